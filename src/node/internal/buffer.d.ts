@@ -1,12 +1,5 @@
 // Type definitions for c++ implementation
 
-interface CompareOptions {
-  aStart?: number;
-  aEnd?: number;
-  bStart?: number;
-  bEnd?: number;
-}
-
 type BufferSource = ArrayBufferView | ArrayBuffer;
 
 export type Encoding = number;
@@ -15,7 +8,10 @@ export function byteLength(value: string): number;
 export function compare(
   a: Uint8Array,
   b: Uint8Array,
-  options?: CompareOptions
+  aStart: number,
+  aEnd: number,
+  bStart: number,
+  bEnd: number
 ): number;
 export function concat(list: Uint8Array[], length: number): Uint8Array;
 export function decodeString(value: string, encoding: Encoding): Uint8Array;
@@ -15,6 +15,16 @@ export function randomPrime(
   add?: ArrayBufferView | undefined,
   rem?: ArrayBufferView | undefined
 ): ArrayBuffer;
+export function checkPrimeAsync(
+  candidate: ArrayBufferView,
+  num_checks: number
+): Promise<boolean>;
+export function randomPrimeAsync(
+  size: number,
+  safe: boolean,
+  add?: ArrayBufferView | undefined,
+  rem?: ArrayBufferView | undefined
+): Promise<ArrayBuffer>;
 
 // X509Certificate
 export interface CheckOptions {
@@ -76,6 +86,13 @@ export function getHkdf(
   info: ArrayLike,
   length: number
 ): ArrayBuffer;
+export function getHkdfAsync(
+  hash: string,
+  key: ArrayLike,
+  salt: ArrayLike,
+  info: ArrayLike,
+  length: number
+): Promise<ArrayBuffer>;
 
 // pbkdf2
 export function getPbkdf(
@@ -85,6 +102,13 @@ export function getPbkdf(
   keylen: number,
   digest: string
 ): ArrayBuffer;
+export function getPbkdfAsync(
+  password: ArrayLike,
+  salt: ArrayLike,
+  iterations: number,
+  keylen: number,
+  digest: string
+): Promise<ArrayBuffer>;
 
 // scrypt
 export function getScrypt(
@@ -96,6 +120,15 @@ export function getScrypt(
   maxmem: number,
   keylen: number
 ): ArrayBuffer;
+export function getScryptAsync(
+  password: ArrayLike,
+  salt: ArrayLike,
+  N: number,
+  r: number,
+  p: number,
+  maxmem: number,
+  keylen: number
+): Promise<ArrayBuffer>;
 
 // Keys
 export function exportKey(
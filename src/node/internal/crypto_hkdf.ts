@@ -137,7 +137,7 @@ export function hkdf(
 
   new Promise<ArrayBuffer>((res, rej) => {
     try {
-      res(cryptoImpl.getHkdf(hash, key as ArrayLike, salt, info, length));
+      res(cryptoImpl.getHkdfAsync(hash, key as ArrayLike, salt, info, length));
     } catch (err) {
       rej(err);
     }
@@ -372,15 +372,18 @@ export function generatePrime(
     options as GeneratePrimeOptions
   );
 
-  new Promise<bigint | ArrayBuffer>((res, rej) => {
+  new Promise<ArrayBuffer>((res, rej) => {
     try {
-      const primeBuf = cryptoImpl.randomPrime(size, safe, add, rem);
-      res(bigint ? arrayBufferToUnsignedBigInt(primeBuf) : primeBuf);
+      res(cryptoImpl.randomPrimeAsync(size, safe, add, rem));
     } catch (err) {
       rej(err);
     }
   }).then(
-    (val) => callback!(null, val),
+    (primeBuf) =>
+      callback!(
+        null,
+        bigint ? arrayBufferToUnsignedBigInt(primeBuf) : primeBuf
+      ),
     (err) => callback!(err)
   );
 }
@@ -449,7 +452,7 @@ export function checkPrime(
   const checks = validateChecks(options);
   new Promise<boolean>((res, rej) => {
     try {
-      res(cryptoImpl.checkPrimeSync(candidate as ArrayBufferView, checks));
+      res(cryptoImpl.checkPrimeAsync(candidate as ArrayBufferView, checks));
     } catch (err) {
       rej(err);
     }
@@ -172,7 +172,7 @@ export function scrypt(
 
   new Promise<ArrayBuffer>((res, rej) => {
     try {
-      res(cryptoImpl.getScrypt(password, salt, N, r, p, maxmem, keylen));
+      res(cryptoImpl.getScryptAsync(password, salt, N, r, p, maxmem, keylen));
     } catch (err) {
       rej(err);
     }
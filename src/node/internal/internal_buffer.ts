@@ -495,7 +495,7 @@ export function compare(a: Buffer | Uint8Array, b: Buffer | Uint8Array) {
   }
   if (a === b) return 0;
 
-  return bufferUtil.compare(a, b);
+  return bufferUtil.compare(a, b, 0, a.length, 0, b.length);
 }
 
 Buffer.compare = compare;
@@ -751,12 +751,14 @@ Buffer.prototype.compare = function compare(
     validateOffset(thisEnd as number, 'sourceEnd', 0, this.length);
   }
 
-  return bufferUtil.compare(this, target, {
-    aStart: thisStart as number,
-    aEnd: thisEnd as number,
-    bStart: start as number,
-    bEnd: end as number,
-  });
+  return bufferUtil.compare(
+    this,
+    target,
+    thisStart as number,
+    thisEnd as number,
+    start,
+    end
+  );
 };
 
 function includes(
@@ -3,7 +3,9 @@
  * optimizations:
  * - Wheels are decompressed with a DecompressionStream instead of in Python
  * - Wheels are overlaid onto the site-packages dir instead of actually being copied
- * - Wheels are fetched from a disk cache if available.
+ * - Wheels are fetched from a disk cache if available. The cache is keyed by the wheel's sha256
+ *   from the lockfile and holds the already decompressed tarball, so every isolate sharing the
+ *   cache directory skips both the download and the decompression.
  *
  * Note that loadPackages is only used in local dev for now, internally we use the full big bundle
  * that contains all the packages ready to go.
@@ -38,25 +40,28 @@ async function decompressArrayBuffer(
   }
 }
 
-function getFilenameOfPackage(requirement: string): string {
+function getPackageDeclaration(requirement: string): PackageDeclaration {
   const obj = LOCKFILE['packages'][requirement];
   if (!obj) {
     throw new Error('Requirement ' + requirement + ' not found in lockfile');
   }
 
-  return obj.file_name;
+  return obj;
+}
+
+function getFilenameOfPackage(requirement: string): string {
+  return getPackageDeclaration(requirement).file_name;
 }
 
 // loadBundleFromR2 loads the package from the internet (through fetch) and uses the DiskCache as
 // a backing store. This is only used in local dev.
 async function loadBundleFromR2(requirement: string): Promise<Reader> {
   // first check if the disk cache has what we want
-  const filename = getFilenameOfPackage(requirement);
-  const cached = DiskCache.get(filename);
+  const { file_name: filename, sha256 } = getPackageDeclaration(requirement);
+  const cacheKey = sha256 + '.tar';
+  const cached = DiskCache.get(cacheKey);
   if (cached) {
-    const decompressed = await decompressArrayBuffer(cached);
-    const reader = new ArrayBufferReader(decompressed);
-    return reader;
+    return new ArrayBufferReader(cached);
   }
 
   // we didn't find it in the disk cache, continue with original fetch
@@ -66,7 +71,7 @@ async function loadBundleFromR2(requirement: string): Promise<Reader> {
   const compressed = await response.arrayBuffer();
   const decompressed = await decompressArrayBuffer(compressed);
 
-  DiskCache.put(filename, compressed);
+  DiskCache.put(cacheKey, decompressed);
   const reader = new ArrayBufferReader(decompressed);
   return reader;
 }
@@ -73,6 +73,29 @@ KJ_TEST("we support deserializing up to v15") {
   });
 }
 
+KJ_TEST("compressed values round-trip through deserializeV8Value") {
+  jsg::test::Evaluator<ActorStateContext, ActorStateIsolate> e(v8System);
+  e.getIsolate().runInLockScope([&](ActorStateIsolate::Lock& isolateLock) {
+    JSG_WITHIN_CONTEXT_SCOPE(isolateLock,
+        isolateLock.newContext<ActorStateContext>().getHandle(isolateLock), [&](jsg::Lock& js) {
+      auto text = kj::str(kj::repeat('a', 10000));
+      auto buf = serializeV8Value(js, js.str(text));
+      auto size = buf.size();
+      auto compressed = compressStoredValue(kj::mv(buf));
+      KJ_EXPECT(compressed.size() < size);
+      KJ_EXPECT(compressed[0] != 0xFF);
+      KJ_EXPECT(deserializeV8Value(js, "some-key"_kj, compressed).toString(js) == text);
+
+      // Small values are left alone.
+      auto small = serializeV8Value(js, js.boolean(true));
+      auto smallSize = small.size();
+      auto uncompressed = compressStoredValue(kj::mv(small));
+      KJ_EXPECT(uncompressed.size() == smallSize);
+      KJ_EXPECT(uncompressed[0] == 0xFF);
+    });
+  });
+}
+
 // This is hacky, but we want to compare the old deserialization logic that's been in prod from when
 // actors went live through March 2022 to the new version of the deserialization logic and make sure
 // it works the same.
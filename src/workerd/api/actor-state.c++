@@ -19,6 +19,7 @@
 #include <workerd/jsg/util.h>
 
 #include <v8.h>
+#include <zlib.h>
 
 namespace workerd::api {
 
@@ -120,6 +121,27 @@ ActorObserver& currentActorMetrics() {
   return IoContext::current().getActorOrThrow().getMetrics();
 }
 
+void billListReadUnits(size_t cachedReadBytes, size_t uncachedReadBytes, bool completelyCached) {
+  auto& actorMetrics = currentActorMetrics();
+  if (cachedReadBytes || uncachedReadBytes) {
+    size_t totalReadBytes = cachedReadBytes + uncachedReadBytes;
+    uint32_t totalUnits = billingUnits(totalReadBytes);
+
+    // If we went to disk, we want to ensure we bill at least 1 uncached unit.
+    // Otherwise, we disable this behavior, to ensure a fully cached list will have
+    // uncachedUnits == 0.
+    auto billAtLeastOne = completelyCached ? BillAtLeastOne::NO : BillAtLeastOne::YES;
+    uint32_t uncachedUnits = billingUnits(uncachedReadBytes, billAtLeastOne);
+    uint32_t cachedUnits = totalUnits - uncachedUnits;
+
+    actorMetrics.addUncachedStorageReadUnits(uncachedUnits);
+    actorMetrics.addCachedStorageReadUnits(cachedUnits);
+  } else {
+    // We bill 1 uncached read unit if there was no results from the list.
+    actorMetrics.addUncachedStorageReadUnits(1);
+  }
+}
+
 jsg::JsRef<jsg::JsValue> listResultsToMap(
     jsg::Lock& js, ActorCacheOps::GetResultList value, bool completelyCached) {
   return js.withinHandleScope([&] {
@@ -132,29 +154,137 @@ jsg::JsRef<jsg::JsValue> listResultsToMap(
       bytesRef += entry.key.size() + entry.value.size();
       map.set(js, entry.key, deserializeV8Value(js, entry.key, entry.value));
     }
-    auto& actorMetrics = currentActorMetrics();
-    if (cachedReadBytes || uncachedReadBytes) {
-      size_t totalReadBytes = cachedReadBytes + uncachedReadBytes;
-      uint32_t totalUnits = billingUnits(totalReadBytes);
-
-      // If we went to disk, we want to ensure we bill at least 1 uncached unit.
-      // Otherwise, we disable this behavior, to ensure a fully cached list will have
-      // uncachedUnits == 0.
-      auto billAtLeastOne = completelyCached ? BillAtLeastOne::NO : BillAtLeastOne::YES;
-      uint32_t uncachedUnits = billingUnits(uncachedReadBytes, billAtLeastOne);
-      uint32_t cachedUnits = totalUnits - uncachedUnits;
-
-      actorMetrics.addUncachedStorageReadUnits(uncachedUnits);
-      actorMetrics.addCachedStorageReadUnits(cachedUnits);
-    } else {
-      // We bill 1 uncached read unit if there was no results from the list.
-      actorMetrics.addUncachedStorageReadUnits(1);
-    }
+    billListReadUnits(cachedReadBytes, uncachedReadBytes, completelyCached);
 
     return jsg::JsValue(map).addRef(js);
   });
 }
 
+// Like listResultsToMap(), but only bills for the read, for when the results are only wanted for
+// their side effect of populating the cache.
+void billListResults(ActorCacheOps::GetResultList value, bool completelyCached) {
+  size_t cachedReadBytes = 0;
+  size_t uncachedReadBytes = 0;
+  for (auto entry: value) {
+    auto& bytesRef =
+        entry.status == ActorCacheOps::CacheStatus::CACHED ? cachedReadBytes : uncachedReadBytes;
+    bytesRef += entry.key.size() + entry.value.size();
+  }
+  billListReadUnits(cachedReadBytes, uncachedReadBytes, completelyCached);
+}
+
+// The key range selected by a `ListOptions`.
+struct ListRange {
+  kj::String start;
+  kj::Maybe<kj::String> end;
+  bool reverse = false;
+  kj::Maybe<uint> limit;
+};
+
+// Computes the key range selected by the options to list() or prefetch(), taking ownership of the
+// keys in `maybeOptions`. Returns none if the range is known to be empty.
+kj::Maybe<ListRange> getListRange(
+    kj::Maybe<DurableObjectStorageOperations::ListOptions&> maybeOptions) {
+  kj::String start;
+  kj::Maybe<kj::String> end;
+  bool reverse = false;
+  kj::Maybe<uint> limit;
+
+  KJ_IF_SOME(o, maybeOptions) {
+    KJ_IF_SOME(s, o.start) {
+      if (o.startAfter != kj::none) {
+        KJ_FAIL_REQUIRE(
+            "jsg.TypeError: list() cannot be called with both start and startAfter values.");
+      }
+      start = kj::mv(s);
+    }
+    KJ_IF_SOME(sks, o.startAfter) {
+      // Convert an exclusive startAfter into an inclusive start key here so that the implementation
+      // doesn't need to handle both. This can be done simply by adding two NULL bytes. One to the end of
+      // the startAfter and another to set the start key after startAfter.
+      auto startAfterKey = kj::heapArray<char>(sks.size() + 2);
+
+      // Copy over the original string.
+      memcpy(startAfterKey.begin(), sks.begin(), sks.size());
+      // Add one additional null byte to set the new start as the key immediately
+      // after startAfter. This looks a little sketchy to be doing with strings rather
+      // than arrays, but kj::String explicitly allows for NULL bytes inside of strings.
+      startAfterKey[startAfterKey.size() - 2] = '\0';
+      // kj::String automatically reads the last NULL as string termination, so we need to add it twice
+      // to make it stick in the final string.
+      startAfterKey[startAfterKey.size() - 1] = '\0';
+      start = kj::String(kj::mv(startAfterKey));
+    }
+    KJ_IF_SOME(e, o.end) {
+      end = kj::mv(e);
+    }
+    KJ_IF_SOME(r, o.reverse) {
+      reverse = r;
+    }
+    KJ_IF_SOME(l, o.limit) {
+      JSG_REQUIRE(l > 0, TypeError, "List limit must be positive.");
+      limit = l;
+    }
+    KJ_IF_SOME(prefix, o.prefix) {
+      // Let's clamp `start` and `end` to include only keys with the given prefix.
+      if (prefix.size() > 0) {
+        if (start < prefix) {
+          // `start` is before `prefix`, so listing should actually start at `prefix`.
+          start = kj::str(prefix);
+        } else if (start.startsWith(prefix)) {
+          // `start` is within the prefix, so need not be modified.
+        } else {
+          // `start` comes after the last value with the prefix, so there's no overlap.
+          return kj::none;
+        }
+
+        // Calculate the first key that sorts after all keys with the given prefix.
+        kj::Vector<char> keyAfterPrefix(prefix.size());
+        keyAfterPrefix.addAll(prefix);
+        while (!keyAfterPrefix.empty() && (byte)keyAfterPrefix.back() == 0xff) {
+          keyAfterPrefix.removeLast();
+        }
+        if (keyAfterPrefix.empty()) {
+          // The prefix is a string of some number of 0xff bytes, so includes the entire key space
+          // up through the last possible key. Hence, there is no end. (But if an end was specified
+          // earlier, that's still valid.)
+        } else {
+          keyAfterPrefix.back()++;
+          keyAfterPrefix.add('\0');
+          auto keyAfterPrefixStr = kj::String(keyAfterPrefix.releaseAsArray());
+
+          KJ_IF_SOME(e, end) {
+            if (e <= prefix) {
+              // No keys could possibly match both the end and the prefix.
+              return kj::none;
+            } else if (e.startsWith(prefix)) {
+              // `end` is within the prefix, so need not be modified.
+            } else {
+              // `end` comes after all keys with the prefix, so we should stop at the end of the
+              // prefix.
+              end = kj::mv(keyAfterPrefixStr);
+            }
+          } else {
+            // We didn't have any end set, so use the end of the prefix range.
+            end = kj::mv(keyAfterPrefixStr);
+          }
+        }
+      }
+    }
+  }
+
+  KJ_IF_SOME(e, end) {
+    if (e <= start) {
+      // Key range is empty.
+      return kj::none;
+    }
+  }
+
+  return ListRange{
+    .start = kj::mv(start), .end = kj::mv(end), .reverse = reverse, .limit = limit};
+}
+
+
 kj::Function<jsg::JsRef<jsg::JsValue>(jsg::Lock&, ActorCacheOps::GetResultList)>
 getMultipleResultsToMap(size_t numInputKeys) {
   return [numInputKeys](jsg::Lock& js, ActorCacheOps::GetResultList value) mutable {
@@ -303,109 +433,20 @@ jsg::Promise<kj::Maybe<double>> DurableObjectStorageOperations::getAlarm(
 
 jsg::Promise<jsg::JsRef<jsg::JsValue>> DurableObjectStorageOperations::list(
     jsg::Lock& js, jsg::Optional<ListOptions> maybeOptions) {
-  kj::String start;
-  kj::Maybe<kj::String> end;
-  bool reverse = false;
-  kj::Maybe<uint> limit;
-
-  auto makeEmptyResult = [&]() { return js.resolvedPromise(jsg::JsValue(js.map()).addRef(js)); };
-
-  KJ_IF_SOME(o, maybeOptions) {
-    KJ_IF_SOME(s, o.start) {
-      if (o.startAfter != kj::none) {
-        KJ_FAIL_REQUIRE(
-            "jsg.TypeError: list() cannot be called with both start and startAfter values.");
-      }
-      start = kj::mv(s);
-    }
-    KJ_IF_SOME(sks, o.startAfter) {
-      // Convert an exclusive startAfter into an inclusive start key here so that the implementation
-      // doesn't need to handle both. This can be done simply by adding two NULL bytes. One to the end of
-      // the startAfter and another to set the start key after startAfter.
-      auto startAfterKey = kj::heapArray<char>(sks.size() + 2);
-
-      // Copy over the original string.
-      memcpy(startAfterKey.begin(), sks.begin(), sks.size());
-      // Add one additional null byte to set the new start as the key immediately
-      // after startAfter. This looks a little sketchy to be doing with strings rather
-      // than arrays, but kj::String explicitly allows for NULL bytes inside of strings.
-      startAfterKey[startAfterKey.size() - 2] = '\0';
-      // kj::String automatically reads the last NULL as string termination, so we need to add it twice
-      // to make it stick in the final string.
-      startAfterKey[startAfterKey.size() - 1] = '\0';
-      start = kj::String(kj::mv(startAfterKey));
-    }
-    KJ_IF_SOME(e, o.end) {
-      end = kj::mv(e);
-    }
-    KJ_IF_SOME(r, o.reverse) {
-      reverse = r;
-    }
-    KJ_IF_SOME(l, o.limit) {
-      JSG_REQUIRE(l > 0, TypeError, "List limit must be positive.");
-      limit = l;
-    }
-    KJ_IF_SOME(prefix, o.prefix) {
-      // Let's clamp `start` and `end` to include only keys with the given prefix.
-      if (prefix.size() > 0) {
-        if (start < prefix) {
-          // `start` is before `prefix`, so listing should actually start at `prefix`.
-          start = kj::str(prefix);
-        } else if (start.startsWith(prefix)) {
-          // `start` is within the prefix, so need not be modified.
-        } else {
-          // `start` comes after the last value with the prefix, so there's no overlap.
-          return makeEmptyResult();
-        }
-
-        // Calculate the first key that sorts after all keys with the given prefix.
-        kj::Vector<char> keyAfterPrefix(prefix.size());
-        keyAfterPrefix.addAll(prefix);
-        while (!keyAfterPrefix.empty() && (byte)keyAfterPrefix.back() == 0xff) {
-          keyAfterPrefix.removeLast();
-        }
-        if (keyAfterPrefix.empty()) {
-          // The prefix is a string of some number of 0xff bytes, so includes the entire key space
-          // up through the last possible key. Hence, there is no end. (But if an end was specified
-          // earlier, that's still valid.)
-        } else {
-          keyAfterPrefix.back()++;
-          keyAfterPrefix.add('\0');
-          auto keyAfterPrefixStr = kj::String(keyAfterPrefix.releaseAsArray());
-
-          KJ_IF_SOME(e, end) {
-            if (e <= prefix) {
-              // No keys could possibly match both the end and the prefix.
-              return makeEmptyResult();
-            } else if (e.startsWith(prefix)) {
-              // `end` is within the prefix, so need not be modified.
-            } else {
-              // `end` comes after all keys with the prefix, so we should stop at the end of the
-              // prefix.
-              end = kj::mv(keyAfterPrefixStr);
-            }
-          } else {
-            // We didn't have any end set, so use the end of the prefix range.
-            end = kj::mv(keyAfterPrefixStr);
-          }
-        }
-      }
-    }
-  }
-
-  KJ_IF_SOME(e, end) {
-    if (e <= start) {
-      // Key range is empty.
-      return makeEmptyResult();
-    }
+  ListRange range;
+  KJ_IF_SOME(r, getListRange(maybeOptions)) {
+    range = kj::mv(r);
+  } else {
+    return js.resolvedPromise(jsg::JsValue(js.map()).addRef(js));
   }
 
   auto options = configureOptions(kj::mv(maybeOptions).orDefault(ListOptions{}));
   ActorCacheOps::ReadOptions readOptions = options;
 
-  auto result = reverse
-      ? getCache(OP_LIST).listReverse(kj::mv(start), kj::mv(end), limit, readOptions)
-      : getCache(OP_LIST).list(kj::mv(start), kj::mv(end), limit, readOptions);
+  auto result = range.reverse
+      ? getCache(OP_LIST).listReverse(
+            kj::mv(range.start), kj::mv(range.end), range.limit, readOptions)
+      : getCache(OP_LIST).list(kj::mv(range.start), kj::mv(range.end), range.limit, readOptions);
   return transformCacheResultWithCacheStatus(js, kj::mv(result), options, &listResultsToMap);
 }
 
@@ -481,7 +522,11 @@ jsg::Promise<void> DurableObjectStorageOperations::putOne(
     jsg::Lock& js, kj::String key, jsg::JsValue value, const PutOptions& options) {
   kj::Array<byte> buffer = serializeV8Value(js, value);
 
+  // Billing is by the serialized size, whether or not the value is stored compressed.
   auto units = billingUnits(key.size() + buffer.size());
+  if (FeatureFlags::get(js).getStorageValueCompression()) {
+    buffer = compressStoredValue(kj::mv(buffer));
+  }
 
   jsg::Promise<void> maybeBackpressure = transformMaybeBackpressure(
       js, options, getCache(OP_PUT).put(kj::mv(key), kj::mv(buffer), options));
@@ -527,7 +572,9 @@ jsg::Promise<void> DurableObjectStorage::deleteAll(
     jsg::Lock& js, jsg::Optional<PutOptions> maybeOptions) {
   auto options = configureOptions(kj::mv(maybeOptions).orDefault(PutOptions{}));
 
-  auto deleteAll = cache->deleteAll(options);
+  ActorCacheOps::WriteOptions writeOptions = options;
+  writeOptions.estimateDeleteAllCount = FeatureFlags::get(js).getDeleteAllEstimatesKeyCount();
+  auto deleteAll = cache->deleteAll(writeOptions);
 
   auto& context = IoContext::current();
   context.addTask(updateStorageDeletes(context, currentActorMetrics(), kj::mv(deleteAll.count)));
@@ -561,6 +608,7 @@ jsg::Promise<void> DurableObjectStorageOperations::putMultiple(
   kj::Vector<ActorCacheOps::KeyValuePair> kvs(entries.fields.size());
 
   uint32_t units = 0;
+  bool compress = FeatureFlags::get(js).getStorageValueCompression();
   for (auto& field: entries.fields) {
     if (field.value.isUndefined()) continue;
     // We silently drop fields with value=undefined in putMultiple. There aren't many good options here, as
@@ -570,6 +618,9 @@ jsg::Promise<void> DurableObjectStorageOperations::putMultiple(
     kj::Array<byte> buffer = serializeV8Value(js, field.value);
 
     units += billingUnits(field.name.size() + buffer.size());
+    if (compress) {
+      buffer = compressStoredValue(kj::mv(buffer));
+    }
 
     kvs.add(ActorCacheOps::KeyValuePair{kj::mv(field.name), kj::mv(buffer)});
   }
@@ -698,6 +749,40 @@ jsg::Promise<void> DurableObjectStorage::sync(jsg::Lock& js) {
   }
 }
 
+jsg::Promise<void> DurableObjectStorage::prefetch(
+    jsg::Lock& js, jsg::Optional<ListOptions> maybeOptions) {
+  ListRange range;
+  KJ_IF_SOME(r, getListRange(maybeOptions)) {
+    range = kj::mv(r);
+  } else {
+    return js.resolvedPromise();
+  }
+
+  // The whole point is to populate the cache, so `noCache` is ignored.
+  ActorCacheOps::ReadOptions readOptions;
+  auto result = range.reverse
+      ? getCache(OP_LIST).listReverse(
+            kj::mv(range.start), kj::mv(range.end), range.limit, readOptions)
+      : getCache(OP_LIST).list(kj::mv(range.start), kj::mv(range.end), range.limit, readOptions);
+
+  KJ_SWITCH_ONEOF(result) {
+    KJ_CASE_ONEOF(value, ActorCacheOps::GetResultList) {
+      // Already entirely in cache.
+      billListResults(kj::mv(value), true);
+      return js.resolvedPromise();
+    }
+    KJ_CASE_ONEOF(promise, kj::Promise<ActorCacheOps::GetResultList>) {
+      // Nothing is returned to the application, so there's no need to wait for the input lock.
+      auto& context = IoContext::current();
+      return context.awaitIo(js, kj::mv(promise),
+          [](jsg::Lock&, ActorCacheOps::GetResultList&& value) {
+        billListResults(kj::mv(value), false);
+      });
+    }
+  }
+  KJ_UNREACHABLE;
+}
+
 SqliteDatabase& DurableObjectStorage::getSqliteDb(jsg::Lock& js) {
   KJ_IF_SOME(db, cache->getSqliteDatabase()) {
     // Actor is SQLite-backed but let's make sure SQL is configured to be enabled.
@@ -927,32 +1012,84 @@ kj::Array<jsg::Ref<api::WebSocket>> DurableObjectState::getWebSockets(
   return kj::Array<jsg::Ref<api::WebSocket>>();
 }
 
+uint DurableObjectState::broadcast(jsg::Lock& js,
+    kj::Maybe<kj::String> tag,
+    kj::OneOf<kj::Array<byte>, kj::String> message,
+    jsg::Optional<BroadcastOptions> options) {
+  auto& a = KJ_REQUIRE_NONNULL(IoContext::current().getActor());
+  KJ_IF_SOME(manager, a.getHibernationManager()) {
+    kj::ArrayPtr<const jsg::Ref<api::WebSocket>> except;
+    KJ_IF_SOME(o, options) {
+      KJ_IF_SOME(e, o.except) {
+        except = e;
+      }
+    }
+    return manager.broadcast(
+        js, tag.map([](kj::StringPtr t) { return t; }), kj::mv(message), except);
+  }
+  return 0;
+}
+
+jsg::Ref<WebSocketRequestResponsePair> WebSocketRequestResponsePair::constructor(
+    kj::String request, kj::String response, jsg::Optional<Options> options) {
+  bool prefix = false;
+  KJ_IF_SOME(o, options) {
+    KJ_IF_SOME(match, o.match) {
+      JSG_REQUIRE(match == "exact" || match == "prefix", TypeError,
+          "The match option must be \"exact\" or \"prefix\".");
+      prefix = match == "prefix";
+    }
+  }
+  JSG_REQUIRE(!prefix || request.size() > 0, RangeError,
+      "A prefix auto-response request cannot be empty.");
+  return jsg::alloc<WebSocketRequestResponsePair>(kj::mv(request), kj::mv(response), prefix);
+}
+
 void DurableObjectState::setWebSocketAutoResponse(
     jsg::Optional<jsg::Ref<WebSocketRequestResponsePair>> maybeReqResp) {
+  KJ_IF_SOME(reqResp, maybeReqResp) {
+    setWebSocketAutoResponses(kj::arr(kj::mv(reqResp)));
+  } else {
+    // If there's no request/response pair, we unset any current set auto response configuration.
+    setWebSocketAutoResponses(nullptr);
+  }
+}
+
+void DurableObjectState::setWebSocketAutoResponses(
+    kj::Array<jsg::Ref<WebSocketRequestResponsePair>> pairs) {
   auto& a = KJ_REQUIRE_NONNULL(IoContext::current().getActor());
 
-  if (maybeReqResp == kj::none) {
-    // If there's no request/response pair, we unset any current set auto response configuration.
+  if (pairs.size() == 0) {
     KJ_IF_SOME(manager, a.getHibernationManager()) {
       // If there's no hibernation manager created yet, there's nothing to do here.
-      manager.setWebSocketAutoResponse(kj::none, kj::none);
+      manager.setWebSocketAutoResponses(nullptr);
     }
     return;
   }
 
-  auto reqResp = KJ_REQUIRE_NONNULL(kj::mv(maybeReqResp));
   auto maxRequestOrResponseSize = 2048;
+  JSG_REQUIRE(pairs.size() <= MAX_AUTO_RESPONSES, RangeError, "A maximum of ", MAX_AUTO_RESPONSES,
+      " auto-responses can be set, but ", pairs.size(), " were provided.");
+
+  auto rules = kj::heapArrayBuilder<Worker::Actor::HibernationManager::AutoResponseRule>(
+      pairs.size());
+  for (auto& reqResp: pairs) {
+    JSG_REQUIRE(reqResp->getRequest().size() <= maxRequestOrResponseSize, RangeError,
+        kj::str("Request cannot be larger than ", maxRequestOrResponseSize, " bytes. ",
+            "A request of size ", reqResp->getRequest().size(), " was provided."));
+
+    JSG_REQUIRE(reqResp->getResponse().size() <= maxRequestOrResponseSize, RangeError,
+        kj::str("Response cannot be larger than ", maxRequestOrResponseSize, " bytes. ",
+            "A response of size ", reqResp->getResponse().size(), " was provided."));
+
+    rules.add(Worker::Actor::HibernationManager::AutoResponseRule{
+      .request = kj::str(reqResp->getRequest()),
+      .response = kj::str(reqResp->getResponse()),
+      .prefix = reqResp->isPrefix(),
+    });
+  }
 
-  JSG_REQUIRE(reqResp->getRequest().size() <= maxRequestOrResponseSize, RangeError,
-      kj::str("Request cannot be larger than ", maxRequestOrResponseSize, " bytes. ",
-          "A request of size ", reqResp->getRequest().size(), " was provided."));
-
-  JSG_REQUIRE(reqResp->getResponse().size() <= maxRequestOrResponseSize, RangeError,
-      kj::str("Response cannot be larger than ", maxRequestOrResponseSize, " bytes. ",
-          "A response of size ", reqResp->getResponse().size(), " was provided."));
-
-  maybeInitHibernationManager(a).setWebSocketAutoResponse(
-      reqResp->getRequest(), reqResp->getResponse());
+  maybeInitHibernationManager(a).setWebSocketAutoResponses(rules.finish());
 }
 
 kj::Maybe<jsg::Ref<api::WebSocketRequestResponsePair>> DurableObjectState::
@@ -989,6 +1126,20 @@ void DurableObjectState::setHibernatableWebSocketEventTimeout(jsg::Optional<uint
   maybeInitHibernationManager(a).setEventTimeout(t);
 }
 
+void DurableObjectState::setHibernatableWebSocketIdleTimeout(jsg::Optional<uint32_t> timeoutMs) {
+  auto& a = KJ_REQUIRE_NONNULL(IoContext::current().getActor());
+
+  // Like the event timeout, 0ms or an empty value unsets the idle timeout.
+  if (timeoutMs == kj::none || KJ_REQUIRE_NONNULL(timeoutMs) == 0) {
+    KJ_IF_SOME(hibernationManager, a.getHibernationManager()) {
+      hibernationManager.setWebSocketIdleTimeout(kj::none);
+    }
+    return;
+  }
+
+  maybeInitHibernationManager(a).setWebSocketIdleTimeout(KJ_REQUIRE_NONNULL(timeoutMs));
+}
+
 kj::Maybe<uint32_t> DurableObjectState::getHibernatableWebSocketEventTimeout() {
   KJ_IF_SOME(a, IoContext::current().getActor()) {
     KJ_IF_SOME(manager, a.getHibernationManager()) {
@@ -1013,10 +1164,72 @@ kj::Array<kj::byte> serializeV8Value(jsg::Lock& js, const jsg::JsValue& value) {
   return kj::mv(released.data);
 }
 
+namespace {
+
+// Leading byte of a value stored by compressStoredValue(), followed by the value's uncompressed
+// size as a little-endian uint32 and then the zlib stream. V8's serialization format never starts
+// with this byte: values begin with the 0xFF version tag, or, for values written before headers
+// were, with a type tag, all of which are printable ASCII.
+constexpr kj::byte COMPRESSED_VALUE_TAG = 0x01;
+constexpr size_t COMPRESSED_VALUE_HEADER_SIZE = 5;
+
+// Smaller values rarely shrink enough to be worth the CPU time.
+constexpr size_t COMPRESSION_THRESHOLD = 4096;
+
+kj::Array<kj::byte> decompressStoredValue(
+    kj::ArrayPtr<const char> key, kj::ArrayPtr<const kj::byte> buf) {
+  KJ_ASSERT(buf.size() > COMPRESSED_VALUE_HEADER_SIZE, "truncated compressed value", key);
+  uint32_t size = static_cast<uint32_t>(buf[1]) | static_cast<uint32_t>(buf[2]) << 8 |
+      static_cast<uint32_t>(buf[3]) << 16 | static_cast<uint32_t>(buf[4]) << 24;
+  auto result = kj::heapArray<kj::byte>(size);
+  uLongf resultSize = size;
+  auto compressed = buf.slice(COMPRESSED_VALUE_HEADER_SIZE);
+  auto status = uncompress(result.begin(), &resultSize, compressed.begin(), compressed.size());
+  KJ_ASSERT(status == Z_OK && resultSize == size, "actor storage value decompression failed", key,
+      buf.size(), status);
+  return result;
+}
+
+}  // namespace
+
+kj::Array<kj::byte> compressStoredValue(kj::Array<kj::byte> value) {
+  if (value.size() < COMPRESSION_THRESHOLD || value.size() > static_cast<uint32_t>(kj::maxValue)) {
+    return kj::mv(value);
+  }
+
+  auto bound = compressBound(value.size());
+  auto buffer = kj::heapArray<kj::byte>(COMPRESSED_VALUE_HEADER_SIZE + bound);
+  uLongf compressedSize = bound;
+  // Favour speed: this runs on the isolate thread for every large put().
+  auto status = compress2(buffer.begin() + COMPRESSED_VALUE_HEADER_SIZE, &compressedSize,
+      value.begin(), value.size(), Z_BEST_SPEED);
+  auto totalSize = COMPRESSED_VALUE_HEADER_SIZE + compressedSize;
+  if (status != Z_OK || totalSize >= value.size()) {
+    return kj::mv(value);
+  }
+
+  auto size = static_cast<uint32_t>(value.size());
+  buffer[0] = COMPRESSED_VALUE_TAG;
+  buffer[1] = size & 0xff;
+  buffer[2] = (size >> 8) & 0xff;
+  buffer[3] = (size >> 16) & 0xff;
+  buffer[4] = (size >> 24) & 0xff;
+  // Copy into an exactly-sized array, since the cache holds on to it.
+  return kj::heapArray(buffer.first(totalSize));
+}
+
 jsg::JsValue deserializeV8Value(
     jsg::Lock& js, kj::ArrayPtr<const char> key, kj::ArrayPtr<const kj::byte> buf) {
 
   KJ_ASSERT(buf.size() > 0, "unexpectedly empty value buffer", key);
+
+  // Values are decompressed only here, when they're actually read; the cache keeps them
+  // compressed.
+  kj::Array<kj::byte> decompressed;
+  if (buf[0] == COMPRESSED_VALUE_TAG) {
+    decompressed = decompressStoredValue(key, buf);
+    buf = decompressed;
+  }
   try {
     // The js.tryCatch will handle the normal exception path. We wrap this in an
     // additional try/catch in case the js.tryCatch hits an exception that is
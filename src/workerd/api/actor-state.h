@@ -27,6 +27,11 @@ class WebSocket;
 
 kj::Array<kj::byte> serializeV8Value(jsg::Lock& js, const jsg::JsValue& value);
 
+// With the `durable_object_storage_value_compression` flag, values of at least a few KB are stored
+// compressed, tagged so that deserializeV8Value() recognizes them whether or not the flag is set.
+// Returns `value` itself if it is too small or doesn't compress.
+kj::Array<kj::byte> compressStoredValue(kj::Array<kj::byte> value);
+
 jsg::JsValue deserializeV8Value(
     jsg::Lock& js, kj::ArrayPtr<const char> key, kj::ArrayPtr<const kj::byte> buf);
 
@@ -217,6 +222,12 @@ class DurableObjectStorage: public jsg::Object, public DurableObjectStorageOpera
 
   jsg::Promise<void> sync(jsg::Lock& js);
 
+  // Hint that the application is about to read the keys in the given range, so that they should
+  // be loaded into the cache in one round trip, rather than one get() at a time. Accepts the same
+  // range options as list(). The returned promise resolves once the range is cached, but need not
+  // be awaited.
+  jsg::Promise<void> prefetch(jsg::Lock& js, jsg::Optional<ListOptions> options);
+
   jsg::Ref<SqlStorage> getSql(jsg::Lock& js);
 
   // Get a bookmark for the current state of the database. Note that since this is async, the
@@ -275,6 +286,7 @@ class DurableObjectStorage: public jsg::Object, public DurableObjectStorageOpera
     JSG_METHOD(onNextSessionRestoreBookmark);
 
     if (flags.getWorkerdExperimental()) {
+      JSG_METHOD(prefetch);
       JSG_METHOD(waitForBookmark);
       JSG_READONLY_INSTANCE_PROPERTY(primary, getPrimary);
     }
@@ -428,25 +440,44 @@ class ActorState: public jsg::Object {
 
 class WebSocketRequestResponsePair: public jsg::Object {
  public:
-  WebSocketRequestResponsePair(kj::String request, kj::String response)
+  WebSocketRequestResponsePair(kj::String request, kj::String response, bool prefix = false)
       : request(kj::mv(request)),
-        response(kj::mv(response)) {};
+        response(kj::mv(response)),
+        prefix(prefix) {};
 
-  static jsg::Ref<WebSocketRequestResponsePair> constructor(
-      kj::String request, kj::String response) {
-    return jsg::alloc<WebSocketRequestResponsePair>(kj::mv(request), kj::mv(response));
+  struct Options {
+    // "exact" (the default) only matches messages equal to the request. "prefix" matches any
+    // message that starts with it.
+    jsg::Optional<kj::String> match;
+
+    JSG_STRUCT(match);
+    JSG_STRUCT_TS_OVERRIDE(WebSocketRequestResponsePairOptions {
+      match?: "exact" | "prefix";
+    });
   };
 
+  static jsg::Ref<WebSocketRequestResponsePair> constructor(
+      kj::String request, kj::String response, jsg::Optional<Options> options);
+
   kj::StringPtr getRequest() {
     return request.asPtr();
   }
   kj::StringPtr getResponse() {
     return response.asPtr();
   }
+  kj::StringPtr getMatch() {
+    return prefix ? "prefix"_kj : "exact"_kj;
+  }
+  bool isPrefix() {
+    return prefix;
+  }
 
-  JSG_RESOURCE_TYPE(WebSocketRequestResponsePair) {
+  JSG_RESOURCE_TYPE(WebSocketRequestResponsePair, CompatibilityFlags::Reader flags) {
     JSG_READONLY_PROTOTYPE_PROPERTY(request, getRequest);
     JSG_READONLY_PROTOTYPE_PROPERTY(response, getResponse);
+    if (flags.getWorkerdExperimental()) {
+      JSG_READONLY_PROTOTYPE_PROPERTY(match, getMatch);
+    }
   }
 
   void visitForMemoryInfo(jsg::MemoryTracker& tracker) const {
@@ -457,6 +488,7 @@ class WebSocketRequestResponsePair: public jsg::Object {
  private:
   kj::String request;
   kj::String response;
+  bool prefix;
 };
 
 // The type passed as the first parameter to durable object class's constructor.
@@ -507,6 +539,22 @@ class DurableObjectState: public jsg::Object {
   // Disconnected WebSockets are automatically removed from the list.
   kj::Array<jsg::Ref<api::WebSocket>> getWebSockets(jsg::Lock& js, jsg::Optional<kj::String> tag);
 
+  struct BroadcastOptions {
+    // WebSockets that the message is not sent to, typically the one that sent it.
+    jsg::Optional<kj::Array<jsg::Ref<api::WebSocket>>> except;
+
+    JSG_STRUCT(except);
+    JSG_STRUCT_TS_OVERRIDE(DurableObjectBroadcastOptions);
+  };
+
+  // Sends `message` to every accepted WebSocket matching the given tag, or to all accepted
+  // WebSockets if `tag` is null, and returns how many it was sent to. Unlike calling send() on
+  // each result of getWebSockets(), hibernating WebSockets are not woken up to send the message.
+  uint broadcast(jsg::Lock& js,
+      kj::Maybe<kj::String> tag,
+      kj::OneOf<kj::Array<byte>, kj::String> message,
+      jsg::Optional<BroadcastOptions> options);
+
   // Sets an object-wide websocket auto response message for a specific
   // request string. All websockets belonging to the same object must
   // reply to the request with the matching response, then store the timestamp at which
@@ -515,7 +563,12 @@ class DurableObjectState: public jsg::Object {
   void setWebSocketAutoResponse(
       jsg::Optional<jsg::Ref<api::WebSocketRequestResponsePair>> maybeReqResp);
 
-  // Gets the currently set object-wide websocket auto response.
+  // Like setWebSocketAutoResponse(), but sets several request/response pairs at once. A message is
+  // answered with the response of the first pair it matches. An empty array unsets them all.
+  void setWebSocketAutoResponses(kj::Array<jsg::Ref<api::WebSocketRequestResponsePair>> pairs);
+
+  // Gets the currently set object-wide websocket auto response. If several are set, this is the
+  // first one.
   kj::Maybe<jsg::Ref<api::WebSocketRequestResponsePair>> getWebSocketAutoResponse();
 
   // Get the last auto response timestamp or null
@@ -528,6 +581,10 @@ class DurableObjectState: public jsg::Object {
   // Get the currently set hibernatable websocket event timeout if set, or kj::none if not.
   kj::Maybe<uint32_t> getHibernatableWebSocketEventTimeout();
 
+  // Sets or unsets the time after which a hibernatable websocket that hasn't received any message
+  // is delivered to webSocketClose() with code 1001, without the client having closed it.
+  void setHibernatableWebSocketIdleTimeout(jsg::Optional<uint32_t> timeoutMs);
+
   // Gets an array of tags that this websocket was accepted with. If the given websocket is not
   // hibernatable, we'll throw an error because regular websockets do not have tags.
   kj::Array<kj::StringPtr> getTags(jsg::Lock& js, jsg::Ref<api::WebSocket> ws);
@@ -546,6 +603,12 @@ class DurableObjectState: public jsg::Object {
     JSG_METHOD(getHibernatableWebSocketEventTimeout);
     JSG_METHOD(getTags);
 
+    if (flags.getWorkerdExperimental()) {
+      JSG_METHOD(broadcast);
+      JSG_METHOD(setWebSocketAutoResponses);
+      JSG_METHOD(setHibernatableWebSocketIdleTimeout);
+    }
+
     JSG_METHOD(abort);
 
     JSG_TS_ROOT();
@@ -579,6 +642,9 @@ class DurableObjectState: public jsg::Object {
 
   const size_t MAX_TAGS_PER_CONNECTION = 10;
   const size_t MAX_TAG_LENGTH = 256;
+
+  // Limit for Hibernatable WebSocket auto-responses.
+  const size_t MAX_AUTO_RESPONSES = 16;
 };
 
 #define EW_ACTOR_STATE_ISOLATE_TYPES                                                               \
@@ -588,6 +654,7 @@ class DurableObjectState: public jsg::Object {
       api::DurableObjectStorageOperations::GetOptions,                                             \
       api::DurableObjectStorageOperations::GetAlarmOptions,                                        \
       api::DurableObjectStorageOperations::PutOptions,                                             \
-      api::DurableObjectStorageOperations::SetAlarmOptions, api::WebSocketRequestResponsePair
+      api::DurableObjectStorageOperations::SetAlarmOptions, api::WebSocketRequestResponsePair,     \
+      api::DurableObjectState::BroadcastOptions, api::WebSocketRequestResponsePair::Options
 
 }  // namespace workerd::api
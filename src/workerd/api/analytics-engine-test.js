@@ -1,10 +1,10 @@
 import * as assert from 'node:assert';
 
-let written = false;
-async function isWritten(timeout) {
+let written = 0;
+async function isWritten(count, timeout) {
   const start = Date.now();
   do {
-    if (written) return true;
+    if (written >= count) return true;
     await scheduler.wait(100);
   } while (Date.now() - start < timeout);
   throw new Error('Test never received request from analytics engine handler');
@@ -12,7 +12,7 @@ async function isWritten(timeout) {
 
 export default {
   async fetch(ctrl, env, ctx) {
-    written = true;
+    written++;
     return new Response('');
   },
   async test(ctrl, env, ctx) {
@@ -22,7 +22,18 @@ export default {
       indexes: ['testindex'],
     });
 
-    assert.equal(await isWritten(5000), true);
+    assert.equal(await isWritten(1, 5000), true);
+
+    // Data points written together are buffered and flushed as one batch, but each is still
+    // delivered.
+    for (let i = 0; i < 3; i++) {
+      env.aebinding.writeDataPoint({
+        blobs: ['TestBlob'],
+        doubles: [25],
+      });
+    }
+
+    assert.equal(await isWritten(4, 5000), true);
     return new Response('');
   },
 };
@@ -6,37 +6,88 @@
 
 #include <workerd/io/io-context.h>
 
+#include <capnp/message.h>
+#include <capnp/orphan.h>
+#include <kj/vector.h>
+
 namespace workerd::api {
 
+struct AnalyticsEngine::Batch: public kj::Refcounted {
+  Batch(IoContext& context, uint logfwdrChannel)
+      : contextRef(context.getWeakRef()),
+        logfwdrChannel(logfwdrChannel) {}
+
+  kj::Own<IoContext::WeakRef> contextRef;
+  uint logfwdrChannel;
+  capnp::MallocMessageBuilder arena;
+  kj::Vector<capnp::Orphan<api::AnalyticsEngineEvent>> events;
+  bool flushed = false;
+};
+
+AnalyticsEngine::Batch& AnalyticsEngine::getBatch(IoContext& context) {
+  KJ_IF_SOME(b, batch) {
+    KJ_IF_SOME(batchContext, b->contextRef->tryGet()) {
+      if (&batchContext == &context && !b->flushed) {
+        return *b;
+      }
+    }
+  }
+
+  auto& b = *batch.emplace(kj::refcounted<Batch>(context, logfwdrChannel));
+
+  // Flush once the current turn of the event loop is over, by which time a request writing many
+  // data points in a row will have written them all.
+  context.addWaitUntil(kj::evalLater([&context, b = kj::addRef(b)]() mutable {
+    return context.run([&context, b = kj::mv(b)](Worker::Lock&) { flush(context, *b); });
+  }));
+  return b;
+}
+
+void AnalyticsEngine::flush(IoContext& context, Batch& batch) {
+  if (batch.flushed) return;
+  batch.flushed = true;
+  if (batch.events.size() == 0) return;
+
+  context.writeLogfwdrBatch(batch.logfwdrChannel, batch.events.size(),
+      [&](uint index, capnp::AnyPointer::Builder ptr) {
+    ptr.setAs<api::AnalyticsEngineEvent>(batch.events[index].getReader());
+  });
+}
+
 void AnalyticsEngine::writeDataPoint(
     jsg::Lock& js, jsg::Optional<api::AnalyticsEngine::AnalyticsEngineEvent> event) {
   auto& context = IoContext::current();
 
   context.getLimitEnforcer().newAnalyticsEngineRequest();
 
-  context.writeLogfwdr(logfwdrChannel, [&](capnp::AnyPointer::Builder ptr) {
-    api::AnalyticsEngineEvent::Builder aeEvent = ptr.initAs<api::AnalyticsEngineEvent>();
-
-    aeEvent.setAccountId(static_cast<int64_t>(ownerId));
-    aeEvent.setTimestamp(now());
-    aeEvent.setDataset(dataset.asBytes());
-    aeEvent.setSchemaVersion(version);
-    // `index1` should default to the empty string (`""`).
-    // The optional call to `setIndexes()`below assumes defaults, if any.
-    aeEvent.setIndex1(""_kj.asBytes());
-
-    kj::StringPtr errorPrefix = "writeDataPoint(): "_kj;
-    KJ_IF_SOME(ev, event) {
-      KJ_IF_SOME(indexes, ev.indexes) {
-        setIndexes<api::AnalyticsEngineEvent::Builder>(aeEvent, indexes, errorPrefix);
-      }
-      KJ_IF_SOME(blobs, ev.blobs) {
-        setBlobs<api::AnalyticsEngineEvent::Builder>(aeEvent, blobs, errorPrefix);
-      }
-      KJ_IF_SOME(doubles, ev.doubles) {
-        setDoubles<api::AnalyticsEngineEvent::Builder>(aeEvent, doubles, errorPrefix);
-      }
+  auto& batch = getBatch(context);
+  auto orphan = batch.arena.getOrphanage().newOrphan<api::AnalyticsEngineEvent>();
+  api::AnalyticsEngineEvent::Builder aeEvent = orphan.get();
+
+  aeEvent.setAccountId(static_cast<int64_t>(ownerId));
+  aeEvent.setTimestamp(now());
+  aeEvent.setDataset(dataset.asBytes());
+  aeEvent.setSchemaVersion(version);
+  // `index1` should default to the empty string (`""`).
+  // The optional call to `setIndexes()`below assumes defaults, if any.
+  aeEvent.setIndex1(""_kj.asBytes());
+
+  kj::StringPtr errorPrefix = "writeDataPoint(): "_kj;
+  KJ_IF_SOME(ev, event) {
+    KJ_IF_SOME(indexes, ev.indexes) {
+      setIndexes<api::AnalyticsEngineEvent::Builder>(aeEvent, indexes, errorPrefix);
     }
-  });
+    KJ_IF_SOME(blobs, ev.blobs) {
+      setBlobs<api::AnalyticsEngineEvent::Builder>(aeEvent, blobs, errorPrefix);
+    }
+    KJ_IF_SOME(doubles, ev.doubles) {
+      setDoubles<api::AnalyticsEngineEvent::Builder>(aeEvent, doubles, errorPrefix);
+    }
+  }
+
+  batch.events.add(kj::mv(orphan));
+  if (batch.events.size() >= MAX_BATCH_SIZE) {
+    flush(context, batch);
+  }
 }
 }  // namespace workerd::api
@@ -10,6 +10,9 @@
 #include <workerd/io/io-util.h>
 #include <workerd/jsg/jsg.h>
 
+namespace workerd {
+class IoContext;
+}
 namespace workerd::api {
 
 // Analytics Engine is a tool for customers to get telemetry about anything
@@ -53,6 +56,10 @@ class AnalyticsEngine: public jsg::Object {
 
   // Send an Analytics Engine-compatible event to the configured logfwdr socket.
   // Like logfwdr itself, `writeDataPoint` makes no delivery guarantees.
+  //
+  // Data points are validated and encoded immediately, but buffered: those written by a request
+  // during one turn of the event loop are handed to the logfwdr channel together at the end of
+  // the turn, or as soon as MAX_BATCH_SIZE of them have accumulated.
   void writeDataPoint(
       jsg::Lock& js, jsg::Optional<api::AnalyticsEngine::AnalyticsEngineEvent> event);
 
@@ -67,6 +74,11 @@ class AnalyticsEngine: public jsg::Object {
   }
 
  private:
+  static constexpr size_t MAX_BATCH_SIZE = 64;
+
+  // The data points waiting to be flushed, built into one message arena. Defined in the .c++.
+  struct Batch;
+
   double millisToNanos(double m) {
     return m * 1000000;
   }
@@ -76,6 +88,13 @@ class AnalyticsEngine: public jsg::Object {
   int64_t version;
   uint32_t ownerId;
 
+  // The batch being filled by the current request, if any. A batch is only ever appended to by the
+  // IoContext that created it, within one turn of the event loop.
+  kj::Maybe<kj::Own<Batch>> batch;
+
+  Batch& getBatch(IoContext& context);
+  static void flush(IoContext& context, Batch& batch);
+
   uint64_t now() {
     return millisToNanos(dateNow());
   }
@@ -275,7 +275,7 @@ void EventTarget::addEventListener(jsg::Lock& js,
       return signal->newNativeHandler(js, kj::str("abort"), kj::mv(func), true);
     });
 
-    auto eventHandler = kj::heap<EventHandler>(
+    auto eventHandler = kj::refcounted<EventHandler>(
         EventHandler::JavaScriptHandler{
           .identity = kj::mv(handler.identity),
           .callback = kj::mv(handlerFn),
@@ -283,7 +283,7 @@ void EventTarget::addEventListener(jsg::Lock& js,
         },
         once);
 
-    set.handlers.upsert(kj::mv(eventHandler), [&](auto&&...) {});
+    set.add(kj::mv(eventHandler));
   });
 }
 
@@ -305,7 +305,7 @@ void EventTarget::removeEventListener(jsg::Lock& js,
 
   js.withinHandleScope([&] {
     KJ_IF_SOME(handlerSet, typeMap.find(type)) {
-      handlerSet.handlers.eraseMatch(handler);
+      handlerSet.erase(handler);
     }
   });
 }
@@ -313,22 +313,39 @@ void EventTarget::removeEventListener(jsg::Lock& js,
 void EventTarget::addNativeListener(jsg::Lock& js, NativeHandler& handler) {
   auto& set = getOrCreate(handler.type);
 
-  auto eventHandler = kj::heap<EventHandler>(
+  auto eventHandler = kj::refcounted<EventHandler>(
       EventHandler::NativeHandlerRef{
         .handler = handler,
       },
       handler.once);
 
-  set.handlers.upsert(kj::mv(eventHandler), [&](auto&&...) {});
+  set.add(kj::mv(eventHandler));
 }
 
 bool EventTarget::removeNativeListener(EventTarget::NativeHandler& handler) {
   KJ_IF_SOME(handlerSet, typeMap.find(handler.type)) {
-    return handlerSet.handlers.eraseMatch(handler);
+    return handlerSet.erase(handler);
   }
   return false;
 }
 
+void EventTarget::EventHandlerSet::add(kj::Own<EventHandler> handler) {
+  handlers.upsert(kj::mv(handler), [&](auto&&...) {});
+  snapshot = kj::none;
+}
+
+kj::Own<EventTarget::HandlerSnapshot> EventTarget::EventHandlerSet::getSnapshot() {
+  KJ_IF_SOME(existing, snapshot) {
+    return kj::addRef(*existing);
+  }
+  auto builder = kj::heapArrayBuilder<kj::Own<EventHandler>>(handlers.size());
+  for (auto& handler: handlers.ordered<kj::InsertionOrderIndex>()) {
+    builder.add(kj::addRef(*handler));
+  }
+  auto& result = snapshot.emplace(kj::refcounted<HandlerSnapshot>(builder.finish()));
+  return kj::addRef(*result);
+}
+
 EventTarget::EventHandlerSet& EventTarget::getOrCreate(kj::StringPtr type) {
   return typeMap.upsert(kj::str(type), EventHandlerSet(), [&](auto&&...) {}).value;
 }
@@ -339,145 +356,108 @@ bool EventTarget::dispatchEventImpl(jsg::Lock& js, jsg::Ref<Event> event) {
 
   event->clearPreventDefault();
 
-  // First, gather all the function handles that we plan to call. This is important to ensure that
+  // First, take a snapshot of the handlers that we plan to call. This is important to ensure that
   // the callback can add or remove listeners without affecting the current event's processing.
+  // The snapshot is shared with other dispatches until the set changes, so in the common case
+  // this doesn't copy anything.
 
   return js.withinHandleScope([&] {
-    struct Callback {
-      EventHandler::Handler handler;
-      bool once = false;
-      bool oldStyle = false;
+    const auto callJavaScriptHandler = [&](HandlerFunction& callback) {
+      // Per the standard, the event listener is not supposed to return any value, and if it
+      // does, that value is ignored. That can be somewhat problematic if the user passes an
+      // async function as the event handler. Doing so counts as undefined behavior and can
+      // introduce subtle and difficult to diagnose bugs. Here, if the handler does return a
+      // value, we're going to emit a warning but otherwise ignore it. The warning will only
+      // be emitted at most once per EventEmitter instance.
+      auto ret = callback(js, event.addRef());
+      // Note: We used to run each handler in its own v8::TryCatch. However, due to a
+      //   misunderstanding of the V8 API, we incorrectly believed that TryCatch mishandled
+      //   termination (or maybe it actually did at the time), so we changed things such that
+      //   we don't catch exceptions so the first handler to throw an exception terminates the
+      //   loop, and the exception flows out of dispatchEvent(). In theory if multiple
+      //   handlers were registered then maybe we ought to be running all of them even if one
+      //   fails. This isn't entirely clear, though: in the case of 'fetch' handlers, in
+      //   fail-closed mode, an exception from any handler should make the whole request fail,
+      //   but then who cares if the remaining handlers run? Meanwhile, in fail-open mode, for
+      //   consistency, we should probably trigger fallback behavior if any handler throws, so
+      //   again it doesn't matter. For other types of handlers, e.g. WebSocket 'message', it's
+      //   not clear why one would ever register multiple handlers.
+      KJ_IF_SOME(r, ret) {
+        auto handle = r.getHandle(js);
+        // Returning true is the same as calling preventDefault() on the event.
+        if (handle->IsTrue()) {
+          event->preventDefault();
+        }
+        if (warnOnHandlerReturn && !handle->IsBoolean()) {
+          warnOnHandlerReturn = false;
+          // To help make debugging easier, let's tailor the warning a bit if it was a promise.
+          if (handle->IsPromise()) {
+            js.logWarning(
+                kj::str("An event handler returned a promise that will be ignored. Event handlers "
+                        "should not have a return value and should not be async functions."));
+          } else {
+            js.logWarning(kj::str("An event handler returned a value of type \"",
+                handle->TypeOf(js.v8Isolate),
+                "\" that will be ignored. Event handlers should not have a return value."));
+          }
+        }
+      }
     };
 
-    kj::Vector<Callback> callbacks;
-
     // Check if there is an `on<event>` property on this object. If so, we treat that as an event
     // handler, in addition to the ones registered with addEventListener().
+    kj::Maybe<HandlerFunction> onEventHandler;
     KJ_IF_SOME(onProp, onEvents.get(js, kj::str("on", event->getType()))) {
       // If the on-event is not a function, we silently ignore it rather than raise an error.
       KJ_IF_SOME(cb, onProp.tryGet<HandlerFunction>()) {
-        callbacks.add(Callback{
-          .handler =
-              EventHandler::JavaScriptHandler{
-                .identity = nullptr,  // won't be used below if oldStyle is true and once is false
-                .callback = kj::mv(cb),
-              },
-          .oldStyle = true,
-        });
+        onEventHandler = kj::mv(cb);
       }
     }
 
-    auto maybeHandlerSet = typeMap.find(event->getType());
-    KJ_IF_SOME(handlerSet, maybeHandlerSet) {
-      for (auto& handler: handlerSet.handlers.ordered<kj::InsertionOrderIndex>()) {
-        KJ_SWITCH_ONEOF(handler->handler) {
-          KJ_CASE_ONEOF(jsh, EventHandler::JavaScriptHandler) {
-            callbacks.add(Callback{
-              .handler = EventHandler::JavaScriptHandler{.identity = jsh.identity.addRef(js),
-                .callback = jsh.callback.addRef(js)},
-              .once = handler->once,
-            });
-          }
-          KJ_CASE_ONEOF(native, EventHandler::NativeHandlerRef) {
-            callbacks.add(Callback{
-              .handler =
-                  EventHandler::NativeHandlerRef{
-                    .handler = native.handler,
-                  },
-              .once = handler->once,
-            });
-          }
-        }
-      }
+    kj::Maybe<kj::Own<HandlerSnapshot>> snapshot;
+    KJ_IF_SOME(handlerSet, typeMap.find(event->getType())) {
+      snapshot = handlerSet.getSnapshot();
     }
 
-    const auto isRemoved = [&](auto& handler) {
-      // This is not the most efficient way to do this but it's what works right now.
-      // Instead of capturing direct references to the handler structs, we copy those
-      // into the Callbacks vector, which means we need to look up the actual handler
-      // again to see if it still exists in the list. The entire way the storage of the
-      // handlers is done here can be improved to make this more efficient.
-      auto& handlerSet = KJ_ASSERT_NONNULL(maybeHandlerSet);
-      KJ_SWITCH_ONEOF(handler) {
-        KJ_CASE_ONEOF(js, EventHandler::JavaScriptHandler) {
-          return handlerSet.handlers.find(js.identity) == kj::none;
-        }
-        KJ_CASE_ONEOF(native, EventHandler::NativeHandlerRef) {
-          return handlerSet.handlers.find(native.handler) == kj::none;
-        }
+    KJ_IF_SOME(cb, onEventHandler) {
+      if (!event->isStopped()) {
+        callJavaScriptHandler(cb);
       }
-      KJ_UNREACHABLE;
-    };
+    }
 
-    for (auto& callback: callbacks) {
-      if (event->isStopped()) {
-        // stopImmediatePropagation() was called; don't call any further listeners
-        break;
-      }
+    KJ_IF_SOME(s, snapshot) {
+      for (auto& handler: s->handlers) {
+        if (event->isStopped()) {
+          // stopImmediatePropagation() was called; don't call any further listeners
+          break;
+        }
 
-      // If the handler gets removed by an earlier run handler, then we need to
-      // make sure we don't run it. Skip over and continue.
-      if (!callback.oldStyle && isRemoved(callback.handler)) {
-        continue;
-      }
+        // If the handler gets removed by an earlier run handler, then we need to
+        // make sure we don't run it. Skip over and continue.
+        if (handler->removed) {
+          continue;
+        }
 
-      if (callback.once) {
-        KJ_SWITCH_ONEOF(callback.handler) {
+        KJ_SWITCH_ONEOF(handler->handler) {
           KJ_CASE_ONEOF(jsh, EventHandler::JavaScriptHandler) {
-            removeEventListener(js, kj::str(event->getType()), jsh.identity.addRef(js), kj::none);
+            if (handler->once) {
+              // Once removed, the set no longer traces the callback for the GC, so hold a strong
+              // reference of our own for the call.
+              auto callback = jsh.callback.addRef(js);
+              KJ_IF_SOME(handlerSet, typeMap.find(event->getType())) {
+                handlerSet.erase(jsh.identity);
+              }
+              callJavaScriptHandler(callback);
+            } else {
+              callJavaScriptHandler(jsh.callback);
+            }
           }
           KJ_CASE_ONEOF(native, EventHandler::NativeHandlerRef) {
             // The native handler will handle detaching itself when invoked
+            native.handler(js, event.addRef());
           }
         }
       }
-
-      KJ_SWITCH_ONEOF(callback.handler) {
-        KJ_CASE_ONEOF(jsh, EventHandler::JavaScriptHandler) {
-          // Per the standard, the event listener is not supposed to return any value, and if it
-          // does, that value is ignored. That can be somewhat problematic if the user passes an
-          // async function as the event handler. Doing so counts as undefined behavior and can
-          // introduce subtle and difficult to diagnose bugs. Here, if the handler does return a
-          // value, we're going to emit a warning but otherwise ignore it. The warning will only
-          // be emitted at most once per EventEmitter instance.
-          auto ret = jsh.callback(js, event.addRef());
-          // Note: We used to run each handler in its own v8::TryCatch. However, due to a
-          //   misunderstanding of the V8 API, we incorrectly believed that TryCatch mishandled
-          //   termination (or maybe it actually did at the time), so we changed things such that
-          //   we don't catch exceptions so the first handler to throw an exception terminates the
-          //   loop, and the exception flows out of dispatchEvent(). In theory if multiple
-          //   handlers were registered then maybe we ought to be running all of them even if one
-          //   fails. This isn't entirely clear, though: in the case of 'fetch' handlers, in
-          //   fail-closed mode, an exception from any handler should make the whole request fail,
-          //   but then who cares if the remaining handlers run? Meanwhile, in fail-open mode, for
-          //   consistency, we should probably trigger fallback behavior if any handler throws, so
-          //   again it doesn't matter. For other types of handlers, e.g. WebSocket 'message', it's
-          //   not clear why one would ever register multiple handlers.
-          KJ_IF_SOME(r, ret) {
-            auto handle = r.getHandle(js);
-            // Returning true is the same as calling preventDefault() on the event.
-            if (handle->IsTrue()) {
-              event->preventDefault();
-            }
-            if (warnOnHandlerReturn && !handle->IsBoolean()) {
-              warnOnHandlerReturn = false;
-              // To help make debugging easier, let's tailor the warning a bit if it was a promise.
-              if (handle->IsPromise()) {
-                js.logWarning(kj::str(
-                    "An event handler returned a promise that will be ignored. Event handlers "
-                    "should not have a return value and should not be async functions."));
-              } else {
-                js.logWarning(kj::str("An event handler returned a value of type \"",
-                    handle->TypeOf(js.v8Isolate),
-                    "\" that will be ignored. Event handlers should not have a return value."));
-              }
-            }
-          }
-        }
-        KJ_CASE_ONEOF(native, EventHandler::NativeHandlerRef) {
-          native.handler(js, event.addRef());
-        }
-      }
     }
 
     return !event->isPreventDefault();
@@ -585,9 +565,8 @@ jsg::Ref<AbortSignal> AbortSignal::timeout(jsg::Lock& js, double delay) {
   return kj::mv(signal);
 }
 
-jsg::Ref<AbortSignal> AbortSignal::any(jsg::Lock& js,
-    kj::Array<jsg::Ref<AbortSignal>> signals,
-    const jsg::TypeHandler<EventTarget::HandlerFunction>& handler) {
+jsg::Ref<AbortSignal> AbortSignal::any(
+    jsg::Lock& js, kj::Array<jsg::Ref<AbortSignal>> signals) {
   // If nothing was passed in, we can just return a signal that never aborts.
   if (signals.size() == 0) {
     return jsg::alloc<AbortSignal>(kj::none, kj::none, AbortSignal::Flag::NEVER_ABORTS);
@@ -601,39 +580,47 @@ jsg::Ref<AbortSignal> AbortSignal::any(jsg::Lock& js,
     }
   }
 
-  // Otherwise we need to create a new signal and register event handlers on all
-  // of the signals that were passed in.
-  auto signal = jsg::alloc<AbortSignal>();
+  // Per the spec, a signal returned by any() follows the sources of the dependent signals it is
+  // given rather than the dependent signals themselves, and each source only once.
+  kj::Vector<jsg::Ref<AbortSignal>> sources(signals.size());
+  kj::HashSet<const AbortSignal*> seen;
+  auto addSource = [&](jsg::Ref<AbortSignal>& source) {
+    if (source->getNeverAborts() || seen.contains(source.get())) return;
+    seen.insert(source.get());
+    sources.add(source.addRef());
+  };
   for (auto& sig: signals) {
-    // This is a bit of a hack. We want to call addEventListener, but that requires a
-    // jsg::Identified<EventTarget::Handler>, which we can't create directly yet.
-    // So we create a jsg::Function, wrap that in a v8::Function, then convert that into
-    // the jsg::Identified<EventTarget::Handler>, and voila, we have what we need.
-    auto fn = js.wrapSimpleFunction(
-        js.v8Context(), [&signal = *signal, &self = *sig](jsg::Lock& js, auto&) {
-      // Note that we are not capturing any strong references here to either signal
-      // or sig. This is because we are capturing a strong reference to the signal
-      // when we add the event below. This ensures that we do not have an unbreakable
-      // circular reference. The returned signal will not have any strong references
-      // to any of the signals that are passed in, but each of the signals passed in
-      // will have a strong reference to the new signal.
-      signal.triggerAbort(js, self.getReason(js));
-    });
-    jsg::Identified<EventTarget::Handler> identified = {.identity = {js.v8Isolate, fn},
-      .unwrapped = JSG_REQUIRE_NONNULL(handler.tryUnwrap(js, fn.As<v8::Value>()), TypeError,
-          "Unable to create AbortSignal.any handler")};
+    if (sig->isDependent) {
+      for (auto& source: sig->sourceSignals) {
+        addSource(source);
+      }
+    } else {
+      addSource(sig);
+    }
+  }
 
-    sig->addEventListener(js, kj::str("abort"), kj::mv(identified),
-        AddEventListenerOptions{// Once the abort is triggered, this handler should remove itself.
-          .once = true,
-          // When the signal is triggered, we'll use it to cancel the other registered signals.
-          .signal = signal.addRef()});
+  auto signal = jsg::alloc<AbortSignal>();
+  signal->isDependent = true;
+
+  auto handlers = kj::heapArrayBuilder<kj::Own<void>>(sources.size());
+  for (auto& source: sources) {
+    // The handler only refers to `signal`, which owns the handler: if `signal` is destroyed first,
+    // the handler is detached from the source along with it.
+    handlers.add(source->newNativeHandler(js, kj::str("abort"),
+        [&signal = *signal, &source = *source](jsg::Lock& js, jsg::Ref<Event>) {
+      signal.triggerAbort(js, source.getReason(js));
+    }, true));
   }
+  signal->sourceSignals = sources.releaseAsArray();
+  signal->sourceHandlers = handlers.finish();
   return signal;
 }
 
 void AbortSignal::visitForGc(jsg::GcVisitor& visitor) {
   visitor.visit(reason, onAbortHandler);
+  for (auto& source: sourceSignals) {
+    visitor.visit(source);
+  }
 }
 
 RefcountedCanceler& AbortSignal::getCanceler() {
@@ -661,6 +648,10 @@ void AbortSignal::triggerAbort(
   }
   canceler->cancel(kj::cp(exception));
 
+  // Nothing else can trigger this signal now, so stop following the rest of its sources. This
+  // signal's handler on the source that triggered it has already detached itself.
+  sourceHandlers = nullptr;
+
   // This is questionable only because it goes against the spec but it does help prevent
   // memory leaks. Once the abort signal has been triggered, there's really nothing else
   // the AbortSignal can be used for and no other events make sense. The user code could
@@ -278,6 +278,11 @@ class EventTarget: public jsg::Object {
   bool dispatchEventImpl(jsg::Lock& js, jsg::Ref<Event> event);
 
   inline void removeAllHandlers() {
+    for (auto& entry: typeMap) {
+      for (auto& handler: entry.value.handlers) {
+        handler->removed = true;
+      }
+    }
     typeMap.clear();
   }
 
@@ -401,7 +406,9 @@ class EventTarget: public jsg::Object {
   void addNativeListener(jsg::Lock& js, NativeHandler& handler);
   bool removeNativeListener(NativeHandler& handler);
 
-  struct EventHandler {
+  // Refcounted so that a dispatch in progress can keep the handlers it is about to call alive
+  // while earlier handlers remove them from the set.
+  struct EventHandler: public kj::Refcounted {
     struct JavaScriptHandler {
       jsg::HashableV8Ref<v8::Object> identity;
       HandlerFunction callback;
@@ -443,6 +450,10 @@ class EventTarget: public jsg::Object {
     // When once is true, the handler will be removed after it is invoked one time.
     bool once = false;
 
+    // Set when the handler is removed from its EventHandlerSet, so that a dispatch already in
+    // progress skips it.
+    bool removed = false;
+
     EventHandler(Handler handler, bool once): handler(kj::mv(handler)), once(once) {}
     KJ_DISALLOW_COPY_AND_MOVE(EventHandler);
 
@@ -466,14 +477,43 @@ class EventTarget: public jsg::Object {
     uint hashCode(const EventHandler::Handler& handler) const;
   };
 
+  // The handlers registered for a type at some point in time, in insertion order.
+  struct HandlerSnapshot: public kj::Refcounted {
+    kj::Array<kj::Own<EventHandler>> handlers;
+
+    explicit HandlerSnapshot(kj::Array<kj::Own<EventHandler>> handlers)
+        : handlers(kj::mv(handlers)) {}
+  };
+
   struct EventHandlerSet {
     kj::Table<kj::Own<EventHandler>,
         kj::HashIndex<EventHandlerHashCallbacks>,
         kj::InsertionOrderIndex>
         handlers;
 
+    // A snapshot of `handlers` shared by every dispatch until the set next changes, so that
+    // dispatching an event doesn't copy the set each time. A dispatch holds its own reference,
+    // which is what lets handlers add and remove listeners while it runs.
+    kj::Maybe<kj::Own<HandlerSnapshot>> snapshot;
+
     EventHandlerSet(): handlers(EventHandlerHashCallbacks(), {}) {}
 
+    void add(kj::Own<EventHandler> handler);
+
+    // Removes the handler matching `key`, if any. Returns true if one was removed.
+    template <typename Key>
+    bool erase(const Key& key) {
+      KJ_IF_SOME(row, handlers.find(key)) {
+        row->removed = true;
+        handlers.erase(row);
+        snapshot = kj::none;
+        return true;
+      }
+      return false;
+    }
+
+    kj::Own<HandlerSnapshot> getSnapshot();
+
     kj::StringPtr jsgGetMemoryName() const {
       return "EventHandlerSet"_kjc;
     }
@@ -540,9 +580,10 @@ class AbortSignal final: public EventTarget {
   void triggerAbort(
       jsg::Lock& js, jsg::Optional<kj::OneOf<kj::Exception, jsg::JsValue>> maybeReason);
 
-  static jsg::Ref<AbortSignal> any(jsg::Lock& js,
-      kj::Array<jsg::Ref<AbortSignal>> signals,
-      const jsg::TypeHandler<EventTarget::HandlerFunction>& handler);
+  // Returns an AbortSignal that is triggered when any of the given signals is. The returned
+  // signal follows the given signals through native handlers that it owns, so the given signals
+  // never hold a reference to it: once it is garbage collected, it stops following them.
+  static jsg::Ref<AbortSignal> any(jsg::Lock& js, kj::Array<jsg::Ref<AbortSignal>> signals);
 
   // While AbortSignal extends EventTarget, and our EventTarget implementation will
   // automatically support onabort being set as an own property, the spec defines
@@ -602,6 +643,17 @@ class AbortSignal final: public EventTarget {
   kj::Maybe<jsg::JsRef<jsg::JsValue>> reason;
   kj::Maybe<jsg::JsRef<jsg::JsValue>> onAbortHandler;
 
+  // For a signal returned by any(), the signals it follows. These are never themselves signals
+  // returned by any(), since any() follows the sources of those instead, so a composed signal is
+  // always one hop away from the signals that can trigger it.
+  kj::Array<jsg::Ref<AbortSignal>> sourceSignals;
+
+  // The "abort" handlers registered on each of `sourceSignals`. Declared after `sourceSignals` so
+  // that they detach before the sources are released.
+  kj::Array<kj::Own<void>> sourceHandlers;
+
+  bool isDependent = false;
+
   void visitForGc(jsg::GcVisitor& visitor);
 
   friend class AbortController;
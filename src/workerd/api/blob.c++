@@ -17,7 +17,8 @@ namespace {
 kj::Array<byte> concat(jsg::Lock& js, jsg::Optional<Blob::Bits> maybeBits) {
   // TODO(perf): Make it so that a Blob can keep references to the input data rather than copy it.
   //   Note that we can't keep references to ArrayBuffers since they are mutable, but we can
-  //   reference other Blobs in the input.
+  //   reference other Blobs in the input. Currently we only avoid the copy when the input is a
+  //   single contiguous range of one Blob; see Blob::tryShareParts().
 
   auto bits = kj::mv(maybeBits).orDefault(nullptr);
 
@@ -166,9 +167,58 @@ jsg::Ref<Blob> Blob::constructor(
     }
   }
 
+  // Blobs are immutable, so a Blob composed of (contiguous parts of) another Blob can just
+  // reference it. This is common when re-wrapping a Blob to change its type, or when
+  // reassembling slices.
+  KJ_IF_SOME(shared, tryShareParts(bits)) {
+    return jsg::alloc<Blob>(kj::mv(shared.root), shared.data, kj::mv(type));
+  }
+
   return jsg::alloc<Blob>(js, concat(js, kj::mv(bits)), kj::mv(type));
 }
 
+kj::Maybe<Blob::SharedParts> Blob::tryShareParts(jsg::Optional<Bits>& maybeBits) {
+  auto& bits = KJ_UNWRAP_OR(maybeBits, return kj::none);
+
+  kj::Maybe<SharedParts> result;
+  for (auto& part: bits) {
+    KJ_SWITCH_ONEOF(part) {
+      KJ_CASE_ONEOF(bytes, kj::Array<const byte>) {
+        if (bytes.size() > 0) return kj::none;
+      }
+      KJ_CASE_ONEOF(text, kj::String) {
+        if (text.size() > 0) return kj::none;
+      }
+      KJ_CASE_ONEOF(blob, jsg::Ref<Blob>) {
+        if (blob->data.size() == 0) continue;
+
+        // Find the Blob that actually owns the bytes. Slices reference their parent, which may
+        // itself be a slice.
+        auto root = blob.addRef();
+        for (;;) {
+          KJ_IF_SOME(parent, root->ownData.tryGet<jsg::Ref<Blob>>()) {
+            auto next = parent.addRef();
+            root = kj::mv(next);
+          } else {
+            break;
+          }
+        }
+
+        KJ_IF_SOME(r, result) {
+          // The previous parts' range can only be extended if this part continues it within the
+          // same owner. (Separate allocations could happen to be adjacent in memory.)
+          if (r.root.get() != root.get() || blob->data.begin() != r.data.end()) return kj::none;
+          r.data = kj::arrayPtr(r.data.begin(), blob->data.end());
+        } else {
+          result = SharedParts{.root = kj::mv(root), .data = blob->data};
+        }
+      }
+    }
+  }
+
+  return result;
+}
+
 kj::ArrayPtr<const byte> Blob::getData() const {
   FeatureObserver::maybeRecordUse(FeatureObserver::Feature::BLOB_GET_DATA);
   return data;
@@ -327,6 +377,11 @@ jsg::Ref<File> File::constructor(
     lastModified = dateNow();
   }
 
+  KJ_IF_SOME(shared, Blob::tryShareParts(bits)) {
+    return jsg::alloc<File>(
+        kj::mv(shared.root), shared.data, kj::mv(name), kj::mv(type), lastModified);
+  }
+
   return jsg::alloc<File>(js, concat(js, kj::mv(bits)), kj::mv(name), kj::mv(type), lastModified);
 }
 
@@ -110,6 +110,15 @@ class Blob: public jsg::Object {
     }
   }
 
+  // If every non-empty part in `bits` is a Blob, and together they form one contiguous range of
+  // the same underlying Blob (e.g. the Blob itself, or adjacent slices of it), returns that
+  // underlying Blob and the range, so that the new Blob can reference it instead of copying.
+  struct SharedParts {
+    jsg::Ref<Blob> root;
+    kj::ArrayPtr<const byte> data;
+  };
+  static kj::Maybe<SharedParts> tryShareParts(jsg::Optional<Bits>& maybeBits);
+
   class BlobInputStream;
   friend class File;
 };
@@ -43,5 +43,47 @@ KJ_TEST("Test that CfProperty::deepClone returns editable object") {
   KJ_EXPECT(result.statusCode == 200);
 }
 
+KJ_TEST("CfProperty materializes a cf blob just as JSON.parse() would") {
+  TestFixture fixture;
+  fixture.runInIoContext([&](const TestFixture::Environment& env) {
+    auto& js = env.js;
+    auto json = R"({
+      "colo": "SFO", "asn": 13335, "latitude": "37.7", "isEUCountry": false, "region": null,
+      "city": "San \"Francisco\"", "botManagement": {"score": 1},
+      "tlsClientAuth": {"certPresented": "0"}, "list": [1, {"a": [2]}]
+    })"_kj;
+
+    CfProperty cf(json);
+    auto object = KJ_ASSERT_NONNULL(cf.get(js));
+    KJ_EXPECT(jsg::JsValue(object).toJson(js) == jsg::JsValue::fromJson(js, json).toJson(js));
+    KJ_EXPECT(object.get(js, "colo"_kj).toString(js) == "SFO");
+    KJ_EXPECT(object.get(js, "missing"_kj).isUndefined());
+
+    // Fields materialized lazily are frozen too.
+    object.set(js, "colo"_kj, js.str("LHR"_kj));
+    object.set(js, "foo"_kj, js.num(1));
+    auto tls = KJ_ASSERT_NONNULL(object.get(js, "tlsClientAuth"_kj).tryCast<jsg::JsObject>());
+    tls.set(js, "certPresented"_kj, js.str("1"_kj));
+    KJ_EXPECT(object.get(js, "colo"_kj).toString(js) == "SFO");
+    KJ_EXPECT(object.get(js, "foo"_kj).isUndefined());
+    KJ_EXPECT(tls.get(js, "certPresented"_kj).toString(js) == "0");
+  });
+}
+
+KJ_TEST("CfProperty falls back to JSON.parse() for blobs it can't scan") {
+  TestFixture fixture;
+  fixture.runInIoContext([&](const TestFixture::Environment& env) {
+    auto& js = env.js;
+
+    CfProperty duplicated(R"({"colo": "SFO", "colo": "LHR"})"_kj);
+    auto object = KJ_ASSERT_NONNULL(duplicated.get(js));
+    KJ_EXPECT(object.get(js, "colo"_kj).toString(js) == "LHR");
+
+    CfProperty escapedKey(R"({"c\u006flo": "SFO"})"_kj);
+    object = KJ_ASSERT_NONNULL(escapedKey.get(js));
+    KJ_EXPECT(object.get(js, "colo"_kj).toString(js) == "SFO");
+  });
+}
+
 }  // namespace
 }  // namespace workerd::api
@@ -6,6 +6,8 @@
 
 #include <workerd/io/features.h>
 
+#include <cstring>
+
 namespace workerd::api {
 
 static constexpr kj::StringPtr kDefaultBotManagementValue = R"DATA({
@@ -17,28 +19,263 @@ static constexpr kj::StringPtr kDefaultBotManagementValue = R"DATA({
   "score": 99
 })DATA"_kjc;
 
+static constexpr kj::StringPtr kBotManagementName = "botManagement"_kjc;
+
+// Returns the default botManagement value, frozen.
+// For performance reasons, we only want to construct the default values
+// once per isolate so we cache the constructed value using an internal
+// private field on the global scope. Whenever we need to use it again we
+// pull the exact same value.
+static jsg::JsValue getDefaultBotManagement(jsg::Lock& js) {
+  auto bm = js.global().getPrivate(js, kBotManagementName);
+  if (bm.isUndefined()) {
+    bm = jsg::JsValue::fromJson(js, kDefaultBotManagementValue);
+    KJ_DASSERT(bm.isObject());
+    jsg::recursivelyFreeze(js.v8Context(), bm);
+    js.global().setPrivate(js, kBotManagementName, bm);
+  }
+  return bm;
+}
+
 // When the cfBotManagementNoOp compatibility flag is set, we'll check the
 // request cf blob to see if it contains a botManagement field. If it does
 // *not* we will add it using the following default fields.
 // Note that if the botManagement team changes any of the fields they provide,
 // this default value may need to be changed also.
 static void handleDefaultBotManagement(jsg::Lock& js, jsg::JsObject handle) {
-  auto name = "botManagement"_kjc;
-  if (!handle.has(js, name)) {
-    // For performance reasons, we only want to construct the default values
-    // once per isolate so we cache the constructed value using an internal
-    // private field on the global scope. Whenever we need to use it again we
-    // pull the exact same value.
-    auto bm = js.global().getPrivate(js, name);
-    if (bm.isUndefined()) {
-      bm = jsg::JsValue::fromJson(js, kDefaultBotManagementValue);
-      KJ_DASSERT(bm.isObject());
-      js.global().setPrivate(js, name, bm);
+  if (!handle.has(js, kBotManagementName)) {
+    handle.set(js, kBotManagementName, getDefaultBotManagement(js));
+  }
+}
+
+namespace {
+
+// A top-level field of a cf blob, as found by scanCfBlob().
+struct CfBlobField {
+  enum class Kind : uint8_t {
+    // A string without escapes. `text` is its contents, without the quotes.
+    STRING,
+    NUMBER,
+    TRUE,
+    FALSE,
+    NULL_,
+    // An object, an array, or a string with escapes. `text` is its JSON.
+    JSON,
+  };
+
+  // The key, which never has escapes.
+  kj::ArrayPtr<const char> key;
+  kj::ArrayPtr<const char> text;
+  Kind kind;
+  double number = 0;
+};
+
+// Scans the top level of a cf blob, without parsing what's nested in it. Returns none if the blob
+// is anything other than a plain JSON object of uniquely-named fields, or if it's invalid in a
+// way the scan notices; the caller then falls back to JSON.parse(), which reports errors as usual.
+class CfBlobScanner {
+ public:
+  explicit CfBlobScanner(kj::ArrayPtr<const char> json): pos(json.begin()), end(json.end()) {}
+
+  kj::Maybe<kj::Vector<CfBlobField>> scan() {
+    kj::Vector<CfBlobField> fields;
+    skipSpace();
+    if (!consume('{')) return kj::none;
+    skipSpace();
+    if (!consume('}')) {
+      for (;;) {
+        CfBlobField field;
+        if (!consume('"')) return kj::none;
+        auto keyStart = pos;
+        bool escaped = false;
+        if (!skipString(escaped) || escaped) return kj::none;
+        field.key = kj::arrayPtr(keyStart, pos - 1);
+        for (auto& other: fields) {
+          if (other.key == field.key) return kj::none;
+        }
+
+        skipSpace();
+        if (!consume(':')) return kj::none;
+        skipSpace();
+        if (!scanValue(field)) return kj::none;
+        fields.add(kj::mv(field));
+
+        skipSpace();
+        if (consume(',')) {
+          skipSpace();
+          continue;
+        }
+        if (consume('}')) break;
+        return kj::none;
+      }
     }
-    handle.set(js, name, bm);
+    skipSpace();
+    if (pos != end) return kj::none;
+    return kj::mv(fields);
   }
+
+ private:
+  const char* pos;
+  const char* end;
+
+  void skipSpace() {
+    while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\n' || *pos == '\r')) ++pos;
+  }
+
+  bool consume(char c) {
+    if (pos < end && *pos == c) {
+      ++pos;
+      return true;
+    }
+    return false;
+  }
+
+  bool consume(kj::StringPtr literal) {
+    if (size_t(end - pos) >= literal.size() && memcmp(pos, literal.begin(), literal.size()) == 0) {
+      pos += literal.size();
+      return true;
+    }
+    return false;
+  }
+
+  // Skips to just past the closing quote of a string whose opening quote has been consumed.
+  bool skipString(bool& escaped) {
+    while (pos < end) {
+      char c = *pos++;
+      if (c == '"') return true;
+      if (c == '\\') {
+        escaped = true;
+        if (pos == end) return false;
+        ++pos;
+      } else if (static_cast<unsigned char>(c) < 0x20) {
+        return false;
+      }
+    }
+    return false;
+  }
+
+  // Skips an object or array whose opening bracket has been consumed. Its contents are only
+  // checked for balanced brackets; JSON.parse() validates them when they're materialized.
+  bool skipNested() {
+    uint depth = 1;
+    while (pos < end) {
+      char c = *pos++;
+      if (c == '"') {
+        bool escaped = false;
+        if (!skipString(escaped)) return false;
+      } else if (c == '{' || c == '[') {
+        ++depth;
+      } else if (c == '}' || c == ']') {
+        if (--depth == 0) return true;
+      }
+    }
+    return false;
+  }
+
+  bool scanValue(CfBlobField& field) {
+    auto start = pos;
+    using Kind = CfBlobField::Kind;
+    if (consume('"')) {
+      bool escaped = false;
+      if (!skipString(escaped)) return false;
+      if (escaped) {
+        field.kind = Kind::JSON;
+        field.text = kj::arrayPtr(start, pos);
+      } else {
+        field.kind = Kind::STRING;
+        field.text = kj::arrayPtr(start + 1, pos - 1);
+      }
+    } else if (consume('{') || consume('[')) {
+      if (!skipNested()) return false;
+      field.kind = Kind::JSON;
+      field.text = kj::arrayPtr(start, pos);
+    } else if (consume("true"_kj)) {
+      field.kind = Kind::TRUE;
+    } else if (consume("false"_kj)) {
+      field.kind = Kind::FALSE;
+    } else if (consume("null"_kj)) {
+      field.kind = Kind::NULL_;
+    } else if (pos < end && (*pos == '-' || (*pos >= '0' && *pos <= '9'))) {
+      while (pos < end &&
+          ((*pos >= '0' && *pos <= '9') || *pos == '-' || *pos == '+' || *pos == '.' ||
+              *pos == 'e' || *pos == 'E')) {
+        ++pos;
+      }
+      field.kind = Kind::NUMBER;
+      field.text = kj::arrayPtr(start, pos);
+      field.number = KJ_UNWRAP_OR(kj::str(field.text).tryParseAs<double>(), return false);
+    } else {
+      return false;
+    }
+    return true;
+  }
+};
+
+// Getter of a lazily-materialized field of a cf object. The property's data is the field's JSON.
+void getLazyCfField(v8::Local<v8::Name>, const v8::PropertyCallbackInfo<v8::Value>& info) {
+  jsg::liftKj(info, [&]() -> v8::Local<v8::Value> {
+    auto& js = jsg::Lock::from(info.GetIsolate());
+    auto value = jsg::JsValue::fromJson(js, jsg::JsValue(info.Data()));
+    jsg::recursivelyFreeze(js.v8Context(), value);
+    return value;
+  });
 }
 
+// Builds the cf object from the scanned fields of its blob. Scalar fields are set directly, while
+// objects and arrays -- which make up most of a typical blob -- are lazy data properties, parsed
+// the first time they're read. A worker that only reads `cf.country` or `cf.colo` thus never pays
+// for parsing the rest. Every property is read-only and non-configurable, and the object is
+// sealed, so that it's frozen just as the eagerly-parsed object would be.
+jsg::JsObject materializeCfBlob(
+    jsg::Lock& js, kj::ArrayPtr<const CfBlobField> fields, bool addDefaultBotManagement) {
+  auto isolate = js.v8Isolate;
+  auto context = js.v8Context();
+  auto object = js.obj();
+  v8::Local<v8::Object> handle = object;
+  auto attributes = static_cast<v8::PropertyAttribute>(v8::ReadOnly | v8::DontDelete);
+
+  bool hasBotManagement = false;
+  for (auto& field: fields) {
+    // Keys repeat from one request to the next, so they're interned.
+    auto key = jsg::check(v8::String::NewFromUtf8(
+        isolate, field.key.begin(), v8::NewStringType::kInternalized, field.key.size()));
+    hasBotManagement = hasBotManagement || field.key == kBotManagementName.asArray();
+
+    jsg::JsValue value = js.undefined();
+    switch (field.kind) {
+      case CfBlobField::Kind::STRING:
+        value = js.str(field.text);
+        break;
+      case CfBlobField::Kind::NUMBER:
+        value = js.num(field.number);
+        break;
+      case CfBlobField::Kind::TRUE:
+        value = js.boolean(true);
+        break;
+      case CfBlobField::Kind::FALSE:
+        value = js.boolean(false);
+        break;
+      case CfBlobField::Kind::NULL_:
+        value = js.null();
+        break;
+      case CfBlobField::Kind::JSON:
+        jsg::check(handle->SetLazyDataProperty(
+            context, key, &getLazyCfField, js.str(field.text), attributes));
+        continue;
+    }
+    jsg::check(handle->DefineOwnProperty(context, key, value, attributes));
+  }
+
+  if (addDefaultBotManagement && !hasBotManagement) {
+    object.setReadOnly(js, kBotManagementName, getDefaultBotManagement(js));
+  }
+
+  object.seal(js);
+  return object;
+}
+
+}  // namespace
+
 CfProperty::CfProperty(kj::Maybe<kj::StringPtr> unparsed) {
   KJ_IF_SOME(str, unparsed) {
     value = kj::str(str);
@@ -66,14 +303,22 @@ jsg::Optional<jsg::JsRef<jsg::JsObject>> CfProperty::getRef(jsg::Lock& js) {
         return parsed.addRef(js);
       }
       KJ_CASE_ONEOF(unparsed, kj::String) {
-        auto parsed = jsg::JsValue::fromJson(js, unparsed);
-        auto object = KJ_ASSERT_NONNULL(parsed.tryCast<jsg::JsObject>());
+        bool addDefaultBotManagement = !FeatureFlags::get(js).getNoCfBotManagementDefault();
+        auto object = [&]() -> jsg::JsObject {
+          KJ_IF_SOME(fields, CfBlobScanner(unparsed).scan()) {
+            return materializeCfBlob(js, fields, addDefaultBotManagement);
+          }
 
-        if (!FeatureFlags::get(js).getNoCfBotManagementDefault()) {
-          handleDefaultBotManagement(js, object);
-        }
+          auto parsed = jsg::JsValue::fromJson(js, unparsed);
+          auto object = KJ_ASSERT_NONNULL(parsed.tryCast<jsg::JsObject>());
+
+          if (addDefaultBotManagement) {
+            handleDefaultBotManagement(js, object);
+          }
 
-        object.recursivelyFreeze(js);
+          object.recursivelyFreeze(js);
+          return object;
+        }();
 
         // replace unparsed string with a parsed v8 object
         this->value = object.addRef(js);
@@ -101,6 +101,128 @@ int decryptFinalHelper(kj::StringPtr algorithm,
       inputLength, ", output length expected to be ", outputLength, " for ", algorithm);
 }
 
+// The magic number below came from here:
+// https://w3c.github.io/webcrypto/Overview.html#aes-gcm-operations
+constexpr uint64_t AES_GCM_MAX_PLAINTEXT_SIZE = (UINT64_C(1) << 39) - 256;
+
+// Streaming AES-GCM. Encryption emits ciphertext as it goes and appends the tag on finish(), just
+// like AesGcmKey::encrypt(). Decryption cannot know where the ciphertext ends and the tag begins
+// until the input does, so it always holds back the trailing tag-sized run of bytes.
+//
+// Note that decrypted plaintext is released before the tag has been checked. If authentication
+// fails, finish() throws and the stream errors, but the reader will already have seen the
+// plaintext preceding the tag. Callers that must not act on unauthenticated data should use
+// subtle.decrypt() instead.
+class AesGcmCipherStream final: public CryptoKey::Impl::CipherStream {
+ public:
+  AesGcmCipherStream(kj::String algorithmName,
+      kj::ArrayPtr<const kj::byte> keyData,
+      kj::ArrayPtr<const kj::byte> iv,
+      kj::ArrayPtr<const kj::byte> additionalData,
+      int tagLength,
+      bool encrypt)
+      : algorithmName(kj::mv(algorithmName)),
+        tagByteSize(tagLength / 8),
+        encrypt(encrypt) {
+    EVP_CIPHER_CTX_init(&cipherCtx);
+
+    auto type = lookupAesGcmType(keyData.size() * 8);
+    OSSLCALL(EVP_CipherInit_ex(&cipherCtx, type, nullptr, nullptr, nullptr, encrypt));
+    OSSLCALL(EVP_CIPHER_CTX_ctrl(&cipherCtx, EVP_CTRL_GCM_SET_IVLEN, iv.size(), nullptr));
+    OSSLCALL(EVP_CipherInit_ex(&cipherCtx, nullptr, nullptr, keyData.begin(), iv.begin(), -1));
+
+    if (additionalData.size() > 0) {
+      int dummy;
+      OSSLCALL(EVP_CipherUpdate(
+          &cipherCtx, nullptr, &dummy, additionalData.begin(), additionalData.size()));
+    }
+  }
+  ~AesGcmCipherStream() noexcept(false) {
+    EVP_CIPHER_CTX_cleanup(&cipherCtx);
+  }
+  KJ_DISALLOW_COPY_AND_MOVE(AesGcmCipherStream);
+
+  kj::Array<kj::byte> update(kj::ArrayPtr<const kj::byte> input) override {
+    inputSize += input.size();
+
+    if (encrypt) {
+      JSG_REQUIRE(inputSize <= AES_GCM_MAX_PLAINTEXT_SIZE, DOMOperationError,
+          "AES-GCM can only encrypt up to 2^39 - 256 bytes of plaintext at a time, but requested ",
+          inputSize, " bytes.");
+      auto output = kj::heapArray<kj::byte>(input.size());
+      process(input, output);
+      return output;
+    }
+
+    // Everything but the last `tagByteSize` bytes seen so far is ciphertext and can be released.
+    auto pendingSize = heldSize + input.size();
+    if (pendingSize <= tagByteSize) {
+      memcpy(held + heldSize, input.begin(), input.size());
+      heldSize = pendingSize;
+      return nullptr;
+    }
+
+    auto output = kj::heapArray<kj::byte>(pendingSize - tagByteSize);
+    auto fromHeld = kj::min(heldSize, output.size());
+    process(kj::arrayPtr(held, fromHeld), output.first(fromHeld));
+    auto fromInput = output.size() - fromHeld;
+    process(input.first(fromInput), output.slice(fromHeld));
+
+    memmove(held, held + fromHeld, heldSize - fromHeld);
+    heldSize -= fromHeld;
+    auto rest = input.slice(fromInput);
+    memcpy(held + heldSize, rest.begin(), rest.size());
+    heldSize += rest.size();
+    KJ_ASSERT(heldSize == tagByteSize);
+    return output;
+  }
+
+  kj::Array<kj::byte> finish() override {
+    if (encrypt) {
+      kj::byte scratch[16];
+      int finalSize = 0;
+      OSSLCALL(EVP_EncryptFinal_ex(&cipherCtx, scratch, &finalSize));
+      KJ_ASSERT(finalSize == 0, "EVP_EncryptFinal_ex should not output any data");
+
+      auto tag = kj::heapArray<kj::byte>(tagByteSize);
+      OSSLCALL(EVP_CIPHER_CTX_ctrl(&cipherCtx, EVP_CTRL_GCM_GET_TAG, tag.size(), tag.begin()));
+      return tag;
+    }
+
+    JSG_REQUIRE(heldSize == tagByteSize, DOMOperationError, "Ciphertext length of ",
+        inputSize * 8,
+        " bits must be greater than or equal to "
+        "the size of the AES-GCM tag length of ",
+        tagByteSize * 8, " bits.");
+
+    OSSLCALL(EVP_CIPHER_CTX_ctrl(&cipherCtx, EVP_CTRL_GCM_SET_TAG, tagByteSize, held));
+    kj::byte scratch[16];
+    auto plainSize = inputSize - tagByteSize;
+    auto finalSize = decryptFinalHelper(algorithmName, plainSize, plainSize, &cipherCtx, scratch);
+    KJ_ASSERT(finalSize == 0);
+    return nullptr;
+  }
+
+ private:
+  kj::String algorithmName;
+  size_t tagByteSize;
+  bool encrypt;
+  EVP_CIPHER_CTX cipherCtx;
+  uint64_t inputSize = 0;
+
+  // Trailing bytes of the ciphertext that may turn out to be the tag.
+  kj::byte held[16];
+  size_t heldSize = 0;
+
+  void process(kj::ArrayPtr<const kj::byte> input, kj::ArrayPtr<kj::byte> output) {
+    if (input.size() == 0) return;
+    int outputSize = 0;
+    OSSLCALL(
+        EVP_CipherUpdate(&cipherCtx, output.begin(), &outputSize, input.begin(), input.size()));
+    KJ_ASSERT(outputSize == input.size(), "EVP_CipherUpdate should process all input at once");
+  }
+};
+
 // NOTE: The OpenSSL calls to implement AES-GCM and AES-CBC are quite similar. If you update one
 //   algorithm's encrypt() or decrypt() implementation, it'd be worth reviewing the other
 //   algorithm's implementation as well.
@@ -218,9 +340,7 @@ class AesGcmKey final: public AesKeyBase {
 
     auto additionalData = algorithm.additionalData.orDefault(kj::Array<kj::byte>()).asPtr();
 
-    // The magic number below came from here:
-    // https://w3c.github.io/webcrypto/Overview.html#aes-gcm-operations
-    JSG_REQUIRE(plainText.size() <= ((UINT64_C(1) << 39) - 256), DOMOperationError,
+    JSG_REQUIRE(plainText.size() <= AES_GCM_MAX_PLAINTEXT_SIZE, DOMOperationError,
         "AES-GCM can only encrypt up to 2^39 - 256 bytes of plaintext at a time, but requested ",
         plainText.size(), " bytes.");
 
@@ -337,6 +457,21 @@ class AesGcmKey final: public AesKeyBase {
 
     return jsg::BufferSource(js, kj::mv(plainText));
   }
+
+  kj::Own<CipherStream> newCipherStream(
+      SubtleCrypto::EncryptAlgorithm&& algorithm, bool encrypt) const override {
+    kj::ArrayPtr<kj::byte> iv =
+        JSG_REQUIRE_NONNULL(algorithm.iv, TypeError, "Missing field \"iv\" in \"algorithm\".");
+    JSG_REQUIRE(iv.size() != 0, DOMOperationError, "AES-GCM IV must not be empty.");
+
+    int tagLength = algorithm.tagLength.orDefault(128);
+    validateAesGcmTagLength(tagLength);
+
+    auto additionalData = algorithm.additionalData.orDefault(kj::Array<kj::byte>()).asPtr();
+
+    return kj::heap<AesGcmCipherStream>(
+        kj::str(getAlgorithmName()), keyData.asPtr(), iv, additionalData, tagLength, encrypt);
+  }
 };
 
 class AesCbcKey final: public AesKeyBase {
@@ -397,32 +532,131 @@ class AesCbcKey final: public AesKeyBase {
     JSG_REQUIRE(iv.size() == 16, DOMOperationError, "AES-CBC IV must be 16 bytes long (provided ",
         iv.size(), ").");
 
-    auto cipherCtx = kj::disposeWith<EVP_CIPHER_CTX_free>(EVP_CIPHER_CTX_new());
-    KJ_ASSERT(cipherCtx.get() != nullptr);
-
     auto type = lookupAesCbcType(keyData.size() * 8);
+    auto blockSize = EVP_CIPHER_block_size(type);
+
+    // Only the final block carries padding, so we decrypt it on its own first to learn the exact
+    // plaintext size. That lets us decrypt everything else straight into a result buffer of the
+    // right size instead of decrypting into scratch space and copying. CBC decryption of a block
+    // only depends on the block before it, which serves as the IV here.
+    kj::ArrayPtr<const kj::byte> lastBlock;
+    kj::ArrayPtr<const kj::byte> lastBlockIv = iv;
+    if (cipherText.size() >= blockSize && cipherText.size() % blockSize == 0) {
+      lastBlock = cipherText.slice(cipherText.size() - blockSize);
+      if (cipherText.size() > blockSize) {
+        lastBlockIv = cipherText.slice(cipherText.size() - 2 * blockSize).first(blockSize);
+      }
+    } else {
+      // Not a whole number of blocks. Feeding the incomplete tail through the same steps makes
+      // EVP_DecryptFinal_ex() reject it exactly as it would the full ciphertext.
+      lastBlock = cipherText.slice(cipherText.size() - cipherText.size() % blockSize);
+    }
+    auto bodySize = cipherText.size() - lastBlock.size();
+
+    auto tailCtx = kj::disposeWith<EVP_CIPHER_CTX_free>(EVP_CIPHER_CTX_new());
+    KJ_ASSERT(tailCtx.get() != nullptr);
+    OSSLCALL(
+        EVP_DecryptInit_ex(tailCtx.get(), type, nullptr, keyData.begin(), lastBlockIv.begin()));
+
+    kj::byte tail[2 * AES_BLOCK_SIZE];
+    int tailSize = 0;
+    OSSLCALL(
+        EVP_DecryptUpdate(tailCtx.get(), tail, &tailSize, lastBlock.begin(), lastBlock.size()));
+    KJ_ASSERT(tailSize == 0, "EVP_DecryptUpdate should hold back the final block");
+    tailSize =
+        decryptFinalHelper(getAlgorithmName(), cipherText.size(), bodySize, tailCtx.get(), tail);
+    KJ_ASSERT(tailSize < blockSize);
+
+    auto plainText = jsg::BackingStore::alloc<v8::ArrayBuffer>(js, bodySize + tailSize);
+
+    if (bodySize > 0) {
+      auto cipherCtx = kj::disposeWith<EVP_CIPHER_CTX_free>(EVP_CIPHER_CTX_new());
+      KJ_ASSERT(cipherCtx.get() != nullptr);
+
+      // Set up the cipher context with the initialization vector. The body contains no padding, so
+      // with padding disabled EVP_DecryptUpdate() emits all of it rather than holding a block back.
+      OSSLCALL(EVP_DecryptInit_ex(cipherCtx.get(), type, nullptr, keyData.begin(), iv.begin()));
+      OSSLCALL(EVP_CIPHER_CTX_set_padding(cipherCtx.get(), 0));
+
+      // Perform the actual decryption.
+      int plainSize = 0;
+      OSSLCALL(EVP_DecryptUpdate(cipherCtx.get(), plainText.asArrayPtr().begin(), &plainSize,
+          cipherText.begin(), bodySize));
+      KJ_ASSERT(plainSize == bodySize);
+    }
 
-    // Set up the cipher context with the initialization vector.
-    OSSLCALL(EVP_DecryptInit_ex(cipherCtx.get(), type, nullptr, keyData.begin(), iv.begin()));
+    plainText.asArrayPtr().slice(bodySize).copyFrom(kj::arrayPtr(tail, tailSize));
+    return jsg::BufferSource(js, kj::mv(plainText));
+  }
+};
 
-    int plainSize = 0;
-    auto blockSize = EVP_CIPHER_CTX_block_size(cipherCtx.get());
+// Converts a count of AES blocks to bytes, saturating for counts no stream could ever reach.
+uint64_t blocksToBytes(const BIGNUM& blocks) {
+  if (BN_num_bits(&blocks) > 64 - 4) return kj::maxValue;
+  return BN_get_word(&blocks) * AES_BLOCK_SIZE;
+}
 
-    auto plainText = kj::heapArray<kj::byte>(cipherText.size() + ((blockSize > 1) ? blockSize : 0));
+// Streaming AES-CTR. As in AesCtrKey::encrypt(), only the rightmost `length` bits of the counter
+// block are incremented and they may wrap around to zero once, but the stream errors rather than
+// reuse a counter value.
+class AesCtrCipherStream final: public CryptoKey::Impl::CipherStream {
+ public:
+  AesCtrCipherStream(const EVP_CIPHER& cipher,
+      kj::ArrayPtr<const kj::byte> keyData,
+      kj::ArrayPtr<const kj::byte> counter,
+      kj::ArrayPtr<const kj::byte> wrappedCounter,
+      uint64_t bytesUntilWrap,
+      uint64_t maxBytes)
+      : bytesUntilWrap(bytesUntilWrap),
+        maxBytes(maxBytes) {
+    EVP_CIPHER_CTX_init(&cipherCtx);
+    EVP_CIPHER_CTX_init(&wrappedCtx);
 
-    // Perform the actual decryption.
-    OSSLCALL(EVP_DecryptUpdate(
-        cipherCtx.get(), plainText.begin(), &plainSize, cipherText.begin(), cipherText.size()));
-    KJ_ASSERT(plainSize + ((blockSize > 1) ? blockSize : 0) <= plainText.size());
+    // For CTR, it really does not matter whether we are encrypting or decrypting, so set enc to 0.
+    OSSLCALL(EVP_CipherInit_ex(&cipherCtx, &cipher, nullptr, keyData.begin(), counter.begin(), 0));
+    OSSLCALL(EVP_CipherInit_ex(
+        &wrappedCtx, &cipher, nullptr, keyData.begin(), wrappedCounter.begin(), 0));
+  }
+  ~AesCtrCipherStream() noexcept(false) {
+    EVP_CIPHER_CTX_cleanup(&cipherCtx);
+    EVP_CIPHER_CTX_cleanup(&wrappedCtx);
+  }
+  KJ_DISALLOW_COPY_AND_MOVE(AesCtrCipherStream);
 
-    plainSize += decryptFinalHelper(getAlgorithmName(), cipherText.size(), plainSize,
-        cipherCtx.get(), plainText.begin() + plainSize);
-    KJ_ASSERT(plainSize <= plainText.size());
+  kj::Array<kj::byte> update(kj::ArrayPtr<const kj::byte> input) override {
+    JSG_REQUIRE(input.size() <= maxBytes - processed, DOMOperationError,
+        "Counter block values will repeat");
 
-    // TODO(perf): Avoid this copy, see comment in the encrypt implementation functions.
-    auto backing = jsg::BackingStore::alloc<v8::ArrayBuffer>(js, plainSize);
-    backing.asArrayPtr().copyFrom(plainText.first(plainSize));
-    return jsg::BufferSource(js, kj::mv(backing));
+    // The output of AES-CTR is the same size as the input.
+    auto output = kj::heapArray<kj::byte>(input.size());
+    uint64_t beforeWrap =
+        kj::min(uint64_t(input.size()), bytesUntilWrap - kj::min(processed, bytesUntilWrap));
+    process(cipherCtx, input.first(beforeWrap), output.first(beforeWrap));
+    process(wrappedCtx, input.slice(beforeWrap), output.slice(beforeWrap));
+    processed += input.size();
+    return output;
+  }
+
+  kj::Array<kj::byte> finish() override {
+    // CTR mode has no padding or tag, so everything was already emitted by update().
+    return nullptr;
+  }
+
+ private:
+  // `cipherCtx` starts from the caller's counter block, `wrappedCtx` from the same block with its
+  // counter bits zeroed. We switch to the latter once the counter wraps.
+  EVP_CIPHER_CTX cipherCtx;
+  EVP_CIPHER_CTX wrappedCtx;
+  uint64_t bytesUntilWrap;
+  uint64_t maxBytes;
+  uint64_t processed = 0;
+
+  static void process(
+      EVP_CIPHER_CTX& ctx, kj::ArrayPtr<const kj::byte> input, kj::ArrayPtr<kj::byte> output) {
+    if (input.size() == 0) return;
+    int outputLength = 0;
+    OSSLCALL(EVP_CipherUpdate(&ctx, output.begin(), &outputLength, input.begin(), input.size()));
+    KJ_ASSERT(outputLength == input.size());
   }
 };
 
@@ -448,6 +682,30 @@ class AesCtrKey final: public AesKeyBase {
     return encryptOrDecrypt(js, kj::mv(algorithm), cipherText);
   }
 
+  kj::Own<CipherStream> newCipherStream(
+      SubtleCrypto::EncryptAlgorithm&& algorithm, bool encrypt) const override {
+    auto counterBitLength = validateCounter(algorithm);
+    auto& counter = KJ_ASSERT_NONNULL(algorithm.counter);
+
+    auto numCounterValues = newBignum();
+    JSG_REQUIRE(BN_lshift(numCounterValues.get(), BN_value_one(), counterBitLength),
+        InternalDOMOperationError, "Error doing ", getAlgorithmName(), " encrypt/decrypt",
+        internalDescribeOpensslErrors());
+
+    auto currentCounter = getCounter(counter.asPtr(), counterBitLength);
+
+    auto numBlocksUntilReset = newBignum();
+    JSG_REQUIRE(BN_sub(numBlocksUntilReset.get(), numCounterValues.get(), currentCounter.get()),
+        InternalDOMOperationError, "Error doing ", getAlgorithmName(), " encrypt/decrypt",
+        internalDescribeOpensslErrors());
+
+    auto wrappedCounter = kj::heapArray<kj::byte>(counter.asPtr());
+    resetCounter(wrappedCounter, counterBitLength);
+
+    return kj::heap<AesCtrCipherStream>(lookupAesType(keyData.size()), keyData.asPtr(), counter,
+        wrappedCounter, blocksToBytes(*numBlocksUntilReset), blocksToBytes(*numCounterValues));
+  }
+
  protected:
   static const EVP_CIPHER& lookupAesType(size_t keyLengthBytes) {
     switch (keyLengthBytes) {
@@ -464,9 +722,9 @@ class AesCtrKey final: public AesKeyBase {
     KJ_FAIL_ASSERT("CryptoKey has invalid data length");
   }
 
-  jsg::BufferSource encryptOrDecrypt(jsg::Lock& js,
-      SubtleCrypto::EncryptAlgorithm&& algorithm,
-      kj::ArrayPtr<const kj::byte> data) const {
+  // Checks the "counter" and "length" members of `algorithm`, returning the counter's length in
+  // bits.
+  static int validateCounter(const SubtleCrypto::EncryptAlgorithm& algorithm) {
     auto& counter = JSG_REQUIRE_NONNULL(
         algorithm.counter, TypeError, "Missing \"counter\" member in \"algorithm\".");
     JSG_REQUIRE(counter.size() == expectedCounterByteSize, DOMOperationError,
@@ -486,6 +744,26 @@ class AesCtrKey final: public AesKeyBase {
     //   * https://heycam.github.io/webidl/#abstract-opdef-converttoint
     JSG_REQUIRE(counterBitLength > 0 && counterBitLength <= 128, DOMOperationError,
         "Invalid counter of ", counterBitLength, " bits length provided.");
+    return counterBitLength;
+  }
+
+  // Zeroes the counter bits of the block, which is where the counter goes once it wraps.
+  static void resetCounter(kj::ArrayPtr<kj::byte> counter, int counterBitLength) {
+    KJ_DASSERT(counterBitLength / 8 <= expectedCounterByteSize);
+
+    auto remainder = counterBitLength % 8;
+    auto idx = expectedCounterByteSize - counterBitLength / 8;
+    counter.slice(idx).first(counterBitLength / 8).fill(0);
+    if (remainder) {
+      counter[idx - 1] &= 0xFF << remainder;
+    }
+  }
+
+  jsg::BufferSource encryptOrDecrypt(jsg::Lock& js,
+      SubtleCrypto::EncryptAlgorithm&& algorithm,
+      kj::ArrayPtr<const kj::byte> data) const {
+    auto counterBitLength = validateCounter(algorithm);
+    auto& counter = KJ_ASSERT_NONNULL(algorithm.counter);
 
     const auto& cipher = lookupAesType(keyData.size());
 
@@ -532,16 +810,7 @@ class AesCtrKey final: public AesKeyBase {
     process(&cipher, data.first(inputSizePart1), counter, result.asArrayPtr());
 
     // Zero the counter bits of the block. Chromium creates a copy but we own our buffer.
-    {
-      KJ_DASSERT(counterBitLength / 8 <= expectedCounterByteSize);
-
-      auto remainder = counterBitLength % 8;
-      auto idx = expectedCounterByteSize - counterBitLength / 8;
-      counter.slice(idx).first(counterBitLength / 8).fill(0);
-      if (remainder) {
-        counter[idx - 1] &= 0xFF << remainder;
-      }
-    }
+    resetCounter(counter, counterBitLength);
 
     process(&cipher, data.slice(inputSizePart1, data.size()), counter,
         result.asArrayPtr().slice(inputSizePart1, result.size()));
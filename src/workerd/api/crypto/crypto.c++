@@ -5,6 +5,7 @@
 #include "crypto.h"
 
 #include "impl.h"
+#include "key-cache.h"
 
 #include <workerd/api/streams/standard.h>
 #include <workerd/api/util.h>
@@ -374,6 +375,46 @@ jsg::Promise<bool> SubtleCrypto::verify(jsg::Lock& js,
   });
 }
 
+jsg::Promise<kj::Array<bool>> SubtleCrypto::verifyBatch(jsg::Lock& js,
+    kj::OneOf<kj::String, SignAlgorithm> algorithmParam,
+    kj::Array<VerifyBatchItem> items) {
+  auto algorithm = interpretAlgorithmParam(kj::mv(algorithmParam));
+
+  auto checkErrorsOnFinish = webCryptoOperationBegin(__func__, algorithm);
+
+  return js.evalNow([&] {
+    for (auto& item: items) {
+      validateOperation(*item.key, algorithm.name, CryptoKeyUsageSet::verify());
+    }
+
+    // Each verification consumes its algorithm, so give every item its own copy.
+    auto copyAlgorithm = [&]() {
+      return SignAlgorithm{
+        .name = kj::str(algorithm.name),
+        .hash = algorithm.hash.map([](auto& hash) -> kj::OneOf<kj::String, HashAlgorithm> {
+          KJ_SWITCH_ONEOF(hash) {
+            KJ_CASE_ONEOF(name, kj::String) {
+              return kj::str(name);
+            }
+            KJ_CASE_ONEOF(hashAlgorithm, HashAlgorithm) {
+              return HashAlgorithm{.name = kj::str(hashAlgorithm.name)};
+            }
+          }
+          KJ_UNREACHABLE;
+        }),
+        .dataLength = algorithm.dataLength,
+        .saltLength = algorithm.saltLength,
+      };
+    };
+
+    auto digestCtx = OSSL_NEW(EVP_MD_CTX);
+    return KJ_MAP(item, items) {
+      return item.key->impl->verifyWithContext(
+          js, copyAlgorithm(), item.signature, item.data, *digestCtx);
+    };
+  });
+}
+
 jsg::Promise<jsg::BufferSource> SubtleCrypto::digest(jsg::Lock& js,
     kj::OneOf<kj::String, HashAlgorithm> algorithmParam,
     kj::Array<const kj::byte> data) {
@@ -452,9 +493,8 @@ jsg::Promise<jsg::Ref<CryptoKey>> SubtleCrypto::deriveKey(jsg::Lock& js,
 
     auto secret = baseKey.impl->deriveBits(js, kj::mv(algorithm), length);
 
-    // TODO(perf): For conformance, importKey() makes a copy of `secret`. In this case we really
-    //   don't need to, but rather we ought to call the appropriate CryptoKey::Impl::import*()
-    //   function directly.
+    // importKeySync() takes ownership of the array it is given, so this is the only copy of the
+    // derived bits. `secret` lives in a V8 backing store that the key can't hold on to.
     auto data = kj::heapArray<kj::byte>(secret);
     return importKeySync(
         js, "raw", kj::mv(data), kj::mv(derivedKeyAlgorithm), extractable, kj::mv(keyUsages));
@@ -578,6 +618,12 @@ jsg::Promise<jsg::Ref<CryptoKey>> SubtleCrypto::importKey(jsg::Lock& js,
   auto checkErrorsOnFinish = webCryptoOperationBegin(__func__, algorithm, format.asPtr());
 
   return js.evalNow([&] {
+    KJ_IF_SOME(key, keyData.tryGet<kj::Array<kj::byte>>()) {
+      // The array aliases the caller's buffer, which the caller is free to modify once we return,
+      // while import implementations such as HMAC's hold on to the array they are given. Callers
+      // of importKeySync() from C++ pass freshly-allocated arrays, so only this path copies.
+      keyData = kj::heapArray(key.asPtr());
+    }
     return importKeySync(js, format, kj::mv(keyData), kj::mv(algorithm), extractable, keyUsages);
   });
 }
@@ -589,12 +635,9 @@ jsg::Ref<CryptoKey> SubtleCrypto::importKeySync(jsg::Lock& js,
     bool extractable,
     kj::ArrayPtr<const kj::String> keyUsages) {
   if (format == "raw" || format == "pkcs8" || format == "spki") {
-    auto& key = JSG_REQUIRE_NONNULL(keyData.tryGet<kj::Array<kj::byte>>(), TypeError,
+    JSG_REQUIRE(keyData.is<kj::Array<kj::byte>>(), TypeError,
         "Import data provided for \"raw\", \"pkcs8\", or \"spki\" import formats must be a buffer "
         "source.");
-
-    // Make a copy of the key import data.
-    keyData = kj::heapArray(key.asPtr());
   } else if (format == "jwk") {
     JSG_REQUIRE(keyData.is<JsonWebKey>(), TypeError,
         "Import data provided for \"jwk\" import format must be a JsonWebKey.");
@@ -618,8 +661,28 @@ jsg::Ref<CryptoKey> SubtleCrypto::importKeySync(jsg::Lock& js,
   //   implementation functions don't necessarily know the name of the algorithm whose key they're
   //   importing (importKeyAesImpl handles AES-CTR, -CBC, and -GCM, for instance), so they should
   //   rely on this value to set the imported CryptoKey's name.
-  auto cryptoKey = jsg::alloc<CryptoKey>(algoImpl.importFunc(
-      js, algoImpl.name, format, kj::mv(keyData), kj::mv(algorithm), extractable, keyUsages));
+  // Public keys are looked up in the isolate's cache first, so that a worker importing the same
+  // JWKS or SPKI key on every request only pays for parsing it once.
+  kj::Maybe<CryptoKeyCache&> maybeCache;
+  kj::Maybe<CryptoKeyCache::Key> cacheKey;
+  KJ_IF_SOME(isolate, Worker::Isolate::tryFrom(js)) {
+    auto& cache = isolate.getCryptoKeyCache();
+    KJ_IF_SOME(key, CryptoKeyCache::keyFor(
+                        format, algoImpl.name, keyData, algorithm, extractable, keyUsages)) {
+      KJ_IF_SOME(impl, cache.find(key)) {
+        return jsg::alloc<CryptoKey>(kj::mv(impl));
+      }
+      maybeCache = cache;
+      cacheKey = kj::mv(key);
+    }
+  }
+
+  auto impl = algoImpl.importFunc(
+      js, algoImpl.name, format, kj::mv(keyData), kj::mv(algorithm), extractable, keyUsages);
+  KJ_IF_SOME(cache, maybeCache) {
+    impl = cache.insert(KJ_ASSERT_NONNULL(kj::mv(cacheKey)), kj::mv(impl));
+  }
+  auto cryptoKey = jsg::alloc<CryptoKey>(kj::mv(impl));
 
   if (cryptoKey->getUsageSet().size() == 0) {
     auto type = cryptoKey->getType();
@@ -756,6 +819,85 @@ kj::Maybe<StreamStates::Errored> DigestStream::close(jsg::Lock& js) {
   KJ_UNREACHABLE;
 }
 
+// Feeds bytes pumped from a native ReadableStreamSource straight into the DigestStream's hash
+// context. It is only used while tryPipeFromNative() holds the stream's writer lock, so nothing
+// else can write to the stream in the meantime. The digest itself is finalized by closing that
+// writer once the pump completes.
+class DigestStream::NativeSink final: public WritableStreamSink {
+ public:
+  explicit NativeSink(DigestStream& stream): stream(stream) {}
+
+  kj::Promise<void> write(kj::ArrayPtr<const kj::byte> buffer) override {
+    stream.writeNative(buffer);
+    return kj::READY_NOW;
+  }
+
+  kj::Promise<void> write(kj::ArrayPtr<const kj::ArrayPtr<const kj::byte>> pieces) override {
+    for (auto piece: pieces) {
+      stream.writeNative(piece);
+    }
+    return kj::READY_NOW;
+  }
+
+  kj::Promise<void> end() override {
+    return kj::READY_NOW;
+  }
+
+  void abort(kj::Exception reason) override {}
+
+ private:
+  DigestStream& stream;
+};
+
+void DigestStream::writeNative(kj::ArrayPtr<const kj::byte> buffer) {
+  // The stream can still be disposed while the pump is running.
+  auto& ready = JSG_REQUIRE_NONNULL(
+      state.tryGet<Ready>(), TypeError, "This DigestStream is no longer writable.");
+  if (buffer.size() == 0) return;
+  auto checkErrorsOnFinish = webCryptoOperationBegin(__func__, ready.algorithm.name);
+  OSSLCALL(EVP_DigestUpdate(ready.context.get(), buffer.begin(), buffer.size()));
+  bytesWritten += buffer.size();
+}
+
+kj::Maybe<jsg::Promise<void>> DigestStream::tryPipeFromNative(
+    jsg::Lock& js, ReadableStream& source, PipeToOptions& options) {
+  // Pipes that need the spec's finer-grained close/abort/cancel handling take the regular path,
+  // as do sources that are JavaScript-backed or already finished.
+  if (options.preventClose.orDefault(false) || options.preventAbort.orDefault(false) ||
+      options.preventCancel.orDefault(false) || options.signal != kj::none ||
+      !IoContext::hasCurrent() || !state.is<Ready>()) {
+    return kj::none;
+  }
+  auto& sourceController = source.getController();
+  if (!sourceController.isInternal() || sourceController.isDisturbed() ||
+      sourceController.isClosedOrErrored() || source.isLocked()) {
+    return kj::none;
+  }
+  auto& controller = getController();
+  if (controller.isClosedOrClosing() || controller.isErrored()) {
+    return kj::none;
+  }
+
+  // Hold the writer lock for the whole pump, just as the regular pipe would.
+  auto writer = getWriter(js);
+  auto pump = source.pumpTo(js, kj::heap<NativeSink>(*this), true)
+                  .then([](DeferredProxy<void> proxy) { return kj::mv(proxy.proxyTask); });
+
+  return IoContext::current().awaitIo(js, kj::mv(pump)).then(js,
+      JSG_VISITABLE_LAMBDA((self = JSG_THIS, writer = writer.addRef()), (self, writer),
+          (jsg::Lock& js) {
+            return writer->close(js).then(js,
+                JSG_VISITABLE_LAMBDA((writer = writer.addRef()), (writer),
+                    (jsg::Lock& js) { writer->releaseLock(js); }));
+          }),
+      JSG_VISITABLE_LAMBDA((self = JSG_THIS, writer = writer.addRef()), (self, writer),
+          (jsg::Lock& js, jsg::Value exception) {
+            writer->abort(js, exception.getHandle(js)).markAsHandled(js);
+            writer->releaseLock(js);
+            return js.rejectedPromise<void>(kj::mv(exception));
+          }));
+}
+
 void DigestStream::abort(jsg::Lock& js, jsg::JsValue reason) {
   // If the state is already closed or errored, then this is a non-op
   KJ_IF_SOME(ready, state.tryGet<Ready>()) {
@@ -826,4 +968,100 @@ jsg::Ref<DigestStream> DigestStream::constructor(jsg::Lock& js, Algorithm algori
   return kj::mv(stream);
 }
 
+// =======================================================================================
+// EncryptionStream & DecryptionStream
+
+namespace {
+
+// The writable side of an EncryptionStream or DecryptionStream. Every chunk written is run
+// through the cipher, and the output is forwarded to the writable end of an identity pipe whose
+// readable end is the stream's readable side.
+class CipherStreamSink final: public WritableStreamSink {
+ public:
+  CipherStreamSink(
+      kj::Own<WritableStreamSink> inner, kj::Own<CryptoKey::Impl::CipherStream> cipher)
+      : inner(kj::mv(inner)),
+        cipher(kj::mv(cipher)) {}
+
+  kj::Promise<void> write(kj::ArrayPtr<const kj::byte> buffer) override {
+    auto output = run([&]() { return cipher->update(buffer); });
+    if (output.size() == 0) return kj::READY_NOW;
+    auto promise = inner->write(output);
+    return promise.attach(kj::mv(output));
+  }
+
+  kj::Promise<void> write(kj::ArrayPtr<const kj::ArrayPtr<const kj::byte>> pieces) override {
+    auto outputs = kj::heapArrayBuilder<kj::Array<kj::byte>>(pieces.size());
+    for (auto piece: pieces) {
+      outputs.add(run([&]() { return cipher->update(piece); }));
+    }
+    auto chunks = outputs.finish();
+    auto ptrs = KJ_MAP(chunk, chunks) -> kj::ArrayPtr<const kj::byte> { return chunk; };
+    auto promise = inner->write(ptrs);
+    return promise.attach(kj::mv(ptrs), kj::mv(chunks));
+  }
+
+  kj::Promise<void> end() override {
+    auto output = run([&]() { return cipher->finish(); });
+    if (output.size() == 0) return inner->end();
+    auto promise = inner->write(output);
+    return promise.attach(kj::mv(output)).then([this]() { return inner->end(); });
+  }
+
+  void abort(kj::Exception reason) override {
+    inner->abort(kj::mv(reason));
+  }
+
+ private:
+  kj::Own<WritableStreamSink> inner;
+  kj::Own<CryptoKey::Impl::CipherStream> cipher;
+
+  // Runs `func` against the cipher. If it throws, the readable side is errored as well, so that a
+  // reader isn't left waiting for output that will never arrive.
+  template <typename Func>
+  kj::Array<kj::byte> run(Func&& func) {
+    kj::Array<kj::byte> output;
+    KJ_IF_SOME(exception, kj::runCatchingExceptions([&]() { output = func(); })) {
+      inner->abort(kj::cp(exception));
+      kj::throwFatalException(kj::mv(exception));
+    }
+    return output;
+  }
+};
+
+template <typename T>
+jsg::Ref<T> newCipherTransform(jsg::Lock& js,
+    kj::OneOf<kj::String, SubtleCrypto::EncryptAlgorithm> algorithmParam,
+    const CryptoKey& key,
+    const CryptoKey::Impl& impl,
+    bool encrypt) {
+  auto algorithm = interpretAlgorithmParam(kj::mv(algorithmParam));
+  auto checkErrorsOnFinish = webCryptoOperationBegin(__func__, algorithm);
+
+  validateOperation(
+      key, algorithm.name, encrypt ? CryptoKeyUsageSet::encrypt() : CryptoKeyUsageSet::decrypt());
+  auto cipher = impl.newCipherStream(kj::mv(algorithm), encrypt);
+
+  auto& ioContext = IoContext::current();
+  auto pipe = newIdentityPipe();
+  return jsg::alloc<T>(jsg::alloc<ReadableStream>(ioContext, kj::mv(pipe.in)),
+      jsg::alloc<WritableStream>(ioContext,
+          kj::heap<CipherStreamSink>(kj::mv(pipe.out), kj::mv(cipher)),
+          ioContext.getMetrics().tryCreateWritableByteStreamObserver()));
+}
+
+}  // namespace
+
+jsg::Ref<EncryptionStream> EncryptionStream::constructor(jsg::Lock& js,
+    kj::OneOf<kj::String, SubtleCrypto::EncryptAlgorithm> algorithm,
+    const CryptoKey& key) {
+  return newCipherTransform<EncryptionStream>(js, kj::mv(algorithm), key, *key.impl, true);
+}
+
+jsg::Ref<DecryptionStream> DecryptionStream::constructor(jsg::Lock& js,
+    kj::OneOf<kj::String, SubtleCrypto::EncryptAlgorithm> algorithm,
+    const CryptoKey& key) {
+  return newCipherTransform<DecryptionStream>(js, kj::mv(algorithm), key, *key.impl, false);
+}
+
 }  // namespace workerd::api
@@ -5,6 +5,7 @@
 #pragma once
 // WebCrypto API
 
+#include <workerd/api/streams/transform.h>
 #include <workerd/api/streams/writable.h>
 #include <workerd/io/features.h>
 #include <workerd/jsg/jsg.h>
@@ -335,6 +336,8 @@ class CryptoKey: public jsg::Object {
   kj::Own<Impl> impl;
 
   friend class SubtleCrypto;
+  friend class EncryptionStream;
+  friend class DecryptionStream;
   friend class EllipticKey;
   friend class EdDsaKey;
   friend class node::CryptoImpl;
@@ -617,7 +620,28 @@ class SubtleCrypto: public jsg::Object {
   // This is a non-standard extension based off Node.js' implementation of crypto.timingSafeEqual.
   bool timingSafeEqual(kj::Array<kj::byte> a, kj::Array<kj::byte> b);
 
-  JSG_RESOURCE_TYPE(SubtleCrypto) {
+  struct VerifyBatchItem {
+    jsg::Ref<CryptoKey> key;
+    kj::Array<const kj::byte> signature;
+    kj::Array<const kj::byte> data;
+
+    JSG_STRUCT(key, signature, data);
+    JSG_STRUCT_TS_OVERRIDE(SubtleCryptoVerifyBatchItem {
+      key: CryptoKey;
+      signature: ArrayBuffer | ArrayBufferView;
+      data: ArrayBuffer | ArrayBufferView;
+    });
+  };
+
+  // Non-standard extension: verifies a batch of signatures made with the same algorithm,
+  // resolving to one boolean per item. Compared to calling verify() for each signature, the whole
+  // batch crosses into native code once, settles a single promise, and reuses one digest context.
+  // Key and algorithm errors reject the whole batch; a malformed signature is just invalid.
+  jsg::Promise<kj::Array<bool>> verifyBatch(jsg::Lock& js,
+      kj::OneOf<kj::String, SignAlgorithm> algorithm,
+      kj::Array<VerifyBatchItem> items);
+
+  JSG_RESOURCE_TYPE(SubtleCrypto, CompatibilityFlags::Reader flags) {
     JSG_METHOD(encrypt);
     JSG_METHOD(decrypt);
     JSG_METHOD(sign);
@@ -631,6 +655,9 @@ class SubtleCrypto: public jsg::Object {
     JSG_METHOD(wrapKey);
     JSG_METHOD(unwrapKey);
     JSG_METHOD(timingSafeEqual);
+    if (flags.getCryptoVerifyBatch()) {
+      JSG_METHOD(verifyBatch);
+    }
 
     JSG_TS_OVERRIDE({
       wrapKey(format: string,
@@ -686,6 +713,11 @@ class DigestStream: public WritableStream {
     return bytesWritten;
   }
 
+  // Piping a native ReadableStream (a fetch() or R2 body, say) into a DigestStream pumps its bytes
+  // straight into the hash context instead of reading them into JavaScript one chunk at a time.
+  kj::Maybe<jsg::Promise<void>> tryPipeFromNative(
+      jsg::Lock& js, ReadableStream& source, PipeToOptions& options) override;
+
   JSG_RESOURCE_TYPE(DigestStream, CompatibilityFlags::Reader flags) {
     JSG_INHERIT(WritableStream);
     if (flags.getJsgPropertyOnPrototypeTemplate()) {
@@ -714,17 +746,63 @@ class DigestStream: public WritableStream {
           resolver(kj::mv(resolver)),
           context(initContext(this->algorithm)) {}
   };
+  class NativeSink;
+
   jsg::MemoizedIdentity<jsg::Promise<kj::Array<kj::byte>>> promise;
   kj::OneOf<Ready, StreamStates::Closed, StreamStates::Errored> state;
   uint64_t bytesWritten = 0;
 
   kj::Maybe<StreamStates::Errored> write(jsg::Lock& js, kj::ArrayPtr<kj::byte> buffer);
+  // Used by NativeSink, which runs outside of the isolate lock.
+  void writeNative(kj::ArrayPtr<const kj::byte> buffer);
   kj::Maybe<StreamStates::Errored> close(jsg::Lock& js);
   void abort(jsg::Lock& js, jsg::JsValue reason);
 
   void visitForGc(jsg::GcVisitor& visitor);
 };
 
+// =======================================================================================
+// EncryptionStream and DecryptionStream are non-standard extensions that run AES-GCM or AES-CTR
+// over streaming data. Writing a message to one in any number of chunks produces the same bytes
+// as passing the whole message to subtle.encrypt() or subtle.decrypt().
+//
+// A DecryptionStream using AES-GCM emits plaintext before the authentication tag at the end of
+// the input has been checked. An authentication failure errors the stream, but only after the
+// preceding plaintext has been read.
+class EncryptionStream: public TransformStream {
+ public:
+  using TransformStream::TransformStream;
+
+  static jsg::Ref<EncryptionStream> constructor(jsg::Lock& js,
+      kj::OneOf<kj::String, SubtleCrypto::EncryptAlgorithm> algorithm,
+      const CryptoKey& key);
+
+  JSG_RESOURCE_TYPE(EncryptionStream) {
+    JSG_INHERIT(TransformStream);
+
+    JSG_TS_OVERRIDE(extends TransformStream<ArrayBuffer | ArrayBufferView, Uint8Array> {
+      constructor(algorithm: string | SubtleCryptoEncryptAlgorithm, key: CryptoKey);
+    });
+  }
+};
+
+class DecryptionStream: public TransformStream {
+ public:
+  using TransformStream::TransformStream;
+
+  static jsg::Ref<DecryptionStream> constructor(jsg::Lock& js,
+      kj::OneOf<kj::String, SubtleCrypto::EncryptAlgorithm> algorithm,
+      const CryptoKey& key);
+
+  JSG_RESOURCE_TYPE(DecryptionStream) {
+    JSG_INHERIT(TransformStream);
+
+    JSG_TS_OVERRIDE(extends TransformStream<ArrayBuffer | ArrayBufferView, Uint8Array> {
+      constructor(algorithm: string | SubtleCryptoEncryptAlgorithm, key: CryptoKey);
+    });
+  }
+};
+
 // =======================================================================================
 // Crypto
 
@@ -750,6 +828,10 @@ class Crypto: public jsg::Object {
     JSG_METHOD(randomUUID);
 
     JSG_NESTED_TYPE(DigestStream);
+    if (flags.getCryptoCipherStreams()) {
+      JSG_NESTED_TYPE(EncryptionStream);
+      JSG_NESTED_TYPE(DecryptionStream);
+    }
 
     JSG_TS_OVERRIDE({
       getRandomValues<
@@ -787,7 +869,8 @@ class Crypto: public jsg::Object {
       api::CryptoKey::KeyAlgorithm, api::CryptoKey::AesKeyAlgorithm,                               \
       api::CryptoKey::HmacKeyAlgorithm, api::CryptoKey::RsaKeyAlgorithm,                           \
       api::CryptoKey::EllipticKeyAlgorithm, api::CryptoKey::ArbitraryKeyAlgorithm,                 \
-      api::CryptoKey::AsymmetricKeyDetails, api::DigestStream
+      api::CryptoKey::AsymmetricKeyDetails, api::SubtleCrypto::VerifyBatchItem,                    \
+      api::DigestStream, api::EncryptionStream, api::DecryptionStream
 
 }  // namespace workerd::api
 
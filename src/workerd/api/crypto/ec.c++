@@ -870,24 +870,34 @@ class EdDsaKey final: public AsymmetricKeyCryptoKeyImpl {
       SubtleCrypto::SignAlgorithm&& algorithm,
       kj::ArrayPtr<const kj::byte> signature,
       kj::ArrayPtr<const kj::byte> data) const override {
-    ClearErrorOnReturn clearErrorOnReturn;
-
-    JSG_REQUIRE(getTypeEnum() == KeyType::PUBLIC, DOMInvalidAccessError,
-        "Asymmetric verification requires a public key.");
-
-    JSG_REQUIRE(getAlgorithmName() == "Ed25519" || getAlgorithmName() == "NODE-ED25519",
-        DOMOperationError, "Not implemented for this algorithm", getAlgorithmName());
-
+    requireVerifyingAbility();
     JSG_REQUIRE(signature.size() == ED25519_SIGNATURE_LEN, DOMOperationError, "Invalid ",
         getAlgorithmName(), " signature length ", signature.size());
 
     auto digestCtx = OSSL_NEW(EVP_MD_CTX);
-    JSG_REQUIRE(1 == EVP_DigestSignInit(digestCtx.get(), nullptr, nullptr, nullptr, getEvpPkey()),
+    return verifyWithContext(js, kj::mv(algorithm), signature, data, *digestCtx);
+  }
+
+  bool verifyWithContext(jsg::Lock& js,
+      SubtleCrypto::SignAlgorithm&& algorithm,
+      kj::ArrayPtr<const kj::byte> signature,
+      kj::ArrayPtr<const kj::byte> data,
+      EVP_MD_CTX& digestCtx) const override {
+    ClearErrorOnReturn clearErrorOnReturn;
+    requireVerifyingAbility();
+
+    // In a batch, a malformed signature is simply invalid rather than failing every other
+    // signature along with it.
+    if (signature.size() != ED25519_SIGNATURE_LEN) return false;
+
+    // The context may have been used for a previous signature in a batch.
+    EVP_MD_CTX_reset(&digestCtx);
+    JSG_REQUIRE(1 == EVP_DigestSignInit(&digestCtx, nullptr, nullptr, nullptr, getEvpPkey()),
         InternalDOMOperationError, "Failed to initialize Ed25519 verification digest",
         internalDescribeOpensslErrors());
 
     auto result = EVP_DigestVerify(
-        digestCtx.get(), signature.begin(), signature.size(), data.begin(), data.size());
+        &digestCtx, signature.begin(), signature.size(), data.begin(), data.size());
 
     JSG_REQUIRE(result == 0 || result == 1, InternalDOMOperationError, "Unexpected return code",
         result, internalDescribeOpensslErrors());
@@ -989,6 +999,14 @@ class EdDsaKey final: public AsymmetricKeyCryptoKeyImpl {
  private:
   kj::StringPtr keyAlgorithm;
 
+  void requireVerifyingAbility() const {
+    JSG_REQUIRE(getTypeEnum() == KeyType::PUBLIC, DOMInvalidAccessError,
+        "Asymmetric verification requires a public key.");
+
+    JSG_REQUIRE(getAlgorithmName() == "Ed25519" || getAlgorithmName() == "NODE-ED25519",
+        DOMOperationError, "Not implemented for this algorithm", getAlgorithmName());
+  }
+
   SubtleCrypto::JsonWebKey exportJwk() const override final {
     KJ_ASSERT(getAlgorithmName() == "X25519"_kj || getAlgorithmName() == "Ed25519"_kj ||
         getAlgorithmName() == "NODE-ED25519"_kj);
@@ -87,13 +87,21 @@ kj::Maybe<jsg::BufferSource> hkdf(jsg::Lock& js,
     kj::ArrayPtr<const kj::byte> salt,
     kj::ArrayPtr<const kj::byte> info) {
   auto buf = jsg::BackingStore::alloc<v8::ArrayBuffer>(js, length);
-  if (HKDF(buf.asArrayPtr().begin(), length, digest, key.begin(), key.size(), salt.begin(),
-          salt.size(), info.begin(), info.size()) != 1) {
+  if (!hkdf(buf.asArrayPtr(), digest, key, salt, info)) {
     return kj::none;
   }
   return jsg::BufferSource(js, kj::mv(buf));
 }
 
+bool hkdf(kj::ArrayPtr<kj::byte> output,
+    const EVP_MD* digest,
+    kj::ArrayPtr<const kj::byte> key,
+    kj::ArrayPtr<const kj::byte> salt,
+    kj::ArrayPtr<const kj::byte> info) {
+  return HKDF(output.begin(), output.size(), digest, key.begin(), key.size(), salt.begin(),
+             salt.size(), info.begin(), info.size()) == 1;
+}
+
 kj::Own<CryptoKey::Impl> CryptoKey::Impl::importHkdf(jsg::Lock& js,
     kj::StringPtr normalizedName,
     kj::StringPtr format,
@@ -3,6 +3,7 @@
 //     https://opensource.org/licenses/Apache-2.0
 
 #include "impl.h"
+#include "key-cache.h"
 
 #include <openssl/ec.h>
 #include <openssl/err.h>
@@ -34,5 +35,91 @@ KJ_TEST("Crypto error conversion") {
   KJ_EXPECT_THROW_MESSAGE("jsg.DOMException(OperationError): Invalid point encoding.", OSSLCALL(0));
 }
 
+class FakePublicKey final: public CryptoKey::Impl {
+ public:
+  FakePublicKey(): CryptoKey::Impl(true, CryptoKeyUsageSet::verify()) {}
+
+  kj::StringPtr getAlgorithmName() const override {
+    return "ECDSA"_kj;
+  }
+  CryptoKey::AlgorithmVariant getAlgorithm(jsg::Lock& js) const override {
+    return CryptoKey::KeyAlgorithm{.name = "ECDSA"_kj};
+  }
+  kj::StringPtr getType() const override {
+    return "public"_kj;
+  }
+  bool equals(const CryptoKey::Impl& other) const override {
+    return this == &other;
+  }
+};
+
+SubtleCrypto::ImportKeyAlgorithm ecdsaP256() {
+  return {.name = kj::str("ECDSA"), .namedCurve = kj::str("P-256")};
+}
+
+KJ_TEST("CryptoKeyCache only keys public imports") {
+  auto usages = kj::arr(kj::str("verify"));
+  auto spki = [](kj::byte b) -> SubtleCrypto::ImportKeyData { return kj::heapArray({b, b, b}); };
+
+  auto a = KJ_ASSERT_NONNULL(
+      CryptoKeyCache::keyFor("spki", "ECDSA", spki(1), ecdsaP256(), true, usages));
+  auto b = KJ_ASSERT_NONNULL(
+      CryptoKeyCache::keyFor("spki", "ECDSA", spki(1), ecdsaP256(), true, usages));
+  auto c = KJ_ASSERT_NONNULL(
+      CryptoKeyCache::keyFor("spki", "ECDSA", spki(2), ecdsaP256(), true, usages));
+  auto d = KJ_ASSERT_NONNULL(
+      CryptoKeyCache::keyFor("spki", "ECDSA", spki(1), ecdsaP256(), false, usages));
+  KJ_EXPECT(a.id == b.id);
+  KJ_EXPECT(a.id != c.id);
+  KJ_EXPECT(a.id != d.id);
+
+  // Private and secret key material is never cached.
+  KJ_EXPECT(
+      CryptoKeyCache::keyFor("pkcs8", "ECDSA", spki(1), ecdsaP256(), true, usages) == kj::none);
+  KJ_EXPECT(
+      CryptoKeyCache::keyFor("raw", "HMAC", spki(1), ecdsaP256(), true, usages) == kj::none);
+
+  SubtleCrypto::JsonWebKey jwk;
+  jwk.kty = kj::str("EC");
+  jwk.crv = kj::str("P-256");
+  jwk.x = kj::str("x");
+  jwk.y = kj::str("y");
+  KJ_EXPECT(
+      CryptoKeyCache::keyFor("jwk", "ECDSA", kj::mv(jwk), ecdsaP256(), true, usages) != kj::none);
+
+  SubtleCrypto::JsonWebKey privateJwk;
+  privateJwk.kty = kj::str("EC");
+  privateJwk.d = kj::str("d");
+  KJ_EXPECT(CryptoKeyCache::keyFor(
+                "jwk", "ECDSA", kj::mv(privateJwk), ecdsaP256(), true, usages) == kj::none);
+}
+
+KJ_TEST("CryptoKeyCache shares Impls and evicts least recently used") {
+  auto key = [](kj::StringPtr id) { return CryptoKeyCache::Key{.id = kj::str(id), .bytes = 100}; };
+  CryptoKeyCache cache(250);
+
+  auto first = cache.insert(key("a"), kj::heap<FakePublicKey>());
+  auto hit = KJ_ASSERT_NONNULL(cache.find(key("a")));
+  KJ_EXPECT(hit.get() == first.get());
+
+  cache.insert(key("b"), kj::heap<FakePublicKey>());
+  KJ_EXPECT(cache.size() == 2);
+  KJ_EXPECT(cache.getTotalBytes() == 200);
+
+  // Touch "a" so that "b" is the one evicted.
+  KJ_EXPECT(cache.find(key("a")) != kj::none);
+  cache.insert(key("c"), kj::heap<FakePublicKey>());
+  KJ_EXPECT(cache.size() == 2);
+  KJ_EXPECT(cache.find(key("a")) != kj::none);
+  KJ_EXPECT(cache.find(key("b")) == kj::none);
+  KJ_EXPECT(cache.find(key("c")) != kj::none);
+
+  // A key the application still holds outlives its eviction.
+  cache.insert(key("d"), kj::heap<FakePublicKey>());
+  cache.insert(key("e"), kj::heap<FakePublicKey>());
+  KJ_EXPECT(cache.find(key("a")) == kj::none);
+  KJ_EXPECT(first->getType() == "public");
+}
+
 }  // namespace
 }  // namespace workerd::api
@@ -158,6 +158,28 @@ class CryptoKey::Impl {
         getAlgorithmName(), "\".");
   }
 
+  // Incremental form of encrypt() and decrypt(), used by crypto.EncryptionStream and
+  // crypto.DecryptionStream. Feeding a message through update() in any number of chunks and then
+  // calling finish() produces the same bytes as a single encrypt() or decrypt() call would.
+  //
+  // A CipherStream is driven from the stream's sink, outside of the isolate lock, so it must not
+  // touch the JavaScript heap.
+  class CipherStream {
+   public:
+    virtual ~CipherStream() noexcept(false) = default;
+
+    // Transforms the next chunk of input, returning whatever output is ready.
+    virtual kj::Array<kj::byte> update(kj::ArrayPtr<const kj::byte> input) = 0;
+
+    // Returns any trailing output. Throws if the input fails authentication.
+    virtual kj::Array<kj::byte> finish() = 0;
+  };
+  virtual kj::Own<CipherStream> newCipherStream(
+      SubtleCrypto::EncryptAlgorithm&& algorithm, bool encrypt) const {
+    JSG_FAIL_REQUIRE(DOMNotSupportedError, "Streaming ", encrypt ? "encryption" : "decryption",
+        " is not implemented for \"", getAlgorithmName(), "\".");
+  }
+
   virtual jsg::BufferSource sign(jsg::Lock& js,
       SubtleCrypto::SignAlgorithm&& algorithm,
       kj::ArrayPtr<const kj::byte> data) const {
@@ -172,6 +194,17 @@ class CryptoKey::Impl {
         getAlgorithmName(), "\".");
   }
 
+  // Like verify(), but for SubtleCrypto::verifyBatch(). `context` is owned by the caller and
+  // reused for every signature in the batch, so implementations that verify through
+  // EVP_DigestVerify*() should reset and reinitialize it rather than allocate their own.
+  virtual bool verifyWithContext(jsg::Lock& js,
+      SubtleCrypto::SignAlgorithm&& algorithm,
+      kj::ArrayPtr<const kj::byte> signature,
+      kj::ArrayPtr<const kj::byte> data,
+      EVP_MD_CTX& context) const {
+    return verify(js, kj::mv(algorithm), signature, data);
+  }
+
   virtual jsg::BufferSource deriveBits(jsg::Lock& js,
       SubtleCrypto::DeriveKeyAlgorithm&& algorithm,
       kj::Maybe<uint32_t> length) const {
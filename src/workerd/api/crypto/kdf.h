@@ -39,4 +39,27 @@ kj::Maybe<jsg::BufferSource> scrypt(jsg::Lock& js,
     kj::ArrayPtr<const kj::byte> pass,
     kj::ArrayPtr<const kj::byte> salt);
 
+// Variants of the above that derive the key into `output`, which determines its length, rather
+// than onto the JavaScript heap. These don't need the isolate lock, so they can run on a
+// ThreadPool thread. They return false if the derivation failed.
+bool hkdf(kj::ArrayPtr<kj::byte> output,
+    const EVP_MD* digest,
+    kj::ArrayPtr<const kj::byte> key,
+    kj::ArrayPtr<const kj::byte> salt,
+    kj::ArrayPtr<const kj::byte> info);
+
+bool pbkdf2(kj::ArrayPtr<kj::byte> output,
+    size_t iterations,
+    const EVP_MD* digest,
+    kj::ArrayPtr<const kj::byte> password,
+    kj::ArrayPtr<const kj::byte> salt);
+
+bool scrypt(kj::ArrayPtr<kj::byte> output,
+    uint32_t N,
+    uint32_t r,
+    uint32_t p,
+    uint32_t maxmem,
+    kj::ArrayPtr<const kj::byte> pass,
+    kj::ArrayPtr<const kj::byte> salt);
+
 }  // namespace workerd::api
@@ -0,0 +1,190 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "key-cache.h"
+
+#include "impl.h"
+
+#include <openssl/sha.h>
+
+#include <kj/encoding.h>
+
+namespace workerd::api {
+
+namespace {
+
+// Approximate fixed cost of an entry on top of its key material: the table row, the Impl, and
+// OpenSSL's parsed form of the key.
+constexpr size_t ENTRY_OVERHEAD = 1024;
+
+// Feeds the fields of an import into a SHA-256. Every value is length- or tag-prefixed so that
+// two different imports can never serialize to the same byte sequence.
+class KeyHasher {
+ public:
+  KeyHasher() {
+    SHA256_Init(&ctx);
+  }
+
+  void add(kj::ArrayPtr<const kj::byte> bytes) {
+    uint64_t size = bytes.size();
+    bytesHashed += size;
+    SHA256_Update(&ctx, &size, sizeof(size));
+    SHA256_Update(&ctx, bytes.begin(), bytes.size());
+  }
+  void add(kj::StringPtr str) {
+    add(str.asBytes());
+  }
+  void add(const kj::String& str) {
+    add(str.asPtr());
+  }
+  void add(bool value) {
+    kj::byte b = value;
+    SHA256_Update(&ctx, &b, 1);
+  }
+  void add(int value) {
+    SHA256_Update(&ctx, &value, sizeof(value));
+  }
+
+  template <typename T>
+  void add(const jsg::Optional<T>& maybe) {
+    KJ_IF_SOME(value, maybe) {
+      add(true);
+      add(value);
+    } else {
+      add(false);
+    }
+  }
+  void add(const kj::OneOf<kj::String, SubtleCrypto::HashAlgorithm>& hash) {
+    KJ_SWITCH_ONEOF(hash) {
+      KJ_CASE_ONEOF(name, kj::String) {
+        add(name);
+      }
+      KJ_CASE_ONEOF(algorithm, SubtleCrypto::HashAlgorithm) {
+        add(algorithm.name);
+      }
+    }
+  }
+  void add(const kj::Array<kj::String>& strings) {
+    add(static_cast<int>(strings.size()));
+    for (auto& str: strings) {
+      add(str);
+    }
+  }
+
+  kj::String finish() {
+    kj::byte digest[SHA256_DIGEST_LENGTH];
+    SHA256_Final(digest, &ctx);
+    return kj::encodeHex(kj::arrayPtr(digest, sizeof(digest)));
+  }
+
+  // Total size of the strings and buffers hashed so far.
+  size_t getBytesHashed() const {
+    return bytesHashed;
+  }
+
+ private:
+  SHA256_CTX ctx;
+  size_t bytesHashed = 0;
+};
+
+// Formats and algorithms for which a "raw" import yields a public key.
+bool isRawPublicKeyAlgorithm(kj::StringPtr normalizedName) {
+  return normalizedName == "ECDSA" || normalizedName == "ECDH" ||
+      normalizedName == "NODE-ED25519" || normalizedName == "Ed25519" ||
+      normalizedName == "X25519";
+}
+
+bool isPublicJwk(const SubtleCrypto::JsonWebKey& jwk) {
+  if (jwk.kty != "RSA" && jwk.kty != "EC" && jwk.kty != "OKP") return false;
+  return jwk.d == kj::none && jwk.p == kj::none && jwk.q == kj::none && jwk.dp == kj::none &&
+      jwk.dq == kj::none && jwk.qi == kj::none && jwk.oth == kj::none && jwk.k == kj::none;
+}
+
+}  // namespace
+
+kj::Maybe<CryptoKeyCache::Key> CryptoKeyCache::keyFor(kj::StringPtr format,
+    kj::StringPtr normalizedName,
+    const SubtleCrypto::ImportKeyData& keyData,
+    const SubtleCrypto::ImportKeyAlgorithm& algorithm,
+    bool extractable,
+    kj::ArrayPtr<const kj::String> keyUsages) {
+  KeyHasher hasher;
+  hasher.add(format);
+  hasher.add(normalizedName);
+
+  KJ_SWITCH_ONEOF(keyData) {
+    KJ_CASE_ONEOF(bytes, kj::Array<kj::byte>) {
+      if (format != "spki" && !(format == "raw" && isRawPublicKeyAlgorithm(normalizedName))) {
+        return kj::none;
+      }
+      hasher.add(bytes.asPtr());
+    }
+    KJ_CASE_ONEOF(jwk, SubtleCrypto::JsonWebKey) {
+      if (format != "jwk" || !isPublicJwk(jwk)) return kj::none;
+      hasher.add(jwk.kty);
+      hasher.add(jwk.use);
+      hasher.add(jwk.key_ops);
+      hasher.add(jwk.alg);
+      hasher.add(jwk.ext);
+      hasher.add(jwk.crv);
+      hasher.add(jwk.x);
+      hasher.add(jwk.y);
+      hasher.add(jwk.n);
+      hasher.add(jwk.e);
+    }
+  }
+
+  hasher.add(algorithm.hash);
+  hasher.add(algorithm.length);
+  hasher.add(algorithm.namedCurve);
+  hasher.add(algorithm.compressed);
+  hasher.add(extractable);
+  hasher.add(static_cast<int>(keyUsages.size()));
+  for (auto& usage: keyUsages) {
+    hasher.add(usage);
+  }
+
+  auto bytes = ENTRY_OVERHEAD + hasher.getBytesHashed();
+  return Key{.id = hasher.finish(), .bytes = bytes};
+}
+
+kj::Own<CryptoKey::Impl> CryptoKeyCache::share(Shared& shared) {
+  return kj::Own<CryptoKey::Impl>(shared.impl.get(), kj::NullDisposer::instance)
+      .attach(kj::addRef(shared));
+}
+
+kj::Maybe<kj::Own<CryptoKey::Impl>> CryptoKeyCache::find(const Key& key) {
+  KJ_IF_SOME(entry, entries.find(key.id)) {
+    // Move the entry to the back of the insertion order to mark it most recently used.
+    auto& bumped = entries.insert(entries.release(entry));
+    return share(*bumped.shared);
+  }
+  return kj::none;
+}
+
+kj::Own<CryptoKey::Impl> CryptoKeyCache::insert(Key key, kj::Own<CryptoKey::Impl> impl) {
+  auto shared = kj::refcounted<Shared>(kj::mv(impl));
+  auto result = share(*shared);
+  auto bytes = key.bytes;
+  if (shared->impl->getType() != "public" || bytes > maxBytes) {
+    return result;
+  }
+
+  KJ_IF_SOME(existing, entries.find(key.id)) {
+    totalBytes -= existing.bytes;
+    entries.erase(existing);
+  }
+
+  while (totalBytes + bytes > maxBytes) {
+    auto& oldest = *entries.ordered<1>().begin();
+    totalBytes -= oldest.bytes;
+    entries.erase(oldest);
+  }
+
+  totalBytes += bytes;
+  entries.insert(Entry{kj::mv(key.id), kj::mv(shared), bytes});
+  return result;
+}
+
+}  // namespace workerd::api
@@ -0,0 +1,97 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include "crypto.h"
+
+#include <kj/table.h>
+
+namespace workerd::api {
+
+// A per-isolate, memory-bounded cache of imported public keys, owned by the Worker::Isolate.
+//
+// Workers that verify JWTs tend to import the same JWKS or SPKI public keys on every request, and
+// for RSA and EC keys reparsing the key material through OpenSSL costs more than the verification
+// itself. A hit hands back the CryptoKey::Impl built by the first import; Impls are immutable once
+// constructed, so any number of CryptoKeys may share one.
+//
+// Only public keys are cached. Private and secret key material is never hashed or retained beyond
+// the CryptoKeys that the application holds.
+class CryptoKeyCache {
+ public:
+  explicit CryptoKeyCache(size_t maxBytes): maxBytes(maxBytes) {}
+  KJ_DISALLOW_COPY_AND_MOVE(CryptoKeyCache);
+
+  struct Key {
+    // Hex SHA-256 over the format, the normalized algorithm name and parameters, extractability,
+    // usages, and key material.
+    kj::String id;
+
+    // Rough memory cost of caching the imported key, charged against the budget.
+    size_t bytes;
+  };
+
+  // Computes the cache key for an import. Returns kj::none if the import could not produce a
+  // public key and so is never cached.
+  static kj::Maybe<Key> keyFor(kj::StringPtr format,
+      kj::StringPtr normalizedName,
+      const SubtleCrypto::ImportKeyData& keyData,
+      const SubtleCrypto::ImportKeyAlgorithm& algorithm,
+      bool extractable,
+      kj::ArrayPtr<const kj::String> keyUsages);
+
+  // Returns a new reference to the cached Impl, or kj::none on a miss. A hit makes the entry the
+  // most recently used.
+  kj::Maybe<kj::Own<CryptoKey::Impl>> find(const Key& key);
+
+  // Takes ownership of `impl`, caching it under `key` if it is a public key, and returns a
+  // reference to it for the caller's CryptoKey. Evicts the least recently used entries to stay
+  // within the memory budget.
+  kj::Own<CryptoKey::Impl> insert(Key key, kj::Own<CryptoKey::Impl> impl);
+
+  size_t size() const {
+    return entries.size();
+  }
+  size_t getTotalBytes() const {
+    return totalBytes;
+  }
+
+ private:
+  // Keeps a cached Impl alive for as long as any CryptoKey refers to it, even after the entry
+  // itself has been evicted.
+  struct Shared: public kj::Refcounted {
+    kj::Own<CryptoKey::Impl> impl;
+    explicit Shared(kj::Own<CryptoKey::Impl> impl): impl(kj::mv(impl)) {}
+  };
+
+  struct Entry {
+    kj::String key;
+    kj::Own<Shared> shared;
+    size_t bytes;
+  };
+
+  struct EntryCallbacks {
+    kj::StringPtr keyForRow(const Entry& entry) const {
+      return entry.key;
+    }
+    bool matches(const Entry& entry, kj::StringPtr key) const {
+      return entry.key == key;
+    }
+    uint hashCode(kj::StringPtr key) const {
+      return kj::hashCode(key);
+    }
+  };
+
+  static kj::Own<CryptoKey::Impl> share(Shared& shared);
+
+  size_t maxBytes;
+  size_t totalBytes = 0;
+
+  // Iterating the insertion-order index visits the least recently used entry first, since hits
+  // are moved to the back.
+  kj::Table<Entry, kj::HashIndex<EntryCallbacks>, kj::InsertionOrderIndex> entries;
+};
+
+}  // namespace workerd::api
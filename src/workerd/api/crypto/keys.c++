@@ -276,6 +276,15 @@ bool AsymmetricKeyCryptoKeyImpl::verify(jsg::Lock& js,
     SubtleCrypto::SignAlgorithm&& algorithm,
     kj::ArrayPtr<const kj::byte> signature,
     kj::ArrayPtr<const kj::byte> data) const {
+  auto digestCtx = OSSL_NEW(EVP_MD_CTX);
+  return verifyWithContext(js, kj::mv(algorithm), signature, data, *digestCtx);
+}
+
+bool AsymmetricKeyCryptoKeyImpl::verifyWithContext(jsg::Lock& js,
+    SubtleCrypto::SignAlgorithm&& algorithm,
+    kj::ArrayPtr<const kj::byte> signature,
+    kj::ArrayPtr<const kj::byte> data,
+    EVP_MD_CTX& digestCtx) const {
   ClearErrorOnReturn clearErrorOnReturn;
 
   JSG_REQUIRE(keyType == KeyType::PUBLIC, DOMInvalidAccessError,
@@ -285,16 +294,16 @@ bool AsymmetricKeyCryptoKeyImpl::verify(jsg::Lock& js,
 
   auto type = lookupDigestAlgorithm(chooseHash(algorithm.hash)).second;
 
-  auto digestCtx = OSSL_NEW(EVP_MD_CTX);
-
-  OSSLCALL(EVP_DigestVerifyInit(digestCtx.get(), nullptr, type, nullptr, keyData.get()));
-  addSalt(digestCtx->pctx, algorithm);
+  // The context may have been used for a previous signature in a batch.
+  EVP_MD_CTX_reset(&digestCtx);
+  OSSLCALL(EVP_DigestVerifyInit(&digestCtx, nullptr, type, nullptr, keyData.get()));
+  addSalt(digestCtx.pctx, algorithm);
   // No-op call unless CryptoKey is RsaPss
-  OSSLCALL(EVP_DigestVerifyUpdate(digestCtx.get(), data.begin(), data.size()));
+  OSSLCALL(EVP_DigestVerifyUpdate(&digestCtx, data.begin(), data.size()));
   // EVP_DigestVerifyFinal() returns 1 on success, 0 on invalid signature, and any other value
   // indicates "a more serious error".
-  auto result = EVP_DigestVerifyFinal(
-      digestCtx.get(), sslSignature.asArrayPtr().begin(), sslSignature.size());
+  auto result =
+      EVP_DigestVerifyFinal(&digestCtx, sslSignature.asArrayPtr().begin(), sslSignature.size());
   JSG_REQUIRE(result == 0 || result == 1, InternalDOMOperationError,
       "Unexpected return code from digest verify", getAlgorithmName());
   return !!result;
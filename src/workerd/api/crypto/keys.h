@@ -94,6 +94,11 @@ class AsymmetricKeyCryptoKeyImpl: public CryptoKey::Impl {
       SubtleCrypto::SignAlgorithm&& algorithm,
       kj::ArrayPtr<const kj::byte> signature,
       kj::ArrayPtr<const kj::byte> data) const override;
+  bool verifyWithContext(jsg::Lock& js,
+      SubtleCrypto::SignAlgorithm&& algorithm,
+      kj::ArrayPtr<const kj::byte> signature,
+      kj::ArrayPtr<const kj::byte> data,
+      EVP_MD_CTX& context) const override;
 
   kj::StringPtr getType() const override;
   KeyType getTypeEnum() const {
@@ -5,6 +5,7 @@
 #include "impl.h"
 
 #include <workerd/api/crypto/kdf.h>
+#include <workerd/util/duration-exceeded-logger.h>
 
 #include <openssl/evp.h>
 #include <openssl/mem.h>
@@ -108,13 +109,23 @@ kj::Maybe<jsg::BufferSource> pbkdf2(jsg::Lock& js,
     kj::ArrayPtr<const kj::byte> password,
     kj::ArrayPtr<const kj::byte> salt) {
   auto buf = jsg::BackingStore::alloc<v8::ArrayBuffer>(js, length);
-  if (PKCS5_PBKDF2_HMAC(password.asChars().begin(), password.size(), salt.begin(), salt.size(),
-          iterations, digest, length, buf.asArrayPtr().begin()) != 1) {
+  static util::SlowOperationSite slowOpSite("crypto: pbkdf2", 100 * kj::MILLISECONDS);
+  util::SlowOperationTimer slowOpTimer(slowOpSite);
+  if (!pbkdf2(buf.asArrayPtr(), iterations, digest, password, salt)) {
     return kj::none;
   }
   return jsg::BufferSource(js, kj::mv(buf));
 }
 
+bool pbkdf2(kj::ArrayPtr<kj::byte> output,
+    size_t iterations,
+    const EVP_MD* digest,
+    kj::ArrayPtr<const kj::byte> password,
+    kj::ArrayPtr<const kj::byte> salt) {
+  return PKCS5_PBKDF2_HMAC(password.asChars().begin(), password.size(), salt.begin(), salt.size(),
+             iterations, digest, output.size(), output.begin()) == 1;
+}
+
 kj::Own<CryptoKey::Impl> CryptoKey::Impl::importPbkdf2(jsg::Lock& js,
     kj::StringPtr normalizedName,
     kj::StringPtr format,
@@ -1,19 +1,31 @@
 #include "prime.h"
 
 #include <workerd/api/crypto/impl.h>
+#include <workerd/io/io-context.h>
 #include <workerd/jsg/jsg.h>
+#include <workerd/util/duration-exceeded-logger.h>
 
 #include <openssl/bn.h>
 
+#include <atomic>
+
 namespace workerd::api {
 
-jsg::BufferSource randomPrime(jsg::Lock& js,
-    uint32_t size,
+namespace {
+
+// The validated parameters of a prime search. BIGNUMs aren't tied to a thread, so a search can
+// run on the ThreadPool once these have been imported.
+struct PrimeParams {
+  int bits;
+  bool safe;
+  kj::Maybe<kj::Own<BIGNUM>> add;
+  kj::Maybe<kj::Own<BIGNUM>> rem;
+};
+
+PrimeParams importPrimeParams(uint32_t size,
     bool safe,
     kj::Maybe<kj::ArrayPtr<kj::byte>> add_buf,
     kj::Maybe<kj::ArrayPtr<kj::byte>> rem_buf) {
-  ClearErrorOnReturn clearErrorOnReturn;
-
   // Use mapping to have kj::Own work with optional buffer
   const auto maybeOwnBignum = [](kj::Maybe<kj::ArrayPtr<kj::byte>>& maybeBignum) {
     return maybeBignum.map([](kj::ArrayPtr<kj::byte>& a) {
@@ -82,26 +94,150 @@ jsg::BufferSource randomPrime(jsg::Lock& js,
   JSG_REQUIRE(
       workerd::api::CSPRNG(nullptr), Error, "Error while generating prime (bad random state)");
 
+  return PrimeParams{.bits = bits, .safe = safe, .add = kj::mv(_add), .rem = kj::mv(_rem)};
+}
+
+kj::Array<kj::byte> generatePrime(const PrimeParams& params, BN_GENCB* cb) {
   auto prime = OSSL_NEW(BIGNUM);
 
-  int ret = BN_generate_prime_ex(prime.get(), bits, safe ? 1 : 0, add, rem, nullptr);
+  const BIGNUM* add = nullptr;
+  KJ_IF_SOME(a, params.add) {
+    add = a.get();
+  }
+  const BIGNUM* rem = nullptr;
+  KJ_IF_SOME(r, params.rem) {
+    rem = r.get();
+  }
+
+  int ret = BN_generate_prime_ex(prime.get(), params.bits, params.safe ? 1 : 0, add, rem, cb);
   JSG_REQUIRE(ret == 1, Error, "Error while generating prime");
 
-  return JSG_REQUIRE_NONNULL(
-      bignumToArrayPadded(js, *prime), Error, "Error while generating prime");
+  return JSG_REQUIRE_NONNULL(bignumToArrayPadded(*prime), Error, "Error while generating prime");
 }
 
-bool checkPrime(kj::ArrayPtr<kj::byte> bufferView, uint32_t num_checks) {
-  ClearErrorOnReturn clearErrorOnReturn;
+void checkPrimeChecks(uint32_t num_checks) {
   static constexpr int32_t kMaxChecks = kj::maxValue;
   // Strictly upper bound the number of checks. If this proves to be too expensive
   // then we may need to consider lowering this limit further.
   JSG_REQUIRE(num_checks <= kMaxChecks, RangeError, "Invalid number of checks");
-  auto candidate = JSG_REQUIRE_NONNULL(toBignum(bufferView), Error, "Error while checking prime");
+}
+
+bool isPrime(kj::ArrayPtr<const kj::byte> candidateBytes, uint32_t num_checks, BN_GENCB* cb) {
+  auto candidate =
+      JSG_REQUIRE_NONNULL(toBignum(candidateBytes), Error, "Error while checking prime");
   auto ctx = OSSL_NEW(BN_CTX);
-  int ret = BN_is_prime_ex(candidate.get(), num_checks, ctx.get(), nullptr);
+  int ret = BN_is_prime_ex(candidate.get(), num_checks, ctx.get(), cb);
   JSG_REQUIRE(ret >= 0, Error, "Error while checking prime");
   return ret > 0;
 }
 
+// Lets a prime search running on the ThreadPool notice that nobody is waiting for its result
+// anymore -- because the request was canceled or ran out of CPU -- and give up, instead of
+// occupying a pool thread for however many seconds a large safe prime takes.
+class PrimeSearchCanceler final: public kj::AtomicRefcounted {
+ public:
+  void cancel() const {
+    canceled.store(true, std::memory_order_relaxed);
+  }
+
+  // Also stops the search once `context` exceeds its limits. Only for searches that run inline
+  // on the isolate thread.
+  void stopOnLimitsExceeded(IoContext& context) {
+    limitsContext = context;
+  }
+
+  // Installs this canceler as `cb`'s callback. BoringSSL calls it periodically during the
+  // search and abandons the search if it returns 0.
+  void setCallback(BN_GENCB& cb) const {
+    cb.arg = const_cast<PrimeSearchCanceler*>(this);
+    cb.callback = [](int, int, BN_GENCB* cb) -> int {
+      auto& self = *static_cast<const PrimeSearchCanceler*>(cb->arg);
+      if (self.canceled.load(std::memory_order_relaxed)) return 0;
+      KJ_IF_SOME(context, self.limitsContext) {
+        return context.getLimitEnforcer().getLimitsExceeded() == kj::none;
+      }
+      return 1;
+    };
+  }
+
+ private:
+  mutable std::atomic<bool> canceled = false;
+  kj::Maybe<IoContext&> limitsContext;
+};
+
+// Runs `search` such that it doesn't block the isolate: within a request it runs on the shared
+// ThreadPool, charged to the request's CPU time, and is abandoned if the request goes away
+// first. Outside of a request, or when the isolate is already at its off-thread task limit, it
+// runs inline.
+template <typename T, typename Result>
+jsg::Promise<Result> runPrimeSearch(jsg::Lock& js,
+    kj::Function<T(BN_GENCB*)> search,
+    kj::Function<Result(jsg::Lock&, T)> toResult) {
+  if (!IoContext::hasCurrent()) {
+    ClearErrorOnReturn clearErrorOnReturn;
+    return js.resolvedPromise(toResult(js, search(nullptr)));
+  }
+  auto& context = IoContext::current();
+
+  auto canceler = kj::atomicRefcounted<PrimeSearchCanceler>();
+  kj::Function<T()> work = [search = kj::mv(search),
+                               canceler = kj::atomicAddRef(*canceler)]() mutable {
+    ClearErrorOnReturn clearErrorOnReturn;
+    BN_GENCB cb;
+    canceler->setCallback(cb);
+    return search(&cb);
+  };
+  KJ_IF_SOME(promise, context.tryRunOffThread(kj::mv(work))) {
+    auto cancelOnDrop = kj::defer([canceler = kj::mv(canceler)]() { canceler->cancel(); });
+    return context.awaitIo(js, promise.attach(kj::mv(cancelOnDrop)), kj::mv(toResult));
+  }
+
+  canceler->stopOnLimitsExceeded(context);
+  return js.resolvedPromise(toResult(js, work()));
+}
+
+}  // namespace
+
+jsg::BufferSource randomPrime(jsg::Lock& js,
+    uint32_t size,
+    bool safe,
+    kj::Maybe<kj::ArrayPtr<kj::byte>> add_buf,
+    kj::Maybe<kj::ArrayPtr<kj::byte>> rem_buf) {
+  ClearErrorOnReturn clearErrorOnReturn;
+  auto params = importPrimeParams(size, safe, add_buf, rem_buf);
+  static util::SlowOperationSite slowOpSite("crypto: generate prime", 100 * kj::MILLISECONDS);
+  util::SlowOperationTimer slowOpTimer(slowOpSite);
+  auto prime = generatePrime(params, nullptr);
+  return jsg::BufferSource(js, jsg::BackingStore::from<v8::ArrayBuffer>(kj::mv(prime)));
+}
+
+jsg::Promise<jsg::BufferSource> randomPrimeAsync(jsg::Lock& js,
+    uint32_t size,
+    bool safe,
+    kj::Maybe<kj::ArrayPtr<kj::byte>> add_buf,
+    kj::Maybe<kj::ArrayPtr<kj::byte>> rem_buf) {
+  ClearErrorOnReturn clearErrorOnReturn;
+  auto params = importPrimeParams(size, safe, add_buf, rem_buf);
+  return runPrimeSearch<kj::Array<kj::byte>, jsg::BufferSource>(js,
+      [params = kj::mv(params)](BN_GENCB* cb) { return generatePrime(params, cb); },
+      [](jsg::Lock& js, kj::Array<kj::byte> prime) {
+    return jsg::BufferSource(js, jsg::BackingStore::from<v8::ArrayBuffer>(kj::mv(prime)));
+  });
+}
+
+bool checkPrime(kj::ArrayPtr<kj::byte> bufferView, uint32_t num_checks) {
+  ClearErrorOnReturn clearErrorOnReturn;
+  checkPrimeChecks(num_checks);
+  return isPrime(bufferView, num_checks, nullptr);
+}
+
+jsg::Promise<bool> checkPrimeAsync(
+    jsg::Lock& js, kj::ArrayPtr<kj::byte> bufferView, uint32_t num_checks) {
+  checkPrimeChecks(num_checks);
+  return runPrimeSearch<bool, bool>(js,
+      [candidate = kj::heapArray(bufferView.asConst()), num_checks](BN_GENCB* cb) {
+    return isPrime(candidate, num_checks, cb);
+  }, [](jsg::Lock&, bool result) { return result; });
+}
+
 }  // namespace workerd::api
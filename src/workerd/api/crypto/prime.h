@@ -7,6 +7,8 @@
 namespace workerd::jsg {
 class Lock;
 class BufferSource;
+template <typename T>
+class Promise;
 }  // namespace workerd::jsg
 
 namespace workerd::api {
@@ -21,4 +23,15 @@ jsg::BufferSource randomPrime(jsg::Lock& js,
 // Checks if the given buffer represents a prime.
 bool checkPrime(kj::ArrayPtr<kj::byte> buffer, uint32_t num_checks);
 
+// Variants of the above that validate their arguments synchronously but, within a request, run
+// the search on the shared ThreadPool so that large primes don't stall the isolate. The search
+// is abandoned if the request is canceled before it completes.
+jsg::Promise<jsg::BufferSource> randomPrimeAsync(jsg::Lock& js,
+    uint32_t size,
+    bool safe,
+    kj::Maybe<kj::ArrayPtr<kj::byte>> add_buf,
+    kj::Maybe<kj::ArrayPtr<kj::byte>> rem_buf);
+jsg::Promise<bool> checkPrimeAsync(
+    jsg::Lock& js, kj::ArrayPtr<kj::byte> buffer, uint32_t num_checks);
+
 }  // namespace workerd::api
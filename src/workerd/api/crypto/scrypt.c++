@@ -5,6 +5,7 @@
 #include "impl.h"
 
 #include <workerd/api/crypto/kdf.h>
+#include <workerd/util/duration-exceeded-logger.h>
 
 #include <openssl/evp.h>
 
@@ -18,10 +19,25 @@ kj::Maybe<jsg::BufferSource> scrypt(jsg::Lock& js,
     uint32_t maxmem,
     kj::ArrayPtr<const kj::byte> pass,
     kj::ArrayPtr<const kj::byte> salt) {
-  ClearErrorOnReturn clearErrorOnReturn;
   auto buf = jsg::BackingStore::alloc<v8::ArrayBuffer>(js, length);
+  static util::SlowOperationSite slowOpSite("crypto: scrypt", 100 * kj::MILLISECONDS);
+  util::SlowOperationTimer slowOpTimer(slowOpSite);
+  if (!scrypt(buf.asArrayPtr(), N, r, p, maxmem, pass, salt)) {
+    return kj::none;
+  }
+  return jsg::BufferSource(js, kj::mv(buf));
+}
+
+bool scrypt(kj::ArrayPtr<kj::byte> output,
+    uint32_t N,
+    uint32_t r,
+    uint32_t p,
+    uint32_t maxmem,
+    kj::ArrayPtr<const kj::byte> pass,
+    kj::ArrayPtr<const kj::byte> salt) {
+  ClearErrorOnReturn clearErrorOnReturn;
   if (!EVP_PBE_scrypt(pass.asChars().begin(), pass.size(), salt.begin(), salt.size(), N, r, p,
-          maxmem, buf.asArrayPtr().begin(), length)) {
+          maxmem, output.begin(), output.size())) {
     // This does not currently handle the errors in exactly the same way as
     // the Node.js implementation but that's probably ok? We can update the
     // error thrown to match Node.js more closely later if necessary. There
@@ -29,9 +45,9 @@ kj::Maybe<jsg::BufferSource> scrypt(jsg::Lock& js,
     if (clearErrorOnReturn.peekError()) {
       throwOpensslError(__FILE__, __LINE__, "crypto::scrypt");
     }
-    return kj::none;
+    return false;
   }
-  return jsg::BufferSource(js, kj::mv(buf));
+  return true;
 }
 
 }  // namespace workerd::api
@@ -14,49 +14,18 @@
 namespace workerd::api {
 
 namespace {
-class EventSourceSink final: public WritableStreamSink {
+class EventSourceSink final: public WritableStreamSink, private EventStreamParser::Handler {
  public:
-  EventSourceSink(EventSource& eventSource): eventSource(eventSource) {}
+  EventSourceSink(EventSource& eventSource): eventSource(eventSource), parser(*this) {}
 
   kj::Promise<void> write(kj::ArrayPtr<const kj::byte> buffer) override {
-    // The event stream is a new-line delimited format where each line represents an event.
-    // We need to scan the buffer for end-of-line characters. When we find one, everything before
-    // it is pushed into the event queue and we keep scanning. If we do not find an end-of-line
-    // sequence in the remaining input, we buffer it and wait for the next write to continue
-    // scanning, or until the stream is ended or aborted.
-
     if (eventSource == kj::none) {
       // Write was received after end() or abort() was called.
       // We'll just ignore the write.
       return kj::READY_NOW;
     }
 
-    auto input = buffer.asChars();
-
-    // The stream may or may not begin with the UTF-8 BOM (%xFEFF). If this is the
-    // first write, we need to check for it and skip it if it is present.
-    // The BOM is a 3-byte sequence (0xEF, 0xBB, 0xBF) that encodes the Unicode
-    // codepoint U+FEFF. We only want to check for this once.
-    if (!bomChecked) {
-      bomChecked = true;
-      if (input.size() >= 3 && input[0] == '\xEF' && input[1] == '\xBB' && input[2] == '\xBF') {
-        input = input.slice(3);
-      }
-    }
-
-    while (input != nullptr) {
-      KJ_IF_SOME(found, findEndOfLine(input)) {
-        auto prefix = kept.releaseAsArray();
-        // Feed the line into the processor.
-        feed(kj::str(prefix, input.first(found.pos)));
-        input = found.remaining;
-        // If we've reached the end of the input, input will == nullptr here.
-      } else {
-        // No end-of-line found, buffer the input.
-        kept.addAll(input.begin(), input.end());
-        input = nullptr;
-      }
-    }
+    parser.feed(buffer.asChars());
 
     // Release any buffered events to the EventSource
     release();
@@ -65,10 +34,14 @@ class EventSourceSink final: public WritableStreamSink {
   }
 
   kj::Promise<void> write(kj::ArrayPtr<const kj::ArrayPtr<const kj::byte>> pieces) override {
+    if (eventSource == kj::none) {
+      return kj::READY_NOW;
+    }
     for (auto& piece: pieces) {
-      co_await write(piece);
+      parser.feed(piece.asChars());
     }
-    co_return;
+    release();
+    return kj::READY_NOW;
   }
 
   kj::Promise<void> end() override {
@@ -86,93 +59,27 @@ class EventSourceSink final: public WritableStreamSink {
  private:
   kj::Maybe<EventSource&> eventSource;
 
-  // Retained bytes to be processed in the next write.
-  kj::Vector<char> kept;
+  EventStreamParser parser;
 
   // The collected messages that are pending to be dispatched as events
   kj::Vector<EventSource::PendingMessage> pendingMessages;
 
-  // The message that is currently being processed.
-  kj::Maybe<EventSource::PendingMessage> currentPendingMessage;
-
-  // Set to true once the byte-order-mark has been checked
-  bool bomChecked = false;
-
-  EventSource::PendingMessage& getPendingMessage() {
-    KJ_IF_SOME(pending, currentPendingMessage) {
-      return pending;
-    }
-    return currentPendingMessage.emplace();
+  void onEvent(
+      kj::Maybe<kj::ArrayPtr<const char>> type, kj::ArrayPtr<const char> data) override {
+    // The next time release() is called, this will be passed off to the EventSource.
+    pendingMessages.add(EventSource::PendingMessage{
+      .data = kj::str(data),
+      .event = type.map([](kj::ArrayPtr<const char> t) { return kj::str(t); }),
+      .id = kj::str(KJ_ASSERT_NONNULL(eventSource).getLastEventId()),
+    });
   }
 
-  void feed(kj::String line) {
-    // Parse line according to the event stream format and dispatch the event.
-
-    // stream        = [ bom ] *event
-    // event         = *( comment / field ) end-of-line
-    // comment       = colon *any-char end-of-line
-    // field         = 1*name-char [ colon [ space ] *any-char ] end-of-line
-    // end-of-line   = ( cr lf / cr / lf )
-
-    // ; characters
-    // lf            = %x000A ; U+000A LINE FEED (LF)
-    // cr            = %x000D ; U+000D CARRIAGE RETURN (CR)
-    // space         = %x0020 ; U+0020 SPACE
-    // colon         = %x003A ; U+003A COLON (:)
-    // bom           = %xFEFF ; U+FEFF BYTE ORDER MARK
-    // name-char     = %x0000-0009 / %x000B-000C / %x000E-0039 / %x003B-10FFFF
-    //                 ; a scalar value other than U+000A LINE FEED (LF), U+000D CARRIAGE RETURN
-    //                   (CR), or U+003A COLON (:)
-    // any-char      = %x0000-0009 / %x000B-000C / %x000E-10FFFF
-    //                 ; a scalar value other than U+000A LINE FEED (LF) or U+000D CARRIAGE
-    //                   RETURN (CR)
-
-    // Note that the BOM (if present) is filtered out in the write() method.
-
-    if (line.size() == 0) {
-      // Dispatch the current pending message and clear it. If there is no
-      // pending message, we'll just ignore the line.
-      KJ_IF_SOME(pending, currentPendingMessage) {
-        // This message is done and ready to be dispatched. Add it to the
-        // pendingMessages list. The next time release() is called, it will
-        // be passed off to the EventSource.
-        pending.id = kj::str(KJ_ASSERT_NONNULL(eventSource).getLastEventId());
-        pendingMessages.add(kj::mv(pending));
-        currentPendingMessage = kj::none;
-      }
-    } else if (line[0] == ':') {
-      // Ignore the line.
-    } else {
-      static constexpr auto handle = [](auto& self, kj::ArrayPtr<const char> field,
-                                         kj::ArrayPtr<const char> value) {
-        auto& pending = self.getPendingMessage();
-        auto& ev = KJ_ASSERT_NONNULL(self.eventSource);
-        // Per the spec, only one space after the colon is optional and trimmed.
-        // Any other whitespace, or additional spaces aren't accounted for so would
-        // be part of the value.
-        if (value.size() > 0 && value[0] == ' ') {
-          value = value.slice(1);
-        }
-        if (field == "data"_kjc) {
-          pending.data.add(kj::str(value));
-        } else if (field == "event"_kjc) {
-          pending.event = kj::str(value);
-        } else if (field == "id"_kjc) {
-          ev.setLastEventId(kj::str(value));
-        } else if (field == "retry"_kjc) {
-          KJ_IF_SOME(time, kj::str(value).tryParseAs<uint32_t>()) {
-            KJ_ASSERT_NONNULL(self.eventSource).setReconnectionTime(time);
-          }
-          // Ignore the line if it cannot be successfully parsed as a uint32_t
-        }
-      };
+  void onId(kj::ArrayPtr<const char> id) override {
+    KJ_ASSERT_NONNULL(eventSource).setLastEventId(kj::str(id));
+  }
 
-      KJ_IF_SOME(pos, line.findFirst(':')) {
-        handle(*this, line.first(pos), line.slice(pos + 1));
-      } else {
-        handle(*this, line, ""_kjc);
-      }
-    }
+  void onRetry(uint32_t time) override {
+    KJ_ASSERT_NONNULL(eventSource).setReconnectionTime(time);
   }
 
   void release() {
@@ -186,30 +93,8 @@ class EventSourceSink final: public WritableStreamSink {
 
   void clear() {
     eventSource = kj::none;
-    kept.clear();
+    parser.reset();
     pendingMessages.clear();
-    currentPendingMessage = kj::none;
-  }
-
-  struct EndOfLine {
-    size_t pos;
-    kj::ArrayPtr<const char> remaining;
-  };
-  kj::Maybe<EndOfLine> findEndOfLine(kj::ArrayPtr<const char> input) {
-    // The end-of-line marker is either \n, \r, or \r\n
-    size_t pos = 0;
-    while (pos < input.size()) {
-      if (input[pos] == '\n') {
-        return EndOfLine{pos, input.slice(pos + 1)};
-      } else if (input[pos] == '\r') {
-        if (pos + 1 < input.size() && input[pos + 1] == '\n') {
-          return EndOfLine{pos, input.slice(pos + 2)};
-        }
-        return EndOfLine{pos, input.slice(pos + 1)};
-      }
-      pos++;
-    }
-    return kj::none;
   }
 };
 
@@ -304,10 +189,9 @@ void EventSource::notifyMessages(jsg::Lock& js, kj::Array<PendingMessage> messag
   if (readyState == State::CLOSED) return;
   js.tryCatch([&] {
     for (auto& message: messages) {
-      auto data = kj::str(kj::delimited(kj::mv(message.data), "\n"_kjc));
-      if (data.size() == 0) continue;
+      if (message.data.size() == 0) continue;
       dispatchEventImpl(js,
-          jsg::alloc<MessageEvent>(kj::mv(message.event), kj::mv(data), kj::mv(message.id),
+          jsg::alloc<MessageEvent>(kj::mv(message.event), kj::mv(message.data), kj::mv(message.id),
               impl.map([](FetchImpl& i) -> jsg::Url& { return i.url; })));
     }
   }, [&](jsg::Value exception) {
@@ -518,4 +402,157 @@ void EventSource::visitForMemoryInfo(jsg::MemoryTracker& tracker) const {
   tracker.trackField("lastEventId", lastEventId);
 }
 
+// =======================================================================================
+// EventStreamParser
+
+// Parses a line according to the event stream format:
+//
+// stream        = [ bom ] *event
+// event         = *( comment / field ) end-of-line
+// comment       = colon *any-char end-of-line
+// field         = 1*name-char [ colon [ space ] *any-char ] end-of-line
+// end-of-line   = ( cr lf / cr / lf )
+//
+// ; characters
+// lf            = %x000A ; U+000A LINE FEED (LF)
+// cr            = %x000D ; U+000D CARRIAGE RETURN (CR)
+// space         = %x0020 ; U+0020 SPACE
+// colon         = %x003A ; U+003A COLON (:)
+// bom           = %xFEFF ; U+FEFF BYTE ORDER MARK
+// name-char     = %x0000-0009 / %x000B-000C / %x000E-0039 / %x003B-10FFFF
+//                 ; a scalar value other than U+000A LINE FEED (LF), U+000D CARRIAGE RETURN
+//                   (CR), or U+003A COLON (:)
+// any-char      = %x0000-0009 / %x000B-000C / %x000E-10FFFF
+//                 ; a scalar value other than U+000A LINE FEED (LF) or U+000D CARRIAGE
+//                   RETURN (CR)
+
+namespace {
+// Returns the first `c` in [begin, end), or `end`.
+const char* findChar(const char* begin, const char* end, char c) {
+  auto found = static_cast<const char*>(memchr(begin, c, end - begin));
+  return found == nullptr ? end : found;
+}
+
+kj::Maybe<uint32_t> parseRetry(kj::ArrayPtr<const char> value) {
+  if (value.size() == 0) return kj::none;
+  uint64_t result = 0;
+  for (char c: value) {
+    if (c < '0' || c > '9') return kj::none;
+    result = result * 10 + (c - '0');
+    if (result > uint32_t(kj::maxValue)) return kj::none;
+  }
+  return static_cast<uint32_t>(result);
+}
+}  // namespace
+
+void EventStreamParser::feed(kj::ArrayPtr<const char> input) {
+  const char* pos = input.begin();
+  const char* end = input.end();
+  if (skipLf && pos != end) {
+    skipLf = false;
+    if (*pos == '\n') ++pos;
+  }
+
+  // The next LF and CR at or after `pos`. Each is only searched for again once `pos` has passed
+  // it, so a stream that uses one kind of line end is not rescanned for the other on every line.
+  const char* lf = findChar(pos, end, '\n');
+  const char* cr = findChar(pos, end, '\r');
+  while (pos != end) {
+    if (lf < pos) lf = findChar(pos, end, '\n');
+    if (cr < pos) cr = findChar(pos, end, '\r');
+    auto eol = kj::min(lf, cr);
+    if (eol == end) {
+      // No end-of-line in the rest of the input; keep it for the next chunk.
+      partial.addAll(pos, end);
+      break;
+    }
+
+    if (partial.empty()) {
+      processLine(kj::arrayPtr(pos, eol));
+    } else {
+      partial.addAll(pos, eol);
+      processLine(partial.asPtr());
+      partial.clear();
+    }
+
+    pos = eol + 1;
+    if (*eol == '\r') {
+      if (pos == end) {
+        skipLf = true;
+      } else if (*pos == '\n') {
+        ++pos;
+      }
+    }
+  }
+}
+
+void EventStreamParser::reset() {
+  partial.clear();
+  data.clear();
+  eventType.clear();
+  skipLf = false;
+  firstLine = true;
+}
+
+void EventStreamParser::processLine(kj::ArrayPtr<const char> line) {
+  if (firstLine) {
+    firstLine = false;
+    // The stream may begin with the UTF-8 encoding of the byte-order mark, U+FEFF.
+    if (line.size() >= 3 && line[0] == '\xEF' && line[1] == '\xBB' && line[2] == '\xBF') {
+      line = line.slice(3);
+    }
+  }
+
+  if (line.size() == 0) {
+    dispatch();
+    return;
+  }
+  if (line[0] == ':') {
+    // A comment.
+    return;
+  }
+
+  auto field = line;
+  kj::ArrayPtr<const char> value;
+  auto colon = findChar(line.begin(), line.end(), ':');
+  if (colon != line.end()) {
+    field = kj::arrayPtr(line.begin(), colon);
+    value = kj::arrayPtr(colon + 1, line.end());
+    // Per the spec, only one space after the colon is optional and trimmed.
+    // Any other whitespace, or additional spaces aren't accounted for so would
+    // be part of the value.
+    if (value.size() > 0 && value[0] == ' ') {
+      value = value.slice(1);
+    }
+  }
+
+  if (field == "data"_kjc) {
+    data.addAll(value);
+    data.add('\n');
+  } else if (field == "event"_kjc) {
+    eventType.clear();
+    eventType.addAll(value);
+  } else if (field == "id"_kjc) {
+    handler.onId(value);
+  } else if (field == "retry"_kjc) {
+    // Ignore the line if it cannot be successfully parsed as a uint32_t
+    KJ_IF_SOME(time, parseRetry(value)) {
+      handler.onRetry(time);
+    }
+  }
+}
+
+void EventStreamParser::dispatch() {
+  if (!data.empty()) {
+    kj::Maybe<kj::ArrayPtr<const char>> type;
+    if (!eventType.empty()) {
+      type = eventType.asPtr();
+    }
+    // Drop the '\n' that follows the last data line.
+    handler.onEvent(type, data.asPtr().first(data.size() - 1));
+  }
+  data.clear();
+  eventType.clear();
+}
+
 }  // namespace workerd::api
@@ -184,7 +184,8 @@ class EventSource: public EventTarget {
   }
 
   struct PendingMessage {
-    kj::Vector<kj::String> data;
+    // The event's data lines, joined by '\n'.
+    kj::String data;
     kj::Maybe<kj::String> event;
     kj::String id;
   };
@@ -262,6 +263,52 @@ class EventSource: public EventTarget {
   void reconnect(jsg::Lock& js);
 };
 
+// Incremental parser for the text/event-stream format, fed the stream's bytes in chunks of any
+// size. Line ends are found with memchr(), which is vectorized, and a line is only copied if it
+// spans chunks. An event's data is collected in a buffer that's reused across events and only
+// handed out when the event is dispatched.
+class EventStreamParser {
+ public:
+  class Handler {
+   public:
+    // Called when a blank line ends an event that had at least one data field. `type` is
+    // kj::none if the event had no (or an empty) event field. `data` is the event's data lines
+    // joined by '\n'. Both are only valid during the call.
+    virtual void onEvent(
+        kj::Maybe<kj::ArrayPtr<const char>> type, kj::ArrayPtr<const char> data) = 0;
+
+    // Called for each id field.
+    virtual void onId(kj::ArrayPtr<const char> id) = 0;
+
+    // Called for each retry field whose value is a valid uint32.
+    virtual void onRetry(uint32_t time) = 0;
+  };
+
+  explicit EventStreamParser(Handler& handler): handler(handler) {}
+
+  void feed(kj::ArrayPtr<const char> input);
+
+  // Drops any partial line or event.
+  void reset();
+
+ private:
+  Handler& handler;
+
+  // The start of a line that continues in the next chunk.
+  kj::Vector<char> partial;
+  // The current event's data lines, each followed by '\n', and its event type.
+  kj::Vector<char> data;
+  kj::Vector<char> eventType;
+  // Set if the last chunk ended with a CR, in which case a LF starting the next one is part of the
+  // same line end.
+  bool skipLf = false;
+  // Cleared once the first line, which may start with a byte-order mark, has been processed.
+  bool firstLine = true;
+
+  void processLine(kj::ArrayPtr<const char> line);
+  void dispatch();
+};
+
 }  // namespace workerd::api
 
 #define EW_EVENTSOURCE_ISOLATE_TYPES                                                               \
@@ -4,8 +4,10 @@
 
 #include "form-data.h"
 
+#include "streams/common.h"
 #include "util.h"
 
+#include <workerd/api/node/buffer-string-search.h>
 #include <workerd/io/io-util.h>
 #include <workerd/util/mimetype.h>
 
@@ -23,15 +25,34 @@
 namespace workerd::api {
 
 namespace {
-// Like split() in kj/compat/url.c++, but splits at a substring rather than a character.
-kj::ArrayPtr<const char> splitAtSubString(kj::ArrayPtr<const char>& text, kj::StringPtr subString) {
-  // TODO(perf): Use a Boyer-Moore search?
-  auto iter = std::search(text.begin(), text.end(), subString.begin(), subString.end());
-  auto result = kj::arrayPtr(text.begin(), iter - text.begin());
-  text =
-      text.slice(kj::min(text.size(), result.end() - text.begin() + subString.size()), text.size());
-  return result;
-}
+// Splits text at successive occurrences of a fixed substring. This reuses the search behind
+// Buffer.prototype.indexOf(), which uses memchr() to skip to candidate first bytes and upgrades
+// to Boyer-Moore-Horspool / Boyer-Moore for longer patterns when the linear scan does badly.
+// Keeping one splitter per boundary means its skip tables are built once per body, not once per
+// part.
+class SubStringSplitter {
+ public:
+  explicit SubStringSplitter(kj::ArrayPtr<const char> subString)
+      : subStringSize(subString.size()),
+        search(Vector(subString.asBytes().begin(), subString.size(), true)) {}
+
+  // Like split() in kj/compat/url.c++, but splits at a substring rather than a character.
+  kj::ArrayPtr<const char> split(kj::ArrayPtr<const char>& text) {
+    size_t pos = text.size();
+    if (text.size() >= subStringSize) {
+      pos = search.Search(Vector(text.asBytes().begin(), text.size(), true), 0);
+    }
+    auto result = text.first(pos);
+    text = text.slice(kj::min(text.size(), pos + subStringSize), text.size());
+    return result;
+  }
+
+ private:
+  using Vector = node::stringsearch::Vector<const uint8_t>;
+
+  size_t subStringSize;
+  node::stringsearch::StringSearch<uint8_t> search;
+};
 
 struct FormDataHeaderTable {
   kj::HttpHeaderId contentDispositionId;
@@ -78,7 +99,7 @@ void parseFormData(kj::Maybe<jsg::Lock&> js,
   // We want to slice off the delimiter's preceding newline for the initial search, because the very
   // first instance does not require one. In every subsequent multipart message, the preceding
   // newline is required.
-  auto message = splitAtSubString(body, delimiter.slice(1));
+  auto message = SubStringSplitter(delimiter.slice(1)).split(body);
 
   JSG_REQUIRE(
       body.size() > 0, TypeError, "No initial boundary string (or you have a truncated message).");
@@ -107,6 +128,7 @@ void parseFormData(kj::Maybe<jsg::Lock&> js,
   std::cmatch match;
 
   auto& formDataHeaderTable = getFormDataHeaderTable();
+  SubStringSplitter delimiterSplitter(delimiter);
 
   while (!done(body)) {
     JSG_REQUIRE(std::regex_search(body.begin(), body.end(), match, headerTerminationRegex),
@@ -157,7 +179,7 @@ void parseFormData(kj::Maybe<jsg::Lock&> js,
 
     kj::Maybe<kj::StringPtr> type = headers.get(kj::HttpHeaderId::CONTENT_TYPE);
 
-    message = splitAtSubString(body, delimiter);
+    message = delimiterSplitter.split(body);
     JSG_REQUIRE(
         body.size() > 0, TypeError, "No subsequent boundary string after multipart message.");
 
@@ -224,7 +246,8 @@ kj::OneOf<jsg::Ref<File>, kj::String> blobToFile(jsg::Lock& js,
 
 // Add the chars from `value` into `builder` escaping the characters '"' and '\n' using %
 // encoding, exactly as Chrome does for Content-Disposition values.
-void addEscapingQuotes(kj::Vector<char>& builder, kj::StringPtr value) {
+template <typename Output>
+void addEscapingQuotes(Output& builder, kj::StringPtr value) {
   // Chrome throws "Failed to fetch" if the name ends with a backslash. Otherwise it worries that
   // the backslash may be interpreted as escaping the final quote.
   JSG_REQUIRE(!value.endsWith("\\"), TypeError, "Name or filename can't end with backslash");
@@ -252,20 +275,13 @@ void addEscapingQuotes(kj::Vector<char>& builder, kj::StringPtr value) {
   }
 }
 
-}  // namespace
-
-// =======================================================================================
-// FormData implementation
-
-kj::Array<kj::byte> FormData::serialize(kj::ArrayPtr<const char> boundary) {
-  // Boundary string requirement per RFC7578
-  JSG_REQUIRE(boundary.size() > 0 && boundary.size() <= 70, TypeError,
-      "Length of multipart/form-data boundary string must be in the range [1, 70].");
-
-  // TODO(perf): We should be able to trivially calculate the length of the serialized form data
-  //   beforehand. I tried, but apparently my math REALLY sucks and I hate memory overruns, so ...
-  auto builder = kj::Vector<char>{};
-
+// Writes the multipart/form-data serialization of `data` to `builder`. Boundaries, part headers,
+// and text values go through add()/addAll(); File contents go through addFile() so that each
+// Output can decide whether to copy them. Every Output sees exactly the same sequence of calls,
+// which is what lets FormDataMeasurer size the buffers used by the others.
+template <typename Output>
+void writeFormData(
+    Output& builder, kj::ArrayPtr<FormData::Entry> data, kj::ArrayPtr<const char> boundary) {
   for (auto& kv: data) {
     builder.addAll("--"_kj);
     builder.addAll(boundary);
@@ -288,7 +304,7 @@ kj::Array<kj::byte> FormData::serialize(kj::ArrayPtr<const char> boundary) {
           builder.addAll(type);
         }
         builder.addAll("\r\n\r\n"_kj);
-        builder.addAll(file->getData().asChars());
+        builder.addFile(file->getData());
       }
     }
     builder.addAll("\r\n"_kj);
@@ -296,8 +312,198 @@ kj::Array<kj::byte> FormData::serialize(kj::ArrayPtr<const char> boundary) {
   builder.addAll("--"_kj);
   builder.addAll(boundary);
   builder.addAll("--"_kj);
+}
+
+// Output for writeFormData() that only counts.
+struct FormDataMeasurer {
+  size_t framingSize = 0;
+  size_t fileSize = 0;
+  size_t fileCount = 0;
+
+  void add(char) {
+    ++framingSize;
+  }
+  void addAll(kj::ArrayPtr<const char> text) {
+    framingSize += text.size();
+  }
+  void addFile(kj::ArrayPtr<const byte> bytes) {
+    fileSize += bytes.size();
+    ++fileCount;
+  }
+};
+
+// Output for writeFormData() that copies everything into a buffer of exactly the right size.
+class FormDataBufferWriter {
+ public:
+  explicit FormDataBufferWriter(kj::ArrayPtr<byte> buffer): remaining(buffer) {}
+
+  void add(char c) {
+    remaining[0] = c;
+    remaining = remaining.slice(1);
+  }
+  void addAll(kj::ArrayPtr<const char> text) {
+    addFile(text.asBytes());
+  }
+  void addFile(kj::ArrayPtr<const byte> bytes) {
+    remaining.first(bytes.size()).copyFrom(bytes);
+    remaining = remaining.slice(bytes.size());
+  }
+
+  void finish() {
+    KJ_ASSERT(remaining.size() == 0, "form data size was miscomputed");
+  }
+
+ private:
+  kj::ArrayPtr<byte> remaining;
+};
+
+// Output for writeFormData() that copies framing into a buffer of exactly the right size but
+// leaves File contents where they are, producing the body as a list of pieces.
+class FormDataPieceWriter {
+ public:
+  FormDataPieceWriter(kj::ArrayPtr<byte> framing, size_t fileCount)
+      : remaining(framing),
+        pieceStart(framing.begin()),
+        pieces(fileCount * 2 + 1) {}
+
+  void add(char c) {
+    remaining[0] = c;
+    remaining = remaining.slice(1);
+  }
+  void addAll(kj::ArrayPtr<const char> text) {
+    remaining.first(text.size()).copyFrom(text.asBytes());
+    remaining = remaining.slice(text.size());
+  }
+  void addFile(kj::ArrayPtr<const byte> bytes) {
+    flushFraming();
+    if (bytes.size() > 0) {
+      pieces.add(bytes);
+    }
+  }
+
+  kj::Array<kj::ArrayPtr<const byte>> finish() {
+    flushFraming();
+    KJ_ASSERT(remaining.size() == 0, "form data size was miscomputed");
+    return pieces.releaseAsArray();
+  }
+
+ private:
+  kj::ArrayPtr<byte> remaining;
+  byte* pieceStart;
+  kj::Vector<kj::ArrayPtr<const byte>> pieces;
+
+  void flushFraming() {
+    if (remaining.begin() > pieceStart) {
+      pieces.add(kj::arrayPtr(pieceStart, remaining.begin()));
+      pieceStart = remaining.begin();
+    }
+  }
+};
+
+// A serialized FormData body, read out piece by piece. Framing lives in `framing`; File contents
+// are read directly from the Files, which `files` keeps alive.
+//
+// NOTE: `files` holds jsg::Refs, so like Body::Buffer this must only be used from within the
+//   isolate's IoContext.
+class FormDataInputStream final: public ReadableStreamSource {
+ public:
+  FormDataInputStream(kj::Array<byte> framing,
+      kj::Array<jsg::Ref<File>> files,
+      kj::Array<kj::ArrayPtr<const byte>> pieces,
+      size_t size)
+      : framing(kj::mv(framing)),
+        files(kj::mv(files)),
+        pieces(kj::mv(pieces)),
+        unreadSize(size) {}
+
+  kj::Promise<size_t> tryRead(void* buffer, size_t minBytes, size_t maxBytes) override {
+    auto out = kj::arrayPtr(static_cast<byte*>(buffer), maxBytes);
+    size_t amount = 0;
+    while (out.size() > 0 && nextPiece < pieces.size()) {
+      auto& piece = pieces[nextPiece];
+      size_t n = kj::min(out.size(), piece.size());
+      out.first(n).copyFrom(piece.first(n));
+      out = out.slice(n);
+      piece = piece.slice(n);
+      amount += n;
+      if (piece.size() == 0) ++nextPiece;
+    }
+    unreadSize -= amount;
+    return amount;
+  }
+
+  kj::Maybe<uint64_t> tryGetLength(StreamEncoding encoding) override {
+    if (encoding == StreamEncoding::IDENTITY) {
+      return unreadSize;
+    } else {
+      return kj::none;
+    }
+  }
+
+  kj::Promise<DeferredProxy<void>> pumpTo(WritableStreamSink& output, bool end) override {
+    auto unread = pieces.slice(nextPiece);
+    nextPiece = pieces.size();
+    unreadSize = 0;
+    if (unread.size() > 0) {
+      co_await output.write(unread);
+    }
+    if (end) co_await output.end();
+
+    co_return;
+  }
+
+ private:
+  kj::Array<byte> framing;
+  kj::Array<jsg::Ref<File>> files;
+  kj::Array<kj::ArrayPtr<const byte>> pieces;
+  size_t nextPiece = 0;
+  size_t unreadSize;
+};
+
+void requireValidBoundary(kj::ArrayPtr<const char> boundary) {
+  // Boundary string requirement per RFC7578
+  JSG_REQUIRE(boundary.size() > 0 && boundary.size() <= 70, TypeError,
+      "Length of multipart/form-data boundary string must be in the range [1, 70].");
+}
+
+}  // namespace
+
+// =======================================================================================
+// FormData implementation
+
+kj::Array<kj::byte> FormData::serialize(kj::ArrayPtr<const char> boundary) {
+  requireValidBoundary(boundary);
+
+  FormDataMeasurer measurer;
+  writeFormData(measurer, data, boundary);
+
+  auto result = kj::heapArray<kj::byte>(measurer.framingSize + measurer.fileSize);
+  FormDataBufferWriter writer(result);
+  writeFormData(writer, data, boundary);
+  writer.finish();
+  return result;
+}
+
+kj::Own<ReadableStreamSource> FormData::serializeAsStream(kj::ArrayPtr<const char> boundary) {
+  requireValidBoundary(boundary);
+
+  FormDataMeasurer measurer;
+  writeFormData(measurer, data, boundary);
+
+  auto files = kj::heapArrayBuilder<jsg::Ref<File>>(measurer.fileCount);
+  for (auto& kv: data) {
+    KJ_IF_SOME(file, kv.value.tryGet<jsg::Ref<File>>()) {
+      files.add(file.addRef());
+    }
+  }
+
+  auto framing = kj::heapArray<kj::byte>(measurer.framingSize);
+  FormDataPieceWriter writer(framing, measurer.fileCount);
+  writeFormData(writer, data, boundary);
+  auto pieces = writer.finish();
 
-  return builder.releaseAsArray().releaseAsBytes();
+  return kj::heap<FormDataInputStream>(kj::mv(framing), files.finish(), kj::mv(pieces),
+      measurer.framingSize + measurer.fileSize);
 }
 
 FormData::EntryType FormData::clone(FormData::EntryType& value) {
@@ -11,6 +11,8 @@
 
 namespace workerd::api {
 
+class ReadableStreamSource;
+
 // Implements the FormData interface as prescribed by:
 // https://xhr.spec.whatwg.org/#interface-formdata
 //
@@ -43,6 +45,12 @@ public:
   // bytes suitable for use as an HTTP message body.
   kj::Array<kj::byte> serialize(kj::ArrayPtr<const char> boundary);
 
+  // Like serialize(), but produces the body as a stream whose length is known up front. Only the
+  // boundaries and part headers are copied; File contents are written out of the Files
+  // themselves. The stream holds references to the Files, so it must be used within the
+  // isolate's IoContext.
+  kj::Own<ReadableStreamSource> serializeAsStream(kj::ArrayPtr<const char> boundary);
+
   // Parse `rawText`, storing the results in this FormData object. `contentType` must be either
   // multipart/form-data or application/x-www-form-urlencoded.
   //
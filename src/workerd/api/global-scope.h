@@ -53,6 +53,7 @@ class DecompressionStream;
 class TextEncoderStream;
 class TextDecoderStream;
 class URLPattern;
+class URLPatternList;
 class Blob;
 class File;
 class FormData;
@@ -110,7 +111,7 @@ class Performance: public jsg::Object {
 
   JSG_RESOURCE_TYPE(Performance) {
     JSG_READONLY_INSTANCE_PROPERTY(timeOrigin, getTimeOrigin);
-    JSG_METHOD(now);
+    JSG_FAST_METHOD(now);
   }
 };
 
@@ -667,6 +668,9 @@ class ServiceWorkerGlobalScope: public WorkerGlobalScope {
       JSG_NESTED_TYPE(URLSearchParams);
     }
     JSG_NESTED_TYPE(URLPattern);
+    if (flags.getWorkerdExperimental()) {
+      JSG_NESTED_TYPE(URLPatternList);
+    }
 
     JSG_NESTED_TYPE(Blob);
     JSG_NESTED_TYPE(File);
@@ -9,35 +9,66 @@
 #include <kj/common.h>
 #include <kj/debug.h>
 
-#define BUSY_LOOP_DELAY_MS 50
-
 namespace workerd::api::gpu {
 
+namespace {
+
+// Bounds for the interval between ProcessEvents() calls.
+constexpr double MIN_POLL_DELAY_MS = 1;
+constexpr double MAX_POLL_DELAY_MS = 50;
+
+}  // namespace
+
+AsyncRunner::AsyncRunner(wgpu::Instance instance)
+    : instance_(instance),
+      delay_ms_(MIN_POLL_DELAY_MS) {}
+
 void AsyncRunner::Begin() {
   KJ_ASSERT(count_ != std::numeric_limits<decltype(count_)>::max());
-  if (count_++ == 0) {
-    QueueTick();
+  count_++;
+  if (delay_ms_ > MIN_POLL_DELAY_MS) {
+    // Freshly submitted work tends to finish soon; don't leave it waiting on a backed-off poll.
+    KJ_IF_SOME(id, queued_tick_) {
+      IoContext::current().clearTimeoutImpl(id);
+      queued_tick_ = kj::none;
+    }
   }
+  delay_ms_ = MIN_POLL_DELAY_MS;
+  QueueTick();
 }
 
 void AsyncRunner::End() {
   KJ_ASSERT(count_ > 0);
   count_--;
+  completed_++;
 }
 
 void AsyncRunner::QueueTick() {
-  if (tick_queued_) {
+  if (queued_tick_ != kj::none) {
     return;
   }
-  tick_queued_ = true;
 
-  IoContext::current().setTimeoutImpl(timeoutIdGenerator, false, [this](jsg::Lock& js) mutable {
-    this->tick_queued_ = false;
-    if (this->count_ > 0) {
-      this->instance_.ProcessEvents();
-      QueueTick();
-    }
-  }, BUSY_LOOP_DELAY_MS);
+  queued_tick_ = IoContext::current().setTimeoutImpl(
+      timeoutIdGenerator, false, [this](jsg::Lock& js) mutable { this->Tick(); }, delay_ms_);
+}
+
+void AsyncRunner::Tick() {
+  queued_tick_ = kj::none;
+  if (count_ == 0) {
+    return;
+  }
+
+  auto completedBefore = completed_;
+  instance_.ProcessEvents();
+  if (completed_ != completedBefore) {
+    delay_ms_ = MIN_POLL_DELAY_MS;
+  } else {
+    delay_ms_ = kj::min(delay_ms_ * 2, MAX_POLL_DELAY_MS);
+  }
+
+  if (count_ > 0) {
+    QueueTick();
+  }
 }
 
 }  // namespace workerd::api::gpu
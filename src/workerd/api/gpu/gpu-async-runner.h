@@ -16,15 +16,21 @@ namespace workerd::api::gpu {
 
 // AsyncRunner is used to poll a wgpu::Instance with calls to ProcessEvents() while there
 // are asynchronous tasks in flight.
+//
+// Dawn only delivers AllowProcessEvents callbacks from ProcessEvents() on the calling thread, so
+// we can't simply block on the GPU from another thread. Instead the polling interval adapts: it
+// starts short whenever new work begins or a poll completes something, and backs off towards
+// MAX_POLL_DELAY_MS while long-running work is outstanding.
 class AsyncRunner: public kj::Refcounted {
  public:
-  AsyncRunner(wgpu::Instance instance): instance_(instance) {};
+  AsyncRunner(wgpu::Instance instance);
 
   // Begin() should be called when a new asynchronous task is started.
   // If the number of executing asynchronous tasks transitions from 0 to 1, then
   // a function will be scheduled on the main JavaScript thread to call
   // wgpu::Instance::ProcessEvents() whenever the thread is idle. This will be repeatedly
-  // called until the number of executing asynchronous tasks reaches 0 again.
+  // called until the number of executing asynchronous tasks reaches 0 again. If a poll is
+  // already scheduled but has backed off, it is brought forward to the minimum delay.
   void Begin();
 
   // End() should be called once the asynchronous task has finished.
@@ -33,9 +39,14 @@ class AsyncRunner: public kj::Refcounted {
 
  private:
   void QueueTick();
+  void Tick();
   wgpu::Instance const instance_;
   uint64_t count_ = 0;
-  bool tick_queued_ = false;
+  // Number of tasks that have ended so far, used to tell whether a ProcessEvents() call
+  // completed anything.
+  uint64_t completed_ = 0;
+  kj::Maybe<TimeoutId> queued_tick_;
+  double delay_ms_;
   TimeoutId::Generator timeoutIdGenerator;
 };
 
@@ -42,6 +42,8 @@ v8::Local<v8::ArrayBuffer> GPUBuffer::getMappedRange(
     }
   }
 
+  // The returned ArrayBuffer is backed directly by Dawn's mapping (no staging copy is made), and
+  // is detached on unmap() or destroy() so JavaScript can't touch the memory afterwards.
   auto* ptr = (desc_.usage & wgpu::BufferUsage::MapWrite)
       ? buffer_.GetMappedRange(o, s)
       : const_cast<void*>(buffer_.GetConstMappedRange(o, s));
@@ -257,6 +257,8 @@ jsg::Ref<GPUShaderModule> GPUDevice::createShaderModule(GPUShaderModuleDescripto
 
   wgsl_desc.code = descriptor.code.cStr();
 
+  // Dawn deduplicates shader modules and pipelines by content per device, so creating the same
+  // module again on this device reuses the earlier compilation rather than recompiling.
   auto shader = device_.CreateShaderModule(&desc);
   return jsg::alloc<GPUShaderModule>(kj::mv(shader), kj::addRef(*async_));
 }
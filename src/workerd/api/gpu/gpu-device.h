@@ -50,6 +50,7 @@ class GPUDevice: public EventTarget {
     JSG_METHOD(createShaderModule);
     JSG_METHOD(createPipelineLayout);
     JSG_METHOD(createComputePipeline);
+    JSG_METHOD(createComputePipelineAsync);
     JSG_METHOD(createRenderPipeline);
     JSG_METHOD(createCommandEncoder);
     JSG_METHOD(createTexture);
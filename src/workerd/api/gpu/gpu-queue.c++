@@ -45,6 +45,8 @@ void GPUQueue::writeBuffer(jsg::Ref<GPUBuffer> buffer,
   }
 
   KJ_ASSERT(dataSize <= std::numeric_limits<size_t>::max());
+  // Hand Dawn the JS backing store directly; WriteBuffer() copies synchronously into its own
+  // upload ring, so no intermediate copy or pinning beyond this call is necessary.
   queue_.WriteBuffer(buf, bufferOffset, dataPtr, static_cast<size_t>(dataSize));
 }
 
@@ -205,6 +205,17 @@ export class DurableObjectExample {
     });
     ok(computePipelineAuto);
 
+    // Pipeline compiled asynchronously
+    const computePipelineAsync = await device.createComputePipelineAsync({
+      layout: 'auto',
+      compute: {
+        module: shaderModule,
+        entryPoint: 'main',
+      },
+    });
+    ok(computePipelineAsync);
+    ok(computePipelineAsync.getBindGroupLayout(0 /* index */));
+
     // bind group with inferred layout
     const bindGroupAutoLayout = device.createBindGroup({
       layout: computePipelineAuto.getBindGroupLayout(0 /* index */),
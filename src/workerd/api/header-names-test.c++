@@ -0,0 +1,40 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "header-names.h"
+
+#include <kj/test.h>
+
+namespace workerd::api {
+namespace {
+
+KJ_TEST("findCommonHeaderName finds every common name, in any case") {
+  for (auto id: kj::zeroTo(COMMON_HEADER_NAME_COUNT)) {
+    auto name = getCommonHeaderName(id);
+    KJ_EXPECT(findCommonHeaderName(name) == kj::Maybe<uint>(id), name);
+
+    auto upper = kj::heapString(name);
+    for (char& c: upper) {
+      if (c >= 'a' && c <= 'z') c -= 'a' - 'A';
+    }
+    KJ_EXPECT(findCommonHeaderName(upper) == kj::Maybe<uint>(id), upper);
+
+    if (id > 0) {
+      KJ_EXPECT(getCommonHeaderName(id - 1) < name, name);
+    }
+  }
+
+  KJ_EXPECT(findCommonHeaderName("Content-Type"_kj) != kj::none);
+  KJ_EXPECT(findCommonHeaderName("set-cookie"_kj) != kj::none);
+}
+
+KJ_TEST("findCommonHeaderName rejects other names") {
+  for (auto name: {""_kj, "x-custom"_kj, "content-typ"_kj, "content-types"_kj, "acceptx"_kj,
+         "content_type"_kj, "set-cookie2"_kj}) {
+    KJ_EXPECT(findCommonHeaderName(name) == kj::none, name);
+  }
+}
+
+}  // namespace
+}  // namespace workerd::api
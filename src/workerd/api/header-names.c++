@@ -0,0 +1,243 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "header-names.h"
+
+#include <string_view>
+
+namespace workerd::api {
+
+namespace {
+
+// Must stay sorted and lower-case; see the static_asserts below.
+constexpr std::string_view NAMES[] = {
+  "accept",
+  "accept-charset",
+  "accept-encoding",
+  "accept-language",
+  "accept-patch",
+  "accept-post",
+  "accept-ranges",
+  "access-control-allow-credentials",
+  "access-control-allow-headers",
+  "access-control-allow-methods",
+  "access-control-allow-origin",
+  "access-control-expose-headers",
+  "access-control-max-age",
+  "access-control-request-headers",
+  "access-control-request-method",
+  "age",
+  "allow",
+  "alt-svc",
+  "authorization",
+  "cache-control",
+  "cdn-cache-control",
+  "cdn-loop",
+  "cf-cache-status",
+  "cf-connecting-ip",
+  "cf-ipcountry",
+  "cf-ray",
+  "cf-visitor",
+  "clear-site-data",
+  "connection",
+  "content-disposition",
+  "content-encoding",
+  "content-language",
+  "content-length",
+  "content-location",
+  "content-range",
+  "content-security-policy",
+  "content-security-policy-report-only",
+  "content-type",
+  "cookie",
+  "cross-origin-embedder-policy",
+  "cross-origin-opener-policy",
+  "cross-origin-resource-policy",
+  "date",
+  "dnt",
+  "early-data",
+  "etag",
+  "expect",
+  "expires",
+  "forwarded",
+  "from",
+  "host",
+  "if-match",
+  "if-modified-since",
+  "if-none-match",
+  "if-range",
+  "if-unmodified-since",
+  "keep-alive",
+  "last-modified",
+  "link",
+  "location",
+  "max-forwards",
+  "nel",
+  "origin",
+  "permissions-policy",
+  "pragma",
+  "priority",
+  "proxy-authenticate",
+  "proxy-authorization",
+  "range",
+  "referer",
+  "referrer-policy",
+  "refresh",
+  "report-to",
+  "retry-after",
+  "sec-ch-ua",
+  "sec-ch-ua-mobile",
+  "sec-ch-ua-platform",
+  "sec-fetch-dest",
+  "sec-fetch-mode",
+  "sec-fetch-site",
+  "sec-fetch-user",
+  "sec-websocket-accept",
+  "sec-websocket-extensions",
+  "sec-websocket-key",
+  "sec-websocket-protocol",
+  "sec-websocket-version",
+  "server",
+  "server-timing",
+  "set-cookie",
+  "strict-transport-security",
+  "te",
+  "timing-allow-origin",
+  "trailer",
+  "transfer-encoding",
+  "upgrade",
+  "upgrade-insecure-requests",
+  "user-agent",
+  "vary",
+  "via",
+  "www-authenticate",
+  "x-content-type-options",
+  "x-forwarded-for",
+  "x-forwarded-host",
+  "x-forwarded-proto",
+  "x-frame-options",
+  "x-real-ip",
+  "x-requested-with",
+  "x-xss-protection",
+};
+
+static_assert(kj::size(NAMES) == COMMON_HEADER_NAME_COUNT);
+
+constexpr bool namesAreSortedLowerCase() {
+  for (uint i = 0; i < kj::size(NAMES); i++) {
+    for (char c: NAMES[i]) {
+      if (c >= 'A' && c <= 'Z') return false;
+    }
+    if (i > 0 && !(NAMES[i - 1] < NAMES[i])) return false;
+  }
+  return true;
+}
+static_assert(namesAreSortedLowerCase());
+
+// The perfect hash is a "hash and displace" scheme: a name's hash picks a bucket, and the bucket's
+// displacement, chosen at compile time so that no two names collide, picks the name's slot.
+constexpr uint BUCKET_COUNT = 64;
+constexpr uint TABLE_SIZE = 256;
+constexpr kj::byte EMPTY = 0xff;
+static_assert(COMMON_HEADER_NAME_COUNT < EMPTY);
+
+// FNV-1a over the lower-cased name.
+constexpr uint32_t hashName(const char* chars, size_t size) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < size; i++) {
+    char c = chars[i];
+    if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+    hash ^= static_cast<kj::byte>(c);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+constexpr uint slotFor(uint32_t hash, uint32_t displacement) {
+  // MurmurHash3's finalizer, so that each displacement scatters the names differently.
+  uint32_t h = hash + displacement * 0x9e3779b9u;
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35u;
+  h ^= h >> 16;
+  return h % TABLE_SIZE;
+}
+
+struct PerfectHash {
+  uint32_t displacements[BUCKET_COUNT] = {};
+  kj::byte slots[TABLE_SIZE] = {};
+};
+
+constexpr PerfectHash buildPerfectHash() {
+  PerfectHash result;
+  for (auto& slot: result.slots) slot = EMPTY;
+
+  uint32_t hashes[COMMON_HEADER_NAME_COUNT] = {};
+  uint bucketSizes[BUCKET_COUNT] = {};
+  for (uint i = 0; i < COMMON_HEADER_NAME_COUNT; i++) {
+    hashes[i] = hashName(NAMES[i].data(), NAMES[i].size());
+    ++bucketSizes[hashes[i] % BUCKET_COUNT];
+  }
+
+  // Place the fullest buckets first, while the table is emptiest.
+  for (uint size = COMMON_HEADER_NAME_COUNT; size > 0; size--) {
+    for (uint bucket = 0; bucket < BUCKET_COUNT; bucket++) {
+      if (bucketSizes[bucket] != size) continue;
+
+      for (uint32_t displacement = 0;; displacement++) {
+        bool fits = true;
+        for (uint i = 0; i < COMMON_HEADER_NAME_COUNT && fits; i++) {
+          if (hashes[i] % BUCKET_COUNT != bucket) continue;
+          auto& slot = result.slots[slotFor(hashes[i], displacement)];
+          if (slot == EMPTY) {
+            slot = i;
+          } else {
+            fits = false;
+          }
+        }
+        if (fits) {
+          result.displacements[bucket] = displacement;
+          break;
+        }
+
+        // Take back whatever this displacement placed before it collided.
+        for (uint i = 0; i < COMMON_HEADER_NAME_COUNT; i++) {
+          if (hashes[i] % BUCKET_COUNT != bucket) continue;
+          auto& slot = result.slots[slotFor(hashes[i], displacement)];
+          if (slot == i) slot = EMPTY;
+        }
+      }
+    }
+  }
+  return result;
+}
+
+constexpr PerfectHash PERFECT_HASH = buildPerfectHash();
+
+}  // namespace
+
+kj::Maybe<uint> findCommonHeaderName(kj::ArrayPtr<const char> name) {
+  auto hash = hashName(name.begin(), name.size());
+  auto displacement = PERFECT_HASH.displacements[hash % BUCKET_COUNT];
+  auto id = PERFECT_HASH.slots[slotFor(hash, displacement)];
+  if (id == EMPTY) return kj::none;
+
+  auto expected = NAMES[id];
+  if (expected.size() != name.size()) return kj::none;
+  for (auto i: kj::indices(name)) {
+    char c = name[i];
+    if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+    if (c != expected[i]) return kj::none;
+  }
+  return uint(id);
+}
+
+kj::StringPtr getCommonHeaderName(uint id) {
+  KJ_IREQUIRE(id < COMMON_HEADER_NAME_COUNT);
+  // The names are string literals, so they're NUL-terminated.
+  return kj::StringPtr(NAMES[id].data(), NAMES[id].size());
+}
+
+}  // namespace workerd::api
@@ -0,0 +1,25 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <kj/common.h>
+#include <kj/string.h>
+
+namespace workerd::api {
+
+// The number of header names that the Headers class recognizes as common, and looks up by a
+// small integer id rather than by comparing strings. Ids are assigned in the names' sort order, so
+// comparing the ids of two common names compares the names.
+constexpr uint COMMON_HEADER_NAME_COUNT = 108;
+
+// Returns the id of `name` if it is a common header name, compared case-insensitively. Uses a
+// perfect hash built at compile time, so it takes one pass over `name` and at most one string
+// comparison, and never allocates.
+kj::Maybe<uint> findCommonHeaderName(kj::ArrayPtr<const char> name);
+
+// Returns the lower-case name for an id returned by findCommonHeaderName().
+kj::StringPtr getCommonHeaderName(uint id);
+
+}  // namespace workerd::api
@@ -168,8 +168,16 @@ namespace {
 // Rewriter
 using ElementCallbackFunction = HTMLRewriter::ElementCallbackFunction;
 
-struct UnregisteredElementHandlers {
+// A parsed selector. Builders reference it for as long as they live, which may be longer than
+// the HTMLRewriter that parsed it.
+struct SharedSelector final: public kj::Refcounted {
+  explicit SharedSelector(kj::Own<lol_html_Selector> selector): selector(kj::mv(selector)) {}
+
   kj::Own<lol_html_Selector> selector;
+};
+
+struct UnregisteredElementHandlers {
+  kj::Own<SharedSelector> selector;
 
   // The actual handler functions. We store them as jsg::Values for compatibility with GcVisitor.
 
@@ -214,17 +222,67 @@ struct UnregisteredDocumentHandlers {
 using UnregisteredElementOrDocumentHandlers =
     kj::OneOf<UnregisteredElementHandlers, UnregisteredDocumentHandlers>;
 
+// An HTMLRewriter's handlers, registered on a lol-html builder. Every Rewriter is built from the
+// same builder until on() or onDocument() adds another handler, so a rewriter with many selectors
+// doesn't register them all again on each transform(). Rewriters keep a reference, since they can
+// outlive their HTMLRewriter.
+//
+// The builder doesn't hold the handler functions themselves: those would keep the HTMLRewriter
+// alive from outside the GC graph for as long as it exists. Instead, each handler's userdata is its
+// index in the array returned by collectCallbacks(), of which each Rewriter has its own.
+struct CompiledHandlers final: public kj::Refcounted {
+  // The selectors that `builder` refers to.
+  kj::Vector<kj::Own<SharedSelector>> selectors;
+
+  // Declared last, so that it's destroyed before the selectors.
+  kj::Own<lol_html_HtmlRewriterBuilder> builder;
+};
+
+// Takes a reference to each handler function, in the order in which compileHandlers() registers
+// them.
+kj::Array<ElementCallbackFunction> collectCallbacks(
+    jsg::Lock& js, kj::ArrayPtr<UnregisteredElementOrDocumentHandlers> unregisteredHandlers) {
+  kj::Vector<ElementCallbackFunction> result;
+  auto add = [&](jsg::Optional<ElementCallbackFunction>& callback) {
+    KJ_IF_SOME(c, callback) {
+      result.add(c.addRef(js));
+    }
+  };
+  for (auto& handlers: unregisteredHandlers) {
+    KJ_SWITCH_ONEOF(handlers) {
+      KJ_CASE_ONEOF(elementHandlers, UnregisteredElementHandlers) {
+        add(elementHandlers.element);
+        add(elementHandlers.comments);
+        add(elementHandlers.text);
+      }
+      KJ_CASE_ONEOF(documentHandlers, UnregisteredDocumentHandlers) {
+        add(documentHandlers.doctype);
+        add(documentHandlers.comments);
+        add(documentHandlers.text);
+        add(documentHandlers.end);
+      }
+    }
+  }
+  return result.releaseAsArray();
+}
+
 }  // namespace
 
 // Wrapper around an actual rewriter (streaming parser).
 class Rewriter final: public WritableStreamSink {
  public:
   explicit Rewriter(jsg::Lock& js,
-      kj::ArrayPtr<UnregisteredElementOrDocumentHandlers> unregisteredHandlers,
+      kj::Own<CompiledHandlers> handlers,
+      kj::Array<ElementCallbackFunction> callbacks,
       kj::ArrayPtr<const char> encoding,
-      kj::Own<WritableStreamSink> inner);
+      kj::Own<WritableStreamSink> inner,
+      uint32_t outputChunkSize);
   KJ_DISALLOW_COPY_AND_MOVE(Rewriter);
 
+  // Registers `unregisteredHandlers` on a new builder.
+  static kj::Own<CompiledHandlers> compileHandlers(
+      kj::ArrayPtr<UnregisteredElementOrDocumentHandlers> unregisteredHandlers);
+
   // WritableStreamSink implementation. The input body pumpTo() operation calls these.
   kj::Promise<void> write(kj::ArrayPtr<const byte> buffer) override;
   kj::Promise<void> write(kj::ArrayPtr<const kj::ArrayPtr<const byte>> pieces) override;
@@ -241,13 +299,17 @@ class Rewriter final: public WritableStreamSink {
   kj::Promise<void> finishWrite();
 
   static kj::Own<lol_html_HtmlRewriter> buildRewriter(jsg::Lock& js,
-      kj::ArrayPtr<UnregisteredElementOrDocumentHandlers> unregisteredHandlers,
+      CompiledHandlers& handlers,
       kj::ArrayPtr<const char> encoding,
       Rewriter& rewriterWrapper);
 
   static void output(const char* buffer, size_t size, void* userdata);
   void outputImpl(kj::ArrayPtr<const byte> buffer);
 
+  // Writes out the output held back for `outputChunkSize`.
+  void flushOutput();
+  void queueWrite(kj::Array<byte> buffer);
+
   void tryHandleCancellation(int rc) {
     if (canceled) {
       canceled = false;
@@ -269,33 +331,74 @@ class Rewriter final: public WritableStreamSink {
     // A back-reference to the rewriter which owns this particular registered handler.
     Rewriter& rewriter;
 
-    ElementCallbackFunction callback;
+    // Null once the handler has been released back to the arena.
+    kj::Maybe<ElementCallbackFunction> callback;
+
+    // Next released handler, while this one is on the arena's free list.
+    RegisteredHandler* nextFree = nullptr;
+  };
+
+  // Stable-address storage for RegisteredHandlers. We pass raw pointers to these as the userdata
+  // parameter to lol-html, so they must never move once registered, but we don't know how many
+  // there will be up front. Handlers are allocated in fixed-size chunks that are never
+  // reallocated, and are all freed together when the Rewriter is destroyed. End tag handlers that
+  // have run are released early onto a free list, so a document with an onEndTag() per element
+  // cycles through a few slots rather than allocating for every element.
+  class HandlerArena {
+   public:
+    RegisteredHandler& add(Rewriter& rewriter, ElementCallbackFunction callback) {
+      if (freeList != nullptr) {
+        auto& handler = *freeList;
+        freeList = handler.nextFree;
+        handler.nextFree = nullptr;
+        handler.callback = kj::mv(callback);
+        return handler;
+      }
+      if (chunks.empty() || chunks.back().isFull()) {
+        chunks.add(kj::heapArrayBuilder<RegisteredHandler>(CHUNK_SIZE));
+      }
+      return chunks.back().add(RegisteredHandler{rewriter, kj::mv(callback)});
+    }
+
+    // Drops `handler`'s callback and makes its slot available for reuse. Should only be called if
+    // we're confident the handler will never be used again.
+    void release(RegisteredHandler& handler) {
+      handler.callback = kj::none;
+      handler.nextFree = freeList;
+      freeList = &handler;
+    }
+
+   private:
+    static constexpr size_t CHUNK_SIZE = 32;
+
+    kj::Vector<kj::ArrayBuilder<RegisteredHandler>> chunks;
+    RegisteredHandler* freeList = nullptr;
   };
 
-  kj::Vector<kj::Own<RegisteredHandler>> registeredHandlers;
-  // TODO(perf): Don't store Owns. We need to pass stable pointers as the userdata parameter to
-  //   lol_html_rewriter_builder_add_*_content_handlers(), but don't have a really easy way to
-  //   know precisely how many handlers we're going to register beforehand, so we need a vector. But
-  //   vectors can grow, moving their objects around, invalidating pointers into their storage.
+  HandlerArena registeredHandlers;
 
-  // This is separate from `registeredHandlers` so we can delete them more eagerly when EndTags are
-  // destroyed, and not have to look through all other handlers.
-  kj::Vector<kj::Own<RegisteredHandler>> registeredEndTagHandlers;
-  // TODO(perf) Don't store Owns, same as `registeredHandlers` above.
+  // The handlers registered on the builder are shared by all the Rewriters built from it, so they
+  // can't tell which Rewriter they're called for. lol-html only calls them from inside our calls to
+  // lol_html_rewriter_write() and lol_html_rewriter_end(), so we point this at the Rewriter that
+  // made the call before making it, and again whenever a handler resumes after waiting, since
+  // other Rewriters may have run in the meantime.
+  static thread_local Rewriter* current;
 
   template <typename T, typename CType = typename T::CType>
   static lol_html_rewriter_directive_t thunk(CType* content, void* userdata);
   template <typename T, typename CType = typename T::CType>
-  lol_html_rewriter_directive_t thunkImpl(CType* content, RegisteredHandler& registration);
+  lol_html_rewriter_directive_t thunkImpl(CType* content,
+      ElementCallbackFunction& callback,
+      kj::Maybe<RegisteredHandler&> endTagRegistration);
   template <typename T, typename CType = typename T::CType>
-  kj::Promise<void> thunkPromise(CType* content, RegisteredHandler& registration);
+  kj::Promise<void> thunkPromise(CType* content,
+      ElementCallbackFunction& callback,
+      kj::Maybe<RegisteredHandler&> endTagRegistration);
 
-  // Eagerly free this handler. Should only be called if we're confident the handler will never be
-  // used again.
-  void removeEndTagHandler(RegisteredHandler& registration);
+  // Must be constructed BEFORE the rewriter, which is built from it.
+  kj::Own<CompiledHandlers> handlers;
+  kj::Array<ElementCallbackFunction> callbacks;
 
-  // Must be constructed AFTER the registered handler vector, since the function which constructs
-  // this (buildRewriter()) modifies that vector.
   kj::Own<lol_html_HtmlRewriter> rewriter;
 
   kj::Own<WritableStreamSink> inner;
@@ -312,6 +415,9 @@ class Rewriter final: public WritableStreamSink {
 
   kj::Maybe<jsg::Ref<jsg::AsyncContextFrame>> maybeAsyncContext;
 
+  uint32_t outputChunkSize;
+  kj::Vector<byte> pendingOutput;
+
   bool isPoisoned() {
     // If a call to `lol-html` returned an error or propagated a user error from a handler
     // (LOL_HTML_STOP for instance); we consider its instance as poisoned. Future calls to
@@ -328,15 +434,16 @@ class Rewriter final: public WritableStreamSink {
   }
 };
 
-kj::Own<lol_html_HtmlRewriter> Rewriter::buildRewriter(jsg::Lock& js,
-    kj::ArrayPtr<UnregisteredElementOrDocumentHandlers> unregisteredHandlers,
-    kj::ArrayPtr<const char> encoding,
-    Rewriter& rewriter) {
-  auto builder = LOL_HTML_OWN(rewriter_builder, lol_html_rewriter_builder_new());
+kj::Own<CompiledHandlers> Rewriter::compileHandlers(
+    kj::ArrayPtr<UnregisteredElementOrDocumentHandlers> unregisteredHandlers) {
+  auto result = kj::refcounted<CompiledHandlers>();
+  result->builder = LOL_HTML_OWN(rewriter_builder, lol_html_rewriter_builder_new());
+  auto& builder = *result->builder;
 
-  auto registerCallback = [&](ElementCallbackFunction& callback) {
-    auto registeredHandler = RegisteredHandler{rewriter, callback.addRef(js)};
-    return rewriter.registeredHandlers.add(kj::heap(kj::mv(registeredHandler))).get();
+  // The userdata of each handler is its index in collectCallbacks()'s array.
+  uintptr_t index = 0;
+  auto registerCallback = [&](ElementCallbackFunction&) {
+    return reinterpret_cast<void*>(index++);
   };
 
   for (auto& handlers: unregisteredHandlers) {
@@ -346,11 +453,13 @@ kj::Own<lol_html_HtmlRewriter> Rewriter::buildRewriter(jsg::Lock& js,
         auto comments = elementHandlers.comments.map(registerCallback);
         auto text = elementHandlers.text.map(registerCallback);
 
-        check(lol_html_rewriter_builder_add_element_content_handlers(builder,
-            elementHandlers.selector, element == kj::none ? nullptr : &Rewriter::thunk<Element>,
-            element.orDefault(nullptr), comments == kj::none ? nullptr : &Rewriter::thunk<Comment>,
+        check(lol_html_rewriter_builder_add_element_content_handlers(&builder,
+            elementHandlers.selector->selector,
+            element == kj::none ? nullptr : &Rewriter::thunk<Element>, element.orDefault(nullptr),
+            comments == kj::none ? nullptr : &Rewriter::thunk<Comment>,
             comments.orDefault(nullptr), text == kj::none ? nullptr : &Rewriter::thunk<Text>,
             text.orDefault(nullptr)));
+        result->selectors.add(kj::addRef(*elementHandlers.selector));
       }
       KJ_CASE_ONEOF(documentHandlers, UnregisteredDocumentHandlers) {
         auto doctype = documentHandlers.doctype.map(registerCallback);
@@ -359,7 +468,7 @@ kj::Own<lol_html_HtmlRewriter> Rewriter::buildRewriter(jsg::Lock& js,
         auto end = documentHandlers.end.map(registerCallback);
 
         // Adding document content handlers cannot fail, so no need for check().
-        lol_html_rewriter_builder_add_document_content_handlers(builder,
+        lol_html_rewriter_builder_add_document_content_handlers(&builder,
             doctype == kj::none ? nullptr : &Rewriter::thunk<Doctype>, doctype.orDefault(nullptr),
             comments == kj::none ? nullptr : &Rewriter::thunk<Comment>, comments.orDefault(nullptr),
             text == kj::none ? nullptr : &Rewriter::thunk<Text>, text.orDefault(nullptr),
@@ -368,6 +477,15 @@ kj::Own<lol_html_HtmlRewriter> Rewriter::buildRewriter(jsg::Lock& js,
     }
   }
 
+  return result;
+}
+
+kj::Own<lol_html_HtmlRewriter> Rewriter::buildRewriter(jsg::Lock& js,
+    CompiledHandlers& handlers,
+    kj::ArrayPtr<const char> encoding,
+    Rewriter& rewriter) {
+  auto& builder = *handlers.builder;
+
   // `strict` mode will bail out from tokenization process in cases when
   // there is no way to determine correct parsing context. Recommended
   // setting for safety reasons.
@@ -380,24 +498,31 @@ kj::Own<lol_html_HtmlRewriter> Rewriter::buildRewriter(jsg::Lock& js,
 
   if (FeatureFlags::get(js).getEsiIncludeIsVoidTag()) {
     return LOL_HTML_OWN(rewriter,
-        unstable_lol_html_rewriter_build_with_esi_tags(builder, encoding.begin(), encoding.size(),
+        unstable_lol_html_rewriter_build_with_esi_tags(&builder, encoding.begin(), encoding.size(),
             memorySettings, &Rewriter::output, &rewriter, isStrict));
 
   } else {
     return LOL_HTML_OWN(rewriter,
-        lol_html_rewriter_build(builder, encoding.begin(), encoding.size(), memorySettings,
+        lol_html_rewriter_build(&builder, encoding.begin(), encoding.size(), memorySettings,
             &Rewriter::output, &rewriter, isStrict));
   }
 }
 
 Rewriter::Rewriter(jsg::Lock& js,
-    kj::ArrayPtr<UnregisteredElementOrDocumentHandlers> unregisteredHandlers,
+    kj::Own<CompiledHandlers> handlersParam,
+    kj::Array<ElementCallbackFunction> callbacks,
     kj::ArrayPtr<const char> encoding,
-    kj::Own<WritableStreamSink> inner)
-    : rewriter(buildRewriter(js, unregisteredHandlers, encoding, *this)),
+    kj::Own<WritableStreamSink> inner,
+    uint32_t outputChunkSize)
+    : handlers(kj::mv(handlersParam)),
+      callbacks(kj::mv(callbacks)),
+      rewriter(buildRewriter(js, *handlers, encoding, *this)),
       inner(kj::mv(inner)),
       ioContext(IoContext::current()),
-      maybeAsyncContext(jsg::AsyncContextFrame::currentRef(js)) {}
+      maybeAsyncContext(jsg::AsyncContextFrame::currentRef(js)),
+      outputChunkSize(outputChunkSize) {}
+
+thread_local Rewriter* Rewriter::current = nullptr;
 
 namespace {
 
@@ -417,6 +542,7 @@ kj::Promise<void> Rewriter::write(kj::ArrayPtr<const byte> buffer) {
   return getFiberPool().startFiber([this, buffer](kj::WaitScope& scope) {
     maybeWaitScope = scope;
     if (!isPoisoned()) {
+      current = this;
       // Cannot use `check()` because `finishWrite()` implements the error path.
       auto rc = lol_html_rewriter_write(rewriter, buffer.asChars().begin(), buffer.size());
       tryHandleCancellation(rc);
@@ -433,6 +559,7 @@ kj::Promise<void> Rewriter::write(kj::ArrayPtr<const kj::ArrayPtr<const byte>> p
   return getFiberPool().startFiber([this, pieces](kj::WaitScope& scope) {
     maybeWaitScope = scope;
     if (!isPoisoned()) {
+      current = this;
       for (auto bytes: pieces) {
         auto chars = bytes.asChars();
         // Cannot use `check()` because `finishWrite()` implements the error path.
@@ -454,11 +581,14 @@ kj::Promise<void> Rewriter::end() {
   return getFiberPool().startFiber([this](kj::WaitScope& scope) {
     maybeWaitScope = scope;
     if (!isPoisoned()) {
+      current = this;
       // Cannot use `check()` because `finishWrite()` implements the error path.
       auto rc = lol_html_rewriter_end(rewriter);
       tryHandleCancellation(rc);
       if (rc == -1) {
         maybePoison(getLastError());
+      } else {
+        flushOutput();
       }
     }
     return finishWrite().then([this]() { return inner->end(); });
@@ -495,13 +625,25 @@ kj::Promise<void> Rewriter::finishWrite() {
 
 template <typename T, typename CType>
 lol_html_rewriter_directive_t Rewriter::thunk(CType* content, void* userdata) {
-  auto& registration = *reinterpret_cast<RegisteredHandler*>(userdata);
-  return registration.rewriter.thunkImpl<T>(content, registration);
+  if constexpr (kj::isSameType<T, EndTag>()) {
+    // End tag handlers are added to the element by the Rewriter that's running.
+    auto& registration = *reinterpret_cast<RegisteredHandler*>(userdata);
+    return registration.rewriter.thunkImpl<T>(
+        content, KJ_ASSERT_NONNULL(registration.callback), registration);
+  } else {
+    auto& rewriter = KJ_ASSERT_NONNULL(current);
+    auto& callback = rewriter.callbacks[reinterpret_cast<uintptr_t>(userdata)];
+    return rewriter.thunkImpl<T>(content, callback, kj::none);
+  }
 }
 
 template <typename T, typename CType>
-lol_html_rewriter_directive_t Rewriter::thunkImpl(
-    CType* content, RegisteredHandler& registeredHandler) {
+lol_html_rewriter_directive_t Rewriter::thunkImpl(CType* content,
+    ElementCallbackFunction& callback,
+    kj::Maybe<RegisteredHandler&> endTagRegistration) {
+  // Other Rewriters may run while the handler waits.
+  KJ_DEFER(current = this);
+
   if (isPoisoned()) {
     // Handlers disabled due to exception.
     KJ_LOG(ERROR, "poisoned rewriter should not be able to call handlers");
@@ -515,7 +657,8 @@ lol_html_rewriter_directive_t Rewriter::thunkImpl(
       // here, we're in an entirely different stack that V8 doesn't know about, so it gets confused
       // and may think we've overflowed our stack. evalLater will run thunkPromise on the main stack
       // to keep V8 from getting confused.
-      auto promise = kj::evalLater([&]() { return thunkPromise<T>(content, registeredHandler); });
+      auto promise = kj::evalLater(
+          [&]() { return thunkPromise<T>(content, callback, endTagRegistration); });
       promise.wait(KJ_ASSERT_NONNULL(maybeWaitScope));
     })) {
       // Exception in handler. We need to abort the streaming parser, but can't do so just yet: we
@@ -537,25 +680,12 @@ lol_html_rewriter_directive_t Rewriter::thunkImpl(
   return LOL_HTML_CONTINUE;
 }
 
-void Rewriter::removeEndTagHandler(RegisteredHandler& handler) {
-  auto size = registeredEndTagHandlers.size();
-  for (auto counter = size; counter != 0; --counter) {
-    auto idx = counter - 1;
-    if (registeredEndTagHandlers[idx].get() == &handler) {
-      // equivalent of `Vec::swap_remove` in Rust
-      if (counter != size) {
-        registeredEndTagHandlers[idx] = kj::mv(registeredEndTagHandlers[size - 1]);
-      }
-      registeredEndTagHandlers.removeLast();
-      break;
-    }
-  }
-}
-
 template <typename T, typename CType>
-kj::Promise<void> Rewriter::thunkPromise(CType* content, RegisteredHandler& registeredHandler) {
-  return ioContext.run(
-      [this, content, &registeredHandler](Worker::Lock& lock) -> kj::Promise<void> {
+kj::Promise<void> Rewriter::thunkPromise(CType* content,
+    ElementCallbackFunction& callback,
+    kj::Maybe<RegisteredHandler&> endTagRegistration) {
+  return ioContext.run([this, content, &callback, endTagRegistration](
+                           Worker::Lock& lock) -> kj::Promise<void> {
     // We enter the AsyncContextFrame that was current when the Rewriter was created
     // (when transform() was called). If someone wants, instead, to use the context
     // that was current when on(...) is called, the ElementHandler can use AsyncResource
@@ -563,15 +693,15 @@ kj::Promise<void> Rewriter::thunkPromise(CType* content, RegisteredHandler& regi
     jsg::AsyncContextFrame::Scope asyncContextScope(lock, maybeAsyncContext);
     auto jsContent = jsg::alloc<T>(*content, *this);
     auto scope = HTMLRewriter::TokenScope(jsContent);
-    auto value = registeredHandler.callback(lock, kj::mv(jsContent));
+    auto value = callback(lock, kj::mv(jsContent));
 
     if constexpr (kj::isSameType<T, EndTag>()) {
-      // TODO(someday): We can't unconditionally pop the top of `registeredEndTagHandlers`,
+      // TODO(someday): We can't unconditionally pop the most recent end tag handler,
       //   because that depends on https://github.com/cloudflare/lol-html/issues/110
       //   being resolved. For now we let handles to end tag handlers tags live for the duration of
       //   the response transformation, but eagerly release ones that we can.
       //   In particular, note that `thunkPromise` is never called for implied end tags.
-      removeEndTagHandler(registeredHandler);
+      registeredHandlers.release(KJ_ASSERT_NONNULL(endTagRegistration));
     }
 
     return value.attach(kj::mv(scope));
@@ -579,8 +709,7 @@ kj::Promise<void> Rewriter::thunkPromise(CType* content, RegisteredHandler& regi
 }
 
 void Rewriter::onEndTag(lol_html_element_t* element, ElementCallbackFunction&& callback) {
-  auto registeredHandler = Rewriter::RegisteredHandler{*this, kj::mv(callback)};
-  // NOTE: this gets freed in `thunkPromise` above.
+  // NOTE: this gets released in `thunkPromise` above.
   // TODO(someday): this uses more memory than necessary for implied end tags, which lol-html
   // doesn't actually call `thunk` on.  LOL HTML drops the handler after it finishes transforming
   // the current element, but this code will keep it around until the entire HTML document is
@@ -589,10 +718,10 @@ void Rewriter::onEndTag(lol_html_element_t* element, ElementCallbackFunction&& c
   // this probably needs to happen in lol-html; see #110.
   // WARNING: if we ever start reusing the same Rewriter for multiple documents,
   // this will cause a memory leak!
-  auto& registeredHandlerPtr = registeredEndTagHandlers.add(kj::heap(kj::mv(registeredHandler)));
+  auto& registeredHandler = registeredHandlers.add(*this, kj::mv(callback));
   lol_html_element_clear_end_tag_handlers(element);
   check(lol_html_element_add_end_tag_handler(
-      element, Rewriter::thunk<EndTag>, registeredHandlerPtr.get()));
+      element, Rewriter::thunk<EndTag>, &registeredHandler));
 }
 
 void Rewriter::output(const char* buffer, size_t size, void* userdata) {
@@ -606,13 +735,31 @@ void Rewriter::outputImpl(kj::ArrayPtr<const byte> buffer) {
     return;
   }
 
-  auto bufferCopy = kj::heapArray(buffer);
+  if (outputChunkSize == 0) {
+    queueWrite(kj::heapArray(buffer));
+    return;
+  }
+
+  pendingOutput.addAll(buffer);
+  if (pendingOutput.size() >= outputChunkSize) {
+    flushOutput();
+  }
+}
+
+void Rewriter::flushOutput() {
+  if (pendingOutput.size() == 0) return;
+  auto chunk = pendingOutput.releaseAsArray();
+  pendingOutput.reserve(outputChunkSize);
+  queueWrite(kj::mv(chunk));
+}
+
+void Rewriter::queueWrite(kj::Array<byte> buffer) {
   KJ_IF_SOME(wp, writePromise) {
-    writePromise = wp.then([this, bufferCopy = kj::mv(bufferCopy)]() mutable {
-      return inner->write(bufferCopy.asPtr()).attach(kj::mv(bufferCopy));
+    writePromise = wp.then([this, buffer = kj::mv(buffer)]() mutable {
+      return inner->write(buffer.asPtr()).attach(kj::mv(buffer));
     });
   } else {
-    writePromise = inner->write(bufferCopy.asPtr()).attach(kj::mv(bufferCopy));
+    writePromise = inner->write(buffer.asPtr()).attach(kj::mv(buffer));
   }
 }
 
@@ -623,9 +770,9 @@ Element::Element(CType& element, Rewriter& rewriter) {
   impl.emplace(element, rewriter);
 }
 
-kj::String Element::getTagName() {
+jsg::JsString Element::getTagName(jsg::Lock& js) {
   auto tagName = LolString(lol_html_element_tag_name_get(&checkToken(impl).element));
-  return kj::str(tagName.asChars());
+  return js.str(tagName.asChars());
 }
 
 void Element::setTagName(kj::String name) {
@@ -651,15 +798,15 @@ jsg::Ref<Element::AttributesIterator> Element::getAttributes() {
   return kj::mv(jsIter);
 }
 
-kj::Maybe<kj::String> Element::getAttribute(kj::String name) {
+kj::Maybe<jsg::JsString> Element::getAttribute(jsg::Lock& js, kj::String name) {
   // NOTE: lol_html_element_get_attribute() returns NULL for both nonexistent attributes and for
   //   errors, so we can't use check() here.
   LolString attr(
       lol_html_element_get_attribute(&checkToken(impl).element, name.cStr(), name.size()));
-  // TODO(perf): We could construct a v8::String directly here, saving a copy.
-  kj::Maybe kjAttr = attr.asKjString();
-  if (kjAttr != kj::none) {
-    return kj::mv(kjAttr);
+  if (attr.asChars().begin() != nullptr) {
+    // Build the JS string straight from lol-html's buffer rather than copying into a kj::String
+    // first.
+    return js.str(attr.asChars());
   }
 
   KJ_IF_SOME(exception, tryGetLastError()) {
@@ -812,9 +959,9 @@ void Element::AttributesIterator::htmlContentScopeEnd() {
 
 Comment::Comment(CType& comment, Rewriter&): impl(comment) {}
 
-kj::String Comment::getText() {
+jsg::JsString Comment::getText(jsg::Lock& js) {
   auto text = LolString(lol_html_comment_text_get(&checkToken(impl)));
-  return kj::str(text.asChars());
+  return js.str(text.asChars());
 }
 
 void Comment::setText(kj::String text) {
@@ -865,9 +1012,11 @@ void Comment::htmlContentScopeEnd() {
 
 Text::Text(CType& text, Rewriter&): impl(text) {}
 
-kj::String Text::getText() {
+jsg::JsString Text::getText(jsg::Lock& js) {
+  // The chunk is only borrowed from lol-html for the duration of the handler, so it can't back an
+  // external string, but we can still decode it into V8 directly without an intermediate copy.
   auto content = lol_html_text_chunk_content_get(&checkToken(impl));
-  return kj::heapString(content.data, content.len);
+  return js.str(kj::arrayPtr(content.data, content.len));
 }
 
 bool Text::getLastInTextNode() {
@@ -961,14 +1110,14 @@ void DocumentEnd::htmlContentScopeEnd() {
 struct HTMLRewriter::Impl {
   // The list of handlers added to this builder.
   kj::Vector<UnregisteredElementOrDocumentHandlers> unregisteredHandlers;
-  // TODO(perf): It'd be nice to eagerly register handlers on the native builder object. However,
-  //   currently lol-html rewriters are inextricably linked to the builders which created them,
-  //   and this has concurrency and reentrancy ramifications: two rewriters built from the same
-  //   builder require synchronization to access safely, and their callbacks must not use the
-  //   builder which created them, lest the process deadlock.
-  //
-  //   In the meantime, we keep this list of handlers around and "replay" their registration, in
-  //   order, on the builder object that we create inside of .transform().
+
+  // The handlers registered on a native builder, in order, by the first transform() after they
+  // were added. Later transform() calls build their rewriters from the same builder. Rewriters
+  // don't touch the builder once they're built, so sharing it is safe; the handlers it calls find
+  // their Rewriter through Rewriter::current.
+  kj::Maybe<kj::Own<CompiledHandlers>> compiled;
+
+  uint32_t outputChunkSize = 0;
 
   JSG_MEMORY_INFO(HTMLRewriter::Impl) {
     for (const auto& handlers: unregisteredHandlers) {
@@ -984,15 +1133,23 @@ struct HTMLRewriter::Impl {
   }
 };
 
-HTMLRewriter::HTMLRewriter(): impl(kj::heap<Impl>()) {}
+HTMLRewriter::HTMLRewriter(uint32_t outputChunkSize): impl(kj::heap<Impl>()) {
+  impl->outputChunkSize = outputChunkSize;
+}
 HTMLRewriter::~HTMLRewriter() noexcept(false) {}
 
 void HTMLRewriter::visitForMemoryInfo(jsg::MemoryTracker& tracker) const {
   tracker.trackField("impl", impl);
 }
 
-jsg::Ref<HTMLRewriter> HTMLRewriter::constructor() {
-  return jsg::alloc<HTMLRewriter>();
+jsg::Ref<HTMLRewriter> HTMLRewriter::constructor(jsg::Optional<Options> options) {
+  uint32_t outputChunkSize = 0;
+  KJ_IF_SOME(o, options) {
+    outputChunkSize = o.outputChunkSize.orDefault(0);
+    JSG_REQUIRE(outputChunkSize <= MAX_OUTPUT_CHUNK_SIZE, RangeError,
+        "outputChunkSize must be at most ", MAX_OUTPUT_CHUNK_SIZE, " bytes.");
+  }
+  return jsg::alloc<HTMLRewriter>(outputChunkSize);
 }
 
 jsg::Ref<HTMLRewriter> HTMLRewriter::on(
@@ -1000,8 +1157,10 @@ jsg::Ref<HTMLRewriter> HTMLRewriter::on(
   kj::Own<lol_html_Selector> selector =
       LOL_HTML_OWN(selector, lol_html_selector_parse(stringSelector.cStr(), stringSelector.size()));
 
-  impl->unregisteredHandlers.add(UnregisteredElementHandlers{
-    kj::mv(selector), kj::mv(handlers.element), kj::mv(handlers.comments), kj::mv(handlers.text)});
+  impl->unregisteredHandlers.add(
+      UnregisteredElementHandlers{kj::refcounted<SharedSelector>(kj::mv(selector)),
+        kj::mv(handlers.element), kj::mv(handlers.comments), kj::mv(handlers.text)});
+  impl->compiled = kj::none;
 
   return JSG_THIS;
 }
@@ -1009,6 +1168,7 @@ jsg::Ref<HTMLRewriter> HTMLRewriter::on(
 jsg::Ref<HTMLRewriter> HTMLRewriter::onDocument(DocumentContentHandlers&& handlers) {
   impl->unregisteredHandlers.add(UnregisteredDocumentHandlers{kj::mv(handlers.doctype),
     kj::mv(handlers.comments), kj::mv(handlers.text), kj::mv(handlers.end)});
+  impl->compiled = kj::none;
 
   return JSG_THIS;
 }
@@ -1039,7 +1199,12 @@ jsg::Ref<Response> HTMLRewriter::transform(jsg::Lock& js, jsg::Ref<Response> res
     }
   }
 
-  auto rewriter = kj::heap<Rewriter>(js, impl->unregisteredHandlers, encoding, kj::mv(pipe.out));
+  if (impl->compiled == kj::none) {
+    impl->compiled = Rewriter::compileHandlers(impl->unregisteredHandlers);
+  }
+  auto rewriter = kj::heap<Rewriter>(js, kj::addRef(*KJ_ASSERT_NONNULL(impl->compiled)),
+      collectCallbacks(js, impl->unregisteredHandlers), encoding, kj::mv(pipe.out),
+      impl->outputChunkSize);
 
   // NOTE: Avoid throwing any exceptions after initiating the pump below. This makes
   //   the input response object disturbed (response.bodyUsed === true), which should only happen
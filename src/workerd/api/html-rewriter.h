@@ -40,11 +40,24 @@ class HTMLRewriter: public jsg::Object {
   class Token;
   class TokenScope;
 
-  explicit HTMLRewriter();
+  // The largest `outputChunkSize` that may be requested.
+  static constexpr uint32_t MAX_OUTPUT_CHUNK_SIZE = 1024 * 1024;
+
+  struct Options {
+    // If set, rewritten output is held back until this many bytes are ready (or the input ends),
+    // then written to the response body in one chunk. Larger chunks cost fewer writes downstream,
+    // at the expense of time to first byte. By default, output is written as soon as lol-html
+    // produces it.
+    jsg::Optional<uint32_t> outputChunkSize;
+
+    JSG_STRUCT(outputChunkSize);
+  };
+
+  explicit HTMLRewriter(uint32_t outputChunkSize = 0);
   ~HTMLRewriter() noexcept(false);
   KJ_DISALLOW_COPY_AND_MOVE(HTMLRewriter);
 
-  static jsg::Ref<HTMLRewriter> constructor();
+  static jsg::Ref<HTMLRewriter> constructor(jsg::Optional<Options> options);
 
   using ElementCallback = kj::Promise<void>(jsg::Ref<jsg::Object> element);
   using ElementCallbackFunction = jsg::Function<ElementCallback>;
@@ -163,7 +176,7 @@ class Element final: public HTMLRewriter::Token {
 
   explicit Element(CType& element, Rewriter& wrapper);
 
-  kj::String getTagName();
+  jsg::JsString getTagName(jsg::Lock& js);
   void setTagName(kj::String tagName);
 
   class AttributesIterator;
@@ -173,7 +186,7 @@ class Element final: public HTMLRewriter::Token {
 
   kj::StringPtr getNamespaceURI();
 
-  kj::Maybe<kj::String> getAttribute(kj::String name);
+  kj::Maybe<jsg::JsString> getAttribute(jsg::Lock& js, kj::String name);
   bool hasAttribute(kj::String name);
   jsg::Ref<Element> setAttribute(kj::String name, kj::String value);
   jsg::Ref<Element> removeAttribute(kj::String name);
@@ -314,7 +327,7 @@ class Comment final: public HTMLRewriter::Token {
 
   explicit Comment(CType& comment, Rewriter&);
 
-  kj::String getText();
+  jsg::JsString getText(jsg::Lock& js);
   void setText(kj::String);
 
   bool getRemoved();
@@ -354,7 +367,7 @@ class Text final: public HTMLRewriter::Token {
 
   explicit Text(CType& text, Rewriter&);
 
-  kj::String getText();
+  jsg::JsString getText(jsg::Lock& js);
 
   bool getLastInTextNode();
 
@@ -439,9 +452,9 @@ class DocumentEnd final: public HTMLRewriter::Token {
 };
 
 #define EW_HTML_REWRITER_ISOLATE_TYPES                                                             \
-  api::ContentOptions, api::HTMLRewriter, api::HTMLRewriter::ElementContentHandlers,               \
-      api::HTMLRewriter::DocumentContentHandlers, api::Doctype, api::Element, api::EndTag,         \
-      api::Comment, api::Text, api::DocumentEnd, api::Element::AttributesIterator,                 \
-      api::Element::AttributesIterator::Next
+  api::ContentOptions, api::HTMLRewriter, api::HTMLRewriter::Options,                              \
+      api::HTMLRewriter::ElementContentHandlers, api::HTMLRewriter::DocumentContentHandlers,       \
+      api::Doctype, api::Element, api::EndTag, api::Comment, api::Text, api::DocumentEnd,          \
+      api::Element::AttributesIterator, api::Element::AttributesIterator::Next
 
 }  // namespace workerd::api
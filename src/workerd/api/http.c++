@@ -147,24 +147,101 @@ Headers::Headers(jsg::Dict<jsg::ByteString, jsg::ByteString> dict): guard(Guard:
   }
 }
 
-Headers::Headers(const Headers& other): guard(Guard::NONE) {
-  for (auto& header: other.headers) {
+Headers::Headers(const Headers& other)
+    : guard(Guard::NONE),
+      // Shared until either side is modified; see getMutableHeaders().
+      headers(kj::addRef(*other.headers)) {}
+
+Headers::Headers(const kj::HttpHeaders& other, Guard guard): guard(Guard::NONE) {
+  other.forEach([this](auto name, auto value) {
+    append(jsg::ByteString(kj::str(name)), jsg::ByteString(kj::str(value)));
+  });
+
+  this->guard = guard;
+}
+
+kj::Own<Headers::HeaderMap> Headers::copyHeaderMap(const HeaderMap& other) {
+  auto result = kj::refcounted<HeaderMap>();
+  for (auto& header: other.map) {
     Header copy{
       jsg::ByteString(kj::str(header.second.key)),
       jsg::ByteString(kj::str(header.second.name)),
       KJ_MAP(value, header.second.values) { return jsg::ByteString(kj::str(value)); },
     };
     kj::StringPtr keyRef = copy.key;
-    KJ_ASSERT(headers.insert(std::make_pair(keyRef, kj::mv(copy))).second);
+    auto [iter, inserted] = result->map.insert(std::make_pair(keyRef, kj::mv(copy)));
+    KJ_ASSERT(inserted);
+    KJ_IF_SOME(id, findCommonHeaderName(keyRef)) {
+      result->common[id] = iter->second;
+    }
   }
+  return kj::mv(result);
 }
 
-Headers::Headers(const kj::HttpHeaders& other, Guard guard): guard(Guard::NONE) {
-  other.forEach([this](auto name, auto value) {
-    append(jsg::ByteString(kj::str(name)), jsg::ByteString(kj::str(value)));
-  });
+Headers::HeaderMap& Headers::getMutableHeaders() {
+  if (headers->isShared()) {
+    // A live iterator is still using the current map; leave it that snapshot.
+    headers = copyHeaderMap(*headers);
+  }
+  return *headers;
+}
 
-  this->guard = guard;
+kj::Maybe<Headers::Header&> Headers::HeaderMap::find(kj::StringPtr name) {
+  return find(name, findCommonHeaderName(name));
+}
+
+kj::Maybe<Headers::Header&> Headers::HeaderMap::find(
+    kj::StringPtr name, kj::Maybe<uint> commonId) {
+  KJ_IF_SOME(id, commonId) {
+    return common[id];
+  }
+  auto iter = map.find(toLower(name));
+  if (iter == map.end()) {
+    return kj::none;
+  }
+  return iter->second;
+}
+
+void Headers::HeaderMap::insert(
+    jsg::ByteString name, jsg::ByteString value, kj::Maybe<uint> commonId) {
+  auto key = jsg::ByteString(toLower(name));
+  kj::StringPtr keyRef = key;
+  auto [iter, inserted] = map.try_emplace(keyRef, kj::mv(key), kj::mv(name), kj::mv(value));
+  KJ_ASSERT(inserted);
+  KJ_IF_SOME(id, commonId) {
+    common[id] = iter->second;
+  }
+}
+
+void Headers::HeaderMap::set(jsg::ByteString name, jsg::ByteString value) {
+  auto commonId = findCommonHeaderName(name);
+  KJ_IF_SOME(header, find(name, commonId)) {
+    // Overwrite existing value(s).
+    header.values.clear();
+    header.values.add(kj::mv(value));
+  } else {
+    insert(kj::mv(name), kj::mv(value), commonId);
+  }
+}
+
+void Headers::HeaderMap::append(jsg::ByteString name, jsg::ByteString value) {
+  auto commonId = findCommonHeaderName(name);
+  KJ_IF_SOME(header, find(name, commonId)) {
+    header.values.add(kj::mv(value));
+  } else {
+    insert(kj::mv(name), kj::mv(value), commonId);
+  }
+}
+
+void Headers::HeaderMap::erase(kj::StringPtr name) {
+  KJ_IF_SOME(id, findCommonHeaderName(name)) {
+    KJ_IF_SOME(header, common[id]) {
+      common[id] = kj::none;
+      map.erase(map.find(header.key));
+    }
+  } else {
+    map.erase(toLower(name));
+  }
 }
 
 jsg::Ref<Headers> Headers::clone() const {
@@ -176,7 +253,7 @@ jsg::Ref<Headers> Headers::clone() const {
 // Fill in the given HttpHeaders with these headers. Note that strings are inserted by
 // reference, so the output must be consumed immediately.
 void Headers::shallowCopyTo(kj::HttpHeaders& out) {
-  for (auto& entry: headers) {
+  for (auto& entry: headers->map) {
     for (auto& value: entry.second.values) {
       out.add(entry.second.name, value);
     }
@@ -189,13 +266,13 @@ bool Headers::hasLowerCase(kj::StringPtr name) {
     KJ_DREQUIRE(!('A' <= c && c <= 'Z'));
   }
 #endif
-  return headers.find(name) != headers.end();
+  return headers->find(name) != kj::none;
 }
 
 kj::Array<Headers::DisplayedHeader> Headers::getDisplayedHeaders(jsg::Lock& js) {
   if (FeatureFlags::get(js).getHttpHeadersGetSetCookie()) {
     kj::Vector<Headers::DisplayedHeader> copy;
-    for (auto& entry: headers) {
+    for (auto& entry: headers->map) {
       if (entry.first == "set-cookie") {
         // For set-cookie entries, we iterate each individually without
         // combining them.
@@ -213,7 +290,7 @@ kj::Array<Headers::DisplayedHeader> Headers::getDisplayedHeaders(jsg::Lock& js)
     return copy.releaseAsArray();
   } else {
     // The old behavior before the standard getSetCookie() API was introduced...
-    auto headersCopy = KJ_MAP(mapEntry, headers) {
+    auto headersCopy = KJ_MAP(mapEntry, headers->map) {
       const auto& header = mapEntry.second;
       return DisplayedHeader{
         jsg::ByteString(kj::str(header.key)), jsg::ByteString(kj::strArray(header.values, ", "))};
@@ -269,20 +346,16 @@ jsg::Ref<Headers> Headers::constructor(jsg::Lock& js, jsg::Optional<Initializer>
 
 kj::Maybe<jsg::ByteString> Headers::get(jsg::ByteString name) {
   requireValidHeaderName(name);
-  auto iter = headers.find(jsg::ByteString(toLower(kj::mv(name))));
-  if (iter == headers.end()) {
-    return kj::none;
-  } else {
-    return jsg::ByteString(kj::strArray(iter->second.values, ", "));
-  }
+  return headers->find(name).map([](Header& header) {
+    return jsg::ByteString(kj::strArray(header.values, ", "));
+  });
 }
 
 kj::ArrayPtr<jsg::ByteString> Headers::getSetCookie() {
-  auto iter = headers.find("set-cookie");
-  if (iter == headers.end()) {
-    return nullptr;
+  KJ_IF_SOME(header, headers->find("set-cookie")) {
+    return header.values.asPtr();
   } else {
-    return iter->second.values.asPtr();
+    return nullptr;
   }
 }
 
@@ -301,7 +374,7 @@ kj::ArrayPtr<jsg::ByteString> Headers::getAll(jsg::ByteString name) {
 
 bool Headers::has(jsg::ByteString name) {
   requireValidHeaderName(name);
-  return headers.find(jsg::ByteString(toLower(kj::mv(name)))) != headers.end();
+  return headers->find(name) != kj::none;
 }
 
 void Headers::set(jsg::ByteString name, jsg::ByteString value) {
@@ -311,106 +384,95 @@ void Headers::set(jsg::ByteString name, jsg::ByteString value) {
 
 void Headers::setUnguarded(jsg::ByteString name, jsg::ByteString value) {
   requireValidHeaderName(name);
-  auto key = jsg::ByteString(toLower(name));
   value = normalizeHeaderValue(kj::mv(value));
   requireValidHeaderValue(value);
-  auto [iter, emplaced] = headers.try_emplace(key, kj::mv(key), kj::mv(name), kj::mv(value));
-  if (!emplaced) {
-    // Overwrite existing value(s).
-    iter->second.values.clear();
-    iter->second.values.add(kj::mv(value));
-  }
+  getMutableHeaders().set(kj::mv(name), kj::mv(value));
 }
 
 void Headers::append(jsg::ByteString name, jsg::ByteString value) {
   checkGuard();
   requireValidHeaderName(name);
-  auto key = jsg::ByteString(toLower(name));
   value = normalizeHeaderValue(kj::mv(value));
   requireValidHeaderValue(value);
-  auto [iter, emplaced] = headers.try_emplace(key, kj::mv(key), kj::mv(name), kj::mv(value));
-  if (!emplaced) {
-    iter->second.values.add(kj::mv(value));
-  }
+  getMutableHeaders().append(kj::mv(name), kj::mv(value));
 }
 
 void Headers::delete_(jsg::ByteString name) {
   checkGuard();
   requireValidHeaderName(name);
-  headers.erase(jsg::ByteString(toLower(kj::mv(name))));
+  getMutableHeaders().erase(name);
+}
+
+// Headers iterators hold a reference to the header map as it was when iteration started, rather
+// than a pointer to the Headers object. This handles both the iterator -> iterable lifetime
+// dependence and the iterator invalidation issue: if the user modifies the Headers while iterating,
+// getMutableHeaders() sees that the map is shared and gives the Headers object a fresh copy to
+// modify, leaving the iterator with its snapshot. By empirical testing, snapshot semantics seem to
+// be how Chrome implements Headers iteration. In the common case where nothing is modified during
+// iteration, nothing is copied up front; each step only materializes the strings it returns.
+
+Headers::IteratorState Headers::startIteration(jsg::Lock& js) {
+  auto snapshot = kj::addRef(*headers);
+  auto cursor = snapshot->map.cbegin();
+  return IteratorState{
+    .snapshot = kj::mv(snapshot),
+    .cursor = cursor,
+    .splitSetCookie = FeatureFlags::get(js).getHttpHeadersGetSetCookie(),
+  };
 }
 
-// There are a couple implementation details of the Headers iterators worth calling out.
-//
-// 1. Each iterator gets its own copy of the keys and/or values of the headers. While nauseating
-//    from a performance perspective, this solves both the iterator -> iterable lifetime dependence
-//    and the iterator invalidation issue: i.e., it's impossible for a user to unsafely modify the
-//    Headers data structure while iterating over it, because they are simply two separate data
-//    structures. By empirical testing, this seems to be how Chrome implements Headers iteration.
-//
-//    Other alternatives bring their own pitfalls. We could store a Ref of the parent Headers
-//    object, solving the lifetime issue. To solve the iterator invalidation issue, we could store a
-//    copy of the currently-iterated-over key and use std::upper_bound() to find the next entry
-//    every time we want to increment the iterator (making the increment operation O(lg n) rather
-//    than O(1)); or we could make each Header entry in the map store a set of back-pointers to all
-//    live iterators pointing to it, with delete_() incrementing all iterators in the set whenever
-//    it deletes a header entry. Neither hack appealed to me.
-//
-// 2. Notice that the next() member function of the iterator classes moves the string(s) they
-//    contain, rather than making a copy of them as in the FormData iterators. This is safe to do
-//    because, unlike FormData, these iterators have their own copies of the strings, and since they
-//    are forward-only iterators, we know we won't need the strings again.
-//
-// TODO(perf): On point 1, perhaps we could avoid most copies by using a copy-on-write strategy
-//   applied to the header map elements? We'd still copy the whole data structure to avoid iterator
-//   invalidation, but the elements would be cheaper to copy.
+kj::Maybe<Headers::IteratorState::Step> Headers::IteratorState::next() {
+  while (cursor != snapshot->map.end()) {
+    auto& header = cursor->second;
+    // Set-Cookie headers must be handled specially. They should never be combined into a single
+    // value, so the iterators must separate them (which means the keys iterator can end up
+    // producing multiple set-cookie instances).
+    if (!splitSetCookie || header.key != "set-cookie") {
+      ++cursor;
+      return Step{header, kj::none};
+    }
+    if (valueIndex < header.values.size()) {
+      return Step{header, header.values[valueIndex++]};
+    }
+    valueIndex = 0;
+    ++cursor;
+  }
+  return kj::none;
+}
+
+kj::Maybe<kj::Array<jsg::ByteString>> Headers::entryIteratorNext(
+    jsg::Lock& js, IteratorState& state) {
+  return state.next().map([](IteratorState::Step step) {
+    auto key = jsg::ByteString(kj::str(step.header.key));
+    KJ_IF_SOME(value, step.value) {
+      return kj::arr(kj::mv(key), jsg::ByteString(kj::str(value)));
+    }
+    return kj::arr(kj::mv(key), jsg::ByteString(kj::strArray(step.header.values, ", ")));
+  });
+}
+
+kj::Maybe<jsg::ByteString> Headers::keyIteratorNext(jsg::Lock& js, IteratorState& state) {
+  return state.next().map(
+      [](IteratorState::Step step) { return jsg::ByteString(kj::str(step.header.key)); });
+}
+
+kj::Maybe<jsg::ByteString> Headers::valueIteratorNext(jsg::Lock& js, IteratorState& state) {
+  return state.next().map([](IteratorState::Step step) {
+    KJ_IF_SOME(value, step.value) {
+      return jsg::ByteString(kj::str(value));
+    }
+    return jsg::ByteString(kj::strArray(step.header.values, ", "));
+  });
+}
 
 jsg::Ref<Headers::EntryIterator> Headers::entries(jsg::Lock& js) {
-  return jsg::alloc<EntryIterator>(IteratorState<DisplayedHeader>{getDisplayedHeaders(js)});
+  return jsg::alloc<EntryIterator>(startIteration(js));
 }
 jsg::Ref<Headers::KeyIterator> Headers::keys(jsg::Lock& js) {
-  if (FeatureFlags::get(js).getHttpHeadersGetSetCookie()) {
-    kj::Vector<jsg::ByteString> keysCopy;
-    for (auto& entry: headers) {
-      // Set-Cookie headers must be handled specially. They should never be combined into a
-      // single value, so the values iterator must separate them. It seems a bit silly, but
-      // the keys iterator can end up having multiple set-cookie instances.
-      if (entry.first == "set-cookie") {
-        for (auto n = 0; n < entry.second.values.size(); n++) {
-          keysCopy.add(jsg::ByteString(kj::str(entry.first)));
-        }
-      } else {
-        keysCopy.add(jsg::ByteString(kj::str(entry.first)));
-      }
-    }
-    return jsg::alloc<KeyIterator>(IteratorState<jsg::ByteString>{keysCopy.releaseAsArray()});
-  } else {
-    auto keysCopy =
-        KJ_MAP(mapEntry, headers) { return jsg::ByteString(kj::str(mapEntry.second.key)); };
-    return jsg::alloc<KeyIterator>(IteratorState<jsg::ByteString>{kj::mv(keysCopy)});
-  }
+  return jsg::alloc<KeyIterator>(startIteration(js));
 }
 jsg::Ref<Headers::ValueIterator> Headers::values(jsg::Lock& js) {
-  if (FeatureFlags::get(js).getHttpHeadersGetSetCookie()) {
-    kj::Vector<jsg::ByteString> values;
-    for (auto& entry: headers) {
-      // Set-Cookie headers must be handled specially. They should never be combined into a
-      // single value, so the values iterator must separate them.
-      if (entry.first == "set-cookie") {
-        for (auto& value: entry.second.values) {
-          values.add(jsg::ByteString(kj::str(value)));
-        }
-      } else {
-        values.add(jsg::ByteString(kj::strArray(entry.second.values, ", ")));
-      }
-    }
-    return jsg::alloc<ValueIterator>(IteratorState<jsg::ByteString>{values.releaseAsArray()});
-  } else {
-    auto valuesCopy = KJ_MAP(mapEntry, headers) {
-      return jsg::ByteString(kj::strArray(mapEntry.second.values, ", "));
-    };
-    return jsg::alloc<ValueIterator>(IteratorState<jsg::ByteString>{kj::mv(valuesCopy)});
-  }
+  return jsg::alloc<ValueIterator>(startIteration(js));
 }
 
 void Headers::forEach(jsg::Lock& js,
@@ -529,14 +591,14 @@ void Headers::serialize(jsg::Lock& js, jsg::Serializer& serializer) {
 
   // Write the count of headers.
   uint count = 0;
-  for (auto& entry: headers) {
+  for (auto& entry: headers->map) {
     count += entry.second.values.size();
   }
   serializer.writeRawUint32(count);
 
   // Now write key/values.
   auto& commonHeaders = getCommonHeaderMap();
-  for (auto& entry: headers) {
+  for (auto& entry: headers->map) {
     auto& header = entry.second;
     auto commonId = commonHeaders.find(header.key);
     for (auto& value: header.values) {
@@ -890,6 +952,17 @@ jsg::Promise<jsg::Ref<Blob>> Body::blob(jsg::Lock& js) {
 
 kj::Maybe<Body::ExtractedBody> Body::clone(jsg::Lock& js) {
   KJ_IF_SOME(i, impl) {
+    KJ_IF_SOME(b, i.buffer) {
+      if (!i.stream->isDisturbed() && !i.stream->isLocked()) {
+        // The stream will still produce the whole buffer, so give the clone a stream of its own
+        // over the same bytes instead of teeing. A clone that is never read then costs one small
+        // allocation, and neither side needs to buffer what the other hasn't read yet.
+        auto stream = jsg::alloc<ReadableStream>(
+            IoContext::current(), kj::heap<BodyBufferInputStream>(b.clone(js)));
+        return ExtractedBody{kj::mv(stream), b.clone(js)};
+      }
+    }
+
     auto branches = i.stream->tee(js);
 
     i.stream = kj::mv(branches[0]);
@@ -1620,6 +1693,13 @@ kj::Promise<DeferredProxy<void>> Response::send(jsg::Lock& js,
       }
     }
 
+    if (hasEnabledWebSocketCompression && FeatureFlags::get(js).getWebSocketNoContextTakeover()) {
+      KJ_IF_SOME(extensions, outHeaders.get(kj::HttpHeaderId::SEC_WEBSOCKET_EXTENSIONS)) {
+        outHeaders.set(kj::HttpHeaderId::SEC_WEBSOCKET_EXTENSIONS,
+            withoutContextTakeover(extensions));
+      }
+    }
+
     if (!hasEnabledWebSocketCompression) {
       // While we guard against an origin server including `Sec-WebSocket-Extensions` in a Response
       // (we don't send the extension in an offer, and if the server includes it in a response we
@@ -1849,7 +1929,9 @@ jsg::Promise<jsg::Ref<Response>> fetchImplNoOutputLock(jsg::Lock& js,
   kj::Own<kj::HttpClient> client =
       asHttpClient(fetcher->getClient(ioContext, jsRequest->serializeCfBlobJson(js), "fetch"_kjc));
 
-  kj::HttpHeaders headers(ioContext.getHeaderTable());
+  auto ownHeaders = ioContext.newSubrequestHeaders();
+  KJ_DEFER(ioContext.recycleSubrequestHeaders(kj::mv(ownHeaders)));
+  auto& headers = *ownHeaders;
   jsRequest->shallowCopyHeadersTo(headers);
 
   // If the jsRequest has a CacheMode, we need to handle that here.
@@ -1882,6 +1964,11 @@ jsg::Promise<jsg::Ref<Response>> fetchImplNoOutputLock(jsg::Lock& js,
       // If we haven't enabled the websocket compression compatibility flag, strip the header from the
       // subrequest.
       headers.unset(kj::HttpHeaderId::SEC_WEBSOCKET_EXTENSIONS);
+    } else if (FeatureFlags::get(js).getWebSocketNoContextTakeover()) {
+      KJ_IF_SOME(extensions, headers.get(kj::HttpHeaderId::SEC_WEBSOCKET_EXTENSIONS)) {
+        headers.set(
+            kj::HttpHeaderId::SEC_WEBSOCKET_EXTENSIONS, withoutContextTakeover(extensions));
+      }
     }
     auto webSocketResponse = client->openWebSocket(url, headers);
     return ioContext.awaitIo(js, AbortSignal::maybeCancelWrap(signal, kj::mv(webSocketResponse)),
@@ -1939,6 +2026,11 @@ jsg::Promise<jsg::Ref<Response>> fetchImplNoOutputLock(jsg::Lock& js,
 
       // We want to support bidirectional streaming, so we actually don't want to wait for the
       // request to finish before we deliver the response to the app.
+      //
+      // When the body is an incoming request's body passed through untouched, this pump never
+      // reaches JavaScript: the internal controller hands its source to the system stream, which
+      // pumps the original kj::AsyncInputStream into `nr.body` directly (see
+      // EncodedAsyncOutputStream::tryPumpFrom()), and `maybeLength` above carries its length.
 
       // jsBody is not used directly within the function but is passed in so that
       // the coroutine frame keeps it alive.
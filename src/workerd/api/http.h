@@ -11,6 +11,7 @@
 #include "basics.h"
 #include "cf-property.h"
 #include <workerd/api/streams/readable.h>
+#include <workerd/api/header-names.h>
 #include "form-data.h"
 #include "web-socket.h"
 #include <workerd/api/url.h>
@@ -24,10 +25,81 @@ namespace workerd::api {
 
 class Headers final: public jsg::Object {
 private:
-  template <typename T>
+  struct Header {
+    jsg::ByteString key;   // lower-cased name
+    jsg::ByteString name;
+
+    // We intentionally do not comma-concatenate header values of the same name, as we need to be
+    // able to re-serialize them separately. This is particularly important for the Set-Cookie
+    // header, which uses a date format that requires a comma. This would normally suggest using a
+    // std::multimap, but we also need to be able to display the values in comma-concatenated form
+    // via Headers.entries()[1] in order to be Fetch-conformant. Storing a vector of strings in a
+    // std::map makes this easier, and also makes it easy to honor the "first header name casing is
+    // used for all duplicate header names" rule[2] that the Fetch spec mandates.
+    //
+    // See: 1: https://fetch.spec.whatwg.org/#concept-header-list-sort-and-combine
+    //      2: https://fetch.spec.whatwg.org/#concept-header-list-append
+    kj::Vector<jsg::ByteString> values;
+
+    explicit Header(jsg::ByteString key, jsg::ByteString name,
+                    kj::Vector<jsg::ByteString> values)
+        : key(kj::mv(key)), name(kj::mv(name)), values(kj::mv(values)) {}
+    explicit Header(jsg::ByteString key, jsg::ByteString name, jsg::ByteString value)
+        : key(kj::mv(key)), name(kj::mv(name)), values(1) {
+      values.add(kj::mv(value));
+    }
+
+    JSG_MEMORY_INFO(Header) {
+      tracker.trackField("key", key);
+      tracker.trackField("name", name);
+      for (const auto& value : values) {
+        tracker.trackField(nullptr, value);
+      }
+    }
+  };
+
+  // The header map is refcounted so that iterators can share it instead of copying it. Any
+  // mutation goes through getMutableHeaders(), which first copies the map if an iterator (or a
+  // copy of this Headers object) still holds a reference. Live iterators therefore keep seeing
+  // the headers as they were when iteration began, and only a mutation during iteration pays
+  // for a copy.
+  struct HeaderMap final: public kj::Refcounted {
+    // Every header, keyed and ordered by lower-cased name.
+    std::map<kj::StringPtr, Header> map;
+
+    // The headers in `map` that have common names (see header-names.h), indexed by id, so that
+    // looking one of them up needs neither a lower-cased copy of the name nor string comparisons.
+    kj::Maybe<Header&> common[COMMON_HEADER_NAME_COUNT];
+
+    // `name` may be in any case.
+    kj::Maybe<Header&> find(kj::StringPtr name);
+
+    // Replaces or adds to the values of the header `name`, adding the header if needed.
+    void set(jsg::ByteString name, jsg::ByteString value);
+    void append(jsg::ByteString name, jsg::ByteString value);
+
+    void erase(kj::StringPtr name);
+
+  private:
+    kj::Maybe<Header&> find(kj::StringPtr name, kj::Maybe<uint> commonId);
+    void insert(jsg::ByteString name, jsg::ByteString value, kj::Maybe<uint> commonId);
+  };
+
   struct IteratorState {
-    kj::Array<T> copy;
-    decltype(copy.begin()) cursor = copy.begin();
+    kj::Own<HeaderMap> snapshot;
+    std::map<kj::StringPtr, Header>::const_iterator cursor;
+
+    // When set-cookie values are iterated individually, the index of the next value to return
+    // from the set-cookie header at `cursor`.
+    size_t valueIndex = 0;
+    bool splitSetCookie;
+
+    struct Step {
+      const Header& header;
+      // Set only when stepping through the individual values of a set-cookie header.
+      kj::Maybe<const jsg::ByteString&> value;
+    };
+    kj::Maybe<Step> next();
   };
 
 public:
@@ -117,16 +189,16 @@ public:
 
   JSG_ITERATOR(EntryIterator, entries,
                 kj::Array<jsg::ByteString>,
-                IteratorState<DisplayedHeader>,
+                IteratorState,
                 entryIteratorNext)
   JSG_ITERATOR(KeyIterator, keys,
                 jsg::ByteString,
-                IteratorState<jsg::ByteString>,
-                keyOrValueIteratorNext)
+                IteratorState,
+                keyIteratorNext)
   JSG_ITERATOR(ValueIterator, values,
                 jsg::ByteString,
-                IteratorState<jsg::ByteString>,
-                keyOrValueIteratorNext)
+                IteratorState,
+                valueIteratorNext)
 
   // JavaScript API.
 
@@ -170,67 +242,33 @@ public:
   JSG_SERIALIZABLE(rpc::SerializationTag::HEADERS);
 
   void visitForMemoryInfo(jsg::MemoryTracker& tracker) const {
-    for (const auto& entry : headers) {
+    for (const auto& entry : headers->map) {
       tracker.trackField(entry.first, entry.second);
     }
   }
 
 private:
-  struct Header {
-    jsg::ByteString key;   // lower-cased name
-    jsg::ByteString name;
-
-    // We intentionally do not comma-concatenate header values of the same name, as we need to be
-    // able to re-serialize them separately. This is particularly important for the Set-Cookie
-    // header, which uses a date format that requires a comma. This would normally suggest using a
-    // std::multimap, but we also need to be able to display the values in comma-concatenated form
-    // via Headers.entries()[1] in order to be Fetch-conformant. Storing a vector of strings in a
-    // std::map makes this easier, and also makes it easy to honor the "first header name casing is
-    // used for all duplicate header names" rule[2] that the Fetch spec mandates.
-    //
-    // See: 1: https://fetch.spec.whatwg.org/#concept-header-list-sort-and-combine
-    //      2: https://fetch.spec.whatwg.org/#concept-header-list-append
-    kj::Vector<jsg::ByteString> values;
-
-    explicit Header(jsg::ByteString key, jsg::ByteString name,
-                    kj::Vector<jsg::ByteString> values)
-        : key(kj::mv(key)), name(kj::mv(name)), values(kj::mv(values)) {}
-    explicit Header(jsg::ByteString key, jsg::ByteString name, jsg::ByteString value)
-        : key(kj::mv(key)), name(kj::mv(name)), values(1) {
-      values.add(kj::mv(value));
-    }
-
-    JSG_MEMORY_INFO(Header) {
-      tracker.trackField("key", key);
-      tracker.trackField("name", name);
-      for (const auto& value : values) {
-        tracker.trackField(nullptr, value);
-      }
-    }
-  };
 
   Guard guard;
-  std::map<kj::StringPtr, Header> headers;
+  // Mutable so that copying a const Headers can take a reference to its map; a shared map is
+  // never modified in place.
+  mutable kj::Own<HeaderMap> headers = kj::refcounted<HeaderMap>();
 
   void checkGuard() {
     JSG_REQUIRE(guard == Guard::NONE, TypeError, "Can't modify immutable headers.");
   }
 
-  static kj::Maybe<kj::Array<jsg::ByteString>> entryIteratorNext(jsg::Lock& js, auto& state) {
-    if (state.cursor == state.copy.end()) {
-      return kj::none;
-    }
-    auto& ret = *state.cursor++;
-    return kj::arr(kj::mv(ret.key), kj::mv(ret.value));
-  }
+  // Returns the header map for modification, copying it first if it is shared.
+  HeaderMap& getMutableHeaders();
 
-  static kj::Maybe<jsg::ByteString> keyOrValueIteratorNext(jsg::Lock& js, auto& state) {
-    if (state.cursor == state.copy.end()) {
-      return kj::none;
-    }
-    auto& ret = *state.cursor++;
-    return kj::mv(ret);
-  }
+  static kj::Own<HeaderMap> copyHeaderMap(const HeaderMap& other);
+
+  IteratorState startIteration(jsg::Lock& js);
+
+  static kj::Maybe<kj::Array<jsg::ByteString>> entryIteratorNext(
+      jsg::Lock& js, IteratorState& state);
+  static kj::Maybe<jsg::ByteString> keyIteratorNext(jsg::Lock& js, IteratorState& state);
+  static kj::Maybe<jsg::ByteString> valueIteratorNext(jsg::Lock& js, IteratorState& state);
 };
 
 // Base class for Request and Response. In JavaScript, this class is a mixin, meaning no one will
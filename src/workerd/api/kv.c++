@@ -20,6 +20,10 @@ namespace workerd::api {
 
 // As documented in Cloudflare's Worker KV limits.
 static constexpr size_t kMaxKeyLength = 512;
+static constexpr size_t kMaxBulkKeys = 100;
+
+// How much of a bulk get response is read before its complete lines are parsed.
+static constexpr size_t kBulkReadChunkSize = 16 * 1024;
 
 static void checkForErrorStatus(kj::StringPtr method, const kj::HttpClient::Response& response) {
   if (response.statusCode < 200 || response.statusCode >= 300) {
@@ -66,6 +70,114 @@ static void parseListMetadata(
 
 constexpr auto FLPROD_405_HEADER = "CF-KV-FLPROD-405"_kj;
 
+// Limits on what a KvNamespace keeps for reads with a `cacheTtl`, see KvNamespace::ReadCache.
+static constexpr size_t kMaxLocalValueSize = 64 * 1024;
+static constexpr size_t kMaxLocalTotalSize = 1024 * 1024;
+
+KvNamespace::GetWithMetadataResult KvNamespace::toGetWithMetadataResult(
+    jsg::Lock& js, const BufferedValue& value, kj::StringPtr type) {
+  auto cacheStatus = value.cacheStatus.map([&](const kj::String& cs) {
+    return jsg::JsRef<jsg::JsValue>(js, js.strIntern(cs));
+  });
+  if (!value.found) {
+    return KvNamespace::GetWithMetadataResult{
+      .value = kj::none,
+      .metadata = kj::none,
+      .cacheStatus = kj::mv(cacheStatus),
+    };
+  }
+
+  KvNamespace::GetResult result;
+  if (type == "text") {
+    result = kj::heapString(value.body.asChars());
+  } else if (type == "arrayBuffer") {
+    result = kj::heapArray<byte>(value.body);
+  } else if (type == "json") {
+    result = jsg::JsRef(js, jsg::JsValue::fromJson(js, value.body.asChars()));
+  } else {
+    JSG_FAIL_REQUIRE(TypeError,
+        "Unknown response type. Possible types are \"text\", \"arrayBuffer\", "
+        "\"json\", and \"stream\".");
+  }
+
+  kj::Maybe<jsg::JsRef<jsg::JsValue>> meta;
+  KJ_IF_SOME(metaStr, value.metadata) {
+    meta = jsg::JsRef(js, jsg::JsValue::fromJson(js, metaStr));
+  }
+  return KvNamespace::GetWithMetadataResult{
+    kj::mv(result),
+    kj::mv(meta),
+    kj::mv(cacheStatus),
+  };
+}
+
+void KvNamespace::ReadCache::State::erase(kj::StringPtr name) {
+  KJ_IF_SOME(entry, entries.find(name)) {
+    totalSize -= name.size() + entry.value->body.size();
+    entries.erase(name);
+  }
+}
+
+void KvNamespace::ReadCache::invalidate(kj::StringPtr name) const {
+  auto lock = state.lockExclusive();
+  ++lock->writeCount;
+  lock->erase(name);
+}
+
+void KvNamespace::ReadCache::store(kj::String name,
+    kj::Own<const BufferedValue> value,
+    kj::TimePoint fetchTime,
+    kj::Duration ttl,
+    uint64_t writeCountBefore) const {
+  size_t size = name.size() + value->body.size();
+  if (value->body.size() > kMaxLocalValueSize) {
+    return;
+  }
+
+  auto lock = state.lockExclusive();
+  if (lock->writeCount != writeCountBefore) {
+    return;
+  }
+  lock->erase(name);
+
+  // Make room by dropping expired values first, then the oldest ones.
+  if (lock->totalSize + size > kMaxLocalTotalSize) {
+    auto now = kj::systemCoarseMonotonicClock().now();
+    lock->entries.eraseAll([&](const kj::String& key, const Entry& entry) {
+      if (now - entry.fetchTime < entry.ttl) return false;
+      lock->totalSize -= key.size() + entry.value->body.size();
+      return true;
+    });
+  }
+  while (lock->totalSize + size > kMaxLocalTotalSize) {
+    auto oldest = kj::str(lock->entries.begin()->key);
+    lock->erase(oldest);
+  }
+
+  lock->totalSize += size;
+  lock->entries.insert(kj::mv(name),
+      Entry{
+        .value = kj::mv(value),
+        .fetchTime = fetchTime,
+        .ttl = ttl,
+      });
+}
+
+void KvNamespace::ReadCache::finish(kj::StringPtr urlStr, MaybeBufferedValue value) const {
+  kj::Vector<kj::Own<kj::CrossThreadPromiseFulfiller<MaybeBufferedValue>>> waiters;
+  {
+    auto lock = state.lockExclusive();
+    KJ_IF_SOME(inFlight, lock->inFlight.find(urlStr)) {
+      waiters = kj::mv(inFlight.waiters);
+      lock->inFlight.erase(urlStr);
+    }
+  }
+  for (auto& waiter: waiters) {
+    waiter->fulfill(
+        value.map([](kj::Own<const BufferedValue>& v) { return kj::atomicAddRef(*v); }));
+  }
+}
+
 kj::Own<kj::HttpClient> KvNamespace::getHttpClient(IoContext& context,
     kj::HttpHeaders& headers,
     kj::OneOf<LimitEnforcer::KvOpType, kj::LiteralStringConst> opTypeOrUnknown,
@@ -88,6 +200,8 @@ kj::Own<kj::HttpClient> KvNamespace::getHttpClient(IoContext& context,
             return "kv_list"_kjc;
           case LimitEnforcer::KvOpType::DELETE:
             return "kv_delete"_kjc;
+          case LimitEnforcer::KvOpType::GET_BULK:
+            return "kv_get_bulk"_kjc;
         }
       }
     }
@@ -106,13 +220,161 @@ kj::Own<kj::HttpClient> KvNamespace::getHttpClient(IoContext& context,
 }
 
 jsg::Promise<KvNamespace::GetResult> KvNamespace::get(jsg::Lock& js,
-    kj::String name,
+    kj::OneOf<kj::String, kj::Array<kj::String>> name,
     jsg::Optional<kj::OneOf<kj::String, GetOptions>> options,
     CompatibilityFlags::Reader flags) {
   return js.evalNow([&] {
-    auto resp = getWithMetadata(js, kj::mv(name), kj::mv(options));
-    return resp.then(js,
-        [](jsg::Lock&, KvNamespace::GetWithMetadataResult result) { return kj::mv(result.value); });
+    KJ_SWITCH_ONEOF(name) {
+      KJ_CASE_ONEOF(names, kj::Array<kj::String>) {
+        return getBulk(js, kj::mv(names), kj::mv(options));
+      }
+      KJ_CASE_ONEOF(n, kj::String) {
+        auto resp = getWithMetadata(js, kj::mv(n), kj::mv(options));
+        return resp.then(js, [](jsg::Lock&, KvNamespace::GetWithMetadataResult result) {
+          return kj::mv(result.value);
+        });
+      }
+    }
+    KJ_UNREACHABLE;
+  });
+}
+
+// Reads the lines of a bulk get response from `stream` into `map`, a chunk at a time. `partial`
+// is the incomplete line left over from the previous chunk.
+static jsg::Promise<void> readBulkLines(jsg::Lock& js,
+    IoContext& context,
+    IoOwn<ReadableStreamSource> stream,
+    kj::String partial,
+    jsg::JsRef<jsg::JsMap> map,
+    bool parseJson,
+    size_t remainingBytes) {
+  auto buffer = kj::heapArray<char>(kBulkReadChunkSize);
+  auto read = stream->tryRead(buffer.begin(), 1, buffer.size())
+                  .then([buffer = kj::mv(buffer)](size_t amount) mutable {
+    return kj::heapArray<char>(buffer.first(amount));
+  });
+
+  return context.awaitIo(js, kj::mv(read),
+      [&context, stream = kj::mv(stream), partial = kj::mv(partial), map = kj::mv(map), parseJson,
+          remainingBytes](jsg::Lock& js, kj::Array<char> chunk) mutable -> jsg::Promise<void> {
+    JSG_REQUIRE(chunk.size() <= remainingBytes, Error,
+        "KV GET_BULK failed: response exceeded the buffering limit.");
+    auto text = kj::str(partial, chunk);
+    kj::ArrayPtr<const char> rest = text;
+
+    auto handle = map.getHandle(js);
+    auto addLine = [&](kj::ArrayPtr<const char> line) {
+      if (line.size() == 0) return;
+      js.withinHandleScope([&] {
+        auto entry = JSG_REQUIRE_NONNULL(jsg::JsValue::fromJson(js, line).tryCast<jsg::JsArray>(),
+            Error, "KV GET_BULK failed: malformed response line.");
+        auto key = entry.get(js, 0);
+        auto value = entry.get(js, 1);
+        if (parseJson) {
+          KJ_IF_SOME(str, value.tryCast<jsg::JsString>()) {
+            value = jsg::JsValue::fromJson(js, str);
+          }
+        }
+        handle.set(js, key, value);
+      });
+    };
+
+    KJ_IF_SOME(newline, rest.findLast('\n')) {
+      auto complete = rest.first(newline);
+      rest = rest.slice(newline + 1);
+      while (complete.size() > 0) {
+        KJ_IF_SOME(end, complete.findFirst('\n')) {
+          addLine(complete.first(end));
+          complete = complete.slice(end + 1);
+        } else {
+          addLine(complete);
+          break;
+        }
+      }
+    }
+
+    if (chunk.size() == 0) {
+      // End of the response. The last line doesn't need a trailing newline.
+      addLine(rest);
+      return js.resolvedPromise();
+    }
+    return readBulkLines(js, context, kj::mv(stream), kj::str(rest), kj::mv(map), parseJson,
+        remainingBytes - chunk.size());
+  });
+}
+
+jsg::Promise<KvNamespace::GetResult> KvNamespace::getBulk(jsg::Lock& js,
+    kj::Array<kj::String> names,
+    jsg::Optional<kj::OneOf<kj::String, GetOptions>> options) {
+  JSG_REQUIRE(names.size() > 0, TypeError, "KV GET_BULK requires at least one key.");
+  JSG_REQUIRE(names.size() <= kMaxBulkKeys, RangeError, "KV GET_BULK failed: ", names.size(),
+      " keys exceeds the limit of ", kMaxBulkKeys, " keys per call.");
+  for (auto& name: names) {
+    validateKeyName("GET_BULK", name);
+  }
+
+  auto& context = IoContext::current();
+
+  kj::StringPtr type = "text";
+  kj::Maybe<int> cacheTtl;
+  KJ_IF_SOME(oneOfOptions, options) {
+    KJ_SWITCH_ONEOF(oneOfOptions) {
+      KJ_CASE_ONEOF(t, kj::String) {
+        type = t;
+      }
+      KJ_CASE_ONEOF(options, GetOptions) {
+        KJ_IF_SOME(t, options.type) {
+          type = t;
+        }
+        cacheTtl = options.cacheTtl;
+      }
+    }
+  }
+  JSG_REQUIRE(type == "text" || type == "json", TypeError,
+      "Unknown response type. Possible types for a bulk get are \"text\" and \"json\".");
+  bool parseJson = type == "json";
+
+  // Every requested key is in the result, in the order requested, even if it doesn't exist.
+  auto map = js.map();
+  auto requestBody = js.obj();
+  auto keys = KJ_MAP(name, names) -> jsg::JsValue {
+    auto key = js.str(name);
+    map.set(js, key, js.null());
+    return key;
+  };
+  requestBody.set(js, "keys", js.arr(keys.asPtr()));
+  KJ_IF_SOME(ttl, cacheTtl) {
+    requestBody.set(js, "cacheTtl", js.num(ttl));
+  }
+  auto body = requestBody.toJson(js);
+
+  auto urlStr = kj::str("https://fake-host/bulk/get?urlencoded=true");
+
+  kj::HttpHeaders headers(context.getHeaderTable());
+  headers.set(kj::HttpHeaderId::CONTENT_TYPE, MimeType::JSON.toString());
+  auto client = getHttpClient(context, headers, LimitEnforcer::KvOpType::GET_BULK, urlStr);
+
+  auto request = client->request(kj::HttpMethod::POST, urlStr, headers, uint64_t(body.size()));
+  auto promise = request.body->write(body.asBytes())
+                     .attach(kj::mv(body), kj::mv(request.body))
+                     .then([response = kj::mv(request.response)]() mutable {
+    return kj::mv(response);
+  });
+
+  return context.awaitIo(js, kj::mv(promise),
+      [&context, client = kj::mv(client), map = jsg::JsRef(js, map), parseJson](jsg::Lock& js,
+          kj::HttpClient::Response&& response) mutable -> jsg::Promise<KvNamespace::GetResult> {
+    checkForErrorStatus("GET_BULK", response);
+
+    auto stream = newSystemStream(response.body.attach(kj::mv(client)),
+        getContentEncoding(
+            context, *response.headers, Response::BodyEncoding::AUTO, FeatureFlags::get(js)));
+    auto result = map.addRef(js);
+    return readBulkLines(js, context, context.addObject(kj::mv(stream)), kj::str(), kj::mv(map),
+        parseJson, context.getLimitEnforcer().getBufferingLimit())
+        .then(js, [result = kj::mv(result)](jsg::Lock& js) mutable {
+      return KvNamespace::GetResult(jsg::JsRef<jsg::JsValue>(js, result.getHandle(js)));
+    });
   });
 }
 
@@ -122,6 +384,7 @@ jsg::Promise<KvNamespace::GetWithMetadataResult> KvNamespace::getWithMetadata(
 
   auto& context = IoContext::current();
 
+  auto keyName = kj::str(name);
   kj::Url url;
   url.scheme = kj::str("https");
   url.host = kj::str("fake-host");
@@ -129,6 +392,7 @@ jsg::Promise<KvNamespace::GetWithMetadataResult> KvNamespace::getWithMetadata(
   url.query.add(kj::Url::QueryParam{kj::str("urlencoded"), kj::str("true")});
 
   kj::Maybe<kj::String> type;
+  kj::Maybe<kj::Duration> localTtl;
   KJ_IF_SOME(oneOfOptions, options) {
     KJ_SWITCH_ONEOF(oneOfOptions) {
       KJ_CASE_ONEOF(t, kj::String) {
@@ -140,6 +404,9 @@ jsg::Promise<KvNamespace::GetWithMetadataResult> KvNamespace::getWithMetadata(
         }
         KJ_IF_SOME(cacheTtl, options.cacheTtl) {
           url.query.add(kj::Url::QueryParam{kj::str("cache_ttl"), kj::str(cacheTtl)});
+          if (cacheTtl > 0) {
+            localTtl = cacheTtl * kj::SECONDS;
+          }
         }
       }
     }
@@ -147,6 +414,15 @@ jsg::Promise<KvNamespace::GetWithMetadataResult> KvNamespace::getWithMetadata(
 
   auto urlStr = url.toString(kj::Url::Context::HTTP_PROXY_REQUEST);
 
+  // Everything but streams is buffered anyway, so those reads can be shared and kept locally.
+  KJ_IF_SOME(t, type) {
+    if (t != "stream") {
+      return getBuffered(js, context, kj::mv(keyName), kj::mv(urlStr), kj::mv(t), localTtl);
+    }
+  } else {
+    return getBuffered(js, context, kj::mv(keyName), kj::mv(urlStr), kj::str("text"), localTtl);
+  }
+
   auto headers = kj::HttpHeaders(context.getHeaderTable());
   auto client = getHttpClient(context, headers, LimitEnforcer::KvOpType::GET, urlStr);
 
@@ -231,6 +507,133 @@ jsg::Promise<KvNamespace::GetWithMetadataResult> KvNamespace::getWithMetadata(
   });
 }
 
+jsg::Promise<KvNamespace::GetWithMetadataResult> KvNamespace::getBuffered(jsg::Lock& js,
+    IoContext& context,
+    kj::String name,
+    kj::String urlStr,
+    kj::String type,
+    kj::Maybe<kj::Duration> cacheTtl) {
+  auto now = kj::systemCoarseMonotonicClock().now();
+  auto span = context.makeUserTraceSpan("kv_local_cache"_kjc);
+  auto tagSpan = [&](const ReadCache::State& state, kj::StringPtr result) {
+    span.setTag("cloudflare.kv.local_cache.result"_kjc, kj::str(result));
+    span.setTag("cloudflare.kv.local_cache.hits"_kjc, static_cast<int64_t>(state.hits));
+    span.setTag("cloudflare.kv.local_cache.misses"_kjc, static_cast<int64_t>(state.misses));
+    span.setTag("cloudflare.kv.local_cache.coalesced"_kjc, static_cast<int64_t>(state.coalesced));
+  };
+
+  MaybeBufferedValue hit;
+  kj::Maybe<kj::Promise<MaybeBufferedValue>> waiting;
+  uint64_t writeCount;
+  {
+    auto lock = readCache->state.lockExclusive();
+    KJ_IF_SOME(entry, lock->entries.find(name)) {
+      auto age = now - entry.fetchTime;
+      KJ_IF_SOME(ttl, cacheTtl) {
+        // A read accepts a value that is no older than its own `cacheTtl`, just as the KV service
+        // would serve it from its cache.
+        if (age < kj::min(ttl, entry.ttl)) {
+          hit = kj::atomicAddRef(*entry.value);
+        }
+      }
+      if (age >= entry.ttl) {
+        lock->erase(name);
+      }
+    }
+
+    if (hit != kj::none) {
+      ++lock->hits;
+      tagSpan(*lock, "hit");
+    } else {
+      KJ_IF_SOME(inFlight, lock->inFlight.find(urlStr)) {
+        auto paf = kj::newPromiseAndCrossThreadFulfiller<MaybeBufferedValue>();
+        inFlight.waiters.add(kj::mv(paf.fulfiller));
+        waiting = kj::mv(paf.promise);
+        ++lock->coalesced;
+        tagSpan(*lock, "coalesced");
+      } else {
+        lock->inFlight.insert(kj::str(urlStr), {});
+        ++lock->misses;
+        tagSpan(*lock, "miss");
+      }
+    }
+    writeCount = lock->writeCount;
+  }
+
+  KJ_IF_SOME(value, hit) {
+    return js.resolvedPromise(toGetWithMetadataResult(js, *value, type));
+  }
+
+  KJ_IF_SOME(promise, waiting) {
+    return context.awaitIo(js, kj::mv(promise),
+        [self = JSG_THIS, name = kj::mv(name), urlStr = kj::mv(urlStr), type = kj::mv(type),
+            cacheTtl](jsg::Lock& js,
+            MaybeBufferedValue value) mutable -> jsg::Promise<GetWithMetadataResult> {
+      KJ_IF_SOME(v, value) {
+        return js.resolvedPromise(toGetWithMetadataResult(js, *v, type));
+      }
+      // The read we were waiting for failed or was canceled, so send our own request.
+      return self->getBuffered(
+          js, IoContext::current(), kj::mv(name), kj::mv(urlStr), kj::mv(type), cacheTtl);
+    });
+  }
+
+  // If this read fails or is canceled, tells the reads waiting for it to send their own requests.
+  auto leader = kj::heap(kj::defer([readCache = kj::atomicAddRef(*readCache),
+                                       urlStr = kj::str(urlStr)]() {
+    readCache->finish(urlStr, kj::none);
+  }));
+
+  auto headers = kj::HttpHeaders(context.getHeaderTable());
+  auto client = getHttpClient(context, headers, LimitEnforcer::KvOpType::GET, urlStr);
+  auto request = client->request(kj::HttpMethod::GET, urlStr, headers);
+
+  ContentEncodingOptions encodingOptions(FeatureFlags::get(js));
+  auto promise = request.response.then([&context, client = kj::mv(client), encodingOptions](
+                                           kj::HttpClient::Response&& response) mutable
+      -> kj::Promise<kj::Own<BufferedValue>> {
+    auto value = kj::atomicRefcounted<BufferedValue>();
+    value->cacheStatus = response.headers->get(context.getHeaderIds().cfCacheStatus)
+                             .map([](kj::StringPtr cs) { return kj::str(cs); });
+
+    if (response.statusCode == 404 || response.statusCode == 410) {
+      return kj::mv(value);
+    }
+
+    checkForErrorStatus("GET", response);
+
+    value->found = true;
+    value->metadata = response.headers->get(context.getHeaderIds().cfKvMetadata)
+                          .map([](kj::StringPtr m) { return kj::str(m); });
+
+    auto stream = newSystemStream(response.body.attach(kj::mv(client)),
+        getContentEncoding(
+            context, *response.headers, Response::BodyEncoding::AUTO, encodingOptions),
+        context);
+    return stream->readAllBytes(context.getLimitEnforcer().getBufferingLimit())
+        .attach(kj::mv(stream))
+        .then([value = kj::mv(value)](kj::Array<byte> body) mutable {
+      value->body = kj::mv(body);
+      return kj::mv(value);
+    });
+  }).then([readCache = kj::atomicAddRef(*readCache), name = kj::mv(name), urlStr = kj::mv(urlStr),
+               cacheTtl, now, writeCount, leader = kj::mv(leader)](
+              kj::Own<BufferedValue> mutableValue) mutable -> kj::Own<const BufferedValue> {
+    kj::Own<const BufferedValue> value = kj::mv(mutableValue);
+    KJ_IF_SOME(ttl, cacheTtl) {
+      readCache->store(kj::mv(name), kj::atomicAddRef(*value), now, ttl, writeCount);
+    }
+    readCache->finish(urlStr, kj::atomicAddRef(*value));
+    leader = nullptr;
+    return kj::mv(value);
+  });
+
+  return context.awaitIo(js, kj::mv(promise),
+      [type = kj::mv(type)](jsg::Lock& js, kj::Own<const BufferedValue> value) {
+    return toGetWithMetadataResult(js, *value, type);
+  });
+}
+
 jsg::Promise<jsg::JsRef<jsg::JsValue>> KvNamespace::list(
     jsg::Lock& js, jsg::Optional<ListOptions> options) {
   return js.evalNow([&] {
@@ -302,6 +705,12 @@ jsg::Promise<void> KvNamespace::put(jsg::Lock& js,
   return js.evalNow([&] {
     validateKeyName("PUT", name);
 
+    // Reads of this key that are kept locally or in flight may predate this write.
+    readCache->invalidate(name);
+    auto invalidateWhenDone = [readCache = kj::atomicAddRef(*readCache), name = kj::str(name)]() {
+      readCache->invalidate(name);
+    };
+
     auto& context = IoContext::current();
 
     kj::Url url;
@@ -405,7 +814,7 @@ jsg::Promise<void> KvNamespace::put(jsg::Lock& js,
       });
     });
 
-    return context.awaitIo(js, kj::mv(promise));
+    return context.awaitIo(js, promise.then(kj::mv(invalidateWhenDone)));
   });
 }
 
@@ -413,6 +822,12 @@ jsg::Promise<void> KvNamespace::delete_(jsg::Lock& js, kj::String name) {
   return js.evalNow([&] {
     validateKeyName("DELETE", name);
 
+    // Reads of this key that are kept locally or in flight may predate this write.
+    readCache->invalidate(name);
+    auto invalidateWhenDone = [readCache = kj::atomicAddRef(*readCache), name = kj::str(name)]() {
+      readCache->invalidate(name);
+    };
+
     auto& context = IoContext::current();
 
     auto urlStr = kj::str("https://fake-host/", kj::encodeUriComponent(name), "?urlencoded=true");
@@ -430,7 +845,7 @@ jsg::Promise<void> KvNamespace::delete_(jsg::Lock& js, kj::String name) {
       }).attach(kj::mv(client));
     });
 
-    return context.awaitIo(js, kj::mv(promise));
+    return context.awaitIo(js, promise.then(kj::mv(invalidateWhenDone)));
   });
 }
 
@@ -8,6 +8,10 @@
 #include <workerd/io/limit-enforcer.h>
 #include <workerd/jsg/jsg.h>
 
+#include <kj/map.h>
+#include <kj/mutex.h>
+#include <kj/time.h>
+
 namespace kj {
 class HttpClient;
 class HttpHeaders;
@@ -35,7 +39,8 @@ class KvNamespace: public jsg::Object {
   // `additionalHeaders` is what gets appended to every outbound request.
   explicit KvNamespace(kj::Array<AdditionalHeader> additionalHeaders, uint subrequestChannel)
       : additionalHeaders(kj::mv(additionalHeaders)),
-        subrequestChannel(subrequestChannel) {}
+        subrequestChannel(subrequestChannel),
+        readCache(kj::atomicRefcounted<ReadCache>()) {}
 
   struct GetOptions {
     jsg::Optional<kj::String> type;
@@ -50,8 +55,11 @@ class KvNamespace: public jsg::Object {
   using GetResult = kj::Maybe<
       kj::OneOf<jsg::Ref<ReadableStream>, kj::Array<byte>, kj::String, jsg::JsRef<jsg::JsValue>>>;
 
+  // Passing an array of keys reads all of them with a single subrequest and resolves to a Map from
+  // each key to its value, or null if the key doesn't exist. Only the "text" and "json" types are
+  // supported for bulk reads.
   jsg::Promise<GetResult> get(jsg::Lock& js,
-      kj::String name,
+      kj::OneOf<kj::String, kj::Array<kj::String>> name,
       jsg::Optional<kj::OneOf<kj::String, GetOptions>> options,
       CompatibilityFlags::Reader flags);
 
@@ -141,6 +149,11 @@ class KvNamespace: public jsg::Object {
       get<ExpectedValue = unknown>(key: Key, options?: KVNamespaceGetOptions<"json">): Promise<ExpectedValue | null>;
       get(key: Key, options?: KVNamespaceGetOptions<"arrayBuffer">): Promise<ArrayBuffer | null>;
       get(key: Key, options?: KVNamespaceGetOptions<"stream">): Promise<ReadableStream | null>;
+      get(key: Key[], type: "text"): Promise<Map<string, string | null>>;
+      get<ExpectedValue = unknown>(key: Key[], type: "json"): Promise<Map<string, ExpectedValue | null>>;
+      get(key: Key[], options?: Partial<KVNamespaceGetOptions<undefined>>): Promise<Map<string, string | null>>;
+      get(key: Key[], options?: KVNamespaceGetOptions<"text">): Promise<Map<string, string | null>>;
+      get<ExpectedValue = unknown>(key: Key[], options?: KVNamespaceGetOptions<"json">): Promise<Map<string, ExpectedValue | null>>;
 
       list<Metadata = unknown>(options?: KVNamespaceListOptions): Promise<KVNamespaceListResult<Metadata, Key>>;
 
@@ -176,8 +189,92 @@ class KvNamespace: public jsg::Object {
       kj::StringPtr urlStr);
 
  private:
+  // A value read by get() or getWithMetadata() with a type other than "stream". It is fully
+  // buffered, so it can be shared by concurrent reads on this isolate and kept in `readCache`.
+  struct BufferedValue: public kj::AtomicRefcounted {
+    // False if the key doesn't exist.
+    bool found = false;
+    kj::Array<const byte> body;
+    kj::Maybe<kj::String> metadata;
+    kj::Maybe<kj::String> cacheStatus;
+  };
+
+  using MaybeBufferedValue = kj::Maybe<kj::Own<const BufferedValue>>;
+
+  // Buffered reads of this namespace on this isolate. Identical reads that are in flight at the
+  // same time share one subrequest, and reads with a `cacheTtl` are answered locally for that long.
+  //
+  // A KvNamespace lives as long as its isolate, but a read's promise may be destroyed without the
+  // isolate lock held, so this is refcounted and guarded by a mutex rather than owned directly.
+  struct ReadCache: public kj::AtomicRefcounted {
+    struct Entry {
+      kj::Own<const BufferedValue> value;
+      kj::TimePoint fetchTime;
+      kj::Duration ttl;
+    };
+
+    struct InFlight {
+      // Reads waiting for the leading read's value. They're given kj::none, and then send their
+      // own request, if the leading read fails or is canceled.
+      kj::Vector<kj::Own<kj::CrossThreadPromiseFulfiller<MaybeBufferedValue>>> waiters;
+    };
+
+    struct State {
+      // Kept values, by key name.
+      kj::HashMap<kj::String, Entry> entries;
+      size_t totalSize = 0;
+
+      // In-flight reads, by request URL.
+      kj::HashMap<kj::String, InFlight> inFlight;
+
+      // Incremented by every put() and delete(). A value read while one of them was in progress
+      // might be older than what was written, so it isn't kept.
+      uint64_t writeCount = 0;
+
+      uint64_t hits = 0;
+      uint64_t misses = 0;
+      uint64_t coalesced = 0;
+
+      void erase(kj::StringPtr name);
+    };
+
+    kj::MutexGuarded<State> state;
+
+    // Drops the kept value for `name`, and keeps reads that are in flight from keeping theirs.
+    void invalidate(kj::StringPtr name) const;
+
+    // Keeps `value` for `name`, unless it's too large or a write happened since `writeCountBefore`.
+    void store(kj::String name,
+        kj::Own<const BufferedValue> value,
+        kj::TimePoint fetchTime,
+        kj::Duration ttl,
+        uint64_t writeCountBefore) const;
+
+    // Ends the in-flight read of `urlStr`, handing `value` to the reads waiting for it.
+    void finish(kj::StringPtr urlStr, MaybeBufferedValue value) const;
+  };
+
+  // Reads `names` with one POST to `/bulk/get`. The request body is a JSON object with the `keys`
+  // to read and, optionally, their `cacheTtl`. The response body has one line for each key that
+  // exists, holding a JSON array of the key and its value as a string. The lines are parsed as they
+  // arrive, so a large response is never buffered whole.
+  jsg::Promise<GetResult> getBulk(jsg::Lock& js,
+      kj::Array<kj::String> names,
+      jsg::Optional<kj::OneOf<kj::String, GetOptions>> options);
+
+  static GetWithMetadataResult toGetWithMetadataResult(
+      jsg::Lock& js, const BufferedValue& value, kj::StringPtr type);
+
+  jsg::Promise<GetWithMetadataResult> getBuffered(jsg::Lock& js,
+      IoContext& context,
+      kj::String name,
+      kj::String urlStr,
+      kj::String type,
+      kj::Maybe<kj::Duration> cacheTtl);
+
   kj::Array<AdditionalHeader> additionalHeaders;
   uint subrequestChannel;
+  kj::Own<const ReadCache> readCache;
 };
 
 #define EW_KV_ISOLATE_TYPES                                                                        \
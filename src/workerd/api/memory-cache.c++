@@ -20,22 +20,115 @@ static double getCurrentTimeOutsideIoContext() {
   return (now - kj::UNIX_EPOCH) / kj::MILLISECONDS;
 }
 
-// Returns true if the given expiration time exists and has passed. If this is
-// called in an I/O context, the I/O context's timer is used. Otherwise,
-// if allowOutsideIoContext is true, the system clock is used (see above).
-// Lastly, if this function is called from outside of an I/O context and if
-// allowOutsideIoContext is false, this function returns false regardless
-// of whether the expiration time has passed.
+// Returns the current calendar time in milliseconds. If this is called in an
+// I/O context, the I/O context's timer is used. Otherwise, if
+// allowOutsideIoContext is true, the system clock is used (see above). Lastly,
+// if this function is called from outside of an I/O context and if
+// allowOutsideIoContext is false, this function returns nothing.
+static kj::Maybe<double> currentTime(bool allowOutsideIoContext = false) {
+  if (IoContext::hasCurrent()) {
+    return dateNow();
+  } else if (allowOutsideIoContext) {
+    return getCurrentTimeOutsideIoContext();
+  } else {
+    return kj::none;
+  }
+}
+
+// Returns true if the given expiration time exists and has passed, according to
+// currentTime(allowOutsideIoContext). If the current time is unknown, this
+// function returns false regardless of whether the expiration time has passed.
 static bool hasExpired(const kj::Maybe<double>& expiration, bool allowOutsideIoContext = false) {
   KJ_IF_SOME(e, expiration) {
-    double now = (allowOutsideIoContext && !IoContext::hasCurrent())
-        ? getCurrentTimeOutsideIoContext()
-        : dateNow();
-    return e < now;
+    KJ_IF_SOME(now, currentTime(allowOutsideIoContext)) {
+      return e < now;
+    }
   }
   return false;
 }
 
+// Ticks of the expiration wheel are whole milliseconds. Times before the epoch
+// are treated as the epoch, and times too far in the future to matter (such as
+// infinity) as MAX_EXPIRATION_TICK.
+static constexpr int64_t MAX_EXPIRATION_TICK = int64_t(1) << 60;
+
+static int64_t expirationTick(double time) {
+  if (!(time > 0)) return 0;
+  if (time >= static_cast<double>(MAX_EXPIRATION_TICK)) return MAX_EXPIRATION_TICK;
+  return static_cast<int64_t>(time);
+}
+
+void CacheExpirationWheel::add(kj::StringPtr key, double expiration) {
+  insert(Record{.key = kj::str(key), .expiration = expiration});
+  recordCount++;
+}
+
+void CacheExpirationWheel::insert(Record&& record) {
+  // A record whose time has already come goes into the current slot, which the
+  // next sweep looks at.
+  int64_t tick = kj::max(expirationTick(record.expiration), currentTick);
+  for (uint level = 0; level < LEVEL_COUNT; level++) {
+    uint shift = level * SLOT_BITS;
+    if ((tick >> shift) - (currentTick >> shift) < SLOT_COUNT) {
+      slots[level][(tick >> shift) % SLOT_COUNT].add(kj::mv(record));
+      return;
+    }
+  }
+  overflow.add(kj::mv(record));
+}
+
+void CacheExpirationWheel::sweep(
+    double now, kj::FunctionParam<void(kj::StringPtr key, double expiration)> expired) {
+  // The wheel never moves backwards, even if the clock does.
+  int64_t previousTick = currentTick;
+  currentTick = kj::max(expirationTick(now), previousTick);
+
+  kj::Vector<Record> passed;
+  auto take = [&](kj::Vector<Record>& slot) {
+    for (auto& record: slot) {
+      passed.add(kj::mv(record));
+    }
+    slot.clear();
+  };
+
+  for (uint level = 0; level < LEVEL_COUNT; level++) {
+    uint shift = level * SLOT_BITS;
+    int64_t from = previousTick >> shift;
+    int64_t to = currentTick >> shift;
+    // A level's current slot only holds records at level 0, since any other
+    // record in it would have been placed at a lower level.
+    if (level > 0) from++;
+    for (int64_t slot = from; slot <= to && slot - from < SLOT_COUNT; slot++) {
+      take(slots[level][slot % SLOT_COUNT]);
+    }
+  }
+
+  // Records in `overflow` may fit into the top level once it has moved on.
+  uint topShift = (LEVEL_COUNT - 1) * SLOT_BITS;
+  if ((previousTick >> topShift) != (currentTick >> topShift)) {
+    take(overflow);
+  }
+
+  for (auto& record: passed) {
+    if (record.expiration < now) {
+      recordCount--;
+      expired(record.key, record.expiration);
+    } else {
+      insert(kj::mv(record));
+    }
+  }
+}
+
+void CacheExpirationWheel::clear() {
+  for (auto& level: slots) {
+    for (auto& slot: level) {
+      slot.clear();
+    }
+  }
+  overflow.clear();
+  recordCount = 0;
+}
+
 SharedMemoryCache::SharedMemoryCache(kj::Maybe<const MemoryCacheProvider&> provider,
     kj::StringPtr id,
     kj::Maybe<AdditionalResizeMemoryLimitHandler&> additionalResizeMemoryLimitHandler,
@@ -44,7 +137,11 @@ SharedMemoryCache::SharedMemoryCache(kj::Maybe<const MemoryCacheProvider&> provi
       provider(provider),
       id(kj::str(id)),
       additionalResizeMemoryLimitHandler(additionalResizeMemoryLimitHandler),
-      timer(timer) {}
+      timer(timer) {
+  KJ_IF_SOME(p, provider) {
+    hostTable = p.getHostTable();
+  }
+}
 
 SharedMemoryCache::~SharedMemoryCache() noexcept(false) {
   KJ_IF_SOME(p, provider) {
@@ -84,12 +181,13 @@ void SharedMemoryCache::resize(ThreadUnsafeData& data) const {
   if (data.effectiveLimits.maxKeys == 0) {
     data.totalValueSize = 0;
     data.cache.clear();
+    data.expirations.clear();
     return;
   }
 
   // First, remove any values that might be too large.
   while (data.cache.size() != 0) {
-    MemoryCacheEntry& largestEntry = *data.cache.ordered<2>().begin();
+    MemoryCacheEntry& largestEntry = *data.cache.ordered<1>().begin();
     if (largestEntry.size() <= data.effectiveLimits.maxValueSize) {
       break;
     }
@@ -109,30 +207,56 @@ kj::Maybe<kj::Own<CacheValue>> SharedMemoryCache::getWhileLocked(
   KJ_IF_SOME(existingCacheEntry, data.cache.find(key)) {
     if (hasExpired(existingCacheEntry.expiration)) {
       // The cache entry has an associated expiration time and that time has
-      // passed (according to the calling IoContext's timer).
-      data.totalValueSize -= existingCacheEntry.size();
-      data.cache.erase(existingCacheEntry);
+      // passed (according to the calling IoContext's timer). Keep it for stale
+      // reads until its stale-while-revalidate period is over, too.
+      if (hasExpired(existingCacheEntry.removalTime())) {
+        data.totalValueSize -= existingCacheEntry.size();
+        data.cache.erase(existingCacheEntry);
+      }
       return kj::none;
     }
 
-    // Obtain a reference to the cache value before we kj::mv the cache entry.
-    auto cacheValue = kj::atomicAddRef(*existingCacheEntry.value);
-
-    // Update the liveliness.
-    MemoryCacheEntry entry = data.cache.release(existingCacheEntry);
-    entry.liveliness = data.stepLiveliness();
-    data.cache.insert(kj::mv(entry));
+    existingCacheEntry.liveliness.set(data.stepLiveliness());
+    return kj::atomicAddRef(*existingCacheEntry.value);
+  } else {
+    return kj::none;
+  }
+}
 
-    return kj::mv(cacheValue);
+kj::Maybe<kj::Own<CacheValue>> SharedMemoryCache::getWhileShared(
+    const ThreadUnsafeData& data, const kj::String& key) const {
+  KJ_IF_SOME(existingCacheEntry, data.cache.find(key)) {
+    if (hasExpired(existingCacheEntry.expiration)) {
+      return kj::none;
+    }
+    existingCacheEntry.liveliness.set(data.stepLiveliness());
+    return kj::atomicAddRef(*existingCacheEntry.value);
   } else {
     return kj::none;
   }
 }
 
+kj::Maybe<kj::Own<CacheValue>> SharedMemoryCache::getStaleWhileShared(
+    const ThreadUnsafeData& data, const kj::String& key, double staleWhileRevalidate) const {
+  KJ_IF_SOME(existingCacheEntry, data.cache.find(key)) {
+    KJ_IF_SOME(expiration, existingCacheEntry.expiration) {
+      KJ_IF_SOME(now, currentTime()) {
+        double gracePeriod = kj::min(staleWhileRevalidate, existingCacheEntry.staleWhileRevalidate);
+        if (expiration < now && now - expiration < gracePeriod) {
+          existingCacheEntry.liveliness.set(data.stepLiveliness());
+          return kj::atomicAddRef(*existingCacheEntry.value);
+        }
+      }
+    }
+  }
+  return kj::none;
+}
+
 void SharedMemoryCache::putWhileLocked(ThreadUnsafeData& data,
     const kj::String& key,
     kj::Own<CacheValue>&& value,
-    kj::Maybe<double> expiration) const {
+    kj::Maybe<double> expiration,
+    double staleWhileRevalidate) const {
   size_t valueSize = value->bytes.size();
   if (valueSize > data.effectiveLimits.maxValueSize) {
     // Silently drop the value. For consistency, also drop the previous value,
@@ -148,6 +272,20 @@ void SharedMemoryCache::putWhileLocked(ThreadUnsafeData& data,
     return;
   }
 
+  // Expired entries are otherwise only removed when they are read or when
+  // space is needed, so sweep them now and then to release their memory.
+  KJ_IF_SOME(now, currentTime()) {
+    auto monotonicNow = timer.now();
+    bool sweepDue = true;
+    KJ_IF_SOME(last, data.lastExpirationSweep) {
+      sweepDue = monotonicNow - last >= EXPIRATION_SWEEP_INTERVAL;
+    }
+    if (sweepDue) {
+      data.lastExpirationSweep = monotonicNow;
+      sweepExpiredWhileLocked(data, now);
+    }
+  }
+
   kj::Maybe<MemoryCacheEntry&> existingEntry = data.cache.find(key.asPtr());
   KJ_IF_SOME(entry, existingEntry) {
     size_t oldValueSize = entry.size();
@@ -159,11 +297,15 @@ void SharedMemoryCache::putWhileLocked(ThreadUnsafeData& data,
       // risk of evicting it.
       evictNextWhileLocked(data);
     }
-    updatedEntry.liveliness = data.stepLiveliness();
+    updatedEntry.liveliness.set(data.stepLiveliness());
     updatedEntry.value = kj::mv(value);
     updatedEntry.expiration = expiration;
-    data.cache.insert(kj::mv(updatedEntry));
+    updatedEntry.staleWhileRevalidate = staleWhileRevalidate;
+    auto& inserted = data.cache.insert(kj::mv(updatedEntry));
     data.totalValueSize += valueSize;
+    KJ_IF_SOME(removalTime, inserted.removalTime()) {
+      addExpirationWhileLocked(data, key, removalTime);
+    }
   } else {
     // Ensure that adding a new key won't push us over the limit.
     if (data.cache.size() >= data.effectiveLimits.maxKeys) {
@@ -178,33 +320,133 @@ void SharedMemoryCache::putWhileLocked(ThreadUnsafeData& data,
       data.stepLiveliness(),
       kj::mv(value),
       expiration,
+      staleWhileRevalidate,
     };
-    data.cache.insert(kj::mv(newEntry));
+    auto& inserted = data.cache.insert(kj::mv(newEntry));
     data.totalValueSize += valueSize;
+    KJ_IF_SOME(removalTime, inserted.removalTime()) {
+      addExpirationWhileLocked(data, key, removalTime);
+    }
   }
 }
 
+kj::Maybe<kj::Own<CacheValue>> SharedMemoryCache::getFromHost(const kj::String& key) const {
+  auto& table = KJ_UNWRAP_OR(hostTable, return kj::none);
+  auto now = KJ_UNWRAP_OR(currentTime(), return kj::none);
+  // Entries of different caches share the table, so the key includes the cache's id.
+  auto hostKey = kj::str(id, '\0', key);
+  auto entry = KJ_UNWRAP_OR(table.get(hostKey.asBytes(), now), return kj::none);
+
+  auto value = kj::atomicRefcounted<CacheValue>(kj::mv(entry.value));
+  auto data = this->data.lockExclusive();
+  putWhileLocked(*data, key, kj::atomicAddRef(*value), entry.expiration);
+  return kj::mv(value);
+}
+
+void SharedMemoryCache::putToHost(
+    const kj::String& key, const CacheValue& value, kj::Maybe<double> expiration) const {
+  auto& table = KJ_UNWRAP_OR(hostTable, return);
+  auto now = KJ_UNWRAP_OR(currentTime(), return);
+  auto hostKey = kj::str(id, '\0', key);
+  table.put(hostKey.asBytes(), value.bytes, expiration, now);
+}
+
 void SharedMemoryCache::evictNextWhileLocked(
     ThreadUnsafeData& data, bool allowOutsideIoContext) const {
   // The caller is responsible for ensuring that the cache is not empty already.
   KJ_REQUIRE(data.cache.size() > 0);
 
-  // If there is an entry that has expired already, evict that one.
-  MemoryCacheEntry& maybeExpired = *data.cache.ordered<3>().begin();
-  KJ_ASSERT(data.totalValueSize >= maybeExpired.size());
-  if (hasExpired(maybeExpired.expiration, allowOutsideIoContext)) {
-    data.totalValueSize -= maybeExpired.size();
-    data.cache.erase(maybeExpired);
-    return;
+  // If there are entries that have expired already, evict those.
+  KJ_IF_SOME(now, currentTime(allowOutsideIoContext)) {
+    if (sweepExpiredWhileLocked(data, now) > 0) {
+      return;
+    }
   }
 
   // Otherwise, if no entry has expired, evict the least recently used entry.
-  MemoryCacheEntry& leastRecentlyUsed = *data.cache.ordered<1>().begin();
+  MemoryCacheEntry& leastRecentlyUsed = sampleLeastRecentlyUsedWhileLocked(data);
   KJ_ASSERT(data.totalValueSize >= leastRecentlyUsed.size());
   data.totalValueSize -= leastRecentlyUsed.size();
   data.cache.erase(leastRecentlyUsed);
 }
 
+size_t SharedMemoryCache::sweepExpiredWhileLocked(ThreadUnsafeData& data, double now) const {
+  size_t count = 0;
+  data.expirations.sweep(now, [&](kj::StringPtr key, double removalTime) {
+    // Skip records of entries that have since been updated or erased.
+    KJ_IF_SOME(entry, data.cache.find(key)) {
+      KJ_IF_SOME(t, entry.removalTime()) {
+        if (t == removalTime) {
+          KJ_ASSERT(data.totalValueSize >= entry.size());
+          data.totalValueSize -= entry.size();
+          data.cache.erase(entry);
+          count++;
+        }
+      }
+    }
+  });
+  return count;
+}
+
+// How many records of entries that have been updated or erased the expiration
+// wheel may hold, beyond one per entry, before it is rebuilt.
+static constexpr size_t EXPIRATION_WHEEL_SLACK = 1024;
+
+void SharedMemoryCache::addExpirationWhileLocked(
+    ThreadUnsafeData& data, const kj::String& key, double removalTime) const {
+  data.expirations.add(key, removalTime);
+
+  // Records of entries that are updated or erased stay in the wheel until they
+  // expire. Rebuilding the wheel once they pile up keeps it proportional to the
+  // cache, and costs amortized constant time per record.
+  if (data.expirations.size() > 2 * data.cache.size() + EXPIRATION_WHEEL_SLACK) {
+    data.expirations.clear();
+    for (auto& entry: data.cache) {
+      KJ_IF_SOME(t, entry.removalTime()) {
+        data.expirations.add(entry.key, t);
+      }
+    }
+  }
+}
+
+// How often putWhileLocked() sweeps expired entries, see there.
+static constexpr kj::Duration EXPIRATION_SWEEP_INTERVAL = 1 * kj::SECONDS;
+
+// How many entries eviction compares to approximate the least recently used
+// one. With 16 samples, the evicted entry is very likely among the least
+// recently used tenth of the cache.
+static constexpr size_t EVICTION_SAMPLE_SIZE = 16;
+
+MemoryCacheEntry& SharedMemoryCache::sampleLeastRecentlyUsedWhileLocked(
+    ThreadUnsafeData& data) const {
+  auto entries = kj::arrayPtr(data.cache.begin(), data.cache.size());
+  KJ_REQUIRE(entries.size() > 0);
+
+  MemoryCacheEntry* oldest = &entries[0];
+  auto consider = [&](MemoryCacheEntry& entry) {
+    if (entry.liveliness.get() < oldest->liveliness.get()) {
+      oldest = &entry;
+    }
+  };
+
+  if (entries.size() <= EVICTION_SAMPLE_SIZE) {
+    // Small caches evict the exact least recently used entry.
+    for (auto& entry: entries) {
+      consider(entry);
+    }
+  } else {
+    for (size_t i = 0; i < EVICTION_SAMPLE_SIZE; i++) {
+      // xorshift64
+      auto& state = data.evictionSampleState;
+      state ^= state << 13;
+      state ^= state >> 7;
+      state ^= state << 17;
+      consider(entries[state % entries.size()]);
+    }
+  }
+  return *oldest;
+}
+
 void SharedMemoryCache::removeIfExistsWhileLocked(
     ThreadUnsafeData& data, const kj::String& key) const {
   KJ_IF_SOME(entry, data.cache.find(key)) {
@@ -244,24 +486,68 @@ SharedMemoryCache::Use::~Use() noexcept(false) {
 
 kj::Maybe<kj::Own<CacheValue>> SharedMemoryCache::Use::getWithoutFallback(
     const kj::String& key, SpanBuilder& span) const {
-  kj::Locked<ThreadUnsafeData> data = [&] {
-    auto memoryCacheLockRecord =
-        ScopedDurationTagger(span, memoryCachekLockWaitTimeTag, cache->timer);
-    return cache->data.lockExclusive();
-  }();
-  return cache->getWhileLocked(*data, key);
-}
-
-kj::OneOf<kj::Own<CacheValue>, kj::Promise<SharedMemoryCache::Use::GetWithFallbackOutcome>>
-SharedMemoryCache::Use::getWithFallback(const kj::String& key, SpanBuilder& span) const {
-  kj::Locked<ThreadUnsafeData> data = [&] {
-    auto memoryCacheLockRecord =
-        ScopedDurationTagger(span, memoryCachekLockWaitTimeTag, cache->timer);
-    return cache->data.lockExclusive();
-  }();
+  {
+    kj::Locked<const ThreadUnsafeData> data = [&] {
+      auto memoryCacheLockRecord =
+          ScopedDurationTagger(span, memoryCachekLockWaitTimeTag, cache->timer);
+      return cache->data.lockShared();
+    }();
+    KJ_IF_SOME(value, cache->getWhileShared(*data, key)) {
+      return kj::mv(value);
+    }
+  }
+  return cache->getFromHost(key);
+}
+
+kj::OneOf<kj::Own<CacheValue>,
+    SharedMemoryCache::Use::StaleValue,
+    kj::Promise<SharedMemoryCache::Use::GetWithFallbackOutcome>>
+SharedMemoryCache::Use::getWithFallback(
+    const kj::String& key, SpanBuilder& span, double staleWhileRevalidate) const {
+  // Most reads find a value, which only requires a shared lock. So do stale
+  // reads while another read revalidates the value. The lock wait time reported
+  // for a miss includes waiting for both locks.
+  kj::Maybe<ScopedDurationTagger> memoryCacheLockRecord;
+  memoryCacheLockRecord.emplace(span, memoryCachekLockWaitTimeTag, cache->timer);
+  {
+    auto data = cache->data.lockShared();
+    KJ_IF_SOME(existingValue, cache->getWhileShared(*data, key)) {
+      memoryCacheLockRecord = kj::none;
+      return kj::mv(existingValue);
+    }
+    if (staleWhileRevalidate > 0 && data->inProgress.find(key) != kj::none) {
+      KJ_IF_SOME(staleValue, cache->getStaleWhileShared(*data, key, staleWhileRevalidate)) {
+        memoryCacheLockRecord = kj::none;
+        return StaleValue{.value = kj::mv(staleValue), .revalidate = kj::none};
+      }
+    }
+  }
+
+  // Another process on this host may have produced the value already.
+  KJ_IF_SOME(hostValue, cache->getFromHost(key)) {
+    memoryCacheLockRecord = kj::none;
+    return kj::mv(hostValue);
+  }
+
+  auto data = cache->data.lockExclusive();
+  memoryCacheLockRecord = kj::none;
   KJ_IF_SOME(existingValue, cache->getWhileLocked(*data, key)) {
     return kj::mv(existingValue);
-  } else KJ_IF_SOME(existingInProgress, data->inProgress.find(key)) {
+  }
+
+  if (staleWhileRevalidate > 0) {
+    KJ_IF_SOME(staleValue, cache->getStaleWhileShared(*data, key, staleWhileRevalidate)) {
+      // Only the first stale read refreshes the value. The others just return
+      // the stale value until the refreshed one is stored.
+      if (data->inProgress.find(key) != kj::none) {
+        return StaleValue{.value = kj::mv(staleValue), .revalidate = kj::none};
+      }
+      auto& newEntry = data->inProgress.insert(kj::heap<InProgress>(kj::str(key)));
+      return StaleValue{.value = kj::mv(staleValue), .revalidate = prepareFallback(*newEntry)};
+    }
+  }
+
+  KJ_IF_SOME(existingInProgress, data->inProgress.find(key)) {
     // We return a Promise, but we keep the fulfiller. We might fulfill it
     // from a different thread, so we need a cross-thread fulfiller here.
     auto pair = kj::newPromiseAndCrossThreadFulfiller<GetWithFallbackOutcome>();
@@ -303,9 +589,10 @@ SharedMemoryCache::Use::FallbackDoneCallback SharedMemoryCache::Use::prepareFall
       // The fallback succeeded. Store the value in the cache and propagate it to
       // all waiting requests, even if it has expired already.
       status.hasSettled = true;
+      cache->putToHost(inProgress.key, *result.value, result.expiration);
       auto data = cache->data.lockExclusive();
-      cache->putWhileLocked(
-          *data, kj::str(inProgress.key), kj::atomicAddRef(*result.value), result.expiration);
+      cache->putWhileLocked(*data, kj::str(inProgress.key), kj::atomicAddRef(*result.value),
+          result.expiration, result.staleWhileRevalidate);
       for (auto& waiter: inProgress.waiting) {
         waiter.fulfiller->fulfill(kj::atomicAddRef(*result.value));
       }
@@ -375,59 +662,160 @@ static kj::Own<CacheValue> hackySerialize(jsg::Lock& js, jsg::JsRef<jsg::JsValue
   });
 }
 
+// Deeply freezes a deserialized value so that it can be shared between reads. Returns false,
+// possibly after freezing part of the value, if the value contains objects whose contents can be
+// changed even when frozen.
+static bool tryFreezeForSharing(v8::Local<v8::Context> context, v8::Local<v8::Value> value) {
+  if (!value->IsObject()) {
+    return true;
+  }
+  if (value->IsMap() || value->IsSet() || value->IsDate() || value->IsRegExp() ||
+      value->IsArrayBuffer() || value->IsArrayBufferView() || value->IsSharedArrayBuffer()) {
+    return false;
+  }
+
+  v8::HandleScope scope(context->GetIsolate());
+  auto obj = value.As<v8::Object>();
+  auto names = jsg::check(obj->GetPropertyNames(context, v8::KeyCollectionMode::kOwnOnly,
+      v8::ALL_PROPERTIES, v8::IndexFilter::kIncludeIndices));
+  for (auto i: kj::zeroTo(names->Length())) {
+    auto property = jsg::check(obj->Get(context, jsg::check(names->Get(context, i))));
+    if (!tryFreezeForSharing(context, property)) {
+      return false;
+    }
+  }
+  jsg::check(obj->SetIntegrityLevel(context, v8::IntegrityLevel::kFrozen));
+  return true;
+}
+
+jsg::JsValue MemoryCache::deserialize(jsg::Lock& js, kj::Own<CacheValue> serialized) {
+  auto readValue = [&]() {
+    jsg::Deserializer deserializer(js, serialized->bytes.asPtr());
+    return deserializer.readValue(js);
+  };
+
+  if (!shareDeserializedValues) {
+    return readValue();
+  }
+
+  KJ_IF_SOME(existing, deserializedValues.find(serialized.get())) {
+    KJ_IF_SOME(value, existing.value) {
+      return value.getHandle(js);
+    }
+    return readValue();
+  }
+
+  if (deserializedValues.size() >= nextSweepSize) {
+    deserializedValues.eraseAll(
+        [](const CacheValue*, DeserializedValue& entry) { return entry.serialized->isEvicted(); });
+    nextSweepSize = kj::max(MIN_SWEEP_SIZE, deserializedValues.size() * 2);
+  }
+
+  auto value = readValue();
+  kj::Maybe<jsg::JsRef<jsg::JsValue>> shared;
+  if (tryFreezeForSharing(js.v8Context(), value)) {
+    shared = jsg::JsRef(js, value);
+  } else {
+    // The first copy may have been partially frozen.
+    value = readValue();
+  }
+  const CacheValue* key = serialized.get();
+  deserializedValues.insert(key, DeserializedValue{kj::mv(serialized), kj::mv(shared)});
+  return value;
+}
+
+void MemoryCache::visitForGc(jsg::GcVisitor& visitor) {
+  for (auto& entry: deserializedValues) {
+    KJ_IF_SOME(value, entry.value.value) {
+      visitor.visit(value);
+    }
+  }
+}
+
+// Invokes a fallback function and stores the value it produces through `callback`.
+static jsg::Promise<jsg::JsRef<jsg::JsValue>> runFallback(jsg::Lock& js,
+    MemoryCache::FallbackFunction& fallback,
+    kj::String key,
+    SharedMemoryCache::Use::FallbackDoneCallback callback,
+    double staleWhileRevalidate) {
+  auto& context = IoContext::current();
+  auto heapCallback = kj::heap(kj::mv(callback));
+
+  return js.evalNow([&]() { return fallback(js, kj::mv(key)); })
+      .then(js,
+          [callback = context.addObject(*heapCallback), staleWhileRevalidate](
+              jsg::Lock& js, CacheValueProduceResult result) mutable -> jsg::JsRef<jsg::JsValue> {
+    // NOTE: `callback` is IoPtr, not IoOwn. The catch block gets the IoOwn, which
+    //   ensures the object still exists at this point.
+    auto serialized = hackySerialize(js, result.value);
+    KJ_IF_SOME(expiration, result.expiration) {
+      JSG_REQUIRE(!kj::isNaN(expiration), TypeError, "Expiration time must not be NaN.");
+    }
+    (*callback)(SharedMemoryCache::Use::FallbackResult{
+      kj::mv(serialized), result.expiration, staleWhileRevalidate});
+    return kj::mv(result.value);
+  })
+      .catch_(js,
+          [callback = context.addObject(kj::mv(heapCallback))](
+              jsg::Lock& js, jsg::Value&& exception) mutable -> jsg::JsRef<jsg::JsValue> {
+    (*callback)(kj::none);
+    js.throwException(kj::mv(exception));
+  });
+}
+
 jsg::Promise<jsg::JsRef<jsg::JsValue>> MemoryCache::read(jsg::Lock& js,
     jsg::NonCoercible<kj::String> key,
-    jsg::Optional<FallbackFunction> optionalFallback) {
+    jsg::Optional<FallbackFunction> optionalFallback,
+    jsg::Optional<MemoryCacheReadOptions> options) {
   if (key.value.size() > MAX_KEY_SIZE) {
     return js.rejectedPromise<jsg::JsRef<jsg::JsValue>>(js.rangeError("Key too large."_kj));
   }
 
+  double staleWhileRevalidate = 0;
+  KJ_IF_SOME(o, options) {
+    KJ_IF_SOME(gracePeriod, o.staleWhileRevalidate) {
+      if (!(gracePeriod >= 0)) {
+        return js.rejectedPromise<jsg::JsRef<jsg::JsValue>>(
+            js.rangeError("staleWhileRevalidate must be a non-negative number."_kj));
+      }
+      staleWhileRevalidate = gracePeriod;
+    }
+  }
+
   auto readSpan = IoContext::current().makeTraceSpan("memory_cache_read"_kjc);
   auto userReadSpan = IoContext::current().makeUserTraceSpan("memory_cache_read"_kjc);
 
   KJ_IF_SOME(fallback, optionalFallback) {
-    KJ_SWITCH_ONEOF(cacheUse.getWithFallback(key.value, readSpan)) {
+    KJ_SWITCH_ONEOF(cacheUse.getWithFallback(key.value, readSpan, staleWhileRevalidate)) {
       KJ_CASE_ONEOF(result, kj::Own<CacheValue>) {
         // Optimization: Don't even release the isolate lock if the value is aleady in cache.
-        jsg::Deserializer deserializer(js, result->bytes.asPtr());
-        return js.resolvedPromise(jsg::JsRef(js, deserializer.readValue(js)));
+        return js.resolvedPromise(jsg::JsRef(js, deserialize(js, kj::mv(result))));
+      }
+      KJ_CASE_ONEOF(stale, SharedMemoryCache::Use::StaleValue) {
+        KJ_IF_SOME(revalidate, stale.revalidate) {
+          // Refresh the value in the background. If that fails, the stale value is still
+          // returned until its grace period is over, and the next stale read tries again.
+          auto& context = IoContext::current();
+          auto refresh = runFallback(
+              js, fallback, kj::str(key.value), kj::mv(revalidate), staleWhileRevalidate);
+          context.addWaitUntil(context.awaitJs(js,
+              refresh.then(js, [](jsg::Lock&, jsg::JsRef<jsg::JsValue>) {})));
+        }
+        return js.resolvedPromise(jsg::JsRef(js, deserialize(js, kj::mv(stale.value))));
       }
       KJ_CASE_ONEOF(promise, kj::Promise<SharedMemoryCache::Use::GetWithFallbackOutcome>) {
         return IoContext::current().awaitIo(js, kj::mv(promise),
-            [fallback = kj::mv(fallback), key = kj::str(key.value), span = kj::mv(readSpan),
-                userSpan = kj::mv(userReadSpan)](
+            [self = JSG_THIS, fallback = kj::mv(fallback), key = kj::str(key.value),
+                staleWhileRevalidate, span = kj::mv(readSpan), userSpan = kj::mv(userReadSpan)](
                 jsg::Lock& js, SharedMemoryCache::Use::GetWithFallbackOutcome cacheResult) mutable
             -> jsg::Promise<jsg::JsRef<jsg::JsValue>> {
           KJ_SWITCH_ONEOF(cacheResult) {
             KJ_CASE_ONEOF(serialized, kj::Own<CacheValue>) {
-              jsg::Deserializer deserializer(js, serialized->bytes.asPtr());
-              return js.resolvedPromise(jsg::JsRef(js, deserializer.readValue(js)));
+              return js.resolvedPromise(
+                  jsg::JsRef(js, self->deserialize(js, kj::mv(serialized))));
             }
             KJ_CASE_ONEOF(callback, SharedMemoryCache::Use::FallbackDoneCallback) {
-              auto& context = IoContext::current();
-              auto heapCallback = kj::heap(kj::mv(callback));
-
-              return js.evalNow([&]() { return fallback(js, kj::mv(key)); })
-                  .then(js,
-                      [callback = context.addObject(*heapCallback)](jsg::Lock& js,
-                          CacheValueProduceResult result) mutable -> jsg::JsRef<jsg::JsValue> {
-                // NOTE: `callback` is IoPtr, not IoOwn. The catch block gets the IoOwn, which
-                //   ensures the object still exists at this point.
-                auto serialized = hackySerialize(js, result.value);
-                KJ_IF_SOME(expiration, result.expiration) {
-                  JSG_REQUIRE(
-                      !kj::isNaN(expiration), TypeError, "Expiration time must not be NaN.");
-                }
-                (*callback)(
-                    SharedMemoryCache::Use::FallbackResult{kj::mv(serialized), result.expiration});
-                return kj::mv(result.value);
-              })
-                  .catch_(js,
-                      [callback = context.addObject(kj::mv(heapCallback))](jsg::Lock& js,
-                          jsg::Value&& exception) mutable -> jsg::JsRef<jsg::JsValue> {
-                (*callback)(kj::none);
-                js.throwException(kj::mv(exception));
-              });
+              return runFallback(js, fallback, kj::mv(key), kj::mv(callback), staleWhileRevalidate);
             }
           }
           KJ_UNREACHABLE;
@@ -437,8 +825,7 @@ jsg::Promise<jsg::JsRef<jsg::JsValue>> MemoryCache::read(jsg::Lock& js,
     KJ_UNREACHABLE;
   } else {
     KJ_IF_SOME(cacheValue, cacheUse.getWithoutFallback(key.value, readSpan)) {
-      jsg::Deserializer deserializer(js, cacheValue->bytes.asPtr());
-      return js.resolvedPromise(jsg::JsRef(js, deserializer.readValue(js)));
+      return js.resolvedPromise(jsg::JsRef(js, deserialize(js, kj::mv(cacheValue))));
     }
     return js.resolvedPromise(jsg::JsRef(js, js.undefined()));
   }
@@ -500,6 +887,12 @@ kj::Own<const SharedMemoryCache> MemoryCacheProvider::getInstance(
   return makeCache(kj::none, nullptr);
 }
 
+void MemoryCacheProvider::setHostTable(kj::Own<const SharedMemoryTable> table) {
+  KJ_REQUIRE(
+      caches.lockShared()->size() == 0, "setHostTable() must be called before getInstance()");
+  hostTable = kj::mv(table);
+}
+
 void MemoryCacheProvider::removeInstance(const SharedMemoryCache& instance) const {
   // This is fun. We have to make sure that the instance to be removed is actually
   // what we expect it to be.
@@ -1,14 +1,17 @@
 #pragma once
 
 #include <workerd/jsg/jsg.h>
+#include <workerd/util/shared-memory-table.h>
 #include <workerd/util/uuid.h>
 
+#include <kj/function.h>
 #include <kj/hash.h>
 #include <kj/map.h>
 #include <kj/mutex.h>
 #include <kj/table.h>
 #include <kj/timer.h>
 
+#include <atomic>
 #include <set>
 
 namespace workerd {
@@ -41,6 +44,122 @@ struct CacheValue: kj::AtomicRefcounted {
   CacheValue(kj::Array<kj::byte>&& bytes): bytes(kj::mv(bytes)) {}
 
   kj::Array<kj::byte> bytes;
+
+  // Whether the cache has let go of this value, after which no read will return it again.
+  // Isolates that hold on to a deserialized copy of the value (see MemoryCache) use this to know
+  // when to drop it.
+  bool isEvicted() const {
+    return evicted.load(std::memory_order_acquire);
+  }
+
+ private:
+  std::atomic<bool> evicted = false;
+  friend class CacheEntryValue;
+};
+
+// A cache entry's reference to its CacheValue, which marks the value as evicted once the entry
+// lets go of it, whether because the entry was erased or because its value was replaced.
+class CacheEntryValue {
+ public:
+  CacheEntryValue(kj::Own<CacheValue> value): value(kj::mv(value)) {}
+  CacheEntryValue(CacheEntryValue&& other) = default;
+  CacheEntryValue& operator=(CacheEntryValue&& other) {
+    markEvicted();
+    value = kj::mv(other.value);
+    return *this;
+  }
+  ~CacheEntryValue() noexcept(false) {
+    markEvicted();
+  }
+
+  CacheValue& operator*() const {
+    return *value;
+  }
+  CacheValue* operator->() const {
+    return value.get();
+  }
+
+ private:
+  kj::Own<CacheValue> value;
+
+  void markEvicted() {
+    if (value.get() != nullptr) {
+      value->evicted.store(true, std::memory_order_release);
+    }
+  }
+};
+
+// A cache entry's liveliness, see MemoryCacheEntry. It is atomic so that
+// reads can update it while only holding a shared lock on the cache.
+class CacheEntryLiveliness {
+ public:
+  CacheEntryLiveliness(uint64_t value): value(value) {}
+  CacheEntryLiveliness(CacheEntryLiveliness&& other): value(other.get()) {}
+  CacheEntryLiveliness& operator=(CacheEntryLiveliness&& other) {
+    set(other.get());
+    return *this;
+  }
+
+  uint64_t get() const {
+    return value.load(std::memory_order_relaxed);
+  }
+  void set(uint64_t newValue) const {
+    value.store(newValue, std::memory_order_relaxed);
+  }
+
+ private:
+  mutable std::atomic<uint64_t> value;
+};
+
+// Tracks the expiration timestamps of cache entries in a hierarchical timing
+// wheel, so that adding one takes constant time no matter how many entries the
+// cache holds. Each record is kept in a slot of the lowest level whose range
+// covers it, and moves down a level whenever the wheel advances into its slot.
+//
+// Records are not removed when their entry is updated or erased. Instead,
+// sweep() hands each expired record to its caller, which checks whether the
+// record still matches an entry.
+class CacheExpirationWheel {
+ public:
+  CacheExpirationWheel() = default;
+  KJ_DISALLOW_COPY_AND_MOVE(CacheExpirationWheel);
+
+  // Adds a record for the entry with the given key. Like
+  // MemoryCacheEntry::expiration, the expiration is measured in milliseconds.
+  void add(kj::StringPtr key, double expiration);
+
+  // Advances the wheel to the given time and passes every record that has
+  // expired by then to `expired`, in no particular order.
+  void sweep(double now, kj::FunctionParam<void(kj::StringPtr key, double expiration)> expired);
+
+  // Removes all records.
+  void clear();
+
+  // The number of records, including those of entries that have since been
+  // updated or erased.
+  size_t size() const {
+    return recordCount;
+  }
+
+ private:
+  struct Record {
+    kj::String key;
+    double expiration;
+  };
+
+  // Level 0 has one slot per millisecond, and each slot of the next level
+  // spans all slots of the previous one, so five levels span about 12 days.
+  // Records that expire even later wait in `overflow`.
+  static constexpr uint SLOT_BITS = 6;
+  static constexpr uint SLOT_COUNT = 1 << SLOT_BITS;
+  static constexpr uint LEVEL_COUNT = 5;
+
+  kj::Vector<Record> slots[LEVEL_COUNT][SLOT_COUNT];
+  kj::Vector<Record> overflow;
+  int64_t currentTick = 0;
+  size_t recordCount = 0;
+
+  void insert(Record&& record);
 };
 
 struct MemoryCacheEntry {
@@ -48,23 +167,17 @@ struct MemoryCacheEntry {
   kj::String key;
 
   // Whenever an entry is created, updated, or retrieved, its liveliness is
-  // set to the value of a monotonically increasing counter.
-  uint64_t liveliness;
-  // TODO(cleanup): The liveliness index accomplishes the same thing as
-  //   kj::InsertionOrderIndex.
-  //
-  // TODO(perf): Updating a cache entry's liveliness requires a re-insertion,
-  //   which means that cache reads require an exclusive lock. This may be
-  //   suboptimal for a read-heavy workload. WorkerSet avoids this by atomically
-  //   updating a `lastUsed` timestamp. The tradeoff is that LRU-eviction
-  //   becomes O(n) instead of O(1), since we can no longer use kj::Table's
-  //   index to find the LRU entry.
+  // set to the value of a monotonically increasing counter. Unlike the other
+  // fields, this is not indexed, so that updating it doesn't require
+  // re-inserting the entry. Eviction instead samples a few entries and picks
+  // the least recently used among them.
+  CacheEntryLiveliness liveliness;
 
   // The stored JavaScript value, serialized by V8. It is atomicRefcounted to
   // allow threads to deserialize the value without having to lock the cache,
   // so the value can even be deserialized while the cache entry is being
   // evicted.
-  kj::Own<CacheValue> value;
+  CacheEntryValue value;
 
   inline size_t size() const {
     return value->bytes.size();
@@ -75,6 +188,18 @@ struct MemoryCacheEntry {
   // stored as a double so that it is compatible with api::dateNow() and
   // EdgeWorkerPlatform::CurrentClockTimeMillis().
   kj::Maybe<double> expiration;
+
+  // For how many milliseconds after its expiration the entry is kept, so that
+  // reads with the staleWhileRevalidate option can still return it while its
+  // value is being refreshed. This is the grace period of the read whose
+  // fallback produced the value.
+  double staleWhileRevalidate = 0;
+
+  // The time at which the entry is removed from the cache, at the end of its
+  // stale-while-revalidate period.
+  inline kj::Maybe<double> removalTime() const {
+    return expiration.map([&](double e) { return e + staleWhileRevalidate; });
+  }
 };
 
 struct CacheValueProduceResult {
@@ -83,6 +208,15 @@ struct CacheValueProduceResult {
   JSG_STRUCT(value, expiration);
 };
 
+struct MemoryCacheReadOptions {
+  // A grace period in milliseconds. A value that expired less than this long
+  // ago is returned immediately, while one fallback refreshes it in the
+  // background. This only applies to values produced by reads with this
+  // option, which the cache keeps for their grace period after they expire.
+  jsg::Optional<double> staleWhileRevalidate;
+  JSG_STRUCT(staleWhileRevalidate);
+};
+
 class MemoryCacheProvider;
 
 // An in-memory cache that can be accessed by any number of workers/isolates
@@ -189,17 +323,32 @@ class SharedMemoryCache: public kj::AtomicRefcounted {
     struct FallbackResult {
       kj::Own<CacheValue> value;
       kj::Maybe<double> expiration;
+      double staleWhileRevalidate = 0;
     };
     typedef kj::Function<void(kj::Maybe<FallbackResult>)> FallbackDoneCallback;
     using GetWithFallbackOutcome = kj::OneOf<kj::Own<CacheValue>, FallbackDoneCallback>;
 
+    // A value that has expired, but not longer ago than the grace period
+    // passed to getWithFallback().
+    struct StaleValue {
+      kj::Own<CacheValue> value;
+
+      // Set if the caller should invoke the fallback function in the
+      // background to refresh the value. Absent if another fallback for the
+      // same key is in progress already.
+      kj::Maybe<FallbackDoneCallback> revalidate;
+    };
+
     // Returns either:
     // 1. The immediate value, if already in cache.
-    // 2. A Promise that will eventually resolve either to the cached value
+    // 2. A stale value, if the cached value has expired less than
+    //    `staleWhileRevalidate` milliseconds ago.
+    // 3. A Promise that will eventually resolve either to the cached value
     //    or to a FallbackDoneCallback. In the latter case, the caller should
     //    invoke the fallback function.
-    kj::OneOf<kj::Own<CacheValue>, kj::Promise<GetWithFallbackOutcome>> getWithFallback(
-        const kj::String& key, SpanBuilder& span) const;
+    kj::OneOf<kj::Own<CacheValue>, StaleValue, kj::Promise<GetWithFallbackOutcome>>
+    getWithFallback(
+        const kj::String& key, SpanBuilder& span, double staleWhileRevalidate = 0) const;
 
    private:
     // Creates a new FallbackDoneCallback associated with the given
@@ -277,12 +426,32 @@ class SharedMemoryCache: public kj::AtomicRefcounted {
   kj::Maybe<kj::Own<CacheValue>> getWhileLocked(
       ThreadUnsafeData& data, const kj::String& key) const;
 
-  // Stores a value in the cache, with an optional expiration timestamp. It is
-  // marked as the most recently used entry.
+  // Like getWhileLocked(), but only requires a shared lock. An expired entry
+  // is not returned, but is left for a later exclusive operation to remove.
+  kj::Maybe<kj::Own<CacheValue>> getWhileShared(
+      const ThreadUnsafeData& data, const kj::String& key) const;
+
+  // Returns a cached value that has expired less than `staleWhileRevalidate`
+  // milliseconds ago, and which is still within its own stale-while-revalidate
+  // period. Like getWhileShared(), this only requires a shared lock.
+  kj::Maybe<kj::Own<CacheValue>> getStaleWhileShared(
+      const ThreadUnsafeData& data, const kj::String& key, double staleWhileRevalidate) const;
+
+  // Stores a value in the cache, with an optional expiration timestamp and
+  // stale-while-revalidate period. It is marked as the most recently used entry.
   void putWhileLocked(ThreadUnsafeData& data,
       const kj::String& key,
       kj::Own<CacheValue>&& value,
-      kj::Maybe<double> expiration) const;
+      kj::Maybe<double> expiration,
+      double staleWhileRevalidate = 0) const;
+
+  // Looks `key` up in the provider's host table, if there is one, and copies a value found there
+  // into this cache. The cache's data must not be locked.
+  kj::Maybe<kj::Own<CacheValue>> getFromHost(const kj::String& key) const;
+
+  // Publishes a value produced by a fallback to the provider's host table, if there is one.
+  void putToHost(
+      const kj::String& key, const CacheValue& value, kj::Maybe<double> expiration) const;
 
   // Evicts at least one cache entry. The cache's data must already be locked by
   // the calling thread, and the cache must not be empty. Expiration timestamps
@@ -290,6 +459,19 @@ class SharedMemoryCache: public kj::AtomicRefcounted {
   // allowOutsideIoContext is true.
   void evictNextWhileLocked(ThreadUnsafeData& data, bool allowOutsideIoContext = false) const;
 
+  // Removes all entries whose removal time is before `now` and returns how many
+  // there were.
+  size_t sweepExpiredWhileLocked(ThreadUnsafeData& data, double now) const;
+
+  // Records the removal time of the entry with the given key, which must
+  // already be in the cache.
+  void addExpirationWhileLocked(
+      ThreadUnsafeData& data, const kj::String& key, double removalTime) const;
+
+  // Returns the least recently used of a few randomly sampled cache entries, or
+  // of all entries if the cache is small. The cache must not be empty.
+  MemoryCacheEntry& sampleLeastRecentlyUsedWhileLocked(ThreadUnsafeData& data) const;
+
   // Removes the cache entry with the given key, if it exists.
   void removeIfExistsWhileLocked(ThreadUnsafeData& data, const kj::String& key) const;
 
@@ -313,25 +495,6 @@ class SharedMemoryCache: public kj::AtomicRefcounted {
     }
   };
 
-  // Callbacks for a TreeIndex that allow sorting cache entries by their
-  // liveliness. This is used to evict the least recently used entry.
-  class LivelinessCallbacks {
-   public:
-    inline const uint64_t& keyForRow(const MemoryCacheEntry& entry) const {
-      return entry.liveliness;
-    }
-
-    template <typename KeyLike>
-    inline bool matches(const MemoryCacheEntry& e, KeyLike&& key) const {
-      return e.liveliness == key;
-    }
-
-    template <typename KeyLike>
-    inline bool isBefore(const MemoryCacheEntry& e, KeyLike&& key) const {
-      return e.liveliness < key;
-    }
-  };
-
   // Callbacks for a TreeIndex that allow sorting cache entries by the sizes
   // of the serialized values. The entries are sorted in reverse order, i.e.,
   // the first entry contains the largest value. This is used to quickly evict
@@ -356,43 +519,6 @@ class SharedMemoryCache: public kj::AtomicRefcounted {
     }
   };
 
-  // Callbacks for a TreeIndex that allow sorting cache entries by their
-  // expiration times. This is used to quickly evict expired entries even when
-  // they are not least recently used. Values with no expiration timestamp are
-  // at the very end, ordered by their cache keys.
-  class ExpirationCallbacks {
-   public:
-    inline const MemoryCacheEntry& keyForRow(const MemoryCacheEntry& entry) const {
-      return entry;
-    }
-
-    template <typename KeyLike>
-    inline bool matches(const MemoryCacheEntry& e, KeyLike&& key) const {
-      return e.expiration == key.expiration && e.key == key.key;
-    }
-
-    template <typename KeyLike>
-    inline bool isBefore(const MemoryCacheEntry& e, KeyLike&& key) const {
-      const kj::Maybe<double>&expl = e.expiration, expr = key.expiration;
-      if (expl != expr) return isBefore(expl, expr);
-      return e.key < key.key;
-    }
-
-   private:
-    inline bool isBefore(const kj::Maybe<double>& a, const kj::Maybe<double>& b) const {
-      KJ_IF_SOME(da, a) {
-        KJ_IF_SOME(db, b) {
-          return da < db;
-        } else {
-          return false;
-        }
-      } else {
-        KJ_ASSERT(b != kj::none);
-        return true;
-      }
-    }
-  };
-
  public:
   struct ThreadUnsafeData {
     KJ_DISALLOW_COPY_AND_MOVE(ThreadUnsafeData);
@@ -408,15 +534,21 @@ class SharedMemoryCache: public kj::AtomicRefcounted {
     Limits effectiveLimits = Limits::min();
 
     // Returns the next liveliness and increments it so that the next call to
-    // this function will return a different value.
-    inline uint64_t stepLiveliness() {
-      return nextLiveliness++;
+    // this function will return a different value. Reads call this while only
+    // holding a shared lock.
+    inline uint64_t stepLiveliness() const {
+      return nextLiveliness.fetch_add(1, std::memory_order_relaxed);
     }
 
     // We do not handle integer overflow, but a 64-bit counter should never wrap
     // around, at least not in the foreseeable future. (Even at a billion cache
     // operations per second, it would take almost 600 years.)
-    uint64_t nextLiveliness = 0;
+    mutable std::atomic<uint64_t> nextLiveliness = 0;
+
+    // State of the xorshift generator that picks the entries sampled for
+    // eviction. Only used under an exclusive lock. Eviction doesn't need good
+    // randomness, just a spread that doesn't favor any part of the table.
+    uint64_t evictionSampleState = 0x9e3779b97f4a7c15;
 
     // The sum of the sizes of all values that are currently stored in the cache.
     // This is technically redundant information, but more efficient than
@@ -424,14 +556,20 @@ class SharedMemoryCache: public kj::AtomicRefcounted {
     size_t totalValueSize = 0;
 
     // The actual cache contents.
-    kj::Table<MemoryCacheEntry,              // row type
-        kj::HashIndex<KeyCallbacks>,         // index over keys
-        kj::TreeIndex<LivelinessCallbacks>,  // index over liveliness
-        kj::TreeIndex<ValueSizeCallbacks>,   // index over value sizes
-        kj::TreeIndex<ExpirationCallbacks>   // index over expiration
+    kj::Table<MemoryCacheEntry,             // row type
+        kj::HashIndex<KeyCallbacks>,        // index over keys
+        kj::TreeIndex<ValueSizeCallbacks>   // index over value sizes
         >
         cache;
 
+    // The removal times (see MemoryCacheEntry::removalTime()) of the cache
+    // entries that have one. This is used to quickly evict expired entries even
+    // when they are not least recently used.
+    CacheExpirationWheel expirations;
+
+    // When expired entries were last swept, see putWhileLocked().
+    kj::Maybe<kj::TimePoint> lastExpirationSweep;
+
     // Whenever a fallback is active for a particular key, this table will
     // contain one corresponding row. Other concurrent read operations can add
     // themselves to the InProgress struct to be notified once the fallback
@@ -442,9 +580,10 @@ class SharedMemoryCache: public kj::AtomicRefcounted {
   };
 
  private:
-  // To ensure thread-safety, all mutable data is guarded by a mutex. Each cache
-  // operation requires an exclusive lock. Even read-only operations need to
-  // update the liveliness of cache entries, which currently requires a lock.
+  // To ensure thread-safety, all mutable data is guarded by a mutex. Reads of
+  // cached values only take a shared lock, since the liveliness they update is
+  // atomic. Everything else, including reads that miss and have to schedule a
+  // fallback, takes an exclusive lock.
   kj::MutexGuarded<ThreadUnsafeData> data;
 
   // The MemoryCacheProvider instance needs to be guaranteed to outlive the SharedMemoryCache
@@ -453,6 +592,9 @@ class SharedMemoryCache: public kj::AtomicRefcounted {
   // to replace this with a kj::Ptr<MemoryCacheProvider>
   kj::Maybe<const MemoryCacheProvider&> provider;
 
+  // The provider's host table. Only caches with an id use it, since only they are shared.
+  kj::Maybe<const SharedMemoryTable&> hostTable;
+
   // It's a bit unfortunate that we need to keep a copy of the id here as well as in the map
   // in the MemoryCacheProvider, however, it's entirely possible (at least theoretically) that
   // the map entry in the MemoryCacheProvider could be removed before the SharedMemoryCache is
@@ -472,15 +614,24 @@ class SharedMemoryCache: public kj::AtomicRefcounted {
 // manages interaction with the shared cache in a thread-safe manner.
 class MemoryCache: public jsg::Object {
  public:
-  MemoryCache(SharedMemoryCache::Use&& use): cacheUse(kj::mv(use)) {}
+  // If `shareDeserializedValues` is true, each cached value is deserialized only once per
+  // isolate. The result is deeply frozen and handed to every later read of the same cache entry,
+  // which makes repeated reads of large values O(1). Values containing objects that stay mutable
+  // when frozen (Maps, Sets, Dates, RegExps and binary data) are still deserialized for every
+  // read.
+  MemoryCache(SharedMemoryCache::Use&& use, bool shareDeserializedValues = false)
+      : cacheUse(kj::mv(use)),
+        shareDeserializedValues(shareDeserializedValues) {}
 
   using FallbackFunction = jsg::Function<jsg::Promise<CacheValueProduceResult>(kj::String)>;
 
   // Reads a value from the cache or invokes a fallback function to obtain the
-  // value, if a fallback function was given.
+  // value, if a fallback function was given. The options only apply to reads
+  // with a fallback function.
   jsg::Promise<jsg::JsRef<jsg::JsValue>> read(jsg::Lock& js,
       jsg::NonCoercible<kj::String> key,
-      jsg::Optional<FallbackFunction> optionalFallback);
+      jsg::Optional<FallbackFunction> optionalFallback,
+      jsg::Optional<MemoryCacheReadOptions> options);
 
   JSG_RESOURCE_TYPE(MemoryCache) {
     JSG_METHOD(read);
@@ -488,6 +639,25 @@ class MemoryCache: public jsg::Object {
 
  private:
   SharedMemoryCache::Use cacheUse;
+  bool shareDeserializedValues;
+
+  // Deserialized values for shareDeserializedValues, keyed by the identity of the CacheValue
+  // they were read from. Entries whose CacheValue has been evicted are swept out once the table
+  // has doubled in size since the last sweep.
+  struct DeserializedValue {
+    // Keeps the key's address from being reused by another CacheValue.
+    kj::Own<CacheValue> serialized;
+
+    // kj::none if the value can't be shared, see shareDeserializedValues.
+    kj::Maybe<jsg::JsRef<jsg::JsValue>> value;
+  };
+  kj::HashMap<const CacheValue*, DeserializedValue> deserializedValues;
+  size_t nextSweepSize = MIN_SWEEP_SIZE;
+  static constexpr size_t MIN_SWEEP_SIZE = 16;
+
+  jsg::JsValue deserialize(jsg::Lock& js, kj::Own<CacheValue> serialized);
+
+  void visitForGc(jsg::GcVisitor& visitor);
 };
 
 // The MemoryCacheProvider provides the internal implementation of the MemoryCache mechanism.
@@ -509,6 +679,19 @@ class MemoryCacheProvider {
 
   void removeInstance(const SharedMemoryCache& instance) const;
 
+  // Makes caches with an id share their values with every other process that maps the same
+  // table, so that processes on one host serving the same workers don't each fill their own copy
+  // of the cache. Each process still keeps the values it reads in its own cache; the table is
+  // only consulted when a read misses, and only filled by fallbacks. Fallbacks are deduplicated
+  // within each process, not across processes. Must be called before the first getInstance().
+  void setHostTable(kj::Own<const SharedMemoryTable> table);
+
+  kj::Maybe<const SharedMemoryTable&> getHostTable() const {
+    return hostTable.map([](const kj::Own<const SharedMemoryTable>& t) -> const SharedMemoryTable& {
+      return *t;
+    });
+  }
+
  private:
   kj::Maybe<SharedMemoryCache::AdditionalResizeMemoryLimitHandler>
       additionalResizeMemoryLimitHandler;
@@ -520,13 +703,16 @@ class MemoryCacheProvider {
   // is destroyed, it will remove itself from this cache by calling removeInstance.
   kj::MutexGuarded<kj::HashMap<kj::String, const SharedMemoryCache*>> caches;
 
+  kj::Maybe<kj::Own<const SharedMemoryTable>> hostTable;
+
   const kj::MonotonicClock& timer;
 };
 
 // clang-format off
 #define EW_MEMORY_CACHE_ISOLATE_TYPES                                                   \
   api::MemoryCache,                                                                     \
-  api::CacheValueProduceResult
+  api::CacheValueProduceResult,                                                         \
+  api::MemoryCacheReadOptions
 // clang-format on
 
 }  // namespace workerd::api
@@ -184,22 +184,16 @@ uint32_t BufferUtil::byteLength(jsg::Lock& js, jsg::JsString str) {
   return str.utf8Length(js);
 }
 
-int BufferUtil::compare(jsg::Lock& js,
-    kj::Array<kj::byte> one,
-    kj::Array<kj::byte> two,
-    jsg::Optional<CompareOptions> maybeOptions) {
-  kj::ArrayPtr<kj::byte> ptrOne = one;
-  kj::ArrayPtr<kj::byte> ptrTwo = two;
-
-  // The options allow comparing subranges within the two inputs.
-  KJ_IF_SOME(options, maybeOptions) {
-    auto end = options.aEnd.orDefault(ptrOne.size());
-    auto start = kj::min(end, options.aStart.orDefault(0));
-    ptrOne = ptrOne.slice(start, end);
-    end = options.bEnd.orDefault(ptrTwo.size());
-    start = kj::min(end, options.bStart.orDefault(0));
-    ptrTwo = ptrTwo.slice(start, end);
-  }
+int32_t BufferUtil::compare(kj::Array<const kj::byte> one,
+    kj::Array<const kj::byte> two,
+    uint32_t aStart,
+    uint32_t aEnd,
+    uint32_t bStart,
+    uint32_t bEnd) {
+  auto end = kj::min(size_t(aEnd), one.size());
+  auto ptrOne = one.slice(kj::min(end, size_t(aStart)), end);
+  end = kj::min(size_t(bEnd), two.size());
+  auto ptrTwo = two.slice(kj::min(end, size_t(bStart)), end);
 
   size_t toCompare = kj::min(ptrOne.size(), ptrTwo.size());
   auto result = toCompare > 0 ? memcmp(ptrOne.begin(), ptrTwo.begin(), toCompare) : 0;
@@ -411,11 +405,16 @@ jsg::JsString toStringImpl(
   if (slice.size() == 0) return js.str();
   switch (encoding) {
     case Encoding::ASCII: {
-      // TODO(perf): We can look at making this more performant later.
-      // Essentially we have to modify the buffer such that every byte
-      // has the highest bit turned off. Whee! Node.js has a faster
-      // algorithm that it implements so we can likely adopt that.
-      kj::Array<kj::byte> copy = KJ_MAP(b, slice) -> kj::byte { return b & 0x7f; };
+      // Every byte must have its highest bit turned off. Like Node.js, check first whether that's
+      // already the case (the overwhelmingly common one), in which case the bytes can go to V8 as
+      // they are. Otherwise mask into a copy; the loop is trivially vectorized.
+      if (simdutf::validate_ascii(slice.asChars().begin(), slice.size())) {
+        return js.str(slice);
+      }
+      auto copy = kj::heapArray<kj::byte>(slice.size());
+      for (size_t i = 0; i < slice.size(); i++) {
+        copy[i] = slice[i] & 0x7f;
+      }
       return js.str(copy);
     }
     case Encoding::LATIN1: {
@@ -425,7 +424,12 @@ jsg::JsString toStringImpl(
       return js.str(slice.asChars());
     }
     case Encoding::UTF16LE: {
-      // TODO(soon): Using just the slice here results in v8 hitting an IsAligned assertion.
+      // V8 asserts that two-byte input is aligned, so we can only pass the slice through directly
+      // when it happens to start on an even address.
+      if (reinterpret_cast<uintptr_t>(slice.begin()) % alignof(uint16_t) == 0) {
+        return js.str(kj::arrayPtr(
+            reinterpret_cast<const uint16_t*>(slice.begin()), slice.size() / sizeof(uint16_t)));
+      }
       auto data =
           kj::heapArray<uint16_t>(reinterpret_cast<uint16_t*>(slice.begin()), slice.size() / 2);
       return js.str(data);
@@ -761,12 +765,12 @@ jsg::JsString BufferUtil::flush(jsg::Lock& js, kj::Array<kj::byte> state) {
   return ret;
 }
 
-bool BufferUtil::isAscii(kj::Array<kj::byte> buffer) {
+bool BufferUtil::isAscii(kj::Array<const kj::byte> buffer) {
   if (buffer.size() == 0) return true;
   return simdutf::validate_ascii(buffer.asChars().begin(), buffer.size());
 }
 
-bool BufferUtil::isUtf8(kj::Array<kj::byte> buffer) {
+bool BufferUtil::isUtf8(kj::Array<const kj::byte> buffer) {
   if (buffer.size() == 0) return true;
   return simdutf::validate_utf8(buffer.asChars().begin(), buffer.size());
 }
@@ -17,19 +17,13 @@ class BufferUtil final: public jsg::Object {
 
   uint32_t byteLength(jsg::Lock& js, jsg::JsString str);
 
-  struct CompareOptions {
-    jsg::Optional<uint32_t> aStart;
-    jsg::Optional<uint32_t> aEnd;
-    jsg::Optional<uint32_t> bStart;
-    jsg::Optional<uint32_t> bEnd;
-
-    JSG_STRUCT(aStart, aEnd, bStart, bEnd);
-  };
-
-  int compare(jsg::Lock& js,
-      kj::Array<kj::byte> one,
-      kj::Array<kj::byte> two,
-      jsg::Optional<CompareOptions> maybeOptions);
+  // Compares one[aStart, aEnd) with two[bStart, bEnd). A start past its end is clamped to the end.
+  int32_t compare(kj::Array<const kj::byte> one,
+      kj::Array<const kj::byte> two,
+      uint32_t aStart,
+      uint32_t aEnd,
+      uint32_t bStart,
+      uint32_t bEnd);
 
   jsg::BufferSource concat(jsg::Lock& js, kj::Array<kj::Array<kj::byte>> list, uint32_t length);
 
@@ -75,8 +69,8 @@ class BufferUtil final: public jsg::Object {
 
   jsg::JsString decode(jsg::Lock& js, kj::Array<kj::byte> bytes, kj::Array<kj::byte> state);
   jsg::JsString flush(jsg::Lock& js, kj::Array<kj::byte> state);
-  bool isAscii(kj::Array<kj::byte> bytes);
-  bool isUtf8(kj::Array<kj::byte> bytes);
+  bool isAscii(kj::Array<const kj::byte> bytes);
+  bool isUtf8(kj::Array<const kj::byte> bytes);
   jsg::BufferSource transcode(jsg::Lock& js,
       kj::Array<kj::byte> source,
       EncodingValue rawFromEncoding,
@@ -84,7 +78,7 @@ class BufferUtil final: public jsg::Object {
 
   JSG_RESOURCE_TYPE(BufferUtil) {
     JSG_METHOD(byteLength);
-    JSG_METHOD(compare);
+    JSG_FAST_METHOD(compare);
     JSG_METHOD(concat);
     JSG_METHOD(decodeString);
     JSG_METHOD(fillImpl);
@@ -92,8 +86,8 @@ class BufferUtil final: public jsg::Object {
     JSG_METHOD(swap);
     JSG_METHOD(toString);
     JSG_METHOD(write);
-    JSG_METHOD(isAscii);
-    JSG_METHOD(isUtf8);
+    JSG_FAST_METHOD(isAscii);
+    JSG_FAST_METHOD(isUtf8);
     JSG_METHOD(transcode);
 
     // For StringDecoder
@@ -110,6 +104,6 @@ class BufferUtil final: public jsg::Object {
   }
 };
 
-#define EW_NODE_BUFFER_ISOLATE_TYPES api::node::BufferUtil, api::node::BufferUtil::CompareOptions
+#define EW_NODE_BUFFER_ISOLATE_TYPES api::node::BufferUtil
 
 }  // namespace workerd::api::node
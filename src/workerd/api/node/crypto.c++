@@ -8,26 +8,17 @@
 #include <workerd/api/crypto/kdf.h>
 #include <workerd/api/crypto/prime.h>
 #include <workerd/api/crypto/spkac.h>
+#include <workerd/io/io-context.h>
 #include <workerd/jsg/jsg.h>
 
 namespace workerd::api::node {
 
-jsg::BufferSource CryptoImpl::getHkdf(jsg::Lock& js,
-    kj::String hash,
-    kj::Array<const kj::byte> key,
-    kj::Array<const kj::byte> salt,
-    kj::Array<const kj::byte> info,
+namespace {
+const EVP_MD* checkHkdfParams(kj::StringPtr hash,
+    kj::ArrayPtr<const kj::byte> key,
+    kj::ArrayPtr<const kj::byte> salt,
+    kj::ArrayPtr<const kj::byte> info,
     uint32_t length) {
-  // The Node.js version of the HKDF is a bit different from the Web Crypto API
-  // version. For one, the length here specifies the number of bytes, whereas
-  // in Web Crypto the length is expressed in the number of bits. Second, the
-  // Node.js implementation allows for a broader range of possible digest
-  // algorithms whereas the Web Crypto API only allows for a few specific ones.
-  // Third, the Node.js implementation enforces max size limits on the key,
-  // salt, and info parameters. Fourth, the Web Crypto API relies on the key
-  // being a CryptoKey object, whereas the Node.js implementation here takes a
-  // raw byte array.
-  ClearErrorOnReturn clearErrorOnReturn;
   const EVP_MD* digest = EVP_get_digestbyname(hash.begin());
   JSG_REQUIRE(digest != nullptr, TypeError, "Invalid Hkdf digest: ", hash);
 
@@ -43,10 +34,94 @@ jsg::BufferSource CryptoImpl::getHkdf(jsg::Lock& js,
   static constexpr size_t kMaxDigestMultiplier = 255;
   JSG_REQUIRE(
       length <= EVP_MD_size(digest) * kMaxDigestMultiplier, RangeError, "Invalid Hkdf key length");
+  return digest;
+}
+
+const EVP_MD* checkPbkdfParams(jsg::Lock& js,
+    kj::ArrayPtr<const kj::byte> password,
+    kj::ArrayPtr<const kj::byte> salt,
+    uint32_t num_iterations,
+    kj::StringPtr name) {
+  const EVP_MD* digest = EVP_get_digestbyname(name.begin());
+  JSG_REQUIRE(digest != nullptr, TypeError, "Invalid Pbkdf2 digest: ", name,
+      internalDescribeOpensslErrors());
+
+  JSG_REQUIRE(password.size() <= INT32_MAX, RangeError, "Pbkdf2 failed: password is too large");
+  JSG_REQUIRE(salt.size() <= INT32_MAX, RangeError, "Pbkdf2 failed: salt is too large");
+  // Note: The user could DoS us by selecting a very high iteration count. As with the Web Crypto
+  // API, intentionally limit the maximum iteration count.
+  checkPbkdfLimits(js, num_iterations);
+  return digest;
+}
+
+void checkScryptParams(kj::ArrayPtr<const kj::byte> password, kj::ArrayPtr<const kj::byte> salt) {
+  JSG_REQUIRE(password.size() <= INT32_MAX, RangeError, "Scrypt failed: password is too large");
+  JSG_REQUIRE(salt.size() <= INT32_MAX, RangeError, "Scrypt failed: salt is too large");
+}
 
+// Derives a `length`-byte key with `derive`, which must own copies of its inputs since, within a
+// request, it runs on the shared ThreadPool without the isolate lock. Outside of a request, or
+// when the isolate is already at its off-thread task limit, it runs inline.
+jsg::Promise<jsg::BufferSource> deriveKeyAsync(jsg::Lock& js,
+    uint32_t length,
+    kj::StringPtr failureMessage,
+    kj::Function<bool(kj::ArrayPtr<kj::byte>)> derive) {
+  kj::Function<kj::Array<kj::byte>()> work = [length, failureMessage,
+                                                 derive = kj::mv(derive)]() mutable {
+    ClearErrorOnReturn clearErrorOnReturn;
+    auto output = kj::heapArray<kj::byte>(length);
+    JSG_REQUIRE(derive(output), Error, failureMessage);
+    return output;
+  };
+  auto toBufferSource = [](jsg::Lock& js, kj::Array<kj::byte> output) {
+    return jsg::BufferSource(js, jsg::BackingStore::from<v8::ArrayBuffer>(kj::mv(output)));
+  };
+
+  if (IoContext::hasCurrent()) {
+    auto& context = IoContext::current();
+    KJ_IF_SOME(promise, context.tryRunOffThread(kj::mv(work))) {
+      return context.awaitIo(js, kj::mv(promise), kj::mv(toBufferSource));
+    }
+  }
+  return js.resolvedPromise(toBufferSource(js, work()));
+}
+}  // namespace
+
+jsg::BufferSource CryptoImpl::getHkdf(jsg::Lock& js,
+    kj::String hash,
+    kj::Array<const kj::byte> key,
+    kj::Array<const kj::byte> salt,
+    kj::Array<const kj::byte> info,
+    uint32_t length) {
+  // The Node.js version of the HKDF is a bit different from the Web Crypto API
+  // version. For one, the length here specifies the number of bytes, whereas
+  // in Web Crypto the length is expressed in the number of bits. Second, the
+  // Node.js implementation allows for a broader range of possible digest
+  // algorithms whereas the Web Crypto API only allows for a few specific ones.
+  // Third, the Node.js implementation enforces max size limits on the key,
+  // salt, and info parameters. Fourth, the Web Crypto API relies on the key
+  // being a CryptoKey object, whereas the Node.js implementation here takes a
+  // raw byte array.
+  ClearErrorOnReturn clearErrorOnReturn;
+  auto digest = checkHkdfParams(hash, key, salt, info, length);
   return JSG_REQUIRE_NONNULL(hkdf(js, length, digest, key, salt, info), Error, "Hkdf failed");
 }
 
+jsg::Promise<jsg::BufferSource> CryptoImpl::getHkdfAsync(jsg::Lock& js,
+    kj::String hash,
+    kj::Array<const kj::byte> key,
+    kj::Array<const kj::byte> salt,
+    kj::Array<const kj::byte> info,
+    uint32_t length) {
+  ClearErrorOnReturn clearErrorOnReturn;
+  auto digest = checkHkdfParams(hash, key, salt, info, length);
+  return deriveKeyAsync(js, length, "Hkdf failed"_kj,
+      [digest, key = kj::heapArray(key.asPtr()), salt = kj::heapArray(salt.asPtr()),
+          info = kj::heapArray(info.asPtr())](kj::ArrayPtr<kj::byte> output) {
+    return hkdf(output, digest, key, salt, info);
+  });
+}
+
 jsg::BufferSource CryptoImpl::getPbkdf(jsg::Lock& js,
     kj::Array<const kj::byte> password,
     kj::Array<const kj::byte> salt,
@@ -59,21 +134,28 @@ jsg::BufferSource CryptoImpl::getPbkdf(jsg::Lock& js,
   // Second, the Node.js implementation enforces max size limits on the password and
   // salt parameters.
   ClearErrorOnReturn clearErrorOnReturn;
-  const EVP_MD* digest = EVP_get_digestbyname(name.begin());
-  JSG_REQUIRE(digest != nullptr, TypeError, "Invalid Pbkdf2 digest: ", name,
-      internalDescribeOpensslErrors());
-
-  JSG_REQUIRE(password.size() <= INT32_MAX, RangeError, "Pbkdf2 failed: password is too large");
-  JSG_REQUIRE(salt.size() <= INT32_MAX, RangeError, "Pbkdf2 failed: salt is too large");
-  // Note: The user could DoS us by selecting a very high iteration count. As with the Web Crypto
-  // API, intentionally limit the maximum iteration count.
-  checkPbkdfLimits(js, num_iterations);
+  auto digest = checkPbkdfParams(js, password, salt, num_iterations, name);
 
   // Both pass and salt may be zero length here.
   return JSG_REQUIRE_NONNULL(
       pbkdf2(js, keylen, num_iterations, digest, password, salt), Error, "Pbkdf2 failed");
 }
 
+jsg::Promise<jsg::BufferSource> CryptoImpl::getPbkdfAsync(jsg::Lock& js,
+    kj::Array<const kj::byte> password,
+    kj::Array<const kj::byte> salt,
+    uint32_t num_iterations,
+    uint32_t keylen,
+    kj::String name) {
+  ClearErrorOnReturn clearErrorOnReturn;
+  auto digest = checkPbkdfParams(js, password, salt, num_iterations, name);
+  return deriveKeyAsync(js, keylen, "Pbkdf2 failed"_kj,
+      [digest, num_iterations, password = kj::heapArray(password.asPtr()),
+          salt = kj::heapArray(salt.asPtr())](kj::ArrayPtr<kj::byte> output) {
+    return pbkdf2(output, num_iterations, digest, password, salt);
+  });
+}
+
 jsg::BufferSource CryptoImpl::getScrypt(jsg::Lock& js,
     kj::Array<const kj::byte> password,
     kj::Array<const kj::byte> salt,
@@ -83,13 +165,29 @@ jsg::BufferSource CryptoImpl::getScrypt(jsg::Lock& js,
     uint32_t maxmem,
     uint32_t keylen) {
   ClearErrorOnReturn clearErrorOnReturn;
-  JSG_REQUIRE(password.size() <= INT32_MAX, RangeError, "Scrypt failed: password is too large");
-  JSG_REQUIRE(salt.size() <= INT32_MAX, RangeError, "Scrypt failed: salt is too large");
+  checkScryptParams(password, salt);
 
   return JSG_REQUIRE_NONNULL(
       scrypt(js, keylen, N, r, p, maxmem, password, salt), Error, "Scrypt failed");
 }
 
+jsg::Promise<jsg::BufferSource> CryptoImpl::getScryptAsync(jsg::Lock& js,
+    kj::Array<const kj::byte> password,
+    kj::Array<const kj::byte> salt,
+    uint32_t N,
+    uint32_t r,
+    uint32_t p,
+    uint32_t maxmem,
+    uint32_t keylen) {
+  ClearErrorOnReturn clearErrorOnReturn;
+  checkScryptParams(password, salt);
+  return deriveKeyAsync(js, keylen, "Scrypt failed"_kj,
+      [N, r, p, maxmem, password = kj::heapArray(password.asPtr()),
+          salt = kj::heapArray(salt.asPtr())](kj::ArrayPtr<kj::byte> output) {
+    return scrypt(output, N, r, p, maxmem, password, salt);
+  });
+}
+
 bool CryptoImpl::verifySpkac(kj::Array<const kj::byte> input) {
   return workerd::api::verifySpkac(input);
 }
@@ -118,6 +216,21 @@ bool CryptoImpl::checkPrimeSync(kj::Array<kj::byte> bufferView, uint32_t num_che
   return workerd::api::checkPrime(bufferView.asPtr(), num_checks);
 }
 
+jsg::Promise<jsg::BufferSource> CryptoImpl::randomPrimeAsync(jsg::Lock& js,
+    uint32_t size,
+    bool safe,
+    jsg::Optional<kj::Array<kj::byte>> add_buf,
+    jsg::Optional<kj::Array<kj::byte>> rem_buf) {
+  return workerd::api::randomPrimeAsync(js, size, safe,
+      add_buf.map([](kj::Array<kj::byte>& buf) { return buf.asPtr(); }),
+      rem_buf.map([](kj::Array<kj::byte>& buf) { return buf.asPtr(); }));
+}
+
+jsg::Promise<bool> CryptoImpl::checkPrimeAsync(
+    jsg::Lock& js, kj::Array<kj::byte> bufferView, uint32_t num_checks) {
+  return workerd::api::checkPrimeAsync(js, bufferView.asPtr(), num_checks);
+}
+
 // ======================================================================================
 jsg::Ref<CryptoImpl::HmacHandle> CryptoImpl::HmacHandle::constructor(
     jsg::Lock& js, kj::String algorithm, kj::OneOf<kj::Array<kj::byte>, jsg::Ref<CryptoKey>> key) {
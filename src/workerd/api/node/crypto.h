@@ -59,6 +59,16 @@ class CryptoImpl final: public jsg::Object {
       jsg::Optional<kj::Array<kj::byte>> rem);
   bool checkPrimeSync(kj::Array<kj::byte> bufferView, uint32_t num_checks);
 
+  // Variants of the above for Node's callback APIs. Within a request the search runs on the
+  // shared ThreadPool, so that generating a large prime doesn't stall the isolate.
+  jsg::Promise<jsg::BufferSource> randomPrimeAsync(jsg::Lock& js,
+      uint32_t size,
+      bool safe,
+      jsg::Optional<kj::Array<kj::byte>> add,
+      jsg::Optional<kj::Array<kj::byte>> rem);
+  jsg::Promise<bool> checkPrimeAsync(
+      jsg::Lock& js, kj::Array<kj::byte> bufferView, uint32_t num_checks);
+
   // Hash
   class HashHandle final: public jsg::Object {
    public:
@@ -140,6 +150,30 @@ class CryptoImpl final: public jsg::Object {
       uint32_t maxmem,
       uint32_t keylen);
 
+  // Variants of the key derivation functions above for Node's callback APIs. They validate
+  // their arguments synchronously but, within a request, derive the key on the shared ThreadPool
+  // so that costly parameters don't block the isolate.
+  jsg::Promise<jsg::BufferSource> getHkdfAsync(jsg::Lock& js,
+      kj::String hash,
+      kj::Array<const kj::byte> key,
+      kj::Array<const kj::byte> salt,
+      kj::Array<const kj::byte> info,
+      uint32_t length);
+  jsg::Promise<jsg::BufferSource> getPbkdfAsync(jsg::Lock& js,
+      kj::Array<const kj::byte> password,
+      kj::Array<const kj::byte> salt,
+      uint32_t num_iterations,
+      uint32_t keylen,
+      kj::String name);
+  jsg::Promise<jsg::BufferSource> getScryptAsync(jsg::Lock& js,
+      kj::Array<const kj::byte> password,
+      kj::Array<const kj::byte> salt,
+      uint32_t N,
+      uint32_t r,
+      uint32_t p,
+      uint32_t maxmem,
+      uint32_t keylen);
+
   // Keys
   struct KeyExportOptions {
     jsg::Optional<kj::String> type;
@@ -220,15 +254,20 @@ class CryptoImpl final: public jsg::Object {
     // Primes
     JSG_METHOD(randomPrime);
     JSG_METHOD(checkPrimeSync);
+    JSG_METHOD(randomPrimeAsync);
+    JSG_METHOD(checkPrimeAsync);
     // Hash and Hmac
     JSG_NESTED_TYPE(HashHandle);
     JSG_NESTED_TYPE(HmacHandle);
     // Hkdf
     JSG_METHOD(getHkdf);
+    JSG_METHOD(getHkdfAsync);
     // Pbkdf2
     JSG_METHOD(getPbkdf);
+    JSG_METHOD(getPbkdfAsync);
     // Scrypt
     JSG_METHOD(getScrypt);
+    JSG_METHOD(getScryptAsync);
     // Keys
     JSG_METHOD(exportKey);
     JSG_METHOD(equals);
@@ -20,24 +20,31 @@ bool Channel::hasSubscribers() {
   return subscribers.size() != 0;
 }
 
-void Channel::publish(jsg::Lock& js, jsg::Value message) {
+void Channel::publish(jsg::Lock& js, jsg::JsValue message) {
   for (auto& sub: subscribers) {
-    sub.value(js, message.addRef(js), name.clone(js));
+    sub.value(js, js.v8Ref(v8::Local<v8::Value>(message)), name.clone(js));
   }
 
+  if (!IoContext::hasCurrent()) return;
   auto& context = IoContext::current();
   KJ_IF_SOME(tracer, context.getWorkerTracer()) {
+    if (nameString == kj::none) {
+      nameString = name.toString(js);
+    }
+    auto& channelName = KJ_ASSERT_NONNULL(nameString);
+    if (!tracer.wantsDiagnosticChannelEvent(channelName)) return;
+
     jsg::Serializer ser(js,
         jsg::Serializer::Options{
           .omitHeader = false,
         });
-    ser.write(js, jsg::JsValue(message.getHandle(js)));
+    ser.write(js, message);
     auto tmp = ser.release();
     JSG_REQUIRE(tmp.sharedArrayBuffers.size() == 0 && tmp.transferredArrayBuffers.size() == 0,
         Error,
         "Diagnostic events cannot be published with SharedArrayBuffer or "
         "transferred ArrayBuffer instances");
-    tracer.addDiagnosticChannelEvent(context.now(), name.toString(js), kj::mv(tmp.data));
+    tracer.addDiagnosticChannelEvent(context.now(), kj::str(channelName), kj::mv(tmp.data));
   }
 }
 
@@ -88,7 +95,7 @@ v8::Local<v8::Value> Channel::runStores(jsg::Lock& js,
         js, *store.key, store.transform(js, message.addRef(js)));
   };
 
-  publish(js, message.addRef(js));
+  publish(js, jsg::JsValue(message.getHandle(js)));
 
   v8::Local<v8::Value> receiver = js.v8Context()->Global();
   KJ_IF_SOME(val, maybeReceiver) {
@@ -18,7 +18,9 @@ class Channel: public jsg::Object {
   Channel(jsg::Name name);
 
   bool hasSubscribers();
-  void publish(jsg::Lock& js, jsg::Value message);
+  // Nearly free when nothing subscribes and no tail worker records this channel: the message is
+  // neither copied into a persistent handle nor serialized.
+  void publish(jsg::Lock& js, jsg::JsValue message);
   void subscribe(jsg::Lock& js, jsg::Identified<MessageCallback> callback);
   void unsubscribe(jsg::Lock& js, jsg::Identified<MessageCallback> callback);
   void bindStore(jsg::Lock& js,
@@ -69,6 +71,9 @@ class Channel: public jsg::Object {
   };
 
   jsg::Name name;
+  // `name` as a string, for checking whether a tail worker wants the channel's messages. Filled in
+  // the first time a traced request publishes on the channel.
+  kj::Maybe<kj::String> nameString;
   kj::HashMap<jsg::HashableV8Ref<v8::Object>, MessageCallback> subscribers;
   kj::Table<StoreEntry, kj::HashIndex<StoreCallbacks>> stores;
 
@@ -1548,6 +1548,14 @@ export const ascii = {
       if (input.charCodeAt(i) > 65535) ++i;
       if (input.charCodeAt(i) > 127) ++i;
     }
+
+    // Pure ASCII input is passed through unchanged.
+    strictEqual(Buffer.from('plain ascii').toString('ascii'), 'plain ascii');
+
+    // UTF-16LE decoding must work from both even and odd byte offsets.
+    const utf16 = Buffer.concat([Buffer.from([0]), Buffer.from('héllo', 'utf16le')]);
+    strictEqual(utf16.subarray(1).toString('utf16le'), 'héllo');
+    strictEqual(Buffer.from(utf16.subarray(1)).toString('utf16le'), 'héllo');
   },
 };
 
@@ -6173,3 +6181,25 @@ export const invalidThisTests = {
     ok(new bufferModule.Blob([]));
   },
 };
+
+// Calls that are hot enough to be optimized go through the fast API entry points of
+// compare(), isAscii() and isUtf8(); make sure they agree with the regular path, including for
+// small buffers whose contents live on the V8 heap.
+export const hotBufferUtilCalls = {
+  test() {
+    const small = Buffer.from('abc');
+    const large = Buffer.alloc(4096, 'a');
+    const larger = Buffer.alloc(4097, 'a');
+    const invalid = new Uint8Array([0xc3, 0x28]);
+    for (let i = 0; i < 20000; i++) {
+      strictEqual(Buffer.compare(small, Buffer.from('abd')), -1);
+      strictEqual(Buffer.compare(larger, large), 1);
+      strictEqual(large.compare(larger, 0, 4096), 0);
+      strictEqual(small.compare(small, 1, 3, 0, 2), 1);
+      strictEqual(isAscii(small), true);
+      strictEqual(isUtf8(invalid), false);
+      strictEqual(isUtf8(large.buffer), true);
+    }
+    throws(() => isAscii('abc'), { name: 'TypeError' });
+  },
+};
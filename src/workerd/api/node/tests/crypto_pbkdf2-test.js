@@ -326,3 +326,27 @@ export const invalid_digest_tests = {
     }
   },
 };
+
+export const pbkdf2_concurrent_callbacks_test = {
+  async test(ctrl, env, ctx) {
+    // More calls than the isolate may run off-thread at once, so that some derive inline.
+    const salts = Array.from({ length: 8 }, (_, i) => `salt${i}`);
+    const results = await Promise.all(
+      salts.map(
+        (salt) =>
+          new Promise((resolve, reject) => {
+            crypto.pbkdf2('password', salt, 1000, 32, 'sha256', (err, key) => {
+              if (err) return reject(err);
+              resolve(key);
+            });
+          })
+      )
+    );
+    for (let i = 0; i < salts.length; i++) {
+      assert.deepStrictEqual(
+        results[i],
+        crypto.pbkdf2Sync('password', salts[i], 1000, 32, 'sha256')
+      );
+    }
+  },
+};
@@ -395,6 +395,30 @@ export const test = {
   },
 };
 
+// The callback APIs search off the isolate thread, so several can be in flight at once.
+export const generatePrimeConcurrent = {
+  async test() {
+    const primes = await Promise.all(
+      Array.from(
+        { length: 4 },
+        () =>
+          new Promise((res, rej) => {
+            generatePrime(256, { bigint: true }, (err, prime) =>
+              err ? rej(err) : res(prime)
+            );
+          })
+      )
+    );
+    for (const prime of primes) {
+      strictEqual(checkPrimeSync(prime), true);
+      const result = await new Promise((res, rej) => {
+        checkPrime(prime, (err, result) => (err ? rej(err) : res(result)));
+      });
+      strictEqual(result, true);
+    }
+  },
+};
+
 export const timingSafeEqualTest = {
   test() {
     timingSafeEqual(new Uint8Array(1), new Uint8Array(1));
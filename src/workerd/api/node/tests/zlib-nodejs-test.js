@@ -2631,3 +2631,25 @@ export const compatFlagTest = {
     ]);
   },
 };
+
+export const callbackInputIsCopied = {
+  async test() {
+    // The callback APIs may compress on a background thread, so they must not observe changes
+    // the caller makes to its buffer after the call returns.
+    const input = Buffer.alloc(64 * 1024, 'a');
+    const expected = zlib.deflateSync(input);
+    const { promise, resolve, reject } = Promise.withResolvers();
+    zlib.deflate(input, (err, result) => (err ? reject(err) : resolve(result)));
+    input.fill('b');
+    assert.deepStrictEqual(await promise, expected);
+
+    const brotliInput = Buffer.alloc(64 * 1024, 'a');
+    const brotliExpected = zlib.brotliCompressSync(brotliInput);
+    const brotliDone = Promise.withResolvers();
+    zlib.brotliCompress(brotliInput, (err, result) =>
+      err ? brotliDone.reject(err) : brotliDone.resolve(result)
+    );
+    brotliInput.fill('b');
+    assert.deepStrictEqual(await brotliDone.promise, brotliExpected);
+  },
+};
@@ -7,6 +7,8 @@
 
 #include "util.h"
 
+#include <workerd/io/io-context.h>
+
 // The following implementation is adapted from Node.js
 // and therefore follows Node.js style as opposed to kj style.
 // Latest implementation of Node.js zlib can be found at:
@@ -41,37 +43,46 @@ class GrowableBuffer final {
  public:
   inline explicit GrowableBuffer(size_t _chunkSize, size_t _maxCapacity) {
     auto maxChunkSize = kj::min(_chunkSize, _maxCapacity);
-    builder = kj::heapArrayBuilder<kj::byte>(maxChunkSize);
+    storage = kj::heapArray<kj::byte>(maxChunkSize);
     chunkSize = maxChunkSize;
     maxCapacity = _maxCapacity;
   }
 
   size_t size() const {
-    return builder.size();
+    return used;
   }
   bool empty() const {
     return size() == 0;
   }
   size_t capacity() const {
-    return builder.capacity();
+    return storage.size();
   }
   size_t available() const {
     return capacity() - size();
   }
 
   kj::byte* begin() KJ_LIFETIMEBOUND {
-    return builder.begin();
+    return storage.begin();
   }
   kj::byte* end() KJ_LIFETIMEBOUND {
-    return builder.end();
+    return storage.begin() + used;
   }
 
   kj::Array<kj::byte> releaseAsArray() {
-    // TODO(perf):  Avoid a copy/move by allowing Array<T> to point to incomplete space?
-    if (!builder.isFull()) {
-      setCapacity(size());
+    if (used == capacity()) {
+      return kj::mv(storage);
+    }
+    if (available() <= used / 4) {
+      // The unused tail is small relative to the output, so rather than copying everything into
+      // an exactly-sized array, hand out the filled prefix with the whole allocation attached.
+      auto result = storage.first(used).attach(kj::mv(storage));
+      used = 0;
+      return result;
     }
-    return builder.finish();
+    // Mostly empty (e.g. a small result in a full-size first chunk); a copy is cheap and avoids
+    // pinning the slack for as long as the result lives.
+    setCapacity(used);
+    return kj::mv(storage);
   }
 
   void adjustUnused(size_t unused) {
@@ -79,8 +90,8 @@ class GrowableBuffer final {
   }
 
   void resize(size_t size) {
-    if (size > builder.capacity()) grow(size);
-    builder.resize(size);
+    if (size > capacity()) grow(size);
+    used = size;
   }
 
   void addChunk() {
@@ -88,13 +99,14 @@ class GrowableBuffer final {
   }
 
   void reserve(size_t size) {
-    if (size > builder.capacity()) {
+    if (size > capacity()) {
       grow(size);
     }
   }
 
  private:
-  kj::ArrayBuilder<kj::byte> builder;
+  kj::Array<kj::byte> storage;
+  size_t used = 0;
   size_t chunkSize;
   size_t maxCapacity;
 
@@ -103,13 +115,13 @@ class GrowableBuffer final {
     setCapacity(kj::min(maxCapacity, kj::max(minCapacity, capacity() == 0 ? 4 : capacity() * 2)));
   }
   void setCapacity(size_t newSize) {
-    if (builder.size() > newSize) {
-      builder.truncate(newSize);
+    if (used > newSize) {
+      used = newSize;
     }
 
-    kj::ArrayBuilder<kj::byte> newBuilder = kj::heapArrayBuilder<kj::byte>(newSize);
-    newBuilder.addAll(kj::mv(builder));
-    builder = kj::mv(newBuilder);
+    auto newStorage = kj::heapArray<kj::byte>(newSize);
+    newStorage.first(used).copyFrom(storage.first(used));
+    storage = kj::mv(newStorage);
   }
 };
 }  // namespace
@@ -802,9 +814,8 @@ static kj::Array<kj::byte> syncProcessBuffer(Context& ctx, GrowableBuffer& resul
 
   return result.releaseAsArray();
 }
-}  // namespace
 
-kj::Array<kj::byte> ZlibUtil::zlibSync(
+kj::Array<kj::byte> zlibSyncImpl(
     ZlibUtil::InputSource data, ZlibContext::Options opts, ZlibModeValue mode) {
   // Any use of zlib APIs constitutes an implicit dependency on Allocator which must
   // remain alive until the zlib stream is destroyed
@@ -841,24 +852,8 @@ kj::Array<kj::byte> ZlibUtil::zlibSync(
   return syncProcessBuffer(ctx, result);
 }
 
-void ZlibUtil::zlibWithCallback(jsg::Lock& js,
-    InputSource data,
-    ZlibContext::Options options,
-    ZlibModeValue mode,
-    CompressCallback cb) {
-  // Capture only relevant errors so they can be passed to the callback
-  auto res = js.tryCatch([&]() {
-    return CompressCallbackArg(zlibSync(kj::mv(data), kj::mv(options), mode));
-  }, [&](jsg::Value&& exception) {
-    return CompressCallbackArg(jsg::JsValue(exception.getHandle(js)));
-  });
-
-  // Ensure callback is invoked only once
-  cb(js, kj::mv(res));
-}
-
 template <typename Context>
-kj::Array<kj::byte> ZlibUtil::brotliSync(InputSource data, BrotliContext::Options opts) {
+kj::Array<kj::byte> brotliSyncImpl(ZlibUtil::InputSource data, BrotliContext::Options opts) {
   // Any use of brotli APIs constitutes an implicit dependency on Allocator which must
   // remain alive until the brotli state is destroyed
   CompressionAllocator allocator;
@@ -908,18 +903,95 @@ kj::Array<kj::byte> ZlibUtil::brotliSync(InputSource data, BrotliContext::Option
   return syncProcessBuffer(ctx, result);
 }
 
+using CompressResult = kj::OneOf<kj::Array<kj::byte>, kj::Exception>;
+
+// Copies `data` out of the JavaScript heap so that it can be read without the isolate lock.
+ZlibUtil::InputSource copyInputSource(ZlibUtil::InputSource data) {
+  KJ_SWITCH_ONEOF(data) {
+    KJ_CASE_ONEOF(dataBuf, kj::Array<kj::byte>) {
+      return kj::heapArray<kj::byte>(dataBuf.asPtr());
+    }
+    KJ_CASE_ONEOF(dataStr, jsg::NonCoercible<kj::String>) {
+      return kj::mv(dataStr);
+    }
+  }
+  KJ_UNREACHABLE;
+}
+
+CompressResult catchCompressError(kj::FunctionParam<kj::Array<kj::byte>()> compress) {
+  kj::Array<kj::byte> output;
+  KJ_IF_SOME(exception, kj::runCatchingExceptions([&]() { output = compress(); })) {
+    return kj::mv(exception);
+  }
+  return kj::mv(output);
+}
+
+void invokeCallback(jsg::Lock& js, ZlibUtil::CompressCallback& cb, CompressResult result) {
+  KJ_SWITCH_ONEOF(result) {
+    KJ_CASE_ONEOF(output, kj::Array<kj::byte>) {
+      cb(js, ZlibUtil::CompressCallbackArg(kj::mv(output)));
+    }
+    KJ_CASE_ONEOF(exception, kj::Exception) {
+      auto error = js.exceptionToJsValue(kj::mv(exception));
+      cb(js, ZlibUtil::CompressCallbackArg(error.getHandle(js)));
+    }
+  }
+}
+
+// Runs `work` and passes its output, or the error it threw, to `cb`. Within a request, `work`
+// runs on the shared ThreadPool when the isolate has an off-thread slot free, so that a large
+// input doesn't stall every other request on the isolate; it must own copies of its inputs.
+void compressWithCallback(
+    jsg::Lock& js, kj::Function<CompressResult()> work, ZlibUtil::CompressCallback cb) {
+  if (IoContext::hasCurrent()) {
+    auto& context = IoContext::current();
+    KJ_IF_SOME(promise, context.tryRunOffThread(kj::mv(work))) {
+      context.awaitIo(js, kj::mv(promise),
+          [cb = kj::mv(cb)](jsg::Lock& js, CompressResult result) mutable {
+        invokeCallback(js, cb, kj::mv(result));
+      });
+      return;
+    }
+  }
+
+  invokeCallback(js, cb, work());
+}
+}  // namespace
+
+kj::Array<kj::byte> ZlibUtil::zlibSync(
+    InputSource data, ZlibContext::Options options, ZlibModeValue mode) {
+  return zlibSyncImpl(kj::mv(data), kj::mv(options), mode);
+}
+
+void ZlibUtil::zlibWithCallback(jsg::Lock& js,
+    InputSource data,
+    ZlibContext::Options options,
+    ZlibModeValue mode,
+    CompressCallback cb) {
+  KJ_IF_SOME(dictionary, options.dictionary) {
+    dictionary = kj::heapArray<kj::byte>(dictionary.asPtr());
+  }
+  compressWithCallback(js,
+      [data = copyInputSource(kj::mv(data)), options = kj::mv(options),
+          mode]() mutable -> CompressResult {
+    return catchCompressError([&]() { return zlibSyncImpl(kj::mv(data), kj::mv(options), mode); });
+  }, kj::mv(cb));
+}
+
+template <typename Context>
+kj::Array<kj::byte> ZlibUtil::brotliSync(InputSource data, BrotliContext::Options options) {
+  return brotliSyncImpl<Context>(kj::mv(data), kj::mv(options));
+}
+
 template <typename Context>
 void ZlibUtil::brotliWithCallback(
     jsg::Lock& js, InputSource data, BrotliContext::Options options, CompressCallback cb) {
-  // Capture only relevant errors so they can be passed to the callback
-  auto res = js.tryCatch([&]() {
-    return CompressCallbackArg(brotliSync<Context>(kj::mv(data), kj::mv(options)));
-  }, [&](jsg::Value&& exception) {
-    return CompressCallbackArg(jsg::JsValue(exception.getHandle(js)));
-  });
-
-  // Ensure callback is invoked only once
-  cb(js, kj::mv(res));
+  compressWithCallback(js,
+      [data = copyInputSource(kj::mv(data)),
+          options = kj::mv(options)]() mutable -> CompressResult {
+    return catchCompressError(
+        [&]() { return brotliSyncImpl<Context>(kj::mv(data), kj::mv(options)); });
+  }, kj::mv(cb));
 }
 
 #ifndef CREATE_TEMPLATE
@@ -86,7 +86,9 @@ class PyodideMetadataReader: public jsg::Object {
   bool snapshotToDisk;
   bool createBaselineSnapshot;
   bool usePackagesInArtifactBundler;
-  kj::Maybe<kj::Array<kj::byte>> memorySnapshot;
+  // Only ever read (straight into the Wasm heap via readMemorySnapshot()), so this may be a
+  // read-only mapping of a snapshot file shared by every isolate on the host.
+  kj::Maybe<kj::Array<const kj::byte>> memorySnapshot;
 
  public:
   PyodideMetadataReader(kj::String mainModule,
@@ -100,7 +102,7 @@ class PyodideMetadataReader: public jsg::Object {
       bool snapshotToDisk,
       bool createBaselineSnapshot,
       bool usePackagesInArtifactBundler,
-      kj::Maybe<kj::Array<kj::byte>> memorySnapshot)
+      kj::Maybe<kj::Array<const kj::byte>> memorySnapshot)
       : mainModule(kj::mv(mainModule)),
         names(kj::mv(names)),
         contents(kj::mv(contents)),
@@ -325,7 +327,7 @@ class ArtifactBundler: public jsg::Object {
 
  private:
   // A memory snapshot of the state of the Python interpreter after initialisation. Used to speed
-  // up cold starts.
+  // up cold starts. As with PyodideMetadataReader, this may be a shared read-only mapping.
   kj::Maybe<kj::Array<const kj::byte>> existingSnapshot;
   bool isValidating;
 };
@@ -71,6 +71,9 @@ export default {
   async queue(batch, env, ctx) {
     assert.strictEqual(batch.queue, 'test-queue');
     assert.strictEqual(batch.messages.length, 5);
+    // The messages array is built once and cached, as is each deserialized body.
+    assert.strictEqual(batch.messages, batch.messages);
+    assert.strictEqual(batch.messages[2].body, batch.messages[2].body);
 
     assert.strictEqual(batch.messages[0].id, '#0');
     assert.strictEqual(batch.messages[0].body, 'ghi');
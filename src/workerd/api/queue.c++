@@ -130,8 +130,10 @@ struct SerializedWithOptions {
   kj::Maybe<int> delaySeconds;
 };
 
+// `body` is only consumed for the "bytes" content type, so if deserialization throws the caller
+// still holds the data.
 jsg::JsValue deserialize(
-    jsg::Lock& js, kj::Array<kj::byte> body, kj::Maybe<kj::StringPtr> contentType) {
+    jsg::Lock& js, kj::Array<kj::byte>& body, kj::Maybe<kj::StringPtr> contentType) {
   auto type = contentType.orDefault(IncomingQueueMessage::ContentType::V8);
 
   if (type == IncomingQueueMessage::ContentType::TEXT) {
@@ -146,27 +148,6 @@ jsg::JsValue deserialize(
     JSG_FAIL_REQUIRE(TypeError, kj::str("Unsupported queue message content type: ", type));
   }
 }
-
-jsg::JsValue deserialize(jsg::Lock& js, rpc::QueueMessage::Reader message) {
-  kj::StringPtr type = message.getContentType();
-  if (type == "") {
-    // default to v8 format
-    type = IncomingQueueMessage::ContentType::V8;
-  }
-
-  if (type == IncomingQueueMessage::ContentType::TEXT) {
-    return js.str(message.getData().asChars());
-  } else if (type == IncomingQueueMessage::ContentType::BYTES) {
-    kj::Array<kj::byte> bytes = kj::heapArray(message.getData().asBytes());
-    return jsg::JsValue(js.bytes(kj::mv(bytes)).getHandle(js));
-  } else if (type == IncomingQueueMessage::ContentType::JSON) {
-    return jsg::JsValue::fromJson(js, message.getData().asChars());
-  } else if (type == IncomingQueueMessage::ContentType::V8) {
-    return jsg::JsValue(jsg::Deserializer(js, message.getData()).readValue(js));
-  } else {
-    JSG_FAIL_REQUIRE(TypeError, kj::str("Unsupported queue message content type: ", type));
-  }
-}
 }  // namespace
 
 kj::Promise<void> WorkerQueue::send(
@@ -264,39 +245,56 @@ kj::Promise<void> WorkerQueue::sendBatch(jsg::Lock& js,
   auto serializedBodies = builder.finish();
 
   // Construct the request body by concatenating the messages together into a JSON message.
-  // Done manually to minimize copies, although it'd be nice to make this safer.
-  // (totalSize + 2) / 3 * 4 is equivalent to ceil(totalSize / 3) * 4 for base64 encoding overhead.
-  auto estimatedSize = (totalSize + 2) / 3 * 4 + messageCount * 64 + 32;
-  kj::Vector<char> bodyBuilder(estimatedSize);
-  bodyBuilder.addAll("{\"messages\":["_kj);
+  // Done manually to minimize copies, although it'd be nice to make this safer. The exact size is
+  // computed up front so the body takes a single allocation, and each message is base64-encoded
+  // directly into its place in that buffer.
+  auto delayStrings = KJ_MAP(item, serializedBodies) {
+    return item.delaySeconds.map([](int secs) { return kj::str(secs); });
+  };
+  size_t bodySize = "{\"messages\":["_kj.size() + "]}"_kj.size() + (messageCount - 1);
   for (size_t i = 0; i < messageCount; ++i) {
-    bodyBuilder.addAll("{\"body\":\""_kj);
-    // TODO(perf): We should be able to encode the data directly into bodyBuilder's buffer to
-    // eliminate a lot of data copying (whereas now encodeBase64 allocates a new buffer of its own
-    // to hold its result, which we then have to copy into bodyBuilder).
-    bodyBuilder.addAll(kj::encodeBase64(serializedBodies[i].body.data));
-    bodyBuilder.add('"');
+    auto& item = serializedBodies[i];
+    bodySize += "{\"body\":\""_kj.size() + base64EncodedLength(item.body.data.size()) + 2;
+    KJ_IF_SOME(contentType, item.contentType) {
+      bodySize += ",\"contentType\":\""_kj.size() + contentType.size() + 1;
+    }
+    KJ_IF_SOME(delaySecs, delayStrings[i]) {
+      bodySize += ",\"delaySecs\": "_kj.size() + delaySecs.size();
+    }
+  }
+
+  auto bodyChars = kj::heapArray<char>(bodySize + 1);
+  auto remaining = bodyChars.asPtr();
+  auto append = [&](kj::ArrayPtr<const char> text) {
+    remaining.first(text.size()).copyFrom(text);
+    remaining = remaining.slice(text.size());
+  };
+  append("{\"messages\":["_kj);
+  for (size_t i = 0; i < messageCount; ++i) {
+    append("{\"body\":\""_kj);
+    remaining = remaining.slice(fastEncodeBase64Into(serializedBodies[i].body.data, remaining));
+    append("\""_kj);
 
     KJ_IF_SOME(contentType, serializedBodies[i].contentType) {
-      bodyBuilder.addAll(",\"contentType\":\""_kj);
-      bodyBuilder.addAll(contentType);
-      bodyBuilder.add('"');
+      append(",\"contentType\":\""_kj);
+      append(contentType);
+      append("\""_kj);
     }
 
-    KJ_IF_SOME(delaySecs, serializedBodies[i].delaySeconds) {
-      bodyBuilder.addAll(",\"delaySecs\": "_kj);
-      bodyBuilder.addAll(kj::str(delaySecs));
+    KJ_IF_SOME(delaySecs, delayStrings[i]) {
+      append(",\"delaySecs\": "_kj);
+      append(delaySecs);
     }
 
-    bodyBuilder.addAll("}"_kj);
+    append("}"_kj);
     if (i < messageCount - 1) {
-      bodyBuilder.add(',');
+      append(","_kj);
     }
   }
-  bodyBuilder.addAll("]}"_kj);
-  bodyBuilder.add('\0');
-  KJ_DASSERT(bodyBuilder.size() <= estimatedSize);
-  kj::String body(bodyBuilder.releaseAsArray());
+  append("]}"_kj);
+  KJ_ASSERT(remaining.size() == 1);
+  remaining[0] = '\0';
+  kj::String body(kj::mv(bodyChars));
   KJ_DASSERT(jsg::JsValue::fromJson(js, body).isObject());
 
   auto client = context.getHttpClient(subrequestChannel, true, kj::none, "queue_send"_kjc);
@@ -342,7 +340,12 @@ QueueMessage::QueueMessage(
     jsg::Lock& js, rpc::QueueMessage::Reader message, IoPtr<QueueEventResult> result)
     : id(kj::str(message.getId())),
       timestamp(message.getTimestampNs() * kj::NANOSECONDS + kj::UNIX_EPOCH),
-      body(deserialize(js, message).addRef(js)),
+      body(SerializedBody{
+        .data = kj::heapArray(message.getData().asBytes()),
+        .contentType = message.getContentType() == ""
+            ? kj::Maybe<kj::String>(kj::none)
+            : kj::Maybe<kj::String>(kj::str(message.getContentType())),
+      }),
       attempts(message.getAttempts()),
       result(result) {}
 // Note that we must make deep copies of all data here since the incoming Reader may be
@@ -352,12 +355,25 @@ QueueMessage::QueueMessage(
     jsg::Lock& js, IncomingQueueMessage message, IoPtr<QueueEventResult> result)
     : id(kj::mv(message.id)),
       timestamp(message.timestamp),
-      body(deserialize(js, kj::mv(message.body), message.contentType).addRef(js)),
+      body(SerializedBody{
+        .data = kj::mv(message.body),
+        .contentType = kj::mv(message.contentType),
+      }),
       attempts(message.attempts),
       result(result) {}
 
 jsg::JsValue QueueMessage::getBody(jsg::Lock& js) {
-  return body.getHandle(js);
+  KJ_SWITCH_ONEOF(body) {
+    KJ_CASE_ONEOF(serialized, SerializedBody) {
+      auto value = deserialize(js, serialized.data, serialized.contentType);
+      body = value.addRef(js);
+      return value;
+    }
+    KJ_CASE_ONEOF(value, jsg::JsRef<jsg::JsValue>) {
+      return value.getHandle(js);
+    }
+  }
+  KJ_UNREACHABLE;
 }
 
 void QueueMessage::retry(jsg::Optional<QueueRetryOptions> options) {
@@ -434,6 +450,19 @@ QueueEvent::QueueEvent(jsg::Lock& js, Params params, IoPtr<QueueEventResult> res
   messages = messagesBuilder.finish();
 }
 
+jsg::JsArray QueueEvent::getMessages(
+    jsg::Lock& js, const jsg::TypeHandler<jsg::Ref<QueueMessage>>& messageHandler) {
+  KJ_IF_SOME(array, messagesArray) {
+    return array.getHandle(js);
+  }
+  auto values = KJ_MAP(message, messages) {
+    return jsg::JsValue(messageHandler.wrap(js, message.addRef()));
+  };
+  auto array = js.arr(values);
+  messagesArray = jsg::JsRef<jsg::JsArray>(js, array);
+  return array;
+}
+
 void QueueEvent::retryAll(jsg::Optional<QueueRetryOptions> options) {
   if (result->ackAll) {
     IoContext::current().logWarning(
@@ -187,19 +187,36 @@ class QueueMessage final: public jsg::Object {
 
   void visitForMemoryInfo(jsg::MemoryTracker& tracker) const {
     tracker.trackField("id", id);
-    tracker.trackField("body", body);
+    KJ_SWITCH_ONEOF(body) {
+      KJ_CASE_ONEOF(serialized, SerializedBody) {
+        tracker.trackField("body", serialized.data);
+      }
+      KJ_CASE_ONEOF(value, jsg::JsRef<jsg::JsValue>) {
+        tracker.trackField("body", value);
+      }
+    }
     tracker.trackFieldWithSize("IoPtr<QueueEventResult>", sizeof(IoPtr<QueueEventResult>));
   }
 
  private:
+  // The message body as it arrived, before it has been read from JS. Deserialization is deferred
+  // until the first `body` access so that consumers which only look at ids or attempts never pay
+  // for it.
+  struct SerializedBody {
+    kj::Array<kj::byte> data;
+    kj::Maybe<kj::String> contentType;
+  };
+
   kj::String id;
   kj::Date timestamp;
-  jsg::JsRef<jsg::JsValue> body;
+  kj::OneOf<SerializedBody, jsg::JsRef<jsg::JsValue>> body;
   uint16_t attempts;
   IoPtr<QueueEventResult> result;
 
   void visitForGc(jsg::GcVisitor& visitor) {
-    visitor.visit(body);
+    KJ_IF_SOME(value, body.tryGet<jsg::JsRef<jsg::JsValue>>()) {
+      visitor.visit(value);
+    }
   }
 };
 
@@ -219,9 +236,10 @@ class QueueEvent final: public ExtendableEvent {
 
   static jsg::Ref<QueueEvent> constructor(kj::String type) = delete;
 
-  kj::ArrayPtr<jsg::Ref<QueueMessage>> getMessages() {
-    return messages;
-  }
+  // Returns the messages as a JS array. The array is built on first access and cached, so
+  // repeated reads (e.g. `batch.messages` from a module handler) return the same array.
+  jsg::JsArray getMessages(
+      jsg::Lock& js, const jsg::TypeHandler<jsg::Ref<QueueMessage>>& messageHandler);
   kj::StringPtr getQueueName() {
     return queueName;
   }
@@ -268,15 +286,15 @@ class QueueEvent final: public ExtendableEvent {
   }
 
  private:
-  // TODO(perf): Should we store these in a v8 array directly rather than this intermediate kj
-  // array to avoid one intermediate copy?
   kj::Array<jsg::Ref<QueueMessage>> messages;
+  kj::Maybe<jsg::JsRef<jsg::JsArray>> messagesArray;
   kj::String queueName;
   IoPtr<QueueEventResult> result;
   CompletionStatus completionStatus = Incomplete{};
 
   void visitForGc(jsg::GcVisitor& visitor) {
     visitor.visitAll(messages);
+    visitor.visit(messagesArray);
   }
 };
 
@@ -285,8 +303,9 @@ class QueueController final: public jsg::Object {
  public:
   QueueController(jsg::Ref<QueueEvent> event): event(kj::mv(event)) {}
 
-  kj::ArrayPtr<jsg::Ref<QueueMessage>> getMessages() {
-    return event->getMessages();
+  jsg::JsArray getMessages(
+      jsg::Lock& js, const jsg::TypeHandler<jsg::Ref<QueueMessage>>& messageHandler) {
+    return event->getMessages(js, messageHandler);
   }
   kj::StringPtr getQueueName() {
     return event->getQueueName();
@@ -8,6 +8,7 @@
 
 #include <workerd/api/r2-api.capnp.h>
 #include <workerd/util/http-util.h>
+#include <workerd/util/message-arena.h>
 
 #include <capnp/compat/json.h>
 #include <capnp/message.h>
@@ -30,9 +31,8 @@ jsg::Promise<jsg::Ref<R2Bucket>> R2Admin::create(
   auto client = context.getHttpClientWithSpans(subrequestChannel, true, kj::none, "r2_create"_kjc,
       {{"rpc.service"_kjc, "r2"_kjc}, {"rpc.method"_kjc, "CreateBucket"_kjc}});
 
-  capnp::JsonCodec json;
-  json.handleByAnnotation<R2BindingRequest>();
-  capnp::MallocMessageBuilder requestMessage;
+  auto& json = getR2JsonCodec<R2BindingRequest>();
+  PooledMessageBuilder requestMessage;
 
   auto requestBuilder = requestMessage.initRoot<R2BindingRequest>();
   requestBuilder.setVersion(VERSION_PUBLIC_BETA);
@@ -62,10 +62,8 @@ jsg::Promise<R2Admin::ListResult> R2Admin::list(jsg::Lock& js,
   auto client = context.getHttpClientWithSpans(subrequestChannel, true, kj::none, "r2_list"_kjc,
       {{"rpc.service"_kjc, "r2"_kjc}, {"rpc.method"_kjc, "ListObjects"_kjc}});
 
-  capnp::JsonCodec json;
-  json.handleByAnnotation<R2BindingRequest>();
-  json.setHasMode(capnp::HasMode::NON_DEFAULT);
-  capnp::MallocMessageBuilder requestMessage;
+  auto& json = getR2JsonCodec<R2BindingRequest, capnp::HasMode::NON_DEFAULT>();
+  PooledMessageBuilder requestMessage;
 
   auto requestBuilder = requestMessage.initRoot<R2BindingRequest>();
   requestBuilder.setVersion(VERSION_PUBLIC_BETA);
@@ -87,9 +85,8 @@ jsg::Promise<R2Admin::ListResult> R2Admin::list(jsg::Lock& js,
       [this, &retrievedBucketType, &errorType](jsg::Lock& js, R2Result r2Result) mutable {
     r2Result.throwIfError("listBucket", errorType);
 
-    capnp::MallocMessageBuilder responseMessage;
-    capnp::JsonCodec json;
-    json.handleByAnnotation<R2ListResponse>();
+    PooledMessageBuilder responseMessage;
+    auto& json = getR2JsonCodec<R2ListResponse>();
     auto responseBuilder = responseMessage.initRoot<R2ListBucketResponse>();
     json.decode(KJ_ASSERT_NONNULL(r2Result.metadataPayload), responseBuilder);
 
@@ -120,9 +117,8 @@ jsg::Promise<void> R2Admin::delete_(
   auto client = context.getHttpClientWithSpans(subrequestChannel, true, kj::none, "r2_delete"_kjc,
       {{"rpc.service"_kjc, "r2"_kjc}, {"rpc.method"_kjc, "DeleteBucket"_kjc}});
 
-  capnp::JsonCodec json;
-  json.handleByAnnotation<R2BindingRequest>();
-  capnp::MallocMessageBuilder requestMessage;
+  auto& json = getR2JsonCodec<R2BindingRequest>();
+  PooledMessageBuilder requestMessage;
 
   auto requestBuilder = requestMessage.initRoot<R2BindingRequest>();
   requestBuilder.setVersion(VERSION_PUBLIC_BETA);
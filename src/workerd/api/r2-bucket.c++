@@ -11,7 +11,9 @@
 #include <workerd/api/http.h>
 #include <workerd/api/r2-api.capnp.h>
 #include <workerd/api/streams.h>
+#include <workerd/util/http-date.h>
 #include <workerd/util/http-util.h>
+#include <workerd/util/message-arena.h>
 #include <workerd/util/mimetype.h>
 
 #include <capnp/compat/json.h>
@@ -19,8 +21,10 @@
 #include <kj/compat/http.h>
 #include <kj/encoding.h>
 
+#include <algorithm>
 #include <array>
 #include <cmath>
+#include <deque>
 #include <regex>
 
 namespace workerd::api::public_beta {
@@ -29,17 +33,15 @@ static bool isWholeNumber(double x) {
   return modf(x, &intpart) == 0;
 }
 
-// TODO(perf): Would be nice to expose the v8 internals for parsing a date/stringifying it as
-// something an embedder can call directly rather than doing this rigamarole. It would also avoid
-// concerns about the user overriding the methods we're invoking.
+// Conditional headers and `Expires` are nearly always HTTP dates, which are parsed natively. Other
+// strings are still accepted as far as V8's Date parser accepts them, as they always have been.
 static kj::Date parseDate(jsg::Lock& js, kj::StringPtr value) {
+  KJ_IF_SOME(date, parseHttpDate(value)) {
+    return date;
+  }
   return js.date(value);
 }
 
-static jsg::ByteString toUTCString(jsg::Lock& js, kj::Date date) {
-  return js.date(date).toUTCString(js);
-}
-
 enum class OptionalMetadata : uint16_t {
   Http = static_cast<uint8_t>(R2ListRequest::IncludeField::HTTP),
   Custom = static_cast<uint8_t>(R2ListRequest::IncludeField::CUSTOM),
@@ -185,10 +187,9 @@ static kj::Maybe<jsg::Ref<T>> parseObjectMetadata(kj::StringPtr action,
   kj::ArrayPtr<OptionalMetadata> expectedFields = {
     expectedFieldsOwned.data(), expectedFieldsOwned.size()};
 
-  capnp::MallocMessageBuilder responseMessage;
-  capnp::JsonCodec json;
+  PooledMessageBuilder responseMessage;
   // Annoyingly our R2GetResponse alias isn't emitted.
-  json.handleByAnnotation<R2HeadResponse>();
+  auto& json = getR2JsonCodec<R2HeadResponse>();
   auto responseBuilder = responseMessage.initRoot<R2HeadResponse>();
   json.decode(KJ_ASSERT_NONNULL(r2Result.metadataPayload), responseBuilder);
 
@@ -343,10 +344,8 @@ jsg::Promise<kj::Maybe<jsg::Ref<R2Bucket::HeadResult>>> R2Bucket::head(jsg::Lock
 
     auto client = context.getHttpClient(clientIndex, true, kj::none, "r2_get"_kjc);
 
-    capnp::JsonCodec json;
-    json.handleByAnnotation<R2BindingRequest>();
-    json.setHasMode(capnp::HasMode::NON_DEFAULT);
-    capnp::MallocMessageBuilder requestMessage;
+    auto& json = getR2JsonCodec<R2BindingRequest, capnp::HasMode::NON_DEFAULT>();
+    PooledMessageBuilder requestMessage;
 
     auto requestBuilder = requestMessage.initRoot<R2BindingRequest>();
     requestBuilder.setVersion(VERSION_PUBLIC_BETA);
@@ -379,10 +378,8 @@ R2Bucket::get(jsg::Lock& js,
 
     auto client = context.getHttpClient(clientIndex, true, kj::none, "r2_get"_kjc);
 
-    capnp::JsonCodec json;
-    json.handleByAnnotation<R2BindingRequest>();
-    json.setHasMode(capnp::HasMode::NON_DEFAULT);
-    capnp::MallocMessageBuilder requestMessage;
+    auto& json = getR2JsonCodec<R2BindingRequest, capnp::HasMode::NON_DEFAULT>();
+    PooledMessageBuilder requestMessage;
 
     auto requestBuilder = requestMessage.initRoot<R2BindingRequest>();
     requestBuilder.setVersion(VERSION_PUBLIC_BETA);
@@ -425,6 +422,18 @@ jsg::Promise<kj::Maybe<jsg::Ref<R2Bucket::HeadResult>>> R2Bucket::put(jsg::Lock&
     jsg::Optional<PutOptions> options,
     const jsg::TypeHandler<jsg::Ref<R2Error>>& errorType) {
   return js.evalNow([&] {
+    KJ_IF_SOME(o, options) {
+      KJ_IF_SOME(multipart, o.multipart) {
+        KJ_IF_SOME(v, value) {
+          KJ_IF_SOME(stream, v.tryGet<jsg::Ref<ReadableStream>>()) {
+            auto multipartOptions = kj::mv(multipart);
+            return putMultipart(js, kj::mv(name), kj::mv(stream), kj::mv(o),
+                kj::mv(multipartOptions), errorType);
+          }
+        }
+      }
+    }
+
     auto cancelReader = kj::defer([&] {
       KJ_IF_SOME(v, value) {
         KJ_SWITCH_ONEOF(v) {
@@ -441,10 +450,8 @@ jsg::Promise<kj::Maybe<jsg::Ref<R2Bucket::HeadResult>>> R2Bucket::put(jsg::Lock&
     auto& context = IoContext::current();
     auto client = context.getHttpClient(clientIndex, true, kj::none, "r2_put"_kjc);
 
-    capnp::JsonCodec json;
-    json.handleByAnnotation<R2BindingRequest>();
-    json.setHasMode(capnp::HasMode::NON_DEFAULT);
-    capnp::MallocMessageBuilder requestMessage;
+    auto& json = getR2JsonCodec<R2BindingRequest, capnp::HasMode::NON_DEFAULT>();
+    PooledMessageBuilder requestMessage;
 
     auto requestBuilder = requestMessage.initRoot<R2BindingRequest>();
     requestBuilder.setVersion(VERSION_PUBLIC_BETA);
@@ -624,6 +631,224 @@ jsg::Promise<kj::Maybe<jsg::Ref<R2Bucket::HeadResult>>> R2Bucket::put(jsg::Lock&
   });
 }
 
+namespace {
+
+// R2 requires every part but the last to be at least 5 MiB, and allows at most 10000 parts.
+constexpr double MIN_MULTIPART_PART_SIZE = 5 * 1024 * 1024;
+constexpr double MAX_MULTIPART_PART_SIZE = 5.0 * 1024 * 1024 * 1024;
+constexpr double DEFAULT_MULTIPART_PART_SIZE = 8 * 1024 * 1024;
+constexpr int DEFAULT_MULTIPART_CONCURRENCY = 4;
+constexpr int MAX_MULTIPART_CONCURRENCY = 16;
+constexpr int MAX_MULTIPART_PARTS = 10000;
+
+// Drives a put() with the `multipart` option. The body is read into buffers of `partSize` bytes,
+// each of which is uploaded with R2MultipartUpload::uploadPart() as soon as it is full. A new
+// buffer is only started while fewer than `concurrency` uploads are outstanding, which bounds the
+// memory used to `concurrency` buffers.
+class MultipartPut: public kj::Refcounted {
+ public:
+  MultipartPut(jsg::Ref<R2MultipartUpload> upload,
+      jsg::Ref<ReadableStreamDefaultReader> reader,
+      size_t partSize,
+      size_t concurrency,
+      kj::Maybe<kj::String> ssecKey,
+      const jsg::TypeHandler<jsg::Ref<R2Error>>& errorType)
+      : upload(kj::mv(upload)),
+        reader(kj::mv(reader)),
+        partSize(partSize),
+        concurrency(concurrency),
+        ssecKey(kj::mv(ssecKey)),
+        errorType(errorType) {}
+
+  // Uploads the whole body and completes the upload, or aborts it if anything fails.
+  jsg::Promise<jsg::Ref<R2Bucket::HeadResult>> run(jsg::Lock& js) {
+    return js.evalNow([&] { return pump(js); })
+        .then(js, [self = kj::addRef(*this)](jsg::Lock& js) mutable {
+      auto parts = self->uploaded.releaseAsArray();
+      std::sort(parts.begin(), parts.end(),
+          [](const auto& a, const auto& b) { return a.partNumber < b.partNumber; });
+      return self->upload->complete(js, kj::mv(parts), self->errorType);
+    }).catch_(js, [self = kj::addRef(*this)](jsg::Lock& js, jsg::Value exception) mutable {
+      return self->fail(js, kj::mv(exception));
+    });
+  }
+
+ private:
+  jsg::Ref<R2MultipartUpload> upload;
+  jsg::Ref<ReadableStreamDefaultReader> reader;
+  size_t partSize;
+  size_t concurrency;
+  kj::Maybe<kj::String> ssecKey;
+  const jsg::TypeHandler<jsg::Ref<R2Error>>& errorType;
+
+  // The part being filled, and what is left of the last chunk read from the body.
+  kj::Vector<byte> part;
+  kj::Maybe<jsg::BufferSource> pending;
+  size_t pendingOffset = 0;
+  bool bodyDone = false;
+
+  // Outstanding uploads, oldest first.
+  std::deque<jsg::Promise<void>> uploads;
+  kj::Vector<R2MultipartUpload::UploadedPart> uploaded;
+  int nextPartNumber = 1;
+
+  // Moves the body into parts and uploads them until the body has been read and every upload
+  // has finished, waiting for the body or for uploads as needed.
+  jsg::Promise<void> pump(jsg::Lock& js) {
+    for (;;) {
+      size_t pendingSize = 0;
+      KJ_IF_SOME(p, pending) {
+        pendingSize = p.size() - pendingOffset;
+      }
+
+      bool lastPart = bodyDone && pendingSize == 0;
+      if (part.size() == partSize || (lastPart && (part.size() > 0 || nextPartNumber == 1))) {
+        startUpload(js);
+      } else if (pendingSize > 0) {
+        if (part.size() == 0) {
+          if (uploads.size() >= concurrency) {
+            return waitForOldestUpload(js);
+          }
+          part.reserve(partSize);
+        }
+        auto& p = KJ_ASSERT_NONNULL(pending);
+        auto amount = kj::min(partSize - part.size(), pendingSize);
+        part.addAll(p.asArrayPtr().slice(pendingOffset, pendingOffset + amount));
+        pendingOffset += amount;
+      } else if (!bodyDone) {
+        return reader->read(js).then(
+            js, [self = kj::addRef(*this)](jsg::Lock& js, ReadResult result) mutable {
+          self->receive(js, kj::mv(result));
+          return self->pump(js);
+        });
+      } else if (!uploads.empty()) {
+        return waitForOldestUpload(js);
+      } else {
+        return js.resolvedPromise();
+      }
+    }
+  }
+
+  jsg::Promise<void> waitForOldestUpload(jsg::Lock& js) {
+    auto oldest = kj::mv(uploads.front());
+    uploads.pop_front();
+    return oldest.then(
+        js, [self = kj::addRef(*this)](jsg::Lock& js) mutable { return self->pump(js); });
+  }
+
+  void receive(jsg::Lock& js, ReadResult result) {
+    pending = kj::none;
+    pendingOffset = 0;
+    if (result.done) {
+      bodyDone = true;
+      return;
+    }
+    auto& value = JSG_REQUIRE_NONNULL(
+        result.value, TypeError, "The body of a multipart put() produced an empty chunk.");
+    auto handle = value.getHandle(js);
+    JSG_REQUIRE(handle->IsArrayBuffer() || handle->IsArrayBufferView(), TypeError,
+        "The body of a multipart put() must be a stream of ArrayBuffers or ArrayBufferViews.");
+    pending = jsg::BufferSource(js, handle);
+  }
+
+  void startUpload(jsg::Lock& js) {
+    JSG_REQUIRE(nextPartNumber <= MAX_MULTIPART_PARTS, RangeError,
+        "The body of a multipart put() needs more than ", MAX_MULTIPART_PARTS,
+        " parts. Use a larger partSize.");
+    int partNumber = nextPartNumber++;
+
+    R2MultipartUpload::UploadPartOptions options;
+    KJ_IF_SOME(key, ssecKey) {
+      options.ssecKey = kj::OneOf<kj::Array<byte>, kj::String>(kj::str(key));
+    }
+    auto value = R2PutValue(part.releaseAsArray());
+    uploads.push_back(
+        upload->uploadPart(js, partNumber, kj::mv(value), kj::mv(options), errorType)
+            .then(js,
+                [self = kj::addRef(*this)](
+                    jsg::Lock&, R2MultipartUpload::UploadedPart uploadedPart) mutable {
+      self->uploaded.add(kj::mv(uploadedPart));
+    }));
+  }
+
+  jsg::Promise<jsg::Ref<R2Bucket::HeadResult>> fail(jsg::Lock& js, jsg::Value exception) {
+    // Uploads still in flight don't matter any more: aborting the upload discards their parts.
+    for (auto& outstanding: uploads) {
+      outstanding.markAsHandled(js);
+    }
+    uploads.clear();
+    reader->cancel(js, exception.getHandle(js)).markAsHandled(js);
+
+    auto rethrow = [exception = exception.addRef(js)](
+                       jsg::Lock& js) mutable -> jsg::Ref<R2Bucket::HeadResult> {
+      js.throwException(kj::mv(exception));
+    };
+    return upload->abort(js, errorType)
+        .then(js, kj::mv(rethrow),
+            [exception = kj::mv(exception)](
+                jsg::Lock& js, jsg::Value) mutable -> jsg::Ref<R2Bucket::HeadResult> {
+      // Report the original error rather than the one from the abort.
+      js.throwException(kj::mv(exception));
+    });
+  }
+};
+
+}  // namespace
+
+jsg::Promise<kj::Maybe<jsg::Ref<R2Bucket::HeadResult>>> R2Bucket::putMultipart(jsg::Lock& js,
+    kj::String name,
+    jsg::Ref<ReadableStream> stream,
+    PutOptions options,
+    MultipartPutOptions multipart,
+    const jsg::TypeHandler<jsg::Ref<R2Error>>& errorType) {
+  JSG_REQUIRE(options.onlyIf == kj::none, TypeError,
+      "The onlyIf option can't be used with a multipart put().");
+  JSG_REQUIRE(options.md5 == kj::none && options.sha1 == kj::none && options.sha256 == kj::none &&
+          options.sha384 == kj::none && options.sha512 == kj::none,
+      TypeError, "Checksums can't be used with a multipart put().");
+
+  double partSize = multipart.partSize.orDefault(DEFAULT_MULTIPART_PART_SIZE);
+  JSG_REQUIRE(isWholeNumber(partSize) && partSize >= MIN_MULTIPART_PART_SIZE &&
+          partSize <= MAX_MULTIPART_PART_SIZE,
+      RangeError, "multipart.partSize must be a whole number of bytes between ",
+      MIN_MULTIPART_PART_SIZE, " and ", MAX_MULTIPART_PART_SIZE, ".");
+  int concurrency = multipart.concurrency.orDefault(DEFAULT_MULTIPART_CONCURRENCY);
+  JSG_REQUIRE(concurrency >= 1 && concurrency <= MAX_MULTIPART_CONCURRENCY, RangeError,
+      "multipart.concurrency must be between 1 and ", MAX_MULTIPART_CONCURRENCY, ".");
+
+  // Every part has to be uploaded with the same SSE-C key as the upload itself.
+  auto ssecKey = buildSsecKey(kj::mv(options.ssecKey));
+
+  MultipartOptions createOptions;
+  createOptions.httpMetadata = kj::mv(options.httpMetadata);
+  createOptions.customMetadata = kj::mv(options.customMetadata);
+  createOptions.storageClass = kj::mv(options.storageClass);
+  KJ_IF_SOME(key, ssecKey) {
+    createOptions.ssecKey = kj::OneOf<kj::Array<byte>, kj::String>(kj::str(key));
+  }
+
+  // Lock the body now, so that it can't be read by anyone else while the upload is created.
+  auto reader = ReadableStreamDefaultReader::constructor(js, kj::mv(stream));
+
+  return createMultipartUpload(js, kj::mv(name), kj::mv(createOptions), errorType)
+      .then(js,
+          [reader = reader.addRef(), partSize = static_cast<size_t>(partSize),
+              concurrency = static_cast<size_t>(concurrency), ssecKey = kj::mv(ssecKey),
+              &errorType](jsg::Lock& js, jsg::Ref<R2MultipartUpload> upload) mutable {
+    auto put = kj::refcounted<MultipartPut>(
+        kj::mv(upload), kj::mv(reader), partSize, concurrency, kj::mv(ssecKey), errorType);
+    return put->run(js).then(
+        js, [](jsg::Lock&, jsg::Ref<HeadResult> result) -> kj::Maybe<jsg::Ref<HeadResult>> {
+      return kj::mv(result);
+    });
+  },
+          [reader = kj::mv(reader)](jsg::Lock& js, jsg::Value exception) mutable
+          -> jsg::Promise<kj::Maybe<jsg::Ref<HeadResult>>> {
+    reader->cancel(js, exception.getHandle(js)).markAsHandled(js);
+    return js.rejectedPromise<kj::Maybe<jsg::Ref<HeadResult>>>(kj::mv(exception));
+  });
+}
+
 jsg::Promise<jsg::Ref<R2MultipartUpload>> R2Bucket::createMultipartUpload(jsg::Lock& js,
     kj::String key,
     jsg::Optional<MultipartOptions> options,
@@ -633,10 +858,8 @@ jsg::Promise<jsg::Ref<R2MultipartUpload>> R2Bucket::createMultipartUpload(jsg::L
     auto client =
         context.getHttpClient(clientIndex, true, kj::none, "r2_createMultipartUpload"_kjc);
 
-    capnp::JsonCodec json;
-    json.handleByAnnotation<R2BindingRequest>();
-    json.setHasMode(capnp::HasMode::NON_DEFAULT);
-    capnp::MallocMessageBuilder requestMessage;
+    auto& json = getR2JsonCodec<R2BindingRequest, capnp::HasMode::NON_DEFAULT>();
+    PooledMessageBuilder requestMessage;
 
     auto requestBuilder = requestMessage.initRoot<R2BindingRequest>();
     requestBuilder.setVersion(VERSION_PUBLIC_BETA);
@@ -705,9 +928,8 @@ jsg::Promise<jsg::Ref<R2MultipartUpload>> R2Bucket::createMultipartUpload(jsg::L
         [&errorType, key = kj::mv(key), this](jsg::Lock& js, R2Result r2Result) mutable {
       r2Result.throwIfError("createMultipartUpload", errorType);
 
-      capnp::MallocMessageBuilder responseMessage;
-      capnp::JsonCodec json;
-      json.handleByAnnotation<R2CreateMultipartUploadResponse>();
+      PooledMessageBuilder responseMessage;
+      auto& json = getR2JsonCodec<R2CreateMultipartUploadResponse>();
       auto responseBuilder = responseMessage.initRoot<R2CreateMultipartUploadResponse>();
 
       json.decode(KJ_ASSERT_NONNULL(r2Result.metadataPayload), responseBuilder);
@@ -731,9 +953,8 @@ jsg::Promise<void> R2Bucket::delete_(jsg::Lock& js,
     auto& context = IoContext::current();
     auto client = context.getHttpClient(clientIndex, true, kj::none, "r2_delete"_kjc);
 
-    capnp::JsonCodec json;
-    json.handleByAnnotation<R2BindingRequest>();
-    capnp::MallocMessageBuilder requestMessage;
+    auto& json = getR2JsonCodec<R2BindingRequest>();
+    PooledMessageBuilder requestMessage;
 
     auto requestBuilder = requestMessage.initRoot<R2BindingRequest>();
     requestBuilder.setVersion(VERSION_PUBLIC_BETA);
@@ -776,10 +997,8 @@ jsg::Promise<R2Bucket::ListResult> R2Bucket::list(jsg::Lock& js,
     auto& context = IoContext::current();
     auto client = context.getHttpClient(clientIndex, true, kj::none, "r2_list"_kjc);
 
-    capnp::JsonCodec json;
-    json.handleByAnnotation<R2BindingRequest>();
-    json.setHasMode(capnp::HasMode::NON_DEFAULT);
-    capnp::MallocMessageBuilder requestMessage;
+    auto& json = getR2JsonCodec<R2BindingRequest, capnp::HasMode::NON_DEFAULT>();
+    PooledMessageBuilder requestMessage;
 
     auto requestBuilder = requestMessage.initRoot<R2BindingRequest>();
     requestBuilder.setVersion(VERSION_PUBLIC_BETA);
@@ -865,9 +1084,8 @@ jsg::Promise<R2Bucket::ListResult> R2Bucket::list(jsg::Lock& js,
       r2Result.throwIfError("list", errorType);
 
       R2Bucket::ListResult result;
-      capnp::MallocMessageBuilder responseMessage;
-      capnp::JsonCodec json;
-      json.handleByAnnotation<R2ListResponse>();
+      PooledMessageBuilder responseMessage;
+      auto& json = getR2JsonCodec<R2ListResponse>();
       auto responseBuilder = responseMessage.initRoot<R2ListResponse>();
 
       json.decode(KJ_ASSERT_NONNULL(r2Result.metadataPayload), responseBuilder);
@@ -889,6 +1107,60 @@ jsg::Promise<R2Bucket::ListResult> R2Bucket::list(jsg::Lock& js,
   });
 }
 
+jsg::Ref<R2Bucket::ListStream> R2Bucket::listStream(jsg::Lock& js,
+    jsg::Optional<ListOptions> options,
+    const jsg::TypeHandler<jsg::Ref<R2Error>>& errorType,
+    CompatibilityFlags::Reader flags) {
+  auto o = kj::mv(options).orDefault({});
+  JSG_REQUIRE(o.delimiter == kj::none, TypeError,
+      "listStream() doesn't support the delimiter option. Use list() instead.");
+  return jsg::alloc<ListStream>(ListStreamState{
+    .bucket = JSG_THIS,
+    .options = kj::mv(o),
+    .errorType = errorType,
+    .flags = flags,
+  });
+}
+
+jsg::Promise<kj::Maybe<jsg::Ref<R2Bucket::HeadResult>>> R2Bucket::listStreamNext(
+    jsg::Lock& js, ListStreamState& state) {
+  if (state.nextIndex < state.objects.size()) {
+    auto object = kj::mv(state.objects[state.nextIndex++]);
+    if (state.nextIndex == state.objects.size()) {
+      state.objects = nullptr;
+      state.nextIndex = 0;
+    }
+    return js.resolvedPromise(kj::Maybe<jsg::Ref<HeadResult>>(kj::mv(object)));
+  }
+  if (state.lastPage) {
+    return js.resolvedPromise(kj::Maybe<jsg::Ref<HeadResult>>(kj::none));
+  }
+
+  // The iterator serializes calls to next(), so `state` stays valid until this promise settles.
+  return state.bucket->list(js, state.options.clone(), state.errorType, state.flags)
+      .then(js, [&state](jsg::Lock& js, ListResult page) {
+    state.lastPage = true;
+    if (page.truncated) {
+      KJ_IF_SOME(cursor, page.cursor) {
+        state.options.cursor = jsg::NonCoercible<kj::String>{kj::mv(cursor)};
+        // The cursor already encodes where the listing started.
+        state.options.startAfter = kj::none;
+        state.lastPage = false;
+      }
+    }
+    state.objects = kj::mv(page.objects);
+    state.nextIndex = 0;
+    return listStreamNext(js, state);
+  });
+}
+
+jsg::Promise<void> R2Bucket::listStreamReturn(
+    jsg::Lock& js, ListStreamState& state, jsg::Optional<jsg::Value> value) {
+  state.objects = nullptr;
+  state.lastPage = true;
+  return js.resolvedPromise();
+}
+
 namespace {
 
 kj::Array<R2Bucket::Etag> parseConditionalEtagHeader(kj::StringPtr condHeader,
@@ -1071,6 +1343,22 @@ R2Bucket::HttpMetadata R2Bucket::HttpMetadata::clone() const {
   };
 }
 
+R2Bucket::ListOptions R2Bucket::ListOptions::clone() const {
+  auto cloneStr = [](const jsg::NonCoercible<kj::String>& str) {
+    return jsg::NonCoercible<kj::String>{kj::str(str.value)};
+  };
+  return {
+    .limit = limit,
+    .prefix = prefix.map(cloneStr),
+    .cursor = cursor.map(cloneStr),
+    .delimiter = delimiter.map(cloneStr),
+    .startAfter = startAfter.map(cloneStr),
+    .include = include.map([&](const kj::Array<jsg::NonCoercible<kj::String>>& fields) {
+      return KJ_MAP(f, fields) { return cloneStr(f); };
+    }),
+  };
+}
+
 void R2Bucket::HeadResult::writeHttpMetadata(jsg::Lock& js, Headers& headers) {
   JSG_REQUIRE(httpMetadata != kj::none, TypeError, "HTTP metadata unknown for key `", name,
       "`. Did you forget to add 'httpMetadata' to `include` when listing?");
@@ -1092,7 +1380,7 @@ void R2Bucket::HeadResult::writeHttpMetadata(jsg::Lock& js, Headers& headers) {
     headers.set(jsg::ByteString(kj::str("cache-control")), jsg::ByteString(kj::str(cc)));
   }
   KJ_IF_SOME(ce, m.cacheExpiry) {
-    headers.set(jsg::ByteString(kj::str("expires")), toUTCString(js, ce));
+    headers.set(jsg::ByteString(kj::str("expires")), jsg::ByteString(formatHttpDate(ce)));
   }
 }
 
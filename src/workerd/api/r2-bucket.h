@@ -180,6 +180,18 @@ class R2Bucket: public jsg::Object {
     }
   };
 
+  // Uploads a ReadableStream body as a multipart upload, reading the stream in parts of
+  // `partSize` bytes and uploading up to `concurrency` parts at a time. At most
+  // `concurrency * partSize` bytes of the body are buffered at once. If anything fails, the upload
+  // is aborted, so the object is either written whole or not at all.
+  struct MultipartPutOptions {
+    jsg::Optional<double> partSize;
+    jsg::Optional<int> concurrency;
+
+    JSG_STRUCT(partSize, concurrency);
+    JSG_STRUCT_TS_OVERRIDE(R2MultipartPutOptions);
+  };
+
   struct PutOptions {
     jsg::Optional<kj::OneOf<Conditional, jsg::Ref<Headers>>> onlyIf;
     jsg::Optional<kj::OneOf<HttpMetadata, jsg::Ref<Headers>>> httpMetadata;
@@ -191,6 +203,7 @@ class R2Bucket: public jsg::Object {
     jsg::Optional<kj::OneOf<kj::Array<kj::byte>, jsg::NonCoercible<kj::String>>> sha512;
     jsg::Optional<kj::String> storageClass;
     jsg::Optional<kj::OneOf<kj::Array<byte>, kj::String>> ssecKey;
+    jsg::Optional<MultipartPutOptions> multipart;
 
     JSG_STRUCT(onlyIf,
         httpMetadata,
@@ -201,7 +214,8 @@ class R2Bucket: public jsg::Object {
         sha384,
         sha512,
         storageClass,
-        ssecKey);
+        ssecKey,
+        multipart);
     JSG_STRUCT_TS_OVERRIDE(R2PutOptions);
   };
 
@@ -424,6 +438,8 @@ class R2Bucket: public jsg::Object {
     // with R2Bucket so we can access compatibility flags. Note, even though
     // we're deleting the definition, all definitions will still be renamed
     // from `R2BucketListOptions` to `R2ListOptions`.
+
+    ListOptions clone() const;
   };
 
   jsg::Promise<kj::Maybe<jsg::Ref<HeadResult>>> head(jsg::Lock& js,
@@ -456,6 +472,42 @@ class R2Bucket: public jsg::Object {
       const jsg::TypeHandler<jsg::Ref<R2Error>>& errorType,
       CompatibilityFlags::Reader flags);
 
+  struct ListStreamState {
+    jsg::Ref<R2Bucket> bucket;
+    ListOptions options;
+    const jsg::TypeHandler<jsg::Ref<R2Error>>& errorType;
+    CompatibilityFlags::Reader flags;
+
+    // The rest of the current page. Objects are handed out one at a time, so JS only ever sees the
+    // ones that have been yielded.
+    kj::Array<jsg::Ref<HeadResult>> objects;
+    size_t nextIndex = 0;
+    bool lastPage = false;
+
+    void visitForGc(jsg::GcVisitor& visitor) {
+      visitor.visit(bucket);
+      for (auto& object: objects) {
+        visitor.visit(object);
+      }
+    }
+  };
+
+  static jsg::Promise<kj::Maybe<jsg::Ref<HeadResult>>> listStreamNext(
+      jsg::Lock& js, ListStreamState& state);
+  static jsg::Promise<void> listStreamReturn(
+      jsg::Lock& js, ListStreamState& state, jsg::Optional<jsg::Value> value);
+
+  JSG_ASYNC_ITERATOR_TYPE(
+      ListStream, jsg::Ref<HeadResult>, ListStreamState, listStreamNext, listStreamReturn);
+
+  // Lists every object that matches `options`, fetching the next page whenever the iterator has
+  // yielded all objects of the current one. Only one page is held at a time, however large the
+  // listing. `limit` sets the page size. A delimited listing can only be done with list().
+  jsg::Ref<ListStream> listStream(jsg::Lock& js,
+      jsg::Optional<ListOptions> options,
+      const jsg::TypeHandler<jsg::Ref<R2Error>>& errorType,
+      CompatibilityFlags::Reader flags);
+
   JSG_RESOURCE_TYPE(R2Bucket, CompatibilityFlags::Reader flags) {
     JSG_METHOD(head);
     JSG_METHOD(get);
@@ -464,6 +516,7 @@ class R2Bucket: public jsg::Object {
     JSG_METHOD(resumeMultipartUpload);
     JSG_METHOD_NAMED(delete, delete_);
     JSG_METHOD(list);
+    JSG_METHOD(listStream);
 
     JSG_TS_ROOT();
     JSG_TS_OVERRIDE({
@@ -476,6 +529,8 @@ class R2Bucket: public jsg::Object {
         options?: R2PutOptions & { onlyIf: R2BucketConditional | Headers }
       ): Promise<R2Object | null>;
       put(key: string, value: ReadableStream | ArrayBuffer | ArrayBufferView | string | null | Blob, options?: R2PutOptions): Promise<R2Object>;
+
+      listStream(options?: R2ListOptions): AsyncIterableIterator<R2Object>;
     });
     // Exclude `R2Object` from `get` return type if `onlyIf` not specified, and exclude `null` from `put` return type
 
@@ -533,6 +588,14 @@ class R2Bucket: public jsg::Object {
   }
 
  private:
+  // Implements put() for a ReadableStream body with the `multipart` option.
+  jsg::Promise<kj::Maybe<jsg::Ref<HeadResult>>> putMultipart(jsg::Lock& js,
+      kj::String name,
+      jsg::Ref<ReadableStream> stream,
+      PutOptions options,
+      MultipartPutOptions multipart,
+      const jsg::TypeHandler<jsg::Ref<R2Error>>& errorType);
+
   FeatureFlags featureFlags;
   uint clientIndex;
   kj::Maybe<kj::String> adminBucket;
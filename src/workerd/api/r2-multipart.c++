@@ -10,6 +10,7 @@
 
 #include <workerd/api/r2-api.capnp.h>
 #include <workerd/util/http-util.h>
+#include <workerd/util/message-arena.h>
 
 #include <capnp/compat/json.h>
 #include <capnp/message.h>
@@ -33,10 +34,8 @@ jsg::Promise<R2MultipartUpload::UploadedPart> R2MultipartUpload::uploadPart(jsg:
     auto client =
         context.getHttpClient(this->bucket->clientIndex, true, kj::none, "r2_uploadPart"_kjc);
 
-    capnp::JsonCodec json;
-    json.handleByAnnotation<R2BindingRequest>();
-    json.setHasMode(capnp::HasMode::NON_DEFAULT);
-    capnp::MallocMessageBuilder requestMessage;
+    auto& json = getR2JsonCodec<R2BindingRequest, capnp::HasMode::NON_DEFAULT>();
+    PooledMessageBuilder requestMessage;
 
     auto requestBuilder = requestMessage.initRoot<R2BindingRequest>();
     requestBuilder.setVersion(VERSION_PUBLIC_BETA);
@@ -77,9 +76,8 @@ jsg::Promise<R2MultipartUpload::UploadedPart> R2MultipartUpload::uploadPart(jsg:
         js, kj::mv(promise), [&errorType, partNumber](jsg::Lock& js, R2Result r2Result) mutable {
       r2Result.throwIfError("uploadPart", errorType);
 
-      capnp::MallocMessageBuilder responseMessage;
-      capnp::JsonCodec json;
-      json.handleByAnnotation<R2UploadPartResponse>();
+      PooledMessageBuilder responseMessage;
+      auto& json = getR2JsonCodec<R2UploadPartResponse>();
       auto responseBuilder = responseMessage.initRoot<R2UploadPartResponse>();
 
       json.decode(KJ_ASSERT_NONNULL(r2Result.metadataPayload), responseBuilder);
@@ -98,9 +96,8 @@ jsg::Promise<jsg::Ref<R2Bucket::HeadResult>> R2MultipartUpload::complete(jsg::Lo
     auto client = context.getHttpClient(
         this->bucket->clientIndex, true, kj::none, "r2_completeMultipartUpload"_kjc);
 
-    capnp::JsonCodec json;
-    json.handleByAnnotation<R2BindingRequest>();
-    capnp::MallocMessageBuilder requestMessage;
+    auto& json = getR2JsonCodec<R2BindingRequest>();
+    PooledMessageBuilder requestMessage;
 
     auto requestBuilder = requestMessage.initRoot<R2BindingRequest>();
     requestBuilder.setVersion(VERSION_PUBLIC_BETA);
@@ -148,9 +145,8 @@ jsg::Promise<void> R2MultipartUpload::abort(
     auto client = context.getHttpClient(
         this->bucket->clientIndex, true, kj::none, "r2_abortMultipartUpload"_kjc);
 
-    capnp::JsonCodec json;
-    json.handleByAnnotation<R2BindingRequest>();
-    capnp::MallocMessageBuilder requestMessage;
+    auto& json = getR2JsonCodec<R2BindingRequest>();
+    PooledMessageBuilder requestMessage;
 
     auto requestBuilder = requestMessage.initRoot<R2BindingRequest>();
     requestBuilder.setVersion(VERSION_PUBLIC_BETA);
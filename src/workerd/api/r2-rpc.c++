@@ -8,6 +8,7 @@
 #include <workerd/api/system-streams.h>
 #include <workerd/api/util.h>
 #include <workerd/util/http-util.h>
+#include <workerd/util/message-arena.h>
 // This is imported for the error type and that's shared between internal and public beta.
 
 #include <capnp/compat/json.h>
@@ -16,9 +17,8 @@
 
 namespace workerd::api {
 static kj::Own<R2Error> toError(uint statusCode, kj::StringPtr responseBody) {
-  capnp::JsonCodec json;
-  json.handleByAnnotation<public_beta::R2ErrorResponse>();
-  capnp::MallocMessageBuilder errorMessageArena;
+  auto& json = getR2JsonCodec<public_beta::R2ErrorResponse>();
+  PooledMessageBuilder errorMessageArena;
   auto errorMessage = errorMessageArena.initRoot<public_beta::R2ErrorResponse>();
   json.decode(responseBody, errorMessage);
 
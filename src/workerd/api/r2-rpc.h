@@ -7,6 +7,8 @@
 #include <workerd/api/blob.h>
 #include <workerd/jsg/jsg.h>
 
+#include <capnp/compat/json.h>
+
 namespace kj {
 class HttpClient;
 }
@@ -105,4 +107,22 @@ kj::Promise<R2Result> doR2HTTPPutRequest(kj::Own<kj::HttpClient> client,
     kj::ArrayPtr<kj::StringPtr> path,
     kj::Maybe<kj::StringPtr> jwt);
 
+// A JsonCodec that handles the JSON annotations of `T`.
+template <typename T, capnp::HasMode hasMode>
+class R2JsonCodec final: public capnp::JsonCodec {
+ public:
+  R2JsonCodec() {
+    handleByAnnotation<T>();
+    setHasMode(hasMode);
+  }
+};
+
+// Returns a JsonCodec for the R2 protocol message `T`, set up once per thread. Setting a codec up
+// walks the whole schema of `T`, which costs more than encoding or decoding a typical message.
+template <typename T, capnp::HasMode hasMode = capnp::HasMode::NON_NULL>
+const capnp::JsonCodec& getR2JsonCodec() {
+  static thread_local const R2JsonCodec<T, hasMode> codec;
+  return codec;
+}
+
 }  // namespace workerd::api
@@ -21,6 +21,14 @@ const objResponse = {
   storageClass: 'Standard',
 };
 
+// Sizes of the parts uploaded for the 'multipart-put' object, by part number.
+const multipartPutParts = new Map();
+let multipartPutAborted = false;
+
+// Objects listed under the 'stream/' prefix, and the list requests for them.
+const streamObjects = ['a', 'b', 'c', 'd', 'e'].map((name) => `stream/${name}`);
+const listRequests = [];
+
 export default {
   // Handler for HTTP request binding makes to R2
   async fetch(request, env, ctx) {
@@ -44,8 +52,10 @@ export default {
 
         const jsonRequest = JSON.parse(new TextDecoder().decode(value));
 
-        // Currently not using the body in these test so I'm going to just discard
-        for await (const _ of request.body) {
+        // Only the size of the body matters to these tests
+        let bodySize = 0;
+        for await (const chunk of request.body) {
+          bodySize += chunk.byteLength;
         }
 
         // Assert it's the correct version
@@ -56,6 +66,7 @@ export default {
             'createMultipartUpload',
             'uploadPart',
             'completeMultipartUpload',
+            'abortMultipartUpload',
           ].includes(jsonRequest.method)
         );
 
@@ -135,6 +146,45 @@ export default {
               });
             }
           }
+          case 'multipart-put':
+          case 'multipart-put-fail': {
+            if (jsonRequest.method === 'createMultipartUpload') {
+              return Response.json({ uploadId: 'multipartPutId' });
+            }
+            if (jsonRequest.method === 'uploadPart') {
+              assert.strictEqual(jsonRequest.uploadId, 'multipartPutId');
+              multipartPutParts.set(jsonRequest.partNumber, bodySize);
+              if (
+                jsonRequest.object === 'multipart-put-fail' &&
+                jsonRequest.partNumber === 2
+              ) {
+                return new Response(null, {
+                  status: 400,
+                  headers: {
+                    'cf-r2-error': JSON.stringify({
+                      version: 0,
+                      v4code: 10001,
+                      message: 'part rejected',
+                    }),
+                  },
+                });
+              }
+              return Response.json({ etag: `etag${jsonRequest.partNumber}` });
+            }
+            if (jsonRequest.method === 'abortMultipartUpload') {
+              multipartPutAborted = true;
+              return Response.json({});
+            }
+            if (jsonRequest.method === 'completeMultipartUpload') {
+              assert.deepStrictEqual(
+                jsonRequest.parts,
+                [...multipartPutParts.keys()]
+                  .sort((a, b) => a - b)
+                  .map((part) => ({ etag: `etag${part}`, part }))
+              );
+              return Response.json(objResponse);
+            }
+          }
         }
         return Response.json(objResponse);
       }
@@ -142,7 +192,29 @@ export default {
         const rawHeader = request.headers.get('cf-r2-request');
         const jsonRequest = JSON.parse(rawHeader);
         assert((jsonRequest.version = 1));
-        assert(['get', 'head'].includes(jsonRequest.method));
+        assert(['get', 'head', 'list'].includes(jsonRequest.method));
+        if (jsonRequest.method === 'list') {
+          assert.strictEqual(jsonRequest.prefix, 'stream/');
+          listRequests.push(jsonRequest);
+          const start = jsonRequest.cursor ? parseInt(jsonRequest.cursor) : 0;
+          const end = Math.min(start + jsonRequest.limit, streamObjects.length);
+          const truncated = end < streamObjects.length;
+          const metadata = new TextEncoder().encode(
+            JSON.stringify({
+              objects: streamObjects
+                .slice(start, end)
+                .map((name) => ({ ...objResponse, name })),
+              truncated,
+              ...(truncated ? { cursor: `${end}` } : {}),
+            })
+          );
+          return new Response(metadata, {
+            headers: {
+              'cf-r2-metadata-size': metadata.length.toString(),
+              'content-length': metadata.length.toString(),
+            },
+          });
+        }
         if (jsonRequest.object === 'ssec') {
           const encoder = new TextEncoder();
           const metadata = encoder.encode(
@@ -244,5 +316,94 @@ export default {
         }
       }
     }
+
+    {
+      // Multipart put
+      const MiB = 1024 * 1024;
+      const body = (size) =>
+        new ReadableStream({
+          pull(controller) {
+            const chunk = Math.min(size, MiB);
+            size -= chunk;
+            controller.enqueue(new Uint8Array(chunk));
+            if (size === 0) controller.close();
+          },
+        });
+
+      multipartPutParts.clear();
+      const object = await env.BUCKET.put('multipart-put', body(12 * MiB), {
+        multipart: { partSize: 5 * MiB, concurrency: 2 },
+      });
+      assert.strictEqual(object.etag, 'objectEtag');
+      assert.deepStrictEqual(
+        [...multipartPutParts.entries()].sort(([a], [b]) => a - b),
+        [
+          [1, 5 * MiB],
+          [2, 5 * MiB],
+          [3, 2 * MiB],
+        ]
+      );
+
+      multipartPutParts.clear();
+      await assert.rejects(
+        env.BUCKET.put('multipart-put-fail', body(12 * MiB), {
+          multipart: { partSize: 5 * MiB },
+        }),
+        { message: /part rejected/ }
+      );
+      assert(multipartPutAborted);
+
+      await assert.rejects(
+        env.BUCKET.put('multipart-put', body(MiB), {
+          multipart: { partSize: MiB },
+        }),
+        RangeError
+      );
+      await assert.rejects(
+        env.BUCKET.put('multipart-put', body(MiB), {
+          multipart: { concurrency: 0 },
+        }),
+        RangeError
+      );
+      await assert.rejects(
+        env.BUCKET.put('multipart-put', body(MiB), {
+          multipart: {},
+          onlyIf: { etagMatches: 'strongEtag' },
+        }),
+        TypeError
+      );
+    }
+
+    {
+      // listStream
+      const keys = [];
+      for await (const object of env.BUCKET.listStream({
+        prefix: 'stream/',
+        limit: 2,
+      })) {
+        keys.push(object.key);
+      }
+      assert.deepStrictEqual(keys, streamObjects);
+      assert.deepStrictEqual(
+        listRequests.map(({ cursor }) => cursor),
+        [undefined, '2', '4']
+      );
+
+      // Breaking out of the loop stops fetching pages.
+      listRequests.length = 0;
+      for await (const object of env.BUCKET.listStream({
+        prefix: 'stream/',
+        limit: 2,
+      })) {
+        assert.strictEqual(object.key, 'stream/a');
+        break;
+      }
+      assert.strictEqual(listRequests.length, 1);
+
+      assert.throws(
+        () => env.BUCKET.listStream({ prefix: 'stream/', delimiter: '/' }),
+        TypeError
+      );
+    }
   },
 };
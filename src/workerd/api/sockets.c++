@@ -6,7 +6,9 @@
 
 #include "system-streams.h"
 
+#include <workerd/io/features.h>
 #include <workerd/io/worker-interface.h>
+#include <workerd/io/worker.h>
 #include <workerd/jsg/url.h>
 
 namespace workerd::api {
@@ -76,6 +78,79 @@ kj::Maybe<uint64_t> getWritableHighWaterMark(jsg::Optional<SocketOptions>& opts)
 
 }  // namespace
 
+kj::Maybe<kj::Own<kj::AsyncIoStream>> SocketPool::take(IoContext& context, kj::StringPtr key) {
+  auto& entries = KJ_UNWRAP_OR_RETURN(idle.find(key), kj::none);
+  prune(context, entries);
+
+  kj::Maybe<kj::Own<kj::AsyncIoStream>> result;
+  // Newest first: it is the least likely to have been timed out by the peer.
+  for (auto i = entries.size(); i-- > 0;) {
+    KJ_IF_SOME(owner, entries[i].context->tryGet()) {
+      if (&owner == &context) {
+        auto& entry = *entries[i].idle;
+        entry.watch = nullptr;
+        result = kj::mv(entry.connection);
+        if (i != entries.size() - 1) {
+          entries[i] = kj::mv(entries.back());
+        }
+        entries.removeLast();
+        break;
+      }
+    }
+  }
+
+  if (entries.empty()) {
+    idle.erase(key);
+  }
+  return result;
+}
+
+void SocketPool::put(IoContext& context, kj::String key, kj::Own<kj::AsyncIoStream> connection) {
+  auto& entries = idle.findOrCreate(key, [&]() {
+    return decltype(idle)::Entry{kj::mv(key), {}};
+  });
+  prune(context, entries);
+
+  size_t count = 0;
+  for (auto& entry: entries) {
+    KJ_IF_SOME(owner, entry.context->tryGet()) {
+      if (&owner == &context) {
+        ++count;
+      }
+    }
+  }
+  if (count >= MAX_IDLE_PER_KEY) {
+    return;
+  }
+
+  auto entry = kj::heap<Idle>();
+  entry->connection = kj::mv(connection);
+  entry->since = context.now();
+  entry->watch = entry->connection->whenWriteDisconnected()
+                     .then([&state = *entry]() { state.disconnected = true; },
+                         [&state = *entry](kj::Exception&&) { state.disconnected = true; })
+                     .eagerlyEvaluate(nullptr);
+  entries.add(Entry{
+    .context = context.getWeakRef(),
+    .idle = context.addObject(kj::mv(entry)),
+  });
+}
+
+void SocketPool::prune(IoContext& context, kj::Vector<Entry>& entries) {
+  auto now = context.now();
+  kj::Vector<Entry> kept(entries.size());
+  for (auto& entry: entries) {
+    KJ_IF_SOME(owner, entry.context->tryGet()) {
+      if (&owner != &context ||
+          (!entry.idle->disconnected && now - entry.idle->since < IDLE_TIMEOUT)) {
+        kept.add(kj::mv(entry));
+      }
+    }
+    // Otherwise the IoContext that opened the connection is gone, and the connection with it.
+  }
+  entries = kj::mv(kept);
+}
+
 jsg::Ref<Socket> setupSocket(jsg::Lock& js,
     kj::Own<kj::AsyncIoStream> connection,
     kj::String remoteAddress,
@@ -221,6 +296,21 @@ jsg::Ref<Socket> connectImplNoOutputLock(jsg::Lock& js,
   JSG_REQUIRE(isValidHost(addressStr), TypeError,
       "Specified address is empty string, contains unsupported characters or is too long.");
 
+  auto secureTransport = SecureTransportKind::OFF;
+  kj::Maybe<kj::String> poolKey;
+  KJ_IF_SOME(opts, options) {
+    secureTransport = parseSecureTransport(opts);
+    if (opts.pool.orDefault(false)) {
+      JSG_REQUIRE(FeatureFlags::get(js).getWorkerdExperimental(), TypeError,
+          "The `pool` socket option is experimental.");
+      JSG_REQUIRE(fetcher == kj::none, TypeError,
+          "The `pool` socket option is only supported by the global connect().");
+      JSG_REQUIRE(secureTransport != SecureTransportKind::STARTTLS, TypeError,
+          "The `pool` socket option cannot be combined with `secureTransport: 'starttls'`.");
+      poolKey = kj::str(secureTransport == SecureTransportKind::ON ? "tls:" : "tcp:", addressStr);
+    }
+  }
+
   jsg::Ref<Fetcher> actualFetcher = nullptr;
   KJ_IF_SOME(f, fetcher) {
     actualFetcher = kj::mv(f);
@@ -231,6 +321,19 @@ jsg::Ref<Socket> connectImplNoOutputLock(jsg::Lock& js,
     KJ_IF_SOME(fn, ioContext.getCurrentLock().getWorker().getConnectOverride(addressStr)) {
       return fn(js);
     }
+
+    KJ_IF_SOME(key, poolKey) {
+      KJ_IF_SOME(connection, Worker::Isolate::from(js).getSocketPool().take(ioContext, key)) {
+        auto useTls = secureTransport == SecureTransportKind::ON;
+        auto result = setupSocket(js, kj::mv(connection), kj::mv(addressStr), kj::mv(options),
+            kj::heap<kj::TlsStarterCallback>(), useTls, kj::mv(domain), isDefaultFetchPort);
+        result->setPoolKey(kj::mv(key));
+        // The connection is already established, so the socket opens right away.
+        result->handleProxyStatus(
+            js, kj::Promise<kj::Maybe<kj::Exception>>(kj::Maybe<kj::Exception>(kj::none)));
+        return result;
+      }
+    }
     actualFetcher =
         jsg::alloc<Fetcher>(IoContext::NULL_CLIENT_CHANNEL, Fetcher::RequiresHostAndProtocol::YES);
   }
@@ -242,10 +345,9 @@ jsg::Ref<Socket> connectImplNoOutputLock(jsg::Lock& js,
   // Set up the connection.
   auto headers = kj::heap<kj::HttpHeaders>(ioContext.getHeaderTable());
   auto httpClient = asHttpClient(kj::mv(client));
-  kj::HttpConnectSettings httpConnectSettings = {.useTls = false};
-  KJ_IF_SOME(opts, options) {
-    httpConnectSettings.useTls = parseSecureTransport(opts) == SecureTransportKind::ON;
-  }
+  kj::HttpConnectSettings httpConnectSettings = {
+    .useTls = secureTransport == SecureTransportKind::ON,
+  };
   kj::Own<kj::TlsStarterCallback> tlsStarter = kj::heap<kj::TlsStarterCallback>();
   httpConnectSettings.tlsStarter = tlsStarter;
   auto request = httpClient->connect(addressStr, *headers, httpConnectSettings);
@@ -253,6 +355,9 @@ jsg::Ref<Socket> connectImplNoOutputLock(jsg::Lock& js,
 
   auto result = setupSocket(js, kj::mv(request.connection), kj::mv(addressStr), kj::mv(options),
       kj::mv(tlsStarter), httpConnectSettings.useTls, kj::mv(domain), isDefaultFetchPort);
+  KJ_IF_SOME(key, poolKey) {
+    result->setPoolKey(kj::mv(key));
+  }
   // `handleProxyStatus` needs an initialised refcount to use `JSG_THIS`, hence it cannot be
   // called in Socket's constructor. Also it's only necessary when creating a Socket as a result of
   // a `connect`.
@@ -358,6 +463,36 @@ jsg::Ref<Socket> Socket::startTls(jsg::Lock& js, jsg::Optional<TlsOptions> tlsOp
       kj::mv(options), kj::mv(newTlsStarter), true, kj::mv(domain), isDefaultFetchPort);
 }
 
+jsg::Promise<void> Socket::release(jsg::Lock& js) {
+  auto& key = JSG_REQUIRE_NONNULL(poolKey, TypeError,
+      "release() can only be called on a socket opened with the `pool` option.");
+  JSG_REQUIRE(!isClosing, TypeError, "Cannot release a socket that is closed or closing.");
+  JSG_REQUIRE(!readable->isLocked() && !writable->isLocked(), TypeError,
+      "Cannot release a socket while its readable or writable stream is locked.");
+
+  isClosing = true;
+  writable->getController().setPendingClosure();
+  readable->getController().setPendingClosure();
+
+  // Like startTls(), wait for the writable's queue to drain, then detach the connection from the
+  // streams rather than closing or aborting them, either of which would shut the connection down.
+  return openedPromiseCopy.whenResolved(js)
+      .then(js, [this](jsg::Lock& js) { return writable->flush(js); })
+      .then(js, [this, key = kj::str(key)](jsg::Lock& js) mutable {
+    writable->detach(js);
+    readable = readable->detach(js, true);
+    // The detached stream still reads from the connection, so shut it too.
+    readable->getController().cancel(js, kj::none).markAsHandled(js);
+
+    // The pool watches for disconnects from here on. Canceling our own watch leaves `closed`
+    // unresolved, so resolve it below.
+    *watchForDisconnectTask = kj::Promise<void>(kj::READY_NOW);
+    Worker::Isolate::from(js).getSocketPool().put(
+        IoContext::current(), kj::mv(key), connectionStream->addWrappedRef());
+    resolveFulfiller(js, kj::none);
+  }).catch_(js, [this](jsg::Lock& js, jsg::Value err) { errorHandler(js, kj::mv(err)); });
+}
+
 void Socket::handleProxyStatus(
     jsg::Lock& js, kj::Promise<kj::HttpClient::ConnectRequest::Status> status) {
   auto& context = IoContext::current();
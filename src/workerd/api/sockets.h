@@ -6,10 +6,13 @@
 
 #include <workerd/api/streams/readable.h>
 #include <workerd/api/streams/writable.h>
+#include <workerd/io/compatibility-date.capnp.h>
 #include <workerd/jsg/jsg.h>
 #include <workerd/jsg/modules-new.h>
 #include <workerd/jsg/url.h>
 
+#include <kj/map.h>
+
 namespace workerd::api {
 
 class Fetcher;
@@ -44,7 +47,10 @@ struct SocketOptions {
   jsg::Optional<kj::String> secureTransport;
   bool allowHalfOpen = false;
   jsg::Optional<uint64_t> highWaterMark;
-  JSG_STRUCT(secureTransport, allowHalfOpen, highWaterMark);
+  // Experimental: reuse an idle connection to the same address released with `Socket::release()`,
+  // if there is one. Only supported by the global connect() and not with `starttls`.
+  jsg::Optional<bool> pool;
+  JSG_STRUCT(secureTransport, allowHalfOpen, highWaterMark, pool);
   JSG_MEMORY_INFO(SocketOptions) {
     tracker.trackField("secureTransport", secureTransport);
   }
@@ -114,6 +120,18 @@ class Socket: public jsg::Object {
   // All new operations should be performed on the new `Socket` instance.
   jsg::Ref<Socket> startTls(jsg::Lock& js, jsg::Optional<TlsOptions> options);
 
+  // Flushes write buffers then hands the connection to the isolate's SocketPool instead of
+  // closing it, so that a later `connect()` to the same address with the `pool` option can reuse
+  // it without a new handshake. The socket, and its readable/writable, are closed. Only valid on a
+  // socket opened with the `pool` option, and only safe once the application protocol is idle,
+  // i.e. no response is still in flight.
+  jsg::Promise<void> release(jsg::Lock& js);
+
+  // Records the key under which `release()` will pool this socket's connection.
+  void setPoolKey(kj::String key) {
+    poolKey = kj::mv(key);
+  }
+
   // Sets up relevant callbacks to handle the case when the proxy rejects our connection.
   // The first variant is useful for connections established using HTTP connect. The latter is for
   // connections established any other way, where the lack of an exception indicates we connected
@@ -129,13 +147,17 @@ class Socket: public jsg::Object {
   void handleReadableEof(jsg::Lock& js, jsg::Promise<void> onEof);
   // Sets up relevant callbacks to handle the case when the readable stream reaches EOF.
 
-  JSG_RESOURCE_TYPE(Socket) {
+  JSG_RESOURCE_TYPE(Socket, CompatibilityFlags::Reader flags) {
     JSG_READONLY_PROTOTYPE_PROPERTY(readable, getReadable);
     JSG_READONLY_PROTOTYPE_PROPERTY(writable, getWritable);
     JSG_READONLY_PROTOTYPE_PROPERTY(closed, getClosed);
     JSG_READONLY_PROTOTYPE_PROPERTY(opened, getOpened);
     JSG_METHOD(close);
     JSG_METHOD(startTls);
+
+    if (flags.getWorkerdExperimental()) {
+      JSG_METHOD(release);
+    }
   }
 
   void visitForMemoryInfo(jsg::MemoryTracker& tracker) const {
@@ -153,6 +175,7 @@ class Socket: public jsg::Object {
     tracker.trackField("openedResolver", openedResolver);
     tracker.trackField("openedPromiseCopy", openedPromiseCopy);
     tracker.trackField("openedPromise", openedPromise);
+    tracker.trackField("poolKey", poolKey);
   }
 
  private:
@@ -187,6 +210,8 @@ class Socket: public jsg::Object {
   jsg::MemoizedIdentity<jsg::Promise<SocketInfo>> openedPromise;
   // Used to keep track of a pending `close` operation on the socket.
   bool isClosing;
+  // Set on sockets opened with the `pool` option: the SocketPool key `release()` uses.
+  kj::Maybe<kj::String> poolKey;
 
   kj::Promise<kj::Own<kj::AsyncIoStream>> processConnection();
   jsg::Promise<void> maybeCloseWriteSide(jsg::Lock& js);
@@ -215,6 +240,47 @@ class Socket: public jsg::Object {
   }
 };
 
+// A per-isolate pool of idle connections opened by `connect()` with the `pool` option and handed
+// back by `Socket::release()`, keyed by address and by whether TLS is on.
+//
+// A connection is bound to the IoContext that opened it -- it goes through that context's
+// subrequest channel and counts against its limits -- so it is only ever reused by that same
+// IoContext. In practice that means by later requests to the same Durable Object, whose
+// IoContext spans requests. Idle connections are dropped after IDLE_TIMEOUT, when the peer
+// disconnects, or when their IoContext goes away. Requires the isolate lock.
+class SocketPool {
+ public:
+  static constexpr size_t MAX_IDLE_PER_KEY = 8;
+  static constexpr kj::Duration IDLE_TIMEOUT = 60 * kj::SECONDS;
+
+  // Returns the most recently pooled healthy connection `context` opened for `key`, if any.
+  kj::Maybe<kj::Own<kj::AsyncIoStream>> take(IoContext& context, kj::StringPtr key);
+
+  // Pools `connection`, or drops (closes) it if `context` already has MAX_IDLE_PER_KEY idle
+  // connections for `key`.
+  void put(IoContext& context, kj::String key, kj::Own<kj::AsyncIoStream> connection);
+
+ private:
+  struct Idle {
+    kj::Own<kj::AsyncIoStream> connection;
+    kj::Date since = kj::UNIX_EPOCH;
+    bool disconnected = false;
+    // Watches for the peer closing the connection while it is idle.
+    kj::Promise<void> watch = nullptr;
+  };
+
+  struct Entry {
+    kj::Own<IoContext::WeakRef> context;
+    IoOwn<Idle> idle;
+  };
+
+  // Drops the entries whose IoContext is gone, and the expired or disconnected entries of
+  // `context`. Entries of other IoContexts can't be inspected from here, so they are kept.
+  void prune(IoContext& context, kj::Vector<Entry>& entries);
+
+  kj::HashMap<kj::String, kj::Vector<Entry>> idle;
+};
+
 jsg::Ref<Socket> setupSocket(jsg::Lock& js,
     kj::Own<kj::AsyncIoStream> connection,
     kj::String remoteAddress,
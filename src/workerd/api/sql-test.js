@@ -97,6 +97,28 @@ async function test(state) {
     ]);
   }
 
+  {
+    // Test multiple rows by column using .toColumns()
+    const cursor = sql.exec(
+      'SELECT 1 AS num, 1 AS mixed, NULL AS nullable\n' +
+        'UNION ALL\n' +
+        'SELECT 2.5 AS num, "foo" AS mixed, 4 AS nullable\n' +
+        'UNION ALL\n' +
+        'SELECT 3 AS num, 3 AS mixed, 5 AS nullable;'
+    );
+    const columns = cursor.toColumns();
+    assert.ok(columns.num instanceof Float64Array);
+    assert.deepEqual(Array.from(columns.num), [1, 2.5, 3]);
+    assert.deepEqual(columns.mixed, [1, 'foo', 3]);
+    assert.deepEqual(columns.nullable, [null, 4, 5]);
+    assert.deepEqual(cursor.toArray(), []);
+
+    // An empty result still has every column.
+    const empty = sql.exec('SELECT 1 AS a, 2 AS b WHERE 0').toColumns();
+    assert.deepEqual(Object.keys(empty), ['a', 'b']);
+    assert.equal(empty.a.length, 0);
+  }
+
   {
     // Test one row with .one()
     let cursor = sql.exec('SELECT 123 AS foo, "abc" AS bar');
@@ -17,6 +17,10 @@ namespace workerd::api {
 // queries containing dynamic content or excessively large one-off queries.
 static constexpr uint SQL_STATEMENT_CACHE_MAX_SIZE = 1024 * 1024;
 
+// Maximum number of cached statements. Each prepared statement also holds SQLite memory beyond
+// its SQL text, so apps issuing many small distinct queries are bounded here.
+static constexpr uint SQL_STATEMENT_CACHE_MAX_COUNT = 1024;
+
 SqlStorage::SqlStorage(jsg::Ref<DurableObjectStorage> storage)
     : storage(kj::mv(storage)),
       statementCache(IoContext::current().addObject(kj::heap<StatementCache>())) {}
@@ -33,7 +37,9 @@ jsg::Ref<SqlStorage::Cursor> SqlStorage::exec(
   auto& db = getDb(js);
   auto& statementCache = *this->statementCache;
 
+  bool cacheHit = true;
   kj::Rc<CachedStatement>& slot = statementCache.map.findOrCreate(querySql, [&]() {
+    cacheHit = false;
     auto result = kj::rc<CachedStatement>(js, *this, db, querySql, js.toString(querySql));
     statementCache.totalSize += result->statementSize;
     return result;
@@ -53,14 +59,17 @@ jsg::Ref<SqlStorage::Cursor> SqlStorage::exec(
     //
     // In theory we could try to cache multiple copies of the statement, but as this is probably
     // exceedingly rare, it is not worth the added code complexity.
+    db.getSqliteObserver().addStatementCacheStats(0, 1);
     SqliteDatabase::Regulator& regulator = *this;
     return jsg::alloc<Cursor>(js, db, regulator, js.toString(querySql), kj::mv(bindings));
   }
 
+  db.getSqliteObserver().addStatementCacheStats(cacheHit ? 1 : 0, cacheHit ? 0 : 1);
   auto result = jsg::alloc<Cursor>(js, slot.addRef(), kj::mv(bindings));
 
   // If the statement cache grew too big, drop the least-recently-used entry.
-  while (statementCache.totalSize > SQL_STATEMENT_CACHE_MAX_SIZE) {
+  while (statementCache.totalSize > SQL_STATEMENT_CACHE_MAX_SIZE ||
+      statementCache.map.size() > SQL_STATEMENT_CACHE_MAX_COUNT) {
     auto& toRemove = *statementCache.lru.begin();
     auto oldQuery = jsg::JsString(toRemove.query.getHandle(js));
     statementCache.totalSize -= toRemove.statementSize;
@@ -204,20 +213,100 @@ SqlStorage::Cursor::RowIterator::Next SqlStorage::Cursor::next(jsg::Lock& js) {
 }
 
 jsg::JsArray SqlStorage::Cursor::toArray(jsg::Lock& js) {
-  auto self = JSG_THIS;
   v8::LocalVector<v8::Value> results(js.v8Isolate);
-  for (;;) {
-    auto maybeRow = rowIteratorNext(js, self);
-    KJ_IF_SOME(row, maybeRow) {
-      results.push_back(row);
-    } else {
-      break;
-    }
+  KJ_IF_SOME(st, state) {
+    // Read all the remaining rows in one batch, rather than one iterator step at a time.
+    auto& query = st->query;
+    auto names = columnNames.getHandle(js);
+    query.forEachRow(kj::maxValue, [&]() {
+      auto values = readRow(js, query);
+      results.push_back(rowToObject(js, names, values));
+    });
+    endQuery(*st);
+  } else {
+    // This throws if the cursor was canceled.
+    auto self = JSG_THIS;
+    KJ_ASSERT(rowIteratorNext(js, self) == kj::none);
   }
 
   return jsg::JsArray(v8::Array::New(js.v8Isolate, results.data(), results.size()));
 }
 
+jsg::JsObject SqlStorage::Cursor::toColumns(jsg::Lock& js) {
+  auto names = columnNames.getHandle(js);
+
+  // Each column is read as numbers for as long as every value in it is one. The first value that
+  // isn't converts the column to a vector of JS values.
+  struct Column {
+    kj::Vector<double> numbers;
+    kj::Maybe<v8::LocalVector<v8::Value>> values;
+  };
+  auto columns = kj::heapArray<Column>(names.size());
+
+  KJ_IF_SOME(st, state) {
+    auto& query = st->query;
+    query.forEachRow(kj::maxValue, [&]() {
+      for (auto i: kj::indices(columns)) {
+        auto& column = columns[i];
+        auto value = query.getValue(i);
+        if (column.values == kj::none) {
+          KJ_IF_SOME(d, value.tryGet<double>()) {
+            column.numbers.add(d);
+            continue;
+          } else KJ_IF_SOME(n, value.tryGet<int64_t>()) {
+            // Coerced to double, as readRow() does.
+            column.numbers.add(static_cast<double>(n));
+            continue;
+          }
+          auto& values = column.values.emplace(js.v8Isolate);
+          values.reserve(column.numbers.size() + 1);
+          for (double d: column.numbers) {
+            values.push_back(js.num(d));
+          }
+          column.numbers.clear();
+        }
+        SqlValue sqlValue;
+        KJ_SWITCH_ONEOF(value) {
+          KJ_CASE_ONEOF(data, kj::ArrayPtr<const byte>) {
+            sqlValue.emplace(kj::heapArray(data));
+          }
+          KJ_CASE_ONEOF(text, kj::StringPtr) {
+            sqlValue.emplace(text);
+          }
+          KJ_CASE_ONEOF(n, int64_t) {
+            sqlValue.emplace(static_cast<double>(n));
+          }
+          KJ_CASE_ONEOF(d, double) {
+            sqlValue.emplace(d);
+          }
+          KJ_CASE_ONEOF(_, decltype(nullptr)) {}
+        }
+        KJ_ASSERT_NONNULL(column.values).push_back(wrapSqlValue(js, kj::mv(sqlValue)));
+      }
+    });
+    endQuery(*st);
+  } else {
+    // This throws if the cursor was canceled.
+    auto self = JSG_THIS;
+    KJ_ASSERT(rowIteratorNext(js, self) == kj::none);
+  }
+
+  jsg::JsObject result = js.obj();
+  for (auto i: kj::indices(columns)) {
+    auto& column = columns[i];
+    v8::Local<v8::Value> handle;
+    KJ_IF_SOME(values, column.values) {
+      handle = v8::Array::New(js.v8Isolate, values.data(), values.size());
+    } else {
+      auto size = column.numbers.size();
+      auto buffer = js.wrapBytes(column.numbers.releaseAsArray().releaseAsBytes());
+      handle = v8::Float64Array::New(buffer, 0, size);
+    }
+    result.set(js, names.get(js, i), jsg::JsValue(handle));
+  }
+  return result;
+}
+
 jsg::JsValue SqlStorage::Cursor::one(jsg::Lock& js) {
   auto self = JSG_THIS;
   auto result = JSG_REQUIRE_NONNULL(rowIteratorNext(js, self), Error,
@@ -240,18 +329,22 @@ jsg::Ref<SqlStorage::Cursor::RowIterator> SqlStorage::Cursor::rows(jsg::Lock& js
 
 kj::Maybe<jsg::JsObject> SqlStorage::Cursor::rowIteratorNext(jsg::Lock& js, jsg::Ref<Cursor>& obj) {
   KJ_IF_SOME(values, iteratorImpl(js, obj)) {
-    auto names = obj->columnNames.getHandle(js);
-    jsg::JsObject result = js.obj();
-    KJ_ASSERT(names.size() == values.size());
-    for (auto i: kj::zeroTo(names.size())) {
-      result.set(js, names.get(js, i), jsg::JsValue(values[i]));
-    }
-    return result;
+    return rowToObject(js, obj->columnNames.getHandle(js), values);
   } else {
     return kj::none;
   }
 }
 
+jsg::JsObject SqlStorage::Cursor::rowToObject(
+    jsg::Lock& js, jsg::JsArray names, v8::LocalVector<v8::Value>& values) {
+  jsg::JsObject result = js.obj();
+  KJ_ASSERT(names.size() == values.size());
+  for (auto i: kj::zeroTo(names.size())) {
+    result.set(js, names.get(js, i), jsg::JsValue(values[i]));
+  }
+  return result;
+}
+
 jsg::Ref<SqlStorage::Cursor::RawIterator> SqlStorage::Cursor::raw(jsg::Lock&) {
   return jsg::alloc<RawIterator>(JSG_THIS);
 }
@@ -292,6 +385,30 @@ kj::Maybe<v8::LocalVector<v8::Value>> SqlStorage::Cursor::iteratorImpl(
     return kj::none;
   }
 
+  auto results = readRow(js, query);
+
+  // Proactively iterate to the next row and, if it turns out the query is done, discard it. This
+  // is an optimization to make sure that the statement can be returned to the statement cache once
+  // the application has iterated over all results, even if the application fails to call next()
+  // one last time to get `{done: true}`. A common case where this could happen is if the app is
+  // expecting zero or one results, so it calls `exec(...).next()`. In the case that one result
+  // was returned, the application may not bother calling `next()` again. If we hadn't proactively
+  // iterated ahead by one, then the statement would not be returned to the cache until it was
+  // GC'd, which might prevent the cache from being effective in the meantime.
+  //
+  // Unfortunately, this does not help with the case where the application stops iterating with
+  // results still available from the cursor. There's not much we can do about that case since
+  // there's no way to know if the app might come back and try to use the cursor again later.
+  query.nextRow();
+  if (query.isDone()) {
+    obj->endQuery(state);
+  }
+
+  return kj::mv(results);
+}
+
+v8::LocalVector<v8::Value> SqlStorage::Cursor::readRow(
+    jsg::Lock& js, SqliteDatabase::Query& query) {
   auto n = query.columnCount();
   v8::LocalVector<v8::Value> results(js.v8Isolate);
   results.reserve(n);
@@ -319,25 +436,7 @@ kj::Maybe<v8::LocalVector<v8::Value>> SqlStorage::Cursor::iteratorImpl(
     }
     results.push_back(wrapSqlValue(js, kj::mv(value)));
   }
-
-  // Proactively iterate to the next row and, if it turns out the query is done, discard it. This
-  // is an optimization to make sure that the statement can be returned to the statement cache once
-  // the application has iterated over all results, even if the application fails to call next()
-  // one last time to get `{done: true}`. A common case where this could happen is if the app is
-  // expecting zero or one results, so it calls `exec(...).next()`. In the case that one result
-  // was returned, the application may not bother calling `next()` again. If we hadn't proactively
-  // iterated ahead by one, then the statement would not be returned to the cache until it was
-  // GC'd, which might prevent the cache from being effective in the meantime.
-  //
-  // Unfortunately, this does not help with the case where the application stops iterating with
-  // results still available from the cursor. There's not much we can do about that case since
-  // there's no way to know if the app might come back and try to use the cursor again later.
-  query.nextRow();
-  if (query.isDone()) {
-    obj->endQuery(state);
-  }
-
-  return kj::mv(results);
+  return results;
 }
 
 void SqlStorage::Cursor::endQuery(State& stateRef) {
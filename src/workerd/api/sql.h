@@ -193,6 +193,7 @@ class SqlStorage::Cursor final: public jsg::Object {
   JSG_RESOURCE_TYPE(Cursor, CompatibilityFlags::Reader flags) {
     JSG_METHOD(next);
     JSG_METHOD(toArray);
+    JSG_METHOD(toColumns);
     JSG_METHOD(one);
 
     JSG_ITERABLE(rows);
@@ -207,6 +208,7 @@ class SqlStorage::Cursor final: public jsg::Object {
       raw<U extends SqlStorageValue[]>(): IterableIterator<U>;
       next(): { done?: false, value: T } | { done: true, value?: never };
       toArray(): T[];
+      toColumns(): { [K in keyof T]: Float64Array | T[K][] };
       one(): T;
       columnNames: string[];
     });
@@ -221,6 +223,13 @@ class SqlStorage::Cursor final: public jsg::Object {
 
   RowIterator::Next next(jsg::Lock& js);
   jsg::JsArray toArray(jsg::Lock& js);
+
+  // Reads all remaining rows and returns them by column: an object mapping each column name to
+  // the column's values. A column whose values are all numbers comes back as a Float64Array,
+  // which costs no JS value per cell; any other column is an array of values, as they'd appear in
+  // rows.
+  jsg::JsObject toColumns(jsg::Lock& js);
+
   jsg::JsValue one(jsg::Lock& js);
 
   void visitForMemoryInfo(jsg::MemoryTracker& tracker) const {
@@ -291,6 +300,13 @@ class SqlStorage::Cursor final: public jsg::Object {
   static kj::Maybe<jsg::JsArray> rawIteratorNext(jsg::Lock& js, jsg::Ref<Cursor>& obj);
   static kj::Maybe<v8::LocalVector<v8::Value>> iteratorImpl(jsg::Lock& js, jsg::Ref<Cursor>& obj);
 
+  // Convert the query's current row to JS values.
+  static v8::LocalVector<v8::Value> readRow(jsg::Lock& js, SqliteDatabase::Query& query);
+
+  // Build a row object, as returned by the row iterator, from the values returned by readRow().
+  static jsg::JsObject rowToObject(
+      jsg::Lock& js, jsg::JsArray names, v8::LocalVector<v8::Value>& values);
+
   friend class Statement;
 
   void visitForGc(jsg::GcVisitor& visitor) {
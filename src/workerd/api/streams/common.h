@@ -200,6 +200,15 @@ class WritableStreamSink {
   virtual kj::Maybe<kj::Promise<DeferredProxy<void>>> tryPumpFrom(
       ReadableStreamSource& input, bool end);
 
+  // Like `kj::AsyncOutputStream::tryPumpFrom()`: if this sink is backed by a native KJ stream,
+  // pump up to `amount` bytes from `input` directly into it, returning the number of bytes pumped.
+  // This lets Cap'n Proto perform path shortening when a sink handed off over RPC turns out to be
+  // backed by another native or capnp stream. Returns none if the sink cannot accept native
+  // input (e.g. it is JavaScript-backed or must observe every write), in which case the caller
+  // falls back to write().
+  virtual kj::Maybe<kj::Promise<uint64_t>> tryPumpFromNative(
+      kj::AsyncInputStream& input, uint64_t amount);
+
   virtual void abort(kj::Exception reason) = 0;
   // TODO(conform): abort() should return a promise after which closed fulfillers should be
   //   rejected. This may necessitate an "erroring" state.
@@ -237,6 +246,19 @@ class ReadableStreamSource {
   kj::Promise<kj::Array<byte>> readAllBytes(uint64_t limit);
   kj::Promise<kj::String> readAllText(uint64_t limit);
 
+  struct ReadAllIntoResult {
+    // Number of bytes written to the front of the destination buffer.
+    size_t amount;
+    // Bytes the stream produced beyond the end of the destination buffer, if it turned out to be
+    // longer than expected.
+    kj::Array<byte> overflow;
+  };
+
+  // Like readAllBytes(), but reads into a caller-provided buffer, typically one allocated in V8
+  // memory using the length reported by tryGetLength(). This lets the body land directly in its
+  // final location rather than being copied out of a KJ buffer afterwards.
+  kj::Promise<ReadAllIntoResult> readAllBytesInto(kj::ArrayPtr<byte> dest, uint64_t limit);
+
   // Hook to inform this ReadableStreamSource that the ReadableStream has been canceled. This only
   // really means anything to TransformStreams, which are supposed to propagate the error to the
   // writable side, and custom ReadableStreams, which we don't implement yet.
@@ -447,6 +469,11 @@ class ReadableStreamController {
     virtual void release(jsg::Lock& js, kj::Maybe<v8::Local<v8::Value>> maybeError = kj::none) = 0;
     virtual kj::Maybe<kj::Promise<void>> tryPumpTo(WritableStreamSink& sink, bool end) = 0;
     virtual jsg::Promise<ReadResult> read(jsg::Lock& js) = 0;
+
+    // True if the next read() will be fulfilled from chunks the source has already queued,
+    // without waiting on the underlying source. Pipes use this to read several chunks ahead
+    // before writing them to the destination together.
+    virtual bool hasBufferedData() = 0;
   };
 
   virtual ~ReadableStreamController() noexcept(false) {}
@@ -460,6 +487,12 @@ class ReadableStreamController {
   // any arbitrary JavaScript value through.
   virtual bool isByteOriented() const = 0;
 
+  // Returns true if the stream is backed by a native ReadableStreamSource rather than by
+  // JavaScript, in which case pumpTo() moves its data without running any JavaScript per chunk.
+  virtual bool isInternal() const {
+    return false;
+  }
+
   // Reads data from the stream. If the stream is byte-oriented, then the ByobOptions can be
   // specified to provide a v8::ArrayBuffer to be filled by the read operation. If the ByobOptions
   // are provided and the stream is not byte-oriented, the operation will return a rejected promise.
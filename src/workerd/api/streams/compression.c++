@@ -8,6 +8,10 @@
 
 #include <workerd/io/features.h>
 
+#include <brotli/decode.h>
+#include <brotli/encode.h>
+#include <kj/vector.h>
+
 #include <deque>
 #include <iterator>
 #include <vector>
@@ -64,8 +68,42 @@ void CompressionAllocator::FreeForZlib(void* opaque, void* pointer) {
   JSG_REQUIRE(allocator->allocations.erase(pointer), Error, "Zlib allocation should exist"_kj);
 }
 
+void CompressionAllocator::detachFromIsolate() {
+  for (auto& entry: allocations) {
+    entry.value.memoryAdjustment = kj::none;
+  }
+}
+
+void CompressionAllocator::attachToIsolate(jsg::Lock& js) {
+  for (auto& entry: allocations) {
+    if (entry.value.memoryAdjustment == kj::none) {
+      entry.value.memoryAdjustment = js.getExternalMemoryAdjustment(entry.value.data.size());
+    }
+  }
+}
+
 namespace {
 
+enum class Format {
+  GZIP,
+  DEFLATE,
+  DEFLATE_RAW,
+  BROTLI,
+};
+
+Format parseFormat(jsg::Lock& js, kj::StringPtr format) {
+  if (format == "gzip") return Format::GZIP;
+  if (format == "deflate") return Format::DEFLATE;
+  if (format == "deflate-raw") return Format::DEFLATE_RAW;
+  if (FeatureFlags::get(js).getBrotliCompressionStreams()) {
+    JSG_REQUIRE(format == "br", TypeError,
+        "The compression format must be either 'deflate', 'deflate-raw', 'gzip' or 'br'.");
+    return Format::BROTLI;
+  }
+  JSG_FAIL_REQUIRE(
+      TypeError, "The compression format must be either 'deflate', 'deflate-raw' or 'gzip'.");
+}
+
 class Context {
  public:
   enum class Mode {
@@ -83,9 +121,53 @@ class Context {
     kj::ArrayPtr<const byte> buffer;
   };
 
-  explicit Context(Mode mode, kj::StringPtr format, ContextFlags flags)
+  Context(Mode mode, Format format, ContextFlags flags)
       : mode(mode),
-        strictCompression(flags) {
+        format(format),
+        strictCompression(flags) {}
+  virtual ~Context() noexcept(false) = default;
+  KJ_DISALLOW_COPY_AND_MOVE(Context);
+
+  Mode getMode() const {
+    return mode;
+  }
+
+  Format getFormat() const {
+    return format;
+  }
+
+  void setFlags(ContextFlags flags) {
+    strictCompression = flags;
+  }
+
+  CompressionAllocator& getAllocator() {
+    return allocator;
+  }
+
+  virtual void setInput(const void* in, size_t size) = 0;
+
+  // Compresses or decompresses as much pending input as fits in the output buffer. `flush` is
+  // Z_NO_FLUSH for ordinary writes and Z_FINISH once the input has ended. `success` in the result
+  // means that calling pumpOnce() again may produce more output.
+  virtual Result pumpOnce(int flush) = 0;
+
+  // Returns the context to its freshly-initialized state so that another stream can use it.
+  // Returns false if the context can't be reused.
+  virtual bool reset() = 0;
+
+ protected:
+  Mode mode;
+  Format format;
+  CompressionAllocator allocator;
+  kj::byte buffer[16384];
+
+  // For the eponymous compatibility flag
+  ContextFlags strictCompression;
+};
+
+class ZlibStreamContext final: public Context {
+ public:
+  ZlibStreamContext(Mode mode, Format format, ContextFlags flags): Context(mode, format, flags) {
     // Configure allocator before any stream operations.
     allocator.configure(&ctx);
     int result = Z_OK;
@@ -104,7 +186,7 @@ class Context {
     JSG_REQUIRE(result == Z_OK, Error, "Failed to initialize compression context."_kj);
   }
 
-  ~Context() noexcept(false) {
+  ~ZlibStreamContext() noexcept(false) {
     switch (mode) {
       case Mode::COMPRESS:
         deflateEnd(&ctx);
@@ -115,14 +197,12 @@ class Context {
     }
   }
 
-  KJ_DISALLOW_COPY_AND_MOVE(Context);
-
-  void setInput(const void* in, size_t size) {
+  void setInput(const void* in, size_t size) override {
     ctx.next_in = const_cast<byte*>(reinterpret_cast<const byte*>(in));
     ctx.avail_in = size;
   }
 
-  Result pumpOnce(int flush) {
+  Result pumpOnce(int flush) override {
     ctx.next_out = buffer;
     ctx.avail_out = sizeof(buffer);
 
@@ -160,11 +240,20 @@ class Context {
     };
   }
 
- protected:
-  CompressionAllocator allocator;
+  bool reset() override {
+    // Unlike tearing the stream down and initializing a new one, resetting keeps zlib's
+    // allocations (the window and hash tables), which is what makes pooling worthwhile.
+    switch (mode) {
+      case Mode::COMPRESS:
+        return deflateReset(&ctx) == Z_OK;
+      case Mode::DECOMPRESS:
+        return inflateReset(&ctx) == Z_OK;
+    }
+    KJ_UNREACHABLE;
+  }
 
  private:
-  static int getWindowBits(kj::StringPtr format) {
+  static int getWindowBits(Format format) {
     // We use a windowBits value of 15 combined with the magic value
     // for the compression format type. For gzip, the magic value is
     // 16, so the value returned is 15 + 16. For deflate, the magic
@@ -174,21 +263,96 @@ class Context {
     static constexpr auto GZIP = 16;
     static constexpr auto DEFLATE = 15;
     static constexpr auto DEFLATE_RAW = -15;
-    if (format == "gzip")
-      return DEFLATE + GZIP;
-    else if (format == "deflate")
-      return DEFLATE;
-    else if (format == "deflate-raw")
-      return DEFLATE_RAW;
+    switch (format) {
+      case Format::GZIP:
+        return DEFLATE + GZIP;
+      case Format::DEFLATE:
+        return DEFLATE;
+      case Format::DEFLATE_RAW:
+        return DEFLATE_RAW;
+      case Format::BROTLI:
+        break;
+    }
     KJ_UNREACHABLE;
   }
 
-  Mode mode;
   z_stream ctx = {};
-  kj::byte buffer[16384];
+};
 
-  // For the eponymous compatibility flag
-  ContextFlags strictCompression;
+class BrotliStreamContext final: public Context {
+ public:
+  BrotliStreamContext(Mode mode, ContextFlags flags): Context(mode, Format::BROTLI, flags) {
+    switch (mode) {
+      case Mode::COMPRESS:
+        encoder = BrotliEncoderCreateInstance(
+            CompressionAllocator::AllocForBrotli, CompressionAllocator::FreeForZlib, &allocator);
+        JSG_REQUIRE(encoder != nullptr, Error, "Failed to initialize compression context."_kj);
+        break;
+      case Mode::DECOMPRESS:
+        decoder = BrotliDecoderCreateInstance(
+            CompressionAllocator::AllocForBrotli, CompressionAllocator::FreeForZlib, &allocator);
+        JSG_REQUIRE(decoder != nullptr, Error, "Failed to initialize compression context."_kj);
+        break;
+    }
+  }
+
+  ~BrotliStreamContext() noexcept(false) {
+    if (encoder != nullptr) BrotliEncoderDestroyInstance(encoder);
+    if (decoder != nullptr) BrotliDecoderDestroyInstance(decoder);
+  }
+
+  void setInput(const void* in, size_t size) override {
+    nextIn = reinterpret_cast<const uint8_t*>(in);
+    availIn = size;
+  }
+
+  Result pumpOnce(int flush) override {
+    uint8_t* nextOut = buffer;
+    size_t availOut = sizeof(buffer);
+    bool more = false;
+
+    switch (mode) {
+      case Mode::COMPRESS: {
+        auto op = flush == Z_FINISH ? BROTLI_OPERATION_FINISH : BROTLI_OPERATION_PROCESS;
+        JSG_REQUIRE(BrotliEncoderCompressStream(
+                        encoder, op, &availIn, &nextIn, &availOut, &nextOut, nullptr),
+            Error, "Compression failed.");
+        more = availIn > 0 || BrotliEncoderHasMoreOutput(encoder) ||
+            (op == BROTLI_OPERATION_FINISH && !BrotliEncoderIsFinished(encoder));
+        break;
+      }
+      case Mode::DECOMPRESS: {
+        auto result = BrotliDecoderDecompressStream(
+            decoder, &availIn, &nextIn, &availOut, &nextOut, nullptr);
+        JSG_REQUIRE(result != BROTLI_DECODER_RESULT_ERROR, Error, "Decompression failed.");
+
+        if (strictCompression == ContextFlags::STRICT) {
+          JSG_REQUIRE(!(result == BROTLI_DECODER_RESULT_SUCCESS && availIn > 0), TypeError,
+              "Trailing bytes after end of compressed data");
+          JSG_REQUIRE(!(flush == Z_FINISH && result == BROTLI_DECODER_RESULT_NEEDS_MORE_INPUT),
+              TypeError, "Called close() on a decompression stream with incomplete data");
+        }
+        more = result == BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT;
+        break;
+      }
+    }
+
+    return Result{
+      .success = more,
+      .buffer = kj::arrayPtr(buffer, sizeof(buffer) - availOut),
+    };
+  }
+
+  bool reset() override {
+    // Brotli has no reset operation, and recreating the state frees its allocations anyway.
+    return false;
+  }
+
+ private:
+  BrotliEncoderState* encoder = nullptr;
+  BrotliDecoderState* decoder = nullptr;
+  const uint8_t* nextIn = nullptr;
+  size_t availIn = 0;
 };
 
 // Buffer class based on std::vector that erases data that has been read from it lazily to avoid
@@ -196,7 +360,10 @@ class Context {
 // used to track the amount of data that has not been read back yet.
 class LazyBuffer {
  public:
-  LazyBuffer(): valid_size_(0) {}
+  // `storage` is reused for its capacity; any contents are discarded.
+  explicit LazyBuffer(std::vector<kj::byte> storage): output(kj::mv(storage)), valid_size_(0) {
+    output.clear();
+  }
 
   // Return a chunk of data and mark it as invalid. The returned chunk remains valid until data is
   // shifted, cleared or destructor is called. maybeShift() should be called after the returned data
@@ -240,19 +407,99 @@ class LazyBuffer {
     return valid_size_ == 0;
   }
 
+  // Gives up the underlying storage so that another stream can reuse its capacity.
+  std::vector<kj::byte> releaseStorage() {
+    valid_size_ = 0;
+    return kj::mv(output);
+  }
+
  private:
   std::vector<kj::byte> output;
   size_t valid_size_;
 };
 
+// Setting up a zlib context takes several large allocations (deflate's state alone is about
+// 256KB), and workers that compress every response would otherwise churn through them. So when a
+// stream is destroyed, its context and output buffer go back to a small per-thread pool, and the
+// next stream with the same mode and format resets and reuses them. Contexts in the pool aren't
+// charged to any isolate; acquire() charges them to the isolate that takes them. Brotli contexts
+// can't be reset, so they are never pooled.
+class ContextPool {
+ public:
+  static ContextPool& current() {
+    static thread_local ContextPool pool;
+    return pool;
+  }
+
+  kj::Own<Context> acquire(
+      jsg::Lock& js, Context::Mode mode, Format format, Context::ContextFlags flags) {
+    if (format == Format::BROTLI) {
+      return kj::heap<BrotliStreamContext>(mode, flags);
+    }
+
+    auto& pooled = contexts[static_cast<uint>(mode)][static_cast<uint>(format)];
+    if (pooled.empty()) {
+      return kj::heap<ZlibStreamContext>(mode, format, flags);
+    }
+
+    auto context = kj::mv(pooled.back());
+    pooled.removeLast();
+    context->setFlags(flags);
+    context->getAllocator().attachToIsolate(js);
+    return kj::mv(context);
+  }
+
+  void release(kj::Own<Context> context) {
+    if (context->getFormat() == Format::BROTLI) return;
+
+    auto& pooled =
+        contexts[static_cast<uint>(context->getMode())][static_cast<uint>(context->getFormat())];
+    if (pooled.size() >= MAX_POOLED_CONTEXTS || !context->reset()) return;
+
+    context->getAllocator().detachFromIsolate();
+    pooled.add(kj::mv(context));
+  }
+
+  std::vector<kj::byte> acquireBuffer() {
+    if (buffers.empty()) return {};
+    auto buffer = kj::mv(buffers.back());
+    buffers.removeLast();
+    return buffer;
+  }
+
+  void releaseBuffer(std::vector<kj::byte> buffer) {
+    // Don't hold on to the occasional huge buffer left behind by a reader that fell far behind.
+    if (buffers.size() >= MAX_POOLED_BUFFERS || buffer.capacity() > MAX_POOLED_BUFFER_CAPACITY) {
+      return;
+    }
+    buffer.clear();
+    buffers.add(kj::mv(buffer));
+  }
+
+ private:
+  static constexpr size_t MAX_POOLED_CONTEXTS = 4;  // Per mode and zlib format.
+  static constexpr size_t MAX_POOLED_BUFFERS = 8;
+  static constexpr size_t MAX_POOLED_BUFFER_CAPACITY = 64 * 1024;
+
+  // Indexed by Context::Mode, then by the zlib formats of Format.
+  kj::Vector<kj::Own<Context>> contexts[2][3];
+  kj::Vector<std::vector<kj::byte>> buffers;
+};
+
 // Uncompressed data goes in. Compressed data comes out.
-template <Context::Mode mode>
 class CompressionStreamImpl: public kj::Refcounted,
                              public ReadableStreamSource,
                              public WritableStreamSink {
  public:
-  explicit CompressionStreamImpl(kj::String format, Context::ContextFlags flags)
-      : context(mode, format, flags) {}
+  explicit CompressionStreamImpl(kj::Own<Context> context)
+      : context(kj::mv(context)),
+        output(ContextPool::current().acquireBuffer()) {}
+
+  ~CompressionStreamImpl() noexcept(false) {
+    auto& pool = ContextPool::current();
+    pool.release(kj::mv(context));
+    pool.releaseBuffer(output.releaseStorage());
+  }
 
   // WritableStreamSink implementation ---------------------------------------------------
 
@@ -265,7 +512,7 @@ class CompressionStreamImpl: public kj::Refcounted,
         return kj::cp(exception);
       }
       KJ_CASE_ONEOF(open, Open) {
-        context.setInput(buffer.begin(), buffer.size());
+        context->setInput(buffer.begin(), buffer.size());
         return writeInternal(Z_NO_FLUSH);
       }
     }
@@ -362,7 +609,7 @@ class CompressionStreamImpl: public kj::Refcounted,
     // output queue.
     // If we reached the end, resolve the read immediately as well, since no
     // new data is expected.
-    if (output.size() >= minBytes || state.template is<Ended>()) {
+    if (output.size() >= minBytes || state.is<Ended>()) {
       return copyIntoBuffer(dest);
     }
 
@@ -388,12 +635,12 @@ class CompressionStreamImpl: public kj::Refcounted,
   kj::Promise<void> writeInternal(int flush) {
     // TODO(later): This does not yet implement any backpressure. A caller can keep calling
     // write without reading, which will continue to fill the internal buffer.
-    KJ_ASSERT(flush == Z_FINISH || state.template is<Open>());
+    KJ_ASSERT(flush == Z_FINISH || state.is<Open>());
     Context::Result result;
 
     while (true) {
       KJ_IF_SOME(exception, kj::runCatchingExceptions([this, flush, &result]() {
-        result = context.pumpOnce(flush);
+        result = context->pumpOnce(flush);
       })) {
         cancelInternal(kj::cp(exception));
         return kj::mv(exception);
@@ -462,7 +709,7 @@ class CompressionStreamImpl: public kj::Refcounted,
       KJ_ASSERT(output.empty());
     }
 
-    if (state.template is<Ended>() && !pendingReads.empty()) {
+    if (state.is<Ended>() && !pendingReads.empty()) {
       // We are ended and we have pending reads. Because of the loop above,
       // one of either pendingReads or output must be empty, so if we got this
       // far, output.empty() must be true. Let's check.
@@ -485,7 +732,7 @@ class CompressionStreamImpl: public kj::Refcounted,
   struct Open {};
 
   kj::OneOf<Open, Ended, kj::Exception> state = Open();
-  Context context;
+  kj::Own<Context> context;
 
   kj::Canceler canceler;
   LazyBuffer output;
@@ -493,12 +740,9 @@ class CompressionStreamImpl: public kj::Refcounted,
 };
 }  // namespace
 
-jsg::Ref<CompressionStream> CompressionStream::constructor(kj::String format) {
-  JSG_REQUIRE(format == "deflate" || format == "gzip" || format == "deflate-raw", TypeError,
-      "The compression format must be either 'deflate', 'deflate-raw' or 'gzip'.");
-
-  auto readableSide = kj::refcounted<CompressionStreamImpl<Context::Mode::COMPRESS>>(
-      kj::mv(format), Context::ContextFlags::NONE);
+jsg::Ref<CompressionStream> CompressionStream::constructor(jsg::Lock& js, kj::String format) {
+  auto readableSide = kj::refcounted<CompressionStreamImpl>(ContextPool::current().acquire(
+      js, Context::Mode::COMPRESS, parseFormat(js, format), Context::ContextFlags::NONE));
   auto writableSide = kj::addRef(*readableSide);
 
   auto& ioContext = IoContext::current();
@@ -509,13 +753,10 @@ jsg::Ref<CompressionStream> CompressionStream::constructor(kj::String format) {
 }
 
 jsg::Ref<DecompressionStream> DecompressionStream::constructor(jsg::Lock& js, kj::String format) {
-  JSG_REQUIRE(format == "deflate" || format == "gzip" || format == "deflate-raw", TypeError,
-      "The compression format must be either 'deflate', 'deflate-raw' or 'gzip'.");
-
-  auto readableSide =
-      kj::refcounted<CompressionStreamImpl<Context::Mode::DECOMPRESS>>(kj::mv(format),
-          FeatureFlags::get(js).getStrictCompression() ? Context::ContextFlags::STRICT
-                                                       : Context::ContextFlags::NONE);
+  auto readableSide = kj::refcounted<CompressionStreamImpl>(ContextPool::current().acquire(js,
+      Context::Mode::DECOMPRESS, parseFormat(js, format),
+      FeatureFlags::get(js).getStrictCompression() ? Context::ContextFlags::STRICT
+                                                   : Context::ContextFlags::NONE));
   auto writableSide = kj::addRef(*readableSide);
 
   auto& ioContext = IoContext::current();
@@ -20,6 +20,13 @@ class CompressionAllocator final {
  public:
   void configure(z_stream* stream);
 
+  // Drops the external memory adjustments for everything allocated so far, so that those
+  // allocations can outlive the isolate that made them; used when a stream's context is pooled.
+  void detachFromIsolate();
+
+  // Charges everything allocated so far that isn't already charged to the isolate holding `js`.
+  void attachToIsolate(jsg::Lock& js);
+
   static void* AllocForZlib(void* data, uInt items, uInt size);
   static void* AllocForBrotli(void* data, size_t size);
   static void FreeForZlib(void* data, void* pointer);
@@ -36,7 +43,7 @@ class CompressionStream: public TransformStream {
  public:
   using TransformStream::TransformStream;
 
-  static jsg::Ref<CompressionStream> constructor(kj::String format);
+  static jsg::Ref<CompressionStream> constructor(jsg::Lock& js, kj::String format);
 
   JSG_RESOURCE_TYPE(CompressionStream) {
     JSG_INHERIT(TransformStream);
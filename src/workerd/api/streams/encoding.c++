@@ -12,30 +12,106 @@
 namespace workerd::api {
 
 namespace {
+// The state a TextEncoderStream carries from one chunk to the next: a high surrogate that ended
+// the last chunk, which may pair with a low surrogate that starts the next one.
 class TextEncoderStreamController: public kj::Refcounted {
  public:
- private:
-  jsg::Ref<TextEncoder> encoder = jsg::alloc<TextEncoder>();
-};
-}  // namespace
-
-jsg::Ref<TextEncoderStream> TextEncoderStream::constructor(jsg::Lock& js) {
-  auto transformer = TransformStream::constructor(js,
-      Transformer{.transform = jsg::Function<Transformer::TransformAlgorithm>(
-                      [](jsg::Lock& js, auto chunk, auto controller) {
+  void transform(jsg::Lock& js, v8::Local<v8::Value> chunk, Transformer::Controller controller) {
     auto str = jsg::check(chunk->ToString(js.v8Context()));
-    auto maybeBuffer = v8::ArrayBuffer::MaybeNew(js.v8Isolate, str->Utf8Length(js.v8Isolate));
+    int length = str->Length();
+    if (length == 0) return;
+
+    // V8 encodes each lone surrogate as the 3-byte replacement character, so the surrogates at
+    // either end of the chunk are handled by adjusting the encoded output in place: a low
+    // surrogate that completes a pending high surrogate replaces the replacement character at the
+    // start of the output, and a trailing high surrogate is trimmed from the end and held back.
+    size_t offset = 0;
+    kj::Maybe<char32_t> pair;
+    KJ_IF_SOME(high, pendingHighSurrogate) {
+      auto first = codeUnitAt(js, str, 0);
+      if (isLowSurrogate(first)) {
+        pair = 0x10000 + ((high - 0xd800) << 10) + (first - 0xdc00);
+        offset = 1;  // The 4-byte pair replaces a 3-byte replacement character.
+      } else {
+        offset = REPLACEMENT.size();
+      }
+    }
+    pendingHighSurrogate = kj::none;
+    size_t trim = 0;
+    auto last = codeUnitAt(js, str, length - 1);
+    if (isHighSurrogate(last)) {
+      pendingHighSurrogate = last;
+      trim = REPLACEMENT.size();
+    }
+
+    size_t utf8Length = str->Utf8Length(js.v8Isolate);
+    auto maybeBuffer = v8::ArrayBuffer::MaybeNew(js.v8Isolate, offset + utf8Length);
     JSG_ASSERT(!maybeBuffer.IsEmpty(), RangeError, "Cannot allocate space for TextEncoder.encode");
     auto buffer = maybeBuffer.ToLocalChecked();
 
-    auto bytes = jsg::asBytes(buffer).releaseAsChars();
+    auto bytes = jsg::asBytes(buffer);
     [[maybe_unused]] int read = 0;
-    [[maybe_unused]] auto written = str->WriteUtf8(js.v8Isolate, bytes.begin(), bytes.size(), &read,
+    [[maybe_unused]] auto written = str->WriteUtf8(js.v8Isolate,
+        bytes.slice(offset).asChars().begin(), utf8Length, &read,
         v8::String::NO_NULL_TERMINATION | v8::String::REPLACE_INVALID_UTF8);
+    KJ_DASSERT(written == utf8Length);
+    KJ_DASSERT(read == length);
+
+    KJ_IF_SOME(codePoint, pair) {
+      bytes[0] = 0xf0 | (codePoint >> 18);
+      bytes[1] = 0x80 | ((codePoint >> 12) & 0x3f);
+      bytes[2] = 0x80 | ((codePoint >> 6) & 0x3f);
+      bytes[3] = 0x80 | (codePoint & 0x3f);
+    } else if (offset > 0) {
+      memcpy(bytes.begin(), REPLACEMENT.begin(), REPLACEMENT.size());
+    }
+
+    size_t size = offset + utf8Length - trim;
+    if (size > 0) {
+      controller->enqueue(js, v8::Uint8Array::New(buffer, 0, size));
+    }
+  }
+
+  void flush(jsg::Lock& js, Transformer::Controller controller) {
+    if (pendingHighSurrogate != kj::none) {
+      pendingHighSurrogate = kj::none;
+      auto buffer = jsg::check(v8::ArrayBuffer::MaybeNew(js.v8Isolate, REPLACEMENT.size()));
+      memcpy(jsg::asBytes(buffer).begin(), REPLACEMENT.begin(), REPLACEMENT.size());
+      controller->enqueue(js, v8::Uint8Array::New(buffer, 0, REPLACEMENT.size()));
+    }
+  }
+
+ private:
+  // U+FFFD, encoded as UTF-8.
+  static constexpr kj::StringPtr REPLACEMENT = "\xef\xbf\xbd"_kj;
+
+  kj::Maybe<char16_t> pendingHighSurrogate;
+
+  static bool isHighSurrogate(char16_t c) {
+    return c >= 0xd800 && c <= 0xdbff;
+  }
+  static bool isLowSurrogate(char16_t c) {
+    return c >= 0xdc00 && c <= 0xdfff;
+  }
+  static char16_t codeUnitAt(jsg::Lock& js, v8::Local<v8::String> str, int index) {
+    uint16_t unit = 0;
+    str->Write(js.v8Isolate, &unit, index, 1, v8::String::NO_NULL_TERMINATION);
+    return unit;
+  }
+};
+}  // namespace
 
-    KJ_DASSERT(written == buffer->ByteLength());
-    KJ_DASSERT(read == str->Length());
-    controller->enqueue(js, v8::Uint8Array::New(buffer, 0, buffer->ByteLength()));
+jsg::Ref<TextEncoderStream> TextEncoderStream::constructor(jsg::Lock& js) {
+  auto state = kj::refcounted<TextEncoderStreamController>();
+  auto transformer = TransformStream::constructor(js,
+      Transformer{.transform = jsg::Function<Transformer::TransformAlgorithm>(
+                      [state = kj::addRef(*state)](jsg::Lock& js, auto chunk, auto controller) {
+    state->transform(js, chunk, kj::mv(controller));
+    return js.resolvedPromise();
+  }),
+        .flush = jsg::Function<Transformer::FlushAlgorithm>(
+            [state = kj::mv(state)](jsg::Lock& js, auto controller) {
+    state->flush(js, kj::mv(controller));
     return js.resolvedPromise();
   })},
       StreamQueuingStrategy{}, StreamQueuingStrategy{});
@@ -66,17 +142,25 @@ jsg::Ref<TextDecoderStream> TextDecoderStream::constructor(
                       (decoder = decoder.addRef()), (decoder),
                       (jsg::Lock& js, auto chunk, auto controller) {
                         jsg::BufferSource source(js, chunk);
-                        controller->enqueue(js,
+                        auto decoded =
                             JSG_REQUIRE_NONNULL(decoder->decodePtr(js, source.asArrayPtr(), false),
-                                TypeError, "Failed to decode input."));
+                                TypeError, "Failed to decode input.");
+                        // A chunk that ends partway through a character may decode to nothing
+                        // yet. Per the spec, empty strings are not enqueued.
+                        if (decoded.length(js) > 0) {
+                          controller->enqueue(js, decoded);
+                        }
                         return js.resolvedPromise();
                       })),
         .flush = jsg::Function<Transformer::FlushAlgorithm>(
             JSG_VISITABLE_LAMBDA((decoder = decoder.addRef()), (decoder),
                 (jsg::Lock& js, auto controller) {
-                  controller->enqueue(js,
+                  auto decoded =
                       JSG_REQUIRE_NONNULL(decoder->decodePtr(js, kj::ArrayPtr<kj::byte>(), true),
-                          TypeError, "Failed to decode input."));
+                          TypeError, "Failed to decode input.");
+                  if (decoded.length(js) > 0) {
+                    controller->enqueue(js, decoded);
+                  }
                   return js.resolvedPromise();
                 }))},
       StreamQueuingStrategy{}, StreamQueuingStrategy{});
@@ -201,6 +201,71 @@ KJ_TEST("honest small stream") {
   KJ_ASSERT(stream.maxMaxBytesSeen(), 100);
 }
 
+KJ_TEST("readAllBytesInto") {
+  kj::EventLoop loop;
+  kj::WaitScope waitScope(loop);
+
+  // The stream reports its length, so the whole body should land in the destination buffer in a
+  // single read, followed by one zero-length read to confirm EOF.
+  BarStream<100000> stream;
+  auto dest = kj::heapArray<kj::byte>(100000);
+
+  auto result = stream.readAllBytesInto(dest, 100001).wait(waitScope);
+  KJ_ASSERT(result.amount == 100000);
+  KJ_ASSERT(result.overflow.size() == 0);
+  KJ_ASSERT(dest == stream.buf());
+  KJ_ASSERT(stream.numreads() == 2);
+
+  // A stream that is longer than the destination buffer returns the remainder as overflow.
+  FooStream<10000> longer;
+  auto small = kj::heapArray<kj::byte>(10);
+  auto overflowed = longer.readAllBytesInto(small, 10001).wait(waitScope);
+  KJ_ASSERT(overflowed.amount == 10);
+  KJ_ASSERT(overflowed.overflow.size() == 9990);
+  KJ_ASSERT(small == longer.buf().first(10));
+  KJ_ASSERT(overflowed.overflow == longer.buf().slice(10));
+}
+
+KJ_TEST("IdentityTransformStreamImpl fills minBytes from many small writes") {
+  kj::EventLoop loop;
+  kj::WaitScope waitScope(loop);
+
+  constexpr size_t kChunkSize = 4096;
+  constexpr size_t kChunks = 16;
+  constexpr size_t kReadSize = kChunkSize * kChunks;
+  constexpr size_t kIterations = 64;
+
+  IdentityTransformStreamImpl stream;
+  auto chunk = kj::heapArray<kj::byte>(kChunkSize);
+  auto buffer = kj::heapArray<kj::byte>(kReadSize);
+
+  for (size_t i = 0; i < kIterations; i++) {
+    auto read = stream.tryRead(buffer.begin(), kReadSize, kReadSize);
+
+    for (size_t j = 0; j < kChunks; j++) {
+      memset(chunk.begin(), static_cast<kj::byte>(i + j), chunk.size());
+      // Each write is absorbed into the pending read immediately...
+      auto write = stream.write(chunk);
+      KJ_ASSERT(write.poll(waitScope));
+      write.wait(waitScope);
+      // ...but the read only completes once it has been filled to minBytes.
+      KJ_ASSERT(read.poll(waitScope) == (j + 1 == kChunks));
+    }
+
+    KJ_ASSERT(read.wait(waitScope) == kReadSize);
+    for (size_t j = 0; j < kChunks; j++) {
+      KJ_ASSERT(buffer[j * kChunkSize] == static_cast<kj::byte>(i + j));
+    }
+  }
+
+  // A close hands over a partially filled read.
+  auto read = stream.tryRead(buffer.begin(), kReadSize, kReadSize);
+  stream.write(chunk).wait(waitScope);
+  KJ_ASSERT(!read.poll(waitScope));
+  stream.end().wait(waitScope);
+  KJ_ASSERT(read.wait(waitScope) == kChunkSize);
+}
+
 KJ_TEST("WritableStreamInternalController queue size assertion") {
 
   capnp::MallocMessageBuilder message;
@@ -352,5 +417,61 @@ KJ_TEST("WritableStreamInternalController observability") {
   KJ_ASSERT(observer.queueSizeBytes == 0);
 }
 
+KJ_TEST("WritableStreamInternalController combines queued writes") {
+  TestFixture fixture;
+
+  class MySink final: public WritableStreamSink {
+   public:
+    kj::Promise<void> write(kj::ArrayPtr<const byte> buffer) override {
+      ++writeCount;
+      data.addAll(buffer);
+      // Don't complete right away, so that the writes after this one queue up behind it.
+      return kj::evalLater([] {});
+    }
+    kj::Promise<void> write(kj::ArrayPtr<const kj::ArrayPtr<const byte>> pieces) override {
+      ++vectoredWriteCount;
+      pieceCount += pieces.size();
+      for (auto piece: pieces) {
+        data.addAll(piece);
+      }
+      return kj::evalLater([] {});
+    }
+    kj::Promise<void> end() override {
+      return kj::READY_NOW;
+    }
+    void abort(kj::Exception reason) override {}
+
+    uint writeCount = 0;
+    uint vectoredWriteCount = 0;
+    size_t pieceCount = 0;
+    kj::Vector<byte> data;
+  };
+
+  auto mySink = kj::heap<MySink>();
+  auto& sink = *mySink;
+  kj::Maybe<jsg::Ref<WritableStream>> stream;
+  fixture.runInIoContext([&](const TestFixture::Environment& env) -> kj::Promise<void> {
+    stream = jsg::alloc<WritableStream>(env.context, kj::mv(mySink), kj::none);
+
+    auto write = [&](byte value) {
+      auto buffersource = env.js.bytes(kj::heapArray<kj::byte>({value, value}));
+      return env.context.awaitJs(env.js,
+          KJ_ASSERT_NONNULL(stream)->getController().write(env.js, buffersource.getHandle(env.js)));
+    };
+
+    auto builder = kj::heapArrayBuilder<kj::Promise<void>>(4);
+    for (auto c: "abcd"_kj) {
+      builder.add(write(c));
+    }
+    return kj::joinPromises(builder.finish());
+  });
+
+  // The first write goes to the sink on its own. The three queued behind it go together.
+  KJ_EXPECT(sink.writeCount == 1);
+  KJ_EXPECT(sink.vectoredWriteCount == 1);
+  KJ_EXPECT(sink.pieceCount == 3);
+  KJ_EXPECT(sink.data.asPtr() == "aabbccdd"_kjb);
+}
+
 }  // namespace
 }  // namespace workerd::api
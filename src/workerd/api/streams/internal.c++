@@ -11,6 +11,7 @@
 #include <workerd/io/features.h>
 #include <workerd/jsg/jsg.h>
 #include <workerd/util/string-buffer.h>
+#include <workerd/util/use-perfetto-categories.h>
 
 #include <kj/vector.h>
 
@@ -33,6 +34,9 @@ namespace {
 }
 
 kj::Promise<void> pumpTo(ReadableStreamSource& input, WritableStreamSink& output, bool end) {
+  TRACE_EVENT_BEGIN(
+      "workerd.streams", "ReadableStreamSource pump", PERFETTO_TRACK_FROM_POINTER(&input));
+  KJ_DEFER(TRACE_EVENT_END("workerd.streams", PERFETTO_TRACK_FROM_POINTER(&input)));
   kj::byte buffer[4096]{};
 
   while (true) {
@@ -70,6 +74,49 @@ class AllReader final {
     co_return kj::String(kj::mv(data));
   }
 
+  // Reads the stream into `dest`, which the caller has sized from tryGetLength(). The stream is
+  // still read through to EOF; anything beyond `dest.size()` is returned as overflow.
+  kj::Promise<ReadableStreamSource::ReadAllIntoResult> readAllBytesInto(
+      kj::ArrayPtr<kj::byte> dest) {
+    uint64_t runningTotal = 0;
+    if (dest.size() > 0) {
+      runningTotal = co_await input.tryRead(dest.begin(), dest.size(), dest.size());
+      KJ_DASSERT(runningTotal <= dest.size());
+      JSG_REQUIRE(runningTotal < limit, TypeError, "Memory limit exceeded before EOF.");
+      if (runningTotal < dest.size()) {
+        co_return ReadableStreamSource::ReadAllIntoResult{runningTotal, nullptr};
+      }
+    }
+
+    // In the best case the stream was honest about its length and the next read is zero length,
+    // but we have to keep reading until it says so.
+    size_t filled = runningTotal;
+    kj::Vector<kj::Array<kj::byte>> parts;
+    for (;;) {
+      auto bytes = kj::heapArray<kj::byte>(MIN_BUFFER_CHUNK);
+      uint64_t amount = co_await input.tryRead(bytes.begin(), MIN_BUFFER_CHUNK, MIN_BUFFER_CHUNK);
+      KJ_DASSERT(amount <= MIN_BUFFER_CHUNK);
+
+      runningTotal += amount;
+      JSG_REQUIRE(runningTotal < limit, TypeError, "Memory limit exceeded before EOF.");
+
+      if (amount > 0) {
+        parts.add(bytes.first(amount).attach(kj::mv(bytes)));
+      }
+      if (amount < MIN_BUFFER_CHUNK) break;
+    }
+
+    if (parts.size() == 0) {
+      co_return ReadableStreamSource::ReadAllIntoResult{filled, nullptr};
+    }
+
+    KJ_LOG(WARNING, "ReadableStream provided more data than advertised", runningTotal,
+        dest.size());
+    auto overflow = kj::heapArray<kj::byte>(runningTotal - filled);
+    copyInto<kj::byte>(overflow, parts.asPtr());
+    co_return ReadableStreamSource::ReadAllIntoResult{filled, kj::mv(overflow)};
+  }
+
  private:
   ReadableStreamSource& input;
   uint64_t limit;
@@ -79,6 +126,10 @@ class AllReader final {
     NULL_TERMINATE,
   };
 
+  static constexpr uint64_t MIN_BUFFER_CHUNK = 1024;
+  static constexpr uint64_t DEFAULT_BUFFER_CHUNK = 4096;
+  static constexpr uint64_t MAX_BUFFER_CHUNK = DEFAULT_BUFFER_CHUNK * 4;
+
   template <typename T>
   kj::Promise<kj::Array<T>> read(ReadOption option = ReadOption::NONE) {
     // There are a few complexities in this operation that make it difficult to completely
@@ -122,9 +173,6 @@ class AllReader final {
 
     kj::Vector<kj::Array<T>> parts;
     uint64_t runningTotal = 0;
-    static constexpr uint64_t MIN_BUFFER_CHUNK = 1024;
-    static constexpr uint64_t DEFAULT_BUFFER_CHUNK = 4096;
-    static constexpr uint64_t MAX_BUFFER_CHUNK = DEFAULT_BUFFER_CHUNK * 4;
 
     // If we know in advance how much data we'll be reading, then we can attempt to
     // optimize the loop here by setting the value specifically so we are only
@@ -473,6 +521,12 @@ kj::Promise<kj::Array<byte>> ReadableStreamSource::readAllBytes(uint64_t limit)
   co_return co_await allReader.readAllBytes();
 }
 
+kj::Promise<ReadableStreamSource::ReadAllIntoResult> ReadableStreamSource::readAllBytesInto(
+    kj::ArrayPtr<byte> dest, uint64_t limit) {
+  AllReader allReader(*this, limit);
+  co_return co_await allReader.readAllBytesInto(dest);
+}
+
 kj::Promise<kj::String> ReadableStreamSource::readAllText(uint64_t limit) {
   AllReader allReader(*this, limit);
   co_return co_await allReader.readAllText();
@@ -489,6 +543,11 @@ kj::Maybe<kj::Promise<DeferredProxy<void>>> WritableStreamSink::tryPumpFrom(
   return kj::none;
 }
 
+kj::Maybe<kj::Promise<uint64_t>> WritableStreamSink::tryPumpFromNative(
+    kj::AsyncInputStream& input, uint64_t amount) {
+  return kj::none;
+}
+
 // =======================================================================================
 
 ReadableStreamInternalController::~ReadableStreamInternalController() noexcept(false) {
@@ -1581,7 +1640,37 @@ jsg::Promise<void> WritableStreamInternalController::writeLoopAfterFrontOutputLo
 
       auto amountToWrite = request.bytes.size();
 
-      auto promise = writable->sink->write(request.bytes).attach(kj::mv(request.ownBytes));
+      // Writes that queued up behind the one in flight are combined with it into one vectored
+      // write, so that JavaScript writing many small chunks back to back costs one write on the
+      // sink (a single writev() for a socket) and one trip through the event loop per batch. A
+      // write that has to wait for output locks of its own ends the batch.
+      static constexpr size_t MAX_COMBINED_WRITES = 64;
+      size_t count = 1;
+      while (count < queue.size() && count < MAX_COMBINED_WRITES) {
+        auto& next = queue[count];
+        auto maybeWrite = next.event.tryGet<Write>();
+        if (next.outputLock != kj::none || maybeWrite == kj::none ||
+            KJ_ASSERT_NONNULL(maybeWrite).bytes.size() == 0) {
+          break;
+        }
+        ++count;
+      }
+
+      kj::Promise<void> promise = nullptr;
+      if (count == 1) {
+        promise = writable->sink->write(request.bytes).attach(kj::mv(request.ownBytes));
+      } else {
+        auto pieces = kj::heapArrayBuilder<kj::ArrayPtr<const kj::byte>>(count);
+        auto ownBytes = kj::heapArrayBuilder<jsg::V8Ref<v8::ArrayBuffer>>(count);
+        for (auto i: kj::zeroTo(count)) {
+          auto& write = queue[i].event.get<Write>();
+          pieces.add(write.bytes);
+          ownBytes.add(kj::mv(write.ownBytes));
+        }
+        auto piecesArray = pieces.finish();
+        promise =
+            writable->sink->write(piecesArray).attach(kj::mv(piecesArray), ownBytes.finish());
+      }
 
       // TODO(soon): We use awaitIoLegacy() here because if the stream terminates in JavaScript in
       // this same isolate, then the promise may actually be waiting on JavaScript to do something,
@@ -1594,16 +1683,21 @@ jsg::Promise<void> WritableStreamInternalController::writeLoopAfterFrontOutputLo
       return ioContext.awaitIoLegacy(js, writable->canceler.wrap(kj::mv(promise)))
           .then(js,
               ioContext.addFunctor(
-                  [this, check, maybeAbort, amountToWrite](jsg::Lock& js) -> jsg::Promise<void> {
+                  [this, check, maybeAbort, count](jsg::Lock& js) -> jsg::Promise<void> {
         // Under some conditions, the clean up has already happened.
         if (queue.empty()) return js.resolvedPromise();
         auto& request = check();
-        maybeResolvePromise(js, request.promise);
-        decreaseCurrentWriteBufferSize(js, amountToWrite);
-        KJ_IF_SOME(o, observer) {
-          o->onChunkDequeued(amountToWrite);
+        KJ_ASSERT(queue.size() >= count);
+        for (auto i KJ_UNUSED: kj::zeroTo(count)) {
+          auto& write = queue.front().event.get<Write>();
+          auto amountWritten = write.bytes.size();
+          maybeResolvePromise(js, write.promise);
+          decreaseCurrentWriteBufferSize(js, amountWritten);
+          KJ_IF_SOME(o, observer) {
+            o->onChunkDequeued(amountWritten);
+          }
+          queue.pop_front();
         }
-        queue.pop_front();
         maybeAbort(js, request);
         return writeLoop(js, IoContext::current());
       }),
@@ -1614,6 +1708,8 @@ jsg::Promise<void> WritableStreamInternalController::writeLoopAfterFrontOutputLo
         auto handle = reason.getHandle(js);
         auto& request = check();
         auto& writable = state.get<IoOwn<Writable>>();
+        // Only the first of the combined writes is failed here. The rest are still queued and
+        // are rejected when the queue is drained below.
         decreaseCurrentWriteBufferSize(js, amountToWrite);
         KJ_IF_SOME(o, observer) {
           o->onChunkDequeued(amountToWrite);
@@ -1828,31 +1924,44 @@ bool WritableStreamInternalController::Pipe::checkSignal(jsg::Lock& js) {
   return false;
 }
 
-jsg::Promise<void> WritableStreamInternalController::Pipe::write(v8::Local<v8::Value> handle) {
+jsg::Promise<void> WritableStreamInternalController::Pipe::write(jsg::Lock& js) {
   auto& writable = parent.state.get<IoOwn<Writable>>();
-  // TODO(soon): Once jsg::BufferSource lands and we're able to use it, this can be simplified.
-  KJ_ASSERT(handle->IsArrayBuffer() || handle->IsArrayBufferView());
-  std::shared_ptr<v8::BackingStore> store;
-  size_t byteLength = 0;
-  size_t byteOffset = 0;
-  if (handle->IsArrayBuffer()) {
-    auto buffer = handle.template As<v8::ArrayBuffer>();
-    store = buffer->GetBackingStore();
-    byteLength = buffer->ByteLength();
+  auto chunks = batch.releaseAsArray();
+  batchSize = 0;
+
+  auto pieces = kj::heapArrayBuilder<kj::ArrayPtr<const kj::byte>>(chunks.size());
+  auto buffers = kj::heapArrayBuilder<jsg::V8Ref<v8::ArrayBuffer>>(chunks.size());
+  for (auto& chunk: chunks) {
+    auto handle = chunk.getHandle(js);
+    // TODO(soon): Once jsg::BufferSource lands and we're able to use it, this can be simplified.
+    KJ_ASSERT(handle->IsArrayBuffer() || handle->IsArrayBufferView());
+    std::shared_ptr<v8::BackingStore> store;
+    size_t byteLength = 0;
+    size_t byteOffset = 0;
+    if (handle->IsArrayBuffer()) {
+      auto buffer = handle.template As<v8::ArrayBuffer>();
+      store = buffer->GetBackingStore();
+      byteLength = buffer->ByteLength();
+    } else {
+      auto view = handle.template As<v8::ArrayBufferView>();
+      store = view->Buffer()->GetBackingStore();
+      byteLength = view->ByteLength();
+      byteOffset = view->ByteOffset();
+    }
+    kj::byte* data = reinterpret_cast<kj::byte*>(store->Data()) + byteOffset;
+    pieces.add(data, byteLength);
+    buffers.add(js.v8Ref(v8::ArrayBuffer::New(js.v8Isolate, store)));
+  }
+
+  kj::Promise<void> promise = nullptr;
+  if (pieces.size() == 1) {
+    promise = writable->sink->write(pieces[0]);
   } else {
-    auto view = handle.template As<v8::ArrayBufferView>();
-    store = view->Buffer()->GetBackingStore();
-    byteLength = view->ByteLength();
-    byteOffset = view->ByteOffset();
-  }
-  kj::byte* data = reinterpret_cast<kj::byte*>(store->Data()) + byteOffset;
-  // TODO(cleanup): Have this method accept a jsg::Lock& from the caller instead of using
-  // v8::Isolate::GetCurrent();
-  jsg::Lock& js = jsg::Lock::from(v8::Isolate::GetCurrent());
+    auto piecesArray = pieces.finish();
+    promise = writable->sink->write(piecesArray).attach(kj::mv(piecesArray));
+  }
   return IoContext::current().awaitIo(js,
-      writable->canceler.wrap(writable->sink->write(kj::arrayPtr(data, byteLength)))
-          .attach(js.v8Ref(v8::ArrayBuffer::New(js.v8Isolate, store))),
-      [](jsg::Lock&) {});
+      writable->canceler.wrap(kj::mv(promise)).attach(buffers.finish()), [](jsg::Lock&) {});
 }
 
 jsg::Promise<void> WritableStreamInternalController::Pipe::pipeLoop(jsg::Lock& js) {
@@ -1860,17 +1969,32 @@ jsg::Promise<void> WritableStreamInternalController::Pipe::pipeLoop(jsg::Lock& j
   // the internal, more efficient kj pipe (which means it is a JavaScript-backed ReadableStream).
   // We need to call read() on the source which returns a JavaScript Promise, wait on it to resolve,
   // then call write() which returns a kj::Promise. Before each iteration we check to see if either
-  // the source or the destination have errored or closed and handle accordingly. At some point we
-  // should explore if there are ways of making this more efficient. For the most part, however,
-  // every read from the source must call into JavaScript to advance the ReadableStream.
-
-  auto& ioContext = IoContext::current();
+  // the source or the destination have errored or closed and handle accordingly. Every read from
+  // the source must call into JavaScript to advance the ReadableStream, but when the source
+  // already has chunks queued we read several of them before writing (see read()), so that the
+  // write and the trip through the kj event loop that comes with it are paid once per batch.
 
   if (checkSignal(js)) {
     // If the signal is triggered, checkSignal will handle erroring the source and destination.
     return js.resolvedPromise();
   }
 
+  if (!batch.empty()) {
+    // Chunks read ahead of the last write still have to reach the sink before we act on the
+    // state of the source. If the destination is no longer writable they are dropped, as they
+    // would have been had they already been handed to the sink.
+    if (parent.state.is<IoOwn<Writable>>()) {
+      return write(js).then(js, [this](jsg::Lock& js) -> jsg::Promise<void> {
+        return pipeLoop(js);
+      }, [this](jsg::Lock& js, jsg::Value reason) -> jsg::Promise<void> {
+        parent.doError(js, reason.getHandle(js));
+        return pipeLoop(js);
+      });
+    }
+    batch.clear();
+    batchSize = 0;
+  }
+
   // Here we check the closed and errored states of both the source and the destination,
   // propagating those states to the other based on the options. This check must be
   // performed at the start of each iteration in the pipe loop.
@@ -1937,11 +2061,24 @@ jsg::Promise<void> WritableStreamInternalController::Pipe::pipeLoop(jsg::Lock& j
     return js.rejectedPromise<void>(destClosed);
   }
 
+  return read(js);
+}
+
+jsg::Promise<void> WritableStreamInternalController::Pipe::read(jsg::Lock& js) {
+  auto& ioContext = IoContext::current();
   return source.read(js).then(js,
       ioContext.addFunctor([this](jsg::Lock& js, ReadResult result) -> jsg::Promise<void> {
-    if (checkSignal(js) || result.done) {
+    if (checkSignal(js)) {
       return js.resolvedPromise();
     }
+    if (result.done) {
+      // Anything read ahead is flushed by the next iteration, which will then find the source
+      // closed.
+      if (batch.empty()) {
+        return js.resolvedPromise();
+      }
+      return pipeLoop(js);
+    }
 
     // WritableStreamInternalControllers only support byte data. If we can't
     // interpret the result.value as bytes, then we error the pipe; otherwise
@@ -1949,7 +2086,16 @@ jsg::Promise<void> WritableStreamInternalController::Pipe::pipeLoop(jsg::Lock& j
     KJ_IF_SOME(value, result.value) {
       auto handle = value.getHandle(js);
       if (handle->IsArrayBuffer() || handle->IsArrayBufferView()) {
-        return write(handle).then(js, [this](jsg::Lock& js) -> jsg::Promise<void> {
+        batchSize += handle->IsArrayBuffer() ? handle.As<v8::ArrayBuffer>()->ByteLength()
+                                             : handle.As<v8::ArrayBufferView>()->ByteLength();
+        batch.add(kj::mv(value));
+        if (batchSize < MAX_BATCH_SIZE && source.hasBufferedData()) {
+          // The next read is fulfilled from the source's queue, within this same turn of the
+          // event loop, so keep reading and write the chunks together. The state of the source
+          // and destination is checked once the batch is written.
+          return read(js);
+        }
+        return write(js).then(js, [this](jsg::Lock& js) -> jsg::Promise<void> {
           // The signal will be checked again at the start of the next loop iteration.
           return pipeLoop(js);
         }, [this](jsg::Lock& js, jsg::Value reason) -> jsg::Promise<void> {
@@ -2011,6 +2157,9 @@ void WritableStreamInternalController::visitForGc(jsg::GcVisitor& visitor) {
       }
       KJ_CASE_ONEOF(pipe, Pipe) {
         visitor.visit(pipe.maybeSignal, pipe.promise);
+        for (auto& chunk: pipe.batch) {
+          visitor.visit(chunk);
+        }
       }
     }
   }
@@ -2085,6 +2234,11 @@ jsg::Promise<ReadResult> ReadableStreamInternalController::PipeLocked::read(jsg:
   return KJ_ASSERT_NONNULL(inner.read(js, kj::none));
 }
 
+bool ReadableStreamInternalController::PipeLocked::hasBufferedData() {
+  // Reads from a ReadableStreamSource always wait on the source.
+  return false;
+}
+
 jsg::Promise<jsg::BufferSource> ReadableStreamInternalController::readAllBytes(
     jsg::Lock& js, uint64_t limit) {
   if (isLockedToReader()) {
@@ -2106,9 +2260,36 @@ jsg::Promise<jsg::BufferSource> ReadableStreamInternalController::readAllBytes(
     KJ_CASE_ONEOF(readable, Readable) {
       auto source = KJ_ASSERT_NONNULL(removeSource(js));
       auto& context = IoContext::current();
-      // TODO(perf): v8 sandboxing will require that backing stores are allocated within
-      // the sandbox. This will require a change to the API of ReadableStreamSource::readAllBytes.
-      // For now, we'll read and allocate into a proper backing store.
+
+      KJ_IF_SOME(length, source->tryGetLength(StreamEncoding::IDENTITY)) {
+        if (length > 0 && length < limit) {
+          // We know how big the body should be, so allocate the result in V8 memory up front and
+          // have the source read straight into it. The I/O side holds its own reference to the
+          // backing store since it writes into it outside of the isolate lock.
+          auto backing = jsg::BackingStore::alloc<v8::ArrayBuffer>(js, length);
+          auto dest = backing.asArrayPtr();
+          auto promise = source->readAllBytesInto(dest, limit)
+                             .attach(kj::mv(source), backing.getTypedView<v8::ArrayBuffer>());
+          return context.awaitIoLegacy(js, kj::mv(promise))
+              .then(js,
+                  [backing = kj::mv(backing)](jsg::Lock& js,
+                      ReadableStreamSource::ReadAllIntoResult result) mutable -> jsg::BufferSource {
+            if (result.amount == backing.size() && result.overflow.size() == 0) {
+              return jsg::BufferSource(js, kj::mv(backing));
+            }
+            // The stream did not produce the length it advertised, so we have to copy after all.
+            auto resized = jsg::BackingStore::alloc<v8::ArrayBuffer>(
+                js, result.amount + result.overflow.size());
+            auto out = resized.asArrayPtr();
+            out.first(result.amount).copyFrom(backing.asArrayPtr().first(result.amount));
+            out.slice(result.amount).copyFrom(result.overflow);
+            return jsg::BufferSource(js, kj::mv(resized));
+          });
+        }
+      }
+
+      // Without a known length we read into KJ memory and copy once into a backing store of the
+      // final size.
       return context.awaitIoLegacy(js, source->readAllBytes(limit).attach(kj::mv(source)))
           .then(js, [](jsg::Lock& js, kj::Array<kj::byte> bytes) -> jsg::BufferSource {
         auto backing = jsg::BackingStore::alloc<v8::ArrayBuffer>(js, bytes.size());
@@ -2178,8 +2359,14 @@ kj::Promise<DeferredProxy<void>> ReadableStreamInternalController::pumpTo(
 
     Holder(kj::Own<WritableStreamSink> sink, kj::Own<ReadableStreamSource> source)
         : sink(kj::mv(sink)),
-          source(kj::mv(source)) {}
+          source(kj::mv(source)) {
+      // The holder lives as long as the pump, including any part of it deferred past the
+      // IoContext, so the pump's slice goes on a track of its own.
+      TRACE_EVENT_BEGIN(
+          "workerd.streams", "ReadableStream pump", PERFETTO_TRACK_FROM_POINTER(this));
+    }
     ~Holder() noexcept(false) {
+      TRACE_EVENT_END("workerd.streams", PERFETTO_TRACK_FROM_POINTER(this));
       if (!done) {
         // It appears the pump was canceled. We should make sure this propagates back to the
         // source stream. This is important in particular when we're implementing the response
@@ -2225,38 +2412,26 @@ StreamEncoding ReadableStreamInternalController::getPreferredEncoding() {
 
 kj::Promise<size_t> IdentityTransformStreamImpl::tryRead(
     void* buffer, size_t minBytes, size_t maxBytes) {
-  size_t total = 0;
-  while (total < minBytes) {
-    // TODO(perf): tryReadInternal was written assuming minBytes would always be 1 but we've now
-    // introduced an API for user to specify a larger minBytes. For now, this is implemented as a
-    // naiive loop dispatching to the 1 byte version but would be better to bake it deeper into
-    // the implementation where it can be more efficient.
-    auto amount = co_await tryReadInternal(buffer, maxBytes);
-    KJ_ASSERT(amount <= maxBytes);
-    if (amount == 0) {
-      // EOF.
-      break;
-    }
-
-    total += amount;
-    buffer = reinterpret_cast<char*>(buffer) + amount;
-    maxBytes -= amount;
+  if (minBytes == 0) {
+    return size_t(0);
   }
-
-  co_return total;
+  KJ_ASSERT(minBytes <= maxBytes);
+  return tryReadInternal(buffer, minBytes, maxBytes);
 }
 
-kj::Promise<size_t> IdentityTransformStreamImpl::tryReadInternal(void* buffer, size_t maxBytes) {
-  auto promise = readHelper(kj::arrayPtr(static_cast<kj::byte*>(buffer), maxBytes));
+kj::Promise<size_t> IdentityTransformStreamImpl::tryReadInternal(
+    void* buffer, size_t minBytes, size_t maxBytes) {
+  auto promise = readHelper(kj::arrayPtr(static_cast<kj::byte*>(buffer), maxBytes), minBytes);
 
   KJ_IF_SOME(l, limit) {
-    promise = promise.then([this, &l = l](size_t amount) -> kj::Promise<size_t> {
+    promise = promise.then([this, &l = l, minBytes](size_t amount) -> kj::Promise<size_t> {
       if (amount > l) {
         auto exception = JSG_KJ_EXCEPTION(
             FAILED, TypeError, "Attempt to write too many bytes through a FixedLengthStream.");
         cancel(exception);
         return kj::mv(exception);
-      } else if (amount == 0 && l != 0) {
+      } else if (amount < minBytes && amount != l) {
+        // A short read means the writable side has closed.
         auto exception = JSG_KJ_EXCEPTION(
             FAILED, TypeError, "FixedLengthStream did not see all expected bytes before close().");
         cancel(exception);
@@ -2369,35 +2544,42 @@ void IdentityTransformStreamImpl::abort(kj::Exception reason) {
   // TODO(conform): Proactively put ReadableStream into Errored state.
 }
 
-kj::Promise<size_t> IdentityTransformStreamImpl::readHelper(kj::ArrayPtr<kj::byte> bytes) {
+kj::Promise<size_t> IdentityTransformStreamImpl::readHelper(
+    kj::ArrayPtr<kj::byte> bytes, size_t minBytes) {
   KJ_SWITCH_ONEOF(state) {
     KJ_CASE_ONEOF(idle, Idle) {
       // No outstanding write request, switch to ReadRequest state.
 
       auto paf = kj::newPromiseAndFulfiller<size_t>();
-      state = ReadRequest{bytes, kj::mv(paf.fulfiller)};
+      state = ReadRequest{bytes, minBytes, 0, kj::mv(paf.fulfiller)};
       return kj::mv(paf.promise);
     }
     KJ_CASE_ONEOF(request, ReadRequest) {
       KJ_FAIL_ASSERT("read operation already in flight");
     }
     KJ_CASE_ONEOF(request, WriteRequest) {
-      if (bytes.size() >= request.bytes.size()) {
-        // The write buffer will entirely fit into our read buffer; fulfill both requests.
-        memcpy(bytes.begin(), request.bytes.begin(), request.bytes.size());
-        auto result = request.bytes.size();
-        request.fulfiller->fulfill();
+      if (bytes.size() < request.bytes.size()) {
+        // The write buffer won't quite fit into our read buffer; fulfill only the read request.
+        memcpy(bytes.begin(), request.bytes.begin(), bytes.size());
+        request.bytes = request.bytes.slice(bytes.size(), request.bytes.size());
+        return bytes.size();
+      }
 
-        // Switch to idle state.
-        state = Idle();
+      // The write buffer will entirely fit into our read buffer; fulfill the write request.
+      memcpy(bytes.begin(), request.bytes.begin(), request.bytes.size());
+      auto result = request.bytes.size();
+      request.fulfiller->fulfill();
 
+      if (result >= minBytes) {
+        // That was enough to satisfy the read, too. Switch to idle state.
+        state = Idle();
         return result;
       }
 
-      // The write buffer won't quite fit into our read buffer; fulfill only the read request.
-      memcpy(bytes.begin(), request.bytes.begin(), bytes.size());
-      request.bytes = request.bytes.slice(bytes.size(), request.bytes.size());
-      return bytes.size();
+      // Wait for further writes to fill in the rest of the read.
+      auto paf = kj::newPromiseAndFulfiller<size_t>();
+      state = ReadRequest{bytes, minBytes, result, kj::mv(paf.fulfiller)};
+      return kj::mv(paf.promise);
     }
     KJ_CASE_ONEOF(exception, kj::Exception) {
       return kj::cp(exception);
@@ -2439,25 +2621,30 @@ kj::Promise<void> IdentityTransformStreamImpl::writeHelper(kj::ArrayPtr<const kj
       }
 
       if (bytes.size() == 0) {
-        // This is a close operation.
-        request.fulfiller->fulfill(size_t(0));
+        // This is a close operation. Hand over whatever was already filled in.
+        request.fulfiller->fulfill(kj::cp(request.filled));
         state = StreamStates::Closed();
         return kj::READY_NOW;
       }
 
-      KJ_ASSERT(request.bytes.size() > 0);
-
-      if (request.bytes.size() >= bytes.size()) {
-        // Our write buffer will entirely fit into the read buffer; fulfill both requests.
-        memcpy(request.bytes.begin(), bytes.begin(), bytes.size());
-        request.fulfiller->fulfill(bytes.size());
-        state = Idle();
+      auto space = request.bytes.slice(request.filled, request.bytes.size());
+      KJ_ASSERT(space.size() > 0);
+
+      if (space.size() >= bytes.size()) {
+        // Our write buffer will entirely fit into the read buffer; fulfill the write request, and
+        // the read request too if it now has enough bytes.
+        memcpy(space.begin(), bytes.begin(), bytes.size());
+        request.filled += bytes.size();
+        if (request.filled >= request.minBytes) {
+          request.fulfiller->fulfill(kj::cp(request.filled));
+          state = Idle();
+        }
         return kj::READY_NOW;
       }
 
       // Our write buffer won't quite fit into the read buffer; fulfill only the read request.
-      memcpy(request.bytes.begin(), bytes.begin(), request.bytes.size());
-      bytes = bytes.slice(request.bytes.size(), bytes.size());
+      memcpy(space.begin(), bytes.begin(), space.size());
+      bytes = bytes.slice(space.size(), bytes.size());
       request.fulfiller->fulfill(request.bytes.size());
 
       auto paf = kj::newPromiseAndFulfiller<void>();
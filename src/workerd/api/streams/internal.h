@@ -58,6 +58,10 @@ class ReadableStreamInternalController: public ReadableStreamController {
     return true;
   }
 
+  bool isInternal() const override {
+    return true;
+  }
+
   kj::Maybe<jsg::Promise<ReadResult>> read(
       jsg::Lock& js, kj::Maybe<ByobOptions> byobOptions) override;
 
@@ -143,6 +147,8 @@ class ReadableStreamInternalController: public ReadableStreamController {
 
     jsg::Promise<ReadResult> read(jsg::Lock& js) override;
 
+    bool hasBufferedData() override;
+
     void visitForGc(jsg::GcVisitor& visitor) {
       visitor.visit(ref);
     }
@@ -343,9 +349,18 @@ class WritableStreamInternalController: public WritableStreamController {
     bool preventCancel;
     kj::Maybe<jsg::Ref<AbortSignal>> maybeSignal;
 
+    // Chunks read from the source but not yet written to the sink. When the source has more
+    // chunks queued, the pipe reads ahead up to MAX_BATCH_SIZE bytes so they can be written to
+    // the sink with one write rather than one write (and one trip through the event loop) each.
+    kj::Vector<jsg::Value> batch;
+    size_t batchSize = 0;
+
+    static constexpr size_t MAX_BATCH_SIZE = 64 * 1024;
+
     bool checkSignal(jsg::Lock& js);
     jsg::Promise<void> pipeLoop(jsg::Lock& js);
-    jsg::Promise<void> write(v8::Local<v8::Value> value);
+    jsg::Promise<void> read(jsg::Lock& js);
+    jsg::Promise<void> write(jsg::Lock& js);
 
     JSG_MEMORY_INFO(Pipe) {
       tracker.trackField("resolver", promise);
@@ -407,7 +422,7 @@ class IdentityTransformStreamImpl: public kj::Refcounted,
 
   kj::Promise<size_t> tryRead(void* buffer, size_t minBytes, size_t maxBytes) override;
 
-  kj::Promise<size_t> tryReadInternal(void* buffer, size_t maxBytes);
+  kj::Promise<size_t> tryReadInternal(void* buffer, size_t minBytes, size_t maxBytes);
 
   kj::Promise<DeferredProxy<void>> pumpTo(WritableStreamSink& output, bool end) override;
 
@@ -426,7 +441,7 @@ class IdentityTransformStreamImpl: public kj::Refcounted,
   void abort(kj::Exception reason) override;
 
  private:
-  kj::Promise<size_t> readHelper(kj::ArrayPtr<kj::byte> bytes);
+  kj::Promise<size_t> readHelper(kj::ArrayPtr<kj::byte> bytes, size_t minBytes);
 
   kj::Promise<void> writeHelper(kj::ArrayPtr<const kj::byte> bytes);
 
@@ -437,6 +452,13 @@ class IdentityTransformStreamImpl: public kj::Refcounted,
     // WARNING: `bytes` may be invalid if fulfiller->isWaiting() returns false! (This indicates the
     //   read was canceled.)
 
+    size_t minBytes;
+    // The read is only fulfilled once at least this many bytes have been filled in (or the stream
+    // closes), so that several small writes can complete one large read in a single step.
+
+    size_t filled = 0;
+    // Number of bytes at the start of `bytes` already filled in by previous writes.
+
     kj::Own<kj::PromiseFulfiller<size_t>> fulfiller;
   };
 
@@ -265,6 +265,40 @@ KJ_TEST("ValueQueue with multiple consumers") {
   });
 }
 
+KJ_TEST("ValueQueue size follows the consumer with the most data") {
+  preamble([](jsg::Lock& js) {
+    ValueQueue queue(10);
+
+    ValueQueue::Consumer consumer1(queue);
+    auto consumer2 = kj::heap<ValueQueue::Consumer>(queue);
+    queue.push(js, getEntry(js, 2));
+    ValueQueue::Consumer consumer3(queue);
+    queue.push(js, getEntry(js, 3));
+
+    KJ_ASSERT(consumer1.size() == 5);
+    KJ_ASSERT(consumer2->size() == 5);
+    KJ_ASSERT(consumer3.size() == 3);
+    KJ_ASSERT(queue.size() == 5);
+
+    // Another consumer still has 5.
+    consumer1.reset();
+    KJ_ASSERT(queue.size() == 5);
+
+    // Removing the largest consumer leaves the next largest.
+    consumer2 = nullptr;
+    KJ_ASSERT(queue.size() == 3);
+
+    // A clone starts out with the same buffered data, and a canceled consumer no longer counts.
+    auto clone = consumer3.clone(js);
+    consumer3.cancel(js, kj::none);
+    KJ_ASSERT(queue.size() == 3);
+
+    clone->reset();
+    KJ_ASSERT(queue.size() == 0);
+    KJ_ASSERT(queue.desiredSize() == 10);
+  });
+}
+
 KJ_TEST("ValueQueue consumer with multiple-reads") {
   preamble([](jsg::Lock& js) {
     ValueQueue queue(2);
@@ -1199,6 +1233,59 @@ KJ_TEST("ByteQueue with multiple default consumers with atLeast (different rate)
   });
 }
 
+KJ_TEST("ByteQueue coalesces small chunks") {
+  preamble([](jsg::Lock& js) {
+    ByteQueue queue(2, ByteQueue::CoalescingPolicy{.maxChunkSize = 4, .bufferSize = 8});
+
+    ByteQueue::Consumer consumer(queue);
+
+    const auto push = [&](kj::StringPtr chars) {
+      auto store = jsg::BackingStore::alloc(js, chars.size());
+      memcpy(store.asArrayPtr().begin(), chars.begin(), chars.size());
+      queue.push(js, kj::heap<ByteQueue::Entry>(jsg::BufferSource(js, kj::mv(store))));
+    };
+
+    // The first four fill a coalescing buffer, the rest start another one.
+    for (auto chunk: {"ab"_kj, "cd"_kj, "ef"_kj, "gh"_kj, "ij"_kj, "kl"_kj}) {
+      push(chunk);
+    }
+    // Too large to be coalesced.
+    push("mnopq"_kj);
+    push("r"_kj);
+
+    KJ_ASSERT(consumer.size() == 18);
+    KJ_ASSERT(queue.size() == 18);
+
+    // A clone gets its own copy of the coalesced data.
+    auto clone = consumer.clone(js);
+    push("s"_kj);
+    KJ_ASSERT(consumer.size() == 19);
+    KJ_ASSERT(clone->size() == 19);
+
+    const auto expectRead = [&](ByteQueue::Consumer& c, kj::StringPtr expected) {
+      auto prp = js.newPromiseAndResolver<ReadResult>();
+      c.read(js,
+          ByteQueue::ReadRequest(kj::mv(prp.resolver),
+              {
+                .store = jsg::BufferSource(js, jsg::BackingStore::alloc(js, 32)),
+              }));
+      prp.promise.then(js, [expected = kj::str(expected)](jsg::Lock& js, ReadResult&& result) {
+        KJ_ASSERT(!result.done);
+        jsg::BufferSource source(js, KJ_ASSERT_NONNULL(result.value).getHandle(js));
+        KJ_ASSERT(source.asArrayPtr() == expected.asBytes());
+      });
+    };
+    expectRead(consumer, "abcdefghijklmnopqrs"_kj);
+    expectRead(*clone, "abcdefghijklmnopqrs"_kj);
+
+    js.runMicrotasks();
+
+    KJ_ASSERT(consumer.size() == 0);
+    KJ_ASSERT(clone->size() == 0);
+    KJ_ASSERT(queue.size() == 0);
+  });
+}
+
 #pragma endregion ByteQueue Tests
 
 }  // namespace
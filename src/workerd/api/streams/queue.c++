@@ -308,16 +308,57 @@ kj::Own<ByteQueue::ByobRequest> ByteQueue::ReadRequest::makeByobReadRequest(
 
 ByteQueue::Entry::Entry(jsg::BufferSource store): store(kj::mv(store)) {}
 
+ByteQueue::Entry::Entry(size_t capacity)
+    : store(Coalesced{.buffer = kj::heapArray<kj::byte>(capacity)}) {}
+
 kj::ArrayPtr<kj::byte> ByteQueue::Entry::toArrayPtr() {
-  return store.asArrayPtr();
+  KJ_SWITCH_ONEOF(store) {
+    KJ_CASE_ONEOF(source, jsg::BufferSource) {
+      return source.asArrayPtr();
+    }
+    KJ_CASE_ONEOF(coalesced, Coalesced) {
+      return coalesced.buffer.first(coalesced.size);
+    }
+  }
+  KJ_UNREACHABLE;
 }
 
 size_t ByteQueue::Entry::getSize() const {
-  return store.size();
+  KJ_SWITCH_ONEOF(store) {
+    KJ_CASE_ONEOF(source, jsg::BufferSource) {
+      return source.size();
+    }
+    KJ_CASE_ONEOF(coalesced, Coalesced) {
+      return coalesced.size;
+    }
+  }
+  KJ_UNREACHABLE;
+}
+
+bool ByteQueue::Entry::tryAppend(kj::ArrayPtr<const kj::byte> data) {
+  KJ_IF_SOME(coalesced, store.tryGet<Coalesced>()) {
+    if (coalesced.buffer.size() - coalesced.size >= data.size()) {
+      std::copy(data.begin(), data.end(), coalesced.buffer.begin() + coalesced.size);
+      coalesced.size += data.size();
+      return true;
+    }
+  }
+  return false;
 }
 
 kj::Own<ByteQueue::Entry> ByteQueue::Entry::clone(jsg::Lock& js) {
-  return kj::heap<ByteQueue::Entry>(store.clone(js));
+  KJ_SWITCH_ONEOF(store) {
+    KJ_CASE_ONEOF(source, jsg::BufferSource) {
+      return kj::heap<ByteQueue::Entry>(source.clone(js));
+    }
+    KJ_CASE_ONEOF(coalesced, Coalesced) {
+      // A coalescing entry belongs to a single consumer, so the clone gets its own copy.
+      auto entry = kj::heap<ByteQueue::Entry>(coalesced.buffer.size());
+      KJ_ASSERT(entry->tryAppend(coalesced.buffer.first(coalesced.size)));
+      return kj::mv(entry);
+    }
+  }
+  KJ_UNREACHABLE;
 }
 
 void ByteQueue::Entry::visitForGc(jsg::GcVisitor& visitor) {}
@@ -536,7 +577,15 @@ v8::Local<v8::Uint8Array> ByteQueue::ByobRequest::getView(jsg::Lock& js) {
 
 #pragma endregion ByteQueue::ByobRequest
 
-ByteQueue::ByteQueue(size_t highWaterMark): impl(highWaterMark) {}
+ByteQueue::ByteQueue(size_t highWaterMark, kj::Maybe<CoalescingPolicy> coalescingPolicy)
+    : impl(highWaterMark) {
+  KJ_IF_SOME(policy, coalescingPolicy) {
+    KJ_REQUIRE(policy.bufferSize >= policy.maxChunkSize * 2);
+  }
+  KJ_IF_SOME(state, impl.getState()) {
+    state.coalescingPolicy = coalescingPolicy;
+  }
+}
 
 void ByteQueue::close(jsg::Lock& js) {
   KJ_IF_SOME(ready, impl.state.tryGet<ByteQueue::QueueImpl::Ready>()) {
@@ -579,8 +628,38 @@ size_t ByteQueue::size() const {
 
 void ByteQueue::handlePush(
     jsg::Lock& js, ConsumerImpl::Ready& state, QueueImpl& queue, kj::Own<Entry> newEntry) {
+  // Copies `data` into the last buffered entry per the queue's coalescing policy, if any.
+  const auto tryCoalesce = [&](kj::ArrayPtr<const kj::byte> data) {
+    KJ_IF_SOME(queueState, queue.getState()) {
+      KJ_IF_SOME(policy, queueState.coalescingPolicy) {
+        if (data.size() > policy.maxChunkSize || state.buffer.empty()) {
+          return false;
+        }
+        KJ_IF_SOME(last, state.buffer.back().tryGet<QueueEntry>()) {
+          if (last.entry->tryAppend(data)) {
+            return true;
+          }
+          auto lastData = last.entry->toArrayPtr().slice(last.offset);
+          if (lastData.size() <= policy.maxChunkSize) {
+            // Both are small, so replace the last entry with a coalescing one holding both.
+            auto coalesced = kj::heap<Entry>(policy.bufferSize);
+            KJ_ASSERT(coalesced->tryAppend(lastData));
+            KJ_ASSERT(coalesced->tryAppend(data));
+            last = QueueEntry{.entry = kj::mv(coalesced), .offset = 0};
+            return true;
+          }
+        }
+      }
+    }
+    return false;
+  };
+
   const auto bufferData = [&](size_t offset) {
-    state.queueTotalSize += newEntry->getSize() - offset;
+    auto data = newEntry->toArrayPtr().slice(offset);
+    state.queueTotalSize += data.size();
+    if (tryCoalesce(data)) {
+      return;
+    }
     state.buffer.emplace_back(QueueEntry{
       .entry = kj::mv(newEntry),
       .offset = offset,
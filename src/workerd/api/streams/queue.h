@@ -202,11 +202,31 @@ class QueueImpl final {
     totalQueueSize = 0;
     KJ_IF_SOME(ready, state.template tryGet<Ready>()) {
       for (auto consumer: ready.consumers) {
-        totalQueueSize = kj::max(totalQueueSize, consumer->size());
+        updateConsumerSize(*consumer);
       }
     }
   }
 
+  // Updates the queue size after the given consumer's buffer size has changed. The sizes of
+  // all consumers are kept in sorted order, so this doesn't need to poll every consumer the way
+  // maybeUpdateBackpressure() does. That matters when a stream has been tee()'d many times,
+  // since every chunk changes the buffer size of every consumer.
+  void updateConsumerSize(ConsumerImpl& consumer) {
+    KJ_IF_SOME(ready, state.template tryGet<Ready>()) {
+      auto newSize = consumer.size();
+      if (newSize != consumer.reportedSize) {
+        auto iter = ready.consumerSizes.find(consumer.reportedSize);
+        KJ_ASSERT(iter != ready.consumerSizes.end());
+        ready.consumerSizes.erase(iter);
+        ready.consumerSizes.insert(newSize);
+        consumer.reportedSize = newSize;
+      }
+      totalQueueSize = *ready.consumerSizes.rbegin();
+    } else {
+      totalQueueSize = 0;
+    }
+  }
+
   // Forwards the entry to all consumers (except skipConsumer if given).
   // For each consumer, the entry will be used to fulfill any pending consume operations.
   // If the entry type is byteOriented and has not been fully consumed by pending consume
@@ -284,6 +304,10 @@ class QueueImpl final {
 
   struct Ready final: public State {
     std::set<ConsumerImpl*> consumers;
+
+    // The buffer size of each consumer in `consumers`, as last reported to
+    // updateConsumerSize(). The largest is the queue size.
+    std::multiset<size_t> consumerSizes;
   };
 
   size_t highWaterMark;
@@ -293,13 +317,17 @@ class QueueImpl final {
   void addConsumer(ConsumerImpl* consumer) {
     KJ_IF_SOME(ready, state.template tryGet<Ready>()) {
       ready.consumers.insert(consumer);
+      ready.consumerSizes.insert(consumer->reportedSize);
     }
   }
 
   void removeConsumer(ConsumerImpl* consumer) {
     KJ_IF_SOME(ready, state.template tryGet<Ready>()) {
       ready.consumers.erase(consumer);
-      maybeUpdateBackpressure();
+      auto iter = ready.consumerSizes.find(consumer->reportedSize);
+      KJ_ASSERT(iter != ready.consumerSizes.end());
+      ready.consumerSizes.erase(iter);
+      totalQueueSize = ready.consumerSizes.empty() ? 0 : *ready.consumerSizes.rbegin();
     }
   }
 
@@ -324,11 +352,23 @@ class ConsumerImpl final {
   // updated.
   struct UpdateBackpressureScope final {
     QueueImpl& queue;
-    UpdateBackpressureScope(QueueImpl& queue): queue(queue) {};
+    kj::Maybe<ConsumerImpl&> consumer;
+    UpdateBackpressureScope(QueueImpl& queue, ConsumerImpl& consumer)
+        : queue(queue),
+          consumer(consumer) {};
     ~UpdateBackpressureScope() noexcept(false) {
-      queue.maybeUpdateBackpressure();
+      update();
     }
     KJ_DISALLOW_COPY_AND_MOVE(UpdateBackpressureScope);
+
+    // Updates the backpressure now rather than when the scope ends. Must be called before
+    // anything that may destroy the consumer.
+    void update() {
+      KJ_IF_SOME(c, consumer) {
+        queue.updateConsumerSize(c);
+        consumer = kj::none;
+      }
+    }
   };
 
   using ReadRequest = typename Self::ReadRequest;
@@ -355,6 +395,7 @@ class ConsumerImpl final {
       KJ_CASE_ONEOF(closed, Closed) {}
       KJ_CASE_ONEOF(errored, Errored) {}
       KJ_CASE_ONEOF(ready, Ready) {
+        UpdateBackpressureScope scope(queue, *this);
         for (auto& request: ready.readRequests) {
           request.resolveAsDone(js);
         }
@@ -399,7 +440,7 @@ class ConsumerImpl final {
       return;
     }
 
-    UpdateBackpressureScope scope(queue);
+    UpdateBackpressureScope scope(queue, *this);
     Self::handlePush(js, ready, queue, kj::mv(entry));
   }
 
@@ -421,7 +462,7 @@ class ConsumerImpl final {
 
   void reset() {
     KJ_IF_SOME(ready, state.template tryGet<Ready>()) {
-      UpdateBackpressureScope scope(queue);
+      UpdateBackpressureScope scope(queue, *this);
       ready.buffer.clear();
       ready.queueTotalSize = 0;
     }
@@ -471,6 +512,7 @@ class ConsumerImpl final {
         // We copy the buffered state but not the readRequests.
         auto& otherReady = KJ_REQUIRE_NONNULL(other.state.template tryGet<Ready>(),
             "The new consumer should not be closed or errored.");
+        UpdateBackpressureScope scope(other.queue, other);
         otherReady.queueTotalSize = ready.queueTotalSize;
         for (auto& item: ready.buffer) {
           KJ_SWITCH_ONEOF(item) {
@@ -557,6 +599,9 @@ class ConsumerImpl final {
   kj::OneOf<Ready, Closed, Errored> state = Ready();
   kj::Maybe<ConsumerImpl::StateListener&> stateListener;
 
+  // This consumer's size as last reported to the queue; see QueueImpl::updateConsumerSize().
+  size_t reportedSize = 0;
+
   bool isClosing() {
     // Closing state is determined by whether there is a Close sentinel that has been
     // pushed into the end of Ready state buffer.
@@ -580,7 +625,7 @@ class ConsumerImpl final {
   void maybeDrainAndSetState(jsg::Lock& js, kj::Maybe<jsg::Value> maybeReason = kj::none) {
     // If the state is already errored or closed then there is nothing to drain.
     KJ_IF_SOME(ready, state.template tryGet<Ready>()) {
-      UpdateBackpressureScope scope(queue);
+      UpdateBackpressureScope scope(queue, *this);
       KJ_IF_SOME(reason, maybeReason) {
         // If maybeReason != nullptr, then we are draining because of an error.
         // In that case, we want to reset/clear the buffer and reject any remaining
@@ -589,6 +634,7 @@ class ConsumerImpl final {
           request.reject(js, reason);
         }
         state = reason.addRef(js);
+        scope.update();
         KJ_IF_SOME(listener, stateListener) {
           listener.onConsumerError(js, kj::mv(reason));
           // After this point, we should not assume that this consumer can
@@ -613,6 +659,7 @@ class ConsumerImpl final {
             request.resolveAsDone(js);
           }
           state.template init<Closed>();
+          scope.update();
           KJ_IF_SOME(listener, stateListener) {
             listener.onConsumerClose(js);
             // After this point, we should not assume that this consumer can
@@ -626,6 +673,7 @@ class ConsumerImpl final {
 
   friend typename Self::Consumer;
   friend Self;
+  friend QueueImpl;
 };
 
 // ============================================================================
@@ -862,8 +910,23 @@ class ByteQueue final {
     QueueImpl& queue;
   };
 
+  // Producers that enqueue many tiny chunks would otherwise leave each consumer with one buffer
+  // entry per chunk, each drained separately by reads. When a queue has a coalescing policy, a
+  // small chunk pushed into a consumer whose last buffered entry is also small is copied, along
+  // with that entry, into a buffer owned by the consumer, and further small chunks are appended
+  // to that buffer while it has room. Reads already fill from as many entries as they can, so
+  // this doesn't change what reads return.
+  struct CoalescingPolicy {
+    // Chunks of up to this many bytes are coalesced.
+    size_t maxChunkSize = 512;
+
+    // The capacity of the buffers chunks are coalesced into. At least twice maxChunkSize.
+    size_t bufferSize = 4096;
+  };
+
   struct State {
     std::deque<kj::Own<ByobRequest>> pendingByobReadRequests;
+    kj::Maybe<CoalescingPolicy> coalescingPolicy;
 
     JSG_MEMORY_INFO(ByteQueue::State) {
       for (auto& request: pendingByobReadRequests) {
@@ -874,24 +937,45 @@ class ByteQueue final {
 
   // A byte queue entry consists of a jsg::BufferSource containing a non-zero-length
   // sequence of bytes. The size is determined by the number of bytes in the entry.
+  //
+  // An entry may instead hold a buffer that small chunks are coalesced into (see
+  // CoalescingPolicy). Such an entry is only ever held by one consumer, so it can grow as
+  // chunks are appended to it.
   class Entry {
    public:
     explicit Entry(jsg::BufferSource store);
 
+    // Creates an empty coalescing entry with room for `capacity` bytes.
+    explicit Entry(size_t capacity);
+
     kj::ArrayPtr<kj::byte> toArrayPtr();
 
     size_t getSize() const;
 
+    // Appends `data` if this is a coalescing entry with room for it. Returns false otherwise.
+    bool tryAppend(kj::ArrayPtr<const kj::byte> data);
+
     void visitForGc(jsg::GcVisitor& visitor);
 
     kj::Own<Entry> clone(jsg::Lock& js);
 
     JSG_MEMORY_INFO(ByteQueue::Entry) {
-      tracker.trackField("store", store);
+      KJ_SWITCH_ONEOF(store) {
+        KJ_CASE_ONEOF(source, jsg::BufferSource) {
+          tracker.trackField("store", source);
+        }
+        KJ_CASE_ONEOF(coalesced, Coalesced) {
+          tracker.trackFieldWithSize("coalesced", coalesced.buffer.size());
+        }
+      }
     }
 
    private:
-    jsg::BufferSource store;
+    struct Coalesced {
+      kj::Array<kj::byte> buffer;
+      size_t size = 0;
+    };
+    kj::OneOf<jsg::BufferSource, Coalesced> store;
   };
 
   struct QueueEntry {
@@ -945,7 +1029,8 @@ class ByteQueue final {
     ConsumerImpl impl;
   };
 
-  explicit ByteQueue(size_t highWaterMark);
+  explicit ByteQueue(
+      size_t highWaterMark, kj::Maybe<CoalescingPolicy> coalescingPolicy = kj::none);
 
   void close(jsg::Lock& js);
 
@@ -411,6 +411,9 @@ jsg::Promise<void> ReadableStream::pipeTo(jsg::Lock& js,
   }
 
   auto options = kj::mv(maybeOptions).orDefault({});
+  KJ_IF_SOME(promise, destination->tryPipeFromNative(js, *this, options)) {
+    return kj::mv(promise);
+  }
   return getController().pipeTo(js, destination->getController(), kj::mv(options));
 }
 
@@ -9,6 +9,8 @@
 
 #include <workerd/io/features.h>
 #include <workerd/jsg/jsg.h>
+#include <workerd/util/autogate.h>
+#include <workerd/util/use-perfetto-categories.h>
 #include <workerd/util/weak-refs.h>
 
 #include <kj/debug.h>
@@ -128,6 +130,10 @@ class ReadableLockImpl {
 
     jsg::Promise<ReadResult> read(jsg::Lock& js) override;
 
+    bool hasBufferedData() override {
+      return inner.hasBufferedData();
+    }
+
     void visitForGc(jsg::GcVisitor& visitor);
 
     JSG_MEMORY_INFO(PipeLocked) {
@@ -555,6 +561,20 @@ int getHighWaterMark(
   return queuingStrategy.highWaterMark.orDefault(isBytes ? 0 : 1);
 }
 
+template <typename Queue>
+Queue makeQueue(size_t highWaterMark) {
+  return Queue(highWaterMark);
+}
+
+template <>
+ByteQueue makeQueue<ByteQueue>(size_t highWaterMark) {
+  kj::Maybe<ByteQueue::CoalescingPolicy> coalescingPolicy;
+  if (util::Autogate::isEnabled(util::AutogateKey::BYTE_QUEUE_COALESCING)) {
+    coalescingPolicy = ByteQueue::CoalescingPolicy{};
+  }
+  return ByteQueue(highWaterMark, coalescingPolicy);
+}
+
 }  // namespace
 
 // It is possible for the controller state to be released synchronously while
@@ -752,6 +772,9 @@ class ReadableStreamJsController final: public ReadableStreamController {
     return pendingReadCount > 0;
   }
 
+  // True if the consumer has chunks queued, so that a read will be fulfilled immediately.
+  bool hasBufferedData();
+
   friend ReadableLockImpl;
   friend ReadableLockImpl::PipeLocked;
 
@@ -872,7 +895,7 @@ kj::Own<WritableStreamController> newWritableStreamJsController() {
 template <typename Self>
 ReadableImpl<Self>::ReadableImpl(
     UnderlyingSource underlyingSource, StreamQueuingStrategy queuingStrategy)
-    : state(Queue(getHighWaterMark(underlyingSource, queuingStrategy))),
+    : state(makeQueue<Queue>(getHighWaterMark(underlyingSource, queuingStrategy))),
       algorithms(kj::mv(underlyingSource), kj::mv(queuingStrategy)) {}
 
 template <typename Self>
@@ -1725,6 +1748,13 @@ struct ValueReadable final: private api::ValueQueue::ConsumerImpl::StateListener
     return kj::none;
   }
 
+  bool hasBufferedData() {
+    KJ_IF_SOME(s, state) {
+      return !s.consumer->empty();
+    }
+    return false;
+  }
+
   bool canCloseOrEnqueue() {
     return state.map([](State& s) { return s.controller->canCloseOrEnqueue(); }).orDefault(false);
   }
@@ -1882,6 +1912,13 @@ struct ByteReadable final: private api::ByteQueue::ConsumerImpl::StateListener {
     return kj::none;
   }
 
+  bool hasBufferedData() {
+    KJ_IF_SOME(s, state) {
+      return !s.consumer->empty();
+    }
+    return false;
+  }
+
   bool canCloseOrEnqueue() {
     return state.map([](State& s) { return s.controller->canCloseOrEnqueue(); }).orDefault(false);
   }
@@ -2612,6 +2649,27 @@ bool ReadableStreamJsController::hasBackpressure() {
   return false;
 }
 
+bool ReadableStreamJsController::hasBufferedData() {
+  if (maybePendingState != kj::none) {
+    return false;
+  }
+  KJ_SWITCH_ONEOF(state) {
+    KJ_CASE_ONEOF(closed, StreamStates::Closed) {
+      return false;
+    }
+    KJ_CASE_ONEOF(errored, StreamStates::Errored) {
+      return false;
+    }
+    KJ_CASE_ONEOF(consumer, kj::Own<ValueReadable>) {
+      return consumer->hasBufferedData();
+    }
+    KJ_CASE_ONEOF(consumer, kj::Own<ByteReadable>) {
+      return consumer->hasBufferedData();
+    }
+  }
+  KJ_UNREACHABLE;
+}
+
 kj::Maybe<kj::OneOf<DefaultController, ByobController>> ReadableStreamJsController::
     getController() {
   if (maybePendingState != kj::none) {
@@ -2764,10 +2822,14 @@ class PumpToReader {
         state(kj::mv(stream)),
         sink(kj::mv(sink)),
         self(kj::refcounted<WeakRef<PumpToReader>>(kj::Badge<PumpToReader>{}, *this)),
-        end(end) {}
+        end(end) {
+    TRACE_EVENT_BEGIN(
+        "workerd.streams", "ReadableStream JS pump", PERFETTO_TRACK_FROM_POINTER(this));
+  }
   KJ_DISALLOW_COPY_AND_MOVE(PumpToReader);
 
   ~PumpToReader() noexcept(false) {
+    TRACE_EVENT_END("workerd.streams", PERFETTO_TRACK_FROM_POINTER(this));
     self->invalidate();
     // Ensure that if a write promise is pending it is proactively canceled.
     canceler.cancel("PumpToReader was destroyed");
@@ -44,6 +44,75 @@ export const arrayBufferOfReadable = {
   },
 };
 
+export const compressionStreamReuse = {
+  async test() {
+    // Streams hand their contexts back to a pool when they are destroyed, so a later stream may
+    // pick up a context that a previous one left mid-stream. It must behave like a fresh one.
+    const input = new TextEncoder().encode('0123456789'.repeat(1000));
+    const roundTrip = async (format) => {
+      const cs = new CompressionStream(format);
+      const cw = cs.writable.getWriter();
+      await cw.write(input);
+      await cw.close();
+      const compressed = await new Response(cs.readable).arrayBuffer();
+
+      const ds = new DecompressionStream(format);
+      const dw = ds.writable.getWriter();
+      await dw.write(compressed);
+      await dw.close();
+      const output = await new Response(ds.readable).arrayBuffer();
+      assert.deepStrictEqual(new Uint8Array(output), input);
+      return compressed.byteLength;
+    };
+
+    for (const format of ['gzip', 'deflate', 'deflate-raw', 'br']) {
+      // Abandon a stream partway through before reusing its context.
+      const abandoned = new CompressionStream(format).writable.getWriter();
+      await abandoned.write(input);
+      await abandoned.abort();
+
+      const first = await roundTrip(format);
+      assert.strictEqual(await roundTrip(format), first);
+    }
+  },
+};
+
+export const brotliDecompressionStreamErrors = {
+  async test() {
+    const cs = new CompressionStream('br');
+    const cw = cs.writable.getWriter();
+    await cw.write(new TextEncoder().encode('hello'));
+    await cw.close();
+    const compressed = new Uint8Array(await new Response(cs.readable).arrayBuffer());
+
+    // Trailing bytes after the end of the compressed data.
+    {
+      const ds = new DecompressionStream('br');
+      const dw = ds.writable.getWriter();
+      const trailing = new Uint8Array(compressed.length + 1);
+      trailing.set(compressed);
+      dw.write(trailing).catch(() => {});
+      dw.close().catch(() => {});
+      await assert.rejects(new Response(ds.readable).arrayBuffer(), {
+        name: 'TypeError',
+        message: 'Trailing bytes after end of compressed data',
+      });
+    }
+
+    // Closing before the compressed data is complete.
+    {
+      const ds = new DecompressionStream('br');
+      const dw = ds.writable.getWriter();
+      dw.write(compressed.slice(0, 2)).catch(() => {});
+      dw.close().catch(() => {});
+      await assert.rejects(new Response(ds.readable).arrayBuffer(), {
+        name: 'TypeError',
+        message: 'Called close() on a decompression stream with incomplete data',
+      });
+    }
+  },
+};
+
 export const inspect = {
   async test() {
     const inspectOpts = { breakLength: Infinity };
@@ -285,3 +354,37 @@ export const inspect = {
     }
   },
 };
+
+export const pipeQueuedChunksToInternalStream = {
+  async test() {
+    // All of the chunks are queued before the pipe starts, so they are read ahead and written
+    // to the destination in batches. Some are views into a larger buffer, at an offset.
+    const chunkSize = 1000;
+    const chunkCount = 200;
+    const rs = new ReadableStream({
+      start(controller) {
+        for (let i = 0; i < chunkCount; i++) {
+          if (i % 2 == 0) {
+            controller.enqueue(new Uint8Array(chunkSize).fill(i % 256));
+          } else {
+            const buffer = new Uint8Array(chunkSize + 10).fill(255);
+            buffer.fill(i % 256, 5, 5 + chunkSize);
+            controller.enqueue(new Uint8Array(buffer.buffer, 5, chunkSize));
+          }
+        }
+        controller.close();
+      },
+    });
+    const { readable, writable } = new IdentityTransformStream();
+    const [data] = await Promise.all([
+      new Response(readable).arrayBuffer(),
+      rs.pipeTo(writable),
+    ]);
+    const bytes = new Uint8Array(data);
+    assert.strictEqual(bytes.length, chunkSize * chunkCount);
+    for (let i = 0; i < chunkCount; i++) {
+      assert.strictEqual(bytes[i * chunkSize], i % 256);
+      assert.strictEqual(bytes[(i + 1) * chunkSize - 1], i % 256);
+    }
+  },
+};
@@ -332,10 +332,15 @@ class WritableStreamRpcAdapter final: public capnp::ExplicitEndOutputStream {
     return canceler.wrap(getInner().write(pieces));
   }
 
-  // TODO(perf): We can't properly implement tryPumpFrom(), which means that Cap'n Proto will
-  //   be unable to perform path shortening if the underlying stream turns out to be another capnp
-  //   stream. This isn't a huge deal, but might be nice to enable someday. It may require
-  //   significant refactoring of streams.
+  // If the underlying sink is backed by a native stream, hand the pump down to it so Cap'n Proto
+  // can perform path shortening when the sink turns out to be another capnp stream.
+  kj::Maybe<kj::Promise<uint64_t>> tryPumpFrom(
+      kj::AsyncInputStream& input, uint64_t amount) override {
+    KJ_IF_SOME(promise, getInner().tryPumpFromNative(input, amount)) {
+      return canceler.wrap(kj::mv(promise));
+    }
+    return kj::none;
+  }
 
   kj::Promise<void> whenWriteDisconnected() override {
     // TODO(someday): WritableStreamSink doesn't give us a way to implement this.
@@ -481,10 +486,8 @@ class WritableStreamJsRpcAdapter final: public capnp::ExplicitEndOutputStream {
     }));
   }
 
-  // TODO(perf): We can't properly implement tryPumpFrom(), which means that Cap'n Proto will
-  //   be unable to perform path shortening if the underlying stream turns out to be another capnp
-  //   stream. This isn't a huge deal, but might be nice to enable someday. It may require
-  //   significant refactoring of streams.
+  // There is no tryPumpFrom() here: every chunk has to be delivered to the JavaScript writer, so
+  // there is no native path to shorten.
 
   kj::Promise<void> whenWriteDisconnected() override {
     // TODO(soon): We might be able to support this by following the writer.closed promise,
@@ -123,6 +123,15 @@ class WritableStream: public jsg::Object {
       jsg::Lock& js);
   virtual void detach(jsg::Lock& js);
 
+  // Called by ReadableStream::pipeTo() before it falls back to the controller-level pipe. A
+  // subclass that consumes bytes natively can take over the pipe by returning a promise here, for
+  // instance to pump a native source straight into its own state without entering JavaScript per
+  // chunk. Returns kj::none to use the regular pipe.
+  virtual kj::Maybe<jsg::Promise<void>> tryPipeFromNative(
+      jsg::Lock& js, ReadableStream& source, PipeToOptions& options) {
+    return kj::none;
+  }
+
   // ---------------------------------------------------------------------------
   // JS interface
 
@@ -132,6 +132,45 @@ void EncodedAsyncInputStream::ensureIdentityEncoding() {
   }
 }
 
+// =======================================================================================
+// Socket pumps
+
+// Returns true if `stream` is backed directly by a file descriptor, as raw TCP sockets are.
+bool isFdStream(kj::AsyncInputStream& stream) {
+  KJ_IF_SOME(io, kj::dynamicDowncastIfAvailable<kj::AsyncIoStream>(stream)) {
+    return io.getFd() != kj::none;
+  }
+  return false;
+}
+bool isFdStream(kj::AsyncOutputStream& stream) {
+  KJ_IF_SOME(io, kj::dynamicDowncastIfAvailable<kj::AsyncIoStream>(stream)) {
+    return io.getFd() != kj::none;
+  }
+  return false;
+}
+
+// Pumps between two fd-backed streams, as when a Worker proxies one TCP socket into another.
+// The output gets the first chance to optimize the pump, which lets KJ splice() between the
+// descriptors where it can. Otherwise the data is copied through a buffer much larger than the
+// one kj::AsyncInputStream::pumpTo() uses, since proxies are bound on the number of read and write
+// calls rather than on the copying itself. An fd-backed input has no pumpTo() optimizations of its
+// own, so going around it loses nothing.
+kj::Promise<void> pumpBetweenFds(kj::AsyncInputStream& input, kj::AsyncOutputStream& output) {
+  static constexpr size_t BUFFER_SIZE = 64 * 1024;
+
+  KJ_IF_SOME(promise, output.tryPumpFrom(input, kj::maxValue)) {
+    co_await promise;
+    co_return;
+  }
+
+  auto buffer = kj::heapArray<kj::byte>(BUFFER_SIZE);
+  for (;;) {
+    auto amount = co_await input.tryRead(buffer.begin(), 1, buffer.size());
+    if (amount == 0) co_return;
+    co_await output.write(buffer.first(amount));
+  }
+}
+
 // =======================================================================================
 // EncodedAsyncOutputStream
 
@@ -157,6 +196,9 @@ class EncodedAsyncOutputStream final: public WritableStreamSink {
   kj::Maybe<kj::Promise<DeferredProxy<void>>> tryPumpFrom(
       ReadableStreamSource& input, bool end) override;
 
+  kj::Maybe<kj::Promise<uint64_t>> tryPumpFromNative(
+      kj::AsyncInputStream& input, uint64_t amount) override;
+
   kj::Promise<void> end() override;
 
   void abort(kj::Exception reason) override;
@@ -237,7 +279,12 @@ kj::Maybe<kj::Promise<DeferredProxy<void>>> EncodedAsyncOutputStream::tryPumpFro
       nativeInput.ensureIdentityEncoding();
     }
 
-    auto promise = nativeInput.inner->pumpTo(getInner()).ignoreResult();
+    kj::Promise<void> promise = nullptr;
+    if (isFdStream(*nativeInput.inner) && isFdStream(getInner())) {
+      promise = pumpBetweenFds(*nativeInput.inner, getInner());
+    } else {
+      promise = nativeInput.inner->pumpTo(getInner()).ignoreResult();
+    }
     if (end) {
       // TODO(cleanup): When KJ streams are refactored to have a general end(), this stupid switch
       //   can go away.
@@ -267,6 +314,18 @@ kj::Maybe<kj::Promise<DeferredProxy<void>>> EncodedAsyncOutputStream::tryPumpFro
   return kj::none;
 }
 
+kj::Maybe<kj::Promise<uint64_t>> EncodedAsyncOutputStream::tryPumpFromNative(
+    kj::AsyncInputStream& input, uint64_t amount) {
+  if (inner.is<Ended>()) return kj::none;
+
+  // Native input is always in identity encoding.
+  ensureIdentityEncoding();
+
+  // kj::AsyncInputStream::pumpTo() gives the inner stream a chance to tryPumpFrom() itself, so if
+  // it is a capnp stream the path can be shortened further from there.
+  return input.pumpTo(getInner(), amount).attach(ioContext.registerPendingEvent());
+}
+
 StreamEncoding EncodedAsyncOutputStream::disownEncodingResponsibility() {
   StreamEncoding result = encoding;
   encoding = StreamEncoding::IDENTITY;
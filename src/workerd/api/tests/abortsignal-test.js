@@ -160,6 +160,37 @@ export const anyAbort3 = {
   },
 };
 
+export const anyNested = {
+  test() {
+    const ac1 = new AbortController();
+    const ac2 = new AbortController();
+    const inner = AbortSignal.any([ac1.signal, ac2.signal]);
+    // The same source given twice, directly and through `inner`, is only followed once.
+    const outer = AbortSignal.any([inner, ac1.signal, AbortSignal.timeout(1000000)]);
+
+    const order = [];
+    inner.onabort = () => order.push('inner');
+    outer.onabort = () => order.push('outer');
+
+    ac1.abort('boom');
+    strictEqual(inner.aborted, true);
+    strictEqual(outer.aborted, true);
+    strictEqual(inner.reason, 'boom');
+    strictEqual(outer.reason, 'boom');
+    strictEqual(order.join(','), 'inner,outer');
+
+    // Aborting the other source afterwards has no further effect.
+    ac2.abort('later');
+    strictEqual(outer.reason, 'boom');
+    strictEqual(order.length, 2);
+
+    // A dependent signal that is already aborted aborts the result immediately.
+    const after = AbortSignal.any([outer]);
+    strictEqual(after.aborted, true);
+    strictEqual(after.reason, 'boom');
+  },
+};
+
 export const onabortPrototypeProperty = {
   test() {
     const ac = new AbortController();
@@ -27,3 +27,30 @@ export const customthenable = {
     strictEqual(result2, 123);
   },
 };
+
+export const deepnesting = {
+  // Nest more storage scopes than a frame chain holds before it is flattened, and check that
+  // every store stays visible, including across awaits and when a store is shadowed.
+  async test() {
+    const stores = Array.from({ length: 20 }, () => new AsyncLocalStorage());
+
+    async function nest(depth) {
+      if (depth === stores.length) {
+        await Promise.resolve();
+        for (let n = 0; n < stores.length; n++) {
+          strictEqual(stores[n].getStore(), n);
+        }
+        return stores[0].run('shadowed', async () => {
+          await Promise.resolve();
+          strictEqual(stores[0].getStore(), 'shadowed');
+          strictEqual(stores[stores.length - 1].getStore(), stores.length - 1);
+          return 'done';
+        });
+      }
+      return stores[depth].run(depth, () => nest(depth + 1));
+    }
+
+    strictEqual(await nest(0), 'done');
+    strictEqual(stores[0].getStore(), undefined);
+  },
+};
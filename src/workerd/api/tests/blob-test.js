@@ -140,6 +140,32 @@ export default {
   },
 };
 
+export const composeFromBlobs = {
+  async test() {
+    const blob = new Blob(['foobarbaz'], { type: 'text/plain' });
+
+    // Re-wrapping a Blob, or reassembling adjacent slices of it, can share its data.
+    const rewrapped = new Blob([blob], { type: 'application/whatever' });
+    strictEqual(await rewrapped.text(), 'foobarbaz');
+    strictEqual(rewrapped.type, 'application/whatever');
+
+    const reassembled = new Blob(['', blob.slice(0, 3), blob.slice(3, 6).slice(0, 3), '']);
+    strictEqual(await reassembled.text(), 'foobar');
+    strictEqual(reassembled.size, 6);
+
+    // Non-adjacent or repeated slices still produce the right contents.
+    strictEqual(
+      await new Blob([blob.slice(6), blob.slice(0, 3)]).text(),
+      'bazfoo'
+    );
+    strictEqual(await new Blob([blob, blob]).text(), 'foobarbazfoobarbaz');
+
+    const file = new File([blob.slice(3)], 'name.txt');
+    strictEqual(await file.text(), 'barbaz');
+    strictEqual(file.name, 'name.txt');
+  },
+};
+
 export const testInspect = {
   async test(ctrl, env, ctx) {
     const blob = new Blob(['abc'], { type: 'text/plain' });
@@ -94,3 +94,119 @@ export const ecdhJwkTest = {
     );
   },
 };
+
+export const repeatedPublicKeyImportTest = {
+  async test() {
+    // Importing the same public key again is served from the isolate's key cache; each import
+    // still gets its own CryptoKey with the requested properties.
+    const pair = await crypto.subtle.generateKey(
+      { name: 'ECDSA', namedCurve: 'P-256' },
+      true,
+      ['sign', 'verify']
+    );
+    const spki = await crypto.subtle.exportKey('spki', pair.publicKey);
+    const data = new TextEncoder().encode('hello');
+    const signature = await crypto.subtle.sign(
+      { name: 'ECDSA', hash: 'SHA-256' },
+      pair.privateKey,
+      data
+    );
+
+    const importSpki = (extractable) =>
+      crypto.subtle.importKey(
+        'spki',
+        spki,
+        { name: 'ECDSA', namedCurve: 'P-256' },
+        extractable,
+        ['verify']
+      );
+    const verify = (key) =>
+      crypto.subtle.verify(
+        { name: 'ECDSA', hash: 'SHA-256' },
+        key,
+        signature,
+        data
+      );
+
+    const first = await importSpki(false);
+    const second = await importSpki(false);
+    const extractable = await importSpki(true);
+    assert.notStrictEqual(first, second);
+    assert.strictEqual(second.extractable, false);
+    assert.strictEqual(extractable.extractable, true);
+
+    for (const key of [first, second, extractable]) {
+      assert.ok(await verify(key));
+    }
+
+    // Modifying the source buffer after import does not affect the imported key.
+    new Uint8Array(spki).fill(0);
+    assert.ok(await verify(second));
+  },
+};
+
+export const verifyBatchTest = {
+  async test() {
+    const enc = new TextEncoder();
+    const pairs = await Promise.all(
+      [0, 1].map(() =>
+        crypto.subtle.generateKey({ name: 'Ed25519' }, false, [
+          'sign',
+          'verify',
+        ])
+      )
+    );
+    const messages = ['first', 'second', 'third'].map((m) => enc.encode(m));
+    const signatures = await Promise.all(
+      messages.map((data, i) =>
+        crypto.subtle.sign('Ed25519', pairs[i % 2].privateKey, data)
+      )
+    );
+
+    const results = await crypto.subtle.verifyBatch('Ed25519', [
+      { key: pairs[0].publicKey, signature: signatures[0], data: messages[0] },
+      { key: pairs[1].publicKey, signature: signatures[1], data: messages[1] },
+      // Signed by the other key.
+      { key: pairs[1].publicKey, signature: signatures[2], data: messages[2] },
+      // A malformed signature is invalid rather than an error.
+      {
+        key: pairs[0].publicKey,
+        signature: new Uint8Array(3),
+        data: messages[0],
+      },
+    ]);
+    assert.deepStrictEqual(results, [true, true, false, false]);
+
+    assert.deepStrictEqual(await crypto.subtle.verifyBatch('Ed25519', []), []);
+
+    // A key that can't verify rejects the whole batch.
+    await assert.rejects(
+      crypto.subtle.verifyBatch('Ed25519', [
+        {
+          key: pairs[0].privateKey,
+          signature: signatures[0],
+          data: messages[0],
+        },
+      ])
+    );
+
+    const ec = await crypto.subtle.generateKey(
+      { name: 'ECDSA', namedCurve: 'P-256' },
+      false,
+      ['sign', 'verify']
+    );
+    const ecdsa = { name: 'ECDSA', hash: 'SHA-256' };
+    const ecSignature = await crypto.subtle.sign(
+      ecdsa,
+      ec.privateKey,
+      messages[0]
+    );
+    assert.deepStrictEqual(
+      await crypto.subtle.verifyBatch(ecdsa, [
+        { key: ec.publicKey, signature: ecSignature, data: messages[0] },
+        { key: ec.publicKey, signature: ecSignature, data: messages[1] },
+      ]),
+      [true, false]
+    );
+  },
+};
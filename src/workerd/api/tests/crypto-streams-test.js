@@ -159,3 +159,120 @@ export const digestStreamDisposable = {
     stream[Symbol.dispose]();
   },
 };
+
+export const digestStreamPipeFromNative = {
+  async test() {
+    const enc = new TextEncoder();
+    const data = enc.encode('hello there'.repeat(10000));
+    const expected = new Uint8Array(await crypto.subtle.digest('SHA-256', data));
+
+    const stream = new crypto.DigestStream('SHA-256');
+    await new Response(data).body.pipeTo(stream);
+
+    deepStrictEqual(new Uint8Array(await stream.digest), expected);
+    strictEqual(stream.bytesWritten, BigInt(data.byteLength));
+    strictEqual(stream.locked, false);
+
+    // A source that errors rejects both the pipe and the digest.
+    const { readable, writable } = new IdentityTransformStream();
+    const writer = writable.getWriter();
+    writer.write(data.subarray(0, 10)).catch(() => {});
+    writer.abort(new Error('boom')).catch(() => {});
+    const failing = new crypto.DigestStream('SHA-256');
+    await rejects(readable.pipeTo(failing));
+    await rejects(failing.digest);
+  },
+};
+
+async function runCipherStream(stream, data, chunkSize) {
+  const writer = stream.writable.getWriter();
+  async function writeAll() {
+    for (let n = 0; n < data.byteLength; n += chunkSize) {
+      await writer.write(data.slice(n, n + chunkSize));
+    }
+    await writer.close();
+  }
+  const [output] = await Promise.all([
+    new Response(stream.readable).arrayBuffer(),
+    writeAll(),
+  ]);
+  return new Uint8Array(output);
+}
+
+export const cipherStreamAesGcm = {
+  async test() {
+    const key = await crypto.subtle.generateKey(
+      { name: 'AES-GCM', length: 256 },
+      false,
+      ['encrypt', 'decrypt']
+    );
+    const algorithm = {
+      name: 'AES-GCM',
+      iv: crypto.getRandomValues(new Uint8Array(12)),
+      additionalData: new TextEncoder().encode('header'),
+    };
+    const data = new Uint8Array(1000).map((_, i) => i & 0xff);
+    const expected = new Uint8Array(
+      await crypto.subtle.encrypt(algorithm, key, data)
+    );
+
+    const encrypted = await runCipherStream(
+      new crypto.EncryptionStream(algorithm, key),
+      data,
+      7
+    );
+    deepStrictEqual(encrypted, expected);
+
+    // Chunks smaller than the tag exercise the held-back tail.
+    const decrypted = await runCipherStream(
+      new crypto.DecryptionStream(algorithm, key),
+      encrypted,
+      5
+    );
+    deepStrictEqual(decrypted, data);
+
+    // A corrupted tag errors both sides of the stream.
+    encrypted[encrypted.byteLength - 1] ^= 1;
+    const decryption = new crypto.DecryptionStream(algorithm, key);
+    await rejects(runCipherStream(decryption, encrypted, 64));
+
+    throws(() => new crypto.EncryptionStream({ name: 'AES-CBC' }, key));
+  },
+};
+
+export const cipherStreamAesCtr = {
+  async test() {
+    const key = await crypto.subtle.generateKey(
+      { name: 'AES-CTR', length: 128 },
+      false,
+      ['encrypt', 'decrypt']
+    );
+    // The counter is the low 8 bits and wraps after the second block.
+    const counter = new Uint8Array(16);
+    counter[15] = 0xfe;
+    const algorithm = { name: 'AES-CTR', counter, length: 8 };
+    const data = new Uint8Array(1000).map((_, i) => i & 0xff);
+    const expected = new Uint8Array(
+      await crypto.subtle.encrypt(algorithm, key, data)
+    );
+
+    const encrypted = await runCipherStream(
+      new crypto.EncryptionStream(algorithm, key),
+      data,
+      13
+    );
+    deepStrictEqual(encrypted, expected);
+    const decrypted = await runCipherStream(
+      new crypto.DecryptionStream(algorithm, key),
+      encrypted,
+      100
+    );
+    deepStrictEqual(decrypted, data);
+
+    // A 1-bit counter only covers two blocks.
+    const short = { name: 'AES-CTR', counter, length: 1 };
+    await rejects(
+      runCipherStream(new crypto.EncryptionStream(short, key), data, 16)
+    );
+  },
+};
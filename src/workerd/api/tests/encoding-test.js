@@ -658,3 +658,47 @@ export const textDecoderStream = {
     strictEqual(enc.encoding, 'utf-8');
   },
 };
+
+async function transformChunks(stream, chunks) {
+  const writer = stream.writable.getWriter();
+  const writing = (async () => {
+    for (const chunk of chunks) await writer.write(chunk);
+    await writer.close();
+  })();
+  const output = [];
+  for await (const chunk of stream.readable) output.push(chunk);
+  await writing;
+  return output;
+}
+
+export const textEncoderStreamSurrogatePairs = {
+  async test() {
+    // A surrogate pair split across chunks is encoded as one character, and a lone
+    // surrogate as the replacement character. Chunks that encode to nothing are dropped.
+    const output = await transformChunks(new TextEncoderStream(), [
+      'a\uD83D',
+      '\uDE00b',
+      '\uD83D',
+      '',
+      '\uDE00',
+      '\uD83D',
+      'c\uD83D',
+    ]);
+    const bytes = output.flatMap((chunk) => [...chunk]);
+    deepStrictEqual(
+      bytes,
+      [...new TextEncoder().encode('a\u{1F600}b\u{1F600}\uFFFDc\uFFFD')]
+    );
+    strictEqual(output.length, 5);
+  },
+};
+
+export const textDecoderStreamSplitCharacters = {
+  async test() {
+    const bytes = new TextEncoder().encode('hé\u{1F600}');
+    const chunks = [...bytes].map((b) => new Uint8Array([b]));
+    const output = await transformChunks(new TextDecoderStream(), chunks);
+    // Only the chunks that complete a character produce output.
+    deepStrictEqual(output, ['h', 'é', '\u{1F600}']);
+  },
+};
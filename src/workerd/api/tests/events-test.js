@@ -395,6 +395,42 @@ export const stopImmediatePropagation = {
   },
 };
 
+export const mutationDuringDispatch = {
+  test() {
+    const target = new EventTarget();
+    const calls = [];
+    const second = () => calls.push('second');
+    const added = () => calls.push('added');
+    let mutate = true;
+    target.addEventListener('foo', () => {
+      calls.push('first');
+      if (!mutate) return;
+      mutate = false;
+      // A listener removed mid-dispatch is skipped, even if added back, and listeners added
+      // mid-dispatch wait for the next dispatch.
+      target.removeEventListener('foo', second);
+      target.addEventListener('foo', second);
+      target.addEventListener('foo', added);
+    });
+    target.addEventListener('foo', second);
+    target.addEventListener('foo', () => calls.push('third'), { once: true });
+
+    target.dispatchEvent(new Event('foo'));
+    deepStrictEqual(calls, ['first', 'third']);
+
+    calls.length = 0;
+    target.dispatchEvent(new Event('foo'));
+    deepStrictEqual(calls, ['first', 'second', 'added']);
+
+    // Repeat dispatches with no changes in between share one snapshot of the listeners.
+    calls.length = 0;
+    target.removeEventListener('foo', added);
+    target.dispatchEvent(new Event('foo'));
+    target.dispatchEvent(new Event('foo'));
+    deepStrictEqual(calls, ['first', 'second', 'first', 'second']);
+  },
+};
+
 export const nullUndefinedHandler = {
   test() {
     // TODO(bug): Odd as it may seem, the spec allows passing null and undefined
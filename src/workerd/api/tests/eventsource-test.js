@@ -398,6 +398,44 @@ export const eventSourceFromWithBOMTest = {
   },
 };
 
+export const eventSourceFromSplitChunksTest = {
+  async test() {
+    const enc = new TextEncoder();
+    // Lines, line ends and the BOM split across chunks, in the middle of a
+    // CRLF in particular, which must not be taken for two line ends.
+    const chunks = [
+      new Uint8Array([0xef, 0xbb]),
+      new Uint8Array([0xbf, ...enc.encode('data: fir')]),
+      enc.encode('st\r'),
+      enc.encode('\ndata: line\r\n\r'),
+      enc.encode('\nevent: custom\rdata: second\n'),
+      enc.encode('\n'),
+    ];
+    const rs = new ReadableStream({
+      pull(c) {
+        c.enqueue(chunks.shift());
+        if (chunks.length === 0) {
+          c.close();
+        }
+      },
+    });
+    const { promise, resolve } = Promise.withResolvers();
+    const eventsource = EventSource.from(rs);
+    let first = false;
+    eventsource.onmessage = (event) => {
+      strictEqual(event.data, 'first\nline');
+      first = true;
+    };
+    eventsource.addEventListener('custom', (event) => {
+      ok(first);
+      strictEqual(event.data, 'second');
+      eventsource.close();
+      resolve();
+    });
+    await promise;
+  },
+};
+
 export const prototypePropertyTest = {
   test() {
     strictEqual(EventSource.prototype.constructor, EventSource);
@@ -22,3 +22,27 @@ export const test = {
     });
   },
 };
+
+export const cloneTest = {
+  async test() {
+    // The headers are shared with the clone until either side changes them,
+    // and a buffered body is read from the same bytes by both.
+    const res = new Response('hello', { headers: { 'x-a': '1' } });
+    const resClone = res.clone();
+    resClone.headers.set('x-a', '2');
+    res.headers.append('x-b', '3');
+    strictEqual(res.headers.get('x-a'), '1');
+    strictEqual(resClone.headers.get('x-a'), '2');
+    strictEqual(resClone.headers.get('x-b'), null);
+    strictEqual(await resClone.text(), 'hello');
+    strictEqual(await res.text(), 'hello');
+
+    const req = new Request('https://example.com', {
+      method: 'POST',
+      body: 'body',
+    });
+    const reqClone = req.clone();
+    strictEqual(await req.text(), 'body');
+    strictEqual(await reqClone.text(), 'body');
+  },
+};
@@ -73,6 +73,30 @@ export const timeoutVarargs = {
   },
 };
 
+export const timeoutOrdering = {
+  async test() {
+    // Callbacks of timeouts that expire together run in order, and each one's microtasks settle
+    // before the next one runs, whether or not they share a lock.
+    const log = [];
+    await new Promise((resolve) => {
+      setTimeout(() => {
+        log.push('a');
+        Promise.resolve().then(() => log.push('a then'));
+      }, 5);
+      setTimeout(() => log.push('b'), 5);
+      const interval = setInterval(() => {
+        log.push('interval');
+        clearInterval(interval);
+      }, 0);
+      setTimeout(() => {
+        log.push('c');
+        resolve();
+      }, 6);
+    });
+    deepStrictEqual(log, ['interval', 'a', 'a then', 'b', 'c']);
+  },
+};
+
 export const intervalVarargs = {
   async test() {
     let resolve;
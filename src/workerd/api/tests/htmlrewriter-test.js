@@ -817,3 +817,62 @@ export const svgNamespace = {
     strictEqual(namespace, 'http://www.w3.org/2000/svg');
   },
 };
+
+export const reusedRewriter = {
+  async test() {
+    const seen = [];
+    const rewriter = new HTMLRewriter().on('b', {
+      element(e) {
+        seen.push('b');
+        e.setInnerContent('B');
+      },
+    });
+
+    // Two responses at once, from the same rewriter, with async handlers that interleave.
+    const first = rewriter.transform(new Response('<b>1</b><b>2</b>')).text();
+    const second = rewriter
+      .on('i', {
+        async element(e) {
+          await scheduler.wait(1);
+          seen.push('i');
+          e.remove();
+        },
+      })
+      .transform(new Response('<b>3</b><i>4</i>'))
+      .text();
+
+    strictEqual(await first, '<b>B</b><b>B</b>');
+    strictEqual(await second, '<b>B</b>');
+    deepStrictEqual(seen.sort(), ['b', 'b', 'b', 'i']);
+
+    // The handler added for the second response applies to later ones too.
+    strictEqual(
+      await rewriter.transform(new Response('<i>5</i><b>6</b>')).text(),
+      '<b>B</b>'
+    );
+  },
+};
+
+export const outputChunkSize = {
+  async test() {
+    const html = '<p>' + 'x'.repeat(100) + '</p><p>' + 'y'.repeat(100) + '</p>';
+    const rewriter = new HTMLRewriter({ outputChunkSize: 64 }).on('p', {
+      element(e) {
+        e.setAttribute('class', 'c');
+      },
+    });
+
+    const chunks = [];
+    for await (const chunk of rewriter.transform(new Response(html)).body) {
+      chunks.push(new TextDecoder().decode(chunk));
+    }
+    for (const chunk of chunks.slice(0, -1)) {
+      strictEqual(chunk.length >= 64, true);
+    }
+    strictEqual(chunks.join(''), html.replaceAll('<p>', '<p class="c">'));
+
+    throws(() => new HTMLRewriter({ outputChunkSize: 2 * 1024 * 1024 }), {
+      name: 'RangeError',
+    });
+  },
+};
@@ -0,0 +1,120 @@
+import { strictEqual, deepStrictEqual, rejects } from 'node:assert';
+
+async function getCounts(env) {
+  const response = await env.BACKEND.fetch('http://backend/__counts');
+  return await response.json();
+}
+
+async function getCount(env) {
+  return (await getCounts(env)).gets;
+}
+
+export const coalescesConcurrentGets = {
+  async test(ctrl, env) {
+    await env.KV.put('hot', '{"hot":true}');
+    const before = await getCount(env);
+    const [text, again, json] = await Promise.all([
+      env.KV.get('hot'),
+      env.KV.get('hot', 'text'),
+      env.KV.get('hot', 'json'),
+    ]);
+    strictEqual(text, '{"hot":true}');
+    strictEqual(again, '{"hot":true}');
+    deepStrictEqual(json, { hot: true });
+    strictEqual(await getCount(env), before + 1);
+
+    // Without a cacheTtl, nothing is kept once the read has finished.
+    strictEqual(await env.KV.get('hot'), '{"hot":true}');
+    strictEqual(await getCount(env), before + 2);
+  },
+};
+
+export const keepsReadsForCacheTtl = {
+  async test(ctrl, env) {
+    await env.KV.put('kept', 'one');
+    const before = await getCount(env);
+    strictEqual(await env.KV.get('kept', { cacheTtl: 60 }), 'one');
+    strictEqual(await env.KV.get('kept', { cacheTtl: 60 }), 'one');
+    strictEqual(await getCount(env), before + 1);
+
+    // Missing keys are kept as well.
+    strictEqual(await env.KV.get('missing', { cacheTtl: 60 }), null);
+    strictEqual(await env.KV.get('missing', { cacheTtl: 60 }), null);
+    strictEqual(await getCount(env), before + 2);
+
+    // A write drops the kept value.
+    await env.KV.put('kept', 'two');
+    strictEqual(await env.KV.get('kept', { cacheTtl: 60 }), 'two');
+    await env.KV.delete('kept');
+    strictEqual(await env.KV.get('kept', { cacheTtl: 60 }), null);
+    strictEqual(await getCount(env), before + 4);
+  },
+};
+
+export const streamsAreNotShared = {
+  async test(ctrl, env) {
+    await env.KV.put('streamed', 'value');
+    const before = await getCount(env);
+    const streams = await Promise.all([
+      env.KV.get('streamed', 'stream'),
+      env.KV.get('streamed', 'stream'),
+    ]);
+    for (const stream of streams) {
+      strictEqual(await new Response(stream).text(), 'value');
+    }
+    strictEqual(await getCount(env), before + 2);
+  },
+};
+
+export const bulkGet = {
+  async test(ctrl, env) {
+    await env.KV.put('bulk-a', 'a');
+    await env.KV.put('bulk-b', '{"b":2}');
+    const before = await getCounts(env);
+
+    const text = await env.KV.get(['bulk-b', 'bulk-missing', 'bulk-a']);
+    deepStrictEqual(
+      text,
+      new Map([
+        ['bulk-b', '{"b":2}'],
+        ['bulk-missing', null],
+        ['bulk-a', 'a'],
+      ])
+    );
+    strictEqual([...text.keys()].join(), 'bulk-b,bulk-missing,bulk-a');
+
+    const json = await env.KV.get(['bulk-b'], { type: 'json' });
+    deepStrictEqual(json, new Map([['bulk-b', { b: 2 }]]));
+
+    const after = await getCounts(env);
+    strictEqual(after.bulkGets, before.bulkGets + 2);
+    strictEqual(after.gets, before.gets);
+  },
+};
+
+export const bulkGetLargeResponse = {
+  async test(ctrl, env) {
+    // Large enough that the response arrives in several chunks.
+    const keys = [];
+    for (let i = 0; i < 50; i++) {
+      const key = `large-${i}`;
+      keys.push(key);
+      await env.KV.put(key, String(i).repeat(1000));
+    }
+    const values = await env.KV.get(keys);
+    strictEqual(values.size, 50);
+    for (let i = 0; i < 50; i++) {
+      strictEqual(values.get(`large-${i}`), String(i).repeat(1000));
+    }
+  },
+};
+
+export const bulkGetValidation = {
+  async test(ctrl, env) {
+    await rejects(env.KV.get([]), TypeError);
+    const tooMany = Array.from({ length: 101 }, (_, i) => `key-${i}`);
+    await rejects(env.KV.get(tooMany), RangeError);
+    await rejects(env.KV.get(['a'], 'arrayBuffer'), TypeError);
+    await rejects(env.KV.get(['']), TypeError);
+  },
+};
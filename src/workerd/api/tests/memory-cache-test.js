@@ -1,4 +1,4 @@
-import { strictEqual, ok } from 'node:assert';
+import { strictEqual, ok, rejects } from 'node:assert';
 
 export const basic = {
   async test(ctrl, env) {
@@ -158,6 +158,65 @@ export const expiredEviction = {
   },
 };
 
+export const expiredEvictedBeforeLeastRecentlyUsed = {
+  async test(ctrl, env) {
+    // Fill the cache with a value that never expires and a more recently used
+    // value that expires soon.
+    await env.EXPIRING_CACHE.read('lasting', async () => {
+      return { value: 'lasting' };
+    });
+    await env.EXPIRING_CACHE.read('expiring', async () => {
+      return { value: 'expiring', expiration: Date.now() + 100 };
+    });
+    await scheduler.wait(200);
+    // Adding a third value must evict the expired value, not the least
+    // recently used one.
+    await env.EXPIRING_CACHE.read('new', async () => {
+      return { value: 'new' };
+    });
+    strictEqual(await env.EXPIRING_CACHE.read('lasting'), 'lasting');
+    strictEqual(await env.EXPIRING_CACHE.read('new'), 'new');
+    strictEqual(await env.EXPIRING_CACHE.read('expiring'), undefined);
+  },
+};
+
+export const staleWhileRevalidate = {
+  async test(ctrl, env) {
+    const options = { staleWhileRevalidate: 10_000 };
+    const first = await env.SWR_CACHE.read(
+      'key',
+      async () => {
+        return { value: 1, expiration: Date.now() + 100 };
+      },
+      options
+    );
+    strictEqual(first, 1);
+    await scheduler.wait(200);
+
+    // The expired value is returned right away, while a single fallback
+    // refreshes it in the background.
+    const { promise: refreshed, resolve } = Promise.withResolvers();
+    let calls = 0;
+    const fallback = async () => {
+      calls++;
+      await refreshed;
+      return { value: 2 };
+    };
+    strictEqual(await env.SWR_CACHE.read('key', fallback, options), 1);
+    strictEqual(await env.SWR_CACHE.read('key', fallback, options), 1);
+    strictEqual(calls, 1);
+
+    resolve();
+    await scheduler.wait(10);
+    strictEqual(await env.SWR_CACHE.read('key'), 2);
+
+    await rejects(
+      env.SWR_CACHE.read('key', fallback, { staleWhileRevalidate: -1 }),
+      RangeError
+    );
+  },
+};
+
 export const fallbackThrows = {
   async test(ctrl, env) {
     try {
@@ -242,3 +301,46 @@ export const fallbackNotLocked = {
     strictEqual(raced, 'bbb');
   },
 };
+
+export const sharedDeserializedValues = {
+  async test(ctrl, env) {
+    const produce = async () => ({ value: { routes: [{ path: '/a' }] } });
+    const produced = await env.SHARED_CACHE.read('routes', produce);
+    ok(!Object.isFrozen(produced));
+
+    // Later reads of the same entry return the same, deeply frozen, object.
+    const first = await env.SHARED_CACHE.read('routes');
+    const second = await env.SHARED_CACHE.read('routes', produce);
+    strictEqual(first, second);
+    ok(first !== produced);
+    ok(Object.isFrozen(first));
+    ok(Object.isFrozen(first.routes[0]));
+    strictEqual(first.routes[0].path, '/a');
+
+    // Values with contents that can't be frozen are copied for each read.
+    await env.SHARED_CACHE.read('map', async () => ({
+      value: new Map([['a', 1]]),
+    }));
+    const map = await env.SHARED_CACHE.read('map');
+    ok(map !== (await env.SHARED_CACHE.read('map')));
+    map.set('b', 2);
+    strictEqual((await env.SHARED_CACHE.read('map')).size, 1);
+
+    // Replacing the entry, here by evicting it, produces a new object.
+    await env.SHARED_CACHE.read('other', async () => ({ value: 1 }));
+    await env.SHARED_CACHE.read('routes', produce);
+    const replaced = await env.SHARED_CACHE.read('routes');
+    ok(replaced !== first);
+    ok(Object.isFrozen(replaced));
+  },
+};
+
+export const unsharedValuesAreCopies = {
+  async test(ctrl, env) {
+    await env.CACHE2.read('obj', async () => ({ value: { a: 1 } }));
+    const first = await env.CACHE2.read('obj');
+    const second = await env.CACHE2.read('obj');
+    ok(first !== second);
+    ok(!Object.isFrozen(first));
+  },
+};
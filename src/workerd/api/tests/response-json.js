@@ -60,3 +60,16 @@ export const notJsonSerializable = {
     throws(() => Response.json({ a: 1n }));
   },
 };
+
+export const largeNonAscii = {
+  async test() {
+    const value = {
+      text: 'caf\u00e9 \u{1f600} '.repeat(10000),
+      items: Array.from({ length: 1000 }, (_, i) => ({ i, s: `\u00fc${i}` })),
+    };
+    const response = Response.json(value);
+    const bytes = new Uint8Array(await response.clone().arrayBuffer());
+    strictEqual(bytes.byteLength, new TextEncoder().encode(JSON.stringify(value)).byteLength);
+    deepStrictEqual(await response.json(), value);
+  },
+};
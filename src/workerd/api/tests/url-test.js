@@ -9899,6 +9899,83 @@ export const urlPatternPortRegression = {
   },
 };
 
+export const urlPatternSimpleComponents = {
+  test() {
+    // Components built from fixed text, `:name` segments and `*` are matched without the regex
+    // engine, which must give the same answers as the regex would.
+    const pattern = new URLPattern({
+      hostname: ':sub.example.com',
+      pathname: '/books/:id/*',
+    });
+    const result = pattern.exec('https://shop.example.com/books/12/a/b?x=1');
+    strictEqual(result.hostname.groups.sub, 'shop');
+    strictEqual(result.pathname.input, '/books/12/a/b');
+    deepStrictEqual({ ...result.pathname.groups }, { id: '12', 0: 'a/b' });
+    deepStrictEqual({ ...result.search.groups }, { 0: 'x=1' });
+
+    // Segments never cross their delimiter and are never empty.
+    ok(!pattern.test('https://a.b.example.com/books/12/'));
+    ok(!pattern.test('https://shop.example.com/books//x'));
+    ok(!pattern.test('https://shop.example.com/books/12'));
+    ok(!pattern.test('https://shop.example.com/Books/12/x'));
+
+    // Patterns that need backtracking, optional parts, or case folding still use the regex.
+    const dashed = new URLPattern({ pathname: '/:from-:to' });
+    deepStrictEqual({ ...dashed.exec({ pathname: '/a-b-c' }).pathname.groups }, {
+      from: 'a-b',
+      to: 'c',
+    });
+    ok(new URLPattern({ pathname: '/books/:id?' }).test({ pathname: '/books' }));
+    ok(
+      new URLPattern({ pathname: '/Books' }, undefined, { ignoreCase: true }).test({
+        pathname: '/books',
+      })
+    );
+
+    // Patterns sharing components share compiled regexes, but each still matches on its own.
+    const a = new URLPattern({ pathname: '/items/:id(\\d+)' });
+    const b = new URLPattern({ pathname: '/items/:id(\\d+)' });
+    ok(a.test({ pathname: '/items/1' }) && b.test({ pathname: '/items/2' }));
+    ok(!b.test({ pathname: '/items/x' }));
+  },
+};
+
+export const urlPatternList = {
+  test() {
+    const list = new URLPatternList(
+      [
+        '/users/:id',
+        { pathname: '/users/:id/posts/:post' },
+        new URLPattern({ pathname: '/users/*' }),
+        '/static/*',
+        '/:anything(.*)',
+      ],
+      'https://example.com'
+    );
+    strictEqual(list.length, 5);
+
+    // The first pattern in list order wins, whatever the trie visits first.
+    const first = list.exec('https://example.com/users/1/posts/2');
+    strictEqual(first.index, 1);
+    deepStrictEqual({ ...first.result.pathname.groups }, { id: '1', post: '2' });
+    deepStrictEqual(first.result.inputs, ['https://example.com/users/1/posts/2']);
+
+    deepStrictEqual(
+      list.execAll('https://example.com/users/1').map((match) => match.index),
+      [0, 2, 4]
+    );
+    ok(list.test('https://example.com/static/app.js'));
+    ok(!list.test('not a url'));
+
+    // Patterns keep their own protocol and hostname requirements: only those given as
+    // URLPatternInits without a baseURL match any host, or an init input with no protocol.
+    strictEqual(list.exec('https://other.example/users/1').index, 2);
+    strictEqual(list.exec({ pathname: '/users/7' }).index, 2);
+    strictEqual(list.exec('https://other.example/static/app.js'), null);
+    strictEqual(new URLPatternList([]).exec('https://example.com/'), null);
+  },
+};
+
 export const urlParseStatic = {
   test() {
     const url = URL.parse('http://example.org');
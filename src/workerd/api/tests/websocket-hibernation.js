@@ -2,6 +2,8 @@
 // Licensed under the Apache 2.0 license found in the LICENSE file or at:
 //     https://opensource.org/licenses/Apache-2.0
 
+import * as assert from 'node:assert';
+
 // A simple test to confirm we can close() a websocket from the close handler.
 export class DurableObjectExample {
   constructor(state) {
@@ -20,6 +22,17 @@ export class DurableObjectExample {
     let server = pair[0];
     if (request.url.endsWith('/hibernation')) {
       this.state.acceptWebSocket(server);
+    } else if (request.url.endsWith('/room')) {
+      this.state.acceptWebSocket(server, ['room']);
+    } else if (request.url.endsWith('/auto')) {
+      this.state.acceptWebSocket(server);
+      this.state.setWebSocketAutoResponses([
+        new WebSocketRequestResponsePair('ping', 'pong', { match: 'prefix' }),
+        new WebSocketRequestResponsePair('status', 'ok'),
+      ]);
+    } else if (request.url.endsWith('/idle')) {
+      this.state.acceptWebSocket(server);
+      this.state.setHibernatableWebSocketIdleTimeout(100);
     } else {
       server.accept();
       server.addEventListener('message', () => {
@@ -36,11 +49,21 @@ export class DurableObjectExample {
     });
   }
 
-  webSocketMessage(ws) {
+  webSocketMessage(ws, message) {
+    if (message === 'shout') {
+      const count = this.state.broadcast('room', 'hello room', {
+        except: [ws],
+      });
+      ws.send(`sent to ${count}`);
+      return;
+    }
     ws.send(`Hibernatable message from DO.`);
   }
 
   webSocketClose(ws, code, reason, wasClean) {
+    if (code === 1001) {
+      ws.send(`${reason}, clean: ${wasClean}`);
+    }
     ws.close(1000, 'Hibernatable close from DO');
   }
 }
@@ -86,5 +109,76 @@ export default {
       'http://example.com/hibernation',
       'Hibernatable close from DO'
     );
+
+    // Broadcast to a tag, skipping the sender.
+    let connect = async (path = 'room', stub = obj) => {
+      let req = await stub.fetch(`http://example.com/${path}`, {
+        headers: {
+          Upgrade: 'websocket',
+        },
+      });
+      let ws = req.webSocket;
+      ws.accept();
+      return ws;
+    };
+    let nextMessage = (ws) =>
+      new Promise((resolve) => {
+        ws.addEventListener('message', (event) => resolve(event.data), {
+          once: true,
+        });
+      });
+    let sender = await connect();
+    let listener = await connect();
+    let senderReply = nextMessage(sender);
+    let listenerMessage = nextMessage(listener);
+    sender.send('shout');
+    assert.strictEqual(await senderReply, 'sent to 1');
+    assert.strictEqual(await listenerMessage, 'hello room');
+    sender.close(1000, 'done');
+    listener.close(1000, 'done');
+
+    // Auto-responses don't reach webSocketMessage().
+    let auto = await connect('auto');
+    for (let [message, expected] of [
+      ['ping 1', 'pong'],
+      ['status', 'ok'],
+      ['status?', 'Hibernatable message from DO.'],
+    ]) {
+      let reply = nextMessage(auto);
+      auto.send(message);
+      assert.strictEqual(await reply, expected);
+    }
+    auto.close(1000, 'done');
+
+    // An idle websocket is closed by the DO once the timeout passes.
+    let idle = await connect('idle', env.ns.get(env.ns.idFromName('idle')));
+    let idleClosed = new Promise((resolve) => {
+      idle.addEventListener('close', resolve);
+    });
+    assert.strictEqual(
+      await nextMessage(idle),
+      'WebSocket idle timeout, clean: false'
+    );
+    await idleClosed;
+  },
+};
+
+export const sendBlob = {
+  async test() {
+    let [left, right] = Object.values(new WebSocketPair());
+    left.accept();
+    right.accept();
+    let received = new Promise((resolve) => {
+      right.addEventListener('message', (event) => resolve(event.data));
+    });
+
+    left.send(new Blob(['hello ', 'blob']));
+    // The message is only written once send() has returned.
+    assert.strictEqual(left.bufferedAmount, 10);
+
+    let data = await received;
+    assert.ok(data instanceof ArrayBuffer);
+    assert.strictEqual(new TextDecoder().decode(data), 'hello blob');
+    assert.strictEqual(left.bufferedAmount, 0);
   },
 };
@@ -53,42 +53,37 @@ double getTraceDiagnosticChannelEventTimestamp(const tracing::DiagnosticChannelE
   }
 }
 
-kj::String getTraceLogLevel(const tracing::Log& log) {
+kj::StringPtr getTraceLogLevel(const tracing::Log& log) {
   switch (log.logLevel) {
     case LogLevel::DEBUG_:
-      return kj::str("debug");
+      return "debug"_kj;
     case LogLevel::INFO:
-      return kj::str("info");
+      return "info"_kj;
     case LogLevel::LOG:
-      return kj::str("log");
+      return "log"_kj;
     case LogLevel::WARN:
-      return kj::str("warn");
+      return "warn"_kj;
     case LogLevel::ERROR:
-      return kj::str("error");
+      return "error"_kj;
   }
   KJ_UNREACHABLE;
 }
 
-jsg::V8Ref<v8::Object> getTraceLogMessage(jsg::Lock& js, const tracing::Log& log) {
-  return js.parseJson(log.message).cast<v8::Object>(js);
-}
-
-kj::Array<jsg::Ref<TraceLog>> getTraceLogs(jsg::Lock& js, const Trace& trace) {
+kj::Array<jsg::Ref<TraceLog>> getTraceLogs(Trace& trace) {
   auto builder = kj::heapArrayBuilder<jsg::Ref<TraceLog>>(trace.logs.size() + trace.spans.size());
   for (auto i: kj::indices(trace.logs)) {
-    builder.add(jsg::alloc<TraceLog>(js, trace, trace.logs[i]));
+    builder.add(jsg::alloc<TraceLog>(kj::addRef(trace), trace.logs[i]));
   }
   // Add spans represented as logs to the logs object.
   for (auto i: kj::indices(trace.spans)) {
-    builder.add(jsg::alloc<TraceLog>(js, trace, trace.spans[i]));
+    builder.add(jsg::alloc<TraceLog>(kj::addRef(trace), trace.spans[i]));
   }
   return builder.finish();
 }
 
-kj::Array<jsg::Ref<TraceDiagnosticChannelEvent>> getTraceDiagnosticChannelEvents(
-    jsg::Lock& js, const Trace& trace) {
+kj::Array<jsg::Ref<TraceDiagnosticChannelEvent>> getTraceDiagnosticChannelEvents(Trace& trace) {
   return KJ_MAP(x, trace.diagnosticChannelEvents) -> jsg::Ref<TraceDiagnosticChannelEvent> {
-    return jsg::alloc<TraceDiagnosticChannelEvent>(trace, x);
+    return jsg::alloc<TraceDiagnosticChannelEvent>(kj::addRef(trace), x);
   };
 }
 
@@ -104,8 +99,10 @@ double getTraceExceptionTimestamp(const tracing::Exception& ex) {
   }
 }
 
-kj::Array<jsg::Ref<TraceException>> getTraceExceptions(const Trace& trace) {
-  return KJ_MAP(x, trace.exceptions) -> jsg::Ref<TraceException> { return jsg::alloc<TraceException>(trace, x); };
+kj::Array<jsg::Ref<TraceException>> getTraceExceptions(Trace& trace) {
+  return KJ_MAP(x, trace.exceptions) -> jsg::Ref<TraceException> {
+    return jsg::alloc<TraceException>(kj::addRef(trace), x);
+  };
 }
 
 jsg::Optional<kj::Array<kj::String>> getTraceScriptTags(const Trace& trace) {
@@ -127,14 +124,6 @@ kj::String enumToStr(const Enum& var) {
 
 kj::Own<TraceItem::FetchEventInfo::Request::Detail> getFetchRequestDetail(
     jsg::Lock& js, const Trace& trace, const tracing::FetchEventInfo& eventInfo) {
-  const auto getCf = [&]() -> jsg::Optional<jsg::V8Ref<v8::Object>> {
-    const auto& cfJson = eventInfo.cfJson;
-    if (cfJson.size() > 0) {
-      return js.parseJson(cfJson).cast<v8::Object>(js);
-    }
-    return kj::none;
-  };
-
   const auto getHeaders = [&]() -> kj::Array<tracing::FetchEventInfo::Header> {
     return KJ_MAP(header, eventInfo.headers) {
       return tracing::FetchEventInfo::Header(kj::str(header.name), kj::str(header.value));
@@ -142,7 +131,7 @@ kj::Own<TraceItem::FetchEventInfo::Request::Detail> getFetchRequestDetail(
   };
 
   return kj::refcounted<TraceItem::FetchEventInfo::Request::Detail>(
-      getCf(), getHeaders(), kj::str(eventInfo.method), kj::str(eventInfo.url));
+      kj::str(eventInfo.cfJson), getHeaders(), kj::str(eventInfo.method), kj::str(eventInfo.url));
 }
 
 kj::Maybe<TraceItem::EventInfo> getTraceEvent(jsg::Lock& js, const Trace& trace) {
@@ -197,12 +186,12 @@ kj::Maybe<TraceItem::EventInfo> getTraceEvent(jsg::Lock& js, const Trace& trace)
 }
 }  // namespace
 
-TraceItem::TraceItem(jsg::Lock& js, const Trace& trace)
+TraceItem::TraceItem(jsg::Lock& js, Trace& trace)
     : eventInfo(getTraceEvent(js, trace)),
       eventTimestamp(getTraceTimestamp(trace)),
-      logs(getTraceLogs(js, trace)),
+      logs(getTraceLogs(trace)),
       exceptions(getTraceExceptions(trace)),
-      diagnosticChannelEvents(getTraceDiagnosticChannelEvents(js, trace)),
+      diagnosticChannelEvents(getTraceDiagnosticChannelEvents(trace)),
       scriptName(trace.scriptName.map([](auto& name) { return kj::str(name); })),
       entrypoint(trace.entrypoint.map([](auto& name) { return kj::str(name); })),
       scriptVersion(getTraceScriptVersion(trace)),
@@ -313,11 +302,11 @@ TraceItem::FetchEventInfo::FetchEventInfo(jsg::Lock& js,
     : request(jsg::alloc<Request>(js, trace, eventInfo)),
       response(responseInfo.map([&](auto& info) { return jsg::alloc<Response>(trace, info); })) {}
 
-TraceItem::FetchEventInfo::Request::Detail::Detail(jsg::Optional<jsg::V8Ref<v8::Object>> cf,
+TraceItem::FetchEventInfo::Request::Detail::Detail(kj::String cfJson,
     kj::Array<tracing::FetchEventInfo::Header> headers,
     kj::String method,
     kj::String url)
-    : cf(kj::mv(cf)),
+    : cfJson(kj::mv(cfJson)),
       headers(kj::mv(headers)),
       method(kj::mv(method)),
       url(kj::mv(url)) {}
@@ -342,6 +331,10 @@ TraceItem::FetchEventInfo::Request::Request(Detail& detail, bool redacted)
       detail(kj::addRef(detail)) {}
 
 jsg::Optional<jsg::V8Ref<v8::Object>> TraceItem::FetchEventInfo::Request::getCf(jsg::Lock& js) {
+  if (detail->cfJson.size() > 0) {
+    detail->cf = js.parseJson(detail->cfJson).cast<v8::Object>(js);
+    detail->cfJson = kj::String();
+  }
   return detail->cf.map([&](jsg::V8Ref<v8::Object>& obj) { return obj.addRef(js); });
 }
 
@@ -471,23 +464,22 @@ kj::Maybe<kj::StringPtr> TraceItem::TailEventInfo::TailItem::getScriptName() {
 }
 
 TraceDiagnosticChannelEvent::TraceDiagnosticChannelEvent(
-    const Trace& trace, const tracing::DiagnosticChannelEvent& eventInfo)
-    : timestamp(getTraceDiagnosticChannelEventTimestamp(eventInfo)),
-      channel(kj::heapString(eventInfo.channel)),
-      message(kj::heapArray<kj::byte>(eventInfo.message)) {}
+    kj::Own<Trace> trace, const tracing::DiagnosticChannelEvent& event)
+    : trace(kj::mv(trace)),
+      event(event) {}
 
 kj::StringPtr TraceDiagnosticChannelEvent::getChannel() {
-  return channel;
+  return event.channel;
 }
 
 jsg::JsValue TraceDiagnosticChannelEvent::getMessage(jsg::Lock& js) {
-  if (message.size() == 0) return js.undefined();
-  jsg::Deserializer des(js, message.asPtr());
+  if (event.message.size() == 0) return js.undefined();
+  jsg::Deserializer des(js, event.message.asPtr());
   return des.readValue(js);
 }
 
 double TraceDiagnosticChannelEvent::getTimestamp() {
-  return timestamp;
+  return getTraceDiagnosticChannelEventTimestamp(event);
 }
 
 ScriptVersion::ScriptVersion(workerd::ScriptVersion::Reader version)
@@ -553,43 +545,40 @@ bool TraceItem::HibernatableWebSocketEventInfo::Close::getWasClean() {
   return eventInfo.wasClean;
 }
 
-TraceLog::TraceLog(jsg::Lock& js, const Trace& trace, const tracing::Log& log)
-    : timestamp(getTraceLogTimestamp(log)),
-      level(getTraceLogLevel(log)),
-      message(getTraceLogMessage(js, log)) {}
+TraceLog::TraceLog(kj::Own<Trace> trace, const tracing::Log& log)
+    : trace(kj::mv(trace)),
+      log(log) {}
 
 double TraceLog::getTimestamp() {
-  return timestamp;
+  return getTraceLogTimestamp(log);
 }
 
 kj::StringPtr TraceLog::getLevel() {
-  return level;
+  return getTraceLogLevel(log);
 }
 
 jsg::V8Ref<v8::Object> TraceLog::getMessage(jsg::Lock& js) {
-  return message.addRef(js);
+  return js.parseJson(log.message).cast<v8::Object>(js);
 }
 
-TraceException::TraceException(const Trace& trace, const tracing::Exception& exception)
-    : timestamp(getTraceExceptionTimestamp(exception)),
-      name(kj::str(exception.name)),
-      message(kj::str(exception.message)),
-      stack(exception.stack.map([](kj::StringPtr s) { return kj::str(s); })) {}
+TraceException::TraceException(kj::Own<Trace> trace, const tracing::Exception& exception)
+    : trace(kj::mv(trace)),
+      exception(exception) {}
 
 double TraceException::getTimestamp() {
-  return timestamp;
+  return getTraceExceptionTimestamp(exception);
 }
 
 kj::StringPtr TraceException::getMessage() {
-  return message;
+  return exception.message;
 }
 
 kj::StringPtr TraceException::getName() {
-  return name;
+  return exception.name;
 }
 
 jsg::Optional<kj::StringPtr> TraceException::getStack(jsg::Lock& js) {
-  return stack;
+  return exception.stack;
 }
 
 TraceMetrics::TraceMetrics(uint cpuTime, uint wallTime): cpuTime(cpuTime), wallTime(wallTime) {}
@@ -609,7 +598,9 @@ kj::Promise<void> sendTracesToExportedHandler(kj::Own<IoContext::IncomingRequest
   auto& metrics = incomingRequest->getMetrics();
 
   KJ_IF_SOME(t, incomingRequest->getWorkerTracer()) {
-    t.setEventInfo(context.now(), tracing::TraceEventInfo(traces));
+    if (t.wantsEventInfo()) {
+      t.setEventInfo(context.now(), tracing::TraceEventInfo(traces));
+    }
   }
 
   auto nonEmptyTraces = kj::Vector<kj::Own<Trace>>(kj::size(traces));
@@ -665,7 +656,11 @@ auto TraceCustomEventImpl::run(kj::Own<IoContext::IncomingRequest> incomingReque
 auto TraceCustomEventImpl::sendRpc(capnp::HttpOverCapnpFactory& httpOverCapnpFactory,
     capnp::ByteStreamFactory& byteStreamFactory,
     workerd::rpc::EventDispatcher::Client dispatcher) -> kj::Promise<Result> {
-  auto req = dispatcher.sendTracesRequest();
+  capnp::MessageSize sizeHint{0, 0};
+  for (auto& trace: traces) {
+    sizeHint.wordCount += trace->getSizeHint().wordCount;
+  }
+  auto req = dispatcher.sendTracesRequest(sizeHint);
   auto out = req.initTraces(traces.size());
   for (auto i: kj::indices(traces)) {
     traces[i]->copyTo(out[i]);
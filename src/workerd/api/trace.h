@@ -78,7 +78,9 @@ class TraceItem final: public jsg::Object {
   class HibernatableWebSocketEventInfo;
   class CustomEventInfo;
 
-  explicit TraceItem(jsg::Lock& js, const Trace& trace);
+  // Logs, exceptions and diagnostic channel events keep a reference to `trace`, and read from it
+  // when their properties are first accessed, rather than copying it all up front.
+  explicit TraceItem(jsg::Lock& js, Trace& trace);
 
   typedef kj::OneOf<jsg::Ref<FetchEventInfo>,
       jsg::Ref<JsRpcEventInfo>,
@@ -190,17 +192,21 @@ class TraceItem::FetchEventInfo final: public jsg::Object {
 class TraceItem::FetchEventInfo::Request final: public jsg::Object {
  public:
   struct Detail: public kj::Refcounted {
+    // The cf object is only parsed from `cfJson` the first time it is read, since many tail
+    // workers never look at it. `cfJson` is then dropped.
+    kj::String cfJson;
     jsg::Optional<jsg::V8Ref<v8::Object>> cf;
     kj::Array<tracing::FetchEventInfo::Header> headers;
     kj::String method;
     kj::String url;
 
-    Detail(jsg::Optional<jsg::V8Ref<v8::Object>> cf,
+    Detail(kj::String cfJson,
         kj::Array<tracing::FetchEventInfo::Header> headers,
         kj::String method,
         kj::String url);
 
     JSG_MEMORY_INFO(Detail) {
+      tracker.trackField("cfJson", cfJson);
       tracker.trackField("cf", cf);
       for (const auto& header: headers) {
         tracker.trackField(nullptr, header);
@@ -497,7 +503,7 @@ class TraceItem::CustomEventInfo final: public jsg::Object {
 class TraceDiagnosticChannelEvent final: public jsg::Object {
  public:
   explicit TraceDiagnosticChannelEvent(
-      const Trace& trace, const tracing::DiagnosticChannelEvent& eventInfo);
+      kj::Own<Trace> trace, const tracing::DiagnosticChannelEvent& event);
 
   double getTimestamp();
   kj::StringPtr getChannel();
@@ -510,19 +516,20 @@ class TraceDiagnosticChannelEvent final: public jsg::Object {
   }
 
   void visitForMemoryInfo(jsg::MemoryTracker& tracker) const {
-    tracker.trackField("channel", channel);
-    tracker.trackFieldWithSize("message", message.size());
+    tracker.trackField("channel", event.channel);
+    tracker.trackFieldWithSize("message", event.message.size());
   }
 
  private:
-  double timestamp;
-  kj::String channel;
-  kj::Array<kj::byte> message;
+  // Owns `event`.
+  kj::Own<Trace> trace;
+  const tracing::DiagnosticChannelEvent& event;
 };
 
 class TraceLog final: public jsg::Object {
  public:
-  TraceLog(jsg::Lock& js, const Trace& trace, const tracing::Log& log);
+  // The message is only parsed from JSON when it's first read.
+  TraceLog(kj::Own<Trace> trace, const tracing::Log& log);
 
   double getTimestamp();
   kj::StringPtr getLevel();
@@ -535,19 +542,18 @@ class TraceLog final: public jsg::Object {
   }
 
   void visitForMemoryInfo(jsg::MemoryTracker& tracker) const {
-    tracker.trackField("level", level);
-    tracker.trackField("message", message);
+    tracker.trackField("message", log.message);
   }
 
  private:
-  double timestamp;
-  kj::String level;
-  jsg::V8Ref<v8::Object> message;
+  // Owns `log`.
+  kj::Own<Trace> trace;
+  const tracing::Log& log;
 };
 
 class TraceException final: public jsg::Object {
  public:
-  TraceException(const Trace& trace, const tracing::Exception& exception);
+  TraceException(kj::Own<Trace> trace, const tracing::Exception& exception);
 
   double getTimestamp();
   kj::StringPtr getName();
@@ -562,15 +568,14 @@ class TraceException final: public jsg::Object {
   }
 
   void visitForMemoryInfo(jsg::MemoryTracker& tracker) const {
-    tracker.trackField("name", name);
-    tracker.trackField("message", message);
+    tracker.trackField("name", exception.name);
+    tracker.trackField("message", exception.message);
   }
 
  private:
-  double timestamp;
-  kj::String name;
-  kj::String message;
-  kj::Maybe<kj::String> stack;
+  // Owns `exception`.
+  kj::Own<Trace> trace;
+  const tracing::Exception& exception;
 };
 
 class TraceMetrics final: public jsg::Object {
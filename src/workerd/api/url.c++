@@ -161,6 +161,30 @@ kj::String kjUrlToString(const kj::Url& url) {
   return kj::mv(result);
 }
 
+// Whether `scheme` may simply be assigned over `current` without reparsing the URL. This mirrors
+// the scheme state's state-override rules: the new scheme must already be in kj::Url's normalized
+// form (lowercase, starting with a letter) and must not change whether the URL is special. file:
+// URLs are left to the full reparse since their host handling differs.
+bool canOverrideSchemeInPlace(kj::StringPtr current, kj::StringPtr scheme) {
+  if (scheme.size() == 0 || scheme[0] < 'a' || scheme[0] > 'z') {
+    return false;
+  }
+  for (char c: scheme.slice(1)) {
+    if (!((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '+' || c == '-' || c == '.')) {
+      return false;
+    }
+  }
+  return current != "file" && scheme != "file" &&
+      isSpecialScheme(current) == isSpecialScheme(scheme);
+}
+
+// Whether the URL's credentials may be assigned directly. Per the spec, URLs without a host (and
+// file: URLs) cannot have credentials, which the reparse would otherwise catch. Special non-file
+// URLs always serialize credentials as `user:pass@host`, so the reparse is an identity there.
+bool canOverrideUserInfoInPlace(const kj::Url& url) {
+  return url.host.size() > 0 && url.scheme != "file" && isSpecialScheme(url.scheme);
+}
+
 }  // namespace
 
 // =======================================================================================
@@ -199,13 +223,12 @@ URL::URL(kj::Url&& u): url(kj::refcounted<RefcountedUrl>(kj::mv(u))) {
 // kj::Url's parser, more and more unit tests for this wrapper class should start passing without
 // modification.
 //
-// TODO(perf): Pre-processing input, cloning, stringifying, and parsing the cloned URL is an awfully
-//   heavyweight operation when all we want to do is validly replace a URL component. A couple
-//   attributes, pathname and search, are able to take advantage of the kj::Url parser's context
-//   argument: we can parse a pathname using the HTTP_REQUEST context, for instance. The WHATWG URL
-//   spec defines a parser state machine allowing for the state to be overridden to parse only
-//   specific components of a URL. This is more or less a generalization of kj::Url's parser
-//   context, and offers an obvious path forward to both conformance and performance.
+// Cloning, stringifying, and reparsing is an awfully heavyweight operation when all we want to do
+// is validly replace one component, so, like the WHATWG parser's state override, most setters
+// only touch the component in question: pathname and search parse just their component, host,
+// hostname, port, and hash assign directly, and protocol, username, and password assign directly
+// whenever doing so can't change how the rest of the URL parses. Only the remaining cases fall
+// back to the full reparse.
 
 kj::String URL::getHref() {
   return toString();
@@ -242,6 +265,12 @@ void URL::setProtocol(kj::String value) {
     value = kj::str(value.first(colon));
   }
 
+  if (canOverrideSchemeInPlace(url->scheme, value)) {
+    url->scheme = kj::mv(value);
+    normalizePort(*url);
+    return;
+  }
+
   auto copy = url->clone();
   copy.scheme = kj::mv(value);
 
@@ -259,6 +288,15 @@ kj::String URL::getUsername() {
   return {};
 }
 void URL::setUsername(kj::String value) {
+  if (value.size() > 0 && canOverrideUserInfoInPlace(*url)) {
+    KJ_IF_SOME(ui, url->userInfo) {
+      ui.username = kj::mv(value);
+    } else {
+      url->userInfo = kj::Url::UserInfo{.username = kj::mv(value)};
+    }
+    return;
+  }
+
   auto copy = url->clone();
   KJ_IF_SOME(ui, copy.userInfo) {
     ui.username = kj::mv(value);
@@ -280,6 +318,15 @@ kj::String URL::getPassword() {
   return {};
 }
 void URL::setPassword(kj::String value) {
+  if (value.size() > 0 && canOverrideUserInfoInPlace(*url)) {
+    KJ_IF_SOME(ui, url->userInfo) {
+      ui.password = kj::mv(value);
+    } else {
+      url->userInfo = kj::Url::UserInfo{.password = kj::mv(value)};
+    }
+    return;
+  }
+
   auto copy = url->clone();
   KJ_IF_SOME(ui, copy.userInfo) {
     // We already have userInfo. Set the password if we were given a non-empty string, otherwise
@@ -4,8 +4,12 @@
 
 #include "urlpattern.h"
 
+#include <workerd/io/worker.h>
+
 #include <kj/vector.h>
 
+#include <algorithm>
+
 namespace workerd::api {
 
 namespace {
@@ -17,29 +21,15 @@ jsg::JsRef<jsg::JsRegExp> compileRegex(
       flags = static_cast<jsg::Lock::RegExpFlags>(
           flags | static_cast<int>(jsg::Lock::RegExpFlags::kIGNORE_CASE));
     }
+    KJ_IF_SOME(isolate, Worker::Isolate::tryFrom(js)) {
+      return isolate.getURLPatternRegexCache().getOrCompile(js, component.getRegex(), flags);
+    }
     return jsg::JsRef<jsg::JsRegExp>(js, js.regexp(component.getRegex(), flags));
   }, [&](auto reason) -> jsg::JsRef<jsg::JsRegExp> {
     JSG_FAIL_REQUIRE(TypeError, "Invalid regular expression syntax.");
   });
 }
 
-jsg::Ref<URLPattern> create(jsg::Lock& js, jsg::UrlPattern pattern) {
-  bool ignoreCase = pattern.getIgnoreCase();
-
-  // Might look a bit confusing here. The URL_PATTERN_COMPONENTS macro
-  // is used also to define the constructor for URLPattern so to make
-  // sure things line up right we reuse that pattern here also. Because
-  // we are moving the pattern into the constructor, we need to make sure
-  // the regex patterns are compiled first so we use the macro twice.
-#define V(Name, var) auto var = compileRegex(js, pattern.get##Name(), ignoreCase);
-  URL_PATTERN_COMPONENTS(V)
-#undef V
-
-#define V(_, var) , kj::mv(var)
-  return jsg::alloc<URLPattern>(kj::mv(pattern) URL_PATTERN_COMPONENTS(V));
-#undef V
-}
-
 kj::Maybe<URLPattern::URLPatternComponentResult> execRegex(jsg::Lock& js,
     jsg::JsRef<jsg::JsRegExp>& regex,
     kj::ArrayPtr<const kj::String> nameList,
@@ -70,32 +60,222 @@ kj::Maybe<URLPattern::URLPatternComponentResult> execRegex(jsg::Lock& js,
 
   return kj::none;
 }
+
+// The characters jsg::UrlPattern escapes when it embeds fixed text in a regex. Any of these
+// appearing unescaped means the regex is doing something other than matching fixed text.
+bool isRegexSyntax(char c) {
+  return c == '.' || c == '+' || c == '*' || c == '?' || c == '^' || c == '$' || c == '{' ||
+      c == '}' || c == '(' || c == ')' || c == '[' || c == ']' || c == '|' || c == '/' ||
+      c == '\\';
+}
+
+// Consumes one character of fixed text at the start of `pos` into `text`, which is either escaped
+// or not regex syntax.
+bool tryConsumeFixedText(kj::StringPtr& pos, kj::Vector<char>& text) {
+  if (pos.size() >= 2 && pos[0] == '\\' && isRegexSyntax(pos[1])) {
+    text.add(pos[1]);
+    pos = pos.slice(2);
+    return true;
+  } else if (pos.size() > 0 && !isRegexSyntax(pos[0])) {
+    text.add(pos[0]);
+    pos = pos.slice(1);
+    return true;
+  }
+  return false;
+}
+
+// Returns the fixed text that every match of a component regex generated by jsg::UrlPattern
+// starts with. Fixed text outside a group is never optional, so this is everything up to the
+// first group.
+kj::String literalPrefix(kj::StringPtr regex, bool ignoreCase) {
+  kj::Vector<char> text;
+  if (!ignoreCase && regex.startsWith("^")) {
+    auto pos = regex.slice(1);
+    while (tryConsumeFixedText(pos, text)) {}
+  }
+  text.add('\0');
+  return kj::String(text.releaseAsArray());
+}
+
+// Without the `s` flag, `.` does not match line terminators, so neither does a full wildcard.
+bool containsLineTerminator(kj::StringPtr str) {
+  return str.findFirst('\n') != kj::none || str.findFirst('\r') != kj::none ||
+      str.contains("\u2028"_kj) || str.contains("\u2029"_kj);
+}
 }  // namespace
 
-URLPattern::URLPattern(jsg::UrlPattern inner,
-    jsg::JsRef<jsg::JsRegExp> protocolRegex,
-    jsg::JsRef<jsg::JsRegExp> usernameRegex,
-    jsg::JsRef<jsg::JsRegExp> passwordRegex,
-    jsg::JsRef<jsg::JsRegExp> hostnameRegex,
-    jsg::JsRef<jsg::JsRegExp> portRegex,
-    jsg::JsRef<jsg::JsRegExp> pathnameRegex,
-    jsg::JsRef<jsg::JsRegExp> searchRegex,
-    jsg::JsRef<jsg::JsRegExp> hashRegex)
-    : inner(kj::mv(inner)),
-      protocolRegex(kj::mv(protocolRegex)),
-      usernameRegex(kj::mv(usernameRegex)),
-      passwordRegex(kj::mv(passwordRegex)),
-      hostnameRegex(kj::mv(hostnameRegex)),
-      portRegex(kj::mv(portRegex)),
-      pathnameRegex(kj::mv(pathnameRegex)),
-      searchRegex(kj::mv(searchRegex)),
-      hashRegex(kj::mv(hashRegex)) {}
+jsg::JsRef<jsg::JsRegExp> URLPatternRegexCache::getOrCompile(
+    jsg::Lock& js, kj::StringPtr source, jsg::Lock::RegExpFlags flags) {
+  auto key = kj::str(static_cast<int>(flags), ':', source);
+  KJ_IF_SOME(entry, entries.find(key)) {
+    // Move the entry to the back of the insertion order to mark it most recently used.
+    auto& bumped = entries.insert(entries.release(entry));
+    return bumped.regex.addRef(js);
+  }
+
+  auto regex = jsg::JsRef<jsg::JsRegExp>(js, js.regexp(source, flags));
+  if (entries.size() >= maxEntries) {
+    entries.erase(*entries.ordered<1>().begin());
+  }
+  auto& entry = entries.insert(Entry{kj::mv(key), kj::mv(regex)});
+  return entry.regex.addRef(js);
+}
+
+kj::Maybe<URLPattern::ComponentMatcher> URLPattern::ComponentMatcher::tryCreate(
+    kj::StringPtr regex, bool ignoreCase) {
+  using Type = Step::Type;
+
+  // Case-insensitive matching follows Unicode case folding, which is best left to the regex.
+  if (ignoreCase || !regex.startsWith("^") || !regex.endsWith("$")) return kj::none;
+
+  kj::Vector<Step> steps;
+  kj::Vector<char> text;
+  auto flushText = [&]() {
+    if (text.size() > 0) {
+      text.add('\0');
+      steps.add(Step{.type = Type::TEXT, .text = kj::String(text.releaseAsArray())});
+    }
+  };
+
+  auto tryConsumeText = [&](kj::StringPtr& pos) { return tryConsumeFixedText(pos, text); };
+
+  // Consumes a capture group holding a full or segment wildcard, as generated for `*` and `:name`.
+  auto tryConsumeGroup = [&](kj::StringPtr& pos) {
+    if (pos.startsWith("(.*)")) {
+      flushText();
+      steps.add(Step{.type = Type::REST});
+      pos = pos.slice(4);
+      return true;
+    } else if (pos.startsWith("([^]+)")) {
+      flushText();
+      steps.add(Step{.type = Type::SEGMENT});
+      pos = pos.slice(6);
+      return true;
+    } else if (pos.size() >= 8 && pos.startsWith("([^\\") && pos.slice(5).startsWith("]+)")) {
+      flushText();
+      steps.add(Step{.type = Type::SEGMENT, .delimiter = pos[4]});
+      pos = pos.slice(8);
+      return true;
+    }
+    return false;
+  };
+
+  auto pos = regex.slice(1, regex.size() - 1);
+  while (pos.size() > 0) {
+    if (tryConsumeText(pos)) continue;
+
+    if (pos.startsWith("(?:")) {
+      // A prefixed or suffixed part: `(?:<prefix>(<wildcard>)<suffix>)`.
+      pos = pos.slice(3);
+      while (tryConsumeText(pos)) {}
+      if (!tryConsumeGroup(pos)) return kj::none;
+      while (tryConsumeText(pos)) {}
+      if (!pos.startsWith(")")) return kj::none;
+      pos = pos.slice(1);
+    } else if (!tryConsumeGroup(pos)) {
+      return kj::none;
+    }
+
+    // Optional and repeated parts need backtracking.
+    if (pos.size() > 0 && (pos[0] == '?' || pos[0] == '*' || pos[0] == '+')) return kj::none;
+  }
+  flushText();
+
+  // Matching greedily gives the same answer as the regex only if no step could have given
+  // characters back: a segment must run up to its delimiter or the end of the input, and a full
+  // wildcard must come last.
+  for (auto i: kj::indices(steps)) {
+    auto& step = steps[i];
+    bool last = i + 1 == steps.size();
+    if (step.type == Type::REST && !last) return kj::none;
+    if (step.type == Type::SEGMENT && !last) {
+      KJ_IF_SOME(delimiter, step.delimiter) {
+        auto& next = steps[i + 1];
+        if (next.type != Type::TEXT || next.text[0] != delimiter) return kj::none;
+      } else {
+        return kj::none;
+      }
+    }
+  }
+
+  return ComponentMatcher(steps.releaseAsArray());
+}
+
+kj::Maybe<URLPattern::URLPatternComponentResult> URLPattern::ComponentMatcher::match(
+    kj::ArrayPtr<const kj::String> nameList, kj::StringPtr input) const {
+  using Groups = jsg::Dict<kj::String, kj::String>;
+
+  kj::Vector<Groups::Field> fields(nameList.size());
+  auto remaining = input;
+  for (auto& step: steps) {
+    switch (step.type) {
+      case Step::Type::TEXT: {
+        if (!remaining.startsWith(step.text)) return kj::none;
+        remaining = remaining.slice(step.text.size());
+        break;
+      }
+      case Step::Type::SEGMENT: {
+        size_t end = remaining.size();
+        KJ_IF_SOME(delimiter, step.delimiter) {
+          end = remaining.findFirst(delimiter).orDefault(end);
+        }
+        if (end == 0) return kj::none;
+        fields.add(Groups::Field{
+          .name = kj::str(nameList[fields.size()]),
+          .value = kj::str(remaining.first(end)),
+        });
+        remaining = remaining.slice(end);
+        break;
+      }
+      case Step::Type::REST: {
+        if (containsLineTerminator(remaining)) return kj::none;
+        fields.add(Groups::Field{
+          .name = kj::str(nameList[fields.size()]),
+          .value = kj::str(remaining),
+        });
+        remaining = ""_kj;
+        break;
+      }
+    }
+  }
+  if (remaining.size() > 0) return kj::none;
+
+  return URLPattern::URLPatternComponentResult{
+    .input = kj::str(input),
+    .groups = Groups{.fields = fields.releaseAsArray()},
+  };
+}
+
+URLPattern::URLPattern(jsg::Lock& js, jsg::UrlPattern inner): inner(kj::mv(inner)) {
+  bool ignoreCase = this->inner.getIgnoreCase();
+
+  // Only components the matcher can't handle need a regex, so a pattern made up entirely of
+  // fixed text, `:name` segments and `*` never touches the regex engine at all.
+#define V(Name, name)                                                                              \
+  name##Matcher = ComponentMatcher::tryCreate(this->inner.get##Name().getRegex(), ignoreCase);     \
+  if (name##Matcher == kj::none) {                                                                 \
+    name##Regex = compileRegex(js, this->inner.get##Name(), ignoreCase);                           \
+  }
+  URL_PATTERN_COMPONENTS(V)
+#undef V
+}
 
 void URLPattern::visitForGc(jsg::GcVisitor& visitor) {
   visitor.visit(protocolRegex, usernameRegex, passwordRegex, hostnameRegex, portRegex,
       pathnameRegex, searchRegex, hashRegex);
 }
 
+kj::Maybe<URLPattern::URLPatternComponentResult> URLPattern::execComponent(jsg::Lock& js,
+    kj::Maybe<ComponentMatcher>& matcher,
+    kj::Maybe<jsg::JsRef<jsg::JsRegExp>>& regex,
+    const jsg::UrlPattern::Component& component,
+    kj::StringPtr input) {
+  KJ_IF_SOME(m, matcher) {
+    return m.match(component.getNames(), input);
+  }
+  return execRegex(js, KJ_ASSERT_NONNULL(regex), component.getNames(), input);
+}
+
 kj::StringPtr URLPattern::getProtocol() {
   return inner.getProtocol().getPattern();
 }
@@ -121,6 +301,20 @@ kj::StringPtr URLPattern::getHash() {
   return inner.getHash().getPattern();
 }
 
+URLPattern::URLPatternInit URLPattern::URLPatternInit::clone() const {
+  return {
+    .protocol = this->protocol.map([](const kj::String& str) { return kj::str(str); }),
+    .username = this->username.map([](const kj::String& str) { return kj::str(str); }),
+    .password = this->password.map([](const kj::String& str) { return kj::str(str); }),
+    .hostname = this->hostname.map([](const kj::String& str) { return kj::str(str); }),
+    .port = this->port.map([](const kj::String& str) { return kj::str(str); }),
+    .pathname = this->pathname.map([](const kj::String& str) { return kj::str(str); }),
+    .search = this->search.map([](const kj::String& str) { return kj::str(str); }),
+    .hash = this->hash.map([](const kj::String& str) { return kj::str(str); }),
+    .baseURL = this->baseURL.map([](const kj::String& str) { return kj::str(str); }),
+  };
+}
+
 URLPattern::URLPatternInit::operator jsg::UrlPattern::Init() {
   return {
     .protocol = this->protocol.map([](kj::String& str) { return kj::str(str); }),
@@ -151,7 +345,7 @@ jsg::Ref<URLPattern> URLPattern::constructor(jsg::Lock& js,
           JSG_FAIL_REQUIRE(TypeError, kj::mv(err));
         }
         KJ_CASE_ONEOF(pattern, jsg::UrlPattern) {
-          return create(js, kj::mv(pattern));
+          return jsg::alloc<URLPattern>(js, kj::mv(pattern));
         }
       }
     }
@@ -164,7 +358,7 @@ jsg::Ref<URLPattern> URLPattern::constructor(jsg::Lock& js,
           JSG_FAIL_REQUIRE(TypeError, kj::mv(err));
         }
         KJ_CASE_ONEOF(pattern, jsg::UrlPattern) {
-          return create(js, kj::mv(pattern));
+          return jsg::alloc<URLPattern>(js, kj::mv(pattern));
         }
       }
     }
@@ -179,17 +373,20 @@ bool URLPattern::test(
 
 kj::Maybe<URLPattern::URLPatternResult> URLPattern::exec(
     jsg::Lock& js, jsg::Optional<URLPatternInput> maybeInput, jsg::Optional<kj::String> maybeBase) {
+  KJ_IF_SOME(input, parseInput(kj::mv(maybeInput), kj::mv(maybeBase))) {
+    KJ_IF_SOME(result, match(js, input)) {
+      result.inputs = kj::mv(input.inputs);
+      return kj::mv(result);
+    }
+  }
+  return kj::none;
+}
+
+kj::Maybe<URLPattern::ParsedInput> URLPattern::parseInput(
+    jsg::Optional<URLPatternInput> maybeInput, jsg::Optional<kj::String> maybeBase) {
   auto input = kj::mv(maybeInput).orDefault(URLPattern::URLPatternInit());
   kj::Vector<URLPattern::URLPatternInput> inputs(2);
-
-  kj::String protocol = nullptr;
-  kj::String username = nullptr;
-  kj::String password = nullptr;
-  kj::String hostname = nullptr;
-  kj::String port = nullptr;
-  kj::String pathname = nullptr;
-  kj::String search = nullptr;
-  kj::String hash = nullptr;
+  ParsedInput result;
 
   KJ_SWITCH_ONEOF(input) {
     KJ_CASE_ONEOF(string, kj::String) {
@@ -197,14 +394,15 @@ kj::Maybe<URLPattern::URLPatternResult> URLPattern::exec(
         return s.asPtr();
       }))) {
         auto p = url.getProtocol();
-        protocol = kj::str(p.first(p.size() - 1));
-        username = kj::str(url.getUsername());
-        password = kj::str(url.getPassword());
-        hostname = kj::str(url.getHostname());
-        port = kj::str(url.getPort());
-        pathname = kj::str(url.getPathname());
-        search = url.getSearch().size() > 0 ? kj::str(url.getSearch().slice(1)) : kj::String();
-        hash = url.getHash().size() > 0 ? kj::str(url.getHash().slice(1)) : kj::String();
+        result.protocol = kj::str(p.first(p.size() - 1));
+        result.username = kj::str(url.getUsername());
+        result.password = kj::str(url.getPassword());
+        result.hostname = kj::str(url.getHostname());
+        result.port = kj::str(url.getPort());
+        result.pathname = kj::str(url.getPathname());
+        result.search =
+            url.getSearch().size() > 0 ? kj::str(url.getSearch().slice(1)) : kj::String();
+        result.hash = url.getHash().size() > 0 ? kj::str(url.getHash().slice(1)) : kj::String();
       } else {
         return kj::none;
       }
@@ -216,17 +414,7 @@ kj::Maybe<URLPattern::URLPatternResult> URLPattern::exec(
     KJ_CASE_ONEOF(i, URLPattern::URLPatternInit) {
       JSG_REQUIRE(
           maybeBase == kj::none, TypeError, "A baseURL is not allowed when input is an object.");
-      inputs.add(URLPattern::URLPatternInit{
-        .protocol = i.protocol.map([](kj::String& str) { return kj::str(str); }),
-        .username = i.username.map([](kj::String& str) { return kj::str(str); }),
-        .password = i.password.map([](kj::String& str) { return kj::str(str); }),
-        .hostname = i.hostname.map([](kj::String& str) { return kj::str(str); }),
-        .port = i.port.map([](kj::String& str) { return kj::str(str); }),
-        .pathname = i.pathname.map([](kj::String& str) { return kj::str(str); }),
-        .search = i.search.map([](kj::String& str) { return kj::str(str); }),
-        .hash = i.hash.map([](kj::String& str) { return kj::str(str); }),
-        .baseURL = i.baseURL.map([](kj::String& str) { return kj::str(str); }),
-      });
+      inputs.add(i.clone());
 
       jsg::UrlPattern::Init init = {
         .protocol = kj::mv(i.protocol),
@@ -248,27 +436,25 @@ kj::Maybe<URLPattern::URLPatternResult> URLPattern::exec(
           JSG_FAIL_REQUIRE(TypeError, kj::mv(err));
         }
         KJ_CASE_ONEOF(init, jsg::UrlPattern::Init) {
-          protocol = kj::mv(init.protocol).orDefault(kj::String());
-          username = kj::mv(init.username).orDefault(kj::String());
-          password = kj::mv(init.password).orDefault(kj::String());
-          hostname = kj::mv(init.hostname).orDefault(kj::String());
-          port = kj::mv(init.port).orDefault(kj::String());
-          pathname = kj::mv(init.pathname).orDefault(kj::String());
-          search = kj::mv(init.search).orDefault(kj::String());
-          hash = kj::mv(init.hash).orDefault(kj::String());
+#define V(_, name) result.name = kj::mv(init.name).orDefault(kj::String());
+          URL_PATTERN_COMPONENTS(V)
+#undef V
         }
       }
     }
   }
 
-  auto protocolExecResult = execRegex(js, protocolRegex, inner.getProtocol().getNames(), protocol);
-  auto usernameExecResult = execRegex(js, usernameRegex, inner.getUsername().getNames(), username);
-  auto passwordExecResult = execRegex(js, passwordRegex, inner.getPassword().getNames(), password);
-  auto hostnameExecResult = execRegex(js, hostnameRegex, inner.getHostname().getNames(), hostname);
-  auto portExecResult = execRegex(js, portRegex, inner.getPort().getNames(), port);
-  auto pathnameExecResult = execRegex(js, pathnameRegex, inner.getPathname().getNames(), pathname);
-  auto searchExecResult = execRegex(js, searchRegex, inner.getSearch().getNames(), search);
-  auto hashExecResult = execRegex(js, hashRegex, inner.getHash().getNames(), hash);
+  result.inputs = inputs.releaseAsArray();
+  return kj::mv(result);
+}
+
+kj::Maybe<URLPattern::URLPatternResult> URLPattern::match(
+    jsg::Lock& js, const ParsedInput& input) {
+#define V(Name, name)                                                                              \
+  auto name##ExecResult =                                                                          \
+      execComponent(js, name##Matcher, name##Regex, inner.get##Name(), input.name);
+  URL_PATTERN_COMPONENTS(V)
+#undef V
 
   if (protocolExecResult == kj::none || usernameExecResult == kj::none ||
       passwordExecResult == kj::none || hostnameExecResult == kj::none ||
@@ -277,8 +463,9 @@ kj::Maybe<URLPattern::URLPatternResult> URLPattern::exec(
     return kj::none;
   }
 
+  // The caller fills in `inputs`, since a URLPatternList shares one ParsedInput across patterns.
   return URLPattern::URLPatternResult{
-    .inputs = inputs.releaseAsArray(),
+    .inputs = nullptr,
     .protocol = kj::mv(KJ_REQUIRE_NONNULL(protocolExecResult)),
     .username = kj::mv(KJ_REQUIRE_NONNULL(usernameExecResult)),
     .password = kj::mv(KJ_REQUIRE_NONNULL(passwordExecResult)),
@@ -289,4 +476,104 @@ kj::Maybe<URLPattern::URLPatternResult> URLPattern::exec(
     .hash = kj::mv(KJ_REQUIRE_NONNULL(hashExecResult)),
   };
 }
+
+URLPatternList::URLPatternList(kj::Array<jsg::Ref<URLPattern>> patternsParam)
+    : patterns(kj::mv(patternsParam)) {
+  for (auto i: kj::indices(patterns)) {
+    auto& inner = patterns[i]->inner;
+    auto prefix = literalPrefix(inner.getPathname().getRegex(), inner.getIgnoreCase());
+    TrieNode* node = &root;
+    for (char c: prefix) {
+      node = node->children.findOrCreate(c, [&]() {
+        return kj::HashMap<char, kj::Own<TrieNode>>::Entry{c, kj::heap<TrieNode>()};
+      }).get();
+    }
+    node->patterns.add(i);
+  }
+}
+
+jsg::Ref<URLPatternList> URLPatternList::constructor(jsg::Lock& js,
+    kj::Array<Pattern> patterns,
+    jsg::Optional<kj::String> baseURL,
+    jsg::Optional<URLPattern::URLPatternOptions> options) {
+  auto compiled = KJ_MAP(pattern, patterns) -> jsg::Ref<URLPattern> {
+    KJ_SWITCH_ONEOF(pattern) {
+      KJ_CASE_ONEOF(ref, jsg::Ref<URLPattern>) {
+        return kj::mv(ref);
+      }
+      KJ_CASE_ONEOF(str, kj::String) {
+        return URLPattern::constructor(js, URLPattern::URLPatternInput(kj::mv(str)),
+            baseURL.map([](kj::String& s) { return kj::str(s); }), options);
+      }
+      KJ_CASE_ONEOF(init, URLPattern::URLPatternInit) {
+        return URLPattern::constructor(
+            js, URLPattern::URLPatternInput(kj::mv(init)), kj::none, options);
+      }
+    }
+    KJ_UNREACHABLE;
+  };
+  return jsg::alloc<URLPatternList>(kj::mv(compiled));
+}
+
+kj::Array<uint32_t> URLPatternList::candidatesFor(kj::StringPtr pathname) {
+  kj::Vector<uint32_t> result;
+  TrieNode* node = &root;
+  result.addAll(node->patterns);
+  for (char c: pathname) {
+    KJ_IF_SOME(child, node->children.find(c)) {
+      node = child.get();
+      result.addAll(node->patterns);
+    } else {
+      break;
+    }
+  }
+  std::sort(result.begin(), result.end());
+  return result.releaseAsArray();
+}
+
+kj::Maybe<URLPatternList::URLPatternListResult> URLPatternList::exec(jsg::Lock& js,
+    jsg::Optional<URLPattern::URLPatternInput> input,
+    jsg::Optional<kj::String> baseURL) {
+  KJ_IF_SOME(parsed, URLPattern::parseInput(kj::mv(input), kj::mv(baseURL))) {
+    for (auto i: candidatesFor(parsed.pathname)) {
+      KJ_IF_SOME(result, patterns[i]->match(js, parsed)) {
+        result.inputs = kj::mv(parsed.inputs);
+        return URLPatternListResult{.index = i, .result = kj::mv(result)};
+      }
+    }
+  }
+  return kj::none;
+}
+
+kj::Array<URLPatternList::URLPatternListResult> URLPatternList::execAll(jsg::Lock& js,
+    jsg::Optional<URLPattern::URLPatternInput> input,
+    jsg::Optional<kj::String> baseURL) {
+  kj::Vector<URLPatternListResult> results;
+  KJ_IF_SOME(parsed, URLPattern::parseInput(kj::mv(input), kj::mv(baseURL))) {
+    for (auto i: candidatesFor(parsed.pathname)) {
+      KJ_IF_SOME(result, patterns[i]->match(js, parsed)) {
+        result.inputs = KJ_MAP(original, parsed.inputs) -> URLPattern::URLPatternInput {
+          KJ_SWITCH_ONEOF(original) {
+            KJ_CASE_ONEOF(str, kj::String) {
+              return kj::str(str);
+            }
+            KJ_CASE_ONEOF(init, URLPattern::URLPatternInit) {
+              return init.clone();
+            }
+          }
+          KJ_UNREACHABLE;
+        };
+        results.add(URLPatternListResult{.index = i, .result = kj::mv(result)});
+      }
+    }
+  }
+  return results.releaseAsArray();
+}
+
+bool URLPatternList::test(jsg::Lock& js,
+    jsg::Optional<URLPattern::URLPatternInput> input,
+    jsg::Optional<kj::String> baseURL) {
+  return exec(js, kj::mv(input), kj::mv(baseURL)) != kj::none;
+}
+
 }  // namespace workerd::api
@@ -7,6 +7,10 @@
 #include <workerd/jsg/jsg.h>
 #include <workerd/jsg/url.h>
 
+#include <kj/map.h>
+#include <kj/table.h>
+#include <kj/vector.h>
+
 namespace workerd::api {
 
 #define URL_PATTERN_COMPONENTS(V)                                                                  \
@@ -19,6 +23,59 @@ namespace workerd::api {
   V(Search, search)                                                                                \
   V(Hash, hash)
 
+// A per-isolate cache of the regexes that URLPattern compiles for its components, owned by the
+// Worker::Isolate and keyed by the generated regex source plus flags.
+//
+// Routers tend to construct the same patterns on every request, and the components of a pattern
+// set overlap heavily (most patterns leave six or seven components as `*`), so without the cache
+// each construction compiles the same handful of regexes over again. A RegExp object is never
+// exposed to the application, so any number of URLPatterns may share one. The cache is bounded by
+// entry count and evicts the least recently used entry.
+class URLPatternRegexCache {
+ public:
+  explicit URLPatternRegexCache(size_t maxEntries = 1024): maxEntries(maxEntries) {}
+  KJ_DISALLOW_COPY_AND_MOVE(URLPatternRegexCache);
+
+  // Returns a new reference to the regex compiled from `source` with `flags`, compiling and
+  // caching it on a miss. A hit makes the entry the most recently used. Throws a JS exception if
+  // `source` is not a valid regex.
+  jsg::JsRef<jsg::JsRegExp> getOrCompile(
+      jsg::Lock& js, kj::StringPtr source, jsg::Lock::RegExpFlags flags);
+
+  // Drops every entry. The isolate calls this under its lock before tearing down V8.
+  void clear() {
+    entries.clear();
+  }
+
+  size_t size() const {
+    return entries.size();
+  }
+
+ private:
+  struct Entry {
+    kj::String key;
+    jsg::JsRef<jsg::JsRegExp> regex;
+  };
+
+  struct EntryCallbacks {
+    kj::StringPtr keyForRow(const Entry& entry) const {
+      return entry.key;
+    }
+    bool matches(const Entry& entry, kj::StringPtr key) const {
+      return entry.key == key;
+    }
+    uint hashCode(kj::StringPtr key) const {
+      return kj::hashCode(key);
+    }
+  };
+
+  size_t maxEntries;
+
+  // Iterating the insertion-order index visits the least recently used entry first, since hits
+  // are moved to the back.
+  kj::Table<Entry, kj::HashIndex<EntryCallbacks>, kj::InsertionOrderIndex> entries;
+};
+
 // URLPattern is a Web Platform standard API for matching URLs against a
 // pattern syntax (think of it as a regular expression for URLs). It is
 // defined in https://wicg.github.io/urlpattern.
@@ -41,6 +98,8 @@ class URLPattern final: public jsg::Object {
     JSG_STRUCT(protocol, username, password, hostname, port, pathname, search, hash, baseURL);
 
     operator jsg::UrlPattern::Init();
+
+    URLPatternInit clone() const;
   };
 
   using URLPatternInput = kj::OneOf<kj::String, URLPatternInit>;
@@ -75,11 +134,7 @@ class URLPattern final: public jsg::Object {
     JSG_STRUCT(ignoreCase);
   };
 
-  explicit URLPattern(jsg::UrlPattern inner
-#define V(_, name) , jsg::JsRef<jsg::JsRegExp> name##Regex
-          URL_PATTERN_COMPONENTS(V)
-#undef V
-  );
+  URLPattern(jsg::Lock& js, jsg::UrlPattern inner);
 
   static jsg::Ref<URLPattern> constructor(jsg::Lock& js,
       jsg::Optional<URLPatternInput> input,
@@ -108,16 +163,156 @@ class URLPattern final: public jsg::Object {
   }
 
  private:
+  // Matches a component whose pattern is built only from fixed text, `:name` segments, and a
+  // trailing `*`, which covers the bulk of routing patterns, without running the regex engine.
+  // The steps are recovered from the component's generated regex so that the match is exactly
+  // what the regex would produce.
+  class ComponentMatcher {
+   public:
+    // Returns kj::none if the regex uses anything beyond the supported subset, or if the pattern
+    // ignores case, in which case the component must be matched with the regex.
+    static kj::Maybe<ComponentMatcher> tryCreate(kj::StringPtr regex, bool ignoreCase);
+
+    kj::Maybe<URLPatternComponentResult> match(
+        kj::ArrayPtr<const kj::String> nameList, kj::StringPtr input) const;
+
+   private:
+    struct Step {
+      enum class Type {
+        // `text` must appear verbatim.
+        TEXT,
+        // One or more characters other than `delimiter`, captured as a group.
+        SEGMENT,
+        // Everything up to the end of the input, captured as a group. Always the last step.
+        REST,
+      };
+      Type type;
+      kj::String text;
+      kj::Maybe<char> delimiter;
+    };
+
+    kj::Array<Step> steps;
+
+    explicit ComponentMatcher(kj::Array<Step> steps): steps(kj::mv(steps)) {}
+  };
+
+  // An exec() input broken into its components, parsed once and shared by every pattern that a
+  // URLPatternList tries against it.
+  struct ParsedInput {
+    kj::Array<URLPatternInput> inputs;
+#define V(_, name) kj::String name;
+    URL_PATTERN_COMPONENTS(V)
+#undef V
+  };
+
+  // Returns kj::none if the input is a string that does not parse as a URL.
+  static kj::Maybe<ParsedInput> parseInput(
+      jsg::Optional<URLPatternInput> input, jsg::Optional<kj::String> baseURL);
+
+  // Matches every component against `input`. The result's `inputs` is left for the caller to fill.
+  kj::Maybe<URLPatternResult> match(jsg::Lock& js, const ParsedInput& input);
+
   jsg::UrlPattern inner;
-#define V(_, name) jsg::JsRef<jsg::JsRegExp> name##Regex;
+
+  // A component has a matcher or a compiled regex, never both.
+#define V(_, name)                                                                                 \
+  kj::Maybe<ComponentMatcher> name##Matcher;                                                       \
+  kj::Maybe<jsg::JsRef<jsg::JsRegExp>> name##Regex;
   URL_PATTERN_COMPONENTS(V)
 #undef V
 
+  kj::Maybe<URLPatternComponentResult> execComponent(jsg::Lock& js,
+      kj::Maybe<ComponentMatcher>& matcher,
+      kj::Maybe<jsg::JsRef<jsg::JsRegExp>>& regex,
+      const jsg::UrlPattern::Component& component,
+      kj::StringPtr input);
+
   void visitForGc(jsg::GcVisitor& visitor);
+
+  friend class URLPatternList;
+};
+
+// URLPatternList is a non-standard router over a list of URLPatterns. Routers that call test() on
+// each of N patterns re-parse the input URL N times and run every pattern's regexes; the list
+// parses the input once, and files patterns in a trie keyed by the fixed text each pathname
+// pattern starts with, so that only patterns whose prefix the input's pathname shares are tried
+// at all.
+class URLPatternList final: public jsg::Object {
+ public:
+  using Pattern = kj::OneOf<jsg::Ref<URLPattern>, kj::String, URLPattern::URLPatternInit>;
+
+  // A match, along with the position in the list of the pattern that matched.
+  struct URLPatternListResult final {
+    uint32_t index;
+    URLPattern::URLPatternResult result;
+
+    JSG_STRUCT(index, result);
+  };
+
+  explicit URLPatternList(kj::Array<jsg::Ref<URLPattern>> patterns);
+
+  // Patterns given as strings or URLPatternInits are compiled with `baseURL` and `options`, as
+  // if passed to the URLPattern constructor.
+  static jsg::Ref<URLPatternList> constructor(jsg::Lock& js,
+      kj::Array<Pattern> patterns,
+      jsg::Optional<kj::String> baseURL,
+      jsg::Optional<URLPattern::URLPatternOptions> options);
+
+  // Returns the first pattern in list order that matches.
+  kj::Maybe<URLPatternListResult> exec(jsg::Lock& js,
+      jsg::Optional<URLPattern::URLPatternInput> input,
+      jsg::Optional<kj::String> baseURL);
+
+  // Returns every pattern that matches, in list order.
+  kj::Array<URLPatternListResult> execAll(jsg::Lock& js,
+      jsg::Optional<URLPattern::URLPatternInput> input,
+      jsg::Optional<kj::String> baseURL);
+
+  bool test(jsg::Lock& js,
+      jsg::Optional<URLPattern::URLPatternInput> input,
+      jsg::Optional<kj::String> baseURL);
+
+  uint32_t getLength() {
+    return patterns.size();
+  }
+
+  JSG_RESOURCE_TYPE(URLPatternList) {
+    JSG_READONLY_PROTOTYPE_PROPERTY(length, getLength);
+    JSG_METHOD(test);
+    JSG_METHOD(exec);
+    JSG_METHOD(execAll);
+  }
+
+  void visitForMemoryInfo(jsg::MemoryTracker& tracker) const {
+    for (auto& pattern: patterns) {
+      tracker.trackField("pattern", pattern);
+    }
+  }
+
+ private:
+  struct TrieNode {
+    // Indices of the patterns whose pathname prefix ends at this node.
+    kj::Vector<uint32_t> patterns;
+    kj::HashMap<char, kj::Own<TrieNode>> children;
+  };
+
+  kj::Array<jsg::Ref<URLPattern>> patterns;
+  TrieNode root;
+
+  // Returns the indices of the patterns whose pathname prefix `pathname` starts with, in list
+  // order. Only these can match.
+  kj::Array<uint32_t> candidatesFor(kj::StringPtr pathname);
+
+  void visitForGc(jsg::GcVisitor& visitor) {
+    for (auto& pattern: patterns) {
+      visitor.visit(pattern);
+    }
+  }
 };
 
 #define EW_URLPATTERN_ISOLATE_TYPES                                                                \
   api::URLPattern, api::URLPattern::URLPatternInit, api::URLPattern::URLPatternComponentResult,    \
-      api::URLPattern::URLPatternResult, api::URLPattern::URLPatternOptions
+      api::URLPattern::URLPatternResult, api::URLPattern::URLPatternOptions,                      \
+      api::URLPatternList, api::URLPatternList::URLPatternListResult
 
 }  // namespace workerd::api
@@ -4,6 +4,7 @@
 
 #include "util.h"
 
+#include <kj/encoding.h>
 #include <kj/test.h>
 
 namespace workerd::api {
@@ -156,5 +157,40 @@ KJ_TEST("readContentTypeParameter can fetch boundary parameter") {
       "multipart/form-data; foo=bar ;boundary=\"asdf\""_kj, "boundary"_kj, "asdf"_kj);
 }
 
+KJ_TEST("withoutContextTakeover") {
+  KJ_EXPECT(withoutContextTakeover("permessage-deflate") ==
+      "permessage-deflate; server_no_context_takeover; client_no_context_takeover");
+  KJ_EXPECT(withoutContextTakeover("permessage-deflate; client_max_window_bits, x-other; a=1") ==
+      "permessage-deflate; client_max_window_bits; server_no_context_takeover; "
+      "client_no_context_takeover, x-other; a=1");
+  KJ_EXPECT(withoutContextTakeover("Permessage-Deflate; Server_No_Context_Takeover") ==
+      "Permessage-Deflate; Server_No_Context_Takeover; client_no_context_takeover");
+  KJ_EXPECT(withoutContextTakeover(
+                "permessage-deflate; server_no_context_takeover; client_no_context_takeover") ==
+      "permessage-deflate; server_no_context_takeover; client_no_context_takeover");
+  KJ_EXPECT(withoutContextTakeover("") == "");
+}
+
+KJ_TEST("fastEncodeBase64Into matches kj::encodeBase64") {
+  auto input = kj::heapArray<byte>(70);
+  for (auto i: kj::indices(input)) {
+    input[i] = static_cast<byte>(i * 37 + 11);
+  }
+
+  for (size_t size: {0, 1, 2, 3, 4, 5, 32, 70}) {
+    auto bytes = input.first(size);
+    auto expected = kj::encodeBase64(bytes);
+    KJ_EXPECT(base64EncodedLength(size) == expected.size(), size);
+
+    // Encode into a larger buffer to check nothing past the encoded length is touched.
+    auto out = kj::heapArray<char>(expected.size() + 4);
+    out.fill('*');
+    auto written = fastEncodeBase64Into(bytes, out);
+    KJ_EXPECT(written == expected.size(), size);
+    KJ_EXPECT(kj::str(out.first(written)) == expected, size);
+    KJ_EXPECT(kj::str(out.slice(written)) == "****", size);
+  }
+}
+
 }  // namespace
 }  // namespace workerd::api
@@ -53,6 +53,63 @@ kj::Maybe<kj::String> readContentTypeParameter(kj::StringPtr contentType, kj::St
   return kj::none;
 }
 
+namespace {
+
+kj::ArrayPtr<const char> trimSpaces(kj::ArrayPtr<const char> str) {
+  while (str.size() > 0 && (str.front() == ' ' || str.front() == '\t')) str = str.slice(1);
+  while (str.size() > 0 && (str.back() == ' ' || str.back() == '\t')) {
+    str = str.first(str.size() - 1);
+  }
+  return str;
+}
+
+// Calls `func` with each `delimiter`-separated part of `str`, trimmed.
+template <typename Func>
+void forEachPart(kj::ArrayPtr<const char> str, char delimiter, Func&& func) {
+  while (true) {
+    KJ_IF_SOME(pos, str.findFirst(delimiter)) {
+      func(trimSpaces(str.first(pos)));
+      str = str.slice(pos + 1);
+    } else {
+      func(trimSpaces(str));
+      return;
+    }
+  }
+}
+
+}  // namespace
+
+kj::String withoutContextTakeover(kj::StringPtr extensions) {
+  kj::Vector<kj::String> result;
+  forEachPart(extensions, ',', [&](kj::ArrayPtr<const char> extension) {
+    if (extension.size() == 0) return;
+
+    bool isDeflate = true;
+    bool first = true;
+    bool hasServer = false;
+    bool hasClient = false;
+    forEachPart(extension, ';', [&](kj::ArrayPtr<const char> param) {
+      auto name = toLower(param);
+      if (first) {
+        isDeflate = name == "permessage-deflate";
+        first = false;
+      } else if (name == "server_no_context_takeover") {
+        hasServer = true;
+      } else if (name == "client_no_context_takeover") {
+        hasClient = true;
+      }
+    });
+
+    if (!isDeflate) {
+      result.add(kj::str(extension));
+      return;
+    }
+    result.add(kj::str(extension, hasServer ? "" : "; server_no_context_takeover",
+        hasClient ? "" : "; client_no_context_takeover"));
+  });
+  return kj::strArray(result, ", ");
+}
+
 kj::Maybe<kj::Exception> translateKjException(
     const kj::Exception& exception, std::initializer_list<ErrorTranslation> translations) {
   for (auto& t: translations) {
@@ -227,6 +284,19 @@ kj::String fastEncodeBase64Url(kj::ArrayPtr<const byte> bytes) {
   return kj::String(kj::mv(output));
 }
 
+size_t base64EncodedLength(size_t size) {
+  return simdutf::base64_length_from_binary(size, simdutf::base64_default);
+}
+
+size_t fastEncodeBase64Into(kj::ArrayPtr<const byte> bytes, kj::ArrayPtr<char> out) {
+  KJ_REQUIRE(out.size() >= base64EncodedLength(bytes.size()), "base64 output buffer too small");
+  if (KJ_UNLIKELY(bytes.size() == 0)) {
+    return 0;
+  }
+  return simdutf::binary_to_base64(
+      bytes.asChars().begin(), bytes.size(), out.begin(), simdutf::base64_default);
+}
+
 kj::Array<char16_t> fastEncodeUtf16(kj::ArrayPtr<const char> bytes) {
   if (KJ_UNLIKELY(bytes.size() == 0)) {
     return {};
@@ -49,6 +49,11 @@ void parseQueryString(kj::Vector<kj::Url::QueryParam>& query,
 kj::Maybe<kj::String> readContentTypeParameter(kj::StringPtr contentType, kj::StringPtr param);
 // TODO(cleanup): Replace this function with a full kj::MimeType parser.
 
+// Adds `server_no_context_takeover` and `client_no_context_takeover` to every permessage-deflate
+// entry of a Sec-WebSocket-Extensions value that doesn't already have them. Other extensions are
+// kept as they are.
+kj::String withoutContextTakeover(kj::StringPtr extensions);
+
 // =======================================================================================
 
 struct ErrorTranslation {
@@ -85,6 +90,14 @@ kj::String redactUrl(kj::StringPtr url);
 void maybeWarnIfNotText(jsg::Lock& js, kj::StringPtr str);
 
 kj::String fastEncodeBase64Url(kj::ArrayPtr<const byte> bytes);
+
+// Returns the length of the standard (padded) base64 encoding of `size` bytes.
+size_t base64EncodedLength(size_t size);
+
+// Encodes `bytes` as standard padded base64 into the front of `out`, which must have room for at
+// least base64EncodedLength(bytes.size()) chars. Returns the number of chars written. No NUL
+// terminator is added. Lets callers encode into a larger buffer without an intermediate copy.
+size_t fastEncodeBase64Into(kj::ArrayPtr<const byte> bytes, kj::ArrayPtr<char> out);
 kj::Array<char16_t> fastEncodeUtf16(kj::ArrayPtr<const char> bytes);
 
 }  // namespace workerd::api
@@ -5,6 +5,7 @@
 #include "web-socket.h"
 
 #include "events.h"
+#include "util.h"
 
 #include <workerd/io/features.h>
 #include <workerd/io/io-context.h>
@@ -137,6 +138,22 @@ void WebSocket::initConnection(jsg::Lock& js, kj::Promise<PackedWebSocket> prom)
 
 namespace {
 
+// The bytes a message adds to `bufferedAmount`. Like in browsers, Close messages don't count.
+size_t countBufferedBytes(const kj::WebSocket::Message& message) {
+  KJ_SWITCH_ONEOF(message) {
+    KJ_CASE_ONEOF(text, kj::String) {
+      return text.size();
+    }
+    KJ_CASE_ONEOF(data, kj::Array<byte>) {
+      return data.size();
+    }
+    KJ_CASE_ONEOF(close, kj::WebSocket::Close) {
+      return 0;
+    }
+  }
+  KJ_UNREACHABLE;
+}
+
 // See item 10 of https://datatracker.ietf.org/doc/html/rfc6455#section-4.1
 bool validProtoToken(const kj::StringPtr protocol) {
   if (kj::size(protocol) == 0) {
@@ -243,7 +260,10 @@ jsg::Ref<WebSocket> WebSocket::constructor(jsg::Lock& js,
   auto connUrl = urlRecord.toString();
   auto ws = jsg::alloc<WebSocket>(kj::mv(url));
 
-  headers.set(kj::HttpHeaderId::SEC_WEBSOCKET_EXTENSIONS, kj::str("permessage-deflate"));
+  headers.set(kj::HttpHeaderId::SEC_WEBSOCKET_EXTENSIONS,
+      FeatureFlags::get(js).getWebSocketNoContextTakeover()
+          ? withoutContextTakeover("permessage-deflate")
+          : kj::str("permessage-deflate"));
   // By default, browsers set the compression extension header for `new WebSocket()`.
 
   if (!FeatureFlags::get(js).getWebSocketCompression()) {
@@ -538,7 +558,33 @@ void WebSocket::startReadLoop(jsg::Lock& js, kj::Maybe<kj::Own<InputGate::Critic
   })));
 }
 
-void WebSocket::send(jsg::Lock& js, kj::OneOf<kj::Array<byte>, kj::String> message) {
+void WebSocket::send(
+    jsg::Lock& js, kj::OneOf<jsg::Ref<Blob>, kj::Array<byte>, kj::String> message) {
+  KJ_SWITCH_ONEOF(message) {
+    KJ_CASE_ONEOF(blob, jsg::Ref<Blob>) {
+      if (!FeatureFlags::get(js).getWebSocketSendBlob()) {
+        // Before Blobs were accepted, they were coerced to a string like any other object.
+        auto handle = KJ_ASSERT_NONNULL(blob.tryGetHandle(js));
+        return sendMessage(js, jsg::JsValue(handle).toString(js));
+      }
+      // A Blob's contents never change, so rather than copying them, the message borrows them
+      // and keeps the Blob alive until it has been written.
+      auto data = blob->getData();
+      auto bytes = kj::arrayPtr(const_cast<byte*>(data.begin()), data.size());
+      return sendMessage(js, bytes.attach(kj::mv(blob)));
+    }
+    KJ_CASE_ONEOF(data, kj::Array<byte>) {
+      // An ArrayBuffer may be modified as soon as send() returns, so jsg has already copied it.
+      return sendMessage(js, kj::mv(data));
+    }
+    KJ_CASE_ONEOF(text, kj::String) {
+      return sendMessage(js, kj::mv(text));
+    }
+  }
+  KJ_UNREACHABLE;
+}
+
+void WebSocket::sendMessage(jsg::Lock& js, kj::WebSocket::Message message) {
   auto& native = *farNative;
   JSG_REQUIRE(!native.closedOutgoing, TypeError, "Can't call WebSocket send() after close().");
   if (native.outgoingAborted || native.state.is<Released>()) {
@@ -564,26 +610,13 @@ void WebSocket::send(jsg::Lock& js, kj::OneOf<kj::Array<byte>, kj::String> messa
       "messages.");
 
   auto maybeOutputLock = IoContext::current().waitForOutputLocksIfNecessary();
-  auto msg = [&]() -> kj::WebSocket::Message {
-    KJ_SWITCH_ONEOF(message) {
-      KJ_CASE_ONEOF(text, kj::String) {
-        return kj::mv(text);
-        break;
-      }
-      KJ_CASE_ONEOF(data, kj::Array<byte>) {
-        return kj::mv(data);
-        break;
-      }
-    }
-
-    KJ_UNREACHABLE;
-  }();
+  native.bufferedAmount += countBufferedBytes(message);
 
   auto pendingAutoResponses =
       autoResponseStatus.pendingAutoResponseDeque.size() - autoResponseStatus.queuedAutoResponses;
   autoResponseStatus.queuedAutoResponses = autoResponseStatus.pendingAutoResponseDeque.size();
   outgoingMessages->insert(
-      GatedMessage{kj::mv(maybeOutputLock), kj::mv(msg), pendingAutoResponses});
+      GatedMessage{kj::mv(maybeOutputLock), kj::mv(message), pendingAutoResponses});
 
   ensurePumping(js);
 }
@@ -665,6 +698,10 @@ int WebSocket::getReadyState() {
   return READY_STATE_OPEN;
 }
 
+size_t WebSocket::getBufferedAmount() {
+  return farNative->bufferedAmount;
+}
+
 bool WebSocket::isAccepted() {
   return farNative->state.is<Accepted>();
 }
@@ -863,6 +900,7 @@ kj::Promise<void> WebSocket::pump(IoContext& context,
     // Either we were already through all our outgoing messages or we experienced failure/
     // cancellation and cannot send these anyway.
     outgoingMessages.clear();
+    native.bufferedAmount = 0;
 
     autoResponse.isPumping = false;
 
@@ -909,6 +947,8 @@ kj::Promise<void> WebSocket::pump(IoContext& context,
       }
     }
 
+    native.bufferedAmount -= countBufferedBytes(gatedMessage.message);
+
     KJ_IF_SOME(o, observer) {
       o->sentMessage(size);
     }
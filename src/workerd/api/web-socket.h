@@ -5,6 +5,7 @@
 #pragma once
 
 #include "basics.h"
+#include "blob.h"
 
 #include <workerd/io/io-gate.h>
 #include <workerd/io/observer.h>
@@ -372,7 +373,11 @@ class WebSocket: public EventTarget {
   // share code.
   void startReadLoop(jsg::Lock& js, kj::Maybe<kj::Own<InputGate::CriticalSection>> cs);
 
-  void send(jsg::Lock& js, kj::OneOf<kj::Array<byte>, kj::String> message);
+  void send(jsg::Lock& js, kj::OneOf<jsg::Ref<Blob>, kj::Array<byte>, kj::String> message);
+
+  // Queues a message that C++ code has already prepared, with the same checks as send(). The
+  // message's bytes may be borrowed from a buffer that outlives the send, e.g. with `attach()`.
+  void sendMessage(jsg::Lock& js, kj::WebSocket::Message message);
   void close(jsg::Lock& js, jsg::Optional<int> code, jsg::Optional<kj::String> reason);
 
   // Used to get/set the attachment for hibernation.
@@ -396,6 +401,10 @@ class WebSocket: public EventTarget {
 
   int getReadyState();
 
+  // The number of bytes that send() has queued but that haven't been written to the connection
+  // yet.
+  size_t getBufferedAmount();
+
   bool isAccepted();
   bool isReleased();
 
@@ -437,11 +446,13 @@ class WebSocket: public EventTarget {
       JSG_READONLY_PROTOTYPE_PROPERTY(url, getUrl);
       JSG_READONLY_PROTOTYPE_PROPERTY(protocol, getProtocol);
       JSG_READONLY_PROTOTYPE_PROPERTY(extensions, getExtensions);
+      JSG_READONLY_PROTOTYPE_PROPERTY(bufferedAmount, getBufferedAmount);
     } else {
       JSG_READONLY_INSTANCE_PROPERTY(readyState, getReadyState);
       JSG_READONLY_INSTANCE_PROPERTY(url, getUrl);
       JSG_READONLY_INSTANCE_PROPERTY(protocol, getProtocol);
       JSG_READONLY_INSTANCE_PROPERTY(extensions, getExtensions);
+      JSG_READONLY_INSTANCE_PROPERTY(bufferedAmount, getBufferedAmount);
     }
 
     JSG_TS_DEFINE(type WebSocketEventMap = {
@@ -594,6 +605,9 @@ class WebSocket: public EventTarget {
     // Have we detected that the peer has stopped accepting messages? We may want to clean up more
     // proactively in this case.
     bool outgoingAborted = false;
+
+    // Total size of the text and binary messages in outgoingMessages, plus the one being written.
+    size_t bufferedAmount = 0;
   };
 
   // The underlying native WebSocket (or a promise that will emplace one).
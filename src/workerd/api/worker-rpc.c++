@@ -168,6 +168,7 @@ void serializeJsValue(jsg::Lock& js,
         .omitHeader = false,
         .treatClassInstancesAsPlainObjects = false,
         .externalHandler = externalHandler,
+        .maxSize = MAX_JS_RPC_MESSAGE_SIZE,
       });
   serializer.write(js, value);
   kj::Array<const byte> data = serializer.release().data;
@@ -185,8 +186,8 @@ void serializeJsValue(jsg::Lock& js,
   rpc::JsValue::Builder builder = makeBuilder(hint);
 
   // TODO(perf): It would be nice if we could serialize directly into the capnp message to avoid
-  // a redundant copy of the bytes here. Maybe we could even cancel serialization early if it
-  // goes over the size limit.
+  // a redundant copy of the bytes here. We can't know the size of the message before serializing,
+  // and growing a Data orphan in place would leave the abandoned space in the message.
   builder.setV8Serialized(data);
 
   if (externalHandler.size() > 0) {
@@ -481,27 +482,35 @@ JsRpcPromiseAndPipleine callImpl(jsg::Lock& js,
         client = lock.then([client = kj::mv(client)]() mutable { return kj::mv(client); });
       }
 
-      auto builder = client.callRequest();
-
-      // This code here is slightly overcomplicated in order to avoid pushing anything to the
-      // kj::Vector in the common case that the parent path is empty. I'm probably trying too hard
-      // but oh well.
-      if (path.empty()) {
-        KJ_IF_SOME(n, name) {
-          builder.setMethodName(n);
+      // The request is created lazily, so that when there are arguments the message can be sized
+      // up front from the serialized size of the arguments.
+      kj::Maybe<capnp::Request<rpc::JsRpcTarget::CallParams, rpc::JsRpcTarget::CallResults>>
+          maybeBuilder;
+      auto initRequest = [&](kj::Maybe<capnp::MessageSize> hint) -> auto& {
+        auto& builder = maybeBuilder.emplace(client.callRequest(hint));
+
+        // This code here is slightly overcomplicated in order to avoid pushing anything to the
+        // kj::Vector in the common case that the parent path is empty. I'm probably trying too
+        // hard but oh well.
+        if (path.empty()) {
+          KJ_IF_SOME(n, name) {
+            builder.setMethodName(n);
+          } else {
+            // No name and no path, must be directly calling a stub.
+            builder.initMethodPath(0);
+          }
         } else {
-          // No name and no path, must be directly calling a stub.
-          builder.initMethodPath(0);
-        }
-      } else {
-        auto pathBuilder = builder.initMethodPath(path.size() + (name != kj::none));
-        for (auto i: kj::indices(path)) {
-          pathBuilder.set(i, path[i]);
-        }
-        KJ_IF_SOME(n, name) {
-          pathBuilder.set(path.size(), n);
+          auto pathBuilder = builder.initMethodPath(path.size() + (name != kj::none));
+          for (auto i: kj::indices(path)) {
+            pathBuilder.set(i, path[i]);
+          }
+          KJ_IF_SOME(n, name) {
+            pathBuilder.set(path.size(), n);
+          }
         }
-      }
+
+        return builder;
+      };
 
       kj::Maybe<StreamSinkFulfiller> paramsStreamSinkFulfiller;
 
@@ -518,8 +527,15 @@ JsRpcPromiseAndPipleine callImpl(jsg::Lock& js,
           auto arr = v8::Array::New(js.v8Isolate, argv.data(), argv.size());
 
           serializeJsValue(js, jsg::JsValue(arr), [&](capnp::MessageSize hint) {
-            // TODO(perf): Actually use the size hint.
-            return builder.getOperation().initCallWithArgs();
+            hint.wordCount += capnp::sizeInWords<rpc::JsRpcTarget::CallParams>();
+            for (auto& part: path) {
+              hint.wordCount += part.size() / sizeof(capnp::word) + 2;
+            }
+            KJ_IF_SOME(n, name) {
+              hint.wordCount += n.size() / sizeof(capnp::word) + 2;
+            }
+            hint.capCount += 1;  // for resultsStreamSink
+            return initRequest(hint).getOperation().initCallWithArgs();
           }, [&]() -> rpc::JsValue::StreamSink::Client {
             // A stream was encountered in the params, so we must expect the response to contain
             // paramsStreamSink. But we don't have the response yet. So, we need to set up a
@@ -531,8 +547,14 @@ JsRpcPromiseAndPipleine callImpl(jsg::Lock& js,
         }
       } else {
         // This is a property access.
-        builder.getOperation().setGetProperty();
+        initRequest(kj::none).getOperation().setGetProperty();
+      }
+
+      if (maybeBuilder == kj::none) {
+        // A call with no arguments.
+        initRequest(kj::none);
       }
+      auto& builder = KJ_ASSERT_NONNULL(maybeBuilder);
 
       // Unfortunately, we always have to send a `resultsStreamSink` because we don't know until
       // after the call completes whether or not it will return any streams. If it's unused,
@@ -540,6 +562,13 @@ JsRpcPromiseAndPipleine callImpl(jsg::Lock& js,
       auto resultStreamSink = kj::refcounted<StreamSinkImpl>();
       builder.setResultsStreamSink(kj::addRef(*resultStreamSink));
 
+      // Note that we deliberately send each call as its own capnp call, even when an application
+      // fans out many calls to the same stub in one turn (e.g. `Promise.all(items.map(stub.foo))`).
+      // Packing several operations into one call would give them a single shared result, which
+      // breaks per-call promise pipelining (each call's `callPipeline` and `paramsStreamSink`), and
+      // would make one slow or failing call hold up or fail its siblings. The transport already
+      // coalesces the cost that matters: the two-party network queues outgoing messages and writes
+      // everything sent in the same turn together, so fan-out does not cost one syscall per call.
       auto callResult = builder.send();
 
       KJ_IF_SOME(ssf, paramsStreamSinkFulfiller) {
@@ -1174,7 +1203,7 @@ class JsRpcTargetBase: public rpc::JsRpcTarget::Server {
       jsg::JsObject object,
       rpc::JsRpcTarget::CallParams::Reader callParams,
       bool allowInstanceProperties) {
-    auto prototypeOfObject = KJ_ASSERT_NONNULL(js.obj().getPrototype(js).tryCast<jsg::JsObject>());
+    auto prototypeOfObject = js.getObjectPrototype();
 
     // Get the named property of `object`.
     auto getProperty = [&](kj::StringPtr kjName) {
@@ -1517,7 +1546,7 @@ static MakeCallPipeline::Result makeCallPipeline(jsg::Lock& js, jsg::JsValue val
             kj::heap<TransientJsRpcTarget>(js, IoContext::current(), js.obj(), kj::none, true))});
     });
 
-    if (obj.getPrototype(js) == js.obj().getPrototype(js)) {
+    if (obj.getPrototype(js) == js.getObjectPrototype()) {
       // It's a plain object.
       kj::Maybe<v8::Local<v8::Function>> maybeDispose;
       jsg::JsValue disposeProperty = obj.get(js, js.symbolDispose());
@@ -1619,9 +1648,7 @@ void RpcSerializerExternalHander::serializeProxy(
     // function here. Luckily, you really don't need to use a `Proxy` to wrap a function... you
     // can just use a function.
 
-    // TODO(perf): We should really cache `prototypeOfObject` somewhere so we don't have to create
-    //   an object to get it. (We do this other places in this file, too...)
-    auto prototypeOfObject = KJ_ASSERT_NONNULL(js.obj().getPrototype(js).tryCast<jsg::JsObject>());
+    auto prototypeOfObject = js.getObjectPrototype();
     auto prototypeOfRpcTarget = js.getPrototypeFor<JsRpcTarget>();
     bool allowInstanceProperties = false;
     auto proto = handle.getPrototype(js);
@@ -210,6 +210,7 @@ struct ActorCacheTestOptions {
   size_t maxKeysPerRpc = 128;
   bool noCache = false;
   bool neverFlush = false;
+  size_t flushWindowBytes = 0;
 };
 
 struct ActorCacheTest: public ActorCacheConvenienceWrappers {
@@ -234,7 +235,7 @@ struct ActorCacheTest: public ActorCacheConvenienceWrappers {
         ws(loop),
         mockStorage(kj::mv(mockPair.mock)),
         lru({options.softLimit, options.hardLimit, options.staleTimeout, options.dirtyListByteLimit,
-          options.maxKeysPerRpc, options.noCache, options.neverFlush}),
+          options.maxKeysPerRpc, options.noCache, options.neverFlush, options.flushWindowBytes}),
         cache(kj::mv(mockPair.client), lru, gate),
         gateBrokenPromise(options.monitorOutputGate ? eagerlyReportExceptions(gate.onBroken())
                                                     : kj::Promise<void>(kj::READY_NOW)) {}
@@ -690,6 +691,33 @@ KJ_TEST("ActorCache batching due to maxKeysPerRpc") {
   KJ_EXPECT(deleteProm3.wait(ws) == 2);
 }
 
+KJ_TEST("ActorCache batches are paced by flushWindowBytes") {
+  // A window of one byte means each batch must complete before the next one is sent.
+  ActorCacheTest test({.maxKeysPerRpc = 2, .flushWindowBytes = 1});
+  auto& ws = test.ws;
+  auto& mockStorage = test.mockStorage;
+
+  test.put({{"foo", "123"}, {"bar", "456"}, {"baz", "789"}});
+
+  auto mockTxn = mockStorage->expectCall("txn", ws).returnMock("transaction");
+  auto firstPut = mockTxn->expectCall("put", ws).withParams(
+      CAPNP(entries = [ (key = "foo", value = "123"), (key = "bar", value = "456") ]));
+
+  // The second batch is held back until the first one completes.
+  mockTxn->expectNoActivity(ws);
+  kj::mv(firstPut).thenReturn(CAPNP());
+
+  auto secondPut =
+      mockTxn->expectCall("put", ws).withParams(CAPNP(entries = [(key = "baz", value = "789")]));
+
+  // The transaction isn't committed until the last batch has been sent, and the commit itself
+  // isn't subject to the window.
+  auto commitCall = mockTxn->expectCall("commit", ws);
+  kj::mv(secondPut).thenReturn(CAPNP());
+  kj::mv(commitCall).thenReturn(CAPNP());
+  mockTxn->expectDropped(ws);
+}
+
 KJ_TEST("ActorCache batching due to max storage RPC words") {
   ActorCacheTest test({.hardLimit = 128 * 1024 * 1024});
   auto& ws = test.ws;
@@ -3609,6 +3637,48 @@ KJ_TEST("ActorCache LRU purge ordering") {
   KJ_ASSERT(KJ_ASSERT_NONNULL(expectCached(test.get("yyy"))) == "bbb");
 }
 
+KJ_TEST("ActorCache LRU purge keeps preceding gap known-empty") {
+  auto kilobyte = kj::str(kj::repeat('x', 1024));
+  ActorCacheTest test({.softLimit = 1024 + 4 * ENTRY_SIZE});
+  auto& ws = test.ws;
+  auto& mockStorage = test.mockStorage;
+
+  {
+    auto promise = expectUncached(test.list("bar", "qux"));
+
+    mockStorage->expectCall("list", ws)
+        .withParams(CAPNP(start = "bar", end = "qux"), "stream"_kj)
+        .useCallback("stream", [&](MockClient stream) {
+      stream.call("values", kj::str("(list = [(key = \"baz\", value = \"", kilobyte, "\")])"))
+          .expectReturns(CAPNP(), ws);
+      stream.call("end", CAPNP()).expectReturns(CAPNP(), ws);
+    }).expectCanceled();
+
+    KJ_ASSERT(promise.wait(ws) == kvs({{"baz", kilobyte}}));
+  }
+
+  // Touch the negative entry at the start of the range, so that "baz" is evicted before it.
+  KJ_ASSERT(expectCached(test.get("bar")) == nullptr);
+
+  // Write two new values to push things out.
+  test.put("xxx", "aaa");
+  test.put("yyy", "bbb");
+
+  mockStorage->expectCall("put", ws).thenReturn(CAPNP());
+  test.gate.wait().wait(ws);
+
+  // The value of "baz" was evicted, but the gap between "bar" and "baz" is still known-empty.
+  KJ_ASSERT(expectCached(test.get("bas")) == nullptr);
+
+  {
+    auto promise = expectUncached(test.get("baz"));
+    mockStorage->expectCall("get", ws)
+        .withParams(CAPNP(key = "baz"))
+        .thenReturn(kj::str("(value = \"", kilobyte, "\")"));
+    KJ_ASSERT(KJ_ASSERT_NONNULL(promise.wait(ws)) == kilobyte);
+  }
+}
+
 KJ_TEST("ActorCache LRU purge larger") {
   ActorCacheTest test({.softLimit = 32 * ENTRY_SIZE});
   auto& ws = test.ws;
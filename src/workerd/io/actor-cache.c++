@@ -9,6 +9,7 @@
 #include <workerd/jsg/exception.h>
 #include <workerd/util/duration-exceeded-logger.h>
 #include <workerd/util/sentry.h>
+#include <workerd/util/use-perfetto-categories.h>
 
 #include <kj/debug.h>
 
@@ -295,17 +296,28 @@ bool ActorCache::SharedLru::evictIfNeeded(Lock& lock) const {
     }
 
     Entry& entry = lock->front();
+    if (entry.recentlyUsed) {
+      // Read since it was last considered, give it a second chance. This terminates since each
+      // entry only gets one second chance per pass.
+      entry.recentlyUsed = false;
+      lock->remove(entry);
+      lock->add(entry);
+      continue;
+    }
+
     auto& cache = KJ_ASSERT_NONNULL(entry.maybeCache);
     cache.removeEntry(lock, entry);
-    cache.evictEntry(lock, entry);
+    cache.evictEntry(lock, entry, /*keepPrecedingGap=*/true);
   }
 }
 
 void ActorCache::touchEntry(Lock& lock, Entry& entry) {
   if (entry.getSyncStatus() == EntrySyncStatus::CLEAN) {
+    // Rather than moving the entry to the end of the clean list, which would touch the list
+    // links of its neighbors, just mark it. SharedLru::evictIfNeeded() will move it to the end
+    // if and when it reaches the front.
     entry.isStale = false;
-    lock->remove(entry);
-    addToCleanList(lock, entry);
+    entry.recentlyUsed = true;
   }
 
   // We only call `touchEntry` when the operation or the LRU has !noCache, so we want to cache this.
@@ -335,27 +347,40 @@ void ActorCache::removeEntry(Lock& lock, Entry& entry) {
   entry.setNotInCache();
 }
 
-void ActorCache::evictEntry(Lock& lock, Entry& entry) {
+void ActorCache::evictEntry(Lock& lock, Entry& entry, bool keepPrecedingGap) {
   auto& map = currentValues.get(lock);
   auto ordered = map.ordered();
   auto iter = map.seek(entry.key);
 
   KJ_ASSERT(iter != ordered.end() && iter->get() == &entry);
 
-  // If the previous entry has gapIsKnownEmpty, we need to set that false, because when we delete
-  // this entry, the previous entry's "gap" will now extend to the *next* entry. We definitely know
-  // that that the new gap is non-empty because we're evicting an entry inside that very gap.
+  // If the previous entry has gapIsKnownEmpty, we can't just delete this entry, because then the
+  // previous entry's "gap" would extend to the *next* entry, and we definitely know that the new
+  // gap is non-empty because we're evicting an entry inside that very gap.
   //
-  // TODO(perf): Maybe we should instead replace the evicted entry with an UNKNOWN entry in this
-  //   case? The problem is, when the app accesses a key in the gap, the LRU time of the previous
-  //   entry gets bumped, but the _next_ entry does not get bumped. Hence these accesses won't
-  //   prevent the next entry from being evicted, and when it is, the gap effectively gets evicted
-  //   too, leading to a cache miss on a key that had been recently accessed. This is a pretty
-  //   obscure scenario, though, and after one cache miss the key would then be in cache again.
+  // If `keepPrecedingGap` is true, and dropping the value frees more memory than it costs, we
+  // instead replace the evicted entry with an UNKNOWN entry, which drops the value but keeps the
+  // previous gap known-empty. This matters because accesses to the previous entry don't bump the
+  // LRU time of this entry, so when this entry is evicted, the gap effectively gets evicted too,
+  // leading to cache misses on keys that had been recently accessed (e.g. by repeated list()s
+  // over a sparse range). The UNKNOWN entry is itself a clean entry in the LRU, so gap knowledge
+  // can't grow without bound: when the UNKNOWN entry is evicted in turn, it's simply erased.
   if (iter != ordered.begin()) {
     auto prev = iter;
     --prev;
-    prev->get()->gapIsKnownEmpty = false;
+    if (prev->get()->gapIsKnownEmpty) {
+      size_t markerSize = sizeof(Entry) + entry.key.size();
+      if (keepPrecedingGap && entry.getValueStatus() == EntryValueStatus::PRESENT &&
+          entry.size() > 2 * markerSize && !lru.options.noCache) {
+        auto marker =
+            kj::atomicRefcounted<Entry>(*this, cloneKey(entry.key), EntryValueStatus::UNKNOWN);
+        addToCleanList(lock, *marker);
+        *iter = kj::mv(marker);
+        return;
+      }
+
+      prev->get()->gapIsKnownEmpty = false;
+    }
   }
 
   map.erase(*iter);
@@ -772,6 +797,8 @@ class ActorCache::ForwardListStreamImpl final: public rpc::ActorStorage::ListStr
     {
       auto lock = cache.lru.cleanList.lockExclusive();
       auto list = context.getParams().getList();
+      cache.reserveForReadResults(lock, list.size(), options);
+      fetchedEntries.reserve(fetchedEntries.size() + list.size());
 
       bool insertedAny = false;
 
@@ -1150,6 +1177,8 @@ class ActorCache::ReverseListStreamImpl final: public rpc::ActorStorage::ListStr
     {
       auto lock = cache.lru.cleanList.lockExclusive();
       auto list = context.getParams().getList();
+      cache.reserveForReadResults(lock, list.size(), options);
+      fetchedEntries.reserve(fetchedEntries.size() + list.size());
 
       bool insertedAny = false;
 
@@ -1482,6 +1511,18 @@ kj::Own<ActorCache::Entry> ActorCache::findInCache(
   }
 }
 
+void ActorCache::reserveForReadResults(Lock& lock, size_t count, const ReadOptions& options) {
+  if (options.noCache) {
+    // addReadResultToCache() won't insert anything.
+    return;
+  }
+
+  // Grow the table and its index once for the whole batch, rather than repeatedly as entries are
+  // inserted one at a time.
+  auto& map = currentValues.get(lock);
+  map.reserve(map.size() + count);
+}
+
 kj::Own<ActorCache::Entry> ActorCache::addReadResultToCache(
     Lock& lock, Key key, kj::Maybe<capnp::Data::Reader> maybeReader, const ReadOptions& options) {
   if (options.noCache) {
@@ -1518,8 +1559,8 @@ kj::Own<ActorCache::Entry> ActorCache::addReadResultToCache(
 
     entry = kj::atomicRefcounted<Entry>(*this, kj::mv(key), EntryValueStatus::ABSENT);
     // TODO(perf): It's a little sad that we are going to do a findOrCreate() below that is going
-    //   to repeat the same lookup that produced `iter`. Maybe we could extend kj::Table with a
-    //   way to provide an existing iterator as a hint when inserting?
+    //   to repeat the same lookup that produced `iter`. Avoiding that needs kj::Table to accept
+    //   an existing iterator as a hint when inserting, which is a change to KJ itself.
   }
 
   // At this point, we know we definitely want there to exist an entry matching this key. So now
@@ -2194,10 +2235,15 @@ void ActorCache::ensureFlushScheduled(const WriteOptions& options) {
       flushScheduledWithOutputGate = false;
     })).then([this]() {
       ++flushesEnqueued;
+      // Flushes run one after another, so they can share the cache's track.
+      TRACE_EVENT_BEGIN("workerd.storage", "ActorCache flush", PERFETTO_TRACK_FROM_POINTER(this));
       return kj::evalNow([this]() {
         // `flushImpl()` can throw, so we need to wrap it in `evalNow()` to observe all pathways.
         return flushImpl();
-      }).attach(kj::defer([this]() { --flushesEnqueued; }));
+      }).attach(kj::defer([this]() {
+        --flushesEnqueued;
+        TRACE_EVENT_END("workerd.storage", PERFETTO_TRACK_FROM_POINTER(this));
+      }));
     });
 
     if (options.allowUnconfirmed) {
@@ -2324,11 +2370,9 @@ kj::Promise<void> ActorCache::startFlushTransaction() {
   // muted deletes, we go ahead and construct batches of no more than 128 keys. They all end up
   // being part of the same transaction in the end, though.
   //
-  // TODO(perf): Currently we send all the batches at the same time. If the batches are large,
-  //   it could be worth spacing them out a bit so we don't saturate the connection. However, we
-  //   still need to make sure that the whole transaction represents a consistent snapshot in time,
-  //   so getting this right, without making a copy of everything upfront, could get complicated.
-  //   Punting for now.
+  // If a transaction has many batches, flushImplUsingTxn() can pace them according to
+  // `options.flushWindowBytes`. The batches' contents are all copied into RPC messages upfront,
+  // so the transaction still represents a consistent snapshot in time.
 
   PutFlush putFlush;
   MutedDeleteFlush mutedDeleteFlush;
@@ -2692,8 +2736,8 @@ kj::Promise<void> ActorCache::flushImplUsingSinglePut(PutFlush putFlush) {
   putFlush.batches.clear();
   {
     auto writeObserver = recordStorageWrite(hooks, clock);
-    util::DurationExceededLogger logger(
-        clock, 1 * kj::SECONDS, "storage operation took longer than expected: single put");
+    static util::SlowOperationSite slowOpSite("actor storage: single put", 1 * kj::SECONDS);
+    util::SlowOperationTimer slowOpTimer(slowOpSite, clock);
     co_await request.send().ignoreResult();
   }
 }
@@ -2719,8 +2763,8 @@ kj::Promise<void> ActorCache::flushImplUsingSingleMutedDelete(MutedDeleteFlush m
 
   {
     auto writeObserver = recordStorageWrite(hooks, clock);
-    util::DurationExceededLogger logger(
-        clock, 1 * kj::SECONDS, "storage operation took longer than expected: muted delete");
+    static util::SlowOperationSite slowOpSite("actor storage: muted delete", 1 * kj::SECONDS);
+    util::SlowOperationTimer slowOpTimer(slowOpSite, clock);
     co_await request.send().ignoreResult();
   }
 }
@@ -2745,8 +2789,8 @@ kj::Promise<void> ActorCache::flushImplUsingSingleCountedDelete(CountedDeleteFlu
   countedFlush.batches.clear();
 
   auto writeObserver = recordStorageWrite(hooks, clock);
-  util::DurationExceededLogger logger(
-      clock, 1 * kj::SECONDS, "storage operation took longer than expected: counted delete");
+  static util::SlowOperationSite slowOpSite("actor storage: counted delete", 1 * kj::SECONDS);
+  util::SlowOperationTimer slowOpTimer(slowOpSite, clock);
   auto response = co_await request.send();
   countedDelete->countDeleted += response.getNumDeleted();
   countedDelete->isFinished = true;
@@ -2754,8 +2798,8 @@ kj::Promise<void> ActorCache::flushImplUsingSingleCountedDelete(CountedDeleteFlu
 
 kj::Promise<void> ActorCache::flushImplAlarmOnly(DirtyAlarm dirty) {
   auto writeObserver = recordStorageWrite(hooks, clock);
-  util::DurationExceededLogger logger(
-      clock, 1 * kj::SECONDS, "storage operation took longer than expected: set/delete alarm");
+  static util::SlowOperationSite slowOpSite("actor storage: set/delete alarm", 1 * kj::SECONDS);
+  util::SlowOperationTimer slowOpTimer(slowOpSite, clock);
 
   // TODO(someday) This could be templated to reuse the same code for this and the transaction case.
   // Handle alarm writes first, since they're simplest.
@@ -2882,7 +2926,7 @@ kj::Promise<void> ActorCache::flushImplUsingTxn(PutFlush putFlush,
   // The constant extra 2 promises are those added outside of the rpc batches, currently one
   // to work around a bug in capnp::autoreconnect, and one to actually commit the flush txn
   // A 3rd promise may be added to write the alarm time if necessary.
-  auto promises = kj::heapArrayBuilder<kj::Promise<void>>(rpcPuts.size() + rpcMutedDeletes.size() +
+  kj::Vector<kj::Promise<void>> promises(rpcPuts.size() + rpcMutedDeletes.size() +
       rpcCountedDeletes.size() + 2 + !maybeAlarmChange.is<CleanAlarm>());
 
   auto joinCountedDelete = [](RpcCountedDelete& rpcCountedDelete) -> kj::Promise<void> {
@@ -2910,16 +2954,59 @@ kj::Promise<void> ActorCache::flushImplUsingTxn(PutFlush putFlush,
     rpcCountedDelete.countedDelete->completedInTransaction = true;
   };
 
+  struct PendingSend {
+    size_t bytes;
+    kj::Function<kj::Promise<void>()> send;
+  };
+  auto requestBytes = [](auto& request) -> size_t {
+    return request.totalSize().wordCount * sizeof(capnp::word);
+  };
+  kj::Vector<PendingSend> sends(promises.capacity());
+
   for (auto& rpcCountedDelete: rpcCountedDeletes) {
-    promises.add(joinCountedDelete(rpcCountedDelete));
+    size_t bytes = 0;
+    for (auto& request: rpcCountedDelete.rpcDeletes) {
+      bytes += requestBytes(request);
+    }
+    sends.add(PendingSend{.bytes = bytes, .send = [&joinCountedDelete, &rpcCountedDelete]() {
+      return joinCountedDelete(rpcCountedDelete);
+    }});
   }
 
   for (auto& request: rpcMutedDeletes) {
-    promises.add(request.send().ignoreResult());
+    sends.add(PendingSend{.bytes = requestBytes(request),
+      .send = [&request]() { return request.send().ignoreResult(); }});
   }
 
   for (auto& request: rpcPuts) {
-    promises.add(request.send().ignoreResult());
+    sends.add(PendingSend{.bytes = requestBytes(request),
+      .send = [&request]() { return request.send().ignoreResult(); }});
+  }
+
+  // If a flush window is configured, hold back each batch until the batches still in flight add
+  // up to less than the window, so that a huge flush doesn't monopolize the storage connection.
+  // This doesn't affect atomicity: everything is still part of the one transaction, which is only
+  // committed after the last batch is sent. We wait for the oldest batch in flight, since batches
+  // on the same connection tend to complete in order.
+  {
+    size_t windowBytes = lru.options.flushWindowBytes;
+    kj::Vector<kj::Promise<void>> inFlight(sends.size());
+    kj::Vector<size_t> inFlightSizes(sends.size());
+    size_t inFlightBytes = 0;
+    size_t oldestInFlight = 0;
+    for (auto& pending: sends) {
+      while (windowBytes > 0 && inFlightBytes > 0 && inFlightBytes + pending.bytes > windowBytes) {
+        co_await kj::mv(inFlight[oldestInFlight]);
+        inFlightBytes -= inFlightSizes[oldestInFlight];
+        ++oldestInFlight;
+      }
+      inFlight.add(pending.send().eagerlyEvaluate(nullptr));
+      inFlightSizes.add(pending.bytes);
+      inFlightBytes += pending.bytes;
+    }
+    for (auto i: kj::range(oldestInFlight, inFlight.size())) {
+      promises.add(kj::mv(inFlight[i]));
+    }
   }
 
   KJ_SWITCH_ONEOF(maybeAlarmChange) {
@@ -2969,11 +3056,12 @@ kj::Promise<void> ActorCache::flushImplUsingTxn(PutFlush putFlush,
 
   {
     auto writeObserver = recordStorageWrite(hooks, clock);
-    util::DurationExceededLogger logger(clock, 1 * kj::SECONDS,
-        "storage operation took longer than expected: commit flush transaction");
+    static util::SlowOperationSite slowOpSite(
+        "actor storage: commit flush transaction", 1 * kj::SECONDS);
+    util::SlowOperationTimer slowOpTimer(slowOpSite, clock);
     promises.add(txn.commitRequest(capnp::MessageSize{4, 0}).send().ignoreResult());
 
-    co_await kj::joinPromises(promises.finish());
+    co_await kj::joinPromises(promises.releaseAsArray());
     for (auto& rpcCountedDelete: rpcCountedDeletes) {
       // Now that the transaction has successfully completed, we can mark all our CountedDeletes
       // as having completed as well.
@@ -44,6 +44,10 @@ struct ActorCacheWriteOptions {
   // Until the value is safely on disk, the dirty value will be used to fulfill reads for the same
   // key.  Hence, `noCache` does not affect consistency, only performance.
   bool noCache = false;
+
+  // Only used by deleteAll(). Allows the returned count to be an estimate, if counting the keys
+  // exactly would be expensive.
+  bool estimateDeleteAllCount = false;
 };
 
 // Common interface between ActorCache and ActorCache::Transaction.
@@ -494,30 +498,36 @@ class ActorCache final: public ActorCacheInterface {
       }
     }
 
-    bool isStale = false;
-    bool flushStarted = false;
+    // The flags below are bitfields since there are typically a very large number of entries, many
+    // of them tiny, so that every byte of `Entry` adds up.
+    bool isStale: 1 = false;
+    bool flushStarted: 1 = false;
+
+    // If CLEAN, set when the entry is read, to give it a second chance when it reaches the front
+    // of the clean list. See `touchEntry()`.
+    bool recentlyUsed: 1 = false;
 
     // If true, then a past list() operation covered the space between this entry and the following
     // entry, meaning that we know for sure that there are no other keys on disk between them.
-    bool gapIsKnownEmpty = false;
+    bool gapIsKnownEmpty: 1 = false;
 
     // If true, then this entry should be evicted from cache immediately when it becomes CLEAN.
     // The entry still needs to reside in cache while DIRTY since we need to store it
     // somewhere, and so we might as well serve cache hits based on it in the meantime.
-    bool noCache = false;
+    bool noCache: 1 = false;
 
     // In the DIRTY state, if this entry was originally created as the result of a
     // `delete()` call, and as such the caller needs to receive a count of deletions, then this
     // tracks that need. Note that only one caller could ever be waiting on this, because
     // subsequent delete() calls can be counted based on the cache content. This can be false
     // if no delete operations need a count from this entry.
-    bool isCountedDelete = false;
+    bool isCountedDelete: 1 = false;
 
     // This Entry is part of a CountedDelete, but has since been overwritten via a put().
     // This is really only useful in determining if we need to retry the deletion of this entry from
     // storage, since we're interested in the number of deleted records. If we already got the count,
     // we won't include this entry as part of our retried delete.
-    bool overwritingCountedDelete = false;
+    bool overwritingCountedDelete: 1 = false;
 
     // If CLEAN, the entry will be in the SharedLru's `cleanList`.
     //
@@ -728,7 +738,11 @@ class ActorCache final: public ActorCacheInterface {
   kj::ForkedPromise<void> lastFlush = kj::Promise<void>(kj::READY_NOW).fork();
   // TODO(perf): If we could rely on e-order on the ActorStorage API, we could pipeline additional
   //   writes and not have to worry about this. However, at present, ActorStorage has automatic
-  //   reconnect behavior at the supervisor layer which violates e-order.
+  //   reconnect behavior at the supervisor layer which violates e-order. Sequence-numbering each
+  //   transaction would let the storage server reject or reorder out-of-order commits after a
+  //   reconnect, but that needs support on the server side first. On the cache side, note that
+  //   `Entry::flushStarted` and the `dirtyList` -> clean transition in flushImpl() also assume
+  //   only one flush is in flight, so each in-flight batch would need to track its own entries.
 
   // Did we hit a problem that makes the ActorCache unusable? If so this is the exception that
   // describes the problem.
@@ -744,6 +758,7 @@ class ActorCache final: public ActorCacheInterface {
   // This doesn't do much, but it makes it easier to track what's going on.
   void addToCleanList(Lock& listLock, Entry& entryRef) {
     entryRef.setClean();
+    entryRef.recentlyUsed = false;
     listLock->add(entryRef);
   }
 
@@ -754,8 +769,8 @@ class ActorCache final: public ActorCacheInterface {
     dirtyList.add(entryRef);
   }
 
-  // Indicate that an entry was observed by a read operation and so should be moved to the end of
-  // the LRU queue.
+  // Indicate that an entry was observed by a read operation and so should be treated as
+  // recently-used by the LRU queue.
   void touchEntry(Lock& lock, Entry& entry);
 
   // TODO(soon) This function mostly belongs on the SharedLru, not the ActorCache. Notably,
@@ -778,6 +793,10 @@ class ActorCache final: public ActorCacheInterface {
   kj::Own<Entry> addReadResultToCache(
       Lock& lock, Key key, kj::Maybe<capnp::Data::Reader> value, const ReadOptions& readOptions);
 
+  // Prepare to add a batch of `count` read results (e.g. one chunk of a list() stream) to the cache
+  // via addReadResultToCache().
+  void reserveForReadResults(Lock& lock, size_t count, const ReadOptions& readOptions);
+
   // Mark all gaps empty between the begin and end key.
   void markGapsEmpty(Lock& lock, KeyPtr begin, kj::Maybe<KeyPtr> end, const ReadOptions& options);
 
@@ -843,8 +862,11 @@ class ActorCache final: public ActorCacheInterface {
       CountedDeleteFlushes countedDeleteFlushes,
       MaybeAlarmChange maybeAlarmChange);
 
-  // Carefully remove a clean entry from `currentValues`, making sure to update gaps.
-  void evictEntry(Lock& lock, Entry& entry);
+  // Carefully remove a clean entry from `currentValues`, making sure to update gaps. If
+  // `keepPrecedingGap` is true, the entry may be replaced by an UNKNOWN entry rather than removed,
+  // so that the previous entry's known-empty gap survives. This is used for memory-pressure
+  // eviction, where the entry may still be part of a recently-used range.
+  void evictEntry(Lock& lock, Entry& entry, bool keepPrecedingGap = false);
 
   // Drop the entire cache. Called during destructor and on OOM.
   void clear(Lock& lock);
@@ -968,6 +990,12 @@ struct ActorCacheSharedLruOptions {
   // If true, don't actually flush anything. This is used in preview sessions, since they keep
   // state strictly in memory.
   bool neverFlush = false;
+
+  // When a flush transaction is split into multiple batches, the maximum number of bytes worth of
+  // batches to have in flight at once. Further batches are sent as earlier ones complete. A
+  // single batch larger than this is still sent on its own. Zero means no limit, i.e. all the
+  // batches are sent at once.
+  size_t flushWindowBytes = 0;
 };
 
 class ActorCache::SharedLru {
@@ -988,7 +1016,10 @@ class ActorCache::SharedLru {
   const Options options;
 
   // List of clean values, across all caches, ordered from least-recently-used to
-  // most-recently-used.
+  // most-recently-used. Reads don't move entries within the list; they only set the entry's
+  // `recentlyUsed` bit, and eviction moves such entries to the back instead of evicting them
+  // (i.e. this is a "second chance" / CLOCK approximation of LRU). This keeps the work done while
+  // holding the lock on the read path to a minimum.
   kj::MutexGuarded<kj::List<Entry, &Entry::link>> cleanList;
 
   // Total byte size of everything that is cached, including dirty values that aren't in `cleanList`.
@@ -77,9 +77,17 @@ struct ActorSqliteTest final {
       return kj::mv(promise);
     }
 
+    kj::Maybe<kj::Promise<void>> delayImplicitCommit() override {
+      if (!parent.groupCommit) return kj::none;
+      auto [promise, fulfiller] = kj::newPromiseAndFulfiller<void>();
+      parent.calls.add(Call{kj::str("delayImplicitCommit"), kj::mv(fulfiller)});
+      return kj::mv(promise);
+    }
+
     ActorSqliteTest& parent;
   };
   kj::Maybe<kj::Function<kj::Promise<void>(kj::Maybe<kj::Date>)>> scheduleRunHandler;
+  bool groupCommit = false;
   ActorSqliteTestHooks hooks = ActorSqliteTestHooks(*this);
 
   ActorSqlite actor;
@@ -190,6 +198,33 @@ KJ_TEST("storage op without alarm change does not wait on scheduler") {
   KJ_ASSERT(expectSync(test.getAlarm()) == kj::none);
 }
 
+KJ_TEST("group commit coalesces writes from several turns") {
+  ActorSqliteTest test;
+  test.groupCommit = true;
+
+  test.put("foo", "bar");
+  auto delay = kj::mv(test.pollAndExpectCalls({"delayImplicitCommit"})[0]);
+
+  // Gate is blocked until the grouped commit completes.
+  auto gateWait = test.gate.wait();
+  KJ_ASSERT(!gateWait.poll(test.ws));
+
+  // A write in a later turn joins the implicit transaction that is already open.
+  test.put("baz", "qux");
+  test.pollAndExpectCalls({});
+  KJ_ASSERT(test.actor.isCommitScheduled());
+
+  delay->fulfill();
+  auto commitFulfiller = kj::mv(test.pollAndExpectCalls({"commit"})[0]);
+  KJ_ASSERT(!gateWait.poll(test.ws));
+  commitFulfiller->fulfill();
+  KJ_ASSERT(gateWait.poll(test.ws));
+  test.pollAndExpectCalls({});
+
+  KJ_ASSERT(KJ_ASSERT_NONNULL(expectSync(test.get("foo"))) == kj::str("bar").asBytes());
+  KJ_ASSERT(KJ_ASSERT_NONNULL(expectSync(test.get("baz"))) == kj::str("qux").asBytes());
+}
+
 KJ_TEST("alarm scheduling starts synchronously before implicit local db commit") {
   ActorSqliteTest test;
 
@@ -200,8 +200,18 @@ void ActorSqlite::onWrite() {
   if (currentTxn.is<NoTxn>()) {
     auto txn = kj::heap<ImplicitTxn>(*this);
 
+    // Writes made before the commit runs join this same transaction, since `currentTxn` remains
+    // set. Normally that just means the rest of this turn, but the hooks may extend it to group
+    // several events' writes into one commit.
+    kj::Promise<void> readyToCommit = nullptr;
+    KJ_IF_SOME(delay, hooks.delayImplicitCommit()) {
+      readyToCommit = kj::mv(delay);
+    } else {
+      readyToCommit = kj::evalLater([]() {});
+    }
+
     commitTasks.add(outputGate.lockWhile(
-        kj::evalLater([this, txn = kj::mv(txn)]() mutable -> kj::Promise<void> {
+        readyToCommit.then([this, txn = kj::mv(txn)]() mutable -> kj::Promise<void> {
       // Don't commit if shutdown() has been called.
       requireNotBroken();
 
@@ -378,10 +388,10 @@ kj::OneOf<ActorCacheOps::GetResultList, kj::Promise<ActorCacheOps::GetResultList
   requireNotBroken();
 
   kj::Vector<KeyValuePair> results;
-  for (auto& key: keys) {
-    kv.get(
-        key, [&](ValuePtr value) { results.add(KeyValuePair{kj::mv(key), kj::heapArray(value)}); });
-  }
+  auto keyPtrs = KJ_MAP(key, keys) -> KeyPtr { return key; };
+  kv.getMultiple(keyPtrs, [&](KeyPtr key, ValuePtr value) {
+    results.add(KeyValuePair{kj::str(key), kj::heapArray(value)});
+  });
   std::sort(results.begin(), results.end(), [](auto& a, auto& b) { return a.key < b.key; });
   return GetResultList(kj::mv(results));
 }
@@ -441,9 +451,10 @@ kj::Maybe<kj::Promise<void>> ActorSqlite::put(Key key, Value value, WriteOptions
 kj::Maybe<kj::Promise<void>> ActorSqlite::put(kj::Array<KeyValuePair> pairs, WriteOptions options) {
   requireNotBroken();
 
-  for (auto& pair: pairs) {
-    kv.put(pair.key, pair.value);
-  }
+  auto pairPtrs = KJ_MAP(pair, pairs) {
+    return SqliteKv::KeyValuePtrPair{.key = pair.key, .value = pair.value};
+  };
+  kv.putMultiple(pairPtrs);
   return kj::none;
 }
 
@@ -456,11 +467,8 @@ kj::OneOf<bool, kj::Promise<bool>> ActorSqlite::delete_(Key key, WriteOptions op
 kj::OneOf<uint, kj::Promise<uint>> ActorSqlite::delete_(kj::Array<Key> keys, WriteOptions options) {
   requireNotBroken();
 
-  uint count = 0;
-  for (auto& key: keys) {
-    count += kv.delete_(key);
-  }
-  return count;
+  auto keyPtrs = KJ_MAP(key, keys) -> KeyPtr { return key; };
+  return kv.deleteMultiple(keyPtrs);
 }
 
 kj::Maybe<kj::Promise<void>> ActorSqlite::setAlarm(
@@ -543,7 +551,9 @@ ActorCacheInterface::DeleteAllResults ActorSqlite::deleteAll(WriteOptions option
     deleteAllCommitScheduled = true;
   }
 
-  uint count = kv.deleteAll();
+  uint count = kv.deleteAll(
+      options.estimateDeleteAllCount ? SqliteKv::DeleteAllCount::ESTIMATE
+                                     : SqliteKv::DeleteAllCount::EXACT);
 
   // TODO(correctness): Since workerd doesn't have a separate durability step, in the unlikely
   // event of a failure here, between deleteAll() and setAlarm(), we could theoretically lose the
@@ -683,6 +693,10 @@ kj::Promise<void> ActorSqlite::Hooks::scheduleRun(kj::Maybe<kj::Date> newAlarmTi
   JSG_FAIL_REQUIRE(Error, "alarms are not yet implemented for SQLite-backed Durable Objects");
 }
 
+kj::Maybe<kj::Promise<void>> ActorSqlite::Hooks::delayImplicitCommit() {
+  return kj::none;
+}
+
 kj::OneOf<kj::Maybe<ActorCacheOps::Value>, kj::Promise<kj::Maybe<ActorCacheOps::Value>>>
 ActorSqlite::ExplicitTxn::get(Key key, ReadOptions options) {
   return actorSqlite.get(kj::mv(key), options);
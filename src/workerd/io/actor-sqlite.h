@@ -28,6 +28,15 @@ class ActorSqlite final: public ActorCacheInterface, private kj::TaskSet::ErrorH
     // a promise that resolves when the scheduling has succeeded.
     virtual kj::Promise<void> scheduleRun(kj::Maybe<kj::Date> newAlarmTime);
 
+    // Allows implicit transactions to be held open for longer than one turn of the event loop, so
+    // that writes made by several consecutive events are grouped into a single commit. If this
+    // returns a promise, the implicit transaction is committed when it resolves, rather than at
+    // the end of the current turn. The output gate remains locked in the meantime, so this trades
+    // output latency for fewer commits; implementations should bound the delay, e.g. with a timer.
+    //
+    // The default implementation returns kj::none, committing at the end of the turn.
+    virtual kj::Maybe<kj::Promise<void>> delayImplicitCommit();
+
     static const Hooks DEFAULT;
   };
 
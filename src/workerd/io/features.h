@@ -15,7 +15,41 @@ struct FeatureFlags {
 
   // Get the feature flags that are relevant for the current jsg::Lock or
   // throw if we are not currently executing JavaScript.
-  static CompatibilityFlags::Reader get(jsg::Lock&);
+  //
+  // This is called on hot paths, such as per stream chunk, so it's inline and costs a
+  // thread-local load: the reader is looked up once, when the isolate lock is taken, rather than
+  // on every call. The getters on the returned reader are each a load from the flags message
+  // the Api copied at creation.
+  //
+  // Note that the jsg::Lock& argument here is not actually used. We require that a jsg::Lock
+  // reference is passed in as proof that this is called from within a valid isolate lock.
+  static CompatibilityFlags::Reader get(jsg::Lock&) {
+    KJ_REQUIRE(current != nullptr, "not running JavaScript");
+    return *current;
+  }
+
+  // Makes `flags` the current feature flags on this thread for as long as it exists. Held by
+  // Worker::Isolate's lock.
+  class Scope {
+   public:
+    explicit Scope(CompatibilityFlags::Reader flags): flags(flags), previous(current) {
+      current = &this->flags;
+    }
+    ~Scope() noexcept(false) {
+      current = previous;
+    }
+    KJ_DISALLOW_COPY_AND_MOVE(Scope);
+
+   private:
+    CompatibilityFlags::Reader flags;
+    const CompatibilityFlags::Reader* previous;
+  };
+
+ private:
+  // TODO(later): This implies that there is only one set of compatibility flags relevant at a
+  // time within each thread context. For now that holds true. Later it is possible that may not
+  // be the case which will require us to further adapt this model.
+  static constinit thread_local const CompatibilityFlags::Reader* current;
 };
 
 }  // namespace workerd
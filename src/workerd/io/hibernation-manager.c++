@@ -5,6 +5,7 @@
 #include "hibernation-manager.h"
 
 #include "io-channels.h"
+#include "io-context.h"
 
 #include <workerd/util/uuid.h>
 
@@ -61,8 +62,9 @@ kj::Array<kj::String> HibernationManagerImpl::HibernatableWebSocket::cloneTags()
 
 jsg::Ref<api::WebSocket> HibernationManagerImpl::HibernatableWebSocket::getActiveOrUnhibernate(
     jsg::Lock& js) {
-  KJ_IF_SOME(package, activeOrPackage.tryGet<api::WebSocket::HibernationPackage>()) {
+  KJ_IF_SOME(compact, activeOrPackage.tryGet<CompactPackage>()) {
     // Recreate our tags array for the api::WebSocket.
+    auto package = compact.unpack();
     package.maybeTags = getTags();
 
     // Now that we unhibernated the WebSocket, we can set the last received autoResponse timestamp
@@ -77,6 +79,110 @@ jsg::Ref<api::WebSocket> HibernationManagerImpl::HibernatableWebSocket::getActiv
   return activeOrPackage.get<jsg::Ref<api::WebSocket>>().addRef();
 }
 
+size_t HibernationManagerImpl::HibernatableWebSocket::getHibernatedSize() const {
+  // Each websocket also has a node in `allWs`, holding its kj::Own and the node's two links.
+  size_t size = sizeof(HibernatableWebSocket) + sizeof(kj::Own<HibernatableWebSocket>) +
+      2 * sizeof(void*) + tagItems.size() * sizeof(TagListItem);
+  KJ_IF_SOME(package, activeOrPackage.tryGet<CompactPackage>()) {
+    size += package.getHeapSize();
+  }
+  return size;
+}
+
+HibernationManagerImpl::CompactPackage::CompactPackage(api::WebSocket::HibernationPackage package)
+    : closedOutgoingConnection(package.closedOutgoingConnection) {
+  auto chars = [](kj::Maybe<kj::String>& str) {
+    return str.map([](kj::String& s) { return s.asBytes(); });
+  };
+  kj::Maybe<kj::ArrayPtr<const kj::byte>> fields[FIELD_COUNT] = {
+    chars(package.url),
+    chars(package.protocol),
+    chars(package.extensions),
+    package.serializedAttachment.map(
+        [](kj::Array<kj::byte>& bytes) { return kj::ArrayPtr<const kj::byte>(bytes); }),
+  };
+
+  size_t total = 0;
+  for (auto i: kj::zeroTo(FIELD_COUNT)) {
+    KJ_IF_SOME(field, fields[i]) {
+      KJ_REQUIRE(field.size() < ABSENT, "hibernated websocket property is too large");
+      sizes[i] = field.size();
+      total += field.size();
+    } else {
+      sizes[i] = ABSENT;
+    }
+  }
+
+  buffer = kj::heapArray<kj::byte>(total);
+  auto rest = buffer.asPtr();
+  for (auto& maybeField: fields) {
+    KJ_IF_SOME(field, maybeField) {
+      memcpy(rest.begin(), field.begin(), field.size());
+      rest = rest.slice(field.size());
+    }
+  }
+}
+
+api::WebSocket::HibernationPackage HibernationManagerImpl::CompactPackage::unpack() const {
+  kj::ArrayPtr<const kj::byte> rest = buffer;
+  auto next = [&](uint i) -> kj::Maybe<kj::ArrayPtr<const kj::byte>> {
+    if (sizes[i] == ABSENT) return kj::none;
+    auto field = rest.first(sizes[i]);
+    rest = rest.slice(sizes[i]);
+    return field;
+  };
+  auto str = [](kj::ArrayPtr<const kj::byte> bytes) { return kj::heapString(bytes.asChars()); };
+
+  // Designated initializers are evaluated in order, which is the order the fields are stored in.
+  return api::WebSocket::HibernationPackage{
+    .url = next(0).map(str),
+    .protocol = next(1).map(str),
+    .extensions = next(2).map(str),
+    .serializedAttachment =
+        next(3).map([](kj::ArrayPtr<const kj::byte> bytes) { return kj::heapArray(bytes); }),
+    .maybeTags = kj::none,
+    .closedOutgoingConnection = closedOutgoingConnection,
+  };
+}
+
+kj::Promise<void> HibernationManagerImpl::HibernatableWebSocket::sendWhileHibernating(
+    kj::Own<OutgoingMessage> message, kj::Promise<void> ready) {
+  auto& socket = *KJ_REQUIRE_NONNULL(ws);
+  // A kj::WebSocket can only send one message at a time, so each send waits for the previous one.
+  auto sent = autoResponsePromise
+                  .then([ready = kj::mv(ready)]() mutable { return kj::mv(ready); })
+                  .then([&socket, message = kj::mv(message)]() mutable {
+    return message->sendTo(socket).attach(kj::mv(message));
+  }).fork();
+  autoResponsePromise = sent.addBranch();
+  return sent.addBranch();
+}
+
+kj::Promise<void> HibernationManagerImpl::OutgoingMessage::sendTo(kj::WebSocket& ws) const {
+  KJ_SWITCH_ONEOF(data) {
+    KJ_CASE_ONEOF(text, kj::String) {
+      return ws.send(text.asArray());
+    }
+    KJ_CASE_ONEOF(bytes, kj::Array<kj::byte>) {
+      return ws.send(bytes.asPtr());
+    }
+  }
+  KJ_UNREACHABLE;
+}
+
+kj::WebSocket::Message HibernationManagerImpl::OutgoingMessage::share() {
+  KJ_SWITCH_ONEOF(data) {
+    KJ_CASE_ONEOF(text, kj::String) {
+      // Include the NUL terminator, which kj::String expects to own.
+      return kj::String(kj::arrayPtr(text.begin(), text.size() + 1).attach(kj::addRef(*this)));
+    }
+    KJ_CASE_ONEOF(bytes, kj::Array<kj::byte>) {
+      return bytes.asPtr().attach(kj::addRef(*this));
+    }
+  }
+  KJ_UNREACHABLE;
+}
+
 HibernationManagerImpl::HibernationManagerImpl(
     kj::Own<Worker::Actor::Loopback> loopback, uint16_t hibernationEventType)
     : loopback(kj::mv(loopback)),
@@ -179,46 +285,120 @@ kj::Vector<jsg::Ref<api::WebSocket>> HibernationManagerImpl::getWebSockets(
   return kj::mv(matches);
 }
 
-void HibernationManagerImpl::setWebSocketAutoResponse(
-    kj::Maybe<kj::StringPtr> request, kj::Maybe<kj::StringPtr> response) {
-  KJ_IF_SOME(req, request) {
-    // If we have a request, we must also have a response. If response is kj::none, we'll throw.
-    autoResponsePair->request = kj::str(req);
-    autoResponsePair->response = kj::str(KJ_REQUIRE_NONNULL(response));
-    return;
+uint HibernationManagerImpl::broadcast(jsg::Lock& js,
+    kj::Maybe<kj::StringPtr> maybeTag,
+    kj::OneOf<kj::Array<kj::byte>, kj::String> message,
+    kj::ArrayPtr<const jsg::Ref<api::WebSocket>> except) {
+  kj::Own<OutgoingMessage> outgoing;
+  KJ_SWITCH_ONEOF(message) {
+    KJ_CASE_ONEOF(text, kj::String) {
+      outgoing = kj::refcounted<OutgoingMessage>(kj::mv(text));
+    }
+    KJ_CASE_ONEOF(bytes, kj::Array<kj::byte>) {
+      outgoing = kj::refcounted<OutgoingMessage>(kj::mv(bytes));
+    }
+  }
+
+  // Like api::WebSocket::send(), messages to hibernating websockets wait for the output gate.
+  kj::Maybe<kj::ForkedPromise<void>> outputLock;
+  KJ_IF_SOME(promise, IoContext::current().waitForOutputLocksIfNecessary()) {
+    outputLock = promise.fork();
+  }
+
+  uint count = 0;
+  auto sendTo = [&](HibernatableWebSocket& hib) {
+    if (hib.ws == kj::none) {
+      // We've already dispatched the close or error event.
+      return;
+    }
+    KJ_SWITCH_ONEOF(hib.activeOrPackage) {
+      KJ_CASE_ONEOF(active, jsg::Ref<api::WebSocket>) {
+        for (auto& skipped: except) {
+          if (skipped.get() == active.get()) return;
+        }
+        if (active->getReadyState() != api::WebSocket::READY_STATE_OPEN) return;
+        // An active websocket may have messages queued already, so it has to send this one too.
+        active->sendMessage(js, outgoing->share());
+      }
+      KJ_CASE_ONEOF(package, CompactPackage) {
+        // A hibernating websocket has no JS object, so it can't be in `except`.
+        if (package.closedOutgoingConnection) return;
+        kj::Promise<void> ready = kj::READY_NOW;
+        KJ_IF_SOME(lock, outputLock) {
+          ready = lock.addBranch();
+        }
+        // The send stays queued on the websocket, nothing needs to wait for it here. Errors show
+        // up in the websocket's readLoop().
+        (void)hib.sendWhileHibernating(kj::addRef(*outgoing), kj::mv(ready));
+      }
+    }
+    ++count;
+  };
+
+  KJ_IF_SOME(tag, maybeTag) {
+    KJ_IF_SOME(item, tagToWs.find(tag)) {
+      for (auto& entry: *item->list) {
+        sendTo(KJ_REQUIRE_NONNULL(entry.hibWS));
+      }
+    }
+  } else {
+    for (auto& hibWS: allWs) {
+      sendTo(*hibWS);
+    }
   }
-  // If we don't have a request, we must unset both request and response.
-  autoResponsePair->request = kj::none;
-  autoResponsePair->response = kj::none;
+  return count;
+}
+
+void HibernationManagerImpl::setWebSocketAutoResponses(kj::Array<AutoResponseRule> rules) {
+  autoResponseRules = kj::mv(rules);
 }
 
 kj::Maybe<jsg::Ref<api::WebSocketRequestResponsePair>> HibernationManagerImpl::
     getWebSocketAutoResponse() {
-  KJ_IF_SOME(req, autoResponsePair->request) {
-    // When getting the currently set auto-response pair, if we have a request we must have a response
-    // set. If not, we'll throw.
-    return api::WebSocketRequestResponsePair::constructor(
-        kj::str(req), kj::str(KJ_REQUIRE_NONNULL(autoResponsePair->response)));
+  if (autoResponseRules.size() == 0) {
+    return kj::none;
+  }
+  auto& rule = autoResponseRules[0];
+  return jsg::alloc<api::WebSocketRequestResponsePair>(
+      kj::str(rule.request), kj::str(rule.response), rule.prefix);
+}
+
+kj::Maybe<kj::String> HibernationManagerImpl::findAutoResponse(kj::StringPtr message) {
+  for (auto& rule: autoResponseRules) {
+    if (rule.prefix ? message.startsWith(rule.request) : message == rule.request) {
+      // The rules may be replaced while the response is being sent, so we return a copy.
+      return kj::str(rule.response);
+    }
   }
   return kj::none;
 }
 
+void HibernationManagerImpl::setWebSocketIdleTimeout(kj::Maybe<uint32_t> timeoutMs) {
+  idleTimeoutMs = timeoutMs;
+}
+
 void HibernationManagerImpl::setTimerChannel(TimerChannel& timerChannel) {
   timer = timerChannel;
 }
 
-void HibernationManagerImpl::hibernateWebSockets(Worker::Lock& lock) {
+void HibernationManagerImpl::setObserver(kj::Own<ActorObserver> actorObserver) {
+  observer = kj::mv(actorObserver);
+}
+
+void HibernationManagerImpl::hibernateWebSockets(Worker::Lock& lock, ActorObserver& metrics) {
+  size_t hibernatedBytes = 0;
   JSG_WITHIN_CONTEXT_SCOPE(lock, lock.getContext(), [&](jsg::Lock& js) {
     for (auto& ws: allWs) {
       KJ_IF_SOME(active, ws->activeOrPackage.tryGet<jsg::Ref<api::WebSocket>>()) {
         // Transfers ownership of properties from api::WebSocket to HibernatableWebSocket via the
-        // HibernationPackage.
-        ws->activeOrPackage.init<api::WebSocket::HibernationPackage>(
-            active.get()->buildPackageForHibernation());
+        // HibernationPackage, which we then compact.
+        ws->activeOrPackage.init<CompactPackage>(active.get()->buildPackageForHibernation());
       } else {
       }  // Here to quash compiler warning
+      hibernatedBytes += ws->getHibernatedSize();
     }
   });
+  metrics.webSocketsHibernated(allWs.size(), hibernatedBytes);
 }
 
 void HibernationManagerImpl::setEventTimeout(kj::Maybe<uint32_t> timeoutMs) {
@@ -279,64 +459,66 @@ kj::Promise<void> HibernationManagerImpl::readLoop(HibernatableWebSocket& hib) {
   // Like the api::WebSocket readLoop(), but we dispatch different types of events.
   auto& ws = *KJ_REQUIRE_NONNULL(hib.ws);
   while (true) {
-    kj::WebSocket::Message message = co_await ws.receive();
+    auto receive = ws.receive();
+    bool timedOut = false;
+    KJ_IF_SOME(ms, idleTimeoutMs) {
+      // Protocol-level pings are answered inside kj::WebSocket::receive(), so they don't count as
+      // activity here.
+      receive = receive.exclusiveJoin(
+          KJ_REQUIRE_NONNULL(timer)
+              .afterLimitTimeout(ms * kj::MILLISECONDS)
+              .then([&timedOut]() -> kj::WebSocket::Message {
+        timedOut = true;
+        return kj::WebSocket::Close{.code = 1001, .reason = kj::str("WebSocket idle timeout")};
+      }));
+    }
+    kj::WebSocket::Message message = co_await receive;
     // Note that errors are handled by the callee of `readLoop`, since we throw from `receive()`.
 
-    auto skip = false;
-
-    // If we have a request != kj::none, we can compare it the received message. This also implies
-    // that we have a response set in autoResponsePair.
-    KJ_IF_SOME(req, autoResponsePair->request) {
-      KJ_SWITCH_ONEOF(message) {
-        KJ_CASE_ONEOF(text, kj::String) {
-          if (text == req) {
-            // If the received message matches the one set for auto-response, we must
-            // short-circuit readLoop, store the current timestamp and and automatically respond
-            // with the expected response.
-            TimerChannel& timerChannel = KJ_REQUIRE_NONNULL(timer);
-            // This should count as a new IO event, hence we should call syncTime
-            // otherwise the autoResponseTimestamp wouldn't be accurate.
-            timerChannel.syncTime();
-            // We should have set the timerChannel previously in the hibernation manager.
-            // If we haven't, we aren't able to get the current time.
-            hib.autoResponseTimestamp = timerChannel.now();
-            // We'll store the current timestamp in the HibernatableWebSocket to assure it gets
-            // stored even if the WebSocket is currently hibernating. In that scenario, the timestamp
-            // value will be loaded into the WebSocket during unhibernation.
-            KJ_SWITCH_ONEOF(hib.activeOrPackage) {
-              KJ_CASE_ONEOF(apiWs, jsg::Ref<api::WebSocket>) {
-                // If the actor is not hibernated/If the WebSocket is active, we need to update
-                // autoResponseTimestamp on the active websocket.
-                apiWs->setAutoResponseStatus(hib.autoResponseTimestamp, kj::READY_NOW);
-                // Since we had a request set, we must have and response that's sent back using the
-                // same websocket here. The sending of response is managed in web-socket to avoid
-                // possible racing problems with regular websocket messages.
-                co_await apiWs->sendAutoResponse(
-                    kj::str(KJ_REQUIRE_NONNULL(autoResponsePair->response).asArray()), ws);
-              }
-              KJ_CASE_ONEOF(package, api::WebSocket::HibernationPackage) {
-                if (!package.closedOutgoingConnection) {
-                  // We need to store the autoResponsePromise because we may instantiate an api::websocket
-                  // If we do that, we have to provide it with the promise to avoid races. This can
-                  // happen if we have a websocket hibernating, that unhibernates and sends a
-                  // message while ws.send() for auto-response is also sending.
-                  auto p = ws.send(KJ_REQUIRE_NONNULL(autoResponsePair->response).asArray()).fork();
-                  hib.autoResponsePromise = p.addBranch();
-                  co_await p;
-                  hib.autoResponsePromise = kj::READY_NOW;
-                }
-              }
-            }
-            // If we've sent an auto response message, we should not unhibernate or deliver the
-            // received message to the actor
-            skip = true;
+    kj::Maybe<kj::String> autoResponse;
+    KJ_IF_SOME(text, message.tryGet<kj::String>()) {
+      autoResponse = findAutoResponse(text);
+    }
+
+    KJ_IF_SOME(response, autoResponse) {
+      // If the received message matches a rule set for auto-response, we must short-circuit
+      // readLoop, store the current timestamp and and automatically respond with the expected
+      // response.
+      TimerChannel& timerChannel = KJ_REQUIRE_NONNULL(timer);
+      // This should count as a new IO event, hence we should call syncTime
+      // otherwise the autoResponseTimestamp wouldn't be accurate.
+      timerChannel.syncTime();
+      // We should have set the timerChannel previously in the hibernation manager.
+      // If we haven't, we aren't able to get the current time.
+      hib.autoResponseTimestamp = timerChannel.now();
+      // We'll store the current timestamp in the HibernatableWebSocket to assure it gets
+      // stored even if the WebSocket is currently hibernating. In that scenario, the timestamp
+      // value will be loaded into the WebSocket during unhibernation.
+      KJ_SWITCH_ONEOF(hib.activeOrPackage) {
+        KJ_CASE_ONEOF(apiWs, jsg::Ref<api::WebSocket>) {
+          // If the actor is not hibernated/If the WebSocket is active, we need to update
+          // autoResponseTimestamp on the active websocket.
+          apiWs->setAutoResponseStatus(hib.autoResponseTimestamp, kj::READY_NOW);
+          // The response is sent back using the same websocket here. The sending of response is
+          // managed in web-socket to avoid possible racing problems with regular websocket
+          // messages.
+          co_await apiWs->sendAutoResponse(kj::mv(response), ws);
+        }
+        KJ_CASE_ONEOF(package, CompactPackage) {
+          if (!package.closedOutgoingConnection) {
+            // sendWhileHibernating() stores the autoResponsePromise because we may instantiate an
+            // api::websocket. If we do that, we have to provide it with the promise to avoid
+            // races. This can happen if we have a websocket hibernating, that unhibernates and
+            // sends a message while ws.send() for auto-response is also sending.
+            co_await hib.sendWhileHibernating(kj::refcounted<OutgoingMessage>(kj::mv(response)));
           }
         }
-        KJ_CASE_ONEOF_DEFAULT {}
       }
-    }
-
-    if (skip) {
+      KJ_IF_SOME(o, observer) {
+        o->webSocketAutoResponseSent();
+      }
+      // If we've sent an auto response message, we should not unhibernate or deliver the
+      // received message to the actor
       continue;
     }
 
@@ -353,7 +535,8 @@ kj::Promise<void> HibernationManagerImpl::readLoop(HibernatableWebSocket& hib) {
         maybeParams.emplace(kj::mv(data), kj::mv(websocketId));
       }
       KJ_CASE_ONEOF(close, kj::WebSocket::Close) {
-        maybeParams.emplace(close.code, kj::mv(close.reason), true, kj::mv(websocketId));
+        // A close that we made up because the websocket was idle wasn't a clean close.
+        maybeParams.emplace(close.code, kj::mv(close.reason), !timedOut, kj::mv(websocketId));
         // We'll dispatch the close event, so let's mark our websocket as having done so to
         // prevent a situation where we dispatch it twice.
         hib.hasDispatchedClose = true;
@@ -31,14 +31,32 @@ class HibernationManagerImpl final: public Worker::Actor::HibernationManager {
   kj::Vector<jsg::Ref<api::WebSocket>> getWebSockets(
       jsg::Lock& js, kj::Maybe<kj::StringPtr> tag) override;
 
+  // Sends `message` to every accepted websocket with the given tag, or to all of them if no tag is
+  // provided, except those in `except`. Hibernating websockets are written to directly, without
+  // waking them up, and share a single copy of the message. Returns the number of websockets the
+  // message was sent to.
+  uint broadcast(jsg::Lock& js,
+      kj::Maybe<kj::StringPtr> tag,
+      kj::OneOf<kj::Array<kj::byte>, kj::String> message,
+      kj::ArrayPtr<const jsg::Ref<api::WebSocket>> except) override;
+
   // Hibernates all the websockets held by the HibernationManager.
-  // This converts our activeOrPackage from an api::WebSocket to a HibernationPackage.
-  void hibernateWebSockets(Worker::Lock& lock) override;
+  // This converts our activeOrPackage from an api::WebSocket to a CompactPackage, and reports the
+  // memory that the hibernating websockets retain to `metrics`.
+  void hibernateWebSockets(Worker::Lock& lock, ActorObserver& metrics) override;
+
+  // Replaces the auto-response rules. A text message is answered by the first rule it matches.
+  void setWebSocketAutoResponses(kj::Array<AutoResponseRule> rules) override;
 
-  void setWebSocketAutoResponse(
-      kj::Maybe<kj::StringPtr> request, kj::Maybe<kj::StringPtr> response) override;
+  // Returns the first auto-response rule, if any.
   kj::Maybe<jsg::Ref<api::WebSocketRequestResponsePair>> getWebSocketAutoResponse() override;
+
+  // Sets/unsets the time in milliseconds after which a hibernatable websocket that hasn't received
+  // a message gets a close event with code 1001. Auto-responses count as messages.
+  void setWebSocketIdleTimeout(kj::Maybe<uint32_t> timeoutMs) override;
+
   void setTimerChannel(TimerChannel& timerChannel) override;
+  void setObserver(kj::Own<ActorObserver> observer) override;
 
   kj::Own<HibernationManager> addRef() override;
 
@@ -67,6 +85,46 @@ class HibernationManagerImpl final: public Worker::Actor::HibernationManager {
     kj::Maybe<kj::List<TagListItem, &TagListItem::link>&> list;
   };
 
+  // A message that is sent to hibernating websockets. It's refcounted so that a broadcast can
+  // share one copy between all of them, active or not.
+  struct OutgoingMessage: public kj::Refcounted {
+    kj::OneOf<kj::String, kj::Array<kj::byte>> data;
+
+    explicit OutgoingMessage(kj::OneOf<kj::String, kj::Array<kj::byte>> data)
+        : data(kj::mv(data)) {}
+
+    kj::Promise<void> sendTo(kj::WebSocket& ws) const;
+    // Returns a message for api::WebSocket::sendMessage() that borrows this one's bytes.
+    kj::WebSocket::Message share();
+  };
+
+  // The properties of a hibernating api::WebSocket (see api::WebSocket::HibernationPackage). An
+  // actor can have tens of thousands of hibernating websockets, so rather than keeping the url,
+  // protocol, extensions and attachment in four allocations, we copy them back to back into one.
+  class CompactPackage {
+   public:
+    explicit CompactPackage(api::WebSocket::HibernationPackage package);
+
+    // Copies the properties back out, for recreating the api::WebSocket.
+    api::WebSocket::HibernationPackage unpack() const;
+
+    size_t getHeapSize() const {
+      return buffer.size();
+    }
+
+    // True forever once the JS WebSocket calls `close()`.
+    bool closedOutgoingConnection;
+
+   private:
+    static constexpr uint FIELD_COUNT = 4;
+    static constexpr uint32_t ABSENT = kj::maxValue;
+
+    kj::Array<kj::byte> buffer;
+
+    // The size of each field in `buffer`, in the order above, or ABSENT if the field isn't set.
+    uint32_t sizes[FIELD_COUNT];
+  };
+
   // api::WebSockets cannot survive hibernation, but kj::WebSockets do. This class helps us
   // manage the transition of an api::WebSocket from its active state to a hibernated state
   // and vice versa.
@@ -98,6 +156,15 @@ class HibernationManagerImpl final: public Worker::Actor::HibernationManager {
     // to the api::WebSocket.
     jsg::Ref<api::WebSocket> getActiveOrUnhibernate(jsg::Lock& js);
 
+    // Sends `message` on the kj::WebSocket once `ready` resolves and any earlier message sent
+    // while hibernating has been sent. Returns a promise for when `message` has been sent.
+    kj::Promise<void> sendWhileHibernating(
+        kj::Own<OutgoingMessage> message, kj::Promise<void> ready = kj::READY_NOW);
+
+    // Returns the heap memory used by this object while it's hibernating, excluding the tag
+    // strings, which are shared with all other websockets that have the same tags.
+    size_t getHibernatedSize() const;
+
     kj::ListLink<HibernatableWebSocket> link;
 
     // An array of all the items/nodes that refer to this HibernatableWebSocket.
@@ -107,8 +174,8 @@ class HibernationManagerImpl final: public Worker::Actor::HibernationManager {
     kj::Array<TagListItem> tagItems;
 
     // If active, we have an api::WebSocket reference, otherwise, we're hibernating, so we retain
-    // the websocket's properties in a HibernationPackage until it's time to wake up.
-    kj::OneOf<jsg::Ref<api::WebSocket>, api::WebSocket::HibernationPackage> activeOrPackage;
+    // the websocket's properties in a CompactPackage until it's time to wake up.
+    kj::OneOf<jsg::Ref<api::WebSocket>, CompactPackage> activeOrPackage;
 
     // This is an owned websocket that we extract from the api::WebSocket after accepting as
     // hibernatable. It becomes null once we dispatch a close or error event because we want its
@@ -132,8 +199,8 @@ class HibernationManagerImpl final: public Worker::Actor::HibernationManager {
     // Stores the last received autoResponseRequest timestamp.
     kj::Maybe<kj::Date> autoResponseTimestamp;
 
-    // Keeps track of the currently ongoing websocket auto-response send promise. This promise may
-    // be moved to api::websocket if an hibernating websocket unhibernates.
+    // Keeps track of the currently ongoing websocket auto-response or broadcast send promise. This
+    // promise may be moved to api::websocket if an hibernating websocket unhibernates.
     kj::Promise<void> autoResponsePromise = kj::READY_NOW;
 
     friend HibernationManagerImpl;
@@ -155,6 +222,9 @@ class HibernationManagerImpl final: public Worker::Actor::HibernationManager {
   // Like the api::WebSocket readLoop(), but we dispatch different types of events.
   kj::Promise<void> readLoop(HibernatableWebSocket& hib);
 
+  // Returns the auto-response for `message`, if it matches a rule.
+  kj::Maybe<kj::String> findAutoResponse(kj::StringPtr message);
+
   // This struct is held by the `tagToWs` hashmap. The key is a StringPtr to tag, and the value
   // is this struct itself.
   struct TagCollection {
@@ -165,15 +235,6 @@ class HibernationManagerImpl final: public Worker::Actor::HibernationManager {
     TagCollection(TagCollection&& other) = default;
   };
 
-  // This structure will hold the request and corresponding response for hibernatable websockets
-  // auto-response feature. Although we store 2 kj::Maybe strings, if we don't have a request set
-  // we can't have a response, and vice versa.
-  // TODO(cleanup): Remove kj::Maybe from request and response strings.
-  struct AutoRequestResponsePair {
-    kj::Maybe<kj::String> request = kj::none;
-    kj::Maybe<kj::String> response = kj::none;
-  };
-
   // A hashmap of tags to HibernatableWebSockets associated with the tag.
   // We use a kj::List so we can quickly remove websockets that have disconnected.
   // Also note that we box the keys and values such that in the event of a hashmap resizing we don't
@@ -209,8 +270,11 @@ class HibernationManagerImpl final: public Worker::Actor::HibernationManager {
   };
   DisconnectHandler onDisconnect;
   kj::TaskSet readLoopTasks;
-  kj::Own<AutoRequestResponsePair> autoResponsePair = kj::heap<AutoRequestResponsePair>();
+  // The request and response pairs for the hibernatable websockets auto-response feature.
+  kj::Array<AutoResponseRule> autoResponseRules;
   kj::Maybe<TimerChannel&> timer;
+  kj::Maybe<kj::Own<ActorObserver>> observer;
   kj::Maybe<uint32_t> eventTimeoutMs;
+  kj::Maybe<uint32_t> idleTimeoutMs;
 };
 };  // namespace workerd
@@ -129,6 +129,21 @@ class IoChannelFactory {
   virtual kj::Promise<void> writeLogfwdr(
       uint channel, kj::FunctionParam<void(capnp::AnyPointer::Builder)> buildMessage) = 0;
 
+  // Like writeLogfwdr(), but writes `count` messages at once, invoking `buildMessage` for each
+  // index in order before returning. The default writes them one by one; a factory whose transport
+  // can carry several messages in a single write should override this.
+  virtual kj::Promise<void> writeLogfwdrBatch(uint channel,
+      uint count,
+      kj::FunctionParam<void(uint index, capnp::AnyPointer::Builder)> buildMessage) {
+    auto promises = kj::heapArrayBuilder<kj::Promise<void>>(count);
+    for (auto i: kj::zeroTo(count)) {
+      promises.add(writeLogfwdr(channel, [&](capnp::AnyPointer::Builder ptr) {
+        buildMessage(i, ptr);
+      }));
+    }
+    return kj::joinPromises(promises.finish());
+  }
+
   // Stub for a remote actor. Allows sending requests to the actor. Multiple requests may be
   // sent, and they will be delivered in the order they are sent (e-order). This is an I/O type
   // so it is only valid within the `IoContext` where it was created.
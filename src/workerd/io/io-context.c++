@@ -7,13 +7,13 @@
 #include <workerd/io/io-gate.h>
 #include <workerd/io/worker.h>
 #include <workerd/jsg/jsg.h>
+#include <workerd/util/autogate.h>
 #include <workerd/util/sentry.h>
 #include <workerd/util/uncaught-exception-source.h>
 
 #include <kj/debug.h>
 
 #include <cmath>
-#include <map>
 
 namespace workerd {
 
@@ -28,16 +28,14 @@ static void* getThreadId() {
 class IoContext::TimeoutManagerImpl final: public TimeoutManager {
  public:
   class TimeoutState;
-  using Map = std::map<TimeoutId, TimeoutState>;
-  using Iterator = Map::iterator;
 
   TimeoutManagerImpl() = default;
   KJ_DISALLOW_COPY_AND_MOVE(TimeoutManagerImpl);
 
   TimeoutId setTimeout(
       IoContext& context, TimeoutId::Generator& generator, TimeoutParameters params) override {
-    auto [id, it] = addState(generator, kj::mv(params));
-    setTimeoutImpl(context, it);
+    auto id = addState(generator, kj::mv(params));
+    setTimeoutImpl(context, id);
     return id;
   }
 
@@ -48,54 +46,59 @@ class IoContext::TimeoutManagerImpl final: public TimeoutManager {
   }
 
   kj::Maybe<kj::Date> getNextTimeout() const override {
-    if (timeoutTimes.size() == 0) {
-      return kj::none;
-    } else {
-      return timeoutTimes.begin()->key.when;
-    }
+    return timeoutTimes.front().map([](const TimeoutWheel::Entry& entry) {
+      return entry.getWhen();
+    });
   }
 
  private:
-  struct IdAndIterator {
-    TimeoutId id;
-    Iterator it;
-  };
-  IdAndIterator addState(TimeoutId::Generator& generator, TimeoutParameters params);
+  TimeoutId addState(TimeoutId::Generator& generator, TimeoutParameters params);
 
-  void setTimeoutImpl(IoContext& context, Iterator it);
+  void setTimeoutImpl(IoContext& context, TimeoutId id);
 
-  // A pair of a Date and a numeric ID, used as entry in timeoutTimes set, below.
-  struct TimeoutTime {
-    kj::Date when;
-    uint tiebreaker;  // Unique number, in case two timeouts target same time.
+  TimeoutState& getState(TimeoutId id) {
+    return *KJ_ASSERT_NONNULL(timeouts.find(id));
+  }
 
-    inline bool operator<(const TimeoutTime& other) const {
-      if (when < other.when) return true;
-      if (when > other.when) return false;
-      return tiebreaker < other.tiebreaker;
-    }
-    inline bool operator==(const TimeoutTime& other) const {
-      return when == other.when && tiebreaker == other.tiebreaker;
-    }
+  // An entry in timeoutTimes, below. The sequence number breaks ties between timeouts that target
+  // the same time.
+  struct ScheduledTimeout final: public TimeoutWheel::Entry {
+    ScheduledTimeout(kj::Date when,
+        uint64_t sequence,
+        TimeoutId id,
+        kj::Own<kj::PromiseFulfiller<void>> fulfiller)
+        : Entry(when, sequence),
+          id(id),
+          fulfiller(kj::mv(fulfiller)) {}
+
+    TimeoutId id;
+    kj::Own<kj::PromiseFulfiller<void>> fulfiller;
   };
 
+  // Runs the callback of the timeout `id`, which is due. `isInline` is set when fireDue() runs it.
+  void fire(IoContext& context, Worker::Lock& lock, TimeoutId id, bool isInline);
+
+  // With the `batched_callbacks` flag, runs the other timeouts that are due along with `first`,
+  // whose callback has just run, in the same isolate lock.
+  void fireDue(IoContext& context, Worker::Lock& lock, ScheduledTimeout& first);
+
   // Tracks registered timeouts sorted by the next time the timeout is expected to fire.
   //
   // The associated fulfiller should be fulfilled when the time has been reached AND all previous
   // timeouts have completed.
-  kj::TreeMap<TimeoutTime, kj::Own<kj::PromiseFulfiller<void>>> timeoutTimes;
-  uint timeoutTimesTiebreakerCounter = 0;
+  TimeoutWheel timeoutTimes;
+  uint64_t timeoutTimesTiebreakerCounter = 0;
 
   uint timeoutsStarted = 0;
   uint timeoutsFinished = 0;
-  Map timeouts;
+  kj::HashMap<TimeoutId, kj::Own<TimeoutState>> timeouts;
 
   // Promise that is waiting for the closest timeout, and will fulfill its fulfiller. We only ever
   // actually wait on the next timeout in `timeoutTasks`, so that we can't fulfill timer callbacks
   // out-of-order. This task gets replaced each time the lead timeout changes.
   kj::Promise<void> timerTask = nullptr;
 
-  // Must be called any time timeoutTimes.begin() changes.
+  // Must be called any time timeoutTimes.front() changes.
   void resetTimerTask(TimerChannel& timerChannel);
 };
 
@@ -130,6 +133,11 @@ IoContext::IoContext(ThreadContext& thread,
       waitUntilTasks(*this),
       timeoutManager(kj::heap<TimeoutManagerImpl>()),
       deleteQueueSignalTask(startDeleteQueueSignalTask(this)) {
+  batchCallbacks = worker->getIsolate().getApi().getFeatureFlags().getBatchedCallbacks();
+  if (util::Autogate::isEnabled(util::AutogateKey::OWNED_OBJECT_ARENA)) {
+    ownedObjects.useArena();
+  }
+
   kj::PromiseFulfillerPair<void> paf = kj::newPromiseAndFulfiller<void>();
   abortFulfiller = kj::mv(paf.fulfiller);
   auto localAbortPromise = kj::mv(paf.promise);
@@ -230,6 +238,7 @@ void IoContext::IncomingRequest::delivered() {
   context->incomingRequests.addFront(*this);
   wasDelivered = true;
   metrics->delivered();
+  context->worker->getIsolate().startedRequest();
 
   KJ_IF_SOME(a, context->actor) {
     // Re-synchronize the timer and top up limits for every new incoming request to an actor.
@@ -295,7 +304,9 @@ bool IoContext::hasOutputGate() {
 }
 
 kj::Maybe<kj::Promise<void>> IoContext::waitForOutputLocksIfNecessary() {
-  return actor.map([](Worker::Actor& actor) { return actor.getOutputGate().wait(); });
+  return actor.map([this](Worker::Actor& actor) {
+    return reportWait(actor.getOutputGate().wait(), &RequestObserver::outputGateWaited);
+  });
 }
 
 kj::Maybe<IoOwn<kj::Promise<void>>> IoContext::waitForOutputLocksIfNecessaryIoOwn() {
@@ -312,7 +323,7 @@ bool IoContext::isOutputGateBroken() {
 }
 
 bool IoContext::isInspectorEnabled() {
-  return worker->getIsolate().isInspectorEnabled();
+  return worker->getIsolate().hasInspectorSession();
 }
 
 bool IoContext::isFiddle() {
@@ -342,7 +353,7 @@ void IoContext::logUncaughtException(
 
 void IoContext::logUncaughtExceptionAsync(
     UncaughtExceptionSource source, kj::Exception&& exception) {
-  if (getWorkerTracer() == kj::none && !worker->getIsolate().isInspectorEnabled()) {
+  if (getWorkerTracer() == kj::none && !isInspectorEnabled()) {
     // We don't need to take the isolate lock as neither inspecting nor tracing is enabled. We
     // do still want to syslog if relevant, but we can do that without a lock.
     if (!jsg::isTunneledException(exception.getDescription()) &&
@@ -494,6 +505,10 @@ IoContext::~IoContext() noexcept(false) {
 
   // Kill the sentinel so that no weak references can refer to this IoContext anymore.
   selfRef->invalidate();
+
+  KJ_IF_SOME(arena, ownedObjects.getArena()) {
+    limitEnforcer->reportOwnedObjectArenaSize(arena.getAllocatedBytes());
+  }
 }
 
 IoContext::PendingEvent::~PendingEvent() noexcept(false) {
@@ -576,36 +591,35 @@ void IoContext::TimeoutManagerImpl::TimeoutState::cancel() {
   ++manager.timeoutsFinished;
 }
 
-auto IoContext::TimeoutManagerImpl::addState(
-    TimeoutId::Generator& generator, TimeoutParameters params) -> IdAndIterator {
+TimeoutId IoContext::TimeoutManagerImpl::addState(
+    TimeoutId::Generator& generator, TimeoutParameters params) {
   JSG_REQUIRE(getTimeoutCount() < MAX_TIMEOUTS, DOMQuotaExceededError,
       "You have exceeded the number of active timeouts you may set.",
       " max active timeouts: ", MAX_TIMEOUTS, ", current active timeouts: ", getTimeoutCount(),
       ", finished timeouts: ", timeoutsFinished);
 
   auto id = generator.getNext();
-  auto [it, wasEmplaced] = timeouts.try_emplace(id, *this, kj::mv(params));
-  if (!wasEmplaced) {
+  KJ_IF_SOME(existing, timeouts.find(id)) {
     // We shouldn't have reached here because the `TimeoutId::Generator` throws if it reaches
     // Number.MAX_SAFE_INTEGER, much less wraps around the uint64_t number space. Let's throw with
     // as many details as possible.
-    auto& state = it->second;
-    auto delay = state.params.msDelay;
-    auto repeat = state.params.repeat;
+    auto delay = existing->params.msDelay;
+    auto repeat = existing->params.repeat;
     KJ_FAIL_ASSERT("Saw a timeout id collision", getTimeoutCount(), timeoutsStarted, id.toNumber(),
         delay, repeat);
   }
+  timeouts.insert(id, kj::heap<TimeoutState>(*this, kj::mv(params)));
 
-  return {id, it};
+  return id;
 }
 
-void IoContext::TimeoutManagerImpl::setTimeoutImpl(IoContext& context, Iterator it) {
-  auto& state = it->second;
+void IoContext::TimeoutManagerImpl::setTimeoutImpl(IoContext& context, TimeoutId id) {
+  auto& state = getState(id);
 
   auto stateGuard = kj::defer([&]() {
     if (state.maybePromise == kj::none) {
       // Something threw, erase the state.
-      timeouts.erase(it);
+      timeouts.erase(id);
     }
   });
 
@@ -614,88 +628,47 @@ void IoContext::TimeoutManagerImpl::setTimeoutImpl(IoContext& context, Iterator
   // Always schedule the timeout relative to what Date.now() currently returns, so that the delay
   // appear exact. Otherwise, the delay could reveal non-determinism containing side channels.
   auto when = context.now() + state.params.msDelay * kj::MILLISECONDS;
+
+  // Add an entry to the timeoutTimes wheel, to track when the nearest timeout is. It's removed
+  // when the promise completes, see below.
+  auto scheduled = kj::heap<ScheduledTimeout>(
+      when, timeoutTimesTiebreakerCounter++, id, kj::mv(paf.fulfiller));
+  auto& scheduledRef = *scheduled;
+
   // TODO(cleanup): The manual use of run() here (including carrying over the critical section) is
   //   kind of ugly, but using awaitIo() doesn't work here because we need the ability to cancel
   //   the timer, so we don't want to addTask() it, which awaitIo() does implicitly.
-  auto promise =
-      paf.promise.then([this, &context, it, cs = context.getCriticalSection()]() mutable {
-    return context.run([this, &context, it](Worker::Lock& lock) mutable {
-      auto& state = it->second;
-
-      auto stateGuard = kj::defer([&] {
-        if (state.maybePromise == kj::none) {
-          // At the end of this block, there was no new timeout, so we should remove the state.
-          // Note that this can happen from cancelTimeout or a non-repeating timeout.
-          timeouts.erase(it);
-        }
-      });
-
-      if (state.isCanceled) {
-        // We've been canceled before running. Nothing more to do.
-        KJ_ASSERT(state.maybePromise == kj::none);
-        return;
-      }
-
-      KJ_IF_SOME(promise, state.maybePromise) {
-        // We could KJ_ASSERT_NONNULL(iter->second) instead if we are sure clearTimeout() couldn't
-        // race us. However, I'm not sure about that.
-
-        // First, move our timeout promise to the task set so it's safe to call clearInterval()
-        // inside the user's callback. We don't yet null out the Maybe<Promise>, because we need to
-        // be able to detect whether the user does call clearInterval(). We leave the actual map
-        // entry in place because this aids in reporting cross-request-context timeout cancellation
-        // errors to the user.
-        context.addTask(kj::mv(promise));
-
-        // Because Promise has an underspecified move ctor, we need to explicitly nullify the Maybe
-        // to indicate that we've consumed the promise.
-        state.maybePromise = kj::none;
-
-        // The user's callback might throw, but we need to at least attempt to reschedule interval
-        // callbacks even if they throw. This deferred action takes care of that. Note that we don't
-        // run the user's callback directly in this->run(), because that function throws a fatal
-        // exception if a JS exception is thrown, which complicates our logic here.
-        //
-        // TODO(perf): If we can guarantee that `timeout->second = nullptr` will never throw, it
-        //   might be worthwhile having an early-out path for non-interval timeouts.
-        kj::UnwindDetector unwindDetector;
-        KJ_DEFER(unwindDetector.catchExceptionsIfUnwinding([&] {
-          if (state.isCanceled) {
-            // The user's callback has called clearInterval(), nothing more to do.
-            KJ_ASSERT(state.maybePromise == kj::none);
-            return;
-          }
-
-          // If this is an interval task and the script has CPU time left, reschedule the task;
-          // otherwise leave the dead map entry in place.
-          if (state.params.repeat && context.limitEnforcer->getLimitsExceeded() == kj::none) {
-            setTimeoutImpl(context, it);
-          }
-        }););
-
-        state.trigger(lock);
+  auto promise = paf.promise.then(
+      [this, &context, id, &scheduledRef, cs = context.getCriticalSection()]() mutable {
+    return context.run([this, &context, id, &scheduledRef](Worker::Lock& lock) mutable {
+      fire(context, lock, id, false);
+      if (context.batchCallbacks && context.actor == kj::none) {
+        fireDue(context, lock, scheduledRef);
       }
     }, kj::mv(cs));
   }, [](kj::Exception&&) {});
 
   promise = promise.attach(context.registerPendingEvent());
 
-  // Add an entry to the timeoutTimes map, to track when the nearest timeout is. Arrange for it
-  // to be removed when the promise completes.
-  TimeoutTime timeoutTimesKey{when, timeoutTimesTiebreakerCounter++};
-  timeoutTimes.insert(timeoutTimesKey, kj::mv(paf.fulfiller));
-  auto deferredTimeoutTimeRemoval = kj::defer([this, &context, timeoutTimesKey]() {
+  timeoutTimes.add(*scheduled);
+  bool isFirst = &KJ_ASSERT_NONNULL(timeoutTimes.front()) == scheduled.get();
+  auto deferredTimeoutTimeRemoval =
+      kj::defer([this, &context, scheduled = kj::mv(scheduled)]() mutable {
     // If the promise is being destroyed due to IoContext teardown then IoChannelFactory may
     // no longer be available, but we can just skip starting a new timer in that case as it'd be
     // canceled anyway.
     if (context.selfRef->isValid()) {
-      bool isNext = timeoutTimes.begin()->key == timeoutTimesKey;
-      timeoutTimes.erase(timeoutTimesKey);
+      // fireDue() may have taken the entry out already, in which case it resets the timer itself.
+      bool isNext = false;
+      KJ_IF_SOME(front, timeoutTimes.front()) {
+        isNext = &front == scheduled.get();
+      }
+      scheduled = nullptr;
       if (isNext) resetTimerTask(context.getIoChannelFactory().getTimer());
     }
   });
 
-  if (timeoutTimes.begin()->key == timeoutTimesKey) {
+  if (isFirst) {
     resetTimerTask(context.getIoChannelFactory().getTimer());
   }
   promise = promise.attach(kj::mv(deferredTimeoutTimeRemoval));
@@ -712,33 +685,128 @@ void IoContext::TimeoutManagerImpl::setTimeoutImpl(IoContext& context, Iterator
   state.maybePromise = promise.eagerlyEvaluate(nullptr);
 }
 
+void IoContext::TimeoutManagerImpl::fire(
+    IoContext& context, Worker::Lock& lock, TimeoutId id, bool isInline) {
+  auto& state = getState(id);
+
+  auto stateGuard = kj::defer([&] {
+    if (state.maybePromise == kj::none) {
+      // At the end of this block, there was no new timeout, so we should remove the state.
+      // Note that this can happen from cancelTimeout or a non-repeating timeout.
+      timeouts.erase(id);
+    }
+  });
+
+  if (state.isCanceled) {
+    // We've been canceled before running. Nothing more to do.
+    KJ_ASSERT(state.maybePromise == kj::none);
+    return;
+  }
+
+  KJ_IF_SOME(promise, state.maybePromise) {
+    // We could KJ_ASSERT_NONNULL(iter->second) instead if we are sure clearTimeout() couldn't
+    // race us. However, I'm not sure about that.
+
+    // First, move our timeout promise to the task set so it's safe to call clearInterval()
+    // inside the user's callback. We don't yet null out the Maybe<Promise>, because we need to
+    // be able to detect whether the user does call clearInterval(). We leave the actual map
+    // entry in place because this aids in reporting cross-request-context timeout cancellation
+    // errors to the user.
+    //
+    // A timeout that fireDue() runs along with an earlier one wasn't fired by its promise, which
+    // only needs to stay alive until the callback has returned.
+    kj::Maybe<kj::Promise<void>> inlinePromise;
+    if (isInline) {
+      inlinePromise = kj::mv(promise);
+    } else {
+      context.addTask(kj::mv(promise));
+    }
+
+    // Because Promise has an underspecified move ctor, we need to explicitly nullify the Maybe
+    // to indicate that we've consumed the promise.
+    state.maybePromise = kj::none;
+
+    // The user's callback might throw, but we need to at least attempt to reschedule interval
+    // callbacks even if they throw. This deferred action takes care of that. Note that we don't
+    // run the user's callback directly in this->run(), because that function throws a fatal
+    // exception if a JS exception is thrown, which complicates our logic here.
+    //
+    // TODO(perf): If we can guarantee that `timeout->second = nullptr` will never throw, it
+    //   might be worthwhile having an early-out path for non-interval timeouts.
+    kj::UnwindDetector unwindDetector;
+    KJ_DEFER(unwindDetector.catchExceptionsIfUnwinding([&] {
+      if (state.isCanceled) {
+        // The user's callback has called clearInterval(), nothing more to do.
+        KJ_ASSERT(state.maybePromise == kj::none);
+        return;
+      }
+
+      // If this is an interval task and the script has CPU time left, reschedule the task;
+      // otherwise leave the dead map entry in place.
+      if (state.params.repeat && context.limitEnforcer->getLimitsExceeded() == kj::none) {
+        setTimeoutImpl(context, id);
+      }
+    }););
+
+    state.trigger(lock);
+  }
+}
+
+void IoContext::TimeoutManagerImpl::fireDue(
+    IoContext& context, Worker::Lock& lock, ScheduledTimeout& first) {
+  auto& timer = context.getIoChannelFactory().getTimer();
+
+  // `first` would only leave timeoutTimes once its promise completes, after we've released the
+  // lock. Take it out now so that the timeouts behind it can be found, and wait for whichever
+  // timeout is left at the front when we're done.
+  timeoutTimes.remove(first);
+  KJ_DEFER(resetTimerTask(timer));
+
+  // Only run timeouts that were set before this batch started, so that a zero-delay interval
+  // can't keep the batch going forever.
+  auto now = timer.now();
+  auto endSequence = timeoutTimesTiebreakerCounter;
+  jsg::Lock& js = lock;
+  for (;;) {
+    kj::Maybe<TimeoutId> next;
+    KJ_IF_SOME(entry, timeoutTimes.front()) {
+      if (entry.getWhen() <= now && entry.getSequence() < endSequence) {
+        next = kj::downcast<ScheduledTimeout>(entry).id;
+      }
+    }
+    if (next == kj::none || context.limitEnforcer->getLimitsExceeded() != kj::none) {
+      break;
+    }
+
+    // Settle the promises of the previous callback first, as if this one ran in its own turn.
+    js.runMicrotasks();
+    fire(context, lock, KJ_ASSERT_NONNULL(next), true);
+  }
+}
+
 void IoContext::TimeoutManagerImpl::resetTimerTask(TimerChannel& timerChannel) {
-  if (timeoutTimes.size() == 0) {
-    // Not waiting for any timer, clear the existing timer task.
-    timerTask = nullptr;
-  } else {
+  KJ_IF_SOME(entry, timeoutTimes.front()) {
     // Wait for the first timer.
-    auto& entry = *timeoutTimes.begin();
-    timerTask = timerChannel.atTime(entry.key.when)
-                    .then([this, key = entry.key]() {
-      auto& newEntry = *timeoutTimes.begin();
-      KJ_ASSERT(newEntry.key == key,
+    timerTask = timerChannel.atTime(entry.getWhen())
+                    .then([this, &entry]() {
+      auto& newEntry = KJ_ASSERT_NONNULL(timeoutTimes.front());
+      KJ_ASSERT(&newEntry == &entry,
           "front of timeoutTimes changed without calling resetTimerTask(), we probably missed "
           "a timeout!");
-      newEntry.value->fulfill();
+      kj::downcast<ScheduledTimeout>(newEntry).fulfiller->fulfill();
     }).eagerlyEvaluate([](kj::Exception&& e) { KJ_LOG(ERROR, e); });
+  } else {
+    // Not waiting for any timer, clear the existing timer task.
+    timerTask = nullptr;
   }
 }
 
 void IoContext::TimeoutManagerImpl::clearTimeout(IoContext& context, TimeoutId timeoutId) {
-  auto timeout = timeouts.find(timeoutId);
-  if (timeout == timeouts.end()) {
-    // We can't find this timeout, thus we act as if it was already canceled.
-    return;
+  KJ_IF_SOME(timeout, timeouts.find(timeoutId)) {
+    // Cancel the timeout.
+    timeout->cancel();
   }
-
-  // Cancel the timeout.
-  timeout->second.cancel();
+  // Otherwise we can't find this timeout, thus we act as if it was already canceled.
 }
 
 TimeoutId IoContext::setTimeoutImpl(
@@ -781,6 +849,22 @@ kj::Date IoContext::now() {
   return now(getCurrentIncomingRequest());
 }
 
+kj::Own<kj::HttpHeaders> IoContext::newSubrequestHeaders() {
+  if (spareSubrequestHeaders.empty()) {
+    return kj::heap<kj::HttpHeaders>(getHeaderTable());
+  }
+  auto result = kj::mv(spareSubrequestHeaders.back());
+  spareSubrequestHeaders.removeLast();
+  return result;
+}
+
+void IoContext::recycleSubrequestHeaders(kj::Own<kj::HttpHeaders> headers) {
+  if (spareSubrequestHeaders.size() < MAX_SPARE_SUBREQUEST_HEADERS) {
+    headers->clear();
+    spareSubrequestHeaders.add(kj::mv(headers));
+  }
+}
+
 kj::Own<WorkerInterface> IoContext::getSubrequestNoChecks(
     kj::FunctionParam<kj::Own<WorkerInterface>(TraceContext&, IoChannelFactory&)> func,
     SubrequestOptions options) {
@@ -1056,105 +1140,190 @@ void IoContext::runImpl(Runnable& runnable,
   getIoChannelFactory().getTimer().syncTime();
 
   runInContextScope(lockType, kj::mv(inputLock), [&](Worker::Lock& workerLock) {
-    if (!allowPermanentException) {
-      workerLock.requireNoPermanentException();
-    }
+    runInLock(runnable, workerLock, takePendingEvent, allowPermanentException);
+  });
+}
 
-    kj::Own<void> event;
-    if (takePendingEvent) {
-      // Prevent finalizers from running while we're still executing JavaScript.
-      event = registerPendingEvent();
-    }
+void IoContext::runInLock(Runnable& runnable,
+    Worker::Lock& workerLock,
+    bool takePendingEvent,
+    bool allowPermanentException) {
+  if (!allowPermanentException) {
+    workerLock.requireNoPermanentException();
+  }
 
-    auto limiterScope = limitEnforcer->enterJs(workerLock, *this);
-
-    bool gotTermination = false;
-
-    KJ_DEFER({
-      // Always clear out all pending V8 events before leaving the scope. This ensures that
-      // there's never any unfinished work waiting to run when we return to the event loop.
-      //
-      // Alternatively, we could use kj::evalLater() to queue a callback which runs the microtasks.
-      // This would perhaps prevent a microtask loop from blocking incoming I/O events. However,
-      // in practice this seems like a dubious scenario. A script that does while(1) will always
-      // block I/O, so why should a script in a promise loop not? If scripts want to use 100% of
-      // CPU but also receive I/O as it arrives, we should offer some API to explicitly request
-      // polling for I/O.
-      jsg::Lock& js = workerLock;
-
-      if (gotTermination) {
-        // We already consumed the termination pseudo-exception, so if we call RunMicrotasks() now,
-        // they will run with no limit. But if we call TerminateExecution() again now, it will
-        // conveniently cause RunMicrotasks() to terminate _right after_ dequeuing the contents of
-        // the task queue, which is perfect, because it effectively cancels them all.
-        js.terminateExecution();
-      }
+  kj::Own<void> event;
+  if (takePendingEvent) {
+    // Prevent finalizers from running while we're still executing JavaScript.
+    event = registerPendingEvent();
+  }
 
-      // Running the microtask queue can itself trigger a pending exception in the isolate.
-      v8::TryCatch tryCatch(workerLock.getIsolate());
+  auto limiterScope = limitEnforcer->enterJs(workerLock, *this);
 
-      js.runMicrotasks();
+  bool gotTermination = false;
 
-      if (tryCatch.HasCaught()) {
-        // It really shouldn't be possible for microtasks to throw regular exceptions.
-        // so if we got here it should be a terminal condition.
-        KJ_ASSERT(tryCatch.HasTerminated());
-        // If we do not reset here we end up with a dangling exception in the isolate that
-        // leads to an assert in v8 when the Lock is destroyed.
-        tryCatch.Reset();
-      }
-    });
+  KJ_DEFER({
+    // Always clear out all pending V8 events before leaving the scope. This ensures that
+    // there's never any unfinished work waiting to run when we return to the event loop.
+    //
+    // Alternatively, we could use kj::evalLater() to queue a callback which runs the microtasks.
+    // This would perhaps prevent a microtask loop from blocking incoming I/O events. However,
+    // in practice this seems like a dubious scenario. A script that does while(1) will always
+    // block I/O, so why should a script in a promise loop not? If scripts want to use 100% of
+    // CPU but also receive I/O as it arrives, we should offer some API to explicitly request
+    // polling for I/O.
+    jsg::Lock& js = workerLock;
+
+    if (gotTermination) {
+      // We already consumed the termination pseudo-exception, so if we call RunMicrotasks() now,
+      // they will run with no limit. But if we call TerminateExecution() again now, it will
+      // conveniently cause RunMicrotasks() to terminate _right after_ dequeuing the contents of
+      // the task queue, which is perfect, because it effectively cancels them all.
+      js.terminateExecution();
+    }
 
+    // Running the microtask queue can itself trigger a pending exception in the isolate.
     v8::TryCatch tryCatch(workerLock.getIsolate());
-    try {
-      runnable.run(workerLock);
-    } catch (const jsg::JsExceptionThrown&) {
-      if (tryCatch.HasTerminated()) {
-        gotTermination = true;
-        limiterScope = nullptr;
-
-        // Check if we hit a limit.
-        limitEnforcer->requireLimitsNotExceeded();
-
-        // If we were terminated because abort() was called, then it's not an unknown
-        // reason...
-        if (!abortFulfiller->isWaiting()) {
-          // The assumption is that we've terminated because the IoContext was aborted and
-          // isolate->TerminateExection() was called (likely because of someone using
-          // process.exit(...) in Node.js compat mode).
-
-          // TODO(later): If this ends up being too spammy in sentry that we'll need to
-          // revisit, but for now... log the assert and move on.
-          KJ_FAIL_ASSERT("request terminated because it was aborted");
-        }
 
-        // That should have thrown, so we shouldn't get here.
-        KJ_FAIL_ASSERT("script terminated for unknown reasons");
+    js.runMicrotasks();
+
+    if (tryCatch.HasCaught()) {
+      // It really shouldn't be possible for microtasks to throw regular exceptions.
+      // so if we got here it should be a terminal condition.
+      KJ_ASSERT(tryCatch.HasTerminated());
+      // If we do not reset here we end up with a dangling exception in the isolate that
+      // leads to an assert in v8 when the Lock is destroyed.
+      tryCatch.Reset();
+    }
+  });
+
+  v8::TryCatch tryCatch(workerLock.getIsolate());
+  try {
+    runnable.run(workerLock);
+  } catch (const jsg::JsExceptionThrown&) {
+    if (tryCatch.HasTerminated()) {
+      gotTermination = true;
+      limiterScope = nullptr;
+
+      // Check if we hit a limit.
+      limitEnforcer->requireLimitsNotExceeded();
+
+      // If we were terminated because abort() was called, then it's not an unknown
+      // reason...
+      if (!abortFulfiller->isWaiting()) {
+        // The assumption is that we've terminated because the IoContext was aborted and
+        // isolate->TerminateExection() was called (likely because of someone using
+        // process.exit(...) in Node.js compat mode).
+
+        // TODO(later): If this ends up being too spammy in sentry that we'll need to
+        // revisit, but for now... log the assert and move on.
+        KJ_FAIL_ASSERT("request terminated because it was aborted");
+      }
+
+      // That should have thrown, so we shouldn't get here.
+      KJ_FAIL_ASSERT("script terminated for unknown reasons");
+    } else {
+      if (tryCatch.Message().IsEmpty()) {
+        // Should never happen, but check for it because otherwise V8 will crash.
+        KJ_LOG(ERROR, "tryCatch.Message() was empty even when not HasTerminated()??",
+            kj::getStackTrace());
+        JSG_FAIL_REQUIRE(Error, "(JavaScript exception with no message)");
       } else {
-        if (tryCatch.Message().IsEmpty()) {
-          // Should never happen, but check for it because otherwise V8 will crash.
-          KJ_LOG(ERROR, "tryCatch.Message() was empty even when not HasTerminated()??",
-              kj::getStackTrace());
-          JSG_FAIL_REQUIRE(Error, "(JavaScript exception with no message)");
+        auto jsException = tryCatch.Exception();
+
+        // TODO(someday): We log "uncaught exception" here whenever throwing from JS to C++.
+        //   However, the C++ code calling us may still catch the exception and do its own logging,
+        //   or may even tunnel it back to JavaScript, making this log line redundant or maybe even
+        //   wrong (if the exception is in fact caught later). But, it's difficult to be sure that
+        //   all C++ consumers log properly, and even if they do, the stack trace is lost once the
+        //   exception has been tunneled into a KJ exception, so the later logging won't be as
+        //   useful. We should improve the tunneling to include stack traces and ensure that all
+        //   consumers do in fact log exceptions, then we can remove this.
+        workerLock.logUncaughtException(UncaughtExceptionSource::INTERNAL,
+            jsg::JsValue(jsException), jsg::JsMessage(tryCatch.Message()));
+
+        jsg::throwTunneledException(workerLock.getIsolate(), jsException);
+      }
+    }
+  }
+}
+
+kj::Promise<void> IoContext::queueRun(kj::Own<Runnable> runnable) {
+  auto paf = kj::newPromiseAndFulfiller<void>();
+  queuedRuns.add(QueuedRun{kj::mv(runnable), kj::mv(paf.fulfiller)});
+  if (queuedRuns.size() == 1 && !holdingLock) {
+    scheduleQueuedRuns();
+  }
+  return kj::mv(paf.promise);
+}
+
+void IoContext::scheduleQueuedRuns() {
+  queuedRunsTasks.add(
+      reportWait(worker->takeAsyncLock(getMetrics()), &RequestObserver::isolateLockWaited)
+          .then([this](Worker::AsyncLock lock) {
+    return runQueuedAndHoldLock(kj::mv(lock));
+  }, [this](kj::Exception&& e) {
+    for (auto& queued: queuedRuns) {
+      queued.fulfiller->reject(kj::cp(e));
+    }
+    queuedRuns.clear();
+  }));
+}
+
+void IoContext::runQueued(Worker::AsyncLock& asyncLock) {
+  // Callbacks that are queued while this batch runs go into the next one, so that a callback that
+  // keeps queueing more can't starve the event loop.
+  auto batch = kj::mv(queuedRuns);
+  queuedRuns = {};
+
+  size_t next = 0;
+  KJ_IF_SOME(exception, kj::runCatchingExceptions([&]() {
+    getIoChannelFactory().getTimer().syncTime();
+    runInContextScope(asyncLock, kj::none, [&](Worker::Lock& workerLock) {
+      for (; next < batch.size(); ++next) {
+        auto& queued = batch[next];
+        // Each callback gets its own pending event, CPU limit scope and microtask checkpoint, just
+        // like on its own lock. Only taking the lock and entering the context are shared.
+        KJ_IF_SOME(e, kj::runCatchingExceptions([&]() {
+          runInLock(*queued.runnable, workerLock, true, false);
+        })) {
+          queued.fulfiller->reject(kj::mv(e));
         } else {
-          auto jsException = tryCatch.Exception();
-
-          // TODO(someday): We log "uncaught exception" here whenever throwing from JS to C++.
-          //   However, the C++ code calling us may still catch the exception and do its own logging,
-          //   or may even tunnel it back to JavaScript, making this log line redundant or maybe even
-          //   wrong (if the exception is in fact caught later). But, it's difficult to be sure that
-          //   all C++ consumers log properly, and even if they do, the stack trace is lost once the
-          //   exception has been tunneled into a KJ exception, so the later logging won't be as
-          //   useful. We should improve the tunneling to include stack traces and ensure that all
-          //   consumers do in fact log exceptions, then we can remove this.
-          workerLock.logUncaughtException(UncaughtExceptionSource::INTERNAL,
-              jsg::JsValue(jsException), jsg::JsMessage(tryCatch.Message()));
-
-          jsg::throwTunneledException(workerLock.getIsolate(), jsException);
+          queued.fulfiller->fulfill();
         }
       }
+    });
+  })) {
+    for (; next < batch.size(); ++next) {
+      batch[next].fulfiller->reject(kj::cp(exception));
     }
-  });
+  }
+}
+
+kj::Promise<void> IoContext::runQueuedAndHoldLock(Worker::AsyncLock asyncLock) {
+  // The lock mustn't outlive the current stretch of work, so it's only kept for a bounded number
+  // of turns, and only as long as each of them queues something.
+  static constexpr uint MAX_HELD_BATCHES = 64;
+
+  holdingLock = true;
+  KJ_DEFER(holdingLock = false);
+
+  runQueued(asyncLock);
+  for (uint i = 1; i < MAX_HELD_BATCHES; ++i) {
+    // Let the events that are already queued, such as the rest of the I/O resolving this turn,
+    // run first and maybe queue more callbacks.
+    co_await kj::yield();
+    if (queuedRuns.empty() || asyncLock.isContended()) break;
+    runQueued(asyncLock);
+  }
+
+  if (!queuedRuns.empty()) {
+    // Someone else is waiting, or we're out of turns. Release the lock before getting back in
+    // line, since taking it again while we still hold it would just join our own hold.
+    { auto released = kj::mv(asyncLock); }
+    holdingLock = false;
+    scheduleQueuedRuns();
+  }
 }
 
 static constexpr auto kAsyncIoErrorMessage =
@@ -1303,6 +1472,14 @@ void IoContext::writeLogfwdr(
                    .attach(registerPendingEvent()));
 }
 
+void IoContext::writeLogfwdrBatch(uint channel,
+    uint count,
+    kj::FunctionParam<void(uint index, capnp::AnyPointer::Builder)> buildMessage) {
+  addWaitUntil(getIoChannelFactory()
+                   .writeLogfwdrBatch(channel, count, kj::mv(buildMessage))
+                   .attach(registerPendingEvent()));
+}
+
 void IoContext::requireCurrentOrThrowJs() {
   if (!isCurrent()) {
     throwNotCurrentJsError();
@@ -16,6 +16,7 @@
 #include <workerd/io/trace.h>
 #include <workerd/jsg/async-context.h>
 #include <workerd/jsg/jsg.h>
+#include <workerd/util/thread-pool.h>
 #include <workerd/util/uncaught-exception-source.h>
 #include <workerd/util/weak-refs.h>
 
@@ -249,6 +250,12 @@ class IoContext final: public kj::Refcounted, private kj::TaskSet::ErrorHandler
     return *getCurrentIncomingRequest().metrics;
   }
 
+  // Like getMetrics(), but returns kj::none if the context has no current IncomingRequest.
+  kj::Maybe<RequestObserver&> tryGetMetrics() {
+    if (incomingRequests.empty()) return kj::none;
+    return *getCurrentIncomingRequest().metrics;
+  }
+
   const kj::Maybe<WorkerTracer&> getWorkerTracer() {
     if (incomingRequests.empty()) return kj::none;
     return getCurrentIncomingRequest().getWorkerTracer();
@@ -302,6 +309,8 @@ class IoContext final: public kj::Refcounted, private kj::TaskSet::ErrorHandler
   template <typename T>
   kj::Promise<T> lockOutputWhile(kj::Promise<T> promise);
 
+  // True if an inspector session is attached to the isolate, i.e. if warnings meant for a
+  // developer have somewhere to go. An isolate that merely allows the inspector doesn't count.
   bool isInspectorEnabled();
   bool isFiddle();
 
@@ -486,6 +495,18 @@ class IoContext final: public kj::Refcounted, private kj::TaskSet::ErrorHandler
   template <typename T>
   jsg::Promise<T> awaitIoLegacyWithInputLock(jsg::Lock& js, kj::Promise<T> promise);
 
+  // Runs `func` on the shared ThreadPool, without the isolate lock, and returns a promise for its
+  // result that is suitable for passing to awaitIo(). Use this for CPU-bound native work that
+  // would otherwise stall every other request on the isolate; `func` must not touch JavaScript
+  // objects, so copy its inputs first. The pool thread's CPU time is charged to this request via
+  // LimitEnforcer::reportOffThreadCpuTime().
+  //
+  // Returns kj::none if the isolate is already at its off-thread task limit (see
+  // IsolateLimitEnforcer::getOffThreadTaskLimit()). In that case `func` is left untouched, and
+  // the caller should call it inline, as it would have without a pool.
+  template <typename T>
+  kj::Maybe<kj::Promise<T>> tryRunOffThread(kj::Function<T()>&& func);
+
   // Returns a KJ promise that resolves when a particular JavaScript promise completes.
   //
   // The JS promise must complete within this IoContext. The KJ promise will reject
@@ -648,6 +669,13 @@ class IoContext final: public kj::Refcounted, private kj::TaskSet::ErrorHandler
     return thread.getHeaderIds();
   }
 
+  // Returns an empty header set for building an outgoing subrequest. A request that fans out to
+  // many subrequests reuses the same few header sets rather than allocating new ones each time.
+  // Hand it back to recycleSubrequestHeaders() once the subrequest has been started; HttpClient
+  // implementations never hold on to the request headers past `request()`.
+  kj::Own<kj::HttpHeaders> newSubrequestHeaders();
+  void recycleSubrequestHeaders(kj::Own<kj::HttpHeaders> headers);
+
   // Subrequest channel numbers for the two special channels.
   // NULL = The channel used by global fetch() when the Request has no fetcher attached.
   // NEXT = DEPRECATED: The fetcher attached to Requests delivered by a FetchEvent, so that we can
@@ -813,6 +841,12 @@ class IoContext final: public kj::Refcounted, private kj::TaskSet::ErrorHandler
 
   void writeLogfwdr(uint channel, kj::FunctionParam<void(capnp::AnyPointer::Builder)> buildMessage);
 
+  // Writes `count` messages to a logfwdr channel together; see
+  // IoChannelFactory::writeLogfwdrBatch().
+  void writeLogfwdrBatch(uint channel,
+      uint count,
+      kj::FunctionParam<void(uint index, capnp::AnyPointer::Builder)> buildMessage);
+
   jsg::JsObject getPromiseContextTag(jsg::Lock& js);
 
   // Returns the existing WarningAggregator for the specified key, or calls load to create one.
@@ -865,6 +899,10 @@ class IoContext final: public kj::Refcounted, private kj::TaskSet::ErrorHandler
 
   WarningAggregator::Map warningAggregatorMap;
 
+  // Header sets returned through recycleSubrequestHeaders(), cleared and ready for reuse.
+  static constexpr size_t MAX_SPARE_SUBREQUEST_HEADERS = 4;
+  kj::Vector<kj::Own<kj::HttpHeaders>> spareSubrequestHeaders;
+
   // Objects pointed to by IoOwn<T>s.
   // NOTE: This must live below `deleteQueue`, as some of these OwnedObjects may own attachctx()'ed
   //   objects which reference `deleteQueue` in their destructors.
@@ -884,6 +922,20 @@ class IoContext final: public kj::Refcounted, private kj::TaskSet::ErrorHandler
       double msDelay,
       kj::Array<jsg::Value> args);
 
+  // With the `batched_callbacks` compatibility flag, run() on a context that doesn't belong to an
+  // actor queues its callback instead of taking the isolate lock for it. All callbacks queued
+  // while waiting for the lock then run under it, in order, each followed by a microtask
+  // checkpoint. Expired timeouts are batched the same way. Actors keep taking the lock per
+  // callback, since each of those callbacks holds its own input lock.
+  //
+  // After a batch, the lock is kept for as long as each turn of the event loop queues more
+  // callbacks and no one else is waiting for the isolate, so that a request awaiting a chain of
+  // I/O doesn't hand the lock off and take it back for every step. `holdingLock` is true meanwhile.
+  bool batchCallbacks = false;
+  bool holdingLock = false;
+  kj::Vector<QueuedRun> queuedRuns;
+  kj::TaskSet queuedRunsTasks{*this};
+
   uint addTaskCounter = 0;
   kj::Maybe<kj::TaskSet> tasks;
 
@@ -926,8 +978,59 @@ class IoContext final: public kj::Refcounted, private kj::TaskSet::ErrorHandler
       kj::Maybe<InputGate::Lock> inputLock,
       bool allowPermanentException);
 
+  // The part of runImpl() that runs inside the context scope, which every callback gets on its own
+  // even when run() batches them.
+  void runInLock(Runnable& runnable,
+      Worker::Lock& workerLock,
+      bool takePendingEvent,
+      bool allowPermanentException);
+
+  // A callback that run() queues until the next batch, see `batchCallbacks`. It's refcounted so
+  // that the caller can pick up the result after the batch has dropped it.
+  template <typename Func,
+      typename Result = decltype(kj::instance<Func&>()(kj::instance<Worker::Lock&>()))>
+  struct QueuedRunnable final: public Runnable, public kj::Refcounted {
+    Func func;
+    kj::Maybe<Result> result;
+
+    QueuedRunnable(Func&& func): func(kj::fwd<Func>(func)) {}
+    void run(Worker::Lock& lock) override {
+      result = func(lock);
+    }
+    Result takeResult() {
+      return kj::mv(KJ_ASSERT_NONNULL(result));
+    }
+  };
+  template <typename Func>
+  struct QueuedRunnable<Func, void> final: public Runnable, public kj::Refcounted {
+    Func func;
+
+    QueuedRunnable(Func&& func): func(kj::fwd<Func>(func)) {}
+    void run(Worker::Lock& lock) override {
+      func(lock);
+    }
+    void takeResult() {}
+  };
+
+  struct QueuedRun {
+    kj::Own<Runnable> runnable;
+    kj::Own<kj::PromiseFulfiller<void>> fulfiller;
+  };
+
+  // Resolves once `runnable` has run in the next batch, or rejects with what it threw.
+  kj::Promise<void> queueRun(kj::Own<Runnable> runnable);
+  void scheduleQueuedRuns();
+  void runQueued(Worker::AsyncLock& asyncLock);
+  kj::Promise<void> runQueuedAndHoldLock(Worker::AsyncLock asyncLock);
+
   void runFinalizers(Worker::AsyncLock& asyncLock);
 
+  // Reports how long `promise` took to the current request's RequestObserver through `report`,
+  // e.g. `&RequestObserver::outputGateWaited`.
+  template <typename T>
+  kj::Promise<T> reportWait(
+      kj::Promise<T> promise, void (RequestObserver::*report)(kj::Duration duration));
+
   template <typename T>
   struct IdentityFunc {
     inline T operator()(jsg::Lock&, T&& value) const {
@@ -1000,6 +1103,18 @@ kj::Promise<T> IoContext::lockOutputWhile(kj::Promise<T> promise) {
   return getActorOrThrow().getOutputGate().lockWhile(kj::mv(promise));
 }
 
+template <typename T>
+kj::Promise<T> IoContext::reportWait(
+    kj::Promise<T> promise, void (RequestObserver::*report)(kj::Duration duration)) {
+  KJ_IF_SOME(metrics, tryGetMetrics()) {
+    auto start = kj::systemPreciseMonotonicClock().now();
+    return promise.attach(kj::defer([metrics = kj::addRef(metrics), report, start]() {
+      ((*metrics).*report)(kj::systemPreciseMonotonicClock().now() - start);
+    }));
+  }
+  return kj::mv(promise);
+}
+
 template <typename Func>
 kj::PromiseForResult<Func, Worker::Lock&> IoContext::run(
     Func&& func, kj::Maybe<kj::Own<InputGate::CriticalSection>> criticalSection) {
@@ -1019,15 +1134,22 @@ kj::PromiseForResult<Func, Worker::Lock&> IoContext::run(
   kj::Promise<Worker::AsyncLock> asyncLockPromise = nullptr;
   KJ_IF_SOME(a, actor) {
     if (inputLock == kj::none) {
-      return a.getInputGate().wait().then(
-          [this, func = kj::fwd<Func>(func)](InputGate::Lock&& inputLock) mutable {
+      return reportWait(a.getInputGate().wait(), &RequestObserver::inputGateWaited)
+          .then([this, func = kj::fwd<Func>(func)](InputGate::Lock&& inputLock) mutable {
         return run(kj::fwd<Func>(func), kj::mv(inputLock));
       });
     }
 
-    asyncLockPromise = worker->takeAsyncLockWhenActorCacheReady(now(), a, getMetrics());
+    asyncLockPromise =
+        reportWait(worker->takeAsyncLockWhenActorCacheReady(now(), a, getMetrics()),
+            &RequestObserver::isolateLockWaited);
+  } else if (batchCallbacks) {
+    auto runnable = kj::refcounted<QueuedRunnable<Func>>(kj::fwd<Func>(func));
+    auto ran = queueRun(kj::addRef(*runnable));
+    return ran.then([runnable = kj::mv(runnable)]() mutable { return runnable->takeResult(); });
   } else {
-    asyncLockPromise = worker->takeAsyncLock(getMetrics());
+    asyncLockPromise =
+        reportWait(worker->takeAsyncLock(getMetrics()), &RequestObserver::isolateLockWaited);
   }
 
   return asyncLockPromise.then([this, inputLock = kj::mv(inputLock), func = kj::fwd<Func>(func)](
@@ -1102,6 +1224,19 @@ jsg::Promise<T> IoContext::awaitIoLegacyWithInputLock(jsg::Lock& js, kj::Promise
   return awaitIoImpl(js, kj::mv(promise), getInputLock(), IdentityFunc<T>());
 }
 
+template <typename T>
+kj::Maybe<kj::Promise<T>> IoContext::tryRunOffThread(kj::Function<T()>&& func) {
+  KJ_IF_SOME(reservation, getWorker().getIsolate().tryReserveOffThreadTask()) {
+    return ThreadPool::getShared()
+        .run<T>(kj::mv(func))
+        .then([this](ThreadPool::Result<T> result) {
+      getLimitEnforcer().reportOffThreadCpuTime(result.cpuTime);
+      return kj::mv(result.value);
+    }).attach(kj::mv(reservation));
+  }
+  return kj::none;
+}
+
 // To reduce the code size impact of awaitIoImpl, move promise continuation code out of
 // awaitIoImpl() where possible. This way, the then() parameters are only templated based on one
 // type each.
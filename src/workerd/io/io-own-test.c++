@@ -0,0 +1,66 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "io-own.h"
+
+#include <kj/test.h>
+
+namespace workerd {
+namespace {
+
+struct Counted {
+  Counted(uint& destroyed): destroyed(destroyed) {}
+  ~Counted() {
+    ++destroyed;
+  }
+  uint& destroyed;
+};
+
+// Links `obj` the same way DeleteQueue::addObjectImpl() does.
+template <typename T>
+OwnedObject& link(OwnedObjectList& list, kj::Own<T> obj) {
+  kj::Own<OwnedObject> object;
+  KJ_IF_SOME(arena, list.getArena()) {
+    object = arena.allocate(kj::mv(obj));
+  } else {
+    object = kj::Own<OwnedObject>(new SpecificOwnedObject<T>(kj::mv(obj)),
+        kj::_::HeapDisposer<SpecificOwnedObject<T>>::instance);
+  }
+  auto& ref = *object;
+  list.link(kj::mv(object));
+  return ref;
+}
+
+KJ_TEST("OwnedObjectArena reuses slots and frees everything with the list") {
+  uint destroyed = 0;
+  {
+    OwnedObjectList list;
+    list.useArena();
+    auto& arena = KJ_ASSERT_NONNULL(list.getArena());
+
+    kj::Vector<OwnedObject*> objects;
+    for (uint i = 0; i < 100; i++) {
+      objects.add(&link(list, kj::heap<Counted>(destroyed)));
+    }
+    // Objects of other types share the same slots.
+    link(list, kj::heap<kj::String>(kj::str("hello")));
+    size_t allocated = arena.getAllocatedBytes();
+    KJ_EXPECT(allocated > 0);
+
+    for (uint i = 0; i < 100; i += 2) {
+      OwnedObjectList::unlink(*objects[i]);
+    }
+    KJ_EXPECT(destroyed == 50);
+
+    // Freed slots are reused before the arena grows.
+    for (uint i = 0; i < 50; i++) {
+      link(list, kj::heap<Counted>(destroyed));
+    }
+    KJ_EXPECT(arena.getAllocatedBytes() == allocated);
+  }
+  KJ_EXPECT(destroyed == 150);
+}
+
+}  // namespace
+}  // namespace workerd
@@ -91,6 +91,29 @@ kj::Promise<void> DeleteQueue::resetCrossThreadSignal() {
   }
 }
 
+OwnedObjectArena::~OwnedObjectArena() noexcept(false) {}
+
+void* OwnedObjectArena::allocateSlot() {
+  if (freeList != nullptr) {
+    auto slot = freeList;
+    freeList = slot->nextFree;
+    return slot;
+  }
+  if (usedInLastChunk == SLOTS_PER_CHUNK) {
+    chunks.add(kj::heap<Chunk>());
+    usedInLastChunk = 0;
+  }
+  return &chunks.back()->slots[usedInLastChunk++];
+}
+
+void OwnedObjectArena::disposeImpl(void* pointer) const {
+  auto& object = *reinterpret_cast<OwnedObject*>(pointer);
+  object.destroy(object);
+  auto slot = reinterpret_cast<Slot*>(pointer);
+  slot->nextFree = freeList;
+  freeList = slot;
+}
+
 OwnedObjectList::~OwnedObjectList() noexcept(false) {
   while (head != kj::none) {
     // We want to have the same order of operations as the recursive destructor here. Without this
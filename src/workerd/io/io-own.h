@@ -84,6 +84,10 @@ struct OwnedObject {
   kj::Maybe<kj::Own<OwnedObject>> next;
   kj::Maybe<kj::Own<OwnedObject>>* prev;
   kj::Maybe<Finalizeable&> finalizer;
+
+  // Destroys the SpecificOwnedObject<T> this is. Only set for objects allocated by an
+  // OwnedObjectArena, whose disposer doesn't otherwise know T.
+  void (*destroy)(OwnedObject& self) = nullptr;
 };
 
 template <typename T>
@@ -92,12 +96,61 @@ struct SpecificOwnedObject: public OwnedObject {
   kj::Own<T> ptr;
 };
 
+// Allocates the OwnedObjects of one OwnedObjectList from chunks that are only freed together, when
+// the list goes away, rather than giving each object its own heap allocation. Every
+// SpecificOwnedObject<T> has the same size whatever T is, so freed slots are simply reused.
+//
+// Only the list nodes live in the arena. The objects they own were allocated by the caller.
+class OwnedObjectArena final: public kj::Disposer {
+ public:
+  OwnedObjectArena() = default;
+  KJ_DISALLOW_COPY_AND_MOVE(OwnedObjectArena);
+  ~OwnedObjectArena() noexcept(false);
+
+  template <typename T>
+  kj::Own<OwnedObject> allocate(kj::Own<T> ptr);
+
+  // The total size of the chunks allocated so far.
+  size_t getAllocatedBytes() const {
+    return chunks.size() * sizeof(Chunk);
+  }
+
+ private:
+  static constexpr size_t SLOT_SIZE = sizeof(SpecificOwnedObject<int>);
+  static constexpr size_t SLOTS_PER_CHUNK = 64;
+
+  union Slot {
+    Slot* nextFree;
+    alignas(SpecificOwnedObject<int>) kj::byte bytes[SLOT_SIZE];
+  };
+  struct Chunk {
+    Slot slots[SLOTS_PER_CHUNK];
+  };
+
+  kj::Vector<kj::Own<Chunk>> chunks;
+
+  // Slots that were freed, and then the unused rest of the last chunk.
+  mutable Slot* freeList = nullptr;
+  size_t usedInLastChunk = SLOTS_PER_CHUNK;
+
+  void* allocateSlot();
+  void disposeImpl(void* pointer) const override;
+};
+
 class OwnedObjectList {
  public:
   OwnedObjectList() = default;
   KJ_DISALLOW_COPY_AND_MOVE(OwnedObjectList);
   ~OwnedObjectList() noexcept(false);
 
+  // Makes objects linked from now on be allocated from an arena, see OwnedObjectArena.
+  void useArena() {
+    arena.emplace();
+  }
+  kj::Maybe<OwnedObjectArena&> getArena() {
+    return arena;
+  }
+
   void link(kj::Own<OwnedObject> object);
   static void unlink(OwnedObject& object);
 
@@ -110,6 +163,9 @@ class OwnedObjectList {
   }
 
  private:
+  // Declared before `head` so that it outlives the objects it holds.
+  kj::Maybe<OwnedObjectArena> arena;
+
   kj::Maybe<kj::Own<OwnedObject>> head;
 
   bool finalizersRan = false;
@@ -198,8 +254,13 @@ inline SpecificOwnedObject<T>* DeleteQueue::addObjectImpl(
   //   (which would have forced a bunch of useless vtables and vtable pointers)... I'm manually
   //   constructing the kj::Own<> using a disposer that I know is compatible.
   // TODO(cleanup): Can KJ be made to support this use case?
-  kj::Own<OwnedObject> ownedObject(new SpecificOwnedObject<T>(kj::mv(obj)),
-      kj::_::HeapDisposer<SpecificOwnedObject<T>>::instance);
+  kj::Own<OwnedObject> ownedObject;
+  KJ_IF_SOME(arena, ownedObjects.getArena()) {
+    ownedObject = arena.allocate(kj::mv(obj));
+  } else {
+    ownedObject = kj::Own<OwnedObject>(new SpecificOwnedObject<T>(kj::mv(obj)),
+        kj::_::HeapDisposer<SpecificOwnedObject<T>>::instance);
+  }
 
   if constexpr (kj::canConvert<T&, Finalizeable&>()) {
     ownedObject->finalizer = ref;
@@ -210,6 +271,19 @@ inline SpecificOwnedObject<T>* DeleteQueue::addObjectImpl(
   return result;
 }
 
+template <typename T>
+inline kj::Own<OwnedObject> OwnedObjectArena::allocate(kj::Own<T> ptr) {
+  // The same single-inheritance reasoning as in DeleteQueue::addObjectImpl() applies here.
+  static_assert(sizeof(SpecificOwnedObject<T>) == SLOT_SIZE);
+  static_assert(alignof(SpecificOwnedObject<T>) <= alignof(Slot));
+  auto& object = *reinterpret_cast<SpecificOwnedObject<T>*>(allocateSlot());
+  kj::ctor(object, kj::mv(ptr));
+  object.destroy = [](OwnedObject& self) {
+    kj::dtor(static_cast<SpecificOwnedObject<T>&>(self));
+  };
+  return kj::Own<OwnedObject>(&object, *this);
+}
+
 template <typename T>
 inline IoOwn<T> DeleteQueue::addObject(kj::Own<T> obj, OwnedObjectList& ownedObjects) {
   return IoOwn<T>(kj::atomicAddRef(*this), addObjectImpl(kj::mv(obj), ownedObjects));
@@ -0,0 +1,101 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "io-timers.h"
+
+#include <kj/test.h>
+#include <kj/vector.h>
+
+namespace workerd {
+namespace {
+
+kj::Date at(int64_t ms) {
+  return kj::UNIX_EPOCH + ms * kj::MILLISECONDS;
+}
+
+// Removes every entry from the wheel and returns their due times in the order they came out.
+kj::Vector<int64_t> drain(TimeoutWheel& wheel) {
+  kj::Vector<int64_t> result;
+  KJ_IF_SOME(entry, wheel.front()) {
+    result.add((entry.getWhen() - kj::UNIX_EPOCH) / kj::MILLISECONDS);
+    wheel.remove(entry);
+    result.addAll(drain(wheel));
+  }
+  return result;
+}
+
+KJ_TEST("TimeoutWheel orders timeouts across levels") {
+  TimeoutWheel wheel;
+  // Due times spread over every level of the wheel and the overflow list, added out of order.
+  int64_t base = 1'700'000'000'000;
+  int64_t offsets[] = {5, 0, 63, 64, 4000, 4095, 4096, 300'000, 20'000'000, 1, 20'000'000, 65};
+  kj::Vector<kj::Own<TimeoutWheel::Entry>> entries;
+  for (auto i: kj::indices(offsets)) {
+    entries.add(kj::heap<TimeoutWheel::Entry>(at(base + offsets[i]), i));
+    wheel.add(*entries.back());
+  }
+  KJ_EXPECT(wheel.size() == kj::size(offsets));
+
+  auto order = drain(wheel);
+  KJ_ASSERT(order.size() == kj::size(offsets));
+  for (auto i: kj::range(1, order.size())) {
+    KJ_EXPECT(order[i - 1] <= order[i], i, order[i - 1], order[i]);
+  }
+  KJ_EXPECT(order.front() == base);
+  KJ_EXPECT(order.back() == base + 20'000'000);
+  KJ_EXPECT(wheel.front() == kj::none);
+}
+
+KJ_TEST("TimeoutWheel keeps timeouts in the same tick sorted") {
+  TimeoutWheel wheel;
+  TimeoutWheel::Entry late(kj::UNIX_EPOCH + 10 * kj::MILLISECONDS + 500 * kj::MICROSECONDS, 0);
+  TimeoutWheel::Entry second(at(10), 2);
+  TimeoutWheel::Entry first(at(10), 1);
+  wheel.add(late);
+  wheel.add(second);
+  wheel.add(first);
+
+  KJ_EXPECT(&KJ_ASSERT_NONNULL(wheel.front()) == &first);
+  wheel.remove(first);
+  KJ_EXPECT(&KJ_ASSERT_NONNULL(wheel.front()) == &second);
+  wheel.remove(second);
+  KJ_EXPECT(&KJ_ASSERT_NONNULL(wheel.front()) == &late);
+}
+
+KJ_TEST("TimeoutWheel accepts timeouts that are already due") {
+  TimeoutWheel wheel;
+  TimeoutWheel::Entry far(at(100'000), 0);
+  TimeoutWheel::Entry soon(at(100'010), 1);
+  wheel.add(far);
+  wheel.add(soon);
+  wheel.remove(far);
+
+  // The wheel's cursor is at 100'000 by now, but an earlier timeout still comes first.
+  TimeoutWheel::Entry overdue(at(50), 2);
+  wheel.add(overdue);
+  KJ_EXPECT(&KJ_ASSERT_NONNULL(wheel.front()) == &overdue);
+  wheel.remove(overdue);
+  KJ_EXPECT(&KJ_ASSERT_NONNULL(wheel.front()) == &soon);
+}
+
+KJ_TEST("TimeoutWheel entries remove themselves") {
+  TimeoutWheel wheel;
+  TimeoutWheel::Entry kept(at(2'000), 0);
+  wheel.add(kept);
+  {
+    TimeoutWheel::Entry dropped(at(1'000), 1);
+    wheel.add(dropped);
+    KJ_EXPECT(&KJ_ASSERT_NONNULL(wheel.front()) == &dropped);
+  }
+  KJ_EXPECT(wheel.size() == 1);
+  KJ_EXPECT(&KJ_ASSERT_NONNULL(wheel.front()) == &kept);
+
+  // Removing an entry twice does nothing.
+  wheel.remove(kept);
+  wheel.remove(kept);
+  KJ_EXPECT(wheel.size() == 0);
+}
+
+}  // namespace
+}  // namespace workerd
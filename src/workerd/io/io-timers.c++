@@ -1,5 +1,7 @@
 #include "io-timers.h"
 
+#include <bit>
+
 namespace workerd {
 
 TimeoutId TimeoutId::Generator::getNext() {
@@ -28,4 +30,174 @@ TimeoutManager::TimeoutParameters::TimeoutParameters(
   }
 }
 
+TimeoutWheel::Entry::Entry(kj::Date when, uint64_t sequence)
+    : when(when),
+      sequence(sequence),
+      tick(when > kj::UNIX_EPOCH ? (when - kj::UNIX_EPOCH) / kj::MILLISECONDS : 0) {}
+
+TimeoutWheel::Entry::~Entry() noexcept(false) {
+  KJ_IF_SOME(w, wheel) {
+    w.remove(*this);
+  }
+}
+
+TimeoutWheel::~TimeoutWheel() noexcept(false) {
+  // Normally every entry has removed itself by now, but don't leave dangling pointers if not.
+  auto detach = [](Slot& slot) {
+    for (Entry* entry = slot.head; entry != nullptr;) {
+      Entry* next = entry->next;
+      entry->wheel = kj::none;
+      entry->prev = nullptr;
+      entry->next = nullptr;
+      entry = next;
+    }
+  };
+  for (auto& slot: slots) {
+    detach(slot);
+  }
+  detach(overflow);
+}
+
+void TimeoutWheel::add(Entry& entry) {
+  KJ_REQUIRE(entry.wheel == kj::none, "timeout is already in a wheel");
+  if (slots == nullptr) {
+    slots = kj::heapArray<Slot>(LEVELS * SLOTS);
+  }
+  if (count == 0) {
+    cursor = entry.tick;
+  }
+  entry.wheel = *this;
+  ++count;
+  place(entry);
+}
+
+void TimeoutWheel::remove(Entry& entry) {
+  KJ_IF_SOME(w, entry.wheel) {
+    KJ_REQUIRE(&w == this, "timeout is in a different wheel");
+  } else {
+    return;
+  }
+  unlink(entry);
+  entry.wheel = kj::none;
+  --count;
+  settle();
+}
+
+kj::Maybe<TimeoutWheel::Entry&> TimeoutWheel::front() const {
+  if (count == 0) {
+    return kj::none;
+  }
+  return *slots[std::countr_zero(occupied[0])].head;
+}
+
+TimeoutWheel::Slot& TimeoutWheel::slotOf(Entry& entry) {
+  return entry.level == LEVELS ? overflow : slots[entry.level * SLOTS + entry.slot];
+}
+
+void TimeoutWheel::place(Entry& entry) {
+  // Timeouts that were already due when they were added go into the cursor's slot, where they
+  // sort before everything else.
+  uint64_t tick = kj::max(entry.tick, cursor);
+
+  // The entry goes on the lowest level whose slots span both the entry's tick and the cursor.
+  for (uint level = 0; level < LEVELS; level++) {
+    uint shift = LEVEL_BITS * level;
+    if ((tick >> (shift + LEVEL_BITS)) != (cursor >> (shift + LEVEL_BITS))) {
+      continue;
+    }
+
+    uint index = (tick >> shift) & (SLOTS - 1);
+    entry.level = level;
+    entry.slot = index;
+    occupied[level] |= uint64_t(1) << index;
+    auto& slot = slots[level * SLOTS + index];
+    if (level == 0) {
+      // Search from the back, since timeouts are mostly added in the order they're due.
+      Entry* after = slot.tail;
+      while (after != nullptr && entry.isBefore(*after)) {
+        after = after->prev;
+      }
+      insertAfter(slot, after, entry);
+    } else {
+      insertAfter(slot, slot.tail, entry);
+    }
+    return;
+  }
+
+  entry.level = LEVELS;
+  insertAfter(overflow, overflow.tail, entry);
+}
+
+void TimeoutWheel::unlink(Entry& entry) {
+  auto& slot = slotOf(entry);
+  if (entry.prev == nullptr) {
+    slot.head = entry.next;
+  } else {
+    entry.prev->next = entry.next;
+  }
+  if (entry.next == nullptr) {
+    slot.tail = entry.prev;
+  } else {
+    entry.next->prev = entry.prev;
+  }
+  entry.prev = nullptr;
+  entry.next = nullptr;
+  if (slot.head == nullptr && entry.level < LEVELS) {
+    occupied[entry.level] &= ~(uint64_t(1) << entry.slot);
+  }
+}
+
+void TimeoutWheel::insertAfter(Slot& slot, Entry* after, Entry& entry) {
+  entry.prev = after;
+  entry.next = after == nullptr ? slot.head : after->next;
+  if (entry.prev == nullptr) {
+    slot.head = &entry;
+  } else {
+    entry.prev->next = &entry;
+  }
+  if (entry.next == nullptr) {
+    slot.tail = &entry;
+  } else {
+    entry.next->prev = &entry;
+  }
+}
+
+void TimeoutWheel::settle() {
+  while (count > 0 && occupied[0] == 0) {
+    Slot taken;
+    uint level = 1;
+    while (level < LEVELS && occupied[level] == 0) {
+      ++level;
+    }
+    if (level < LEVELS) {
+      // Move the cursor to the start of the first occupied slot. Everything below it is empty.
+      uint index = std::countr_zero(occupied[level]);
+      uint shift = LEVEL_BITS * level;
+      uint64_t upper = cursor >> (shift + LEVEL_BITS) << (shift + LEVEL_BITS);
+      cursor = upper | (uint64_t(index) << shift);
+      auto& slot = slots[level * SLOTS + index];
+      taken = slot;
+      slot = {};
+      occupied[level] &= ~(uint64_t(1) << index);
+    } else {
+      // Only the overflow list is left. Restart the wheel at its first timeout.
+      uint64_t first = kj::maxValue;
+      for (Entry* entry = overflow.head; entry != nullptr; entry = entry->next) {
+        first = kj::min(first, entry->tick);
+      }
+      cursor = first;
+      taken = overflow;
+      overflow = {};
+    }
+
+    for (Entry* entry = taken.head; entry != nullptr;) {
+      Entry* next = entry->next;
+      entry->prev = nullptr;
+      entry->next = nullptr;
+      place(*entry);
+      entry = next;
+    }
+  }
+}
+
 }  // namespace workerd
@@ -2,6 +2,9 @@
 
 #include <workerd/jsg/jsg.h>
 
+#include <kj/hash.h>
+#include <kj/time.h>
+
 namespace workerd {
 
 class IoContext;
@@ -42,6 +45,12 @@ class TimeoutId {
   inline bool operator<(TimeoutId id) const {
     return value < id.value;
   }
+  inline bool operator==(TimeoutId id) const {
+    return value == id.value;
+  }
+  inline uint hashCode() const {
+    return kj::hashCode(value);
+  }
 
  private:
   constexpr explicit TimeoutId(ValueType value): value(value) {}
@@ -86,4 +95,97 @@ class TimeoutManager {
   virtual kj::Maybe<kj::Date> getNextTimeout() const = 0;
 };
 
+// Keeps pending timeouts ordered by the time they're due, for TimeoutManager implementations.
+//
+// Timeouts are kept in a hierarchical timing wheel with millisecond ticks: LEVELS levels of SLOTS
+// slots each, where a slot on level L spans SLOTS^L ticks, plus an overflow list for timeouts too
+// far out for the wheel (about 4.6 hours). Adding and removing a timeout takes constant time, and
+// so does finding the first one. The wheel only moves its cursor forward when the slots below it
+// have emptied, at which point the next slot up is spread over the levels below; each timeout is
+// moved at most once per level.
+//
+// Timeouts that are due in the same tick are kept sorted, so the wheel orders timeouts exactly by
+// due time, and then by the order of their sequence numbers.
+class TimeoutWheel {
+ public:
+  static constexpr uint LEVEL_BITS = 6;
+  static constexpr uint SLOTS = 1u << LEVEL_BITS;
+  static constexpr uint LEVELS = 4;
+
+  // A timeout in the wheel. It removes itself from the wheel when it is destroyed.
+  class Entry {
+   public:
+    Entry(kj::Date when, uint64_t sequence);
+    virtual ~Entry() noexcept(false);
+    KJ_DISALLOW_COPY_AND_MOVE(Entry);
+
+    kj::Date getWhen() const {
+      return when;
+    }
+    uint64_t getSequence() const {
+      return sequence;
+    }
+
+   private:
+    kj::Date when;
+    uint64_t sequence;
+    uint64_t tick;
+
+    kj::Maybe<TimeoutWheel&> wheel;
+    uint level = 0;
+    uint slot = 0;
+    Entry* prev = nullptr;
+    Entry* next = nullptr;
+
+    bool isBefore(const Entry& other) const {
+      return when < other.when || (when == other.when && sequence < other.sequence);
+    }
+
+    friend class TimeoutWheel;
+  };
+
+  TimeoutWheel() = default;
+  ~TimeoutWheel() noexcept(false);
+  KJ_DISALLOW_COPY_AND_MOVE(TimeoutWheel);
+
+  // Adds `entry`, which must not be in a wheel yet.
+  void add(Entry& entry);
+
+  // Removes `entry` if it's in this wheel.
+  void remove(Entry& entry);
+
+  // Returns the timeout that is due first.
+  kj::Maybe<Entry&> front() const;
+
+  size_t size() const {
+    return count;
+  }
+
+ private:
+  struct Slot {
+    Entry* head = nullptr;
+    Entry* tail = nullptr;
+  };
+
+  // Every entry is due at `cursor` or later, except that entries added with an earlier due time
+  // are kept in the cursor's slot. Whenever the wheel isn't empty, level 0 isn't either.
+  uint64_t cursor = 0;
+  size_t count = 0;
+
+  // LEVELS * SLOTS slots, allocated by the first add() since most contexts never set a timeout.
+  kj::Array<Slot> slots;
+  uint64_t occupied[LEVELS] = {};
+  Slot overflow;
+
+  Slot& slotOf(Entry& entry);
+
+  // Puts `entry` in its slot relative to `cursor`.
+  void place(Entry& entry);
+  void unlink(Entry& entry);
+  static void insertAfter(Slot& slot, Entry* after, Entry& entry);
+
+  // Moves the cursor ahead until level 0 has entries again.
+  void settle();
+};
+
 }  // namespace workerd
@@ -83,6 +83,31 @@ class IsolateLimitEnforcer: public kj::Refcounted {
   virtual size_t getBlobSizeLimit() const {
     return 128 * 1024 * 1024;  // 128 MB
   }
+
+  // Maximum number of CPU-bound native tasks (async compression, key derivation) that a single
+  // isolate may have running on the shared ThreadPool at once. Work beyond this limit runs inline
+  // on the isolate thread, as it does if this returns 0.
+  virtual uint getOffThreadTaskLimit() const {
+    return 2;
+  }
+
+  // Memory budget, in bytes, for the per-isolate cache of imported public CryptoKeys. Returning 0
+  // disables the cache.
+  virtual size_t getCryptoKeyCacheLimit() const {
+    return 1024 * 1024;  // 1 MB
+  }
+
+  // How long V8 may spend on its idle tasks (GC bookkeeping, code flushing, and the like) each
+  // time the isolate finishes its last in-flight request. Returning 0 leaves idle tasks queued
+  // until V8 gives up on them.
+  virtual kj::Duration getIdleTaskBudget() const {
+    return 5 * kj::MILLISECONDS;
+  }
+
+  // Called with the isolate locked once it has gone idle and V8's idle tasks have run (so only
+  // when getIdleTaskBudget() is nonzero). No request is waiting, so this is the cheapest time to
+  // force a garbage collection, if the enforcer wants one.
+  virtual void isolateIdle(jsg::Lock& lock) const {}
 };
 
 // Abstract interface that enforces resource limits on a IoContext.
@@ -93,6 +118,16 @@ class LimitEnforcer {
   // be dropped when JavaScript is done, before unlocking the isolate.
   virtual kj::Own<void> enterJs(jsg::Lock& lock, IoContext& context) = 0;
 
+  // Called when the request's CPU-bound native work ran on a ThreadPool thread instead of under
+  // the isolate lock, so that the time can still be charged to the request. Enforcers that don't
+  // track CPU time can ignore it.
+  virtual void reportOffThreadCpuTime(kj::Duration cpuTime) {}
+
+  // Called when the IoContext goes away with the size of the arena its owned objects were
+  // allocated from, if the `owned-object-arena` autogate gave it one. The arena only grows during
+  // the request, so this is also its peak size.
+  virtual void reportOwnedObjectArenaSize(size_t bytes) {}
+
   // Called on each new event delivered that should cause an actor's resource limits to be
   // "topped up". This method does nothing if the IoContext is not an actor. Note that this must
   // not be called while in a JS scope, i.e. when `enterJs()` has been called and the returned
@@ -109,9 +144,10 @@ class LimitEnforcer {
   // external subrequests.
   virtual void newSubrequest(bool isInHouse) = 0;
 
-  enum class KvOpType { GET, PUT, LIST, DELETE };
+  enum class KvOpType { GET, PUT, LIST, DELETE, GET_BULK };
   // Called before starting a KV operation. Throws a JSG exception if the operation should be
-  // blocked due to exceeding limits, such as the free tier daily operation limit.
+  // blocked due to exceeding limits, such as the free tier daily operation limit. A GET_BULK
+  // reads many keys with one subrequest; how it counts against limits is up to the enforcer.
   virtual void newKvRequest(KvOpType op) = 0;
 
   // Called before starting an attempt to write to the Analytics Engine. Throws
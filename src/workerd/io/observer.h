@@ -136,6 +136,23 @@ class RequestObserver: public kj::Refcounted {
 
   virtual void setFailedOpen(bool value) {}
 
+  // Report time that the request spent blocked, so that its latency can be attributed to the right
+  // subsystem. Each call reports one wait once it has ended, or has been canceled.
+  virtual void outputGateWaited(kj::Duration duration) {}
+  virtual void inputGateWaited(kj::Duration duration) {}
+  virtual void isolateLockWaited(kj::Duration duration) {}
+
+  // Reports a write to actor storage that completed while this was the actor's current request.
+  virtual void storageFlushed(kj::Duration duration) {}
+
+  // Reports the CPU time the current thread spent running JavaScript for this request, once each
+  // time the request exits JavaScript. The LimitEnforcer only reads the clock, and calls
+  // jsExecuted(), if wantsJsTiming() returns true.
+  virtual bool wantsJsTiming() {
+    return false;
+  }
+  virtual void jsExecuted(kj::Duration cpuTime) {}
+
   virtual uint64_t clockRead() {
     return 0;
   }
@@ -188,6 +205,10 @@ class IsolateObserver: public kj::AtomicRefcounted {
     // same thread.
     virtual void waitingForOtherIsolate(kj::StringPtr id) {}
 
+    // Called by `Isolate::takeAsyncLock()` when it was woken up to retry after being blocked, but
+    // found the thread busy with a different isolate lock again and had to go back to waiting.
+    virtual void spuriousWakeup() {}
+
     // Call if this is an async lock attempt, before constructing LockRecord.
     virtual void reportAsyncInfo(
         uint currentLoad, bool threadWaitingSameLock, uint threadWaitingDifferentLockCount) {}
@@ -287,6 +308,14 @@ class ActorObserver: public kj::Refcounted, public SqliteObserver {
   virtual void receivedWebSocketMessage(size_t bytes) {}
   virtual void sentWebSocketMessage(size_t bytes) {}
 
+  // Called each time a hibernatable websocket answers a message with an auto-response.
+  virtual void webSocketAutoResponseSent() {}
+
+  // Called when the actor hibernates, with the number of hibernating websockets and the heap
+  // memory that the HibernationManager keeps for them, so `bytes / count` is the cost of each
+  // hibernated socket.
+  virtual void webSocketsHibernated(size_t count, size_t bytes) {}
+
   virtual void addCachedStorageReadUnits(uint32_t units) {}
   virtual void addUncachedStorageReadUnits(uint32_t units) {}
   virtual void addStorageWriteUnits(uint32_t units) {}
@@ -348,6 +348,20 @@ KJ_TEST("Read/Write Log works") {
   KJ_ASSERT(info3.message == "foo"_kj);
 }
 
+KJ_TEST("Trace::getSizeHint() leaves room to copy a trace in one segment") {
+  auto trace = kj::refcounted<Trace>(kj::none, kj::str("foo"), kj::none, kj::none, kj::none,
+      kj::Array<kj::String>(), kj::none, ExecutionModel::STATELESS);
+  for (auto i: kj::zeroTo(100)) {
+    auto message = kj::str("[\"line ", i, ": ", kj::repeat('x', 200), "\"]");
+    trace->bytesUsed += sizeof(tracing::Log) + message.size();
+    trace->logs.add(kj::UNIX_EPOCH, LogLevel::LOG, kj::mv(message));
+  }
+
+  capnp::MallocMessageBuilder message(trace->getSizeHint().wordCount);
+  trace->copyTo(message.initRoot<rpc::Trace>());
+  KJ_EXPECT(message.getSegmentsForOutput().size() == 1);
+}
+
 KJ_TEST("Read/Write Exception works") {
   capnp::MallocMessageBuilder builder;
   auto infoBuilder = builder.initRoot<rpc::Trace::Exception>();
@@ -609,5 +623,74 @@ KJ_TEST("Read/Write TailEvent with Multiple Attributes") {
   KJ_ASSERT(attrs2[1].name == "bar"_kj);
 }
 
+class FakeTailStreamTarget final: public rpc::TailStreamTarget::Server {
+ public:
+  kj::Vector<kj::Array<TailEvent>> batches;
+
+  // If set, report() calls don't return until this resolves.
+  kj::Maybe<kj::ForkedPromise<void>> gate;
+
+  kj::Promise<void> report(ReportContext context) override {
+    batches.add(KJ_MAP(event, context.getParams().getEvents()) { return TailEvent(event); });
+    KJ_IF_SOME(g, gate) {
+      return g.addBranch();
+    }
+    return kj::READY_NOW;
+  }
+};
+
+KJ_TEST("TailStreamWriter sends bounded batches and drops what a slow target can't take") {
+  kj::EventLoop loop;
+  kj::WaitScope waitScope(loop);
+
+  auto server = kj::heap<FakeTailStreamTarget>();
+  auto& target = *server;
+  auto gate = kj::newPromiseAndFulfiller<void>();
+  target.gate = gate.promise.fork();
+
+  FakeEntropySource entropy;
+  auto writer = kj::refcounted<TailStreamWriter>(rpc::TailStreamTarget::Client(kj::mv(server)),
+      InvocationSpanContext::newForInvocation(kj::none, entropy), 4);
+  auto log = [&](kj::StringPtr message) {
+    writer->report(kj::UNIX_EPOCH, Mark(Log(kj::UNIX_EPOCH, LogLevel::LOG, kj::str(message))));
+  };
+
+  // Events reported in the same turn go out together once the turn is over.
+  log("a");
+  log("b");
+  log("c");
+  KJ_EXPECT(target.batches.size() == 0);
+  waitScope.poll();
+  KJ_ASSERT(target.batches.size() == 1);
+  KJ_EXPECT(target.batches[0].size() == 3);
+
+  // While that call is held back, only one more batch worth of events is kept. The Outcome is kept
+  // regardless.
+  for (auto i = 0; i < 10; i++) {
+    log("d");
+  }
+  writer->report(kj::UNIX_EPOCH, Outcome(EventOutcome::OK, 0 * kj::SECONDS, 0 * kj::SECONDS));
+  writer->close();
+  waitScope.poll();
+  KJ_EXPECT(target.batches.size() == 1);
+  KJ_EXPECT(writer->getDroppedCount() == 6);
+
+  gate.fulfiller->fulfill();
+  writer->onDrained().wait(waitScope);
+  KJ_ASSERT(target.batches.size() == 2);
+
+  auto& batch = target.batches[1];
+  KJ_ASSERT(batch.size() == 6);
+  for (uint i: kj::range(0u, 4u)) {
+    KJ_EXPECT(batch[i].sequence == 3 + i);
+  }
+  KJ_EXPECT(batch[4].sequence == 13);
+  KJ_EXPECT(batch[4].event.is<Outcome>());
+  KJ_EXPECT(batch[5].sequence == 14);
+  auto& warning = KJ_ASSERT_NONNULL(KJ_ASSERT_NONNULL(batch[5].event.tryGet<Mark>()).tryGet<Log>());
+  KJ_EXPECT(warning.logLevel == LogLevel::WARN);
+  KJ_EXPECT(warning.message.contains("6 events were dropped"));
+}
+
 }  // namespace
 }  // namespace workerd::tracing
@@ -3,10 +3,9 @@
 //     https://opensource.org/licenses/Apache-2.0
 
 #include <workerd/io/trace.h>
+#include <workerd/util/random.h>
 #include <workerd/util/thread-scopes.h>
 
-#include <openssl/rand.h>
-
 #include <capnp/message.h>
 #include <capnp/schema.h>
 #include <kj/compat/http.h>
@@ -136,7 +135,7 @@ uint64_t getRandom64Bit(const kj::Maybe<kj::EntropySource&>& entropySource) {
     KJ_IF_SOME(entropy, entropySource) {
       entropy.generate(kj::arrayPtr(&ret, 1).asBytes());
     } else {
-      KJ_ASSERT(RAND_bytes(reinterpret_cast<uint8_t*>(&ret), sizeof(ret)) == 1);
+      getRandomBytes(kj::arrayPtr(&ret, 1).asBytes());
     }
     // On the extreme off chance that we ended with with zeroes
     // let's try again, but only up to three times.
@@ -580,6 +579,14 @@ Trace::Trace(rpc::Trace::Reader reader) {
 
 Trace::~Trace() noexcept(false) {}
 
+capnp::MessageSize Trace::getSizeHint() const {
+  // `bytesUsed` covers the recorded logs, exceptions and events, which are nearly all of a large
+  // trace. On top of that, each entry takes a few words of struct and pointer, and the event info
+  // and script metadata aren't counted at all.
+  auto entries = logs.size() + spans.size() + exceptions.size() + diagnosticChannelEvents.size();
+  return {.wordCount = bytesUsed / sizeof(capnp::word) + entries * 4 + 256, .capCount = 0};
+}
+
 void Trace::copyTo(rpc::Trace::Builder builder) {
   {
     auto list = builder.initLogs(logs.size() + spans.size());
@@ -1571,6 +1578,109 @@ tracing::TailEvent tracing::TailEvent::clone() {
   return TailEvent(traceId, invocationId, spanId, timestamp, sequence, cloneEvent(event));
 }
 
+tracing::TailStreamWriter::TailStreamWriter(
+    rpc::TailStreamTarget::Client target, InvocationSpanContext context, size_t maxBatchSize)
+    : target(kj::mv(target)),
+      context(kj::mv(context)),
+      maxBatchSize(kj::max(maxBatchSize, size_t(1))),
+      tasks(*this) {}
+
+void tracing::TailStreamWriter::report(kj::Date timestamp, TailEvent::Event&& event) {
+  if (closed || broken) return;
+
+  // The first and last event of a stream are what tell the consumer where it begins and ends, so
+  // they are never dropped.
+  bool droppable = !event.is<Onset>() && !event.is<Outcome>();
+  if (sending && queued.size() >= maxBatchSize && droppable) {
+    ++sequence;
+    ++dropped;
+    ++droppedTotal;
+    lastDropped = timestamp;
+    return;
+  }
+
+  queued.add(context, timestamp, sequence++, kj::mv(event));
+  if (sending) {
+    // The next batch goes out when the call in flight returns.
+  } else if (queued.size() >= maxBatchSize) {
+    sendQueued();
+  } else {
+    scheduleFlush();
+  }
+}
+
+void tracing::TailStreamWriter::close() {
+  closed = true;
+  maybeDrained();
+}
+
+kj::Promise<void> tracing::TailStreamWriter::onDrained() {
+  if (isDrained()) {
+    return kj::READY_NOW;
+  }
+  auto paf = kj::newPromiseAndFulfiller<void>();
+  drainFulfillers.add(kj::mv(paf.fulfiller));
+  return kj::mv(paf.promise);
+}
+
+bool tracing::TailStreamWriter::isDrained() const {
+  return closed && (broken || (!sending && queued.empty()));
+}
+
+void tracing::TailStreamWriter::scheduleFlush() {
+  if (flushScheduled) return;
+  flushScheduled = true;
+  tasks.add(kj::evalLater([this]() {
+    flushScheduled = false;
+    sendQueued();
+    maybeDrained();
+  }));
+}
+
+void tracing::TailStreamWriter::sendQueued() {
+  if (sending || broken || queued.empty()) return;
+
+  if (dropped > 0) {
+    // We use a JSON encoded array/string to match other console.log() recordings.
+    queued.add(context, lastDropped, sequence++,
+        Mark(Log(lastDropped, LogLevel::WARN,
+            kj::str("[\"Tail stream consumer fell behind; ", dropped,
+                " events were dropped.\"]"))));
+    dropped = 0;
+  }
+
+  auto req = target.reportRequest();
+  auto events = req.initEvents(queued.size());
+  for (auto i: kj::indices(queued)) {
+    queued[i].copyTo(events[i]);
+  }
+  queued.clear();
+
+  sending = true;
+  tasks.add(req.send().then([this](auto) {
+    sending = false;
+    sendQueued();
+    maybeDrained();
+  }));
+}
+
+void tracing::TailStreamWriter::maybeDrained() {
+  if (!isDrained()) return;
+  for (auto& fulfiller: drainFulfillers) {
+    fulfiller->fulfill();
+  }
+  drainFulfillers.clear();
+}
+
+void tracing::TailStreamWriter::taskFailed(kj::Exception&& exception) {
+  // A consumer that failed once won't see a consistent stream anymore, so stop sending to it.
+  KJ_LOG(WARNING, "tail stream target failed; dropping its remaining events", exception);
+  broken = true;
+  sending = false;
+  queued.clear();
+  maybeDrained();
+}
+
 // ======================================================================================
 
 SpanBuilder& SpanBuilder::operator=(SpanBuilder&& other) {
@@ -1682,11 +1792,32 @@ WorkerTracer::WorkerTracer(PipelineLogLevel pipelineLogLevel, ExecutionModel exe
           kj::none, kj::none, kj::none, kj::none, kj::none, nullptr, kj::none, executionModel)),
       self(kj::refcounted<WeakRef<WorkerTracer>>(kj::Badge<WorkerTracer>{}, *this)) {}
 
+WorkerTracer::~WorkerTracer() noexcept(false) {
+  self->invalidate();
+  for (auto& stream: tailStreams) {
+    stream->close();
+  }
+}
+
+void WorkerTracer::addTailStream(kj::Own<tracing::TailStreamWriter> stream) {
+  tailStreams.add(kj::mv(stream));
+}
+
+template <typename MakeEvent>
+void WorkerTracer::reportToStreams(kj::Date timestamp, MakeEvent&& makeEvent) {
+  for (auto& stream: tailStreams) {
+    stream->report(timestamp, makeEvent());
+  }
+}
+
 void WorkerTracer::addLog(kj::Date timestamp, LogLevel logLevel, kj::String message, bool isSpan) {
-  if (trace->exceededLogLimit) {
+  if (pipelineLogLevel == PipelineLogLevel::NONE) {
     return;
   }
-  if (pipelineLogLevel == PipelineLogLevel::NONE) {
+  reportToStreams(timestamp, [&]() -> tracing::TailEvent::Event {
+    return tracing::Mark(tracing::Log(timestamp, logLevel, kj::str(message)));
+  });
+  if (!buffering || trace->exceededLogLimit) {
     return;
   }
   size_t newSize = trace->bytesUsed + sizeof(tracing::Log) + message.size();
@@ -1710,8 +1841,9 @@ void WorkerTracer::addLog(kj::Date timestamp, LogLevel logLevel, kj::String mess
 
 void WorkerTracer::addSpan(const Span& span, kj::String spanContext) {
   // This is where we'll actually encode the span for now.
-  // Drop any spans beyond MAX_USER_SPANS.
-  if (trace->numSpans >= MAX_USER_SPANS) {
+  // Drop any spans beyond MAX_USER_SPANS. Tail streams don't keep the spans, so they get all of
+  // them.
+  if (buffering && trace->numSpans >= MAX_USER_SPANS) {
     return;
   }
   if (isPredictableModeForTest()) {
@@ -1753,15 +1885,19 @@ void WorkerTracer::addSpan(const Span& span, kj::String spanContext) {
 
 void WorkerTracer::addException(
     kj::Date timestamp, kj::String name, kj::String message, kj::Maybe<kj::String> stack) {
-  if (trace->exceededExceptionLimit) {
-    return;
-  }
   // TODO(someday): For now, we're using logLevel == none as a hint to avoid doing anything
   //   expensive while tracing.  We may eventually want separate configuration for exceptions vs.
   //   logs.
   if (pipelineLogLevel == PipelineLogLevel::NONE) {
     return;
   }
+  reportToStreams(timestamp, [&]() -> tracing::TailEvent::Event {
+    return tracing::Mark(tracing::Exception(timestamp, kj::str(name), kj::str(message),
+        stack.map([](kj::String& s) { return kj::str(s); })));
+  });
+  if (!buffering || trace->exceededExceptionLimit) {
+    return;
+  }
   size_t newSize = trace->bytesUsed + sizeof(tracing::Exception) + name.size() + message.size();
   KJ_IF_SOME(s, stack) {
     newSize += s.size();
@@ -1777,12 +1913,29 @@ void WorkerTracer::addException(
   trace->exceptions.add(timestamp, kj::mv(name), kj::mv(message), kj::mv(stack));
 }
 
+bool WorkerTracer::wantsDiagnosticChannelEvent(kj::StringPtr channel) const {
+  if (pipelineLogLevel == PipelineLogLevel::NONE) {
+    return false;
+  }
+  if (tailStreams.empty() && (!buffering || trace->exceededDiagnosticChannelEventLimit)) {
+    return false;
+  }
+  KJ_IF_SOME(names, diagnosticChannels) {
+    return names.contains(channel);
+  }
+  return true;
+}
+
 void WorkerTracer::addDiagnosticChannelEvent(
     kj::Date timestamp, kj::String channel, kj::Array<kj::byte> message) {
-  if (trace->exceededDiagnosticChannelEventLimit) {
+  if (!wantsDiagnosticChannelEvent(channel)) {
     return;
   }
-  if (pipelineLogLevel == PipelineLogLevel::NONE) {
+  reportToStreams(timestamp, [&]() -> tracing::TailEvent::Event {
+    return tracing::Mark(tracing::DiagnosticChannelEvent(
+        timestamp, kj::str(channel), kj::heapArray<kj::byte>(message)));
+  });
+  if (!buffering || trace->exceededDiagnosticChannelEventLimit) {
     return;
   }
   size_t newSize =
@@ -1803,15 +1956,28 @@ void WorkerTracer::setEventInfo(kj::Date timestamp, tracing::EventInfo&& info) {
 
   // TODO(someday): For now, we're using logLevel == none as a hint to avoid doing anything
   //   expensive while tracing.  We may eventually want separate configuration for event info vs.
-  //   logs.
-  // TODO(perf): Find a way to allow caller to avoid the cost of generation if the info struct
-  //   won't be used?
-  if (pipelineLogLevel == PipelineLogLevel::NONE) {
+  //   logs. Callers that want to skip generating the info struct check wantsEventInfo().
+  if (!wantsEventInfo()) {
     return;
   }
 
   trace->eventTimestamp = timestamp;
 
+  if (!tailStreams.empty()) {
+    tracing::Onset onset(kj::mv(info),
+        tracing::Onset::WorkerInfo{
+          .executionModel = trace->executionModel,
+          .scriptName = trace->scriptName.map([](auto& str) { return kj::str(str); }),
+          .scriptVersion =
+              trace->scriptVersion.map([](auto& version) { return capnp::clone(*version); }),
+          .dispatchNamespace = trace->dispatchNamespace.map([](auto& str) { return kj::str(str); }),
+          .scriptTags = KJ_MAP(tag, trace->scriptTags) { return kj::str(tag); },
+          .entrypoint = trace->entrypoint.map([](auto& str) { return kj::str(str); }),
+        });
+    reportToStreams(timestamp, [&]() -> tracing::TailEvent::Event { return onset.clone(); });
+    info = kj::mv(onset.info);
+  }
+
   size_t newSize = trace->bytesUsed;
   KJ_SWITCH_ONEOF(info) {
     KJ_CASE_ONEOF(fetch, tracing::FetchEventInfo) {
@@ -1838,13 +2004,22 @@ void WorkerTracer::setOutcome(EventOutcome outcome, kj::Duration cpuTime, kj::Du
   trace->outcome = outcome;
   trace->cpuTime = cpuTime;
   trace->wallTime = wallTime;
+
+  // There's no clock reading here that's safe to hand to a tail worker, so the Outcome is stamped
+  // with the end of the event's wall time.
+  reportToStreams(trace->eventTimestamp + wallTime, [&]() -> tracing::TailEvent::Event {
+    return tracing::Outcome(outcome, cpuTime, wallTime);
+  });
+  for (auto& stream: tailStreams) {
+    stream->close();
+  }
 }
 
 void WorkerTracer::setFetchResponseInfo(tracing::FetchResponseInfo&& info) {
   // Match the behavior of setEventInfo(). Any resolution of the TODO comments
   // in setEventInfo() that are related to this check while probably also affect
   // this function.
-  if (pipelineLogLevel == PipelineLogLevel::NONE) {
+  if (!wantsEventInfo()) {
     return;
   }
 
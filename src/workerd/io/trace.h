@@ -300,7 +300,8 @@ struct FetchEventInfo final {
 
   kj::HttpMethod method;
   kj::String url;
-  // TODO(perf): It might be more efficient to store some sort of parsed JSON result instead?
+  // Kept as JSON, the form in which it arrives from the request and is sent to other processes.
+  // Tail workers only parse it once their handler reads `request.cf`.
   kj::String cfJson;
   kj::Array<Header> headers;
 
@@ -767,6 +768,68 @@ struct TailEvent final {
   void copyTo(rpc::Trace::TailEvent::Builder builder);
   TailEvent clone();
 };
+
+// Sends the tail events of one invocation to a TailStreamTarget while the invocation runs, so that
+// they reach the consumer without being kept until the invocation is done. Events reported during
+// one turn of the event loop go out together in a single report() call of at most `maxBatchSize`
+// events. Only one call is in flight at a time. While it is, at most `maxBatchSize` further events
+// are buffered and later ones are dropped (except Onset and Outcome). The dropped events still use
+// up their sequence numbers, and the next batch ends with a warning log saying how many there were.
+//
+// The writer is refcounted so that whoever set up the stream can keep it alive past the tracer
+// that reports to it, until onDrained() resolves.
+class TailStreamWriter final: public kj::Refcounted, private kj::TaskSet::ErrorHandler {
+ public:
+  static constexpr size_t DEFAULT_MAX_BATCH_SIZE = 64;
+
+  explicit TailStreamWriter(rpc::TailStreamTarget::Client target,
+      InvocationSpanContext context,
+      size_t maxBatchSize = DEFAULT_MAX_BATCH_SIZE);
+  KJ_DISALLOW_COPY_AND_MOVE(TailStreamWriter);
+
+  // Queues an event for the invocation, giving it the next sequence number.
+  void report(kj::Date timestamp, TailEvent::Event&& event);
+
+  // No more events will be reported. Anything reported after this is ignored.
+  void close();
+
+  // Resolves once the writer has been closed and everything it buffered has been delivered, or
+  // the target has failed.
+  kj::Promise<void> onDrained();
+
+  // The number of events that were dropped because the target fell behind.
+  size_t getDroppedCount() const {
+    return droppedTotal;
+  }
+
+ private:
+  rpc::TailStreamTarget::Client target;
+  InvocationSpanContext context;
+  size_t maxBatchSize;
+  kj::uint sequence = 0;
+
+  kj::Vector<TailEvent> queued;
+
+  // Events dropped since the last batch was sent, and the timestamp of the last one of them.
+  size_t dropped = 0;
+  kj::Date lastDropped = kj::UNIX_EPOCH;
+  size_t droppedTotal = 0;
+
+  bool sending = false;
+  bool flushScheduled = false;
+  bool closed = false;
+  bool broken = false;
+
+  kj::Vector<kj::Own<kj::PromiseFulfiller<void>>> drainFulfillers;
+
+  kj::TaskSet tasks;
+
+  bool isDrained() const;
+  void scheduleFlush();
+  void sendQueued();
+  void maybeDrained();
+  void taskFailed(kj::Exception&& exception) override;
+};
 }  // namespace tracing
 
 enum class PipelineLogLevel {
@@ -852,6 +915,10 @@ class Trace final: public kj::Refcounted {
   // Copy content from this trace into `builder`.
   void copyTo(rpc::Trace::Builder builder);
 
+  // Estimates the space copyTo() needs, so that a message built to send this trace can be
+  // allocated in one piece rather than grown a segment at a time.
+  capnp::MessageSize getSizeHint() const;
+
   // Adds all content from `reader` to this `Trace`. (Typically this trace is empty before the
   // call.)  Also applies filtering to the trace as if it were recorded with the given
   // pipelineLogLevel.
@@ -939,9 +1006,7 @@ class WorkerTracer final: public kj::Refcounted, public BaseTracer {
       kj::Own<Trace> trace,
       PipelineLogLevel pipelineLogLevel);
   explicit WorkerTracer(PipelineLogLevel pipelineLogLevel, ExecutionModel executionModel);
-  ~WorkerTracer() {
-    self->invalidate();
-  }
+  ~WorkerTracer() noexcept(false);
   KJ_DISALLOW_COPY_AND_MOVE(WorkerTracer);
 
   void addLog(
@@ -957,6 +1022,22 @@ class WorkerTracer final: public kj::Refcounted, public BaseTracer {
   void setFetchResponseInfo(tracing::FetchResponseInfo&&) override;
   void setOutcome(EventOutcome outcome, kj::Duration cpuTime, kj::Duration wallTime) override;
 
+  // Returns false if setEventInfo() and setFetchResponseInfo() would drop what they're given.
+  // Callers whose event info is expensive to build should check this first.
+  bool wantsEventInfo() const {
+    return pipelineLogLevel != PipelineLogLevel::NONE;
+  }
+
+  // Returns false if addDiagnosticChannelEvent() would drop an event published on `channel`, so
+  // that the publisher can skip serializing the message.
+  bool wantsDiagnosticChannelEvent(kj::StringPtr channel) const;
+
+  // Records diagnostic channel events only for the channels in `names`, which must outlive the
+  // tracer. By default, every channel's events are recorded.
+  void setDiagnosticChannels(const kj::HashSet<kj::String>& names) {
+    diagnosticChannels = names;
+  }
+
   // Used only for a Trace in a process sandbox. Copies the content of this tracer's trace to the
   // builder.
   void extractTrace(rpc::Trace::Builder builder);
@@ -969,9 +1050,24 @@ class WorkerTracer final: public kj::Refcounted, public BaseTracer {
     return self->addRef();
   }
 
+  // Also reports this stage's events to `stream` as they happen: an Onset from setEventInfo(),
+  // a mark for every log, span, exception and diagnostic channel event, and an Outcome from
+  // setOutcome(), after which (or when the tracer is destroyed) the stream is closed.
+  void addTailStream(kj::Own<tracing::TailStreamWriter> stream);
+
+  // Stops collecting logs, spans, exceptions and diagnostic channel events into this stage's
+  // Trace. Use this once every consumer of the stage reads its tail streams rather than the Trace,
+  // so that the events aren't also kept in memory until the request is done.
+  void stopBuffering() {
+    buffering = false;
+  }
+
  private:
   PipelineLogLevel pipelineLogLevel;
   kj::Own<Trace> trace;
+  kj::Vector<kj::Own<tracing::TailStreamWriter>> tailStreams;
+  bool buffering = true;
+  kj::Maybe<const kj::HashSet<kj::String>&> diagnosticChannels;
 
   // own an instance of the pipeline to make sure it doesn't get destroyed
   // before we're finished tracing
@@ -982,6 +1078,10 @@ class WorkerTracer final: public kj::Refcounted, public BaseTracer {
   // response, but with e.g. waitUntil() the worker can still be performing tasks afterwards so the
   // span submitter may exist for longer than the tracer).
   kj::Own<WeakRef<WorkerTracer>> self;
+
+  // Reports the event made by `makeEvent` to each tail stream.
+  template <typename MakeEvent>
+  void reportToStreams(kj::Date timestamp, MakeEvent&& makeEvent);
 };
 
 // =======================================================================================
@@ -246,31 +246,35 @@ kj::Promise<void> WorkerEntrypoint::request(kj::HttpMethod method,
   bool isActor = context.getActor() != kj::none;
 
   KJ_IF_SOME(t, incomingRequest->getWorkerTracer()) {
-    auto timestamp = context.now();
-    kj::String cfJson;
-    KJ_IF_SOME(c, cfBlobJson) {
-      cfJson = kj::str(c);
-    }
+    // Building the event info copies the URL, headers and cf blob, which is wasted work if the
+    // tracer won't record it.
+    if (t.wantsEventInfo()) {
+      auto timestamp = context.now();
+      kj::String cfJson;
+      KJ_IF_SOME(c, cfBlobJson) {
+        cfJson = kj::str(c);
+      }
 
-    // To match our historical behavior (when we used to pull the headers from the JavaScript
-    // object later on), we need to canonicalize the headers, including:
-    // - Lower-case the header name.
-    // - Combine multiple headers with the same name into a comma-delimited list. (This explicitly
-    //   breaks the Set-Cookie header, incidentally, but should be equivalent for all other
-    //   headers.)
-    kj::TreeMap<kj::String, kj::Vector<kj::StringPtr>> traceHeaders;
-    headers.forEach([&](kj::StringPtr name, kj::StringPtr value) {
-      kj::String lower = toLower(name);
-      auto& slot = traceHeaders.findOrCreate(
-          lower, [&]() { return decltype(traceHeaders)::Entry{kj::mv(lower), {}}; });
-      slot.add(value);
-    });
-    auto traceHeadersArray = KJ_MAP(entry, traceHeaders) {
-      return tracing::FetchEventInfo::Header(kj::mv(entry.key), kj::strArray(entry.value, ", "));
-    };
+      // To match our historical behavior (when we used to pull the headers from the JavaScript
+      // object later on), we need to canonicalize the headers, including:
+      // - Lower-case the header name.
+      // - Combine multiple headers with the same name into a comma-delimited list. (This explicitly
+      //   breaks the Set-Cookie header, incidentally, but should be equivalent for all other
+      //   headers.)
+      kj::TreeMap<kj::String, kj::Vector<kj::StringPtr>> traceHeaders;
+      headers.forEach([&](kj::StringPtr name, kj::StringPtr value) {
+        kj::String lower = toLower(name);
+        auto& slot = traceHeaders.findOrCreate(
+            lower, [&]() { return decltype(traceHeaders)::Entry{kj::mv(lower), {}}; });
+        slot.add(value);
+      });
+      auto traceHeadersArray = KJ_MAP(entry, traceHeaders) {
+        return tracing::FetchEventInfo::Header(kj::mv(entry.key), kj::strArray(entry.value, ", "));
+      };
 
-    t.setEventInfo(timestamp,
-        tracing::FetchEventInfo(method, kj::str(url), kj::mv(cfJson), kj::mv(traceHeadersArray)));
+      t.setEventInfo(timestamp,
+          tracing::FetchEventInfo(method, kj::str(url), kj::mv(cfJson), kj::mv(traceHeadersArray)));
+    }
   }
 
   auto metricsForCatch = kj::addRef(incomingRequest->getMetrics());
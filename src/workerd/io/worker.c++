@@ -5,9 +5,11 @@
 #include "actor-cache.h"
 
 #include <workerd/api/actor-state.h>
+#include <workerd/api/crypto/key-cache.h>
 #include <workerd/api/global-scope.h>
 #include <workerd/api/sockets.h>
 #include <workerd/api/streams.h>  // for api::StreamEncoding
+#include <workerd/api/urlpattern.h>
 #include <workerd/io/cdp.capnp.h>
 #include <workerd/io/compatibility-date.h>
 #include <workerd/io/features.h>
@@ -20,9 +22,14 @@
 #include <workerd/jsg/util.h>
 #include <workerd/util/batch-queue.h>
 #include <workerd/util/color-util.h>
+#include <workerd/util/duration-exceeded-logger.h>
+#include <workerd/util/log-writer.h>
+#include <workerd/util/message-arena.h>
 #include <workerd/util/mimetype.h>
+#include <workerd/util/pprof.h>
 #include <workerd/util/stream-utils.h>
 #include <workerd/util/thread-scopes.h>
+#include <workerd/util/use-perfetto-categories.h>
 #include <workerd/util/xthreadnotifier.h>
 
 #include <v8-inspector.h>
@@ -34,6 +41,7 @@
 #include <kj/compat/gzip.h>
 #include <kj/encoding.h>
 #include <kj/filesystem.h>
+#include <kj/list.h>
 #include <kj/map.h>
 
 #include <cstdint>
@@ -117,6 +125,31 @@ const capnp::JsonCodec& getCdpJsonCodec() {
   return *codec;
 }
 
+// Installed as the SlowOperationSite's JsStackCapturer. Formats the stack of the isolate that
+// this thread has locked, if it's running JavaScript.
+kj::Maybe<kj::String> captureJsStackForSlowOperation() {
+  auto isolate = v8::Isolate::TryGetCurrent();
+  if (isolate == nullptr || !v8::Locker::IsLocked(isolate) || !isolate->InContext()) {
+    return kj::none;
+  }
+
+  v8::HandleScope scope(isolate);
+  auto stackTrace = v8::StackTrace::CurrentStackTrace(isolate, 10);
+  auto frameCount = stackTrace->GetFrameCount();
+  if (frameCount == 0) return kj::none;
+
+  kj::Vector<kj::String> lines(frameCount);
+  for (int i = 0; i < frameCount; i++) {
+    auto frame = stackTrace->GetFrame(isolate, i);
+    auto func = frame->GetFunctionName();
+    auto url = frame->GetScriptNameOrSourceURL();
+    lines.add(kj::str("\n    at ", func.IsEmpty() ? kj::str("<anonymous>") : kj::str(func), " (",
+        url.IsEmpty() ? kj::str() : kj::str(url), ':', frame->GetLineNumber(), ':',
+        frame->GetColumn(), ')'));
+  }
+  return kj::strArray(lines, "");
+}
+
 }  // namespace
 
 // =======================================================================================
@@ -338,6 +371,92 @@ uint64_t getCurrentThreadId() {
 
 }  // namespace
 
+// An attempt to take an async lock that can't proceed yet because its thread is already waiting
+// for or holding a lock on a different isolate. Each thread keeps a FIFO queue of these. When the
+// thread's lock is released, only the attempt at the front of the queue is woken, instead of
+// waking every blocked attempt only for all but one of them to go back to sleep. Attempts for the
+// isolate that the thread starts waiting on next are woken too, since they can coalesce with it.
+class Worker::BlockedLockAttempt {
+ public:
+  explicit BlockedLockAttempt(const Isolate& isolate): isolate(isolate) {}
+
+  ~BlockedLockAttempt() noexcept(false) {
+    if (link.isLinked()) {
+      (*queue).remove(*this);
+    } else if (wokenToProceed) {
+      // We were chosen to proceed, but were canceled before we got a chance. Pass it on.
+      wakeNext();
+    }
+  }
+  KJ_DISALLOW_COPY_AND_MOVE(BlockedLockAttempt);
+
+  // Joins the queue and returns a promise that resolves when it's this attempt's turn to try
+  // again. `atFront` puts the attempt back at the front of the queue, for use when it was woken
+  // but still couldn't proceed.
+  kj::Promise<void> block(bool atFront) {
+    auto paf = kj::newPromiseAndFulfiller<void>();
+    fulfiller = kj::mv(paf.fulfiller);
+    wokenToProceed = false;
+    if (atFront) {
+      (*queue).addFront(*this);
+    } else {
+      (*queue).add(*this);
+    }
+    return kj::mv(paf.promise);
+  }
+
+  // Call once the attempt has resumed after block().
+  void resumed() {
+    wokenToProceed = false;
+  }
+
+  // Wakes the attempt at the front of the current thread's queue, if any. Called when the
+  // thread's current AsyncWaiter goes away.
+  static void wakeNext() {
+    auto& q = *queue;
+    if (!q.empty()) {
+      auto& attempt = q.front();
+      q.remove(attempt);
+      attempt.wokenToProceed = true;
+      attempt.fulfiller->fulfill();
+    }
+  }
+
+  // Returns true if any lock attempt on the current thread is blocked.
+  static bool anyBlocked() {
+    return !(*queue).empty();
+  }
+
+  // Wakes every attempt in the current thread's queue that is for `target`. Called when the thread
+  // starts waiting for a lock on `target`.
+  static void wakeAllFor(const Isolate& target) {
+    auto& q = *queue;
+    kj::Vector<BlockedLockAttempt*> toWake;
+    for (auto& attempt: q) {
+      if (&attempt.isolate == &target) {
+        toWake.add(&attempt);
+      }
+    }
+    for (auto attempt: toWake) {
+      q.remove(*attempt);
+      attempt->fulfiller->fulfill();
+    }
+  }
+
+ private:
+  const Isolate& isolate;
+  kj::Own<kj::PromiseFulfiller<void>> fulfiller;
+  kj::ListLink<BlockedLockAttempt> link;
+
+  // True if this attempt was woken by wakeNext() and hasn't resumed yet.
+  bool wokenToProceed = false;
+
+  using Queue = kj::List<BlockedLockAttempt, &BlockedLockAttempt::link>;
+  static const kj::EventLoopLocal<Queue> queue;
+};
+
+const kj::EventLoopLocal<Worker::BlockedLockAttempt::Queue> Worker::BlockedLockAttempt::queue;
+
 // Represents a thread's attempt to take an async lock. Each Isolate has a linked list of
 // `AsyncWaiter`s. A particular thread only ever owns one `AsyncWaiter` at a time.
 class Worker::AsyncWaiter: public kj::Refcounted {
@@ -358,9 +477,9 @@ class Worker::AsyncWaiter: public kj::Refcounted {
   kj::ForkedPromise<void> readyPromise = nullptr;
   kj::Own<kj::CrossThreadPromiseFulfiller<void>> readyFulfiller;
 
-  // Promise/fulfiller to fire when the AsyncLock is finally released. This is used when a thread
-  // tries to take locks on multiple different isolates concurrently, in order to serialize the
-  // locks so only one is taken at a time. This is NOT a cross-thread fulfiller; it can only be
+  // Promise/fulfiller to fire when the AsyncLock is finally released. This is used by
+  // AsyncLock::whenThreadIdle(). (Lock attempts for other isolates wait in the thread's
+  // BlockedLockAttempt queue instead.) This is NOT a cross-thread fulfiller; it can only be
   // fulfilled by the thread that owns the waiter.
   kj::ForkedPromise<void> releasePromise = nullptr;
   kj::Own<kj::PromiseFulfiller<void>> releaseFulfiller;
@@ -525,6 +644,35 @@ struct Worker::Isolate::Impl {
   // their own thread has blocked waiting for the lock for a long time.
   mutable uint64_t lockSuccessCount = 0;
 
+  // Instantaneous count of tasks this isolate has running on the shared ThreadPool, used to
+  // implement tryReserveOffThreadTask().
+  mutable uint offThreadTaskCount = 0;
+
+  // Instantaneous count of requests delivered to this isolate that have not yet completed, and
+  // whether an idle task pass is already waiting to run for when it drops to zero. See
+  // completedRequest().
+  mutable uint activeRequestCount = 0;
+  mutable bool idleTasksScheduled = false;
+
+  // Only accessed under the isolate lock.
+  mutable api::CryptoKeyCache cryptoKeyCache;
+
+  // Only accessed under the isolate lock.
+  mutable api::SocketPool socketPool;
+
+  // Only accessed under the isolate lock. Holds V8 handles, so it is cleared under the lock when
+  // the isolate is destroyed.
+  mutable api::URLPatternRegexCache urlPatternRegexCache;
+
+  // Whether startHeapSampling() started V8's sampling heap profiler. Only accessed under the
+  // isolate lock.
+  mutable bool heapSamplingStarted = false;
+
+  // The CPU profiler started by startCpuProfiling(). Kept apart from `profiler`, which belongs to
+  // the inspector, so that an inspector session can't stop this profile or vice versa. Only
+  // accessed under the isolate lock.
+  mutable kj::Maybe<kj::Own<v8::CpuProfiler>> controlCpuProfiler;
+
   // Wrapper around JsgWorkerIsolate::Lock and various RAII objects which help us report metrics,
   // measure instantaneous load, avoid spurious watchdog kills, and defer context destruction.
   //
@@ -552,6 +700,7 @@ struct Worker::Isolate::Impl {
           }()),
           progressCounter(impl.lockSuccessCount),
           oldCurrentApi(currentApi),
+          featureFlags(isolate.api->getFeatureFlags()),
           limitEnforcer(isolate.getLimitEnforcer()),
           consoleMode(isolate.consoleMode),
           lock(isolate.api->lock(stackScope)) {
@@ -634,6 +783,9 @@ struct Worker::Isolate::Impl {
     bool shouldReportIsolateMetrics = false;
     const Api* oldCurrentApi;
 
+    // Makes FeatureFlags::get() return this isolate's flags while the lock is held.
+    FeatureFlags::Scope featureFlags;
+
     const IsolateLimitEnforcer& limitEnforcer;  // only so we can call getIsolateStats()
 
     ConsoleMode consoleMode;
@@ -669,7 +821,8 @@ struct Worker::Isolate::Impl {
       InspectorPolicy inspectorPolicy)
       : metrics(metrics),
         inspectorPolicy(inspectorPolicy),
-        actorCacheLru(limitEnforcer.getActorCacheLruOptions()) {
+        actorCacheLru(limitEnforcer.getActorCacheLruOptions()),
+        cryptoKeyCache(limitEnforcer.getCryptoKeyCacheLimit()) {
     jsg::runInV8Stack([&](jsg::V8StackScope& stackScope) {
       auto lock = api.lock(stackScope);
 
@@ -987,6 +1140,7 @@ Worker::Isolate::Isolate(kj::Own<Api> apiParam,
       traceAsyncContextKey(kj::refcounted<jsg::AsyncContextFrame::StorageKey>()) {
   api->setIsolateObserver(*metrics);
   metrics->created();
+  util::SlowOperationSite::setJsStackCapturer(&captureJsStackForSlowOperation);
   // We just created our isolate, so we don't need to use Isolate::Impl::Lock (nor an async lock).
   jsg::runInV8Stack([&](jsg::V8StackScope& stackScope) {
     auto lock = api->lock(stackScope);
@@ -1027,7 +1181,9 @@ Worker::Isolate::Isolate(kj::Own<Api> apiParam,
         }
 
         KJ_IF_SOME(i, impl->inspector) {
-          jsg::sendExceptionToInspector(js, *i.get(), kj::str(desc), error, message);
+          if (hasInspectorSession()) {
+            jsg::sendExceptionToInspector(js, *i.get(), kj::str(desc), error, message);
+          }
         }
 
         // Run with --verbose to log JS exceptions to stderr. Useful when running tests.
@@ -1049,6 +1205,7 @@ Worker::Isolate::Isolate(kj::Own<Api> apiParam,
         [](v8::Isolate* isolate, v8::GCType type, v8::GCCallbackFlags flags, void* data) noexcept {
       // We assume that a v8::Locker is alive during GC.
       KJ_DASSERT(v8::Locker::IsLocked(isolate));
+      TRACE_EVENT_BEGIN("workerd.gc", "V8 GC", "type", static_cast<int>(type));
       auto& self = *reinterpret_cast<Isolate*>(data);
       // However, currentLock might not be available, if (like in our Worker::Isolate constructor) we
       // don't use a Worker::Isolate::Impl::Lock.
@@ -1060,6 +1217,7 @@ Worker::Isolate::Isolate(kj::Own<Api> apiParam,
         [](v8::Isolate* isolate, v8::GCType type, v8::GCCallbackFlags flags, void* data) noexcept {
       // We make similar assumptions about v8::Locker and currentLock as in the prologue callback.
       KJ_DASSERT(v8::Locker::IsLocked(isolate));
+      TRACE_EVENT_END("workerd.gc");
       auto& self = *reinterpret_cast<Isolate*>(data);
       KJ_IF_SOME(currentLock, self.impl->currentLock) {
         currentLock.gcEpilogue();
@@ -1267,7 +1425,8 @@ Worker::Script::Script(kj::Own<const Isolate> isolateParam,
     });
 
     lock.withinHandleScope([&] {
-      if (isolate->impl->inspector != kj::none || errorReporter != kj::none) {
+      // An inspector session turns this on while it's attached; see attachInspector().
+      if (isolate->hasInspectorSession() || errorReporter != kj::none) {
         lock.v8Isolate->SetCaptureStackTraceForUncaughtExceptions(true);
       }
 
@@ -1331,6 +1490,9 @@ Worker::Script::Script(kj::Own<const Isolate> isolateParam,
 
         try {
           try {
+            TRACE_EVENT("workerd.script", "Worker::Script compile");
+            static util::SlowOperationSite slowOpSite("worker: script compile", 1 * kj::SECONDS);
+            util::SlowOperationTimer slowOpTimer(slowOpSite);
             KJ_SWITCH_ONEOF(source) {
               KJ_CASE_ONEOF(script, ScriptSource) {
                 impl->globals =
@@ -1406,6 +1568,7 @@ Worker::Isolate::~Isolate() noexcept(false) {
     metrics->teardownLockAcquired();
     auto inspector = kj::mv(impl->inspector);
     auto dropTraceAsyncContextKey = kj::mv(traceAsyncContextKey);
+    impl->urlPatternRegexCache.clear();
   });
 }
 
@@ -1431,6 +1594,12 @@ const Worker::Isolate& Worker::Isolate::from(jsg::Lock& js) {
   return *static_cast<const Worker::Isolate*>(ptr);
 }
 
+kj::Maybe<const Worker::Isolate&> Worker::Isolate::tryFrom(jsg::Lock& js) {
+  auto ptr = js.v8Isolate->GetData(jsg::SET_DATA_ISOLATE);
+  if (ptr == nullptr) return kj::none;
+  return *static_cast<const Worker::Isolate*>(ptr);
+}
+
 bool Worker::Isolate::Impl::Lock::checkInWithLimitEnforcer(Worker::Isolate& isolate) {
   shouldReportIsolateMetrics = true;
   return limitEnforcer.exitJs(*lock);
@@ -1491,6 +1660,22 @@ void Worker::setupContext(
 
 namespace {
 
+kj::StringPtr logLevelName(LogLevel level) {
+  switch (level) {
+    case LogLevel::DEBUG_:
+      return "debug"_kj;
+    case LogLevel::INFO:
+      return "info"_kj;
+    case LogLevel::LOG:
+      return "log"_kj;
+    case LogLevel::WARN:
+      return "warn"_kj;
+    case LogLevel::ERROR:
+      return "error"_kj;
+  }
+  KJ_UNREACHABLE;
+}
+
 jsg::JsObject resolveNodeInspectModule(jsg::Lock& js) {
   static constexpr auto kSpecifier = "node-internal:internal_inspect"_kj;
   if (FeatureFlags::get(js).getNewModuleRegistry()) {
@@ -1510,6 +1695,7 @@ kj::Maybe<jsg::JsObject> tryResolveMainModule(jsg::Lock& js,
     jsg::JsContext<api::ServiceWorkerGlobalScope>& jsContext,
     const Worker::Script& script,
     ExceptionOrDuration& limitErrorOrTime) {
+  TRACE_EVENT("workerd.script", "Worker evaluate main module");
   kj::Own<void> limitScope;
   if (script.isPython) {
     limitScope = script.getIsolate().getLimitEnforcer().enterStartupPython(js, limitErrorOrTime);
@@ -1769,12 +1955,20 @@ void Worker::handleLog(jsg::Lock& js,
     LogLevel level,
     const v8::Global<v8::Function>& original,
     const v8::FunctionCallbackInfo<v8::Value>& info) {
-  // Call original V8 implementation so messages sent to connected inspector if any
+  // Call the original V8 implementation so that the message reaches the attached inspector. With
+  // nobody attached, the inspector would only capture a stack trace and keep the arguments alive
+  // in its message storage, so skip it.
   auto context = js.v8Context();
   int length = info.Length();
   v8::LocalVector<v8::Value> args(js.v8Isolate, length + 1);
   for (auto i: kj::zeroTo(length)) args[i] = info[i];
-  jsg::check(original.Get(js.v8Isolate)->Call(context, info.This(), length, args.data()));
+  KJ_IF_SOME(isolate, Isolate::tryFrom(js)) {
+    if (isolate.hasInspectorSession()) {
+      jsg::check(original.Get(js.v8Isolate)->Call(context, info.This(), length, args.data()));
+    }
+  } else {
+    jsg::check(original.Get(js.v8Isolate)->Call(context, info.This(), length, args.data()));
+  }
 
   // The TryCatch is initialised here to catch cases where the v8 isolate's execution is
   // terminating, usually as a result of an infinite loop. We need to perform the initialisation
@@ -1878,10 +2072,10 @@ void Worker::handleLog(jsg::Lock& js,
 
     // Log warnings and errors to stderr
     auto useStderr = level >= LogLevel::WARN;
-    auto fd = useStderr ? stderr : stdout;
     auto tty = useStderr ? STDERR_TTY : STDOUT_TTY;
-    auto colors =
-        COLOR_MODE == ColorMode::ENABLED || (COLOR_MODE == ColorMode::ENABLED_IF_TTY && tty);
+    auto& logWriter = LogWriter::getStdio();
+    auto colors = logWriter.getFormat() == LogWriter::Format::TEXT &&
+        (COLOR_MODE == ColorMode::ENABLED || (COLOR_MODE == ColorMode::ENABLED_IF_TTY && tty));
 
     auto inspectModule = resolveNodeInspectModule(js);
     v8::Local<v8::Value> formatLogVal = inspectModule.get(js, "formatLog"_kj);
@@ -1891,8 +2085,9 @@ void Worker::handleLog(jsg::Lock& js,
     args[length] = v8::Boolean::New(js.v8Isolate, colors);
     auto formatted = js.toString(
         jsg::check(formatLog->Call(context, js.v8Undefined(), length + 1, args.data())));
-    fprintf(fd, "%s\n", formatted.cStr());
-    fflush(fd);
+    // The write itself happens on the log writer's thread, so a slow log pipe doesn't stall the
+    // event loop.
+    logWriter.write(useStderr, logLevelName(level), kj::mv(formatted));
   }
 }
 
@@ -1923,9 +2118,11 @@ Worker::Lock::Lock(const Worker& constWorker, LockType lockType, jsg::V8StackSco
       worker(const_cast<Worker&>(constWorker)),
       impl(kj::heap<Impl>(worker, lockType, stackScope)) {
   kj::requireOnStack(this, "Worker::Lock MUST be allocated on the stack.");
+  TRACE_EVENT_BEGIN("workerd.lock", "isolate lock held");
 }
 
 Worker::Lock::~Lock() noexcept(false) {
+  TRACE_EVENT_END("workerd.lock");
   // const_cast OK because we hold -- nay, we *are* -- a lock on the script.
   auto& isolate = const_cast<Isolate&>(worker.getIsolate());
   if (impl->recordedLock.checkInWithLimitEnforcer(isolate)) {
@@ -2040,8 +2237,10 @@ void Worker::Lock::logUncaughtException(kj::StringPtr description) {
   // We don't add the exception to traces here, since it turns out that this path only gets hit by
   // intermediate exception handling.
   KJ_IF_SOME(i, worker.script->isolate->impl->inspector) {
-    JSG_WITHIN_CONTEXT_SCOPE(*this, getContext(),
-        [&](jsg::Lock& js) { jsg::sendExceptionToInspector(js, *i.get(), description); });
+    if (worker.script->isolate->hasInspectorSession()) {
+      JSG_WITHIN_CONTEXT_SCOPE(*this, getContext(),
+          [&](jsg::Lock& js) { jsg::sendExceptionToInspector(js, *i.get(), description); });
+    }
   }
 
   // Run with --verbose to log JS exceptions to stderr. Useful when running tests.
@@ -2062,8 +2261,11 @@ void Worker::Lock::logUncaughtException(
   }
 
   KJ_IF_SOME(i, worker.script->isolate->impl->inspector) {
-    JSG_WITHIN_CONTEXT_SCOPE(*this, getContext(),
-        [&](jsg::Lock& js) { sendExceptionToInspector(js, *i.get(), source, exception, message); });
+    if (worker.script->isolate->hasInspectorSession()) {
+      JSG_WITHIN_CONTEXT_SCOPE(*this, getContext(), [&](jsg::Lock& js) {
+        sendExceptionToInspector(js, *i.get(), source, exception, message);
+      });
+    }
   }
 
   // Run with --verbose to log JS exceptions to stderr. Useful when running tests.
@@ -2270,6 +2472,12 @@ kj::Promise<Worker::AsyncLock> Worker::Isolate::takeAsyncLockImpl(
     currentLoad = getCurrentLoad();
   }
 
+  kj::Maybe<BlockedLockAttempt> blocked;
+
+  // The wait spans turns of the event loop, so it goes on a track of its own.
+  TRACE_EVENT_BEGIN("workerd.lock", "isolate lock wait", PERFETTO_TRACK_FROM_POINTER(&blocked));
+  KJ_DEFER(TRACE_EVENT_END("workerd.lock", PERFETTO_TRACK_FROM_POINTER(&blocked)));
+
   for (uint threadWaitingDifferentLockCount = 0;; ++threadWaitingDifferentLockCount) {
     AsyncWaiter* waiter = *AsyncWaiter::threadCurrentWaiter;
 
@@ -2295,12 +2503,20 @@ kj::Promise<Worker::AsyncLock> Worker::Isolate::takeAsyncLockImpl(
     } else {
       // Thread is already waiting for or holding a different isolate lock. Wait for that one to
       // be released before we try to lock a different isolate.
-      // TODO(perf): Use of ForkedPromise leads to thundering herd here. Should be minor in practice,
-      //   but we could consider creating another linked list instead...
+      bool wasWoken = blocked != kj::none;
       KJ_IF_SOME(lt, lockTiming) {
+        if (wasWoken) {
+          // We were woken, but another lock attempt on this thread got in first.
+          lt.get()->spuriousWakeup();
+        }
         lt.get()->waitingForOtherIsolate(waiter->isolate->getId());
       }
-      co_await waiter->releasePromise;
+      if (blocked == kj::none) {
+        blocked.emplace(*this);
+      }
+      auto& attempt = KJ_ASSERT_NONNULL(blocked);
+      co_await attempt.block(wasWoken /* atFront */);
+      attempt.resumed();
     }
   }
 }
@@ -2344,6 +2560,10 @@ Worker::AsyncWaiter::AsyncWaiter(kj::Own<const Isolate> isolateParam)
   *threadCurrentWaiter = this;
 
   __atomic_add_fetch(&isolate->impl->lockAttemptGauge, 1, __ATOMIC_RELAXED);
+
+  // Other lock attempts on this thread that were blocked waiting to lock this same isolate can
+  // now coalesce with us.
+  BlockedLockAttempt::wakeAllFor(*isolate);
 }
 
 Worker::AsyncWaiter::~AsyncWaiter() noexcept {
@@ -2352,29 +2572,44 @@ Worker::AsyncWaiter::~AsyncWaiter() noexcept {
 
   __atomic_sub_fetch(&isolate->impl->lockAttemptGauge, 1, __ATOMIC_RELAXED);
 
-  auto lock = isolate->asyncWaiters.lockExclusive();
-
   releaseFulfiller->fulfill();
 
-  // Remove ourselves from the list.
-  *prev = next;
-  KJ_IF_SOME(n, next) {
-    n.prev = prev;
-  } else {
-    lock->tail = prev;
-  }
+  // If we were at the front of the line, the fulfiller that wakes the next waiter. We take it out
+  // of the waiter while we hold the list lock, but only invoke it after releasing the lock: waking
+  // another thread can involve a syscall, and every other thread taking or releasing a lock on
+  // this isolate is blocked on `asyncWaiters` for as long as we hold it. Once taken, the next
+  // waiter no longer refers to the fulfiller, so it's fine if it goes away in the meantime; its
+  // promise is then simply never awaited.
+  kj::Own<kj::CrossThreadPromiseFulfiller<void>> wakeNext;
 
-  if (prev == &lock->head) {
-    // We held the lock before now. Alert the next waiter that they are now at the front of the
-    // line.
+  {
+    auto lock = isolate->asyncWaiters.lockExclusive();
+
+    // Remove ourselves from the list.
+    *prev = next;
     KJ_IF_SOME(n, next) {
-      n.readyFulfiller->fulfill();
+      n.prev = prev;
+    } else {
+      lock->tail = prev;
+    }
+
+    if (prev == &lock->head) {
+      // We held the lock before now. The next waiter is now at the front of the line.
+      KJ_IF_SOME(n, next) {
+        wakeNext = kj::mv(n.readyFulfiller);
+      }
     }
   }
 
+  if (wakeNext.get() != nullptr) {
+    wakeNext->fulfill();
+  }
+
   auto& w = *threadCurrentWaiter;
   KJ_ASSERT(w == this);
   w = nullptr;
+
+  BlockedLockAttempt::wakeNext();
 }
 
 kj::Promise<void> Worker::AsyncLock::whenThreadIdle() {
@@ -2394,6 +2629,13 @@ kj::Promise<void> Worker::AsyncLock::whenThreadIdle() {
   }
 }
 
+bool Worker::AsyncLock::isContended() const {
+  // Every AsyncWaiter counts towards the gauge, including ours, so any other count means another
+  // thread is in line for the isolate.
+  return BlockedLockAttempt::anyBlocked() ||
+      __atomic_load_n(&waiter->isolate->impl->lockAttemptGauge, __ATOMIC_RELAXED) > 1;
+}
+
 // =======================================================================================
 
 // A proxy for OutputStream that internally buffers data as long as it's beyond a given limit.
@@ -2507,7 +2749,7 @@ class Worker::Isolate::InspectorChannelImpl final: public v8_inspector::V8Inspec
       Isolate& isolate,
       jsg::V8StackScope& stackScope,
       Isolate::Impl::Lock& recordedLock) {
-    capnp::MallocMessageBuilder messageBuilder;
+    PooledMessageBuilder messageBuilder;
     auto cmd = messageBuilder.initRoot<cdp::Command>();
     getCdpJsonCodec().decode(message, cmd);
 
@@ -2902,7 +3144,7 @@ class Worker::Isolate::InspectorChannelImpl final: public v8_inspector::V8Inspec
       Activity(InspectorChannelImpl& channel): channel(channel) {}
 
       ControlOption ReportProgressValue(uint32_t done, uint32_t total) {
-        capnp::MallocMessageBuilder message;
+        PooledMessageBuilder message;
         auto event = message.initRoot<cdp::Event>();
         auto params = event.initReportHeapSnapshotProgress();
         params.setDone(done);
@@ -2932,7 +3174,7 @@ class Worker::Isolate::InspectorChannelImpl final: public v8_inspector::V8Inspec
       }
 
       v8::OutputStream::WriteResult WriteAsciiChunk(char* data, int size) override {
-        capnp::MallocMessageBuilder message;
+        PooledMessageBuilder message;
         auto event = message.initRoot<cdp::Event>();
 
         auto params = event.initAddHeapSnapshotChunk();
@@ -3069,6 +3311,11 @@ kj::Promise<void> Worker::Isolate::attachInspector(
     auto channel = kj::heap<Worker::Isolate::InspectorChannelImpl>(
         kj::atomicAddRef(*this), kj::mv(isolateThreadExecutor), webSocket);
     lockedSelf.currentInspectorSession = *channel;
+    __atomic_store_n(&lockedSelf.inspectorSessionAttached, true, __ATOMIC_RELAXED);
+    // Stack traces for uncaught exceptions are only worth capturing once someone can see them.
+    // This stays on after the session ends, since the script's error reporter may want it too.
+    // (V8 records async stack traces only once the session asks for them.)
+    lock.v8Isolate->SetCaptureStackTraceForUncaughtExceptions(true);
     lockedSelf.impl->inspectorClient.setChannel(*channel);
 
     // Send any queued notifications.
@@ -3089,6 +3336,7 @@ void Worker::Isolate::disconnectInspector() {
   KJ_IF_SOME(current, currentInspectorSession) {
     current.disconnect();
     currentInspectorSession = kj::none;
+    __atomic_store_n(&inspectorSessionAttached, false, __ATOMIC_RELAXED);
   }
   impl->inspectorClient.resetChannel();
 }
@@ -3146,7 +3394,7 @@ void Worker::Isolate::logMessage(jsg::Lock& js, uint16_t type, kj::StringPtr des
     //   inspector's own log. (Also, how does Chrome handle this?)
 
     js.withinHandleScope([&] {
-      capnp::MallocMessageBuilder message;
+      PooledMessageBuilder message;
       auto event = message.initRoot<cdp::Event>();
 
       auto params = event.initRuntimeConsoleApiCalled();
@@ -3192,10 +3440,14 @@ struct Worker::Actor::Impl {
 
   class HooksImpl: public InputGate::Hooks, public OutputGate::Hooks, public ActorCache::Hooks {
    public:
-    HooksImpl(kj::Own<Loopback> loopback, TimerChannel& timerChannel, ActorObserver& metrics)
+    HooksImpl(kj::Own<Loopback> loopback,
+        TimerChannel& timerChannel,
+        ActorObserver& metrics,
+        kj::Maybe<kj::Own<IoContext>>& ioContext)
         : loopback(kj::mv(loopback)),
           timerChannel(timerChannel),
-          metrics(metrics) {}
+          metrics(metrics),
+          ioContext(ioContext) {}
 
     void inputGateLocked() override {
       metrics.inputGateLocked();
@@ -3246,12 +3498,18 @@ struct Worker::Actor::Impl {
     }
     void storageWriteCompleted(kj::Duration latency) override {
       metrics.storageWriteCompleted(latency);
+      KJ_IF_SOME(context, ioContext) {
+        KJ_IF_SOME(request, context->tryGetMetrics()) {
+          request.storageFlushed(latency);
+        }
+      }
     }
 
    private:
     kj::Own<Loopback> loopback;  // only for updateAlarmInMemory()
     TimerChannel& timerChannel;  // only for afterLimitTimeout() and updateAlarmInMemory()
     ActorObserver& metrics;
+    kj::Maybe<kj::Own<IoContext>>& ioContext;  // only for storageWriteCompleted()
 
     kj::Maybe<kj::Promise<void>> maybeAlarmPreviewTask;
   };
@@ -3341,7 +3599,7 @@ struct Worker::Actor::Impl {
       : actorId(kj::mv(actorId)),
         makeStorage(kj::mv(makeStorage)),
         metrics(kj::mv(metricsParam)),
-        hooks(loopback->addRef(), timerChannel, *metrics),
+        hooks(loopback->addRef(), timerChannel, *metrics, ioContext),
         inputGate(hooks),
         outputGate(hooks),
         loopback(kj::mv(loopback)),
@@ -3775,6 +4033,7 @@ kj::Maybe<Worker::Actor::HibernationManager&> Worker::Actor::getHibernationManag
 void Worker::Actor::setHibernationManager(kj::Own<HibernationManager> hib) {
   KJ_REQUIRE(impl->hibernationManager == kj::none);
   hib->setTimerChannel(impl->timerChannel);
+  hib->setObserver(kj::addRef(*impl->metrics));
   // Not the cleanest way to provide hibernation manager with a timer channel reference, but
   // where HibernationManager is constructed (actor-state), we don't have a timer channel ref.
   impl->hibernationManager = kj::mv(hib);
@@ -3802,6 +4061,176 @@ uint Worker::Isolate::getLockSuccessCount() const {
   return __atomic_load_n(&impl->lockSuccessCount, __ATOMIC_RELAXED);
 }
 
+kj::Maybe<kj::Own<void>> Worker::Isolate::tryReserveOffThreadTask() const {
+  auto limit = limitEnforcer->getOffThreadTaskLimit();
+  uint count = __atomic_load_n(&impl->offThreadTaskCount, __ATOMIC_RELAXED);
+  do {
+    if (count >= limit) return kj::none;
+  } while (!__atomic_compare_exchange_n(
+      &impl->offThreadTaskCount, &count, count + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+  return kj::heap(kj::defer([isolate = kj::atomicAddRef(*this)]() {
+    __atomic_sub_fetch(&isolate->impl->offThreadTaskCount, 1, __ATOMIC_RELAXED);
+  }));
+}
+
+api::CryptoKeyCache& Worker::Isolate::getCryptoKeyCache() const {
+  return impl->cryptoKeyCache;
+}
+
+api::SocketPool& Worker::Isolate::getSocketPool() const {
+  return impl->socketPool;
+}
+
+api::URLPatternRegexCache& Worker::Isolate::getURLPatternRegexCache() const {
+  return impl->urlPatternRegexCache;
+}
+
+// Deepest stack the sampling heap profiler records for an allocation.
+static constexpr int HEAP_SAMPLING_STACK_DEPTH = 64;
+
+bool Worker::Isolate::startHeapSampling(uint64_t sampleInterval) const {
+  bool started = false;
+  jsg::runInV8Stack([&](jsg::V8StackScope& stackScope) {
+    Isolate::Impl::Lock recordedLock(*this, Worker::Lock::TakeSynchronously(kj::none), stackScope);
+    if (impl->heapSamplingStarted) return;
+    auto heapProfiler = recordedLock.lock->v8Isolate->GetHeapProfiler();
+    started = heapProfiler->StartSamplingHeapProfiler(sampleInterval, HEAP_SAMPLING_STACK_DEPTH);
+    impl->heapSamplingStarted = started;
+  });
+  return started;
+}
+
+bool Worker::Isolate::stopHeapSampling(PprofBuilder& profile) const {
+  bool stopped = false;
+  jsg::runInV8Stack([&](jsg::V8StackScope& stackScope) {
+    Isolate::Impl::Lock recordedLock(*this, Worker::Lock::TakeSynchronously(kj::none), stackScope);
+    if (!impl->heapSamplingStarted) return;
+    impl->heapSamplingStarted = false;
+    stopped = true;
+
+    auto& js = *recordedLock.lock;
+    js.withinHandleScope([&] {
+      auto heapProfiler = js.v8Isolate->GetHeapProfiler();
+      std::unique_ptr<v8::AllocationProfile> allocations(heapProfiler->GetAllocationProfile());
+      heapProfiler->StopSamplingHeapProfiler();
+      if (allocations == nullptr) return;
+
+      PprofBuilder::Label labels[] = {{"isolate", id}};
+      kj::Vector<uint64_t> callers;  // Root first.
+      auto visit = [&](auto& self, v8::AllocationProfile::Node* node) -> void {
+        auto name = js.toString(node->name);
+        auto scriptName = node->script_name.IsEmpty() ? kj::str() : js.toString(node->script_name);
+        callers.add(profile.addLocation(name.size() == 0 ? "(anonymous)"_kj : name.asPtr(),
+            scriptName, node->line_number));
+
+        if (node->allocations.size() > 0) {
+          auto stack = kj::heapArray<uint64_t>(callers.size());
+          for (auto i: kj::indices(callers)) {
+            stack[i] = callers[callers.size() - 1 - i];
+          }
+          for (auto& allocation: node->allocations) {
+            // V8 has already scaled the counts up to estimate all allocations, not just sampled
+            // ones.
+            int64_t values[] = {static_cast<int64_t>(allocation.count),
+              static_cast<int64_t>(allocation.count) * static_cast<int64_t>(allocation.size)};
+            profile.addSample(stack, values, labels);
+          }
+        }
+
+        for (auto child: node->children) {
+          self(self, child);
+        }
+        callers.removeLast();
+      };
+
+      // The root node is a placeholder for the bottom of every stack.
+      for (auto child: allocations->GetRootNode()->children) {
+        visit(visit, child);
+      }
+    });
+  });
+  return stopped;
+}
+
+static constexpr kj::StringPtr CONTROL_PROFILE_NAME = "Control Profile"_kj;
+
+bool Worker::Isolate::startCpuProfiling(kj::Duration sampleInterval) const {
+  bool started = false;
+  jsg::runInV8Stack([&](jsg::V8StackScope& stackScope) {
+    Isolate::Impl::Lock recordedLock(*this, Worker::Lock::TakeSynchronously(kj::none), stackScope);
+    if (impl->controlCpuProfiler != kj::none) return;
+
+    auto& js = *recordedLock.lock;
+    auto profiler = kj::Own<v8::CpuProfiler>(
+        v8::CpuProfiler::New(js.v8Isolate, v8::kDebugNaming, v8::kLazyLogging),
+        CpuProfilerDisposer::instance);
+    profiler->SetSamplingInterval(static_cast<int>(sampleInterval / kj::MICROSECONDS));
+    js.withinHandleScope([&] {
+      v8::CpuProfilingOptions options(
+          v8::kLeafNodeLineNumbers, v8::CpuProfilingOptions::kNoSampleLimit);
+      auto status = profiler->StartProfiling(
+          jsg::v8StrIntern(js.v8Isolate, CONTROL_PROFILE_NAME), kj::mv(options));
+      started = status == v8::CpuProfilingStatus::kStarted;
+    });
+    if (started) {
+      impl->controlCpuProfiler = kj::mv(profiler);
+    }
+  });
+  return started;
+}
+
+bool Worker::Isolate::stopCpuProfiling(PprofBuilder& profile) const {
+  bool stopped = false;
+  jsg::runInV8Stack([&](jsg::V8StackScope& stackScope) {
+    Isolate::Impl::Lock recordedLock(*this, Worker::Lock::TakeSynchronously(kj::none), stackScope);
+    auto profiler = kj::mv(KJ_UNWRAP_OR(impl->controlCpuProfiler, return));
+    impl->controlCpuProfiler = kj::none;
+    stopped = true;
+
+    auto& js = *recordedLock.lock;
+    js.withinHandleScope([&] {
+      auto cpuProfile =
+          profiler->StopProfiling(jsg::v8StrIntern(js.v8Isolate, CONTROL_PROFILE_NAME));
+      if (cpuProfile == nullptr) return;
+      KJ_DEFER(cpuProfile->Delete());
+
+      // Merge samples by leaf node. Each sample stands for the time until the next one.
+      struct NodeTotal {
+        int64_t count = 0;
+        int64_t nanos = 0;
+      };
+      kj::HashMap<const v8::CpuProfileNode*, NodeTotal> totals;
+      int sampleCount = cpuProfile->GetSamplesCount();
+      for (int i = 0; i < sampleCount; i++) {
+        auto end = i + 1 < sampleCount ? cpuProfile->GetSampleTimestamp(i + 1)
+                                       : cpuProfile->GetEndTime();
+        auto micros = kj::max(end - cpuProfile->GetSampleTimestamp(i), int64_t(0));
+        auto node = cpuProfile->GetSample(i);
+        auto& total =
+            totals.findOrCreate(node, [&]() { return decltype(totals)::Entry{node, {}}; });
+        total.count += 1;
+        total.nanos += micros * 1000;
+      }
+
+      PprofBuilder::Label labels[] = {{"isolate", id}};
+      auto root = cpuProfile->GetTopDownRoot();
+      kj::Vector<uint64_t> stack;  // Leaf first.
+      for (auto& entry: totals) {
+        stack.clear();
+        for (auto node = entry.key; node != nullptr && node != root; node = node->GetParent()) {
+          kj::StringPtr name = node->GetFunctionNameStr();
+          stack.add(profile.addLocation(name.size() == 0 ? "(anonymous)"_kj : name,
+              node->GetScriptResourceNameStr(), node->GetLineNumber()));
+        }
+        int64_t values[] = {entry.value.count, entry.value.nanos};
+        profile.addSample(stack, values, labels);
+      }
+    });
+  });
+  return stopped;
+}
+
 kj::Own<const Worker::Script> Worker::Isolate::newScript(kj::StringPtr scriptId,
     Script::Source source,
     IsolateObserver::StartType startType,
@@ -3812,8 +4241,50 @@ kj::Own<const Worker::Script> Worker::Isolate::newScript(kj::StringPtr scriptId,
       kj::atomicAddRef(*this), scriptId, kj::mv(source), startType, logNewScript, errorReporter);
 }
 
+void Worker::Isolate::startedRequest() const {
+  __atomic_add_fetch(&impl->activeRequestCount, 1, __ATOMIC_RELAXED);
+}
+
 void Worker::Isolate::completedRequest() const {
   limitEnforcer->completedRequest(id);
+
+  if (__atomic_sub_fetch(&impl->activeRequestCount, 1, __ATOMIC_RELAXED) > 0) return;
+
+  // The isolate just went idle. Give V8 a slice of time for the idle tasks it has queued, so that
+  // GC bookkeeping and code flushing happen now rather than on the next request's critical path.
+  auto budget = limitEnforcer->getIdleTaskBudget();
+  if (budget <= 0 * kj::NANOSECONDS) return;
+  if (__atomic_exchange_n(&impl->idleTasksScheduled, true, __ATOMIC_RELAXED)) return;
+  runIdleTasks(kj::atomicAddRef(*this), budget).detach([](kj::Exception&& exception) {
+    KJ_LOG(ERROR, "failed to run idle tasks", exception);
+  });
+}
+
+bool Worker::Isolate::isIdle(uint lockHolders) const {
+  return __atomic_load_n(&impl->activeRequestCount, __ATOMIC_RELAXED) == 0 &&
+      getCurrentLoad() <= lockHolders;
+}
+
+kj::Promise<void> Worker::Isolate::runIdleTasks(
+    kj::Own<const Isolate> isolate, kj::Duration budget) {
+  KJ_DEFER(__atomic_store_n(&isolate->impl->idleTasksScheduled, false, __ATOMIC_RELAXED));
+
+  // Let the rest of this turn run first; the request that just finished often has a successor
+  // ready to go on the same thread.
+  co_await kj::yield();
+  if (!isolate->isIdle(0)) co_return;
+
+  auto asyncLock = co_await isolate->takeAsyncLockWithoutRequest(nullptr);
+
+  // A request may have arrived, or another thread may have queued for the lock, while we waited.
+  // Our own lock counts towards the load.
+  if (!isolate->isIdle(1)) co_return;
+
+  jsg::runInV8Stack([&](jsg::V8StackScope& stackScope) {
+    Isolate::Impl::Lock recordedLock(*isolate, asyncLock, stackScope);
+    recordedLock.lock->runIdleTasks(budget);
+    isolate->limitEnforcer->isolateIdle(*recordedLock.lock);
+  });
 }
 
 bool Worker::Isolate::isInspectorEnabled() const {
@@ -3866,7 +4337,7 @@ class Worker::Isolate::ResponseStreamWrapper final: public kj::AsyncOutputStream
       auto& isolate = const_cast<Isolate&>(*constIsolate);
 
       KJ_IF_SOME(i, isolate.currentInspectorSession) {
-        capnp::MallocMessageBuilder message;
+        PooledMessageBuilder message;
 
         auto event = message.initRoot<cdp::Event>();
 
@@ -3930,7 +4401,7 @@ class Worker::Isolate::ResponseStreamWrapper final: public kj::AsyncOutputStream
       auto& isolate = const_cast<Isolate&>(*constIsolate);
 
       KJ_IF_SOME(i, isolate.currentInspectorSession) {
-        capnp::MallocMessageBuilder message;
+        PooledMessageBuilder message;
 
         auto event = message.initRoot<cdp::Event>();
 
@@ -4023,7 +4494,7 @@ kj::Promise<void> Worker::Isolate::SubrequestClient::request(kj::HttpMethod meth
       return lock.withinHandleScope([&] {
         auto requestId = kj::str(isolate.nextRequestId++);
 
-        capnp::MallocMessageBuilder message;
+        PooledMessageBuilder message;
 
         auto event = message.initRoot<cdp::Event>();
 
@@ -4065,7 +4536,7 @@ kj::Promise<void> Worker::Isolate::SubrequestClient::request(kj::HttpMethod meth
     // Note that signalResponse() is only called at all if signalRequest() determined that network
     // inspection is enabled.
 
-    auto message = kj::heap<capnp::MallocMessageBuilder>();
+    auto message = kj::heap<PooledMessageBuilder>();
 
     auto event = message->initRoot<cdp::Event>();
 
@@ -4225,7 +4696,9 @@ kj::Promise<WorkerInterface::CustomEvent::Result> Worker::Isolate::SubrequestCli
 kj::Own<WorkerInterface> Worker::Isolate::wrapSubrequestClient(kj::Own<WorkerInterface> client,
     kj::HttpHeaderId contentEncodingHeaderId,
     RequestObserver& requestMetrics) const {
-  if (impl->inspector != kj::none) {
+  // A session that attaches while the subrequest is in flight won't see it, but it wouldn't have
+  // seen the request start anyway.
+  if (hasInspectorSession()) {
     client = kj::heap<SubrequestClient>(
         kj::atomicAddRef(*this), kj::mv(client), contentEncodingHeaderId, requestMetrics);
   }
@@ -34,10 +34,13 @@ namespace api {
 class DurableObjectState;
 class DurableObjectStorage;
 class ServiceWorkerGlobalScope;
+class CryptoKeyCache;
 struct ExportedHandler;
 struct CryptoAlgorithm;
 struct QueueExportedHandler;
 class Socket;
+class SocketPool;
+class URLPatternRegexCache;
 class WebSocket;
 class WebSocketRequestResponsePair;
 class ExecutionContext;
@@ -46,6 +49,7 @@ class ExecutionContext;
 class ThreadContext;
 class IoContext;
 class InputGate;
+class PprofBuilder;
 class OutputGate;
 
 // Type signature of an entrypoint implementation class (Durable Object or stateless service).
@@ -172,6 +176,7 @@ class Worker: public kj::AtomicRefcounted {
 
   class InspectorClient;
   class AsyncWaiter;
+  class BlockedLockAttempt;
   friend constexpr bool _kj_internal_isPolymorphic(AsyncWaiter*);
 
   static void handleLog(jsg::Lock& js,
@@ -290,6 +295,10 @@ class Worker::Isolate: public kj::AtomicRefcounted {
   // Get the current Worker::Isolate from the current jsg::Lock
   static const Isolate& from(jsg::Lock& js);
 
+  // Like from(), but returns kj::none when the lock's isolate is not a Worker::Isolate, as in
+  // tests that run JSG code directly.
+  static kj::Maybe<const Isolate&> tryFrom(jsg::Lock& js);
+
   inline IsolateObserver& getMetrics() {
     return *metrics;
   }
@@ -332,6 +341,51 @@ class Worker::Isolate: public kj::AtomicRefcounted {
   // Returns a count that is incremented upon every successful lock.
   uint getLockSuccessCount() const;
 
+  // Reserves one of this isolate's slots for running CPU-bound native work on the shared
+  // ThreadPool. Returns kj::none if the isolate already has as many such tasks in flight as
+  // IsolateLimitEnforcer::getOffThreadTaskLimit() allows, in which case the caller should do the
+  // work inline. The slot is released when the returned object is dropped. Does not require a
+  // lock.
+  kj::Maybe<kj::Own<void>> tryReserveOffThreadTask() const;
+
+  // Returns this isolate's cache of imported public CryptoKeys. Requires the isolate lock.
+  api::CryptoKeyCache& getCryptoKeyCache() const;
+
+  // Returns this isolate's pool of idle connections released by sockets opened with `connect()`'s
+  // `pool` option. Requires the isolate lock.
+  api::SocketPool& getSocketPool() const;
+
+  // Returns this isolate's cache of compiled URLPattern component regexes. Requires the isolate
+  // lock.
+  api::URLPatternRegexCache& getURLPatternRegexCache() const;
+
+  // Starts V8's sampling heap profiler, which records the stack of roughly one allocation per
+  // `sampleInterval` bytes allocated. Unlike taking a heap snapshot, this only holds the isolate
+  // lock for long enough to start and stop sampling, so it is cheap enough for production. Returns
+  // false if sampling was already started. Takes the isolate lock synchronously.
+  //
+  // Note that V8 has only one sampling heap profiler per isolate, which is shared with the
+  // inspector's HeapProfiler.startSampling command.
+  bool startHeapSampling(uint64_t sampleInterval) const;
+
+  // Stops the sampling heap profiler and adds the sampled allocations that are still live to
+  // `profile`, labeled with this isolate's ID. `profile` must have been created with the sample
+  // types {"objects", "count"} and {"space", "bytes"}. Returns false if sampling wasn't started.
+  // Takes the isolate lock synchronously.
+  bool stopHeapSampling(PprofBuilder& profile) const;
+
+  // Starts V8's CPU profiler, sampling the isolate's stack every `sampleInterval`. This profiler
+  // is separate from the one the inspector's Profiler domain uses, so the two don't interfere.
+  // Returns false if a profile started by this method is already running. Takes the isolate lock
+  // synchronously.
+  bool startCpuProfiling(kj::Duration sampleInterval) const;
+
+  // Stops the CPU profiler and adds its samples to `profile`, labeled with this isolate's ID.
+  // Samples with the same stack are merged. `profile` must have been created with the sample
+  // types {"samples", "count"} and {"cpu", "nanoseconds"}. Returns false if profiling wasn't
+  // started. Takes the isolate lock synchronously.
+  bool stopCpuProfiling(PprofBuilder& profile) const;
+
   // Accepts a connection to the V8 inspector and handles requests until the client disconnects.
   // Also adds a special JSON value to the header identified by `controlHeaderId`, for compatibility
   // with internal Cloudflare systems.
@@ -379,7 +433,12 @@ class Worker::Isolate: public kj::AtomicRefcounted {
     return featureFlagsForFl;
   }
 
-  // Called after each completed request. Does not require a lock.
+  // Called when a request is delivered to this isolate. Does not require a lock.
+  void startedRequest() const;
+
+  // Called after each completed request. Does not require a lock. Once no requests remain in
+  // flight, this schedules a pass over V8's idle tasks, bounded by
+  // IsolateLimitEnforcer::getIdleTaskBudget().
   void completedRequest() const;
 
   // See Worker::takeAsyncLock().
@@ -390,6 +449,13 @@ class Worker::Isolate: public kj::AtomicRefcounted {
 
   bool isInspectorEnabled() const;
 
+  // True while an inspector session is attached. Inspector bookkeeping that only matters to an
+  // attached client checks this, so that an isolate with the inspector enabled but nobody
+  // attached runs about as fast as one without. Safe to call without the isolate lock.
+  bool hasInspectorSession() const {
+    return __atomic_load_n(&inspectorSessionAttached, __ATOMIC_RELAXED);
+  }
+
   // Represents a weak reference back to the isolate that code within the isolate can use as an
   // indirect pointer when they want to be able to race destruction safely. A caller wishing to
   // use a weak reference to the isolate should acquire a strong reference to weakIsolateRef.
@@ -407,6 +473,12 @@ class Worker::Isolate: public kj::AtomicRefcounted {
   kj::Promise<AsyncLock> takeAsyncLockImpl(
       kj::Maybe<kj::Own<IsolateObserver::LockTiming>> lockTiming) const;
 
+  // True if no requests are in flight and no more than `lockHolders` threads hold or are waiting
+  // for the isolate lock.
+  bool isIdle(uint lockHolders) const;
+
+  static kj::Promise<void> runIdleTasks(kj::Own<const Isolate> isolate, kj::Duration budget);
+
   kj::Own<IsolateObserver> metrics;
   // NOTE: destruction order is important here. The teardown guard should be destroyed after the
   // `api` since API destruction may perform some aspects of isolate teardown.
@@ -433,6 +505,8 @@ class Worker::Isolate: public kj::AtomicRefcounted {
 
   class InspectorChannelImpl;
   kj::Maybe<InspectorChannelImpl&> currentInspectorSession;
+  // Mirrors `currentInspectorSession != kj::none`, for hasInspectorSession().
+  bool inspectorSessionAttached = false;
 
   struct AsyncWaiterList {
     kj::Maybe<AsyncWaiter&> head = kj::none;
@@ -445,8 +519,10 @@ class Worker::Isolate: public kj::AtomicRefcounted {
   // protects the `AsyncWaiterList` as well as the next/prev pointers in each `AsyncWaiter` that
   // is currently in the list.
   kj::MutexGuarded<AsyncWaiterList> asyncWaiters;
-  // TODO(perf): Use a lock-free list? Tricky to get right. `asyncWaiters` should only be locked
-  //   briefly so there's probably not that much to gain.
+  // TODO(perf): Use a lock-free list? Tricky to get right, since waiters can leave from the middle
+  //   of the list when canceled. `asyncWaiters` is only locked briefly (in particular, waking the
+  //   next waiter happens after releasing it) so there's probably not that much to gain. See
+  //   `bench-async-lock` for measurements.
 
   friend class Worker::AsyncLock;
 
@@ -681,6 +757,11 @@ class Worker::AsyncLock {
   // pending events (a la `kj::evalLast()`).
   static kj::Promise<void> whenThreadIdle();
 
+  // Returns true if another thread is waiting for a lock on this isolate, or if a lock attempt on
+  // this thread is waiting for this lock to be released. A holder that could keep the lock for more
+  // work should release it instead if so.
+  bool isContended() const;
+
  private:
   kj::Own<AsyncWaiter> waiter;
   kj::Maybe<kj::Own<IsolateObserver::LockTiming>> lockTiming;
@@ -732,14 +813,29 @@ class Worker::Actor final: public kj::Refcounted {
   // removing WebSockets from its collection when they disconnect.
   class HibernationManager: public kj::Refcounted {
    public:
+    // A message that hibernatable websockets answer automatically, without waking the actor.
+    struct AutoResponseRule {
+      kj::String request;
+      kj::String response;
+
+      // If true, any text message that starts with `request` matches, rather than only `request`
+      // itself.
+      bool prefix = false;
+    };
+
     virtual void acceptWebSocket(jsg::Ref<api::WebSocket> ws, kj::ArrayPtr<kj::String> tags) = 0;
     virtual kj::Vector<jsg::Ref<api::WebSocket>> getWebSockets(
         jsg::Lock& js, kj::Maybe<kj::StringPtr> tag) = 0;
-    virtual void hibernateWebSockets(Worker::Lock& lock) = 0;
-    virtual void setWebSocketAutoResponse(
-        kj::Maybe<kj::StringPtr> request, kj::Maybe<kj::StringPtr> response) = 0;
+    virtual uint broadcast(jsg::Lock& js,
+        kj::Maybe<kj::StringPtr> tag,
+        kj::OneOf<kj::Array<kj::byte>, kj::String> message,
+        kj::ArrayPtr<const jsg::Ref<api::WebSocket>> except) = 0;
+    virtual void hibernateWebSockets(Worker::Lock& lock, ActorObserver& metrics) = 0;
+    virtual void setWebSocketAutoResponses(kj::Array<AutoResponseRule> rules) = 0;
     virtual kj::Maybe<jsg::Ref<api::WebSocketRequestResponsePair>> getWebSocketAutoResponse() = 0;
+    virtual void setWebSocketIdleTimeout(kj::Maybe<uint32_t> timeoutMs) = 0;
     virtual void setTimerChannel(TimerChannel& timerChannel) = 0;
+    virtual void setObserver(kj::Own<ActorObserver> observer) = 0;
     virtual kj::Own<HibernationManager> addRef() = 0;
     virtual void setEventTimeout(kj::Maybe<uint32_t> timeoutMs) = 0;
     virtual kj::Maybe<uint32_t> getEventTimeout() = 0;
@@ -29,9 +29,11 @@ AsyncContextFrame::AsyncContextFrame(Lock& js, StorageEntry storageEntry) {
     // Propagate the storage context of the current frame (if any).
     // If current(js) returns nullptr, we assume we're in the root
     // frame and there is no storage to propagate.
-    frame.storage.eraseAll([](const auto& entry) { return entry.key->isDead(); });
-    for (auto& entry: frame.storage) {
-      storage.insert(entry.clone(js));
+    if (frame.depth < MAX_CHAIN_DEPTH) {
+      parent = frame.addRef();
+      depth = frame.depth + 1;
+    } else {
+      frame.copyStorageInto(js, storage);
     }
   }
 
@@ -140,10 +142,35 @@ v8::Local<v8::Function> AsyncContextFrame::wrapRoot(
           }));
 }
 
+void AsyncContextFrame::copyStorageInto(Lock& js, Storage& into) {
+  for (AsyncContextFrame* frame = this;;) {
+    for (auto& entry: frame->storage) {
+      // Nearer frames are visited first, so an entry already present shadows this one.
+      if (!entry.key->isDead() && into.find(*entry.key) == kj::none) {
+        into.insert(entry.clone(js));
+      }
+    }
+    KJ_IF_SOME(next, frame->parent) {
+      frame = next.get();
+    } else {
+      return;
+    }
+  }
+}
+
 kj::Maybe<Value&> AsyncContextFrame::get(StorageKey& key) {
   KJ_ASSERT(!key.isDead());
-  storage.eraseAll([](const auto& entry) { return entry.key->isDead(); });
-  return storage.find(key).map([](auto& entry) -> Value& { return entry.value; });
+  for (AsyncContextFrame* frame = this;;) {
+    frame->storage.eraseAll([](const auto& entry) { return entry.key->isDead(); });
+    KJ_IF_SOME(entry, frame->storage.find(key)) {
+      return entry.value;
+    }
+    KJ_IF_SOME(next, frame->parent) {
+      frame = next.get();
+    } else {
+      return kj::none;
+    }
+  }
 }
 
 AsyncContextFrame::Scope::Scope(Lock& js, kj::Maybe<AsyncContextFrame&> resource)
@@ -180,6 +207,7 @@ v8::Local<v8::Object> AsyncContextFrame::getJSWrapper(Lock& js) {
 }
 
 void AsyncContextFrame::jsgVisitForGc(GcVisitor& visitor) {
+  visitor.visit(parent);
   for (auto& entry: storage) {
     visitor.visit(entry.value);
   }
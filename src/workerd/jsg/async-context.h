@@ -46,7 +46,12 @@ namespace workerd::jsg {
 //
 // All frames (except for the Root) are created within the scope of a parent, which by
 // default is whichever frame is current when the new frame is created. When the new frame
-// is created, it inherits a copy storage context of the parent.
+// is created, it inherits the storage context of the parent. Frames are immutable once
+// created, so rather than copying the parent's storage, a new frame stores only its own entry
+// plus a reference to its parent, and lookups fall through to the parent. Entering a new
+// storage scope is therefore O(1). To keep lookups cheap and to release shadowed values, a
+// frame whose chain of parents would exceed MAX_CHAIN_DEPTH instead copies the live entries
+// of the chain and starts a new one.
 //
 // To implement all of this, however, we depend largely on an obscure v8 API on the
 // v8::Context object called SetContinuationPreservedEmbedderData and
@@ -205,6 +210,7 @@ class AsyncContextFrame final: public Wrappable {
   }
   void jsgGetMemoryInfo(MemoryTracker& tracker) const override {
     Wrappable::jsgGetMemoryInfo(tracker);
+    tracker.trackField("parent", parent);
     tracker.trackField("storage", storage);
   }
 
@@ -224,8 +230,20 @@ class AsyncContextFrame final: public Wrappable {
   };
 
   using Storage = kj::Table<StorageEntry, kj::HashIndex<StorageEntryCallbacks>>;
+
+  static constexpr uint MAX_CHAIN_DEPTH = 8;
+
+  // The frame this one was created in, whose storage is visible through this frame unless
+  // shadowed by an entry in `storage`.
+  kj::Maybe<Ref<AsyncContextFrame>> parent;
+  // The number of frames in the chain of parents.
+  uint depth = 0;
   Storage storage;
 
+  // Copies the live entries visible from this frame into `into`, skipping keys `into` already
+  // has.
+  void copyStorageInto(Lock& js, Storage& into);
+
   void jsgVisitForGc(GcVisitor& visitor) override;
 
   friend struct StorageScope;
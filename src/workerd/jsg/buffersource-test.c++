@@ -99,5 +99,47 @@ KJ_TEST("BufferSource works") {
       "boolean", "true");
 }
 
+// Counts the arrays it disposes of, so tests can tell when V8 has released a backing store.
+class CountingDisposer final: public kj::ArrayDisposer {
+ public:
+  mutable uint count = 0;
+
+ protected:
+  void disposeImpl(void* firstElement,
+      size_t elementSize,
+      size_t elementCount,
+      size_t capacity,
+      void (*destroyElement)(void*)) const override {
+    ++count;
+    delete[] static_cast<kj::byte*>(firstElement);
+  }
+};
+
+KJ_TEST("BackingStore::from takes ownership of the array without copying") {
+  CountingDisposer disposer;
+
+  // Enough round trips to both fill and drain the recycled holders several times over.
+  for (auto i: kj::zeroTo(200u)) {
+    auto bytes = new kj::byte[3]{1, 2, static_cast<kj::byte>(i)};
+    {
+      auto backing = BackingStore::from(kj::Array<kj::byte>(bytes, 3, disposer));
+      auto ptr = backing.asArrayPtr();
+      KJ_EXPECT(ptr.begin() == bytes);
+      KJ_EXPECT(ptr.size() == 3);
+      KJ_EXPECT(ptr[2] == static_cast<kj::byte>(i));
+      KJ_EXPECT(disposer.count == i);
+    }
+    KJ_EXPECT(disposer.count == i + 1);
+  }
+
+  // Empty arrays are released right away, since V8 won't call a deleter for them.
+  {
+    auto backing = BackingStore::from(kj::Array<kj::byte>(new kj::byte[0], 0, disposer));
+    KJ_EXPECT(backing.size() == 0);
+    KJ_EXPECT(disposer.count == 201);
+  }
+  KJ_EXPECT(disposer.count == 201);
+}
+
 }  // namespace
 }  // namespace workerd::jsg::test
@@ -0,0 +1,136 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+// INTERNAL IMPLEMENTATION FILE
+//
+// Argument and return value conversions for methods registered with JSG_FAST_METHOD. V8 calls
+// these methods straight from optimized code through the fast API (v8::CFunction), bypassing the
+// FunctionCallbackInfo and the type wrapper. Only a handful of parameter types can be received
+// that way; see FastApiParam below.
+
+#include "util.h"
+
+#include <workerd/jsg/exception.h>
+
+#include <v8-fast-api-calls.h>
+
+#include <kj/array.h>
+
+namespace workerd::jsg {
+
+// FastApiParam<T> describes how a C++ parameter of type T can be received by a fast API call.
+//
+// - `Type` is what V8 passes to the fast callback.
+// - `Storage` is scratch space that lives for the duration of the call.
+// - `get()` converts the V8 value to T exactly the way the slow path's unwrap would, throwing the
+//   same errors, so that it doesn't matter which of the two paths V8 picks for a given call.
+template <typename T>
+struct FastApiParam {
+  static constexpr bool supported = false;
+};
+
+struct FastApiNoStorage {};
+
+template <>
+struct FastApiParam<bool> {
+  static constexpr bool supported = true;
+  using Type = bool;
+  using Storage = FastApiNoStorage;
+  static bool get(v8::Isolate*, bool value, Storage&, TypeErrorContext) {
+    return value;
+  }
+};
+
+template <>
+struct FastApiParam<double> {
+  static constexpr bool supported = true;
+  using Type = double;
+  using Storage = FastApiNoStorage;
+  static double get(v8::Isolate*, double value, Storage&, TypeErrorContext) {
+    return value;
+  }
+};
+
+// Received as a double rather than a uint32_t: V8 converts integer arguments for the fast path
+// with ToUint32()-like wrapping, whereas the slow path rejects negative and out-of-range values.
+template <>
+struct FastApiParam<uint32_t> {
+  static constexpr bool supported = true;
+  using Type = double;
+  using Storage = FastApiNoStorage;
+  static uint32_t get(v8::Isolate*, double value, Storage&, TypeErrorContext) {
+    JSG_REQUIRE(
+        isFinite(value), TypeError, "The value cannot be converted because it is not an integer.");
+    JSG_REQUIRE(value >= 0, TypeError,
+        "The value cannot be converted because it is negative and this "
+        "API expects a positive number.");
+    JSG_REQUIRE(value <= uint32_t(kj::maxValue), TypeError,
+        kj::str("Value out of range. Must be less than or equal to ", uint32_t(kj::maxValue), "."));
+    return uint32_t(value);
+  }
+};
+
+// A read-only view of an ArrayBuffer or ArrayBufferView's bytes. Unlike the slow path, this does
+// not take a reference on the backing store or materialize the ArrayBuffer of an on-heap typed
+// array; small on-heap contents are copied into the per-call storage instead. The view is only
+// valid until the method returns, and is only safe for methods that don't call back into
+// JavaScript, which could detach or resize the buffer.
+template <>
+struct FastApiParam<kj::Array<const kj::byte>> {
+  static constexpr bool supported = true;
+  using Type = v8::Local<v8::Value>;
+  struct Storage {
+    kj::byte bytes[V8_TYPED_ARRAY_MAX_SIZE_IN_HEAP];
+  };
+  static kj::Array<const kj::byte> get(
+      v8::Isolate* isolate, v8::Local<v8::Value> value, Storage& storage, TypeErrorContext ctx) {
+    kj::ArrayPtr<const kj::byte> bytes;
+    if (value->IsArrayBufferView()) {
+      auto span = value.As<v8::ArrayBufferView>()->GetContents(
+          v8::MemorySpan<uint8_t>(storage.bytes, sizeof(storage.bytes)));
+      bytes = kj::arrayPtr(span.data(), span.size());
+    } else if (value->IsArrayBuffer()) {
+      auto buffer = value.As<v8::ArrayBuffer>();
+      bytes = kj::arrayPtr(static_cast<const kj::byte*>(buffer->Data()), buffer->ByteLength());
+    } else {
+      throwTypeError(isolate, ctx, "ArrayBuffer or ArrayBufferView");
+    }
+    return kj::Array<const kj::byte>(bytes.begin(), bytes.size(), kj::NullArrayDisposer::instance);
+  }
+};
+
+// Return types that a fast API call can hand back to V8 without allocating.
+template <typename T>
+constexpr bool isFastApiReturn() {
+  return isVoid<T>() || kj::isSameType<T, bool>() || kj::isSameType<T, int32_t>() ||
+      kj::isSameType<T, uint32_t>() || kj::isSameType<T, double>();
+}
+
+// Like liftKj(), but for fast API callbacks, which report errors by throwing on the isolate and
+// returning an arbitrary value.
+template <typename Ret, typename Func>
+Ret liftKjFast(v8::Isolate* isolate, Func&& func) {
+  v8::HandleScope scope(isolate);
+  try {
+    try {
+      return func();
+    } catch (kj::Exception& exception) {
+      // As in liftKj(), decoding a tunneled error may itself throw JsExceptionThrown.
+      throwInternalError(isolate, kj::mv(exception));
+    }
+  } catch (JsExceptionThrown&) {
+    // nothing to do
+  } catch (std::exception& exception) {
+    throwInternalError(isolate, exception.what());
+  } catch (...) {
+    throwInternalError(
+        isolate, kj::str("caught unknown exception of type: ", kj::getCaughtExceptionType()));
+  }
+  if constexpr (!isVoid<Ret>()) {
+    return Ret();
+  }
+}
+
+}  // namespace workerd::jsg
@@ -90,6 +90,8 @@ struct FunctorCallback<TypeWrapper, Ret(Args...), kj::_::Indexes<indexes...>> {
       auto& func = extractInternalPointer<WrappableFunction<Ret(Args...)>, false>(
           context, args.Data().As<v8::Object>());
 
+      wrapper.template checkArgumentCount<Args...>(
+          context, args, [](uint i) { return TypeErrorContext::callbackArgument(i); });
       if constexpr (isVoid<Ret>()) {
         func(Lock::from(isolate),
             wrapper.template unwrap<Args>(
@@ -119,6 +121,8 @@ struct FunctorCallback<TypeWrapper,
           WrappableFunction<Ret(const v8::FunctionCallbackInfo<v8::Value>&, Args...)>, false>(
           context, args.Data().As<v8::Object>());
 
+      wrapper.template checkArgumentCount<Args...>(
+          context, args, [](uint i) { return TypeErrorContext::callbackArgument(i); });
       if constexpr (isVoid<Ret>()) {
         func(Lock::from(isolate), args,
             wrapper.template unwrap<Args>(
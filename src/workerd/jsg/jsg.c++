@@ -264,6 +264,10 @@ void Lock::terminateExecution() {
   v8Isolate->TerminateExecution();
 }
 
+void Lock::runIdleTasks(kj::Duration budget) {
+  IsolateBase::from(v8Isolate).runIdleTasks({}, budget);
+}
+
 Name Lock::newSymbol(kj::StringPtr symbol) {
   return Name(*this, v8::Symbol::New(v8Isolate, v8StrIntern(v8Isolate, symbol)));
 }
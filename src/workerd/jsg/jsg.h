@@ -22,6 +22,7 @@
 #include <kj/function.h>
 #include <kj/one-of.h>
 #include <kj/string.h>
+#include <kj/time.h>
 
 #include <type_traits>
 
@@ -210,6 +211,29 @@ namespace workerd::jsg {
     registry.template registerMethod<NAME, decltype(&Self::method), &Self::method>();              \
   } while (false)
 
+// Like JSG_METHOD, but additionally registers a V8 fast API entry point, which optimized code
+// calls directly without going through a FunctionCallbackInfo or the type wrapper. Intended for
+// small, hot methods whose own work is cheap enough that the call overhead dominates.
+//
+// The method must take only `bool`, `double`, `uint32_t` and `kj::Array<const kj::byte>`
+// parameters (optionally preceded by `jsg::Lock&`), and return void, bool, int32_t, uint32_t or
+// double. It must not call back into JavaScript: byte array parameters are borrowed views onto
+// the caller's buffers. V8 still uses the regular slow path whenever it cannot use the fast one,
+// e.g. before the caller has been optimized, so both must be correct.
+#define JSG_FAST_METHOD(name)                                                                      \
+  do {                                                                                             \
+    static const char NAME[] = #name;                                                              \
+    registry.template registerFastMethod<NAME, decltype(&Self::name), &Self::name>();              \
+  } while (false)
+
+// Like JSG_FAST_METHOD but allows you to specify a different name to use in JavaScript, as with
+// JSG_METHOD_NAMED.
+#define JSG_FAST_METHOD_NAMED(name, method)                                                        \
+  do {                                                                                             \
+    static const char NAME[] = #name;                                                              \
+    registry.template registerFastMethod<NAME, decltype(&Self::method), &Self::method>();          \
+  } while (false)
+
 // Use inside a JSG_RESOURCE_TYPE block to declare that the given method should be callable from
 // JavaScript on the resource type's constructor.
 #define JSG_STATIC_METHOD(name)                                                                    \
@@ -2609,6 +2633,9 @@ class Lock {
   JsSymbol symbolInternal(kj::StringPtr) KJ_WARN_UNUSED_RESULT;
   JsObject obj() KJ_WARN_UNUSED_RESULT;
   JsObject objNoProto() KJ_WARN_UNUSED_RESULT;
+  // Returns the current context's `Object.prototype`. This is cached on the context, so unlike
+  // `obj().getPrototype()` it does not allocate an object on every call.
+  JsObject getObjectPrototype() KJ_WARN_UNUSED_RESULT;
   JsMap map() KJ_WARN_UNUSED_RESULT;
   JsValue external(void*) KJ_WARN_UNUSED_RESULT;
   JsValue error(kj::StringPtr message) KJ_WARN_UNUSED_RESULT;
@@ -2666,6 +2693,11 @@ class Lock {
   void runMicrotasks();
   void terminateExecution();
 
+  // Gives V8 up to `budget` to run the idle tasks it has queued for this isolate, such as
+  // background-friendly GC work and code flushing. Call this only when the isolate has no request
+  // in flight, so that the work doesn't land on a request's critical path.
+  void runIdleTasks(kj::Duration budget);
+
   // Logs and reports the error to tail workers (if called within an request),
   // the inspector (if attached), or to KJ_LOG(Info).
   virtual void reportError(const JsValue& value) = 0;
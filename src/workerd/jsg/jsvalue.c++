@@ -223,7 +223,14 @@ JS_IS_TYPES(V)
 #undef V
 
 kj::String JsValue::toJson(Lock& js) const {
-  return kj::str(check(v8::JSON::Stringify(js.v8Context(), inner)));
+  // Encode straight into the result rather than going through kj::str(), which would encode into
+  // a v8::String::Utf8Value and then copy that again. The output of JSON.stringify() never has
+  // lone surrogates or embedded NULs, so the plain UTF-8 encoding is exact.
+  v8::Local<v8::String> str = check(v8::JSON::Stringify(js.v8Context(), inner));
+  auto buf = kj::heapArray<char>(str->Utf8Length(js.v8Isolate) + 1);
+  str->WriteUtf8(js.v8Isolate, buf.begin(), buf.size());
+  buf[buf.size() - 1] = 0;
+  return kj::String(kj::mv(buf));
 }
 
 JsValue JsValue::fromJson(Lock& js, kj::ArrayPtr<const char> input) {
@@ -441,6 +448,25 @@ JsObject Lock::obj() {
   return JsObject(v8::Object::New(v8Isolate));
 }
 
+// Embedder data slots 1 through 3 hold aligned pointers set up by newContext(); we stash
+// Object.prototype in the next one.
+static constexpr int OBJECT_PROTOTYPE_EMBEDDER_DATA_SLOT = 4;
+
+JsObject Lock::getObjectPrototype() {
+  auto context = v8Context();
+  if (context->GetNumberOfEmbedderDataFields() > OBJECT_PROTOTYPE_EMBEDDER_DATA_SLOT) {
+    auto cached = context->GetEmbedderData(OBJECT_PROTOTYPE_EMBEDDER_DATA_SLOT);
+    if (cached->IsObject()) {
+      return JsObject(cached.As<v8::Object>());
+    }
+  }
+
+  auto proto = v8::Object::New(v8Isolate)->GetPrototypeV2();
+  KJ_ASSERT(proto->IsObject());
+  context->SetEmbedderData(OBJECT_PROTOTYPE_EMBEDDER_DATA_SLOT, proto);
+  return JsObject(proto.As<v8::Object>());
+}
+
 JsObject Lock::objNoProto() {
   return JsObject(v8::Object::New(v8Isolate, v8::Null(v8Isolate), nullptr, nullptr, 0));
 }
@@ -76,7 +76,12 @@ namespace workerd::jsg::modules {
 // the ModuleRegistry will not actually generate the v8::Local<v8::Module>,
 // compile scripts, or evaluate it until the module is actually imported.
 // This means that any modules that are never actually imported by a worker
-// will never actually be compiled or evaluated.
+// will never actually be compiled or evaluated. Once compiled, a module is
+// cached by the IsolateModuleRegistry so that later imports of the same
+// specifier in that isolate reuse it. Note that the static imports of an ESM
+// module are, per the ESM spec, always evaluated before the importing module
+// itself; code that should only be loaded on rarely-used paths needs to use
+// dynamic `import()` to benefit from the lazy loading.
 //
 // A ModuleBundle will have one of three basic types: Bundle, Builtin,
 // or Builtin-Only. A Bundle ModuleBundle provides access to modules
@@ -7,6 +7,9 @@
 #include <kj/common.h>
 #include <kj/exception.h>
 #include <kj/string.h>
+#include <kj/time.h>
+
+#include <typeinfo>
 
 // Forward declare v8::Isolate here, this allows us to avoid including the V8 header and compile
 // some targets without depending on V8.
@@ -147,9 +150,22 @@ struct InternalExceptionObserver {
   virtual void reportInternalException(const kj::Exception&, Detail detail) {}
 };
 
+struct TemplateObserver {
+  virtual ~TemplateObserver() noexcept(false) {}
+
+  // Called after jsg creates the FunctionTemplate for a resource type, which happens at most once
+  // per type per isolate, the first time the type is needed. Nested types declared by the type
+  // are created along with it, but each is reported separately, and `duration` excludes them, so
+  // summing the durations never double-counts. Used to find out which APIs make isolate startup
+  // expensive. It is guaranteed that isolate lock is held during invocation.
+  virtual void onResourceTemplateCreated(
+      v8::Isolate* isolate, const std::type_info& type, kj::Duration duration) const {}
+};
+
 struct IsolateObserver: public CompilationObserver,
                         public InternalExceptionObserver,
-                        public ResolveObserver {
+                        public ResolveObserver,
+                        public TemplateObserver {
   virtual ~IsolateObserver() noexcept(false) {}
 };
 
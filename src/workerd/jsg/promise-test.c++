@@ -98,6 +98,15 @@ struct PromiseContext: public jsg::Object, public jsg::ContextGlobal {
     return result;
   }
 
+  Promise<int> makeResolved(jsg::Lock& js, int i) {
+    return js.resolvedPromise(kj::mv(i));
+  }
+
+  // Returns the promised value if it was already available on arrival, or -1.
+  int consumeIfResolved(jsg::Lock& js, jsg::Promise<int> promise) {
+    return promise.tryConsumeResolved(js).orDefault(-1);
+  }
+
   JSG_RESOURCE_TYPE(PromiseContext) {
     JSG_READONLY_PROTOTYPE_PROPERTY(promise, makePromise);
     JSG_METHOD(resolvePromise);
@@ -111,6 +120,9 @@ struct PromiseContext: public jsg::Object, public jsg::ContextGlobal {
     JSG_METHOD(whenResolved);
 
     JSG_METHOD(thenable);
+
+    JSG_METHOD(makeResolved);
+    JSG_METHOD(consumeIfResolved);
   }
 
   kj::Maybe<Promise<int>::Resolver> resolver;
@@ -176,6 +188,15 @@ KJ_TEST("whenResolved") {
   e.expectEval("whenResolved(Promise.resolve(1))", "undefined", "undefined");
 }
 
+KJ_TEST("already-settled promises convert without waiting for a microtask") {
+  Evaluator<PromiseContext, PromiseIsolate> e(v8System);
+
+  e.expectEval("consumeIfResolved(Promise.resolve(123))", "number", "123");
+  e.expectEval("consumeIfResolved((async () => 123)())", "number", "123");
+  e.expectEval("consumeIfResolved(makeResolved(123))", "number", "123");
+  e.expectEval("consumeIfResolved(new Promise(() => {}))", "number", "-1");
+}
+
 KJ_TEST("thenable") {
   static const auto config = JsgConfig{
     .unwrapCustomThenables = true,
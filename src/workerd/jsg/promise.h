@@ -588,11 +588,41 @@ class PromiseWrapper {
     // the object whose method returned the promise will not be destroyed while the promise is
     // still executing.
     auto markedAsHandled = promise.markedAsHandled;
+    auto& js = jsg::Lock::from(context->GetIsolate());
+    auto handle = promise.consumeHandle(js);
+
+    if constexpr (!isVoid<T>() && !isV8Ref<T>()) {
+      if (handle->State() == v8::Promise::kFulfilled) {
+        // The C++ value is already there, so convert it now rather than in a reaction job, which
+        // saves allocating the continuation function and queueing a microtask. Conversion errors
+        // still surface as a rejection, as they would from thenWrap().
+        auto resolver = check(v8::Promise::Resolver::New(context));
+        v8::TryCatch tryCatch(js.v8Isolate);
+        try {
+          auto& wrapper = *static_cast<TypeWrapper*>(this);
+          auto value = unwrapOpaque<T>(js.v8Isolate, handle->Result());
+          check(resolver->Resolve(context, wrapper.wrap(context, kj::none, kj::mv(value))));
+        } catch (JsExceptionThrown&) {
+          if (!tryCatch.CanContinue()) {
+            // Probably TerminateExecution() called.
+            tryCatch.ReThrow();
+            throw;
+          }
+          check(resolver->Reject(context, tryCatch.Exception()));
+        } catch (kj::Exception& exception) {
+          check(resolver->Reject(context, makeInternalError(js.v8Isolate, kj::mv(exception))));
+        }
+        auto ret = resolver->GetPromise();
+        if (markedAsHandled) {
+          ret->MarkAsHandled();
+        }
+        return ret;
+      }
+    }
+
     auto then = check(v8::Function::New(context, &thenWrap<TypeWrapper, T>, creator.orDefault({}),
         1, v8::ConstructorBehavior::kThrow));
-
-    auto& js = jsg::Lock::from(context->GetIsolate());
-    auto ret = check(promise.consumeHandle(js)->Then(context, then));
+    auto ret = check(handle->Then(context, then));
     // Although we added a .then() to the promise to translate the value to JavaScript, we would
     // like things to behave as if the C++ code returned this Promise directly to JavaScript. In
     // particular, if the C++ code marked the Promise handled, then the derived JavaScript promise
@@ -612,13 +642,22 @@ class PromiseWrapper {
     if (handle->IsPromise()) {
       auto promise = handle.As<v8::Promise>();
       if constexpr (!isVoid<T>() && !isV8Ref<T>()) {
+        if (promise->State() == v8::Promise::kFulfilled) {
+          // Typically the result of an async function that never awaited. Unwrap the value now
+          // rather than in a reaction job; evalNow() turns a failed conversion into a rejection,
+          // as thenUnwrap() would.
+          auto& js = Lock::from(context->GetIsolate());
+          auto& wrapper = *static_cast<TypeWrapper*>(this);
+          auto result = promise->Result();
+          return js.evalNow([&]() {
+            return wrapper.template unwrap<T>(
+                context, result, TypeErrorContext::promiseResolution());
+          });
+        }
+
         // Add a .then() to unwrap the promise's resolution (i.e. convert it from JS to C++).
         // Note that we don't need to handle the rejection case here as there is no wrapping
         // applied to exception values, so we just let it propagate through.
-        //
-        // TODO(perf): We could in theory check if promise->State() is kFulfilled and, in that
-        //   case, pull out promise->Result(), unwrap it, and make a new immediate promise.
-        //   Similarly in `wrap()`. Not clear if the added complexity is worth it, though.
         auto then = check(v8::Function::New(
             context, &thenUnwrap<TypeWrapper, T>, {}, 1, v8::ConstructorBehavior::kThrow));
         promise = check(promise->Then(context, then));
@@ -77,6 +77,60 @@ KJ_TEST("methods") {
 
 // ========================================================================================
 
+struct FastMethodContext: public ContextGlobalObject {
+  double scale(double value, uint32_t factor) {
+    return value * factor;
+  }
+  uint32_t sum(kj::Array<const kj::byte> bytes) {
+    uint32_t result = 0;
+    for (auto b: bytes) result += b;
+    return result;
+  }
+  bool isEmpty(Lock&, kj::Array<const kj::byte> bytes) {
+    return bytes.size() == 0;
+  }
+
+  JSG_RESOURCE_TYPE(FastMethodContext) {
+    JSG_FAST_METHOD(scale);
+    JSG_FAST_METHOD(sum);
+    JSG_FAST_METHOD(isEmpty);
+  }
+};
+JSG_DECLARE_ISOLATE_TYPE(FastMethodIsolate, FastMethodContext);
+
+KJ_TEST("JSG_FAST_METHODs behave like JSG_METHODs") {
+  Evaluator<FastMethodContext, FastMethodIsolate> e(v8System);
+  e.expectEval("scale(1.5, 4)", "number", "6");
+  e.expectEval("sum(new Uint8Array([1, 2, 3]))", "number", "6");
+  e.expectEval("sum(new Uint8Array([1, 2, 3]).buffer)", "number", "6");
+  e.expectEval("sum(new Uint8Array([1, 2, 3, 4]).subarray(1, 3))", "number", "5");
+  e.expectEval("sum(new Uint16Array([256, 1]))", "number", "2");
+  e.expectEval("isEmpty(new ArrayBuffer(0))", "boolean", "true");
+
+  e.expectEval("scale(1, -1)", "throws",
+      "TypeError: The value cannot be converted because it is negative and this "
+      "API expects a positive number.");
+  e.expectEval("sum('abc')", "throws",
+      "TypeError: Failed to execute 'sum' on 'FastMethodContext': parameter 1 is not of type "
+      "'ArrayBuffer or ArrayBufferView'.");
+
+  // Enough calls for the loop to be optimized, at which point V8 switches to the fast path
+  // part-way through. The results, and the errors, must not change when it does.
+  e.expectEval("const bytes = new Uint8Array([1, 2, 3]);\n"
+               "let total = 0;\n"
+               "for (let i = 0; i < 100000; ++i) total += sum(bytes) + scale(i % 2, 1);\n"
+               "total",
+      "number", "650000");
+  e.expectEval("let errors = 0;\n"
+               "for (let i = 0; i < 100000; ++i) {\n"
+               "  try { scale(1, i % 2 ? -1 : 1); } catch (e) { ++errors; }\n"
+               "}\n"
+               "errors",
+      "number", "50000");
+}
+
+// ========================================================================================
+
 struct Mixin {
   int getValue() {
     return i;
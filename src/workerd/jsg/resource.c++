@@ -24,6 +24,27 @@ void exposeGlobalScopeType(v8::Isolate* isolate, v8::Local<v8::Context> context)
   KJ_ASSERT(check(global->Set(context, name, constructor)));
 }
 
+static thread_local TemplateCreationScope* currentTemplateCreationScope = nullptr;
+
+TemplateCreationScope::TemplateCreationScope(v8::Isolate* isolate, const std::type_info& type)
+    : isolate(isolate),
+      type(type),
+      parent(currentTemplateCreationScope),
+      start(kj::systemPreciseMonotonicClock().now()) {
+  currentTemplateCreationScope = this;
+}
+
+TemplateCreationScope::~TemplateCreationScope() noexcept(false) {
+  currentTemplateCreationScope = parent;
+  if (unwindDetector.isUnwinding()) return;
+  auto elapsed = kj::systemPreciseMonotonicClock().now() - start;
+  if (parent != nullptr) {
+    parent->nested += elapsed;
+  }
+  IsolateBase::from(isolate).getObserver().onResourceTemplateCreated(
+      isolate, type, elapsed - nested);
+}
+
 v8::Local<v8::Symbol> getSymbolDispose(v8::Isolate* isolate) {
   return v8::Symbol::GetDispose(isolate);
 }
@@ -10,6 +10,7 @@
 // can call back to the class's methods. This differs from, say, a struct type, which will be deeply
 // converted into a JS object when passed into JS.
 
+#include "fast-api.h"
 #include "meta.h"
 #include "util.h"
 #include "wrappable.h"
@@ -21,6 +22,7 @@
 #include <kj/map.h>
 #include <kj/tuple.h>
 
+#include <tuple>
 #include <type_traits>
 #include <typeindex>
 
@@ -105,6 +107,9 @@ struct ConstructorCallback<TypeWrapper, T, Ref<T>(Args...), kj::_::Indexes<index
 
       auto& wrapper = TypeWrapper::from(isolate);
 
+      wrapper.template checkArgumentCount<Args...>(context, args,
+          [](uint i) { return TypeErrorContext::constructorArgument(typeid(T), i); });
+
       Ref<T> ptr = T::constructor(wrapper.template unwrap<Args>(
           context, args, indexes, TypeErrorContext::constructorArgument(typeid(T), indexes))...);
       if constexpr (T::jsgHasReflection) {
@@ -130,6 +135,9 @@ struct ConstructorCallback<TypeWrapper, T, Ref<T>(Lock&, Args...), kj::_::Indexe
 
       auto& wrapper = TypeWrapper::from(isolate);
 
+      wrapper.template checkArgumentCount<Args...>(context, args,
+          [](uint i) { return TypeErrorContext::constructorArgument(typeid(T), i); });
+
       Ref<T> ptr = T::constructor(Lock::from(isolate),
           wrapper.template unwrap<Args>(context, args, indexes,
               TypeErrorContext::constructorArgument(typeid(T), indexes))...);
@@ -160,6 +168,9 @@ struct ConstructorCallback<TypeWrapper,
 
       auto& wrapper = TypeWrapper::from(isolate);
 
+      wrapper.template checkArgumentCount<Args...>(context, args,
+          [](uint i) { return TypeErrorContext::constructorArgument(typeid(T), i); });
+
       Ref<T> ptr = T::constructor(args,
           wrapper.template unwrap<Args>(context, args, indexes,
               TypeErrorContext::constructorArgument(typeid(T), indexes))...);
@@ -211,6 +222,8 @@ struct MethodCallback<TypeWrapper,
       auto obj = args.This();
       auto& wrapper = TypeWrapper::from(isolate);
       auto& self = extractInternalPointer<T, isContext>(context, obj);
+      wrapper.template checkArgumentCount<Args...>(context, args,
+          [](uint i) { return TypeErrorContext::methodArgument(typeid(T), methodName, i); });
       if constexpr (isVoid<Ret>()) {
         (self.*method)(wrapper.template unwrap<Args>(context, args, indexes,
             TypeErrorContext::methodArgument(typeid(T), methodName, indexes))...);
@@ -248,6 +261,8 @@ struct MethodCallback<TypeWrapper,
       auto& wrapper = TypeWrapper::from(isolate);
       auto& self = extractInternalPointer<T, isContext>(context, obj);
       auto& lock = Lock::from(isolate);
+      wrapper.template checkArgumentCount<Args...>(context, args,
+          [](uint i) { return TypeErrorContext::methodArgument(typeid(T), methodName, i); });
       if constexpr (isVoid<Ret>()) {
         (self.*method)(lock,
             wrapper.template unwrap<Args>(context, args, indexes,
@@ -287,6 +302,8 @@ struct MethodCallback<TypeWrapper,
       auto obj = args.This();
       auto& wrapper = TypeWrapper::from(isolate);
       auto& self = extractInternalPointer<T, isContext>(context, obj);
+      wrapper.template checkArgumentCount<Args...>(context, args,
+          [](uint i) { return TypeErrorContext::methodArgument(typeid(T), methodName, i); });
       if constexpr (isVoid<Ret>()) {
         (self.*method)(args,
             wrapper.template unwrap<Args>(context, args, indexes,
@@ -321,6 +338,81 @@ struct MethodCallback<TypeWrapper,
   }
 };
 
+// Implements the V8 fast API entry point for a method registered with JSG_FAST_METHOD. V8 calls
+// `invoke()` directly from optimized code when every argument at the call site already has the
+// type that the C signature expects, and falls back to MethodCallback otherwise, so the two must
+// behave identically.
+template <const char* methodName,
+    bool isContext,
+    typename T,
+    typename Method,
+    Method method,
+    typename Indexes>
+struct FastMethodCallback;
+
+template <const char* methodName,
+    bool isContext,
+    typename T,
+    typename U,
+    typename Ret,
+    typename... Args,
+    Ret (U::*method)(Args...),
+    size_t... indexes>
+struct FastMethodCallback<methodName,
+    isContext,
+    T,
+    Ret (U::*)(Args...),
+    method,
+    kj::_::Indexes<indexes...>> {
+  static constexpr bool supported =
+      isFastApiReturn<Ret>() && (FastApiParam<Args>::supported && ...);
+
+  static Ret invoke(v8::Local<v8::Object> receiver,
+      typename FastApiParam<Args>::Type... args,
+      v8::FastApiCallbackOptions& options) {
+    auto isolate = options.isolate;
+    return liftKjFast<Ret>(isolate, [&]() {
+      auto& self = extractInternalPointer<T, isContext>(isolate->GetCurrentContext(), receiver);
+      std::tuple<typename FastApiParam<Args>::Storage...> storage;
+      return (self.*method)(FastApiParam<Args>::get(isolate, args, std::get<indexes>(storage),
+          TypeErrorContext::methodArgument(typeid(T), methodName, indexes))...);
+    });
+  }
+};
+
+// Specialization for methods that take `Lock&` as their first parameter.
+template <const char* methodName,
+    bool isContext,
+    typename T,
+    typename U,
+    typename Ret,
+    typename... Args,
+    Ret (U::*method)(Lock&, Args...),
+    size_t... indexes>
+struct FastMethodCallback<methodName,
+    isContext,
+    T,
+    Ret (U::*)(Lock&, Args...),
+    method,
+    kj::_::Indexes<indexes...>> {
+  static constexpr bool supported =
+      isFastApiReturn<Ret>() && (FastApiParam<Args>::supported && ...);
+
+  static Ret invoke(v8::Local<v8::Object> receiver,
+      typename FastApiParam<Args>::Type... args,
+      v8::FastApiCallbackOptions& options) {
+    auto isolate = options.isolate;
+    return liftKjFast<Ret>(isolate, [&]() {
+      auto& self = extractInternalPointer<T, isContext>(isolate->GetCurrentContext(), receiver);
+      auto& lock = Lock::from(isolate);
+      std::tuple<typename FastApiParam<Args>::Storage...> storage;
+      return (self.*method)(lock,
+          FastApiParam<Args>::get(isolate, args, std::get<indexes>(storage),
+              TypeErrorContext::methodArgument(typeid(T), methodName, indexes))...);
+    });
+  }
+};
+
 // Implements the V8 callback function for calling a static method of the C++ class.
 //
 // This is separate from MethodCallback<> because we need to know the interface type, T, and it
@@ -356,6 +448,8 @@ struct StaticMethodCallback<TypeWrapper,
       auto isolate = args.GetIsolate();
       auto context = isolate->GetCurrentContext();
       auto& wrapper = TypeWrapper::from(isolate);
+      wrapper.template checkArgumentCount<Args...>(context, args,
+          [](uint i) { return TypeErrorContext::methodArgument(typeid(T), methodName, i); });
       if constexpr (isVoid<Ret>()) {
         (*method)(wrapper.template unwrap<Args>(context, args, indexes,
             TypeErrorContext::methodArgument(typeid(T), methodName, indexes))...);
@@ -388,6 +482,8 @@ struct StaticMethodCallback<TypeWrapper,
       auto context = isolate->GetCurrentContext();
       auto& wrapper = TypeWrapper::from(isolate);
       auto& lock = Lock::from(isolate);
+      wrapper.template checkArgumentCount<Args...>(context, args,
+          [](uint i) { return TypeErrorContext::methodArgument(typeid(T), methodName, i); });
       if constexpr (isVoid<Ret>()) {
         (*method)(lock,
             wrapper.template unwrap<Args>(context, args, indexes,
@@ -422,6 +518,8 @@ struct StaticMethodCallback<TypeWrapper,
       auto isolate = args.GetIsolate();
       auto context = isolate->GetCurrentContext();
       auto& wrapper = TypeWrapper::from(isolate);
+      wrapper.template checkArgumentCount<Args...>(context, args,
+          [](uint i) { return TypeErrorContext::methodArgument(typeid(T), methodName, i); });
       if constexpr (isVoid<Ret>()) {
         (*method)(args,
             wrapper.template unwrap<Args>(context, args, indexes,
@@ -963,6 +1061,21 @@ struct ResourceTypeBuilder {
             v8::Local<v8::Value>(), signature, 0, v8::ConstructorBehavior::kThrow));
   }
 
+  template <const char* name, typename Method, Method method>
+  inline void registerFastMethod() {
+    using Fast = FastMethodCallback<name, isContext, Self, Method, method, ArgumentIndexes<Method>>;
+    static_assert(Fast::supported,
+        "JSG_FAST_METHOD only supports bool, double, uint32_t and kj::Array<const kj::byte> "
+        "parameters, and void, bool, int32_t, uint32_t or double return values.");
+    static const v8::CFunction cFunction = v8::CFunction::Make(&Fast::invoke);
+    prototype->Set(isolate, name,
+        v8::FunctionTemplate::New(isolate,
+            &MethodCallback<TypeWrapper, name, isContext, Self, Method, method,
+                ArgumentIndexes<Method>>::callback,
+            v8::Local<v8::Value>(), signature, 0, v8::ConstructorBehavior::kThrow,
+            v8::SideEffectType::kHasSideEffect, &cFunction));
+  }
+
   template <const char* name, typename Method, Method method>
   inline void registerStaticMethod() {
     // Notably, we specify an empty signature because a static method invocation will have no holder
@@ -1149,7 +1262,11 @@ struct ResourceTypeBuilder {
     static_assert(
         hasGetTemplate, "Type must be listed in JSG_DECLARE_ISOLATE_TYPE to be declared nested.");
 
-    prototype->Set(isolate, name, typeWrapper.getTemplate(isolate, (Type*)nullptr));
+    // The constructor is materialized the first time the property is read, so that a global
+    // declaring many nested types doesn't have to build all of their templates up front. Until
+    // then, the property looks like the plain data property it becomes.
+    prototype->SetLazyDataProperty(
+        v8StrIntern(isolate, name), &NestedTypeCallback<Type>::callback);
   }
 
   inline void registerTypeScriptRoot() { /* only needed for RTTI */ }
@@ -1163,6 +1280,18 @@ struct ResourceTypeBuilder {
   inline void registerJsBundle(Bundle::Reader bundle) { /* handled at the second stage */ }
 
  private:
+  template <typename Type>
+  struct NestedTypeCallback {
+    static void callback(v8::Local<v8::Name>, const v8::PropertyCallbackInfo<v8::Value>& info) {
+      liftKj(info, [&]() {
+        auto isolate = info.GetIsolate();
+        auto& wrapper = TypeWrapper::from(isolate);
+        return check(
+            wrapper.getTemplate(isolate, (Type*)nullptr)->GetFunction(isolate->GetCurrentContext()));
+      });
+    }
+  };
+
   TypeWrapper& typeWrapper;
   v8::Isolate* isolate;
   v8::Local<v8::FunctionTemplate> constructor;
@@ -1227,6 +1356,9 @@ struct JsSetup {
   template <const char* name, typename Method, Method method>
   inline void registerMethod() {}
 
+  template <const char* name, typename Method, Method method>
+  inline void registerFastMethod() {}
+
   template <const char* name, typename Method, Method method>
   inline void registerStaticMethod() {}
 
@@ -1287,6 +1419,24 @@ struct NewContextOptions {
   kj::Maybe<ModuleRegistryBase&> newModuleRegistry = kj::none;
 };
 
+// Times the creation of a resource type's FunctionTemplate and reports it to the isolate's
+// TemplateObserver. Scopes nest, as creating one template creates the templates of its nested
+// types, and each reports only its own share of the time.
+class TemplateCreationScope {
+ public:
+  TemplateCreationScope(v8::Isolate* isolate, const std::type_info& type);
+  ~TemplateCreationScope() noexcept(false);
+  KJ_DISALLOW_COPY_AND_MOVE(TemplateCreationScope);
+
+ private:
+  v8::Isolate* isolate;
+  const std::type_info& type;
+  TemplateCreationScope* parent;
+  kj::TimePoint start;
+  kj::Duration nested = 0 * kj::SECONDS;
+  kj::UnwindDetector unwindDetector;
+};
+
 // TypeWrapper mixin for resource types (application-defined C++ classes declared with a
 // JSG_RESOURCE_TYPE block).
 template <typename TypeWrapper, typename T>
@@ -1500,6 +1650,7 @@ class ResourceWrapper {
   v8::Local<v8::FunctionTemplate> getTemplate(v8::Isolate* isolate, T*) {
     v8::Global<v8::FunctionTemplate>& slot = isContext ? contextConstructor : memoizedConstructor;
     if (slot.IsEmpty()) {
+      TemplateCreationScope creationScope(isolate, typeid(T));
       auto result = makeConstructor<isContext>(isolate);
       slot.Reset(isolate, result);
       return result;
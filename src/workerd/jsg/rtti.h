@@ -580,6 +580,11 @@ struct MemberCounter {
     ++members;
   }
 
+  template <const char* name, typename Method, Method method>
+  inline void registerFastMethod() {
+    registerMethod<name, Method, method>();
+  }
+
   template <typename Method, Method method>
   inline void registerCallable() { /* not a member */ }
 
@@ -804,6 +809,11 @@ struct MembersBuilder {
     TupleRttiBuilder<Configuration, Args>::build(method.initArgs(std::tuple_size_v<Args>), rtti);
   }
 
+  template <const char* name, typename Method, Method method>
+  inline void registerFastMethod() {
+    registerMethod<name, Method, method>();
+  }
+
   template <typename Method, Method method>
   inline void registerCallable() {
     auto func = structure.initCallable();
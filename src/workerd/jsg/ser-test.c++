@@ -150,12 +150,24 @@ struct SerTestContext: public ContextGlobalObject {
     return result;
   }
 
+  uint32_t serializedSizeWithLimit(Lock& js, JsValue in, uint32_t maxSize) {
+    Serializer ser(js, Serializer::Options{.maxSize = maxSize});
+    ser.write(js, in);
+    return ser.release().data.size();
+  }
+
+  JsValue clone(Lock& js, JsValue in) {
+    return jsg::structuredClone(js, in);
+  }
+
   JSG_RESOURCE_TYPE(SerTestContext) {
     JSG_NESTED_TYPE(Foo);
     JSG_NESTED_TYPE(Bar);
     JSG_NESTED_TYPE(Baz);
     JSG_NESTED_TYPE(Qux);
     JSG_METHOD(roundTrip);
+    JSG_METHOD(serializedSizeWithLimit);
+    JSG_METHOD(clone);
   }
 };
 JSG_DECLARE_ISOLATE_TYPE(SerTestIsolate,
@@ -253,6 +265,11 @@ KJ_TEST("serialization") {
   e.expectEval("roundTrip(new Baz(true)).text", "throws", "Error: throw from serialize()");
   e.expectEval("roundTrip(new Baz(false)).text", "throws", "Error: throw from deserialize()");
 
+  // Test aborting serialization once the output outgrows the size limit.
+  e.expectEval("serializedSizeWithLimit('x'.repeat(100), 4096) < 4096", "boolean", "true");
+  e.expectEval("serializedSizeWithLimit('x'.repeat(100000), 4096)", "throws",
+      "Error: Serialized data exceeded the maximum size of 4096 bytes.");
+
   // Let's set up the "new version" of the code.
   Evaluator<SerTestContextV2, SerTestIsolateV2> e2(v8System);
 
@@ -284,5 +301,46 @@ KJ_TEST("serialization") {
       "number", "321");
 }
 
+KJ_TEST("structuredClone") {
+  Evaluator<SerTestContext, SerTestIsolate> e(v8System);
+
+  // Plain data is copied directly, preserving key order, shared references and cycles.
+  e.expectEval("JSON.stringify(clone({b: 1, a: [1, 'x', null, -0], 2: true}))", "string",
+      "{\"2\":true,\"b\":1,\"a\":[1,\"x\",null,0]}");
+  e.expectEval("let cyclic = {a: 1}; cyclic.self = cyclic;\n"
+               "let cyclicCopy = clone(cyclic);\n"
+               "cyclicCopy !== cyclic && cyclicCopy.self === cyclicCopy && cyclicCopy.a === 1",
+      "boolean", "true");
+  e.expectEval("let shared = {};\n"
+               "let sharedCopy = clone({x: shared, y: [shared]});\n"
+               "sharedCopy.x !== shared && sharedCopy.x === sharedCopy.y[0]",
+      "boolean", "true");
+  e.expectEval("let hidden = {a: 1}; Object.defineProperty(hidden, 'b', {value: 2});\n"
+               "Object.keys(clone(hidden)).join()",
+      "string", "a");
+  e.expectEval("clone(new Date(1234)).getTime()", "number", "1234");
+
+  // Views share a single copy of their underlying buffer.
+  e.expectEval("let buffer = new ArrayBuffer(8);\n"
+               "let views = clone([new Uint8Array(buffer, 2, 4), new DataView(buffer)]);\n"
+               "views[0].buffer === views[1].buffer && views[0].buffer !== buffer &&\n"
+               "    views[0].byteOffset === 2 && views[0].length === 4",
+      "boolean", "true");
+  e.expectEval("let bytes = new Uint8Array([1, 2, 3]);\n"
+               "let bytesCopy = clone(bytes); bytes[0] = 9; bytesCopy[0]",
+      "number", "1");
+
+  // Anything else falls back to the serializer.
+  e.expectEval("clone({m: new Map([[1, 2]])}).m.get(1)", "number", "2");
+  e.expectEval("1 in clone([1, , 3])", "boolean", "false");
+  e.expectEval("class A { constructor() { this.x = 1; } }\n"
+               "let instanceCopy = clone(new A());\n"
+               "Object.getPrototypeOf(instanceCopy) === Object.prototype && instanceCopy.x === 1",
+      "boolean", "true");
+  e.expectEval("let mixed = {}; mixed.map = new Map([['self', mixed]]);\n"
+               "let mixedCopy = clone(mixed); mixedCopy.map.get('self') === mixedCopy",
+      "boolean", "true");
+}
+
 }  // namespace
 }  // namespace workerd::jsg::test
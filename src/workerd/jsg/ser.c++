@@ -6,6 +6,8 @@
 
 #include "setup.h"
 
+#include <kj/table.h>
+
 namespace workerd::jsg {
 
 void Serializer::ExternalHandler::serializeFunction(
@@ -20,13 +22,14 @@ void Serializer::ExternalHandler::serializeProxy(
 
 Serializer::Serializer(Lock& js, Options options)
     : externalHandler(options.externalHandler),
+      maxSize(options.maxSize),
       treatClassInstancesAsPlainObjects(options.treatClassInstancesAsPlainObjects),
       ser(js.v8Isolate, this) {
 #ifdef KJ_DEBUG
   kj::requireOnStack(this, "jsg::Serializer must be allocated on the stack");
 #endif
   if (!treatClassInstancesAsPlainObjects) {
-    prototypeOfObject = js.obj().getPrototype(js);
+    prototypeOfObject = js.getObjectPrototype();
   }
   if (externalHandler != kj::none) {
     // If we have an ExternalHandler, we'll ask it to serialize host objects.
@@ -57,6 +60,27 @@ v8::Maybe<uint32_t> Serializer::GetSharedArrayBufferId(
   return v8::Just(n);
 }
 
+void* Serializer::ReallocateBufferMemory(void* oldBuffer, size_t size, size_t* actualSize) {
+  KJ_IF_SOME(max, maxSize) {
+    // V8 only asks for more memory once the data no longer fits in the current buffer, so once
+    // the buffer is already at the limit we know the data is over it. Returning null makes V8
+    // abandon serialization and report the failure through ThrowDataCloneError().
+    if (bufferCapacity >= max) {
+      maxSizeExceeded = true;
+      return nullptr;
+    }
+  }
+
+  // Same as the default implementation. The buffer is eventually freed by
+  // SERIALIZED_BUFFER_DISPOSER or by FreeBufferMemory(), both of which use free().
+  void* result = realloc(oldBuffer, size);
+  if (result != nullptr) {
+    bufferCapacity = size;
+    *actualSize = size;
+  }
+  return result;
+}
+
 void Serializer::throwDataCloneErrorForObject(jsg::Lock& js, v8::Local<v8::Object> obj) {
   // The default error that V8 would generate is "#<TypeName> could not be cloned." -- for some
   // reason, it surrounds the type name in "#<>", which seems bizarre? Let's generate a better
@@ -72,6 +96,13 @@ void Serializer::ThrowDataCloneError(v8::Local<v8::String> message) {
   auto isolate = v8::Isolate::GetCurrent();
   try {
     Lock& js = Lock::from(isolate);
+    if (maxSizeExceeded) {
+      // V8 reports this as running out of memory; say what actually happened instead.
+      isolate->ThrowException(js.error(
+          kj::str("Serialized data exceeded the maximum size of ", KJ_ASSERT_NONNULL(maxSize),
+              " bytes.")));
+      return;
+    }
     auto exception = js.domException(kj::str("DataCloneError"), kj::str(message));
     isolate->ThrowException(KJ_ASSERT_NONNULL(exception.tryGetHandle(js)));
   } catch (JsExceptionThrown&) {
@@ -311,8 +342,219 @@ void SerializedBufferDisposer::disposeImpl(void* firstElement,
   free(firstElement);
 }
 
+namespace {
+
+// Copies a value graph made only of primitives, plain objects, dense arrays, Dates, ArrayBuffers
+// and ArrayBuffer views directly into new objects, skipping the round trip through
+// v8::ValueSerializer and its intermediate buffer. The copy follows the same rules as the
+// serializer: only own enumerable string-keyed properties are copied, prototypes are not, and
+// shared references and cycles are preserved.
+//
+// clone() returns kj::none as soon as it finds anything else (Maps, Errors, host objects,
+// class instances, holey arrays, ...), in which case the caller discards the partial copy and
+// goes through the serializer instead. Note that accessor properties read before that point
+// will then be read a second time; own accessors on otherwise cloneable data are rare enough
+// that we accept this.
+class FastCloner {
+public:
+  explicit FastCloner(Lock& js)
+      : isolate(js.v8Isolate),
+        context(js.v8Context()),
+        prototypeOfObject(js.getObjectPrototype()) {}
+
+  kj::Maybe<v8::Local<v8::Value>> clone(v8::Local<v8::Value> value, uint depth = 0) {
+    if (!value->IsObject()) {
+      // Primitives are immutable so they can be shared with the copy. Symbols can't be cloned;
+      // let the serializer produce the error.
+      if (value->IsSymbol()) return kj::none;
+      return value;
+    }
+
+    auto obj = value.As<v8::Object>();
+    KJ_IF_SOME(entry, seen.find(obj)) {
+      return entry.copy;
+    }
+    if (depth >= MAX_DEPTH) return kj::none;
+
+    if (obj->IsArray()) {
+      return cloneArray(obj.As<v8::Array>(), depth);
+    } else if (obj->IsDate()) {
+      auto copy = check(v8::Date::New(context, obj.As<v8::Date>()->ValueOf()));
+      return remember(obj, copy);
+    } else if (obj->IsArrayBuffer()) {
+      return cloneArrayBuffer(obj.As<v8::ArrayBuffer>());
+    } else if (obj->IsArrayBufferView()) {
+      return cloneView(obj.As<v8::ArrayBufferView>(), depth);
+    } else if (isPlainObject(obj)) {
+      auto copy = v8::Object::New(isolate);
+      remember(obj, copy);
+      return copyProperties(obj, copy, depth);
+    } else {
+      return kj::none;
+    }
+  }
+
+private:
+  // Deeper graphs are left to the serializer rather than risking the native stack.
+  static constexpr uint MAX_DEPTH = 64;
+
+  struct Entry {
+    v8::Local<v8::Object> original;
+    v8::Local<v8::Value> copy;
+  };
+
+  struct EntryCallbacks {
+    v8::Local<v8::Object> keyForRow(const Entry& entry) const {
+      return entry.original;
+    }
+    bool matches(const Entry& entry, v8::Local<v8::Object> key) const {
+      return entry.original == key;
+    }
+    uint hashCode(v8::Local<v8::Object> key) const {
+      return key->GetIdentityHash();
+    }
+  };
+
+  v8::Isolate* isolate;
+  v8::Local<v8::Context> context;
+  v8::Local<v8::Value> prototypeOfObject;
+
+  // Maps each object already visited to its copy.
+  kj::Table<Entry, kj::HashIndex<EntryCallbacks>> seen;
+
+  v8::Local<v8::Value> remember(v8::Local<v8::Object> original, v8::Local<v8::Value> copy) {
+    seen.insert(Entry{.original = original, .copy = copy});
+    return copy;
+  }
+
+  bool isPlainObject(v8::Local<v8::Object> obj) {
+    // Exotic built-ins can be given Object.prototype with Object.setPrototypeOf(), so the
+    // prototype check alone isn't enough.
+    return obj->GetPrototypeV2() == prototypeOfObject && obj->InternalFieldCount() == 0 &&
+        !obj->IsFunction() && !obj->IsProxy() && !obj->IsArgumentsObject() &&
+        !obj->IsBooleanObject() && !obj->IsNumberObject() && !obj->IsStringObject() &&
+        !obj->IsBigIntObject() && !obj->IsSymbolObject() && !obj->IsNativeError() &&
+        !obj->IsRegExp() && !obj->IsMap() && !obj->IsSet() && !obj->IsMapIterator() &&
+        !obj->IsSetIterator() && !obj->IsWeakMap() && !obj->IsWeakSet() && !obj->IsWeakRef() &&
+        !obj->IsPromise() && !obj->IsGeneratorObject() && !obj->IsSharedArrayBuffer() &&
+        !obj->IsModuleNamespaceObject() && !obj->IsWasmMemoryObject() &&
+        !obj->IsWasmModuleObject() && !obj->IsExternal();
+  }
+
+  v8::Local<v8::Array> ownKeys(v8::Local<v8::Object> obj) {
+    return check(obj->GetOwnPropertyNames(context,
+        static_cast<v8::PropertyFilter>(v8::ONLY_ENUMERABLE | v8::SKIP_SYMBOLS),
+        v8::KeyConversionMode::kKeepNumbers));
+  }
+
+  kj::Maybe<v8::Local<v8::Value>> copyProperties(
+      v8::Local<v8::Object> obj, v8::Local<v8::Object> copy, uint depth) {
+    return copyProperties(obj, ownKeys(obj), copy, depth);
+  }
+
+  kj::Maybe<v8::Local<v8::Value>> copyProperties(v8::Local<v8::Object> obj,
+      v8::Local<v8::Array> keys,
+      v8::Local<v8::Object> copy,
+      uint depth) {
+    for (uint32_t i = 0; i < keys->Length(); i++) {
+      auto key = check(keys->Get(context, i));
+      if (key->IsUint32()) {
+        uint32_t index = key.As<v8::Uint32>()->Value();
+        auto original = check(obj->Get(context, index));
+        auto value = KJ_UNWRAP_OR(clone(original, depth + 1), return kj::none);
+        check(copy->CreateDataProperty(context, index, value));
+      } else {
+        auto name = key.As<v8::Name>();
+        auto original = check(obj->Get(context, name));
+        auto value = KJ_UNWRAP_OR(clone(original, depth + 1), return kj::none);
+        check(copy->CreateDataProperty(context, name, value));
+      }
+    }
+    return copy.As<v8::Value>();
+  }
+
+  kj::Maybe<v8::Local<v8::Value>> cloneArray(v8::Local<v8::Array> array, uint depth) {
+    // Holey and sparse arrays are left to the serializer, which preserves their holes. Index keys
+    // come first in the key list, so the array is dense iff it has an index key for every slot.
+    auto keys = ownKeys(array);
+    uint32_t length = array->Length();
+    if (keys->Length() < length) return kj::none;
+    if (length > 0) {
+      auto last = check(keys->Get(context, length - 1));
+      if (!last->IsUint32() || last.As<v8::Uint32>()->Value() != length - 1) return kj::none;
+    }
+
+    auto copy = v8::Array::New(isolate, length);
+    remember(array, copy);
+    return copyProperties(array, keys, copy, depth);
+  }
+
+  kj::Maybe<v8::Local<v8::Value>> cloneArrayBuffer(v8::Local<v8::ArrayBuffer> buffer) {
+    // Detached and resizable buffers have their own serializer semantics (the former is an
+    // error); don't try to match them here.
+    if (buffer->WasDetached()) return kj::none;
+    auto backing = buffer->GetBackingStore();
+    if (backing->IsResizableByUserJavaScript()) return kj::none;
+
+    size_t size = buffer->ByteLength();
+    auto copy = v8::ArrayBuffer::New(isolate, size);
+    if (size > 0) {
+      memcpy(copy->GetBackingStore()->Data(), backing->Data(), size);
+    }
+    return remember(buffer, copy);
+  }
+
+  kj::Maybe<v8::Local<v8::Value>> cloneView(v8::Local<v8::ArrayBufferView> view, uint depth) {
+    // Like the serializer, copy the whole underlying buffer (shared with any other views on it)
+    // and then recreate the view over the copy.
+    auto buffer = view->Buffer();
+    auto copiedBuffer = KJ_UNWRAP_OR(clone(buffer, depth + 1), return kj::none);
+    auto copy = KJ_UNWRAP_OR(newView(view, copiedBuffer.As<v8::ArrayBuffer>()), return kj::none);
+    return remember(view, copy);
+  }
+
+  kj::Maybe<v8::Local<v8::Value>> newView(
+      v8::Local<v8::ArrayBufferView> view, v8::Local<v8::ArrayBuffer> buffer) {
+    size_t offset = view->ByteOffset();
+    if (view->IsDataView()) {
+      return v8::DataView::New(buffer, offset, view->ByteLength()).As<v8::Value>();
+    }
+
+    size_t length = view.As<v8::TypedArray>()->Length();
+#define V(Type)                                                                                    \
+  if (view->Is##Type()) return v8::Type::New(buffer, offset, length).As<v8::Value>();
+    V(Uint8Array)
+    V(Uint8ClampedArray)
+    V(Int8Array)
+    V(Uint16Array)
+    V(Int16Array)
+    V(Uint32Array)
+    V(Int32Array)
+    V(Float32Array)
+    V(Float64Array)
+    V(BigInt64Array)
+    V(BigUint64Array)
+#undef V
+    // Any typed array kind not listed above goes through the serializer.
+    return kj::none;
+  }
+};
+
+}  // namespace
+
 JsValue structuredClone(
     Lock& js, const JsValue& value, kj::Maybe<kj::Array<JsValue>> maybeTransfer) {
+  // Transfers detach their sources, which only the serializer knows how to do.
+  bool hasTransfers = false;
+  KJ_IF_SOME(transfers, maybeTransfer) {
+    hasTransfers = transfers.size() > 0;
+  }
+  if (!hasTransfers) {
+    KJ_IF_SOME(copy, FastCloner(js).clone(value)) {
+      return JsValue(copy);
+    }
+  }
+
   Serializer ser(js);
   KJ_IF_SOME(transfers, maybeTransfer) {
     for (auto& item: transfers) {
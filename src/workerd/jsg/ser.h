@@ -118,6 +118,13 @@ class Serializer final: v8::ValueSerializer::Delegate {
     // ExternalHandler, if any. Typically this would be allocated on the stack just before the
     // Serializer.
     kj::Maybe<ExternalHandler&> externalHandler;
+
+    // If set, write() throws as soon as the output buffer has to grow past this many bytes, rather
+    // than serializing the whole value only for the caller to reject it afterwards. Since the
+    // buffer grows geometrically the output may still end up somewhat larger than `maxSize`
+    // without tripping this, so callers that need an exact bound must still check the size of
+    // the released data.
+    kj::Maybe<size_t> maxSize;
   };
 
   struct Released {
@@ -192,8 +199,14 @@ class Serializer final: v8::ValueSerializer::Delegate {
 
   v8::Maybe<uint32_t> GetSharedArrayBufferId(
       v8::Isolate* isolate, v8::Local<v8::SharedArrayBuffer> sab) override;
+  void* ReallocateBufferMemory(void* oldBuffer, size_t size, size_t* actualSize) override;
 
   kj::Maybe<ExternalHandler&> externalHandler;
+  kj::Maybe<size_t> maxSize;
+
+  // Current capacity of the output buffer, as handed out by ReallocateBufferMemory().
+  size_t bufferCapacity = 0;
+  bool maxSizeExceeded = false;
 
   kj::Vector<JsValue> sharedArrayBuffers;
   kj::Vector<JsValue> arrayBuffers;
@@ -58,22 +58,99 @@ struct ConfigContext: public Object, public ContextGlobal {
 JSG_DECLARE_ISOLATE_TYPE(
     ConfigIsolate, ConfigContext, ConfigContext::Nested, ConfigContext::OtherNested);
 
+// Nested types are set up the first time the global scope's property is read.
+void readNestedType(ConfigIsolate::Lock& lock) {
+  JSG_WITHIN_CONTEXT_SCOPE(lock, lock.newContext<ConfigContext>().getHandle(lock),
+      [&](jsg::Lock& js) {
+    auto context = js.v8Context();
+    check(context->Global()->Get(context, v8StrIntern(js.v8Isolate, "Nested")));
+  });
+}
+
 KJ_TEST("configuration values reach nested type declarations") {
   {
     ConfigIsolate isolate(v8System, 123, kj::heap<IsolateObserver>());
-    isolate.runInLockScope([&](ConfigIsolate::Lock& lock) {
-      jsg::Lock& js = lock;
-      js.withinHandleScope([&] { lock.newContext<ConfigContext>().getHandle(lock); });
-    });
+    isolate.runInLockScope([&](ConfigIsolate::Lock& lock) { readNestedType(lock); });
   }
   {
     KJ_EXPECT_LOG(ERROR, "failed: expected configuration == 123");
     ConfigIsolate isolate(v8System, 456, kj::heap<IsolateObserver>());
-    isolate.runInLockScope([&](ConfigIsolate::Lock& lock) {
-      jsg::Lock& js = lock;
-      js.withinHandleScope([&] { lock.newContext<ConfigContext>().getHandle(lock); });
-    });
+    isolate.runInLockScope([&](ConfigIsolate::Lock& lock) { readNestedType(lock); });
+  }
+}
+
+struct TemplateCountingObserver final: public IsolateObserver {
+  void onResourceTemplateCreated(
+      v8::Isolate* isolate, const std::type_info& type, kj::Duration duration) const override {
+    KJ_EXPECT(duration >= 0 * kj::SECONDS);
+    ++counts.findOrCreate(&type, [&]() -> decltype(counts)::Entry { return {&type, 0}; });
+  }
+  uint countFor(const std::type_info& type) const {
+    return counts.find(&type).orDefault(0);
+  }
+
+  mutable kj::HashMap<const std::type_info*, uint> counts;
+};
+
+KJ_TEST("resource templates are created once per type per isolate, on first use") {
+  auto ownObserver = kj::heap<TemplateCountingObserver>();
+  auto& observer = *ownObserver;
+  ConfigIsolate isolate(v8System, 123, kj::mv(ownObserver));
+  isolate.runInLockScope([&](ConfigIsolate::Lock& lock) {
+    jsg::Lock& js = lock;
+    js.withinHandleScope([&] { lock.newContext<ConfigContext>().getHandle(lock); });
+    KJ_EXPECT(observer.countFor(typeid(ConfigContext)) == 1);
+    KJ_EXPECT(observer.countFor(typeid(ConfigContext::Nested)) == 0);
+
+    readNestedType(lock);
+    readNestedType(lock);
+  });
+
+  KJ_EXPECT(observer.countFor(typeid(ConfigContext)) == 1);
+  KJ_EXPECT(observer.countFor(typeid(ConfigContext::Nested)) == 1);
+  KJ_EXPECT(observer.countFor(typeid(ConfigContext::OtherNested)) == 0);
+}
+
+// ========================================================================================
+
+struct CountingIdleTask final: public v8::IdleTask {
+  explicit CountingIdleTask(uint& count): count(count) {}
+  void Run(double deadlineInSeconds) override {
+    ++count;
   }
+  uint& count;
+};
+
+KJ_TEST("V8PlatformWrapper queues idle tasks until asked to run them") {
+  auto inner = defaultPlatform(1);
+  V8PlatformWrapper platform(*inner);
+
+  EvalIsolate isolate(v8System, kj::heap<IsolateObserver>());
+  isolate.runInLockScope([&](EvalIsolate::Lock& lock) {
+    auto v8Isolate = lock.v8Isolate;
+    KJ_EXPECT(platform.IdleTasksEnabled(v8Isolate));
+
+    auto runner = platform.GetForegroundTaskRunner(v8Isolate, v8::TaskPriority::kUserBlocking);
+    KJ_EXPECT(runner->IdleTasksEnabled());
+
+    uint count = 0;
+    runner->PostIdleTask(std::make_unique<CountingIdleTask>(count));
+    runner->PostIdleTask(std::make_unique<CountingIdleTask>(count));
+    KJ_EXPECT(count == 0);
+
+    // A zero budget runs nothing.
+    platform.runIdleTasks(v8Isolate, 0 * kj::SECONDS);
+    KJ_EXPECT(count == 0);
+
+    platform.runIdleTasks(v8Isolate, 10 * kj::SECONDS);
+    KJ_EXPECT(count == 2);
+
+    // Tasks still queued when the isolate goes away are dropped.
+    runner->PostIdleTask(std::make_unique<CountingIdleTask>(count));
+    platform.disposeIsolate(v8Isolate);
+    platform.runIdleTasks(v8Isolate, 10 * kj::SECONDS);
+    KJ_EXPECT(count == 2);
+  });
 }
 
 }  // namespace
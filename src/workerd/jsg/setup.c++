@@ -59,7 +59,7 @@ const PlatformDisposer PlatformDisposer::instance{};
 kj::Own<v8::Platform> defaultPlatform(uint backgroundThreadCount) {
   return kj::Own<v8::Platform>(
       v8::platform::NewDefaultPlatform(backgroundThreadCount,  // default thread pool size
-          v8::platform::IdleTaskSupport::kDisabled,            // TODO(perf): investigate enabling
+          v8::platform::IdleTaskSupport::kDisabled,            // V8PlatformWrapper queues them
           v8::platform::InProcessStackDumping::kDisabled,      // KJ's stack traces are better
           nullptr)                                             // default TracingController
           .release(),
@@ -200,6 +200,10 @@ void IsolateBase::terminateExecution() const {
   ptr->TerminateExecution();
 }
 
+void IsolateBase::runIdleTasks(kj::Badge<Lock>, kj::Duration budget) {
+  const_cast<V8PlatformWrapper&>(system.platformWrapper).runIdleTasks(ptr, budget);
+}
+
 void IsolateBase::clearDestructionQueue() {
   // Safe to destroy the popped batch outside of the lock because the lock is only actually used to
   // guard the push buffer.
@@ -314,6 +318,13 @@ static v8::Isolate* newIsolate(v8::Isolate::CreateParams&& params, v8::CppHeap*
     // TODO(soon): submit a bug report/patch to v8.
     params.cpp_heap = cppHeap;
 
+    // TODO(perf): Boot from a startup snapshot (`params.snapshot_blob`) containing an initialized
+    //   global scope and evaluated built-in modules, which `workerd compile` could embed in the
+    //   binary. This needs every C++ callback that jsg installs in templates to be registered in
+    //   `params.external_references`, and internal fields of wrapped objects to be serialized
+    //   through v8::SerializeInternalFieldsCallback, neither of which jsg supports yet. Until
+    //   then, built-in modules rely on CompileCache to skip recompilation.
+
     if (params.array_buffer_allocator == nullptr &&
         params.array_buffer_allocator_shared == nullptr) {
       params.array_buffer_allocator_shared = std::shared_ptr<v8::ArrayBuffer::Allocator>(
@@ -396,7 +407,7 @@ IsolateBase::~IsolateBase() noexcept(false) {
   jsg::runInV8Stack([&](jsg::V8StackScope& stackScope) {
     ptr->Dispose();
     cppHeap.reset();
-    ;
+    const_cast<V8PlatformWrapper&>(system.platformWrapper).disposeIsolate(ptr);
   });
 }
 
@@ -92,6 +92,9 @@ class IsolateBase {
   // be thrown. Safe to call across threads, without holding the lock.
   void terminateExecution() const;
 
+  // See Lock::runIdleTasks().
+  void runIdleTasks(kj::Badge<Lock>, kj::Duration budget);
+
   using Logger = Lock::Logger;
   inline void setLoggerCallback(kj::Badge<Lock>, kj::Function<Logger>&& logger) {
     maybeLogger = kj::mv(logger);
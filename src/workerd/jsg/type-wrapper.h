@@ -494,8 +494,63 @@ class TypeWrapper: public DynamicResourceTypeMap<Self>,
     }
   }
 
+  // Whether a parameter of type U must have a corresponding argument, i.e. whether calling the
+  // function with too few arguments to reach it is a TypeError rather than `undefined`. Web IDL
+  // nullable types (Maybe<T>) can be initialized from `undefined`, so without this check
+  // `f(Maybe<T>)` could be called like `f()`.
+  template <typename U>
+  static constexpr bool isRequiredParameter() {
+    using V = kj::Decay<U>;
+    return !kj::isSameType<V, Varargs>() && !isArguments<V>() && !isValueLessParameter<Self, V> &&
+        !webidl::isOptional<V> && !kj::isSameType<V, Unimplemented>();
+  }
+
+  // The number of arguments needed to reach the last required parameter.
+  template <typename... Args>
+  static constexpr size_t requiredArgumentCount() {
+    size_t count = 0;
+    size_t index = 0;
+    ((++index, count = isRequiredParameter<Args>() ? index : count), ...);
+    return count;
+  }
+
+  // Checks that the call passed an argument for every required parameter, throwing the same
+  // TypeError as unwrapping `undefined` into the first one that is missing. Callbacks call this
+  // once, before unwrapping their arguments with the unwrap() overload below, so that the common
+  // case costs a single comparison (or nothing, for functions without required parameters).
+  // `errorContext` maps a parameter index to its TypeErrorContext.
+  template <typename... Args, typename ErrorContextFunc>
+  void checkArgumentCount(v8::Local<v8::Context> context,
+      const v8::FunctionCallbackInfo<v8::Value>& args,
+      ErrorContextFunc&& errorContext) {
+    constexpr size_t required = requiredArgumentCount<Args...>();
+    if constexpr (required > 0) {
+      size_t length = args.Length();
+      if (KJ_UNLIKELY(length < required)) {
+        uint index = 0;
+        (throwIfMissingArgument<Args>(context, index++, length, errorContext), ...);
+        KJ_UNREACHABLE;
+      }
+    }
+  }
+
+  template <typename U, typename ErrorContextFunc>
+  void throwIfMissingArgument(v8::Local<v8::Context> context,
+      uint index,
+      size_t length,
+      ErrorContextFunc& errorContext) {
+    if constexpr (isRequiredParameter<U>()) {
+      if (index >= length) {
+        throwTypeError(context->GetIsolate(), errorContext(index),
+            TypeWrapper::getName((kj::Decay<U>*)nullptr));
+      }
+    }
+  }
+
   // Helper for unwrapping function/method arguments correctly. Specifically, we need logic to
   // handle the case where the user passes in fewer arguments than the function has parameters.
+  // The caller must already have called checkArgumentCount(), so a parameter index past the end
+  // of the arguments always belongs to a parameter that accepts `undefined`.
   template <typename U>
   auto unwrap(v8::Local<v8::Context> context,
       const v8::FunctionCallbackInfo<v8::Value>& args,
@@ -517,21 +572,7 @@ class TypeWrapper: public DynamicResourceTypeMap<Self>,
       // C++ parameters which don't unwrap JS values, like v8::Isolate* and TypeHandlers.
       return unwrap(context, (V*)nullptr);
     } else {
-      if constexpr (!webidl::isOptional<V> && !kj::isSameType<V, Unimplemented>()) {
-        // TODO(perf): Better to perform this parameter index check once, at the unwrap<U>() call
-        //   site. We'll need function length properties implemented correctly for that, most
-        //   likely -- see EW-386.
-        if (parameterIndex >= args.Length()) {
-          // We're unwrapping a nonexistent argument into a required parameter. Since Web IDL
-          // nullable types (Maybe<T>) can be initialized from `undefined`, we need to explicitly
-          // throw here, or else `f(Maybe<T>)` could be called like `f()`.
-          throwTypeError(context->GetIsolate(), errorContext, TypeWrapper::getName((V*)nullptr));
-        }
-      }
-
-      // If we get here, we're either unwrapping into an optional or unimplemented parameter, in
-      // which cases we're fine with nonexistent arguments implying `undefined`, or we have an
-      // argument at this parameter index.
+      // Past the end of the arguments, `args[parameterIndex]` is `undefined`.
       return unwrap<U>(context, args[parameterIndex], errorContext);
     }
   }
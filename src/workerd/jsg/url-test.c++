@@ -194,6 +194,13 @@ void test(kj::StringPtr input, kj::Maybe<kj::StringPtr> base, kj::StringPtr href
   KJ_ASSERT(Url::canParse(input, base));
   auto url = KJ_ASSERT_NONNULL(Url::tryParse(input, base));
   KJ_ASSERT(url.getHref() == href);
+
+  // Resolving against an already parsed base must give the same result.
+  KJ_IF_SOME(b, base) {
+    auto baseUrl = KJ_ASSERT_NONNULL(Url::tryParse(b));
+    auto resolved = KJ_ASSERT_NONNULL(baseUrl.tryResolve(input));
+    KJ_ASSERT(resolved.getHref() == href);
+  }
 }
 
 KJ_TEST("Valid Urls") {
@@ -867,6 +874,29 @@ KJ_TEST("Search params (2)") {
   KJ_ASSERT(kj::str(params) == "a=z");
 }
 
+KJ_TEST("Search params (3)") {
+  // Lookups answered from the unparsed query must agree with the parsed pairs.
+  auto params = KJ_ASSERT_NONNULL(UrlSearchParams::tryParse("?a=1&&b=&c&a=2&d=x+y&e%20f=3"_kj));
+  KJ_ASSERT(KJ_ASSERT_NONNULL(params.get("a"_kj)) == "1"_kj);
+  KJ_ASSERT(KJ_ASSERT_NONNULL(params.get("b"_kj)) == ""_kj);
+  KJ_ASSERT(KJ_ASSERT_NONNULL(params.get("c"_kj)) == ""_kj);
+  KJ_ASSERT(params.has("a"_kj, kj::Maybe("2"_kj)));
+  KJ_ASSERT(!params.has("a"_kj, kj::Maybe("3"_kj)));
+  KJ_ASSERT(params.getAll("a"_kj).size() == 2);
+
+  // These need decoding: "d" has an encoded value, and the last name is encoded.
+  KJ_ASSERT(KJ_ASSERT_NONNULL(params.get("d"_kj)) == "x y"_kj);
+  KJ_ASSERT(KJ_ASSERT_NONNULL(params.get("e f"_kj)) == "3"_kj);
+  KJ_ASSERT(params.get("?a"_kj) == kj::none);
+  KJ_ASSERT(params.size() == 6);
+  KJ_ASSERT(KJ_ASSERT_NONNULL(params.get("a"_kj)) == "1"_kj);
+
+  params.reset(kj::Maybe("x=1"_kj));
+  KJ_ASSERT(params.get("a"_kj) == kj::none);
+  params.append("y"_kj, "2 3"_kj);
+  KJ_ASSERT(kj::str(params) == "x=1&y=2+3");
+}
+
 // ======================================================================================
 
 KJ_TEST("URLPattern - processInit Default") {
@@ -52,6 +52,21 @@ T getInner(const kj::Own<void>& inner) {
   return const_cast<T>(value);
 }
 
+// An ada_url is an ada::result<ada::url_aggregator> allocated by ada's C API, which keeps the
+// serialized href in a single buffer along with the offsets of each component. Going through the
+// C++ API lets us parse relative to an already parsed base, rather than serializing the base and
+// parsing it again as ada_parse_with_base() would.
+using AdaResult = ada::result<ada::url_aggregator>;
+
+kj::Maybe<ada_url> tryParseAgainst(kj::ArrayPtr<const char> input, const ada_url base) {
+  auto& baseResult = *static_cast<const AdaResult*>(base);
+  KJ_DASSERT(baseResult.has_value());
+  auto result = ada::parse<ada::url_aggregator>(
+      std::string_view(input.begin(), input.size()), &baseResult.value());
+  if (!result) return kj::none;
+  return static_cast<ada_url>(new AdaResult(kj::mv(result)));
+}
+
 kj::Array<const char> normalizePathEncoding(kj::ArrayPtr<const char> pathname) {
   // Sadly, this is a bit tricky because we do not want to decode %2f as a slash.
   // we want to keep those as is. So we'll split the input around those bits.
@@ -172,7 +187,7 @@ kj::Maybe<Url> Url::tryParse(
 }
 
 kj::Maybe<Url> Url::resolve(kj::ArrayPtr<const char> input) {
-  return tryParse(input, getHref());
+  return tryResolve(input);
 }
 
 kj::ArrayPtr<const char> Url::getHref() const {
@@ -319,7 +334,9 @@ kj::Array<const char> Url::idnToAscii(kj::ArrayPtr<const char> value) {
 }
 
 kj::Maybe<Url> Url::tryResolve(kj::ArrayPtr<const char> input) const {
-  return tryParse(input, getHref());
+  return tryParseAgainst(input, getInner<ada_url>(inner)).map([](ada_url result) {
+    return Url(wrap(result));
+  });
 }
 
 kj::uint Url::hashCode() const {
@@ -337,79 +354,149 @@ kj::Array<kj::byte> Url::percentDecode(kj::ArrayPtr<const kj::byte> input) {
 // ======================================================================================
 
 namespace {
-kj::Own<void> emptySearchParams() {
-  ada_url_search_params result = ada_parse_search_params(nullptr, 0);
-  KJ_ASSERT(result);
-  return kj::disposeWith<ada_free_search_params>(result);
+// Returns true if `text` decodes to itself as part of an application/x-www-form-urlencoded name
+// or value, i.e. it has no percent-encoded bytes or '+' standing for a space.
+bool decodesToItself(kj::ArrayPtr<const char> text) {
+  for (char c: text) {
+    if (c == '%' || c == '+') return false;
+  }
+  return true;
+}
+
+// Calls `func` with the raw value of each pair named `key` in the unparsed `query`, in order,
+// until it returns false. Returns false if the answer depends on percent-decoding, which is the
+// case once a name that has to be compared, or a matching value, doesn't decode to itself.
+template <typename Func>
+bool findUnparsed(kj::ArrayPtr<const char> query, kj::ArrayPtr<const char> key, Func&& func) {
+  if (query.size() > 0 && query[0] == '?') query = query.slice(1);
+  while (query.size() > 0) {
+    size_t end = 0;
+    while (end < query.size() && query[end] != '&') end++;
+    auto pair = query.first(end);
+    query = query.slice(kj::min(end + 1, query.size()));
+    if (pair.size() == 0) continue;
+
+    size_t equals = 0;
+    while (equals < pair.size() && pair[equals] != '=') equals++;
+    auto name = pair.first(equals);
+    auto value = pair.slice(kj::min(equals + 1, pair.size()));
+
+    if (!decodesToItself(name)) return false;
+    if (name != key) continue;
+    if (!decodesToItself(value)) return false;
+    if (!func(value)) break;
+  }
+  return true;
 }
 }  // namespace
 
-UrlSearchParams::UrlSearchParams(): inner(emptySearchParams()) {}
+UrlSearchParams::UrlSearchParams(): unparsed(kj::String()) {}
 
-UrlSearchParams::UrlSearchParams(kj::Own<void> inner): inner(kj::mv(inner)) {}
+UrlSearchParams::UrlSearchParams(kj::String query): unparsed(kj::mv(query)) {}
 
 bool UrlSearchParams::operator==(const UrlSearchParams& other) const {
   return toStr() == other.toStr();
 }
 
+const kj::Own<void>& UrlSearchParams::getParsed() const {
+  KJ_IF_SOME(query, unparsed) {
+    ada_url_search_params result = ada_parse_search_params(query.begin(), query.size());
+    KJ_ASSERT(result);
+    inner = kj::disposeWith<ada_free_search_params>(result);
+    unparsed = kj::none;
+  }
+  return inner;
+}
+
 void UrlSearchParams::reset(kj::Maybe<kj::ArrayPtr<const char>> input) {
   KJ_IF_SOME(i, input) {
-    ada_search_params_reset(inner, i.begin(), i.size());
+    unparsed = kj::heapString(i);
   } else {
-    ada_search_params_reset(inner, nullptr, 0);
+    unparsed = kj::String();
   }
+  inner = nullptr;
 }
 
 kj::Maybe<UrlSearchParams> UrlSearchParams::tryParse(kj::ArrayPtr<const char> input) {
-  ada_url_search_params result = ada_parse_search_params(input.begin(), input.size());
-  if (!result) return kj::none;
-  return UrlSearchParams(kj::disposeWith<ada_free_search_params>(result));
+  return UrlSearchParams(kj::heapString(input));
 }
 
 size_t UrlSearchParams::size() const {
-  return ada_search_params_size(getInner<ada_url_search_params>(inner));
+  return ada_search_params_size(getInner<ada_url_search_params>(getParsed()));
 }
 
 void UrlSearchParams::append(kj::ArrayPtr<const char> key, kj::ArrayPtr<const char> value) {
-  ada_search_params_append(
-      getInner<ada_url_search_params>(inner), key.begin(), key.size(), value.begin(), value.size());
+  ada_search_params_append(getInner<ada_url_search_params>(getParsed()), key.begin(), key.size(),
+      value.begin(), value.size());
 }
 
 void UrlSearchParams::set(kj::ArrayPtr<const char> key, kj::ArrayPtr<const char> value) {
-  ada_search_params_set(
-      getInner<ada_url_search_params>(inner), key.begin(), key.size(), value.begin(), value.size());
+  ada_search_params_set(getInner<ada_url_search_params>(getParsed()), key.begin(), key.size(),
+      value.begin(), value.size());
 }
 
 void UrlSearchParams::delete_(
     kj::ArrayPtr<const char> key, kj::Maybe<kj::ArrayPtr<const char>> maybeValue) {
   KJ_IF_SOME(value, maybeValue) {
-    ada_search_params_remove_value(getInner<ada_url_search_params>(inner), key.begin(), key.size(),
-        value.begin(), value.size());
+    ada_search_params_remove_value(getInner<ada_url_search_params>(getParsed()), key.begin(),
+        key.size(), value.begin(), value.size());
   } else {
-    ada_search_params_remove(getInner<ada_url_search_params>(inner), key.begin(), key.size());
+    ada_search_params_remove(getInner<ada_url_search_params>(getParsed()), key.begin(), key.size());
   }
 }
 
 bool UrlSearchParams::has(
     kj::ArrayPtr<const char> key, kj::Maybe<kj::ArrayPtr<const char>> maybeValue) const {
+  KJ_IF_SOME(query, unparsed) {
+    bool found = false;
+    if (findUnparsed(query, key, [&](kj::ArrayPtr<const char> value) {
+      KJ_IF_SOME(v, maybeValue) {
+        found = v == value;
+      } else {
+        found = true;
+      }
+      return !found;
+    })) {
+      return found;
+    }
+  }
   KJ_IF_SOME(value, maybeValue) {
-    return ada_search_params_has_value(getInner<ada_url_search_params>(inner), key.begin(),
+    return ada_search_params_has_value(getInner<ada_url_search_params>(getParsed()), key.begin(),
         key.size(), value.begin(), value.size());
   } else {
-    return ada_search_params_has(getInner<ada_url_search_params>(inner), key.begin(), key.size());
+    return ada_search_params_has(
+        getInner<ada_url_search_params>(getParsed()), key.begin(), key.size());
   }
 }
 
 kj::Maybe<kj::ArrayPtr<const char>> UrlSearchParams::get(kj::ArrayPtr<const char> key) const {
+  KJ_IF_SOME(query, unparsed) {
+    kj::Maybe<kj::ArrayPtr<const char>> found;
+    if (findUnparsed(query, key, [&](kj::ArrayPtr<const char> value) {
+      found = value;
+      return false;
+    })) {
+      return found;
+    }
+  }
   auto result =
-      ada_search_params_get(getInner<ada_url_search_params>(inner), key.begin(), key.size());
+      ada_search_params_get(getInner<ada_url_search_params>(getParsed()), key.begin(), key.size());
   if (result.data == nullptr) return kj::none;
   return kj::ArrayPtr<const char>(result.data, result.length);
 }
 
 kj::Array<kj::ArrayPtr<const char>> UrlSearchParams::getAll(kj::ArrayPtr<const char> key) const {
-  ada_strings results =
-      ada_search_params_get_all(getInner<ada_url_search_params>(inner), key.begin(), key.size());
+  KJ_IF_SOME(query, unparsed) {
+    kj::Vector<kj::ArrayPtr<const char>> found;
+    if (findUnparsed(query, key, [&](kj::ArrayPtr<const char> value) {
+      found.add(value);
+      return true;
+    })) {
+      return found.releaseAsArray();
+    }
+  }
+  ada_strings results = ada_search_params_get_all(
+      getInner<ada_url_search_params>(getParsed()), key.begin(), key.size());
   size_t size = ada_strings_size(results);
   kj::Vector<kj::ArrayPtr<const char>> items(size);
   for (size_t n = 0; n < size; n++) {
@@ -420,26 +507,27 @@ kj::Array<kj::ArrayPtr<const char>> UrlSearchParams::getAll(kj::ArrayPtr<const c
 }
 
 void UrlSearchParams::sort() {
-  ada_search_params_sort(getInner<ada_url_search_params>(inner));
+  ada_search_params_sort(getInner<ada_url_search_params>(getParsed()));
 }
 
 UrlSearchParams::KeyIterator UrlSearchParams::getKeys() const {
   return KeyIterator(kj::disposeWith<ada_free_search_params_keys_iter>(
-      ada_search_params_get_keys(getInner<ada_url_search_params>(inner))));
+      ada_search_params_get_keys(getInner<ada_url_search_params>(getParsed()))));
 }
 
 UrlSearchParams::ValueIterator UrlSearchParams::getValues() const {
   return ValueIterator(kj::disposeWith<ada_free_search_params_values_iter>(
-      ada_search_params_get_values(getInner<ada_url_search_params>(inner))));
+      ada_search_params_get_values(getInner<ada_url_search_params>(getParsed()))));
 }
 
 UrlSearchParams::EntryIterator UrlSearchParams::getEntries() const {
   return EntryIterator(kj::disposeWith<ada_free_search_params_entries_iter>(
-      ada_search_params_get_entries(getInner<ada_url_search_params>(inner))));
+      ada_search_params_get_entries(getInner<ada_url_search_params>(getParsed()))));
 }
 
 kj::Array<const char> UrlSearchParams::toStr() const {
-  ada_owned_string result = ada_search_params_to_string(getInner<ada_url_search_params>(inner));
+  ada_owned_string result =
+      ada_search_params_to_string(getInner<ada_url_search_params>(getParsed()));
   return kj::Array<const char>(result.data, result.length, AdaOwnedStringDisposer::INSTANCE);
 }
 
@@ -540,6 +628,13 @@ inline kj::Maybe<kj::String> strFromMaybePtr(const kj::Maybe<kj::StringPtr>& ptr
 
 using Canonicalizer = kj::Maybe<kj::String>(kj::StringPtr, kj::Maybe<kj::StringPtr>);
 
+// The URL the component canonicalizers below set the component on. It's parsed once and copied
+// for each use, since copying the parsed URL is much cheaper than parsing it again.
+Url dummyUrl() {
+  static const Url url = KJ_ASSERT_NONNULL(Url::tryParse("fake://dummy.test"_kj));
+  return url.clone();
+}
+
 kj::Maybe<kj::String> canonicalizeProtocol(
     kj::StringPtr protocol, kj::Maybe<kj::StringPtr> = kj::none) {
   // @see https://wicg.github.io/urlpattern/#canonicalize-a-protocol
@@ -556,7 +651,7 @@ kj::Maybe<kj::String> canonicalizeUsername(
     kj::StringPtr username, kj::Maybe<kj::StringPtr> = kj::none) {
   // @see https://wicg.github.io/urlpattern/#canonicalize-a-username
   if (username.size() == 0) return kj::String();
-  auto url = KJ_ASSERT_NONNULL(Url::tryParse("fake://dummy.test"_kj));
+  auto url = dummyUrl();
   if (!url.setUsername(username)) return kj::none;
   return kj::str(url.getUsername());
 }
@@ -565,7 +660,7 @@ kj::Maybe<kj::String> canonicalizePassword(
     kj::StringPtr password, kj::Maybe<kj::StringPtr> = kj::none) {
   // @see https://wicg.github.io/urlpattern/#canonicalize-a-password
   if (password.size() == 0) return kj::String();
-  auto url = KJ_ASSERT_NONNULL(Url::tryParse("fake://dummy.test"_kj));
+  auto url = dummyUrl();
   if (!url.setPassword(password)) return kj::none;
   return kj::str(url.getPassword());
 }
@@ -574,7 +669,7 @@ kj::Maybe<kj::String> canonicalizeHostname(
     kj::StringPtr hostname, kj::Maybe<kj::StringPtr> = kj::none) {
   // @see https://wicg.github.io/urlpattern/#canonicalize-a-hostname
   if (hostname.size() == 0) return kj::String();
-  auto url = KJ_ASSERT_NONNULL(Url::tryParse("fake://dummy.test"_kj));
+  auto url = dummyUrl();
   if (!isValidHostnameInput(hostname)) return kj::none;
   if (!url.setHostname(hostname)) return kj::none;
   return kj::str(url.getHostname());
@@ -629,7 +724,7 @@ kj::Maybe<kj::String> canonicalizeSearch(
     kj::StringPtr search, kj::Maybe<kj::StringPtr> = kj::none) {
   // @see https://wicg.github.io/urlpattern/#canonicalize-a-search
   if (search.size() == 0) return kj::String();
-  auto url = KJ_ASSERT_NONNULL(Url::tryParse("fake://dummy.test"_kj));
+  auto url = dummyUrl();
   url.setSearch(kj::Maybe(search));
   return url.getSearch().size() > 0 ? kj::str(url.getSearch().slice(1)) : kj::String();
 }
@@ -637,7 +732,7 @@ kj::Maybe<kj::String> canonicalizeSearch(
 kj::Maybe<kj::String> canonicalizeHash(kj::StringPtr hash, kj::Maybe<kj::StringPtr> = kj::none) {
   // @see https://wicg.github.io/urlpattern/#canonicalize-a-hash
   if (hash.size() == 0) return kj::String();
-  auto url = KJ_ASSERT_NONNULL(Url::tryParse("fake://dummy.test"_kj));
+  auto url = dummyUrl();
   url.setHash(kj::Maybe(hash));
   return url.getHash().size() > 0 ? kj::str(url.getHash().slice(1)) : kj::String();
 }
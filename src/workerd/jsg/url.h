@@ -196,14 +196,26 @@ class UrlSearchParams final {
   kj::Array<const char> toStr() const KJ_WARN_UNUSED_RESULT;
 
   JSG_MEMORY_INFO(Url) {
-    tracker.trackField("inner", toStr());
+    KJ_IF_SOME(query, unparsed) {
+      tracker.trackField("unparsed", query);
+    } else {
+      tracker.trackField("inner", toStr());
+    }
   }
 
   void reset(kj::Maybe<kj::ArrayPtr<const char>> input);
 
  private:
-  UrlSearchParams(kj::Own<void> inner);
-  kj::Own<void> inner;
+  UrlSearchParams(kj::String query);
+
+  // A query is only split into decoded pairs once something needs them. Until then, `unparsed`
+  // holds it as given, and has() and get() look names up in it directly as long as the names
+  // and values they compare contain nothing that percent-decoding would change.
+  mutable kj::Maybe<kj::String> unparsed;
+  mutable kj::Own<void> inner;
+
+  // Returns the parsed pairs, parsing `unparsed` first if needed.
+  const kj::Own<void>& getParsed() const;
 };
 
 inline kj::String KJ_STRINGIFY(const Url& url) {
@@ -66,10 +66,22 @@ struct TypeErrorContext: public ContextGlobalObject {
   auto returnFunctionTakingBox(double value) {
     return [value](Lock&, Ref<NumberBox> value2) mutable { return value + value2->value; };
   }
+  double addMaybeBoxes(
+      kj::Maybe<Ref<NumberBox>> a, Optional<double> b, kj::Maybe<Ref<NumberBox>> c) {
+    double result = b.orDefault(0);
+    KJ_IF_SOME(box, a) {
+      result += box->value;
+    }
+    KJ_IF_SOME(box, c) {
+      result += box->value;
+    }
+    return result;
+  }
 
   JSG_RESOURCE_TYPE(TypeErrorContext) {
     JSG_NESTED_TYPE(NumberBox);
     JSG_METHOD(returnFunctionTakingBox);
+    JSG_METHOD(addMaybeBoxes);
   }
 };
 JSG_DECLARE_ISOLATE_TYPE(TypeErrorIsolate, TypeErrorContext, NumberBox);
@@ -87,6 +99,22 @@ KJ_TEST("throw TypeError") {
       "this object constructor cannot be called as a function.");
   e.expectEval("returnFunctionTakingBox(123)(321)", "throws",
       "TypeError: Failed to execute function: parameter 1 is not of type 'NumberBox'.");
+
+  // Missing arguments for required parameters are reported against the first one missing, even
+  // when the parameter would accept an explicit `undefined`.
+  e.expectEval("new NumberBox(123).addBox()", "throws",
+      "TypeError: Failed to execute 'addBox' on 'NumberBox': parameter 1 is not of "
+      "type 'NumberBox'.");
+  e.expectEval("returnFunctionTakingBox(123)()", "throws",
+      "TypeError: Failed to execute function: parameter 1 is not of type 'NumberBox'.");
+  e.expectEval("addMaybeBoxes()", "throws",
+      "TypeError: Failed to execute 'addMaybeBoxes' on 'TypeErrorContext': parameter 1 is not of "
+      "type 'NumberBox'.");
+  e.expectEval("addMaybeBoxes(new NumberBox(1))", "throws",
+      "TypeError: Failed to execute 'addMaybeBoxes' on 'TypeErrorContext': parameter 3 is not of "
+      "type 'NumberBox'.");
+  e.expectEval("addMaybeBoxes(new NumberBox(1), undefined, undefined)", "number", "1");
+  e.expectEval("addMaybeBoxes(new NumberBox(1), 2, new NumberBox(3))", "number", "6");
 }
 
 // ========================================================================================
@@ -522,6 +522,72 @@ kj::Array<kj::byte> asBytes(v8::Local<v8::ArrayBufferView> arrayBufferView) {
   }
 }
 
+namespace {
+
+// V8 calls a backing store's deleter with only the data pointer, the length, and one word of
+// context, but destroying a kj::Array also needs its disposer, which KJ doesn't let us pull out of
+// the array. So the array is moved into a small holder that travels as the context. Holders are
+// recycled through a bounded per-thread free list, so that wrapping bytes in steady state doesn't
+// allocate anything beyond the bytes themselves. The deleter may run on a different thread than
+// the one that created the backing store, in which case the holder simply joins that thread's
+// list.
+struct ByteArrayHolder {
+  kj::Array<kj::byte> bytes;
+  ByteArrayHolder* next = nullptr;
+};
+
+// Deliberately trivially destructible: backing stores can be released by other thread-local
+// destructors while a thread exits, after a non-trivial pool would already be gone. The few
+// holders left on an exiting thread's list are leaked.
+struct ByteArrayHolderPool {
+  static constexpr uint MAX_POOLED_HOLDERS = 64;
+
+  ByteArrayHolder* head;
+  uint count;
+
+  ByteArrayHolder* acquire(kj::Array<kj::byte> bytes) {
+    ByteArrayHolder* holder = head;
+    if (holder == nullptr) {
+      holder = new ByteArrayHolder;
+    } else {
+      head = holder->next;
+      --count;
+    }
+    holder->bytes = kj::mv(bytes);
+    return holder;
+  }
+
+  void release(ByteArrayHolder* holder) {
+    holder->bytes = nullptr;
+    if (count >= MAX_POOLED_HOLDERS) {
+      delete holder;
+    } else {
+      holder->next = head;
+      head = holder;
+      ++count;
+    }
+  }
+};
+
+thread_local ByteArrayHolderPool byteArrayHolderPool = {nullptr, 0};
+
+}  // namespace
+
+std::unique_ptr<v8::BackingStore> newBackingStore(kj::Array<kj::byte> bytes) {
+  size_t size = bytes.size();
+  if (size == 0) {
+    // BackingStore doesn't call the deleter if the data pointer is null, which it often is for
+    // empty arrays, so there's nothing to hand over.
+    return v8::ArrayBuffer::NewBackingStore(nullptr, 0, v8::BackingStore::EmptyDeleter, nullptr);
+  }
+
+  kj::byte* begin = bytes.begin();
+  auto holder = byteArrayHolderPool.acquire(kj::mv(bytes));
+  return v8::ArrayBuffer::NewBackingStore(begin, size, [](void*, size_t, void* holder) {
+    byteArrayHolderPool.release(reinterpret_cast<ByteArrayHolder*>(holder));
+  }, holder);
+}
+
 void recursivelyFreeze(v8::Local<v8::Context> context, v8::Local<v8::Value> value) {
   if (value->IsArray()) {
     // Optimize array freezing (Array is a subclass of Object, but we can iterate it faster).
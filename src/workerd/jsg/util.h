@@ -194,6 +194,10 @@ kj::Array<kj::byte> asBytes(v8::Local<v8::ArrayBuffer> arrayBuffer);
 // View the contents of the given v8::ArrayBuffer/ArrayBufferView as an ArrayPtr<byte>.
 kj::Array<kj::byte> asBytes(v8::Local<v8::ArrayBufferView> arrayBufferView);
 
+// Creates a v8::BackingStore that takes ownership of `bytes` without copying them. The array is
+// destroyed when V8 releases the backing store, which may happen on any thread.
+std::unique_ptr<v8::BackingStore> newBackingStore(kj::Array<kj::byte> bytes);
+
 // Freeze the given object and all its members, making it recursively immutable.
 //
 // WARNING: This function is unsafe to call on user-provided content since if the value is cyclic
@@ -17,4 +17,117 @@ void V8PlatformWrapper::JobTaskWrapper::Run(v8::JobDelegate* delegate) {
   runInV8Stack([&](jsg::V8StackScope& stackScope) { inner->Run(delegate); });
 }
 
+// Passes everything through to the wrapped platform's task runner except idle tasks, which are
+// queued on the V8PlatformWrapper.
+class V8PlatformWrapper::TaskRunnerWrapper final: public v8::TaskRunner {
+ public:
+  TaskRunnerWrapper(
+      V8PlatformWrapper& platform, v8::Isolate* isolate, std::shared_ptr<v8::TaskRunner> inner)
+      : platform(platform),
+        isolate(isolate),
+        inner(kj::mv(inner)) {}
+
+  bool IdleTasksEnabled() override {
+    return true;
+  }
+
+  bool NonNestableTasksEnabled() const override {
+    return inner->NonNestableTasksEnabled();
+  }
+
+  bool NonNestableDelayedTasksEnabled() const override {
+    return inner->NonNestableDelayedTasksEnabled();
+  }
+
+ protected:
+  void PostTaskImpl(std::unique_ptr<v8::Task> task, const v8::SourceLocation& location) override {
+    inner->PostTask(kj::mv(task), location);
+  }
+
+  void PostNonNestableTaskImpl(
+      std::unique_ptr<v8::Task> task, const v8::SourceLocation& location) override {
+    inner->PostNonNestableTask(kj::mv(task), location);
+  }
+
+  void PostDelayedTaskImpl(std::unique_ptr<v8::Task> task,
+      double delay_in_seconds,
+      const v8::SourceLocation& location) override {
+    inner->PostDelayedTask(kj::mv(task), delay_in_seconds, location);
+  }
+
+  void PostNonNestableDelayedTaskImpl(std::unique_ptr<v8::Task> task,
+      double delay_in_seconds,
+      const v8::SourceLocation& location) override {
+    inner->PostNonNestableDelayedTask(kj::mv(task), delay_in_seconds, location);
+  }
+
+  void PostIdleTaskImpl(
+      std::unique_ptr<v8::IdleTask> task, const v8::SourceLocation& location) override {
+    platform.postIdleTask(isolate, kj::mv(task));
+  }
+
+ private:
+  V8PlatformWrapper& platform;
+  v8::Isolate* isolate;
+  std::shared_ptr<v8::TaskRunner> inner;
+};
+
+std::shared_ptr<v8::TaskRunner> V8PlatformWrapper::GetForegroundTaskRunner(
+    v8::Isolate* isolate, v8::TaskPriority priority) {
+  auto index = static_cast<size_t>(priority);
+  KJ_ASSERT(index < TASK_PRIORITY_COUNT);
+
+  auto lock = isolates.lockExclusive();
+  auto& state = lock->findOrCreate(isolate, [&]() {
+    return kj::HashMap<v8::Isolate*, IsolateState>::Entry{isolate, {}};
+  });
+  auto& runner = state.taskRunners[index];
+  if (runner == nullptr) {
+    runner = std::make_shared<TaskRunnerWrapper>(
+        *this, isolate, inner.GetForegroundTaskRunner(isolate, priority));
+  }
+  return runner;
+}
+
+void V8PlatformWrapper::postIdleTask(v8::Isolate* isolate, std::unique_ptr<v8::IdleTask> task) {
+  auto lock = isolates.lockExclusive();
+  KJ_IF_SOME(state, lock->find(isolate)) {
+    state.idleTasks.push_back(kj::mv(task));
+  }
+  // Otherwise the isolate has been disposed, and the task is dropped.
+}
+
+void V8PlatformWrapper::runIdleTasks(v8::Isolate* isolate, kj::Duration budget) {
+  // V8 compares idle task deadlines against MonotonicallyIncreasingTime(), in seconds.
+  double deadline = MonotonicallyIncreasingTime() + double(budget / kj::NANOSECONDS) / 1e9;
+
+  while (MonotonicallyIncreasingTime() < deadline) {
+    std::unique_ptr<v8::IdleTask> task;
+    {
+      // Don't hold the mutex while running the task, since it may post more of them.
+      auto lock = isolates.lockExclusive();
+      KJ_IF_SOME(state, lock->find(isolate)) {
+        if (state.idleTasks.empty()) return;
+        task = kj::mv(state.idleTasks.front());
+        state.idleTasks.pop_front();
+      } else {
+        return;
+      }
+    }
+    task->Run(deadline);
+  }
+}
+
+void V8PlatformWrapper::disposeIsolate(v8::Isolate* isolate) {
+  // Move the state out so that the tasks are destroyed after the mutex is released.
+  kj::Maybe<IsolateState> state;
+  {
+    auto lock = isolates.lockExclusive();
+    KJ_IF_SOME(entry, lock->findEntry(isolate)) {
+      state = kj::mv(entry.value);
+      lock->erase(entry);
+    }
+  }
+}
+
 }  // namespace workerd::jsg
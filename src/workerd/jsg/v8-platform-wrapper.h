@@ -7,6 +7,11 @@
 #include <v8-platform.h>
 
 #include <kj/common.h>
+#include <kj/map.h>
+#include <kj/mutex.h>
+#include <kj/time.h>
+
+#include <deque>
 
 namespace workerd::jsg {
 
@@ -23,9 +28,7 @@ class V8PlatformWrapper: public v8::Platform {
   }
 
   std::shared_ptr<v8::TaskRunner> GetForegroundTaskRunner(
-      v8::Isolate* isolate, v8::TaskPriority priority) override {
-    return inner.GetForegroundTaskRunner(isolate, priority);
-  }
+      v8::Isolate* isolate, v8::TaskPriority priority) override;
 
   void PostTaskOnWorkerThreadImpl(v8::TaskPriority priority,
       std::unique_ptr<v8::Task> task,
@@ -47,8 +50,11 @@ class V8PlatformWrapper: public v8::Platform {
         priority, std::make_unique<JobTaskWrapper>(kj::mv(job_task)), location);
   }
 
+  // Idle tasks are supported whatever the wrapped platform says. The foreground task runners we
+  // hand out queue them per isolate instead of passing them on, and they run only when the
+  // embedder calls runIdleTasks(), i.e. when it knows the isolate has nothing better to do.
   bool IdleTasksEnabled(v8::Isolate* isolate) override {
-    return inner.IdleTasksEnabled(isolate);
+    return true;
   }
 
   double MonotonicallyIncreasingTime() override {
@@ -71,9 +77,35 @@ class V8PlatformWrapper: public v8::Platform {
     return inner.GetTracingController();
   }
 
+  // Runs the idle tasks that V8 has posted for `isolate`, oldest first, until `budget` has elapsed
+  // or none remain. The caller must hold the isolate lock.
+  void runIdleTasks(v8::Isolate* isolate, kj::Duration budget);
+
+  // Discards everything queued for `isolate`. Called when the isolate is disposed.
+  void disposeIsolate(v8::Isolate* isolate);
+
  private:
   v8::Platform& inner;
 
+  class TaskRunnerWrapper;
+
+  static constexpr size_t TASK_PRIORITY_COUNT =
+      static_cast<size_t>(v8::TaskPriority::kMaxPriority) + 1;
+
+  struct IsolateState {
+    std::deque<std::unique_ptr<v8::IdleTask>> idleTasks;
+
+    // Task runners handed out for this isolate, indexed by v8::TaskPriority. Created on first
+    // use.
+    std::shared_ptr<v8::TaskRunner> taskRunners[TASK_PRIORITY_COUNT];
+  };
+
+  // Foreground task runners may be requested, and idle tasks posted, from V8's background
+  // threads, so this is guarded by a mutex rather than the isolate lock.
+  kj::MutexGuarded<kj::HashMap<v8::Isolate*, IsolateState>> isolates;
+
+  void postIdleTask(v8::Isolate* isolate, std::unique_ptr<v8::IdleTask> task);
+
   class JobTaskWrapper: public v8::JobTask {
    public:
     JobTaskWrapper(std::unique_ptr<v8::JobTask> inner);
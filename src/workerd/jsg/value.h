@@ -912,32 +912,8 @@ class ArrayBufferWrapper {
 
   v8::Local<v8::ArrayBuffer> wrap(
       v8::Isolate* isolate, kj::Maybe<v8::Local<v8::Object>> creator, kj::Array<byte> value) {
-    // We need to construct a BackingStore that owns the byte array. We use the version of
-    // v8::ArrayBuffer::NewBackingStore() that accepts a deleter callback, and arrange for it to
-    // delete an Array<byte> placed on the heap.
-    //
-    // TODO(perf): We could avoid an allocation here, perhaps, by decomposing the kj::Array<byte>
-    //   into its component pointer and disposer, and then pass the disposer pointer as the
-    //   "deleter_data" for NewBackingStore. However, KJ doesn't give us any way to decompose an
-    //   Array<T> this way, and it might not want to, as this could make it impossible to support
-    //   unifying Array<T> and Vector<T> in the future (i.e. making all Array<T>s growable). So
-    //   it may be best to stick with allocating an Array<byte> on the heap after all...
-    size_t size = value.size();
-    if (size == 0) {
-      // BackingStore doesn't call custom deleter if begin is null, which it often is for empty
-      // arrays.
-      return v8::ArrayBuffer::New(isolate, 0);
-    }
-    byte* begin = value.begin();
-
-    auto ownerPtr = new kj::Array<byte>(kj::mv(value));
-
-    std::unique_ptr<v8::BackingStore> backing =
-        v8::ArrayBuffer::NewBackingStore(begin, size, [](void* begin, size_t size, void* ownerPtr) {
-      delete reinterpret_cast<kj::Array<byte>*>(ownerPtr);
-    }, ownerPtr);
-
-    return v8::ArrayBuffer::New(isolate, kj::mv(backing));
+    // The BackingStore takes ownership of the byte array, so no copy is made.
+    return v8::ArrayBuffer::New(isolate, newBackingStore(kj::mv(value)));
   }
 
   v8::Local<v8::ArrayBuffer> wrap(v8::Local<v8::Context> context,
@@ -105,3 +105,32 @@ KJ_TEST("ActorIdImplFactory idFromString test") {
     }
   }
 }
+
+KJ_TEST("ActorIdImplFactory idFromName test") {
+  using ActorIdFactoryImpl = workerd::server::ActorIdFactoryImpl;
+  ActorIdFactoryImpl factory(deadbeef64);
+
+  // The first half of a named ID is the HMAC of the name; the second half is the usual MAC.
+  kj::byte key[SHA256_DIGEST_LENGTH];
+  SHA256(kj::StringPtr(deadbeef64).asBytes().begin(), strlen(deadbeef64), key);
+  kj::byte expected[SHA256_DIGEST_LENGTH];
+  unsigned int len = SHA256_DIGEST_LENGTH;
+  auto name = "room"_kj;
+  HMAC(EVP_sha256(), key, sizeof(key), name.asBytes().begin(), name.size(), expected, &len);
+  auto expectedBase = kj::encodeHex(kj::arrayPtr(expected, BASE_LENGTH));
+  auto expectedId = computeProperTestMac(
+      kj::str(expectedBase, kj::repeat('0', BASE_LENGTH * 2)).cStr(), deadbeef64);
+
+  auto id = factory.idFromName(kj::str(name));
+  KJ_EXPECT(id->toString() == expectedId);
+  KJ_EXPECT(KJ_ASSERT_NONNULL(id->getName()) == name);
+
+  // A repeat lookup is served from the cache and must give the same ID, as must a lookup after
+  // the entry has been evicted.
+  KJ_EXPECT(factory.idFromName(kj::str(name))->toString() == expectedId);
+  for (auto i: kj::zeroTo(5000)) {
+    factory.idFromName(kj::str("name", i));
+  }
+  KJ_EXPECT(factory.idFromName(kj::str(name))->toString() == expectedId);
+  KJ_EXPECT(factory.idFromString(kj::mv(expectedId))->equals(*id));
+}
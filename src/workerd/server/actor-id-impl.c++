@@ -34,6 +34,7 @@ kj::Own<ActorIdFactory::ActorId> ActorIdFactoryImpl::ActorIdImpl::clone() const
 
 ActorIdFactoryImpl::ActorIdFactoryImpl(kj::StringPtr uniqueKey) {
   KJ_ASSERT(SHA256(uniqueKey.asBytes().begin(), uniqueKey.size(), key) == key);
+  KJ_ASSERT(HMAC_Init_ex(hmac.get(), key, sizeof(key), EVP_sha256(), nullptr) == 1);
 }
 
 kj::Own<ActorIdFactory::ActorId> ActorIdFactoryImpl::newUniqueId(
@@ -60,16 +61,26 @@ kj::Own<ActorIdFactory::ActorId> ActorIdFactoryImpl::newUniqueId(
 }
 
 kj::Own<ActorIdFactory::ActorId> ActorIdFactoryImpl::idFromName(kj::String name) {
+  KJ_IF_SOME(entry, nameCache.find(name)) {
+    // Move the entry to the back of the insertion order to mark it most recently used.
+    auto& bumped = nameCache.insert(nameCache.release(entry));
+    return kj::heap<ActorIdImpl>(bumped.id, kj::mv(name));
+  }
+
   kj::byte id[BASE_LENGTH + SHA256_DIGEST_LENGTH]{};
 
   // Compute the first half of the ID by HMACing the name itself. We're using HMAC as a keyed
   // hash here, not actually for authentication, but it works.
-  unsigned int len = SHA256_DIGEST_LENGTH;
-  KJ_ASSERT(
-      HMAC(EVP_sha256(), key, sizeof(key), name.asBytes().begin(), name.size(), id, &len) == id);
-  KJ_ASSERT(len == SHA256_DIGEST_LENGTH);
+  computeHmac(name.asBytes(), id);
 
   computeMac(id);
+
+  if (nameCache.size() >= MAX_CACHED_NAMES) {
+    nameCache.erase(*nameCache.ordered<1>().begin());
+  }
+  auto& entry = nameCache.insert(CachedName{.name = kj::str(name)});
+  memcpy(entry.id, id, sizeof(entry.id));
+
   return kj::heap<ActorIdImpl>(id, kj::mv(name));
 }
 
@@ -104,9 +115,17 @@ void ActorIdFactoryImpl::computeMac(kj::byte id[BASE_LENGTH + SHA256_DIGEST_LENG
   // first half of the ID plus a full HMAC, even though only a prefix of the HMAC becomes part
   // of the final ID.
 
-  kj::byte* hmacOut = id + BASE_LENGTH;
+  computeHmac(kj::arrayPtr(id, BASE_LENGTH), id + BASE_LENGTH);
+}
+
+void ActorIdFactoryImpl::computeHmac(
+    kj::ArrayPtr<const kj::byte> input, kj::byte out[SHA256_DIGEST_LENGTH]) {
+  // Passing a null key and digest restarts the context from the key state set up in the
+  // constructor, equivalent to `HMAC(EVP_sha256(), key, ...)` without rehashing the key.
   unsigned int len = SHA256_DIGEST_LENGTH;
-  KJ_ASSERT(HMAC(EVP_sha256(), key, sizeof(key), id, BASE_LENGTH, hmacOut, &len) == hmacOut);
+  KJ_ASSERT(HMAC_Init_ex(hmac.get(), nullptr, 0, nullptr, nullptr) == 1);
+  KJ_ASSERT(HMAC_Update(hmac.get(), input.begin(), input.size()) == 1);
+  KJ_ASSERT(HMAC_Final(hmac.get(), out, &len) == 1);
   KJ_ASSERT(len == SHA256_DIGEST_LENGTH);
 }
 
@@ -2,8 +2,11 @@
 
 #include <workerd/io/actor-id.h>
 
+#include <openssl/hmac.h>
 #include <openssl/sha.h>
 
+#include <kj/table.h>
+
 namespace workerd::server {
 class ActorIdFactoryImpl final: public ActorIdFactory {
  public:
@@ -31,10 +34,38 @@ class ActorIdFactoryImpl final: public ActorIdFactory {
  private:
   kj::byte key[SHA256_DIGEST_LENGTH];
 
+  // Keyed with `key` once at construction. Each MAC restarts from the precomputed key state rather
+  // than hashing the key again.
+  bssl::ScopedHMAC_CTX hmac;
+
   uint64_t counter = 0;  // only used in predictable mode
 
   static constexpr size_t BASE_LENGTH = SHA256_DIGEST_LENGTH / 2;
   void computeMac(kj::byte id[BASE_LENGTH + SHA256_DIGEST_LENGTH]);
+  void computeHmac(kj::ArrayPtr<const kj::byte> input, kj::byte out[SHA256_DIGEST_LENGTH]);
+
+  // Routing workers tend to call idFromName() with the same few thousand names on every request,
+  // so the IDs derived for recently used names are kept, evicting the least recently used.
+  static constexpr size_t MAX_CACHED_NAMES = 4096;
+
+  struct CachedName {
+    kj::String name;
+    kj::byte id[SHA256_DIGEST_LENGTH];
+  };
+
+  struct CachedNameCallbacks {
+    kj::StringPtr keyForRow(const CachedName& entry) const {
+      return entry.name;
+    }
+    bool matches(const CachedName& entry, kj::StringPtr name) const {
+      return entry.name == name;
+    }
+    uint hashCode(kj::StringPtr name) const {
+      return kj::hashCode(name);
+    }
+  };
+
+  kj::Table<CachedName, kj::HashIndex<CachedNameCallbacks>, kj::InsertionOrderIndex> nameCache;
 };
 
 }  // namespace workerd::server
@@ -39,6 +39,13 @@ AlarmScheduler::AlarmScheduler(
   loadAlarmsFromDb();
 }
 
+AlarmScheduler::~AlarmScheduler() noexcept(false) {
+  // Write anything that was changed during the last turn.
+  KJ_IF_SOME(exception, kj::runCatchingExceptions([&]() { flushWrites(); })) {
+    KJ_LOG(ERROR, "failed to write alarms to the database", exception);
+  }
+}
+
 void AlarmScheduler::ensureInitialized(SqliteDatabase& db) {
   // TODO(sqlite): Do this automatically at a lower layer?
   db.run("PRAGMA journal_mode=WAL;");
@@ -54,8 +61,6 @@ void AlarmScheduler::ensureInitialized(SqliteDatabase& db) {
 }
 
 void AlarmScheduler::loadAlarmsFromDb() {
-  auto now = clock.now();
-
   // TODO(someday): don't maintain the entire alarm set in memory -- right now for the usecase of
   // local development, doing so is sufficient.
   auto query = db->run(R"(
@@ -70,7 +75,10 @@ void AlarmScheduler::loadAlarmsFromDb() {
     auto actor = kj::attachVal(ActorKey{.uniqueKey = ownUniqueKey, .actorId = ownActorId},
         kj::mv(ownUniqueKey), kj::mv(ownActorId));
 
-    alarms.insert(*actor, scheduleAlarm(now, kj::mv(actor), date));
+    ActorKey key = *actor;
+    auto& entry =
+        alarms.insert(key, ScheduledAlarm{.actor = kj::mv(actor), .scheduledTime = date});
+    enqueue(entry.value, date);
 
     query.nextRow();
   }
@@ -97,38 +105,28 @@ kj::Maybe<kj::Date> AlarmScheduler::getAlarm(ActorKey actor) {
   }
 }
 
-bool AlarmScheduler::setAlarm(ActorKey actor, kj::Date scheduledTime) {
-  int64_t scheduledTimeNs = (scheduledTime - kj::UNIX_EPOCH) / kj::NANOSECONDS;
-  auto query = stmtSetAlarm.run(actor.uniqueKey, actor.actorId, scheduledTimeNs);
+void AlarmScheduler::setAlarm(ActorKey actor, kj::Date scheduledTime) {
+  persist(actor, scheduledTime);
 
-  bool existing = true;
-  auto& entry = alarms.findOrCreate(actor, [&]() {
-    existing = false;
-
-    auto ownUniqueKey = kj::str(actor.uniqueKey);
-    auto ownActorId = kj::str(actor.actorId);
-    auto ownActor = kj::attachVal(ActorKey{.uniqueKey = ownUniqueKey, .actorId = ownActorId},
-        kj::mv(ownUniqueKey), kj::mv(ownActorId));
-
-    return decltype(alarms)::Entry{
-      *ownActor, scheduleAlarm(clock.now(), kj::mv(ownActor), scheduledTime)};
-  });
-
-  if (existing) {
+  KJ_IF_SOME(entry, alarms.find(actor)) {
     if (entry.status != AlarmStatus::WAITING) {
       // We queue any new alarm after the existing alarm even if the new alarm has the same scheduled
       // time, as receiving a notification directly maps to a write for that time in the actor.
       entry.queuedAlarm = scheduledTime;
     } else {
-      entry = scheduleAlarm(clock.now(), kj::mv(entry.actor), scheduledTime);
+      scheduleAlarm(entry, scheduledTime);
     }
+  } else {
+    auto ownActor = actor.clone();
+    ActorKey key = *ownActor;
+    auto& entry = alarms.insert(
+        key, ScheduledAlarm{.actor = kj::mv(ownActor), .scheduledTime = scheduledTime});
+    enqueue(entry.value, scheduledTime);
   }
-
-  return query.changeCount() > 0;
 }
 
-bool AlarmScheduler::deleteAlarm(ActorKey actor) {
-  auto query = stmtDeleteAlarm.run(actor.uniqueKey, actor.actorId);
+void AlarmScheduler::deleteAlarm(ActorKey actor) {
+  persist(actor, kj::none);
 
   KJ_IF_SOME(entry, alarms.findEntry(actor)) {
     KJ_IF_SOME(queued, entry.value.queuedAlarm) {
@@ -136,17 +134,16 @@ bool AlarmScheduler::deleteAlarm(ActorKey actor) {
         // If we are currently running an alarm, we want to delete the queued instead of current.
         entry.value.queuedAlarm = kj::none;
       } else {
-        entry.value = scheduleAlarm(clock.now(), kj::mv(entry.value.actor), queued);
+        scheduleAlarm(entry.value, queued);
       }
     } else {
       if (entry.value.status != AlarmStatus::STARTED) {
         // We can't remove running alarms.
+        dequeue(entry.value);
         alarms.erase(entry);
       }
     }
   }
-
-  return query.changeCount() > 0;
 }
 
 kj::Promise<AlarmScheduler::RetryInfo> AlarmScheduler::runAlarm(
@@ -161,30 +158,62 @@ kj::Promise<AlarmScheduler::RetryInfo> AlarmScheduler::runAlarm(
   }
 }
 
-AlarmScheduler::ScheduledAlarm AlarmScheduler::scheduleAlarm(
-    kj::Date now, kj::Own<ActorKey> actor, kj::Date scheduledTime) {
-  auto task = makeAlarmTask(scheduledTime - now, *actor, scheduledTime);
+void AlarmScheduler::scheduleAlarm(ScheduledAlarm& alarm, kj::Date scheduledTime) {
+  dequeue(alarm);
+  alarm = ScheduledAlarm{.actor = kj::mv(alarm.actor), .scheduledTime = scheduledTime};
+  enqueue(alarm, scheduledTime);
+}
+
+void AlarmScheduler::enqueue(ScheduledAlarm& alarm, kj::Date startTime) {
+  dequeue(alarm);
+  alarm.startTime = startTime;
+  queue.insert(QueuedAlarm{.startTime = startTime, .actor = alarm.actor.get()});
+
+  bool isEarliest = true;
+  KJ_IF_SOME(time, wakeupTime) {
+    isEarliest = startTime < time;
+  }
+  if (isEarliest) {
+    setWakeup(startTime);
+  }
+}
 
-  return ScheduledAlarm{kj::mv(actor), scheduledTime, kj::mv(task)};
+void AlarmScheduler::dequeue(ScheduledAlarm& alarm) {
+  // The wakeup is left alone even if this was the earliest alarm: firing early is harmless, and
+  // much cheaper than replacing the timer every time.
+  KJ_IF_SOME(time, alarm.startTime) {
+    queue.erase(QueuedAlarm{.startTime = time, .actor = alarm.actor.get()});
+    alarm.startTime = kj::none;
+  }
 }
 
-kj::Promise<void> AlarmScheduler::checkTimestamp(kj::Duration delay, kj::Date scheduledTime) {
-  co_await timer.afterDelay(delay);
+void AlarmScheduler::setWakeup(kj::Date time) {
+  wakeupTime = time;
+  // The timer may run a little behind the clock, so startDueAlarms() checks the clock again and
+  // waits some more if it's too early.
+  wakeup = timer.afterDelay(time - clock.now()).then([this]() {
+    // A promise cannot delete itself, and startDueAlarms() replaces `wakeup`.
+    tasks.add(kj::mv(KJ_ASSERT_NONNULL(wakeup)));
+    wakeup = kj::none;
+    wakeupTime = kj::none;
+    startDueAlarms();
+  }).eagerlyEvaluate(nullptr);
+}
 
-  // Since we are waiting on timer.afterDelay, it's possible that timer.now() was behind
-  // the real time by a few ms, leading to premature alarm() execution. This checks it the current
-  // time is >= than scheduledTime to ensure we run alarms only on or after their scheduled time.
+void AlarmScheduler::startDueAlarms() {
   auto now = clock.now();
-  if (now < scheduledTime) {
-    // If it's not yet time to trigger the alarm, we shall wait a while longer until we can
-    // trigger it. This repeats until it's time for the alarm to run.
-    co_await checkTimestamp(scheduledTime - now, scheduledTime);
+  while (!queue.empty() && queue.begin()->startTime <= now) {
+    auto& entry = KJ_ASSERT_NONNULL(alarms.findEntry(*queue.begin()->actor));
+    queue.erase(queue.begin());
+    entry.value.startTime = kj::none;
+    tasks.add(makeAlarmTask(*entry.value.actor, entry.value.scheduledTime));
+  }
+  if (!queue.empty()) {
+    setWakeup(queue.begin()->startTime);
   }
 }
 
-kj::Promise<void> AlarmScheduler::makeAlarmTask(
-    kj::Duration delay, const ActorKey& actorRef, kj::Date scheduledTime) {
-  co_await checkTimestamp(delay, scheduledTime);
+kj::Promise<void> AlarmScheduler::makeAlarmTask(const ActorKey& actorRef, kj::Date scheduledTime) {
   uint32_t retryCount = 0;
   {
     auto& entry = KJ_ASSERT_NONNULL(alarms.findEntry(actorRef));
@@ -211,23 +240,19 @@ kj::Promise<void> AlarmScheduler::makeAlarmTask(
   try {
     auto& entry = KJ_ASSERT_NONNULL(alarms.findEntry(actorRef));
 
-    // We can't overwrite our entry before moving ourselves out of it, as a promise cannot
-    // delete itself.
-    tasks.add(kj::mv(entry.value.task));
-
     // If an alarm is queued, there's no point in retrying the current one -- proceed
     // to running the queued alarm instead.
     KJ_IF_SOME(a, entry.value.queuedAlarm) {
       // creating a new alarm and overwriting the old one will reset
       // `status` to WAITING and `queuedAlarm` to null
-      entry.value = scheduleAlarm(clock.now(), kj::mv(entry.value.actor), a);
+      scheduleAlarm(entry.value, a);
       co_return;
     }
 
     // When we reach this block of code and alarm has either succeeded or failed and may (or may
     // not) retry. Setting the status of an alarm as FINISHED here, will allow deletion of alarms
-    // between retries. If there's a retry, `makeAlarmTask` is called, setting status as RUNNING
-    // again.
+    // between retries. If there's a retry, the alarm is queued again, and `makeAlarmTask` sets its
+    // status as STARTED once it is due.
     entry.value.status = AlarmStatus::FINISHED;
 
     if (retryInfo.retry) {
@@ -260,7 +285,7 @@ kj::Promise<void> AlarmScheduler::makeAlarmTask(
       entry.value.backoff++;
       entry.value.retry++;
 
-      entry.value.task = makeAlarmTask(delay, actorRef, scheduledTime);
+      enqueue(entry.value, clock.now() + delay);
     } else {
       KJ_ASSERT(entry.value.queuedAlarm == kj::none);
       deleteAlarm(actorRef);
@@ -271,6 +296,40 @@ kj::Promise<void> AlarmScheduler::makeAlarmTask(
   }
 }
 
+void AlarmScheduler::persist(const ActorKey& actor, kj::Maybe<kj::Date> scheduledTime) {
+  auto& write = pendingWrites.findOrCreate(actor, [&]() {
+    auto ownActor = actor.clone();
+    return decltype(pendingWrites)::Entry{*ownActor, PendingWrite{.actor = kj::mv(ownActor)}};
+  });
+  write.scheduledTime = scheduledTime;
+
+  if (!flushScheduled) {
+    flushScheduled = true;
+    tasks.add(kj::evalLater([this]() { flushWrites(); }));
+  }
+}
+
+void AlarmScheduler::flushWrites() {
+  flushScheduled = false;
+  if (pendingWrites.size() == 0) {
+    return;
+  }
+  KJ_DEFER(pendingWrites.clear());
+
+  stmtBeginTransaction.run();
+  KJ_ON_SCOPE_FAILURE(stmtRollbackTransaction.run());
+  for (auto& entry: pendingWrites) {
+    auto& actor = *entry.value.actor;
+    KJ_IF_SOME(scheduledTime, entry.value.scheduledTime) {
+      int64_t scheduledTimeNs = (scheduledTime - kj::UNIX_EPOCH) / kj::NANOSECONDS;
+      stmtSetAlarm.run(actor.uniqueKey, actor.actorId, scheduledTimeNs);
+    } else {
+      stmtDeleteAlarm.run(actor.uniqueKey, actor.actorId);
+    }
+  }
+  stmtCommitTransaction.run();
+}
+
 void AlarmScheduler::taskFailed(kj::Exception&& e) {
   KJ_LOG(WARNING, e);
 }
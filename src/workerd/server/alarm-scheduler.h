@@ -14,7 +14,9 @@
 #include <kj/time.h>
 #include <kj/timer.h>
 
+#include <functional>
 #include <random>
+#include <set>
 
 namespace workerd::server {
 
@@ -43,6 +45,11 @@ inline uint KJ_HASHCODE(const ActorKey& k) {
 
 // Allows scheduling alarm executions at specific times, returning a promise representing
 // the completion of the alarm event.
+//
+// Waiting alarms are kept in a queue ordered by start time, and only the earliest of them has a
+// timer, so the number of scheduled alarms doesn't affect the number of pending timers. Changes
+// are written to the database in one transaction per turn of the event loop, rather than one
+// write per setAlarm() or deleteAlarm().
 class AlarmScheduler final: kj::TaskSet::ErrorHandler {
  public:
   static constexpr auto RETRY_START_SECONDS = WorkerInterface::ALARM_RETRY_START_SECONDS;
@@ -63,10 +70,11 @@ class AlarmScheduler final: kj::TaskSet::ErrorHandler {
 
   AlarmScheduler(
       const kj::Clock& clock, kj::Timer& timer, const SqliteDatabase::Vfs& vfs, kj::Path path);
+  ~AlarmScheduler() noexcept(false);
 
   kj::Maybe<kj::Date> getAlarm(ActorKey actor);
-  bool setAlarm(ActorKey actor, kj::Date scheduledTime);
-  bool deleteAlarm(ActorKey actor);
+  void setAlarm(ActorKey actor, kj::Date scheduledTime);
+  void deleteAlarm(ActorKey actor);
 
   void registerNamespace(kj::StringPtr uniqueKey, GetActorFn getActor);
 
@@ -86,11 +94,13 @@ class AlarmScheduler final: kj::TaskSet::ErrorHandler {
   struct ScheduledAlarm {
     kj::Own<ActorKey> actor;
     kj::Date scheduledTime;
-    kj::Promise<void> task;
     kj::Maybe<kj::Date> queuedAlarm = kj::none;
     // Once started, an alarm can have a single alarm queued behind it.
     AlarmStatus status = AlarmStatus::WAITING;
 
+    // When the alarm, or its next retry, is due to start, if it is in `queue`.
+    kj::Maybe<kj::Date> startTime = kj::none;
+
     bool previousRetryCountedAgainstLimit = false;
 
     // Counter for calculating backoff -- separate from retry, so we can reset backoff without losing
@@ -106,6 +116,32 @@ class AlarmScheduler final: kj::TaskSet::ErrorHandler {
 
   kj::HashMap<ActorKey, ScheduledAlarm> alarms;
 
+  // The alarms that wait to start, earliest first. An alarm's actor key points into its entry in
+  // `alarms`.
+  struct QueuedAlarm {
+    kj::Date startTime;
+    const ActorKey* actor;
+
+    bool operator<(const QueuedAlarm& other) const {
+      if (startTime != other.startTime) return startTime < other.startTime;
+      return std::less<const ActorKey*>()(actor, other.actor);
+    }
+  };
+  std::set<QueuedAlarm> queue;
+
+  // Fires when the first alarm in `queue` is due to start.
+  kj::Maybe<kj::Promise<void>> wakeup;
+  kj::Maybe<kj::Date> wakeupTime;
+
+  // Writes that haven't been made to the database yet, by actor. A scheduled time of kj::none
+  // deletes the actor's alarm.
+  struct PendingWrite {
+    kj::Own<ActorKey> actor;
+    kj::Maybe<kj::Date> scheduledTime;
+  };
+  kj::HashMap<ActorKey, PendingWrite> pendingWrites;
+  bool flushScheduled = false;
+
   struct RetryInfo {
     bool retry;
     bool retryCountsAgainstLimit;
@@ -113,14 +149,23 @@ class AlarmScheduler final: kj::TaskSet::ErrorHandler {
   kj::Promise<RetryInfo> runAlarm(
       const ActorKey& actor, kj::Date scheduledTime, uint32_t retryCount);
 
-  void setAlarmInMemory(kj::Own<ActorKey> actor, kj::Date scheduledTime);
+  // Replaces `alarm` with a new alarm for `scheduledTime`, and queues it.
+  void scheduleAlarm(ScheduledAlarm& alarm, kj::Date scheduledTime);
+
+  // Queues `alarm` to start at `startTime`, or removes it from the queue.
+  void enqueue(ScheduledAlarm& alarm, kj::Date startTime);
+  void dequeue(ScheduledAlarm& alarm);
 
-  ScheduledAlarm scheduleAlarm(kj::Date now, kj::Own<ActorKey> actor, kj::Date scheduledTime);
+  // Starts every queued alarm that is due, and sets a timer for the next one.
+  void startDueAlarms();
+  void setWakeup(kj::Date time);
 
-  kj::Promise<void> makeAlarmTask(
-      kj::Duration delay, const ActorKey& actor, kj::Date scheduledTime);
+  kj::Promise<void> makeAlarmTask(const ActorKey& actor, kj::Date scheduledTime);
 
-  kj::Promise<void> checkTimestamp(kj::Duration delay, kj::Date scheduledTime);
+  // Records that the actor's alarm is now at `scheduledTime`, or deleted, to be written to the
+  // database at the end of this turn.
+  void persist(const ActorKey& actor, kj::Maybe<kj::Date> scheduledTime);
+  void flushWrites();
 
   SqliteDatabase::Statement stmtSetAlarm = db->prepare(R"(
     INSERT INTO _cf_ALARM VALUES(?, ?, ?)
@@ -129,6 +174,9 @@ class AlarmScheduler final: kj::TaskSet::ErrorHandler {
   SqliteDatabase::Statement stmtDeleteAlarm = db->prepare(R"(
     DELETE FROM _cf_ALARM WHERE actor_unique_key = ? AND actor_id = ?
   )");
+  SqliteDatabase::Statement stmtBeginTransaction = db->prepare("BEGIN TRANSACTION");
+  SqliteDatabase::Statement stmtCommitTransaction = db->prepare("COMMIT TRANSACTION");
+  SqliteDatabase::Statement stmtRollbackTransaction = db->prepare("ROLLBACK TRANSACTION");
 
   void taskFailed(kj::Exception&& exception) override;
 
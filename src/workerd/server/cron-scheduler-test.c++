@@ -0,0 +1,181 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "cron-scheduler.h"
+
+#include <kj/test.h>
+#include <kj/vector.h>
+
+namespace workerd::server {
+namespace {
+
+// 2024-10-04T00:00:00Z, a Friday.
+constexpr kj::Date FRIDAY = kj::UNIX_EPOCH + 1728000000 * kj::SECONDS;
+
+kj::Maybe<kj::Date> nextAfter(kj::StringPtr cron, kj::Date after) {
+  return KJ_ASSERT_NONNULL(CronSchedule::parse(cron), cron).next(after);
+}
+
+KJ_TEST("CronSchedule finds the next matching minute") {
+  auto at = FRIDAY + 10 * kj::HOURS + 7 * kj::MINUTES;
+
+  KJ_EXPECT(nextAfter("* * * * *", at) == at + 1 * kj::MINUTES);
+  KJ_EXPECT(nextAfter("* * * * *", at + 30 * kj::SECONDS) == at + 1 * kj::MINUTES);
+  KJ_EXPECT(nextAfter("*/15 * * * *", at) == at + 8 * kj::MINUTES);
+  KJ_EXPECT(nextAfter("5,50 10-11 * * *", at) == at + 43 * kj::MINUTES);
+  KJ_EXPECT(nextAfter("0 9 * * *", at) == FRIDAY + 1 * kj::DAYS + 9 * kj::HOURS);
+  KJ_EXPECT(nextAfter("@hourly", at) == FRIDAY + 11 * kj::HOURS);
+
+  // Named and numbered days of week, with Sunday as 0 or 7.
+  KJ_EXPECT(nextAfter("0 0 * * MON", at) == FRIDAY + 3 * kj::DAYS);
+  KJ_EXPECT(nextAfter("0 0 * * 7", at) == FRIDAY + 2 * kj::DAYS);
+  KJ_EXPECT(nextAfter("0 0 * * sat,sun", at) == FRIDAY + 1 * kj::DAYS);
+
+  // With both restricted, either the day of month or the day of week matches.
+  KJ_EXPECT(nextAfter("0 0 5 * MON", at) == FRIDAY + 1 * kj::DAYS);
+  KJ_EXPECT(nextAfter("0 0 * OCT MON", at) == FRIDAY + 3 * kj::DAYS);
+
+  // 2024-11-01, then 2028-02-29.
+  KJ_EXPECT(nextAfter("0 0 1 NOV *", at) == FRIDAY + 28 * kj::DAYS);
+  KJ_EXPECT(nextAfter("0 0 29 2 *", at) == kj::UNIX_EPOCH + 1835395200 * kj::SECONDS);
+
+  KJ_EXPECT(nextAfter("0 0 30 2 *", at) == kj::none);
+}
+
+KJ_TEST("CronSchedule rejects malformed expressions") {
+  for (auto cron: {"", "* * * *", "* * * * * *", "60 * * * *", "* 24 * * *", "* * 0 * *",
+         "* * * 13 *", "* * * * 8", "5-1 * * * *", "*/0 * * * *", "1- * * * *", "a * * * *",
+         "* * * FOO *", "@never"}) {
+    KJ_EXPECT(CronSchedule::parse(cron) == kj::none, cron);
+  }
+}
+
+class FakeEntropySource final: public kj::EntropySource {
+ public:
+  void generate(kj::ArrayPtr<kj::byte> buffer) override {
+    buffer.fill(0x5a);
+  }
+};
+
+// A wall clock that moves with the test's timer.
+class FakeClock final: public kj::Clock {
+ public:
+  FakeClock(kj::Timer& timer, kj::Date start): timer(timer), start(start) {}
+
+  kj::Date now() const override {
+    return start + (timer.now() - kj::origin<kj::TimePoint>());
+  }
+
+ private:
+  kj::Timer& timer;
+  kj::Date start;
+};
+
+struct TestEnv {
+  kj::EventLoop loop;
+  kj::WaitScope waitScope;
+  kj::TimerImpl timer;
+  FakeClock clock;
+  FakeEntropySource entropy;
+  kj::Vector<kj::Date> runs;
+  kj::Maybe<kj::Own<kj::PromiseFulfiller<void>>> pendingRun;
+  bool holdRuns = false;
+
+  TestEnv(kj::Date start)
+      : waitScope(loop),
+        timer(kj::origin<kj::TimePoint>()),
+        clock(timer, start) {}
+
+  kj::Own<CronScheduler> makeScheduler(
+      kj::StringPtr cron, kj::Duration maxJitter = 0 * kj::SECONDS) {
+    auto triggers = kj::heapArray<CronScheduler::Trigger>(1);
+    triggers[0] = {
+      .cron = kj::str(cron),
+      .schedule = KJ_ASSERT_NONNULL(CronSchedule::parse(cron)),
+    };
+    return kj::heap<CronScheduler>(clock, timer, entropy, maxJitter, kj::mv(triggers),
+        [this](kj::Date scheduledTime, kj::StringPtr) -> kj::Promise<void> {
+      runs.add(scheduledTime);
+      if (!holdRuns) return kj::READY_NOW;
+      auto paf = kj::newPromiseAndFulfiller<void>();
+      pendingRun = kj::mv(paf.fulfiller);
+      return kj::mv(paf.promise);
+    });
+  }
+
+  void advance(kj::Duration duration) {
+    timer.advanceTo(timer.now() + duration);
+    waitScope.poll();
+  }
+};
+
+KJ_TEST("CronScheduler runs each tick") {
+  TestEnv env(FRIDAY + 30 * kj::SECONDS);
+  auto scheduler = env.makeScheduler("* * * * *");
+  env.waitScope.poll();
+
+  env.advance(29 * kj::SECONDS);
+  KJ_EXPECT(env.runs.size() == 0);
+  env.advance(1 * kj::SECONDS);
+  KJ_ASSERT(env.runs.size() == 1);
+  KJ_EXPECT(env.runs[0] == FRIDAY + 1 * kj::MINUTES);
+
+  env.advance(1 * kj::MINUTES);
+  KJ_ASSERT(env.runs.size() == 2);
+  KJ_EXPECT(env.runs[1] == FRIDAY + 2 * kj::MINUTES);
+}
+
+KJ_TEST("CronScheduler coalesces ticks missed during a stall") {
+  TestEnv env(FRIDAY + 30 * kj::SECONDS);
+  auto scheduler = env.makeScheduler("* * * * *");
+  env.waitScope.poll();
+
+  // Nothing runs for five and a half minutes, then only the latest tick runs.
+  env.advance(5 * kj::MINUTES + 30 * kj::SECONDS);
+  KJ_ASSERT(env.runs.size() == 1);
+  KJ_EXPECT(env.runs[0] == FRIDAY + 6 * kj::MINUTES);
+  KJ_EXPECT(scheduler->getCoalescedCount() == 5);
+
+  // The schedule carries on from there.
+  env.advance(1 * kj::MINUTES);
+  KJ_ASSERT(env.runs.size() == 2);
+  KJ_EXPECT(env.runs[1] == FRIDAY + 7 * kj::MINUTES);
+}
+
+KJ_TEST("CronScheduler skips ticks while the previous run is still going") {
+  TestEnv env(FRIDAY);
+  env.holdRuns = true;
+  auto scheduler = env.makeScheduler("* * * * *");
+  env.waitScope.poll();
+
+  env.advance(1 * kj::MINUTES);
+  KJ_EXPECT(env.runs.size() == 1);
+  env.advance(1 * kj::MINUTES);
+  KJ_EXPECT(env.runs.size() == 1);
+  KJ_EXPECT(scheduler->getShedCount() == 1);
+
+  KJ_ASSERT_NONNULL(env.pendingRun)->fulfill();
+  env.waitScope.poll();
+  env.advance(1 * kj::MINUTES);
+  KJ_ASSERT(env.runs.size() == 2);
+  KJ_EXPECT(env.runs[1] == FRIDAY + 3 * kj::MINUTES);
+}
+
+KJ_TEST("CronScheduler delays ticks by up to the jitter") {
+  TestEnv env(FRIDAY);
+  auto scheduler = env.makeScheduler("*/5 * * * *", 10 * kj::SECONDS);
+  env.waitScope.poll();
+
+  // FakeEntropySource makes the jitter 3.47 seconds.
+  env.advance(5 * kj::MINUTES + 3 * kj::SECONDS);
+  KJ_EXPECT(env.runs.size() == 0);
+  env.advance(1 * kj::SECONDS);
+  KJ_ASSERT(env.runs.size() == 1);
+
+  // The handler still sees the tick's own time.
+  KJ_EXPECT(env.runs[0] == FRIDAY + 5 * kj::MINUTES);
+}
+
+}  // namespace
+}  // namespace workerd::server
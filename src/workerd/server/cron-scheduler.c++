@@ -0,0 +1,304 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "cron-scheduler.h"
+
+#include <kj/debug.h>
+
+namespace workerd::server {
+
+namespace {
+
+constexpr int64_t MINUTES_PER_DAY = 24 * 60;
+
+// How far ahead next() looks for a match. Leap days can be eight years apart.
+constexpr int64_t MAX_SEARCH_DAYS = 366 * 9;
+
+constexpr kj::StringPtr MONTH_NAMES[] = {
+  "JAN"_kj, "FEB"_kj, "MAR"_kj, "APR"_kj, "MAY"_kj, "JUN"_kj,
+  "JUL"_kj, "AUG"_kj, "SEP"_kj, "OCT"_kj, "NOV"_kj, "DEC"_kj,
+};
+constexpr kj::StringPtr DAY_NAMES[] = {
+  "SUN"_kj, "MON"_kj, "TUE"_kj, "WED"_kj, "THU"_kj, "FRI"_kj, "SAT"_kj,
+};
+
+kj::ArrayPtr<const char> split(kj::ArrayPtr<const char>& text, char c) {
+  for (auto i: kj::indices(text)) {
+    if (text[i] == c) {
+      kj::ArrayPtr<const char> result = text.first(i);
+      text = text.slice(i + 1, text.size());
+      return result;
+    }
+  }
+  auto result = text;
+  text = {};
+  return result;
+}
+
+// Parses a number or, if `names` is given, a case-insensitive name whose index is offset by `min`.
+kj::Maybe<uint> parseValue(
+    kj::ArrayPtr<const char> text, uint min, kj::ArrayPtr<const kj::StringPtr> names) {
+  for (auto i: kj::indices(names)) {
+    auto name = names[i];
+    if (text.size() != name.size()) continue;
+    bool equal = true;
+    for (auto j: kj::indices(text)) {
+      char c = text[j];
+      if (c >= 'a' && c <= 'z') c -= 'a' - 'A';
+      if (c != name[j]) {
+        equal = false;
+        break;
+      }
+    }
+    if (equal) return min + i;
+  }
+
+  if (text.size() == 0 || text.size() > 2) return kj::none;
+  uint value = 0;
+  for (char c: text) {
+    if (c < '0' || c > '9') return kj::none;
+    value = value * 10 + (c - '0');
+  }
+  return value;
+}
+
+// Parses one field into a bit set of the values in [min, max] it allows.
+kj::Maybe<uint64_t> parseField(
+    kj::ArrayPtr<const char> field, uint min, uint max, kj::ArrayPtr<const kj::StringPtr> names) {
+  uint64_t bits = 0;
+  while (field.size() > 0) {
+    auto item = split(field, ',');
+    auto range = split(item, '/');
+    auto stepText = item;
+
+    uint first, last;
+    if (range == "*"_kj.asArray()) {
+      first = min;
+      last = max;
+    } else {
+      auto size = range.size();
+      auto firstText = split(range, '-');
+      first = KJ_UNWRAP_OR(parseValue(firstText, min, names), return kj::none);
+      if (firstText.size() < size) {
+        last = KJ_UNWRAP_OR(parseValue(range, min, names), return kj::none);
+      } else if (stepText.size() > 0) {
+        // `5/15` means every 15 starting at 5.
+        last = max;
+      } else {
+        last = first;
+      }
+    }
+
+    uint step = 1;
+    if (stepText.size() > 0) {
+      step = KJ_UNWRAP_OR(parseValue(stepText, 0, nullptr), return kj::none);
+    }
+    if (first < min || last > max || first > last || step == 0) return kj::none;
+
+    for (uint value = first; value <= last; value += step) {
+      bits |= uint64_t(1) << value;
+    }
+  }
+  if (bits == 0) return kj::none;
+  return bits;
+}
+
+// Converts days since the Unix epoch to a proleptic Gregorian date, and back. See
+// http://howardhinnant.github.io/date_algorithms.html.
+struct CivilDate {
+  int64_t year;
+  uint month;  // 1-12
+  uint day;    // 1-31
+};
+
+CivilDate civilFromDays(int64_t days) {
+  days += 719468;
+  int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+  uint64_t dayOfEra = days - era * 146097;
+  uint64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+  uint64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+  uint64_t monthIndex = (5 * dayOfYear + 2) / 153;
+  uint day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+  uint month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+  return {.year = int64_t(yearOfEra) + era * 400 + (month <= 2), .month = month, .day = day};
+}
+
+int64_t daysFromCivil(int64_t year, uint month, uint day) {
+  year -= month <= 2;
+  int64_t era = (year >= 0 ? year : year - 399) / 400;
+  uint64_t yearOfEra = year - era * 400;
+  uint64_t dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+  uint64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+  return era * 146097 + int64_t(dayOfEra) - 719468;
+}
+
+uint dayOfWeek(int64_t days) {
+  // 1970-01-01 was a Thursday.
+  return ((days + 4) % 7 + 7) % 7;
+}
+
+}  // namespace
+
+kj::Maybe<CronSchedule> CronSchedule::parse(kj::StringPtr text) {
+  if (text.startsWith("@")) {
+    if (text == "@yearly" || text == "@annually") return parse("0 0 1 1 *");
+    if (text == "@monthly") return parse("0 0 1 * *");
+    if (text == "@weekly") return parse("0 0 * * 0");
+    if (text == "@daily" || text == "@midnight") return parse("0 0 * * *");
+    if (text == "@hourly") return parse("0 * * * *");
+    return kj::none;
+  }
+
+  kj::ArrayPtr<const char> fields[5];
+  uint count = 0;
+  auto rest = text.asArray();
+  while (rest.size() > 0) {
+    auto field = split(rest, ' ');
+    if (field.size() == 0) continue;
+    if (count == kj::size(fields)) return kj::none;
+    fields[count++] = field;
+  }
+  if (count != kj::size(fields)) return kj::none;
+
+  CronSchedule result;
+  result.minutes = KJ_UNWRAP_OR(parseField(fields[0], 0, 59, nullptr), return kj::none);
+  result.hours = KJ_UNWRAP_OR(parseField(fields[1], 0, 23, nullptr), return kj::none);
+  result.daysOfMonth = KJ_UNWRAP_OR(parseField(fields[2], 1, 31, nullptr), return kj::none);
+  result.months = KJ_UNWRAP_OR(parseField(fields[3], 1, 12, MONTH_NAMES), return kj::none);
+  auto daysOfWeek = KJ_UNWRAP_OR(parseField(fields[4], 0, 7, DAY_NAMES), return kj::none);
+  // Sunday can be written as 7.
+  result.daysOfWeek = (daysOfWeek | daysOfWeek >> 7) & 0x7f;
+
+  result.daysOfMonthRestricted = fields[2][0] != '*';
+  result.daysOfWeekRestricted = fields[4][0] != '*';
+  return result;
+}
+
+bool CronSchedule::matchesDay(uint dayOfMonth, uint dayOfWeek) const {
+  bool domMatches = daysOfMonth >> dayOfMonth & 1;
+  bool dowMatches = daysOfWeek >> dayOfWeek & 1;
+  if (daysOfMonthRestricted && daysOfWeekRestricted) {
+    return domMatches || dowMatches;
+  }
+  return domMatches && dowMatches;
+}
+
+kj::Maybe<kj::Date> CronSchedule::next(kj::Date after) const {
+  // The first whole minute after `after`.
+  int64_t start = (after - kj::UNIX_EPOCH) / kj::MINUTES;
+  if (after >= kj::UNIX_EPOCH + start * kj::MINUTES) ++start;
+
+  int64_t day = start / MINUTES_PER_DAY;
+  int64_t remainder = start % MINUTES_PER_DAY;
+  if (remainder < 0) {
+    --day;
+    remainder += MINUTES_PER_DAY;
+  }
+  uint minuteOfDay = remainder;
+
+  int64_t endDay = day + MAX_SEARCH_DAYS;
+  for (; day < endDay; ++day, minuteOfDay = 0) {
+    auto date = civilFromDays(day);
+    if (!(months >> date.month & 1)) {
+      // Skip to the last day of the month, so that the loop moves on to the next one.
+      day = date.month == 12 ? daysFromCivil(date.year + 1, 1, 1) - 1
+                             : daysFromCivil(date.year, date.month + 1, 1) - 1;
+      continue;
+    }
+    if (!matchesDay(date.day, dayOfWeek(day))) continue;
+
+    for (uint hour = minuteOfDay / 60; hour < 24; ++hour) {
+      if (!(hours >> hour & 1)) continue;
+      uint minute = hour == minuteOfDay / 60 ? minuteOfDay % 60 : 0;
+      for (; minute < 60; ++minute) {
+        if (minutes >> minute & 1) {
+          return kj::UNIX_EPOCH + (day * MINUTES_PER_DAY + hour * 60 + minute) * kj::MINUTES;
+        }
+      }
+    }
+  }
+  return kj::none;
+}
+
+// =======================================================================================
+
+CronScheduler::CronScheduler(const kj::Clock& clock,
+    kj::Timer& timer,
+    kj::EntropySource& entropySource,
+    kj::Duration maxJitter,
+    kj::Array<Trigger> triggersParam,
+    RunFn run)
+    : clock(clock),
+      timer(timer),
+      entropySource(entropySource),
+      maxJitter(maxJitter),
+      run(kj::mv(run)),
+      triggers(KJ_MAP(t, triggersParam) { return TriggerState{.trigger = kj::mv(t)}; }),
+      tasks(*this) {
+  for (auto& state: triggers) {
+    tasks.add(loop(state));
+  }
+}
+
+kj::Promise<void> CronScheduler::loop(TriggerState& state) {
+  auto& schedule = state.trigger.schedule;
+  kj::StringPtr cron = state.trigger.cron;
+
+  kj::Maybe<kj::Date> upcoming = schedule.next(clock.now());
+  if (upcoming == kj::none) {
+    KJ_LOG(WARNING, "cron trigger never fires", cron);
+  }
+
+  while (upcoming != kj::none) {
+    auto next = KJ_ASSERT_NONNULL(upcoming);
+    auto following = schedule.next(next);
+    auto jitterLimit = following.map([&](kj::Date f) { return f - next; }).orDefault(maxJitter);
+    auto fireAt = next + pickJitter(jitterLimit);
+
+    // The timer may run a little behind the clock, so check the clock again and wait some more
+    // if it's too early.
+    for (auto now = clock.now(); now < fireAt; now = clock.now()) {
+      co_await timer.afterDelay(fireAt - now);
+    }
+
+    // If we woke up so late that later ticks are due too, run once, for the latest of them.
+    auto now = clock.now();
+    for (;;) {
+      KJ_IF_SOME(f, following) {
+        if (f <= now) {
+          ++coalescedCount;
+          next = f;
+          following = schedule.next(f);
+          continue;
+        }
+      }
+      break;
+    }
+
+    if (state.running) {
+      ++shedCount;
+      KJ_LOG(WARNING, "skipping cron tick, previous run is still going", cron);
+    } else {
+      state.running = true;
+      tasks.add(run(next, cron).attach(kj::defer([&state]() { state.running = false; })));
+    }
+
+    upcoming = following;
+  }
+}
+
+kj::Duration CronScheduler::pickJitter(kj::Duration limit) {
+  auto range = kj::min(maxJitter, limit - 1 * kj::MILLISECONDS);
+  if (range <= 0 * kj::SECONDS) return 0 * kj::SECONDS;
+
+  uint64_t random;
+  entropySource.generate(kj::arrayPtr(&random, 1).asBytes());
+  return int64_t(random % uint64_t(range / kj::MILLISECONDS + 1)) * kj::MILLISECONDS;
+}
+
+void CronScheduler::taskFailed(kj::Exception&& exception) {
+  KJ_LOG(ERROR, "cron trigger failed", exception);
+}
+
+}  // namespace workerd::server
@@ -0,0 +1,107 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <kj/async.h>
+#include <kj/common.h>
+#include <kj/function.h>
+#include <kj/string.h>
+#include <kj/time.h>
+#include <kj/timer.h>
+
+namespace workerd::server {
+
+// A cron expression with the usual five fields: minute, hour, day of month, month and day of
+// week, evaluated in UTC. Each field accepts `*`, numbers, ranges (`1-5`), steps (`*/15`,
+// `0-30/10`) and comma-separated lists of those. Months and days of week can also be named
+// (`JAN`, `MON`), and Sunday is either 0 or 7. The macros `@yearly`, `@monthly`, `@weekly`,
+// `@daily` and `@hourly` are accepted too.
+//
+// As in cron, if both the day of month and the day of week are restricted, a day matches if
+// either does.
+class CronSchedule {
+ public:
+  // Returns kj::none if `text` isn't a valid expression.
+  static kj::Maybe<CronSchedule> parse(kj::StringPtr text);
+
+  // Returns the first matching minute strictly after `after`, or kj::none if there is none in the
+  // next few years (e.g. `0 0 30 2 *`).
+  kj::Maybe<kj::Date> next(kj::Date after) const;
+
+ private:
+  // Bit sets of the values allowed in each field.
+  uint64_t minutes = 0;      // 0-59
+  uint32_t hours = 0;        // 0-23
+  uint32_t daysOfMonth = 0;  // 1-31
+  uint16_t months = 0;       // 1-12
+  uint8_t daysOfWeek = 0;    // 0-6, Sunday first
+
+  bool daysOfMonthRestricted = false;
+  bool daysOfWeekRestricted = false;
+
+  bool matchesDay(uint dayOfMonth, uint dayOfWeek) const;
+};
+
+// Calls a Worker's scheduled() handler on its cron triggers, see `Worker.cron` in workerd.capnp.
+//
+// Each trigger waits on the timer for its next tick, like AlarmScheduler does for alarms. When a
+// tick is late because the process stalled (or the machine slept), all the ticks that were missed
+// are coalesced into one run for the latest of them. A tick is skipped, rather than queued, if
+// the trigger's previous run hasn't finished yet.
+class CronScheduler final: private kj::TaskSet::ErrorHandler {
+ public:
+  // Runs the scheduled() handler for a tick of `cron`.
+  using RunFn = kj::Function<kj::Promise<void>(kj::Date scheduledTime, kj::StringPtr cron)>;
+
+  struct Trigger {
+    kj::String cron;
+    CronSchedule schedule;
+  };
+
+  // Each tick is delayed by a random amount up to `maxJitter`, so that services sharing a schedule
+  // don't all run at the same moment. The jitter is kept below the gap to the following tick.
+  CronScheduler(const kj::Clock& clock,
+      kj::Timer& timer,
+      kj::EntropySource& entropySource,
+      kj::Duration maxJitter,
+      kj::Array<Trigger> triggers,
+      RunFn run);
+  KJ_DISALLOW_COPY_AND_MOVE(CronScheduler);
+
+  // The number of ticks that didn't run, because they were coalesced with a later tick or the
+  // previous run was still going.
+  uint64_t getCoalescedCount() const {
+    return coalescedCount;
+  }
+  uint64_t getShedCount() const {
+    return shedCount;
+  }
+
+ private:
+  struct TriggerState {
+    Trigger trigger;
+    bool running = false;
+  };
+
+  const kj::Clock& clock;
+  kj::Timer& timer;
+  kj::EntropySource& entropySource;
+  kj::Duration maxJitter;
+  RunFn run;
+  kj::Array<TriggerState> triggers;
+
+  uint64_t coalescedCount = 0;
+  uint64_t shedCount = 0;
+
+  // The trigger loops, and the runs they start.
+  kj::TaskSet tasks;
+
+  kj::Promise<void> loop(TriggerState& state);
+  kj::Duration pickJitter(kj::Duration limit);
+
+  void taskFailed(kj::Exception&& exception) override;
+};
+
+}  // namespace workerd::server
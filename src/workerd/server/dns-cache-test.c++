@@ -0,0 +1,245 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "dns-cache.h"
+
+#include <kj/test.h>
+#include <kj/vector.h>
+
+namespace workerd::server {
+namespace {
+
+ResolvedAddress v4(kj::byte last) {
+  ResolvedAddress result;
+  result.bytes[0] = 192;
+  result.bytes[1] = 0;
+  result.bytes[2] = 2;
+  result.bytes[3] = last;
+  return result;
+}
+
+ResolvedAddress v6(kj::byte last) {
+  ResolvedAddress result;
+  result.ipv6 = true;
+  result.bytes[0] = 0x20;
+  result.bytes[1] = 0x01;
+  result.bytes[15] = last;
+  return result;
+}
+
+class FakeResolver final: public DnsCache::Resolver {
+ public:
+  mutable uint lookups = 0;
+  mutable bool fail = false;
+  mutable kj::byte next = 1;
+
+  kj::Promise<kj::Array<ResolvedAddress>> lookup(kj::StringPtr host) const override {
+    ++lookups;
+    if (fail) return KJ_EXCEPTION(FAILED, "DNS lookup failed.", host);
+    return kj::arr(v4(next++));
+  }
+};
+
+struct CacheEnv {
+  kj::EventLoop loop;
+  kj::WaitScope waitScope;
+  kj::TimerImpl timer;
+  FakeResolver resolver;
+  DnsCache cache;
+
+  explicit CacheEnv(DnsCache::Options options = {})
+      : waitScope(loop),
+        timer(kj::origin<kj::TimePoint>()),
+        cache(timer, resolver, options) {}
+
+  ResolvedAddress lookup(kj::StringPtr host) {
+    auto addresses = cache.lookup(host).wait(waitScope);
+    KJ_ASSERT(addresses.size() == 1);
+    return addresses[0];
+  }
+
+  void advance(kj::Duration duration) {
+    timer.advanceTo(timer.now() + duration);
+  }
+};
+
+KJ_TEST("DnsCache answers from the cache until the TTL is up") {
+  CacheEnv env;
+
+  KJ_EXPECT(env.lookup("example.com") == v4(1));
+  KJ_EXPECT(env.lookup("EXAMPLE.com") == v4(1));
+  env.advance(29 * kj::SECONDS);
+  KJ_EXPECT(env.lookup("example.com") == v4(1));
+  KJ_EXPECT(env.resolver.lookups == 1);
+
+  env.advance(1 * kj::SECONDS);
+  KJ_EXPECT(env.lookup("example.com") == v4(2));
+  KJ_EXPECT(env.resolver.lookups == 2);
+}
+
+KJ_TEST("DnsCache caches failed lookups briefly") {
+  CacheEnv env;
+  env.resolver.fail = true;
+
+  KJ_EXPECT_THROW_MESSAGE("DNS lookup failed", env.lookup("example.com"));
+  KJ_EXPECT_THROW_MESSAGE("DNS lookup failed", env.lookup("example.com"));
+  KJ_EXPECT(env.resolver.lookups == 1);
+
+  env.resolver.fail = false;
+  env.advance(5 * kj::SECONDS);
+  KJ_EXPECT(env.lookup("example.com") == v4(1));
+  KJ_EXPECT(env.resolver.lookups == 2);
+}
+
+KJ_TEST("DnsCache serves stale answers when a lookup fails") {
+  CacheEnv env;
+  KJ_EXPECT(env.lookup("example.com") == v4(1));
+
+  env.resolver.fail = true;
+  env.advance(30 * kj::SECONDS);
+  KJ_EXPECT(env.lookup("example.com") == v4(1));
+  KJ_EXPECT(env.resolver.lookups == 2);
+
+  // The resolver isn't asked again until the negative TTL is up.
+  env.advance(4 * kj::SECONDS);
+  KJ_EXPECT(env.lookup("example.com") == v4(1));
+  KJ_EXPECT(env.resolver.lookups == 2);
+  env.advance(1 * kj::SECONDS);
+  KJ_EXPECT(env.lookup("example.com") == v4(1));
+  KJ_EXPECT(env.resolver.lookups == 3);
+
+  // Once the stale window has passed, the failure shows.
+  env.advance(5 * kj::MINUTES);
+  KJ_EXPECT_THROW_MESSAGE("DNS lookup failed", env.lookup("example.com"));
+}
+
+KJ_TEST("DnsCache drops the least recently used host when full") {
+  CacheEnv env({.maxEntries = 2});
+
+  KJ_EXPECT(env.lookup("a.example") == v4(1));
+  env.advance(1 * kj::SECONDS);
+  KJ_EXPECT(env.lookup("b.example") == v4(2));
+  env.advance(1 * kj::SECONDS);
+  KJ_EXPECT(env.lookup("a.example") == v4(1));
+  env.advance(1 * kj::SECONDS);
+  KJ_EXPECT(env.lookup("c.example") == v4(3));
+
+  KJ_EXPECT(env.lookup("a.example") == v4(1));
+  KJ_EXPECT(env.lookup("b.example") == v4(4));
+}
+
+KJ_TEST("interleaveFamilies alternates, starting with the preferred family") {
+  auto ordered = interleaveFamilies(kj::arr(v6(1), v6(2), v6(3), v4(1)));
+  KJ_ASSERT(ordered.size() == 4);
+  KJ_EXPECT(ordered[0] == v6(1));
+  KJ_EXPECT(ordered[1] == v4(1));
+  KJ_EXPECT(ordered[2] == v6(2));
+  KJ_EXPECT(ordered[3] == v6(3));
+
+  ordered = interleaveFamilies(kj::arr(v4(1), v4(2), v6(1), v6(2)));
+  KJ_EXPECT(ordered[0] == v4(1));
+  KJ_EXPECT(ordered[1] == v6(1));
+  KJ_EXPECT(ordered[2] == v4(2));
+  KJ_EXPECT(ordered[3] == v6(2));
+}
+
+// =======================================================================================
+
+// An address whose connections succeed, fail or hang depending on its name.
+class FakeAddress final: public kj::NetworkAddress {
+ public:
+  FakeAddress(kj::StringPtr name, kj::Vector<kj::String>& attempts)
+      : name(name),
+        attempts(attempts) {}
+
+  kj::Promise<kj::Own<kj::AsyncIoStream>> connect() override {
+    attempts.add(kj::str(name));
+    if (name.startsWith("ok")) {
+      auto pipe = kj::newTwoWayPipe();
+      return kj::mv(pipe.ends[0]);
+    } else if (name.startsWith("fail")) {
+      return KJ_EXCEPTION(DISCONNECTED, "connection refused", name);
+    } else {
+      return kj::NEVER_DONE;
+    }
+  }
+
+  kj::Own<kj::ConnectionReceiver> listen() override {
+    KJ_UNIMPLEMENTED("unused");
+  }
+  kj::Own<kj::NetworkAddress> clone() override {
+    return kj::heap<FakeAddress>(name, attempts);
+  }
+  kj::String toString() override {
+    return kj::str(name);
+  }
+
+ private:
+  kj::StringPtr name;
+  kj::Vector<kj::String>& attempts;
+};
+
+struct RaceEnv {
+  kj::EventLoop loop;
+  kj::WaitScope waitScope;
+  kj::TimerImpl timer;
+  kj::Vector<kj::String> attempts;
+
+  RaceEnv(): waitScope(loop), timer(kj::origin<kj::TimePoint>()) {}
+
+  kj::Own<kj::NetworkAddress> makeAddress(std::initializer_list<kj::StringPtr> names) {
+    auto builder = kj::heapArrayBuilder<kj::Own<kj::NetworkAddress>>(names.size());
+    for (auto name: names) {
+      builder.add(kj::heap<FakeAddress>(name, attempts));
+    }
+    return newHappyEyeballsAddress(timer, builder.finish());
+  }
+
+  void advance(kj::Duration duration) {
+    timer.advanceTo(timer.now() + duration);
+    waitScope.poll();
+  }
+};
+
+KJ_TEST("happy eyeballs tries the next address after the attempt delay") {
+  RaceEnv env;
+  auto address = env.makeAddress({"hang", "ok"});
+  auto promise = address->connect();
+  env.waitScope.poll();
+  KJ_EXPECT(env.attempts.size() == 1);
+
+  env.advance(CONNECTION_ATTEMPT_DELAY - 1 * kj::MILLISECONDS);
+  KJ_EXPECT(env.attempts.size() == 1);
+  KJ_EXPECT(!promise.poll(env.waitScope));
+
+  env.advance(1 * kj::MILLISECONDS);
+  KJ_ASSERT(env.attempts.size() == 2);
+  KJ_EXPECT(env.attempts[1] == "ok");
+  promise.wait(env.waitScope);
+}
+
+KJ_TEST("happy eyeballs moves on as soon as an attempt fails") {
+  RaceEnv env;
+  auto address = env.makeAddress({"fail1", "fail2", "ok"});
+  auto promise = address->connect();
+  env.waitScope.poll();
+  KJ_EXPECT(env.attempts.size() == 3);
+  promise.wait(env.waitScope);
+}
+
+KJ_TEST("happy eyeballs fails only once every attempt has failed") {
+  RaceEnv env;
+  auto address = env.makeAddress({"hang", "fail1", "fail2"});
+  auto promise = address->connect();
+
+  env.advance(CONNECTION_ATTEMPT_DELAY);
+  KJ_EXPECT(env.attempts.size() == 3);
+  KJ_EXPECT(!promise.poll(env.waitScope));
+
+  address = env.makeAddress({"fail1", "fail2"});
+  KJ_EXPECT_THROW_MESSAGE("fail1", address->connect().wait(env.waitScope));
+}
+
+}  // namespace
+}  // namespace workerd::server
@@ -0,0 +1,428 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "dns-cache.h"
+
+#include <kj/debug.h>
+#include <kj/thread.h>
+#include <kj/vector.h>
+
+#include <cstring>
+
+#if _WIN32
+#include <ws2tcpip.h>
+#undef RELATIVE
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+namespace workerd::server {
+
+bool ResolvedAddress::operator==(const ResolvedAddress& other) const {
+  return ipv6 == other.ipv6 && scopeId == other.scopeId &&
+      memcmp(bytes, other.bytes, sizeof(bytes)) == 0;
+}
+
+namespace {
+
+kj::Array<ResolvedAddress> getAddrInfo(kj::StringPtr host) {
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_ADDRCONFIG;
+
+  struct addrinfo* list = nullptr;
+  int status = getaddrinfo(host.cStr(), nullptr, &hints, &list);
+#if !_WIN32
+  if (status == EAI_SYSTEM) {
+    KJ_FAIL_SYSCALL("getaddrinfo", errno, host);
+  }
+#endif
+  KJ_REQUIRE(status == 0, "DNS lookup failed.", host, gai_strerror(status));
+  KJ_DEFER(freeaddrinfo(list));
+
+  kj::Vector<ResolvedAddress> result;
+  for (auto cur = list; cur != nullptr; cur = cur->ai_next) {
+    ResolvedAddress address;
+    if (cur->ai_family == AF_INET) {
+      auto& sin = *reinterpret_cast<struct sockaddr_in*>(cur->ai_addr);
+      memcpy(address.bytes, &sin.sin_addr, sizeof(sin.sin_addr));
+    } else if (cur->ai_family == AF_INET6) {
+      auto& sin6 = *reinterpret_cast<struct sockaddr_in6*>(cur->ai_addr);
+      address.ipv6 = true;
+      address.scopeId = sin6.sin6_scope_id;
+      memcpy(address.bytes, &sin6.sin6_addr, sizeof(sin6.sin6_addr));
+    } else {
+      continue;
+    }
+
+    // Each address can come back once per protocol.
+    bool duplicate = false;
+    for (auto& other: result) {
+      if (other == address) {
+        duplicate = true;
+        break;
+      }
+    }
+    if (!duplicate) result.add(address);
+  }
+  KJ_REQUIRE(result.size() > 0, "DNS lookup found no addresses.", host);
+  return result.releaseAsArray();
+}
+
+// Looks hosts up with getaddrinfo(), which blocks, on a thread of its own per lookup -- the same
+// as kj::Network does. Lookups can take seconds, so they don't belong on the shared ThreadPool.
+class SystemResolver final: public DnsCache::Resolver {
+ public:
+  kj::Promise<kj::Array<ResolvedAddress>> lookup(kj::StringPtr host) const override {
+    auto paf = kj::newPromiseAndCrossThreadFulfiller<kj::Array<ResolvedAddress>>();
+    kj::Thread([host = kj::str(host), fulfiller = kj::mv(paf.fulfiller)]() mutable {
+      KJ_IF_SOME(exception, kj::runCatchingExceptions([&]() {
+        fulfiller->fulfill(getAddrInfo(host));
+      })) {
+        fulfiller->reject(kj::mv(exception));
+      }
+    }).detach();
+    return kj::mv(paf.promise);
+  }
+};
+
+kj::String toLower(kj::StringPtr text) {
+  auto result = kj::heapString(text);
+  for (char& c: result) {
+    if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+  }
+  return result;
+}
+
+}  // namespace
+
+DnsCache::DnsCache(const kj::MonotonicClock& clock, const Resolver& resolver, Options options)
+    : clock(clock),
+      resolver(resolver),
+      options(options) {}
+
+const DnsCache& DnsCache::getShared() {
+  // Intentionally leaked, like ThreadPool::getShared(), since lookups may still be running on
+  // their threads during static destruction.
+  static const DnsCache* cache =
+      new DnsCache(kj::systemCoarseMonotonicClock(), *new SystemResolver, {});
+  return *cache;
+}
+
+kj::Promise<kj::Array<ResolvedAddress>> DnsCache::lookup(kj::StringPtr hostParam) const {
+  auto host = toLower(hostParam);
+
+  KJ_IF_SOME(addresses, findFresh(host)) {
+    co_return kj::mv(addresses);
+  }
+
+  try {
+    auto addresses = co_await resolver.lookup(host);
+    store(host, kj::heapArray(addresses.asPtr()));
+    co_return kj::mv(addresses);
+  } catch (...) {
+    auto exception = kj::getCaughtExceptionAsKj();
+    KJ_IF_SOME(stale, storeFailure(host, exception)) {
+      co_return kj::mv(stale);
+    }
+    kj::throwFatalException(kj::mv(exception));
+  }
+}
+
+kj::Maybe<kj::Array<ResolvedAddress>> DnsCache::findFresh(kj::StringPtr host) const {
+  auto now = clock.now();
+  auto lock = entries.lockExclusive();
+  KJ_IF_SOME(entry, lock->find(host)) {
+    entry.lastUsed = now;
+    if (now < entry.expires) {
+      KJ_IF_SOME(error, entry.error) {
+        kj::throwFatalException(kj::cp(error));
+      }
+      return kj::heapArray(entry.addresses.asPtr());
+    }
+  }
+  return kj::none;
+}
+
+void DnsCache::store(kj::StringPtr host, kj::Array<ResolvedAddress> addresses) const {
+  auto now = clock.now();
+  auto lock = entries.lockExclusive();
+  makeRoom(*lock, host, now);
+  lock->upsert(kj::str(host),
+      Entry{
+        .addresses = kj::mv(addresses),
+        .expires = now + options.ttl,
+        .staleUntil = now + options.ttl + options.staleIfError,
+        .lastUsed = now,
+      },
+      [](Entry& existing, Entry&& replacement) { existing = kj::mv(replacement); });
+}
+
+kj::Maybe<kj::Array<ResolvedAddress>> DnsCache::storeFailure(
+    kj::StringPtr host, const kj::Exception& exception) const {
+  auto now = clock.now();
+  auto lock = entries.lockExclusive();
+  KJ_IF_SOME(entry, lock->find(host)) {
+    if (entry.error == kj::none && now < entry.staleUntil) {
+      // Keep serving the last good answer, and don't ask the resolver again until the negative TTL
+      // is up.
+      entry.expires = kj::min(now + options.negativeTtl, entry.staleUntil);
+      return kj::heapArray(entry.addresses.asPtr());
+    }
+  }
+
+  makeRoom(*lock, host, now);
+  lock->upsert(kj::str(host),
+      Entry{
+        .error = kj::cp(exception),
+        .expires = now + options.negativeTtl,
+        .staleUntil = now + options.negativeTtl,
+        .lastUsed = now,
+      },
+      [](Entry& existing, Entry&& replacement) { existing = kj::mv(replacement); });
+  return kj::none;
+}
+
+void DnsCache::makeRoom(
+    kj::HashMap<kj::String, Entry>& map, kj::StringPtr host, kj::TimePoint now) const {
+  if (map.size() < options.maxEntries || map.find(host) != kj::none) return;
+
+  // Scanning is fine here, since it only happens when the cache is full.
+  map.eraseAll([&](auto&, Entry& entry) { return entry.staleUntil <= now; });
+  while (map.size() >= options.maxEntries) {
+    kj::Maybe<kj::HashMap<kj::String, Entry>::Entry&> oldest;
+    for (auto& candidate: map) {
+      KJ_IF_SOME(o, oldest) {
+        if (candidate.value.lastUsed >= o.value.lastUsed) continue;
+      }
+      oldest = candidate;
+    }
+    auto victim = kj::str(KJ_ASSERT_NONNULL(oldest).key);
+    map.erase(victim);
+  }
+}
+
+// =======================================================================================
+
+namespace {
+
+// Runs one connect() or connectAuthenticated() race for HappyEyeballsAddress.
+template <typename T>
+class ConnectionRace final: private kj::TaskSet::ErrorHandler {
+ public:
+  using ConnectFn = kj::Function<kj::Promise<T>(kj::NetworkAddress&)>;
+
+  ConnectionRace(kj::Timer& timer,
+      kj::Array<kj::Own<kj::NetworkAddress>> addresses,
+      ConnectFn connectFn,
+      kj::Own<kj::PromiseFulfiller<T>> fulfiller)
+      : timer(timer),
+        addresses(kj::mv(addresses)),
+        connectFn(kj::mv(connectFn)),
+        fulfiller(kj::mv(fulfiller)),
+        tasks(*this) {}
+
+  void startNext() {
+    if (started == addresses.size()) return;
+    auto index = started++;
+    ++pending;
+
+    tasks.add(connectFn(*addresses[index]).then([this](T connection) {
+      // A later attempt that also succeeds is just dropped.
+      if (fulfiller->isWaiting()) fulfiller->fulfill(kj::mv(connection));
+    }, [this](kj::Exception&& exception) {
+      --pending;
+      if (error == kj::none) error = kj::mv(exception);
+      if (started < addresses.size()) {
+        startNext();
+      } else if (pending == 0 && fulfiller->isWaiting()) {
+        fulfiller->reject(kj::mv(KJ_ASSERT_NONNULL(error)));
+      }
+    }));
+
+    // Don't wait for this attempt to fail before trying the next address.
+    tasks.add(timer.afterDelay(CONNECTION_ATTEMPT_DELAY).then([this, index]() {
+      if (started == index + 1) startNext();
+    }));
+  }
+
+ private:
+  kj::Timer& timer;
+  kj::Array<kj::Own<kj::NetworkAddress>> addresses;
+  ConnectFn connectFn;
+  kj::Own<kj::PromiseFulfiller<T>> fulfiller;
+
+  size_t started = 0;
+  size_t pending = 0;
+
+  // The first attempt's error is usually the most informative.
+  kj::Maybe<kj::Exception> error;
+
+  // Destroying the race cancels the attempts still going.
+  kj::TaskSet tasks;
+
+  void taskFailed(kj::Exception&& exception) override {
+    KJ_LOG(ERROR, "happy eyeballs connection race failed", exception);
+  }
+};
+
+class HappyEyeballsAddress final: public kj::NetworkAddress {
+ public:
+  HappyEyeballsAddress(kj::Timer& timer, kj::Array<kj::Own<kj::NetworkAddress>> addresses)
+      : timer(timer),
+        addresses(kj::mv(addresses)) {
+    KJ_REQUIRE(this->addresses.size() > 0);
+  }
+
+  kj::Promise<kj::Own<kj::AsyncIoStream>> connect() override {
+    return race<kj::Own<kj::AsyncIoStream>>(
+        [](kj::NetworkAddress& address) { return address.connect(); });
+  }
+
+  kj::Promise<kj::AuthenticatedStream> connectAuthenticated() override {
+    return race<kj::AuthenticatedStream>(
+        [](kj::NetworkAddress& address) { return address.connectAuthenticated(); });
+  }
+
+  kj::Own<kj::ConnectionReceiver> listen() override {
+    return addresses[0]->listen();
+  }
+
+  kj::Own<kj::NetworkAddress> clone() override {
+    return kj::heap<HappyEyeballsAddress>(timer, cloneAddresses());
+  }
+
+  kj::String toString() override {
+    return addresses[0]->toString();
+  }
+
+ private:
+  kj::Timer& timer;
+  kj::Array<kj::Own<kj::NetworkAddress>> addresses;
+
+  kj::Array<kj::Own<kj::NetworkAddress>> cloneAddresses() {
+    return KJ_MAP(address, addresses) { return address->clone(); };
+  }
+
+  template <typename T>
+  kj::Promise<T> race(typename ConnectionRace<T>::ConnectFn connectFn) {
+    // The race gets its own copies of the addresses so that it doesn't depend on this object
+    // outliving it.
+    auto paf = kj::newPromiseAndFulfiller<T>();
+    auto state = kj::heap<ConnectionRace<T>>(
+        timer, cloneAddresses(), kj::mv(connectFn), kj::mv(paf.fulfiller));
+    state->startNext();
+    return paf.promise.attach(kj::mv(state));
+  }
+};
+
+// Splits `host[:port]` where the host is a name, rather than an IP address or something else kj
+// knows how to parse.
+struct HostAndPort {
+  kj::String host;
+  uint port;
+};
+
+kj::Maybe<HostAndPort> parseHostAndPort(kj::StringPtr addr, uint portHint) {
+  auto hostText = addr.asArray();
+  uint port = portHint;
+  KJ_IF_SOME(colon, addr.findLast(':')) {
+    hostText = addr.asArray().first(colon);
+    auto portText = addr.slice(colon + 1);
+    if (portText.size() == 0 || portText.size() > 5) return kj::none;
+    port = 0;
+    for (char c: portText) {
+      if (c < '0' || c > '9') return kj::none;
+      port = port * 10 + (c - '0');
+    }
+    if (port > 65535) return kj::none;
+  }
+  if (port == 0 || hostText.size() == 0) return kj::none;
+
+  // A name has at least one letter; that rules out IPv4 addresses. IPv6 addresses and "unix:",
+  // "*" and the like are ruled out by the allowed characters.
+  bool hasLetter = false;
+  for (char c: hostText) {
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+      hasLetter = true;
+    } else if (!((c >= '0' && c <= '9') || c == '.' || c == '-' || c == '_')) {
+      return kj::none;
+    }
+  }
+  if (!hasLetter) return kj::none;
+
+  return HostAndPort{.host = kj::str(hostText), .port = port};
+}
+
+}  // namespace
+
+kj::Own<kj::NetworkAddress> newHappyEyeballsAddress(
+    kj::Timer& timer, kj::Array<kj::Own<kj::NetworkAddress>> addresses) {
+  return kj::heap<HappyEyeballsAddress>(timer, kj::mv(addresses));
+}
+
+kj::Array<ResolvedAddress> interleaveFamilies(kj::ArrayPtr<const ResolvedAddress> addresses) {
+  if (addresses.size() == 0) return nullptr;
+
+  kj::Vector<ResolvedAddress> preferred;
+  kj::Vector<ResolvedAddress> other;
+  for (auto& address: addresses) {
+    (address.ipv6 == addresses[0].ipv6 ? preferred : other).add(address);
+  }
+
+  auto result = kj::heapArrayBuilder<ResolvedAddress>(addresses.size());
+  for (auto i: kj::zeroTo(kj::max(preferred.size(), other.size()))) {
+    if (i < preferred.size()) result.add(preferred[i]);
+    if (i < other.size()) result.add(other[i]);
+  }
+  return result.finish();
+}
+
+kj::Promise<kj::Own<kj::NetworkAddress>> DnsCachingNetwork::parseAddress(
+    kj::StringPtr addr, uint portHint) {
+  KJ_IF_SOME(parsed, parseHostAndPort(addr, portHint)) {
+    auto resolved = interleaveFamilies(co_await cache.lookup(parsed.host));
+    auto addresses = KJ_MAP(address, resolved) { return toNetworkAddress(address, parsed.port); };
+    if (addresses.size() == 1) co_return kj::mv(addresses[0]);
+    co_return newHappyEyeballsAddress(timer, kj::mv(addresses));
+  }
+  co_return co_await inner.parseAddress(addr, portHint);
+}
+
+kj::Own<kj::NetworkAddress> DnsCachingNetwork::getSockaddr(const void* sockaddr, uint len) {
+  return inner.getSockaddr(sockaddr, len);
+}
+
+kj::Own<kj::Network> DnsCachingNetwork::restrictPeers(
+    kj::ArrayPtr<const kj::StringPtr> allow, kj::ArrayPtr<const kj::StringPtr> deny) {
+  return kj::heap<DnsCachingNetwork>(inner.restrictPeers(allow, deny), timer, cache);
+}
+
+kj::Own<kj::NetworkAddress> DnsCachingNetwork::toNetworkAddress(
+    const ResolvedAddress& address, uint port) {
+  // Going through getSockaddr() keeps any restrictPeers() filter of the inner network in force.
+  if (address.ipv6) {
+    struct sockaddr_in6 sin6;
+    memset(&sin6, 0, sizeof(sin6));
+    sin6.sin6_family = AF_INET6;
+    sin6.sin6_port = htons(port);
+    sin6.sin6_scope_id = address.scopeId;
+    memcpy(&sin6.sin6_addr, address.bytes, sizeof(sin6.sin6_addr));
+    return inner.getSockaddr(&sin6, sizeof(sin6));
+  } else {
+    struct sockaddr_in sin;
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons(port);
+    memcpy(&sin.sin_addr, address.bytes, sizeof(sin.sin_addr));
+    return inner.getSockaddr(&sin, sizeof(sin));
+  }
+}
+
+}  // namespace workerd::server
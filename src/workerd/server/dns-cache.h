@@ -0,0 +1,127 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <kj/async-io.h>
+#include <kj/map.h>
+#include <kj/mutex.h>
+#include <kj/timer.h>
+
+namespace workerd::server {
+
+// An IPv4 or IPv6 address returned by a hostname lookup, without a port.
+struct ResolvedAddress {
+  bool ipv6 = false;
+  uint32_t scopeId = 0;     // IPv6 only.
+  kj::byte bytes[16] = {};  // The first 4 bytes for IPv4.
+
+  bool operator==(const ResolvedAddress& other) const;
+};
+
+// Caches hostname lookups for the whole process, so that outbound connections don't each wait on
+// the system resolver. Every thread's network shares the same cache.
+//
+// Failed lookups are cached too, for a shorter time. If a lookup fails after an earlier one
+// succeeded, the earlier answer keeps being served for a while (stale-if-error), since a resolver
+// hiccup is usually more likely than the origin having gone away.
+class DnsCache {
+ public:
+  class Resolver {
+   public:
+    // Looks up the addresses of `host`, in the order the system prefers them. Rejects if the
+    // lookup fails or finds nothing. Called from any thread that uses the cache.
+    virtual kj::Promise<kj::Array<ResolvedAddress>> lookup(kj::StringPtr host) const = 0;
+  };
+
+  struct Options {
+    // The system resolver doesn't report record TTLs, so every answer is kept for the same time.
+    kj::Duration ttl = 30 * kj::SECONDS;
+    kj::Duration negativeTtl = 5 * kj::SECONDS;
+
+    // How long past `ttl` an answer may still be served when looking it up again fails.
+    kj::Duration staleIfError = 5 * kj::MINUTES;
+
+    // When full, the least recently used host is dropped.
+    uint maxEntries = 4096;
+  };
+
+  DnsCache(const kj::MonotonicClock& clock, const Resolver& resolver, Options options);
+  KJ_DISALLOW_COPY_AND_MOVE(DnsCache);
+
+  // Returns the process-wide cache, backed by getaddrinfo(). It is never destroyed.
+  static const DnsCache& getShared();
+
+  // Thread-safe. Lookups that miss the cache at the same time each go to the resolver.
+  kj::Promise<kj::Array<ResolvedAddress>> lookup(kj::StringPtr host) const;
+
+ private:
+  struct Entry {
+    // Empty if the lookup failed, in which case `error` is set.
+    kj::Array<ResolvedAddress> addresses;
+    kj::Maybe<kj::Exception> error;
+
+    kj::TimePoint expires;
+    kj::TimePoint staleUntil;
+    kj::TimePoint lastUsed;
+  };
+
+  const kj::MonotonicClock& clock;
+  const Resolver& resolver;
+  Options options;
+  kj::MutexGuarded<kj::HashMap<kj::String, Entry>> entries;
+
+  kj::Maybe<kj::Array<ResolvedAddress>> findFresh(kj::StringPtr host) const;
+  void store(kj::StringPtr host, kj::Array<ResolvedAddress> addresses) const;
+  kj::Maybe<kj::Array<ResolvedAddress>> storeFailure(
+      kj::StringPtr host, const kj::Exception& exception) const;
+  void makeRoom(kj::HashMap<kj::String, Entry>& map, kj::StringPtr host, kj::TimePoint now) const;
+};
+
+// How long a connection attempt gets before the next address is tried alongside it, as
+// recommended by RFC 8305.
+constexpr kj::Duration CONNECTION_ATTEMPT_DELAY = 250 * kj::MILLISECONDS;
+
+// Returns an address whose connect() races `addresses` in order, "happy eyeballs" style (RFC
+// 8305): each attempt starts when the previous one fails or after CONNECTION_ATTEMPT_DELAY,
+// whichever comes first, and the first connection to succeed wins. listen() uses the first
+// address only.
+kj::Own<kj::NetworkAddress> newHappyEyeballsAddress(
+    kj::Timer& timer, kj::Array<kj::Own<kj::NetworkAddress>> addresses);
+
+// Orders addresses per RFC 8305 section 4: alternating between address families, starting with
+// the family of the first address.
+kj::Array<ResolvedAddress> interleaveFamilies(kj::ArrayPtr<const ResolvedAddress> addresses);
+
+// A kj::Network which looks hostnames up through a DnsCache, and connects to hosts with several
+// addresses using happy eyeballs. Numeric addresses, Unix sockets and anything else that isn't a
+// plain `host[:port]` are passed through to the inner network.
+class DnsCachingNetwork final: public kj::Network {
+ public:
+  DnsCachingNetwork(kj::Network& inner, kj::Timer& timer, const DnsCache& cache)
+      : inner(inner),
+        timer(timer),
+        cache(cache) {}
+  DnsCachingNetwork(kj::Own<kj::Network> inner, kj::Timer& timer, const DnsCache& cache)
+      : inner(*inner),
+        ownInner(kj::mv(inner)),
+        timer(timer),
+        cache(cache) {}
+
+  kj::Promise<kj::Own<kj::NetworkAddress>> parseAddress(
+      kj::StringPtr addr, uint portHint = 0) override;
+  kj::Own<kj::NetworkAddress> getSockaddr(const void* sockaddr, uint len) override;
+  kj::Own<kj::Network> restrictPeers(kj::ArrayPtr<const kj::StringPtr> allow,
+      kj::ArrayPtr<const kj::StringPtr> deny = nullptr) override;
+
+ private:
+  kj::Network& inner;
+  kj::Own<kj::Network> ownInner;
+  kj::Timer& timer;
+  const DnsCache& cache;
+
+  kj::Own<kj::NetworkAddress> toNetworkAddress(const ResolvedAddress& address, uint port);
+};
+
+}  // namespace workerd::server
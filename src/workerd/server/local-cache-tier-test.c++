@@ -0,0 +1,275 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "local-cache-tier.h"
+
+#include <workerd/util/stream-utils.h>
+
+#include <kj/async-io.h>
+#include <kj/test.h>
+#include <kj/timer.h>
+
+namespace workerd::server {
+namespace {
+
+// Stands in for the outbound cache service, answering lookups from a fixed set of objects.
+class FakeCache final: public kj::HttpClient {
+ public:
+  FakeCache(const ThreadContext::HeaderIdBundle& headerIds): headerIds(headerIds) {}
+
+  struct Object {
+    kj::String cacheControl;
+    kj::String body;
+    bool vary = false;
+  };
+
+  kj::HashMap<kj::String, Object> objects;
+  uint lookups = 0;
+  uint puts = 0;
+  uint purges = 0;
+
+  // If set, responses are held back until this resolves.
+  kj::Maybe<kj::ForkedPromise<void>> gate;
+
+  Request request(kj::HttpMethod method,
+      kj::StringPtr url,
+      const kj::HttpHeaders& headers,
+      kj::Maybe<uint64_t> expectedBodySize = kj::none) override {
+    if (method == kj::HttpMethod::PUT) {
+      ++puts;
+      return {newNullOutputStream(), respond(204, "No Content", nullptr, "")};
+    } else if (method == kj::HttpMethod::PURGE) {
+      ++purges;
+      objects.erase(url);
+      return {newNullOutputStream(), respond(200, "OK", nullptr, "")};
+    }
+
+    ++lookups;
+    kj::Promise<kj::HttpClient::Response> response = nullptr;
+    KJ_IF_SOME(object, objects.find(url)) {
+      response = respond(200, "OK", &object, object.body);
+    } else {
+      response = respond(504, "Gateway Timeout", nullptr, "");
+    }
+    KJ_IF_SOME(g, gate) {
+      return {newNullOutputStream(), g.addBranch().then([response = kj::mv(response)]() mutable {
+        return kj::mv(response);
+      })};
+    }
+    return {newNullOutputStream(), kj::mv(response)};
+  }
+
+ private:
+  const ThreadContext::HeaderIdBundle& headerIds;
+
+  kj::Promise<kj::HttpClient::Response> respond(
+      uint statusCode, kj::StringPtr statusText, Object* object, kj::StringPtr body) {
+    auto headers = kj::heap<kj::HttpHeaders>(headerIds.table);
+    if (object != nullptr) {
+      headers->setPtr(headerIds.cfCacheStatus, "HIT");
+      headers->set(headerIds.cacheControl, kj::str(object->cacheControl));
+      if (object->vary) {
+        headers->add("Vary", "Accept-Encoding");
+      }
+    } else {
+      headers->setPtr(headerIds.cfCacheStatus, "MISS");
+    }
+    // The object may be purged while the response is held back, so the body is copied.
+    auto bytes = kj::heapString(body);
+    auto& headersRef = *headers;
+    auto stream = newMemoryInputStream(bytes.asBytes());
+    return kj::HttpClient::Response{
+      .statusCode = statusCode,
+      .statusText = statusText,
+      .headers = &headersRef,
+      .body = stream.attach(kj::mv(headers), kj::mv(bytes)),
+    };
+  }
+};
+
+struct TestEnv {
+  kj::EventLoop loop;
+  kj::WaitScope waitScope;
+  kj::TimerImpl timer;
+  kj::HttpHeaderTable::Builder builder;
+  ThreadContext::HeaderIdBundle headerIds;
+  kj::Own<kj::HttpHeaderTable> table;
+  FakeCache outbound;
+  LocalCacheTier tier;
+  kj::Own<kj::HttpClient> client;
+
+  TestEnv(LocalCacheTier::Limits limits = {
+            .maxTotalSize = 1024,
+            .maxEntrySize = 64,
+            .maxTtl = 60 * kj::SECONDS,
+          })
+      : waitScope(loop),
+        timer(kj::origin<kj::TimePoint>()),
+        headerIds(builder),
+        table(builder.build()),
+        outbound(headerIds),
+        tier(limits, timer, headerIds),
+        client(tier.wrap(kj::str("test"), [this]() -> kj::Own<kj::HttpClient> {
+          return {&outbound, kj::NullDisposer::instance};
+        })) {}
+
+  kj::Promise<kj::HttpClient::Response> match(kj::StringPtr url) {
+    kj::HttpHeaders headers(*table);
+    headers.setPtr(headerIds.cacheControl, "only-if-cached");
+    return client->request(kj::HttpMethod::GET, url, headers, uint64_t(0)).response;
+  }
+
+  // Looks up `url` and returns the response body, or kj::none on a cache miss.
+  kj::Maybe<kj::String> matchText(kj::StringPtr url) {
+    auto response = match(url).wait(waitScope);
+    auto body = response.body->readAllText().wait(waitScope);
+    if (response.statusCode != 200) return kj::none;
+    return kj::mv(body);
+  }
+
+  void purge(kj::StringPtr url) {
+    kj::HttpHeaders headers(*table);
+    client->request(kj::HttpMethod::PURGE, url, headers, uint64_t(0)).response.wait(waitScope);
+  }
+};
+
+KJ_TEST("LocalCacheTier answers fresh hits locally") {
+  TestEnv env;
+  env.outbound.objects.insert(kj::str("https://example.com/a"),
+      {.cacheControl = kj::str("max-age=30"), .body = kj::str("A")});
+
+  KJ_EXPECT(KJ_ASSERT_NONNULL(env.matchText("https://example.com/a")) == "A");
+  KJ_EXPECT(env.outbound.lookups == 1);
+  KJ_EXPECT(env.tier.size() == 1);
+
+  KJ_EXPECT(KJ_ASSERT_NONNULL(env.matchText("https://example.com/a")) == "A");
+  KJ_EXPECT(env.outbound.lookups == 1);
+
+  // Misses are never kept.
+  KJ_EXPECT(env.matchText("https://example.com/missing") == kj::none);
+  KJ_EXPECT(env.matchText("https://example.com/missing") == kj::none);
+  KJ_EXPECT(env.outbound.lookups == 3);
+
+  // Once the response's lifetime has passed, the outbound service is asked again.
+  env.timer.advanceTo(env.timer.now() + 31 * kj::SECONDS);
+  KJ_EXPECT(KJ_ASSERT_NONNULL(env.matchText("https://example.com/a")) == "A");
+  KJ_EXPECT(env.outbound.lookups == 4);
+
+  // A purge drops the local copy before it reaches the outbound service.
+  env.purge("https://example.com/a");
+  KJ_EXPECT(env.outbound.purges == 1);
+  KJ_EXPECT(env.tier.size() == 0);
+  KJ_EXPECT(env.matchText("https://example.com/a") == kj::none);
+  KJ_EXPECT(env.outbound.lookups == 5);
+}
+
+KJ_TEST("LocalCacheTier caps lifetimes at maxTtl") {
+  TestEnv env({
+    .maxTotalSize = 1024,
+    .maxEntrySize = 64,
+    .maxTtl = 5 * kj::SECONDS,
+  });
+  env.outbound.objects.insert(kj::str("https://example.com/a"),
+      {.cacheControl = kj::str("public, s-maxage=300, max-age=1"), .body = kj::str("A")});
+
+  env.matchText("https://example.com/a");
+  env.timer.advanceTo(env.timer.now() + 4 * kj::SECONDS);
+  env.matchText("https://example.com/a");
+  KJ_EXPECT(env.outbound.lookups == 1);
+
+  env.timer.advanceTo(env.timer.now() + 1 * kj::SECONDS);
+  env.matchText("https://example.com/a");
+  KJ_EXPECT(env.outbound.lookups == 2);
+}
+
+KJ_TEST("LocalCacheTier only keeps small, explicitly fresh responses") {
+  TestEnv env;
+  env.outbound.objects.insert(kj::str("https://example.com/no-store"),
+      {.cacheControl = kj::str("max-age=30, no-store"), .body = kj::str("A")});
+  env.outbound.objects.insert(kj::str("https://example.com/no-lifetime"),
+      {.cacheControl = kj::str("public"), .body = kj::str("A")});
+  env.outbound.objects.insert(kj::str("https://example.com/large"),
+      {.cacheControl = kj::str("max-age=30"), .body = kj::str(kj::repeat('x', 65))});
+  env.outbound.objects.insert(kj::str("https://example.com/vary"),
+      {.cacheControl = kj::str("max-age=30"), .body = kj::str("A"), .vary = true});
+
+  for (auto url: {"https://example.com/no-store"_kj, "https://example.com/no-lifetime"_kj,
+         "https://example.com/large"_kj, "https://example.com/vary"_kj}) {
+    KJ_EXPECT(env.matchText(url) != kj::none, url);
+    KJ_EXPECT(env.matchText(url) != kj::none, url);
+  }
+  KJ_EXPECT(env.outbound.lookups == 8);
+  KJ_EXPECT(env.tier.size() == 0);
+}
+
+KJ_TEST("LocalCacheTier evicts least recently used responses") {
+  TestEnv env({
+    .maxTotalSize = 100,
+    .maxEntrySize = 64,
+    .maxTtl = 60 * kj::SECONDS,
+  });
+  for (auto name: {"a", "b", "c"}) {
+    env.outbound.objects.insert(kj::str("https://example.com/", name),
+        {.cacheControl = kj::str("max-age=30"), .body = kj::str(kj::repeat('x', 20))});
+  }
+
+  // Each entry counts 28 bytes of key and 20 bytes of body, so only two fit.
+  env.matchText("https://example.com/a");
+  env.matchText("https://example.com/b");
+  env.matchText("https://example.com/a");
+  env.matchText("https://example.com/c");
+  KJ_EXPECT(env.tier.size() == 2);
+  KJ_EXPECT(env.tier.getTotalSize() <= 100);
+  KJ_EXPECT(env.outbound.lookups == 3);
+
+  env.matchText("https://example.com/a");
+  KJ_EXPECT(env.outbound.lookups == 3);
+  env.matchText("https://example.com/b");
+  KJ_EXPECT(env.outbound.lookups == 4);
+}
+
+KJ_TEST("LocalCacheTier coalesces concurrent lookups") {
+  TestEnv env;
+  env.outbound.objects.insert(kj::str("https://example.com/a"),
+      {.cacheControl = kj::str("max-age=30"), .body = kj::str("A")});
+  auto gate = kj::newPromiseAndFulfiller<void>();
+  env.outbound.gate = gate.promise.fork();
+
+  auto first = env.match("https://example.com/a");
+  auto second = env.match("https://example.com/a");
+  auto third = env.match("https://example.com/a");
+  KJ_EXPECT(!first.poll(env.waitScope));
+  KJ_EXPECT(env.outbound.lookups == 1);
+
+  gate.fulfiller->fulfill();
+  for (auto promise: {&first, &second, &third}) {
+    auto response = promise->wait(env.waitScope);
+    KJ_EXPECT(response.statusCode == 200);
+    KJ_EXPECT(response.body->readAllText().wait(env.waitScope) == "A");
+  }
+  KJ_EXPECT(env.outbound.lookups == 1);
+}
+
+KJ_TEST("LocalCacheTier doesn't keep responses that race with a purge") {
+  TestEnv env;
+  env.outbound.objects.insert(kj::str("https://example.com/a"),
+      {.cacheControl = kj::str("max-age=30"), .body = kj::str("A")});
+  auto gate = kj::newPromiseAndFulfiller<void>();
+  env.outbound.gate = gate.promise.fork();
+
+  auto lookup = env.match("https://example.com/a");
+  KJ_EXPECT(!lookup.poll(env.waitScope));
+  {
+    kj::HttpHeaders headers(*env.table);
+    env.client->request(kj::HttpMethod::PURGE, "https://example.com/a", headers, uint64_t(0));
+  }
+
+  gate.fulfiller->fulfill();
+  auto response = lookup.wait(env.waitScope);
+  KJ_EXPECT(response.body->readAllText().wait(env.waitScope) == "A");
+  KJ_EXPECT(env.tier.size() == 0);
+}
+
+}  // namespace
+}  // namespace workerd::server
@@ -0,0 +1,307 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "local-cache-tier.h"
+
+#include <workerd/util/stream-utils.h>
+
+#include <kj/debug.h>
+
+namespace workerd::server {
+
+namespace {
+
+bool equalsIgnoreCase(kj::ArrayPtr<const char> a, kj::StringPtr b) {
+  if (a.size() != b.size()) return false;
+  for (auto i: kj::indices(a)) {
+    char ca = a[i], cb = b[i];
+    if ('A' <= ca && ca <= 'Z') ca += 'a' - 'A';
+    if ('A' <= cb && cb <= 'Z') cb += 'a' - 'A';
+    if (ca != cb) return false;
+  }
+  return true;
+}
+
+kj::ArrayPtr<const char> trim(kj::ArrayPtr<const char> str) {
+  while (str.size() > 0 && (str.front() == ' ' || str.front() == '\t')) str = str.slice(1);
+  while (str.size() > 0 && (str.back() == ' ' || str.back() == '\t')) {
+    str = str.first(str.size() - 1);
+  }
+  return str;
+}
+
+bool hasHeader(const kj::HttpHeaders& headers, kj::StringPtr name) {
+  bool found = false;
+  headers.forEach([&](kj::StringPtr headerName, kj::StringPtr) {
+    if (equalsIgnoreCase(headerName, name)) found = true;
+  });
+  return found;
+}
+
+kj::Maybe<kj::StringPtr> findHeader(const kj::HttpHeaders& headers, kj::StringPtr name) {
+  kj::Maybe<kj::StringPtr> result;
+  headers.forEach([&](kj::StringPtr headerName, kj::StringPtr value) {
+    if (equalsIgnoreCase(headerName, name)) result = value;
+  });
+  return result;
+}
+
+// Returns whether a request is a Cache API lookup whose response doesn't depend on anything but
+// the URL, i.e. that isn't a range or conditional request.
+bool isLocalLookup(const kj::HttpHeaders& headers, const ThreadContext::HeaderIdBundle& headerIds) {
+  auto cacheControl = KJ_UNWRAP_OR(headers.get(headerIds.cacheControl), return false);
+  if (cacheControl != "only-if-cached"_kj) {
+    return false;
+  }
+  bool dependsOnHeaders = false;
+  headers.forEach([&](kj::StringPtr name, kj::StringPtr) {
+    if (equalsIgnoreCase(name, "range"_kj) ||
+        (name.size() > 3 && equalsIgnoreCase(name.asArray().first(3), "if-"_kj))) {
+      dependsOnHeaders = true;
+    }
+  });
+  return !dependsOnHeaders;
+}
+
+// Returns the freshness lifetime in seconds given by a Cache-Control header, or kj::none if the
+// header doesn't give one or forbids keeping the response.
+kj::Maybe<uint64_t> freshnessLifetime(kj::StringPtr cacheControl) {
+  kj::Maybe<uint64_t> maxAge;
+  kj::Maybe<uint64_t> sharedMaxAge;
+  kj::ArrayPtr<const char> rest = cacheControl;
+  while (rest.size() > 0) {
+    kj::ArrayPtr<const char> directive = rest;
+    KJ_IF_SOME(comma, rest.findFirst(',')) {
+      directive = rest.first(comma);
+      rest = rest.slice(comma + 1);
+    } else {
+      rest = nullptr;
+    }
+
+    kj::ArrayPtr<const char> name = trim(directive);
+    kj::ArrayPtr<const char> value = nullptr;
+    KJ_IF_SOME(equals, name.findFirst('=')) {
+      value = trim(name.slice(equals + 1));
+      name = trim(name.first(equals));
+    }
+
+    if (equalsIgnoreCase(name, "no-store"_kj) || equalsIgnoreCase(name, "no-cache"_kj) ||
+        equalsIgnoreCase(name, "private"_kj)) {
+      return kj::none;
+    } else if (equalsIgnoreCase(name, "s-maxage"_kj)) {
+      sharedMaxAge = kj::str(value).tryParseAs<uint64_t>();
+    } else if (equalsIgnoreCase(name, "max-age"_kj)) {
+      maxAge = kj::str(value).tryParseAs<uint64_t>();
+    }
+  }
+  return sharedMaxAge == kj::none ? maxAge : sharedMaxAge;
+}
+
+}  // namespace
+
+class LocalCacheTier::Client final: public kj::HttpClient {
+ public:
+  Client(LocalCacheTier& tier, kj::Maybe<kj::String> cacheName, OutboundFactory outboundFactory)
+      : tier(tier),
+        cacheName(kj::mv(cacheName)),
+        outboundFactory(kj::mv(outboundFactory)) {}
+
+  Request request(kj::HttpMethod method,
+      kj::StringPtr url,
+      const kj::HttpHeaders& headers,
+      kj::Maybe<uint64_t> expectedBodySize = kj::none) override {
+    // Cache names are URI-encoded, so they contain no spaces.
+    auto key = cacheName
+                   .map([&](kj::String& name) { return kj::str("n:", name, ' ', url); })
+                   .orDefault([&]() { return kj::str("d: ", url); });
+
+    if (method == kj::HttpMethod::GET && isLocalLookup(headers, tier.headerIds)) {
+      return {newNullOutputStream(), tier.lookup(*this, kj::mv(key), url, headers)};
+    }
+    if (method == kj::HttpMethod::PUT || method == kj::HttpMethod::PURGE) {
+      tier.invalidate(key);
+    }
+    return getOutbound().request(method, url, headers, expectedBodySize);
+  }
+
+  kj::HttpClient& getOutbound() {
+    KJ_IF_SOME(client, outbound) {
+      return *client;
+    }
+    return *outbound.emplace(outboundFactory());
+  }
+
+ private:
+  LocalCacheTier& tier;
+  kj::Maybe<kj::String> cacheName;
+  OutboundFactory outboundFactory;
+  kj::Maybe<kj::Own<kj::HttpClient>> outbound;
+};
+
+LocalCacheTier::Entry::Entry(kj::String key,
+    const kj::HttpClient::Response& response,
+    kj::Array<kj::byte> body,
+    kj::TimePoint expiration)
+    : key(kj::mv(key)),
+      statusCode(response.statusCode),
+      statusText(kj::str(response.statusText)),
+      headers(response.headers->clone()),
+      body(kj::mv(body)),
+      expiration(expiration) {}
+
+LocalCacheTier::LocalCacheTier(
+    Limits limits, const kj::Timer& timer, const ThreadContext::HeaderIdBundle& headerIds)
+    : limits(limits),
+      timer(timer),
+      headerIds(headerIds) {}
+
+LocalCacheTier::~LocalCacheTier() noexcept(false) {
+  // Responses that are still being read hold on to their entries, which must not stay linked.
+  for (auto& entry: entries) {
+    lru.remove(*entry.value);
+  }
+}
+
+kj::Own<kj::HttpClient> LocalCacheTier::wrap(
+    kj::Maybe<kj::String> cacheName, OutboundFactory outbound) {
+  return kj::heap<Client>(*this, kj::mv(cacheName), kj::mv(outbound));
+}
+
+kj::Promise<kj::HttpClient::Response> LocalCacheTier::lookup(
+    Client& client, kj::String key, kj::StringPtr url, const kj::HttpHeaders& headers) {
+  KJ_IF_SOME(response, tryServe(key)) {
+    return kj::mv(response);
+  }
+
+  KJ_IF_SOME(pending, inFlight.find(key)) {
+    // Another lookup is already waiting for the outbound service's response for this key. Serve
+    // that response once it has been kept, or send our own request if it couldn't be.
+    return pending.addBranch().then(
+        [this, &client, key = kj::mv(key), url = kj::str(url), headers = headers.clone()]() mutable
+        -> kj::Promise<kj::HttpClient::Response> {
+      KJ_IF_SOME(response, tryServe(key)) {
+        return kj::mv(response);
+      }
+      return client.getOutbound().request(kj::HttpMethod::GET, url, headers, uint64_t(0)).response;
+    });
+  }
+
+  return fetch(client, kj::mv(key), url, headers);
+}
+
+kj::Promise<kj::HttpClient::Response> LocalCacheTier::fetch(
+    Client& client, kj::String key, kj::StringPtr url, const kj::HttpHeaders& headers) {
+  // Wakes up the lookups that wait for this one once its response has been kept or turned out not
+  // to be keepable, or if this lookup is canceled.
+  auto paf = kj::newPromiseAndFulfiller<void>();
+  inFlight.insert(kj::str(key), paf.promise.fork());
+  auto done = kj::heap(
+      kj::defer([this, key = kj::str(key), fulfiller = kj::mv(paf.fulfiller)]() mutable {
+        inFlight.erase(key);
+        fulfiller->fulfill();
+      }));
+
+  uint64_t invalidationsBefore = invalidationCount;
+  auto request = client.getOutbound().request(kj::HttpMethod::GET, url, headers, uint64_t(0));
+  return request.response.then(
+      [this, key = kj::mv(key), invalidationsBefore, done = kj::mv(done)](
+          kj::HttpClient::Response&& response) mutable -> kj::Promise<kj::HttpClient::Response> {
+    auto ttl = KJ_UNWRAP_OR(keepableFor(response), {
+      done = nullptr;
+      return kj::mv(response);
+    });
+
+    auto& body = *response.body;
+    return body.readAllBytes(limits.maxEntrySize)
+        .then([this, key = kj::mv(key), invalidationsBefore, done = kj::mv(done),
+                  response = kj::mv(response), ttl](kj::Array<kj::byte> bytes) mutable {
+      auto entry = kj::refcounted<Entry>(kj::mv(key), response, kj::mv(bytes), timer.now() + ttl);
+      if (invalidationCount == invalidationsBefore) {
+        store(*entry);
+      }
+      done = nullptr;
+      return respond(*entry);
+    });
+  });
+}
+
+kj::Maybe<kj::HttpClient::Response> LocalCacheTier::tryServe(kj::StringPtr key) {
+  KJ_IF_SOME(entry, entries.find(key)) {
+    if (timer.now() >= entry->expiration) {
+      remove(*entry);
+      return kj::none;
+    }
+    lru.remove(*entry);
+    lru.add(*entry);
+    return respond(*entry);
+  }
+  return kj::none;
+}
+
+kj::Maybe<kj::Duration> LocalCacheTier::keepableFor(kj::HttpClient::Response& response) const {
+  auto cacheStatus = KJ_UNWRAP_OR(response.headers->get(headerIds.cfCacheStatus), return kj::none);
+  if (cacheStatus != "HIT"_kj || response.statusCode == 206 ||
+      hasHeader(*response.headers, "vary"_kj)) {
+    return kj::none;
+  }
+
+  KJ_IF_SOME(length, response.body->tryGetLength()) {
+    if (length > limits.maxEntrySize) return kj::none;
+  } else {
+    return kj::none;
+  }
+
+  auto cacheControl = KJ_UNWRAP_OR(response.headers->get(headerIds.cacheControl), return kj::none);
+  uint64_t lifetime = KJ_UNWRAP_OR(freshnessLifetime(cacheControl), return kj::none);
+  KJ_IF_SOME(age, findHeader(*response.headers, "age"_kj)) {
+    lifetime -= kj::min(lifetime, age.tryParseAs<uint64_t>().orDefault(0));
+  }
+  if (lifetime == 0) {
+    return kj::none;
+  }
+  return kj::min(lifetime, limits.maxTtl / kj::SECONDS) * kj::SECONDS;
+}
+
+void LocalCacheTier::store(Entry& entry) {
+  removeKey(entry.key);
+  if (entry.size() > limits.maxTotalSize) {
+    return;
+  }
+  while (totalSize + entry.size() > limits.maxTotalSize) {
+    remove(*lru.begin());
+  }
+  lru.add(entry);
+  totalSize += entry.size();
+  entries.insert(entry.key, kj::addRef(entry));
+}
+
+void LocalCacheTier::invalidate(kj::StringPtr key) {
+  ++invalidationCount;
+  removeKey(key);
+}
+
+void LocalCacheTier::removeKey(kj::StringPtr key) {
+  KJ_IF_SOME(entry, entries.find(key)) {
+    remove(*entry);
+  }
+}
+
+void LocalCacheTier::remove(Entry& entry) {
+  // The map's key points into the entry, so keep the entry alive until it has been erased.
+  auto own = kj::mv(KJ_ASSERT_NONNULL(entries.find(entry.key)));
+  lru.remove(entry);
+  totalSize -= entry.size();
+  entries.erase(own->key);
+}
+
+kj::HttpClient::Response LocalCacheTier::respond(Entry& entry) {
+  return {
+    .statusCode = entry.statusCode,
+    .statusText = entry.statusText,
+    .headers = &entry.headers,
+    .body = newMemoryInputStream(entry.body).attach(kj::addRef(entry)),
+  };
+}
+
+}  // namespace workerd::server
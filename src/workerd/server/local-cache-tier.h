@@ -0,0 +1,130 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <workerd/io/io-thread-context.h>
+
+#include <kj/compat/http.h>
+#include <kj/function.h>
+#include <kj/list.h>
+#include <kj/map.h>
+#include <kj/refcount.h>
+#include <kj/timer.h>
+
+namespace workerd::server {
+
+// A small in-memory cache in front of a Worker's `cacheApiOutbound`, see `Worker.cacheApiLocalTier`
+// in workerd.capnp. Cache API lookups that hit a small, explicitly fresh response are answered
+// from memory instead of being sent to the outbound service.
+//
+// The tier speaks the HTTP protocol that api/cache.c++ uses to talk to the cache: a lookup is a
+// GET request with `Cache-Control: only-if-cached`, `put()` is a PUT request and `delete()` is a
+// PURGE request. Only lookups are answered locally. Puts and purges always go to the outbound
+// service, and drop the local copy first.
+//
+// A response from the outbound service is kept if it is a cache hit (`CF-Cache-Status: HIT`)
+// without a `Vary` header, if its body has a known length of at most `maxEntrySize` bytes, and if
+// its `Cache-Control` header gives it a freshness lifetime with `s-maxage` or `max-age` and
+// doesn't forbid storing it. It is kept for that lifetime minus its `Age`, but at most `maxTtl`.
+//
+// Concurrent lookups of the same key that miss the tier share one outbound request. If the
+// response can't be kept, the waiting lookups then send their own requests.
+//
+// The tier is not thread-safe. Each serving thread has its own.
+class LocalCacheTier {
+ public:
+  struct Limits {
+    // The maximum sum of the sizes of all kept response bodies and their keys.
+    uint64_t maxTotalSize;
+
+    // The maximum size of a single response body.
+    uint64_t maxEntrySize;
+
+    // The longest time for which a response is kept, whatever its Cache-Control header says.
+    kj::Duration maxTtl;
+  };
+
+  LocalCacheTier(
+      Limits limits, const kj::Timer& timer, const ThreadContext::HeaderIdBundle& headerIds);
+  ~LocalCacheTier() noexcept(false);
+  KJ_DISALLOW_COPY_AND_MOVE(LocalCacheTier);
+
+  using OutboundFactory = kj::Function<kj::Own<kj::HttpClient>()>;
+
+  // Returns an HttpClient for the cache namespace `cacheName`, or for the default cache if
+  // `cacheName` is kj::none. Requests that the tier can't answer are sent to a client created by
+  // `outbound`, which is only called when that first happens.
+  kj::Own<kj::HttpClient> wrap(kj::Maybe<kj::String> cacheName, OutboundFactory outbound);
+
+  // The number of kept responses, and the total size that counts against `maxTotalSize`.
+  size_t size() const {
+    return entries.size();
+  }
+  uint64_t getTotalSize() const {
+    return totalSize;
+  }
+
+ private:
+  struct Entry: public kj::Refcounted {
+    kj::String key;
+    uint statusCode;
+    kj::String statusText;
+    kj::HttpHeaders headers;
+    kj::Array<kj::byte> body;
+    kj::TimePoint expiration;
+    kj::ListLink<Entry> lruLink;
+
+    Entry(kj::String key,
+        const kj::HttpClient::Response& response,
+        kj::Array<kj::byte> body,
+        kj::TimePoint expiration);
+
+    uint64_t size() const {
+      return key.size() + body.size();
+    }
+  };
+
+  class Client;
+
+  Limits limits;
+  const kj::Timer& timer;
+  const ThreadContext::HeaderIdBundle& headerIds;
+
+  kj::HashMap<kj::StringPtr, kj::Own<Entry>> entries;
+
+  // All kept entries, least recently used first.
+  kj::List<Entry, &Entry::lruLink> lru;
+  uint64_t totalSize = 0;
+
+  // Lookups that are waiting for an outbound response for their key. Resolves once that response
+  // has either been kept or turned out not to be keepable.
+  kj::HashMap<kj::String, kj::ForkedPromise<void>> inFlight;
+
+  // Incremented by every put and purge. A response that arrives after one of them might be older
+  // than what was put or purged, so it isn't kept.
+  uint64_t invalidationCount = 0;
+
+  kj::Promise<kj::HttpClient::Response> lookup(
+      Client& client, kj::String key, kj::StringPtr url, const kj::HttpHeaders& headers);
+  kj::Promise<kj::HttpClient::Response> fetch(
+      Client& client, kj::String key, kj::StringPtr url, const kj::HttpHeaders& headers);
+
+  // Returns a fresh local response for `key`, if there is one.
+  kj::Maybe<kj::HttpClient::Response> tryServe(kj::StringPtr key);
+
+  // Returns for how long `response` may be kept, or kj::none if it must not be kept.
+  kj::Maybe<kj::Duration> keepableFor(kj::HttpClient::Response& response) const;
+
+  // Keeps `entry`, replacing any entry for the same key, unless it is larger than `maxTotalSize`.
+  void store(Entry& entry);
+
+  void invalidate(kj::StringPtr key);
+  void removeKey(kj::StringPtr key);
+  void remove(Entry& entry);
+
+  static kj::HttpClient::Response respond(Entry& entry);
+};
+
+}  // namespace workerd::server
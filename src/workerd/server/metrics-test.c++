@@ -0,0 +1,142 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "metrics.h"
+
+#include <workerd/util/duration-exceeded-logger.h>
+
+#include <kj/test.h>
+
+namespace workerd::server {
+namespace {
+
+KJ_TEST("ServerMetrics renders OpenMetrics text") {
+  ServerMetrics metrics;
+
+  metrics.requests.add(3);
+  metrics.requestDuration.observe(50 * kj::MICROSECONDS);
+  metrics.requestDuration.observe(150 * kj::MICROSECONDS);
+  metrics.requestDuration.observe(10 * kj::MINUTES);
+
+  auto isolateObserver = metrics.makeIsolateObserver();
+  isolateObserver->created();
+  isolateObserver->created();
+  isolateObserver->evicted();
+  metrics.lazyWorkerStartup.observe(300 * kj::MILLISECONDS);
+
+  auto actorObserver = metrics.makeActorObserver();
+  actorObserver->addQueryStats(5, 2);
+  actorObserver->addCachedStorageReadUnits(7);
+
+  metrics.actorsEvicted.add();
+  metrics.actorsEvictedForMemory.add();
+  metrics.actorResidency.observe(30 * kj::SECONDS);
+
+  metrics.tlsContextsCreated.add();
+  metrics.tlsContextsShared.add(2);
+
+  auto text = metrics.render();
+
+  KJ_EXPECT(text.startsWith("# TYPE workerd_request_duration_seconds histogram\n"), text);
+  KJ_EXPECT(text.endsWith("\n# EOF\n"), text);
+
+  auto expectLine = [&](kj::StringPtr line) {
+    KJ_EXPECT(text.contains(kj::str('\n', line, '\n')), line, text);
+  };
+  expectLine("workerd_request_duration_seconds_bucket{le=\"0.000100000\"} 1");
+  expectLine("workerd_request_duration_seconds_bucket{le=\"0.000200000\"} 2");
+  expectLine("workerd_request_duration_seconds_bucket{le=\"52.428800000\"} 2");
+  expectLine("workerd_request_duration_seconds_bucket{le=\"+Inf\"} 3");
+  expectLine("workerd_request_duration_seconds_sum 600.000200000");
+  expectLine("workerd_request_duration_seconds_count 3");
+  expectLine("# TYPE workerd_requests counter");
+  expectLine("workerd_requests_total 3");
+  expectLine("workerd_request_failures_total 0");
+  expectLine("workerd_isolates 1");
+  expectLine("workerd_lazy_worker_startup_seconds_bucket{le=\"0.204800000\"} 0");
+  expectLine("workerd_lazy_worker_startup_seconds_bucket{le=\"0.409600000\"} 1");
+  expectLine("workerd_lazy_worker_startup_seconds_count 1");
+  expectLine("workerd_sqlite_rows_read_total 5");
+  expectLine("workerd_sqlite_rows_written_total 2");
+  expectLine("workerd_actor_cached_read_units_total 7");
+  expectLine("workerd_actors_evicted_total 1");
+  expectLine("workerd_actors_evicted_for_memory_total 1");
+  expectLine("workerd_actor_residency_seconds_bucket{le=\"26.214400000\"} 0");
+  expectLine("workerd_actor_residency_seconds_bucket{le=\"52.428800000\"} 1");
+  expectLine("workerd_actor_residency_seconds_count 1");
+  expectLine("workerd_tls_contexts_created_total 1");
+  expectLine("workerd_tls_contexts_shared_total 2");
+}
+
+KJ_TEST("ServerMetrics keeps handler times per service, entrypoint and event") {
+  ServerMetrics metrics;
+
+  auto& fetch = metrics.getHandlerTimes("main", "default", "fetch");
+  KJ_EXPECT(&metrics.getHandlerTimes("main", "default", "fetch") == &fetch);
+  KJ_EXPECT(&metrics.getHandlerTimes("main", "default", "alarm") != &fetch);
+
+  fetch.invocations.add(2);
+  fetch.cpuNs.add(1'500'000);
+  fetch.wallNs.add(3'000'000'000);
+  metrics.getHandlerTimes("main", "say\"hi\"", "rpc").invocations.add();
+
+  auto text = metrics.render();
+  auto expectLine = [&](kj::StringPtr line) {
+    KJ_EXPECT(text.contains(kj::str('\n', line, '\n')), line, text);
+  };
+  expectLine("# TYPE workerd_handler_cpu_seconds counter");
+  expectLine("workerd_handler_invocations_total{service=\"main\",entrypoint=\"default\","
+             "event=\"fetch\"} 2");
+  expectLine("workerd_handler_invocations_total{service=\"main\",entrypoint=\"default\","
+             "event=\"alarm\"} 0");
+  expectLine("workerd_handler_invocations_total{service=\"main\",entrypoint=\"say\\\"hi\\\"\","
+             "event=\"rpc\"} 1");
+  expectLine("workerd_handler_cpu_seconds_total{service=\"main\",entrypoint=\"default\","
+             "event=\"fetch\"} 0.001500000");
+  expectLine("workerd_handler_wall_seconds_total{service=\"main\",entrypoint=\"default\","
+             "event=\"fetch\"} 3.000000000");
+}
+
+KJ_TEST("ServerMetrics keeps isolate heap metrics per service") {
+  ServerMetrics metrics;
+
+  auto& memory = metrics.getIsolateMemory("main");
+  KJ_EXPECT(&metrics.getIsolateMemory("main") == &memory);
+
+  memory.heapBytes.add(1000);
+  memory.heapLimitBytes.add(4096);
+  memory.requestsShed.add(3);
+
+  auto text = metrics.render();
+  auto expectLine = [&](kj::StringPtr line) {
+    KJ_EXPECT(text.contains(kj::str('\n', line, '\n')), line, text);
+  };
+  expectLine("# TYPE workerd_worker_heap_bytes gauge");
+  expectLine("workerd_worker_heap_bytes{service=\"main\"} 1000");
+  expectLine("workerd_worker_heap_limit_bytes{service=\"main\"} 4096");
+  expectLine("# TYPE workerd_worker_requests_shed counter");
+  expectLine("workerd_worker_requests_shed_total{service=\"main\"} 3");
+  expectLine("workerd_worker_heap_limit_reached_total{service=\"main\"} 0");
+}
+
+KJ_TEST("ServerMetrics renders slow operation sites") {
+  ServerMetrics metrics;
+  static util::SlowOperationSite site("metrics test site", 1 * kj::SECONDS);
+  site.record(3 * kj::MILLISECONDS, kj::origin<kj::TimePoint>());
+
+  auto text = metrics.render();
+  auto expectLine = [&](kj::StringPtr line) {
+    KJ_EXPECT(text.contains(kj::str('\n', line, '\n')), line, text);
+  };
+  auto name = "workerd_slow_operation_duration_seconds"_kj;
+  expectLine(kj::str("# TYPE ", name, " histogram"));
+  expectLine(kj::str(name, "_bucket{site=\"metrics test site\",le=\"0.002000000\"} 0"));
+  expectLine(kj::str(name, "_bucket{site=\"metrics test site\",le=\"0.004000000\"} 1"));
+  expectLine(kj::str(name, "_bucket{site=\"metrics test site\",le=\"+Inf\"} 1"));
+  expectLine(kj::str(name, "_sum{site=\"metrics test site\"} 0.003000000"));
+  expectLine(kj::str(name, "_count{site=\"metrics test site\"} 1"));
+}
+
+}  // namespace
+}  // namespace workerd::server
@@ -0,0 +1,333 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "metrics.h"
+
+#include <workerd/util/duration-exceeded-logger.h>
+
+namespace workerd::server {
+
+namespace {
+
+// Formats `ns` nanoseconds as seconds with a fixed number of decimals, so the output doesn't
+// depend on how doubles are printed.
+kj::String formatSeconds(uint64_t ns) {
+  auto fraction = kj::str(ns % 1'000'000'000);
+  return kj::str(ns / 1'000'000'000, '.', kj::repeat('0', 9 - fraction.size()), fraction);
+}
+
+void renderHeader(
+    kj::Vector<kj::String>& out, kj::StringPtr name, kj::StringPtr type, kj::StringPtr help) {
+  out.add(kj::str("# TYPE ", name, ' ', type, '\n'));
+  out.add(kj::str("# HELP ", name, ' ', help, '\n'));
+}
+
+void renderCounter(kj::Vector<kj::String>& out,
+    kj::StringPtr name,
+    kj::StringPtr help,
+    const ServerMetrics::Counter& counter) {
+  renderHeader(out, name, "counter", help);
+  out.add(kj::str(name, "_total ", counter.get(), '\n'));
+}
+
+void renderGauge(kj::Vector<kj::String>& out,
+    kj::StringPtr name,
+    kj::StringPtr help,
+    const ServerMetrics::Gauge& gauge) {
+  renderHeader(out, name, "gauge", help);
+  out.add(kj::str(name, ' ', gauge.get(), '\n'));
+}
+
+// Escapes a label value per the OpenMetrics text format.
+kj::String escapeLabel(kj::StringPtr value) {
+  kj::Vector<char> out(value.size() + 1);
+  for (char c: value) {
+    switch (c) {
+      case '\\':
+        out.addAll("\\\\"_kj);
+        break;
+      case '"':
+        out.addAll("\\\""_kj);
+        break;
+      case '\n':
+        out.addAll("\\n"_kj);
+        break;
+      default:
+        out.add(c);
+    }
+  }
+  out.add('\0');
+  return kj::String(out.releaseAsArray());
+}
+
+void renderHistogram(kj::Vector<kj::String>& out,
+    kj::StringPtr name,
+    kj::StringPtr help,
+    const ServerMetrics::DurationHistogram& histogram) {
+  renderHeader(out, name, "histogram", help);
+  histogram.render(out, name);
+}
+
+class MetricsIsolateObserver final: public IsolateObserver {
+ public:
+  MetricsIsolateObserver(ServerMetrics& metrics): metrics(metrics) {}
+
+  void created() override {
+    metrics.isolates.add(1);
+  }
+  void evicted() override {
+    metrics.isolates.add(-1);
+  }
+
+ private:
+  ServerMetrics& metrics;
+};
+
+class MetricsActorObserver final: public ActorObserver {
+ public:
+  MetricsActorObserver(ServerMetrics& metrics): metrics(metrics) {}
+
+  void addQueryStats(uint64_t rowsRead, uint64_t rowsWritten) override {
+    metrics.sqliteRowsRead.add(rowsRead);
+    metrics.sqliteRowsWritten.add(rowsWritten);
+  }
+  void addCachedStorageReadUnits(uint32_t units) override {
+    metrics.actorCachedReadUnits.add(units);
+  }
+  void addUncachedStorageReadUnits(uint32_t units) override {
+    metrics.actorUncachedReadUnits.add(units);
+  }
+  void addStorageWriteUnits(uint32_t units) override {
+    metrics.actorWriteUnits.add(units);
+  }
+
+ private:
+  ServerMetrics& metrics;
+};
+
+class MetricsByteStreamObserver final: public ByteStreamObserver {
+ public:
+  MetricsByteStreamObserver(ServerMetrics& metrics): metrics(metrics) {}
+
+  void onChunkEnqueued(size_t bytes) override {
+    metrics.streamBytesWritten.add(bytes);
+  }
+
+ private:
+  ServerMetrics& metrics;
+};
+
+class MetricsWebSocketObserver final: public WebSocketObserver {
+ public:
+  MetricsWebSocketObserver(ServerMetrics& metrics): metrics(metrics) {}
+
+  void sentMessage(size_t bytes) override {
+    metrics.webSocketMessagesSent.add();
+  }
+  void receivedMessage(size_t bytes) override {
+    metrics.webSocketMessagesReceived.add();
+  }
+
+ private:
+  ServerMetrics& metrics;
+};
+
+}  // namespace
+
+ServerMetrics& ServerMetrics::get() {
+  static ServerMetrics instance;
+  return instance;
+}
+
+void ServerMetrics::DurationHistogram::observe(kj::Duration duration) {
+  size_t bucket = 0;
+  auto bound = FIRST_BUCKET;
+  while (bucket < BUCKET_COUNT && duration > bound) {
+    ++bucket;
+    bound = bound * 2;
+  }
+  buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+  sumNs.fetch_add(duration / kj::NANOSECONDS, std::memory_order_relaxed);
+}
+
+void ServerMetrics::DurationHistogram::render(
+    kj::Vector<kj::String>& out, kj::StringPtr name) const {
+  // The buckets are read one at a time, so a scrape racing with observations may see a count
+  // that's slightly off from the buckets. Collectors tolerate that.
+  uint64_t cumulative = 0;
+  auto bound = FIRST_BUCKET;
+  for (auto i: kj::zeroTo(BUCKET_COUNT)) {
+    cumulative += buckets[i].load(std::memory_order_relaxed);
+    out.add(kj::str(name, "_bucket{le=\"", formatSeconds(bound / kj::NANOSECONDS), "\"} ",
+        cumulative, '\n'));
+    bound = bound * 2;
+  }
+  cumulative += buckets[BUCKET_COUNT].load(std::memory_order_relaxed);
+  out.add(kj::str(name, "_bucket{le=\"+Inf\"} ", cumulative, '\n'));
+  out.add(kj::str(name, "_sum ", formatSeconds(sumNs.load(std::memory_order_relaxed)), '\n'));
+  out.add(kj::str(name, "_count ", cumulative, '\n'));
+}
+
+ServerMetrics::HandlerTimes& ServerMetrics::getHandlerTimes(
+    kj::StringPtr service, kj::StringPtr entrypoint, kj::StringPtr event) {
+  auto labels = kj::str("service=\"", escapeLabel(service), "\",entrypoint=\"",
+      escapeLabel(entrypoint), "\",event=\"", escapeLabel(event), '"');
+  auto lock = handlerTimes.lockExclusive();
+  return *lock->findOrCreate(labels, [&]() {
+    using Entry = kj::HashMap<kj::String, kj::Own<HandlerTimes>>::Entry;
+    return Entry{kj::str(labels), kj::heap<HandlerTimes>()};
+  });
+}
+
+ServerMetrics::IsolateMemory& ServerMetrics::getIsolateMemory(kj::StringPtr service) {
+  auto labels = kj::str("service=\"", escapeLabel(service), '"');
+  auto lock = isolateMemory.lockExclusive();
+  return *lock->findOrCreate(labels, [&]() {
+    using Entry = kj::HashMap<kj::String, kj::Own<IsolateMemory>>::Entry;
+    return Entry{kj::str(labels), kj::heap<IsolateMemory>()};
+  });
+}
+
+kj::Own<IsolateObserver> ServerMetrics::makeIsolateObserver() {
+  return kj::atomicRefcounted<MetricsIsolateObserver>(*this);
+}
+
+kj::Own<ActorObserver> ServerMetrics::makeActorObserver() {
+  return kj::refcounted<MetricsActorObserver>(*this);
+}
+
+kj::Own<ByteStreamObserver> ServerMetrics::makeByteStreamObserver() {
+  return kj::heap<MetricsByteStreamObserver>(*this);
+}
+
+kj::Own<WebSocketObserver> ServerMetrics::makeWebSocketObserver() {
+  return kj::refcounted<MetricsWebSocketObserver>(*this);
+}
+
+kj::String ServerMetrics::render() const {
+  kj::Vector<kj::String> out;
+
+  renderHistogram(out, "workerd_request_duration_seconds",
+      "Time from the start of a request to a Worker until it's done.", requestDuration);
+  renderCounter(out, "workerd_requests", "Requests handled by Workers.", requests);
+  renderCounter(
+      out, "workerd_request_failures", "Requests that ended in an exception.", requestFailures);
+
+  renderHistogram(out, "workerd_isolate_lock_wait_seconds",
+      "Time requests spent waiting for an isolate lock.", isolateLockWait);
+  renderHistogram(out, "workerd_input_gate_wait_seconds",
+      "Time requests spent waiting for an actor's input gate.", inputGateWait);
+  renderHistogram(out, "workerd_output_gate_wait_seconds",
+      "Time requests spent waiting for an actor's output gate.", outputGateWait);
+  renderHistogram(out, "workerd_storage_flush_seconds",
+      "Time requests spent waiting for actor storage to flush.", storageFlush);
+
+  renderGauge(out, "workerd_isolates", "Live isolates.", isolates);
+  renderGauge(out, "workerd_isolate_heap_bytes",
+      "V8 heap in use by all isolates, as of each isolate's last exit from JavaScript.",
+      isolateHeapBytes);
+  renderHistogram(out, "workerd_lazy_worker_startup_seconds",
+      "Time taken to recreate the isolate of a lazy worker for the request that needed it.",
+      lazyWorkerStartup);
+
+  renderCounter(out, "workerd_actor_cached_read_units",
+      "Actor storage read units served from the actor cache.", actorCachedReadUnits);
+  renderCounter(out, "workerd_actor_uncached_read_units",
+      "Actor storage read units that missed the actor cache.", actorUncachedReadUnits);
+  renderCounter(out, "workerd_actor_write_units", "Actor storage write units.", actorWriteUnits);
+  renderCounter(
+      out, "workerd_actors_evicted", "Actors evicted after being inactive.", actorsEvicted);
+  renderCounter(out, "workerd_actors_evicted_for_memory",
+      "Actors evicted before their inactivity timeout because memory was short.",
+      actorsEvictedForMemory);
+  renderHistogram(out, "workerd_actor_residency_seconds",
+      "Time from an actor's creation until its eviction for inactivity.", actorResidency);
+
+  renderCounter(out, "workerd_sqlite_rows_read", "Rows read by SQLite queries.", sqliteRowsRead);
+  renderCounter(
+      out, "workerd_sqlite_rows_written", "Rows written by SQLite queries.", sqliteRowsWritten);
+
+  renderCounter(out, "workerd_stream_written_bytes", "Bytes written to writable streams.",
+      streamBytesWritten);
+  renderCounter(out, "workerd_websocket_messages_sent", "WebSocket messages sent by Workers.",
+      webSocketMessagesSent);
+  renderCounter(out, "workerd_websocket_messages_received",
+      "WebSocket messages received by Workers.", webSocketMessagesReceived);
+
+  renderCounter(out, "workerd_tls_contexts_created", "TLS contexts built from config.",
+      tlsContextsCreated);
+  renderCounter(out, "workerd_tls_contexts_shared",
+      "Times a TLS context was reused for a service or socket with the same TLS options.",
+      tlsContextsShared);
+
+  {
+    auto lock = handlerTimes.lockShared();
+    auto renderHandlers = [&](kj::StringPtr name, kj::StringPtr help, auto render) {
+      renderHeader(out, name, "counter", help);
+      for (auto& entry: *lock) {
+        out.add(kj::str(name, "_total{", entry.key, "} ", render(*entry.value), '\n'));
+      }
+    };
+    renderHandlers("workerd_handler_invocations", "Invocations of each entrypoint's handlers.",
+        [](const HandlerTimes& times) { return kj::str(times.invocations.get()); });
+    renderHandlers("workerd_handler_cpu_seconds",
+        "Thread CPU time spent running JavaScript in each entrypoint's handlers.",
+        [](const HandlerTimes& times) { return formatSeconds(times.cpuNs.get()); });
+    renderHandlers("workerd_handler_wall_seconds",
+        "Wall time of each entrypoint's handlers, from the start of the event until it's done.",
+        [](const HandlerTimes& times) { return formatSeconds(times.wallNs.get()); });
+  }
+
+  {
+    auto lock = isolateMemory.lockShared();
+    auto renderServices = [&](kj::StringPtr name, kj::StringPtr type, kj::StringPtr help,
+                              auto render) {
+      renderHeader(out, name, type, help);
+      auto suffix = type == "counter" ? "_total"_kj : ""_kj;
+      for (auto& entry: *lock) {
+        out.add(kj::str(name, suffix, '{', entry.key, "} ", render(*entry.value), '\n'));
+      }
+    };
+    renderServices("workerd_worker_heap_bytes", "gauge",
+        "V8 heap in use by each Worker's isolates, as of their last exit from JavaScript.",
+        [](const IsolateMemory& memory) { return memory.heapBytes.get(); });
+    renderServices("workerd_worker_heap_limit_bytes", "gauge",
+        "Heap limit of each Worker's isolates, summed over serving threads.",
+        [](const IsolateMemory& memory) { return memory.heapLimitBytes.get(); });
+    renderServices("workerd_worker_heap_limit_reached", "counter",
+        "Times a Worker's isolate ran into its heap limit and had its JavaScript terminated.",
+        [](const IsolateMemory& memory) { return memory.heapLimitReached.get(); });
+    renderServices("workerd_worker_requests_shed", "counter",
+        "Requests refused with a 503 because the Worker's isolate was near its heap limit.",
+        [](const IsolateMemory& memory) { return memory.requestsShed.get(); });
+    renderServices("workerd_worker_idle_collections", "counter",
+        "Full garbage collections forced while a Worker's isolate was idle.",
+        [](const IsolateMemory& memory) { return memory.idleCollections.get(); });
+  }
+
+  renderHeader(out, "workerd_slow_operation_duration_seconds", "histogram",
+      "Duration of operations watched for slowness, by call site.");
+  util::SlowOperationSite::forEach([&](const util::SlowOperationSite& site) {
+    auto name = "workerd_slow_operation_duration_seconds"_kj;
+    auto label = kj::str("site=\"", escapeLabel(site.getName()), '"');
+    uint64_t cumulative = 0;
+    for (auto i: kj::zeroTo(util::SlowOperationSite::BUCKET_COUNT)) {
+      cumulative += site.getBucketCount(i);
+      KJ_IF_SOME(bound, util::SlowOperationSite::getBucketBound(i)) {
+        out.add(kj::str(name, "_bucket{", label, ",le=\"", formatSeconds(bound / kj::NANOSECONDS),
+            "\"} ", cumulative, '\n'));
+      } else {
+        out.add(kj::str(name, "_bucket{", label, ",le=\"+Inf\"} ", cumulative, '\n'));
+      }
+    }
+    auto sum = formatSeconds(site.getTotalDuration() / kj::NANOSECONDS);
+    out.add(kj::str(name, "_sum{", label, "} ", sum, '\n'));
+    out.add(kj::str(name, "_count{", label, "} ", cumulative, '\n'));
+  });
+
+  out.add(kj::str("# EOF\n"));
+  return kj::strArray(out, "");
+}
+
+}  // namespace workerd::server
@@ -0,0 +1,158 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <workerd/io/observer.h>
+
+#include <kj/map.h>
+#include <kj/mutex.h>
+#include <kj/string.h>
+#include <kj/time.h>
+#include <kj/vector.h>
+
+#include <atomic>
+
+namespace workerd::server {
+
+// Process-wide metrics collected from the observers of all Workers, rendered in the OpenMetrics
+// text format by the `metrics` service type (see workerd.capnp).
+//
+// All serving threads update the same instance, so every metric is a relaxed atomic. The only
+// locks guard the tables of labeled metrics, which are looked up once per request or isolate.
+class ServerMetrics {
+ public:
+  ServerMetrics() = default;
+  KJ_DISALLOW_COPY_AND_MOVE(ServerMetrics);
+
+  // The instance shared by all threads.
+  static ServerMetrics& get();
+
+  class Counter {
+   public:
+    void add(uint64_t n = 1) {
+      value.fetch_add(n, std::memory_order_relaxed);
+    }
+    uint64_t get() const {
+      return value.load(std::memory_order_relaxed);
+    }
+
+   private:
+    std::atomic<uint64_t> value = 0;
+  };
+
+  class Gauge {
+   public:
+    void add(int64_t n) {
+      value.fetch_add(n, std::memory_order_relaxed);
+    }
+    int64_t get() const {
+      return value.load(std::memory_order_relaxed);
+    }
+
+   private:
+    std::atomic<int64_t> value = 0;
+  };
+
+  // A histogram of durations with exponentially growing buckets: bucket `i` counts observations
+  // up to `FIRST_BUCKET << i`, from 100us up to about 52s. Longer observations only land in the
+  // implicit +Inf bucket.
+  class DurationHistogram {
+   public:
+    static constexpr size_t BUCKET_COUNT = 20;
+    static constexpr kj::Duration FIRST_BUCKET = 100 * kj::MICROSECONDS;
+
+    void observe(kj::Duration duration);
+
+    // Appends the `_bucket`, `_sum` and `_count` samples for this histogram to `out`.
+    void render(kj::Vector<kj::String>& out, kj::StringPtr name) const;
+
+   private:
+    // Not cumulative; render() sums them up.
+    std::atomic<uint64_t> buckets[BUCKET_COUNT + 1] = {};
+    std::atomic<uint64_t> sumNs = 0;
+  };
+
+  DurationHistogram requestDuration;
+  Counter requests;
+  Counter requestFailures;
+
+  DurationHistogram isolateLockWait;
+  DurationHistogram inputGateWait;
+  DurationHistogram outputGateWait;
+  DurationHistogram storageFlush;
+
+  Gauge isolates;
+  Gauge isolateHeapBytes;
+  // Time taken to recreate the isolate of a `Worker.lazy` worker for the request that needed it.
+  DurationHistogram lazyWorkerStartup;
+
+  Counter actorCachedReadUnits;
+  Counter actorUncachedReadUnits;
+  Counter actorWriteUnits;
+
+  // Actors whose Worker::Actor was dropped after a period without requests, and how long each
+  // had been resident when that happened.
+  Counter actorsEvicted;
+  DurationHistogram actorResidency;
+  // The subset of `actorsEvicted` evicted early because memory crossed `Config.actorMemory`.
+  Counter actorsEvictedForMemory;
+
+  Counter sqliteRowsRead;
+  Counter sqliteRowsWritten;
+
+  Counter streamBytesWritten;
+  Counter webSocketMessagesSent;
+  Counter webSocketMessagesReceived;
+
+  // Lookups of the TLS contexts the server builds from config, which services and sockets with
+  // identical TLS options share.
+  Counter tlsContextsCreated;
+  Counter tlsContextsShared;
+
+  // Time spent in one kind of event handler (`fetch`, `alarm`, `rpc`, ...) of one entrypoint.
+  struct HandlerTimes {
+    Counter invocations;
+    Counter cpuNs;
+    Counter wallNs;
+  };
+
+  // Returns the times for handler `event` of `entrypoint` in the Worker named `service`, adding
+  // them on first use.
+  HandlerTimes& getHandlerTimes(
+      kj::StringPtr service, kj::StringPtr entrypoint, kj::StringPtr event);
+
+  // The V8 heaps of one Worker's isolates, summed over serving threads. Only workers with a
+  // `memoryLimit` report these.
+  struct IsolateMemory {
+    // As of each isolate's last exit from JavaScript.
+    Gauge heapBytes;
+    Gauge heapLimitBytes;
+    // Times V8 ran into the heap limit, which terminates whatever JavaScript was running.
+    Counter heapLimitReached;
+    // Requests refused with a 503 because the isolate was close to its heap limit.
+    Counter requestsShed;
+    // Full garbage collections forced while the isolate was idle.
+    Counter idleCollections;
+  };
+
+  // Returns the heap metrics of the Worker named `service`, adding them on first use.
+  IsolateMemory& getIsolateMemory(kj::StringPtr service);
+
+  // Observers that feed these metrics.
+  kj::Own<IsolateObserver> makeIsolateObserver();
+  kj::Own<ActorObserver> makeActorObserver();
+  kj::Own<ByteStreamObserver> makeByteStreamObserver();
+  kj::Own<WebSocketObserver> makeWebSocketObserver();
+
+  // Returns all metrics in the OpenMetrics text format, terminated by `# EOF`.
+  kj::String render() const;
+
+ private:
+  // Keyed by the rendered label set. Entries are never removed, so references remain valid.
+  kj::MutexGuarded<kj::HashMap<kj::String, kj::Own<HandlerTimes>>> handlerTimes;
+  kj::MutexGuarded<kj::HashMap<kj::String, kj::Own<IsolateMemory>>> isolateMemory;
+};
+
+}  // namespace workerd::server
@@ -0,0 +1,245 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "pg-pool.h"
+
+#include <kj/debug.h>
+#include <kj/test.h>
+
+#include <cstring>
+
+namespace workerd::server {
+namespace {
+
+kj::Array<kj::byte> message(char type, kj::ArrayPtr<const kj::byte> body) {
+  kj::Vector<kj::byte> out;
+  if (type != 0) out.add(type);
+  uint32_t length = 4 + body.size();
+  out.add(length >> 24);
+  out.add(length >> 16);
+  out.add(length >> 8);
+  out.add(length);
+  out.addAll(body);
+  return out.releaseAsArray();
+}
+
+// Joins strings, each with a NUL terminator, as the fields of a message body.
+kj::Array<kj::byte> fields(std::initializer_list<kj::StringPtr> strings) {
+  kj::Vector<kj::byte> out;
+  for (auto s: strings) {
+    out.addAll(s.asBytes());
+    out.add(0);
+  }
+  return out.releaseAsArray();
+}
+
+kj::Promise<kj::Maybe<char>> readMessage(kj::AsyncInputStream& in, kj::Vector<kj::byte>& body) {
+  kj::byte header[5];
+  if (co_await in.tryRead(header, 5, 5) == 0) co_return kj::none;
+  uint32_t length = (uint32_t(header[1]) << 24) | (uint32_t(header[2]) << 16) |
+      (uint32_t(header[3]) << 8) | uint32_t(header[4]);
+  body.resize(length - 4);
+  co_await in.read(body.begin(), body.size());
+  co_return static_cast<char>(header[0]);
+}
+
+// Answers just enough of the protocol for the pool: it accepts any startup, and replies to each
+// extended-query message as if it had succeeded.
+struct FakeServer {
+  uint connections = 0;
+  kj::Vector<kj::String> parses;
+  kj::Vector<kj::Promise<void>> tasks;
+
+  kj::Own<kj::AsyncIoStream> connect() {
+    ++connections;
+    auto pipe = kj::newTwoWayPipe();
+    tasks.add(serve(kj::mv(pipe.ends[1])).eagerlyEvaluate(nullptr));
+    return kj::mv(pipe.ends[0]);
+  }
+
+  kj::Promise<void> serve(kj::Own<kj::AsyncIoStream> stream) {
+    kj::byte lengthBytes[4];
+    co_await stream->read(lengthBytes, 4);
+    auto startup = kj::heapArray<kj::byte>(lengthBytes[3] - 4);
+    co_await stream->read(startup.begin(), startup.size());
+
+    kj::Vector<kj::byte> reply;
+    reply.addAll(message('R', kj::heapArray<kj::byte>({0, 0, 0, 0})));
+    reply.addAll(message('S', fields({"server_version", "16.0"})));
+    reply.addAll(message('Z', "I"_kjb));
+    co_await stream->write(reply.asPtr());
+
+    kj::Vector<kj::byte> body;
+    for (;;) {
+      auto maybeType = co_await readMessage(*stream, body);
+      char type;
+      KJ_IF_SOME(t, maybeType) {
+        type = t;
+      } else {
+        break;
+      }
+
+      kj::Array<kj::byte> out;
+      switch (type) {
+        case 'P':
+          parses.add(kj::str(kj::StringPtr(body.asPtr().asChars().begin())));
+          out = message('1', nullptr);
+          break;
+        case 'B':
+          out = message('2', nullptr);
+          break;
+        case 'C':
+          out = message('3', nullptr);
+          break;
+        case 'E':
+          out = message('C', fields({"SELECT 1"}));
+          break;
+        case 'S':
+          out = message('Z', "I"_kjb);
+          break;
+        case 'Q': {
+          kj::Vector<kj::byte> both;
+          both.addAll(message('C', fields({"SELECT 1"})));
+          both.addAll(message('Z', "I"_kjb));
+          out = both.releaseAsArray();
+          break;
+        }
+        default:
+          KJ_FAIL_ASSERT("unexpected message", type);
+      }
+      co_await stream->write(out);
+    }
+  }
+};
+
+struct ZeroEntropy final: public kj::EntropySource {
+  void generate(kj::ArrayPtr<kj::byte> buffer) override {
+    memset(buffer.begin(), 0, buffer.size());
+  }
+};
+
+struct PoolEnv {
+  kj::EventLoop loop;
+  kj::WaitScope waitScope;
+  kj::TimerImpl timer;
+  ZeroEntropy entropy;
+  FakeServer server;
+  PgPool pool;
+
+  PoolEnv()
+      : waitScope(loop),
+        timer(kj::origin<kj::TimePoint>()),
+        pool(timer, entropy, [this]() -> kj::Promise<kj::Own<kj::AsyncIoStream>> {
+    return server.connect();
+  }, PgPool::Options{.database = kj::str("db"), .user = kj::str("user")}) {}
+};
+
+// A client connected to the pool.
+struct Client {
+  PoolEnv& env;
+  kj::Own<kj::AsyncIoStream> stream;
+  kj::Promise<void> serving;
+
+  explicit Client(PoolEnv& env, kj::TwoWayPipe pipe = kj::newTwoWayPipe())
+      : env(env),
+        stream(kj::mv(pipe.ends[0])),
+        serving(env.pool.serve(*pipe.ends[1]).attach(kj::mv(pipe.ends[1])).eagerlyEvaluate(
+            nullptr)) {
+    kj::Vector<kj::byte> startup;
+    startup.addAll(kj::heapArray<kj::byte>({0, 3, 0, 0}));
+    startup.addAll(fields({"user", "someone", ""}));
+    send(message(0, startup));
+    KJ_EXPECT(receive() == "RSKZ");
+  }
+
+  void send(kj::ArrayPtr<const kj::byte> bytes) {
+    stream->write(bytes).wait(env.waitScope);
+  }
+
+  // Returns the types of the messages received up to the next ReadyForQuery.
+  kj::String receive() {
+    kj::Vector<char> types;
+    kj::Vector<kj::byte> body;
+    for (;;) {
+      auto type = KJ_ASSERT_NONNULL(readMessage(*stream, body).wait(env.waitScope));
+      types.add(type);
+      if (type == 'Z') break;
+    }
+    types.add('\0');
+    return kj::String(types.releaseAsArray());
+  }
+
+  // Sends Parse, Bind, Execute and Sync for a named statement.
+  void execute(kj::StringPtr name, kj::StringPtr query) {
+    kj::Vector<kj::byte> batch;
+    kj::Vector<kj::byte> parse;
+    parse.addAll(fields({name, query}));
+    parse.addAll(kj::heapArray<kj::byte>({0, 0}));
+    batch.addAll(message('P', parse));
+    kj::Vector<kj::byte> bind;
+    bind.addAll(fields({"", name}));
+    bind.addAll(kj::heapArray<kj::byte>({0, 0, 0, 0, 0, 0}));
+    batch.addAll(message('B', bind));
+    batch.addAll(message('E', kj::heapArray<kj::byte>({0, 0, 0, 0, 0})));
+    batch.addAll(message('S', nullptr));
+    send(batch);
+  }
+
+  void terminate() {
+    send(message('X', nullptr));
+    serving.wait(env.waitScope);
+  }
+};
+
+KJ_TEST("PgPool reuses one upstream connection for consecutive clients") {
+  PoolEnv env;
+
+  for (auto i = 0; i < 3; i++) {
+    Client client(env);
+    client.send(message('Q', fields({"SELECT 1"})));
+    KJ_EXPECT(client.receive() == "CZ");
+    client.terminate();
+  }
+
+  KJ_EXPECT(env.server.connections == 1);
+  KJ_EXPECT(env.pool.getConnectionCount() == 1);
+  KJ_EXPECT(env.pool.getIdleConnectionCount() == 1);
+}
+
+KJ_TEST("PgPool prepares a statement shared by clients once per connection") {
+  PoolEnv env;
+
+  Client first(env);
+  first.execute("a", "SELECT $1");
+  KJ_EXPECT(first.receive() == "12CZ");
+
+  // The same query under another name, from another client, reuses the upstream statement.
+  Client second(env);
+  second.execute("b", "SELECT $1");
+  KJ_EXPECT(second.receive() == "12CZ");
+
+  // Closing it only forgets the client's name for it.
+  kj::Vector<kj::byte> close;
+  close.add('S');
+  close.addAll(fields({"b"}));
+  kj::Vector<kj::byte> batch;
+  batch.addAll(message('C', close));
+  batch.addAll(message('S', nullptr));
+  second.send(batch);
+  KJ_EXPECT(second.receive() == "3Z");
+
+  first.execute("a", "SELECT $2");
+  KJ_EXPECT(first.receive() == "12CZ");
+
+  KJ_ASSERT(env.server.parses.size() == 2);
+  KJ_EXPECT(env.server.parses[0] == "workerd_1");
+  KJ_EXPECT(env.server.parses[1] == "workerd_2");
+  KJ_EXPECT(env.server.connections == 1);
+
+  first.terminate();
+  second.terminate();
+}
+
+}  // namespace
+}  // namespace workerd::server
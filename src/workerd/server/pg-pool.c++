@@ -0,0 +1,1071 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "pg-pool.h"
+
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/md5.h>
+#include <openssl/sha.h>
+
+#include <kj/debug.h>
+#include <kj/encoding.h>
+
+#include <cstring>
+
+namespace workerd::server {
+
+namespace {
+
+constexpr int32_t PROTOCOL_VERSION_3 = 196608;
+constexpr int32_t CANCEL_REQUEST_CODE = 80877102;
+constexpr int32_t SSL_REQUEST_CODE = 80877103;
+constexpr int32_t GSSENC_REQUEST_CODE = 80877104;
+
+// The largest message Postgres itself accepts.
+constexpr uint32_t MAX_MESSAGE_SIZE = 1u << 30;
+constexpr uint32_t MAX_STARTUP_MESSAGE_SIZE = 10000;
+
+// Replies are passed on to the client in batches; one is written out once it reaches this size,
+// even if more replies are already buffered.
+constexpr size_t FLUSH_THRESHOLD = 64 * 1024;
+
+uint32_t readUint32(const kj::byte* bytes) {
+  return (uint32_t(bytes[0]) << 24) | (uint32_t(bytes[1]) << 16) | (uint32_t(bytes[2]) << 8) |
+      uint32_t(bytes[3]);
+}
+
+void appendUint32(kj::Vector<kj::byte>& out, uint32_t value) {
+  out.add(value >> 24);
+  out.add(value >> 16);
+  out.add(value >> 8);
+  out.add(value);
+}
+
+// Appends a message: its type, then its length including the length itself, then its body.
+// Messages sent while a connection starts up have no type, which `type == 0` stands for.
+void appendMessage(kj::Vector<kj::byte>& out, char type, kj::ArrayPtr<const kj::byte> body) {
+  if (type != 0) out.add(type);
+  appendUint32(out, 4 + body.size());
+  out.addAll(body);
+}
+
+kj::Array<kj::byte> encodeMessage(char type, kj::ArrayPtr<const kj::byte> body) {
+  kj::Vector<kj::byte> out(5 + body.size());
+  appendMessage(out, type, body);
+  return out.releaseAsArray();
+}
+
+class BodyBuilder {
+ public:
+  void addByte(kj::byte value) {
+    bytes.add(value);
+  }
+  void addInt32(int32_t value) {
+    appendUint32(bytes, value);
+  }
+  // Adds `value` with a NUL terminator.
+  void addString(kj::StringPtr value) {
+    bytes.addAll(value.asBytes());
+    bytes.add(0);
+  }
+  void addBytes(kj::ArrayPtr<const kj::byte> value) {
+    bytes.addAll(value);
+  }
+
+  kj::ArrayPtr<const kj::byte> asPtr() const {
+    return bytes.asPtr();
+  }
+
+ private:
+  kj::Vector<kj::byte> bytes;
+};
+
+// Reads the fields of a message body, throwing if the body is too short for them.
+class BodyReader {
+ public:
+  explicit BodyReader(kj::ArrayPtr<const kj::byte> body): rest(body) {}
+
+  kj::byte readByte() {
+    return take(1)[0];
+  }
+  int32_t readInt32() {
+    return readUint32(take(4).begin());
+  }
+  // Reads a NUL-terminated string. The result points into the body.
+  kj::StringPtr readString() {
+    for (auto i: kj::indices(rest)) {
+      if (rest[i] == 0) {
+        auto result = kj::StringPtr(rest.asChars().begin(), i);
+        rest = rest.slice(i + 1);
+        return result;
+      }
+    }
+    KJ_FAIL_REQUIRE("Postgres message has an unterminated string");
+  }
+  kj::ArrayPtr<const kj::byte> take(size_t size) {
+    KJ_REQUIRE(rest.size() >= size, "Postgres message is too short");
+    auto result = rest.first(size);
+    rest = rest.slice(size);
+    return result;
+  }
+  kj::ArrayPtr<const kj::byte> remaining() const {
+    return rest;
+  }
+
+ private:
+  kj::ArrayPtr<const kj::byte> rest;
+};
+
+// Formats the message and SQLSTATE code of an ErrorResponse.
+kj::String describeError(kj::ArrayPtr<const kj::byte> body) {
+  kj::StringPtr message = "unknown error";
+  kj::StringPtr code = "";
+  BodyReader reader(body);
+  for (;;) {
+    auto field = reader.readByte();
+    if (field == 0) break;
+    auto value = reader.readString();
+    if (field == 'M') message = value;
+    if (field == 'C') code = value;
+  }
+  return kj::str(message, " (SQLSTATE ", code, ")");
+}
+
+void appendError(kj::Vector<kj::byte>& out,
+    kj::StringPtr severity,
+    kj::StringPtr code,
+    kj::StringPtr message) {
+  BodyBuilder body;
+  body.addByte('S');
+  body.addString(severity);
+  body.addByte('V');
+  body.addString(severity);
+  body.addByte('C');
+  body.addString(code);
+  body.addByte('M');
+  body.addString(message);
+  body.addByte(0);
+  appendMessage(out, 'E', body.asPtr());
+}
+
+struct Message {
+  char type;
+  kj::Array<kj::byte> body;
+};
+
+class MessageReader {
+ public:
+  explicit MessageReader(kj::AsyncInputStream& in)
+      : in(in),
+        buffer(kj::heapArray<kj::byte>(8192)) {}
+
+  // Reads the next message, or returns none if the stream ends before it starts.
+  kj::Promise<kj::Maybe<Message>> tryRead() {
+    if (!co_await fill(5)) co_return kj::none;
+    auto type = static_cast<char>(buffer[begin]);
+    auto length = readUint32(buffer.begin() + begin + 1);
+    KJ_REQUIRE(length >= 4 && length <= MAX_MESSAGE_SIZE, "bad Postgres message length", length);
+    begin += 5;
+    co_return Message{type, co_await readBody(length - 4)};
+  }
+
+  // Like tryRead(), but throws if the stream ends.
+  kj::Promise<Message> read() {
+    auto maybeMessage = co_await tryRead();
+    KJ_IF_SOME(message, maybeMessage) {
+      co_return kj::mv(message);
+    }
+    kj::throwFatalException(KJ_EXCEPTION(DISCONNECTED, "Postgres server closed the connection"));
+  }
+
+  // Reads one of the untyped messages a client starts with, returning its body.
+  kj::Promise<kj::Maybe<kj::Array<kj::byte>>> tryReadStartup() {
+    if (!co_await fill(4)) co_return kj::none;
+    auto length = readUint32(buffer.begin() + begin);
+    KJ_REQUIRE(length >= 8 && length <= MAX_STARTUP_MESSAGE_SIZE,
+        "bad Postgres startup message length", length);
+    begin += 4;
+    co_return co_await readBody(length - 4);
+  }
+
+  // Whether a whole message is already buffered, so that reading it won't wait.
+  bool hasBufferedMessage() const {
+    auto size = end - begin;
+    return size >= 5 && size >= 1 + readUint32(buffer.begin() + begin + 1);
+  }
+
+ private:
+  kj::AsyncInputStream& in;
+  kj::Array<kj::byte> buffer;
+  size_t begin = 0;
+  size_t end = 0;
+
+  // Buffers at least `size` bytes. Returns false if the stream ends with nothing buffered.
+  kj::Promise<bool> fill(size_t size) {
+    if (end - begin >= size) co_return true;
+    if (begin > 0) {
+      memmove(buffer.begin(), buffer.begin() + begin, end - begin);
+      end -= begin;
+      begin = 0;
+    }
+    while (end < size) {
+      auto n = co_await in.tryRead(buffer.begin() + end, 1, buffer.size() - end);
+      if (n == 0) {
+        if (end == 0) co_return false;
+        kj::throwFatalException(KJ_EXCEPTION(DISCONNECTED, "Postgres connection ended mid-message"));
+      }
+      end += n;
+    }
+    co_return true;
+  }
+
+  kj::Promise<kj::Array<kj::byte>> readBody(size_t size) {
+    auto body = kj::heapArray<kj::byte>(size);
+    auto buffered = kj::min(size, end - begin);
+    memcpy(body.begin(), buffer.begin() + begin, buffered);
+    begin += buffered;
+    if (buffered < size) {
+      auto rest = size - buffered;
+      auto n = co_await in.tryRead(body.begin() + buffered, rest, rest);
+      if (n < rest) {
+        kj::throwFatalException(KJ_EXCEPTION(DISCONNECTED, "Postgres connection ended mid-message"));
+      }
+    }
+    co_return body;
+  }
+};
+
+kj::String md5Hex(kj::ArrayPtr<const kj::byte> data) {
+  kj::byte digest[MD5_DIGEST_LENGTH];
+  MD5(data.begin(), data.size(), digest);
+  return kj::encodeHex(digest);
+}
+
+kj::Array<kj::byte> hmacSha256(kj::ArrayPtr<const kj::byte> key, kj::ArrayPtr<const kj::byte> data) {
+  auto result = kj::heapArray<kj::byte>(SHA256_DIGEST_LENGTH);
+  unsigned int size = 0;
+  KJ_ASSERT(HMAC(EVP_sha256(), key.begin(), key.size(), data.begin(), data.size(), result.begin(),
+                &size) != nullptr);
+  return result;
+}
+
+// The client side of SCRAM-SHA-256 authentication (RFC 5802, RFC 7677), as Postgres uses it: the
+// user name is left out, since the server takes it from the startup message. The password isn't
+// SASLprep-normalized, which only matters for non-ASCII passwords.
+class ScramClient {
+ public:
+  ScramClient(kj::StringPtr password, kj::EntropySource& entropySource): password(password) {
+    kj::byte random[18];
+    entropySource.generate(random);
+    nonce = kj::encodeBase64(random);
+    clientFirstBare = kj::str("n=,r=", nonce);
+  }
+
+  kj::String clientFirst() {
+    return kj::str("n,,", clientFirstBare);
+  }
+
+  kj::String clientFinal(kj::StringPtr serverFirst) {
+    kj::Maybe<kj::String> serverNonce;
+    kj::Maybe<kj::Array<kj::byte>> salt;
+    uint iterations = 0;
+    for (auto attribute: split(serverFirst)) {
+      if (attribute.startsWith("r=")) {
+        serverNonce = kj::str(attribute.slice(2));
+      } else if (attribute.startsWith("s=")) {
+        salt = kj::decodeBase64(attribute.slice(2));
+      } else if (attribute.startsWith("i=")) {
+        iterations = attribute.slice(2).parseAs<uint>();
+      }
+    }
+    auto& fullNonce = KJ_REQUIRE_NONNULL(serverNonce, "bad SCRAM server-first message");
+    auto& saltBytes = KJ_REQUIRE_NONNULL(salt, "bad SCRAM server-first message");
+    KJ_REQUIRE(fullNonce.startsWith(nonce) && iterations > 0, "bad SCRAM server-first message");
+
+    saltedPassword = kj::heapArray<kj::byte>(SHA256_DIGEST_LENGTH);
+    KJ_ASSERT(PKCS5_PBKDF2_HMAC(password.begin(), password.size(), saltBytes.begin(),
+                  saltBytes.size(), iterations, EVP_sha256(), saltedPassword.size(),
+                  saltedPassword.begin()) == 1);
+    auto clientKey = hmacSha256(saltedPassword, "Client Key"_kj.asBytes());
+    kj::byte storedKey[SHA256_DIGEST_LENGTH];
+    SHA256(clientKey.begin(), clientKey.size(), storedKey);
+
+    // "biws" is "n,," in base64: no channel binding.
+    auto withoutProof = kj::str("c=biws,r=", fullNonce);
+    authMessage = kj::str(clientFirstBare, ",", serverFirst, ",", withoutProof);
+    auto signature = hmacSha256(storedKey, authMessage.asBytes());
+    for (auto i: kj::indices(clientKey)) clientKey[i] ^= signature[i];
+    return kj::str(withoutProof, ",p=", kj::encodeBase64(clientKey));
+  }
+
+  void verifyServerFinal(kj::StringPtr serverFinal) {
+    KJ_REQUIRE(serverFinal.startsWith("v="), "SCRAM authentication failed", serverFinal);
+    auto serverKey = hmacSha256(saltedPassword, "Server Key"_kj.asBytes());
+    auto expected = hmacSha256(serverKey, authMessage.asBytes());
+    auto actual = kj::decodeBase64(serverFinal.slice(2));
+    KJ_REQUIRE(actual.asPtr() == expected.asPtr(), "Postgres server failed SCRAM verification");
+  }
+
+ private:
+  kj::StringPtr password;
+  kj::String nonce;
+  kj::String clientFirstBare;
+  kj::Array<kj::byte> saltedPassword;
+  kj::String authMessage;
+
+  static kj::Vector<kj::String> split(kj::StringPtr text) {
+    kj::Vector<kj::String> result;
+    size_t start = 0;
+    for (auto i: kj::zeroTo(text.size() + 1)) {
+      if (i == text.size() || text[i] == ',') {
+        result.add(kj::str(text.slice(start, i)));
+        start = i + 1;
+      }
+    }
+    return result;
+  }
+};
+
+}  // namespace
+
+struct PgPool::Upstream {
+  explicit Upstream(kj::Own<kj::AsyncIoStream> streamParam)
+      : stream(kj::mv(streamParam)),
+        reader(*stream) {}
+
+  kj::Own<kj::AsyncIoStream> stream;
+  MessageReader reader;
+
+  // Statements prepared on this connection, by upstream name, with when each was last used. The
+  // names belong to the pool's `statementNames`.
+  kj::HashMap<kj::StringPtr, uint64_t> prepared;
+  uint64_t useCount = 0;
+
+  kj::TimePoint idleSince = kj::origin<kj::TimePoint>();
+};
+
+// Serves one client. The client's messages are handled in order by serveClient(), which holds
+// an upstream connection while a transaction is open and forwards the messages to it, rewritten
+// where prepared statements are involved. The upstream's replies are forwarded by pumpUpstream(),
+// which gives the connection back once the upstream is idle and has nothing left to answer.
+//
+// To keep the replies the client sees in step with what it sent, the session tracks the reply
+// each forwarded message is waiting for. Some of those replies come from messages the session
+// sent upstream on its own, and are dropped; others are made up by the session, for messages it
+// didn't need to forward, and are sent once every earlier reply has been.
+class PgPool::Session {
+ public:
+  Session(PgPool& pool, kj::AsyncIoStream& client)
+      : pool(pool),
+        client(client),
+        reader(client) {}
+
+  ~Session() noexcept(false) {
+    pump = nullptr;
+    KJ_IF_SOME(owned, upstream) {
+      auto connection = kj::mv(owned);
+      upstream = kj::none;
+      // A connection abandoned partway through anything can't be trusted with another client.
+      if (isUpstreamIdle()) {
+        pool.release(kj::mv(connection));
+      } else {
+        pool.discard(kj::mv(connection));
+      }
+    }
+  }
+
+  kj::Promise<void> run() {
+    auto paf = kj::newPromiseAndFulfiller<void>();
+    pumpFailed = kj::mv(paf.fulfiller);
+    co_await serveClient().exclusiveJoin(kj::mv(paf.promise));
+  }
+
+ private:
+  enum class Reply : uint8_t {
+    // Replies to client messages that were forwarded upstream.
+    PARSE,
+    BIND,
+    CLOSE,
+    DESCRIBE_STATEMENT,
+    DESCRIBE_PORTAL,
+    EXECUTE,
+    SYNC,
+    QUERY,
+    FUNCTION_CALL,
+
+    // Replies to messages the session sent upstream itself, which the client mustn't see.
+    INJECTED_PARSE,
+    INJECTED_CLOSE,
+
+    // Replies the session makes itself.
+    SYNTHETIC_PARSE,
+    SYNTHETIC_CLOSE,
+  };
+
+  struct Expected {
+    Reply reply;
+    // For the parsing or closing of a named statement, its upstream name, so that the connection's
+    // list of prepared statements can be fixed up if the server skips the message.
+    kj::Maybe<kj::StringPtr> statement;
+  };
+
+  struct Statement {
+    // Owned by the pool's `statementNames`.
+    kj::StringPtr upstreamName;
+    // The client's Parse message, with the statement renamed to `upstreamName`.
+    kj::Array<kj::byte> parse;
+  };
+
+  PgPool& pool;
+  kj::AsyncIoStream& client;
+  MessageReader reader;
+
+  // The client's named prepared statements.
+  kj::HashMap<kj::String, Statement> statements;
+
+  kj::Maybe<kj::Own<Upstream>> upstream;
+  std::deque<Expected> expected;
+  // The transaction status from the upstream's last ReadyForQuery.
+  char transactionStatus = 'I';
+  // Whether extended-query messages have been sent upstream since the last Sync. Until the Sync,
+  // they may leave behind an unnamed statement or portal that later messages refer to.
+  bool unsynced = false;
+  bool writingUpstream = false;
+  kj::Vector<kj::byte> toUpstream;
+
+  kj::Vector<kj::byte> toClient;
+  kj::ForkedPromise<void> clientWrites = kj::Promise<void>(kj::READY_NOW).fork();
+
+  // Declared after `upstream`, since it reads from it.
+  kj::Promise<void> pump = nullptr;
+  kj::Own<kj::PromiseFulfiller<void>> pumpFailed;
+
+  Upstream& getUpstream() {
+    return *KJ_ASSERT_NONNULL(upstream);
+  }
+
+  bool isUpstreamIdle() const {
+    return expected.empty() && transactionStatus == 'I' && !unsynced && !writingUpstream &&
+        toUpstream.empty();
+  }
+
+  kj::Promise<bool> startup() {
+    for (;;) {
+      auto maybeBody = co_await reader.tryReadStartup();
+      kj::Array<kj::byte> body;
+      KJ_IF_SOME(b, maybeBody) {
+        body = kj::mv(b);
+      } else {
+        co_return false;
+      }
+
+      auto code = BodyReader(body).readInt32();
+      if (code == SSL_REQUEST_CODE || code == GSSENC_REQUEST_CODE) {
+        // Encryption isn't supported. The client either carries on without it or gives up.
+        co_await client.write("N"_kjb);
+        continue;
+      } else if (code == CANCEL_REQUEST_CODE) {
+        // Cancellation isn't supported; the query being cancelled runs to completion.
+        co_return false;
+      } else if (code != PROTOCOL_VERSION_3) {
+        appendError(toClient, "FATAL", "0A000",
+            kj::str("unsupported frontend protocol ", code >> 16, ".", code & 0xffff));
+        co_await flushClient();
+        co_return false;
+      }
+      break;
+    }
+
+    kj::Maybe<kj::Exception> failure;
+    try {
+      co_await pool.ensureServerParameters();
+    } catch (...) {
+      failure = kj::getCaughtExceptionAsKj();
+    }
+    KJ_IF_SOME(exception, failure) {
+      appendError(toClient, "FATAL", "08006",
+          kj::str("could not connect to the database: ", exception.getDescription()));
+      co_await flushClient();
+      co_return false;
+    }
+
+    // AuthenticationOk: clients aren't asked for a password.
+    kj::byte ok[4] = {0, 0, 0, 0};
+    appendMessage(toClient, 'R', kj::arrayPtr(ok));
+    for (auto& parameter: KJ_ASSERT_NONNULL(pool.serverParameters)) {
+      toClient.addAll(parameter);
+    }
+    // BackendKeyData, which a client would only use to cancel queries.
+    kj::byte key[8];
+    pool.entropySource.generate(key);
+    appendMessage(toClient, 'K', kj::arrayPtr(key));
+    appendMessage(toClient, 'Z', "I"_kjb);
+    co_await flushClient();
+    co_return true;
+  }
+
+  kj::Promise<void> serveClient() {
+    if (!co_await startup()) co_return;
+
+    for (;;) {
+      auto maybeMessage = co_await reader.tryRead();
+      KJ_IF_SOME(message, maybeMessage) {
+        if (message.type == 'X') break;
+        co_await handleClient(kj::mv(message));
+      } else {
+        break;
+      }
+
+      // Let pipelined messages pile up, and pass them on together. Replies to the client are
+      // written in the background: a client may well send more before it reads them.
+      if (!reader.hasBufferedMessage()) {
+        co_await flushUpstream();
+        startClientWrite();
+      }
+    }
+  }
+
+  kj::Promise<void> handleClient(Message message) {
+    switch (message.type) {
+      case 'P':
+        co_await parse(kj::mv(message));
+        break;
+      case 'B':
+        co_await bind(kj::mv(message));
+        break;
+      case 'D':
+        co_await describe(kj::mv(message));
+        break;
+      case 'C':
+        co_await close(kj::mv(message));
+        break;
+      case 'Q':
+        co_await forward(message, Reply::QUERY);
+        break;
+      case 'E':
+        co_await forward(message, Reply::EXECUTE);
+        break;
+      case 'S':
+        co_await forward(message, Reply::SYNC);
+        break;
+      case 'F':
+        co_await forward(message, Reply::FUNCTION_CALL);
+        break;
+      case 'H':
+        // Flush: without an upstream connection, there's nothing to flush.
+        if (upstream != kj::none) appendMessage(toUpstream, message.type, message.body);
+        break;
+      default:
+        // COPY data, mostly, which only comes while a connection is held.
+        co_await ensureUpstream();
+        appendMessage(toUpstream, message.type, message.body);
+        break;
+    }
+  }
+
+  kj::Promise<void> forward(const Message& message, Reply reply) {
+    co_await ensureUpstream();
+    appendMessage(toUpstream, message.type, message.body);
+    expect({reply});
+  }
+
+  kj::Promise<void> parse(Message message) {
+    BodyReader body(message.body);
+    auto name = body.readString();
+    if (name.size() == 0) {
+      // Clients use the unnamed statement within the batch that parsed it, which holds on to the
+      // connection until its Sync, so it needs no tracking.
+      co_await forward(message, Reply::PARSE);
+      co_return;
+    }
+
+    auto queryAndTypes = body.remaining();
+    auto upstreamName = pool.getStatementName(queryAndTypes);
+    BodyBuilder renamed;
+    renamed.addString(upstreamName);
+    renamed.addBytes(queryAndTypes);
+    auto& statement = statements.findOrCreate(name, [&]() -> decltype(statements)::Entry {
+      return {kj::str(name), {}};
+    });
+    statement = Statement{
+      .upstreamName = upstreamName,
+      .parse = encodeMessage('P', renamed.asPtr()),
+    };
+
+    co_await ensureUpstream();
+    if (isPrepared(statement)) {
+      expect({Reply::SYNTHETIC_PARSE});
+    } else {
+      prepare(statement, Reply::PARSE);
+    }
+  }
+
+  kj::Promise<void> bind(Message message) {
+    co_await ensureUpstream();
+    BodyReader body(message.body);
+    auto portal = body.readString();
+    auto name = body.readString();
+    KJ_IF_SOME(statement, findStatement(name)) {
+      ensurePrepared(statement);
+      BodyBuilder renamed;
+      renamed.addString(portal);
+      renamed.addString(statement.upstreamName);
+      renamed.addBytes(body.remaining());
+      appendMessage(toUpstream, 'B', renamed.asPtr());
+    } else {
+      appendMessage(toUpstream, message.type, message.body);
+    }
+    expect({Reply::BIND});
+  }
+
+  kj::Promise<void> describe(Message message) {
+    co_await ensureUpstream();
+    BodyReader body(message.body);
+    auto kind = body.readByte();
+    auto name = body.readString();
+    if (kind == 'P') {
+      appendMessage(toUpstream, message.type, message.body);
+      expect({Reply::DESCRIBE_PORTAL});
+      co_return;
+    }
+
+    KJ_IF_SOME(statement, findStatement(name)) {
+      ensurePrepared(statement);
+      BodyBuilder renamed;
+      renamed.addByte(kind);
+      renamed.addString(statement.upstreamName);
+      appendMessage(toUpstream, 'D', renamed.asPtr());
+    } else {
+      appendMessage(toUpstream, message.type, message.body);
+    }
+    expect({Reply::DESCRIBE_STATEMENT});
+  }
+
+  kj::Promise<void> close(Message message) {
+    BodyReader body(message.body);
+    auto kind = body.readByte();
+    auto name = body.readString();
+    if (kind == 'S' && name.size() > 0) {
+      // Upstream, the statement stays prepared for whoever uses the same query next.
+      statements.erase(name);
+      expect({Reply::SYNTHETIC_CLOSE});
+      co_return;
+    }
+    co_await forward(message, Reply::CLOSE);
+  }
+
+  kj::Maybe<Statement&> findStatement(kj::StringPtr name) {
+    if (name.size() == 0) return kj::none;
+    return statements.find(name);
+  }
+
+  bool isPrepared(const Statement& statement) {
+    auto& connection = getUpstream();
+    KJ_IF_SOME(lastUse, connection.prepared.find(statement.upstreamName)) {
+      lastUse = ++connection.useCount;
+      return true;
+    }
+    return false;
+  }
+
+  void ensurePrepared(const Statement& statement) {
+    if (!isPrepared(statement)) prepare(statement, Reply::INJECTED_PARSE);
+  }
+
+  // Sends the statement's Parse message upstream, first making room for it if the connection
+  // holds as many statements as it may.
+  void prepare(const Statement& statement, Reply reply) {
+    auto& connection = getUpstream();
+    while (connection.prepared.size() >= kj::max(pool.options.maxPreparedStatements, 1u)) {
+      kj::Maybe<kj::StringPtr> oldest;
+      uint64_t oldestUse = kj::maxValue;
+      for (auto& entry: connection.prepared) {
+        if (entry.value < oldestUse) {
+          oldest = entry.key;
+          oldestUse = entry.value;
+        }
+      }
+      auto name = KJ_ASSERT_NONNULL(oldest);
+      BodyBuilder closeBody;
+      closeBody.addByte('S');
+      closeBody.addString(name);
+      appendMessage(toUpstream, 'C', closeBody.asPtr());
+      connection.prepared.erase(name);
+      expect({Reply::INJECTED_CLOSE, name});
+    }
+
+    toUpstream.addAll(statement.parse);
+    connection.prepared.insert(statement.upstreamName, ++connection.useCount);
+    expect({reply, statement.upstreamName});
+  }
+
+  void expect(Expected entry) {
+    switch (entry.reply) {
+      case Reply::SYNC:
+      case Reply::QUERY:
+      case Reply::FUNCTION_CALL:
+        unsynced = false;
+        break;
+      case Reply::SYNTHETIC_PARSE:
+      case Reply::SYNTHETIC_CLOSE:
+        break;
+      default:
+        unsynced = true;
+        break;
+    }
+    expected.push_back(entry);
+    sendSyntheticReplies();
+  }
+
+  // Sends the replies the session makes itself that are next in line.
+  void sendSyntheticReplies() {
+    while (!expected.empty()) {
+      auto reply = expected.front().reply;
+      if (reply == Reply::SYNTHETIC_PARSE) {
+        appendMessage(toClient, '1', nullptr);
+      } else if (reply == Reply::SYNTHETIC_CLOSE) {
+        appendMessage(toClient, '3', nullptr);
+      } else {
+        break;
+      }
+      expected.pop_front();
+    }
+  }
+
+  kj::Promise<void> ensureUpstream() {
+    if (upstream != kj::none) co_return;
+
+    // The client may be owed replies while it waits for a connection.
+    startClientWrite();
+    upstream = co_await pool.acquire();
+    transactionStatus = 'I';
+    unsynced = false;
+    pump = pumpUpstream().eagerlyEvaluate(
+        [this](kj::Exception&& exception) { pumpFailed->reject(kj::mv(exception)); });
+  }
+
+  void releaseUpstream() {
+    auto connection = kj::mv(KJ_ASSERT_NONNULL(upstream));
+    upstream = kj::none;
+    pool.release(kj::mv(connection));
+  }
+
+  kj::Promise<void> flushUpstream() {
+    if (toUpstream.empty()) co_return;
+    auto& connection = getUpstream();
+    auto bytes = toUpstream.releaseAsArray();
+    writingUpstream = true;
+    co_await connection.stream->write(bytes);
+    writingUpstream = false;
+
+    // The upstream may have gone idle while the write was in progress.
+    if (isUpstreamIdle()) {
+      pump = nullptr;
+      releaseUpstream();
+    }
+  }
+
+  // Starts writing everything in `toClient`, after any earlier writes.
+  void startClientWrite() {
+    if (!toClient.empty()) {
+      auto bytes = toClient.releaseAsArray();
+      auto write = [this, bytes = kj::mv(bytes)]() mutable {
+        auto promise = client.write(bytes);
+        return promise.attach(kj::mv(bytes));
+      };
+      clientWrites = clientWrites.addBranch().then(kj::mv(write)).fork();
+    }
+  }
+
+  kj::Promise<void> flushClient() {
+    startClientWrite();
+    return clientWrites.addBranch();
+  }
+
+  kj::Promise<void> pumpUpstream() {
+    auto& connection = getUpstream();
+    for (;;) {
+      auto message = co_await connection.reader.read();
+      handleUpstream(message);
+
+      if (!connection.reader.hasBufferedMessage() || toClient.size() >= FLUSH_THRESHOLD) {
+        co_await flushClient();
+      }
+      if (isUpstreamIdle()) {
+        co_await flushClient();
+        // The client may have sent more while that was being written.
+        if (isUpstreamIdle()) {
+          releaseUpstream();
+          co_return;
+        }
+      }
+    }
+  }
+
+  bool headIs(Reply reply) const {
+    return !expected.empty() && expected.front().reply == reply;
+  }
+
+  void handleUpstream(const Message& message) {
+    switch (message.type) {
+      case '1':  // ParseComplete
+        KJ_REQUIRE(headIs(Reply::PARSE) || headIs(Reply::INJECTED_PARSE),
+            "unexpected ParseComplete from Postgres");
+        if (headIs(Reply::PARSE)) forwardToClient(message);
+        complete();
+        return;
+      case '2':  // BindComplete
+        KJ_REQUIRE(headIs(Reply::BIND), "unexpected BindComplete from Postgres");
+        forwardToClient(message);
+        complete();
+        return;
+      case '3':  // CloseComplete
+        KJ_REQUIRE(headIs(Reply::CLOSE) || headIs(Reply::INJECTED_CLOSE),
+            "unexpected CloseComplete from Postgres");
+        if (headIs(Reply::CLOSE)) forwardToClient(message);
+        complete();
+        return;
+      case 'T':  // RowDescription
+      case 'n':  // NoData
+        forwardToClient(message);
+        if (headIs(Reply::DESCRIBE_STATEMENT) || headIs(Reply::DESCRIBE_PORTAL)) complete();
+        return;
+      case 'C':  // CommandComplete
+      case 'I':  // EmptyQueryResponse
+      case 's':  // PortalSuspended
+        forwardToClient(message);
+        if (headIs(Reply::EXECUTE)) complete();
+        return;
+      case 'Z':  // ReadyForQuery
+        KJ_REQUIRE(message.body.size() == 1, "bad ReadyForQuery from Postgres");
+        transactionStatus = message.body[0];
+        forwardToClient(message);
+        if (headIs(Reply::SYNC) || headIs(Reply::QUERY) || headIs(Reply::FUNCTION_CALL)) {
+          complete();
+        }
+        return;
+      case 'E':  // ErrorResponse
+        forwardToClient(message);
+        if (!expected.empty() && !headIs(Reply::QUERY) && !headIs(Reply::FUNCTION_CALL)) {
+          skipToSync();
+        }
+        return;
+      default:
+        forwardToClient(message);
+        return;
+    }
+  }
+
+  // After an error in an extended-query message, the server ignores everything up to the next
+  // Sync, so none of those messages will be answered.
+  void skipToSync() {
+    auto& connection = getUpstream();
+    while (!expected.empty() && expected.front().reply != Reply::SYNC) {
+      auto& entry = expected.front();
+      KJ_IF_SOME(statement, entry.statement) {
+        if (entry.reply == Reply::INJECTED_CLOSE) {
+          connection.prepared.upsert(statement, 0, [](auto&&...) {});
+        } else {
+          connection.prepared.erase(statement);
+        }
+      }
+      expected.pop_front();
+    }
+  }
+
+  void complete() {
+    expected.pop_front();
+    sendSyntheticReplies();
+  }
+
+  void forwardToClient(const Message& message) {
+    appendMessage(toClient, message.type, message.body);
+  }
+};
+
+PgPool::PgPool(
+    kj::Timer& timer, kj::EntropySource& entropySource, ConnectFunc connect, Options options)
+    : timer(timer),
+      entropySource(entropySource),
+      connect(kj::mv(connect)),
+      options(kj::mv(options)) {
+  if (this->options.idleTimeout > 0 * kj::SECONDS) {
+    reaper = reapIdle().eagerlyEvaluate(
+        [](kj::Exception&& exception) { KJ_LOG(ERROR, "Postgres pool reaper failed", exception); });
+  }
+}
+
+PgPool::~PgPool() noexcept(false) {}
+
+kj::Promise<void> PgPool::serve(kj::AsyncIoStream& client) {
+  auto session = kj::heap<Session>(*this, client);
+  co_await session->run();
+}
+
+kj::Promise<kj::Own<PgPool::Upstream>> PgPool::acquire() {
+  for (;;) {
+    if (!idle.empty()) {
+      auto upstream = kj::mv(idle.back());
+      idle.removeLast();
+      co_return upstream;
+    }
+
+    if (connectionCount < options.maxConnections) {
+      ++connectionCount;
+      // Gives the slot back if opening fails, or the client gives up on it.
+      bool opened = false;
+      KJ_DEFER(if (!opened) {
+        --connectionCount;
+        wakeWaiter();
+      });
+      auto upstream = co_await open();
+      opened = true;
+      co_return kj::mv(upstream);
+    }
+
+    auto paf = kj::newPromiseAndFulfiller<void>();
+    waiters.push_back(kj::mv(paf.fulfiller));
+    co_await paf.promise;
+  }
+}
+
+void PgPool::release(kj::Own<Upstream> upstream) {
+  upstream->idleSince = timer.now();
+  idle.add(kj::mv(upstream));
+  wakeWaiter();
+}
+
+void PgPool::discard(kj::Own<Upstream> upstream) {
+  --connectionCount;
+  wakeWaiter();
+}
+
+void PgPool::wakeWaiter() {
+  while (!waiters.empty()) {
+    auto waiter = kj::mv(waiters.front());
+    waiters.pop_front();
+    // Skip clients that gave up waiting.
+    if (waiter->isWaiting()) {
+      waiter->fulfill();
+      return;
+    }
+  }
+}
+
+kj::Promise<kj::Own<PgPool::Upstream>> PgPool::open() {
+  auto upstream = kj::heap<Upstream>(co_await connect());
+
+  BodyBuilder startup;
+  startup.addInt32(PROTOCOL_VERSION_3);
+  startup.addString("user"_kj);
+  startup.addString(options.user);
+  startup.addString("database"_kj);
+  startup.addString(options.database);
+  startup.addByte(0);
+  auto startupMessage = encodeMessage(0, startup.asPtr());
+  co_await upstream->stream->write(startupMessage);
+
+  kj::Vector<kj::Array<kj::byte>> parameters;
+  kj::Maybe<ScramClient> scram;
+  for (;;) {
+    auto message = co_await upstream->reader.read();
+    switch (message.type) {
+      case 'R': {
+        BodyReader body(message.body);
+        auto request = body.readInt32();
+        BodyBuilder response;
+        switch (request) {
+          case 0:  // AuthenticationOk
+            break;
+          case 3:  // AuthenticationCleartextPassword
+            response.addString(options.password);
+            break;
+          case 5: {  // AuthenticationMD5Password
+            auto salt = body.take(4);
+            auto inner = md5Hex(kj::str(options.password, options.user).asBytes());
+            auto outer = md5Hex(kj::str(inner, salt.asChars()).asBytes());
+            response.addString(kj::str("md5", outer));
+            break;
+          }
+          case 10: {  // AuthenticationSASL
+            bool offered = false;
+            for (;;) {
+              auto mechanism = body.readString();
+              if (mechanism.size() == 0) break;
+              if (mechanism == "SCRAM-SHA-256") offered = true;
+            }
+            KJ_REQUIRE(offered, "Postgres server offered no supported SASL mechanism");
+            auto first = scram.emplace(options.password, entropySource).clientFirst();
+            response.addString("SCRAM-SHA-256"_kj);
+            response.addInt32(first.size());
+            response.addBytes(first.asBytes());
+            break;
+          }
+          case 11: {  // AuthenticationSASLContinue
+            auto& client = KJ_REQUIRE_NONNULL(scram, "unexpected SASLContinue from Postgres");
+            response.addBytes(client.clientFinal(kj::str(body.remaining().asChars())).asBytes());
+            break;
+          }
+          case 12:  // AuthenticationSASLFinal
+            KJ_REQUIRE_NONNULL(scram, "unexpected SASLFinal from Postgres")
+                .verifyServerFinal(kj::str(body.remaining().asChars()));
+            break;
+          default:
+            KJ_FAIL_REQUIRE("Postgres server asked for an unsupported authentication method", request);
+        }
+        if (response.asPtr().size() > 0) {
+          auto responseMessage = encodeMessage('p', response.asPtr());
+          co_await upstream->stream->write(responseMessage);
+        }
+        break;
+      }
+      case 'S':  // ParameterStatus
+        parameters.add(encodeMessage('S', message.body));
+        break;
+      case 'E':
+        KJ_FAIL_REQUIRE("Postgres server refused the connection", describeError(message.body));
+      case 'Z':
+        if (serverParameters == kj::none) serverParameters = parameters.releaseAsArray();
+        co_return kj::mv(upstream);
+      default:
+        // BackendKeyData or NoticeResponse.
+        break;
+    }
+  }
+}
+
+kj::Promise<void> PgPool::ensureServerParameters() {
+  if (serverParameters != kj::none) co_return;
+  // Opening a connection learns them, and leaves it warm for the client's first query.
+  release(co_await acquire());
+}
+
+kj::StringPtr PgPool::getStatementName(kj::ArrayPtr<const kj::byte> queryAndTypes) {
+  auto key = kj::str(queryAndTypes.asChars());
+  KJ_IF_SOME(name, statementNames.find(key)) {
+    return name;
+  }
+  auto name = kj::str("workerd_", statementNames.size() + 1);
+  return statementNames.insert(kj::mv(key), kj::mv(name)).value;
+}
+
+kj::Promise<void> PgPool::reapIdle() {
+  for (;;) {
+    co_await timer.afterDelay(options.idleTimeout);
+    auto now = timer.now();
+    size_t expired = 0;
+    while (expired < idle.size() && now - idle[expired]->idleSince >= options.idleTimeout) {
+      ++expired;
+    }
+    if (expired > 0) {
+      kj::Vector<kj::Own<Upstream>> kept(idle.size() - expired);
+      for (auto i: kj::range(expired, idle.size())) kept.add(kj::mv(idle[i]));
+      idle = kj::mv(kept);
+      connectionCount -= expired;
+    }
+  }
+}
+
+}  // namespace workerd::server
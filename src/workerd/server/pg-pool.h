@@ -0,0 +1,102 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <kj/async-io.h>
+#include <kj/function.h>
+#include <kj/map.h>
+#include <kj/timer.h>
+#include <kj/vector.h>
+
+#include <deque>
+
+namespace workerd::server {
+
+// A Postgres connection pooler, like the one Hyperdrive runs in production. It speaks the
+// Postgres wire protocol to its clients as if it were the server, and forwards their queries over
+// a pool of upstream connections that stay open between clients.
+//
+// Pooling is per transaction: a client holds an upstream connection from its first message until
+// the server reports that it's idle outside a transaction, and then gives it back. So session
+// state -- SET, LISTEN, advisory locks, temporary tables -- doesn't carry over from one
+// transaction to the next. Named prepared statements do: the pool keeps each client's
+// statements, and prepares them on whichever upstream connection the client gets. Statements
+// with the same text and parameter types share one name upstream, so a connection prepares each
+// at most once no matter how many clients use it.
+//
+// Clients aren't authenticated. The pool logs in upstream with the credentials it's configured
+// with, over plain TCP, using password, MD5 or SCRAM-SHA-256 authentication.
+class PgPool {
+ public:
+  struct Options {
+    kj::String database;
+    kj::String user;
+    kj::String password;
+
+    // Upstream connections open at once, busy or idle. Clients wait for one when all are busy.
+    uint maxConnections = 10;
+
+    // How long an upstream connection may sit idle before it's closed. Zero keeps them forever.
+    kj::Duration idleTimeout = 60 * kj::SECONDS;
+
+    // Prepared statements kept on each upstream connection. The least recently used one is
+    // deallocated to make room for another.
+    uint maxPreparedStatements = 100;
+  };
+
+  using ConnectFunc = kj::Function<kj::Promise<kj::Own<kj::AsyncIoStream>>()>;
+
+  // `connect` opens a new connection to the Postgres server.
+  PgPool(kj::Timer& timer, kj::EntropySource& entropySource, ConnectFunc connect, Options options);
+  ~PgPool() noexcept(false);
+  KJ_DISALLOW_COPY_AND_MOVE(PgPool);
+
+  // Serves one client connection until the client disconnects.
+  kj::Promise<void> serve(kj::AsyncIoStream& client);
+
+  // Upstream connections currently open, and how many of them are idle.
+  uint getConnectionCount() const {
+    return connectionCount;
+  }
+  uint getIdleConnectionCount() const {
+    return idle.size();
+  }
+
+ private:
+  class Session;
+  struct Upstream;
+
+  kj::Timer& timer;
+  kj::EntropySource& entropySource;
+  ConnectFunc connect;
+  Options options;
+
+  // Includes connections still being opened.
+  uint connectionCount = 0;
+  // Most recently used last.
+  kj::Vector<kj::Own<Upstream>> idle;
+  // Clients waiting for a connection while all are busy, first come first served.
+  std::deque<kj::Own<kj::PromiseFulfiller<void>>> waiters;
+
+  // The ParameterStatus messages the server sent when the first upstream connection started,
+  // which are repeated to each client when it starts.
+  kj::Maybe<kj::Array<kj::Array<kj::byte>>> serverParameters;
+
+  // Upstream names of prepared statements, by their query text and parameter types.
+  kj::HashMap<kj::String, kj::String> statementNames;
+
+  kj::Promise<void> reaper = nullptr;
+
+  kj::Promise<kj::Own<Upstream>> acquire();
+  void release(kj::Own<Upstream> upstream);
+  void discard(kj::Own<Upstream> upstream);
+  void wakeWaiter();
+  kj::Promise<kj::Own<Upstream>> open();
+  kj::Promise<void> ensureServerParameters();
+  kj::StringPtr getStatementName(kj::ArrayPtr<const kj::byte> queryAndTypes);
+  kj::Promise<void> reapIdle();
+};
+
+}  // namespace workerd::server
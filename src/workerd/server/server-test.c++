@@ -835,6 +835,40 @@ KJ_TEST("Server: value bindings") {
       "GRAULT is null? true");
 }
 
+KJ_TEST("Server: identical Wasm bindings share a compilation") {
+  TestServer test(singleWorker(R"((
+    compatibilityDate = "2022-08-17",
+    serviceWorkerScript =
+      `const a = new WebAssembly.Instance(SQUARE_A, {});
+      `const b = new WebAssembly.Instance(SQUARE_B, {});
+      `addEventListener("fetch", event => {
+      `  event.respondWith(new Response(
+      `      [SQUARE_A !== SQUARE_B, a.exports.square(3), b.exports.square(4)].join(" ")));
+      `});
+      ,
+    bindings = [
+      ( name = "SQUARE_A",
+        wasmModule = 0x"00 61 73 6d 01 00 00 00  01 06 01 60 01 7f 01 7f
+                        03 02 01 00 05 03 01 00  02 06 08 01 7f 01 41 80
+                        88 04 0b 07 13 02 06 6d  65 6d 6f 72 79 02 00 06
+                        73 71 75 61 72 65 00 00  0a 09 01 07 00 20 00 20
+                        00 6c 0b"
+      ),
+      ( name = "SQUARE_B",
+        wasmModule = 0x"00 61 73 6d 01 00 00 00  01 06 01 60 01 7f 01 7f
+                        03 02 01 00 05 03 01 00  02 06 08 01 7f 01 41 80
+                        88 04 0b 07 13 02 06 6d  65 6d 6f 72 79 02 00 06
+                        73 71 75 61 72 65 00 00  0a 09 01 07 00 20 00 20
+                        00 6c 0b"
+      ),
+    ]
+  ))"_kj));
+
+  test.start();
+  auto conn = test.connect("test-addr");
+  conn.httpGet200("/", "true 9 16");
+}
+
 KJ_TEST("Server: WebCrypto bindings") {
   TestServer test(singleWorker(R"((
     compatibilityDate = "2022-08-17",
@@ -1441,6 +1475,33 @@ KJ_TEST("Server: invalid entrypoint") {
       "has no such named entrypoint.\n");
 }
 
+KJ_TEST("Server: invalid cron triggers") {
+  TestServer test(R"((
+    services = [
+      ( name = "hello",
+        worker = (
+          compatibilityDate = "2022-08-17",
+          modules = [
+            ( name = "main.js",
+              esModule =
+                `export default {
+                `  async fetch(request, env) {
+                `    return new Response("hello");
+                `  }
+                `}
+            )
+          ],
+          cron = ( schedules = [ "*/5 * * * *", "61 * * * *" ] )
+        )
+      ),
+    ]
+  ))"_kj);
+
+  test.expectErrors(
+      "Worker \"hello\"'s cron schedule \"61 * * * *\" is not a valid cron expression.\n"
+      "Worker \"hello\" has cron schedules, but doesn't export a scheduled() handler.\n");
+}
+
 KJ_TEST("Server: call queue handler on service binding") {
   TestServer test(R"((
     services = [
@@ -1511,6 +1572,89 @@ KJ_TEST("Server: call queue handler on service binding") {
   conn.httpGet200("/", "queue outcome: ok, ackAll: true");
 }
 
+KJ_TEST("Server: local queue batches and redelivers messages") {
+  TestServer test(R"((
+    services = [
+      ( name = "hello",
+        worker = (
+          compatibilityDate = "2022-08-17",
+          modules = [
+            ( name = "main.js",
+              esModule =
+                `let batches = [];
+                `export default {
+                `  async fetch(request, env) {
+                `    let url = new URL(request.url);
+                `    if (url.pathname == "/send") {
+                `      await env.queue.send(url.searchParams.get("body"));
+                `      return new Response("sent");
+                `    } else {
+                `      return new Response(batches.join(" "));
+                `    }
+                `  },
+                `  async queue(batch) {
+                `    batches.push(batch.queue + "[" +
+                `        batch.messages.map(m => m.body + ":" + m.attempts).join(",") + "]");
+                `    for (let m of batch.messages) {
+                `      if (m.body == "r" && m.attempts == 1) m.retry();
+                `    }
+                `  }
+                `}
+            )
+          ],
+          bindings = [ ( name = "queue", queue = "q" ) ]
+        )
+      ),
+      ( name = "q",
+        localQueue = (
+          consumer = "hello",
+          queueName = "jobs",
+          maxBatchSize = 2,
+          maxWaitMs = 1000
+        )
+      ),
+    ],
+    sockets = [
+      ( name = "main",
+        address = "test-addr",
+        service = "hello"
+      )
+    ]
+  ))"_kj);
+
+  test.server.allowExperimental();
+  test.start();
+  auto conn = test.connect("test-addr");
+
+  // The first two messages fill a batch, which goes out right away. The third waits for
+  // `maxWaitMs`.
+  conn.httpGet200("/send?body=a", "sent");
+  conn.httpGet200("/send?body=b", "sent");
+  conn.httpGet200("/send?body=c", "sent");
+  conn.httpGet200("/read", "jobs[a:1,b:1]");
+  test.wait(2);
+  conn.httpGet200("/read", "jobs[a:1,b:1] jobs[c:1]");
+
+  // A retried message comes back in a later batch.
+  conn.httpGet200("/send?body=r", "sent");
+  test.wait(5);
+  conn.httpGet200("/read", "jobs[a:1,b:1] jobs[c:1] jobs[r:1] jobs[r:2]");
+}
+
+KJ_TEST("Server: local queues require --experimental") {
+  TestServer test(R"((
+    services = [
+      ( name = "q",
+        localQueue = ( consumer = "q" )
+      ),
+    ]
+  ))"_kj);
+
+  test.expectErrors(
+      "Local queue services are an experimental feature which may change or go away in the "
+      "future. You must run workerd with `--experimental` to use this feature.\n");
+}
+
 KJ_TEST("Server: Durable Objects (in memory)") {
   TestServer test(R"((
     services = [
@@ -1576,6 +1720,46 @@ KJ_TEST("Server: Durable Objects (in memory)") {
       "/bar", "02b496f65dd35cbac90e3e72dc5a398ee93926ea4a3821e26677082d2e6f9b79: http://foo/bar 2");
 }
 
+KJ_TEST("Server: Durable Objects are rejected when serving on multiple threads") {
+  TestServer test(R"((
+    services = [
+      ( name = "hello",
+        worker = (
+          compatibilityDate = "2022-08-17",
+          modules = [
+            ( name = "main.js",
+              esModule =
+                `export default {
+                `  async fetch(request, env) {
+                `    return new Response("ok");
+                `  }
+                `}
+                `export class MyActorClass {}
+            )
+          ],
+          durableObjectNamespaces = [
+            ( className = "MyActorClass",
+              uniqueKey = "mykey",
+            )
+          ],
+          durableObjectStorage = (inMemory = void)
+        )
+      ),
+    ],
+    sockets = [
+      ( name = "main",
+        address = "test-addr",
+        service = "hello"
+      )
+    ],
+    threads = 4
+  ))"_kj);
+
+  test.expectErrors(R"(
+    Worker service "hello" defines Durable Object namespaces, which are not supported when `threads` is greater than 1.
+  )"_blockquote);
+}
+
 KJ_TEST("Server: Durable Objects (on disk)") {
   kj::StringPtr config = R"((
     services = [
@@ -1843,6 +2027,175 @@ KJ_TEST("Server: Durable Objects (ephemeral) eviction") {
   connTwo.httpGet200("/checkEvicted", "OK");
 }
 
+KJ_TEST("Server: Durable Objects evicted early when short of memory") {
+  TestServer test(R"((
+    services = [
+      ( name = "hello",
+        worker = (
+          compatibilityDate = "2023-08-17",
+          modules = [
+            ( name = "main.js",
+              esModule =
+                `export default {
+                `  async fetch(request, env) {
+                `    let id = env.ns.idFromName("59002eb8cf872e541722977a258a12d6a93bbe8192b502e1c0cb250aa91af234");
+                `    let obj = env.ns.get(id)
+                `    if (request.url.endsWith("/setup")) {
+                `      return await obj.fetch("http://example.com/setup");
+                `    } else if (request.url.endsWith("/check")) {
+                `      try {
+                `        return await obj.fetch("http://example.com/check");
+                `      } catch(e) {
+                `        throw e;
+                `      }
+                `    } else if (request.url.endsWith("/checkEvicted")) {
+                `      return await obj.fetch("http://example.com/checkEvicted");
+                `    }
+                `    return new Response("Invalid Route!")
+                `  }
+                `}
+                `export class MyActorClass {
+                `  constructor(state, env) {
+                `    this.defaultMessage = false; // Set to true on first "setup" request
+                `  }
+                `  async fetch(request) {
+                `    if (request.url.endsWith("/setup")) {
+                `      // Request 1, set defaultMessage, will remain true as long as actor is live.
+                `      this.defaultMessage = true;
+                `      return new Response("OK");
+                `    } else if (request.url.endsWith("/check")) {
+                `      // Request 2, assert that actor is still in alive (defaultMessage is still true).
+                `      if (this.defaultMessage) {
+                `        // Actor is still alive and we did not re-run the constructor
+                `        return new Response("OK");
+                `      }
+                `      throw new Error("Error: Actor was evicted!");
+                `    } else if (request.url.endsWith("/checkEvicted")) {
+                `      // Final request (3), check if the defaultMessage has been set to false,
+                `      //  indicating the actor was evicted
+                `      if (!this.defaultMessage) {
+                `        // Actor was evicted and we re-ran the constructor!
+                `        return new Response("OK");
+                `      }
+                `      throw new Error("Error: Actor was not evicted! We were still alive.");
+                `    }
+                `  }
+                `}
+            )
+          ],
+          bindings = [(name = "ns", durableObjectNamespace = "MyActorClass")],
+          durableObjectNamespaces = [
+            ( className = "MyActorClass",
+              uniqueKey = "mykey",
+            )
+          ],
+          durableObjectStorage = (inMemory = void)
+        )
+      ),
+    ],
+    sockets = [
+      ( name = "main",
+        address = "test-addr",
+        service = "hello"
+      )
+    ],
+    # Any isolate is over this, so idle actors are evicted on the next tick.
+    actorMemory = (maxIsolateHeapBytes = 1)
+  ))"_kj);
+
+  test.start();
+  auto conn = test.connect("test-addr");
+  conn.httpGet200("/setup", "OK");
+  conn.httpGet200("/check", "OK");
+
+  // Well before the 10 second inactivity timeout.
+  test.wait(2);
+  conn.httpGet200("/checkEvicted", "OK");
+}
+
+KJ_TEST("Server: lazy workers discard their isolate while idle") {
+  TestServer test(R"((
+    services = [
+      ( name = "hello",
+        worker = (
+          compatibilityDate = "2023-08-17",
+          modules = [
+            ( name = "main.js",
+              esModule =
+                `let count = 0;
+                `export default {
+                `  async fetch(request) {
+                `    return new Response(`requests: ${++count}`);
+                `  }
+                `}
+            )
+          ],
+          lazy = true,
+          lazyIdleTimeoutSeconds = 5
+        )
+      ),
+    ],
+    sockets = [
+      ( name = "main",
+        address = "test-addr",
+        service = "hello"
+      )
+    ]
+  ))"_kj);
+
+  test.start();
+  auto conn = test.connect("test-addr");
+  conn.httpGet200("/", "requests: 1");
+  test.wait(2);
+  conn.httpGet200("/", "requests: 2");
+
+  // Idle for longer than the timeout, so the next request gets a fresh isolate.
+  test.wait(6);
+  conn.httpGet200("/", "requests: 1");
+}
+
+KJ_TEST("Server: requests are shed while an isolate is near its heap limit") {
+  TestServer test(R"((
+    services = [
+      ( name = "hello",
+        worker = (
+          compatibilityDate = "2023-08-17",
+          modules = [
+            ( name = "main.js",
+              esModule =
+                `export default {
+                `  async fetch(request) {
+                `    globalThis.hog = new Array(5_000_000).fill(1.5);
+                `    return new Response("OK");
+                `  }
+                `}
+            )
+          ],
+          memoryLimit = (maxHeapBytes = 67108864, shedPercent = 50)
+        )
+      ),
+    ],
+    sockets = [
+      ( name = "main",
+        address = "test-addr",
+        service = "hello"
+      )
+    ]
+  ))"_kj);
+
+  test.start();
+  auto conn = test.connect("test-addr");
+  conn.httpGet200("/", "OK");
+
+  // The first request left 40MB on the heap, more than half of the limit.
+  conn.sendHttpGet("/");
+  conn.recv(R"(
+    HTTP/1.1 503 Service Unavailable
+    Content-Length: 19
+
+    Service Unavailable)"_blockquote);
+}
+
 KJ_TEST("Server: Durable Objects (ephemeral) prevent eviction") {
   TestServer test(R"((
     services = [
@@ -1981,11 +2334,11 @@ KJ_TEST("Server: Durable Object evictions when callback scheduled") {
                 `      // indicating the actor was evicted
                 `      if (!this.defaultMessage) {
                 `        var count = await this.storage.get("count");
-                `        if (!(4 < count && count < 8)) {
-                `          // Something must have gone wrong. We have a 70 sec expiration,
-                `          // and worst case is it takes ~140 seconds to evict. The callback runs
-                `          // every 20 seconds, so it has to be evicted before the 8th callback.
-                `          throw new Error(`Callback ran ${count} times, expected between 4 to 8!`);
+                `        if (count != 3) {
+                `          // Something must have gone wrong. We have a 70 sec expiration from when
+                `          // the last client disconnected, 25 seconds in. The callback runs every
+                `          // 20 seconds, so it runs at 45, 65 and 85 seconds before we're evicted.
+                `          throw new Error(`Callback ran ${count} times, expected 3!`);
                 `        }
                 `        // Actor was evicted and we had the right count!
                 `        return new Response("OK");
@@ -2058,9 +2411,8 @@ KJ_TEST("Server: Durable Object evictions when callback scheduled") {
     // Note that the `/20seconds` path calls setInterval to run every 20 seconds, and never clears.
     auto connFour = test.connect("test-addr");
     connFour.httpGet200("/20Seconds", "OK");
-    // It's unlikely, but the worst case is the cleanupLoop checks just before the 70 sec expiration,
-    // and has to wait another 70 seconds before trying to remove again. We'll wait for 142 seconds
-    // to account for this.
+    // The actor is removed 70 seconds after this request ends. Wait well past that to make sure
+    // its callback doesn't keep running afterwards.
     test.wait(142);
 
     auto connFive = test.connect("test-addr");
@@ -2941,6 +3293,9 @@ KJ_TEST("Server: disk service") {
   dir->openFile(kj::Path({"baz", "qux.txt"}), mode)->writeAll("hello from qux.txt\n");
   dir->openFile(kj::Path({".dot"}), mode)->writeAll("this is a dotfile\n");
   dir->openFile(kj::Path({".dotdir", "foo"}), mode)->writeAll("this is a dotfile\n");
+  dir->openFile(kj::Path({"style.css"}), mode)->writeAll("body {}\n");
+  dir->openFile(kj::Path({"style.css.br"}), mode)->writeAll("brotli\n");
+  dir->openFile(kj::Path({"style.css.gz"}), mode)->writeAll("gzipped\n");
 
   test.start();
 
@@ -2951,6 +3306,7 @@ KJ_TEST("Server: disk service") {
     HTTP/1.1 200 OK
     Content-Length: 19
     Content-Type: application/octet-stream
+    ETag: W/"ae88e6257600-13"
     Last-Modified: Sat, 03 Jan 1970 05:18:23 GMT
 
     hello from foo.txt
@@ -2961,6 +3317,7 @@ KJ_TEST("Server: disk service") {
     HTTP/1.1 200 OK
     Content-Length: 19
     Content-Type: application/octet-stream
+    ETag: W/"7ad187fd8768c0-13"
     Last-Modified: Fri, 05 Feb 1971 02:52:09 GMT
 
     hello from bar.txt
@@ -2971,6 +3328,7 @@ KJ_TEST("Server: disk service") {
     HTTP/1.1 200 OK
     Content-Length: 19
     Content-Type: application/octet-stream
+    ETag: W/"0-13"
     Last-Modified: Thu, 01 Jan 1970 00:00:00 GMT
 
     hello from qux.txt
@@ -2991,6 +3349,7 @@ KJ_TEST("Server: disk service") {
     HTTP/1.1 200 OK
     Content-Length: 11
     Content-Type: application/octet-stream
+    ETag: W/"ae88e6257600-b"
     Last-Modified: Sat, 03 Jan 1970 05:18:23 GMT
 
   )"_blockquote);
@@ -3007,6 +3366,7 @@ KJ_TEST("Server: disk service") {
     Content-Length: 3
     Content-Type: application/octet-stream
     Content-Range: bytes 3-5/11
+    ETag: W/"ae88e6257600-b"
     Last-Modified: Sat, 03 Jan 1970 05:18:23 GMT
 
     345)"_blockquote);
@@ -3022,6 +3382,7 @@ KJ_TEST("Server: disk service") {
     HTTP/1.1 200 OK
     Content-Length: 11
     Content-Type: application/octet-stream
+    ETag: W/"ae88e6257600-b"
     Last-Modified: Sat, 03 Jan 1970 05:18:23 GMT
 
     0123456789
@@ -3038,11 +3399,59 @@ KJ_TEST("Server: disk service") {
     HTTP/1.1 200 OK
     Content-Length: 11
     Content-Type: application/octet-stream
+    ETag: W/"ae88e6257600-b"
     Last-Modified: Sat, 03 Jan 1970 05:18:23 GMT
 
     0123456789
   )"_blockquote);
 
+  // GET with a matching If-None-Match is not modified. Weak comparison applies, and the ETag
+  // can appear anywhere in the list.
+  conn.send(R"(
+    GET /numbers.txt HTTP/1.1
+    Host: foo
+    If-None-Match: "abc", "ae88e6257600-b"
+
+  )"_blockquote);
+  conn.recv(R"(
+    HTTP/1.1 304 Not Modified
+    ETag: W/"ae88e6257600-b"
+    Last-Modified: Sat, 03 Jan 1970 05:18:23 GMT
+
+  )"_blockquote);
+
+  // If-None-Match takes precedence over If-Modified-Since.
+  conn.send(R"(
+    GET /numbers.txt HTTP/1.1
+    Host: foo
+    If-None-Match: W/"ae88e6257600-c"
+    If-Modified-Since: Sat, 03 Jan 1970 05:18:23 GMT
+
+  )"_blockquote);
+  conn.recv(R"(
+    HTTP/1.1 200 OK
+    Content-Length: 11
+    Content-Type: application/octet-stream
+    ETag: W/"ae88e6257600-b"
+    Last-Modified: Sat, 03 Jan 1970 05:18:23 GMT
+
+    0123456789
+  )"_blockquote);
+
+  // HEAD with a matching If-Modified-Since is not modified.
+  conn.send(R"(
+    HEAD /numbers.txt HTTP/1.1
+    Host: foo
+    If-Modified-Since: Sat, 03 Jan 1970 05:18:23 GMT
+
+  )"_blockquote);
+  conn.recv(R"(
+    HTTP/1.1 304 Not Modified
+    ETag: W/"ae88e6257600-b"
+    Last-Modified: Sat, 03 Jan 1970 05:18:23 GMT
+
+  )"_blockquote);
+
   // GET with unsatisfiable range.
   conn.send(R"(
     GET /numbers.txt HTTP/1.1
@@ -3057,6 +3466,95 @@ KJ_TEST("Server: disk service") {
 
     Range Not Satisfiable)"_blockquote);
 
+  // Precompressed siblings are served to clients that accept them, preferring Brotli on ties.
+  conn.send(R"(
+    GET /style.css HTTP/1.1
+    Host: foo
+    Accept-Encoding: gzip, deflate, br
+
+  )"_blockquote);
+  conn.recv(R"(
+    HTTP/1.1 200 OK
+    Content-Length: 7
+    Content-Type: application/octet-stream
+    Content-Encoding: br
+    ETag: W/"0-7-br"
+    Last-Modified: Thu, 01 Jan 1970 00:00:00 GMT
+    Vary: Accept-Encoding
+
+    brotli
+  )"_blockquote);
+
+  // Quality values are respected.
+  conn.send(R"(
+    GET /style.css HTTP/1.1
+    Host: foo
+    Accept-Encoding: br;q=0.5, gzip
+
+  )"_blockquote);
+  conn.recv(R"(
+    HTTP/1.1 200 OK
+    Content-Length: 8
+    Content-Type: application/octet-stream
+    Content-Encoding: gzip
+    ETag: W/"0-8-gzip"
+    Last-Modified: Thu, 01 Jan 1970 00:00:00 GMT
+    Vary: Accept-Encoding
+
+    gzipped
+  )"_blockquote);
+
+  // The precompressed variant has its own validator.
+  conn.send(R"(
+    GET /style.css HTTP/1.1
+    Host: foo
+    Accept-Encoding: br
+    If-None-Match: W/"0-7-br"
+
+  )"_blockquote);
+  conn.recv(R"(
+    HTTP/1.1 304 Not Modified
+    Content-Encoding: br
+    ETag: W/"0-7-br"
+    Last-Modified: Thu, 01 Jan 1970 00:00:00 GMT
+    Vary: Accept-Encoding
+
+  )"_blockquote);
+
+  // Clients that don't accept an available encoding get the file itself.
+  conn.send(R"(
+    GET /style.css HTTP/1.1
+    Host: foo
+    Accept-Encoding: identity, br;q=0
+
+  )"_blockquote);
+  conn.recv(R"(
+    HTTP/1.1 200 OK
+    Content-Length: 8
+    Content-Type: application/octet-stream
+    ETag: W/"0-8"
+    Last-Modified: Thu, 01 Jan 1970 00:00:00 GMT
+
+    body {}
+  )"_blockquote);
+
+  // As do clients asking for files without a precompressed sibling.
+  conn.send(R"(
+    GET /baz/qux.txt HTTP/1.1
+    Host: foo
+    Accept-Encoding: br, gzip
+
+  )"_blockquote);
+  conn.recv(R"(
+    HTTP/1.1 200 OK
+    Content-Length: 19
+    Content-Type: application/octet-stream
+    ETag: W/"0-13"
+    Last-Modified: Thu, 01 Jan 1970 00:00:00 GMT
+
+    hello from qux.txt
+  )"_blockquote);
+
   // File not found...
   conn.sendHttpGet("/no-such-file.txt");
   conn.recv(R"(
@@ -3352,6 +3850,7 @@ KJ_TEST("Server: disk service allow dotfiles") {
     HTTP/1.1 200 OK
     Content-Length: 6
     Content-Type: application/octet-stream
+    ETag: W/"0-6"
     Last-Modified: Thu, 01 Jan 1970 00:00:00 GMT
 
     waldo
@@ -3697,6 +4196,112 @@ KJ_TEST("Server: JS RPC over HTTP connections") {
   conn.httpGet200("/", "got: 35");
 }
 
+KJ_TEST("Server: Durable Object namespace with peers") {
+  // The "remote" peer points back at our own loopback socket, so objects placed on it are reached
+  // over RPC and then hosted by this same process. With these peer names, "a" and "e" are placed
+  // locally while "b" and "c" are placed on "remote".
+
+  TestServer test(R"((
+    services = [
+      ( name = "hello",
+        worker = (
+          compatibilityDate = "2024-02-23",
+          modules = [
+            ( name = "main.js",
+              esModule =
+                `export default {
+                `  async fetch(request, env) {
+                `    let name = new URL(request.url).pathname.slice(1);
+                `    return await env.ns.get(name).fetch(request);
+                `  }
+                `}
+                `export class MyActorClass {
+                `  constructor(state, env) {
+                `    this.id = state.id;
+                `    this.count = 0;
+                `  }
+                `  async fetch(request) {
+                `    return new Response(this.id + " " + this.count++);
+                `  }
+                `}
+            )
+          ],
+          bindings = [(name = "ns", durableObjectNamespace = "MyActorClass")],
+          durableObjectNamespaces = [
+            ( className = "MyActorClass",
+              ephemeralLocal = void,
+              peers = [
+                (name = "local"),
+                (name = "remote", service = "peer"),
+              ]
+            )
+          ]
+        )
+      ),
+      (name = "peer", external = (address = "loopback", http = (capnpConnectHost = "cappy")))
+    ],
+    sockets = [
+      ( name = "main", address = "test-addr", service = "hello" ),
+      ( name = "alt1", address = "loopback", service = "hello",
+        http = (capnpConnectHost = "cappy")),
+    ]
+  ))"_kj);
+
+  test.server.allowExperimental();
+  test.start();
+
+  auto conn = test.connect("test-addr");
+  conn.httpGet200("/a", "a 0");
+  conn.httpGet200("/b", "b 0");
+  conn.httpGet200("/c", "c 0");
+  conn.httpGet200("/b", "b 1");
+  conn.httpGet200("/a", "a 1");
+  conn.httpGet200("/e", "e 0");
+  conn.httpGet200("/c", "c 1");
+}
+
+KJ_TEST("Server: Durable Object peers must include this process once") {
+  TestServer test(R"((
+    services = [
+      ( name = "hello",
+        worker = (
+          compatibilityDate = "2024-02-23",
+          modules = [
+            ( name = "main.js",
+              esModule =
+                `export default {
+                `  async fetch(request, env) {
+                `    return new Response("ok");
+                `  }
+                `}
+                `export class MyActorClass {}
+            )
+          ],
+          durableObjectNamespaces = [
+            ( className = "MyActorClass",
+              ephemeralLocal = void,
+              peers = [
+                (name = "one", service = "peer"),
+                (name = "two", service = "hello"),
+              ]
+            )
+          ]
+        )
+      ),
+      (name = "peer", external = (address = "loopback", http = (capnpConnectHost = "cappy")))
+    ],
+    sockets = [
+      ( name = "main", address = "test-addr", service = "hello" ),
+    ]
+  ))"_kj);
+
+  test.server.allowExperimental();
+  test.expectErrors(R"(
+    Worker "hello"'s Durable Object class "MyActorClass"'s peer "two" must be an external HTTP service with `capnpConnectHost` set.
+    Worker "hello"'s Durable Object class "MyActorClass" must list exactly one peer without a `service`, representing this process.
+  )"_blockquote);
+}
+
 // =======================================================================================
 
 // TODO(beta): Test TLS (send and receive)
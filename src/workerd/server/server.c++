@@ -4,11 +4,18 @@
 
 #include "server.h"
 
+#include "cron-scheduler.h"
+#include "local-cache-tier.h"
+#include "metrics.h"
+#include "pg-pool.h"
+#include "tail-sampler.h"
 #include "workerd-api.h"
 
 #include <workerd/api/actor-state.h>
 #include <workerd/api/analytics-engine.capnp.h>
+#include <workerd/api/hibernatable-web-socket.h>
 #include <workerd/api/pyodide/pyodide.h>
+#include <workerd/api/queue.h>
 #include <workerd/api/trace.h>
 #include <workerd/api/worker-rpc.h>
 #include <workerd/io/actor-cache.h>
@@ -23,6 +30,10 @@
 #include <workerd/io/worker.h>
 #include <workerd/util/http-util.h>
 #include <workerd/util/mimetype.h>
+#include <workerd/util/pprof.h>
+#include <workerd/util/shared-memory-table.h>
+#include <workerd/util/thread-pool.h>
+#include <workerd/util/thread-scopes.h>
 #include <workerd/util/use-perfetto-categories.h>
 #include <workerd/util/uuid.h>
 
@@ -38,10 +49,17 @@
 #include <kj/debug.h>
 #include <kj/encoding.h>
 #include <kj/glob-filter.h>
+#include <kj/list.h>
 #include <kj/map.h>
 
+#include <cstdio>
 #include <cstdlib>
 #include <ctime>
+#include <deque>
+
+#if __linux__
+#include <unistd.h>
+#endif
 
 namespace workerd::server {
 
@@ -86,6 +104,21 @@ static kj::Maybe<PemData> decodePem(kj::ArrayPtr<const char> text) {
   return PemData{kj::String(kj::mv(nameArr)), kj::mv(data)};
 }
 
+// Returns the resident set size of this process, if the platform makes that cheap to find out.
+static kj::Maybe<uint64_t> getResidentBytes() {
+#if __linux__
+  // The second field of /proc/self/statm is the resident set, in pages.
+  FILE* statm = fopen("/proc/self/statm", "re");
+  if (statm == nullptr) return kj::none;
+  KJ_DEFER(fclose(statm));
+  unsigned long size, resident;
+  if (fscanf(statm, "%lu %lu", &size, &resident) != 2) return kj::none;
+  return static_cast<uint64_t>(resident) * sysconf(_SC_PAGESIZE);
+#else
+  return kj::none;
+#endif
+}
+
 // Returns a time string in the format HTTP likes to use.
 static kj::String httpTime(kj::Date date) {
   time_t time = (date - kj::UNIX_EPOCH) / kj::SECONDS;
@@ -145,6 +178,24 @@ static kj::String escapeJsonString(kj::StringPtr text) {
   return kj::str("\"", escaped.releaseAsArray(), "\"");
 }
 
+// Rendezvous-hashing weight of `peerName` for the Durable Object `id`: an object is placed on the
+// peer with the highest weight. This must give the same answer in every process, so it's a fixed
+// FNV-1a hash with a final mix rather than kj::hashCode().
+uint64_t placementWeight(kj::StringPtr peerName, kj::StringPtr id) {
+  uint64_t h = 0xcbf29ce484222325ull;
+  auto mix = [&](kj::ArrayPtr<const char> bytes) {
+    for (char c: bytes) {
+      h = (h ^ static_cast<uint8_t>(c)) * 0x100000001b3ull;
+    }
+  };
+  mix(peerName);
+  mix(kj::arrayPtr("\0", 1));
+  mix(id);
+  h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+  h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+  return h ^ (h >> 31);
+}
+
 // TODO(now): Temporary
 class ServerResolveObserver final: public jsg::ResolveObserver {};
 const ServerResolveObserver serverResolveObserver;
@@ -202,11 +253,26 @@ class Server::Service {
 
   // Returns true if the service exports the given handler, e.g. `fetch`, `scheduled`, etc.
   virtual bool hasHandler(kj::StringPtr handlerName) = 0;
+
+  // Begin a request to the Durable Object `id` of class `className`. Worker services host the
+  // object themselves, while external services forward the request to the peer behind them (see
+  // `DurableObjectNamespace.peers`). Returns null if the service has no such class.
+  virtual kj::Maybe<kj::Own<WorkerInterface>> startActorRequest(kj::StringPtr className,
+      kj::StringPtr id,
+      IoChannelFactory::SubrequestMetadata metadata) {
+    return kj::none;
+  }
 };
 
 // =======================================================================================
 
 kj::Own<kj::TlsContext> Server::makeTlsContext(config::TlsOptions::Reader conf) {
+  auto key = kj::str(conf);
+  KJ_IF_SOME(context, tlsContexts.find(key)) {
+    ServerMetrics::get().tlsContextsShared.add();
+    return kj::Own<kj::TlsContext>(context.get(), kj::NullDisposer::instance);
+  }
+
   kj::TlsContext::Options options;
 
   struct Attachments {
@@ -259,7 +325,11 @@ validVersion:
     options.cipherList = conf.getCipherList();
   }
 
-  return kj::heap<kj::TlsContext>(kj::mv(options));
+  auto context = kj::heap<kj::TlsContext>(kj::mv(options));
+  auto result = kj::Own<kj::TlsContext>(context.get(), kj::NullDisposer::instance);
+  tlsContexts.insert(kj::mv(key), kj::mv(context));
+  ServerMetrics::get().tlsContextsCreated.add();
+  return result;
 }
 
 kj::Promise<kj::Own<kj::NetworkAddress>> Server::makeTlsNetworkAddress(
@@ -578,15 +648,19 @@ class Server::ExternalHttpService final: public Service, private kj::TaskSet::Er
       kj::Timer& timer,
       kj::EntropySource& entropySource,
       capnp::ByteStreamFactory& byteStreamFactory,
-      capnp::HttpOverCapnpFactory& httpOverCapnpFactory)
+      capnp::HttpOverCapnpFactory& httpOverCapnpFactory,
+      kj::Duration idleTimeout)
       : addr(kj::mv(addrParam)),
         inner(kj::newHttpClient(timer,
             headerTable,
             *addr,
-            {.entropySource = entropySource,
+            {.idleTimeout = idleTimeout,
+              .entropySource = entropySource,
               .webSocketCompressionMode = kj::HttpClientSettings::MANUAL_COMPRESSION})),
         serviceAdapter(kj::newHttpService(*inner)),
         rewriter(kj::mv(rewriter)),
+        timer(timer),
+        idleTimeout(idleTimeout),
         headerTable(headerTable),
         byteStreamFactory(byteStreamFactory),
         httpOverCapnpFactory(httpOverCapnpFactory),
@@ -600,6 +674,27 @@ class Server::ExternalHttpService final: public Service, private kj::TaskSet::Er
     return handlerName == "fetch"_kj || handlerName == "connect"_kj;
   }
 
+  kj::Maybe<kj::Own<WorkerInterface>> startActorRequest(kj::StringPtr className,
+      kj::StringPtr id,
+      IoChannelFactory::SubrequestMetadata metadata) override {
+    // Every event for the object goes over the shared RPC connection, HTTP included, since the
+    // object can't be addressed by a plain HTTP request.
+    auto bootstrap = getOutgoingCapnp(*inner);
+    auto activeEvent = trackCapnpEvent();
+    auto req = bootstrap.startActorEventRequest(
+        capnp::MessageSize{6 + (className.size() + id.size()) / sizeof(capnp::word), 0});
+    req.setClassName(className);
+    req.setActorId(id);
+    auto dispatcher = req.send().getDispatcher();
+    return kj::Own<WorkerInterface>(
+        kj::heap<RpcWorkerInterface>(httpOverCapnpFactory, byteStreamFactory, kj::mv(dispatcher))
+            .attach(kj::mv(activeEvent)));
+  }
+
+  bool supportsRpc() {
+    return rewriter->getCapnpConnectHost() != kj::none;
+  }
+
  private:
   kj::Own<kj::NetworkAddress> addr;
 
@@ -608,6 +703,9 @@ class Server::ExternalHttpService final: public Service, private kj::TaskSet::Er
 
   kj::Own<HttpRewriter> rewriter;
 
+  kj::Timer& timer;
+  kj::Duration idleTimeout;
+
   kj::HttpHeaderTable& headerTable;
   capnp::ByteStreamFactory& byteStreamFactory;
   capnp::HttpOverCapnpFactory& httpOverCapnpFactory;
@@ -632,6 +730,27 @@ class Server::ExternalHttpService final: public Service, private kj::TaskSet::Er
   // This task nulls out `capnpClient` when the connection is lost.
   kj::Promise<void> clearCapnpClientTask = nullptr;
 
+  // Number of events currently being delivered over `capnpClient`.
+  uint capnpActiveEvents = 0;
+
+  // While `capnpActiveEvents` is zero, this task closes `capnpClient` once `idleTimeout` elapses.
+  kj::Promise<void> capnpIdleTask = nullptr;
+
+  // Marks the start of an event delivered over `capnpClient`. The returned object marks its end.
+  kj::Own<void> trackCapnpEvent() {
+    ++capnpActiveEvents;
+    capnpIdleTask = nullptr;
+    return kj::defer([this]() {
+      if (--capnpActiveEvents == 0 && capnpClient != kj::none) {
+        capnpIdleTask = timer.afterDelay(idleTimeout).then([this]() {
+          // Cancel the disconnect watcher first, since it refers into the RPC system.
+          clearCapnpClientTask = nullptr;
+          capnpClient = kj::none;
+        }).eagerlyEvaluate(nullptr);
+      }
+    });
+  }
+
   // Get an WorkerdBootstrap representing the service on the other end of an HTTP connection. May
   // reuse an existing connection, or form a new one over `client`.
   rpc::WorkerdBootstrap::Client getOutgoingCapnp(kj::HttpClient& client) {
@@ -647,11 +766,11 @@ class Server::ExternalHttpService final: public Service, private kj::TaskSet::Er
     auto& c = capnpClient.emplace(kj::mv(req.connection));
 
     // Arrange that when the connection is lost, we'll null out `capnpClient`. This ensures that
-    // on the next event, we'll attempt to reconnect.
-    //
-    // TODO(perf): Time out idle connections?
+    // on the next event, we'll attempt to reconnect. Idle connections are closed separately, see
+    // trackCapnpEvent().
     clearCapnpClientTask =
         c.rpcSystem.onDisconnect().attach(kj::defer([this]() {
+      capnpIdleTask = nullptr;
       capnpClient = kj::none;
     })).eagerlyEvaluate(nullptr);
 
@@ -703,11 +822,12 @@ class Server::ExternalHttpService final: public Service, private kj::TaskSet::Er
     kj::Promise<CustomEvent::Result> customEvent(kj::Own<CustomEvent> event) override {
       // We'll use capnp RPC for custom events.
       auto bootstrap = parent.getOutgoingCapnp(*parent.inner);
+      auto activeEvent = parent.trackCapnpEvent();
       auto dispatcher =
           bootstrap.startEventRequest(capnp::MessageSize{4, 0}).send().getDispatcher();
       return event
           ->sendRpc(parent.httpOverCapnpFactory, parent.byteStreamFactory, kj::mv(dispatcher))
-          .attach(kj::mv(event));
+          .attach(kj::mv(event), kj::mv(activeEvent));
     }
 
    private:
@@ -775,7 +895,8 @@ kj::Own<Server::Service> Server::makeExternalService(kj::StringPtr name,
       auto addr = kj::heap<PromisedNetworkAddress>(network.parseAddress(addrStr, 80));
       return kj::heap<ExternalHttpService>(kj::mv(addr), kj::mv(rewriter),
           headerTableBuilder.getFutureTable(), timer, entropySource,
-          globalContext->byteStreamFactory, globalContext->httpOverCapnpFactory);
+          globalContext->byteStreamFactory, globalContext->httpOverCapnpFactory,
+          conf.getIdleTimeoutMs() * kj::MILLISECONDS);
     }
     case config::ExternalServer::HTTPS: {
       auto httpsConf = conf.getHttps();
@@ -788,7 +909,8 @@ kj::Own<Server::Service> Server::makeExternalService(kj::StringPtr name,
           makeTlsNetworkAddress(httpsConf.getTlsOptions(), addrStr, certificateHost, 443));
       return kj::heap<ExternalHttpService>(kj::mv(addr), kj::mv(rewriter),
           headerTableBuilder.getFutureTable(), timer, entropySource,
-          globalContext->byteStreamFactory, globalContext->httpOverCapnpFactory);
+          globalContext->byteStreamFactory, globalContext->httpOverCapnpFactory,
+          conf.getIdleTimeoutMs() * kj::MILLISECONDS);
     }
     case config::ExternalServer::TCP: {
       auto tcpConf = conf.getTcp();
@@ -912,6 +1034,12 @@ class Server::DiskDirectoryService final: public Service, private WorkerInterfac
         readable(kj::mv(dir)),
         headerTable(headerTableBuilder.getFutureTable()),
         hLastModified(headerTableBuilder.add("Last-Modified")),
+        hETag(headerTableBuilder.add("ETag")),
+        hIfNoneMatch(headerTableBuilder.add("If-None-Match")),
+        hIfModifiedSince(headerTableBuilder.add("If-Modified-Since")),
+        hAcceptEncoding(headerTableBuilder.add("Accept-Encoding")),
+        hContentEncoding(headerTableBuilder.add("Content-Encoding")),
+        hVary(headerTableBuilder.add("Vary")),
         allowDotfiles(conf.getAllowDotfiles()) {}
   DiskDirectoryService(config::DiskDirectory::Reader conf,
       kj::Own<const kj::ReadableDirectory> dir,
@@ -919,6 +1047,12 @@ class Server::DiskDirectoryService final: public Service, private WorkerInterfac
       : readable(kj::mv(dir)),
         headerTable(headerTableBuilder.getFutureTable()),
         hLastModified(headerTableBuilder.add("Last-Modified")),
+        hETag(headerTableBuilder.add("ETag")),
+        hIfNoneMatch(headerTableBuilder.add("If-None-Match")),
+        hIfModifiedSince(headerTableBuilder.add("If-Modified-Since")),
+        hAcceptEncoding(headerTableBuilder.add("Accept-Encoding")),
+        hContentEncoding(headerTableBuilder.add("Content-Encoding")),
+        hVary(headerTableBuilder.add("Vary")),
         allowDotfiles(conf.getAllowDotfiles()) {}
 
   kj::Own<WorkerInterface> startRequest(IoChannelFactory::SubrequestMetadata metadata) override {
@@ -938,8 +1072,195 @@ class Server::DiskDirectoryService final: public Service, private WorkerInterfac
   kj::Own<const kj::ReadableDirectory> readable;
   kj::HttpHeaderTable& headerTable;
   kj::HttpHeaderId hLastModified;
+  kj::HttpHeaderId hETag;
+  kj::HttpHeaderId hIfNoneMatch;
+  kj::HttpHeaderId hIfModifiedSince;
+  kj::HttpHeaderId hAcceptEncoding;
+  kj::HttpHeaderId hContentEncoding;
+  kj::HttpHeaderId hVary;
   bool allowDotfiles;
 
+  // Recently opened files, so that repeated requests for hot assets skip the open() and stat().
+  // Entries are trusted for FILE_CACHE_TTL, so changes made to the directory other than through
+  // this service are seen within that time. Changes made through this service clear the cache.
+  struct CachedFile {
+    kj::Own<const kj::ReadableFile> file;
+    kj::FsNode::Metadata meta;
+    kj::TimePoint expires;
+  };
+  kj::HashMap<kj::String, CachedFile> fileCache;
+
+  static constexpr kj::Duration FILE_CACHE_TTL = 1 * kj::SECONDS;
+  static constexpr size_t FILE_CACHE_MAX_ENTRIES = 256;
+
+  struct OpenedFile {
+    kj::Own<const kj::ReadableFile> file;
+    kj::FsNode::Metadata meta;
+  };
+
+  // Opens the file at `path` and stats it, using the cache if possible. Directories and other
+  // non-files are not cached. The returned handle stays valid even if the entry gets evicted.
+  kj::Maybe<OpenedFile> openFile(const kj::Path& path) {
+    auto now = kj::systemCoarseMonotonicClock().now();
+    auto key = path.toString();
+    KJ_IF_SOME(cached, fileCache.find(key)) {
+      if (now < cached.expires) {
+        return OpenedFile{.file = cached.file->clone(), .meta = cached.meta};
+      }
+      fileCache.erase(key);
+    }
+
+    auto file = KJ_UNWRAP_OR_RETURN(readable->tryOpenFile(path), kj::none);
+    auto meta = file->stat();
+    if (meta.type == kj::FsNode::Type::FILE) {
+      if (fileCache.size() >= FILE_CACHE_MAX_ENTRIES) {
+        fileCache.eraseAll([&](auto&, CachedFile& entry) { return entry.expires <= now; });
+        if (fileCache.size() >= FILE_CACHE_MAX_ENTRIES) {
+          fileCache.clear();
+        }
+      }
+      fileCache.insert(kj::mv(key),
+          {.file = file->clone(), .meta = meta, .expires = now + FILE_CACHE_TTL});
+    }
+    return OpenedFile{.file = kj::mv(file), .meta = meta};
+  }
+
+  // A weak validator made from the file's modification time and size, as most file servers use.
+  // Precompressed variants also carry their encoding, so they never share a validator with the
+  // uncompressed file.
+  static kj::String makeETag(const kj::FsNode::Metadata& meta, kj::StringPtr encoding = ""_kj) {
+    auto mtime = (meta.lastModified - kj::UNIX_EPOCH) / kj::NANOSECONDS;
+    return kj::str("W/\"", kj::hex(static_cast<uint64_t>(mtime)), '-', kj::hex(meta.size),
+        encoding.size() > 0 ? "-"_kj : ""_kj, encoding, '"');
+  }
+
+  struct Precompressed {
+    kj::StringPtr encoding;
+    kj::StringPtr suffix;
+  };
+
+  // Sibling files we look for next to a requested file, in order of preference on ties.
+  static constexpr Precompressed PRECOMPRESSED[] = {
+    {.encoding = "br"_kj, .suffix = ".br"_kj},
+    {.encoding = "gzip"_kj, .suffix = ".gz"_kj},
+  };
+
+  static bool equalsIgnoreCase(kj::ArrayPtr<const char> a, kj::StringPtr b) {
+    if (a.size() != b.size()) return false;
+    for (auto i: kj::indices(a)) {
+      char ca = a[i], cb = b[i];
+      if ('A' <= ca && ca <= 'Z') ca += 'a' - 'A';
+      if ('A' <= cb && cb <= 'Z') cb += 'a' - 'A';
+      if (ca != cb) return false;
+    }
+    return true;
+  }
+
+  // Returns the quality an Accept-Encoding header gives `encoding`, falling back to that of "*",
+  // or 0 if the encoding isn't acceptable.
+  static double encodingQuality(kj::StringPtr acceptEncoding, kj::StringPtr encoding) {
+    kj::Maybe<double> exact;
+    kj::Maybe<double> wildcard;
+    kj::ArrayPtr<const char> rest = acceptEncoding;
+    while (rest.size() > 0) {
+      kj::ArrayPtr<const char> item = rest;
+      KJ_IF_SOME(comma, rest.findFirst(',')) {
+        item = rest.first(comma);
+        rest = rest.slice(comma + 1);
+      } else {
+        rest = nullptr;
+      }
+
+      kj::ArrayPtr<const char> coding = item;
+      double q = 1;
+      KJ_IF_SOME(semicolon, item.findFirst(';')) {
+        coding = item.first(semicolon);
+        auto param = trimOws(item.slice(semicolon + 1));
+        if (param.size() > 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+          q = kj::str(trimOws(param.slice(2))).tryParseAs<double>().orDefault(0);
+        }
+      }
+      coding = trimOws(coding);
+      if (equalsIgnoreCase(coding, encoding)) {
+        exact = q;
+      } else if (coding == "*"_kjc) {
+        wildcard = q;
+      }
+    }
+    return exact.orDefault(wildcard.orDefault(0));
+  }
+
+  struct Variant {
+    OpenedFile opened;
+    kj::StringPtr encoding;
+  };
+
+  // Finds the precompressed sibling of `path` (e.g. "style.css.br") that the client ranks
+  // highest, if any exists.
+  kj::Maybe<Variant> findPrecompressed(const kj::Path& path, kj::StringPtr acceptEncoding) {
+    kj::Maybe<Variant> best;
+    double bestQuality = 0;
+    for (auto& candidate: PRECOMPRESSED) {
+      auto quality = encodingQuality(acceptEncoding, candidate.encoding);
+      if (quality <= bestQuality) continue;
+
+      auto siblingPath = path.parent().append(kj::str(path.basename()[0], candidate.suffix));
+      KJ_IF_SOME(opened, openFile(siblingPath)) {
+        if (opened.meta.type == kj::FsNode::Type::FILE) {
+          best = Variant{.opened = kj::mv(opened), .encoding = candidate.encoding};
+          bestQuality = quality;
+        }
+      }
+    }
+    return best;
+  }
+
+  // Whether an If-None-Match header value matches `etag` under the weak comparison that RFC 9110
+  // section 13.1.2 prescribes for it.
+  static bool ifNoneMatchMatches(kj::StringPtr header, kj::StringPtr etag) {
+    auto opaque = [](kj::ArrayPtr<const char> tag) {
+      return tag.startsWith("W/"_kjc) ? tag.slice(2) : tag;
+    };
+    auto target = opaque(etag);
+    kj::ArrayPtr<const char> rest = header;
+    while (rest.size() > 0) {
+      kj::ArrayPtr<const char> tag = rest;
+      KJ_IF_SOME(comma, rest.findFirst(',')) {
+        tag = rest.first(comma);
+        rest = rest.slice(comma + 1);
+      } else {
+        rest = nullptr;
+      }
+      tag = trimOws(tag);
+      if (tag == "*"_kjc || opaque(tag) == target) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static kj::ArrayPtr<const char> trimOws(kj::ArrayPtr<const char> text) {
+    while (text.size() > 0 && (text.front() == ' ' || text.front() == '\t')) text = text.slice(1);
+    while (text.size() > 0 && (text.back() == ' ' || text.back() == '\t')) {
+      text = text.first(text.size() - 1);
+    }
+    return text;
+  }
+
+  // Implements the If-None-Match and If-Modified-Since preconditions of a GET or HEAD. Like many
+  // servers, If-Modified-Since only matches a date equal to our Last-Modified, which is what
+  // caches send back.
+  bool isNotModified(
+      const kj::HttpHeaders& requestHeaders, kj::StringPtr etag, kj::StringPtr lastModified) {
+    KJ_IF_SOME(header, requestHeaders.get(hIfNoneMatch)) {
+      return ifNoneMatchMatches(header, etag);
+    }
+    KJ_IF_SOME(header, requestHeaders.get(hIfModifiedSince)) {
+      return trimOws(header) == lastModified.asArray();
+    }
+    return false;
+  }
+
   kj::Promise<void> request(kj::HttpMethod method,
       kj::StringPtr urlStr,
       const kj::HttpHeaders& requestHeaders,
@@ -971,13 +1292,42 @@ class Server::DiskDirectoryService final: public Service, private WorkerInterfac
         co_return co_await response.sendError(404, "Not Found", headerTable);
       }
 
-      auto file = KJ_UNWRAP_OR(readable->tryOpenFile(path),
+      auto opened = KJ_UNWRAP_OR(openFile(path),
           { co_return co_await response.sendError(404, "Not Found", headerTable); });
-
-      auto meta = file->stat();
+      auto file = kj::mv(opened.file);
+      auto meta = opened.meta;
 
       switch (meta.type) {
         case kj::FsNode::Type::FILE: {
+          // If the client accepts a precompressed sibling that exists, serve that instead. The
+          // rest of this branch then describes the compressed file, including any Range.
+          kj::Maybe<kj::StringPtr> contentEncoding;
+          KJ_IF_SOME(acceptEncoding, requestHeaders.get(hAcceptEncoding)) {
+            KJ_IF_SOME(variant, findPrecompressed(path, acceptEncoding)) {
+              file = kj::mv(variant.opened.file);
+              meta = variant.opened.meta;
+              contentEncoding = variant.encoding;
+            }
+          }
+
+          auto etag = makeETag(meta, contentEncoding.orDefault(""_kj));
+          auto lastModified = httpTime(meta.lastModified);
+          auto setRepresentationHeaders = [&](kj::HttpHeaders& headers) {
+            headers.set(hLastModified, kj::mv(lastModified));
+            headers.set(hETag, kj::mv(etag));
+            KJ_IF_SOME(encoding, contentEncoding) {
+              headers.set(hContentEncoding, encoding);
+              headers.set(hVary, "Accept-Encoding");
+            }
+          };
+
+          if (isNotModified(requestHeaders, etag, lastModified)) {
+            kj::HttpHeaders headers(headerTable);
+            setRepresentationHeaders(headers);
+            response.send(304, "Not Modified", headers);
+            co_return;
+          }
+
           // If this is a GET request with a Range header, return partial content if a single
           // satisfiable range is specified.
           // TODO(someday): consider supporting multiple ranges with multipart/byteranges
@@ -1001,7 +1351,7 @@ class Server::DiskDirectoryService final: public Service, private WorkerInterfac
 
           kj::HttpHeaders headers(headerTable);
           headers.set(kj::HttpHeaderId::CONTENT_TYPE, MimeType::OCTET_STREAM.toString());
-          headers.set(hLastModified, httpTime(meta.lastModified));
+          setRepresentationHeaders(headers);
 
           // We explicitly set the Content-Length header because if we don't, and we were called
           // by a local Worker (without an actual HTTP connection in between), then the Worker
@@ -1105,6 +1455,7 @@ class Server::DiskDirectoryService final: public Service, private WorkerInterfac
         co_return co_await response.sendError(403, "Unauthorized", headerTable);
       }
 
+      fileCache.clear();
       auto replacer = w.replaceFile(
           path, kj::WriteMode::CREATE | kj::WriteMode::MODIFY | kj::WriteMode::CREATE_PARENT);
       auto stream = kj::heap<kj::FileOutputStream>(replacer->get());
@@ -1123,6 +1474,7 @@ class Server::DiskDirectoryService final: public Service, private WorkerInterfac
         co_return co_await response.sendError(403, "Unauthorized", headerTable);
       }
 
+      fileCache.clear();
       auto found = w.tryRemove(path);
 
       kj::HttpHeaders headers(headerTable);
@@ -1202,72 +1554,161 @@ kj::Own<Server::Service> Server::makeDiskDirectoryService(kj::StringPtr name,
 
 // =======================================================================================
 
-// This class exists to update the InspectorService's table of isolates when a config
-// has multiple services. The InspectorService exists on the stack of it's own thread and
-// initializes state that is bound to the thread, e.g. a http server and an event loop.
-// This class provides a small thread-safe interface to the InspectorService so <name>:<isolate>
-// mappings can be added after the InspectorService has started.
-//
-// The Cloudflare devtools only show the first service in workerd configuration. This service
-// is always contains a users code. However, in packaging user code wrangler may add
-// additional services that also have code. If using Chrome devtools to inspect a workerd,
-// instance all services are visible and can be debugged.
-class Server::InspectorServiceIsolateRegistrar final {
+// Serves ServerMetrics in the OpenMetrics text format.
+class Server::MetricsService final: public Service, private WorkerInterface {
  public:
-  InspectorServiceIsolateRegistrar() {}
-  ~InspectorServiceIsolateRegistrar() noexcept(true);
+  MetricsService(ServerMetrics& metrics, kj::HttpHeaderTable::Builder& headerTableBuilder)
+      : metrics(metrics),
+        headerTable(headerTableBuilder.getFutureTable()) {}
 
-  void registerIsolate(kj::StringPtr name, Worker::Isolate* isolate);
+  kj::Own<WorkerInterface> startRequest(IoChannelFactory::SubrequestMetadata metadata) override {
+    return {this, kj::NullDisposer::instance};
+  }
 
-  KJ_DISALLOW_COPY_AND_MOVE(InspectorServiceIsolateRegistrar);
+  bool hasHandler(kj::StringPtr handlerName) override {
+    return handlerName == "fetch"_kj;
+  }
 
  private:
-  void attach(const Server::InspectorService* anInspectorService) {
-    *inspectorService.lockExclusive() = anInspectorService;
+  ServerMetrics& metrics;
+  kj::HttpHeaderTable& headerTable;
+
+  kj::Promise<void> request(kj::HttpMethod method,
+      kj::StringPtr urlStr,
+      const kj::HttpHeaders& requestHeaders,
+      kj::AsyncInputStream& requestBody,
+      kj::HttpService::Response& response) override {
+    TRACE_EVENT("workerd", "MetricsService::request()");
+    if (method != kj::HttpMethod::GET && method != kj::HttpMethod::HEAD) {
+      co_return co_await response.sendError(405, "Method Not Allowed", headerTable);
+    }
+
+    auto text = metrics.render();
+    kj::HttpHeaders headers(headerTable);
+    headers.set(kj::HttpHeaderId::CONTENT_TYPE,
+        "application/openmetrics-text; version=1.0.0; charset=utf-8");
+    auto out = response.send(200, "OK", headers, text.size());
+    if (method == kj::HttpMethod::GET) {
+      co_await out->write(text.asBytes());
+    }
   }
 
-  void detach() {
-    *inspectorService.lockExclusive() = nullptr;
+  kj::Promise<void> connect(kj::StringPtr host,
+      const kj::HttpHeaders& headers,
+      kj::AsyncIoStream& connection,
+      kj::HttpService::ConnectResponse& response,
+      kj::HttpConnectSettings settings) override {
+    throwUnsupported();
+  }
+  kj::Promise<void> prewarm(kj::StringPtr url) override {
+    return kj::READY_NOW;
+  }
+  kj::Promise<ScheduledResult> runScheduled(kj::Date scheduledTime, kj::StringPtr cron) override {
+    throwUnsupported();
+  }
+  kj::Promise<AlarmResult> runAlarm(kj::Date scheduledTime, uint32_t retryCount) override {
+    throwUnsupported();
+  }
+  kj::Promise<CustomEvent::Result> customEvent(kj::Own<CustomEvent> event) override {
+    return event->notSupported();
   }
 
-  kj::MutexGuarded<const InspectorService*> inspectorService;
-  friend class Server::InspectorService;
+  [[noreturn]] void throwUnsupported() {
+    JSG_FAIL_REQUIRE(Error, "Metrics services don't support this event type.");
+  }
 };
 
-// Implements the interface for the devtools inspector protocol.
+kj::Own<Server::Service> Server::makeMetricsService(
+    kj::HttpHeaderTable::Builder& headerTableBuilder) {
+  return kj::heap<MetricsService>(KJ_ASSERT_NONNULL(metrics), headerTableBuilder);
+}
+
+// =======================================================================================
+
+// A queue held in memory. Producers send to it through a Queue binding, which speaks the same
+// HTTP protocol as the production queue broker (see WorkerQueue::send() and sendBatch()), and
+// it delivers batches to the consumer's queue() handler.
 //
-// The InspectorService is created when workerd serve is called using the -i option
-// to define the inspector socket.
-class Server::InspectorService final: public kj::HttpService, public kj::HttpServerErrorHandler {
+// Messages accumulate until a batch is full or its oldest message has waited `maxWaitMs`. Up to
+// `maxConcurrency` batches are delivered at once. While all of those are busy, up to `prefetch`
+// more batches are cut ahead of time, so that the next one is delivered the moment a delivery
+// finishes. Each batch is settled in one pass when its delivery finishes: messages that were
+// retried, or all messages not explicitly acked if the handler failed or retried the whole
+// batch, go back on the queue, and all the others are acknowledged.
+class Server::LocalQueueService final: public Service,
+                                       private WorkerInterface,
+                                       private kj::TaskSet::ErrorHandler {
  public:
-  InspectorService(kj::Own<const kj::Executor> isolateThreadExecutor,
-      kj::Timer& timer,
-      kj::HttpHeaderTable::Builder& headerTableBuilder,
-      InspectorServiceIsolateRegistrar& registrar)
-      : isolateThreadExecutor(kj::mv(isolateThreadExecutor)),
-        timer(timer),
+  LocalQueueService(Server& server,
+      kj::StringPtr name,
+      config::LocalQueue::Reader conf,
+      kj::HttpHeaderTable::Builder& headerTableBuilder)
+      : server(server),
+        name(name),
+        conf(conf),
+        queueName(conf.hasQueueName() ? conf.getQueueName() : name),
+        maxBatchSize(kj::max(conf.getMaxBatchSize(), 1u)),
+        maxWait(conf.getMaxWaitMs() * kj::MILLISECONDS),
+        maxConcurrency(kj::max(conf.getMaxConcurrency(), 1u)),
+        prefetch(conf.getPrefetch()),
+        maxRetries(conf.getMaxRetries()),
         headerTable(headerTableBuilder.getFutureTable()),
-        server(timer, headerTable, *this, kj::HttpServerSettings{.errorHandler = *this}),
-        registrar(registrar) {
-    registrar.attach(this);
+        msgFormatHeader(headerTableBuilder.add("X-Msg-Fmt")),
+        msgDelayHeader(headerTableBuilder.add("X-Msg-Delay-Secs")),
+        tasks(*this) {}
+
+  void link() override {
+    consumer = server.lookupService(conf.getConsumer(), kj::str("Queue \"", name, "\"'s consumer"));
   }
 
-  ~InspectorService() {
-    KJ_IF_SOME(r, registrar) {
-      r.detach();
-    }
+  kj::Own<WorkerInterface> startRequest(IoChannelFactory::SubrequestMetadata metadata) override {
+    return {this, kj::NullDisposer::instance};
   }
 
-  void invalidateRegistrar() {
-    registrar = kj::none;
+  bool hasHandler(kj::StringPtr handlerName) override {
+    return handlerName == "fetch"_kj;
   }
 
-  kj::Promise<void> handleApplicationError(
-      kj::Exception exception, kj::Maybe<kj::HttpService::Response&> response) override {
-    KJ_LOG(ERROR, kj::str("Uncaught exception: ", exception));
-    KJ_IF_SOME(r, response) {
-      co_return co_await r.sendError(500, "Internal Server Error", headerTable);
-    }
+ private:
+  struct Message {
+    kj::String id;
+    kj::Date timestamp;
+    kj::Array<kj::byte> body;
+    kj::Maybe<kj::String> contentType;
+    uint16_t attempts;
+    // When the message became ready for delivery, for `maxWaitMs`.
+    kj::TimePoint readyAt;
+  };
+
+  Server& server;
+  kj::StringPtr name;
+  config::LocalQueue::Reader conf;
+  kj::StringPtr queueName;
+  uint maxBatchSize;
+  kj::Duration maxWait;
+  uint maxConcurrency;
+  uint prefetch;
+  uint maxRetries;
+  kj::HttpHeaderTable& headerTable;
+  kj::HttpHeaderId msgFormatHeader;
+  kj::HttpHeaderId msgDelayHeader;
+  kj::Maybe<Service&> consumer;
+
+  // Messages ready for delivery, oldest first.
+  std::deque<Message> ready;
+  // Batches cut ahead of time, waiting for a delivery to finish.
+  std::deque<kj::Array<Message>> prefetched;
+  uint deliveriesInFlight = 0;
+
+  // Wakes pump() when the oldest ready message will have waited `maxWaitMs`.
+  kj::Maybe<kj::TimePoint> wakeAt;
+  kj::Promise<void> wakeTask = nullptr;
+
+  // Deliveries and delayed messages.
+  kj::TaskSet tasks;
+
+  void taskFailed(kj::Exception&& exception) override {
+    KJ_LOG(ERROR, "local queue task failed", queueName, exception);
   }
 
   kj::Promise<void> request(kj::HttpMethod method,
@@ -1275,68 +1716,467 @@ class Server::InspectorService final: public kj::HttpService, public kj::HttpSer
       const kj::HttpHeaders& headers,
       kj::AsyncInputStream& requestBody,
       kj::HttpService::Response& response) override {
-    // The inspector protocol starts with the debug client sending ordinary HTTP GET requests
-    // to /json/version and then to /json or /json/list. These must respond with valid JSON
-    // documents that list the details of what isolates are available for inspection. Each
-    // isolate must be listed separately. In the advertisement for each isolate is a URL
-    // and a unique ID. The client will use the URL and ID to open a WebSocket request to
-    // actually connect the debug session.
-    kj::HttpHeaders responseHeaders(headerTable);
-    if (headers.isWebSocket()) {
-      KJ_IF_SOME(pos, url.findLast('/')) {
-        auto id = url.slice(pos + 1);
+    TRACE_EVENT("workerd", "LocalQueueService::request()");
+    if (method != kj::HttpMethod::POST) {
+      co_return co_await response.sendError(405, "Method Not Allowed", headerTable);
+    }
 
-        KJ_IF_SOME(isolate, isolates.find(id)) {
-          // If getting the strong ref doesn't work it means that the Worker::Isolate
-          // has already been cleaned up. We use a weak ref here in order to keep from
-          // having the Worker::Isolate itself having to know anything at all about the
-          // IsolateService and the registration process. So instead of having Isolate
-          // explicitly clean up after itself we lazily evaluate the weak ref and clean
-          // up when necessary.
-          KJ_IF_SOME(ref, isolate->tryAddStrongRef()) {
-            // When using --verbose, we'll output some logging to indicate when the
-            // inspector client is attached/detached.
-            KJ_LOG(INFO, kj::str("Inspector client attaching [", id, "]"));
-            auto webSocket = response.acceptWebSocket(responseHeaders);
-            kj::Duration timerOffset = 0 * kj::MILLISECONDS;
-            try {
-              co_return co_await ref->attachInspector(
-                  isolateThreadExecutor->addRef(), timer, timerOffset, *webSocket);
-            } catch (...) {
-              auto exception = kj::getCaughtExceptionAsKj();
-              if (exception.getType() == kj::Exception::Type::DISCONNECTED) {
-                // This likely just means that the inspector client was closed.
-                // Nothing to do here but move along.
-                KJ_LOG(INFO, "Inspector client detached"_kj);
-                co_return;
-              } else {
-                // If it's any other kind of error, propagate it!
-                kj::throwFatalException(kj::mv(exception));
-              }
-            }
-          } else {
-            // If we can't get a strong ref to the isolate here, it's been cleaned
-            // up. The only thing we're going to do is clean up here and act like
-            // nothing happened.
-            isolates.erase(id);
-          }
-        }
+    kj::Maybe<int> delaySeconds;
+    KJ_IF_SOME(delay, headers.get(msgDelayHeader)) {
+      delaySeconds = delay.tryParseAs<int>();
+    }
 
-        KJ_LOG(INFO, kj::str("Unknown worker session [", id, "]"));
-        co_return co_await response.sendError(404, "Unknown worker session", responseHeaders);
+    auto body = co_await requestBody.readAllBytes();
+    if (url.endsWith("/message")) {
+      auto contentType =
+          headers.get(msgFormatHeader).map([](kj::StringPtr t) { return kj::str(t); });
+      send(kj::mv(body), kj::mv(contentType), delaySeconds);
+    } else if (url.endsWith("/batch")) {
+      if (!sendBatch(body.asChars(), delaySeconds)) {
+        co_return co_await response.sendError(400, "Bad Request", headerTable);
       }
-
-      // No / in url!? That's weird
-      co_return co_await response.sendError(400, "Invalid request", responseHeaders);
+    } else {
+      co_return co_await response.sendError(404, "Not Found", headerTable);
     }
 
-    // If the request is not a WebSocket request, it must be a GET to fetch details
-    // about the implementation.
-    if (method != kj::HttpMethod::GET) {
-      co_return co_await response.sendError(501, "Unsupported Operation", responseHeaders);
+    kj::HttpHeaders responseHeaders(headerTable);
+    response.send(200, "OK", responseHeaders, uint64_t(0));
+  }
+
+  // Parses the `{"messages": [{"body": <base64>, "contentType": ..., "delaySecs": ...}]}` body of
+  // a batch send. Returns false if it's malformed, in which case nothing is enqueued.
+  bool sendBatch(kj::ArrayPtr<const char> text, kj::Maybe<int> batchDelaySeconds) {
+    capnp::MallocMessageBuilder message;
+    auto root = message.initRoot<capnp::JsonValue>();
+    KJ_IF_SOME(exception, kj::runCatchingExceptions([&]() {
+      capnp::JsonCodec json;
+      json.decodeRaw(text, root);
+    })) {
+      KJ_LOG(WARNING, "malformed queue batch", queueName, exception.getDescription());
+      return false;
     }
 
-    if (url.endsWith("/json/version")) {
+    struct Parsed {
+      kj::Array<kj::byte> body;
+      kj::Maybe<kj::String> contentType;
+      kj::Maybe<int> delaySeconds;
+    };
+    kj::Vector<Parsed> parsed;
+    if (!root.isObject()) return false;
+    for (auto field: root.getObject()) {
+      if (field.getName() != "messages" || !field.getValue().isArray()) continue;
+      for (auto item: field.getValue().getArray()) {
+        if (!item.isObject()) return false;
+        Parsed msg{.delaySeconds = batchDelaySeconds};
+        bool hasBody = false;
+        for (auto prop: item.getObject()) {
+          auto value = prop.getValue();
+          if (prop.getName() == "body" && value.isString()) {
+            msg.body = kj::decodeBase64(value.getString().asArray());
+            hasBody = true;
+          } else if (prop.getName() == "contentType" && value.isString()) {
+            msg.contentType = kj::str(value.getString());
+          } else if (prop.getName() == "delaySecs" && value.isNumber()) {
+            msg.delaySeconds = static_cast<int>(value.getNumber());
+          }
+        }
+        if (!hasBody) return false;
+        parsed.add(kj::mv(msg));
+      }
+    }
+
+    for (auto& msg: parsed) {
+      send(kj::mv(msg.body), kj::mv(msg.contentType), msg.delaySeconds);
+    }
+    return true;
+  }
+
+  void send(kj::Array<kj::byte> body, kj::Maybe<kj::String> contentType, kj::Maybe<int> delay) {
+    enqueue(
+        Message{
+          .id = randomUUID(server.entropySource),
+          .timestamp = kj::systemPreciseCalendarClock().now(),
+          .body = kj::mv(body),
+          .contentType = kj::mv(contentType),
+          .attempts = 1,
+          .readyAt = server.timer.now(),
+        },
+        delay);
+  }
+
+  void enqueue(Message message, kj::Maybe<int> delaySeconds) {
+    KJ_IF_SOME(delay, delaySeconds) {
+      if (delay > 0) {
+        tasks.add(server.timer.afterDelay(delay * kj::SECONDS)
+                      .then([this, message = kj::mv(message)]() mutable {
+          enqueue(kj::mv(message), kj::none);
+        }));
+        return;
+      }
+    }
+    message.readyAt = server.timer.now();
+    ready.push_back(kj::mv(message));
+    pump();
+  }
+
+  // Cuts batches and starts deliveries as far as the limits allow.
+  void pump() {
+    auto now = server.timer.now();
+    for (;;) {
+      if (deliveriesInFlight < maxConcurrency && !prefetched.empty()) {
+        auto batch = kj::mv(prefetched.front());
+        prefetched.pop_front();
+        ++deliveriesInFlight;
+        tasks.add(deliver(kj::mv(batch)));
+        continue;
+      }
+      if (ready.empty()) break;
+      if (deliveriesInFlight >= maxConcurrency && prefetched.size() >= prefetch) break;
+
+      auto deadline = ready.front().readyAt + maxWait;
+      if (ready.size() < maxBatchSize && now < deadline) {
+        scheduleWake(deadline);
+        break;
+      }
+
+      auto size = kj::min(ready.size(), size_t(maxBatchSize));
+      auto batch = kj::heapArrayBuilder<Message>(size);
+      for (auto i KJ_UNUSED: kj::zeroTo(size)) {
+        batch.add(kj::mv(ready.front()));
+        ready.pop_front();
+      }
+      prefetched.push_back(batch.finish());
+    }
+  }
+
+  void scheduleWake(kj::TimePoint deadline) {
+    KJ_IF_SOME(w, wakeAt) {
+      if (w <= deadline) return;
+    }
+    wakeAt = deadline;
+    wakeTask = server.timer.atTime(deadline)
+                   .then([this]() {
+      wakeAt = kj::none;
+      pump();
+    }).eagerlyEvaluate([this](kj::Exception&& e) { taskFailed(kj::mv(e)); });
+  }
+
+  kj::Promise<void> deliver(kj::Array<Message> batch) {
+    auto messages = KJ_MAP(m, batch) {
+      return api::IncomingQueueMessage{
+        .id = kj::str(m.id),
+        .timestamp = m.timestamp,
+        .body = kj::heapArray(m.body.asPtr()),
+        .contentType = m.contentType.map([](const kj::String& t) { return kj::str(t); }),
+        .attempts = m.attempts,
+      };
+    };
+    auto event = kj::refcounted<api::QueueCustomEventImpl>(api::QueueEvent::Params{
+      .queueName = kj::str(queueName),
+      .messages = kj::mv(messages),
+    });
+
+    auto worker = KJ_ASSERT_NONNULL(consumer).startRequest({});
+    bool succeeded = co_await worker->customEvent(kj::addRef(*event))
+                         .then([](WorkerInterface::CustomEvent::Result result) {
+      return result.outcome == EventOutcome::OK;
+    }, [this](kj::Exception&& e) {
+      KJ_LOG(WARNING, "queue consumer failed", queueName, e);
+      return false;
+    });
+
+    settle(kj::mv(batch), *event, succeeded);
+    --deliveriesInFlight;
+    pump();
+  }
+
+  void settle(kj::Array<Message> batch, api::QueueCustomEventImpl& event, bool succeeded) {
+    auto acks = event.getExplicitAcks();
+    kj::HashSet<kj::StringPtr> acked;
+    for (auto& id: acks) acked.upsert(id, [](auto&&...) {});
+    auto retryMessages = event.getRetryMessages();
+    kj::HashMap<kj::StringPtr, kj::Maybe<int>> retried;
+    for (auto& r: retryMessages) {
+      retried.upsert(r.msgId, r.delaySeconds, [](auto&&...) {});
+    }
+    auto retryBatch = event.getRetryBatch();
+    bool retryRest = !event.getAckAll() && (!succeeded || retryBatch.retry);
+
+    for (auto& message: batch) {
+      kj::Maybe<int> delay;
+      KJ_IF_SOME(d, retried.find(message.id)) {
+        delay = d;
+      } else if (acked.contains(message.id) || !retryRest) {
+        continue;
+      } else {
+        delay = retryBatch.delaySeconds;
+      }
+
+      if (message.attempts > maxRetries) {
+        KJ_LOG(WARNING, "dropping queue message after its last retry", queueName, message.id);
+        continue;
+      }
+      ++message.attempts;
+      enqueue(kj::mv(message), delay);
+    }
+  }
+
+  kj::Promise<void> connect(kj::StringPtr host,
+      const kj::HttpHeaders& headers,
+      kj::AsyncIoStream& connection,
+      kj::HttpService::ConnectResponse& response,
+      kj::HttpConnectSettings settings) override {
+    throwUnsupported();
+  }
+  kj::Promise<void> prewarm(kj::StringPtr url) override {
+    return kj::READY_NOW;
+  }
+  kj::Promise<ScheduledResult> runScheduled(kj::Date scheduledTime, kj::StringPtr cron) override {
+    throwUnsupported();
+  }
+  kj::Promise<AlarmResult> runAlarm(kj::Date scheduledTime, uint32_t retryCount) override {
+    throwUnsupported();
+  }
+  kj::Promise<CustomEvent::Result> customEvent(kj::Own<CustomEvent> event) override {
+    return event->notSupported();
+  }
+
+  [[noreturn]] void throwUnsupported() {
+    JSG_FAIL_REQUIRE(Error, "Queue services don't support this event type.");
+  }
+};
+
+kj::Own<Server::Service> Server::makeLocalQueueService(kj::StringPtr name,
+    config::LocalQueue::Reader conf,
+    kj::HttpHeaderTable::Builder& headerTableBuilder) {
+  if (!experimental) {
+    reportConfigError(kj::str("Local queue services are an experimental feature which may "
+                              "change or go away in the future. You must run workerd with "
+                              "`--experimental` to use this feature."));
+  }
+  return kj::heap<LocalQueueService>(*this, name, conf, headerTableBuilder);
+}
+
+// Service used when the service is configured as a Hyperdrive pool. Each connect() call is one
+// Postgres client of the pool.
+class Server::HyperdriveService final: public Service, private WorkerInterface {
+ public:
+  HyperdriveService(kj::Own<kj::NetworkAddress> addrParam,
+      kj::Timer& timer,
+      kj::EntropySource& entropySource,
+      PgPool::Options options)
+      : addr(kj::mv(addrParam)),
+        pool(timer, entropySource, [this]() { return addr->connect(); }, kj::mv(options)) {}
+
+  kj::Own<WorkerInterface> startRequest(IoChannelFactory::SubrequestMetadata metadata) override {
+    return {this, kj::NullDisposer::instance};
+  }
+
+  bool hasHandler(kj::StringPtr handlerName) override {
+    return handlerName == "connect"_kj;
+  }
+
+ private:
+  kj::Own<kj::NetworkAddress> addr;
+  PgPool pool;
+
+  kj::Promise<void> request(kj::HttpMethod method,
+      kj::StringPtr url,
+      const kj::HttpHeaders& headers,
+      kj::AsyncInputStream& requestBody,
+      kj::HttpService::Response& response) override {
+    throwUnsupported();
+  }
+
+  kj::Promise<void> connect(kj::StringPtr host,
+      const kj::HttpHeaders& headers,
+      kj::AsyncIoStream& connection,
+      ConnectResponse& tunnel,
+      kj::HttpConnectSettings settings) override {
+    TRACE_EVENT("workerd", "HyperdriveService::connect()", "host", host.cStr());
+    tunnel.accept(200, "OK", kj::HttpHeaders(kj::HttpHeaderTable{}));
+    co_await pool.serve(connection);
+  }
+
+  kj::Promise<void> prewarm(kj::StringPtr url) override {
+    return kj::READY_NOW;
+  }
+  kj::Promise<ScheduledResult> runScheduled(kj::Date scheduledTime, kj::StringPtr cron) override {
+    throwUnsupported();
+  }
+  kj::Promise<AlarmResult> runAlarm(kj::Date scheduledTime, uint32_t retryCount) override {
+    throwUnsupported();
+  }
+  kj::Promise<CustomEvent::Result> customEvent(kj::Own<CustomEvent> event) override {
+    return event->notSupported();
+  }
+
+  [[noreturn]] void throwUnsupported() {
+    JSG_FAIL_REQUIRE(Error, "Hyperdrive services only support connect().");
+  }
+};
+
+kj::Own<Server::Service> Server::makeHyperdriveService(
+    kj::StringPtr name, config::HyperdrivePool::Reader conf) {
+  if (!experimental) {
+    reportConfigError(kj::str("Hyperdrive services are an experimental feature which may "
+                              "change or go away in the future. You must run workerd with "
+                              "`--experimental` to use this feature."));
+  }
+  if (!conf.hasAddress()) {
+    reportConfigError(kj::str("Hyperdrive service \"", name, "\" has no address."));
+    return makeInvalidConfigService();
+  }
+
+  auto addr = kj::heap<PromisedNetworkAddress>(network.parseAddress(conf.getAddress(), 5432));
+  return kj::heap<HyperdriveService>(kj::mv(addr), timer, entropySource,
+      PgPool::Options{
+        .database = kj::str(conf.getDatabase()),
+        .user = kj::str(conf.getUser()),
+        .password = kj::str(conf.getPassword()),
+        .maxConnections = conf.getMaxConnections(),
+        .idleTimeout = conf.getIdleTimeoutMs() * kj::MILLISECONDS,
+        .maxPreparedStatements = conf.getMaxPreparedStatements(),
+      });
+}
+
+// =======================================================================================
+
+// This class exists to update the InspectorService's table of isolates when a config
+// has multiple services. The InspectorService exists on the stack of it's own thread and
+// initializes state that is bound to the thread, e.g. a http server and an event loop.
+// This class provides a small thread-safe interface to the InspectorService so <name>:<isolate>
+// mappings can be added after the InspectorService has started.
+//
+// The Cloudflare devtools only show the first service in workerd configuration. This service
+// is always contains a users code. However, in packaging user code wrangler may add
+// additional services that also have code. If using Chrome devtools to inspect a workerd,
+// instance all services are visible and can be debugged.
+class Server::InspectorServiceIsolateRegistrar final {
+ public:
+  InspectorServiceIsolateRegistrar() {}
+  ~InspectorServiceIsolateRegistrar() noexcept(true);
+
+  void registerIsolate(kj::StringPtr name, Worker::Isolate* isolate);
+
+  KJ_DISALLOW_COPY_AND_MOVE(InspectorServiceIsolateRegistrar);
+
+ private:
+  void attach(const Server::InspectorService* anInspectorService) {
+    *inspectorService.lockExclusive() = anInspectorService;
+  }
+
+  void detach() {
+    *inspectorService.lockExclusive() = nullptr;
+  }
+
+  kj::MutexGuarded<const InspectorService*> inspectorService;
+  friend class Server::InspectorService;
+};
+
+// Implements the interface for the devtools inspector protocol.
+//
+// The InspectorService is created when workerd serve is called using the -i option
+// to define the inspector socket.
+class Server::InspectorService final: public kj::HttpService, public kj::HttpServerErrorHandler {
+ public:
+  InspectorService(kj::Own<const kj::Executor> isolateThreadExecutor,
+      kj::Timer& timer,
+      kj::HttpHeaderTable::Builder& headerTableBuilder,
+      InspectorServiceIsolateRegistrar& registrar)
+      : isolateThreadExecutor(kj::mv(isolateThreadExecutor)),
+        timer(timer),
+        headerTable(headerTableBuilder.getFutureTable()),
+        server(timer, headerTable, *this, kj::HttpServerSettings{.errorHandler = *this}),
+        registrar(registrar) {
+    registrar.attach(this);
+  }
+
+  ~InspectorService() {
+    KJ_IF_SOME(r, registrar) {
+      r.detach();
+    }
+  }
+
+  void invalidateRegistrar() {
+    registrar = kj::none;
+  }
+
+  kj::Promise<void> handleApplicationError(
+      kj::Exception exception, kj::Maybe<kj::HttpService::Response&> response) override {
+    KJ_LOG(ERROR, kj::str("Uncaught exception: ", exception));
+    KJ_IF_SOME(r, response) {
+      co_return co_await r.sendError(500, "Internal Server Error", headerTable);
+    }
+  }
+
+  kj::Promise<void> request(kj::HttpMethod method,
+      kj::StringPtr url,
+      const kj::HttpHeaders& headers,
+      kj::AsyncInputStream& requestBody,
+      kj::HttpService::Response& response) override {
+    // The inspector protocol starts with the debug client sending ordinary HTTP GET requests
+    // to /json/version and then to /json or /json/list. These must respond with valid JSON
+    // documents that list the details of what isolates are available for inspection. Each
+    // isolate must be listed separately. In the advertisement for each isolate is a URL
+    // and a unique ID. The client will use the URL and ID to open a WebSocket request to
+    // actually connect the debug session.
+    kj::HttpHeaders responseHeaders(headerTable);
+    if (headers.isWebSocket()) {
+      KJ_IF_SOME(pos, url.findLast('/')) {
+        auto id = url.slice(pos + 1);
+
+        KJ_IF_SOME(isolate, isolates.find(id)) {
+          // If getting the strong ref doesn't work it means that the Worker::Isolate
+          // has already been cleaned up. We use a weak ref here in order to keep from
+          // having the Worker::Isolate itself having to know anything at all about the
+          // IsolateService and the registration process. So instead of having Isolate
+          // explicitly clean up after itself we lazily evaluate the weak ref and clean
+          // up when necessary.
+          KJ_IF_SOME(ref, isolate->tryAddStrongRef()) {
+            // When using --verbose, we'll output some logging to indicate when the
+            // inspector client is attached/detached.
+            KJ_LOG(INFO, kj::str("Inspector client attaching [", id, "]"));
+            auto webSocket = response.acceptWebSocket(responseHeaders);
+            kj::Duration timerOffset = 0 * kj::MILLISECONDS;
+            try {
+              co_return co_await ref->attachInspector(
+                  isolateThreadExecutor->addRef(), timer, timerOffset, *webSocket);
+            } catch (...) {
+              auto exception = kj::getCaughtExceptionAsKj();
+              if (exception.getType() == kj::Exception::Type::DISCONNECTED) {
+                // This likely just means that the inspector client was closed.
+                // Nothing to do here but move along.
+                KJ_LOG(INFO, "Inspector client detached"_kj);
+                co_return;
+              } else {
+                // If it's any other kind of error, propagate it!
+                kj::throwFatalException(kj::mv(exception));
+              }
+            }
+          } else {
+            // If we can't get a strong ref to the isolate here, it's been cleaned
+            // up. The only thing we're going to do is clean up here and act like
+            // nothing happened.
+            isolates.erase(id);
+          }
+        }
+
+        KJ_LOG(INFO, kj::str("Unknown worker session [", id, "]"));
+        co_return co_await response.sendError(404, "Unknown worker session", responseHeaders);
+      }
+
+      // No / in url!? That's weird
+      co_return co_await response.sendError(400, "Invalid request", responseHeaders);
+    }
+
+    // If the request is not a WebSocket request, it must be a GET to fetch details
+    // about the implementation.
+    if (method != kj::HttpMethod::GET) {
+      co_return co_await response.sendError(501, "Unsupported Operation", responseHeaders);
+    }
+
+    if (url.endsWith("/json/version")) {
       responseHeaders.set(kj::HttpHeaderId::CONTENT_TYPE, MimeType::JSON.toString());
       auto content = kj::str("{\"Browser\": \"workerd\", \"Protocol-Version\": \"1.3\" }");
       auto out = response.send(200, "OK", responseHeaders, content.size());
@@ -1447,37 +2287,127 @@ void Server::InspectorServiceIsolateRegistrar::registerIsolate(
 
 // =======================================================================================
 namespace {
+// Names the kind of event a custom event delivers, for metrics.
+kj::StringPtr getCustomEventName(WorkerInterface::CustomEvent& event) {
+  if (kj::dynamicDowncastIfAvailable<api::JsRpcSessionCustomEventImpl>(event) != kj::none) {
+    return "rpc"_kj;
+  } else if (kj::dynamicDowncastIfAvailable<api::QueueCustomEventImpl>(event) != kj::none) {
+    return "queue"_kj;
+  } else if (kj::dynamicDowncastIfAvailable<api::HibernatableWebSocketCustomEventImpl>(event) !=
+      kj::none) {
+    return "hibernatableWebSocket"_kj;
+  } else if (kj::dynamicDowncastIfAvailable<api::TraceCustomEventImpl>(event) != kj::none) {
+    return "trace"_kj;
+  } else {
+    return "custom"_kj;
+  }
+}
+
+// Also feeds ServerMetrics, when the config enables them.
 class RequestObserverWithTracer final: public RequestObserver, public WorkerInterface {
  public:
-  RequestObserverWithTracer(kj::Maybe<kj::Own<WorkerTracer>> tracer): tracer(kj::mv(tracer)) {}
+  RequestObserverWithTracer(kj::Maybe<kj::Own<WorkerTracer>> tracer,
+      kj::Maybe<ServerMetrics&> metrics,
+      kj::StringPtr serviceName,
+      kj::Maybe<kj::StringPtr> entrypointName)
+      : tracer(kj::mv(tracer)),
+        metrics(metrics),
+        startTime(kj::systemCoarseCalendarClock().now()),
+        startInstant(kj::systemPreciseMonotonicClock().now()) {
+    KJ_IF_SOME(m, metrics) {
+      m.requests.add();
+      this->serviceName = kj::str(serviceName);
+      this->entrypointName = kj::str(entrypointName.orDefault("default"_kj));
+    }
+  }
   ~RequestObserverWithTracer() noexcept(false) {
+    auto wallTime = kj::systemPreciseMonotonicClock().now() - startInstant;
+    KJ_IF_SOME(m, metrics) {
+      m.requestDuration.observe(wallTime);
+      if (outcome != EventOutcome::OK) {
+        m.requestFailures.add();
+      }
+      auto& times = m.getHandlerTimes(serviceName, entrypointName, eventName);
+      times.invocations.add();
+      times.cpuNs.add(cpuTime / kj::NANOSECONDS);
+      times.wallNs.add(wallTime / kj::NANOSECONDS);
+    }
     KJ_IF_SOME(t, tracer) {
       if (fetchStatus != 0) {
         t->setFetchResponseInfo(tracing::FetchResponseInfo(fetchStatus));
       }
-      t->setOutcome(
-          outcome, 0 * kj::MILLISECONDS /* cpu time */, 0 * kj::MILLISECONDS /* wall time */);
+      // The wait times vary from run to run, so they're left out of predictable test output.
+      if (waits.hasAny() && !isPredictableModeForTest()) {
+        t->addSpan(waits.toSpan(startTime), kj::str());
+      }
+      if (isPredictableModeForTest()) {
+        t->setOutcome(
+            outcome, 0 * kj::MILLISECONDS /* cpu time */, 0 * kj::MILLISECONDS /* wall time */);
+      } else {
+        t->setOutcome(outcome, cpuTime, wallTime);
+      }
     }
   }
 
   WorkerInterface& wrapWorkerInterface(WorkerInterface& worker) override {
-    if (tracer != kj::none) {
+    if (tracer != kj::none || metrics != kj::none) {
       inner = worker;
       return *this;
     }
     return worker;
   }
 
+  bool wantsJsTiming() override {
+    return tracer != kj::none || metrics != kj::none;
+  }
+  void jsExecuted(kj::Duration duration) override {
+    cpuTime += duration;
+  }
+
   void reportFailure(const kj::Exception& exception, FailureSource source) override {
     outcome = EventOutcome::EXCEPTION;
   }
 
+  kj::Maybe<kj::Own<WebSocketObserver>> tryCreateWebSocketObserver() override {
+    return metrics.map([](ServerMetrics& m) { return m.makeWebSocketObserver(); });
+  }
+
+  kj::Maybe<kj::Own<ByteStreamObserver>> tryCreateWritableByteStreamObserver() override {
+    return metrics.map([](ServerMetrics& m) { return m.makeByteStreamObserver(); });
+  }
+
+  void outputGateWaited(kj::Duration duration) override {
+    waits.outputGate += duration;
+    KJ_IF_SOME(m, metrics) {
+      m.outputGateWait.observe(duration);
+    }
+  }
+  void inputGateWaited(kj::Duration duration) override {
+    waits.inputGate += duration;
+    KJ_IF_SOME(m, metrics) {
+      m.inputGateWait.observe(duration);
+    }
+  }
+  void isolateLockWaited(kj::Duration duration) override {
+    waits.isolateLock += duration;
+    KJ_IF_SOME(m, metrics) {
+      m.isolateLockWait.observe(duration);
+    }
+  }
+  void storageFlushed(kj::Duration duration) override {
+    waits.storageFlush += duration;
+    KJ_IF_SOME(m, metrics) {
+      m.storageFlush.observe(duration);
+    }
+  }
+
   // WorkerInterface
   kj::Promise<void> request(kj::HttpMethod method,
       kj::StringPtr url,
       const kj::HttpHeaders& headers,
       kj::AsyncInputStream& requestBody,
       kj::HttpService::Response& response) override {
+    eventName = "fetch"_kj;
     try {
       SimpleResponseObserver responseWrapper(&fetchStatus, response);
       co_await KJ_ASSERT_NONNULL(inner).request(method, url, headers, requestBody, responseWrapper);
@@ -1494,6 +2424,7 @@ class RequestObserverWithTracer final: public RequestObserver, public WorkerInte
       kj::AsyncIoStream& connection,
       ConnectResponse& response,
       kj::HttpConnectSettings settings) override {
+    eventName = "connect"_kj;
     try {
       co_return co_await KJ_ASSERT_NONNULL(inner).connect(
           host, headers, connection, response, settings);
@@ -1515,6 +2446,7 @@ class RequestObserverWithTracer final: public RequestObserver, public WorkerInte
   }
 
   kj::Promise<ScheduledResult> runScheduled(kj::Date scheduledTime, kj::StringPtr cron) override {
+    eventName = "scheduled"_kj;
     try {
       co_return co_await KJ_ASSERT_NONNULL(inner).runScheduled(scheduledTime, cron);
     } catch (...) {
@@ -1525,6 +2457,7 @@ class RequestObserverWithTracer final: public RequestObserver, public WorkerInte
   }
 
   kj::Promise<AlarmResult> runAlarm(kj::Date scheduledTime, uint32_t retryCount) override {
+    eventName = "alarm"_kj;
     try {
       co_return co_await KJ_ASSERT_NONNULL(inner).runAlarm(scheduledTime, retryCount);
     } catch (...) {
@@ -1535,6 +2468,7 @@ class RequestObserverWithTracer final: public RequestObserver, public WorkerInte
   }
 
   kj::Promise<bool> test() override {
+    eventName = "test"_kj;
     try {
       co_return co_await KJ_ASSERT_NONNULL(inner).test();
     } catch (...) {
@@ -1545,6 +2479,7 @@ class RequestObserverWithTracer final: public RequestObserver, public WorkerInte
   }
 
   kj::Promise<CustomEvent::Result> customEvent(kj::Own<CustomEvent> event) override {
+    eventName = getCustomEventName(*event);
     try {
       co_return co_await KJ_ASSERT_NONNULL(inner).customEvent(kj::mv(event));
     } catch (...) {
@@ -1555,10 +2490,46 @@ class RequestObserverWithTracer final: public RequestObserver, public WorkerInte
   }
 
  private:
+  // Total time the request spent blocked, by cause. Reported to the tracer as the tags of a
+  // "request_waits" span covering the request.
+  struct Waits {
+    kj::Duration outputGate = 0 * kj::SECONDS;
+    kj::Duration inputGate = 0 * kj::SECONDS;
+    kj::Duration isolateLock = 0 * kj::SECONDS;
+    kj::Duration storageFlush = 0 * kj::SECONDS;
+
+    bool hasAny() const {
+      return outputGate + inputGate + isolateLock + storageFlush > 0 * kj::SECONDS;
+    }
+
+    Span toSpan(kj::Date startTime) const {
+      Span span("request_waits"_kjc, startTime);
+      span.endTime = kj::systemCoarseCalendarClock().now();
+      auto tag = [&](kj::ConstString key, kj::Duration duration) {
+        span.tags.insert(kj::mv(key), duration / kj::NANOSECONDS / 1e6);
+      };
+      tag("output_gate_wait_ms"_kjc, outputGate);
+      tag("input_gate_wait_ms"_kjc, inputGate);
+      tag("isolate_lock_wait_ms"_kjc, isolateLock);
+      tag("storage_flush_ms"_kjc, storageFlush);
+      return span;
+    }
+  };
+
   kj::Maybe<kj::Own<WorkerTracer>> tracer;
+  kj::Maybe<ServerMetrics&> metrics;
+  // Only set when `metrics` is.
+  kj::String serviceName;
+  kj::String entrypointName;
+  kj::StringPtr eventName = "unknown"_kj;
   kj::Maybe<WorkerInterface&> inner;
   EventOutcome outcome = EventOutcome::OK;
   kj::uint fetchStatus = 0;
+  kj::Date startTime;
+  kj::TimePoint startInstant;
+  // Thread CPU time spent running JavaScript for this request, see jsExecuted().
+  kj::Duration cpuTime = 0 * kj::SECONDS;
+  Waits waits;
 };
 }  // namespace
 
@@ -1575,26 +2546,56 @@ class Server::WorkerService final: public Service,
     kj::Array<Service*> subrequest;
     kj::Array<kj::Maybe<ActorNamespace&>> actor;  // null = configuration error
     kj::Maybe<Service&> cache;
+    kj::Maybe<kj::Own<LocalCacheTier>> localCache;  // in front of `cache`, if configured
     kj::Maybe<kj::Own<SqliteDatabase::Vfs>> actorStorage;
     AlarmScheduler& alarmScheduler;
     kj::Array<Service*> tails;
+    kj::Maybe<kj::Own<TailSampler>> tailSampler;  // decides which requests `tails` see
+    // Diagnostics channels recorded for `tails`, if not all of them.
+    kj::Maybe<kj::HashSet<kj::String>> tailDiagnosticsChannels;
+    kj::Maybe<kj::Own<CronScheduler>> cronScheduler;  // runs `cron` triggers
   };
   using LinkCallback = kj::Function<LinkedIoChannels(WorkerService&)>;
   using AbortActorsCallback = kj::Function<void()>;
 
+  // The heap of the worker's isolate, as its limit enforcer last saw it. Shared between the
+  // service and the enforcer, and kept across the rebuilds of a `lazy` worker.
+  struct IsolateHeap: public kj::Refcounted {
+    // As of the isolate's last exit from JavaScript. Only sampled when something needs it: metrics,
+    // `Worker.memoryLimit` or `Config.actorMemory.maxIsolateHeapBytes`.
+    size_t usedBytes = 0;
+    // Requests are shed while this is set; see `Worker.memoryLimit`.
+    bool nearLimit = false;
+    // Set if the worker has a `memoryLimit` and metrics are enabled.
+    kj::Maybe<ServerMetrics::IsolateMemory&> metrics;
+  };
+
+  // For `Worker.lazy` workers, whose isolate is discarded while idle.
+  struct Lazy {
+    kj::Function<kj::Own<const Worker>(Worker::ValidationErrorReporter&)> rebuild;
+    kj::Duration idleTimeout;
+  };
+
   WorkerService(ThreadContext& threadContext,
       kj::Own<const Worker> worker,
       kj::Maybe<kj::HashSet<kj::String>> defaultEntrypointHandlers,
       kj::HashMap<kj::String, kj::HashSet<kj::String>> namedEntrypointsParam,
       const kj::HashMap<kj::String, ActorConfig>& actorClasses,
       LinkCallback linkCallback,
-      AbortActorsCallback abortActorsCallback)
+      AbortActorsCallback abortActorsCallback,
+      kj::Maybe<ServerMetrics&> metrics,
+      const ActorMemoryLimits& actorMemoryLimits,
+      kj::Own<IsolateHeap> isolateHeap,
+      kj::Maybe<Lazy> lazyParam)
       : threadContext(threadContext),
         ioChannels(kj::mv(linkCallback)),
         worker(kj::mv(worker)),
         defaultEntrypointHandlers(kj::mv(defaultEntrypointHandlers)),
         waitUntilTasks(*this),
-        abortActorsCallback(kj::mv(abortActorsCallback)) {
+        abortActorsCallback(kj::mv(abortActorsCallback)),
+        metrics(metrics),
+        actorMemoryLimits(actorMemoryLimits),
+        isolateHeap(kj::mv(isolateHeap)) {
 
     namedEntrypoints.reserve(namedEntrypointsParam.size());
     for (auto& ep: namedEntrypointsParam) {
@@ -1608,6 +2609,12 @@ class Server::WorkerService final: public Service,
           kj::heap<ActorNamespace>(*this, entry.key, entry.value, threadContext.getUnsafeTimer());
       actorNamespaces.insert(entry.key, kj::mv(ns));
     }
+
+    KJ_IF_SOME(l, lazyParam) {
+      // The worker was only built to validate the config; getWorker() rebuilds it when needed.
+      lazy = LazyState{.options = kj::mv(l), .lastUsed = threadContext.getUnsafeTimer().now()};
+      this->worker = nullptr;
+    }
   }
 
   kj::Maybe<Service&> getEntrypoint(kj::StringPtr name) {
@@ -1636,6 +2643,15 @@ class Server::WorkerService final: public Service,
     return actorNamespaces;
   }
 
+  kj::Maybe<kj::Own<WorkerInterface>> startActorRequest(kj::StringPtr className,
+      kj::StringPtr id,
+      IoChannelFactory::SubrequestMetadata metadata) override {
+    KJ_IF_SOME(ns, actorNamespaces.find(className)) {
+      return ns->getActor(kj::str(id), kj::mv(metadata));
+    }
+    return kj::none;
+  }
+
   kj::Own<WorkerInterface> startRequest(IoChannelFactory::SubrequestMetadata metadata) override {
     return startRequest(kj::mv(metadata), kj::none);
   }
@@ -1653,6 +2669,44 @@ class Server::WorkerService final: public Service,
       kj::Maybe<kj::Own<Worker::Actor>> actor = kj::none) {
     TRACE_EVENT("workerd", "Server::WorkerService::startRequest()");
 
+    auto& channels = KJ_ASSERT_NONNULL(ioChannels.tryGet<LinkedIoChannels>());
+
+    if (isolateHeap->nearLimit) {
+      KJ_IF_SOME(m, isolateHeap->metrics) {
+        m.requestsShed.add();
+      }
+      return kj::heap<HeapLimitShedder>(threadContext.getHeaderTable());
+    }
+
+    auto& worker = getWorker();
+
+    // Requests that no tail worker will see don't need a tracer at all.
+    auto sampling = TailSampler::Decision::SKIP;
+    if (channels.tails.size() > 0) {
+      KJ_IF_SOME(sampler, channels.tailSampler) {
+        sampling = sampler->sampleRequest();
+      } else {
+        sampling = TailSampler::Decision::SAMPLED;
+      }
+    }
+    if (sampling == TailSampler::Decision::SKIP) {
+      kj::Own<RequestObserver> observer;
+      if (metrics != kj::none) {
+        observer = kj::refcounted<RequestObserverWithTracer>(
+            kj::none, metrics, worker.getIsolate().getId(), entrypointName);
+      } else {
+        observer = kj::refcounted<RequestObserver>();
+      }
+      return newWorkerEntrypoint(threadContext, kj::atomicAddRef(worker), entrypointName,
+          kj::mv(actor), kj::Own<LimitEnforcer>(this, kj::NullDisposer::instance),
+          {},  // ioContextDependency
+          kj::Own<IoChannelFactory>(this, kj::NullDisposer::instance), kj::mv(observer),
+          waitUntilTasks,
+          true,      // tunnelExceptions
+          kj::none,  // workerTracer
+          kj::mv(metadata.cfBlobJson));
+    }
+
     // Setting up tail workers support.
     auto tracer = kj::rc<PipelineTracer>();
     auto executionModel =
@@ -1661,8 +2715,10 @@ class Server::WorkerService final: public Service,
         tracer->makeWorkerTracer(PipelineLogLevel::FULL, executionModel, kj::none /* scriptId */,
             kj::none /* stableId */, kj::none /* scriptName */, kj::none /* scriptVersion */,
             kj::none /* dispatchNamespace */, nullptr /* scriptTags */, kj::none /* entrypoint */);
-
-    auto& channels = KJ_ASSERT_NONNULL(ioChannels.tryGet<LinkedIoChannels>());
+    KJ_IF_SOME(names, channels.tailDiagnosticsChannels) {
+      // Owned by this service's ioChannels, like the sampler.
+      workerTracer->setDiagnosticChannels(names);
+    }
 
     auto tailWorkers = KJ_MAP(service, channels.tails) -> kj::Own<WorkerInterface> {
       KJ_ASSERT(service != this, "A worker currently cannot log to itself");
@@ -1685,9 +2741,19 @@ class Server::WorkerService final: public Service,
     // will be. See below, we end up creating two references to the WorkerTracer,
     // one held by the observer and one that will be passed to the IoContext.
     // The PipelineTracer will be destroyed once both of those are freed.
+    // The sampler outlives the request: both are owned by this service's ioChannels.
+    kj::Maybe<TailSampler&> exceptionsOnly;
+    if (sampling == TailSampler::Decision::EXCEPTIONS_ONLY) {
+      exceptionsOnly = *KJ_ASSERT_NONNULL(channels.tailSampler);
+    }
     waitUntilTasks.add(tracer->onComplete().then(
-        kj::coCapture([tailWorkers = kj::mv(tailWorkers)](
+        kj::coCapture([tailWorkers = kj::mv(tailWorkers), exceptionsOnly](
                           kj::Array<kj::Own<Trace>> traces) mutable -> kj::Promise<void> {
+      KJ_IF_SOME(sampler, exceptionsOnly) {
+        if (!sampler.shouldDeliverUnsampled(traces)) {
+          co_return;
+        }
+      }
       for (auto& worker: tailWorkers) {
         auto event = kj::heap<workerd::api::TraceCustomEventImpl>(
             workerd::api::TraceCustomEventImpl::TYPE, mapAddRef(traces));
@@ -1696,9 +2762,10 @@ class Server::WorkerService final: public Service,
       co_return;
     })));
 
-    auto observer = kj::refcounted<RequestObserverWithTracer>(kj::addRef(*workerTracer));
+    auto observer = kj::refcounted<RequestObserverWithTracer>(
+        kj::addRef(*workerTracer), metrics, worker.getIsolate().getId(), entrypointName);
 
-    return newWorkerEntrypoint(threadContext, kj::atomicAddRef(*worker), entrypointName,
+    return newWorkerEntrypoint(threadContext, kj::atomicAddRef(worker), entrypointName,
         kj::mv(actor), kj::Own<LimitEnforcer>(this, kj::NullDisposer::instance),
         {},  // ioContextDependency
         kj::Own<IoChannelFactory>(this, kj::NullDisposer::instance), kj::mv(observer),
@@ -1717,12 +2784,31 @@ class Server::WorkerService final: public Service,
         : service(service),
           className(className),
           config(config),
+          evictionWheel(timer, [](ActorContainer& container) { container.evict(); },
+              [this]() { evictForMemory(); }),
+          removalWheel(timer, [this](ActorContainer& container) {
+            auto key = kj::str(container.getKey());
+            actors.erase(key.asPtr());
+          }),
           timer(timer) {}
 
     const ActorConfig& getConfig() {
       return config;
     }
 
+    // A process sharing this namespace, see `DurableObjectNamespace.peers`.
+    struct Peer {
+      kj::StringPtr name;
+      // An ExternalHttpService reaching the peer, or null for this process.
+      kj::Maybe<Service&> service;
+    };
+
+    void setPeers(kj::Array<Peer> peersParam) {
+      peers = kj::mv(peersParam);
+    }
+
+    // Routes to the peer that owns `id` when the namespace has peers, otherwise to the local
+    // object.
     kj::Own<WorkerInterface> getActor(
         Worker::Actor::Id id, IoChannelFactory::SubrequestMetadata metadata) {
       kj::String idStr;
@@ -1737,9 +2823,13 @@ class Server::WorkerService final: public Service,
         }
       }
 
+      KJ_IF_SOME(owner, findRemoteOwner(idStr)) {
+        return KJ_ASSERT_NONNULL(owner.startActorRequest(className, idStr, kj::mv(metadata)));
+      }
       return getActor(kj::mv(idStr), kj::mv(metadata));
     }
 
+    // Always hosts the object in this process, regardless of `peers`.
     kj::Own<WorkerInterface> getActor(
         kj::String id, IoChannelFactory::SubrequestMetadata metadata) {
       return newPromisedWorkerInterface(getActorThenStartRequest(kj::mv(id), kj::mv(metadata)));
@@ -1749,30 +2839,140 @@ class Server::WorkerService final: public Service,
       return kj::heap<ActorChannelImpl>(*this, kj::mv(id));
     }
 
-    // Forward declaration.
+    // Forward declarations.
+    class ActorContainer;
     class ActorContainerRef;
 
+    // A container's place in a `Wheel`.
+    struct WheelEntry {
+      ActorContainer& container;
+      kj::ListLink<WheelEntry> link;
+      size_t slot = 0;
+    };
+
+    // A timing wheel that fires the deadlines of all of a namespace's actors from one timer, so
+    // that a namespace with many live actors doesn't keep a timer event per actor, and requests
+    // don't have to re-arm one. Scheduling and cancelling are O(1), and each tick only visits the
+    // entries in its own slot.
+    //
+    // Deadlines are rounded down to the tick, so entries can fire up to one tick early.
+    class Wheel {
+     public:
+      Wheel(kj::Timer& timer,
+          kj::Function<void(ActorContainer&)> fire,
+          kj::Maybe<kj::Function<void()>> afterTick = kj::none)
+          : timer(timer),
+            fire(kj::mv(fire)),
+            afterTick(kj::mv(afterTick)) {}
+
+      void schedule(WheelEntry& entry, kj::TimePoint deadline) {
+        cancel(entry);
+
+        if (!running) {
+          running = true;
+          nextTick = currentTick() + 1;
+          task = run().eagerlyEvaluate([](kj::Exception&& e) { KJ_LOG(ERROR, e); });
+        }
+
+        auto tick = kj::max(toTick(deadline), nextTick);
+        KJ_REQUIRE(tick - nextTick < SLOTS, "deadline too far in the future for the wheel");
+        entry.slot = tick % SLOTS;
+        slots[entry.slot].add(entry);
+        ++size;
+      }
+
+      void cancel(WheelEntry& entry) {
+        if (entry.link.isLinked()) {
+          slots[entry.slot].remove(entry);
+          --size;
+        }
+      }
+
+      size_t getSize() {
+        return size;
+      }
+
+      // Calls `func` on each entry, earliest deadline first (in order of slots). `func` must not
+      // schedule or cancel entries.
+      template <typename Func>
+      void forEach(Func&& func) {
+        for (auto tick: kj::range(nextTick, nextTick + SLOTS)) {
+          for (auto& entry: slots[tick % SLOTS]) {
+            func(entry);
+          }
+        }
+      }
+
+     private:
+      static constexpr kj::Duration TICK = 1 * kj::SECONDS;
+      // Must cover the longest delay we schedule, in ticks.
+      static constexpr int64_t SLOTS = 128;
+
+      kj::Timer& timer;
+      kj::Function<void(ActorContainer&)> fire;
+      kj::Maybe<kj::Function<void()>> afterTick;
+      kj::List<WheelEntry, &WheelEntry::link> slots[SLOTS];
+      size_t size = 0;
+
+      // The first tick whose slot hasn't been processed yet. Only meaningful while running.
+      int64_t nextTick = 0;
+      bool running = false;
+      kj::Maybe<kj::Promise<void>> task;
+
+      static int64_t toTick(kj::TimePoint time) {
+        return (time - kj::origin<kj::TimePoint>()) / TICK;
+      }
+      int64_t currentTick() {
+        return toTick(timer.now());
+      }
+
+      // Wakes up once per tick for as long as the wheel has entries, calling `afterTick` each
+      // time.
+      kj::Promise<void> run() {
+        while (size > 0) {
+          co_await timer.atTime(kj::origin<kj::TimePoint>() + nextTick * TICK);
+          auto now = currentTick();
+          while (nextTick <= now) {
+            auto& slot = slots[nextTick++ % SLOTS];
+            while (!slot.empty()) {
+              auto& entry = *slot.begin();
+              slot.remove(entry);
+              --size;
+              // This may destroy the container, and with it `entry`.
+              fire(entry.container);
+            }
+          }
+          KJ_IF_SOME(f, afterTick) {
+            f();
+          }
+        }
+        running = false;
+      }
+    };
+
     // ActorContainer mostly serves as a wrapper around Worker::Actor.
     // We use it to associate a HibernationManager with the Worker::Actor, since the
     // Worker::Actor can be destroyed during periods of prolonged inactivity.
     //
     // We use a RequestTracker to track strong references to this ActorContainer's Worker::Actor.
     // Once there are no Worker::Actor's left (excluding our own), `inactive()` is triggered and we
-    // initiate the eviction of the Durable Object. If no requests arrive in the next 10 seconds,
-    // the DO is evicted, otherwise we cancel the eviction task.
+    // schedule the eviction of the Durable Object on the namespace's `evictionWheel`. If no
+    // requests arrive in the next 10 seconds, the DO is evicted, otherwise we cancel the eviction.
     class ActorContainer final: public RequestTracker::Hooks {
      public:
       ActorContainer(kj::StringPtr key, ActorNamespace& parent, kj::Timer& timer)
           : key(key),
             tracker(kj::refcounted<RequestTracker>(*this)),
             parent(parent),
-            timer(timer),
-            lastAccess(timer.now()) {}
+            timer(timer) {}
 
       ~ActorContainer() noexcept(false) {
         // Shutdown the tracker so we don't use active/inactive hooks anymore.
         tracker->shutdown();
 
+        parent.evictionWheel.cancel(evictionEntry);
+        parent.removalWheel.cancel(removalEntry);
+
         KJ_IF_SOME(a, actor) {
           // Unknown broken reason.
           auto reason = 0;
@@ -1794,22 +2994,13 @@ class Server::WorkerService final: public Service,
       }
 
       void active() override {
-        // We're handling a new request, cancel the eviction promise.
+        // We're handling a new request, cancel the eviction.
+        parent.evictionWheel.cancel(evictionEntry);
         shutdownTask = kj::none;
       }
 
       void inactive() override {
-        // Durable objects are evictable by default.
-        bool isEvictable = true;
-        KJ_SWITCH_ONEOF(parent.config) {
-          KJ_CASE_ONEOF(c, Durable) {
-            isEvictable = c.isEvictable;
-          }
-          KJ_CASE_ONEOF(c, Ephemeral) {
-            isEvictable = c.isEvictable;
-          }
-        }
-        if (isEvictable) {
+        if (parent.isEvictable()) {
           KJ_IF_SOME(a, actor) {
             KJ_IF_SOME(m, a->getHibernationManager()) {
               // The hibernation manager needs to survive actor eviction and be passed to the actor
@@ -1817,17 +3008,27 @@ class Server::WorkerService final: public Service,
               manager = m.addRef();
             }
           }
-          shutdownTask =
-              handleShutdown().eagerlyEvaluate([](kj::Exception&& e) { KJ_LOG(ERROR, e); });
+          parent.evictionWheel.schedule(evictionEntry, timer.now() + INACTIVITY_TIMEOUT);
         }
       }
 
+      // Called by the `evictionWheel` once we've been inactive for INACTIVITY_TIMEOUT, or earlier
+      // by `evictForMemory()`.
+      void evict() {
+        parent.evictionWheel.cancel(evictionEntry);
+        shutdownTask =
+            handleShutdown().eagerlyEvaluate([](kj::Exception&& e) { KJ_LOG(ERROR, e); });
+      }
+
+      // Records that a new Worker::Actor was just created for `actor`.
+      void actorCreated() {
+        residentSince = timer.now();
+      }
+
       // Processes the eviction of the Durable Object and hibernates active websockets.
       kj::Promise<void> handleShutdown() {
-        // After 10 seconds of inactivity, we destroy the Worker::Actor and hibernate any active
-        // JS WebSockets.
-        // TODO(someday): We could make this timeout configurable to make testing less burdensome.
-        co_await timer.afterDelay(10 * kj::SECONDS);
+        // We've been inactive long enough, so we destroy the Worker::Actor and hibernate any
+        // active JS WebSockets.
         KJ_IF_SOME(onBroken, parent.onBrokenTasks.findEntry(getKey())) {
           // Cancel the onBroken promise, since we're about to destroy the actor anyways and don't
           // want to trigger it.
@@ -1857,11 +3058,15 @@ class Server::WorkerService final: public Service,
             // promise. If a new request comes in while we're waiting to get the lock then we will
             // cancel this promise.
             Worker::AsyncLock asyncLock = co_await worker.takeAsyncLockWithoutRequest(nullptr);
-            workerStrongRef->runInLockScope(
-                asyncLock, [&](Worker::Lock& lock) { m->hibernateWebSockets(lock); });
+            workerStrongRef->runInLockScope(asyncLock,
+                [&](Worker::Lock& lock) { m->hibernateWebSockets(lock, a->getMetrics()); });
           }
           a->shutdown(
               0, KJ_EXCEPTION(DISCONNECTED, "broken.dropped; Actor freed due to inactivity"));
+          KJ_IF_SOME(m, parent.service.metrics) {
+            m.actorsEvicted.add();
+            m.actorResidency.observe(timer.now() - residentSince);
+          }
         }
         // Destroy the last strong Worker::Actor reference.
         actor = kj::none;
@@ -1873,17 +3078,14 @@ class Server::WorkerService final: public Service,
       RequestTracker& getTracker() {
         return *tracker;
       }
+      // Whether our actor has WebSockets that survive its eviction.
+      bool canHibernate() {
+        return manager != kj::none;
+      }
       kj::Maybe<kj::Own<Worker::Actor::HibernationManager>> tryGetManagerRef() {
         return manager.map(
             [&](kj::Own<Worker::Actor::HibernationManager>& m) { return kj::addRef(*m); });
       }
-      void updateAccessTime() {
-        lastAccess = timer.now();
-      }
-      kj::TimePoint getLastAccess() {
-        return lastAccess;
-      }
-
       bool hasClients() {
         return containerRef != kj::none;
       }
@@ -1904,31 +3106,39 @@ class Server::WorkerService final: public Service,
       kj::Own<RequestTracker> tracker;
       ActorNamespace& parent;
       kj::Timer& timer;
-      kj::TimePoint lastAccess;
+      kj::TimePoint residentSince = kj::origin<kj::TimePoint>();
       kj::Maybe<kj::Own<Worker::Actor::HibernationManager>> manager;
       kj::Maybe<kj::Promise<void>> shutdownTask;
       bool onBrokenTriggered = false;
 
+      // Our places in the namespace's `evictionWheel` and `removalWheel`.
+      WheelEntry evictionEntry{.container = *this};
+      WheelEntry removalEntry{.container = *this};
+
       // Non-empty if at least one client has a reference to this actor.
-      // If no clients are connected, we may be evicted by `cleanupLoop`.
+      // If no clients are connected, we are on the `removalWheel`.
       kj::Maybe<ActorContainerRef&> containerRef;
       friend class ActorContainerRef;
     };
 
     // This class tracks clients that a have reference to the given actor.
-    // Upon destruction, we update the lastAccess time for the actor and
-    // `ActorContainer::hasClients()` starts returning false. After 70 seconds, the cleanupLoop
-    // will remove the `ActorContainer` from `actors`.
+    // Upon destruction, `ActorContainer::hasClients()` starts returning false and the container is
+    // scheduled on the `removalWheel`. If no new client arrives within CONTAINER_EXPIRATION, the
+    // `ActorContainer` is removed from `actors`.
     class ActorContainerRef: public kj::Refcounted {
      public:
       ActorContainerRef(ActorContainer& container): container(container) {
         // Link this ref to the actual ActorContainer.
         container.containerRef = *this;
+        container.parent.removalWheel.cancel(container.removalEntry);
       }
       ~ActorContainerRef() noexcept(false) {
         KJ_IF_SOME(ref, container) {
-          ref.updateAccessTime();
           ref.containerRef = kj::none;
+          if (ref.parent.isEvictable()) {
+            ref.parent.removalWheel.schedule(
+                ref.removalEntry, ref.timer.now() + CONTAINER_EXPIRATION);
+          }
         }
       }
 
@@ -1948,17 +3158,67 @@ class Server::WorkerService final: public Service,
     }
 
    private:
+    // How long an actor may go without requests before its Worker::Actor is evicted.
+    // TODO(someday): We could make this timeout configurable to make testing less burdensome.
+    static constexpr kj::Duration INACTIVITY_TIMEOUT = 10 * kj::SECONDS;
+    // How long an ActorContainer without clients is kept before being removed from `actors`.
+    static constexpr kj::Duration CONTAINER_EXPIRATION = 70 * kj::SECONDS;
+
     WorkerService& service;
     kj::StringPtr className;
     const ActorConfig& config;
+    // Declared before `actors` since containers leave the wheels when destroyed.
+    Wheel evictionWheel;
+    Wheel removalWheel;
     // If the actor is broken, we remove it from the map. However, if it's just evicted due to
     // inactivity, we keep the ActorContainer in the map but drop the Own<Worker::Actor>. When a new
     // request comes in, we recreate the Own<Worker::Actor>.
     kj::HashMap<kj::String, kj::Own<ActorContainer>> actors;
     kj::HashMap<kj::String, kj::Maybe<kj::Promise<void>>> onBrokenTasks;
-    kj::Maybe<kj::Promise<void>> cleanupTask;
     kj::Timer& timer;
 
+    bool isEvictable() {
+      // Durable Objects are evictable by default.
+      bool isEvictable = true;
+      KJ_SWITCH_ONEOF(config) {
+        KJ_CASE_ONEOF(c, Durable) {
+          isEvictable = c.isEvictable;
+        }
+        KJ_CASE_ONEOF(c, Ephemeral) {
+          isEvictable = c.isEvictable;
+        }
+      }
+      return isEvictable;
+    }
+
+    // Evicts some idle actors before their inactivity timeout if the service is short of memory.
+    // Runs after each tick of the `evictionWheel`, which is exactly when there are idle actors.
+    //
+    // Only a fraction go per tick, since it takes a GC for their heap to be reclaimed and we don't
+    // want to empty the namespace over memory that's already on its way out.
+    void evictForMemory() {
+      if (!service.isShortOfMemory()) return;
+
+      auto count = kj::max(evictionWheel.getSize() / 8, size_t(1));
+      kj::Vector<ActorContainer*> victims(count);
+      // The wheel holds idle actors by when they went idle, so this picks the least recently used,
+      // preferring ones that keep their clients' WebSockets connected through hibernation.
+      for (bool hibernatable: {true, false}) {
+        evictionWheel.forEach([&](WheelEntry& entry) {
+          if (victims.size() < count && entry.container.canHibernate() == hibernatable) {
+            victims.add(&entry.container);
+          }
+        });
+      }
+
+      for (auto victim: victims) {
+        victim->evict();
+        KJ_IF_SOME(m, service.metrics) {
+          m.actorsEvictedForMemory.add();
+        }
+      }
+    }
+
     // An owned actor and an ActorContainerRef
     // used to track the client that requested it.
     struct GetActorResult {
@@ -1966,48 +3226,33 @@ class Server::WorkerService final: public Service,
       kj::Own<ActorContainerRef> ref;
     };
 
+    kj::Array<Peer> peers;
+
+    // Returns the peer that `id` is placed on, or null if that's this process.
+    kj::Maybe<Service&> findRemoteOwner(kj::StringPtr id) {
+      kj::Maybe<Peer&> owner;
+      uint64_t ownerWeight = 0;
+      for (auto& peer: peers) {
+        auto weight = placementWeight(peer.name, id);
+        if (owner == kj::none || weight > ownerWeight) {
+          owner = peer;
+          ownerWeight = weight;
+        }
+      }
+      KJ_IF_SOME(o, owner) {
+        return o.service;
+      }
+      return kj::none;
+    }
+
     kj::Promise<kj::Own<WorkerInterface>> getActorThenStartRequest(
         kj::String id, IoChannelFactory::SubrequestMetadata metadata) {
       auto [actor, refTracker] = co_await getActorImpl(kj::mv(id));
 
-      if (cleanupTask == kj::none) {
-        // Need to start the cleanup loop.
-        cleanupTask = cleanupLoop();
-      }
-
       co_return service.startRequest(kj::mv(metadata), className, kj::mv(actor))
           .attach(kj::mv(refTracker));
     }
 
-    // Removes actors from `actors` after 70 seconds of last access.
-    kj::Promise<void> cleanupLoop() {
-      constexpr auto EXPIRATION = 70 * kj::SECONDS;
-
-      while (true) {
-        auto now = timer.now();
-        actors.eraseAll([&](auto&, kj::Own<ActorContainer>& entry) {
-          // Durable Objects are evictable by default.
-          bool isEvictable = true;
-          KJ_SWITCH_ONEOF(config) {
-            KJ_CASE_ONEOF(c, Durable) {
-              isEvictable = c.isEvictable;
-            }
-            KJ_CASE_ONEOF(c, Ephemeral) {
-              isEvictable = c.isEvictable;
-            }
-          }
-          if (entry->hasClients() || !isEvictable) {
-            // We are still using the actor so we cannot remove it, or this actor cannot be evicted.
-            return false;
-          }
-
-          return (now - entry->getLastAccess()) > EXPIRATION;
-        });
-
-        co_await timer.afterDelay(EXPIRATION).eagerlyEvaluate(nullptr);
-      }
-    }
-
     // Implements actor loopback, which is used by websocket hibernation to deliver events to the
     // actor from the websocket's read loop.
     class Loopback: public Worker::Actor::Loopback, public kj::Refcounted {
@@ -2070,8 +3315,8 @@ class Server::WorkerService final: public Service,
               return GetActorResult{.actor = a->addRef(), .ref = ref.addRef()};
             }
             // We have an actor, but all the clients dropped their reference to the DO so we need
-            // make a new `ActorContainerRef`. Note that `hasClients()` will return true now,
-            // preventing cleanupLoop from evicting us.
+            // make a new `ActorContainerRef`. Note that `hasClients()` will return true now, and
+            // we're taken off the `removalWheel`.
             return GetActorResult{
               .actor = a->addRef(), .ref = kj::refcounted<ActorContainerRef>(*actorContainer)};
           }
@@ -2094,13 +3339,8 @@ class Server::WorkerService final: public Service,
 
                 auto db = kj::heap<SqliteDatabase>(*as,
                     kj::Path({d.uniqueKey, kj::str(idPtr, ".sqlite")}),
-                    kj::WriteMode::CREATE | kj::WriteMode::MODIFY | kj::WriteMode::CREATE_PARENT);
-
-                // Before we do anything, make sure the database is in WAL mode. We also need to
-                // do this after reset() is used, so register a callback for that.
-                auto setWalMode = [](SqliteDatabase& db) { db.run("PRAGMA journal_mode=WAL;"); };
-                setWalMode(*db);
-                db->afterReset(kj::mv(setWalMode));
+                    kj::WriteMode::CREATE | kj::WriteMode::MODIFY | kj::WriteMode::CREATE_PARENT,
+                    sqliteObserver);
 
                 return kj::heap<ActorSqlite>(kj::mv(db), outputGate,
                     []() -> kj::Promise<void> { return kj::READY_NOW; }, *sqliteHooks)
@@ -2135,6 +3375,13 @@ class Server::WorkerService final: public Service,
 
           auto loopback = kj::refcounted<Loopback>(*this, kj::str(idPtr));
 
+          kj::Own<ActorObserver> actorObserver;
+          KJ_IF_SOME(m, service.metrics) {
+            actorObserver = m.makeActorObserver();
+          } else {
+            actorObserver = kj::refcounted<ActorObserver>();
+          }
+
           return service.worker->runInLockScope(asyncLock, [&](Worker::Lock& lock) {
             // We define this event ID in the internal codebase, but to have WebSocket Hibernation
             // work for local development we need to pass an event type.
@@ -2143,8 +3390,9 @@ class Server::WorkerService final: public Service,
             actorContainer->actor.emplace(
                 kj::refcounted<Worker::Actor>(*service.worker, actorContainer->getTracker(),
                     kj::str(idPtr), true, kj::mv(makeActorCache), className, kj::mv(makeStorage),
-                    lock, kj::mv(loopback), timerChannel, kj::refcounted<ActorObserver>(),
+                    lock, kj::mv(loopback), timerChannel, kj::mv(actorObserver),
                     actorContainer->tryGetManagerRef(), hibernationEventTypeId));
+            actorContainer->actorCreated();
 
             // If the actor becomes broken, remove it from the map, so a new one will be created
             // next time.
@@ -2165,7 +3413,7 @@ class Server::WorkerService final: public Service,
               return GetActorResult{.actor = actorRef->addRef(), .ref = ref.addRef()};
             }
 
-            // `hasClients()` will return true now, preventing cleanupLoop from evicting us.
+            // `hasClients()` will return true now, and we're taken off the `removalWheel`.
             return GetActorResult{.actor = actorRef->addRef(),
               .ref = kj::refcounted<ActorContainerRef>(*actorContainer)};
           });
@@ -2209,6 +3457,12 @@ class Server::WorkerService final: public Service,
       return handlers.contains(handlerName);
     }
 
+    kj::Maybe<kj::Own<WorkerInterface>> startActorRequest(kj::StringPtr className,
+        kj::StringPtr id,
+        IoChannelFactory::SubrequestMetadata metadata) override {
+      return worker.startActorRequest(className, id, kj::mv(metadata));
+    }
+
    private:
     WorkerService& worker;
     kj::StringPtr entrypoint;
@@ -2220,12 +3474,135 @@ class Server::WorkerService final: public Service,
   // LinkedIoChannels owns the SqliteDatabase::Vfs, so make sure it is destroyed last.
   kj::OneOf<LinkCallback, LinkedIoChannels> ioChannels;
 
+  // Note that keeping several replicas of `worker` here would not help with lock contention: all
+  // isolates driven by one event loop already take turns through the same thread's AsyncLock
+  // queue, and a single isolate interleaves concurrent requests whenever they await I/O. To use
+  // more cores, serve on several threads instead (see `Config.threads`), each of which gets its
+  // own Worker for every service. Queue depth at lock time is reported to the isolate's observer
+  // via `IsolateObserver::LockTiming::reportAsyncInfo()`.
   kj::Own<const Worker> worker;
   kj::Maybe<kj::HashSet<kj::String>> defaultEntrypointHandlers;
   kj::HashMap<kj::String, EntrypointService> namedEntrypoints;
   kj::HashMap<kj::StringPtr, kj::Own<ActorNamespace>> actorNamespaces;
   kj::TaskSet waitUntilTasks;
   AbortActorsCallback abortActorsCallback;
+  kj::Maybe<ServerMetrics&> metrics;
+  const ActorMemoryLimits& actorMemoryLimits;
+  kj::Own<IsolateHeap> isolateHeap;
+
+  // Stands in for the worker while its isolate is near its heap limit; see `Worker.memoryLimit`.
+  class HeapLimitShedder final: public WorkerInterface {
+   public:
+    explicit HeapLimitShedder(const kj::HttpHeaderTable& headerTable): headerTable(headerTable) {}
+
+    kj::Promise<void> request(kj::HttpMethod method,
+        kj::StringPtr url,
+        const kj::HttpHeaders& headers,
+        kj::AsyncInputStream& requestBody,
+        kj::HttpService::Response& response) override {
+      return response.sendError(503, "Service Unavailable", headerTable);
+    }
+
+    kj::Promise<void> connect(kj::StringPtr host,
+        const kj::HttpHeaders& headers,
+        kj::AsyncIoStream& connection,
+        kj::HttpService::ConnectResponse& response,
+        kj::HttpConnectSettings settings) override {
+      return overloaded();
+    }
+
+    kj::Promise<void> prewarm(kj::StringPtr url) override {
+      return kj::READY_NOW;
+    }
+
+    kj::Promise<ScheduledResult> runScheduled(kj::Date scheduledTime, kj::StringPtr cron) override {
+      return overloaded();
+    }
+
+    kj::Promise<AlarmResult> runAlarm(kj::Date scheduledTime, uint32_t retryCount) override {
+      return overloaded();
+    }
+
+    kj::Promise<CustomEvent::Result> customEvent(kj::Own<CustomEvent> event) override {
+      return overloaded();
+    }
+
+   private:
+    const kj::HttpHeaderTable& headerTable;
+
+    static kj::Exception overloaded() {
+      return KJ_EXCEPTION(OVERLOADED, "Worker's isolate is near its heap limit.");
+    }
+  };
+
+  struct LazyState {
+    Lazy options;
+    // When getWorker() was last called.
+    kj::TimePoint lastUsed;
+    // Discards the worker once it has been idle for `options.idleTimeout`.
+    kj::Maybe<kj::Promise<void>> discardTask;
+  };
+  kj::Maybe<LazyState> lazy;
+
+  // Returns the worker, first rebuilding it if it's `lazy` and was discarded.
+  const Worker& getWorker() {
+    KJ_IF_SOME(state, lazy) {
+      state.lastUsed = threadContext.getUnsafeTimer().now();
+      if (worker.get() == nullptr) {
+        // The config was validated when the worker was first built, so errors here mean the
+        // script behaved differently this time. Fail the request, not the server.
+        struct RebuildErrorReporter final: public Worker::ValidationErrorReporter {
+          bool failed = false;
+          void addError(kj::String error) override {
+            KJ_LOG(ERROR, "error rebuilding lazy worker", error);
+            failed = true;
+          }
+          void addHandler(kj::Maybe<kj::StringPtr> exportName, kj::StringPtr type) override {}
+        };
+        RebuildErrorReporter errorReporter;
+        auto start = kj::systemPreciseMonotonicClock().now();
+        auto rebuilt = state.options.rebuild(errorReporter);
+        KJ_REQUIRE(!errorReporter.failed, "failed to rebuild lazy worker");
+        worker = kj::mv(rebuilt);
+        KJ_IF_SOME(m, metrics) {
+          m.lazyWorkerStartup.observe(kj::systemPreciseMonotonicClock().now() - start);
+        }
+        state.discardTask = discardWhenIdle(state).eagerlyEvaluate(
+            [](kj::Exception&& e) { KJ_LOG(ERROR, "discarding lazy worker failed", e); });
+      }
+    }
+    return *worker;
+  }
+
+  kj::Promise<void> discardWhenIdle(LazyState& state) {
+    auto& timer = threadContext.getUnsafeTimer();
+    for (;;) {
+      auto deadline = state.lastUsed + state.options.idleTimeout;
+      if (timer.now() < deadline) {
+        co_await timer.atTime(deadline);
+      } else if (worker->isShared()) {
+        // Requests or their waitUntil() tasks still hold the worker; check again later.
+        co_await timer.afterDelay(state.options.idleTimeout);
+      } else {
+        break;
+      }
+    }
+    worker = nullptr;
+  }
+
+  // Whether memory use is past one of the `actorMemoryLimits`.
+  bool isShortOfMemory() {
+    if (actorMemoryLimits.maxIsolateHeapBytes > 0 &&
+        isolateHeap->usedBytes > actorMemoryLimits.maxIsolateHeapBytes) {
+      return true;
+    }
+    if (actorMemoryLimits.maxResidentBytes > 0) {
+      KJ_IF_SOME(rss, getResidentBytes()) {
+        return rss > actorMemoryLimits.maxResidentBytes;
+      }
+    }
+    return false;
+  }
 
   class ActorChannelImpl final: public IoChannelFactory::ActorChannel {
    public:
@@ -2263,27 +3640,46 @@ class Server::WorkerService final: public Service,
   }
   class CacheClientImpl final: public CacheClient {
    public:
-    CacheClientImpl(Service& cacheService, kj::HttpHeaderId cacheNamespaceHeader)
+    CacheClientImpl(Service& cacheService,
+        kj::HttpHeaderId cacheNamespaceHeader,
+        kj::Maybe<LocalCacheTier&> localCache)
         : cacheService(cacheService),
-          cacheNamespaceHeader(cacheNamespaceHeader) {}
+          cacheNamespaceHeader(cacheNamespaceHeader),
+          localCache(localCache) {}
 
     kj::Own<kj::HttpClient> getDefault(
         kj::Maybe<kj::String> cfBlobJson, SpanParent parentSpan) override {
-
-      return kj::heap<CacheHttpClientImpl>(
-          cacheService, cacheNamespaceHeader, kj::none, kj::mv(cfBlobJson), kj::mv(parentSpan));
+      return makeClient(kj::none, kj::mv(cfBlobJson), kj::mv(parentSpan));
     }
 
     kj::Own<kj::HttpClient> getNamespace(
         kj::StringPtr cacheName, kj::Maybe<kj::String> cfBlobJson, SpanParent parentSpan) override {
       auto encodedName = kj::encodeUriComponent(cacheName);
-      return kj::heap<CacheHttpClientImpl>(cacheService, cacheNamespaceHeader, kj::mv(encodedName),
-          kj::mv(cfBlobJson), kj::mv(parentSpan));
+      return makeClient(kj::mv(encodedName), kj::mv(cfBlobJson), kj::mv(parentSpan));
     }
 
    private:
     Service& cacheService;
     kj::HttpHeaderId cacheNamespaceHeader;
+    kj::Maybe<LocalCacheTier&> localCache;
+
+    kj::Own<kj::HttpClient> makeClient(kj::Maybe<kj::String> cacheName,
+        kj::Maybe<kj::String> cfBlobJson,
+        SpanParent parentSpan) {
+      KJ_IF_SOME(tier, localCache) {
+        // Only connect to the cache service once the local tier can't answer a request.
+        auto name = cacheName.map([](kj::String& n) { return kj::str(n); });
+        return tier.wrap(kj::mv(name),
+            [&cacheService = cacheService, cacheNamespaceHeader = cacheNamespaceHeader,
+                cacheName = kj::mv(cacheName), cfBlobJson = kj::mv(cfBlobJson),
+                parentSpan = kj::mv(parentSpan)]() mutable -> kj::Own<kj::HttpClient> {
+          return kj::heap<CacheHttpClientImpl>(cacheService, cacheNamespaceHeader,
+              kj::mv(cacheName), kj::mv(cfBlobJson), kj::mv(parentSpan));
+        });
+      }
+      return kj::heap<CacheHttpClientImpl>(cacheService, cacheNamespaceHeader, kj::mv(cacheName),
+          kj::mv(cfBlobJson), kj::mv(parentSpan));
+    }
   };
 
   class CacheHttpClientImpl final: public kj::HttpClient {
@@ -2326,7 +3722,12 @@ class Server::WorkerService final: public Service,
     auto& channels =
         KJ_REQUIRE_NONNULL(ioChannels.tryGet<LinkedIoChannels>(), "link() has not been called");
     auto& cache = JSG_REQUIRE_NONNULL(channels.cache, Error, "No Cache was configured");
-    return kj::heap<CacheClientImpl>(cache, threadContext.getHeaderIds().cfCacheNamespace);
+    kj::Maybe<LocalCacheTier&> localCache;
+    KJ_IF_SOME(tier, channels.localCache) {
+      localCache = *tier;
+    }
+    return kj::heap<CacheClientImpl>(
+        cache, threadContext.getHeaderIds().cfCacheNamespace, localCache);
   }
 
   TimerChannel& getTimer() override {
@@ -2335,38 +3736,54 @@ class Server::WorkerService final: public Service,
 
   kj::Promise<void> writeLogfwdr(
       uint channel, kj::FunctionParam<void(capnp::AnyPointer::Builder)> buildMessage) override {
+    return writeLogfwdrBatch(channel, 1, [&](uint, capnp::AnyPointer::Builder ptr) {
+      buildMessage(ptr);
+    });
+  }
+
+  kj::Promise<void> writeLogfwdrBatch(uint channel,
+      uint count,
+      kj::FunctionParam<void(uint index, capnp::AnyPointer::Builder)> buildMessage) override {
     auto& context = IoContext::current();
 
-    auto headers = kj::HttpHeaders(context.getHeaderTable());
     auto client = context.getHttpClient(channel, true, kj::none, "writeLogfwdr"_kjc);
 
     auto urlStr = kj::str("https://fake-host");
 
-    capnp::MallocMessageBuilder requestMessage;
-    auto requestBuilder = requestMessage.initRoot<capnp::AnyPointer>();
-
-    buildMessage(requestBuilder);
+    // Every message must be built before we return, so encode them all up front.
     capnp::JsonCodec json;
-    auto requestJson = json.encode(requestBuilder.getAs<api::AnalyticsEngineEvent>());
+    auto requestJsonsBuilder = kj::heapArrayBuilder<kj::String>(count);
+    for (auto i: kj::zeroTo(count)) {
+      capnp::MallocMessageBuilder requestMessage;
+      auto requestBuilder = requestMessage.initRoot<capnp::AnyPointer>();
+      buildMessage(i, requestBuilder);
+      requestJsonsBuilder.add(json.encode(requestBuilder.getAs<api::AnalyticsEngineEvent>()));
+    }
+    auto requestJsons = requestJsonsBuilder.finish();
 
     co_await context.waitForOutputLocks();
 
-    auto innerReq = client->request(kj::HttpMethod::POST, urlStr, headers, requestJson.size());
-
     struct RefcountedWrapper: public kj::Refcounted {
       explicit RefcountedWrapper(kj::Own<kj::HttpClient> client): client(kj::mv(client)) {}
       kj::Own<kj::HttpClient> client;
     };
     auto rcClient = kj::refcounted<RefcountedWrapper>(kj::mv(client));
-    auto request = attachToRequest(kj::mv(innerReq), kj::mv(rcClient));
 
-    co_await request.body->write(requestJson.asBytes())
-        .attach(kj::mv(requestJson), kj::mv(request.body));
-    auto response = co_await request.response;
+    // The messages share one client, so a batch goes out over a single connection rather than
+    // opening one per message.
+    for (auto& requestJson: requestJsons) {
+      auto headers = kj::HttpHeaders(context.getHeaderTable());
+      auto innerReq =
+          rcClient->client->request(kj::HttpMethod::POST, urlStr, headers, requestJson.size());
+      auto request = attachToRequest(kj::mv(innerReq), kj::addRef(*rcClient));
 
-    KJ_REQUIRE(response.statusCode >= 200 && response.statusCode < 300,
-        "writeLogfwdr request returned an error");
-    co_await response.body->readAllBytes().attach(kj::mv(response.body)).ignoreResult();
+      co_await request.body->write(requestJson.asBytes()).attach(kj::mv(request.body));
+      auto response = co_await request.response;
+
+      KJ_REQUIRE(response.statusCode >= 200 && response.statusCode < 300,
+          "writeLogfwdr request returned an error");
+      co_await response.body->readAllBytes().attach(kj::mv(response.body)).ignoreResult();
+    }
     co_return;
   }
 
@@ -2430,6 +3847,16 @@ class Server::WorkerService final: public Service,
   // No limits are enforced.
 
   kj::Own<void> enterJs(jsg::Lock& lock, IoContext& context) override {
+    // Nothing is limited, but the request's observer may want to know how much CPU time its
+    // JavaScript used.
+    KJ_IF_SOME(observer, context.tryGetMetrics()) {
+      if (observer.wantsJsTiming()) {
+        return kj::heap(kj::defer([observer = kj::addRef(observer),
+                                      start = ThreadPool::threadCpuTime()]() mutable {
+          observer->jsExecuted(ThreadPool::threadCpuTime() - start);
+        }));
+      }
+    }
     return {};
   }
   void topUpActor() override {}
@@ -2778,6 +4205,7 @@ static kj::Maybe<WorkerdApi::Global> createBinding(kj::StringPtr workerName,
       cacheCopy.maxKeys = limits.getMaxKeys();
       cacheCopy.maxValueSize = limits.getMaxValueSize();
       cacheCopy.maxTotalValueSize = limits.getMaxTotalValueSize();
+      cacheCopy.shareDeserializedValues = cache.getShareDeserializedValues();
       return makeGlobal(kj::mv(cacheCopy));
     }
   }
@@ -2860,9 +4288,10 @@ kj::Own<Server::Service> Server::makeWorker(kj::StringPtr name,
 
   ErrorReporter errorReporter(*this, name);
 
-  capnp::MallocMessageBuilder arena;
+  // On the heap because a `lazy` worker needs the flags again whenever its isolate is rebuilt.
+  auto arena = kj::heap<capnp::MallocMessageBuilder>();
   // TODO(beta): Factor out FeatureFlags from WorkerBundle.
-  auto featureFlags = arena.initRoot<CompatibilityFlags>();
+  auto featureFlags = arena->initRoot<CompatibilityFlags>();
 
   if (conf.hasCompatibilityDate()) {
     compileCompatibilityFlags(conf.getCompatibilityDate(), conf.getCompatibilityFlags(),
@@ -2871,13 +4300,50 @@ kj::Own<Server::Service> Server::makeWorker(kj::StringPtr name,
     errorReporter.addError(kj::str("Worker must specify compatibilityDate."));
   }
 
-  // IsolateLimitEnforcer that enforces no limits.
-  class NullIsolateLimitEnforcer final: public IsolateLimitEnforcer {
+  // IsolateLimitEnforcer that enforces no limits other than `Worker.memoryLimit`.
+  class HeapLimitEnforcer final: public IsolateLimitEnforcer {
    public:
+    HeapLimitEnforcer(kj::Maybe<ServerMetrics&> metrics,
+        bool sampleHeap,
+        config::Worker::MemoryLimit::Reader memoryLimit,
+        kj::Own<WorkerService::IsolateHeap> heap)
+        : metrics(metrics),
+          maxHeapBytes(memoryLimit.getMaxHeapBytes()),
+          shedHeapBytes(maxHeapBytes / 100 * memoryLimit.getShedPercent()),
+          sampleHeap(sampleHeap || metrics != kj::none || maxHeapBytes > 0),
+          ownHeap(kj::mv(heap)),
+          heap(*ownHeap) {
+      KJ_IF_SOME(m, heap.metrics) {
+        m.heapLimitBytes.add(static_cast<int64_t>(maxHeapBytes));
+      }
+    }
+    ~HeapLimitEnforcer() noexcept(false) {
+      auto reported = static_cast<int64_t>(heap.usedBytes);
+      KJ_IF_SOME(m, metrics) {
+        m.isolateHeapBytes.add(-reported);
+      }
+      KJ_IF_SOME(m, heap.metrics) {
+        m.heapBytes.add(-reported);
+        m.heapLimitBytes.add(-static_cast<int64_t>(maxHeapBytes));
+      }
+      heap.usedBytes = 0;
+      heap.nearLimit = false;
+    }
+
     v8::Isolate::CreateParams getCreateParams() override {
-      return {};
+      v8::Isolate::CreateParams params;
+      if (maxHeapBytes > 0) {
+        params.constraints.ConfigureDefaultsFromHeapSize(0, maxHeapBytes);
+      }
+      return params;
+    }
+    void customizeIsolate(v8::Isolate* isolate) override {
+      if (maxHeapBytes > 0) {
+        isolate->AddNearHeapLimitCallback(&nearHeapLimit, this);
+        // Takes back the headroom nearHeapLimit() hands out once the heap is below half the limit.
+        isolate->AutomaticallyRestoreInitialHeapLimit();
+      }
     }
-    void customizeIsolate(v8::Isolate* isolate) override {}
     ActorCacheSharedLruOptions getActorCacheLruOptions() override {
       // TODO(someday): Make this configurable?
       return {.softLimit = 16 * (1ull << 20),  // 16 MiB
@@ -2912,237 +4378,351 @@ kj::Own<Server::Service> Server::makeWorker(kj::StringPtr name,
     }
     void completedRequest(kj::StringPtr id) const override {}
     bool exitJs(jsg::Lock& lock) const override {
+      if (sampleHeap) {
+        if (collectGarbage) {
+          // The heap limit was reached. Collect now, so that requests stop being shed as soon as
+          // the terminated JavaScript's garbage is gone.
+          collectGarbage = false;
+          lock.v8Isolate->LowMemoryNotification();
+        }
+        // This is where the isolate is locked and idle, so it's a good time to sample its heap
+        // for the metrics, for shedding and for `Config.actorMemory`.
+        sampleHeapUsage(lock);
+      }
       return false;
     }
+    void isolateIdle(jsg::Lock& lock) const override {
+      if (maxHeapBytes == 0 || heap.usedBytes <= maxHeapBytes / 2) return;
+      lock.v8Isolate->LowMemoryNotification();
+      KJ_IF_SOME(m, heap.metrics) {
+        m.idleCollections.add();
+      }
+      sampleHeapUsage(lock);
+    }
     void reportMetrics(IsolateObserver& isolateMetrics) const override {}
     kj::Maybe<size_t> checkPbkdfIterations(jsg::Lock& lock, size_t iterations) const override {
       // No limit on the number of iterations in workerd
       return kj::none;
     }
+
+   private:
+    kj::Maybe<ServerMetrics&> metrics;
+    size_t maxHeapBytes;
+    size_t shedHeapBytes;
+    bool sampleHeap;
+    kj::Own<WorkerService::IsolateHeap> ownHeap;
+    // `usedBytes` is also this isolate's share of `ServerMetrics::isolateHeapBytes`.
+    WorkerService::IsolateHeap& heap;
+    // Set by nearHeapLimit(), for the next exitJs().
+    mutable bool collectGarbage = false;
+
+    void sampleHeapUsage(jsg::Lock& lock) const {
+      v8::HeapStatistics stats;
+      lock.v8Isolate->GetHeapStatistics(&stats);
+      auto delta =
+          static_cast<int64_t>(stats.used_heap_size()) - static_cast<int64_t>(heap.usedBytes);
+      KJ_IF_SOME(m, metrics) {
+        m.isolateHeapBytes.add(delta);
+      }
+      KJ_IF_SOME(m, heap.metrics) {
+        m.heapBytes.add(delta);
+      }
+      heap.usedBytes = stats.used_heap_size();
+      heap.nearLimit = maxHeapBytes > 0 && heap.usedBytes > shedHeapBytes;
+    }
+
+    // V8 calls this when a garbage collection can't get the heap back under its limit. Returning
+    // the same limit would abort the whole process, so instead the JavaScript that filled the heap
+    // is terminated, and V8 gets a quarter of the limit again as headroom to finish up. Only if it
+    // keeps running into the limit after doubling it is the process aborted after all.
+    static size_t nearHeapLimit(void* data, size_t currentLimit, size_t initialLimit) {
+      auto& self = *static_cast<HeapLimitEnforcer*>(data);
+      v8::Isolate::GetCurrent()->TerminateExecution();
+      self.heap.nearLimit = true;
+      self.collectGarbage = true;
+      KJ_IF_SOME(m, self.heap.metrics) {
+        m.heapLimitReached.add();
+      }
+      KJ_LOG(WARNING, "isolate reached its heap limit; terminating its JavaScript", initialLimit);
+      if (currentLimit >= initialLimit * 2) return currentLimit;
+      return currentLimit + initialLimit / 4;
+    }
   };
 
-  auto jsgobserver = kj::atomicRefcounted<JsgIsolateObserver>();
-  auto observer = kj::atomicRefcounted<IsolateObserver>();
-  auto limitEnforcer = kj::refcounted<NullIsolateLimitEnforcer>();
+  kj::Vector<FutureSubrequestChannel> subrequestChannels;
+  kj::Vector<FutureActorChannel> actorChannels;
 
-  kj::Maybe<kj::Own<jsg::modules::ModuleRegistry>> newModuleRegistry;
-  if (featureFlags.getNewModuleRegistry()) {
-    KJ_REQUIRE(experimental,
-        "The new ModuleRegistry implementation is an experimental feature. "
-        "You must run workerd with `--experimental` to use this feature.");
-    newModuleRegistry = WorkerdApi::initializeBundleModuleRegistry(
-        *jsgobserver, conf, featureFlags.asReader(), pythonConfig);
+  auto confBindings = conf.getBindings();
+  using Global = WorkerdApi::Global;
+  kj::Vector<Global> globals(confBindings.size());
+  for (auto binding: confBindings) {
+    KJ_IF_SOME(global,
+        createBinding(name, conf, binding, errorReporter, subrequestChannels, actorChannels,
+            actorConfigs, experimental)) {
+      globals.add(kj::mv(global));
+    }
   }
 
-  auto api = kj::heap<WorkerdApi>(globalContext->v8System, featureFlags.asReader(),
-      limitEnforcer->getCreateParams(), kj::mv(jsgobserver), *memoryCacheProvider, pythonConfig,
-      kj::mv(newModuleRegistry));
-  auto inspectorPolicy = Worker::Isolate::InspectorPolicy::DISALLOW;
-  if (inspectorOverride != kj::none) {
-    // For workerd, if the inspector is enabled, it is always fully trusted.
-    inspectorPolicy = Worker::Isolate::InspectorPolicy::ALLOW_FULLY_TRUSTED;
+  if (conf.getMemoryLimit().getShedPercent() > 100) {
+    errorReporter.addError(kj::str("`memoryLimit.shedPercent` can't be more than 100."));
   }
-  auto isolate = kj::atomicRefcounted<Worker::Isolate>(kj::mv(api), kj::mv(observer), name,
-      kj::mv(limitEnforcer), inspectorPolicy,
-      conf.isServiceWorkerScript() ? Worker::ConsoleMode::INSPECTOR_ONLY : consoleMode);
 
-  // If we are using the inspector, we need to register the Worker::Isolate
-  // with the inspector service.
-  KJ_IF_SOME(isolateRegistrar, inspectorIsolateRegistrar) {
-    isolateRegistrar->registerIsolate(name, isolate.get());
-  }
-
-  if (conf.hasModuleFallback()) {
-    KJ_REQUIRE(experimental,
-        "The module fallback service is an experimental feature. "
-        "You must run workerd with `--experimental` to use this feature.");
-    // If the config has the moduleFallback option, then we are going to set up the ability
-    // to load certain modules from a fallback service. This is generally intended for local
-    // dev/testing purposes only.
-    auto& apiIsolate = isolate->getApi();
-    apiIsolate.setModuleFallbackCallback(
-        [address = kj::str(conf.getModuleFallback()), featureFlags = apiIsolate.getFeatureFlags()](
-            jsg::Lock& js, kj::StringPtr specifier, kj::Maybe<kj::String> referrer,
-            jsg::CompilationObserver& observer, jsg::ModuleRegistry::ResolveMethod method,
-            kj::Maybe<kj::StringPtr> rawSpecifier) mutable
-        -> kj::Maybe<kj::OneOf<kj::String, jsg::ModuleRegistry::ModuleInfo>> {
-      kj::Maybe<kj::String> jsonPayload;
-      bool redirect = false;
-      bool prefixed = false;
-      kj::Url url;
-      kj::StringPtr actualSpecifier = nullptr;
-      // TODO(cleanup): This is a bit of a hack based on the current
-      // design of the module registry loader algorithms handling of
-      // prefixed modules. This will be simplified with the upcoming
-      // module registry refactor.
-      KJ_IF_SOME(pos, specifier.findLast('/')) {
-        auto segment = specifier.slice(pos + 1);
-        if (segment.startsWith("node:") || segment.startsWith("cloudflare:") ||
-            segment.startsWith("workerd:")) {
-          actualSpecifier = segment;
-          url.query.add(
-              kj::Url::QueryParam{.name = kj::str("specifier"), .value = kj::str(segment)});
-          prefixed = true;
+  // Kept across isolates, since a `lazy` worker builds a new one whenever it's needed again. Owned
+  // by the WorkerService, which also owns `newWorker`.
+  auto isolateHeap = kj::refcounted<WorkerService::IsolateHeap>();
+  KJ_IF_SOME(m, metrics) {
+    if (conf.getMemoryLimit().getMaxHeapBytes() > 0) {
+      isolateHeap->metrics = m.getIsolateMemory(name);
+    }
+  }
+
+  bool lazy = conf.getLazy() && inspectorOverride == kj::none;
+  if (lazy && conf.getDurableObjectNamespaces().size() > 0) {
+    errorReporter.addError(
+        kj::str("Workers that define Durable Object namespaces can't be `lazy`."));
+    lazy = false;
+  }
+
+  // Builds the isolate, compiles the script and evaluates it. A `lazy` worker does this again
+  // whenever a request arrives after its isolate was discarded.
+  auto newWorker = [this, name, conf, extensions, featureFlags = featureFlags.asReader(),
+                        arena = kj::mv(arena), globals = globals.releaseAsArray(),
+                        &isolateHeap = *isolateHeap](
+                        Worker::ValidationErrorReporter& errorReporter) -> kj::Own<const Worker> {
+    // Startup time breakdown, logged with --verbose once the worker is constructed.
+    auto& clock = kj::systemPreciseMonotonicClock();
+    auto startTime = clock.now();
+
+    auto jsgobserver = kj::atomicRefcounted<JsgIsolateObserver>();
+    kj::Own<IsolateObserver> observer;
+    KJ_IF_SOME(m, metrics) {
+      observer = m.makeIsolateObserver();
+    } else {
+      observer = kj::atomicRefcounted<IsolateObserver>();
+    }
+    auto limitEnforcer = kj::refcounted<HeapLimitEnforcer>(metrics,
+        actorMemoryLimits.maxIsolateHeapBytes > 0, conf.getMemoryLimit(),
+        kj::addRef(isolateHeap));
+
+    kj::Maybe<kj::Own<jsg::modules::ModuleRegistry>> newModuleRegistry;
+    if (featureFlags.getNewModuleRegistry()) {
+      KJ_REQUIRE(experimental,
+          "The new ModuleRegistry implementation is an experimental feature. "
+          "You must run workerd with `--experimental` to use this feature.");
+      newModuleRegistry = WorkerdApi::initializeBundleModuleRegistry(
+          *jsgobserver, conf, featureFlags, pythonConfig);
+    }
+
+    auto api = kj::heap<WorkerdApi>(globalContext->v8System, featureFlags,
+        limitEnforcer->getCreateParams(), kj::mv(jsgobserver), *memoryCacheProvider, pythonConfig,
+        kj::mv(newModuleRegistry), *moduleCodeCache);
+    auto inspectorPolicy = Worker::Isolate::InspectorPolicy::DISALLOW;
+    if (inspectorOverride != kj::none) {
+      // For workerd, if the inspector is enabled, it is always fully trusted.
+      inspectorPolicy = Worker::Isolate::InspectorPolicy::ALLOW_FULLY_TRUSTED;
+    }
+    auto isolate = kj::atomicRefcounted<Worker::Isolate>(kj::mv(api), kj::mv(observer), name,
+        kj::mv(limitEnforcer), inspectorPolicy,
+        conf.isServiceWorkerScript() ? Worker::ConsoleMode::INSPECTOR_ONLY : consoleMode);
+
+    // If we are using the inspector, we need to register the Worker::Isolate
+    // with the inspector service.
+    KJ_IF_SOME(isolateRegistrar, inspectorIsolateRegistrar) {
+      isolateRegistrar->registerIsolate(name, isolate.get());
+    }
+    if (controlInput != kj::none) {
+      controlIsolates.upsert(kj::str(name), isolate->getWeakRef());
+    }
+
+    if (conf.hasModuleFallback()) {
+      KJ_REQUIRE(experimental,
+          "The module fallback service is an experimental feature. "
+          "You must run workerd with `--experimental` to use this feature.");
+      // If the config has the moduleFallback option, then we are going to set up the ability
+      // to load certain modules from a fallback service. This is generally intended for local
+      // dev/testing purposes only.
+      auto& apiIsolate = isolate->getApi();
+      apiIsolate.setModuleFallbackCallback(
+          [address = kj::str(conf.getModuleFallback()),
+              featureFlags = apiIsolate.getFeatureFlags()](jsg::Lock& js, kj::StringPtr specifier,
+              kj::Maybe<kj::String> referrer, jsg::CompilationObserver& observer,
+              jsg::ModuleRegistry::ResolveMethod method,
+              kj::Maybe<kj::StringPtr> rawSpecifier) mutable
+          -> kj::Maybe<kj::OneOf<kj::String, jsg::ModuleRegistry::ModuleInfo>> {
+        kj::Maybe<kj::String> jsonPayload;
+        bool redirect = false;
+        bool prefixed = false;
+        kj::Url url;
+        kj::StringPtr actualSpecifier = nullptr;
+        // TODO(cleanup): This is a bit of a hack based on the current
+        // design of the module registry loader algorithms handling of
+        // prefixed modules. This will be simplified with the upcoming
+        // module registry refactor.
+        KJ_IF_SOME(pos, specifier.findLast('/')) {
+          auto segment = specifier.slice(pos + 1);
+          if (segment.startsWith("node:") || segment.startsWith("cloudflare:") ||
+              segment.startsWith("workerd:")) {
+            actualSpecifier = segment;
+            url.query.add(
+                kj::Url::QueryParam{.name = kj::str("specifier"), .value = kj::str(segment)});
+            prefixed = true;
+          }
         }
-      }
-      if (!prefixed) {
-        actualSpecifier = specifier;
-        if (actualSpecifier.startsWith("/")) {
-          actualSpecifier = specifier.slice(1);
+        if (!prefixed) {
+          actualSpecifier = specifier;
+          if (actualSpecifier.startsWith("/")) {
+            actualSpecifier = specifier.slice(1);
+          }
+          url.query.add(kj::Url::QueryParam{kj::str("specifier"), kj::str(specifier)});
+        }
+        KJ_IF_SOME(ref, referrer) {
+          url.query.add(kj::Url::QueryParam{kj::str("referrer"), kj::mv(ref)});
+        }
+        KJ_IF_SOME(raw, rawSpecifier) {
+          url.query.add(kj::Url::QueryParam{kj::str("rawSpecifier"), kj::str(raw)});
         }
-        url.query.add(kj::Url::QueryParam{kj::str("specifier"), kj::str(specifier)});
-      }
-      KJ_IF_SOME(ref, referrer) {
-        url.query.add(kj::Url::QueryParam{kj::str("referrer"), kj::mv(ref)});
-      }
-      KJ_IF_SOME(raw, rawSpecifier) {
-        url.query.add(kj::Url::QueryParam{kj::str("rawSpecifier"), kj::str(raw)});
-      }
 
-      auto spec = url.toString(kj::Url::HTTP_REQUEST);
+        auto spec = url.toString(kj::Url::HTTP_REQUEST);
 
-      {
-        // Module loading in workerd is expected to be synchronous but we need to perform
-        // an async HTTP request to the fallback service. To accomplish that we wrap the
-        // actual request in a kj::Thread, perform the GET, and drop the thread immediately
-        // so that the destructor joins the current thread (blocking it). The thread will
-        // either set the jsonPayload variable or not.
-        kj::Thread loaderThread([&spec, referrer = kj::mv(referrer), address = address.asPtr(),
-                                    &jsonPayload, &redirect, method]() mutable {
-          try {
-            const auto toStr = [](jsg::ModuleRegistry::ResolveMethod method) {
-              switch (method) {
-                case jsg::ModuleRegistry::ResolveMethod::IMPORT:
-                  return "import"_kjc;
-                case jsg::ModuleRegistry::ResolveMethod::REQUIRE:
-                  return "require"_kjc;
-              }
-              KJ_UNREACHABLE;
-            };
+        {
+          // Module loading in workerd is expected to be synchronous but we need to perform
+          // an async HTTP request to the fallback service. To accomplish that we wrap the
+          // actual request in a kj::Thread, perform the GET, and drop the thread immediately
+          // so that the destructor joins the current thread (blocking it). The thread will
+          // either set the jsonPayload variable or not.
+          kj::Thread loaderThread([&spec, referrer = kj::mv(referrer), address = address.asPtr(),
+                                      &jsonPayload, &redirect, method]() mutable {
+            try {
+              const auto toStr = [](jsg::ModuleRegistry::ResolveMethod method) {
+                switch (method) {
+                  case jsg::ModuleRegistry::ResolveMethod::IMPORT:
+                    return "import"_kjc;
+                  case jsg::ModuleRegistry::ResolveMethod::REQUIRE:
+                    return "require"_kjc;
+                }
+                KJ_UNREACHABLE;
+              };
 
-            kj::AsyncIoContext io = kj::setupAsyncIo();
+              kj::AsyncIoContext io = kj::setupAsyncIo();
 
-            kj::HttpHeaderTable::Builder builder;
-            kj::HttpHeaderId kMethod = builder.add("x-resolve-method");
-            auto headerTable = builder.build();
+              kj::HttpHeaderTable::Builder builder;
+              kj::HttpHeaderId kMethod = builder.add("x-resolve-method");
+              auto headerTable = builder.build();
 
-            auto addr = io.provider->getNetwork().parseAddress(address, 80).wait(io.waitScope);
+              auto addr = io.provider->getNetwork().parseAddress(address, 80).wait(io.waitScope);
 
-            auto client = kj::newHttpClient(io.provider->getTimer(), *headerTable, *addr, {});
+              auto client = kj::newHttpClient(io.provider->getTimer(), *headerTable, *addr, {});
 
-            kj::HttpHeaders headers(*headerTable);
-            headers.set(kMethod, toStr(method));
-            headers.set(kj::HttpHeaderId::HOST, "localhost"_kj);
+              kj::HttpHeaders headers(*headerTable);
+              headers.set(kMethod, toStr(method));
+              headers.set(kj::HttpHeaderId::HOST, "localhost"_kj);
 
-            auto request = client->request(kj::HttpMethod::GET, spec, headers, kj::none);
+              auto request = client->request(kj::HttpMethod::GET, spec, headers, kj::none);
 
-            kj::HttpClient::Response resp = request.response.wait(io.waitScope);
+              kj::HttpClient::Response resp = request.response.wait(io.waitScope);
 
-            if (resp.statusCode == 301) {
-              // The fallback service responded with a redirect.
-              KJ_IF_SOME(loc, resp.headers->get(kj::HttpHeaderId::LOCATION)) {
-                redirect = true;
-                jsonPayload = kj::str(loc);
+              if (resp.statusCode == 301) {
+                // The fallback service responded with a redirect.
+                KJ_IF_SOME(loc, resp.headers->get(kj::HttpHeaderId::LOCATION)) {
+                  redirect = true;
+                  jsonPayload = kj::str(loc);
+                } else {
+                  KJ_LOG(ERROR, "Fallback service returned a redirect with no location", spec);
+                }
+              } else if (resp.statusCode != 200) {
+                // Failed! Log the body of the respnose, if any, and fall through without
+                // setting jsonPayload to signal that the fallback service failed to return
+                // a module for this specifier.
+                auto payload = resp.body->readAllText().wait(io.waitScope);
+                KJ_LOG(ERROR, "Fallback service failed to fetch module", payload, spec);
               } else {
-                KJ_LOG(ERROR, "Fallback service returned a redirect with no location", spec);
+                jsonPayload = resp.body->readAllText().wait(io.waitScope);
               }
-            } else if (resp.statusCode != 200) {
-              // Failed! Log the body of the respnose, if any, and fall through without
-              // setting jsonPayload to signal that the fallback service failed to return
-              // a module for this specifier.
-              auto payload = resp.body->readAllText().wait(io.waitScope);
-              KJ_LOG(ERROR, "Fallback service failed to fetch module", payload, spec);
-            } else {
-              jsonPayload = resp.body->readAllText().wait(io.waitScope);
+            } catch (...) {
+              auto exception = kj::getCaughtExceptionAsKj();
+              KJ_LOG(ERROR, "Fallback service failed to fetch module", exception, spec);
             }
-          } catch (...) {
-            auto exception = kj::getCaughtExceptionAsKj();
-            KJ_LOG(ERROR, "Fallback service failed to fetch module", exception, spec);
-          }
-        });
-      }
+          });
+        }
 
-      KJ_IF_SOME(payload, jsonPayload) {
-        // If the payload is empty then the fallback service failed to fetch the module.
-        if (payload.size() == 0) return kj::none;
+        KJ_IF_SOME(payload, jsonPayload) {
+          // If the payload is empty then the fallback service failed to fetch the module.
+          if (payload.size() == 0) return kj::none;
 
-        // If redirect is true then the fallback service returned a 301 redirect. The
-        // payload is the specifier of the new target module.
-        if (redirect) {
-          return kj::Maybe(kj::mv(payload));
-        }
+          // If redirect is true then the fallback service returned a 301 redirect. The
+          // payload is the specifier of the new target module.
+          if (redirect) {
+            return kj::Maybe(kj::mv(payload));
+          }
 
-        // The response from the fallback service must be a valid JSON serialization
-        // of the workerd module configuration. If it is not, or if there is any other
-        // error when processing here, we'll log the exception and return nothing.
-        try {
-          capnp::MallocMessageBuilder moduleMessage;
-          capnp::JsonCodec json;
-          json.handleByAnnotation<config::Worker::Module>();
-          auto moduleBuilder = moduleMessage.initRoot<config::Worker::Module>();
-          json.decode(payload, moduleBuilder);
-
-          // If the module fallback service returns a name in the module then it has to
-          // match the specifier we passed in. This is an optional sanity check.
-          if (moduleBuilder.hasName()) {
-            if (moduleBuilder.getName() != actualSpecifier) {
-              KJ_LOG(ERROR,
-                  "Fallback service failed to fetch module: returned module "
-                  "name does not match specifier",
-                  moduleBuilder.getName(), actualSpecifier);
-              return kj::none;
+          // The response from the fallback service must be a valid JSON serialization
+          // of the workerd module configuration. If it is not, or if there is any other
+          // error when processing here, we'll log the exception and return nothing.
+          try {
+            capnp::MallocMessageBuilder moduleMessage;
+            capnp::JsonCodec json;
+            json.handleByAnnotation<config::Worker::Module>();
+            auto moduleBuilder = moduleMessage.initRoot<config::Worker::Module>();
+            json.decode(payload, moduleBuilder);
+
+            // If the module fallback service returns a name in the module then it has to
+            // match the specifier we passed in. This is an optional sanity check.
+            if (moduleBuilder.hasName()) {
+              if (moduleBuilder.getName() != actualSpecifier) {
+                KJ_LOG(ERROR,
+                    "Fallback service failed to fetch module: returned module "
+                    "name does not match specifier",
+                    moduleBuilder.getName(), actualSpecifier);
+                return kj::none;
+              }
+            } else {
+              moduleBuilder.setName(kj::str(actualSpecifier));
             }
-          } else {
-            moduleBuilder.setName(kj::str(actualSpecifier));
-          }
 
-          auto module = WorkerdApi::tryCompileModule(js, moduleBuilder, observer, featureFlags);
-          if (module == kj::none) {
-            KJ_LOG(
-                ERROR, "Fallback service does not support this module type", moduleBuilder.which());
+            auto module = WorkerdApi::tryCompileModule(js, moduleBuilder, observer, featureFlags);
+            if (module == kj::none) {
+              KJ_LOG(ERROR, "Fallback service does not support this module type",
+                  moduleBuilder.which());
+            }
+            return module;
+          } catch (...) {
+            auto exception = kj::getCaughtExceptionAsKj();
+            KJ_LOG(ERROR, "Fallback service failed to fetch module", exception, spec);
+            return kj::none;
           }
-          return module;
-        } catch (...) {
-          auto exception = kj::getCaughtExceptionAsKj();
-          KJ_LOG(ERROR, "Fallback service failed to fetch module", exception, spec);
-          return kj::none;
         }
-      }
 
-      // If we got here, no jsonPayload was received and we return nothing.
-      return kj::none;
-    });
-  }
-
-  auto script =
-      isolate->newScript(name, WorkerdApi::extractSource(name, conf, errorReporter, extensions),
-          IsolateObserver::StartType::COLD, false, errorReporter);
-
-  kj::Vector<FutureSubrequestChannel> subrequestChannels;
-  kj::Vector<FutureActorChannel> actorChannels;
+        // If we got here, no jsonPayload was received and we return nothing.
+        return kj::none;
+      });
+    }
 
-  auto confBindings = conf.getBindings();
-  using Global = WorkerdApi::Global;
-  kj::Vector<Global> globals(confBindings.size());
-  for (auto binding: confBindings) {
-    KJ_IF_SOME(global,
-        createBinding(name, conf, binding, errorReporter, subrequestChannels, actorChannels,
-            actorConfigs, experimental)) {
-      globals.add(kj::mv(global));
+    auto isolateTime = clock.now();
+    auto script =
+        isolate->newScript(name, WorkerdApi::extractSource(name, conf, errorReporter, extensions),
+            IsolateObserver::StartType::COLD, false, errorReporter);
+    auto compileTime = clock.now();
+
+    auto worker = kj::atomicRefcounted<Worker>(kj::mv(script),
+        kj::atomicRefcounted<WorkerObserver>(),
+        [&](jsg::Lock& lock, const Worker::Api& api, v8::Local<v8::Object> target) {
+      return WorkerdApi::from(api).compileGlobals(lock, globals, target, 1);
+    }, IsolateObserver::StartType::COLD,
+        TraceParentContext(nullptr, nullptr),  // systemTracer -- TODO(beta): factor out
+        Worker::Lock::TakeSynchronously(kj::none), errorReporter);
+
+    {
+      worker->runInLockScope(Worker::Lock::TakeSynchronously(kj::none),
+          [&](Worker::Lock& lock) { lock.validateHandlers(errorReporter); });
     }
-  }
 
-  auto worker = kj::atomicRefcounted<Worker>(kj::mv(script), kj::atomicRefcounted<WorkerObserver>(),
-      [&](jsg::Lock& lock, const Worker::Api& api, v8::Local<v8::Object> target) {
-    return WorkerdApi::from(api).compileGlobals(lock, globals, target, 1);
-  }, IsolateObserver::StartType::COLD,
-      TraceParentContext(nullptr, nullptr),  // systemTracer -- TODO(beta): factor out
-      Worker::Lock::TakeSynchronously(kj::none), errorReporter);
+    auto evaluateTime = clock.now();
+    KJ_LOG(INFO, "worker startup", name, "isolate", isolateTime - startTime, "compile",
+        compileTime - isolateTime, "evaluate", evaluateTime - compileTime);
 
-  {
-    worker->runInLockScope(Worker::Lock::TakeSynchronously(kj::none),
-        [&](Worker::Lock& lock) { lock.validateHandlers(errorReporter); });
-  }
+    return worker;
+  };
+  auto worker = newWorker(errorReporter);
 
   auto linkCallback = [this, name, conf, subrequestChannels = kj::mv(subrequestChannels),
                           actorChannels = kj::mv(actorChannels)](
@@ -3188,6 +4768,20 @@ kj::Own<Server::Service> Server::makeWorker(kj::StringPtr name,
     if (conf.hasCacheApiOutbound()) {
       result.cache = lookupService(
           conf.getCacheApiOutbound(), kj::str("Worker \"", name, "\"'s cacheApiOutbound"));
+      if (conf.hasCacheApiLocalTier()) {
+        auto tierConf = conf.getCacheApiLocalTier();
+        result.localCache = kj::heap<LocalCacheTier>(
+            LocalCacheTier::Limits{
+              .maxTotalSize = tierConf.getMaxTotalSize(),
+              .maxEntrySize = tierConf.getMaxEntrySize(),
+              .maxTtl = tierConf.getMaxTtlSeconds() * kj::SECONDS,
+            },
+            timer, globalContext->threadContext.getHeaderIds());
+      }
+    } else if (conf.hasCacheApiLocalTier()) {
+      reportConfigError(kj::str("Worker \"", name,
+          "\" specifies cacheApiLocalTier but no cacheApiOutbound. The local tier will be "
+          "ignored."));
     }
 
     auto actorStorageConf = conf.getDurableObjectStorage();
@@ -3201,7 +4795,7 @@ kj::Own<Server::Service> Server::makeWorker(kj::StringPtr name,
               "to the service \"",
               diskName, "\", but that service is not a local disk service."));
         } else KJ_IF_SOME(dir, diskSvc->getWritable()) {
-          result.actorStorage = kj::heap<SqliteDatabase::Vfs>(dir);
+          result.actorStorage = kj::heap<SqliteDatabase::Vfs>(dir, sqliteVfsOptions);
         } else {
           reportConfigError(kj::str("service ", name,
               ": durableObjectStorage config refers "
@@ -3229,16 +4823,121 @@ kj::Own<Server::Service> Server::makeWorker(kj::StringPtr name,
       }
     }
 
+    for (auto nsConf: conf.getDurableObjectNamespaces()) {
+      if (!nsConf.hasPeers()) continue;
+      auto& ns = KJ_UNWRAP_OR(workerService.getActorNamespace(nsConf.getClassName()), continue);
+      auto errorContext =
+          kj::str("Worker \"", name, "\"'s Durable Object class \"", nsConf.getClassName(), "\"");
+
+      bool valid = true;
+      uint selfCount = 0;
+      kj::HashSet<kj::StringPtr> names;
+      auto peers = KJ_MAP(peerConf, nsConf.getPeers()) -> WorkerService::ActorNamespace::Peer {
+        kj::StringPtr peerName = peerConf.getName();
+        if (names.contains(peerName)) {
+          reportConfigError(kj::str(errorContext, " lists peer \"", peerName, "\" twice."));
+          valid = false;
+        }
+        names.insert(peerName);
+
+        if (!peerConf.hasService()) {
+          ++selfCount;
+          return {.name = peerName};
+        }
+        auto& svc = lookupService(
+            peerConf.getService(), kj::str(errorContext, "'s peer \"", peerName, "\""));
+        auto external = dynamic_cast<ExternalHttpService*>(&svc);
+        if (external == nullptr || !external->supportsRpc()) {
+          reportConfigError(kj::str(errorContext, "'s peer \"", peerName,
+              "\" must be an external HTTP service with `capnpConnectHost` set."));
+          valid = false;
+        }
+        return {.name = peerName, .service = svc};
+      };
+
+      if (selfCount != 1) {
+        reportConfigError(kj::str(errorContext,
+            " must list exactly one peer without a `service`, representing this process."));
+        valid = false;
+      }
+      if (valid) {
+        ns.setPeers(kj::mv(peers));
+      }
+    }
+
     result.tails = KJ_MAP(tail, conf.getTails()) {
       return &lookupService(tail, kj::str("Worker \"", name, "\"'s tails"));
     };
+    if (conf.hasTailDiagnosticsChannels()) {
+      kj::HashSet<kj::String> names;
+      for (auto channel: conf.getTailDiagnosticsChannels()) {
+        names.upsert(kj::str(channel), [](auto&, auto&&) {});
+      }
+      result.tailDiagnosticsChannels = kj::mv(names);
+    }
+    if (conf.hasTailSampling()) {
+      auto samplingConf = conf.getTailSampling();
+      auto rate = samplingConf.getHeadSampleRate();
+      if (!(rate >= 0 && rate <= 1)) {
+        reportConfigError(kj::str("Worker \"", name,
+            "\"'s tailSampling.headSampleRate must be between 0 and 1, but is ", rate, "."));
+        rate = 1;
+      }
+      result.tailSampler = kj::heap<TailSampler>(
+          TailSampler::Policy{
+            .headSampleRate = rate,
+            .alwaysSampleExceptions = samplingConf.getAlwaysSampleExceptions(),
+            .maxTracesPerSecond = samplingConf.getMaxTracesPerSecond(),
+          },
+          timer, entropySource);
+    }
+
+    if (conf.hasCron()) {
+      auto cronConf = conf.getCron();
+      auto triggers = kj::heapArrayBuilder<CronScheduler::Trigger>(cronConf.getSchedules().size());
+      for (auto cron: cronConf.getSchedules()) {
+        KJ_IF_SOME(schedule, CronSchedule::parse(cron)) {
+          triggers.add(CronScheduler::Trigger{.cron = kj::str(cron), .schedule = schedule});
+        } else {
+          reportConfigError(kj::str("Worker \"", name, "\"'s cron schedule \"", cron,
+              "\" is not a valid cron expression."));
+        }
+      }
+      if (triggers.size() > 0) {
+        if (!workerService.hasHandler("scheduled"_kj)) {
+          reportConfigError(kj::str("Worker \"", name,
+              "\" has cron schedules, but doesn't export a scheduled() handler."));
+        }
+        result.cronScheduler = kj::heap<CronScheduler>(kj::systemPreciseCalendarClock(), timer,
+            entropySource, cronConf.getMaxJitterMs() * kj::MILLISECONDS, triggers.finish(),
+            [&workerService, name](kj::Date scheduledTime, kj::StringPtr cron) {
+          auto worker = workerService.startRequest({});
+          auto promise = worker->runScheduled(scheduledTime, cron);
+          return promise
+              .then([name, cron](WorkerInterface::ScheduledResult result) {
+            if (result.outcome != EventOutcome::OK) {
+              KJ_LOG(WARNING, "scheduled() handler failed", name, cron, result.outcome);
+            }
+          }).attach(kj::mv(worker));
+        });
+      }
+    }
 
     return result;
   };
 
+  kj::Maybe<WorkerService::Lazy> lazyOptions;
+  if (lazy) {
+    lazyOptions = WorkerService::Lazy{
+      .rebuild = kj::mv(newWorker),
+      .idleTimeout = conf.getLazyIdleTimeoutSeconds() * kj::SECONDS,
+    };
+  }
+
   return kj::heap<WorkerService>(globalContext->threadContext, kj::mv(worker),
       kj::mv(errorReporter.defaultEntrypoint), kj::mv(errorReporter.namedEntrypoints),
-      localActorConfigs, kj::mv(linkCallback), KJ_BIND_METHOD(*this, abortAllActors));
+      localActorConfigs, kj::mv(linkCallback), KJ_BIND_METHOD(*this, abortAllActors), metrics,
+      actorMemoryLimits, kj::mv(isolateHeap), kj::mv(lazyOptions));
 }
 
 // =======================================================================================
@@ -3264,6 +4963,15 @@ kj::Own<Server::Service> Server::makeService(config::Service::Reader conf,
 
     case config::Service::DISK:
       return makeDiskDirectoryService(name, conf.getDisk(), headerTableBuilder);
+
+    case config::Service::METRICS:
+      return makeMetricsService(headerTableBuilder);
+
+    case config::Service::LOCAL_QUEUE:
+      return makeLocalQueueService(name, conf.getLocalQueue(), headerTableBuilder);
+
+    case config::Service::HYPERDRIVE:
+      return makeHyperdriveService(name, conf.getHyperdrive());
   }
 
   reportConfigError(kj::str("Service named \"", name,
@@ -3424,6 +5132,18 @@ class Server::HttpListener final: public kj::Refcounted {
       return kj::READY_NOW;
     }
 
+    kj::Promise<void> startActorEvent(StartActorEventContext context) override {
+      auto params = context.getParams();
+      auto worker = KJ_UNWRAP_OR(
+          parent.service.startActorRequest(params.getClassName(), params.getActorId(), {}), {
+        JSG_FAIL_REQUIRE(
+            Error, "This service has no Durable Object class \"", params.getClassName(), "\".");
+      });
+      context.initResults(capnp::MessageSize{4, 1})
+          .setDispatcher(kj::heap<EventDispatcherImpl>(parent, kj::mv(worker)));
+      return kj::READY_NOW;
+    }
+
    private:
     HttpListener& parent;
   };
@@ -3604,6 +5324,213 @@ kj::Promise<void> Server::listenHttp(kj::Own<kj::ConnectionReceiver> listener,
   co_return co_await obj->run();
 }
 
+// =======================================================================================
+// Control commands
+
+// How often `cpu-profile` samples each isolate's stack. This matches V8's default.
+static constexpr kj::Duration CPU_PROFILE_SAMPLE_INTERVAL = 1 * kj::MILLISECONDS;
+
+void Server::writeControlMessage(kj::StringPtr message) {
+  KJ_IF_SOME(stream, controlOverride) {
+    try {
+      stream->write(kj::str(message, '\n').asBytes());
+    } catch (kj::Exception& e) {
+      KJ_LOG(ERROR, e);
+    }
+  }
+}
+
+kj::Promise<void> Server::handleControlInput(kj::AsyncInputStream& input) {
+  // Commands are short; a longer line is almost certainly garbage, so stop reading.
+  static constexpr size_t MAX_COMMAND_SIZE = 4096;
+
+  kj::Vector<char> line;
+  char buffer[1024];
+  for (;;) {
+    size_t n = co_await input.tryRead(buffer, 1, sizeof(buffer));
+    if (n == 0) co_return;
+    for (char c: kj::arrayPtr(buffer, n)) {
+      if (c != '\n') {
+        if (line.size() >= MAX_COMMAND_SIZE) {
+          KJ_LOG(ERROR, "control command too long; ignoring further control input");
+          co_return;
+        }
+        line.add(c);
+        continue;
+      }
+      auto command = kj::heapString(line.begin(), line.size());
+      line.clear();
+      try {
+        handleControlCommand(command);
+      } catch (kj::Exception& e) {
+        KJ_LOG(ERROR, "control command failed", command, e);
+        writeControlMessage("{\"event\":\"control-error\",\"message\":\"command failed\"}");
+      }
+    }
+  }
+}
+
+void Server::reportControlError(kj::StringPtr message) {
+  writeControlMessage(kj::str("{\"event\":\"control-error\",\"message\":\"", message, "\"}"));
+}
+
+void Server::forEachControlIsolate(kj::FunctionParam<void(const Worker::Isolate&)> func) {
+  kj::Vector<kj::String> dead;
+  for (auto& entry: controlIsolates) {
+    KJ_IF_SOME(isolate, entry.value->tryAddStrongRef()) {
+      func(*isolate);
+    } else {
+      dead.add(kj::str(entry.key));
+    }
+  }
+  for (auto& name: dead) {
+    controlIsolates.erase(name);
+  }
+}
+
+bool Server::writeProfile(kj::StringPtr path, PprofBuilder& profile) {
+  try {
+    fs.getRoot()
+        .openFile(fs.getCurrentPath().eval(path), kj::WriteMode::CREATE | kj::WriteMode::MODIFY)
+        ->writeAll(profile.finish());
+    return true;
+  } catch (kj::Exception& e) {
+    KJ_LOG(ERROR, "failed to write profile", path, e);
+    reportControlError("failed to write profile");
+    return false;
+  }
+}
+
+void Server::handleControlCommand(kj::StringPtr command) {
+  kj::Vector<kj::String> args;
+  for (;;) {
+    while (command.startsWith(" ")) command = command.slice(1);
+    if (command.size() == 0) break;
+    auto end = command.findFirst(' ').orDefault(command.size());
+    args.add(kj::str(command.first(end)));
+    command = command.slice(end);
+  }
+  if (args.size() == 0) return;
+
+  if (args[0] == "heap-profile-start") {
+    // V8's default, which keeps overhead low enough for production use.
+    uint64_t sampleInterval = 512 * 1024;
+    if (args.size() > 1) {
+      KJ_IF_SOME(interval, args[1].tryParseAs<uint64_t>()) {
+        sampleInterval = interval;
+      } else {
+        return reportControlError("invalid sample interval");
+      }
+    }
+    if (heapProfile != kj::none) {
+      return reportControlError("heap profile already started");
+    }
+
+    uint count = 0;
+    forEachControlIsolate([&](const Worker::Isolate& isolate) {
+      if (isolate.startHeapSampling(sampleInterval)) ++count;
+    });
+    heapProfile = HeapProfile{
+      .sampleInterval = sampleInterval,
+      .startTime = kj::systemPreciseCalendarClock().now(),
+    };
+    writeControlMessage(kj::str("{\"event\":\"heap-profile-started\",\"isolates\":", count, "}"));
+  } else if (args[0] == "heap-profile-stop") {
+    if (args.size() != 2) {
+      return reportControlError("usage: heap-profile-stop <path>");
+    }
+    auto& started =
+        KJ_UNWRAP_OR(heapProfile, return reportControlError("heap profile not started"));
+
+    PprofBuilder::ValueType sampleTypes[] = {{"objects", "count"}, {"space", "bytes"}};
+    PprofBuilder profile(sampleTypes);
+    profile.setPeriod({"space", "bytes"}, started.sampleInterval);
+    auto now = kj::systemPreciseCalendarClock().now();
+    profile.setTime((started.startTime - kj::UNIX_EPOCH) / kj::NANOSECONDS,
+        (now - started.startTime) / kj::NANOSECONDS);
+    heapProfile = kj::none;
+
+    uint count = 0;
+    forEachControlIsolate([&](const Worker::Isolate& isolate) {
+      if (isolate.stopHeapSampling(profile)) ++count;
+    });
+    auto samples = profile.sampleCount();
+    if (writeProfile(args[1], profile)) {
+      writeControlMessage(kj::str("{\"event\":\"heap-profile\",\"isolates\":", count,
+          ",\"samples\":", samples, "}"));
+    }
+  } else if (args[0] == "cpu-profile") {
+    static constexpr uint MAX_CPU_PROFILE_SECONDS = 3600;
+    if (args.size() < 3) {
+      return reportControlError("usage: cpu-profile <seconds> <path> [<service>...]");
+    }
+    auto seconds = args[1].tryParseAs<uint>().orDefault(0);
+    if (seconds == 0 || seconds > MAX_CPU_PROFILE_SECONDS) {
+      return reportControlError("invalid duration");
+    }
+    if (cpuProfileRunning) {
+      return reportControlError("cpu profile already running");
+    }
+
+    auto services = args.asPtr().slice(3);
+    kj::Vector<kj::Own<const Worker::Isolate>> isolates;
+    forEachControlIsolate([&](const Worker::Isolate& isolate) {
+      if (services.size() > 0) {
+        bool selected = false;
+        for (auto& name: services) {
+          selected = selected || name == isolate.getId();
+        }
+        if (!selected) return;
+      }
+      if (isolate.startCpuProfiling(CPU_PROFILE_SAMPLE_INTERVAL)) {
+        isolates.add(kj::atomicAddRef(isolate));
+      }
+    });
+
+    cpuProfileRunning = true;
+    writeControlMessage(
+        kj::str("{\"event\":\"cpu-profile-started\",\"isolates\":", isolates.size(), "}"));
+    tasks.add(finishCpuProfile(isolates.releaseAsArray(), seconds * kj::SECONDS, kj::mv(args[2])));
+  } else if (args[0] == "reload") {
+    auto& reload = KJ_UNWRAP_OR(reloadCallback, return reportControlError("reload not supported"));
+    writeControlMessage("{\"event\":\"reload\"}");
+    reload();
+  } else {
+    reportControlError("unknown command");
+  }
+}
+
+kj::Promise<void> Server::finishCpuProfile(
+    kj::Array<kj::Own<const Worker::Isolate>> isolates, kj::Duration duration, kj::String path) {
+  auto startTime = kj::systemPreciseCalendarClock().now();
+  co_await timer.afterDelay(duration);
+  cpuProfileRunning = false;
+
+  PprofBuilder::ValueType sampleTypes[] = {{"samples", "count"}, {"cpu", "nanoseconds"}};
+  PprofBuilder profile(sampleTypes);
+  profile.setPeriod({"cpu", "nanoseconds"}, CPU_PROFILE_SAMPLE_INTERVAL / kj::NANOSECONDS);
+  auto now = kj::systemPreciseCalendarClock().now();
+  profile.setTime(
+      (startTime - kj::UNIX_EPOCH) / kj::NANOSECONDS, (now - startTime) / kj::NANOSECONDS);
+
+  uint count = 0;
+  for (auto& isolate: isolates) {
+    try {
+      if (isolate->stopCpuProfiling(profile)) ++count;
+    } catch (kj::Exception& e) {
+      KJ_LOG(ERROR, "failed to stop CPU profiler", isolate->getId(), e);
+    }
+  }
+  // Let go of the isolates before writing, which may take a while.
+  isolates = nullptr;
+
+  auto samples = profile.sampleCount();
+  if (writeProfile(path, profile)) {
+    writeControlMessage(kj::str("{\"event\":\"cpu-profile\",\"isolates\":", count,
+        ",\"samples\":", samples, "}"));
+  }
+}
+
 // =======================================================================================
 // Server::run()
 
@@ -3725,9 +5652,49 @@ void Server::startServices(jsg::V8System& v8System,
   // ---------------------------------------------------------------------------
   // Configure services
   TRACE_EVENT("workerd", "startServices");
+
+  {
+    // Durable Object databases always use WAL mode.
+    sqliteVfsOptions.walMode = true;
+
+    auto sqliteConf = config.getSqlite();
+    SqliteDatabase::setHeapLimits(sqliteConf.getSoftHeapLimit(), sqliteConf.getHardHeapLimit());
+    if (sqliteConf.getCacheSizeKib() > 0) {
+      // Negative cache_size values are interpreted by SQLite as KiB rather than pages.
+      sqliteVfsOptions.cacheSize = -static_cast<int64_t>(sqliteConf.getCacheSizeKib());
+    }
+    if (sqliteConf.getMmapSize() > 0) {
+      sqliteVfsOptions.mmapSize = static_cast<int64_t>(sqliteConf.getMmapSize());
+    }
+
+    moduleCodeCache = kj::heap<ModuleCodeCache>(
+        moduleCodeCacheRoot.map([](kj::Own<const kj::Directory>& dir) { return dir->clone(); }));
+
+    auto actorMemoryConf = config.getActorMemory();
+    actorMemoryLimits = {
+      .maxResidentBytes = actorMemoryConf.getMaxResidentBytes(),
+      .maxIsolateHeapBytes = actorMemoryConf.getMaxIsolateHeapBytes(),
+    };
+
+    if (config.hasMemoryCacheHostTable()) {
+      auto tableConf = config.getMemoryCacheHostTable();
+      KJ_IF_SOME(exception, kj::runCatchingExceptions([&]() {
+        memoryCacheProvider->setHostTable(SharedMemoryTable::open(tableConf.getPath(),
+            {.slotCount = tableConf.getSlotCount(), .slotSize = tableConf.getSlotSize()}));
+      })) {
+        reportConfigError(kj::str("Couldn't open memoryCacheHostTable \"", tableConf.getPath(),
+            "\": ", exception.getDescription()));
+      }
+    }
+  }
+
   // First pass: Extract actor namespace configs.
   for (auto serviceConf: config.getServices()) {
     kj::StringPtr name = serviceConf.getName();
+
+    if (serviceConf.isMetrics()) {
+      metrics = ServerMetrics::get();
+    }
     kj::HashMap<kj::String, ActorConfig> serviceActorConfigs;
 
     if (serviceConf.isWorker()) {
@@ -3775,6 +5742,14 @@ void Server::startServices(jsg::V8System& v8System,
           "\". Was the config compiled with a newer version of the schema?"));
 
     validDurableObjectStorage:
+      if (config.getThreads() > 1 && workerConf.getDurableObjectNamespaces().size() > 0) {
+        // Each thread constructs its own copy of every service, so the same object could end up
+        // being instantiated in more than one thread at once.
+        reportConfigError(kj::str("Worker service \"", name,
+            "\" defines Durable Object namespaces, which are not supported when `threads` is "
+            "greater than 1."));
+      }
+
       if (workerConf.hasDurableObjectUniqueKeyModifier()) {
         // This should be implemented along with parameterized workers. It's not relevant
         // otherwise, but let's make sure no one sets it accidentally.
@@ -3803,10 +5778,24 @@ void Server::startServices(jsg::V8System& v8System,
     inspectorIsolateRegistrar = kj::mv(registrar);
   }
 
+  KJ_IF_SOME(input, controlInput) {
+    tasks.add(handleControlInput(*input).exclusiveJoin(forkedDrainWhen.addBranch()));
+  }
+
   // Second pass: Build services.
+  //
+  // This is done serially, on this thread. Constructing a worker registers its isolate with the
+  // inspector and the control input, reports errors through reportConfigError(), and builds
+  // objects tied to this thread's event loop, none of which is safe to do from other threads.
+  // Use --verbose to see where the time goes for each worker, and --module-code-cache-dir to
+  // skip recompiling unchanged modules.
+  auto& clock = kj::systemPreciseMonotonicClock();
+  auto buildStart = clock.now();
   for (auto serviceConf: config.getServices()) {
     kj::StringPtr name = serviceConf.getName();
+    auto serviceStart = clock.now();
     auto service = makeService(serviceConf, headerTableBuilder, config.getExtensions());
+    KJ_LOG(INFO, "service startup", name, clock.now() - serviceStart);
 
     services.upsert(kj::str(name), kj::mv(service), [&](auto&&...) {
       reportConfigError(kj::str("Config defines multiple services named \"", name, "\"."));
@@ -3834,9 +5823,12 @@ void Server::startServices(jsg::V8System& v8System,
   startAlarmScheduler(config);
 
   // Third pass: Cross-link services.
+  auto linkStart = clock.now();
   for (auto& service: services) {
     service.value->link();
   }
+  KJ_LOG(INFO, "services started", services.size(), "construct", linkStart - buildStart, "link",
+      clock.now() - linkStart);
 }
 
 kj::Promise<void> Server::listenOnSockets(config::Config::Reader config,
@@ -28,6 +28,9 @@ class V8System;
 namespace workerd::server {
 
 using api::pyodide::PythonConfig;
+class ModuleCodeCache;
+
+class ServerMetrics;
 
 // Implements the single-tenant Workers Runtime server / CLI.
 //
@@ -67,12 +70,25 @@ class Server final: private kj::TaskSet::ErrorHandler {
   void enableControl(uint fd) {
     controlOverride = kj::heap<kj::FdOutputStream>(fd);
   }
+  // Reads control commands from `stream`; see handleControlCommand(). Replies are written as
+  // control messages, so this is only useful together with enableControl().
+  void enableControlInput(kj::Own<kj::AsyncInputStream> stream) {
+    controlInput = kj::mv(stream);
+  }
+  // Sets what the `reload` control command does. It's expected not to return, e.g. because it
+  // re-executes the process. Without a callback, `reload` reports an error.
+  void setReloadCallback(kj::Function<void()> callback) {
+    reloadCallback = kj::mv(callback);
+  }
   void setPackageDiskCacheRoot(kj::Maybe<kj::Own<const kj::Directory>>&& dkr) {
     pythonConfig.packageDiskCacheRoot = kj::mv(dkr);
   }
   void setPyodideDiskCacheRoot(kj::Maybe<kj::Own<const kj::Directory>>&& dkr) {
     pythonConfig.pyodideDiskCacheRoot = kj::mv(dkr);
   }
+  void setModuleCodeCacheRoot(kj::Maybe<kj::Own<const kj::Directory>>&& dir) {
+    moduleCodeCacheRoot = kj::mv(dir);
+  }
   void setPythonCreateSnapshot() {
     pythonConfig.createSnapshot = true;
   }
@@ -119,9 +135,23 @@ class Server final: private kj::TaskSet::ErrorHandler {
     .pyodideDiskCacheRoot = kj::none,
     .createSnapshot = false,
     .createBaselineSnapshot = false};
+  kj::Maybe<kj::Own<const kj::Directory>> moduleCodeCacheRoot;
+  // Shared by all workers' isolates, so that identical modules are only compiled once. Created by
+  // startServices(), backed by `moduleCodeCacheRoot` if set.
+  kj::Own<ModuleCodeCache> moduleCodeCache;
 
   bool experimental = false;
 
+  // Options for the SQLite VFSes backing Durable Object storage, from the config's `sqlite` field.
+  SqliteDatabase::VfsOptions sqliteVfsOptions;
+
+  // Thresholds from the config's `actorMemory` field. Zero disables a threshold.
+  struct ActorMemoryLimits {
+    uint64_t maxResidentBytes = 0;
+    uint64_t maxIsolateHeapBytes = 0;
+  };
+  ActorMemoryLimits actorMemoryLimits;
+
   Worker::ConsoleMode consoleMode;
 
   kj::Own<api::MemoryCacheProvider> memoryCacheProvider;
@@ -138,6 +168,26 @@ class Server final: private kj::TaskSet::ErrorHandler {
   kj::Maybe<kj::String> inspectorOverride;
   kj::Maybe<kj::Own<InspectorServiceIsolateRegistrar>> inspectorIsolateRegistrar;
   kj::Maybe<kj::Own<kj::FdOutputStream>> controlOverride;
+  kj::Maybe<kj::Own<kj::AsyncInputStream>> controlInput;
+  kj::Maybe<kj::Function<void()>> reloadCallback;
+
+  // Isolates that control commands apply to, by service name. Only populated when control input
+  // is enabled.
+  kj::HashMap<kj::String, kj::Own<const Worker::Isolate::WeakIsolateRef>> controlIsolates;
+
+  // State of a heap profile started by the `heap-profile-start` control command.
+  struct HeapProfile {
+    uint64_t sampleInterval;
+    kj::Date startTime;
+  };
+  kj::Maybe<HeapProfile> heapProfile;
+
+  // Whether a `cpu-profile` command is waiting for its profile to finish.
+  bool cpuProfileRunning = false;
+
+  // Set when the config defines a `metrics` service, in which case the observers of all Workers
+  // feed it.
+  kj::Maybe<ServerMetrics&> metrics;
 
   struct GlobalContext;
   // General context needed to construct workers. Initilaized early in run().
@@ -151,6 +201,10 @@ class Server final: private kj::TaskSet::ErrorHandler {
   // correctly construct dependent services.
   kj::HashMap<kj::String, kj::HashMap<kj::String, ActorConfig>> actorConfigs;
 
+  // TLS contexts built by makeTlsContext(), keyed by the stringified TlsOptions they were built
+  // from. Declared before `services` so that they outlive the services and sockets using them.
+  kj::HashMap<kj::String, kj::Own<kj::TlsContext>> tlsContexts;
+
   kj::HashMap<kj::String, kj::Own<Service>> services;
 
   kj::Own<kj::PromiseFulfiller<void>> fatalFulfiller;
@@ -189,6 +243,42 @@ class Server final: private kj::TaskSet::ErrorHandler {
   // request in flight.
   kj::Promise<void> handleDrain(kj::Promise<void> drainWhen);
 
+  // Reads newline-separated commands from `controlInput` until it reaches EOF.
+  kj::Promise<void> handleControlInput(kj::AsyncInputStream& input);
+
+  // Runs one control command, a command name followed by space-separated arguments:
+  //
+  //   heap-profile-start [<sample-interval-bytes>]
+  //     Starts V8's sampling heap profiler in every isolate.
+  //   heap-profile-stop <path>
+  //     Stops the profiler and writes the allocations that are still live, from all isolates,
+  //     to <path> as a pprof profile.
+  //   cpu-profile <seconds> <path> [<service>...]
+  //     Runs V8's CPU profiler for <seconds> in the isolates of the given services, or in every
+  //     isolate if none are given, then writes the merged samples to <path> as a pprof profile.
+  //   reload
+  //     Sends a `reload` message, then calls the callback passed to setReloadCallback().
+  //
+  // Reports the outcome as a control message.
+  void handleControlCommand(kj::StringPtr command);
+
+  // Stops the CPU profilers started by a `cpu-profile` command after `duration`.
+  kj::Promise<void> finishCpuProfile(
+      kj::Array<kj::Own<const Worker::Isolate>> isolates, kj::Duration duration, kj::String path);
+
+  // Calls `func` with each isolate in `controlIsolates` that's still alive.
+  void forEachControlIsolate(kj::FunctionParam<void(const Worker::Isolate&)> func);
+
+  // Writes `profile` to `path`. On failure, reports a control error and returns false.
+  bool writeProfile(kj::StringPtr path, PprofBuilder& profile);
+
+  // Writes a line to the control descriptor, if any.
+  void writeControlMessage(kj::StringPtr message);
+  void reportControlError(kj::StringPtr message);
+
+  // Returns the TLS context for `conf`. Identical options share one context, and so one SSL_CTX
+  // with its session cache, session ticket keys and parsed trust store. The context is owned by
+  // the Server; the returned Own does not own it.
   kj::Own<kj::TlsContext> makeTlsContext(config::TlsOptions::Reader conf);
   kj::Promise<kj::Own<kj::NetworkAddress>> makeTlsNetworkAddress(config::TlsOptions::Reader conf,
       kj::StringPtr addrStr,
@@ -202,6 +292,11 @@ class Server final: private kj::TaskSet::ErrorHandler {
       config::ExternalServer::Reader conf,
       kj::HttpHeaderTable::Builder& headerTableBuilder);
   kj::Own<Service> makeNetworkService(config::Network::Reader conf);
+  kj::Own<Service> makeMetricsService(kj::HttpHeaderTable::Builder& headerTableBuilder);
+  kj::Own<Service> makeLocalQueueService(kj::StringPtr name,
+      config::LocalQueue::Reader conf,
+      kj::HttpHeaderTable::Builder& headerTableBuilder);
+  kj::Own<Service> makeHyperdriveService(kj::StringPtr name, config::HyperdrivePool::Reader conf);
   kj::Own<Service> makeDiskDirectoryService(kj::StringPtr name,
       config::DiskDirectory::Reader conf,
       kj::HttpHeaderTable::Builder& headerTableBuilder);
@@ -228,6 +323,9 @@ class Server final: private kj::TaskSet::ErrorHandler {
   class ExternalTcpService;
   class NetworkService;
   class DiskDirectoryService;
+  class MetricsService;
+  class LocalQueueService;
+  class HyperdriveService;
   class WorkerService;
   class WorkerEntrypointService;
   class HttpListener;
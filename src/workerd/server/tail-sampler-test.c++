@@ -0,0 +1,83 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "tail-sampler.h"
+
+#include <kj/compat/http.h>
+#include <kj/test.h>
+#include <kj/timer.h>
+
+namespace workerd::server {
+namespace {
+
+class FakeEntropySource final: public kj::EntropySource {
+ public:
+  void generate(kj::ArrayPtr<byte> buffer) override {
+    buffer.fill(0x5a);
+  }
+};
+
+kj::Own<Trace> makeTrace(EventOutcome outcome) {
+  auto trace = kj::refcounted<Trace>(kj::none, kj::none, kj::none, kj::none, kj::none, nullptr,
+      kj::none, ExecutionModel::STATELESS);
+  trace->outcome = outcome;
+  return trace;
+}
+
+using Decision = TailSampler::Decision;
+
+KJ_TEST("TailSampler samples about the configured fraction of requests") {
+  kj::TimerImpl timer(kj::origin<kj::TimePoint>());
+  FakeEntropySource entropy;
+
+  TailSampler all({}, timer, entropy);
+  TailSampler none({.headSampleRate = 0, .alwaysSampleExceptions = false}, timer, entropy);
+  TailSampler tenth({.headSampleRate = 0.1, .alwaysSampleExceptions = false}, timer, entropy);
+
+  uint sampled = 0;
+  for (auto i = 0; i < 10000; i++) {
+    KJ_EXPECT(all.sampleRequest() == Decision::SAMPLED);
+    KJ_EXPECT(none.sampleRequest() == Decision::SKIP);
+    if (tenth.sampleRequest() == Decision::SAMPLED) ++sampled;
+  }
+  KJ_EXPECT(sampled > 800 && sampled < 1200, sampled);
+}
+
+KJ_TEST("TailSampler keeps the traces of unsampled requests that failed") {
+  kj::TimerImpl timer(kj::origin<kj::TimePoint>());
+  FakeEntropySource entropy;
+  TailSampler sampler({.headSampleRate = 0}, timer, entropy);
+
+  KJ_EXPECT(sampler.sampleRequest() == Decision::EXCEPTIONS_ONLY);
+
+  auto ok = kj::arr(makeTrace(EventOutcome::OK));
+  KJ_EXPECT(!sampler.shouldDeliverUnsampled(ok));
+
+  auto failed = kj::arr(makeTrace(EventOutcome::OK), makeTrace(EventOutcome::EXCEPTION));
+  KJ_EXPECT(sampler.shouldDeliverUnsampled(failed));
+
+  // An exception that was caught and logged still counts.
+  ok[0]->exceptions.add(kj::UNIX_EPOCH, kj::str("Error"), kj::str("oops"), kj::none);
+  KJ_EXPECT(sampler.shouldDeliverUnsampled(ok));
+}
+
+KJ_TEST("TailSampler caps the traces delivered per second") {
+  kj::TimerImpl timer(kj::origin<kj::TimePoint>());
+  FakeEntropySource entropy;
+  TailSampler sampler({.maxTracesPerSecond = 2}, timer, entropy);
+  auto failed = kj::arr(makeTrace(EventOutcome::EXCEPTION));
+
+  KJ_EXPECT(sampler.sampleRequest() == Decision::SAMPLED);
+  KJ_EXPECT(sampler.sampleRequest() == Decision::SAMPLED);
+  KJ_EXPECT(sampler.sampleRequest() == Decision::EXCEPTIONS_ONLY);
+  KJ_EXPECT(!sampler.shouldDeliverUnsampled(failed));
+
+  timer.advanceTo(timer.now() + 1 * kj::SECONDS);
+  KJ_EXPECT(sampler.shouldDeliverUnsampled(failed));
+  KJ_EXPECT(sampler.sampleRequest() == Decision::SAMPLED);
+  KJ_EXPECT(sampler.sampleRequest() == Decision::EXCEPTIONS_ONLY);
+}
+
+}  // namespace
+}  // namespace workerd::server
@@ -0,0 +1,64 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "tail-sampler.h"
+
+#include <kj/compat/http.h>
+
+namespace workerd::server {
+
+TailSampler::TailSampler(
+    Policy policy, const kj::MonotonicClock& clock, kj::EntropySource& entropySource)
+    : policy(policy),
+      clock(clock),
+      windowStart(clock.now()) {
+  // Sampling doesn't need cryptographic randomness, so the entropy source only seeds a cheap
+  // generator instead of being asked once per request.
+  entropySource.generate(kj::arrayPtr(&randomState, 1).asBytes());
+}
+
+TailSampler::Decision TailSampler::sampleRequest() {
+  if (policy.headSampleRate >= 1.0 || nextRandom() < policy.headSampleRate) {
+    if (tryReserveDelivery()) {
+      return Decision::SAMPLED;
+    }
+  }
+  return policy.alwaysSampleExceptions ? Decision::EXCEPTIONS_ONLY : Decision::SKIP;
+}
+
+bool TailSampler::shouldDeliverUnsampled(kj::ArrayPtr<kj::Own<Trace>> traces) {
+  for (auto& trace: traces) {
+    if (trace->outcome != EventOutcome::OK || trace->exceptions.size() > 0) {
+      return tryReserveDelivery();
+    }
+  }
+  return false;
+}
+
+double TailSampler::nextRandom() {
+  // splitmix64
+  uint64_t z = (randomState += 0x9e3779b97f4a7c15);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+  z ^= z >> 31;
+  return (z >> 11) * 0x1.0p-53;
+}
+
+bool TailSampler::tryReserveDelivery() {
+  if (policy.maxTracesPerSecond == 0) {
+    return true;
+  }
+  auto now = clock.now();
+  if (now - windowStart >= 1 * kj::SECONDS) {
+    windowStart = now;
+    deliveredInWindow = 0;
+  }
+  if (deliveredInWindow >= policy.maxTracesPerSecond) {
+    return false;
+  }
+  ++deliveredInWindow;
+  return true;
+}
+
+}  // namespace workerd::server
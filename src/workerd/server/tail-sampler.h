@@ -0,0 +1,65 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <workerd/io/trace.h>
+
+#include <kj/time.h>
+
+namespace workerd::server {
+
+// Decides which of a Worker's requests are traced for its tail workers, see `Worker.tailSampling`
+// in workerd.capnp. The decision is made when the request starts, so requests that aren't traced
+// never create a tracer.
+//
+// The sampler is not thread-safe. Each serving thread has its own.
+class TailSampler {
+ public:
+  struct Policy {
+    // The fraction of requests that are traced, between 0 and 1.
+    double headSampleRate = 1.0;
+
+    // Also trace the requests that weren't picked by `headSampleRate`, but only deliver their
+    // traces if they report an exception.
+    bool alwaysSampleExceptions = true;
+
+    // The most traces that are delivered per second, 0 meaning no limit.
+    uint32_t maxTracesPerSecond = 0;
+  };
+
+  TailSampler(Policy policy, const kj::MonotonicClock& clock, kj::EntropySource& entropySource);
+  KJ_DISALLOW_COPY_AND_MOVE(TailSampler);
+
+  enum class Decision {
+    // Don't trace the request.
+    SKIP,
+    // Trace the request and deliver its traces.
+    SAMPLED,
+    // Trace the request, and deliver its traces only if shouldDeliverUnsampled() says so.
+    EXCEPTIONS_ONLY,
+  };
+
+  // Decides how to trace a request that's starting.
+  Decision sampleRequest();
+
+  // Returns whether the traces of an EXCEPTIONS_ONLY request should be delivered.
+  bool shouldDeliverUnsampled(kj::ArrayPtr<kj::Own<Trace>> traces);
+
+ private:
+  Policy policy;
+  const kj::MonotonicClock& clock;
+  uint64_t randomState;
+
+  kj::TimePoint windowStart;
+  uint32_t deliveredInWindow = 0;
+
+  // Returns a uniformly distributed number in [0, 1).
+  double nextRandom();
+
+  // Counts a delivery against `maxTracesPerSecond`, returning false if there's no room left.
+  bool tryReserveDelivery();
+};
+
+}  // namespace workerd::server
@@ -46,9 +46,16 @@
 #include <workerd/util/thread-scopes.h>
 #include <workerd/util/use-perfetto-categories.h>
 
+#include <openssl/sha.h>
+
 #include <kj/compat/http.h>
 #include <kj/compat/tls.h>
 #include <kj/compat/url.h>
+#include <kj/encoding.h>
+#include <kj/thread.h>
+
+#include <atomic>
+#include <thread>
 #ifdef WORKERD_EXPERIMENTAL_ENABLE_WEBGPU
 #include <workerd/api/gpu/gpu.h>
 #else
@@ -136,6 +143,7 @@ struct WorkerdApi::Impl final {
   JsgWorkerdIsolate jsgIsolate;
   api::MemoryCacheProvider& memoryCacheProvider;
   const PythonConfig& pythonConfig;
+  kj::Maybe<const ModuleCodeCache&> moduleCodeCache;
 
   class Configuration {
    public:
@@ -163,13 +171,15 @@ struct WorkerdApi::Impl final {
       kj::Own<JsgIsolateObserver> observerParam,
       api::MemoryCacheProvider& memoryCacheProvider,
       const PythonConfig& pythonConfig = defaultConfig,
-      kj::Maybe<kj::Own<jsg::modules::ModuleRegistry>> newModuleRegistry = kj::none)
+      kj::Maybe<kj::Own<jsg::modules::ModuleRegistry>> newModuleRegistry = kj::none,
+      kj::Maybe<const ModuleCodeCache&> moduleCodeCache = kj::none)
       : features(capnp::clone(featuresParam)),
         maybeOwnedModuleRegistry(kj::mv(newModuleRegistry)),
         observer(kj::atomicAddRef(*observerParam)),
         jsgIsolate(v8System, Configuration(*this), kj::mv(observerParam), kj::mv(createParams)),
         memoryCacheProvider(memoryCacheProvider),
-        pythonConfig(pythonConfig) {}
+        pythonConfig(pythonConfig),
+        moduleCodeCache(moduleCodeCache) {}
 
   static v8::Local<v8::String> compileTextGlobal(
       JsgWorkerdIsolate::Lock& lock, capnp::Text::Reader reader) {
@@ -183,7 +193,8 @@ struct WorkerdApi::Impl final {
 
   static v8::Local<v8::WasmModuleObject> compileWasmGlobal(JsgWorkerdIsolate::Lock& lock,
       capnp::Data::Reader reader,
-      const jsg::CompilationObserver& observer) {
+      const jsg::CompilationObserver& observer,
+      kj::Maybe<const ModuleCodeCache&> moduleCodeCache = kj::none) {
     lock.setAllowEval(true);
     KJ_DEFER(lock.setAllowEval(false));
 
@@ -193,6 +204,16 @@ struct WorkerdApi::Impl final {
     // compiles fast but runs slower.
     AllowV8BackgroundThreadsScope scope;
 
+    KJ_IF_SOME(cache, moduleCodeCache) {
+      KJ_IF_SOME(compiled, cache.getWasm(reader)) {
+        auto metrics = observer.onWasmCompilationFromCacheStart(lock.v8Isolate);
+        return jsg::check(v8::WasmModuleObject::FromCompiledModule(lock.v8Isolate, compiled));
+      }
+      auto module = jsg::compileWasmModule(lock, reader, observer);
+      cache.putWasm(module);
+      return module;
+    }
+
     return jsg::compileWasmModule(lock, reader, observer);
   };
 
@@ -215,14 +236,16 @@ WorkerdApi::WorkerdApi(jsg::V8System& v8System,
     kj::Own<JsgIsolateObserver> observer,
     api::MemoryCacheProvider& memoryCacheProvider,
     const PythonConfig& pythonConfig,
-    kj::Maybe<kj::Own<jsg::modules::ModuleRegistry>> newModuleRegistry)
+    kj::Maybe<kj::Own<jsg::modules::ModuleRegistry>> newModuleRegistry,
+    kj::Maybe<const ModuleCodeCache&> moduleCodeCache)
     : impl(kj::heap<Impl>(v8System,
           features,
           kj::mv(createParams),
           kj::mv(observer),
           memoryCacheProvider,
           pythonConfig,
-          kj::mv(newModuleRegistry))) {}
+          kj::mv(newModuleRegistry),
+          moduleCodeCache)) {}
 WorkerdApi::~WorkerdApi() noexcept(false) {}
 
 kj::Own<jsg::Lock> WorkerdApi::lock(jsg::V8StackScope& stackScope) const {
@@ -331,7 +354,8 @@ kj::Array<Worker::Script::CompiledGlobal> WorkerdApi::compileScriptGlobals(jsg::
   for (auto binding: conf.getBindings()) {
     if (binding.isWasmModule()) {
       auto name = lock.str(binding.getName());
-      auto value = Impl::compileWasmGlobal(lock, binding.getWasmModule(), observer);
+      auto value = Impl::compileWasmGlobal(
+          lock, binding.getWasmModule(), observer, impl->moduleCodeCache);
 
       compiledGlobals.add(Worker::Script::CompiledGlobal{
         {lock.v8Isolate, name},
@@ -353,10 +377,206 @@ kj::Array<kj::StringPtr> compileNamedExports(capnp::List<capnp::Text>::Reader na
 }
 }  // namespace
 
+namespace {
+// Name of the file in the module code cache directory holding the code cache for an ES module with
+// the given source. The key covers the V8 version and flags as well, since V8 rejects code cache
+// produced under a different configuration.
+kj::String getModuleCodeCacheFileName(kj::ArrayPtr<const char> source) {
+  uint32_t versionTag = v8::ScriptCompiler::CachedDataVersionTag();
+
+  SHA256_CTX ctx;
+  SHA256_Init(&ctx);
+  SHA256_Update(&ctx, &versionTag, sizeof(versionTag));
+  SHA256_Update(&ctx, source.begin(), source.size());
+  kj::byte digest[SHA256_DIGEST_LENGTH];
+  SHA256_Final(digest, &ctx);
+
+  return kj::str(kj::encodeHex(digest), ".v8cache");
+}
+}  // namespace
+
+bool ModuleCodeCache::contains(kj::ArrayPtr<const char> source) const {
+  auto filename = getModuleCodeCacheFileName(source);
+  if (entries.lockShared()->find(filename) != kj::none) return true;
+  KJ_IF_SOME(d, dir) {
+    return d->exists(kj::Path(kj::mv(filename)));
+  }
+  return false;
+}
+
+kj::Maybe<kj::Array<kj::byte>> ModuleCodeCache::get(kj::ArrayPtr<const char> source) const {
+  auto filename = getModuleCodeCacheFileName(source);
+  {
+    auto lock = entries.lockShared();
+    KJ_IF_SOME(cached, lock->find(filename)) {
+      return kj::heapArray<kj::byte>(cached);
+    }
+  }
+  KJ_IF_SOME(d, dir) {
+    KJ_IF_SOME(file, d->tryOpenFile(kj::Path(filename))) {
+      auto cached = file->readAllBytes();
+      entries.lockExclusive()->upsert(kj::mv(filename), kj::heapArray<kj::byte>(cached),
+          [](kj::Array<kj::byte>&, kj::Array<kj::byte>&&) {});
+      return kj::mv(cached);
+    }
+  }
+  return kj::none;
+}
+
+void ModuleCodeCache::put(kj::ArrayPtr<const char> source, v8::Local<v8::Module> module) const {
+  std::unique_ptr<v8::ScriptCompiler::CachedData> cached(
+      v8::ScriptCompiler::CreateCodeCache(module->GetUnboundModuleScript()));
+  if (cached == nullptr) return;
+  auto data = kj::arrayPtr(cached->data, cached->length);
+  auto filename = getModuleCodeCacheFileName(source);
+
+  KJ_IF_SOME(d, dir) {
+    // A cache that can't be written is not a reason to fail startup; we'll compile from source
+    // again next time.
+    KJ_IF_SOME(exception, kj::runCatchingExceptions([&]() {
+      auto replacer = d->replaceFile(
+          kj::Path(filename), kj::WriteMode::CREATE | kj::WriteMode::MODIFY);
+      replacer->get().writeAll(data);
+      replacer->commit();
+    })) {
+      KJ_LOG(WARNING, "failed to write module code cache", filename, exception);
+    }
+  }
+
+  entries.lockExclusive()->upsert(kj::mv(filename), kj::heapArray<kj::byte>(data),
+      [](kj::Array<kj::byte>& existing, kj::Array<kj::byte>&& replacement) {
+    existing = kj::mv(replacement);
+  });
+}
+
+kj::Maybe<v8::CompiledWasmModule> ModuleCodeCache::getWasm(
+    kj::ArrayPtr<const kj::byte> wasm) const {
+  auto lock = wasmModules.lockShared();
+  for (auto& compiled: *lock) {
+    auto wireBytes = const_cast<v8::CompiledWasmModule&>(compiled).GetWireBytesRef();
+    if (kj::arrayPtr(wireBytes.data(), wireBytes.size()) == wasm) {
+      return compiled;
+    }
+  }
+  return kj::none;
+}
+
+void ModuleCodeCache::putWasm(v8::Local<v8::WasmModuleObject> module) const {
+  wasmModules.lockExclusive()->add(module->GetCompiledModule());
+}
+
+namespace {
+// Feeds a module's source to V8's streaming compiler in a single chunk.
+class ModuleSourceStream final: public v8::ScriptCompiler::ExternalSourceStream {
+ public:
+  explicit ModuleSourceStream(kj::ArrayPtr<const char> source): source(source) {}
+
+  size_t GetMoreData(const uint8_t** src) override {
+    if (consumed) return 0;
+    consumed = true;
+
+    // V8 takes ownership of the returned buffer and frees it with delete[].
+    auto buffer = new uint8_t[source.size()];
+    memcpy(buffer, source.begin(), source.size());
+    *src = buffer;
+    return source.size();
+  }
+
+ private:
+  kj::ArrayPtr<const char> source;
+  bool consumed = false;
+};
+
+// Compiles the ES modules in `modules`, running V8's parser and compiler for each one on a
+// background thread and only finalizing compilation on this thread, under the isolate lock.
+//
+// Returns an array parallel to `modules`. Entries are null for modules that were not compiled
+// here: modules that aren't ES modules, modules that already have code cache on disk (which is
+// cheaper to consume on this thread), and every module if there isn't enough work to spread
+// across threads.
+kj::Array<kj::Maybe<jsg::ModuleRegistry::ModuleInfo>> compileEsModulesInParallel(jsg::Lock& js,
+    capnp::List<config::Worker::Module>::Reader modules,
+    const jsg::CompilationObserver& observer,
+    kj::Maybe<const ModuleCodeCache&> moduleCodeCache) {
+  TRACE_EVENT("workerd", "compileEsModulesInParallel()");
+
+  auto results = kj::heapArray<kj::Maybe<jsg::ModuleRegistry::ModuleInfo>>(modules.size());
+
+  struct PendingModule {
+    uint index;
+    kj::StringPtr name;
+    kj::ArrayPtr<const char> source;
+    kj::Own<v8::ScriptCompiler::StreamedSource> streamed;
+    std::unique_ptr<v8::ScriptCompiler::ScriptStreamingTask> task;
+  };
+  kj::Vector<PendingModule> pending;
+
+  for (auto i: kj::indices(modules)) {
+    auto module = modules[i];
+    if (!module.isEsModule()) continue;
+    kj::ArrayPtr<const char> source = module.getEsModule();
+    KJ_IF_SOME(cache, moduleCodeCache) {
+      if (cache.contains(source)) continue;
+    }
+    pending.add(PendingModule{.index = static_cast<uint>(i),
+      .name = module.getName(),
+      .source = source,
+      .streamed = nullptr,
+      .task = nullptr});
+  }
+
+  size_t threadCount = kj::min(pending.size(), size_t(std::thread::hardware_concurrency()));
+  if (threadCount < 2) {
+    return results;
+  }
+
+  for (auto& p: pending) {
+    p.streamed = kj::heap<v8::ScriptCompiler::StreamedSource>(
+        std::make_unique<ModuleSourceStream>(p.source),
+        v8::ScriptCompiler::StreamedSource::UTF8);
+    p.task.reset(
+        v8::ScriptCompiler::StartStreaming(js.v8Isolate, p.streamed.get(), v8::ScriptType::kModule));
+  }
+
+  {
+    // Streaming tasks don't need the isolate lock. The threads are joined when they go out of
+    // scope.
+    std::atomic<size_t> next = 0;
+    kj::Vector<kj::Own<kj::Thread>> threads(threadCount);
+    for (size_t t = 0; t < threadCount; t++) {
+      threads.add(kj::heap<kj::Thread>([&]() {
+        for (size_t j; (j = next++) < pending.size();) {
+          pending[j].task->Run();
+        }
+      }));
+    }
+  }
+
+  for (auto& p: pending) {
+    auto compilationObserver = observer.onEsmCompilationStart(
+        js.v8Isolate, p.name, jsg::CompilationObserver::Option::BUNDLE);
+
+    // Must match the origin used by the jsg module registry when compiling on this thread.
+    v8::ScriptOrigin origin(jsg::v8StrIntern(js.v8Isolate, p.name), 0, 0, false, -1, {}, false,
+        false, true /* isModule */);
+    auto module = jsg::check(v8::ScriptCompiler::CompileModule(
+        js.v8Context(), p.streamed.get(), jsg::v8Str(js.v8Isolate, p.source), origin));
+
+    KJ_IF_SOME(cache, moduleCodeCache) {
+      cache.put(p.source, module);
+    }
+    results[p.index] = jsg::ModuleRegistry::ModuleInfo(js, module);
+  }
+
+  return results;
+}
+}  // namespace
+
 kj::Maybe<jsg::ModuleRegistry::ModuleInfo> WorkerdApi::tryCompileModule(jsg::Lock& js,
     config::Worker::Module::Reader module,
     jsg::CompilationObserver& observer,
-    CompatibilityFlags::Reader featureFlags) {
+    CompatibilityFlags::Reader featureFlags,
+    kj::Maybe<const ModuleCodeCache&> moduleCodeCache) {
   TRACE_EVENT("workerd", "WorkerdApi::tryCompileModule()", "name", module.getName());
   auto& lock = kj::downcast<JsgWorkerdIsolate::Lock>(js);
   switch (module.which()) {
@@ -373,7 +593,7 @@ kj::Maybe<jsg::ModuleRegistry::ModuleInfo> WorkerdApi::tryCompileModule(jsg::Loc
     case config::Worker::Module::WASM: {
       return jsg::ModuleRegistry::ModuleInfo(lock, module.getName(), kj::none,
           jsg::ModuleRegistry::WasmModuleInfo(
-              lock, Impl::compileWasmGlobal(lock, module.getWasm(), observer)));
+              lock, Impl::compileWasmGlobal(lock, module.getWasm(), observer, moduleCodeCache)));
     }
     case config::Worker::Module::JSON: {
       return jsg::ModuleRegistry::ModuleInfo(lock, module.getName(), kj::none,
@@ -381,7 +601,20 @@ kj::Maybe<jsg::ModuleRegistry::ModuleInfo> WorkerdApi::tryCompileModule(jsg::Loc
               lock, Impl::compileJsonGlobal(lock, module.getJson())));
     }
     case config::Worker::Module::ES_MODULE: {
-      // TODO(soon): Make sure passing nullptr to compile cache is desired.
+      KJ_IF_SOME(cache, moduleCodeCache) {
+        auto source = module.getEsModule();
+        auto cached = cache.get(source);
+        kj::ArrayPtr<const kj::byte> compileCache = nullptr;
+        KJ_IF_SOME(c, cached) {
+          compileCache = c;
+        }
+        jsg::ModuleRegistry::ModuleInfo info(lock, module.getName(), source, compileCache,
+            jsg::ModuleInfoCompileOption::BUNDLE, observer);
+        if (cached == kj::none) {
+          cache.put(source, info.module.getHandle(lock));
+        }
+        return kj::mv(info);
+      }
       return jsg::ModuleRegistry::ModuleInfo(lock, module.getName(), module.getEsModule(),
           nullptr /* compile cache */, jsg::ModuleInfoCompileOption::BUNDLE, observer);
     }
@@ -581,9 +814,17 @@ void WorkerdApi::compileModules(jsg::Lock& lockParam,
           jsg::ModuleRegistry::Type::INTERNAL);
     }
 
-    for (auto module: confModules) {
+    auto precompiled = compileEsModulesInParallel(
+        lockParam, confModules, modules->getObserver(), impl->moduleCodeCache);
+
+    for (auto i: kj::indices(confModules)) {
+      auto module = confModules[i];
       auto path = kj::Path::parse(module.getName());
-      auto maybeInfo = tryCompileModule(lockParam, module, modules->getObserver(), featureFlags);
+      auto maybeInfo = kj::mv(precompiled[i]);
+      if (maybeInfo == kj::none) {
+        maybeInfo = tryCompileModule(
+            lockParam, module, modules->getObserver(), featureFlags, impl->moduleCodeCache);
+      }
       KJ_IF_SOME(info, maybeInfo) {
         modules->add(path, kj::mv(info));
       }
@@ -681,7 +922,8 @@ static v8::Local<v8::Value> createBindingValue(JsgWorkerdIsolate::Lock& lock,
                     .maxKeys = cache.maxKeys,
                     .maxValueSize = cache.maxValueSize,
                     .maxTotalValueSize = cache.maxTotalValueSize,
-                  })));
+                  }),
+              cache.shareDeserializedValues));
     }
 
     KJ_CASE_ONEOF(ns, Global::EphemeralActorNamespace) {
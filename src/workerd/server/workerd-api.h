@@ -8,6 +8,10 @@
 #include <workerd/jsg/modules-new.h>
 #include <workerd/server/workerd.capnp.h>
 
+#include <kj/filesystem.h>
+#include <kj/map.h>
+#include <kj/mutex.h>
+
 namespace workerd {
 namespace api {
 namespace pyodide {
@@ -29,6 +33,44 @@ namespace workerd::server {
 
 using api::pyodide::PythonConfig;
 
+// V8 code cache for ES modules, keyed by module source and shared by every isolate that compiles
+// through it. When several workers are built from the same modules, such as per-tenant copies of
+// one bundle, only the first compiles each module from scratch; the others consume its code
+// cache. If `dir` is given, entries are also read from and persisted to that directory, so that
+// they survive restarts (see `--module-code-cache-dir`).
+//
+// It also holds compiled Wasm modules, so that isolates loading the same Wasm bytes share one
+// native compilation. These are kept in memory only, since V8 offers no public API to load a
+// serialized Wasm module back.
+class ModuleCodeCache {
+ public:
+  explicit ModuleCodeCache(kj::Maybe<kj::Own<const kj::Directory>> dir = kj::none)
+      : dir(kj::mv(dir)) {}
+
+  // Returns whether there's a code cache for `source`, without reading it.
+  bool contains(kj::ArrayPtr<const char> source) const;
+
+  // Returns a copy of the code cache for `source`, if any.
+  kj::Maybe<kj::Array<kj::byte>> get(kj::ArrayPtr<const char> source) const;
+
+  // Records the code cache of `module`, which was compiled from `source`.
+  void put(kj::ArrayPtr<const char> source, v8::Local<v8::Module> module) const;
+
+  // Returns the compiled module for the Wasm binary `wasm`, if one was recorded.
+  kj::Maybe<v8::CompiledWasmModule> getWasm(kj::ArrayPtr<const kj::byte> wasm) const;
+
+  // Records the native compilation of `module`.
+  void putWasm(v8::Local<v8::WasmModuleObject> module) const;
+
+ private:
+  kj::Maybe<kj::Own<const kj::Directory>> dir;
+  // Keyed by the name of the entry's file in `dir`, which covers the source and V8 version.
+  kj::MutexGuarded<kj::HashMap<kj::String, kj::Array<kj::byte>>> entries;
+  // A process rarely loads more than a handful of distinct Wasm binaries, so these are simply
+  // matched against their wire bytes.
+  kj::MutexGuarded<kj::Vector<v8::CompiledWasmModule>> wasmModules;
+};
+
 // A Worker::Api implementation with support for all the APIs supported by the OSS runtime.
 class WorkerdApi final: public Worker::Api {
  public:
@@ -38,7 +80,8 @@ class WorkerdApi final: public Worker::Api {
       kj::Own<JsgIsolateObserver> observer,
       api::MemoryCacheProvider& memoryCacheProvider,
       const PythonConfig& pythonConfig,
-      kj::Maybe<kj::Own<jsg::modules::ModuleRegistry>> newModuleRegistry);
+      kj::Maybe<kj::Own<jsg::modules::ModuleRegistry>> newModuleRegistry,
+      kj::Maybe<const ModuleCodeCache&> moduleCodeCache = kj::none);
   ~WorkerdApi() noexcept(false);
 
   static const WorkerdApi& from(const Worker::Api&);
@@ -144,6 +187,7 @@ class WorkerdApi final: public Worker::Api {
       uint32_t maxKeys;
       uint32_t maxValueSize;
       uint64_t maxTotalValueSize;
+      bool shareDeserializedValues = false;
 
       MemoryCache clone() const {
         return MemoryCache{
@@ -151,6 +195,7 @@ class WorkerdApi final: public Worker::Api {
           .maxKeys = maxKeys,
           .maxValueSize = maxValueSize,
           .maxTotalValueSize = maxTotalValueSize,
+          .shareDeserializedValues = shareDeserializedValues,
         };
       }
     };
@@ -236,10 +281,13 @@ class WorkerdApi final: public Worker::Api {
       v8::Local<v8::Object> target,
       uint32_t ownerId) const;
 
+  // If `moduleCodeCache` is given, ES modules are compiled using the code cache it holds, and
+  // their code cache is added to it for modules that don't have one yet.
   static kj::Maybe<jsg::ModuleRegistry::ModuleInfo> tryCompileModule(jsg::Lock& js,
       config::Worker::Module::Reader conf,
       jsg::CompilationObserver& observer,
-      CompatibilityFlags::Reader featureFlags);
+      CompatibilityFlags::Reader featureFlags,
+      kj::Maybe<const ModuleCodeCache&> moduleCodeCache = kj::none);
 
   using ModuleFallbackCallback = Worker::Api::ModuleFallbackCallback;
   void setModuleFallbackCallback(kj::Function<ModuleFallbackCallback>&& callback) const override;
@@ -8,13 +8,16 @@
 #include <workerd/io/supported-compatibility-date.capnp.h>
 #include <workerd/jsg/setup.h>
 #include <workerd/rust/cxx-integration/lib.rs.h>
+#include <workerd/server/dns-cache.h>
 #include <workerd/server/v8-platform-impl.h>
 #include <workerd/server/workerd-meta.capnp.h>
 #include <workerd/server/workerd.capnp.h>
 #include <workerd/util/autogate.h>
+#include <workerd/util/log-writer.h>
+#include <workerd/util/random.h>
 
 #include <fcntl.h>
-#include <openssl/rand.h>
+#include <openssl/sha.h>
 #include <pyodide/generated/pyodide_extra.capnp.h>
 #include <sys/stat.h>
 
@@ -27,6 +30,8 @@
 #include <kj/filesystem.h>
 #include <kj/main.h>
 #include <kj/map.h>
+#include <kj/mutex.h>
+#include <kj/thread.h>
 
 #ifdef WORKERD_EXPERIMENTAL_ENABLE_WEBGPU
 #include <workerd/api/gpu/gpu.h>
@@ -42,6 +47,8 @@
 
 #include <iostream>
 #else
+#include <netdb.h>
+#include <netinet/in.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/syscall.h>
@@ -84,7 +91,7 @@ static kj::StringPtr getVersionString() {
 class EntropySourceImpl: public kj::EntropySource {
  public:
   void generate(kj::ArrayPtr<kj::byte> buffer) override {
-    KJ_ASSERT(RAND_bytes(buffer.begin(), buffer.size()) == 1);
+    getRandomBytes(buffer);
   }
 };
 
@@ -126,10 +133,73 @@ constexpr capnp::ReaderOptions CONFIG_READER_OPTIONS = {
 
 // =======================================================================================
 
+// Remembers what each watched file looked like when it was loaded, so that a change notification
+// can be checked against what's actually on disk. Editors and build tools often rewrite or touch
+// files without changing them, and reloading for those would restart every isolate for nothing.
+//
+// Each FileWatcher implementation below derives from this and calls snapshot() from watch().
+class WatchedFileSnapshots {
+ public:
+  // Records `path` as it is now. If `file` is provided, its content is compared later; otherwise
+  // (e.g. for our own executable, which can be large) only its size and modification time are.
+  void snapshot(kj::PathPtr path, kj::Maybe<const kj::ReadableFile&> file) {
+    KJ_IF_SOME(f, file) {
+      snapshots.upsert(path.clone(), takeSnapshot(f, true));
+    } else {
+      snapshots.upsert(path.clone(), takeSnapshot(path, false));
+    }
+  }
+
+  // Returns true if any watched file is missing or differs from its snapshot.
+  bool anyChanged() const {
+    for (auto& entry: snapshots) {
+      if (takeSnapshot(entry.key, entry.value.byContent) != entry.value) return true;
+    }
+    return false;
+  }
+
+ private:
+  struct Snapshot {
+    bool byContent;
+    bool exists = true;
+    uint64_t size = 0;
+    kj::Date lastModified = kj::UNIX_EPOCH;
+    kj::FixedArray<kj::byte, SHA256_DIGEST_LENGTH> digest = {};
+
+    bool operator==(const Snapshot& other) const {
+      return byContent == other.byContent && exists == other.exists && size == other.size &&
+          (byContent ? digest.asPtr() == other.digest.asPtr()
+                     : lastModified == other.lastModified);
+    }
+  };
+
+  static Snapshot takeSnapshot(const kj::ReadableFile& file, bool byContent) {
+    auto meta = file.stat();
+    Snapshot result{.byContent = byContent, .size = meta.size, .lastModified = meta.lastModified};
+    if (byContent) {
+      auto content = meta.size == 0 ? kj::Array<const kj::byte>() : file.mmap(0, meta.size);
+      SHA256(content.begin(), content.size(), result.digest.begin());
+    }
+    return result;
+  }
+
+  Snapshot takeSnapshot(kj::PathPtr path, bool byContent) const {
+    KJ_IF_SOME(file, fs->getRoot().tryOpenFile(path)) {
+      return takeSnapshot(*file, byContent);
+    }
+    return {.byContent = byContent, .exists = false};
+  }
+
+  kj::Own<kj::Filesystem> fs = kj::newDiskFilesystem();
+  kj::HashMap<kj::Path, Snapshot> snapshots;
+};
+
+// =======================================================================================
+
 #if __linux__
 
 // Class which uses inotify to watch a set of files and alert when they change.
-class FileWatcher {
+class FileWatcher: public WatchedFileSnapshots {
  public:
   FileWatcher(kj::UnixEventPort& port)
       : inotifyFd(makeInotify()),
@@ -140,7 +210,8 @@ class FileWatcher {
   }
 
   void watch(kj::PathPtr path, kj::Maybe<const kj::ReadableFile&> file) {
-    // `file` is provided if available. The Linux implementation doesn't use it.
+    // `file` is provided if available. inotify doesn't need it, but we snapshot its content.
+    snapshot(path, file);
 
     auto pathStr = path.parent().toNativeString(true);
 
@@ -218,7 +289,7 @@ class FileWatcher {
 //
 // Apple provides the FSEvents API as an alternative, but it seems way more complicated and I
 // can't tell if it would provide a real advantage. Plus, kqueue works on BSD systems.
-class FileWatcher {
+class FileWatcher: public WatchedFileSnapshots {
  public:
   FileWatcher(kj::UnixEventPort& port)
       : kqueueFd(makeKqueue()),
@@ -229,6 +300,7 @@ class FileWatcher {
   }
 
   void watch(kj::PathPtr path, kj::Maybe<const kj::ReadableFile&> file) {
+    snapshot(path, file);
     KJ_IF_SOME(f, file) {
       KJ_IF_SOME(fd, f.getFd()) {
         // We need to duplicate the FD because the original will probably be closed later and
@@ -298,7 +370,7 @@ class FileWatcher {
 
 #elif _WIN32
 
-class FileWatcher {
+class FileWatcher: public WatchedFileSnapshots {
  public:
   FileWatcher(kj::Win32EventPort& port) {}
 
@@ -318,7 +390,7 @@ class FileWatcher {
 #else
 
 // Dummy FileWatcher implementation for operating systems that aren't supported yet.
-class FileWatcher {
+class FileWatcher: public WatchedFileSnapshots {
  public:
   FileWatcher(kj::UnixEventPort& port) {}
 
@@ -760,14 +832,20 @@ class CliMain final: public SchemaFileImpl::ErrorReporter {
         // TODO(later): In the future, we might want to enable providing a perfetto
         // TraceConfig structure here rather than just the categories.
         .addOptionWithArg({"p", "perfetto-trace"}, CLI_METHOD(enablePerfetto),
-            "<path>=<categories>", "Enable perfetto tracing output to the specified file.")
+            "<path>=<categories>",
+            "Enable perfetto tracing output to the specified file. <categories> is a "
+            "comma-separated list of: workerd, workerd.lock, workerd.script, workerd.gc, "
+            "workerd.storage, workerd.sqlite, workerd.streams. Patterns like workerd* work too.")
 #endif
+        .addOptionWithArg({"console-log-format"}, CLI_METHOD(setConsoleLogFormat), "<format>",
+            "Write console.log() output in <format>: \"text\" (the default) or \"json\", which "
+            "writes one JSON object per line with \"level\" and \"message\" fields.")
         .addOption({'w', "watch"}, CLI_METHOD(watch),
             "Watch configuration files (and server binary) and reload if they change. "
             "Useful for development, but not recommended in production.")
         .addOption({"experimental"},
             [this]() {
-      server->allowExperimental();
+      configureServer([](Server& s) { s.allowExperimental(); });
       return true;
     },
             "Permit the use of experimental features which may break backwards "
@@ -778,6 +856,9 @@ class CliMain final: public SchemaFileImpl::ErrorReporter {
         .addOptionWithArg({"pyodide-bundle-disk-cache-dir"}, CLI_METHOD(setPyodideDiskCacheDir),
             "<path>",
             "Use <path> as a disk cache to avoid repeatedly fetching Pyodide bundles from the internet. ")
+        .addOptionWithArg({"module-code-cache-dir"}, CLI_METHOD(setModuleCodeCacheDir), "<path>",
+            "Use <path> as a disk cache of compiled ES modules, so that unchanged modules don't "
+            "need to be compiled from scratch every time the server starts or reloads.")
         .addOption({"python-save-snapshot"},
             [this]() {
       server->setPythonCreateSnapshot();
@@ -800,6 +881,16 @@ class CliMain final: public SchemaFileImpl::ErrorReporter {
         .addOptionWithArg({"control-fd"}, CLI_METHOD(enableControl), "<fd>",
             "Enable sending of control messages on descriptor <fd>. Currently this "
             "only reports the port each socket is listening on when ready.")
+        .addOptionWithArg({"control-input-fd"}, CLI_METHOD(enableControlInput), "<fd>",
+            "Read control commands, one per line, from descriptor <fd>. Replies are sent as "
+            "control messages on the descriptor given to --control-fd. "
+            "`heap-profile-start [<sample-interval-bytes>]` starts sampling allocations in all "
+            "isolates, and `heap-profile-stop <path>` writes the sampled allocations that are "
+            "still live to <path> in pprof format. `cpu-profile <seconds> <path> "
+            "[<service>...]` profiles CPU usage of the given services, or of all of them, "
+            "for <seconds> and writes the merged profile to <path> in pprof format. "
+            "`reload` restarts the server with the config re-read from disk, as --watch does "
+            "when a config file changes.")
         .callAfterParsing(CLI_METHOD(serve))
         .build();
   }
@@ -889,6 +980,14 @@ class CliMain final: public SchemaFileImpl::ErrorReporter {
         .build();
   }
 
+  // Applies `func` to `server` now, and also remembers it so that it can be applied to the
+  // additional Server created for each extra thread when `Config.threads` is greater than 1.
+  // `func` may be called again later from other threads, so it must not modify its captures.
+  void configureServer(kj::Function<void(Server&)> func) {
+    func(*server);
+    serverConfigurators.add(kj::mv(func));
+  }
+
   void addImportPath(kj::StringPtr pathStr) {
     auto path = fs->getCurrentPath().evalNative(pathStr);
     if (fs->getRoot().tryOpenSubdir(path) != kj::none) {
@@ -909,6 +1008,7 @@ class CliMain final: public SchemaFileImpl::ErrorReporter {
 
   void overrideSocketAddr(kj::StringPtr param) {
     auto [name, value] = parseOverride(param);
+    socketAddrOverrides.upsert(kj::str(name), kj::str(value));
     server->overrideSocket(kj::mv(name), kj::str(value));
   }
 
@@ -966,18 +1066,23 @@ class CliMain final: public SchemaFileImpl::ErrorReporter {
     validateSocketFd(fd, name);
 
     inheritedFds.add(fd);
+    socketFdOverrides.upsert(kj::str(name), fd);
     server->overrideSocket(kj::mv(name),
         io.lowLevelProvider->wrapListenSocketFd(fd, kj::LowLevelAsyncIoProvider::TAKE_OWNERSHIP));
   }
 
   void overrideDirectory(kj::StringPtr param) {
     auto [name, value] = parseOverride(param);
-    server->overrideDirectory(kj::mv(name), kj::str(value));
+    configureServer([name = kj::mv(name), value = kj::str(value)](Server& s) {
+      s.overrideDirectory(kj::str(name), kj::str(value));
+    });
   }
 
   void overrideExternal(kj::StringPtr param) {
     auto [name, value] = parseOverride(param);
-    server->overrideExternal(kj::mv(name), kj::str(value));
+    configureServer([name = kj::mv(name), value = kj::str(value)](Server& s) {
+      s.overrideExternal(kj::str(name), kj::str(value));
+    });
   }
 
 #if defined(WORKERD_USE_PERFETTO)
@@ -998,19 +1103,53 @@ class CliMain final: public SchemaFileImpl::ErrorReporter {
     server->enableControl(fd);
   }
 
+  void enableControlInput(kj::StringPtr param) {
+    int fd = KJ_UNWRAP_OR(param.tryParseAs<uint>(),
+        CLI_ERROR("Input value must be a file descriptor (non-negative integer)."));
+#if _WIN32
+    (void)fd;
+    CLI_ERROR("--control-input-fd is not yet supported on Windows.");
+#else
+    inheritedFds.add(fd);
+    server->enableControlInput(
+        io.lowLevelProvider->wrapInputFd(fd, kj::LowLevelAsyncIoProvider::TAKE_OWNERSHIP));
+#endif
+  }
+
   void setPackageDiskCacheDir(kj::StringPtr pathStr) {
     kj::Path path = fs->getCurrentPath().eval(pathStr);
     kj::Maybe<kj::Own<const kj::Directory>> dir =
         fs->getRoot().tryOpenSubdir(path, kj::WriteMode::MODIFY);
-    server->setPackageDiskCacheRoot(
-        kj::mv(KJ_UNWRAP_OR(dir, CLI_ERROR("package disk cache dir must exist"))));
+    configureServer([dir = kj::mv(KJ_UNWRAP_OR(dir, CLI_ERROR("package disk cache dir must exist")))](
+                        Server& s) { s.setPackageDiskCacheRoot(dir->clone()); });
   }
 
   void setPyodideDiskCacheDir(kj::StringPtr pathStr) {
     kj::Path path = fs->getCurrentPath().eval(pathStr);
     kj::Maybe<kj::Own<const kj::Directory>> dir =
         fs->getRoot().tryOpenSubdir(path, kj::WriteMode::MODIFY);
-    server->setPyodideDiskCacheRoot(kj::mv(dir));
+    configureServer([dir = kj::mv(dir)](Server& s) {
+      s.setPyodideDiskCacheRoot(
+          dir.map([](const kj::Own<const kj::Directory>& d) { return d->clone(); }));
+    });
+  }
+
+  void setModuleCodeCacheDir(kj::StringPtr pathStr) {
+    kj::Path path = fs->getCurrentPath().eval(pathStr);
+    kj::Maybe<kj::Own<const kj::Directory>> dir =
+        fs->getRoot().tryOpenSubdir(path, kj::WriteMode::MODIFY);
+    configureServer([dir = kj::mv(KJ_UNWRAP_OR(dir, CLI_ERROR("module code cache dir must exist")))](
+                        Server& s) { s.setModuleCodeCacheRoot(dir->clone()); });
+  }
+
+  void setConsoleLogFormat(kj::StringPtr format) {
+    if (format == "text") {
+      LogWriter::getStdio().setFormat(LogWriter::Format::TEXT);
+    } else if (format == "json") {
+      LogWriter::getStdio().setFormat(LogWriter::Format::JSON);
+    } else {
+      CLI_ERROR("Unknown console log format: ", format);
+    }
   }
 
   void watch() {
@@ -1284,6 +1423,11 @@ class CliMain final: public SchemaFileImpl::ErrorReporter {
         }));
       }
       promise.wait(io.waitScope);
+#if !_WIN32
+      // The extra serving threads use `v8System`, so they must exit before it is destroyed.
+      drainServingThreads();
+      servingThreads.clear();
+#endif
 #ifdef WORKERD_USE_PERFETTO
       KJ_IF_SOME(perfettoSession, maybePerfettoSession) {
         auto dropMe = kj::mv(perfettoSession);
@@ -1291,6 +1435,10 @@ class CliMain final: public SchemaFileImpl::ErrorReporter {
       }
 #endif
 
+      // console.log() output is written asynchronously, and context.exit() skips the static
+      // destructor that would otherwise flush it.
+      LogWriter::getStdio().flush();
+
       if (getenv("KJ_CLEAN_SHUTDOWN") == nullptr) {
         context.exit();
       }
@@ -1303,15 +1451,208 @@ class CliMain final: public SchemaFileImpl::ErrorReporter {
   void serve() noexcept {
     serveImpl([&](jsg::V8System& v8System, config::Config::Reader config) {
 #if _WIN32
+      if (config.getThreads() > 1) {
+        context.exitError("The `threads` config option is not supported on Windows.");
+      }
       return server->run(v8System, config);
 #else
-      return server->run(v8System, config,
-          // Gracefully drain when SIGTERM is received.
-          io.unixEventPort.onSignal(SIGTERM).ignoreResult());
+      if (exeInfo != kj::none) {
+        // Reload the same way --watch does, by re-executing ourselves with the same arguments.
+        server->setReloadCallback([this]() { reloadFromConfigChange("reload command"); });
+      }
+
+      // Gracefully drain when SIGTERM is received.
+      kj::Promise<void> drainWhen = io.unixEventPort.onSignal(SIGTERM).ignoreResult();
+      if (config.getThreads() > 1) {
+        startServingThreads(v8System, config);
+        drainWhen = drainWhen.then([this]() { drainServingThreads(); });
+      }
+      return server->run(v8System, config, kj::mv(drainWhen));
 #endif
     });
   }
 
+#if !_WIN32
+  // Binds a new listening socket on the given numeric host and port with SO_REUSEPORT set, so that
+  // each serving thread can bind its own socket to the same address and let the kernel balance
+  // incoming connections between them.
+  static kj::AutoCloseFd bindReusePortSocket(kj::StringPtr host, uint port) {
+    struct addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV | AI_PASSIVE;
+    auto portStr = kj::str(port);
+    struct addrinfo* results = nullptr;
+    int error = getaddrinfo(host.cStr(), portStr.cStr(), &hints, &results);
+    KJ_REQUIRE(error == 0, "getaddrinfo() failed", host, gai_strerror(error));
+    KJ_DEFER(freeaddrinfo(results));
+
+    int fd;
+    KJ_SYSCALL(fd = socket(results->ai_family, results->ai_socktype, results->ai_protocol));
+    kj::AutoCloseFd ownFd(fd);
+
+    int one = 1;
+    KJ_SYSCALL(setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)));
+    KJ_SYSCALL(setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)));
+    if (results->ai_family == AF_INET6) {
+      // Like KJ, accept IPv4 connections on IPv6 wildcard sockets.
+      int zero = 0;
+      KJ_SYSCALL(setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &zero, sizeof(zero)));
+    }
+    KJ_SYSCALL(bind(fd, results->ai_addr, results->ai_addrlen));
+    KJ_SYSCALL(listen(fd, SOMAXCONN));
+    return ownFd;
+  }
+
+  // Returns the port that a bound socket is actually listening on. This matters when the config
+  // asks for port 0, so that all threads end up bound to the same ephemeral port.
+  static uint getBoundPort(int fd) {
+    struct sockaddr_storage addr = {};
+    socklen_t addrlen = sizeof(addr);
+    KJ_SYSCALL(getsockname(fd, reinterpret_cast<struct sockaddr*>(&addr), &addrlen));
+    switch (addr.ss_family) {
+      case AF_INET:
+        return ntohs(reinterpret_cast<struct sockaddr_in*>(&addr)->sin_port);
+      case AF_INET6:
+        return ntohs(reinterpret_cast<struct sockaddr_in6*>(&addr)->sin6_port);
+    }
+    KJ_FAIL_REQUIRE("unexpected address family for listening socket", addr.ss_family);
+  }
+
+  struct ThreadSocket {
+    kj::String name;
+    kj::AutoCloseFd fd;
+  };
+
+  // Binds every configured socket once per thread with SO_REUSEPORT (or duplicates the descriptor
+  // passed with --socket-fd), hands the first set to `server`, and starts `threads - 1` additional
+  // threads which each run their own Server against the same config.
+  void startServingThreads(jsg::V8System& v8System, config::Config::Reader config) {
+    uint threadCount = config.getThreads();
+    auto perThread = kj::heapArray<kj::Vector<ThreadSocket>>(threadCount);
+
+    for (auto sock: config.getSockets()) {
+      kj::StringPtr name = sock.getName();
+
+      KJ_IF_SOME(fd, socketFdOverrides.find(name)) {
+        // Already put in place by overrideSocketFd() for the first thread; the rest accept on
+        // duplicates of the same descriptor.
+        for (auto& sockets: perThread.slice(1)) {
+          int dupFd;
+          KJ_SYSCALL(dupFd = dup(fd));
+          sockets.add(ThreadSocket{kj::str(name), kj::AutoCloseFd(dupFd)});
+        }
+        continue;
+      }
+
+      kj::StringPtr addrStr;
+      KJ_IF_SOME(addr, socketAddrOverrides.find(name)) {
+        addrStr = addr;
+      } else if (sock.hasAddress()) {
+        addrStr = sock.getAddress();
+      } else {
+        // Server::run() reports this error.
+        continue;
+      }
+
+      if (addrStr.startsWith("unix:") || addrStr.startsWith("unix-abstract:")) {
+        context.exitError(kj::str("Socket "", name,
+            "" is a Unix socket, which cannot be bound once per thread. Use `--socket-fd` to "
+            "share one descriptor between threads, or set `threads` to 1."));
+      }
+
+      uint defaultPort = sock.isHttps() ? 443 : 80;
+      auto parsed = network.parseAddress(addrStr, defaultPort).wait(io.waitScope);
+
+      // KJ renders resolved addresses numerically, e.g. "1.2.3.4:80" or "[::1]:80".
+      auto canonical = parsed->toString();
+      kj::String host;
+      uint port;
+      KJ_IF_SOME(colon, canonical.findLast(':')) {
+        auto hostPart = canonical.first(colon);
+        if (hostPart.startsWith("[") && hostPart.endsWith("]")) {
+          hostPart = hostPart.slice(1, hostPart.size() - 1);
+        }
+        host = hostPart == "*"_kj ? kj::str("::") : kj::str(hostPart);
+        port = KJ_REQUIRE_NONNULL(canonical.slice(colon + 1).tryParseAs<uint>(),
+            "couldn't parse port of socket address", canonical);
+      } else {
+        KJ_FAIL_REQUIRE("couldn't parse socket address", canonical);
+      }
+
+      for (auto& sockets: perThread) {
+        auto fd = bindReusePortSocket(host, port);
+        port = getBoundPort(fd);
+        sockets.add(ThreadSocket{kj::str(name), kj::mv(fd)});
+      }
+    }
+
+    for (auto& socket: perThread[0]) {
+      server->overrideSocket(kj::mv(socket.name),
+          io.lowLevelProvider->wrapListenSocketFd(
+              socket.fd.release(), kj::LowLevelAsyncIoProvider::TAKE_OWNERSHIP));
+    }
+
+    for (auto& sockets: perThread.slice(1)) {
+      servingThreads.add(kj::heap<kj::Thread>(
+          [this, &v8System, config, sockets = sockets.releaseAsArray()]() mutable {
+        runServingThread(v8System, config, sockets);
+      }));
+    }
+  }
+
+  void runServingThread(
+      jsg::V8System& v8System, config::Config::Reader config, kj::ArrayPtr<ThreadSocket> sockets) {
+    kj::AsyncIoContext threadIo = kj::setupAsyncIo();
+    DnsCachingNetwork threadDnsNetwork(
+        threadIo.provider->getNetwork(), threadIo.provider->getTimer(), DnsCache::getShared());
+    NetworkWithLoopback threadNetwork(threadDnsNetwork, *threadIo.provider);
+    EntropySourceImpl threadEntropySource;
+    auto threadFs = kj::newDiskFilesystem();
+
+    // The first thread has already validated the config, and exits on errors unless in --watch
+    // mode, so we only log errors here rather than report them again.
+    Server threadServer(*threadFs, threadIo.provider->getTimer(), threadNetwork,
+        threadEntropySource, Worker::ConsoleMode::STDOUT,
+        [](kj::String error) { KJ_LOG(ERROR, error); });
+    for (auto& configure: serverConfigurators) {
+      configure(threadServer);
+    }
+    for (auto& socket: sockets) {
+      threadServer.overrideSocket(kj::mv(socket.name),
+          threadIo.lowLevelProvider->wrapListenSocketFd(
+              socket.fd.release(), kj::LowLevelAsyncIoProvider::TAKE_OWNERSHIP));
+    }
+
+    auto paf = kj::newPromiseAndCrossThreadFulfiller<void>();
+    {
+      auto lock = drainState.lockExclusive();
+      if (lock->draining) {
+        paf.fulfiller->fulfill();
+      } else {
+        lock->fulfillers.add(kj::mv(paf.fulfiller));
+      }
+    }
+
+    KJ_IF_SOME(exception, kj::runCatchingExceptions([&]() {
+      threadServer.run(v8System, config, kj::mv(paf.promise)).wait(threadIo.waitScope);
+    })) {
+      KJ_LOG(ERROR, "serving thread failed", exception);
+      _exit(1);
+    }
+  }
+
+  // Tells all extra serving threads to start draining.
+  void drainServingThreads() {
+    auto lock = drainState.lockExclusive();
+    lock->draining = true;
+    for (auto& fulfiller: lock->fulfillers) {
+      fulfiller->fulfill();
+    }
+    lock->fulfillers.clear();
+  }
+#endif
+
   void test() {
     if (!noVerbose) {
       // Always turn on info logging when running tests so that uncaught exceptions are displayed.
@@ -1345,14 +1686,14 @@ class CliMain final: public SchemaFileImpl::ErrorReporter {
   }
 
 #if _WIN32
-  void reloadFromConfigChange() {
+  void reloadFromConfigChange(kj::StringPtr reason = "config change") {
     KJ_UNREACHABLE("Watching is not yet implemented on Windows");
   }
 #else
-  [[noreturn]] void reloadFromConfigChange() {
+  [[noreturn]] void reloadFromConfigChange(kj::StringPtr reason = "config change") {
     // Write extra spaces to fully overwrite the line that we wrote earlier with a CR but no LF:
     //     "Noticed configuration change, reloading shortly...\r"
-    context.warning("Reloading due to config change...                                      ");
+    context.warning(kj::str("Reloading due to ", reason, "...                                 "));
     for (auto fd: inheritedFds) {
       // Disable close-on-exec for inherited FDs so that the successor process can also inherit
       // them.
@@ -1389,7 +1730,11 @@ class CliMain final: public SchemaFileImpl::ErrorReporter {
 
   kj::Own<kj::Filesystem> fs = kj::newDiskFilesystem();
   kj::AsyncIoContext io = kj::setupAsyncIo();
-  NetworkWithLoopback network{io.provider->getNetwork(), *io.provider};
+
+  // Hostname lookups go through the process-wide DNS cache, shared with the serving threads.
+  DnsCachingNetwork dnsNetwork{
+    io.provider->getNetwork(), io.provider->getTimer(), DnsCache::getShared()};
+  NetworkWithLoopback network{dnsNetwork, *io.provider};
   EntropySourceImpl entropySource;
 
   kj::Vector<kj::Path> importPath;
@@ -1402,6 +1747,25 @@ class CliMain final: public SchemaFileImpl::ErrorReporter {
 
   kj::Vector<int> inheritedFds;
 
+  // Socket overrides from the command line, remembered so that they can be re-bound for each
+  // thread when `Config.threads` is greater than 1.
+  kj::HashMap<kj::String, kj::String> socketAddrOverrides;
+  kj::HashMap<kj::String, int> socketFdOverrides;
+
+  // See configureServer().
+  kj::Vector<kj::Function<void(Server&)>> serverConfigurators;
+
+#if !_WIN32
+  struct DrainState {
+    bool draining = false;
+    kj::Vector<kj::Own<kj::CrossThreadPromiseFulfiller<void>>> fulfillers;
+  };
+  kj::MutexGuarded<DrainState> drainState;
+
+  // Additional threads started when `Config.threads` is greater than 1.
+  kj::Vector<kj::Own<kj::Thread>> servingThreads;
+#endif
+
   kj::Maybe<kj::String> testServicePattern;
   kj::Maybe<kj::String> testEntrypointPattern;
 
@@ -1537,19 +1901,9 @@ class CliMain final: public SchemaFileImpl::ErrorReporter {
   }
 #else
   // Wait for the FileWatcher to report a change, and then wait a moment for changes to settle
-  // down, in case there's a bunch of changes all at once.
+  // down, in case there's a bunch of changes all at once. Changes that leave every watched file
+  // as it was when we loaded it are ignored.
   kj::Promise<void> waitForChanges(FileWatcher& watcher) {
-    co_await watcher.onChange();
-
-    // Saw our first change!
-
-    // Let the user know we saw the config change.
-    // We don't include a newline but rather a carriage return so that when the next
-    // line is written, this line disappears, to reduce noise.
-    // TODO(cleanup): Writing directly to stderr is super-hacky.
-    auto message = "Noticed configuration change, reloading shortly...\r"_kjb;
-    kj::FdOutputStream(STDERR_FILENO).write(message);
-
     static auto const waitForResult = [](kj::Promise<void> promise,
                                           bool result = false) -> kj::Promise<bool> {
       co_await promise;
@@ -1557,17 +1911,33 @@ class CliMain final: public SchemaFileImpl::ErrorReporter {
     };
 
     for (;;) {
-      auto nextChange = waitForResult(watcher.onChange());
-      auto timeout =
-          waitForResult(io.provider->getTimer().afterDelay(500 * kj::MILLISECONDS), true);
-      bool sawTimeout = co_await nextChange.exclusiveJoin(kj::mv(timeout));
-
-      // If we timed out, we end the loop. If we didn't time out, then we must have seen yet
-      // another change, so we loop again with a new timeout.
-      if (sawTimeout) break;
-    }
+      co_await watcher.onChange();
+
+      // Saw our first change!
+
+      // Let the user know we saw the config change.
+      // We don't include a newline but rather a carriage return so that when the next
+      // line is written, this line disappears, to reduce noise.
+      // TODO(cleanup): Writing directly to stderr is super-hacky.
+      auto message = "Noticed configuration change, reloading shortly...\r"_kjb;
+      kj::FdOutputStream(STDERR_FILENO).write(message);
+
+      for (;;) {
+        auto nextChange = waitForResult(watcher.onChange());
+        auto timeout =
+            waitForResult(io.provider->getTimer().afterDelay(500 * kj::MILLISECONDS), true);
+        bool sawTimeout = co_await nextChange.exclusiveJoin(kj::mv(timeout));
+
+        // If we timed out, we end the loop. If we didn't time out, then we must have seen yet
+        // another change, so we loop again with a new timeout.
+        if (sawTimeout) break;
+      }
+
+      if (watcher.anyChanged()) co_return;
 
-    co_return;
+      // Overwrite the line written above, as in reloadFromConfigChange().
+      context.warning("Config files were touched but not changed, not reloading.          ");
+    }
   }
 #endif
 };
@@ -0,0 +1,52 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/io/actor-cache.h>
+#include <workerd/tests/bench-tools.h>
+
+// Measures the memory overhead of ActorCache entries for counter-style workloads, i.e. many tiny
+// keys with tiny values. Reports the number of bytes `SharedLru` accounts for each entry.
+
+namespace workerd {
+namespace {
+
+constexpr uint ENTRY_COUNT = 10000;
+
+static void ActorCache_SmallEntries(benchmark::State& state) {
+  // With `neverFlush`, puts just stay in the dirty list, so no storage is needed.
+  ActorCache::SharedLru lru({
+    .softLimit = kj::maxValue,
+    .hardLimit = kj::maxValue,
+    .staleTimeout = 30 * kj::SECONDS,
+    .dirtyListByteLimit = kj::maxValue,
+    .maxKeysPerRpc = 128,
+    .neverFlush = true,
+  });
+
+  size_t bytesPerEntry = 0;
+  for (auto _: state) {
+    kj::EventLoop loop;
+    kj::WaitScope ws(loop);
+    OutputGate gate;
+    ActorCache cache(
+        rpc::ActorStorage::Stage::Client(KJ_EXCEPTION(FAILED, "no storage in benchmark")), lru, gate);
+
+    for (uint i = 0; i < ENTRY_COUNT; i++) {
+      // A v8-serialized small integer is a handful of bytes.
+      auto value = kj::heapArray<byte>({0xff, 0x0f, 0x49, static_cast<byte>(i & 0x7f)});
+      benchmark::DoNotOptimize(
+          cache.put(kj::str("counter-", i), kj::mv(value), ActorCache::WriteOptions()));
+    }
+
+    bytesPerEntry = lru.currentSize() / ENTRY_COUNT;
+  }
+
+  state.counters["bytes_per_entry"] = bytesPerEntry;
+  state.SetItemsProcessed(state.iterations() * ENTRY_COUNT);
+}
+
+WD_BENCHMARK(ActorCache_SmallEntries);
+
+}  // namespace
+}  // namespace workerd
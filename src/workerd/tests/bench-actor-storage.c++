@@ -0,0 +1,383 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/io/actor-cache.h>
+#include <workerd/io/actor-sqlite.h>
+#include <workerd/io/io-gate.h>
+#include <workerd/tests/bench-tools.h>
+
+#include <kj/async-io.h>
+#include <kj/filesystem.h>
+
+#include <algorithm>
+#include <map>
+#include <random>
+
+// Durable Object storage benchmarks, run against both ActorCache and ActorSqlite.
+//
+// Every benchmark takes two arguments: the size of the values written and read, and the latency of
+// the storage underneath, in microseconds. For ActorCache the latency applies to every call to the
+// in-memory ActorStorage below; for ActorSqlite it applies to each commit, standing in for
+// replication. Write benchmarks wait for each write to be flushed, so they measure the latency an
+// application sees from sync().
+
+namespace workerd {
+namespace {
+
+// An in-memory rpc::ActorStorage, answering each call after a fixed delay.
+class MemoryStore {
+ public:
+  MemoryStore(kj::Timer& timer, kj::Duration latency): timer(timer), latency(latency) {}
+
+  kj::Promise<void> delay() {
+    if (latency == 0 * kj::SECONDS) return kj::READY_NOW;
+    return timer.afterDelay(latency);
+  }
+
+  using Entries = std::map<kj::String, kj::Array<kj::byte>>;
+  Entries entries;
+
+ private:
+  kj::Timer& timer;
+  kj::Duration latency;
+};
+
+kj::String toKey(capnp::Data::Reader key) {
+  return kj::str(key.asChars());
+}
+
+class MemoryOperations: public virtual rpc::ActorStorage::Operations::Server {
+ public:
+  explicit MemoryOperations(MemoryStore& store): store(store) {}
+
+  kj::Promise<void> get(GetContext context) override {
+    co_await store.delay();
+    auto iter = store.entries.find(toKey(context.getParams().getKey()));
+    if (iter != store.entries.end()) {
+      context.getResults().setValue(iter->second);
+    }
+  }
+
+  kj::Promise<void> getMultiple(GetMultipleContext context) override {
+    co_await store.delay();
+    auto params = context.getParams();
+    kj::Vector<MemoryStore::Entries::const_iterator> found;
+    for (auto key: params.getKeys()) {
+      auto iter = store.entries.find(toKey(key));
+      if (iter != store.entries.end()) {
+        found.add(iter);
+      }
+    }
+    co_await sendEntries(params.getStream(), found);
+  }
+
+  kj::Promise<void> list(ListContext context) override {
+    co_await store.delay();
+    auto params = context.getParams();
+    auto begin = store.entries.lower_bound(toKey(params.getStart()));
+    auto end = params.hasEnd() ? store.entries.lower_bound(toKey(params.getEnd()))
+                               : store.entries.end();
+    kj::Vector<MemoryStore::Entries::const_iterator> found;
+    for (auto iter = begin; iter != end && iter != store.entries.end(); ++iter) {
+      found.add(iter);
+    }
+    if (params.getReverse()) {
+      std::reverse(found.begin(), found.end());
+    }
+    if (params.getLimit() > 0 && found.size() > params.getLimit()) {
+      found.truncate(params.getLimit());
+    }
+    co_await sendEntries(params.getStream(), found);
+  }
+
+  kj::Promise<void> put(PutContext context) override {
+    co_await store.delay();
+    for (auto entry: context.getParams().getEntries()) {
+      store.entries[toKey(entry.getKey())] = kj::heapArray(entry.getValue());
+    }
+  }
+
+  kj::Promise<void> delete_(DeleteContext context) override {
+    co_await store.delay();
+    int32_t count = 0;
+    for (auto key: context.getParams().getKeys()) {
+      count += store.entries.erase(toKey(key));
+    }
+    context.getResults().setNumDeleted(count);
+  }
+
+ protected:
+  MemoryStore& store;
+
+ private:
+  // Builds the message before waiting, so later writes to the store don't affect it.
+  kj::Promise<void> sendEntries(rpc::ActorStorage::ListStream::Client stream,
+      kj::ArrayPtr<const MemoryStore::Entries::const_iterator> found) {
+    auto req = stream.valuesRequest();
+    auto list = req.initList(found.size());
+    for (auto i: kj::indices(found)) {
+      list[i].setKey(found[i]->first.asBytes());
+      list[i].setValue(found[i]->second);
+    }
+    co_await req.send();
+    co_await stream.endRequest().send();
+  }
+};
+
+// Transactions apply their writes immediately: ActorCache only writes in them, and never reads
+// its own writes back, so there's nothing to isolate.
+class MemoryTransaction final: public rpc::ActorStorage::Stage::Transaction::Server,
+                               public MemoryOperations {
+ public:
+  using MemoryOperations::MemoryOperations;
+
+  kj::Promise<void> commit(CommitContext context) override {
+    return store.delay();
+  }
+  kj::Promise<void> rollback(RollbackContext context) override {
+    return kj::READY_NOW;
+  }
+};
+
+class MemoryStage final: public rpc::ActorStorage::Stage::Server, public MemoryOperations {
+ public:
+  using MemoryOperations::MemoryOperations;
+
+  kj::Promise<void> txn(TxnContext context) override {
+    context.getResults().setTransaction(kj::heap<MemoryTransaction>(store));
+    return kj::READY_NOW;
+  }
+};
+
+template <typename T>
+T resolve(kj::OneOf<T, kj::Promise<T>> result, kj::WaitScope& ws) {
+  KJ_SWITCH_ONEOF(result) {
+    KJ_CASE_ONEOF(promise, kj::Promise<T>) {
+      return promise.wait(ws);
+    }
+    KJ_CASE_ONEOF(value, T) {
+      return kj::mv(value);
+    }
+  }
+  KJ_UNREACHABLE;
+}
+
+class StorageBench: public benchmark::Fixture {
+ public:
+  static constexpr uint KEY_COUNT = 256;
+
+  virtual ~StorageBench() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    value = kj::heapArray<kj::byte>(state.range(0));
+    memset(value.begin(), 'v', value.size());
+
+    keys = KJ_MAP(i, kj::zeroTo(KEY_COUNT)) { return kj::str("key-", 100000 + i); };
+    randomOrder = KJ_MAP(i, kj::zeroTo(KEY_COUNT)) { return i; };
+    std::shuffle(randomOrder.begin(), randomOrder.end(), std::mt19937(12345));
+
+    auto& context = io.emplace(kj::setupAsyncIo());
+    storage = makeStorage(context.provider->getTimer(), state.range(1) * kj::MICROSECONDS);
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    storage = nullptr;
+    io = kj::none;
+  }
+
+  kj::WaitScope& ws() {
+    return KJ_ASSERT_NONNULL(io).waitScope;
+  }
+
+  kj::StringPtr randomKey(uint i) {
+    return keys[randomOrder[i % KEY_COUNT]];
+  }
+
+  void put(ActorCacheOps& ops, kj::StringPtr key, ActorCache::WriteOptions options = {}) {
+    KJ_IF_SOME(backpressure, ops.put(kj::str(key), kj::heapArray(value.asPtr()), options)) {
+      backpressure.wait(ws());
+    }
+  }
+
+  void flush() {
+    KJ_IF_SOME(promise, storage->onNoPendingFlush()) {
+      promise.wait(ws());
+    }
+  }
+
+  // Writes every key and waits for the writes to reach storage.
+  void seed(ActorCache::WriteOptions options = {}) {
+    for (auto& key: keys) {
+      put(*storage, key, options);
+    }
+    flush();
+  }
+
+  kj::Array<kj::byte> value;
+  kj::Array<kj::String> keys;
+  kj::Array<uint> randomOrder;
+
+  kj::Maybe<kj::AsyncIoContext> io;
+  kj::Own<ActorCacheInterface> storage;
+
+ protected:
+  virtual kj::Own<ActorCacheInterface> makeStorage(kj::Timer& timer, kj::Duration latency) = 0;
+};
+
+class ActorCacheBench: public StorageBench {
+ protected:
+  kj::Own<ActorCacheInterface> makeStorage(kj::Timer& timer, kj::Duration latency) override {
+    auto store = kj::heap<MemoryStore>(timer, latency);
+    rpc::ActorStorage::Stage::Client client = kj::heap<MemoryStage>(*store);
+    auto lru = kj::heap<ActorCache::SharedLru>(ActorCache::SharedLru::Options{
+      .softLimit = 512 * 1024 * 1024,
+      .hardLimit = 1024 * 1024 * 1024,
+      .staleTimeout = 30 * kj::SECONDS,
+      .dirtyListByteLimit = 8 * 1024 * 1024,
+      .maxKeysPerRpc = 128,
+    });
+    auto gate = kj::heap<OutputGate>();
+    return kj::heap<ActorCache>(kj::mv(client), *lru, *gate)
+        .attach(kj::mv(gate), kj::mv(lru), kj::mv(store));
+  }
+};
+
+class ActorSqliteBench: public StorageBench {
+ protected:
+  kj::Own<ActorCacheInterface> makeStorage(kj::Timer& timer, kj::Duration latency) override {
+    auto dir = kj::newInMemoryDirectory(kj::nullClock());
+    auto vfs = kj::heap<SqliteDatabase::Vfs>(*dir);
+    auto db = kj::heap<SqliteDatabase>(
+        *vfs, kj::Path({"bench"}), kj::WriteMode::CREATE | kj::WriteMode::MODIFY);
+    auto gate = kj::heap<OutputGate>();
+    auto commit = [&timer, latency]() -> kj::Promise<void> {
+      if (latency == 0 * kj::SECONDS) return kj::READY_NOW;
+      return timer.afterDelay(latency);
+    };
+    auto& gateRef = *gate;
+    return kj::heap<ActorSqlite>(kj::mv(db), gateRef, kj::mv(commit))
+        .attach(kj::mv(gate), kj::mv(vfs), kj::mv(dir));
+  }
+};
+
+void storageArgs(benchmark::internal::Benchmark* b) {
+  b->ArgsProduct({{8, 1024, 16 * 1024, 128 * 1024}, {0, 1000}})
+      ->ArgNames({"value_bytes", "latency_us"})
+      ->Unit(benchmark::kMicrosecond);
+}
+
+void putSequential(StorageBench& bench, benchmark::State& state) {
+  uint i = 0;
+  for (auto _: state) {
+    bench.put(*bench.storage, bench.keys[i++ % StorageBench::KEY_COUNT]);
+    bench.flush();
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * bench.value.size());
+}
+
+void putRandom(StorageBench& bench, benchmark::State& state) {
+  uint i = 0;
+  for (auto _: state) {
+    bench.put(*bench.storage, bench.randomKey(i++));
+    bench.flush();
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * bench.value.size());
+}
+
+// For ActorCache, every read is a cache hit.
+void getRandom(StorageBench& bench, benchmark::State& state) {
+  bench.seed();
+  uint i = 0;
+  for (auto _: state) {
+    auto result = resolve(bench.storage->get(kj::str(bench.randomKey(i++)), {}), bench.ws());
+    benchmark::DoNotOptimize(KJ_ASSERT_NONNULL(result).size());
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * bench.value.size());
+}
+
+void list100(StorageBench& bench, benchmark::State& state) {
+  constexpr uint LIMIT = 100;
+  bench.seed();
+  uint i = 0;
+  for (auto _: state) {
+    auto begin = bench.keys[bench.randomOrder[i++ % StorageBench::KEY_COUNT] %
+        (StorageBench::KEY_COUNT - LIMIT)];
+    auto result = resolve(bench.storage->list(kj::str(begin), kj::none, LIMIT, {}), bench.ws());
+    KJ_ASSERT(result.size() == LIMIT);
+  }
+  state.SetItemsProcessed(state.iterations() * LIMIT);
+  state.SetBytesProcessed(state.iterations() * LIMIT * bench.value.size());
+}
+
+void deleteRandom(StorageBench& bench, benchmark::State& state) {
+  bench.seed();
+  uint i = 0;
+  for (auto _: state) {
+    if (i > 0 && i % StorageBench::KEY_COUNT == 0) {
+      state.PauseTiming();
+      bench.seed();
+      state.ResumeTiming();
+    }
+    resolve(bench.storage->delete_(kj::str(bench.randomKey(i++)), {}), bench.ws());
+    bench.flush();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// A read-modify-write transaction: two reads, two writes and a delete.
+void transactionMix(StorageBench& bench, benchmark::State& state) {
+  bench.seed();
+  uint i = 0;
+  for (auto _: state) {
+    auto txn = bench.storage->startTransaction();
+    resolve(txn->get(kj::str(bench.randomKey(i)), {}), bench.ws());
+    resolve(txn->get(kj::str(bench.randomKey(i + 1)), {}), bench.ws());
+    bench.put(*txn, bench.randomKey(i + 2));
+    bench.put(*txn, bench.randomKey(i + 3));
+    resolve(txn->delete_(kj::str(bench.randomKey(i + 4)), {}), bench.ws());
+    KJ_IF_SOME(backpressure, txn->commit()) {
+      backpressure.wait(bench.ws());
+    }
+    bench.flush();
+    i += 5;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+#define STORAGE_BENCHMARK(name)                                                                    \
+  BENCHMARK_DEFINE_F(ActorCacheBench, name)(benchmark::State & state) {                           \
+    name(*this, state);                                                                            \
+  }                                                                                                \
+  BENCHMARK_REGISTER_F(ActorCacheBench, name)->Apply(storageArgs);                                 \
+  BENCHMARK_DEFINE_F(ActorSqliteBench, name)(benchmark::State & state) {                          \
+    name(*this, state);                                                                            \
+  }                                                                                                \
+  BENCHMARK_REGISTER_F(ActorSqliteBench, name)->Apply(storageArgs)
+
+STORAGE_BENCHMARK(putSequential);
+STORAGE_BENCHMARK(putRandom);
+STORAGE_BENCHMARK(getRandom);
+STORAGE_BENCHMARK(list100);
+STORAGE_BENCHMARK(deleteRandom);
+STORAGE_BENCHMARK(transactionMix);
+
+// Every read misses the cache and goes to storage. ActorSqlite has no cache of its own above
+// SQLite, so there's no counterpart for it.
+BENCHMARK_DEFINE_F(ActorCacheBench, getCacheMiss)(benchmark::State& state) {
+  seed({.noCache = true});
+  uint i = 0;
+  for (auto _: state) {
+    auto result = resolve(storage->get(kj::str(randomKey(i++)), {.noCache = true}), ws());
+    benchmark::DoNotOptimize(KJ_ASSERT_NONNULL(result).size());
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * value.size());
+}
+BENCHMARK_REGISTER_F(ActorCacheBench, getCacheMiss)->Apply(storageArgs);
+
+}  // namespace
+}  // namespace workerd
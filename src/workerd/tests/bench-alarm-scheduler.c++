@@ -0,0 +1,88 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/server/alarm-scheduler.h>
+#include <workerd/tests/bench-tools.h>
+
+#include <kj/async.h>
+#include <kj/filesystem.h>
+
+// Measures the cost of scheduling and rescheduling many alarms, including writing them to the
+// alarm database.
+
+namespace workerd::server {
+namespace {
+
+struct AlarmSchedulerBench {
+  kj::EventLoop loop;
+  kj::WaitScope waitScope{loop};
+  kj::TimerImpl timer{kj::origin<kj::TimePoint>()};
+  const kj::Clock& clock = kj::systemPreciseCalendarClock();
+  kj::Own<const kj::Directory> dir = kj::newInMemoryDirectory(clock);
+  SqliteDatabase::Vfs vfs{*dir};
+  kj::Vector<kj::String> actorIds;
+
+  explicit AlarmSchedulerBench(size_t count) {
+    actorIds.reserve(count);
+    for (auto i: kj::zeroTo(count)) {
+      actorIds.add(kj::str("actor-", i));
+    }
+  }
+
+  ActorKey actor(size_t i) {
+    return {.uniqueKey = "bench", .actorId = actorIds[i]};
+  }
+};
+
+static void AlarmScheduler_Set(benchmark::State& state) {
+  size_t count = state.range(0);
+  AlarmSchedulerBench bench(count);
+
+  for (auto _: state) {
+    AlarmScheduler scheduler(bench.clock, bench.timer, bench.vfs, kj::Path({"alarms.sqlite"}));
+    auto time = bench.clock.now() + 1 * kj::HOURS;
+    for (auto i: kj::zeroTo(count)) {
+      scheduler.setAlarm(bench.actor(i), time + i * kj::MILLISECONDS);
+    }
+    // Lets the scheduler write the alarms to the database.
+    bench.waitScope.poll();
+
+    state.PauseTiming();
+    for (auto i: kj::zeroTo(count)) {
+      scheduler.deleteAlarm(bench.actor(i));
+    }
+    bench.waitScope.poll();
+    state.ResumeTiming();
+  }
+
+  state.SetItemsProcessed(state.iterations() * count);
+}
+
+static void AlarmScheduler_Reschedule(benchmark::State& state) {
+  size_t count = state.range(0);
+  AlarmSchedulerBench bench(count);
+  AlarmScheduler scheduler(bench.clock, bench.timer, bench.vfs, kj::Path({"alarms.sqlite"}));
+  auto time = bench.clock.now() + 1 * kj::HOURS;
+  for (auto i: kj::zeroTo(count)) {
+    scheduler.setAlarm(bench.actor(i), time + i * kj::MILLISECONDS);
+  }
+  bench.waitScope.poll();
+
+  // Moves every alarm to a later time, so each one changes its place in the queue.
+  for (auto _: state) {
+    time = time + 1 * kj::SECONDS;
+    for (auto i: kj::zeroTo(count)) {
+      scheduler.setAlarm(bench.actor(i), time + (count - i) * kj::MILLISECONDS);
+    }
+    bench.waitScope.poll();
+  }
+
+  state.SetItemsProcessed(state.iterations() * count);
+}
+
+WD_BENCHMARK(AlarmScheduler_Set)->Arg(1000)->Arg(1000000);
+WD_BENCHMARK(AlarmScheduler_Reschedule)->Arg(1000)->Arg(1000000);
+
+}  // namespace
+}  // namespace workerd::server
@@ -56,5 +56,17 @@ BENCHMARK_F(ApiHeaders, constructor)(benchmark::State& state) {
   });
 }
 
+// iteration snapshots the header map by reference, benchmark it
+BENCHMARK_F(ApiHeaders, entries)(benchmark::State& state) {
+  fixture->runInIoContext([&](const TestFixture::Environment& env) {
+    auto jsHeaders = jsg::alloc<api::Headers>(*kjHeaders, api::Headers::Guard::REQUEST);
+    for (auto _: state) {
+      auto iter = jsHeaders->entries(env.js);
+      while (!iter->next(env.js).done) {
+      }
+    }
+  });
+}
+
 }  // namespace
 }  // namespace workerd
@@ -0,0 +1,66 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/jsg/async-context.h>
+#include <workerd/jsg/jsg.h>
+#include <workerd/jsg/setup.h>
+#include <workerd/tests/bench-tools.h>
+
+// Measures entering an AsyncLocalStorage scope, as `als.run()` does, while a number of other
+// stores (given by the benchmark argument) are already set, as when a framework nests several
+// AsyncLocalStorage instances for tracing, request ids and so on. Each iteration enters one
+// new scope and reads every store from it.
+
+namespace workerd {
+namespace {
+
+using jsg::AsyncContextFrame;
+
+struct AsyncContextContext: public jsg::Object, public jsg::ContextGlobal {
+  JSG_RESOURCE_TYPE(AsyncContextContext) {}
+};
+JSG_DECLARE_ISOLATE_TYPE(AsyncContextIsolate, AsyncContextContext);
+
+jsg::V8System& getV8System() {
+  static jsg::V8System v8System;
+  return v8System;
+}
+
+void AsyncContext_RunNested(benchmark::State& state) {
+  AsyncContextIsolate isolate(getV8System(), kj::heap<jsg::IsolateObserver>());
+  isolate.runInLockScope([&](AsyncContextIsolate::Lock& lock) {
+    JSG_WITHIN_CONTEXT_SCOPE(lock, lock.newContext<AsyncContextContext>().getHandle(lock),
+        [&](jsg::Lock& js) {
+      auto keys = KJ_MAP(i, kj::zeroTo(state.range(0))) {
+        return kj::refcounted<AsyncContextFrame::StorageKey>();
+      };
+
+      kj::Vector<kj::Own<AsyncContextFrame::StorageScope>> outer;
+      for (auto i: kj::indices(keys)) {
+        outer.add(kj::heap<AsyncContextFrame::StorageScope>(
+            js, *keys[i], js.v8Ref<v8::Value>(js.num(static_cast<uint32_t>(i)))));
+      }
+
+      for (auto _: state) {
+        js.withinHandleScope([&] {
+          AsyncContextFrame::StorageScope scope(js, *keys[0], js.v8Ref<v8::Value>(js.num(-1)));
+          auto& frame = KJ_ASSERT_NONNULL(AsyncContextFrame::current(js));
+          for (auto& key: keys) {
+            benchmark::DoNotOptimize(frame.get(*key));
+          }
+        });
+      }
+
+      // Exit the scopes innermost first.
+      while (!outer.empty()) {
+        outer.removeLast();
+      }
+    });
+  });
+}
+
+WD_BENCHMARK(AsyncContext_RunNested)->Arg(1)->Arg(4)->Arg(16);
+
+}  // namespace
+}  // namespace workerd
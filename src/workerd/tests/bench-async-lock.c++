@@ -0,0 +1,64 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/tests/test-fixture.h>
+
+#include <kj/thread.h>
+
+// A benchmark for handing off a Worker::AsyncLock between threads. Each thread repeatedly takes and
+// releases the async lock on the same isolate, so with N threads there are up to N waiters queued
+// at any time.
+
+namespace workerd {
+namespace {
+
+constexpr uint LOCKS_PER_THREAD = 1000;
+
+struct AsyncLockBenchmark: public benchmark::Fixture {
+  virtual ~AsyncLockBenchmark() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    fixture = kj::heap<TestFixture>();
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    fixture = nullptr;
+  }
+
+  kj::Own<TestFixture> fixture;
+};
+
+BENCHMARK_DEFINE_F(AsyncLockBenchmark, handoff)(benchmark::State& state) {
+  auto& worker = fixture->getWorker();
+  uint threadCount = state.range(0);
+
+  for (auto _: state) {
+    kj::Vector<kj::Own<kj::Thread>> threads(threadCount);
+    for (uint i = 0; i < threadCount; i++) {
+      threads.add(kj::heap<kj::Thread>([&worker]() {
+        kj::EventLoop loop;
+        kj::WaitScope waitScope(loop);
+        for (uint j = 0; j < LOCKS_PER_THREAD; j++) {
+          auto lock = worker.takeAsyncLockWithoutRequest(nullptr).wait(waitScope);
+          benchmark::DoNotOptimize(lock);
+        }
+      }));
+    }
+    // Destroying the threads joins them.
+    threads.clear();
+  }
+
+  state.SetItemsProcessed(state.iterations() * threadCount * LOCKS_PER_THREAD);
+}
+
+BENCHMARK_REGISTER_F(AsyncLockBenchmark, handoff)
+    ->Arg(1)
+    ->Arg(8)
+    ->Arg(64)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace workerd
@@ -0,0 +1,74 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/api/eventsource.h>
+#include <workerd/tests/bench-tools.h>
+
+// Measures parsing of a server-sent event stream, fed in network-sized chunks that split lines and
+// line ends at arbitrary points. Each iteration parses 100MB of events. Items processed are events
+// and bytes processed are bytes of stream, so the reported rates are events/sec and throughput.
+
+namespace workerd {
+namespace {
+
+constexpr size_t STREAM_SIZE = 100 * 1024 * 1024;
+constexpr size_t CHUNK_SIZE = 16 * 1024 + 7;
+
+struct CountingHandler final: public api::EventStreamParser::Handler {
+  void onEvent(kj::Maybe<kj::ArrayPtr<const char>> type, kj::ArrayPtr<const char> data) override {
+    ++events;
+    dataBytes += data.size();
+  }
+  void onId(kj::ArrayPtr<const char> id) override {}
+  void onRetry(uint32_t time) override {}
+
+  size_t events = 0;
+  size_t dataBytes = 0;
+};
+
+// Builds about 1MB of events like those of a high-rate feed: an id, an event type, and a couple
+// of JSON data lines, with the given line end.
+kj::String makeEvents(kj::StringPtr eol) {
+  kj::Vector<char> out;
+  for (size_t i = 0; out.size() < 1024 * 1024; ++i) {
+    out.addAll(kj::str("id: ", i, eol, "event: update", eol, "data: {\"seq\":", i,
+        ",\"price\":1234.56,\"size\":100,\"symbol\":\"EXAMPLE\"}", eol,
+        "data: {\"bid\":1234.50,\"ask\":1234.60}", eol, eol));
+  }
+  out.add('\0');
+  return kj::String(out.releaseAsArray());
+}
+
+void parse(benchmark::State& state, kj::StringPtr eol) {
+  auto events = makeEvents(eol);
+  auto bytes = events.asArray();
+  CountingHandler handler;
+  api::EventStreamParser parser(handler);
+
+  auto repeats = (STREAM_SIZE + bytes.size() - 1) / bytes.size();
+
+  for (auto _: state) {
+    for (auto i KJ_UNUSED: kj::zeroTo(repeats)) {
+      for (size_t pos = 0; pos < bytes.size(); pos += CHUNK_SIZE) {
+        parser.feed(bytes.slice(pos, kj::min(pos + CHUNK_SIZE, bytes.size())));
+      }
+    }
+  }
+  benchmark::DoNotOptimize(handler.dataBytes);
+  state.SetItemsProcessed(handler.events);
+  state.SetBytesProcessed(state.iterations() * repeats * bytes.size());
+}
+
+void EventStream_ParseLf(benchmark::State& state) {
+  parse(state, "\n"_kj);
+}
+WD_BENCHMARK(EventStream_ParseLf);
+
+void EventStream_ParseCrLf(benchmark::State& state) {
+  parse(state, "\r\n"_kj);
+}
+WD_BENCHMARK(EventStream_ParseCrLf);
+
+}  // namespace
+}  // namespace workerd
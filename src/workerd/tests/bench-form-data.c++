@@ -0,0 +1,80 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/api/form-data.h>
+#include <workerd/tests/bench-tools.h>
+#include <workerd/tests/test-fixture.h>
+
+// Measures multipart/form-data parsing, which is dominated by searching for the boundary between
+// parts. Bytes processed are bytes of body, so the reported rate is parse throughput.
+
+namespace workerd {
+namespace {
+
+constexpr auto BOUNDARY = "----WorkerdBenchBoundary7MA4YWxkTrZu0gW"_kjc;
+
+// Builds a body of `partCount` text parts, each `partSize` bytes. When `nearMisses` is set, each
+// part's content is made of lines that start like the delimiter but diverge near its end, which
+// is the worst case for a naive substring search.
+kj::String makeBody(size_t partCount, size_t partSize, bool nearMisses) {
+  auto filler = nearMisses ? kj::str("\n--", BOUNDARY.slice(0, BOUNDARY.size() - 1), "X")
+                           : kj::str("lorem ipsum dolor sit amet, consectetur adipiscing elit\n");
+  kj::Vector<char> content(partSize);
+  while (content.size() < partSize) {
+    content.addAll(filler.asArray().first(kj::min(filler.size(), partSize - content.size())));
+  }
+
+  kj::Vector<char> body;
+  for (auto i: kj::zeroTo(partCount)) {
+    body.addAll(kj::str("--", BOUNDARY, "\r\nContent-Disposition: form-data; name=\"field", i,
+        "\"\r\n\r\n"));
+    body.addAll(content);
+    body.addAll("\r\n"_kj);
+  }
+  body.addAll(kj::str("--", BOUNDARY, "--"));
+  body.add('\0');
+  return kj::String(body.releaseAsArray());
+}
+
+struct FormDataParse: public benchmark::Fixture {
+  virtual ~FormDataParse() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    fixture = kj::heap<TestFixture>();
+    contentType = kj::str("multipart/form-data; boundary=", BOUNDARY);
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    fixture = nullptr;
+  }
+
+  void run(benchmark::State& state, kj::StringPtr body) {
+    fixture->runInIoContext([&](const TestFixture::Environment& env) {
+      for (auto _: state) {
+        auto formData = jsg::alloc<api::FormData>();
+        formData->parse(env.js, body, contentType, false);
+        benchmark::DoNotOptimize(formData->getData().size());
+      }
+      state.SetBytesProcessed(state.iterations() * body.size());
+    });
+  }
+
+  kj::Own<TestFixture> fixture;
+  kj::String contentType;
+};
+
+// ~1MB spread over 64 ordinary parts.
+BENCHMARK_F(FormDataParse, manyParts)(benchmark::State& state) {
+  auto body = makeBody(64, 16 * 1024, false);
+  run(state, body);
+}
+
+// ~1MB spread over 4 parts whose content keeps almost matching the delimiter.
+BENCHMARK_F(FormDataParse, nearMisses)(benchmark::State& state) {
+  auto body = makeBody(4, 256 * 1024, true);
+  run(state, body);
+}
+
+}  // namespace
+}  // namespace workerd
@@ -38,5 +38,33 @@ BENCHMARK_F(GlobalScopeBenchmark, request)(benchmark::State& state) {
   }
 }
 
+// Creating an isolate and its global scope, which declares every API as a nested type. Those
+// types' templates are only built when a worker first reads their global names, so most of them
+// never are here.
+BENCHMARK_F(GlobalScopeBenchmark, startup)(benchmark::State& state) {
+  for (auto _: state) {
+    TestFixture isolateFixture;
+    benchmark::DoNotOptimize(&isolateFixture);
+  }
+}
+
+// As above, but reading a selection of rarely used globals afterwards, which pays for their
+// templates.
+BENCHMARK_F(GlobalScopeBenchmark, startupAndReadGlobals)(benchmark::State& state) {
+  for (auto _: state) {
+    TestFixture isolateFixture;
+    isolateFixture.runInIoContext([&](const TestFixture::Environment& env) {
+      auto& js = env.js;
+      auto context = js.v8Context();
+      for (auto name: {"HTMLRewriter", "CompressionStream", "DecompressionStream",
+             "TransformStream", "WritableStream", "CryptoKey", "SubtleCrypto", "FormData",
+             "URLPattern", "EventSource", "WebSocket", "TextDecoderStream"}) {
+        benchmark::DoNotOptimize(
+            jsg::check(context->Global()->Get(context, jsg::v8StrIntern(js.v8Isolate, name))));
+      }
+    });
+  }
+}
+
 }  // namespace
 }  // namespace workerd
@@ -0,0 +1,79 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/tests/test-fixture.h>
+
+#include <kj/test.h>
+
+// Measures HTMLRewriter throughput over a ~1MB page of nested markup. Bytes processed are bytes
+// of rewritten HTML, so the reported rate is rewrite throughput.
+
+namespace workerd {
+namespace {
+
+struct HtmlRewriterBenchmark: public benchmark::Fixture {
+  virtual ~HtmlRewriterBenchmark() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    TestFixture::SetupParams params = {.mainModuleSource = R"(
+        // A representative page: a head with some metadata, then a long list of article cards,
+        // each a handful of nested elements with attributes and text.
+        const card = (i) =>
+            `<div class="card" id="card-${i}"><h2><a href="/articles/${i}">Article ${i}</a></h2>` +
+            `<p class="summary">Lorem ipsum dolor sit amet, consectetur adipiscing elit.</p>` +
+            `<ul class="tags"><li>news</li><li>tech</li></ul></div>\n`;
+        let page = '<!DOCTYPE html><html><head><title>Bench</title>' +
+            '<meta charset="utf-8"><link rel="stylesheet" href="/style.css"></head><body>';
+        for (let i = 0; page.length < 1024 * 1024; i++) page += card(i);
+        page += '</body></html>';
+
+        export default {
+          async fetch(request, env, ctx) {
+            const mode = new URL(request.url).pathname;
+            const rewriter = new HTMLRewriter();
+            if (mode === '/attributes') {
+              rewriter.on('a[href]', {
+                element(e) { e.setAttribute('href', e.getAttribute('href') + '?ref=bench'); },
+              });
+            } else if (mode === '/end-tags') {
+              // One onEndTag() registration per element.
+              rewriter.on('*', {
+                element(e) { e.onEndTag((end) => {}); },
+              });
+            }
+            return rewriter.transform(new Response(page));
+          }
+        }
+      )"_kj};
+    fixture = kj::heap<TestFixture>(kj::mv(params));
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    fixture = nullptr;
+  }
+
+  void run(benchmark::State& state, kj::StringPtr url) {
+    size_t bytes = 0;
+    for (auto _: state) {
+      auto result = fixture->runRequest(kj::HttpMethod::GET, url, ""_kj);
+      KJ_EXPECT(result.statusCode == 200);
+      bytes += result.body.size();
+    }
+    state.SetBytesProcessed(bytes);
+  }
+
+  kj::Own<TestFixture> fixture;
+};
+
+BENCHMARK_F(HtmlRewriterBenchmark, attributes)(benchmark::State& state) {
+  run(state, "http://www.example.com/attributes"_kj);
+}
+
+BENCHMARK_F(HtmlRewriterBenchmark, endTags)(benchmark::State& state) {
+  run(state, "http://www.example.com/end-tags"_kj);
+}
+
+}  // namespace
+}  // namespace workerd
@@ -0,0 +1,56 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/tests/test-fixture.h>
+
+// Compares a worker whose isolate allows the inspector, as with `--inspector-addr`, but has no
+// session attached, against one with the inspector disabled. The two should cost about the same.
+
+namespace workerd {
+namespace {
+
+struct InspectorBenchmark: public benchmark::Fixture {
+  virtual ~InspectorBenchmark() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    TestFixture::SetupParams params = {
+      .mainModuleSource = R"(
+        export default {
+          async fetch(request) {
+            console.log("handling", request.url);
+            try {
+              JSON.parse("not json");
+            } catch (e) {
+              console.warn(e.message);
+            }
+            await Promise.resolve();
+            return new Response("OK");
+          },
+        };
+      )"_kj,
+      .inspectorPolicy = state.range(0) ? Worker::Isolate::InspectorPolicy::ALLOW_FULLY_TRUSTED
+                                        : Worker::Isolate::InspectorPolicy::DISALLOW,
+    };
+    fixture = kj::heap<TestFixture>(kj::mv(params));
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    fixture = nullptr;
+  }
+
+  kj::Own<TestFixture> fixture;
+};
+
+// Arg 0: inspector disallowed. Arg 1: inspector allowed, no session attached.
+BENCHMARK_DEFINE_F(InspectorBenchmark, request)(benchmark::State& state) {
+  for (auto _: state) {
+    auto result = fixture->runRequest(kj::HttpMethod::POST, "http://www.example.com"_kj, "TEST"_kj);
+    KJ_EXPECT(result.statusCode == 200);
+  }
+}
+BENCHMARK_REGISTER_F(InspectorBenchmark, request)->Arg(0)->Arg(1);
+
+}  // namespace
+}  // namespace workerd
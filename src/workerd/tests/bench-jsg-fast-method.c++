@@ -0,0 +1,99 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/jsg/jsg.h>
+#include <workerd/jsg/setup.h>
+#include <workerd/tests/bench-tools.h>
+
+// Compares calling the same C++ methods through JSG_METHOD and JSG_FAST_METHOD, from a loop that
+// V8 optimizes. Each item is one call, so the reported rate is calls/sec.
+
+namespace workerd {
+namespace {
+
+constexpr int CALLS = 1000;
+
+struct FastMethodContext: public jsg::Object, public jsg::ContextGlobal {
+  double add(double a, double b) {
+    return a + b;
+  }
+  uint32_t firstByte(kj::Array<const kj::byte> bytes) {
+    return bytes.size() == 0 ? 0 : bytes[0];
+  }
+
+  JSG_RESOURCE_TYPE(FastMethodContext) {
+    JSG_METHOD_NAMED(addSlow, add);
+    JSG_FAST_METHOD_NAMED(addFast, add);
+    JSG_METHOD_NAMED(firstByteSlow, firstByte);
+    JSG_FAST_METHOD_NAMED(firstByteFast, firstByte);
+  }
+};
+JSG_DECLARE_ISOLATE_TYPE(FastMethodIsolate, FastMethodContext);
+
+jsg::V8System& getV8System() {
+  static jsg::V8System v8System;
+  return v8System;
+}
+
+// `code` must evaluate to a function that makes CALLS calls.
+void runCalls(benchmark::State& state, kj::StringPtr code) {
+  FastMethodIsolate isolate(getV8System(), kj::heap<jsg::IsolateObserver>());
+  isolate.runInLockScope([&](FastMethodIsolate::Lock& lock) {
+    JSG_WITHIN_CONTEXT_SCOPE(lock, lock.newContext<FastMethodContext>().getHandle(lock),
+        [&](jsg::Lock& js) {
+      auto context = js.v8Context();
+      auto script = jsg::check(v8::Script::Compile(context, jsg::v8Str(js.v8Isolate, code)));
+      auto func = jsg::check(script->Run(context)).As<v8::Function>();
+
+      for (auto _: state) {
+        js.withinHandleScope([&] {
+          benchmark::DoNotOptimize(jsg::check(func->Call(context, context->Global(), 0, nullptr)));
+        });
+      }
+      state.SetItemsProcessed(state.iterations() * CALLS);
+    });
+  });
+}
+
+void FastMethod_AddSlow(benchmark::State& state) {
+  runCalls(state, R"((function() {
+    let total = 0;
+    for (let i = 0; i < 1000; ++i) total = addSlow(total, i);
+    return total;
+  }))"_kj);
+}
+
+void FastMethod_AddFast(benchmark::State& state) {
+  runCalls(state, R"((function() {
+    let total = 0;
+    for (let i = 0; i < 1000; ++i) total = addFast(total, i);
+    return total;
+  }))"_kj);
+}
+
+void FastMethod_BytesSlow(benchmark::State& state) {
+  runCalls(state, R"((function() {
+    const bytes = new Uint8Array(4096);
+    let total = 0;
+    for (let i = 0; i < 1000; ++i) total += firstByteSlow(bytes);
+    return total;
+  }))"_kj);
+}
+
+void FastMethod_BytesFast(benchmark::State& state) {
+  runCalls(state, R"((function() {
+    const bytes = new Uint8Array(4096);
+    let total = 0;
+    for (let i = 0; i < 1000; ++i) total += firstByteFast(bytes);
+    return total;
+  }))"_kj);
+}
+
+WD_BENCHMARK(FastMethod_AddSlow);
+WD_BENCHMARK(FastMethod_AddFast);
+WD_BENCHMARK(FastMethod_BytesSlow);
+WD_BENCHMARK(FastMethod_BytesFast);
+
+}  // namespace
+}  // namespace workerd
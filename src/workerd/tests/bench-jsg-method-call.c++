@@ -0,0 +1,69 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/tests/test-fixture.h>
+
+// Measures the fixed cost of calling into a JSG method or property getter from JavaScript: the
+// argument count check, unwrapping `this` and the arguments, and wrapping the result. Each item
+// is one call, so the reported rate is calls/sec.
+
+namespace workerd {
+namespace {
+
+constexpr int CALLS = 1000;
+
+struct MethodCall: public benchmark::Fixture {
+  virtual ~MethodCall() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    fixture = kj::heap<TestFixture>();
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    fixture = nullptr;
+  }
+
+  // `code` must evaluate to a function that makes CALLS calls.
+  void run(benchmark::State& state, kj::StringPtr code) {
+    fixture->runInIoContext([&](const TestFixture::Environment& env) {
+      auto& js = env.js;
+      auto context = js.v8Context();
+      auto script = jsg::check(v8::Script::Compile(context, jsg::v8Str(js.v8Isolate, code)));
+      auto func = jsg::check(script->Run(context)).As<v8::Function>();
+
+      for (auto _: state) {
+        js.withinHandleScope([&] {
+          benchmark::DoNotOptimize(jsg::check(func->Call(context, context->Global(), 0, nullptr)));
+        });
+      }
+      state.SetItemsProcessed(state.iterations() * CALLS);
+    });
+  }
+
+  kj::Own<TestFixture> fixture;
+};
+
+// A method with one required parameter.
+BENCHMARK_F(MethodCall, HeadersGet)(benchmark::State& state) {
+  run(state, R"((function() {
+    const headers = new Headers({ accept: "text/html", "content-type": "text/plain" });
+    return function() {
+      for (let i = 0; i < 1000; ++i) headers.get("accept");
+    };
+  })())"_kj);
+}
+
+// A property getter, which has no arguments to check.
+BENCHMARK_F(MethodCall, RequestUrl)(benchmark::State& state) {
+  run(state, R"((function() {
+    const request = new Request("https://example.com/path?query");
+    return function() {
+      for (let i = 0; i < 1000; ++i) request.url;
+    };
+  })())"_kj);
+}
+
+}  // namespace
+}  // namespace workerd
@@ -0,0 +1,84 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/jsg/jsg.h>
+#include <workerd/jsg/setup.h>
+#include <workerd/tests/bench-tools.h>
+
+// Measures the cost of passing promises between JavaScript and C++, as when a handler hands the
+// result of an async function to an API that returns a promise of its own. Each item is one
+// promise converted from JavaScript to C++ and back, so the reported rate is round trips/sec.
+
+namespace workerd {
+namespace {
+
+constexpr int ROUND_TRIPS = 1000;
+
+struct PromiseContext: public jsg::Object, public jsg::ContextGlobal {
+  jsg::Promise<int> echo(jsg::Promise<int> promise) {
+    return kj::mv(promise);
+  }
+
+  JSG_RESOURCE_TYPE(PromiseContext) {
+    JSG_METHOD(echo);
+  }
+};
+JSG_DECLARE_ISOLATE_TYPE(PromiseIsolate, PromiseContext);
+
+jsg::V8System& getV8System() {
+  static jsg::V8System v8System;
+  return v8System;
+}
+
+// `code` must evaluate to a function that makes ROUND_TRIPS calls to echo().
+void runRoundTrips(benchmark::State& state, kj::StringPtr code) {
+  PromiseIsolate isolate(getV8System(), kj::heap<jsg::IsolateObserver>());
+  isolate.runInLockScope([&](PromiseIsolate::Lock& lock) {
+    JSG_WITHIN_CONTEXT_SCOPE(lock, lock.newContext<PromiseContext>().getHandle(lock),
+        [&](jsg::Lock& js) {
+      auto context = js.v8Context();
+      auto script = jsg::check(v8::Script::Compile(context, jsg::v8Str(js.v8Isolate, code)));
+      auto func = jsg::check(script->Run(context)).As<v8::Function>();
+
+      for (auto _: state) {
+        js.withinHandleScope([&] {
+          benchmark::DoNotOptimize(
+              jsg::check(func->Call(context, context->Global(), 0, nullptr)));
+          js.runMicrotasks();
+        });
+      }
+      state.SetItemsProcessed(state.iterations() * ROUND_TRIPS);
+    });
+  });
+}
+
+void Promise_Resolved(benchmark::State& state) {
+  runRoundTrips(state, R"((function() {
+    for (let i = 0; i < 1000; ++i) echo(Promise.resolve(i));
+  }))"_kj);
+}
+
+void Promise_AsyncFunction(benchmark::State& state) {
+  runRoundTrips(state, R"((function() {
+    const f = async (i) => i;
+    for (let i = 0; i < 1000; ++i) echo(f(i));
+  }))"_kj);
+}
+
+void Promise_Pending(benchmark::State& state) {
+  runRoundTrips(state, R"((function() {
+    for (let i = 0; i < 1000; ++i) {
+      let resolve;
+      echo(new Promise((r) => { resolve = r; }));
+      resolve(i);
+    }
+  }))"_kj);
+}
+
+WD_BENCHMARK(Promise_Resolved);
+WD_BENCHMARK(Promise_AsyncFunction);
+WD_BENCHMARK(Promise_Pending);
+
+}  // namespace
+}  // namespace workerd
@@ -50,7 +50,40 @@ static void Test_JSON_DEC(benchmark::State& state) {
   }
 }
 
+static void buildHeadRequest(workerd::api::public_beta::R2BindingRequest::Builder request) {
+  request.setVersion(1);
+  request.initPayload().initHead().setObject("images/2024/03/photo-0001.jpg");
+}
+
+// Encodes an R2 request the way each binding call used to, setting up a codec for it every time.
+static void Test_R2_ENC_PER_CALL_CODEC(benchmark::State& state) {
+  for (auto _: state) {
+    capnp::JsonCodec json;
+    json.handleByAnnotation<workerd::api::public_beta::R2BindingRequest>();
+    json.setHasMode(capnp::HasMode::NON_DEFAULT);
+    capnp::MallocMessageBuilder requestMessage;
+    auto requestBuilder = requestMessage.initRoot<workerd::api::public_beta::R2BindingRequest>();
+    buildHeadRequest(requestBuilder);
+    benchmark::DoNotOptimize(json.encode(requestBuilder));
+  }
+}
+
+// Encodes the same request with a codec that is set up once, as getR2JsonCodec() provides.
+static void Test_R2_ENC_SHARED_CODEC(benchmark::State& state) {
+  capnp::JsonCodec json;
+  json.handleByAnnotation<workerd::api::public_beta::R2BindingRequest>();
+  json.setHasMode(capnp::HasMode::NON_DEFAULT);
+  for (auto _: state) {
+    capnp::MallocMessageBuilder requestMessage;
+    auto requestBuilder = requestMessage.initRoot<workerd::api::public_beta::R2BindingRequest>();
+    buildHeadRequest(requestBuilder);
+    benchmark::DoNotOptimize(json.encode(requestBuilder));
+  }
+}
+
 WD_BENCHMARK(Test_JSON_ENC);
 WD_BENCHMARK(Test_JSON_DEC);
+WD_BENCHMARK(Test_R2_ENC_PER_CALL_CODEC);
+WD_BENCHMARK(Test_R2_ENC_SHARED_CODEC);
 // Register both functions as benchmarks – we link benchmark_main so there's no need for a main
 // function.
@@ -0,0 +1,85 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/api/memory-cache.h>
+#include <workerd/io/trace.h>
+#include <workerd/tests/bench-tools.h>
+
+// Measures concurrent reads from a SharedMemoryCache, as when many isolates on different threads
+// read the same configuration values. All threads read from one cache, so the benchmark shows how
+// well reads scale with the number of threads.
+
+namespace workerd {
+namespace {
+
+using api::CacheValue;
+using api::SharedMemoryCache;
+using Outcome = SharedMemoryCache::Use::GetWithFallbackOutcome;
+
+constexpr uint KEY_COUNT = 1024;
+constexpr uint VALUE_SIZE = 64;
+
+// A cache holding KEY_COUNT values, shared by all threads of all benchmarks.
+struct FilledCache {
+  SharedMemoryCache::Use use;
+  kj::Array<kj::String> keys;
+
+  FilledCache()
+      : use(SharedMemoryCache::create(
+                kj::none, "bench", kj::none, kj::systemPreciseMonotonicClock()),
+            SharedMemoryCache::Limits{
+              .maxKeys = KEY_COUNT,
+              .maxValueSize = VALUE_SIZE,
+              .maxTotalValueSize = KEY_COUNT * VALUE_SIZE,
+            }),
+        keys(KJ_MAP(i, kj::zeroTo(KEY_COUNT)) { return kj::str("key-", i); }) {
+    kj::EventLoop loop;
+    kj::WaitScope waitScope(loop);
+    SpanBuilder span(nullptr);
+    for (auto& key: keys) {
+      // A miss hands us a callback to report the value that a fallback would have produced.
+      auto result = use.getWithFallback(key, span);
+      auto outcome = result.get<kj::Promise<Outcome>>().wait(waitScope);
+      auto& done = outcome.get<SharedMemoryCache::Use::FallbackDoneCallback>();
+      done(SharedMemoryCache::Use::FallbackResult{
+        .value = kj::atomicRefcounted<CacheValue>(kj::heapArray<kj::byte>(VALUE_SIZE)),
+        .expiration = kj::none,
+      });
+    }
+  }
+};
+
+const FilledCache& getFilledCache() {
+  static const FilledCache filledCache;
+  return filledCache;
+}
+
+void MemoryCache_Read(benchmark::State& state) {
+  auto& filledCache = getFilledCache();
+  SpanBuilder span(nullptr);
+  // Start each thread at a different key so that they don't all hit the same entry at once.
+  uint i = state.thread_index() * 997;
+  for (auto _: state) {
+    auto& key = filledCache.keys[i++ % KEY_COUNT];
+    benchmark::DoNotOptimize(filledCache.use.getWithoutFallback(key, span));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void MemoryCache_ReadWithFallback(benchmark::State& state) {
+  auto& filledCache = getFilledCache();
+  SpanBuilder span(nullptr);
+  uint i = state.thread_index() * 997;
+  for (auto _: state) {
+    auto& key = filledCache.keys[i++ % KEY_COUNT];
+    benchmark::DoNotOptimize(filledCache.use.getWithFallback(key, span));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(MemoryCache_Read)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(MemoryCache_ReadWithFallback)->ThreadRange(1, 16)->UseRealTime();
+
+}  // namespace
+}  // namespace workerd
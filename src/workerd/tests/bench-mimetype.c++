@@ -15,6 +15,23 @@ WD_BENCH("Mimetype::ParseAndSerialize") {
       .toString();
 }
 
+// The Content-Type values most requests carry, each parsed repeatedly as they would be across
+// requests.
+WD_BENCH("Mimetype::ParseCommon") {
+  MimeType::parse("application/json"_kj);
+  MimeType::parse("text/html;charset=utf-8"_kj);
+  MimeType::parse("text/plain; charset=UTF-8"_kj);
+  MimeType::parse("application/x-www-form-urlencoded"_kj);
+  MimeType::parse("application/octet-stream"_kj);
+  MimeType::parse("image/png"_kj);
+}
+
+// Values that are unique to a request, such as a multipart boundary, can't benefit from caching.
+WD_BENCH("Mimetype::ParseUnique") {
+  MimeType::parse("multipart/form-data; boundary=----WebKitFormBoundary7MA4YWxkTrZu0gW"_kj);
+  MimeType::parse("application/vnd.example.v2+json; profile=\"https://example.com/p\""_kj);
+}
+
 WD_BENCH("Mimetype::Serialize") {
   MimeType::PLAINTEXT.toString();
   MimeType::CSS.toString();
@@ -0,0 +1,41 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/util/random.h>
+#include <workerd/util/uuid.h>
+
+#include <openssl/rand.h>
+
+// Benchmarks for the small random draws that crypto.randomUUID(), getRandomValues() on small
+// arrays, and trace and span IDs make, comparing the pooled generator with calling the CSPRNG
+// for each draw.
+
+namespace workerd {
+namespace {
+
+WD_BENCH("Random::RAND_bytes16") {
+  kj::byte buffer[16];
+  KJ_ASSERT(RAND_bytes(buffer, sizeof(buffer)) == 1);
+  benchmark::DoNotOptimize(buffer);
+}
+
+WD_BENCH("Random::getRandomBytes16") {
+  kj::byte buffer[16];
+  getRandomBytes(buffer);
+  benchmark::DoNotOptimize(buffer);
+}
+
+WD_BENCH("Random::getRandomBytes1024") {
+  kj::byte buffer[1024];
+  getRandomBytes(buffer);
+  benchmark::DoNotOptimize(buffer);
+}
+
+WD_BENCH("Random::randomUUID") {
+  benchmark::DoNotOptimize(randomUUID(kj::none));
+}
+
+}  // namespace
+}  // namespace workerd
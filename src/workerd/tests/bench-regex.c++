@@ -52,5 +52,53 @@ BENCHMARK_F(RegExpBenchmark, request)(benchmark::State& state) {
   }
 }
 
+// A router that builds its URLPatterns on every request, as is common when routes are declared
+// inside the fetch handler. Most routes are fixed text and `:name` segments, which match without
+// the regex engine; the `\d+` route still needs a regex, compiled once per isolate.
+struct URLPatternBenchmark: public benchmark::Fixture {
+  virtual ~URLPatternBenchmark() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    TestFixture::SetupParams params = {.mainModuleSource = R"(
+        const routes = [
+          "/", "/about", "/login", "/logout", "/users/:id", "/users/:id/posts",
+          "/users/:id/posts/:post", "/orgs/:org/repos/:repo/issues/:issue", "/static/*",
+          "/api/v1/items/:item(\\d+)",
+        ];
+        export default {
+          async fetch(request, env, ctx) {
+            const patterns = routes.map((pathname) => new URLPattern({ pathname }));
+            for (const pattern of patterns) {
+              const match = pattern.exec(request.url);
+              if (match) {
+                return new Response(JSON.stringify(match.pathname.groups));
+              }
+            }
+            return new Response("not found", {status: 404});
+          }
+        }
+      )"_kj};
+    fixture = kj::heap<TestFixture>(kj::mv(params));
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    fixture = nullptr;
+  }
+
+  kj::Own<TestFixture> fixture;
+};
+
+BENCHMARK_F(URLPatternBenchmark, request)(benchmark::State& state) {
+  for (auto _: state) {
+    auto result = fixture->runRequest(
+        kj::HttpMethod::GET, "http://www.example.com/orgs/a/repos/b/issues/3"_kj, ""_kj);
+    KJ_EXPECT(
+        result.statusCode == 200 && result.body == R"({"org":"a","repo":"b","issue":"3"})"_kj);
+    auto result2 = fixture->runRequest(
+        kj::HttpMethod::GET, "http://www.example.com/api/v1/items/42"_kj, ""_kj);
+    KJ_EXPECT(result2.statusCode == 200 && result2.body == R"({"item":"42"})"_kj);
+  }
+}
+
 }  // namespace
 }  // namespace workerd
@@ -0,0 +1,181 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/tests/test-fixture.h>
+
+// End-to-end benchmarks of a request through a Worker: the request is delivered to the Worker's
+// handler in an IoContext, and the whole response is read back. These give a baseline for the
+// runtime's per-request overhead, as opposed to the benchmarks of individual APIs.
+//
+// Items processed are requests, so the reported rate is requests/sec.
+
+namespace workerd {
+namespace {
+
+struct FetchRequest: public benchmark::Fixture {
+  virtual ~FetchRequest() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    TestFixture::SetupParams params = {.mainModuleSource = R"(
+        export default {
+          async fetch(request) {
+            switch (new URL(request.url).pathname) {
+              case "/hello":
+                return new Response("Hello, world!");
+              case "/json": {
+                const body = await request.json();
+                return Response.json(body);
+              }
+              case "/proxy":
+                // Forward the request's headers back, as a proxy would to its origin.
+                return new Response("OK", { headers: request.headers });
+              case "/stream":
+                return new Response(request.body);
+              case "/upload":
+                // Pass the incoming request straight through to the origin.
+                return fetch(request);
+              case "/fanout": {
+                // A handful of subrequests carrying the incoming headers, as a gateway would.
+                const responses = await Promise.all(Array.from({ length: 10 }, (_, i) =>
+                    fetch(`http://backend.example/${i}`, { headers: request.headers })));
+                return new Response(`${responses.length}`);
+              }
+              default:
+                return new Response("Not Found", { status: 404 });
+            }
+          },
+        };
+      )"_kj};
+    fixture = kj::heap<TestFixture>(kj::mv(params));
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    fixture = nullptr;
+  }
+
+  kj::Own<TestFixture> fixture;
+};
+
+BENCHMARK_F(FetchRequest, helloWorld)(benchmark::State& state) {
+  for (auto _: state) {
+    auto result = fixture->runRequest(kj::HttpMethod::GET, "http://example.com/hello"_kj, ""_kj);
+    KJ_EXPECT(result.statusCode == 200);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_F(FetchRequest, jsonEcho)(benchmark::State& state) {
+  auto body = R"({"id":12345,"name":"example","tags":["a","b","c"],"nested":{"enabled":true,)"
+              R"("ratio":0.25,"items":[{"k":"x","v":1},{"k":"y","v":2},{"k":"z","v":3}]}})"_kj;
+  for (auto _: state) {
+    auto result = fixture->runRequest(kj::HttpMethod::POST, "http://example.com/json"_kj, body);
+    KJ_EXPECT(result.statusCode == 200);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_F(FetchRequest, headerHeavyProxy)(benchmark::State& state) {
+  // About what a browser behind a CDN sends.
+  kj::Vector<kj::String> names;
+  kj::Vector<kj::String> values;
+  for (auto i: kj::zeroTo(40)) {
+    names.add(kj::str("X-Forwarded-Header-", i));
+    values.add(kj::str("value-", i, "-", kj::repeat('v', 32)));
+  }
+  for (auto _: state) {
+    auto result = fixture->runRequest(kj::HttpMethod::GET, "http://example.com/proxy"_kj, ""_kj,
+        [&](kj::HttpHeaders& headers) {
+      for (auto i: kj::indices(names)) {
+        headers.addPtrPtr(names[i], values[i]);
+      }
+    });
+    KJ_EXPECT(result.statusCode == 200);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_F(FetchRequest, subrequestFanOut)(benchmark::State& state) {
+  kj::Vector<kj::String> names;
+  kj::Vector<kj::String> values;
+  for (auto i: kj::zeroTo(20)) {
+    names.add(kj::str("X-Forwarded-Header-", i));
+    values.add(kj::str("value-", i));
+  }
+  for (auto _: state) {
+    auto result = fixture->runRequest(kj::HttpMethod::GET, "http://example.com/fanout"_kj, ""_kj,
+        [&](kj::HttpHeaders& headers) {
+      for (auto i: kj::indices(names)) {
+        headers.addPtrPtr(names[i], values[i]);
+      }
+    });
+    KJ_EXPECT(result.body == "10");
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_F(FetchRequest, stream10MB)(benchmark::State& state) {
+  constexpr size_t SIZE = 10 * 1024 * 1024;
+  auto body = kj::str(kj::repeat('x', SIZE));
+  for (auto _: state) {
+    auto result = fixture->runRequest(kj::HttpMethod::POST, "http://example.com/stream"_kj, body);
+    KJ_EXPECT(result.body.size() == SIZE);
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * SIZE);
+}
+
+BENCHMARK_F(FetchRequest, uploadPassthrough10MB)(benchmark::State& state) {
+  constexpr size_t SIZE = 10 * 1024 * 1024;
+  auto body = kj::str(kj::repeat('x', SIZE));
+  for (auto _: state) {
+    auto result = fixture->runRequest(kj::HttpMethod::POST, "http://example.com/upload"_kj, body);
+    KJ_EXPECT(result.statusCode == 200);
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * SIZE);
+}
+
+struct RpcRequest: public benchmark::Fixture {
+  virtual ~RpcRequest() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    TestFixture::SetupParams params = {.mainModuleSource = R"(
+        import { WorkerEntrypoint } from "cloudflare:workers";
+        export default class extends WorkerEntrypoint {
+          add(a, b) { return a + b; }
+        };
+      )"_kj};
+    fixture = kj::heap<TestFixture>(kj::mv(params));
+    args = fixture->runInIoContext([](const TestFixture::Environment& env) {
+      auto& js = env.js;
+      return TestFixture::serializeJsRpcValue(js, js.arr(js.num(1), js.num(2)));
+    });
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    fixture = nullptr;
+  }
+
+  kj::Own<TestFixture> fixture;
+  kj::Array<kj::byte> args;
+};
+
+// A call through a service binding, as seen by the callee: each iteration opens a session with
+// the entrypoint, as every binding call does, and makes one call in it.
+BENCHMARK_F(RpcRequest, serviceBindingCall)(benchmark::State& state) {
+  for (auto _: state) {
+    fixture->runJsRpcSession([&](rpc::JsRpcTarget::Client cap) -> kj::Promise<void> {
+      auto req = cap.callRequest();
+      req.setMethodName("add");
+      req.getOperation().initCallWithArgs().setV8Serialized(args.asPtr().asConst());
+      auto response = co_await req.send();
+      benchmark::DoNotOptimize(response.getResult().getV8Serialized().size());
+    });
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+}  // namespace
+}  // namespace workerd
@@ -0,0 +1,64 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/api/worker-rpc.h>
+#include <workerd/jsg/ser.h>
+#include <workerd/tests/bench-tools.h>
+#include <workerd/tests/test-fixture.h>
+
+// Measures the per-call isolate-side work of JS RPC dispatch: serializing a small argument list
+// the way the caller does, and deserializing it the way the callee does. Items processed are
+// calls, so the reported rate is calls/sec.
+
+namespace workerd {
+namespace {
+
+struct RpcDispatch: public benchmark::Fixture {
+  virtual ~RpcDispatch() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    fixture = kj::heap<TestFixture>();
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    fixture = nullptr;
+  }
+
+  kj::Own<TestFixture> fixture;
+};
+
+BENCHMARK_F(RpcDispatch, smallArgs)(benchmark::State& state) {
+  fixture->runInIoContext([&](const TestFixture::Environment& env) {
+    auto& js = env.js;
+    for (auto _: state) {
+      js.withinHandleScope([&]() {
+        auto args = js.arr(js.num(123), js.str("key"_kj), js.boolean(true));
+
+        api::RpcSerializerExternalHander externalHandler(
+            []() -> rpc::JsValue::StreamSink::Client { KJ_UNREACHABLE; });
+        jsg::Serializer serializer(js,
+            jsg::Serializer::Options{
+              .version = 15,
+              .omitHeader = false,
+              .treatClassInstancesAsPlainObjects = false,
+              .externalHandler = externalHandler,
+              .maxSize = api::MAX_JS_RPC_MESSAGE_SIZE,
+            });
+        serializer.write(js, args);
+        auto data = serializer.release().data;
+
+        jsg::Deserializer deserializer(js, data, kj::none, kj::none,
+            jsg::Deserializer::Options{
+              .version = 15,
+              .readHeader = true,
+            });
+        benchmark::DoNotOptimize(deserializer.readValue(js));
+      });
+    }
+    state.SetItemsProcessed(state.iterations());
+  });
+}
+
+}  // namespace
+}  // namespace workerd
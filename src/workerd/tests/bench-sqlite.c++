@@ -0,0 +1,90 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/util/sqlite.h>
+
+// Measures row throughput of large SELECTs, stepping one row at a time with nextRow() versus in
+// batches with forEachRow(), and of ingesting a dump of INSERT statements with ingestSql().
+
+namespace workerd {
+namespace {
+
+constexpr uint ROW_COUNT = 50000;
+
+struct SqliteBench {
+  kj::Own<const kj::Directory> dir = kj::newInMemoryDirectory(kj::nullClock());
+  SqliteDatabase::Vfs vfs{*dir};
+  SqliteDatabase db{vfs, kj::Path({"bench"}), kj::WriteMode::CREATE | kj::WriteMode::MODIFY};
+
+  SqliteBench() {
+    db.run("CREATE TABLE rows (id INTEGER PRIMARY KEY, value INTEGER)");
+    db.run("BEGIN TRANSACTION");
+    auto insert = db.prepare("INSERT INTO rows VALUES (?, ?)");
+    for (uint i = 0; i < ROW_COUNT; i++) {
+      insert.run(i, i * 2);
+    }
+    db.run("COMMIT TRANSACTION");
+  }
+};
+
+static void Sqlite_NextRow(benchmark::State& state) {
+  SqliteBench bench;
+  auto stmt = bench.db.prepare("SELECT value FROM rows");
+
+  for (auto _: state) {
+    int64_t sum = 0;
+    for (auto query = stmt.run(); !query.isDone(); query.nextRow()) {
+      sum += query.getInt64(0);
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+
+  state.SetItemsProcessed(state.iterations() * ROW_COUNT);
+}
+
+static void Sqlite_ForEachRow(benchmark::State& state) {
+  SqliteBench bench;
+  auto stmt = bench.db.prepare("SELECT value FROM rows");
+
+  for (auto _: state) {
+    int64_t sum = 0;
+    auto query = stmt.run();
+    query.forEachRow(kj::maxValue, [&]() { sum += query.getInt64(0); });
+    benchmark::DoNotOptimize(sum);
+  }
+
+  state.SetItemsProcessed(state.iterations() * ROW_COUNT);
+}
+
+static void Sqlite_IngestInserts(benchmark::State& state) {
+  constexpr uint INSERT_COUNT = 10000;
+  kj::Vector<kj::String> statements(INSERT_COUNT);
+  for (auto i: kj::zeroTo(INSERT_COUNT)) {
+    statements.add(kj::str("INSERT INTO dump VALUES (", i, ", 'row ", i, "', ", i * 0.5, ");\n"));
+  }
+  auto dump = kj::strArray(statements, "");
+
+  auto dir = kj::newInMemoryDirectory(kj::nullClock());
+  SqliteDatabase::Vfs vfs(*dir);
+  SqliteDatabase db(vfs, kj::Path({"bench"}), kj::WriteMode::CREATE | kj::WriteMode::MODIFY);
+  db.run("CREATE TABLE dump (id INTEGER PRIMARY KEY, name TEXT, score REAL)");
+
+  for (auto _: state) {
+    db.run("BEGIN TRANSACTION");
+    auto result = db.ingestSql(SqliteDatabase::TRUSTED, dump);
+    KJ_ASSERT(result.statementCount == INSERT_COUNT);
+    db.run("ROLLBACK TRANSACTION");
+  }
+
+  state.SetItemsProcessed(state.iterations() * INSERT_COUNT);
+  state.SetBytesProcessed(state.iterations() * dump.size());
+}
+
+WD_BENCHMARK(Sqlite_NextRow);
+WD_BENCHMARK(Sqlite_ForEachRow);
+WD_BENCHMARK(Sqlite_IngestInserts);
+
+}  // namespace
+}  // namespace workerd
@@ -0,0 +1,123 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/api/streams/queue.h>
+#include <workerd/tests/bench-tools.h>
+#include <workerd/tests/test-fixture.h>
+
+// Measures the streams queues with several consumers, as when a body is tee()'d for caching,
+// forwarding and hashing at once. Each iteration pushes one chunk and has every consumer read
+// it, so every consumer's buffer size changes twice per chunk. The argument is the number of
+// consumers. Items processed are chunks.
+
+namespace workerd {
+namespace {
+
+constexpr size_t CHUNK_SIZE = 4096;
+
+struct StreamQueue: public benchmark::Fixture {
+  virtual ~StreamQueue() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    fixture = kj::heap<TestFixture>();
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    fixture = nullptr;
+  }
+
+  kj::Own<TestFixture> fixture;
+};
+
+BENCHMARK_DEFINE_F(StreamQueue, byteQueue)(benchmark::State& state) {
+  fixture->runInIoContext([&](const TestFixture::Environment& env) {
+    auto& js = env.js;
+    api::ByteQueue queue(CHUNK_SIZE * 16);
+    auto consumers = KJ_MAP(i, kj::zeroTo(state.range(0))) {
+      return kj::heap<api::ByteQueue::Consumer>(queue);
+    };
+
+    for (auto _: state) {
+      js.withinHandleScope([&]() {
+        auto store = jsg::BackingStore::alloc(js, CHUNK_SIZE);
+        queue.push(js, kj::heap<api::ByteQueue::Entry>(jsg::BufferSource(js, kj::mv(store))));
+        for (auto& consumer: consumers) {
+          auto prp = js.newPromiseAndResolver<api::ReadResult>();
+          consumer->read(js,
+              api::ByteQueue::ReadRequest(kj::mv(prp.resolver),
+                  {
+                    .store = jsg::BufferSource(js, jsg::BackingStore::alloc(js, CHUNK_SIZE)),
+                  }));
+        }
+      });
+    }
+    KJ_ASSERT(queue.size() == 0);
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * CHUNK_SIZE);
+  });
+}
+BENCHMARK_REGISTER_F(StreamQueue, byteQueue)->RangeMultiplier(2)->Range(2, 16);
+
+BENCHMARK_DEFINE_F(StreamQueue, valueQueue)(benchmark::State& state) {
+  fixture->runInIoContext([&](const TestFixture::Environment& env) {
+    auto& js = env.js;
+    api::ValueQueue queue(16);
+    auto consumers = KJ_MAP(i, kj::zeroTo(state.range(0))) {
+      return kj::heap<api::ValueQueue::Consumer>(queue);
+    };
+
+    for (auto _: state) {
+      js.withinHandleScope([&]() {
+        auto value = js.v8Ref(v8::True(js.v8Isolate).As<v8::Value>());
+        queue.push(js, kj::heap<api::ValueQueue::Entry>(kj::mv(value), 1));
+        for (auto& consumer: consumers) {
+          auto prp = js.newPromiseAndResolver<api::ReadResult>();
+          consumer->read(js, api::ValueQueue::ReadRequest{.resolver = kj::mv(prp.resolver)});
+        }
+      });
+    }
+    KJ_ASSERT(queue.size() == 0);
+    state.SetItemsProcessed(state.iterations());
+  });
+}
+BENCHMARK_REGISTER_F(StreamQueue, valueQueue)->RangeMultiplier(2)->Range(2, 16);
+
+// A producer writing a few bytes at a time to a single consumer that reads once per 256 chunks.
+// The argument is whether small chunks are coalesced.
+BENCHMARK_DEFINE_F(StreamQueue, byteQueueSmallChunks)(benchmark::State& state) {
+  constexpr size_t SMALL_CHUNK_SIZE = 8;
+  constexpr size_t CHUNKS_PER_READ = 256;
+  fixture->runInIoContext([&](const TestFixture::Environment& env) {
+    auto& js = env.js;
+    kj::Maybe<api::ByteQueue::CoalescingPolicy> policy;
+    if (state.range(0)) {
+      policy = api::ByteQueue::CoalescingPolicy{};
+    }
+    api::ByteQueue queue(SMALL_CHUNK_SIZE * CHUNKS_PER_READ, policy);
+    api::ByteQueue::Consumer consumer(queue);
+
+    for (auto _: state) {
+      js.withinHandleScope([&]() {
+        for (auto i KJ_UNUSED: kj::zeroTo(CHUNKS_PER_READ)) {
+          auto store = jsg::BackingStore::alloc(js, SMALL_CHUNK_SIZE);
+          queue.push(js, kj::heap<api::ByteQueue::Entry>(jsg::BufferSource(js, kj::mv(store))));
+        }
+        auto prp = js.newPromiseAndResolver<api::ReadResult>();
+        consumer.read(js,
+            api::ByteQueue::ReadRequest(kj::mv(prp.resolver),
+                {
+                  .store = jsg::BufferSource(
+                      js, jsg::BackingStore::alloc(js, SMALL_CHUNK_SIZE * CHUNKS_PER_READ)),
+                }));
+      });
+    }
+    KJ_ASSERT(queue.size() == 0);
+    state.SetItemsProcessed(state.iterations() * CHUNKS_PER_READ);
+    state.SetBytesProcessed(state.iterations() * CHUNKS_PER_READ * SMALL_CHUNK_SIZE);
+  });
+}
+BENCHMARK_REGISTER_F(StreamQueue, byteQueueSmallChunks)->Arg(0)->Arg(1);
+
+}  // namespace
+}  // namespace workerd
@@ -0,0 +1,44 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/tests/test-fixture.h>
+
+#include <kj/vector.h>
+
+// Measures setting many timeouts in one IoContext and then clearing them all, as debouncers and
+// retry loops do.
+
+namespace workerd {
+namespace {
+
+static void Timeouts_SetAndClear(benchmark::State& state) {
+  size_t count = state.range(0);
+  TestFixture fixture;
+
+  for (auto _: state) {
+    // A cleared timeout stays known to its context until the context is done, so each iteration
+    // uses a new one.
+    fixture.runInIoContext([&](const TestFixture::Environment& env) {
+      TimeoutId::Generator generator;
+      kj::Vector<TimeoutId> ids(count);
+      for (auto i: kj::zeroTo(count)) {
+        // Spread the delays so that the timeouts don't all land on the same tick.
+        ids.add(env.context.setTimeoutImpl(
+            generator, false, jsg::Function<void()>([](jsg::Lock&) {}), i % 1000));
+      }
+      for (auto id: ids) {
+        env.context.clearTimeoutImpl(id);
+      }
+      KJ_ASSERT(env.context.getTimeoutCount() == 0);
+    });
+  }
+
+  state.SetItemsProcessed(state.iterations() * count);
+}
+
+WD_BENCHMARK(Timeouts_SetAndClear)->Arg(100)->Arg(1000)->Arg(5000);
+
+}  // namespace
+}  // namespace workerd
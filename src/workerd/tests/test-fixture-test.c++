@@ -147,6 +147,49 @@ KJ_TEST("runRequest") {
   KJ_EXPECT(result.body == "POST http://www.example.com TEST"_kj);
 }
 
+KJ_TEST("runRequest with headers") {
+  TestFixture fixture({.mainModuleSource = R"SCRIPT(
+      export default {
+        async fetch(request) {
+          return new Response(request.headers.get("X-Test"));
+        },
+      };
+    )SCRIPT"_kj});
+
+  auto result = fixture.runRequest(kj::HttpMethod::GET, "http://www.example.com"_kj, ""_kj,
+      [](kj::HttpHeaders& headers) { headers.addPtrPtr("X-Test", "header value"); });
+  KJ_EXPECT(result.statusCode == 200);
+  KJ_EXPECT(result.body == "header value"_kj);
+}
+
+KJ_TEST("runJsRpcSession") {
+  TestFixture fixture({.mainModuleSource = R"SCRIPT(
+      import { WorkerEntrypoint } from "cloudflare:workers";
+      export default class extends WorkerEntrypoint {
+        add(a, b) { return a + b; }
+      };
+    )SCRIPT"_kj});
+
+  auto args = fixture.runInIoContext([](const TestFixture::Environment& env) {
+    auto& js = env.js;
+    return TestFixture::serializeJsRpcValue(js, js.arr(js.num(1), js.num(2)));
+  });
+
+  kj::Maybe<kj::Array<kj::byte>> result;
+  fixture.runJsRpcSession([&](rpc::JsRpcTarget::Client cap) -> kj::Promise<void> {
+    auto req = cap.callRequest();
+    req.setMethodName("add");
+    req.getOperation().initCallWithArgs().setV8Serialized(args.asPtr().asConst());
+    auto response = co_await req.send();
+    result = kj::heapArray(response.getResult().getV8Serialized());
+  });
+
+  auto sum = fixture.runInIoContext([&](const TestFixture::Environment& env) {
+    return kj::str(TestFixture::deserializeJsRpcValue(env.js, KJ_ASSERT_NONNULL(result)));
+  });
+  KJ_EXPECT(sum == "3"_kj);
+}
+
 KJ_TEST("module import failure") {
   KJ_EXPECT_LOG(ERROR, "script startup threw exception");
 
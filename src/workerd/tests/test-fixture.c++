@@ -7,12 +7,14 @@
 #include <workerd/api/actor-state.h>
 #include <workerd/api/global-scope.h>
 #include <workerd/api/memory-cache.h>
+#include <workerd/api/worker-rpc.h>
 #include <workerd/io/actor-cache.h>
 #include <workerd/io/actor-id.h>
 #include <workerd/io/io-channels.h>
 #include <workerd/io/limit-enforcer.h>
 #include <workerd/io/observer.h>
 #include <workerd/jsg/jsg.h>
+#include <workerd/jsg/ser.h>
 #include <workerd/jsg/setup.h>
 #include <workerd/server/server.h>
 #include <workerd/server/workerd-api.h>
@@ -71,11 +73,56 @@ struct MockTimerChannel final: public TimerChannel {
   }
 };
 
+// Answers every HTTP subrequest with an empty 200 response, so that fixtures can exercise fetch()
+// without a network.
+struct MockSubrequestWorker final: public WorkerInterface {
+  MockSubrequestWorker(const kj::HttpHeaderTable& headerTable): headerTable(headerTable) {}
+
+  kj::Promise<void> request(kj::HttpMethod method,
+      kj::StringPtr url,
+      const kj::HttpHeaders& headers,
+      kj::AsyncInputStream& requestBody,
+      kj::HttpService::Response& response) override {
+    co_await requestBody.readAllBytes();
+    kj::HttpHeaders responseHeaders(headerTable);
+    response.send(200, "OK"_kj, responseHeaders, uint64_t(0));
+  }
+
+  kj::Promise<void> connect(kj::StringPtr host,
+      const kj::HttpHeaders& headers,
+      kj::AsyncIoStream& connection,
+      ConnectResponse& response,
+      kj::HttpConnectSettings settings) override {
+    KJ_UNIMPLEMENTED("no connect() in test subrequests");
+  }
+
+  kj::Promise<void> prewarm(kj::StringPtr url) override {
+    return kj::READY_NOW;
+  }
+
+  kj::Promise<ScheduledResult> runScheduled(kj::Date scheduledTime, kj::StringPtr cron) override {
+    KJ_UNIMPLEMENTED("no scheduled events in test subrequests");
+  }
+
+  kj::Promise<AlarmResult> runAlarm(kj::Date scheduledTime, uint32_t retryCount) override {
+    KJ_UNIMPLEMENTED("no alarms in test subrequests");
+  }
+
+  kj::Promise<CustomEvent::Result> customEvent(kj::Own<CustomEvent> event) override {
+    return event->notSupported();
+  }
+
+  const kj::HttpHeaderTable& headerTable;
+};
+
 struct DummyIoChannelFactory final: public IoChannelFactory {
-  DummyIoChannelFactory(TimerChannel& timer): timer(timer) {}
+  DummyIoChannelFactory(TimerChannel& timer, const kj::HttpHeaderTable& headerTable)
+      : timer(timer),
+        headerTable(headerTable) {}
 
   kj::Own<WorkerInterface> startSubrequest(uint channel, SubrequestMetadata metadata) override {
-    KJ_FAIL_ASSERT("no subrequests");
+    KJ_REQUIRE(channel == IoContext::NULL_CLIENT_CHANNEL, "no subrequest bindings");
+    return kj::heap<MockSubrequestWorker>(headerTable);
   }
 
   capnp::Capability::Client getCapability(uint channel) override {
@@ -110,6 +157,7 @@ struct DummyIoChannelFactory final: public IoChannelFactory {
   }
 
   TimerChannel& timer;
+  const kj::HttpHeaderTable& headerTable;
 };
 
 static constexpr kj::StringPtr mainModuleSource = R"SCRIPT(
@@ -332,7 +380,7 @@ TestFixture::TestFixture(SetupParams&& params)
           kj::atomicRefcounted<IsolateObserver>(),
           scriptId,
           kj::heap<MockIsolateLimitEnforcer>(),
-          Worker::Isolate::InspectorPolicy::DISALLOW)),
+          params.inspectorPolicy)),
       workerScript(kj::atomicRefcounted<Worker::Script>(kj::atomicAddRef(*workerIsolate),
           scriptId,
           server::WorkerdApi::extractSource(mainModuleName,
@@ -405,20 +453,31 @@ void TestFixture::runInIoContext(kj::Function<kj::Promise<void>(const Environmen
   }
 }
 
-kj::Own<IoContext::IncomingRequest> TestFixture::createIncomingRequest() {
+kj::Own<IoContext::IncomingRequest> TestFixture::createIncomingRequest(bool deliver) {
   auto context = kj::refcounted<IoContext>(
       threadContext, kj::atomicAddRef(*worker), actor, kj::heap<MockLimitEnforcer>());
   auto invocationSpanContext = tracing::InvocationSpanContext::newForInvocation(kj::none, kj::none);
   auto incomingRequest = kj::heap<IoContext::IncomingRequest>(kj::addRef(*context),
-      kj::heap<DummyIoChannelFactory>(*timerChannel), kj::refcounted<RequestObserver>(), nullptr,
+      kj::heap<DummyIoChannelFactory>(*timerChannel, *headerTable),
+      kj::refcounted<RequestObserver>(), nullptr,
       kj::mv(invocationSpanContext));
-  incomingRequest->delivered();
+  if (deliver) {
+    incomingRequest->delivered();
+  }
   return incomingRequest;
 }
 
 TestFixture::Response TestFixture::runRequest(
     kj::HttpMethod method, kj::StringPtr url, kj::StringPtr body) {
+  return runRequest(method, url, body, [](kj::HttpHeaders&) {});
+}
+
+TestFixture::Response TestFixture::runRequest(kj::HttpMethod method,
+    kj::StringPtr url,
+    kj::StringPtr body,
+    kj::FunctionParam<void(kj::HttpHeaders&)> setHeaders) {
   kj::HttpHeaders requestHeaders(*headerTable);
+  setHeaders(requestHeaders);
   MockResponse response;
   auto requestBody = newMemoryInputStream(body);
 
@@ -431,4 +490,46 @@ TestFixture::Response TestFixture::runRequest(
   return {.statusCode = response.statusCode, .body = response.body->str()};
 }
 
+void TestFixture::runJsRpcSession(
+    kj::Function<kj::Promise<void>(rpc::JsRpcTarget::Client)> callback) {
+  kj::WaitScope* waitScope;
+  KJ_IF_SOME(ws, this->waitScope) {
+    waitScope = &ws;
+  } else {
+    waitScope = &KJ_REQUIRE_NONNULL(io).waitScope;
+  }
+
+  api::JsRpcSessionCustomEventImpl event(api::JsRpcSessionCustomEventImpl::WORKER_RPC_EVENT_TYPE);
+  // run() delivers the request itself. The session ends once the callback has dropped the
+  // capability.
+  auto session = event.run(createIncomingRequest(false), kj::none, waitUntilTasks);
+  callback(event.getCap()).wait(*waitScope);
+  session.wait(*waitScope);
+}
+
+kj::Array<kj::byte> TestFixture::serializeJsRpcValue(jsg::Lock& js, jsg::JsValue value) {
+  api::RpcSerializerExternalHander externalHandler(
+      []() -> rpc::JsValue::StreamSink::Client { KJ_UNIMPLEMENTED("no streams over test RPC"); });
+  jsg::Serializer serializer(js,
+      jsg::Serializer::Options{
+        .version = 15,
+        .omitHeader = false,
+        .treatClassInstancesAsPlainObjects = false,
+        .externalHandler = externalHandler,
+        .maxSize = api::MAX_JS_RPC_MESSAGE_SIZE,
+      });
+  serializer.write(js, value);
+  return serializer.release().data;
+}
+
+jsg::JsValue TestFixture::deserializeJsRpcValue(
+    jsg::Lock& js, kj::ArrayPtr<const kj::byte> data) {
+  jsg::Deserializer deserializer(js, data, kj::none, kj::none,
+      jsg::Deserializer::Options{
+        .version = 15,
+        .readHeader = true,
+      });
+  return deserializer.readValue(js);
+}
+
 }  // namespace workerd
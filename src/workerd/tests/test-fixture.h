@@ -6,6 +6,7 @@
 
 #include <workerd/api/memory-cache.h>
 #include <workerd/io/io-context.h>
+#include <workerd/io/worker-interface.capnp.h>
 #include <workerd/io/worker.h>
 #include <workerd/jsg/jsg.h>
 #include <workerd/server/workerd.capnp.h>
@@ -26,6 +27,8 @@ struct TestFixture {
     kj::Maybe<kj::StringPtr> mainModuleSource;
     // If set, make a stub of an Actor with the given id.
     kj::Maybe<Worker::Actor::Id> actorId;
+    // Allowing the inspector doesn't attach a session; that's up to the test.
+    Worker::Isolate::InspectorPolicy inspectorPolicy = Worker::Isolate::InspectorPolicy::DISALLOW;
   };
 
   TestFixture(SetupParams&& params = {});
@@ -88,6 +91,25 @@ struct TestFixture {
   // Performs HTTP request on the default module handler, and waits for full response.
   Response runRequest(kj::HttpMethod method, kj::StringPtr url, kj::StringPtr body);
 
+  // As above, with request headers set by `setHeaders`.
+  Response runRequest(kj::HttpMethod method,
+      kj::StringPtr url,
+      kj::StringPtr body,
+      kj::FunctionParam<void(kj::HttpHeaders&)> setHeaders);
+
+  // Opens a JS RPC session with the default entrypoint, the way a service binding does, and
+  // passes the session's top-level capability to `callback`. Returns once the callback's promise
+  // resolves and the session has ended.
+  void runJsRpcSession(kj::Function<kj::Promise<void>(rpc::JsRpcTarget::Client)> callback);
+
+  // Serialize and deserialize values the way JS RPC does for a call's arguments and results.
+  static kj::Array<kj::byte> serializeJsRpcValue(jsg::Lock& js, jsg::JsValue value);
+  static jsg::JsValue deserializeJsRpcValue(jsg::Lock& js, kj::ArrayPtr<const kj::byte> data);
+
+  const Worker& getWorker() const {
+    return *worker;
+  }
+
  private:
   kj::Maybe<kj::WaitScope&> waitScope;
   capnp::MallocMessageBuilder configArena;
@@ -113,7 +135,8 @@ struct TestFixture {
   kj::TaskSet waitUntilTasks;
   kj::Own<kj::HttpHeaderTable> headerTable;
 
-  kj::Own<IoContext::IncomingRequest> createIncomingRequest();
+  // Unless `deliver` is false, the request is delivered before it's returned.
+  kj::Own<IoContext::IncomingRequest> createIncomingRequest(bool deliver = true);
 };
 
 }  // namespace workerd
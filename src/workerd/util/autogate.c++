@@ -17,6 +17,10 @@ kj::StringPtr KJ_STRINGIFY(AutogateKey key) {
   switch (key) {
     case AutogateKey::TEST_WORKERD:
       return "test-workerd"_kj;
+    case AutogateKey::OWNED_OBJECT_ARENA:
+      return "owned-object-arena"_kj;
+    case AutogateKey::BYTE_QUEUE_COALESCING:
+      return "byte-queue-coalescing"_kj;
     case AutogateKey::NumOfKeys:
       KJ_FAIL_ASSERT("NumOfKeys should not be used in getName");
   }
@@ -14,6 +14,10 @@ namespace workerd::util {
 // Workerd-specific list of autogate keys (can also be used in internal repo).
 enum class AutogateKey {
   TEST_WORKERD,
+  // Allocates the objects that IoContext::addObject() links from a per-request arena.
+  OWNED_OBJECT_ARENA,
+  // Coalesces small chunks buffered in ByteQueue consumers; see ByteQueue::CoalescingPolicy.
+  BYTE_QUEUE_COALESCING,
   NumOfKeys  // Reserved for iteration.
 };
 
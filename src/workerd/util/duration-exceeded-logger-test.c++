@@ -22,5 +22,39 @@ KJ_TEST("Duration alert triggers when time is exceeded") {
   }
 }
 
+KJ_TEST("SlowOperationSite counts every operation and reports the slow ones") {
+  kj::TimerImpl timer(kj::origin<kj::TimePoint>());
+  static SlowOperationSite site("test operation", 100 * kj::MILLISECONDS, 10 * kj::SECONDS);
+
+  {
+    SlowOperationTimer fast(site, timer);
+    timer.advanceTo(timer.now() + 1 * kj::MILLISECONDS);
+  }
+  {
+    KJ_EXPECT_LOG(WARNING, "slow operation: test operation; threshold = 100ms; duration = 3s");
+    SlowOperationTimer slow(site, timer);
+    timer.advanceTo(timer.now() + 3 * kj::SECONDS);
+  }
+
+  KJ_EXPECT(site.getBucketCount(0) == 1);
+  KJ_EXPECT(site.getBucketCount(12) == 1);  // 2.048s < 3s <= 4.096s
+  KJ_EXPECT(site.getBucketCount(SlowOperationSite::BUCKET_COUNT - 1) == 0);
+  KJ_EXPECT(site.getTotalDuration() == 3001 * kj::MILLISECONDS);
+
+  // Another slow operation within the report interval is only counted...
+  site.record(200 * kj::MILLISECONDS, timer.now());
+
+  // ... and mentioned by the next report.
+  timer.advanceTo(timer.now() + 10 * kj::SECONDS);
+  {
+    KJ_EXPECT_LOG(WARNING, "duration = 500ms; unreportedCount = 1");
+    site.record(500 * kj::MILLISECONDS, timer.now());
+  }
+
+  bool found = false;
+  SlowOperationSite::forEach([&](const SlowOperationSite& s) { found = found || &s == &site; });
+  KJ_EXPECT(found);
+}
+
 }  // namespace
 }  // namespace workerd::util
@@ -0,0 +1,90 @@
+// Copyright (c) 2017-2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "duration-exceeded-logger.h"
+
+#include <kj/exception.h>
+
+namespace workerd::util {
+
+namespace {
+
+std::atomic<const SlowOperationSite*> allSites = nullptr;
+std::atomic<SlowOperationSite::JsStackCapturer> jsStackCapturer = nullptr;
+
+int64_t toNs(kj::TimePoint time) {
+  return (time - kj::origin<kj::TimePoint>()) / kj::NANOSECONDS;
+}
+
+}  // namespace
+
+SlowOperationSite::SlowOperationSite(
+    kj::StringPtr name, kj::Duration threshold, kj::Duration reportInterval)
+    : name(name),
+      threshold(threshold),
+      reportInterval(reportInterval),
+      next(allSites.load(std::memory_order_relaxed)) {
+  while (!allSites.compare_exchange_weak(next, this, std::memory_order_release)) {
+  }
+}
+
+kj::Maybe<kj::Duration> SlowOperationSite::getBucketBound(size_t i) {
+  if (i + 1 >= BUCKET_COUNT) return kj::none;
+  return (1ll << i) * kj::MILLISECONDS;
+}
+
+void SlowOperationSite::record(kj::Duration duration, kj::TimePoint now) {
+  size_t bucket = 0;
+  while (bucket + 1 < BUCKET_COUNT && duration > (1ll << bucket) * kj::MILLISECONDS) {
+    ++bucket;
+  }
+  buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+  totalNs.fetch_add(duration / kj::NANOSECONDS, std::memory_order_relaxed);
+
+  if (duration < threshold) return;
+
+  // Only the thread that moves `nextReportNs` forward reports; the others just count.
+  auto nowNs = toNs(now);
+  auto nextNs = nextReportNs.load(std::memory_order_relaxed);
+  if (nowNs < nextNs ||
+      !nextReportNs.compare_exchange_strong(
+          nextNs, nowNs + reportInterval / kj::NANOSECONDS, std::memory_order_relaxed)) {
+    unreported.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  report(duration, unreported.exchange(0, std::memory_order_relaxed));
+}
+
+void SlowOperationSite::report(kj::Duration duration, uint64_t unreportedCount) {
+  // Symbolizing the native stack is expensive, so only the addresses are logged.
+  void* space[32]{};
+  auto trace = kj::getStackTrace(space, 2);
+  auto nativeStack = kj::stringifyStackTraceAddresses(trace);
+
+  kj::Maybe<kj::String> jsStack;
+  auto capturer = jsStackCapturer.load(std::memory_order_relaxed);
+  if (capturer != nullptr) {
+    jsStack = capturer();
+  }
+
+  KJ_IF_SOME(js, jsStack) {
+    KJ_LOG(WARNING, kj::str("NOSENTRY slow operation: ", name), threshold, duration,
+        unreportedCount, js, nativeStack);
+  } else {
+    KJ_LOG(WARNING, kj::str("NOSENTRY slow operation: ", name), threshold, duration,
+        unreportedCount, nativeStack);
+  }
+}
+
+void SlowOperationSite::forEach(kj::FunctionParam<void(const SlowOperationSite&)> func) {
+  for (auto site = allSites.load(std::memory_order_acquire); site != nullptr; site = site->next) {
+    func(*site);
+  }
+}
+
+void SlowOperationSite::setJsStackCapturer(JsStackCapturer capturer) {
+  jsStackCapturer.store(capturer, std::memory_order_relaxed);
+}
+
+}  // namespace workerd::util
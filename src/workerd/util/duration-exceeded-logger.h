@@ -5,9 +5,12 @@
 #pragma once
 
 #include <kj/debug.h>
+#include <kj/function.h>
 #include <kj/string.h>
 #include <kj/time.h>
 
+#include <atomic>
+
 namespace workerd::util {
 
 // This is a utility class for instantiating a timer, which will log if it's destructed after a specified time
@@ -40,4 +43,95 @@ class DurationExceededLogger {
   const kj::MonotonicClock& clock;
 };
 
+// A call site profiled by SlowOperationTimer. Declare one as a function-local static next to the
+// code it times:
+//
+//     static util::SlowOperationSite site("sqlite query", 100 * kj::MILLISECONDS);
+//     util::SlowOperationTimer timer(site);
+//
+// Every timed operation is counted in the site's histogram. An operation that takes at least
+// `threshold` is logged as a warning with the native stack, and the JavaScript stack if the
+// thread is running JavaScript. At most one such warning is logged per `reportInterval`; the
+// warning says how many slow operations were left unreported since the last one.
+//
+// Sites are safe to use from any thread. They are never destroyed before the process exits, so
+// forEach() can visit them at any time.
+class SlowOperationSite {
+ public:
+  // Bucket `i` counts operations that took up to `1ms << i`. The last bucket is unbounded.
+  static constexpr size_t BUCKET_COUNT = 17;
+
+  SlowOperationSite(kj::StringPtr name,
+      kj::Duration threshold,
+      kj::Duration reportInterval = 10 * kj::SECONDS);
+  KJ_DISALLOW_COPY_AND_MOVE(SlowOperationSite);
+
+  // Records one operation, reporting it if it was slow.
+  void record(kj::Duration duration, kj::TimePoint now);
+
+  kj::StringPtr getName() const {
+    return name;
+  }
+  kj::Duration getThreshold() const {
+    return threshold;
+  }
+
+  // Returns the upper bound of bucket `i`, or kj::none for the unbounded last bucket.
+  static kj::Maybe<kj::Duration> getBucketBound(size_t i);
+  uint64_t getBucketCount(size_t i) const {
+    return buckets[i].load(std::memory_order_relaxed);
+  }
+  kj::Duration getTotalDuration() const {
+    return totalNs.load(std::memory_order_relaxed) * kj::NANOSECONDS;
+  }
+
+  // Calls `func` with every site that has been constructed.
+  static void forEach(kj::FunctionParam<void(const SlowOperationSite&)> func);
+
+  // Captures the current thread's JavaScript stack for slow operation reports, returning
+  // kj::none if the thread isn't running JavaScript. This library doesn't depend on V8, so the
+  // runtime installs the capturer when it creates its first isolate.
+  using JsStackCapturer = kj::Maybe<kj::String> (*)();
+  static void setJsStackCapturer(JsStackCapturer capturer);
+
+ private:
+  kj::StringPtr name;
+  kj::Duration threshold;
+  kj::Duration reportInterval;
+
+  std::atomic<uint64_t> buckets[BUCKET_COUNT] = {};
+  std::atomic<uint64_t> totalNs = 0;
+
+  // Monotonic time, in nanoseconds since the clock's origin, before which slow operations are
+  // only counted in `unreported`.
+  std::atomic<int64_t> nextReportNs = kj::minValue;
+  std::atomic<uint64_t> unreported = 0;
+
+  // Links all sites, newest first.
+  const SlowOperationSite* next;
+
+  void report(kj::Duration duration, uint64_t unreportedCount);
+};
+
+// Times the scope it's declared in, recording the duration to `site` when destroyed.
+class SlowOperationTimer {
+ public:
+  explicit SlowOperationTimer(
+      SlowOperationSite& site, const kj::MonotonicClock& clock = kj::systemPreciseMonotonicClock())
+      : site(site),
+        clock(clock),
+        start(clock.now()) {}
+  KJ_DISALLOW_COPY_AND_MOVE(SlowOperationTimer);
+
+  ~SlowOperationTimer() noexcept(false) {
+    auto now = clock.now();
+    site.record(now - start, now);
+  }
+
+ private:
+  SlowOperationSite& site;
+  const kj::MonotonicClock& clock;
+  kj::TimePoint start;
+};
+
 }  // namespace workerd::util
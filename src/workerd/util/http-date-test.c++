@@ -0,0 +1,86 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "http-date.h"
+
+#include <kj/test.h>
+
+namespace workerd {
+namespace {
+
+// 1994-11-06T08:49:37Z, the example date of RFC 9110.
+constexpr kj::Date kExample = kj::UNIX_EPOCH + 784111777 * kj::SECONDS;
+
+kj::Date httpDate(kj::StringPtr text) {
+  return KJ_ASSERT_NONNULL(parseHttpDate(text), text);
+}
+
+kj::Date rfc3339Date(kj::StringPtr text) {
+  return KJ_ASSERT_NONNULL(parseRfc3339Date(text), text);
+}
+
+KJ_TEST("parseHttpDate accepts all three HTTP date formats") {
+  KJ_EXPECT(httpDate("Sun, 06 Nov 1994 08:49:37 GMT") == kExample);
+  KJ_EXPECT(httpDate("Sunday, 06-Nov-94 08:49:37 GMT") == kExample);
+  KJ_EXPECT(httpDate("Sun Nov  6 08:49:37 1994") == kExample);
+  KJ_EXPECT(httpDate("Sun Nov 16 08:49:37 1994") == kExample + 10 * kj::DAYS);
+
+  KJ_EXPECT(httpDate("Thu, 01 Jan 1970 00:00:00 GMT") == kj::UNIX_EPOCH);
+  KJ_EXPECT(httpDate("Wed, 31 Dec 1969 23:59:59 GMT") == kj::UNIX_EPOCH - 1 * kj::SECONDS);
+  KJ_EXPECT(httpDate("Tue, 29 Feb 2000 12:00:00 GMT") ==
+      kj::UNIX_EPOCH + 951825600 * kj::SECONDS);
+
+  // Two-digit years before 50 are in this century.
+  KJ_EXPECT(httpDate("Monday, 01-Jan-24 00:00:00 GMT") ==
+      kj::UNIX_EPOCH + 1704067200 * kj::SECONDS);
+}
+
+KJ_TEST("parseHttpDate rejects malformed dates") {
+  for (auto text: {""_kj, "Sun, 6 Nov 1994 08:49:37 GMT"_kj, "Sun, 06 Nov 1994 08:49:37 UTC"_kj,
+         "Sun, 06 nov 1994 08:49:37 GMT"_kj, "Sun, 06 Nov 1994 08:49:37 GMT "_kj,
+         "Sun, 06 Nov 1994 8:49:37 GMT"_kj, "Sun, 31 Nov 1994 08:49:37 GMT"_kj,
+         "Sun, 29 Feb 1900 08:49:37 GMT"_kj, "Sun, 06 Nov 1994 24:00:00 GMT"_kj,
+         "Sun, 06 Nov 1994 08:60:00 GMT"_kj, "Sun, 06 Nov 9999 08:49:37 GMT"_kj,
+         "Sun, 06-Nov-94 08:49:37 GMT"_kj, "Sun Nov 6 08:49:37 1994"_kj,
+         "1994-11-06T08:49:37Z"_kj}) {
+    KJ_EXPECT(parseHttpDate(text) == kj::none, text);
+  }
+}
+
+KJ_TEST("formatHttpDate produces IMF-fixdates") {
+  KJ_EXPECT(formatHttpDate(kExample) == "Sun, 06 Nov 1994 08:49:37 GMT");
+  KJ_EXPECT(formatHttpDate(kj::UNIX_EPOCH) == "Thu, 01 Jan 1970 00:00:00 GMT");
+
+  // Fractions of a second are truncated, also before the epoch.
+  KJ_EXPECT(formatHttpDate(kExample + 999 * kj::MILLISECONDS) == "Sun, 06 Nov 1994 08:49:37 GMT");
+  KJ_EXPECT(formatHttpDate(kj::UNIX_EPOCH - 1 * kj::MILLISECONDS) ==
+      "Wed, 31 Dec 1969 23:59:59 GMT");
+
+  // Every day of a few years round-trips, which covers every weekday, month and leap day.
+  for (int64_t day = 0; day < 4 * 366; day++) {
+    auto date = kj::UNIX_EPOCH + (10956 + day) * kj::DAYS + day * kj::SECONDS;
+    KJ_EXPECT(httpDate(formatHttpDate(date)) == date, formatHttpDate(date));
+  }
+}
+
+KJ_TEST("RFC 3339 dates") {
+  KJ_EXPECT(rfc3339Date("1994-11-06T08:49:37Z") == kExample);
+  KJ_EXPECT(rfc3339Date("1994-11-06t08:49:37z") == kExample);
+  KJ_EXPECT(rfc3339Date("1994-11-06 08:49:37Z") == kExample);
+  KJ_EXPECT(rfc3339Date("1994-11-06T09:49:37+01:00") == kExample);
+  KJ_EXPECT(rfc3339Date("1994-11-06T00:19:37-08:30") == kExample);
+  KJ_EXPECT(rfc3339Date("1994-11-06T08:49:37.1Z") == kExample + 100 * kj::MILLISECONDS);
+  KJ_EXPECT(rfc3339Date("1994-11-06T08:49:37.123456Z") == kExample + 123 * kj::MILLISECONDS);
+
+  for (auto text: {"1994-11-06T08:49:37"_kj, "1994-11-06T08:49:37.Z"_kj, "1994-11-6T08:49:37Z"_kj,
+         "1994-13-06T08:49:37Z"_kj, "1994-11-06T08:49:37+0100"_kj, "1994-11-06"_kj}) {
+    KJ_EXPECT(parseRfc3339Date(text) == kj::none, text);
+  }
+
+  KJ_EXPECT(formatRfc3339Date(kExample + 7 * kj::MILLISECONDS) == "1994-11-06T08:49:37.007Z");
+  KJ_EXPECT(formatRfc3339Date(kj::UNIX_EPOCH - 1 * kj::MILLISECONDS) == "1969-12-31T23:59:59.999Z");
+}
+
+}  // namespace
+}  // namespace workerd
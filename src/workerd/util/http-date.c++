@@ -0,0 +1,347 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "http-date.h"
+
+#include <kj/debug.h>
+
+#include <cstring>
+
+namespace workerd {
+
+namespace {
+
+constexpr kj::StringPtr kDayNames[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+constexpr kj::StringPtr kLongDayNames[] = {
+  "Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday"};
+constexpr kj::StringPtr kMonthNames[] = {
+  "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+// The years that kj::Date, nanoseconds since the epoch in an int64_t, can fully represent.
+constexpr int kMinYear = 1678;
+constexpr int kMaxYear = 2261;
+
+int64_t floorDiv(int64_t a, int64_t b) {
+  return a / b - (a % b != 0 && (a < 0) != (b < 0));
+}
+
+bool isLeapYear(int year) {
+  return year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+}
+
+int daysInMonth(int year, int month) {
+  static constexpr int kDays[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  return month == 2 && isLeapYear(year) ? 29 : kDays[month - 1];
+}
+
+// Converts a proleptic Gregorian date to days since 1970-01-01, and back. See
+// https://howardhinnant.github.io/date_algorithms.html for how these work.
+int64_t daysFromCivil(int year, int month, int day) {
+  int64_t y = year - (month <= 2);
+  int64_t era = floorDiv(y, 400);
+  int64_t yearOfEra = y - era * 400;
+  int64_t dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+  int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+  return era * 146097 + dayOfEra - 719468;
+}
+
+struct CivilDate {
+  int year;
+  int month;
+  int day;
+};
+
+CivilDate civilFromDays(int64_t days) {
+  days += 719468;
+  int64_t era = floorDiv(days, 146097);
+  int64_t dayOfEra = days - era * 146097;
+  int64_t yearOfEra =
+      (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+  int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+  int64_t shiftedMonth = (5 * dayOfYear + 2) / 153;
+  int month = shiftedMonth < 10 ? shiftedMonth + 3 : shiftedMonth - 9;
+  return {
+    .year = static_cast<int>(yearOfEra + era * 400 + (month <= 2)),
+    .month = month,
+    .day = static_cast<int>(dayOfYear - (153 * shiftedMonth + 2) / 5 + 1),
+  };
+}
+
+// The fields of a parsed date, before they have been checked.
+struct DateFields {
+  int year = 0;
+  int month = 0;
+  int day = 0;
+  int hour = 0;
+  int minute = 0;
+  int second = 0;
+  int millisecond = 0;
+  int offsetMinutes = 0;
+
+  kj::Maybe<kj::Date> toDate() const {
+    // RFC 9110 and RFC 3339 both allow a leap second, which we fold into the next minute.
+    if (year < kMinYear || year > kMaxYear || month < 1 || month > 12 || day < 1 ||
+        day > daysInMonth(year, month) || hour > 23 || minute > 59 || second > 60) {
+      return kj::none;
+    }
+    int64_t seconds = daysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 +
+        second - offsetMinutes * 60;
+    return kj::UNIX_EPOCH + seconds * kj::SECONDS + millisecond * kj::MILLISECONDS;
+  }
+};
+
+// Reads a date from left to right. Every method returns false, or kj::none, if the text doesn't
+// continue as expected, in which case the parser must not be used any more.
+class Parser {
+ public:
+  explicit Parser(kj::StringPtr text): rest(text.asArray()) {}
+
+  bool atEnd() const {
+    return rest.size() == 0;
+  }
+
+  bool consume(char c) {
+    if (rest.size() == 0 || rest[0] != c) return false;
+    rest = rest.slice(1);
+    return true;
+  }
+
+  bool consume(kj::StringPtr expected) {
+    if (!rest.startsWith(expected.asArray())) return false;
+    rest = rest.slice(expected.size());
+    return true;
+  }
+
+  // Reads exactly `count` digits.
+  kj::Maybe<int> digits(size_t count) {
+    if (rest.size() < count) return kj::none;
+    int value = 0;
+    for (auto c: rest.first(count)) {
+      if (c < '0' || c > '9') return kj::none;
+      value = value * 10 + (c - '0');
+    }
+    rest = rest.slice(count);
+    return value;
+  }
+
+  // Reads one of `names` and returns its index.
+  template <size_t n>
+  kj::Maybe<int> oneOf(const kj::StringPtr (&names)[n]) {
+    for (auto i: kj::zeroTo(n)) {
+      if (consume(names[i])) return static_cast<int>(i);
+    }
+    return kj::none;
+  }
+
+  // Reads "hh:mm:ss" into `fields`.
+  bool timeOfDay(DateFields& fields) {
+    fields.hour = KJ_UNWRAP_OR(digits(2), return false);
+    if (!consume(':')) return false;
+    fields.minute = KJ_UNWRAP_OR(digits(2), return false);
+    if (!consume(':')) return false;
+    fields.second = KJ_UNWRAP_OR(digits(2), return false);
+    return true;
+  }
+
+ private:
+  kj::ArrayPtr<const char> rest;
+};
+
+kj::Maybe<kj::Date> parseImfFixdate(kj::StringPtr text) {
+  // Sun, 06 Nov 1994 08:49:37 GMT
+  Parser parser(text);
+  DateFields fields;
+  if (parser.oneOf(kDayNames) == kj::none || !parser.consume(", ")) return kj::none;
+  fields.day = KJ_UNWRAP_OR(parser.digits(2), return kj::none);
+  if (!parser.consume(' ')) return kj::none;
+  fields.month = KJ_UNWRAP_OR(parser.oneOf(kMonthNames), return kj::none) + 1;
+  if (!parser.consume(' ')) return kj::none;
+  fields.year = KJ_UNWRAP_OR(parser.digits(4), return kj::none);
+  if (!parser.consume(' ') || !parser.timeOfDay(fields) || !parser.consume(" GMT") ||
+      !parser.atEnd()) {
+    return kj::none;
+  }
+  return fields.toDate();
+}
+
+kj::Maybe<kj::Date> parseRfc850Date(kj::StringPtr text) {
+  // Sunday, 06-Nov-94 08:49:37 GMT
+  Parser parser(text);
+  DateFields fields;
+  if (parser.oneOf(kLongDayNames) == kj::none || !parser.consume(", ")) return kj::none;
+  fields.day = KJ_UNWRAP_OR(parser.digits(2), return kj::none);
+  if (!parser.consume('-')) return kj::none;
+  fields.month = KJ_UNWRAP_OR(parser.oneOf(kMonthNames), return kj::none) + 1;
+  if (!parser.consume('-')) return kj::none;
+  // Two-digit years are resolved the way V8's Date parser does it.
+  int year = KJ_UNWRAP_OR(parser.digits(2), return kj::none);
+  fields.year = year < 50 ? 2000 + year : 1900 + year;
+  if (!parser.consume(' ') || !parser.timeOfDay(fields) || !parser.consume(" GMT") ||
+      !parser.atEnd()) {
+    return kj::none;
+  }
+  return fields.toDate();
+}
+
+kj::Maybe<kj::Date> parseAsctimeDate(kj::StringPtr text) {
+  // Sun Nov  6 08:49:37 1994
+  Parser parser(text);
+  DateFields fields;
+  if (parser.oneOf(kDayNames) == kj::none || !parser.consume(' ')) return kj::none;
+  fields.month = KJ_UNWRAP_OR(parser.oneOf(kMonthNames), return kj::none) + 1;
+  if (!parser.consume(' ')) return kj::none;
+  if (parser.consume(' ')) {
+    fields.day = KJ_UNWRAP_OR(parser.digits(1), return kj::none);
+  } else {
+    fields.day = KJ_UNWRAP_OR(parser.digits(2), return kj::none);
+  }
+  if (!parser.consume(' ') || !parser.timeOfDay(fields) || !parser.consume(' ')) {
+    return kj::none;
+  }
+  fields.year = KJ_UNWRAP_OR(parser.digits(4), return kj::none);
+  if (!parser.atEnd()) return kj::none;
+  return fields.toDate();
+}
+
+// Splits `date` into its fields in UTC, truncating it to whole milliseconds.
+DateFields toFields(kj::Date date) {
+  int64_t milliseconds = floorDiv((date - kj::UNIX_EPOCH) / kj::NANOSECONDS, 1000000);
+  int64_t seconds = floorDiv(milliseconds, 1000);
+  int64_t days = floorDiv(seconds, 86400);
+  int64_t secondOfDay = seconds - days * 86400;
+  auto civil = civilFromDays(days);
+  return {
+    .year = civil.year,
+    .month = civil.month,
+    .day = civil.day,
+    .hour = static_cast<int>(secondOfDay / 3600),
+    .minute = static_cast<int>(secondOfDay / 60 % 60),
+    .second = static_cast<int>(secondOfDay % 60),
+    .millisecond = static_cast<int>(milliseconds - seconds * 1000),
+  };
+}
+
+// Writes `value` as `width` decimal digits, zero-padded, and returns the position after them.
+char* writeDigits(char* pos, int value, int width) {
+  for (int i = width - 1; i >= 0; i--) {
+    pos[i] = '0' + value % 10;
+    value /= 10;
+  }
+  return pos + width;
+}
+
+}  // namespace
+
+kj::Maybe<kj::Date> parseHttpDate(kj::StringPtr text) {
+  // Try the format that senders must use first. The others can be told apart by the character
+  // after the day name.
+  KJ_IF_SOME(date, parseImfFixdate(text)) {
+    return date;
+  }
+  KJ_IF_SOME(date, parseRfc850Date(text)) {
+    return date;
+  }
+  return parseAsctimeDate(text);
+}
+
+kj::String formatHttpDate(kj::Date date) {
+  auto fields = toFields(date);
+  int64_t days = daysFromCivil(fields.year, fields.month, fields.day);
+  int weekday = static_cast<int>(days + 4 - floorDiv(days + 4, 7) * 7);
+
+  // Sun, 06 Nov 1994 08:49:37 GMT
+  auto result = kj::heapString(29);
+  char* pos = result.begin();
+  auto append = [&](kj::StringPtr str) {
+    memcpy(pos, str.begin(), str.size());
+    pos += str.size();
+  };
+  append(kDayNames[weekday]);
+  append(", ");
+  pos = writeDigits(pos, fields.day, 2);
+  *pos++ = ' ';
+  append(kMonthNames[fields.month - 1]);
+  *pos++ = ' ';
+  pos = writeDigits(pos, fields.year, 4);
+  *pos++ = ' ';
+  pos = writeDigits(pos, fields.hour, 2);
+  *pos++ = ':';
+  pos = writeDigits(pos, fields.minute, 2);
+  *pos++ = ':';
+  pos = writeDigits(pos, fields.second, 2);
+  append(" GMT");
+  KJ_DASSERT(pos == result.end());
+  return result;
+}
+
+kj::Maybe<kj::Date> parseRfc3339Date(kj::StringPtr text) {
+  // 1994-11-06T08:49:37.123Z or 1994-11-06T09:49:37+01:00
+  Parser parser(text);
+  DateFields fields;
+  fields.year = KJ_UNWRAP_OR(parser.digits(4), return kj::none);
+  if (!parser.consume('-')) return kj::none;
+  fields.month = KJ_UNWRAP_OR(parser.digits(2), return kj::none);
+  if (!parser.consume('-')) return kj::none;
+  fields.day = KJ_UNWRAP_OR(parser.digits(2), return kj::none);
+  if (!parser.consume('T') && !parser.consume('t') && !parser.consume(' ')) return kj::none;
+  if (!parser.timeOfDay(fields)) return kj::none;
+
+  if (parser.consume('.')) {
+    // At least one digit is required. Only the first three matter.
+    int scale = 100;
+    fields.millisecond = KJ_UNWRAP_OR(parser.digits(1), return kj::none) * scale;
+    for (;;) {
+      KJ_IF_SOME(digit, parser.digits(1)) {
+        scale /= 10;
+        fields.millisecond += digit * scale;
+      } else {
+        break;
+      }
+    }
+  }
+
+  if (!parser.consume('Z') && !parser.consume('z')) {
+    int sign;
+    if (parser.consume('+')) {
+      sign = 1;
+    } else if (parser.consume('-')) {
+      sign = -1;
+    } else {
+      return kj::none;
+    }
+    int hours = KJ_UNWRAP_OR(parser.digits(2), return kj::none);
+    if (!parser.consume(':')) return kj::none;
+    int minutes = KJ_UNWRAP_OR(parser.digits(2), return kj::none);
+    if (hours > 23 || minutes > 59) return kj::none;
+    fields.offsetMinutes = sign * (hours * 60 + minutes);
+  }
+  if (!parser.atEnd()) return kj::none;
+  return fields.toDate();
+}
+
+kj::String formatRfc3339Date(kj::Date date) {
+  auto fields = toFields(date);
+
+  // 1994-11-06T08:49:37.123Z
+  auto result = kj::heapString(24);
+  char* pos = result.begin();
+  pos = writeDigits(pos, fields.year, 4);
+  *pos++ = '-';
+  pos = writeDigits(pos, fields.month, 2);
+  *pos++ = '-';
+  pos = writeDigits(pos, fields.day, 2);
+  *pos++ = 'T';
+  pos = writeDigits(pos, fields.hour, 2);
+  *pos++ = ':';
+  pos = writeDigits(pos, fields.minute, 2);
+  *pos++ = ':';
+  pos = writeDigits(pos, fields.second, 2);
+  *pos++ = '.';
+  pos = writeDigits(pos, fields.millisecond, 3);
+  *pos++ = 'Z';
+  KJ_DASSERT(pos == result.end());
+  return result;
+}
+
+}  // namespace workerd
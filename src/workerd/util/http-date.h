@@ -0,0 +1,37 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <kj/string.h>
+#include <kj/time.h>
+
+namespace workerd {
+
+// Native conversions between kj::Date and the date formats used in HTTP headers and APIs, so
+// that code that only needs to read or write a header doesn't have to call into V8's Date.
+//
+// All of these only handle dates from year 1678 to 2261, the range of kj::Date. Dates are
+// truncated to whole seconds by the HTTP format and to whole milliseconds by RFC 3339, like
+// Date.prototype.toUTCString() and toISOString() do.
+
+// Parses an HTTP date as defined by RFC 9110 section 5.6.7: an IMF-fixdate such as
+// "Sun, 06 Nov 1994 08:49:37 GMT", or one of the obsolete RFC 850 ("Sunday, 06-Nov-94 08:49:37
+// GMT") and asctime ("Sun Nov  6 08:49:37 1994") formats. The day name is not checked against
+// the date. Returns kj::none if `text` is in none of these formats or names an invalid date.
+kj::Maybe<kj::Date> parseHttpDate(kj::StringPtr text);
+
+// Formats `date` as an IMF-fixdate, the format that Date.prototype.toUTCString() also produces.
+kj::String formatHttpDate(kj::Date date);
+
+// Parses an RFC 3339 timestamp such as "1994-11-06T08:49:37.123Z" or "1994-11-06T09:49:37+01:00".
+// Digits after the third of a fraction of a second are ignored. Returns kj::none if `text` isn't
+// such a timestamp.
+kj::Maybe<kj::Date> parseRfc3339Date(kj::StringPtr text);
+
+// Formats `date` as an RFC 3339 timestamp in UTC with milliseconds, the format that
+// Date.prototype.toISOString() also produces.
+kj::String formatRfc3339Date(kj::Date date);
+
+}  // namespace workerd
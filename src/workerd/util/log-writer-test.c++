@@ -0,0 +1,69 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "log-writer.h"
+
+#include <kj/io.h>
+#include <kj/test.h>
+
+#include <unistd.h>
+
+namespace workerd {
+namespace {
+
+struct Pipe {
+  kj::AutoCloseFd readEnd;
+  kj::AutoCloseFd writeEnd;
+
+  Pipe() {
+    int fds[2];
+    KJ_SYSCALL(pipe(fds));
+    readEnd = kj::AutoCloseFd(fds[0]);
+    writeEnd = kj::AutoCloseFd(fds[1]);
+  }
+
+  // Reads everything written so far. Only call once the writer is gone.
+  kj::String readAll() {
+    writeEnd = nullptr;
+    return kj::FdInputStream(kj::mv(readEnd)).readAllText();
+  }
+};
+
+KJ_TEST("LogWriter writes lines in order to their descriptors") {
+  Pipe out, err;
+  {
+    LogWriter writer(out.writeEnd, err.writeEnd);
+    writer.write(false, "log"_kj, kj::str("one"));
+    writer.write(true, "error"_kj, kj::str("two"));
+    writer.write(false, "log"_kj, kj::str("three"));
+  }
+  KJ_EXPECT(out.readAll() == "one\nthree\n");
+  KJ_EXPECT(err.readAll() == "two\n");
+}
+
+KJ_TEST("LogWriter JSON format") {
+  Pipe out, err;
+  {
+    LogWriter writer(out.writeEnd, err.writeEnd);
+    writer.setFormat(LogWriter::Format::JSON);
+    writer.write(false, "info"_kj, kj::str("say \"hi\"\n\x01"));
+  }
+  KJ_EXPECT(out.readAll() == "{\"level\":\"info\",\"message\":\"say \\\"hi\\\"\\n\\u0001\"}\n");
+}
+
+KJ_TEST("LogWriter drops lines past its buffer limit") {
+  Pipe out, err;
+  {
+    // A limit smaller than any line, so that everything is dropped deterministically.
+    LogWriter writer(out.writeEnd, err.writeEnd, 2);
+    writer.write(false, "log"_kj, kj::str("dropped"));
+    writer.write(false, "log"_kj, kj::str("also dropped"));
+    KJ_EXPECT(writer.getDroppedCount() == 2);
+  }
+  KJ_EXPECT(out.readAll() == "");
+  KJ_EXPECT(err.readAll().endsWith(" log lines dropped]\n"));
+}
+
+}  // namespace
+}  // namespace workerd
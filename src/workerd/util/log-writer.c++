@@ -0,0 +1,158 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "log-writer.h"
+
+#include <kj/debug.h>
+#include <kj/io.h>
+#include <kj/vector.h>
+
+#if _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace workerd {
+
+namespace {
+
+void appendJsonString(kj::Vector<char>& out, kj::StringPtr text) {
+  static constexpr char HEX[] = "0123456789abcdef";
+  out.add('"');
+  for (char c: text) {
+    switch (c) {
+      case '"':
+        out.addAll("\\\""_kj);
+        break;
+      case '\\':
+        out.addAll("\\\\"_kj);
+        break;
+      case '\n':
+        out.addAll("\\n"_kj);
+        break;
+      case '\r':
+        out.addAll("\\r"_kj);
+        break;
+      case '\t':
+        out.addAll("\\t"_kj);
+        break;
+      default:
+        if (auto b = static_cast<kj::byte>(c); b < 0x20) {
+          out.addAll("\\u00"_kj);
+          out.add(HEX[b >> 4]);
+          out.add(HEX[b & 0xf]);
+        } else {
+          out.add(c);
+        }
+    }
+  }
+  out.add('"');
+}
+
+}  // namespace
+
+LogWriter::LogWriter(int outFd, int errFd, size_t maxBufferedBytes)
+    : outFd(outFd),
+      errFd(errFd),
+      maxBufferedBytes(maxBufferedBytes) {
+  thread = kj::heap<kj::Thread>([this]() { threadMain(); });
+}
+
+LogWriter::~LogWriter() noexcept(false) {
+  state.lockExclusive()->shuttingDown = true;
+  // Joins the thread, which writes out whatever is still queued before it exits.
+  thread = kj::none;
+}
+
+LogWriter& LogWriter::getStdio() {
+#if _WIN32
+  static LogWriter writer(_fileno(stdout), _fileno(stderr));
+#else
+  static LogWriter writer(STDOUT_FILENO, STDERR_FILENO);
+#endif
+  return writer;
+}
+
+void LogWriter::write(bool toErr, kj::StringPtr level, kj::String message) {
+  // Count the newline too, so that a queued line always makes `bufferedBytes` non-zero.
+  auto size = message.size() + 1;
+  auto lock = state.lockExclusive();
+  if (lock->bufferedBytes + size > maxBufferedBytes) {
+    ++lock->dropped;
+    return;
+  }
+  lock->bufferedBytes += size;
+  lock->queue.push(Line{toErr, level, kj::mv(message)});
+}
+
+void LogWriter::flush() {
+  auto lock = state.lockExclusive();
+  lock.wait([](const State& s) { return s.bufferedBytes == 0 && s.dropped == s.droppedReported; });
+}
+
+uint64_t LogWriter::getDroppedCount() const {
+  return state.lockShared()->dropped;
+}
+
+kj::String LogWriter::formatLine(const Line& line) {
+  if (format == Format::TEXT) {
+    return kj::str(line.message, '\n');
+  }
+  kj::Vector<char> out(line.message.size() + 32);
+  out.addAll("{\"level\":"_kj);
+  appendJsonString(out, line.level);
+  out.addAll(",\"message\":"_kj);
+  appendJsonString(out, line.message);
+  out.addAll("}\n"_kj);
+  out.add('\0');
+  return kj::String(out.releaseAsArray());
+}
+
+void LogWriter::threadMain() {
+  kj::FdOutputStream out(outFd);
+  kj::FdOutputStream err(errFd);
+
+  for (;;) {
+    BatchQueue<Line>::Batch batch;
+    uint64_t newlyDropped = 0;
+    {
+      auto lock = state.lockExclusive();
+      lock.wait([](const State& s) {
+        return s.shuttingDown || !s.queue.empty() || s.dropped != s.droppedReported;
+      });
+      if (lock->queue.empty() && lock->dropped == lock->droppedReported) return;
+      batch = lock->queue.pop();
+      newlyDropped = lock->dropped - lock->droppedReported;
+      lock->droppedReported = lock->dropped;
+    }
+
+    // The batch's buffer is not touched by write(), so it can be read without holding the lock.
+    auto lines = batch.asArrayPtr();
+    kj::Vector<kj::String> outLines(lines.size());
+    kj::Vector<kj::String> errLines;
+    size_t batchBytes = 0;
+    for (auto& line: lines) {
+      batchBytes += line.message.size() + 1;
+      (line.toErr ? errLines : outLines).add(formatLine(line));
+    }
+    if (newlyDropped > 0) {
+      errLines.add(kj::str("[", newlyDropped, " log lines dropped]\n"));
+    }
+
+    auto writeAll = [](kj::FdOutputStream& stream, kj::ArrayPtr<kj::String> texts) {
+      if (texts.size() == 0) return;
+      auto pieces = KJ_MAP(text, texts) { return text.asBytes(); };
+      // A broken or closed log pipe must not take down the process, so failures are ignored. The
+      // lines are lost either way.
+      auto exception KJ_UNUSED = kj::runCatchingExceptions([&]() { stream.write(pieces); });
+    };
+    writeAll(out, outLines);
+    writeAll(err, errLines);
+
+    state.lockExclusive()->bufferedBytes -= batchBytes;
+  }
+}
+
+}  // namespace workerd
@@ -0,0 +1,91 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <workerd/util/batch-queue.h>
+
+#include <kj/mutex.h>
+#include <kj/string.h>
+#include <kj/thread.h>
+
+namespace workerd {
+
+// Writes log lines to a pair of file descriptors from a dedicated thread, so that the threads
+// producing the lines only pay for an enqueue, never for a write(2) into a slow pipe.
+//
+// Lines are handed to the writer thread through a BatchQueue and written out a batch at a time
+// with a single vectored write per descriptor. Buffered lines are bounded by `maxBufferedBytes`:
+// lines logged while the writer is that far behind are dropped and counted, and the count is
+// reported on the error descriptor once the writer catches up.
+class LogWriter {
+ public:
+  enum class Format {
+    // Each line is written as-is.
+    TEXT,
+    // Each line is written as a JSON object with "level" and "message" fields, one per line.
+    JSON,
+  };
+
+  static constexpr size_t DEFAULT_MAX_BUFFERED_BYTES = 16 * 1024 * 1024;
+
+  LogWriter(int outFd, int errFd, size_t maxBufferedBytes = DEFAULT_MAX_BUFFERED_BYTES);
+
+  // Writes out everything queued so far before returning.
+  ~LogWriter() noexcept(false);
+  KJ_DISALLOW_COPY_AND_MOVE(LogWriter);
+
+  // Returns the process-wide writer for stdout and stderr, creating it on first use. It is
+  // destroyed, and so flushed, during static destruction.
+  static LogWriter& getStdio();
+
+  void setFormat(Format format) {
+    this->format = format;
+  }
+  Format getFormat() const {
+    return format;
+  }
+
+  // Queues `message` to be written as one line. `level` is only used in JSON format, and must
+  // have static storage, e.g. be a string literal. Lines with `toErr` set go to the error
+  // descriptor. Safe to call from any thread.
+  void write(bool toErr, kj::StringPtr level, kj::String message);
+
+  // Blocks until every line queued so far has been written. Call before exiting the process
+  // without running static destructors, as kj's process contexts do.
+  void flush();
+
+  // Number of lines dropped so far because the buffer was full.
+  uint64_t getDroppedCount() const;
+
+ private:
+  struct Line {
+    bool toErr;
+    kj::StringPtr level;
+    kj::String message;
+  };
+
+  struct State {
+    BatchQueue<Line> queue{64, 4096};
+    size_t bufferedBytes = 0;
+    uint64_t dropped = 0;
+    uint64_t droppedReported = 0;
+    bool shuttingDown = false;
+  };
+
+  int outFd;
+  int errFd;
+  size_t maxBufferedBytes;
+  Format format = Format::TEXT;
+
+  kj::MutexGuarded<State> state;
+
+  // Declared last so that the thread is joined before the members it uses are destroyed.
+  kj::Maybe<kj::Own<kj::Thread>> thread;
+
+  void threadMain();
+  kj::String formatLine(const Line& line);
+};
+
+}  // namespace workerd
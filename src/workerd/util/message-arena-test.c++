@@ -0,0 +1,69 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "message-arena.h"
+
+#include <capnp/any.h>
+#include <kj/test.h>
+
+#include <cstring>
+
+namespace workerd {
+namespace {
+
+const capnp::word* fillAndGetFirstSegment(capnp::MessageBuilder& message, uint textSize) {
+  auto text = message.initRoot<capnp::AnyPointer>().initAs<capnp::Text>(textSize);
+  memset(text.begin(), 'x', textSize);
+  return message.getSegmentsForOutput()[0].begin();
+}
+
+KJ_TEST("PooledMessageBuilder reuses its first segment, zeroed") {
+  const capnp::word* first;
+  {
+    PooledMessageBuilder message;
+    first = fillAndGetFirstSegment(message, 100);
+  }
+
+  PooledMessageBuilder message;
+  auto root = message.initRoot<capnp::AnyPointer>();
+  KJ_EXPECT(root.isNull());
+  KJ_EXPECT(message.getSegmentsForOutput()[0].begin() == first);
+  for (auto byte: kj::arrayPtr(first, capnp::SUGGESTED_FIRST_SEGMENT_WORDS).asBytes()) {
+    KJ_ASSERT(byte == 0);
+  }
+}
+
+KJ_TEST("PooledMessageBuilder sizes its first segment from the hint") {
+  const capnp::word* small;
+  {
+    PooledMessageBuilder message(capnp::MessageSize{16, 0});
+    small = fillAndGetFirstSegment(message, 8);
+  }
+
+  {
+    // A different size class doesn't get the small segment.
+    PooledMessageBuilder message(capnp::MessageSize{4000, 0});
+    KJ_EXPECT(fillAndGetFirstSegment(message, 30000) != small);
+    KJ_EXPECT(message.getSegmentsForOutput().size() == 1);
+  }
+
+  PooledMessageBuilder message(capnp::MessageSize{100, 0});
+  KJ_EXPECT(fillAndGetFirstSegment(message, 8) == small);
+}
+
+KJ_TEST("PooledMessageBuilder handles messages that outgrow the first segment") {
+  for (auto i = 0; i < 3; i++) {
+    PooledMessageBuilder message(capnp::MessageSize{16, 0});
+    auto list = message.initRoot<capnp::AnyPointer>().initAs<capnp::List<uint64_t>>(10000);
+    for (auto j: kj::indices(list)) list.set(j, j);
+    KJ_EXPECT(message.getSegmentsForOutput().size() > 1);
+  }
+
+  // An oversized hint still works, unpooled.
+  PooledMessageBuilder message(capnp::MessageSize{1 << 20, 0});
+  fillAndGetFirstSegment(message, 100);
+}
+
+}  // namespace
+}  // namespace workerd
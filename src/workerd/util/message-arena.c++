@@ -0,0 +1,84 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "message-arena.h"
+
+#include <kj/vector.h>
+
+#include <cstring>
+
+namespace workerd::_ {
+
+namespace {
+
+// Size classes are powers of two from 2KiB to 64KiB.
+constexpr uint MIN_CLASS_WORDS = 256;
+constexpr uint CLASS_COUNT = 6;
+constexpr uint MAX_CLASS_WORDS = MIN_CLASS_WORDS << (CLASS_COUNT - 1);
+
+// How many free segments each size class keeps per thread. Builders rarely nest deeply, so a few
+// cover every call that's in flight on a thread at once.
+constexpr uint MAX_FREE_PER_CLASS = 8;
+
+struct SegmentPool {
+  kj::Vector<kj::Array<capnp::word>> free[CLASS_COUNT];
+
+  ~SegmentPool() noexcept(false);
+};
+
+thread_local SegmentPool pool;
+
+// Set once the thread's pool has been destroyed, so that a builder destroyed later during thread
+// exit frees its segment instead.
+thread_local bool poolDestroyed = false;
+
+SegmentPool::~SegmentPool() noexcept(false) {
+  poolDestroyed = true;
+}
+
+uint classWords(uint sizeClass) {
+  return MIN_CLASS_WORDS << sizeClass;
+}
+
+kj::Maybe<uint> sizeClassFor(uint64_t words) {
+  for (uint sizeClass = 0; sizeClass < CLASS_COUNT; sizeClass++) {
+    if (words <= classWords(sizeClass)) return sizeClass;
+  }
+  return kj::none;
+}
+
+kj::Array<capnp::word> newZeroedSegment(size_t words) {
+  auto result = kj::heapArray<capnp::word>(words);
+  memset(result.begin(), 0, result.asBytes().size());
+  return result;
+}
+
+}  // namespace
+
+PooledFirstSegment::PooledFirstSegment(capnp::MessageSize sizeHint) {
+  auto words = kj::max(sizeHint.wordCount, 1);
+  KJ_IF_SOME(sizeClass, sizeClassFor(words)) {
+    if (!poolDestroyed && !pool.free[sizeClass].empty()) {
+      firstSegment = kj::mv(pool.free[sizeClass].back());
+      pool.free[sizeClass].removeLast();
+    } else {
+      firstSegment = newZeroedSegment(classWords(sizeClass));
+    }
+  } else {
+    firstSegment = newZeroedSegment(words);
+  }
+}
+
+PooledFirstSegment::~PooledFirstSegment() noexcept(false) {
+  // By now MallocMessageBuilder has zeroed whatever it used of the segment.
+  if (poolDestroyed || firstSegment.size() > MAX_CLASS_WORDS) return;
+  KJ_IF_SOME(sizeClass, sizeClassFor(firstSegment.size())) {
+    auto& free = pool.free[sizeClass];
+    if (free.size() < MAX_FREE_PER_CLASS) {
+      free.add(kj::mv(firstSegment));
+    }
+  }
+}
+
+}  // namespace workerd::_
@@ -0,0 +1,47 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <capnp/message.h>
+
+namespace workerd {
+
+namespace _ {  // private
+
+// Holds the first segment of a PooledMessageBuilder. It's a separate base class so that it's
+// constructed before, and destroyed after, the MallocMessageBuilder that uses it.
+class PooledFirstSegment {
+ protected:
+  explicit PooledFirstSegment(capnp::MessageSize sizeHint);
+  ~PooledFirstSegment() noexcept(false);
+  KJ_DISALLOW_COPY_AND_MOVE(PooledFirstSegment);
+
+  kj::Array<capnp::word> firstSegment;
+};
+
+}  // namespace _
+
+// A MallocMessageBuilder for messages that are built, used and thrown away within one call, such
+// as the JSON-encoded requests to R2 or inspector notifications. Its first segment comes from a
+// per-thread pool of zeroed buffers instead of a fresh allocation, and goes back to the pool when
+// the builder is destroyed. (MallocMessageBuilder zeroes a caller-provided first segment when it's
+// done with it, which is what lets the buffer be reused.)
+//
+// The first segment is sized from `sizeHint`, rounded up to one of a few size classes. Only a
+// message that outgrows it allocates further segments, which aren't pooled; a hint too large for
+// any size class gets an unpooled first segment.
+//
+// A builder may be destroyed on a different thread than the one it was created on; its segment
+// then joins the destroying thread's pool.
+class PooledMessageBuilder final: private _::PooledFirstSegment,
+                                  public capnp::MallocMessageBuilder {
+ public:
+  explicit PooledMessageBuilder(
+      capnp::MessageSize sizeHint = {capnp::SUGGESTED_FIRST_SEGMENT_WORDS, 0})
+      : PooledFirstSegment(sizeHint),
+        capnp::MallocMessageBuilder(firstSegment) {}
+};
+
+}  // namespace workerd
@@ -116,6 +116,28 @@ KJ_TEST("Building MimeType works") {
   KJ_ASSERT(MimeType::PLAINTEXT == type);
 }
 
+KJ_TEST("Repeated MimeType parsing returns independent results") {
+  auto input = "Text/HTML; Charset=UTF-8"_kj;
+  for (auto i = 0; i < 3; i++) {
+    auto type = MimeType::parse(input);
+    KJ_ASSERT(type.type() == "text"_kj);
+    KJ_ASSERT(type.subtype() == "html"_kj);
+    KJ_ASSERT(type.toString() == "text/html;charset=UTF-8"_kj);
+
+    // Changing a parsed result must not affect the next parse of the same value.
+    KJ_ASSERT(type.setSubtype("PLAIN"_kj));
+    KJ_ASSERT(type.addParam("a"_kj, "b"_kj));
+    KJ_ASSERT(type.toString() == "text/plain;charset=UTF-8;a=b"_kj);
+  }
+
+  auto multipart = "multipart/form-data; boundary=abc123"_kj;
+  KJ_ASSERT(MimeType::parse(multipart).toString() == "multipart/form-data;boundary=abc123"_kj);
+  KJ_ASSERT(MimeType::parse(multipart).clone().toString() ==
+      "multipart/form-data;boundary=abc123"_kj);
+  KJ_ASSERT(MimeType::tryParse("text/"_kj) == kj::none);
+  KJ_ASSERT(MimeType::tryParse("text/"_kj) == kj::none);
+}
+
 KJ_TEST("WHATWG tests") {
   struct Test {
     kj::StringPtr input;
@@ -9,6 +9,9 @@
 
 #include <kj/debug.h>
 #include <kj/string-tree.h>
+#include <kj/table.h>
+
+#include <algorithm>
 
 namespace workerd {
 
@@ -114,6 +117,119 @@ kj::String unescape(kj::ArrayPtr<const char> str) {
   return result.flatten();
 }
 
+// Strings that the types, subtypes and parameters of common mime types consist of. Types,
+// subtypes and parameter names are lowercase, so only lowercase forms are listed for those.
+constexpr kj::StringPtr INTERNED_STRINGS[] = {
+  "application"_kj,
+  "text"_kj,
+  "image"_kj,
+  "audio"_kj,
+  "video"_kj,
+  "font"_kj,
+  "multipart"_kj,
+  "json"_kj,
+  "html"_kj,
+  "plain"_kj,
+  "css"_kj,
+  "javascript"_kj,
+  "xml"_kj,
+  "octet-stream"_kj,
+  "x-www-form-urlencoded"_kj,
+  "form-data"_kj,
+  "event-stream"_kj,
+  "png"_kj,
+  "jpeg"_kj,
+  "gif"_kj,
+  "webp"_kj,
+  "svg+xml"_kj,
+  "charset"_kj,
+  "boundary"_kj,
+  "utf-8"_kj,
+  "UTF-8"_kj,
+};
+
+kj::String referTo(kj::StringPtr interned) {
+  return kj::String(
+      const_cast<char*>(interned.begin()), interned.size(), kj::NullArrayDisposer::instance);
+}
+
+// Returns a copy of `value`, or a string referring to its interned copy without allocating if it
+// has one.
+kj::String intern(kj::ArrayPtr<const char> value) {
+  for (auto interned: INTERNED_STRINGS) {
+    if (interned.asArray() == value) return referTo(interned);
+  }
+  return kj::heapString(value);
+}
+
+// Like intern(), but returns `value` in lowercase.
+kj::String internLowercase(kj::ArrayPtr<const char> value) {
+  for (auto interned: INTERNED_STRINGS) {
+    if (interned.size() == value.size() &&
+        std::equal(value.begin(), value.end(), interned.begin(),
+            [](char a, char b) { return (('A' <= a && a <= 'Z') ? a + ('a' - 'A') : a) == b; })) {
+      return referTo(interned);
+    }
+  }
+  return toLower(value);
+}
+
+// A small per-thread cache of parsed mime types. Requests overwhelmingly carry one of a handful
+// of Content-Type values, so a hit skips validating the value again. Only short values, whose
+// only parameter, if any, is the charset, are cached: other parameters, such as a multipart
+// boundary, are usually unique to a request.
+class ParseCache {
+ public:
+  static constexpr size_t MAX_ENTRIES = 32;
+  static constexpr size_t MAX_INPUT_SIZE = 64;
+
+  kj::Maybe<MimeType> find(kj::ArrayPtr<const char> input) {
+    KJ_IF_SOME(entry, entries.find(input)) {
+      // Move the entry to the back of the insertion order to mark it most recently used.
+      auto& bumped = entries.insert(entries.release(entry));
+      return bumped.type.clone();
+    }
+    return kj::none;
+  }
+
+  void maybeAdd(kj::ArrayPtr<const char> input, const MimeType& type) {
+    if (input.size() > MAX_INPUT_SIZE) return;
+    auto& params = type.params();
+    if (params.size() > 1 || (params.size() == 1 && params.find("charset"_kj) == kj::none)) {
+      return;
+    }
+    if (entries.size() >= MAX_ENTRIES) {
+      entries.erase(*entries.ordered<1>().begin());
+    }
+    entries.insert(Entry{kj::heapArray(input), type.clone()});
+  }
+
+ private:
+  struct Entry {
+    kj::Array<const char> input;
+    MimeType type;
+  };
+
+  struct EntryCallbacks {
+    kj::ArrayPtr<const char> keyForRow(const Entry& entry) const {
+      return entry.input;
+    }
+    bool matches(const Entry& entry, kj::ArrayPtr<const char> key) const {
+      return entry.input == key;
+    }
+    uint hashCode(kj::ArrayPtr<const char> key) const {
+      return kj::hashCode(key);
+    }
+  };
+
+  kj::Table<Entry, kj::HashIndex<EntryCallbacks>, kj::InsertionOrderIndex> entries;
+};
+
+ParseCache& getParseCache() {
+  static thread_local ParseCache cache;
+  return cache;
+}
+
 }  // namespace
 
 MimeType MimeType::parse(kj::StringPtr input, ParseOptions options) {
@@ -121,7 +237,19 @@ MimeType MimeType::parse(kj::StringPtr input, ParseOptions options) {
 }
 
 kj::Maybe<MimeType> MimeType::tryParse(kj::ArrayPtr<const char> input, ParseOptions options) {
-  return tryParseImpl(input, kj::mv(options));
+  if (options != ParseOptions::DEFAULT) {
+    return tryParseImpl(input, kj::mv(options));
+  }
+
+  auto& cache = getParseCache();
+  KJ_IF_SOME(cached, cache.find(input)) {
+    return kj::mv(cached);
+  }
+  KJ_IF_SOME(parsed, tryParseImpl(input)) {
+    cache.maybeAdd(input, parsed);
+    return kj::mv(parsed);
+  }
+  return kj::none;
 }
 
 kj::Maybe<MimeType> MimeType::tryParseImpl(kj::ArrayPtr<const char> input, ParseOptions options) {
@@ -129,45 +257,37 @@ kj::Maybe<MimeType> MimeType::tryParseImpl(kj::ArrayPtr<const char> input, Parse
   input = skipWhitespace(input);
   if (input.size() == 0) return kj::none;
 
-  kj::Maybe<kj::String> maybeType;
+  kj::ArrayPtr<const char> type;
   // Let's try to find the solidus that separates the type and subtype
   KJ_IF_SOME(n, input.findFirst('/')) {
-    auto typeCandidate = input.first(n);
-    if (typeCandidate.size() == 0 || hasInvalidCodepoints(typeCandidate, isTokenChar)) {
+    type = input.first(n);
+    if (type.size() == 0 || hasInvalidCodepoints(type, isTokenChar)) {
       return kj::none;
     }
-    maybeType = kj::str(typeCandidate);
     input = input.slice(n + 1);
   } else {
     // If the solidus is not found, then it's not a valid mime type
     return kj::none;
   }
-  auto& type = KJ_ASSERT_NONNULL(maybeType);
 
   // If there's nothing else to parse at this point, it's not a valid mime type.
   if (input.size() == 0) return kj::none;
 
-  kj::Maybe<kj::String> maybeSubtype;
+  kj::ArrayPtr<const char> subtype;
   KJ_IF_SOME(n, input.findFirst(';')) {
     // If a semi-colon is found, the subtype is everything up to that point
     // minus trailing whitespace.
-    auto subtypeCandidate = trimWhitespace(input.first(n));
-    if (subtypeCandidate.size() == 0 || hasInvalidCodepoints(subtypeCandidate, isTokenChar)) {
-      return kj::none;
-    }
-    maybeSubtype = kj::str(subtypeCandidate);
+    subtype = trimWhitespace(input.first(n));
     input = input.slice(n + 1);
   } else {
-    auto subtypeCandidate = trimWhitespace(input);
-    if (subtypeCandidate.size() == 0 || hasInvalidCodepoints(subtypeCandidate, isTokenChar)) {
-      return kj::none;
-    }
-    maybeSubtype = kj::str(subtypeCandidate);
+    subtype = trimWhitespace(input);
     input = input.slice(input.size());
   }
-  auto& subtype = KJ_ASSERT_NONNULL(maybeSubtype);
+  if (subtype.size() == 0 || hasInvalidCodepoints(subtype, isTokenChar)) {
+    return kj::none;
+  }
 
-  MimeType result(type, subtype);
+  MimeType result(internLowercase(type), internLowercase(subtype));
 
   if (!(options & ParseOptions::IGNORE_PARAMS)) {
     // Parse the parameters...
@@ -247,20 +367,24 @@ kj::Maybe<MimeType> MimeType::tryParseImpl(kj::ArrayPtr<const char> input, Parse
 }
 
 MimeType::MimeType(kj::StringPtr type, kj::StringPtr subtype, kj::Maybe<MimeParams> params)
-    : type_(toLower(type)),
-      subtype_(toLower(subtype)) {
+    : type_(internLowercase(type)),
+      subtype_(internLowercase(subtype)) {
   KJ_IF_SOME(p, params) {
     params_ = kj::mv(p);
   }
 }
 
+MimeType::MimeType(kj::String type, kj::String subtype)
+    : type_(kj::mv(type)),
+      subtype_(kj::mv(subtype)) {}
+
 kj::StringPtr MimeType::type() const {
   return type_;
 }
 
 bool MimeType::setType(kj::StringPtr type) {
   if (type.size() == 0 || hasInvalidCodepoints(type, isTokenChar)) return false;
-  type_ = toLower(type);
+  type_ = internLowercase(type);
   return true;
 }
 
@@ -270,7 +394,7 @@ kj::StringPtr MimeType::subtype() const {
 
 bool MimeType::setSubtype(kj::StringPtr type) {
   if (type.size() == 0 || hasInvalidCodepoints(type, isTokenChar)) return false;
-  subtype_ = toLower(type);
+  subtype_ = internLowercase(type);
   return true;
 }
 
@@ -283,7 +407,7 @@ bool MimeType::addParam(kj::ArrayPtr<const char> name, kj::ArrayPtr<const char>
       hasInvalidCodepoints(value, isQuotedStringTokenChar)) {
     return false;
   }
-  params_.upsert(toLower(name), kj::str(value), [](auto&, auto&&) {});
+  params_.upsert(internLowercase(name), intern(value), [](auto&, auto&&) {});
   return true;
 }
 
@@ -341,7 +465,7 @@ MimeType MimeType::clone(ParseOptions options) const {
   MimeParams copy;
   if (!(options & ParseOptions::IGNORE_PARAMS)) {
     for (const auto& entry: params_) {
-      copy.insert(kj::str(entry.key), kj::str(entry.value));
+      copy.insert(intern(entry.key), intern(entry.value));
     }
   }
   return MimeType(type_, subtype_, kj::mv(copy));
@@ -439,7 +563,7 @@ kj::Maybe<MimeType> MimeType::extract(kj::StringPtr input) {
   };
 
   constexpr static auto processPart = [](auto& mimeType, auto& part) -> kj::Maybe<MimeType> {
-    KJ_IF_SOME(parsed, tryParseImpl(part)) {
+    KJ_IF_SOME(parsed, tryParse(part)) {
       if (parsed == MimeType::WILDCARD) return kj::none;
 
       KJ_IF_SOME(current, mimeType) {
@@ -120,6 +120,9 @@ class MimeType final {
 
   void paramsToString(ToStringBuffer& buffer) const;
 
+  // Takes a type and subtype that are already lowercase.
+  MimeType(kj::String type, kj::String subtype);
+
   static kj::Maybe<MimeType> tryParseImpl(
       kj::ArrayPtr<const char> input, ParseOptions options = ParseOptions::DEFAULT);
 };
@@ -7,7 +7,16 @@
 // recommended in the full perfetto header (perfetto/tracing.h).
 #include "perfetto/tracing/track_event.h"
 
-PERFETTO_DEFINE_CATEGORIES_IN_NAMESPACE(workerd::traces, perfetto::Category("workerd"));
+// "workerd" covers request dispatch. The other categories instrument hot paths that emit many
+// events, so that each can be enabled on its own, e.g. `--perfetto-trace=out.pftrace=workerd.lock`.
+PERFETTO_DEFINE_CATEGORIES_IN_NAMESPACE(workerd::traces,
+    perfetto::Category("workerd"),
+    perfetto::Category("workerd.lock").SetDescription("Isolate lock waits and holds"),
+    perfetto::Category("workerd.script").SetDescription("Script compilation and module evaluation"),
+    perfetto::Category("workerd.gc").SetDescription("V8 garbage collections"),
+    perfetto::Category("workerd.storage").SetDescription("Durable Object storage flushes"),
+    perfetto::Category("workerd.sqlite").SetDescription("SQLite statement steps"),
+    perfetto::Category("workerd.streams").SetDescription("Stream pumps"));
 
 namespace kj {
 class StringPtr;
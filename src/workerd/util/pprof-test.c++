@@ -0,0 +1,132 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "pprof.h"
+
+#include <kj/test.h>
+
+namespace workerd {
+namespace {
+
+// A field read back from a serialized message: either a varint or a length-delimited value.
+struct Field {
+  uint number;
+  uint64_t value;
+  kj::ArrayPtr<const kj::byte> bytes;
+};
+
+uint64_t readVarint(kj::ArrayPtr<const kj::byte>& input) {
+  uint64_t result = 0;
+  for (uint shift = 0;; shift += 7) {
+    KJ_ASSERT(input.size() > 0);
+    auto byte = input[0];
+    input = input.slice(1);
+    result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) return result;
+  }
+}
+
+kj::Array<Field> readFields(kj::ArrayPtr<const kj::byte> input) {
+  kj::Vector<Field> fields;
+  while (input.size() > 0) {
+    auto tag = readVarint(input);
+    Field field{.number = static_cast<uint>(tag >> 3), .value = 0, .bytes = nullptr};
+    switch (tag & 7) {
+      case 0:
+        field.value = readVarint(input);
+        break;
+      case 2: {
+        auto size = readVarint(input);
+        field.bytes = input.first(size);
+        input = input.slice(size);
+        break;
+      }
+      default:
+        KJ_FAIL_ASSERT("unexpected wire type", tag & 7);
+    }
+    fields.add(field);
+  }
+  return fields.releaseAsArray();
+}
+
+kj::Vector<kj::ArrayPtr<const kj::byte>> fieldsNumbered(
+    kj::ArrayPtr<const Field> fields, uint number) {
+  kj::Vector<kj::ArrayPtr<const kj::byte>> result;
+  for (auto& field: fields) {
+    if (field.number == number) result.add(field.bytes);
+  }
+  return result;
+}
+
+KJ_TEST("PprofBuilder writes an empty profile") {
+  PprofBuilder::ValueType types[] = {{"samples", "count"}};
+  PprofBuilder builder(types);
+  auto profile = builder.finish();
+  auto fields = readFields(profile);
+
+  // One sample type, and a string table of "", "samples", "count".
+  auto sampleTypes = fieldsNumbered(fields, 1);
+  KJ_ASSERT(sampleTypes.size() == 1);
+  auto typeFields = readFields(sampleTypes[0]);
+  KJ_ASSERT(typeFields.size() == 2);
+  KJ_EXPECT(typeFields[0].value == 1);
+  KJ_EXPECT(typeFields[1].value == 2);
+
+  auto strings = fieldsNumbered(fields, 6);
+  KJ_ASSERT(strings.size() == 3);
+  KJ_EXPECT(strings[0].size() == 0);
+  KJ_EXPECT(kj::str(strings[1].asChars()) == "samples");
+  KJ_EXPECT(kj::str(strings[2].asChars()) == "count");
+
+  KJ_EXPECT(fieldsNumbered(fields, 2).size() == 0);
+}
+
+KJ_TEST("PprofBuilder deduplicates functions and locations") {
+  PprofBuilder::ValueType types[] = {{"objects", "count"}, {"space", "bytes"}};
+  PprofBuilder builder(types);
+  builder.setPeriod({"space", "bytes"}, 512 * 1024);
+
+  auto leaf = builder.addLocation("leaf", "worker.js", 10);
+  auto otherLine = builder.addLocation("leaf", "worker.js", 11);
+  auto caller = builder.addLocation("caller", "worker.js", 2);
+  KJ_EXPECT(leaf == 1);
+  KJ_EXPECT(otherLine == 2);
+  KJ_EXPECT(caller == 3);
+  KJ_EXPECT(builder.addLocation("leaf", "worker.js", 10) == leaf);
+
+  uint64_t stack[] = {leaf, caller};
+  int64_t values[] = {3, 1536};
+  PprofBuilder::Label labels[] = {{"isolate", "main"}};
+  builder.addSample(stack, values, labels);
+  builder.addSample(stack, values);
+  KJ_EXPECT(builder.sampleCount() == 2);
+
+  auto profile = builder.finish();
+  auto fields = readFields(profile);
+  KJ_EXPECT(fieldsNumbered(fields, 2).size() == 2);
+  KJ_EXPECT(fieldsNumbered(fields, 4).size() == 3);
+  KJ_EXPECT(fieldsNumbered(fields, 5).size() == 2);
+  KJ_EXPECT(fieldsNumbered(fields, 11).size() == 1);
+
+  auto sampleFields = readFields(fieldsNumbered(fields, 2)[0]);
+  KJ_ASSERT(sampleFields.size() == 3);
+
+  auto locationIds = sampleFields[0].bytes;
+  KJ_EXPECT(readVarint(locationIds) == leaf);
+  KJ_EXPECT(readVarint(locationIds) == caller);
+  KJ_EXPECT(locationIds.size() == 0);
+
+  auto sampleValues = sampleFields[1].bytes;
+  KJ_EXPECT(readVarint(sampleValues) == 3);
+  KJ_EXPECT(readVarint(sampleValues) == 1536);
+
+  KJ_EXPECT(sampleFields[2].number == 3);
+  KJ_EXPECT(fieldsNumbered(readFields(fieldsNumbered(fields, 2)[1]), 3).size() == 0);
+
+  int64_t wrongValueCount[] = {1};
+  KJ_EXPECT_THROW_MESSAGE("wrong number of values", builder.addSample(stack, wrongValueCount));
+}
+
+}  // namespace
+}  // namespace workerd
@@ -0,0 +1,235 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "pprof.h"
+
+#include <kj/debug.h>
+
+namespace workerd {
+
+namespace {
+
+// Just enough of the protobuf wire format to write a Profile.
+class ProtoWriter {
+ public:
+  void addVarint(uint64_t value) {
+    while (value >= 0x80) {
+      bytes.add(static_cast<kj::byte>(value | 0x80));
+      value >>= 7;
+    }
+    bytes.add(static_cast<kj::byte>(value));
+  }
+
+  // Writes a varint field. Like protoc, omits fields set to their default of zero.
+  void addField(uint field, uint64_t value) {
+    if (value == 0) return;
+    addTag(field, VARINT);
+    addVarint(value);
+  }
+  void addField(uint field, int64_t value) {
+    addField(field, static_cast<uint64_t>(value));
+  }
+
+  void addField(uint field, kj::ArrayPtr<const kj::byte> value) {
+    addTag(field, LENGTH_DELIMITED);
+    addVarint(value.size());
+    bytes.addAll(value);
+  }
+  void addField(uint field, ProtoWriter& message) {
+    addField(field, message.bytes.asPtr());
+  }
+
+  template <typename T>
+  void addPackedField(uint field, kj::ArrayPtr<const T> values) {
+    if (values.size() == 0) return;
+    ProtoWriter packed;
+    for (auto value: values) {
+      packed.addVarint(static_cast<uint64_t>(value));
+    }
+    addField(field, packed);
+  }
+
+  kj::Array<kj::byte> finish() {
+    return bytes.releaseAsArray();
+  }
+
+ private:
+  static constexpr uint VARINT = 0;
+  static constexpr uint LENGTH_DELIMITED = 2;
+
+  kj::Vector<kj::byte> bytes;
+
+  void addTag(uint field, uint wireType) {
+    addVarint((field << 3) | wireType);
+  }
+};
+
+// Field numbers from profile.proto.
+namespace ProfileField {
+constexpr uint SAMPLE_TYPE = 1;
+constexpr uint SAMPLE = 2;
+constexpr uint LOCATION = 4;
+constexpr uint FUNCTION = 5;
+constexpr uint STRING_TABLE = 6;
+constexpr uint TIME_NANOS = 9;
+constexpr uint DURATION_NANOS = 10;
+constexpr uint PERIOD_TYPE = 11;
+constexpr uint PERIOD = 12;
+}  // namespace ProfileField
+
+namespace ValueTypeField {
+constexpr uint TYPE = 1;
+constexpr uint UNIT = 2;
+}  // namespace ValueTypeField
+
+namespace SampleField {
+constexpr uint LOCATION_ID = 1;
+constexpr uint VALUE = 2;
+constexpr uint LABEL = 3;
+}  // namespace SampleField
+
+namespace LabelField {
+constexpr uint KEY = 1;
+constexpr uint STR = 2;
+}  // namespace LabelField
+
+namespace LocationField {
+constexpr uint ID = 1;
+constexpr uint LINE = 4;
+}  // namespace LocationField
+
+namespace LineField {
+constexpr uint FUNCTION_ID = 1;
+constexpr uint LINE = 2;
+}  // namespace LineField
+
+namespace FunctionField {
+constexpr uint ID = 1;
+constexpr uint NAME = 2;
+constexpr uint SYSTEM_NAME = 3;
+constexpr uint FILENAME = 4;
+}  // namespace FunctionField
+
+}  // namespace
+
+PprofBuilder::PprofBuilder(kj::ArrayPtr<const ValueType> types) {
+  // The string table must start with the empty string.
+  intern(""_kj);
+
+  auto builder = kj::heapArrayBuilder<uint64_t>(types.size() * 2);
+  for (auto& type: types) {
+    builder.add(intern(type.type));
+    builder.add(intern(type.unit));
+  }
+  sampleTypes = builder.finish();
+}
+
+void PprofBuilder::setPeriod(ValueType type, int64_t value) {
+  periodType[0] = intern(type.type);
+  periodType[1] = intern(type.unit);
+  period = value;
+}
+
+void PprofBuilder::setTime(int64_t time, int64_t duration) {
+  timeNanos = time;
+  durationNanos = duration;
+}
+
+uint64_t PprofBuilder::intern(kj::StringPtr str) {
+  KJ_IF_SOME(index, stringIndices.find(str)) {
+    return index;
+  }
+  uint64_t index = strings.size();
+  auto& owned = strings.add(kj::str(str));
+  stringIndices.insert(owned, index);
+  return index;
+}
+
+uint64_t PprofBuilder::addLocation(kj::StringPtr name, kj::StringPtr filename, int64_t line) {
+  // IDs are 1-based; zero means "unset" in pprof.
+  auto function = functionIds.findOrCreate(kj::str(name, '\0', filename), [&]() {
+    functions.add(Function{.name = intern(name), .filename = intern(filename)});
+    return decltype(functionIds)::Entry{kj::str(name, '\0', filename), functions.size()};
+  });
+  return locationIds.findOrCreate(kj::str(function, ':', line), [&]() {
+    locations.add(Location{.function = function, .line = line});
+    return decltype(locationIds)::Entry{kj::str(function, ':', line), locations.size()};
+  });
+}
+
+void PprofBuilder::addSample(kj::ArrayPtr<const uint64_t> stack,
+    kj::ArrayPtr<const int64_t> values,
+    kj::ArrayPtr<const Label> labels) {
+  KJ_REQUIRE(values.size() * 2 == sampleTypes.size(), "wrong number of values for sample");
+  auto labelIndices = kj::heapArrayBuilder<uint64_t>(labels.size() * 2);
+  for (auto& label: labels) {
+    labelIndices.add(intern(label.key));
+    labelIndices.add(intern(label.value));
+  }
+  samples.add(Sample{.stack = kj::heapArray(stack),
+    .values = kj::heapArray(values),
+    .labels = labelIndices.finish()});
+}
+
+kj::Array<kj::byte> PprofBuilder::finish() {
+  ProtoWriter profile;
+
+  for (size_t i = 0; i < sampleTypes.size(); i += 2) {
+    ProtoWriter type;
+    type.addField(ValueTypeField::TYPE, sampleTypes[i]);
+    type.addField(ValueTypeField::UNIT, sampleTypes[i + 1]);
+    profile.addField(ProfileField::SAMPLE_TYPE, type);
+  }
+
+  for (auto& sample: samples) {
+    ProtoWriter message;
+    message.addPackedField(SampleField::LOCATION_ID, sample.stack.asPtr().asConst());
+    message.addPackedField(SampleField::VALUE, sample.values.asPtr().asConst());
+    for (size_t i = 0; i < sample.labels.size(); i += 2) {
+      ProtoWriter label;
+      label.addField(LabelField::KEY, sample.labels[i]);
+      label.addField(LabelField::STR, sample.labels[i + 1]);
+      message.addField(SampleField::LABEL, label);
+    }
+    profile.addField(ProfileField::SAMPLE, message);
+  }
+
+  for (auto i: kj::indices(locations)) {
+    ProtoWriter line;
+    line.addField(LineField::FUNCTION_ID, locations[i].function);
+    line.addField(LineField::LINE, locations[i].line);
+
+    ProtoWriter location;
+    location.addField(LocationField::ID, static_cast<uint64_t>(i + 1));
+    location.addField(LocationField::LINE, line);
+    profile.addField(ProfileField::LOCATION, location);
+  }
+
+  for (auto i: kj::indices(functions)) {
+    ProtoWriter function;
+    function.addField(FunctionField::ID, static_cast<uint64_t>(i + 1));
+    function.addField(FunctionField::NAME, functions[i].name);
+    function.addField(FunctionField::SYSTEM_NAME, functions[i].name);
+    function.addField(FunctionField::FILENAME, functions[i].filename);
+    profile.addField(ProfileField::FUNCTION, function);
+  }
+
+  for (auto& str: strings) {
+    profile.addField(ProfileField::STRING_TABLE, str.asBytes());
+  }
+
+  profile.addField(ProfileField::TIME_NANOS, timeNanos);
+  profile.addField(ProfileField::DURATION_NANOS, durationNanos);
+  if (periodType[0] != 0) {
+    ProtoWriter type;
+    type.addField(ValueTypeField::TYPE, periodType[0]);
+    type.addField(ValueTypeField::UNIT, periodType[1]);
+    profile.addField(ProfileField::PERIOD_TYPE, type);
+  }
+  profile.addField(ProfileField::PERIOD, period);
+
+  return profile.finish();
+}
+
+}  // namespace workerd
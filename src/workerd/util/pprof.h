@@ -0,0 +1,94 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <kj/array.h>
+#include <kj/map.h>
+#include <kj/string.h>
+#include <kj/vector.h>
+
+#include <cstdint>
+
+namespace workerd {
+
+// Builds a profile in pprof's format: an (uncompressed) serialized perftools.profiles.Profile
+// protobuf, as described by https://github.com/google/pprof/blob/main/proto/profile.proto. `pprof`
+// and most tools that accept its output read the uncompressed form as well as the gzipped one.
+//
+// Strings, functions, and locations are deduplicated as they are added, so building one profile
+// from several sources (such as several isolates) yields a single merged call graph.
+class PprofBuilder {
+ public:
+  struct ValueType {
+    kj::StringPtr type;
+    kj::StringPtr unit;
+  };
+
+  // `sampleTypes` describes the values recorded for each sample, e.g. {"objects", "count"} and
+  // {"space", "bytes"} for a heap profile.
+  explicit PprofBuilder(kj::ArrayPtr<const ValueType> sampleTypes);
+  KJ_DISALLOW_COPY_AND_MOVE(PprofBuilder);
+
+  // Describes how samples were taken, e.g. {"space", "bytes"} and the sampling interval.
+  void setPeriod(ValueType type, int64_t period);
+
+  // Wall time at which profiling started, and for how long it ran.
+  void setTime(int64_t timeNanos, int64_t durationNanos);
+
+  // Returns the ID of the location for the given function and 1-based line. `name` and `filename`
+  // may be empty if unknown.
+  uint64_t addLocation(kj::StringPtr name, kj::StringPtr filename, int64_t line);
+
+  struct Label {
+    kj::StringPtr key;
+    kj::StringPtr value;
+  };
+
+  // Records one sample. `stack` lists location IDs leaf first. `values` must contain one value
+  // per sample type.
+  void addSample(kj::ArrayPtr<const uint64_t> stack,
+      kj::ArrayPtr<const int64_t> values,
+      kj::ArrayPtr<const Label> labels = nullptr);
+
+  size_t sampleCount() const {
+    return samples.size();
+  }
+
+  // Serializes the profile.
+  kj::Array<kj::byte> finish();
+
+ private:
+  struct Function {
+    uint64_t name;
+    uint64_t filename;
+  };
+  struct Location {
+    uint64_t function;
+    int64_t line;
+  };
+  struct Sample {
+    kj::Array<uint64_t> stack;
+    kj::Array<int64_t> values;
+    kj::Array<uint64_t> labels;  // Alternating key and value string indices.
+  };
+
+  kj::Vector<kj::String> strings;
+  kj::HashMap<kj::StringPtr, uint64_t> stringIndices;
+  kj::Vector<Function> functions;
+  kj::HashMap<kj::String, uint64_t> functionIds;
+  kj::Vector<Location> locations;
+  kj::HashMap<kj::String, uint64_t> locationIds;
+  kj::Vector<Sample> samples;
+
+  kj::Array<uint64_t> sampleTypes;  // Alternating type and unit string indices.
+  uint64_t periodType[2] = {0, 0};
+  int64_t period = 0;
+  int64_t timeNanos = 0;
+  int64_t durationNanos = 0;
+
+  uint64_t intern(kj::StringPtr str);
+};
+
+}  // namespace workerd
@@ -0,0 +1,66 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "random.h"
+
+#include <kj/map.h>
+#include <kj/test.h>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace workerd {
+namespace {
+
+KJ_TEST("getRandomBytes never hands out the same bytes twice") {
+  // Draw enough small values to go through the pool several times, along with some that bypass
+  // it, and make sure all of them are distinct.
+  kj::HashSet<uint64_t> seen;
+  for (auto i = 0; i < 10000; i++) {
+    uint64_t value = 0;
+    getRandomBytes(kj::arrayPtr(&value, 1).asBytes());
+    KJ_ASSERT(!seen.contains(value));
+    seen.insert(value);
+
+    if (i % 100 == 0) {
+      kj::byte large[MAX_POOLED_RANDOM_BYTES + 1]{};
+      getRandomBytes(large);
+    }
+  }
+
+  kj::byte empty[1]{};
+  getRandomBytes(kj::arrayPtr(empty, 0));
+}
+
+KJ_TEST("getRandomBytes gives a forked child different bytes than its parent") {
+  // Make sure the pool has bytes left over for the child to inherit.
+  uint64_t unused = 0;
+  getRandomBytes(kj::arrayPtr(&unused, 1).asBytes());
+
+  int fds[2];
+  KJ_SYSCALL(pipe(fds));
+  pid_t child;
+  KJ_SYSCALL(child = fork());
+  if (child == 0) {
+    uint64_t value = 0;
+    getRandomBytes(kj::arrayPtr(&value, 1).asBytes());
+    (void)write(fds[1], &value, sizeof(value));
+    _exit(0);
+  }
+  close(fds[1]);
+
+  uint64_t parentValue = 0;
+  getRandomBytes(kj::arrayPtr(&parentValue, 1).asBytes());
+
+  uint64_t childValue = 0;
+  KJ_ASSERT(read(fds[0], &childValue, sizeof(childValue)) == sizeof(childValue));
+  close(fds[0]);
+  int status;
+  KJ_SYSCALL(waitpid(child, &status, 0));
+
+  KJ_ASSERT(childValue != parentValue);
+}
+
+}  // namespace
+}  // namespace workerd
@@ -0,0 +1,77 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "random.h"
+
+#include <openssl/mem.h>
+#include <openssl/rand.h>
+#include <pthread.h>
+
+#include <kj/debug.h>
+
+#include <cstring>
+
+namespace workerd {
+namespace {
+
+class RandomPool {
+ public:
+  RandomPool() {
+    // Only the thread that called fork() exists in the child, so resetting its pool, and the
+    // pools of threads started after fork(), is enough for the child never to reuse bytes that
+    // the parent also has.
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, [] { pthread_atfork(nullptr, nullptr, [] { getPool().reset(); }); });
+  }
+
+  ~RandomPool() noexcept(false) {
+    reset();
+  }
+
+  KJ_DISALLOW_COPY_AND_MOVE(RandomPool);
+
+  void generate(kj::ArrayPtr<kj::byte> buffer) {
+    KJ_DASSERT(buffer.size() <= MAX_POOLED_RANDOM_BYTES);
+    if (available < buffer.size()) {
+      KJ_ASSERT(RAND_bytes(pool, sizeof(pool)) == 1);
+      available = sizeof(pool);
+    }
+
+    // Hand out bytes from the end of the pool and wipe them, so that they can't be handed out
+    // again or recovered from memory later.
+    auto source = pool + available - buffer.size();
+    memcpy(buffer.begin(), source, buffer.size());
+    OPENSSL_cleanse(source, buffer.size());
+    available -= buffer.size();
+  }
+
+  void reset() {
+    OPENSSL_cleanse(pool, sizeof(pool));
+    available = 0;
+  }
+
+  static RandomPool& getPool() {
+    static thread_local RandomPool pool;
+    return pool;
+  }
+
+ private:
+  static constexpr size_t POOL_SIZE = 4096;
+  static_assert(POOL_SIZE >= MAX_POOLED_RANDOM_BYTES);
+
+  kj::byte pool[POOL_SIZE];
+  size_t available = 0;
+};
+
+}  // namespace
+
+void getRandomBytes(kj::ArrayPtr<kj::byte> buffer) {
+  if (buffer.size() > MAX_POOLED_RANDOM_BYTES) {
+    KJ_ASSERT(RAND_bytes(buffer.begin(), buffer.size()) == 1);
+    return;
+  }
+  RandomPool::getPool().generate(buffer);
+}
+
+}  // namespace workerd
@@ -0,0 +1,22 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <kj/common.h>
+
+namespace workerd {
+
+// Fills `buffer` with cryptographically secure random bytes.
+//
+// Requests of up to MAX_POOLED_RANDOM_BYTES are served from a per-thread pool that is refilled
+// from BoringSSL's CSPRNG in large blocks, so that generating many small values, such as UUIDs,
+// doesn't pay the CSPRNG's per-call overhead each time. Bytes are wiped from the pool as they're
+// handed out, and the pool is discarded in the child after fork(), so no two callers, or
+// processes, ever get the same bytes. Larger requests go to the CSPRNG directly.
+void getRandomBytes(kj::ArrayPtr<kj::byte> buffer);
+
+constexpr size_t MAX_POOLED_RANDOM_BYTES = 256;
+
+}  // namespace workerd
@@ -0,0 +1,112 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "shared-memory-table.h"
+
+#include <kj/debug.h>
+#include <kj/test.h>
+
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// The table is implemented with POSIX file mappings only.
+#if !_WIN32
+
+namespace workerd {
+namespace {
+
+struct TempFile {
+  kj::String path;
+
+  TempFile() {
+    char templ[] = "/tmp/workerd-shared-memory-table-XXXXXX";
+    int fd;
+    KJ_SYSCALL(fd = mkstemp(templ));
+    close(fd);
+    path = kj::str(templ);
+    // open() initializes empty files.
+    KJ_SYSCALL(truncate(path.cStr(), 0));
+  }
+  ~TempFile() noexcept(false) {
+    unlink(path.cStr());
+  }
+};
+
+constexpr SharedMemoryTable::Options OPTIONS{.slotCount = 64, .slotSize = 256};
+
+kj::ArrayPtr<const kj::byte> bytes(kj::StringPtr text) {
+  return text.asBytes();
+}
+
+kj::String text(kj::Maybe<SharedMemoryTable::Entry> entry) {
+  KJ_IF_SOME(e, entry) {
+    return kj::str(e.value.asChars());
+  }
+  return kj::str("(none)");
+}
+
+KJ_TEST("SharedMemoryTable stores and replaces entries") {
+  TempFile file;
+  auto table = SharedMemoryTable::open(file.path, OPTIONS);
+
+  KJ_EXPECT(text(table->get(bytes("a"), 0)) == "(none)");
+  KJ_EXPECT(table->put(bytes("a"), bytes("one"), kj::none, 0));
+  KJ_EXPECT(table->put(bytes("b"), bytes("two"), kj::none, 0));
+  KJ_EXPECT(text(table->get(bytes("a"), 0)) == "one");
+  KJ_EXPECT(text(table->get(bytes("b"), 0)) == "two");
+
+  KJ_EXPECT(table->put(bytes("a"), bytes("three"), kj::none, 0));
+  KJ_EXPECT(text(table->get(bytes("a"), 0)) == "three");
+}
+
+KJ_TEST("SharedMemoryTable expires entries") {
+  TempFile file;
+  auto table = SharedMemoryTable::open(file.path, OPTIONS);
+
+  KJ_EXPECT(table->put(bytes("a"), bytes("one"), 1000.0, 0));
+  auto entry = KJ_ASSERT_NONNULL(table->get(bytes("a"), 999));
+  KJ_EXPECT(KJ_ASSERT_NONNULL(entry.expiration) == 1000.0);
+  KJ_EXPECT(text(table->get(bytes("a"), 1000)) == "(none)");
+}
+
+KJ_TEST("SharedMemoryTable drops entries that don't fit") {
+  TempFile file;
+  auto table = SharedMemoryTable::open(file.path, OPTIONS);
+
+  KJ_EXPECT(table->put(bytes("a"), bytes("one"), kj::none, 0));
+  auto big = kj::str(kj::repeat('x', table->maxEntrySize()));
+  KJ_EXPECT(!table->put(bytes("a"), bytes(big), kj::none, 0));
+  // The old value must not be served in place of the one that didn't fit.
+  KJ_EXPECT(text(table->get(bytes("a"), 0)) == "(none)");
+}
+
+KJ_TEST("SharedMemoryTable is shared by every mapping of a file") {
+  TempFile file;
+  auto first = SharedMemoryTable::open(file.path, OPTIONS);
+  auto second = SharedMemoryTable::open(file.path, OPTIONS);
+
+  KJ_EXPECT(first->put(bytes("a"), bytes("one"), kj::none, 0));
+  KJ_EXPECT(text(second->get(bytes("a"), 0)) == "one");
+
+  // Across processes, too.
+  pid_t pid;
+  KJ_SYSCALL(pid = fork());
+  if (pid == 0) {
+    auto child = SharedMemoryTable::open(file.path, OPTIONS);
+    _exit(child->put(bytes("b"), bytes("from child"), kj::none, 0) ? 0 : 1);
+  }
+  int status;
+  KJ_SYSCALL(waitpid(pid, &status, 0));
+  KJ_EXPECT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  KJ_EXPECT(text(first->get(bytes("b"), 0)) == "from child");
+
+  KJ_EXPECT_THROW_MESSAGE("created with different options",
+      SharedMemoryTable::open(file.path, {.slotCount = 128, .slotSize = 256}));
+}
+
+}  // namespace
+}  // namespace workerd
+
+#endif  // !_WIN32
@@ -0,0 +1,254 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "shared-memory-table.h"
+
+#include <kj/debug.h>
+#include <kj/io.h>
+
+#include <atomic>
+#include <cstring>
+
+#if !_WIN32
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace workerd {
+
+namespace {
+
+constexpr uint32_t MAGIC = 0x54534457;  // "WDST"
+constexpr uint32_t VERSION = 1;
+
+// Number of consecutive slots a key may live in. Slots are grouped into aligned buckets of this
+// many, so that probing never wraps around.
+constexpr uint32_t PROBE_DISTANCE = 4;
+
+// Number of times a read retries a slot that was being written.
+constexpr uint READ_ATTEMPTS = 3;
+
+// The header is padded to a cache line, so that the first slot doesn't share one with it.
+constexpr size_t HEADER_SIZE = 64;
+
+constexpr uint32_t SLOT_USED = 1;
+constexpr uint32_t SLOT_HAS_EXPIRATION = 2;
+
+// Must agree across processes, so it's a fixed FNV-1a hash with a final mix rather than
+// kj::hashCode().
+uint64_t hashKey(kj::ArrayPtr<const kj::byte> key) {
+  uint64_t h = 0xcbf29ce484222325ull;
+  for (auto b: key) {
+    h = (h ^ b) * 0x100000001b3ull;
+  }
+  h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+  h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+  return h ^ (h >> 31);
+}
+
+}  // namespace
+
+struct SharedMemoryTable::Header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t slotCount;
+  uint32_t slotSize;
+};
+static_assert(sizeof(SharedMemoryTable::Header) <= HEADER_SIZE);
+
+// The key and then the value follow the slot header directly.
+//
+// The sequence number is odd while a writer is changing the slot. The other fields are plain
+// memory, read without synchronization and then validated by re-checking the sequence number
+// after an acquire fence, as is usual for sequence locks.
+struct SharedMemoryTable::Slot {
+  std::atomic<uint32_t> sequence;
+  uint32_t flags;
+  uint32_t keySize;
+  uint32_t valueSize;
+  uint64_t hash;
+  double expiration;
+
+  kj::byte* data() {
+    return reinterpret_cast<kj::byte*>(this + 1);
+  }
+};
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+    "atomics in shared memory must not rely on a process-local lock");
+
+kj::Own<SharedMemoryTable> SharedMemoryTable::open(kj::StringPtr path, Options options) {
+#if _WIN32
+  KJ_UNIMPLEMENTED("SharedMemoryTable is not supported on Windows.");
+#else
+  KJ_REQUIRE(options.slotCount > 0, "shared memory table needs at least one slot");
+  KJ_REQUIRE(options.slotSize > sizeof(Slot), "shared memory table slots are too small",
+      options.slotSize);
+  options.slotCount = (options.slotCount + PROBE_DISTANCE - 1) / PROBE_DISTANCE * PROBE_DISTANCE;
+  options.slotSize = (options.slotSize + alignof(Slot) - 1) / alignof(Slot) * alignof(Slot);
+  size_t size = HEADER_SIZE + size_t(options.slotCount) * options.slotSize;
+
+  int fd;
+  KJ_SYSCALL(fd = ::open(path.cStr(), O_RDWR | O_CREAT | O_CLOEXEC, 0600), path);
+  kj::AutoCloseFd ownFd(fd);
+
+  // Hold an exclusive lock while checking or initializing the file, so that processes starting at
+  // the same time don't both initialize it.
+  KJ_SYSCALL(flock(fd, LOCK_EX), path);
+  KJ_DEFER(flock(fd, LOCK_UN));
+
+  struct stat stats;
+  KJ_SYSCALL(fstat(fd, &stats), path);
+  bool fresh = stats.st_size == 0;
+  if (fresh) {
+    // Zero-filled, which leaves every slot empty.
+    KJ_SYSCALL(ftruncate(fd, size), path);
+  } else {
+    KJ_REQUIRE(size_t(stats.st_size) == size,
+        "shared memory table file was created with different options", path, stats.st_size, size);
+  }
+
+  void* mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (mapped == MAP_FAILED) {
+    KJ_FAIL_SYSCALL("mmap", errno, path);
+  }
+  auto table = kj::heap<SharedMemoryTable>(reinterpret_cast<kj::byte*>(mapped), size, options);
+
+  auto& header = *reinterpret_cast<Header*>(mapped);
+  if (fresh) {
+    header.version = VERSION;
+    header.slotCount = options.slotCount;
+    header.slotSize = options.slotSize;
+    header.magic = MAGIC;
+  } else {
+    KJ_REQUIRE(header.magic == MAGIC && header.version == VERSION &&
+            header.slotCount == options.slotCount && header.slotSize == options.slotSize,
+        "shared memory table file was created with different options", path);
+  }
+  return table;
+#endif
+}
+
+SharedMemoryTable::SharedMemoryTable(kj::byte* mapping, size_t mappingSize, Options options)
+    : mapping(mapping),
+      mappingSize(mappingSize),
+      slotCount(options.slotCount),
+      slotSize(options.slotSize) {}
+
+SharedMemoryTable::~SharedMemoryTable() noexcept(false) {
+#if !_WIN32
+  KJ_SYSCALL(munmap(mapping, mappingSize));
+#endif
+}
+
+size_t SharedMemoryTable::maxEntrySize() const {
+  return slotSize - sizeof(Slot);
+}
+
+SharedMemoryTable::Slot& SharedMemoryTable::slot(uint32_t index) const {
+  return *reinterpret_cast<Slot*>(mapping + HEADER_SIZE + size_t(index) * slotSize);
+}
+
+kj::Maybe<SharedMemoryTable::Entry> SharedMemoryTable::get(
+    kj::ArrayPtr<const kj::byte> key, double now) const {
+  auto hash = hashKey(key);
+  uint32_t first = hash % (slotCount / PROBE_DISTANCE) * PROBE_DISTANCE;
+
+  for (auto i: kj::range(first, first + PROBE_DISTANCE)) {
+    auto& s = slot(i);
+    for (uint attempt = 0; attempt < READ_ATTEMPTS; attempt++) {
+      auto sequence = s.sequence.load(std::memory_order_acquire);
+      if (sequence & 1) continue;
+
+      auto flags = s.flags;
+      auto keySize = s.keySize;
+      auto valueSize = s.valueSize;
+      bool matches = (flags & SLOT_USED) && s.hash == hash && keySize == key.size() &&
+          size_t(keySize) + valueSize <= maxEntrySize() &&
+          memcmp(s.data(), key.begin(), keySize) == 0;
+      kj::Maybe<Entry> result;
+      if (matches) {
+        auto value = kj::heapArray<kj::byte>(valueSize);
+        memcpy(value.begin(), s.data() + keySize, valueSize);
+        kj::Maybe<double> expiration;
+        if (flags & SLOT_HAS_EXPIRATION) {
+          expiration = s.expiration;
+        }
+        result = Entry{.value = kj::mv(value), .expiration = expiration};
+      }
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (s.sequence.load(std::memory_order_relaxed) != sequence) continue;
+
+      if (!matches) break;
+      KJ_IF_SOME(e, result) {
+        KJ_IF_SOME(expiration, e.expiration) {
+          if (expiration <= now) return kj::none;
+        }
+      }
+      return kj::mv(result);
+    }
+  }
+  return kj::none;
+}
+
+bool SharedMemoryTable::put(kj::ArrayPtr<const kj::byte> key,
+    kj::ArrayPtr<const kj::byte> value,
+    kj::Maybe<double> expiration,
+    double now) const {
+  auto hash = hashKey(key);
+  uint32_t first = hash % (slotCount / PROBE_DISTANCE) * PROBE_DISTANCE;
+  bool fits = key.size() + value.size() <= maxEntrySize();
+
+  // Choose a slot from a racy look at the bucket. Another process may change it before we lock
+  // it, which at worst evicts a different entry than we'd otherwise have chosen, or leaves two
+  // copies of the key in the bucket until one of them is evicted or expires.
+  Slot* target = nullptr;
+  Slot* vacant = nullptr;
+  for (auto i: kj::range(first, first + PROBE_DISTANCE)) {
+    auto& s = slot(i);
+    if (!(s.flags & SLOT_USED) || ((s.flags & SLOT_HAS_EXPIRATION) && s.expiration <= now)) {
+      if (vacant == nullptr) vacant = &s;
+    } else if (s.hash == hash && s.keySize == key.size() && key.size() <= maxEntrySize() &&
+        memcmp(s.data(), key.begin(), key.size()) == 0) {
+      target = &s;
+      break;
+    }
+  }
+  if (target == nullptr) {
+    if (!fits) return false;
+    target = vacant != nullptr ? vacant : &slot(first + (hash >> 32) % PROBE_DISTANCE);
+  }
+  auto& s = *target;
+
+  auto sequence = s.sequence.load(std::memory_order_relaxed);
+  if ((sequence & 1) ||
+      !s.sequence.compare_exchange_strong(
+          sequence, sequence + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+    return false;
+  }
+
+  if (fits) {
+    s.flags = SLOT_USED;
+    s.hash = hash;
+    s.keySize = key.size();
+    s.valueSize = value.size();
+    s.expiration = 0;
+    KJ_IF_SOME(e, expiration) {
+      s.flags |= SLOT_HAS_EXPIRATION;
+      s.expiration = e;
+    }
+    memcpy(s.data(), key.begin(), key.size());
+    memcpy(s.data() + key.size(), value.begin(), value.size());
+  } else {
+    s.flags = 0;
+  }
+
+  s.sequence.store(sequence + 2, std::memory_order_release);
+  return fits;
+}
+
+}  // namespace workerd
@@ -0,0 +1,81 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <kj/array.h>
+#include <kj/common.h>
+#include <kj/memory.h>
+#include <kj/string.h>
+
+namespace workerd {
+
+// A fixed-size key/value cache in a shared file mapping, which any number of processes on the
+// same host can map and use at once. It holds copies of values, never pointers, so the processes
+// need not share anything else.
+//
+// The table is an array of equally sized slots. A key may live in any of a few consecutive slots
+// starting at its hash; an insert takes the slot already holding the key, or an empty or expired
+// one, or else evicts one at random. Each slot is guarded by a sequence lock: readers copy the
+// slot out and retry (up to a few times) if a writer touched it meanwhile, and a writer that finds
+// the slot already being written gives up. Neither ever blocks, and since slots are copied out
+// rather than referenced, nothing needs to be reclaimed after an overwrite.
+//
+// Like any cache, the table may lose entries at any time: on eviction, on contention, or if a
+// process dies mid-write (which leaves that one slot unusable until the file is recreated).
+class SharedMemoryTable {
+ public:
+  struct Options {
+    // Number of slots. Rounded up to a multiple of the probe distance.
+    uint32_t slotCount;
+
+    // Size of each slot, including a small header and the key. Bounds the size of the entries
+    // that fit, see maxEntrySize().
+    uint32_t slotSize;
+  };
+
+  // Maps the table backed by the file at `path`, creating and initializing it if it doesn't exist
+  // or is empty. Every process must pass the same options for the same file; a file laid out
+  // with different options is rejected. Not supported on Windows.
+  static kj::Own<SharedMemoryTable> open(kj::StringPtr path, Options options);
+
+  struct Entry {
+    kj::Array<kj::byte> value;
+    // Milliseconds since the Unix epoch, as with Date.now().
+    kj::Maybe<double> expiration;
+  };
+
+  // Returns a copy of the entry for `key`, unless there's none or it expired before `now`.
+  kj::Maybe<Entry> get(kj::ArrayPtr<const kj::byte> key, double now) const;
+
+  // Stores an entry for `key`, possibly evicting another. Entries that expired before `now` are
+  // evicted first. Returns false if it wasn't stored, because the slot was being written by
+  // another process, or because it's too large, in which case any existing entry for `key` is
+  // dropped so that it can't be read in place of the new value.
+  bool put(kj::ArrayPtr<const kj::byte> key,
+      kj::ArrayPtr<const kj::byte> value,
+      kj::Maybe<double> expiration,
+      double now) const;
+
+  // Largest key plus value that fits in a slot.
+  size_t maxEntrySize() const;
+
+  // Use open().
+  SharedMemoryTable(kj::byte* mapping, size_t mappingSize, Options options);
+  ~SharedMemoryTable() noexcept(false);
+  KJ_DISALLOW_COPY_AND_MOVE(SharedMemoryTable);
+
+ private:
+  struct Header;
+  struct Slot;
+
+  kj::byte* mapping;
+  size_t mappingSize;
+  uint32_t slotCount;
+  uint32_t slotSize;
+
+  Slot& slot(uint32_t index) const;
+};
+
+}  // namespace workerd
@@ -6,6 +6,8 @@
 
 #include <kj/test.h>
 
+#include <algorithm>
+
 namespace workerd {
 namespace {
 
@@ -73,6 +75,22 @@ KJ_TEST("SQLite-KV") {
   KJ_EXPECT(list(nullptr, "foo"_kj, 2, F) == "bar=def, baz=123");
   KJ_EXPECT(list(nullptr, "foo"_kj, 3, F) == "bar=def, baz=123");
 
+  auto listKeys = [&](auto&&... params) {
+    kj::Vector<kj::String> results;
+    auto n = kv.listKeys(params..., [&](kj::StringPtr key) { results.add(kj::str(key)); });
+    KJ_EXPECT(results.size() == n);
+    return kj::strArray(results, ", ");
+  };
+
+  KJ_EXPECT(listKeys(nullptr, kj::none, kj::none, F) == "bar, baz, foo, qux");
+  KJ_EXPECT(listKeys("baz"_kj, "qux"_kj, kj::none, F) == "baz, foo");
+  KJ_EXPECT(listKeys(nullptr, kj::none, 2, F) == "bar, baz");
+  KJ_EXPECT(listKeys("bar"_kj, "qux"_kj, 1, F) == "bar");
+  KJ_EXPECT(listKeys(nullptr, kj::none, kj::none, R) == "qux, foo, baz, bar");
+  KJ_EXPECT(listKeys("baz"_kj, "qux"_kj, kj::none, R) == "foo, baz");
+  KJ_EXPECT(listKeys(nullptr, kj::none, 2, R) == "qux, foo");
+  KJ_EXPECT(listKeys("bar"_kj, "qux"_kj, 1, R) == "foo");
+
   KJ_EXPECT(list(nullptr, kj::none, kj::none, R) == "qux=321, foo=abc, baz=123, bar=def");
   KJ_EXPECT(list("foo"_kj, kj::none, kj::none, R) == "qux=321, foo=abc");
   KJ_EXPECT(list(nullptr, "foo"_kj, kj::none, R) == "baz=123, bar=def");
@@ -109,6 +127,71 @@ KJ_TEST("SQLite-KV") {
     }));
     KJ_EXPECT(called);
   }
+
+  // Without statistics, an estimated deleteAll() can only tell whether anything was deleted.
+  KJ_EXPECT(kv.deleteAll(SqliteKv::DeleteAllCount::ESTIMATE) == 1);
+  KJ_EXPECT(list(nullptr, kj::none, kj::none, F) == "");
+  KJ_EXPECT(kv.deleteAll(SqliteKv::DeleteAllCount::ESTIMATE) == 0);
+}
+
+KJ_TEST("SQLite-KV multi-key operations") {
+  auto dir = kj::newInMemoryDirectory(kj::nullClock());
+  SqliteDatabase::Vfs vfs(*dir);
+  SqliteDatabase db(vfs, kj::Path({"foo"}), kj::WriteMode::CREATE | kj::WriteMode::MODIFY);
+  SqliteKv kv(db);
+
+  // Enough keys to need more than one batch, with a short final batch.
+  constexpr size_t COUNT = SqliteKv::MULTI_BATCH_SIZE * 2 + 3;
+  auto keys = KJ_MAP(i, kj::zeroTo(COUNT)) { return kj::str("key", kj::hex(i)); };
+  auto values = KJ_MAP(i, kj::zeroTo(COUNT)) { return kj::str("value", i); };
+  auto keyPtrs = KJ_MAP(key, keys) -> kj::StringPtr { return key; };
+
+  auto getAll = [&](kj::ArrayPtr<const kj::StringPtr> keys) {
+    kj::Vector<kj::String> results;
+    auto n = kv.getMultiple(keys, [&](kj::StringPtr key, kj::ArrayPtr<const byte> value) {
+      results.add(kj::str(key, "=", value.asChars()));
+    });
+    KJ_EXPECT(results.size() == n);
+    std::sort(results.begin(), results.end());
+    return kj::strArray(results, ", ");
+  };
+
+  // Nothing to find before the table exists.
+  KJ_EXPECT(getAll(keyPtrs) == "");
+  KJ_EXPECT(kv.deleteMultiple(keyPtrs) == 0);
+
+  auto pairs = KJ_MAP(i, kj::zeroTo(COUNT)) {
+    return SqliteKv::KeyValuePtrPair{.key = keys[i], .value = values[i].asBytes()};
+  };
+  kv.putMultiple(pairs);
+
+  KJ_EXPECT(kv.list(nullptr, kj::none, kj::none, SqliteKv::FORWARD,
+                [](kj::StringPtr, kj::ArrayPtr<const byte>) {}) == COUNT);
+
+  {
+    kj::StringPtr some[] = {"key0"_kj, "key21"_kj, "nope"_kj};
+    KJ_EXPECT(getAll(some) == "key0=value0, key21=value33");
+  }
+
+  // Put can overwrite, and the last value for a key wins.
+  {
+    SqliteKv::KeyValuePtrPair overwrite[] = {
+      {.key = "key1"_kj, .value = "a"_kj.asBytes()},
+      {.key = "key1"_kj, .value = "b"_kj.asBytes()},
+      {.key = "new"_kj, .value = "c"_kj.asBytes()},
+    };
+    kv.putMultiple(overwrite);
+    kj::StringPtr some[] = {"key1"_kj, "new"_kj};
+    KJ_EXPECT(getAll(some) == "key1=b, new=c");
+  }
+
+  // Duplicates and missing keys aren't counted as deletions.
+  {
+    kj::StringPtr some[] = {"key0"_kj, "key0"_kj, "nope"_kj, "new"_kj};
+    KJ_EXPECT(kv.deleteMultiple(some) == 2);
+  }
+  KJ_EXPECT(kv.deleteMultiple(keyPtrs) == COUNT - 1);
+  KJ_EXPECT(getAll(keyPtrs) == "");
 }
 
 KJ_TEST("large key") {
@@ -67,6 +67,17 @@ SqliteKv::Initialized& SqliteKv::ensureInitialized() {
   KJ_UNREACHABLE;
 }
 
+SqliteDatabase::Statement& SqliteKv::getListKeysStatement(
+    Initialized& stmts, bool hasEnd, bool hasLimit, Order order) {
+  auto& slot = stmts.stmtListKeys[hasEnd * 4 + hasLimit * 2 + (order == Order::REVERSE)];
+  KJ_IF_SOME(stmt, slot) {
+    return stmt;
+  }
+  auto sql = kj::str("SELECT key FROM _cf_KV WHERE key >= ?", hasEnd ? " AND key < ?" : "",
+      " ORDER BY key", order == Order::REVERSE ? " DESC" : "", hasLimit ? " LIMIT ?" : "");
+  return slot.emplace(stmts.db.prepare(stmts.regulator, sql));
+}
+
 void SqliteKv::put(KeyPtr key, ValuePtr value) {
   ensureInitialized().stmtPut.run(key, value);
 }
@@ -76,15 +87,93 @@ bool SqliteKv::delete_(KeyPtr key) {
   return query.changeCount() > 0;
 }
 
-uint SqliteKv::deleteAll() {
-  // TODO(perf): Consider introducing a compatibility flag that causes deleteAll() to always return
-  //   1. Apps almost certainly don't care about the return value but historically we returned the
-  //   count of keys deleted, so now we're stuck counting the table size for no good reason.
-  uint count = tableCreated ? ensureInitialized().stmtCountKeys.run().getInt(0) : 0;
+void SqliteKv::putMultiple(kj::ArrayPtr<const KeyValuePtrPair> pairs) {
+  if (pairs.size() == 0) return;
+  auto& stmts = ensureInitialized();
+
+  for (size_t i = 0; i < pairs.size(); i += MULTI_BATCH_SIZE) {
+    auto batch = pairs.slice(i, kj::min(i + MULTI_BATCH_SIZE, pairs.size()));
+    if (batch.size() == 1) {
+      stmts.stmtPut.run(batch[0].key, batch[0].value);
+      continue;
+    }
+
+    // Pad a short batch by repeating its last pair. Rows are inserted in order, so writing the
+    // same pair again is a no-op.
+    kj::FixedArray<SqliteDatabase::Query::ValuePtr, MULTI_BATCH_SIZE * 2> bindings;
+    for (auto j: kj::zeroTo(MULTI_BATCH_SIZE)) {
+      auto& pair = batch[kj::min(j, batch.size() - 1)];
+      bindings[j * 2] = pair.key;
+      bindings[j * 2 + 1] = pair.value;
+    }
+    kj::ArrayPtr<const SqliteDatabase::Query::ValuePtr> bindingsPtr = bindings.asPtr();
+    stmts.stmtMultiPut.run(bindingsPtr);
+  }
+}
+
+uint SqliteKv::deleteMultiple(kj::ArrayPtr<const KeyPtr> keys) {
+  if (keys.size() == 0) return 0;
+  auto& stmts = ensureInitialized();
+
+  uint count = 0;
+  for (size_t i = 0; i < keys.size(); i += MULTI_BATCH_SIZE) {
+    auto batch = keys.slice(i, kj::min(i + MULTI_BATCH_SIZE, keys.size()));
+    if (batch.size() == 1) {
+      count += stmts.stmtDelete.run(batch[0]).changeCount();
+      continue;
+    }
+
+    // Pad a short batch by repeating its last key. Duplicates in `IN (...)` don't matter.
+    kj::FixedArray<SqliteDatabase::Query::ValuePtr, MULTI_BATCH_SIZE> bindings;
+    for (auto j: kj::indices(bindings)) {
+      bindings[j] = batch[kj::min(j, batch.size() - 1)];
+    }
+    kj::ArrayPtr<const SqliteDatabase::Query::ValuePtr> bindingsPtr = bindings.asPtr();
+    count += stmts.stmtMultiDelete.run(bindingsPtr).changeCount();
+  }
+  return count;
+}
+
+uint SqliteKv::deleteAll(DeleteAllCount countMode) {
+  // Historically we returned the count of keys deleted, which means counting the table size even
+  // though apps almost certainly don't care about the return value. DeleteAllCount::ESTIMATE
+  // (enabled by a compatibility flag) avoids this.
+  uint count = 0;
+  uint64_t rowsCounted = 0;
+  if (tableCreated) {
+    switch (countMode) {
+      case DeleteAllCount::EXACT:
+        count = ensureInitialized().stmtCountKeys.run().getInt(0);
+        rowsCounted = count;
+        break;
+      case DeleteAllCount::ESTIMATE:
+        count = estimateKeyCount();
+        break;
+    }
+  }
+  db.getSqliteObserver().addDeleteAllStats(rowsCounted);
   db.reset();
   return count;
 }
 
+uint SqliteKv::estimateKeyCount() {
+  if (!db.run("SELECT name FROM sqlite_master WHERE type='table' AND name='sqlite_stat1'")
+           .isDone()) {
+    // The first number in the `stat` column is the approximate number of rows in the table.
+    auto query = db.run("SELECT stat FROM sqlite_stat1 WHERE tbl = '_cf_KV' LIMIT 1");
+    if (!query.isDone()) {
+      auto stat = query.getText(0);
+      auto rows = kj::str(stat.first(stat.findFirst(' ').orDefault(stat.size())));
+      KJ_IF_SOME(n, rows.tryParseAs<uint>()) {
+        return n;
+      }
+    }
+  }
+
+  // No statistics, so all we can cheaply tell is whether the table is empty.
+  return db.run("SELECT 1 FROM _cf_KV LIMIT 1").isDone() ? 0 : 1;
+}
+
 void SqliteKv::beforeSqliteReset() {
   // We'll need to recreate the table on the next operation.
   tableCreated = false;
@@ -46,18 +46,53 @@ class SqliteKv: private SqliteDatabase::ResetListener {
   uint list(
       KeyPtr begin, kj::Maybe<KeyPtr> end, kj::Maybe<uint> limit, Order order, Func&& callback);
 
+  // Like list(), but calls the callback with only the KeyPtr of each entry. The values are never
+  // read, so a scan over large values doesn't touch their overflow pages.
+  template <typename Func>
+  uint listKeys(
+      KeyPtr begin, kj::Maybe<KeyPtr> end, kj::Maybe<uint> limit, Order order, Func&& callback);
+
   // Store a value into the table.
   void put(KeyPtr key, ValuePtr value);
 
   // Delete the key and return whether it was matched.
   bool delete_(KeyPtr key);
 
-  uint deleteAll();
+  enum class DeleteAllCount {
+    // Count the keys exactly. This requires scanning the whole table.
+    EXACT,
+
+    // Estimate the number of keys, in constant time. If ANALYZE has gathered statistics on the
+    // table, they're used, otherwise this returns 1 if the table is non-empty.
+    ESTIMATE,
+  };
+
+  // Delete everything (by resetting the whole database) and return the number of keys deleted.
+  uint deleteAll(DeleteAllCount count = DeleteAllCount::EXACT);
+
+  // Multi-key versions of the above. These execute one prepared statement per MULTI_BATCH_SIZE
+  // keys, rather than one per key. (We use fixed-size batches, padding the last one by repeating
+  // an element, so that the statements can be prepared once. The c-array extension can't be used
+  // here since it can only bind arrays of NUL-terminated strings, not blobs.)
+
+  static constexpr size_t MULTI_BATCH_SIZE = 16;
+
+  struct KeyValuePtrPair {
+    KeyPtr key;
+    ValuePtr value;
+  };
+
+  // Like get(), but calls the callback (with KeyPtr and ValuePtr parameters) for each of `keys`
+  // that is found, in no particular order. Duplicate keys are only reported once per batch.
+  // Returns the number of callbacks made.
+  template <typename Func>
+  uint getMultiple(kj::ArrayPtr<const KeyPtr> keys, Func&& callback);
+
+  // Store several values. If a key appears more than once, the last value wins.
+  void putMultiple(kj::ArrayPtr<const KeyValuePtrPair> pairs);
 
-  // TODO(perf): Should we provide multi-get, multi-put, and multi-delete? It's a bit tricky to
-  //   implement them as single SQL queries, while still using prepared statements. The c-array
-  //   extension might help here, though it can only support arrays of NUL-terminated strings, not
-  //   byte blobs or strings containing NUL bytes.
+  // Delete several keys and return how many were matched.
+  uint deleteMultiple(kj::ArrayPtr<const KeyPtr> keys);
 
  private:
   struct Uninitialized {};
@@ -79,6 +114,21 @@ class SqliteKv: private SqliteDatabase::ResetListener {
     SqliteDatabase::Statement stmtDelete = db.prepare(regulator, R"(
       DELETE FROM _cf_KV WHERE key = ?
     )");
+    // The multi-key statements below have exactly MULTI_BATCH_SIZE keys' worth of parameters.
+    SqliteDatabase::Statement stmtMultiGet = db.prepare(regulator, R"(
+      SELECT key, value FROM _cf_KV
+      WHERE key IN (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
+    )");
+    SqliteDatabase::Statement stmtMultiPut = db.prepare(regulator, R"(
+      INSERT INTO _cf_KV VALUES
+        (?, ?), (?, ?), (?, ?), (?, ?), (?, ?), (?, ?), (?, ?), (?, ?),
+        (?, ?), (?, ?), (?, ?), (?, ?), (?, ?), (?, ?), (?, ?), (?, ?)
+        ON CONFLICT DO UPDATE SET value = excluded.value;
+    )");
+    SqliteDatabase::Statement stmtMultiDelete = db.prepare(regulator, R"(
+      DELETE FROM _cf_KV
+      WHERE key IN (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
+    )");
     SqliteDatabase::Statement stmtList = db.prepare(regulator, R"(
       SELECT * FROM _cf_KV
       WHERE key >= ?
@@ -123,6 +173,10 @@ class SqliteKv: private SqliteDatabase::ResetListener {
       ORDER BY key DESC
       LIMIT ?
     )");
+    // Keys-only versions of the list statements, prepared on first use since few callers need
+    // them. Indexed by listKeysStatementIndex().
+    kj::Maybe<SqliteDatabase::Statement> stmtListKeys[8];
+
     // We don't pass in the regulator here because this query doesn't take user input, so
     // it failing is always our fault.
     SqliteDatabase::Statement stmtCountKeys = db.prepare(R"(
@@ -142,6 +196,12 @@ class SqliteKv: private SqliteDatabase::ResetListener {
   // Make sure the KV table is created and prepared statements are ready. Not called until the
   // first write.
 
+  // Estimates the number of keys in the table in constant time, for deleteAll().
+  uint estimateKeyCount();
+
+  SqliteDatabase::Statement& getListKeysStatement(
+      Initialized& stmts, bool hasEnd, bool hasLimit, Order order);
+
   void beforeSqliteReset() override;
 };
 
@@ -167,6 +227,40 @@ bool SqliteKv::get(KeyPtr key, Func&& callback) {
   }
 }
 
+template <typename Func>
+uint SqliteKv::getMultiple(kj::ArrayPtr<const KeyPtr> keys, Func&& callback) {
+  if (!tableCreated) return 0;
+  auto& stmts = KJ_UNWRAP_OR(state.tryGet<Initialized>(), return 0);
+
+  uint count = 0;
+  for (size_t i = 0; i < keys.size(); i += MULTI_BATCH_SIZE) {
+    auto batch = keys.slice(i, kj::min(i + MULTI_BATCH_SIZE, keys.size()));
+    if (batch.size() == 1) {
+      auto query = stmts.stmtGet.run(batch[0]);
+      if (!query.isDone()) {
+        callback(batch[0], query.getBlob(0));
+        ++count;
+      }
+      continue;
+    }
+
+    // Pad a short batch by repeating its last key. Duplicates in `IN (...)` don't matter.
+    kj::FixedArray<SqliteDatabase::Query::ValuePtr, MULTI_BATCH_SIZE> bindings;
+    for (auto j: kj::indices(bindings)) {
+      bindings[j] = batch[kj::min(j, batch.size() - 1)];
+    }
+    kj::ArrayPtr<const SqliteDatabase::Query::ValuePtr> bindingsPtr = bindings.asPtr();
+
+    auto query = stmts.stmtMultiGet.run(bindingsPtr);
+    while (!query.isDone()) {
+      callback(query.getText(0), query.getBlob(1));
+      query.nextRow();
+      ++count;
+    }
+  }
+  return count;
+}
+
 template <typename Func>
 uint SqliteKv::list(
     KeyPtr begin, kj::Maybe<KeyPtr> end, kj::Maybe<uint> limit, Order order, Func&& callback) {
@@ -214,4 +308,29 @@ uint SqliteKv::list(
   }
 }
 
+template <typename Func>
+uint SqliteKv::listKeys(
+    KeyPtr begin, kj::Maybe<KeyPtr> end, kj::Maybe<uint> limit, Order order, Func&& callback) {
+  if (!tableCreated) return 0;
+  auto& stmts = KJ_UNWRAP_OR(state.tryGet<Initialized>(), return 0);
+
+  auto& stmt = getListKeysStatement(stmts, end != kj::none, limit != kj::none, order);
+  kj::Vector<SqliteDatabase::Query::ValuePtr> bindings(3);
+  bindings.add(begin);
+  KJ_IF_SOME(e, end) {
+    bindings.add(e);
+  }
+  KJ_IF_SOME(l, limit) {
+    bindings.add(static_cast<int64_t>(l));
+  }
+
+  auto query = stmt.run(bindings.asPtr().asConst());
+  uint count = 0;
+  query.forEachRow(kj::maxValue, [&]() {
+    callback(query.getText(0));
+    ++count;
+  });
+  return count;
+}
+
 }  // namespace workerd
@@ -779,6 +779,153 @@ KJ_TEST("DELETE with LIMIT") {
   KJ_EXPECT(q.getInt(0) == 3);
 }
 
+KJ_TEST("SQLite per-database cache options") {
+  auto dir = kj::newInMemoryDirectory(kj::nullClock());
+  SqliteDatabase::Vfs vfs(*dir, {.cacheSize = -256});
+  SqliteDatabase db(vfs, kj::Path({"foo"}), kj::WriteMode::CREATE | kj::WriteMode::MODIFY);
+
+  KJ_EXPECT(db.run("PRAGMA cache_size").getInt(0) == -256);
+
+  db.run("CREATE TABLE things (id INTEGER PRIMARY KEY)");
+  db.run("INSERT INTO things VALUES (123)");
+  db.run("SELECT * FROM things").nextRow();
+  db.run("SELECT * FROM things").nextRow();
+
+  auto stats = db.getPageCacheStats();
+  KJ_EXPECT(stats.hits > 0);
+
+  // The setting survives reset().
+  db.reset();
+  KJ_EXPECT(db.run("PRAGMA cache_size").getInt(0) == -256);
+}
+
+KJ_TEST("SQLite memory-mapped reads of read-only database") {
+  auto dir = kj::newInMemoryDirectory(kj::nullClock());
+
+  {
+    SqliteDatabase::Vfs vfs(*dir);
+    SqliteDatabase db(vfs, kj::Path({"foo"}), kj::WriteMode::CREATE | kj::WriteMode::MODIFY);
+    db.run("CREATE TABLE things (id INTEGER PRIMARY KEY, value TEXT)");
+    for (auto i: kj::zeroTo(1000)) {
+      db.run("INSERT INTO things VALUES (?, ?)", i, kj::str("value", i));
+    }
+  }
+
+  SqliteDatabase::Vfs vfs(*dir, {.mmapSize = 1 << 20, .mmapReadOnlyFiles = true});
+  SqliteDatabase db(vfs, kj::Path({"foo"}));
+
+  KJ_EXPECT(db.run("SELECT COUNT(*) FROM things").getInt(0) == 1000);
+  KJ_EXPECT(db.run("SELECT value FROM things WHERE id = 567").getText(0) == "value567");
+}
+
+KJ_TEST("SQLite backup snapshot and restore") {
+  auto dir = kj::newInMemoryDirectory(kj::nullClock());
+  SqliteDatabase::Vfs vfs(*dir);
+  SqliteDatabase db(vfs, kj::Path({"foo"}), kj::WriteMode::CREATE | kj::WriteMode::MODIFY);
+
+  db.run("CREATE TABLE things (id INTEGER PRIMARY KEY, value TEXT)");
+  for (auto i: kj::zeroTo(1000)) {
+    db.run("INSERT INTO things VALUES (?, ?)", i, kj::str("value", i));
+  }
+
+  // Export, one page at a time.
+  auto snapshotDir = kj::newInMemoryDirectory(kj::nullClock());
+  SqliteDatabase::Vfs snapshotVfs(*snapshotDir);
+  {
+    SqliteDatabase snapshot(
+        snapshotVfs, kj::Path({"snapshot"}), kj::WriteMode::CREATE | kj::WriteMode::MODIFY);
+    SqliteDatabase::Backup backup(db, snapshot);
+    uint steps = 0;
+    while (!backup.step(1)) {
+      ++steps;
+      // Writes through the source connection mid-backup are included in the snapshot.
+      if (steps == 1) db.run("INSERT INTO things VALUES (1000, 'late')");
+    }
+    KJ_EXPECT(steps > 1);
+    KJ_EXPECT(backup.remainingPages() == 0);
+  }
+  KJ_EXPECT(snapshotDir->openFile(kj::Path({"snapshot"}))->stat().size > 0);
+
+  // Ingest into another database, replacing its contents.
+  SqliteDatabase restored(vfs, kj::Path({"bar"}), kj::WriteMode::CREATE | kj::WriteMode::MODIFY);
+  restored.run("CREATE TABLE other (x INTEGER)");
+  {
+    SqliteDatabase snapshot(snapshotVfs, kj::Path({"snapshot"}));
+    SqliteDatabase::Backup(snapshot, restored).finish();
+  }
+  KJ_EXPECT(restored.run("SELECT COUNT(*) FROM things").getInt(0) == 1001);
+  KJ_EXPECT(restored.run("SELECT value FROM things WHERE id = 1000").getText(0) == "late");
+  KJ_EXPECT_THROW_MESSAGE("no such table: other", restored.run("SELECT * FROM other"));
+}
+
+KJ_TEST("SQLite WAL mode option") {
+  auto dir = kj::newInMemoryDirectory(kj::nullClock());
+  SqliteDatabase::Vfs vfs(*dir, {.walMode = true});
+  SqliteDatabase db(vfs, kj::Path({"foo"}), kj::WriteMode::CREATE | kj::WriteMode::MODIFY);
+
+  KJ_EXPECT(db.run("PRAGMA journal_mode").getText(0) == "wal");
+
+  db.reset();
+  KJ_EXPECT(db.run("PRAGMA journal_mode").getText(0) == "wal");
+}
+
+KJ_TEST("SQLite forEachRow") {
+  auto dir = kj::newInMemoryDirectory(kj::nullClock());
+  SqliteDatabase::Vfs vfs(*dir);
+  SqliteDatabase db(vfs, kj::Path({"foo"}), kj::WriteMode::CREATE | kj::WriteMode::MODIFY);
+
+  db.run("CREATE TABLE things (id INTEGER PRIMARY KEY)");
+  for (auto i: kj::zeroTo(10)) {
+    db.run("INSERT INTO things VALUES (?)", i);
+  }
+
+  auto query = db.run("SELECT id FROM things ORDER BY id");
+  kj::Vector<int> ids;
+  KJ_EXPECT(query.forEachRow(4, [&]() { ids.add(query.getInt(0)); }) == 4);
+  KJ_EXPECT(!query.isDone());
+  KJ_EXPECT(query.getInt(0) == 4);
+
+  // Mixing with nextRow() works as expected.
+  query.nextRow();
+  KJ_EXPECT(query.forEachRow(100, [&]() { ids.add(query.getInt(0)); }) == 5);
+  KJ_EXPECT(query.isDone());
+  KJ_EXPECT(query.forEachRow(100, [&]() { KJ_FAIL_EXPECT("no more rows"); }) == 0);
+  KJ_EXPECT(kj::strArray(ids, ",") == "0,1,2,3,5,6,7,8,9");
+  KJ_EXPECT(query.getRowsRead() == 10);
+}
+
+KJ_TEST("SQLite ingestSql") {
+  auto dir = kj::newInMemoryDirectory(kj::nullClock());
+  SqliteDatabase::Vfs vfs(*dir);
+  SqliteDatabase db(vfs, kj::Path({"foo"}), kj::WriteMode::CREATE | kj::WriteMode::MODIFY);
+
+  db.run("CREATE TABLE things (id INTEGER PRIMARY KEY, value)");
+
+  // Statements of the same shape share a prepared statement, with their literals bound as
+  // parameters; the values must come through exactly as they would have as literals.
+  auto result = db.ingestSql(SqliteDatabase::TRUSTED,
+      "INSERT INTO things VALUES (1, 'it''s; fine');\n"
+      "INSERT INTO things VALUES (2, -2.5e1);\n"
+      "INSERT INTO things VALUES (3, X'00ff');\n"
+      "INSERT INTO things VALUES (4, NULL);\n"
+      "INSERT INTO things VALUES (5, 9223372036854775807);\n"
+      "INSERT INTO things VALUES (6, 99999999999999999999);\n"
+      "INSERT INTO things (id, value) SELECT 7, 'x' ORDER BY 1;\n"
+      "INSERT INTO things VALUES (8, 'incomp"_kj);
+  KJ_EXPECT(result.statementCount == 7);
+  KJ_EXPECT(result.rowsWritten == 7);
+  KJ_EXPECT(result.remainder == "\nINSERT INTO things VALUES (8, 'incomp");
+
+  auto query = db.run("SELECT id, typeof(value), quote(value) FROM things ORDER BY id");
+  kj::Vector<kj::String> rows;
+  query.forEachRow(kj::maxValue, [&]() {
+    rows.add(kj::str(query.getInt(0), ":", query.getText(1), ":", query.getText(2)));
+  });
+  KJ_EXPECT(kj::strArray(rows, ",") ==
+      "1:text:'it''s; fine',2:real:-25.0,3:blob:X'00FF',4:null:NULL,"
+      "5:integer:9223372036854775807,6:real:1.0e+20,7:text:'x'");
+}
+
 KJ_TEST("reset database") {
   auto dir = kj::newInMemoryDirectory(kj::nullClock());
   SqliteDatabase::Vfs vfs(*dir);
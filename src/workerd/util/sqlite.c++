@@ -4,7 +4,9 @@
 
 #include "sqlite.h"
 
+#include <workerd/util/duration-exceeded-logger.h>
 #include <workerd/util/sentry.h>
+#include <workerd/util/use-perfetto-categories.h>
 
 #include <kj/debug.h>
 #include <kj/refcount.h>
@@ -428,6 +430,20 @@ void SqliteDatabase::init(kj::Maybe<kj::WriteMode> maybeMode) {
 
   KJ_ON_SCOPE_FAILURE(sqlite3_close_v2(db));
 
+  // Apply per-database settings. This must happen before setupSecurity() since the authorizer
+  // would reject these pragmas.
+  KJ_IF_SOME(cacheSize, vfs.options.cacheSize) {
+    SQLITE_CALL_NODB(sqlite3_exec(
+        db, kj::str("PRAGMA cache_size = ", cacheSize).cStr(), nullptr, nullptr, nullptr));
+  }
+  KJ_IF_SOME(mmapSize, vfs.options.mmapSize) {
+    SQLITE_CALL_NODB(sqlite3_exec(
+        db, kj::str("PRAGMA mmap_size = ", mmapSize).cStr(), nullptr, nullptr, nullptr));
+  }
+  if (vfs.options.walMode && maybeMode != kj::none) {
+    SQLITE_CALL_NODB(sqlite3_exec(db, "PRAGMA journal_mode=WAL;", nullptr, nullptr, nullptr));
+  }
+
   setupSecurity(db);
 
   maybeDb = *db;
@@ -453,6 +469,14 @@ SqliteDatabase::operator sqlite3*() {
   return &KJ_ASSERT_NONNULL(maybeDb, "previous reset() failed");
 }
 
+SqliteDatabase::PageCacheStats SqliteDatabase::getPageCacheStats() {
+  sqlite3* db = *this;
+  int hits = 0, misses = 0, highwater = 0;
+  SQLITE_CALL_NODB(sqlite3_db_status(db, SQLITE_DBSTATUS_CACHE_HIT, &hits, &highwater, false));
+  SQLITE_CALL_NODB(sqlite3_db_status(db, SQLITE_DBSTATUS_CACHE_MISS, &misses, &highwater, false));
+  return {.hits = static_cast<uint64_t>(hits), .misses = static_cast<uint64_t>(misses)};
+}
+
 void SqliteDatabase::notifyWrite() {
   KJ_IF_SOME(cb, onWriteCallback) {
     cb();
@@ -676,12 +700,173 @@ SqliteDatabase::StatementAndEffect SqliteDatabase::prepareSql(const Regulator& r
   }
 }
 
+namespace {
+
+// An ingested statement with its literal values replaced by `?` parameters, so that statements
+// differing only in their values -- the million INSERTs of a dump -- can share one prepared
+// statement.
+struct ParameterizedStatement {
+  kj::String shape;
+  kj::Vector<SqliteDatabase::Query::ValuePtr> values;
+
+  // Backing storage for the text and blob values, which need to be decoded.
+  kj::Vector<kj::String> strings;
+  kj::Vector<kj::Array<byte>> blobs;
+};
+
+// SQLite's default limit is higher, but statements with this many values gain little from reuse.
+constexpr size_t MAX_INGEST_PARAMETERS = 999;
+
+// Distinct statement shapes kept prepared during one ingestSql() call.
+constexpr size_t MAX_INGEST_SHAPES = 16;
+
+bool isIdentifierChar(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' ||
+      c == '$' || static_cast<byte>(c) >= 0x80;
+}
+
+bool isDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// Returns the parameterized form of `sql`, or none if it isn't an INSERT or REPLACE that is safe
+// to parameterize. This tokenizes only as much as needed to find literals: anything unusual
+// (comments, existing parameters, hex integers, ORDER BY/GROUP BY, whose integer literals name
+// columns) makes it give up, and the statement is then run as-is.
+kj::Maybe<ParameterizedStatement> parameterizeStatement(kj::StringPtr sql) {
+  size_t i = 0;
+  auto n = sql.size();
+  while (i < n && (sql[i] == ' ' || sql[i] == '\t' || sql[i] == '\n' || sql[i] == '\r')) ++i;
+  auto rest = sql.slice(i);
+  if (strncasecmp(rest.begin(), "INSERT", 6) != 0 && strncasecmp(rest.begin(), "REPLACE", 7) != 0) {
+    return kj::none;
+  }
+
+  ParameterizedStatement result;
+  kj::Vector<char> shape(n + 1);
+  while (i < n) {
+    char c = sql[i];
+    if (c == '\'') {
+      // String literal, in which '' is an escaped quote.
+      kj::Vector<char> text;
+      ++i;
+      for (;;) {
+        if (i >= n) return kj::none;
+        if (sql[i] == '\'') {
+          if (i + 1 < n && sql[i + 1] == '\'') {
+            text.add('\'');
+            i += 2;
+          } else {
+            ++i;
+            break;
+          }
+        } else {
+          text.add(sql[i++]);
+        }
+      }
+      text.add('\0');
+      auto& str = result.strings.add(text.releaseAsArray());
+      result.values.add(str.asPtr());
+      shape.add('?');
+    } else if ((c == 'x' || c == 'X') && i + 1 < n && sql[i + 1] == '\'') {
+      // Blob literal.
+      auto end = i + 2;
+      while (end < n && sql[end] != '\'') ++end;
+      if (end >= n || (end - i - 2) % 2 != 0) return kj::none;
+      auto bytes = kj::heapArray<byte>((end - i - 2) / 2);
+      for (auto j: kj::indices(bytes)) {
+        int hi = hexValue(sql[i + 2 + j * 2]);
+        int lo = hexValue(sql[i + 3 + j * 2]);
+        if (hi < 0 || lo < 0) return kj::none;
+        bytes[j] = static_cast<byte>(hi << 4 | lo);
+      }
+      auto& blob = result.blobs.add(kj::mv(bytes));
+      result.values.add(blob.asPtr().asConst());
+      shape.add('?');
+      i = end + 1;
+    } else if (isDigit(c) || (c == '.' && i + 1 < n && isDigit(sql[i + 1]))) {
+      // Numeric literal.
+      if (c == '0' && i + 1 < n && (sql[i + 1] == 'x' || sql[i + 1] == 'X')) return kj::none;
+      auto start = i;
+      bool isReal = false;
+      while (i < n && isDigit(sql[i])) ++i;
+      if (i < n && sql[i] == '.') {
+        isReal = true;
+        ++i;
+        while (i < n && isDigit(sql[i])) ++i;
+      }
+      if (i < n && (sql[i] == 'e' || sql[i] == 'E')) {
+        isReal = true;
+        ++i;
+        if (i < n && (sql[i] == '+' || sql[i] == '-')) ++i;
+        if (i >= n || !isDigit(sql[i])) return kj::none;
+        while (i < n && isDigit(sql[i])) ++i;
+      }
+      if (i < n && isIdentifierChar(sql[i])) return kj::none;
+      auto text = kj::str(sql.slice(start, i));
+      if (isReal) {
+        result.values.add(KJ_UNWRAP_OR_RETURN(text.tryParseAs<double>(), kj::none));
+      } else {
+        // Integers too large for int64 are REAL in SQLite; leave those statements alone.
+        result.values.add(KJ_UNWRAP_OR_RETURN(text.tryParseAs<int64_t>(), kj::none));
+      }
+      shape.add('?');
+    } else if (isIdentifierChar(c) && c != '$') {
+      auto start = i;
+      while (i < n && isIdentifierChar(sql[i])) ++i;
+      auto word = sql.slice(start, i);
+      if (word.size() == 5 &&
+          (strncasecmp(word.begin(), "ORDER", 5) == 0 ||
+              strncasecmp(word.begin(), "GROUP", 5) == 0)) {
+        return kj::none;
+      }
+      shape.addAll(word);
+    } else if (c == '"' || c == '`' || c == '[') {
+      // Quoted identifier, copied verbatim. A doubled quote is an escaped one, which this handles
+      // as two adjacent identifiers.
+      char close = c == '[' ? ']' : c;
+      auto end = i + 1;
+      while (end < n && sql[end] != close) ++end;
+      if (end >= n) return kj::none;
+      shape.addAll(sql.slice(i, end + 1));
+      i = end + 1;
+    } else if ((c == '-' && i + 1 < n && sql[i + 1] == '-') ||
+        (c == '/' && i + 1 < n && sql[i + 1] == '*') || c == '?' || c == ':' || c == '@' ||
+        c == '$' || c == '#') {
+      return kj::none;
+    } else {
+      shape.add(c);
+      ++i;
+    }
+    if (result.values.size() > MAX_INGEST_PARAMETERS) return kj::none;
+  }
+
+  if (result.values.empty()) return kj::none;
+  shape.add('\0');
+  result.shape = kj::String(shape.releaseAsArray());
+  return kj::mv(result);
+}
+
+}  // namespace
+
 SqliteDatabase::IngestResult SqliteDatabase::ingestSql(
     const Regulator& regulator, kj::StringPtr sqlCode) {
   uint64_t rowsRead = 0;
   uint64_t rowsWritten = 0;
   uint64_t statementCount = 0;
 
+  // Statements prepared for each parameterized shape seen so far. A shape that failed to prepare
+  // -- e.g. because one of its literals was in a position where SQLite doesn't allow parameters
+  // -- maps to none, so that its statements are run as-is without retrying the preparation.
+  kj::HashMap<kj::String, kj::Maybe<kj::Own<Statement>>> shapes;
+
   // While there's still some input SQL to process
   while (sqlCode.begin() != sqlCode.end()) {
     // And there are still valid statements:
@@ -690,11 +875,37 @@ SqliteDatabase::IngestResult SqliteDatabase::ingestSql(
 
     // Slice off the next valid statement SQL
     auto nextStatement = kj::str(sqlCode.first(statementLength));
-    // Create a Query object, which will prepare & execute it
-    auto q = Query(*this, regulator, nextStatement);
 
-    rowsRead += q.getRowsRead();
-    rowsWritten += q.getRowsWritten();
+    kj::Maybe<Statement&> shapeStatement;
+    kj::Maybe<ParameterizedStatement> parameterized = parameterizeStatement(nextStatement);
+    KJ_IF_SOME(p, parameterized) {
+      KJ_IF_SOME(entry, shapes.find(p.shape)) {
+        KJ_IF_SOME(stmt, entry) {
+          shapeStatement = *stmt;
+        }
+      } else if (shapes.size() < MAX_INGEST_SHAPES) {
+        // If this fails, leave it to the unparameterized statement to report any real error.
+        kj::Maybe<kj::Own<Statement>> prepared;
+        auto exception KJ_UNUSED =
+            kj::runCatchingExceptions([&]() { prepared = kj::heap(prepare(regulator, p.shape)); });
+        KJ_IF_SOME(stmt, prepared) {
+          shapeStatement = *stmt;
+        }
+        shapes.insert(kj::mv(p.shape), kj::mv(prepared));
+      }
+    }
+
+    // Create a Query object, which will prepare (unless the shape already was) & execute it
+    auto runQuery = [&](Query&& q) {
+      rowsRead += q.getRowsRead();
+      rowsWritten += q.getRowsWritten();
+    };
+    KJ_IF_SOME(stmt, shapeStatement) {
+      runQuery(stmt.run(KJ_ASSERT_NONNULL(parameterized).values.asPtr().asConst()));
+    } else {
+      runQuery(Query(*this, regulator, nextStatement));
+    }
+
     statementCount++;
     sqlCode = sqlCode.slice(statementLength);
   }
@@ -1050,6 +1261,25 @@ bool SqliteDatabase::isAuthorizedTemp(int actionCode,
 
 // Set up security restrictions.
 // See: https://www.sqlite.org/security.html
+namespace {
+
+void initDefaultHeapLimits() {
+  static bool doOnce KJ_UNUSED = []() {
+    sqlite3_soft_heap_limit64(128u << 20);
+    sqlite3_hard_heap_limit64(512u << 20);
+    return false;
+  }();
+}
+
+}  // namespace
+
+void SqliteDatabase::setHeapLimits(uint64_t softLimit, uint64_t hardLimit) {
+  // Make sure the defaults have been applied first so that they don't overwrite these later.
+  initDefaultHeapLimits();
+  sqlite3_soft_heap_limit64(softLimit);
+  sqlite3_hard_heap_limit64(hardLimit);
+}
+
 void SqliteDatabase::setupSecurity(sqlite3* db) {
   // 1. Set defensive mode.
   SQLITE_CALL_NODB(sqlite3_db_config(db, SQLITE_DBCONFIG_DEFENSIVE, 1, nullptr));
@@ -1105,17 +1335,13 @@ void SqliteDatabase::setupSecurity(sqlite3* db) {
   // This happens inside LimitEnforcer.
 
   // 5. Limit heap size.
-  // Annoyingly, this sets a process-wide limit. We'll set 128MB "soft" limit (to try to control
-  // how much page caching SQLite does) and 512MB "hard" limit (to block DoS attacks from taking
-  // down the whole system).
-  // TODO(perf): Revisit as popularity grows. Maybe make configurable? Maybe patch SQLite to allow
-  //   these to be controlled per-database? Is page caching even all that important when the kernel
-  //   does its own page caching?
-  static bool doOnce KJ_UNUSED = []() {
-    sqlite3_soft_heap_limit64(128u << 20);
-    sqlite3_hard_heap_limit64(512u << 20);
-    return false;
-  }();
+  // Annoyingly, this sets a process-wide limit. By default we set a 128MB "soft" limit (to try to
+  // control how much page caching SQLite does) and 512MB "hard" limit (to block DoS attacks from
+  // taking down the whole system). The limits can be changed with setHeapLimits(), and the page
+  // cache of an individual database can be bounded with VfsOptions::cacheSize.
+  // TODO(perf): Is page caching even all that important when the kernel does its own page
+  //   caching?
+  initDefaultHeapLimits();
 
   // 6. Set SQLITE_MAX_ALLOCATION_SIZE compile flag.
   // (handled in BUILD.sqlite3)
@@ -1295,6 +1521,9 @@ void SqliteDatabase::Query::bind(uint i, decltype(nullptr)) {
 }
 
 void SqliteDatabase::Query::nextRow(bool first) {
+  TRACE_EVENT("workerd.sqlite", "SqliteDatabase::Query::nextRow()");
+  static util::SlowOperationSite slowOpSite("sqlite: query step", 100 * kj::MILLISECONDS);
+  util::SlowOperationTimer slowOpTimer(slowOpSite);
   auto& statementAndEffect = getStatementAndEffect();
   sqlite3_stmt* statement = statementAndEffect.statement;
 
@@ -1308,9 +1537,9 @@ void SqliteDatabase::Query::nextRow(bool first) {
   db.currentRegulator = regulator;
 
   int err = sqlite3_step(statement);
-  // TODO(perf): This is slightly inefficient to call for every row read, but not bad enough to
-  // fix it immediately. The alternate way would be to getRowsRead/Written once when we emit it
-  // in the Dtor, and handle the case where the statement could be null when the Query gets destructed
+  // This is slightly inefficient to call for every row read. We can't defer it to the destructor
+  // because the statement could be gone by then if the database was reset. Callers reading many
+  // rows should use forEachRow(), which updates the counters once per batch.
   rowsRead = getRowsRead();
   rowsWritten = getRowsWritten();
   if (err == SQLITE_DONE) {
@@ -1325,6 +1554,43 @@ void SqliteDatabase::Query::nextRow(bool first) {
   }
 }
 
+uint SqliteDatabase::Query::forEachRow(uint maxRows, kj::FunctionParam<void()> func) {
+  if (done || maxRows == 0) return 0;
+  TRACE_EVENT("workerd.sqlite", "SqliteDatabase::Query::forEachRow()");
+  static util::SlowOperationSite slowOpSite("sqlite: query rows", 100 * kj::MILLISECONDS);
+  util::SlowOperationTimer slowOpTimer(slowOpSite);
+
+  sqlite3_stmt* statement = getStatement();
+
+  KJ_ASSERT(db.currentStatement == kj::none, "recursive nextRow()?");
+  KJ_DEFER(db.currentStatement = kj::none);
+  db.currentStatement = *statement;
+
+  KJ_ASSERT(db.currentRegulator == kj::none, "nextRow() during prepare()?");
+  KJ_DEFER(db.currentRegulator = kj::none);
+  db.currentRegulator = regulator;
+
+  // Update the row counters once for the whole batch, even if we exit early with an exception.
+  KJ_DEFER({
+    rowsRead = sqlite3_stmt_status(statement, LIBSQL_STMTSTATUS_ROWS_READ, 0);
+    rowsWritten = sqlite3_stmt_status(statement, LIBSQL_STMTSTATUS_ROWS_WRITTEN, 0);
+  });
+
+  uint count = 0;
+  while (!done && count < maxRows) {
+    func();
+    ++count;
+
+    int err = sqlite3_step(statement);
+    if (err == SQLITE_DONE) {
+      done = true;
+    } else if (err != SQLITE_ROW) {
+      SQLITE_CALL_FAILED("sqlite3_step()", err);
+    }
+  }
+  return count;
+}
+
 uint SqliteDatabase::Query::changeCount() {
   KJ_REQUIRE(done);
   KJ_DREQUIRE(
@@ -1406,6 +1672,60 @@ void SqliteDatabase::Query::beforeSqliteReset() {
   ownStatement = {};
 }
 
+// =======================================================================================
+
+SqliteDatabase::Backup::Backup(SqliteDatabase& source, SqliteDatabase& destination)
+    : destination(destination) {
+  KJ_REQUIRE(!destination.readOnly, "can't restore a backup into a read-only database");
+  KJ_REQUIRE(!destination.inTransaction && destination.savepoints.empty(),
+      "can't restore a backup into a database during a transaction");
+
+  sqlite3* db = destination;
+  backup = sqlite3_backup_init(db, "main", source, "main");
+  if (backup == nullptr) {
+    // Errors from sqlite3_backup_init() are reported on the destination connection.
+    auto ec = sqlite3_errcode(db);
+    KJ_FAIL_ASSERT("sqlite3_backup_init() failed", dbErrorMessage(ec, db));
+  }
+}
+
+SqliteDatabase::Backup::~Backup() noexcept(false) {
+  // sqlite3_backup_finish() returns the error from the last step, if any, which we've already
+  // reported.
+  sqlite3_backup_finish(backup);
+}
+
+bool SqliteDatabase::Backup::step(uint pages) {
+  if (done) return true;
+
+  sqlite3* db = destination;
+  // sqlite3_backup_step() treats a negative count as "all remaining pages".
+  int err = sqlite3_backup_step(backup, pages >= (1u << 31) ? -1 : static_cast<int>(pages));
+  switch (err) {
+    case SQLITE_DONE:
+      done = true;
+      return true;
+    case SQLITE_OK:
+    case SQLITE_BUSY:
+    case SQLITE_LOCKED:
+      // More to do, or the step should be retried later.
+      return false;
+    default: {
+      auto& regulator = TRUSTED;
+      SQLITE_CALL_FAILED("sqlite3_backup_step()", err);
+      KJ_UNREACHABLE;
+    }
+  }
+}
+
+uint SqliteDatabase::Backup::pageCount() {
+  return sqlite3_backup_pagecount(backup);
+}
+
+uint SqliteDatabase::Backup::remainingPages() {
+  return sqlite3_backup_remaining(backup);
+}
+
 // =======================================================================================
 // VFS
 
@@ -1695,6 +2015,10 @@ struct SqliteDatabase::Vfs::FileImpl: public sqlite3_file {
   //
   // We leave this null if the file is not the main database file.
 
+  kj::Vector<kj::Array<const byte>> mappings;
+  // Mappings handed out by xFetch() which haven't been released by xUnfetch() yet. Only used
+  // when VfsOptions::mmapReadOnlyFiles is enabled.
+
   FileImpl(const Vfs& vfs, kj::Own<const kj::File> file, kj::Maybe<kj::Own<Lock>> lock)
       : sqlite3_file{.pMethods = &FILE_METHOD_TABLE},
         vfs(vfs),
@@ -1897,16 +2221,41 @@ const sqlite3_io_methods SqliteDatabase::Vfs::FileImpl::FILE_METHOD_TABLE = {
   // Well, there's a problem. We mostly use this VFS implementation to wrap an in-memory
   // `kj::File`. Such files support mmap by returning a pointer into the backing store. But
   // while such a mapping exists, the backing store cannot be resized. So write()s that extend
-  // the file may fail. This does not work for SQLite's use case.
+  // the file may fail. This does not work for SQLite's use case in general.
   //
-  // So, alas, we must act like we don't support this. Luckily, SQLite has fallbacks for this.
+  // So, by default, we act like we don't support this. Luckily, SQLite has fallbacks for this.
+  // The exception is read-only databases whose owner promises that nothing writes to the file
+  // in the meantime (VfsOptions::mmapReadOnlyFiles), where zero-copy reads are safe.
   *pp = nullptr;
-  return SQLITE_OK;
+  WRAP_METHOD(SQLITE_IOERR_MMAP, {
+    if (self.vfs.options.mmapReadOnlyFiles && self.writableFile == kj::none && iOfst >= 0 &&
+        iAmt > 0 && iOfst + iAmt <= self.file->stat().size) {
+      auto mapping = self.file->mmap(iOfst, iAmt);
+      *pp = const_cast<byte*>(mapping.begin());
+      self.mappings.add(kj::mv(mapping));
+    }
+    return SQLITE_OK;
+  });
 },
   .xUnfetch = [](sqlite3_file* file, sqlite3_int64 iOfst, void* p) noexcept -> int {
-  // Shouldn't ever be called since xFetch() always produces null? But the native implementation
-  // return SQLITE_OK even when mmap is disabled so we will too.
-  return SQLITE_OK;
+  // A null `p` asks us to drop any mappings we might be caching, but we don't cache any beyond
+  // those still in use. The native implementation returns SQLITE_OK even when mmap is disabled
+  // so we will too.
+  WRAP_METHOD(SQLITE_IOERR, {
+    if (p != nullptr) {
+      for (auto i: kj::indices(self.mappings)) {
+        if (self.mappings[i].begin() == p) {
+          // Release by swapping with the last mapping, since order doesn't matter.
+          if (i + 1 < self.mappings.size()) {
+            self.mappings[i] = kj::mv(self.mappings.back());
+          }
+          self.mappings.removeLast();
+          break;
+        }
+      }
+    }
+    return SQLITE_OK;
+  });
 },
 #undef WRAP_METHOD
 };
@@ -13,6 +13,7 @@
 struct sqlite3;
 struct sqlite3_vfs;
 struct sqlite3_stmt;
+struct sqlite3_backup;
 
 KJ_DECLARE_NON_POLYMORPHIC(sqlite3_stmt);
 
@@ -25,6 +26,12 @@ using kj::uint;
 class SqliteObserver {
  public:
   virtual void addQueryStats(uint64_t rowsRead, uint64_t rowsWritten) {}
+  // Called when the KV table is cleared by deleteAll(). `rowsCounted` is the number of rows that
+  // had to be scanned in order to count the keys being deleted, which is zero when the count is
+  // estimated instead.
+  virtual void addDeleteAllStats(uint64_t rowsCounted) {}
+  // Called by users of a prepared-statement cache (such as SqlStorage::exec()) for each lookup.
+  virtual void addStatementCacheStats(uint64_t hits, uint64_t misses) {}
   // The method is not used by the SqliteDatabase, it is added here for convenience
   virtual void setSqliteStoredBytes(uint64_t sqliteStoredBytes) {}
 
@@ -45,6 +52,7 @@ class SqliteDatabase {
   class Statement;
   class Lock;
   class LockManager;
+  class Backup;
   struct VfsOptions;
 
   struct IngestResult {
@@ -191,6 +199,25 @@ class SqliteDatabase {
   // Execute a function with the given regulator.
   void executeWithRegulator(const Regulator& regulator, kj::FunctionParam<void()> func);
 
+  SqliteObserver& getSqliteObserver() {
+    return sqliteObserver;
+  }
+
+  struct PageCacheStats {
+    uint64_t hits;
+    uint64_t misses;
+  };
+
+  // Returns the number of page cache hits and misses on this database so far. The counters
+  // start over from zero after reset(), since that reopens the database.
+  PageCacheStats getPageCacheStats();
+
+  // Sets the process-wide SQLite heap limits. The soft limit controls how much page caching SQLite
+  // does across all databases, while the hard limit protects the process from runaway memory use.
+  // If never called, a 128MB soft limit and 512MB hard limit are used. Call this before opening
+  // any databases.
+  static void setHeapLimits(uint64_t softLimit, uint64_t hardLimit);
+
   // Resets the database to an empty state by deleting the underlying database file and creating
   // a new one in its place. This is the recommended way to "drop database" in SQLite, and is used
   // to implement deleteAll() in Workers.
@@ -446,6 +473,15 @@ class SqliteDatabase::Query final: private ResetListener {
     return nextRow(/*first=*/false);
   }
 
+  // Calls `func` for the current row and then advances, repeating until either `maxRows` rows
+  // have been visited or there are no more rows. Returns the number of rows visited. This is
+  // equivalent to calling nextRow() in a loop, but sets up the regulator and updates the row
+  // counters once per batch instead of once per row, which adds up for large result sets.
+  //
+  // `func` may read the current row using the get methods below, but must not otherwise use the
+  // database.
+  uint forEachRow(uint maxRows, kj::FunctionParam<void()> func);
+
   // How many columns does each row of the result have?
   uint columnCount();
 
@@ -600,6 +636,42 @@ class SqliteDatabase::Query final: private ResetListener {
   void nextRow(bool first);
 };
 
+// Copies one database into another, page by page, using SQLite's online backup API. This is much
+// faster than copying row by row, and the result is a consistent snapshot: writes made through
+// the source SqliteDatabase while the backup is in progress are carried over to the
+// destination, while writes made through other connections cause the backup to start over.
+//
+// The copy replaces the entire contents of the destination. Exporting a snapshot therefore means
+// backing up into a fresh database (e.g. in an in-memory directory) whose file can then be
+// streamed elsewhere, and ingesting one means backing up from a database opened on the snapshot.
+//
+// Neither database may be reset() while a Backup exists.
+class SqliteDatabase::Backup {
+ public:
+  Backup(SqliteDatabase& source, SqliteDatabase& destination);
+  ~Backup() noexcept(false);
+  KJ_DISALLOW_COPY_AND_MOVE(Backup);
+
+  // Copies up to `pages` more pages. Returns true once the copy is complete. Callers copying
+  // large databases can interleave steps with other work to avoid blocking for too long.
+  bool step(uint pages);
+
+  // Copies all remaining pages.
+  void finish() {
+    while (!step(kj::maxValue)) {}
+  }
+
+  // Total number of pages in the source database and the number still to be copied, as of the
+  // last step().
+  uint pageCount();
+  uint remainingPages();
+
+ private:
+  SqliteDatabase& destination;
+  sqlite3_backup* backup;
+  bool done = false;
+};
+
 // Options affecting SqliteDatabase::Vfs onstructor.
 struct SqliteDatabase::VfsOptions {
 
@@ -619,6 +691,31 @@ struct SqliteDatabase::VfsOptions {
   // will fall back to the native VFS implementation. In that case, the options you set here will
   // be ORed with the ones set by the underlying VFS.
   int deviceCharacteristics = 0x00001000;  // = SQLITE_FCNTL_POWERSAFE_OVERWRITE
+
+  // If set, `PRAGMA cache_size` is applied to every database opened through this VFS, so that
+  // the page cache of each database is bounded independently of the process-wide heap limits.
+  // As with the pragma, a positive value is a number of pages, and a negative value is a number
+  // of KiB. See: https://www.sqlite.org/pragma.html#pragma_cache_size
+  kj::Maybe<int64_t> cacheSize;
+
+  // If set, `PRAGMA mmap_size` is applied to every database opened through this VFS. This only
+  // has an effect when the native VFS is in use (i.e. the directory is a real disk directory).
+  // See: https://www.sqlite.org/pragma.html#pragma_mmap_size
+  kj::Maybe<int64_t> mmapSize;
+
+  // If true, and the directory is not a real disk directory, databases opened read-only through
+  // this VFS serve page reads through `kj::ReadableFile::mmap()` (SQLite's xFetch()) rather than
+  // copying each page. This only takes effect when `mmapSize` is also set.
+  //
+  // Only enable this if nothing writes to the underlying files while they're open read-only,
+  // e.g. for immutable snapshots: KJ's in-memory files cannot be resized while mapped, so a
+  // concurrent write extending the file would fail.
+  bool mmapReadOnlyFiles = false;
+
+  // If true, every writable database opened through this VFS is switched to WAL journaling mode
+  // (`PRAGMA journal_mode=WAL`), including after reset(). WAL mode makes commits cheaper, since a
+  // commit only needs to append to the log. See: https://www.sqlite.org/wal.html
+  bool walMode = false;
 };
 
 // Implements a SQLite VFS based on a KJ directory.
@@ -46,6 +46,10 @@ class MemoryInputStream final: public kj::AsyncInputStream {
     return toRead;
   }
 
+  kj::Maybe<uint64_t> tryGetLength() override {
+    return data.size();
+  }
+
  private:
   kj::ArrayPtr<const kj::byte> data;
 };
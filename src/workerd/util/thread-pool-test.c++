@@ -0,0 +1,72 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "thread-pool.h"
+
+#include <kj/test.h>
+
+namespace workerd {
+namespace {
+
+KJ_TEST("ThreadPool runs tasks off the calling thread") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  ThreadPool pool(2);
+  KJ_EXPECT(pool.getThreadCount() == 2);
+
+  auto callerId = kj::getCurrentThreadId();
+  auto promises = kj::heapArrayBuilder<kj::Promise<ThreadPool::Result<uint>>>(8);
+  for (auto i: kj::zeroTo(8u)) {
+    promises.add(pool.run<uint>([i, callerId]() {
+      KJ_ASSERT(kj::getCurrentThreadId() != callerId);
+      return i * i;
+    }));
+  }
+
+  auto results = kj::joinPromises(promises.finish()).wait(ws);
+  for (auto i: kj::zeroTo(results.size())) {
+    KJ_EXPECT(results[i].value == i * i);
+    KJ_EXPECT(results[i].cpuTime >= 0 * kj::NANOSECONDS);
+  }
+}
+
+KJ_TEST("ThreadPool propagates exceptions") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  ThreadPool pool(1);
+
+  auto promise = pool.run<int>([]() -> int { KJ_FAIL_REQUIRE("task failed"); });
+  KJ_EXPECT_THROW_MESSAGE("task failed", promise.wait(ws));
+}
+
+KJ_TEST("ThreadPool skips tasks whose promise was dropped") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  ThreadPool pool(1);
+
+  // Park the only thread so that the next task is still queued when we drop it.
+  kj::MutexGuarded<bool> release(false);
+  auto blocker = pool.run<bool>([&]() {
+    release.lockExclusive().wait([](bool released) { return released; });
+    return true;
+  });
+
+  kj::MutexGuarded<bool> ran(false);
+  {
+    auto dropped = pool.run<bool>([&]() {
+      *ran.lockExclusive() = true;
+      return true;
+    });
+  }
+
+  *release.lockExclusive() = true;
+  KJ_EXPECT(blocker.wait(ws).value);
+
+  // Run one more task to make sure the dropped one has been dequeued.
+  KJ_EXPECT(pool.run<bool>([]() { return true; }).wait(ws).value);
+  KJ_EXPECT(!*ran.lockExclusive());
+}
+
+}  // namespace
+}  // namespace workerd
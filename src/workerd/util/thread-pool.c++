@@ -0,0 +1,86 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "thread-pool.h"
+
+#include <kj/debug.h>
+
+#include <thread>
+
+#if _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+namespace workerd {
+
+ThreadPool::ThreadPool(uint threadCount) {
+  KJ_REQUIRE(threadCount > 0);
+  auto builder = kj::heapArrayBuilder<kj::Own<kj::Thread>>(threadCount);
+  for (auto i KJ_UNUSED: kj::zeroTo(threadCount)) {
+    builder.add(kj::heap<kj::Thread>([this]() { threadMain(); }));
+  }
+  threads = builder.finish();
+}
+
+ThreadPool::~ThreadPool() noexcept(false) {
+  // Tasks that never started are dropped here, which rejects their promises. The threads are
+  // joined when `threads` is destroyed, after each finishes its current task.
+  std::deque<kj::Function<void()>> pending;
+  {
+    auto lock = queue.lockExclusive();
+    lock->shuttingDown = true;
+    pending = kj::mv(lock->tasks);
+  }
+}
+
+ThreadPool& ThreadPool::getShared() {
+  // Intentionally leaked so that no pool thread can outlive the pool during static destruction.
+  static ThreadPool* pool =
+      new ThreadPool(kj::max(1u, kj::min(8u, std::thread::hardware_concurrency() / 2)));
+  return *pool;
+}
+
+void ThreadPool::enqueue(kj::Function<void()> task) {
+  auto lock = queue.lockExclusive();
+  KJ_REQUIRE(!lock->shuttingDown, "thread pool is shutting down");
+  lock->tasks.push_back(kj::mv(task));
+}
+
+void ThreadPool::threadMain() {
+  for (;;) {
+    kj::Maybe<kj::Function<void()>> next;
+    {
+      auto lock = queue.lockExclusive();
+      lock.wait([](const Queue& q) { return q.shuttingDown || !q.tasks.empty(); });
+      if (lock->shuttingDown) return;
+      next = kj::mv(lock->tasks.front());
+      lock->tasks.pop_front();
+    }
+    KJ_IF_SOME(task, next) {
+      task();
+    }
+  }
+}
+
+kj::Duration ThreadPool::threadCpuTime() {
+#if _WIN32
+  FILETIME creation, exit, kernel, user;
+  if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+    return 0 * kj::NANOSECONDS;
+  }
+  auto toTicks = [](const FILETIME& time) {
+    return (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+  };
+  // FILETIME counts 100ns ticks.
+  return (toTicks(kernel) + toTicks(user)) * 100 * kj::NANOSECONDS;
+#else
+  struct timespec ts;
+  KJ_SYSCALL(clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts));
+  return ts.tv_sec * kj::SECONDS + ts.tv_nsec * kj::NANOSECONDS;
+#endif
+}
+
+}  // namespace workerd
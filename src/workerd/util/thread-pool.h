@@ -0,0 +1,88 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <kj/async.h>
+#include <kj/function.h>
+#include <kj/mutex.h>
+#include <kj/thread.h>
+#include <kj/time.h>
+
+#include <deque>
+
+namespace workerd {
+
+using kj::uint;
+
+// A fixed-size pool of threads for running CPU-bound native work -- compression, key
+// derivation, and the like -- off the isolate thread. Work is submitted from a thread that has a
+// KJ event loop, and its result is delivered back to that thread as a promise.
+//
+// Tasks run with no isolate lock and must not touch JavaScript heap objects or anything else
+// owned by the submitting thread. Copy the inputs into the task before submitting it.
+class ThreadPool {
+ public:
+  explicit ThreadPool(uint threadCount);
+  ~ThreadPool() noexcept(false);
+  KJ_DISALLOW_COPY_AND_MOVE(ThreadPool);
+
+  // Returns the process-wide pool, creating it on first use. It is sized from the number of
+  // hardware threads and is never destroyed.
+  static ThreadPool& getShared();
+
+  template <typename T>
+  struct Result {
+    T value;
+
+    // CPU time the task spent on its pool thread, so that the caller can charge it to whatever
+    // requested the work.
+    kj::Duration cpuTime;
+  };
+
+  // Queues `func` to run on a pool thread. If the returned promise is dropped before the task
+  // starts, the task is skipped. A task that has already started runs to completion and its
+  // result is discarded. Exceptions thrown by `func` reject the promise.
+  template <typename T>
+  kj::Promise<Result<T>> run(kj::Function<T()> func);
+
+  uint getThreadCount() const {
+    return threads.size();
+  }
+
+ private:
+  struct Queue {
+    std::deque<kj::Function<void()>> tasks;
+    bool shuttingDown = false;
+  };
+
+  kj::MutexGuarded<Queue> queue;
+  kj::Array<kj::Own<kj::Thread>> threads;
+
+  void enqueue(kj::Function<void()> task);
+  void threadMain();
+
+  // CPU time consumed so far by the calling thread.
+  static kj::Duration threadCpuTime();
+};
+
+template <typename T>
+kj::Promise<ThreadPool::Result<T>> ThreadPool::run(kj::Function<T()> func) {
+  auto paf = kj::newPromiseAndCrossThreadFulfiller<Result<T>>();
+  enqueue([func = kj::mv(func), fulfiller = kj::mv(paf.fulfiller)]() mutable {
+    // The submitting thread has already given up on the result.
+    if (!fulfiller->isWaiting()) return;
+
+    auto start = threadCpuTime();
+    KJ_IF_SOME(exception, kj::runCatchingExceptions([&]() {
+      auto value = func();
+      fulfiller->fulfill(Result<T>{kj::mv(value), threadCpuTime() - start});
+    })) {
+      fulfiller->reject(kj::mv(exception));
+    }
+  });
+  return kj::mv(paf.promise);
+}
+
+}  // namespace workerd
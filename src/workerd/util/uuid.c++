@@ -4,7 +4,7 @@
 
 #include "uuid.h"
 
-#include <openssl/rand.h>
+#include "random.h"
 
 #include <kj/compat/http.h>
 
@@ -21,7 +21,7 @@ kj::String randomUUID(kj::Maybe<kj::EntropySource&> optionalEntropySource) {
   KJ_IF_SOME(entropySource, optionalEntropySource) {
     entropySource.generate(buffer);
   } else {
-    KJ_ASSERT(RAND_bytes(buffer, sizeof(buffer)) == 1);
+    getRandomBytes(buffer);
   }
   buffer[6] = kj::byte((buffer[6] & 0x0f) | 0x40);
   buffer[8] = kj::byte((buffer[8] & 0x3f) | 0x80);